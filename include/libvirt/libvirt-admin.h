@@ -187,6 +187,148 @@ virAdmServerPtr virAdmConnectLookupServer(virAdmConnectPtr conn,
 
 # define VIR_THREADPOOL_JOB_QUEUE_DEPTH "jobQueueDepth"
 
+/**
+ * VIR_THREADPOOL_MUTATING_WORKERS_MAX:
+ * Macro for the threadpool maxMutatingWorkers limit: represents the upper
+ * limit to number of ordinary workers processing calls which modify state at
+ * the same time, so that the remaining workers stay available for calls which
+ * only query state, as VIR_TYPED_PARAM_UINT. 0 means no limit.
+ */
+
+# define VIR_THREADPOOL_MUTATING_WORKERS_MAX "maxMutatingWorkers"
+
+/**
+ * VIR_THREADPOOL_MUTATING_JOB_QUEUE_DEPTH:
+ * Macro for the threadpool mutatingJobQueueDepth attribute: represents the
+ * current number of jobs modifying state waiting in a queue to be processed,
+ * as VIR_TYPED_PARAM_UINT.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_MUTATING_JOB_QUEUE_DEPTH "mutatingJobQueueDepth"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_POOL_HITS:
+ * Macro for the messagePoolHits attribute: represents the number of RPC
+ * messages and message buffers the daemon was able to reuse instead of
+ * allocating them, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_MESSAGE_POOL_HITS "messagePoolHits"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_POOL_MISSES:
+ * Macro for the messagePoolMisses attribute: represents the number of RPC
+ * messages and message buffers the daemon had to allocate because none
+ * were available for reuse, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_MESSAGE_POOL_MISSES "messagePoolMisses"
+
+/**
+ * VIR_THREADPOOL_JOBS_COMPLETED:
+ * Macro for the threadpool jobsCompleted attribute: represents the number of
+ * jobs the workers finished since the server started, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOBS_COMPLETED "jobsCompleted"
+
+/**
+ * VIR_THREADPOOL_JOB_WAIT_TIME:
+ * Macro for the threadpool jobWaitTime attribute: represents the total time
+ * in microseconds jobs spent queued before a worker picked them up, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_WAIT_TIME "jobWaitTime"
+
+/**
+ * VIR_THREADPOOL_JOB_WAIT_TIME_MAX:
+ * Macro for the threadpool jobWaitTimeMax attribute: represents the longest
+ * time in microseconds a job spent queued, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_WAIT_TIME_MAX "jobWaitTimeMax"
+
+/**
+ * VIR_THREADPOOL_JOB_WAIT_HISTOGRAM_PREFIX:
+ * Prefix of the threadpool job wait time histogram attributes, as
+ * VIR_TYPED_PARAM_ULLONG. Each attribute is named by the prefix followed by
+ * the upper bound of the bucket in microseconds, or "inf" for the last
+ * bucket, and represents the number of jobs which waited longer than the
+ * bound of the previous bucket and at most the bound of this one.
+ *
+ * NOTE: These attributes are read-only and any attempt to set them will be
+ * denied by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_WAIT_HISTOGRAM_PREFIX "jobWaitHistogram."
+
+/**
+ * VIR_THREADPOOL_JOB_RUN_TIME:
+ * Macro for the threadpool jobRunTime attribute: represents the total time
+ * in microseconds workers spent running finished jobs, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_RUN_TIME "jobRunTime"
+
+/**
+ * VIR_THREADPOOL_JOB_RUN_TIME_MAX:
+ * Macro for the threadpool jobRunTimeMax attribute: represents the longest
+ * time in microseconds a finished job ran, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_RUN_TIME_MAX "jobRunTimeMax"
+
+/**
+ * VIR_THREADPOOL_JOBS_LONG_RUNNING:
+ * Macro for the threadpool longRunningJobs attribute: represents the number
+ * of jobs which have been running for more than a second right now, as
+ * VIR_TYPED_PARAM_UINT.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOBS_LONG_RUNNING "longRunningJobs"
+
+/**
+ * VIR_THREADPOOL_JOB_OLDEST_RUN_TIME:
+ * Macro for the threadpool oldestJobRunTime attribute: represents the time
+ * in microseconds the longest running job currently being processed has
+ * been running for, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_OLDEST_RUN_TIME "oldestJobRunTime"
+
 /* Tunables for a server workerpool */
 int virAdmServerGetThreadPoolParameters(virAdmServerPtr srv,
                                         virTypedParameterPtr *params,
@@ -343,6 +485,83 @@ virAdmServerLookupClient(virAdmServerPtr srv,
 
 # define VIR_CLIENT_INFO_SELINUX_CONTEXT "selinux_context"
 
+/* Client statistics, reported with VIR_ADM_CLIENT_INFO_STATS */
+
+/**
+ * VIR_CLIENT_INFO_RX_BYTES:
+ * Macro represents the number of bytes received from the client, not
+ * counting the overhead of TLS or SASL encryption, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_CLIENT_INFO_RX_BYTES "rx_bytes"
+
+/**
+ * VIR_CLIENT_INFO_TX_BYTES:
+ * Macro represents the number of bytes sent to the client, not counting
+ * the overhead of TLS or SASL encryption, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_CLIENT_INFO_TX_BYTES "tx_bytes"
+
+/**
+ * VIR_CLIENT_INFO_RX_MESSAGES:
+ * Macro represents the number of RPC messages received from the client,
+ * as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_CLIENT_INFO_RX_MESSAGES "rx_messages"
+
+/**
+ * VIR_CLIENT_INFO_TX_MESSAGES:
+ * Macro represents the number of RPC messages sent to the client,
+ * including replies, events and stream data, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_CLIENT_INFO_TX_MESSAGES "tx_messages"
+
+/**
+ * VIR_CLIENT_INFO_CALLS:
+ * Macro represents the number of calls dispatched on behalf of the client,
+ * as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_CLIENT_INFO_CALLS "calls"
+
+/**
+ * VIR_CLIENT_INFO_CALLS_PREFIX:
+ * Macro represents the prefix of the number of calls of each procedure
+ * dispatched on behalf of the client, as VIR_TYPED_PARAM_ULLONG. The
+ * full name of the field is "calls.<program>.<procedure>", where
+ * <program> is the RPC program number in hexadecimal and <procedure>
+ * the procedure number in decimal. Only procedures which were called at
+ * least once are reported.
+ */
+
+# define VIR_CLIENT_INFO_CALLS_PREFIX "calls."
+
+/**
+ * VIR_CLIENT_INFO_LATENCY_PREFIX:
+ * Macro represents the prefix of the histogram of the time it took to
+ * dispatch calls of the client, as VIR_TYPED_PARAM_ULLONG. The full name
+ * of the field is "latency.<N>": bucket 0 counts calls which took less
+ * than a microsecond, bucket N > 0 calls which took at least 2^(N-1) but
+ * less than 2^N microseconds. The last bucket also counts all calls
+ * which took longer. Only non-empty buckets are reported.
+ */
+
+# define VIR_CLIENT_INFO_LATENCY_PREFIX "latency."
+
+/**
+ * virAdmClientInfoFlags:
+ *
+ * Flags affecting the data returned by virAdmClientGetInfo.
+ */
+typedef enum {
+    VIR_ADM_CLIENT_INFO_STATS = (1 << 0), /* report traffic and
+                                             call statistics too */
+} virAdmClientInfoFlags;
+
 int virAdmClientGetInfo(virAdmClientPtr client,
                         virTypedParameterPtr *params,
                         int *nparams,
@@ -421,6 +640,61 @@ int virAdmConnectSetLoggingFilters(virAdmConnectPtr conn,
                                    const char *filters,
                                    unsigned int flags);
 
+/**
+ * VIR_OBJECT_STATS_CLASS_COUNT:
+ * Macro represents the number of object classes reported,
+ * as VIR_TYPED_PARAM_UINT.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_COUNT "class.count"
+
+/**
+ * VIR_OBJECT_STATS_CLASS_PREFIX:
+ * Macro represents the prefix of the fields describing each object class.
+ * The full name of the fields is "class.<num>.<suffix>", where <num> ranges
+ * from 0 to VIR_OBJECT_STATS_CLASS_COUNT - 1 and <suffix> is one of the
+ * VIR_OBJECT_STATS_CLASS_SUFFIX_* macros.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_PREFIX "class."
+
+/**
+ * VIR_OBJECT_STATS_CLASS_SUFFIX_NAME:
+ * Macro represents the name of the object class, as VIR_TYPED_PARAM_STRING.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_SUFFIX_NAME ".name"
+
+/**
+ * VIR_OBJECT_STATS_CLASS_SUFFIX_SIZE:
+ * Macro represents the size of an instance of the object class in bytes,
+ * not counting any memory the instance points to, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_SUFFIX_SIZE ".size"
+
+/**
+ * VIR_OBJECT_STATS_CLASS_SUFFIX_LIVE:
+ * Macro represents the number of instances of the object class which are
+ * currently alive, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_SUFFIX_LIVE ".live"
+
+/**
+ * VIR_OBJECT_STATS_CLASS_SUFFIX_CREATED:
+ * Macro represents the number of instances of the object class created
+ * since the daemon started, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_OBJECT_STATS_CLASS_SUFFIX_CREATED ".created"
+
+int virAdmConnectGetObjectStats(virAdmConnectPtr conn,
+                                virTypedParameterPtr *params,
+                                int *nparams,
+                                unsigned int flags);
+
 # ifdef __cplusplus
 }
 # endif
@@ -80,6 +80,13 @@ virDomainSnapshotPtr virDomainSnapshotCreateXML(virDomainPtr domain,
                                                 const char *xmlDesc,
                                                 unsigned int flags);
 
+/* Take a consistent disk snapshot of several VMs at once */
+int virDomainSnapshotCreateXMLGroup(virDomainPtr *domains,
+                                    unsigned int ndomains,
+                                    const char **xmlDescs,
+                                    virDomainSnapshotPtr *snapshots,
+                                    unsigned int flags);
+
 typedef enum {
     VIR_DOMAIN_SNAPSHOT_XML_SECURE         = VIR_DOMAIN_XML_SECURE, /* dump security sensitive information too */
 } virDomainSnapshotXMLFlags;
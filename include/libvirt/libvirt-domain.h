@@ -302,6 +302,7 @@ typedef enum {
     VIR_DOMAIN_START_BYPASS_CACHE = 1 << 2, /* Avoid file system cache pollution */
     VIR_DOMAIN_START_FORCE_BOOT   = 1 << 3, /* Boot, discarding any managed save */
     VIR_DOMAIN_START_VALIDATE     = 1 << 4, /* Validate the XML document against schema */
+    VIR_DOMAIN_START_INCOMING     = 1 << 5, /* Wait for an incoming migration */
 } virDomainCreateFlags;
 
 
@@ -1201,6 +1202,20 @@ int                     virDomainShutdown       (virDomainPtr domain);
 int                     virDomainShutdownFlags  (virDomainPtr domain,
                                                  unsigned int flags);
 
+/* Start or shut down many domains in one call */
+int virConnectStartDomains(virConnectPtr conn,
+                           virDomainPtr *domains,
+                           unsigned int ndomains,
+                           unsigned int parallel,
+                           int *results,
+                           unsigned int flags);
+int virConnectShutdownDomains(virConnectPtr conn,
+                              virDomainPtr *domains,
+                              unsigned int ndomains,
+                              unsigned int parallel,
+                              int *results,
+                              unsigned int flags);
+
 typedef enum {
     VIR_DOMAIN_REBOOT_DEFAULT        = 0,        /* hypervisor choice */
     VIR_DOMAIN_REBOOT_ACPI_POWER_BTN = (1 << 0), /* Send ACPI event */
@@ -1624,6 +1639,9 @@ virDomainGetMetadata(virDomainPtr domain,
  * virDomainXMLFlags:
  *
  * Flags available for virDomainGetXMLDesc
+ *
+ * If any of the VIR_DOMAIN_XML_SECTION_* flags is used, the XML contains
+ * only the name and UUID of the domain and the requested sections.
  */
 
 typedef enum {
@@ -1631,6 +1649,9 @@ typedef enum {
     VIR_DOMAIN_XML_INACTIVE     = (1 << 1), /* dump inactive domain information */
     VIR_DOMAIN_XML_UPDATE_CPU   = (1 << 2), /* update guest CPU requirements according to host CPU */
     VIR_DOMAIN_XML_MIGRATABLE   = (1 << 3), /* dump XML suitable for migration */
+    VIR_DOMAIN_XML_SECTION_METADATA   = (1 << 4), /* dump the title, description and metadata */
+    VIR_DOMAIN_XML_SECTION_DISKS      = (1 << 5), /* dump the <disk> devices */
+    VIR_DOMAIN_XML_SECTION_INTERFACES = (1 << 6), /* dump the <interface> devices */
 } virDomainXMLFlags;
 
 typedef enum {
@@ -2169,6 +2190,15 @@ int virDomainUpdateDeviceFlags(virDomainPtr domain,
 int virDomainDetachDeviceAlias(virDomainPtr domain,
                                const char *alias, unsigned int flags);
 
+int virDomainAttachDevices(virDomainPtr domain,
+                           const char **xmls,
+                           unsigned int nxmls,
+                           unsigned int flags);
+int virDomainDetachDevices(virDomainPtr domain,
+                           const char **xmls,
+                           unsigned int nxmls,
+                           unsigned int flags);
+
 typedef struct _virDomainStatsRecord virDomainStatsRecord;
 typedef virDomainStatsRecord *virDomainStatsRecordPtr;
 struct _virDomainStatsRecord {
@@ -2188,6 +2218,9 @@ typedef enum {
     VIR_DOMAIN_STATS_IOTHREAD = (1 << 7), /* return iothread poll info */
     VIR_DOMAIN_STATS_MEMORY = (1 << 8), /* return domain memory info */
     VIR_DOMAIN_STATS_DIRTYRATE = (1 << 9), /* return domain dirty rate info */
+    VIR_DOMAIN_STATS_VM = (1 << 10), /* return vm info */
+    VIR_DOMAIN_STATS_MONITOR = (1 << 11), /* return hypervisor monitor info */
+    VIR_DOMAIN_STATS_BLOCKJOB = (1 << 12), /* return block job info */
 } virDomainStatsTypes;
 
 typedef enum {
@@ -2202,6 +2235,8 @@ typedef enum {
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_SHUTOFF = VIR_CONNECT_LIST_DOMAINS_SHUTOFF,
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_OTHER = VIR_CONNECT_LIST_DOMAINS_OTHER,
 
+    VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED = 1 << 28, /* report only statistics which changed
+                                                            since the previous call */
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT = 1 << 29, /* report statistics that can be obtained
                                                            immediately without any blocking */
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING = 1 << 30, /* include backing chain for block stats */
@@ -2220,6 +2255,11 @@ int virDomainListGetStats(virDomainPtr *doms,
 
 void virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats);
 
+int virConnectDomainStatsSubscribe(virConnectPtr conn,
+                                   unsigned int stats,
+                                   unsigned int interval,
+                                   unsigned int flags);
+
 /*
  * Perf Event API
  */
@@ -3352,6 +3392,8 @@ typedef enum {
                                               * completed job */
     VIR_DOMAIN_JOB_STATS_KEEP_COMPLETED = 1 << 1, /* don't remove completed
                                                      stats when reading them */
+    VIR_DOMAIN_JOB_STATS_LOCK = 1 << 2, /* return statistics of waiting for
+                                         * and holding domain jobs */
 } virDomainGetJobStatsFlags;
 
 int virDomainGetJobInfo(virDomainPtr dom,
@@ -3714,6 +3756,32 @@ typedef enum {
  */
 # define VIR_DOMAIN_JOB_DISK_TEMP_TOTAL "disk_temp_total"
 
+/**
+ * VIR_DOMAIN_JOB_START_PHASE_PREFIX:
+ *
+ * virDomainGetJobStats field prefix for jobs starting a domain: the time
+ * in microseconds spent in a phase of starting the domain as
+ * VIR_TYPED_PARAM_ULLONG. The prefix is followed by the name of the phase,
+ * i.e., "init", "prepare_domain", "prepare_host", "commandline", "spawn",
+ * "namespace", "cgroup", "label", "monitor", "setup" or "finish".
+ */
+# define VIR_DOMAIN_JOB_START_PHASE_PREFIX "start_phase_"
+
+/**
+ * VIR_DOMAIN_JOB_LOCK_PREFIX:
+ *
+ * virDomainGetJobStats field prefix for statistics returned with
+ * VIR_DOMAIN_JOB_STATS_LOCK. The prefix is followed by the job type, e.g.,
+ * "query", "modify" or "async_migration_out", and one of "_count" (number
+ * of times the job was acquired), "_waiting" (callers waiting for it right
+ * now), "_wait_total", "_wait_max", "_hold_total", "_hold_max" (times in
+ * milliseconds) or "_wait_hist_<bucket>" and "_hold_hist_<bucket>" where
+ * the bucket is "1ms", "10ms", "100ms", "1s", "10s" or "inf" and counts
+ * the waits or holds which took at most that long. All fields are
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_LOCK_PREFIX "lock_"
+
 /**
  * virConnectDomainEventGenericCallback:
  * @conn: the connection pointer
@@ -4678,6 +4746,29 @@ typedef void (*virConnectDomainEventMemoryDeviceSizeChangeCallback)(virConnectPt
                                                                     void *opaque);
 
 
+/**
+ * virConnectDomainEventStatsCallback:
+ * @conn: connection object
+ * @dom: domain the statistics belong to
+ * @params: domain statistics, in the format reported by
+ *          virConnectGetAllDomainStats()
+ * @nparams: size of the params array
+ * @opaque: application specific data
+ *
+ * This callback occurs periodically for every domain once statistics
+ * were requested with virConnectDomainStatsSubscribe() on the same
+ * connection.
+ *
+ * The callback signature to use when registering for an event of type
+ * VIR_DOMAIN_EVENT_ID_STATS with virConnectDomainEventRegisterAny().
+ */
+typedef void (*virConnectDomainEventStatsCallback)(virConnectPtr conn,
+                                                   virDomainPtr dom,
+                                                   virTypedParameterPtr params,
+                                                   int nparams,
+                                                   void *opaque);
+
+
 /**
  * VIR_DOMAIN_EVENT_CALLBACK:
  *
@@ -4722,6 +4813,7 @@ typedef enum {
     VIR_DOMAIN_EVENT_ID_BLOCK_THRESHOLD = 24, /* virConnectDomainEventBlockThresholdCallback */
     VIR_DOMAIN_EVENT_ID_MEMORY_FAILURE = 25,  /* virConnectDomainEventMemoryFailureCallback */
     VIR_DOMAIN_EVENT_ID_MEMORY_DEVICE_SIZE_CHANGE = 26, /* virConnectDomainEventMemoryDeviceSizeChangeCallback */
+    VIR_DOMAIN_EVENT_ID_STATS = 27,          /* virConnectDomainEventStatsCallback */
 
 # ifdef VIR_ENUM_SENTINELS
     VIR_DOMAIN_EVENT_ID_LAST
@@ -5174,8 +5266,57 @@ typedef enum {
 # endif
 } virDomainDirtyRateStatus;
 
+/**
+ * virDomainDirtyRateCalcFlags:
+ *
+ * Flags OR'ed together to provide specific behaviour when calculating dirty
+ * page rate for a Domain
+ */
+typedef enum {
+    VIR_DOMAIN_DIRTYRATE_MODE_PAGE_SAMPLING = 0,        /* default mode - page-sampling */
+    VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP = 1 << 0,    /* dirty-bitmap mode */
+    VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING = 1 << 1,      /* dirty-ring mode */
+} virDomainDirtyRateCalcFlags;
+
 int virDomainStartDirtyRateCalc(virDomainPtr domain,
                                 int seconds,
                                 unsigned int flags);
 
+/**
+ * virDomainBatch:
+ *
+ * A virDomainBatch collects several queries about domains, which are
+ * then run together with as few round trips to the hypervisor as
+ * possible.
+ */
+typedef struct _virDomainBatch virDomainBatch;
+
+/**
+ * virDomainBatchPtr:
+ *
+ * A virDomainBatchPtr is a pointer to a virDomainBatch structure.
+ */
+typedef virDomainBatch *virDomainBatchPtr;
+
+virDomainBatchPtr virDomainBatchNew(virConnectPtr conn,
+                                    unsigned int flags);
+int virDomainBatchAddGetInfo(virDomainBatchPtr batch,
+                             virDomainPtr domain,
+                             virDomainInfoPtr info);
+int virDomainBatchAddGetState(virDomainBatchPtr batch,
+                              virDomainPtr domain,
+                              int *state,
+                              int *reason,
+                              unsigned int flags);
+int virDomainBatchAddGetBlockInfo(virDomainBatchPtr batch,
+                                  virDomainPtr domain,
+                                  const char *disk,
+                                  virDomainBlockInfoPtr info,
+                                  unsigned int flags);
+int virDomainBatchRun(virDomainBatchPtr batch,
+                      unsigned int flags);
+virErrorPtr virDomainBatchGetError(virDomainBatchPtr batch,
+                                   int idx);
+void virDomainBatchFree(virDomainBatchPtr batch);
+
 #endif /* LIBVIRT_DOMAIN_H */
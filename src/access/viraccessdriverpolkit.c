@@ -22,10 +22,12 @@
 
 #include "viraccessdriverpolkit.h"
 #include "viralloc.h"
+#include "virbuffer.h"
 #include "vircommand.h"
 #include "virlog.h"
 #include "virprocess.h"
 #include "virerror.h"
+#include "virgdbus.h"
 #include "virpolkit.h"
 #include "virstring.h"
 
@@ -39,14 +41,209 @@ VIR_LOG_INIT("access.accessdriverpolkit");
 
 #define VIR_ACCESS_DRIVER_POLKIT_ACTION_PREFIX "org.libvirt.api"
 
+/* How long in microseconds a decision of polkit is reused for */
+#define VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL (5 * 1000 * 1000)
+
+/* Upper limit on the number of cached decisions */
+#define VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX 16384
+
 typedef struct _virAccessDriverPolkitPrivate virAccessDriverPolkitPrivate;
 struct _virAccessDriverPolkitPrivate {
-    bool ignore;
+    virMutex lock;
+    /* Decisions keyed by the caller, action and attributes, the values
+     * are virAccessDriverPolkitDecision */
+    GHashTable *cache;
+
+    unsigned int changedID;
+    unsigned int ownerChangedID;
+};
+
+typedef struct _virAccessDriverPolkitDecision virAccessDriverPolkitDecision;
+struct _virAccessDriverPolkitDecision {
+    bool allowed;
+    unsigned long long expires;
 };
 
 
-static void virAccessDriverPolkitCleanup(virAccessManager *manager G_GNUC_UNUSED)
+static void
+virAccessDriverPolkitCacheClear(virAccessDriverPolkitPrivate *priv)
+{
+    virMutexLock(&priv->lock);
+    g_hash_table_remove_all(priv->cache);
+    virMutexUnlock(&priv->lock);
+}
+
+
+/* Forgets all decisions whenever the polkit rules change or polkitd
+ * restarts, as they may not hold anymore */
+static void
+virAccessDriverPolkitChanged(GDBusConnection *connection G_GNUC_UNUSED,
+                             const char *senderName G_GNUC_UNUSED,
+                             const char *objectPath G_GNUC_UNUSED,
+                             const char *interfaceName G_GNUC_UNUSED,
+                             const char *signalName G_GNUC_UNUSED,
+                             GVariant *parameters G_GNUC_UNUSED,
+                             gpointer opaque)
+{
+    virAccessDriverPolkitPrivate *priv = opaque;
+
+    VIR_DEBUG("Polkit authority changed, dropping cached decisions");
+    virAccessDriverPolkitCacheClear(priv);
+}
+
+
+static int
+virAccessDriverPolkitSetup(virAccessManager *manager)
+{
+    virAccessDriverPolkitPrivate *priv = virAccessManagerGetPrivateData(manager);
+    GDBusConnection *sysbus;
+
+    if (virMutexInit(&priv->lock) < 0) {
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        return -1;
+    }
+
+    priv->cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    /* Without the signals any decision could outlive a change of the
+     * rules, so decisions are only cached when they can be invalidated */
+    if (!virGDBusHasSystemBus() ||
+        !(sysbus = virGDBusGetSystemBus())) {
+        virResetLastError();
+        return 0;
+    }
+
+    priv->changedID =
+        g_dbus_connection_signal_subscribe(sysbus,
+                                           NULL,
+                                           "org.freedesktop.PolicyKit1.Authority",
+                                           "Changed",
+                                           "/org/freedesktop/PolicyKit1/Authority",
+                                           NULL,
+                                           G_DBUS_SIGNAL_FLAGS_NONE,
+                                           virAccessDriverPolkitChanged,
+                                           priv,
+                                           NULL);
+    priv->ownerChangedID =
+        g_dbus_connection_signal_subscribe(sysbus,
+                                           NULL,
+                                           "org.freedesktop.DBus",
+                                           "NameOwnerChanged",
+                                           NULL,
+                                           "org.freedesktop.PolicyKit1",
+                                           G_DBUS_SIGNAL_FLAGS_NONE,
+                                           virAccessDriverPolkitChanged,
+                                           priv,
+                                           NULL);
+
+    return 0;
+}
+
+
+static void virAccessDriverPolkitCleanup(virAccessManager *manager)
+{
+    virAccessDriverPolkitPrivate *priv = virAccessManagerGetPrivateData(manager);
+    GDBusConnection *sysbus;
+
+    if (!priv->cache)
+        return;
+
+    if (priv->changedID &&
+        (sysbus = virGDBusGetSystemBus())) {
+        g_dbus_connection_signal_unsubscribe(sysbus, priv->changedID);
+        g_dbus_connection_signal_unsubscribe(sysbus, priv->ownerChangedID);
+    }
+
+    g_clear_pointer(&priv->cache, g_hash_table_unref);
+    virMutexDestroy(&priv->lock);
+}
+
+
+static char *
+virAccessDriverPolkitCacheKey(const char *actionid,
+                              pid_t pid,
+                              unsigned long long startTime,
+                              uid_t uid,
+                              const char **attrs)
 {
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    virBufferAsprintf(&buf, "%lld:%llu:%u:%s",
+                      (long long)pid, startTime, (unsigned int)uid, actionid);
+
+    /* prefix the values with their length so that no combination of
+     * names can produce the key of another object */
+    for (i = 0; attrs && attrs[i]; i++)
+        virBufferAsprintf(&buf, ":%zu:%s", strlen(attrs[i]), attrs[i]);
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+/* Returns 1 if a decision was found in the cache and stored in @allowed */
+static int
+virAccessDriverPolkitCacheLookup(virAccessDriverPolkitPrivate *priv,
+                                 const char *key,
+                                 bool *allowed)
+{
+    virAccessDriverPolkitDecision *decision;
+    int ret = 0;
+
+    if (!priv->changedID)
+        return 0;
+
+    virMutexLock(&priv->lock);
+    if ((decision = g_hash_table_lookup(priv->cache, key))) {
+        if (decision->expires > g_get_monotonic_time()) {
+            *allowed = decision->allowed;
+            ret = 1;
+        } else {
+            g_hash_table_remove(priv->cache, key);
+        }
+    }
+    virMutexUnlock(&priv->lock);
+
+    return ret;
+}
+
+
+static gboolean
+virAccessDriverPolkitCacheExpired(gpointer key G_GNUC_UNUSED,
+                                  gpointer value,
+                                  gpointer opaque)
+{
+    virAccessDriverPolkitDecision *decision = value;
+    unsigned long long *now = opaque;
+
+    return decision->expires <= *now;
+}
+
+
+static void
+virAccessDriverPolkitCacheStore(virAccessDriverPolkitPrivate *priv,
+                                const char *key,
+                                bool allowed)
+{
+    virAccessDriverPolkitDecision *decision;
+    unsigned long long now = g_get_monotonic_time();
+
+    if (!priv->changedID)
+        return;
+
+    decision = g_new0(virAccessDriverPolkitDecision, 1);
+    decision->allowed = allowed;
+    decision->expires = now + VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL;
+
+    virMutexLock(&priv->lock);
+    if (g_hash_table_size(priv->cache) >= VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX) {
+        g_hash_table_foreach_remove(priv->cache,
+                                    virAccessDriverPolkitCacheExpired, &now);
+        if (g_hash_table_size(priv->cache) >= VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX)
+            g_hash_table_remove_all(priv->cache);
+    }
+    g_hash_table_insert(priv->cache, g_strdup(key), decision);
+    virMutexUnlock(&priv->lock);
 }
 
 
@@ -116,15 +313,18 @@ virAccessDriverPolkitGetCaller(const char *actionid,
 
 
 static int
-virAccessDriverPolkitCheck(virAccessManager *manager G_GNUC_UNUSED,
+virAccessDriverPolkitCheck(virAccessManager *manager,
                            const char *typename,
                            const char *permname,
                            const char **attrs)
 {
+    virAccessDriverPolkitPrivate *priv = virAccessManagerGetPrivateData(manager);
     g_autofree char *actionid = NULL;
+    g_autofree char *key = NULL;
     pid_t pid;
     uid_t uid;
     unsigned long long startTime;
+    bool allowed;
     int rv;
 
     if (!(actionid = virAccessDriverPolkitFormatAction(typename, permname)))
@@ -136,6 +336,19 @@ virAccessDriverPolkitCheck(virAccessManager *manager G_GNUC_UNUSED,
                                        &uid) < 0)
         return -1;
 
+    key = virAccessDriverPolkitCacheKey(actionid, pid, startTime, uid, attrs);
+
+    if (virAccessDriverPolkitCacheLookup(priv, key, &allowed) == 1) {
+        VIR_DEBUG("Cached decision for action '%s' for process '%lld': %d",
+                  actionid, (long long)pid, allowed);
+        if (allowed)
+            return 1;
+
+        virAccessError(VIR_ERR_AUTH_FAILED, "%s",
+                       _("access denied by policy"));
+        return 0;
+    }
+
     VIR_DEBUG("Check action '%s' for process '%lld' time %lld uid %d",
               actionid, (long long)pid, startTime, uid);
 
@@ -147,9 +360,14 @@ virAccessDriverPolkitCheck(virAccessManager *manager G_GNUC_UNUSED,
                             false);
 
     if (rv == 0) {
+        virAccessDriverPolkitCacheStore(priv, key, true);
         return 1; /* Allowed */
     } else {
         if (rv == -2) {
+            /* Only plain denials are cached, a missing agent or a
+             * dismissed prompt may give a different answer next time */
+            if (virGetLastErrorCode() == VIR_ERR_AUTH_FAILED)
+                virAccessDriverPolkitCacheStore(priv, key, false);
             return 0; /* Denied */
         } else {
             return -1; /* Error */
@@ -445,6 +663,7 @@ virAccessDriverPolkitCheckStorageVol(virAccessManager *manager,
 virAccessDriver accessDriverPolkit = {
     .privateDataLen = sizeof(virAccessDriverPolkitPrivate),
     .name = "polkit",
+    .setup = virAccessDriverPolkitSetup,
     .cleanup = virAccessDriverPolkitCleanup,
     .checkConnect = virAccessDriverPolkitCheckConnect,
     .checkDomain = virAccessDriverPolkitCheckDomain,
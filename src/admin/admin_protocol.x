@@ -41,11 +41,14 @@ const ADMIN_SERVER_THREADPOOL_PARAMETERS_MAX = 32;
 const ADMIN_CLIENT_LIST_MAX = 16384;
 
 /* Upper limit on number of client info parameters */
-const ADMIN_CLIENT_INFO_PARAMETERS_MAX = 64;
+const ADMIN_CLIENT_INFO_PARAMETERS_MAX = 2048;
 
 /* Upper limit on number of client processing controls */
 const ADMIN_SERVER_CLIENT_LIMITS_MAX = 32;
 
+/* Upper limit on number of object statistics parameters */
+const ADMIN_CONNECT_OBJECT_STATS_PARAMETERS_MAX = 8192;
+
 /* A long string, which may NOT be NULL. */
 typedef string admin_nonnull_string<ADMIN_STRING_MAX>;
 
@@ -214,6 +217,14 @@ struct admin_connect_set_logging_filters_args {
     unsigned int flags;
 };
 
+struct admin_connect_get_object_stats_args {
+    unsigned int flags;
+};
+
+struct admin_connect_get_object_stats_ret {
+    admin_typed_param params<ADMIN_CONNECT_OBJECT_STATS_PARAMETERS_MAX>;
+};
+
 /* Define the program number, protocol version and procedure numbers here. */
 const ADMIN_PROGRAM = 0x06900690;
 const ADMIN_PROTOCOL_VERSION = 1;
@@ -324,5 +335,10 @@ enum admin_procedure {
     /**
      * @generate: both
      */
-    ADMIN_PROC_SERVER_UPDATE_TLS_FILES = 18
+    ADMIN_PROC_SERVER_UPDATE_TLS_FILES = 18,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_CONNECT_GET_OBJECT_STATS = 19
 };
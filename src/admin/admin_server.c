@@ -26,7 +26,9 @@
 #include "virerror.h"
 #include "viridentity.h"
 #include "virlog.h"
+#include "virobject.h"
 #include "rpc/virnetdaemon.h"
+#include "rpc/virnetmessage.h"
 #include "rpc/virnetserver.h"
 #include "virstring.h"
 #include "virthreadpool.h"
@@ -80,6 +82,12 @@ adminServerGetThreadPoolParameters(virNetServer *srv,
     size_t freeWorkers;
     size_t nPrioWorkers;
     size_t jobQueueDepth;
+    size_t maxMutatingWorkers;
+    size_t mutatingJobQueueDepth;
+    unsigned long long poolHits;
+    unsigned long long poolMisses;
+    virThreadPoolStats stats;
+    size_t i;
     g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
 
     virCheckFlags(0, -1);
@@ -87,12 +95,17 @@ adminServerGetThreadPoolParameters(virNetServer *srv,
     if (virNetServerGetThreadPoolParameters(srv, &minWorkers, &maxWorkers,
                                             &nWorkers, &freeWorkers,
                                             &nPrioWorkers,
-                                            &jobQueueDepth) < 0) {
+                                            &jobQueueDepth,
+                                            &maxMutatingWorkers,
+                                            &mutatingJobQueueDepth) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unable to retrieve threadpool parameters"));
         return -1;
     }
 
+    virNetMessageGetPoolStats(&poolHits, &poolMisses);
+    virNetServerGetThreadPoolStats(srv, &stats);
+
     if (virTypedParamListAddUInt(paramlist, minWorkers,
                                  "%s", VIR_THREADPOOL_WORKERS_MIN) < 0)
         return -1;
@@ -117,6 +130,65 @@ adminServerGetThreadPoolParameters(virNetServer *srv,
                                  "%s", VIR_THREADPOOL_JOB_QUEUE_DEPTH) < 0)
         return -1;
 
+    if (virTypedParamListAddUInt(paramlist, maxMutatingWorkers,
+                                 "%s", VIR_THREADPOOL_MUTATING_WORKERS_MAX) < 0)
+        return -1;
+
+    if (virTypedParamListAddUInt(paramlist, mutatingJobQueueDepth,
+                                 "%s", VIR_THREADPOOL_MUTATING_JOB_QUEUE_DEPTH) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, poolHits,
+                                   "%s", VIR_THREADPOOL_MESSAGE_POOL_HITS) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, poolMisses,
+                                   "%s", VIR_THREADPOOL_MESSAGE_POOL_MISSES) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, stats.jobsCompleted,
+                                   "%s", VIR_THREADPOOL_JOBS_COMPLETED) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, stats.waitTime,
+                                   "%s", VIR_THREADPOOL_JOB_WAIT_TIME) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, stats.waitTimeMax,
+                                   "%s", VIR_THREADPOOL_JOB_WAIT_TIME_MAX) < 0)
+        return -1;
+
+    for (i = 0; i < VIR_THREAD_POOL_WAIT_BUCKETS; i++) {
+        if (stats.waitBucketBound[i] == 0) {
+            if (virTypedParamListAddULLong(paramlist, stats.waitBucket[i],
+                                           "%sinf",
+                                           VIR_THREADPOOL_JOB_WAIT_HISTOGRAM_PREFIX) < 0)
+                return -1;
+        } else {
+            if (virTypedParamListAddULLong(paramlist, stats.waitBucket[i],
+                                           "%s%llu",
+                                           VIR_THREADPOOL_JOB_WAIT_HISTOGRAM_PREFIX,
+                                           stats.waitBucketBound[i]) < 0)
+                return -1;
+        }
+    }
+
+    if (virTypedParamListAddULLong(paramlist, stats.runTime,
+                                   "%s", VIR_THREADPOOL_JOB_RUN_TIME) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, stats.runTimeMax,
+                                   "%s", VIR_THREADPOOL_JOB_RUN_TIME_MAX) < 0)
+        return -1;
+
+    if (virTypedParamListAddUInt(paramlist, stats.longRunningJobs,
+                                 "%s", VIR_THREADPOOL_JOBS_LONG_RUNNING) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, stats.oldestJobRunTime,
+                                   "%s", VIR_THREADPOOL_JOB_OLDEST_RUN_TIME) < 0)
+        return -1;
+
     *nparams = virTypedParamListStealParams(paramlist, params);
 
     return 0;
@@ -131,6 +203,7 @@ adminServerSetThreadPoolParameters(virNetServer *srv,
     long long int minWorkers = -1;
     long long int maxWorkers = -1;
     long long int prioWorkers = -1;
+    long long int maxMutatingWorkers = -1;
     virTypedParameterPtr param = NULL;
 
     virCheckFlags(0, -1);
@@ -142,6 +215,8 @@ adminServerSetThreadPoolParameters(virNetServer *srv,
                                VIR_TYPED_PARAM_UINT,
                                VIR_THREADPOOL_WORKERS_PRIORITY,
                                VIR_TYPED_PARAM_UINT,
+                               VIR_THREADPOOL_MUTATING_WORKERS_MAX,
+                               VIR_TYPED_PARAM_UINT,
                                NULL) < 0)
         return -1;
 
@@ -157,8 +232,13 @@ adminServerSetThreadPoolParameters(virNetServer *srv,
                                    VIR_THREADPOOL_WORKERS_PRIORITY)))
         prioWorkers = param->value.ui;
 
+    if ((param = virTypedParamsGet(params, nparams,
+                                   VIR_THREADPOOL_MUTATING_WORKERS_MAX)))
+        maxMutatingWorkers = param->value.ui;
+
     if (virNetServerSetThreadPoolParameters(srv, minWorkers,
-                                            maxWorkers, prioWorkers) < 0)
+                                            maxWorkers, prioWorkers,
+                                            maxMutatingWorkers) < 0)
         return -1;
 
     return 0;
@@ -195,6 +275,50 @@ adminServerLookupClient(virNetServer *srv,
     return virNetServerGetClient(srv, id);
 }
 
+static int
+adminClientGetStats(virNetServerClient *client,
+                    virTypedParamList *paramlist)
+{
+    virNetServerClientStats stats;
+    g_autofree virNetServerClientProcStats *procs = NULL;
+    size_t i;
+
+    virNetServerClientGetStats(client, &stats);
+    procs = stats.procs;
+
+    if (virTypedParamListAddULLong(paramlist, stats.rxBytes,
+                                   "%s", VIR_CLIENT_INFO_RX_BYTES) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.txBytes,
+                                   "%s", VIR_CLIENT_INFO_TX_BYTES) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.rxMessages,
+                                   "%s", VIR_CLIENT_INFO_RX_MESSAGES) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.txMessages,
+                                   "%s", VIR_CLIENT_INFO_TX_MESSAGES) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.calls,
+                                   "%s", VIR_CLIENT_INFO_CALLS) < 0)
+        return -1;
+
+    for (i = 0; i < stats.nprocs; i++) {
+        if (virTypedParamListAddULLong(paramlist, procs[i].calls,
+                                       VIR_CLIENT_INFO_CALLS_PREFIX "%x.%d",
+                                       procs[i].prog, procs[i].proc) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < VIR_NET_SERVER_CLIENT_LATENCY_BUCKETS; i++) {
+        if (stats.latency[i] == 0)
+            continue;
+
+        if (virTypedParamListAddULLong(paramlist, stats.latency[i],
+                                       VIR_CLIENT_INFO_LATENCY_PREFIX "%zu",
+                                       i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
 int
 adminClientGetInfo(virNetServerClient *client,
                    virTypedParameterPtr *params,
@@ -208,7 +332,7 @@ adminClientGetInfo(virNetServerClient *client,
     g_autoptr(virIdentity) identity = NULL;
     int rc;
 
-    virCheckFlags(0, -1);
+    virCheckFlags(VIR_ADM_CLIENT_INFO_STATS, -1);
 
     if (virNetServerClientGetInfo(client, &readonly,
                                   &sock_addr, &identity) < 0)
@@ -283,6 +407,10 @@ adminClientGetInfo(virNetServerClient *client,
                                    "%s", VIR_CLIENT_INFO_SELINUX_CONTEXT) < 0)
         return -1;
 
+    if (flags & VIR_ADM_CLIENT_INFO_STATS &&
+        adminClientGetStats(client, paramlist) < 0)
+        return -1;
+
     *nparams = virTypedParamListStealParams(paramlist, params);
     return 0;
 }
@@ -374,3 +502,42 @@ adminServerUpdateTlsFiles(virNetServer *srv,
 
     return virNetServerUpdateTlsFiles(srv);
 }
+
+int
+adminConnectGetObjectStats(virTypedParameterPtr *params,
+                           int *nparams,
+                           unsigned int flags)
+{
+    g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
+    g_autofree virClassStats *stats = NULL;
+    size_t nstats;
+    size_t i;
+
+    virCheckFlags(0, -1);
+
+    virClassGetStats(&stats, &nstats);
+
+    if (virTypedParamListAddUInt(paramlist, nstats,
+                                 "%s", VIR_OBJECT_STATS_CLASS_COUNT) < 0)
+        return -1;
+
+    for (i = 0; i < nstats; i++) {
+        if (virTypedParamListAddString(paramlist, stats[i].name,
+                                       VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                                       VIR_OBJECT_STATS_CLASS_SUFFIX_NAME, i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].objectSize,
+                                       VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                                       VIR_OBJECT_STATS_CLASS_SUFFIX_SIZE, i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].live,
+                                       VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                                       VIR_OBJECT_STATS_CLASS_SUFFIX_LIVE, i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].created,
+                                       VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                                       VIR_OBJECT_STATS_CLASS_SUFFIX_CREATED, i) < 0)
+            return -1;
+    }
+
+    *nparams = virTypedParamListStealParams(paramlist, params);
+
+    return 0;
+}
@@ -70,3 +70,7 @@ int adminServerSetClientLimits(virNetServer *srv,
 
 int adminServerUpdateTlsFiles(virNetServer *srv,
                               unsigned int flags);
+
+int adminConnectGetObjectStats(virTypedParameterPtr *params,
+                               int *nparams,
+                               unsigned int flags);
@@ -921,7 +921,7 @@ virAdmServerLookupClient(virAdmServerPtr srv,
  * @params: pointer to a list of typed parameters which will be allocated
  *          to store all returned parameters
  * @nparams: pointer which will hold the number of params returned in @params
- * @flags: extra flags; not used yet, so callers should always pass 0
+ * @flags: bitwise-OR of virAdmClientInfoFlags
  *
  * Extract identity information about a client. Attributes returned in @params
  * are mostly transport-dependent, i.e. some attributes including client
@@ -937,6 +937,10 @@ virAdmServerLookupClient(virAdmServerPtr srv,
  * even though a TCP client is able to restrict access to certain APIs for
  * itself.
  *
+ * If @flags contains VIR_ADM_CLIENT_INFO_STATS, statistics about the
+ * traffic and calls of the client are reported as well, see the
+ * VIR_CLIENT_INFO_RX_BYTES and following macros.
+ *
  * Returns 0 if the information has been successfully retrieved or -1 in case
  * of an error.
  */
@@ -1266,3 +1270,46 @@ virAdmConnectSetLoggingFilters(virAdmConnectPtr conn,
     virDispatchError(NULL);
     return -1;
 }
+
+/**
+ * virAdmConnectGetObjectStats:
+ * @conn: pointer to an active admin connection
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned statistics
+ * @nparams: pointer which will hold the number of statistics returned in
+ *           @params
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Retrieves the number of live and created instances of each class of
+ * reference counted objects in the daemon, which helps to find out which
+ * subsystem is responsible for growing memory usage. Only classes which
+ * were instantiated at least once are reported, ordered by the number of
+ * live instances. See VIR_OBJECT_STATS_CLASS_COUNT and
+ * VIR_OBJECT_STATS_CLASS_PREFIX for the names of the returned fields.
+ *
+ * Caller is responsible for freeing @params using virTypedParamsFree.
+ *
+ * Returns 0 on success, -1 in case of an error.
+ */
+int
+virAdmConnectGetObjectStats(virAdmConnectPtr conn,
+                            virTypedParameterPtr *params,
+                            int *nparams,
+                            unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, params=%p, nparams=%p, flags=0x%x",
+              conn, params, nparams, flags);
+
+    virResetLastError();
+    virCheckAdmConnectReturn(conn, -1);
+    virCheckNonNullArgGoto(params, error);
+    virCheckNonNullArgGoto(nparams, error);
+
+    if (remoteAdminConnectGetObjectStats(conn, params, nparams, flags) < 0)
+        goto error;
+
+    return 0;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
@@ -133,6 +133,41 @@ virCHDomainObjEndJob(virDomainObj *obj)
     virCondSignal(&priv->job.cond);
 }
 
+/*
+ * obj must be locked before calling
+ *
+ * To be called immediately before any CH monitor API call.
+ * Must have already called virCHDomainObjBeginJob() and checked
+ * that the VM is still active. The domain object is unlocked while
+ * the request is in flight so that lookups, listing and state queries
+ * of this domain don't wait for the VMM to answer; the job keeps
+ * other state changes, and the monitor itself, away meanwhile.
+ *
+ * To be followed with virCHDomainObjExitMonitor() once complete
+ */
+void
+virCHDomainObjEnterMonitor(virDomainObj *obj)
+{
+    virCHDomainObjPrivate *priv = obj->privateData;
+
+    virObjectRef(priv->monitor);
+    virObjectUnlock(obj);
+}
+
+/*
+ * obj must NOT be locked before calling
+ *
+ * Should be paired with an earlier virCHDomainObjEnterMonitor() call
+ */
+void
+virCHDomainObjExitMonitor(virDomainObj *obj)
+{
+    virCHDomainObjPrivate *priv = obj->privateData;
+
+    virObjectLock(obj);
+    virObjectUnref(priv->monitor);
+}
+
 static void *
 virCHDomainObjPrivateAlloc(void *opaque G_GNUC_UNUSED)
 {
@@ -66,3 +66,9 @@ virCHDomainObjBeginJob(virDomainObj *obj, enum virCHDomainJob job)
 
 void
 virCHDomainObjEndJob(virDomainObj *obj);
+
+void
+virCHDomainObjEnterMonitor(virDomainObj *obj);
+
+void
+virCHDomainObjExitMonitor(virDomainObj *obj);
@@ -262,7 +262,6 @@ chDomainCreateXML(virConnectPtr conn,
     }
     virDomainDefFree(vmdef);
     virDomainObjEndAPI(&vm);
-    chDriverUnlock(driver);
     return dom;
 }
 
@@ -438,7 +437,13 @@ chDomainShutdownFlags(virDomainPtr dom,
                        _("only can shutdown running/paused domain"));
         goto endjob;
     } else {
-        if (virCHMonitorShutdownVM(priv->monitor) < 0) {
+        int rc;
+
+        virCHDomainObjEnterMonitor(vm);
+        rc = virCHMonitorShutdownVM(priv->monitor);
+        virCHDomainObjExitMonitor(vm);
+
+        if (rc < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                         _("failed to shutdown guest VM"));
             goto endjob;
@@ -494,7 +499,13 @@ chDomainReboot(virDomainPtr dom, unsigned int flags)
                        _("only can reboot running/paused domain"));
         goto endjob;
     } else {
-        if (virCHMonitorRebootVM(priv->monitor) < 0) {
+        int rc;
+
+        virCHDomainObjEnterMonitor(vm);
+        rc = virCHMonitorRebootVM(priv->monitor);
+        virCHDomainObjExitMonitor(vm);
+
+        if (rc < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("failed to reboot domain"));
             goto endjob;
@@ -542,7 +553,13 @@ chDomainSuspend(virDomainPtr dom)
                        _("only can suspend running domain"));
         goto endjob;
     } else {
-        if (virCHMonitorSuspendVM(priv->monitor) < 0) {
+        int rc;
+
+        virCHDomainObjEnterMonitor(vm);
+        rc = virCHMonitorSuspendVM(priv->monitor);
+        virCHDomainObjExitMonitor(vm);
+
+        if (rc < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                         _("failed to suspend domain"));
             goto endjob;
@@ -587,7 +604,13 @@ chDomainResume(virDomainPtr dom)
                        _("only can resume paused domain"));
         goto endjob;
     } else {
-        if (virCHMonitorResumeVM(priv->monitor) < 0) {
+        int rc;
+
+        virCHDomainObjEnterMonitor(vm);
+        rc = virCHMonitorResumeVM(priv->monitor);
+        virCHDomainObjExitMonitor(vm);
+
+        if (rc < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                         _("failed to resume domain"));
             goto endjob;
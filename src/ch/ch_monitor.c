@@ -487,8 +487,9 @@ virCHMonitorNew(virDomainObj *vm, const char *socketdir)
     if (virCommandRunAsync(cmd, &mon->pid) < 0)
         return NULL;
 
-    /* get a curl handle */
+    /* get a curl handle, and a multi handle holding its connection */
     mon->handle = curl_easy_init();
+    mon->multi = curl_multi_init();
 
     /* now has its own reference */
     mon->vm = virObjectRef(vm);
@@ -518,6 +519,11 @@ void virCHMonitorClose(virCHMonitor *mon)
     if (mon->handle)
         curl_easy_cleanup(mon->handle);
 
+    if (mon->multi)
+        curl_multi_cleanup(mon->multi);
+
+    g_clear_pointer(&mon->info, virJSONValueFree);
+
     if (mon->socketpath) {
         if (virFileRemove(mon->socketpath, -1, -1) < 0) {
             VIR_WARN("Unable to remove CH socket file '%s'",
@@ -530,21 +536,58 @@ void virCHMonitorClose(virCHMonitor *mon)
 }
 
 static int
-virCHMonitorCurlPerform(CURL *handle)
+virCHMonitorCurlPerform(virCHMonitor *mon)
 {
-    CURLcode errorCode;
+    CURLMcode multiCode;
+    CURLcode errorCode = CURLE_OK;
+    CURLMsg *msg;
     long responseCode = 0;
+    int running = 1;
+    int nmsgs;
+
+    /* The easy handle is driven through the monitor's multi handle so
+     * that the connection to the VMM ends up in the multi handle's
+     * connection cache and is kept alive for the next request. */
+    multiCode = curl_multi_add_handle(mon->multi, mon->handle);
+    if (multiCode != CURLM_OK) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("curl_multi_add_handle() returned an error: %s (%d)"),
+                       curl_multi_strerror(multiCode), multiCode);
+        return -1;
+    }
+
+    while (running) {
+        if ((multiCode = curl_multi_perform(mon->multi, &running)) != CURLM_OK)
+            break;
 
-    errorCode = curl_easy_perform(handle);
+        if (running &&
+            (multiCode = curl_multi_wait(mon->multi, NULL, 0,
+                                         1000, NULL)) != CURLM_OK)
+            break;
+    }
+
+    while ((msg = curl_multi_info_read(mon->multi, &nmsgs))) {
+        if (msg->msg == CURLMSG_DONE && msg->easy_handle == mon->handle)
+            errorCode = msg->data.result;
+    }
+
+    curl_multi_remove_handle(mon->multi, mon->handle);
+
+    if (multiCode != CURLM_OK) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("curl_multi_perform() returned an error: %s (%d)"),
+                       curl_multi_strerror(multiCode), multiCode);
+        return -1;
+    }
 
     if (errorCode != CURLE_OK) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("curl_easy_perform() returned an error: %s (%d)"),
+                       _("curl_multi_perform() returned an error: %s (%d)"),
                        curl_easy_strerror(errorCode), errorCode);
         return -1;
     }
 
-    errorCode = curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE,
+    errorCode = curl_easy_getinfo(mon->handle, CURLINFO_RESPONSE_CODE,
                                   &responseCode);
 
     if (errorCode != CURLE_OK) {
@@ -565,35 +608,6 @@ virCHMonitorCurlPerform(CURL *handle)
     return responseCode;
 }
 
-int
-virCHMonitorPutNoContent(virCHMonitor *mon, const char *endpoint)
-{
-    g_autofree char *url = NULL;
-    int responseCode = 0;
-    int ret = -1;
-
-    url = g_strdup_printf("%s/%s", URL_ROOT, endpoint);
-
-    virObjectLock(mon);
-
-    /* reset all options of a libcurl session handle at first */
-    curl_easy_reset(mon->handle);
-
-    curl_easy_setopt(mon->handle, CURLOPT_UNIX_SOCKET_PATH, mon->socketpath);
-    curl_easy_setopt(mon->handle, CURLOPT_URL, url);
-    curl_easy_setopt(mon->handle, CURLOPT_PUT, true);
-    curl_easy_setopt(mon->handle, CURLOPT_HTTPHEADER, NULL);
-
-    responseCode = virCHMonitorCurlPerform(mon->handle);
-
-    virObjectUnlock(mon);
-
-    if (responseCode == 200 || responseCode == 204)
-        ret = 0;
-
-    return ret;
-}
-
 struct curl_data {
     char *content;
     size_t size;
@@ -616,34 +630,69 @@ curl_callback(void *contents, size_t size, size_t nmemb, void *userp)
     return content_size;
 }
 
+/**
+ * virCHMonitorRequest:
+ * @mon: Pointer to the monitor
+ * @method: "GET" or "PUT"
+ * @endpoint: API endpoint relative to URL_ROOT
+ * @payload: JSON body of a PUT request, may be NULL
+ * @response: filled with the parsed JSON reply, may be NULL
+ *
+ * Sends one request to the Cloud-Hypervisor API. Any PUT request
+ * may change the VM, so it drops the cached vm.info reply.
+ *
+ * Returns 0 on success, -1 on error.
+ */
 static int
-virCHMonitorGet(virCHMonitor *mon, const char *endpoint, virJSONValue **response)
+virCHMonitorRequest(virCHMonitor *mon,
+                    const char *method,
+                    const char *endpoint,
+                    const char *payload,
+                    virJSONValue **response)
 {
     g_autofree char *url = NULL;
     int responseCode = 0;
     int ret = -1;
     struct curl_slist *headers = NULL;
     struct curl_data data = {0};
+    bool put = STREQ(method, "PUT");
 
     url = g_strdup_printf("%s/%s", URL_ROOT, endpoint);
 
+    if (payload || response) {
+        headers = curl_slist_append(headers, "Accept: application/json");
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+    }
+
     virObjectLock(mon);
 
+    if (put)
+        g_clear_pointer(&mon->info, virJSONValueFree);
+
     /* reset all options of a libcurl session handle at first */
     curl_easy_reset(mon->handle);
 
     curl_easy_setopt(mon->handle, CURLOPT_UNIX_SOCKET_PATH, mon->socketpath);
     curl_easy_setopt(mon->handle, CURLOPT_URL, url);
+    curl_easy_setopt(mon->handle, CURLOPT_CUSTOMREQUEST, method);
+    curl_easy_setopt(mon->handle, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(mon->handle, CURLOPT_TIMEOUT_MS,
+                     (long)CH_MONITOR_REQUEST_TIMEOUT);
+
+    if (put) {
+        curl_easy_setopt(mon->handle, CURLOPT_POSTFIELDS,
+                         payload ? payload : "");
+    }
 
     if (response) {
-        headers = curl_slist_append(headers, "Accept: application/json");
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        curl_easy_setopt(mon->handle, CURLOPT_HTTPHEADER, headers);
         curl_easy_setopt(mon->handle, CURLOPT_WRITEFUNCTION, curl_callback);
         curl_easy_setopt(mon->handle, CURLOPT_WRITEDATA, (void *)&data);
     }
 
-    responseCode = virCHMonitorCurlPerform(mon->handle);
+    responseCode = virCHMonitorCurlPerform(mon);
+
+    /* reset the libcurl handle to avoid leaking a stack pointer to data */
+    curl_easy_reset(mon->handle);
 
     virObjectUnlock(mon);
 
@@ -660,12 +709,17 @@ virCHMonitorGet(virCHMonitor *mon, const char *endpoint, virJSONValue **response
 
  cleanup:
     g_free(data.content);
-    /* reset the libcurl handle to avoid leaking a stack pointer to data */
-    curl_easy_reset(mon->handle);
+    curl_slist_free_all(headers);
 
     return ret;
 }
 
+int
+virCHMonitorPutNoContent(virCHMonitor *mon, const char *endpoint)
+{
+    return virCHMonitorRequest(mon, "PUT", endpoint, NULL, NULL);
+}
+
 int
 virCHMonitorShutdownVMM(virCHMonitor *mon)
 {
@@ -675,39 +729,12 @@ virCHMonitorShutdownVMM(virCHMonitor *mon)
 int
 virCHMonitorCreateVM(virCHMonitor *mon)
 {
-    g_autofree char *url = NULL;
-    int responseCode = 0;
-    int ret = -1;
     g_autofree char *payload = NULL;
-    struct curl_slist *headers = NULL;
-
-    url = g_strdup_printf("%s/%s", URL_ROOT, URL_VM_CREATE);
-    headers = curl_slist_append(headers, "Accept: application/json");
-    headers = curl_slist_append(headers, "Content-Type: application/json");
 
     if (virCHMonitorBuildVMJson(mon->vm->def, &payload) != 0)
         return -1;
 
-    virObjectLock(mon);
-
-    /* reset all options of a libcurl session handle at first */
-    curl_easy_reset(mon->handle);
-
-    curl_easy_setopt(mon->handle, CURLOPT_UNIX_SOCKET_PATH, mon->socketpath);
-    curl_easy_setopt(mon->handle, CURLOPT_URL, url);
-    curl_easy_setopt(mon->handle, CURLOPT_CUSTOMREQUEST, "PUT");
-    curl_easy_setopt(mon->handle, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(mon->handle, CURLOPT_POSTFIELDS, payload);
-
-    responseCode = virCHMonitorCurlPerform(mon->handle);
-
-    virObjectUnlock(mon);
-
-    if (responseCode == 200 || responseCode == 204)
-        ret = 0;
-
-    curl_slist_free_all(headers);
-    return ret;
+    return virCHMonitorRequest(mon, "PUT", URL_VM_CREATE, payload, NULL);
 }
 
 int
@@ -745,12 +772,38 @@ virCHMonitorResumeVM(virCHMonitor *mon)
  * @mon: Pointer to the monitor
  * @info: Get VM info
  *
- * Retrieve the VM info and store in @info
+ * Retrieve the VM info and store in @info. A reply younger than
+ * CH_MONITOR_INFO_CACHE_TIME is reused instead of asking the VMM
+ * again, so that listing and stats calls don't each cost a round trip.
  *
  * Returns 0 on success.
  */
 int
 virCHMonitorGetInfo(virCHMonitor *mon, virJSONValue **info)
 {
-    return virCHMonitorGet(mon, URL_VM_INFO, info);
+    g_autoptr(virJSONValue) reply = NULL;
+    unsigned long long now;
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    virObjectLock(mon);
+    if (mon->info && now - mon->infoTime < CH_MONITOR_INFO_CACHE_TIME) {
+        *info = virJSONValueCopy(mon->info);
+        virObjectUnlock(mon);
+        return 0;
+    }
+    virObjectUnlock(mon);
+
+    if (virCHMonitorRequest(mon, "GET", URL_VM_INFO, NULL, &reply) < 0)
+        return -1;
+
+    virObjectLock(mon);
+    virJSONValueFree(mon->info);
+    mon->info = virJSONValueCopy(reply);
+    mon->infoTime = now;
+    virObjectUnlock(mon);
+
+    *info = g_steal_pointer(&reply);
+    return 0;
 }
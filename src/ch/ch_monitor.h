@@ -37,18 +37,27 @@
 #define URL_VM_RESUME "vm.resume"
 #define URL_VM_INFO "vm.info"
 
+/* Give up on a request the VMM didn't answer within 30 seconds */
+#define CH_MONITOR_REQUEST_TIMEOUT (1000 * 30)
+/* Reuse a vm.info reply for up to 1 second */
+#define CH_MONITOR_INFO_CACHE_TIME 1000
+
 typedef struct _virCHMonitor virCHMonitor;
 
 struct _virCHMonitor {
     virObjectLockable parent;
 
     CURL *handle;
+    CURLM *multi;
 
     char *socketpath;
 
     pid_t pid;
 
     virDomainObj *vm;
+
+    virJSONValue *info;
+    unsigned long long infoTime;
 };
 
 virCHMonitor *virCHMonitorNew(virDomainObj *vm, const char *socketdir);
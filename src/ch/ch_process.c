@@ -123,7 +123,13 @@ virCHProcessUpdateInfo(virDomainObj *vm)
 {
     virJSONValue *info;
     virCHDomainObjPrivate *priv = vm->privateData;
-    if (virCHMonitorGetInfo(priv->monitor, &info) < 0)
+    int rc;
+
+    virCHDomainObjEnterMonitor(vm);
+    rc = virCHMonitorGetInfo(priv->monitor, &info);
+    virCHDomainObjExitMonitor(vm);
+
+    if (rc < 0)
         return -1;
 
     virCHProcessUpdateConsole(vm, info);
@@ -148,6 +154,7 @@ int virCHProcessStart(virCHDriver *driver,
                       virDomainRunningReason reason)
 {
     int ret = -1;
+    int rc;
     virCHDomainObjPrivate *priv = vm->privateData;
 
     if (!priv->monitor) {
@@ -158,14 +165,22 @@ int virCHProcessStart(virCHDriver *driver,
             goto cleanup;
         }
 
-        if (virCHMonitorCreateVM(priv->monitor) < 0) {
+        virCHDomainObjEnterMonitor(vm);
+        rc = virCHMonitorCreateVM(priv->monitor);
+        virCHDomainObjExitMonitor(vm);
+
+        if (rc < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                         _("failed to create guest VM"));
             goto cleanup;
         }
     }
 
-    if (virCHMonitorBootVM(priv->monitor) < 0) {
+    virCHDomainObjEnterMonitor(vm);
+    rc = virCHMonitorBootVM(priv->monitor);
+    virCHDomainObjExitMonitor(vm);
+
+    if (rc < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("failed to boot guest VM"));
         goto cleanup;
@@ -159,8 +159,11 @@ virDomainBackupDiskDefParseXML(xmlNodePtr node,
     if (!(def->store = virDomainStorageSourceParseBase(type, format, idx)))
           return -1;
 
+    /* push mode backups can be streamed to a NBD server directly, e.g. to
+     * one uploading the image to remote storage */
     if (def->store->type != VIR_STORAGE_TYPE_FILE &&
-        def->store->type != VIR_STORAGE_TYPE_BLOCK) {
+        def->store->type != VIR_STORAGE_TYPE_BLOCK &&
+        !(push && def->store->type == VIR_STORAGE_TYPE_NETWORK)) {
         virReportError(VIR_ERR_XML_ERROR,
                        _("unsupported disk backup type '%s'"), type);
         return -1;
@@ -176,6 +179,23 @@ virDomainBackupDiskDefParseXML(xmlNodePtr node,
                                     storageSourceParseFlags, xmlopt) < 0)
         return -1;
 
+    if (def->store->type == VIR_STORAGE_TYPE_NETWORK) {
+        if (!srcNode) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("missing target for backup of disk '%s'"),
+                           def->name);
+            return -1;
+        }
+
+        if (def->store->protocol != VIR_STORAGE_NET_PROTOCOL_NBD) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("unsupported protocol '%s' of backup target of disk '%s'"),
+                           virStorageNetProtocolTypeToString(def->store->protocol),
+                           def->name);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
@@ -573,31 +573,28 @@ virDomainPCIAddressBusSetModel(virDomainPCIAddressBus *bus,
 }
 
 
+/* Returns the mask of the slots of @bus devices can be plugged into */
+static uint32_t
+virDomainPCIAddressBusSlotMask(virDomainPCIAddressBus *bus)
+{
+    return (uint32_t)(((1ULL << (bus->maxSlot + 1)) - 1) &
+                      ~((1ULL << bus->minSlot) - 1));
+}
+
+
 bool
 virDomainPCIAddressBusIsFullyReserved(virDomainPCIAddressBus *bus)
 {
-    size_t i;
+    uint32_t mask = virDomainPCIAddressBusSlotMask(bus);
 
-    for (i = bus->minSlot; i <= bus->maxSlot; i++) {
-        if (!bus->slot[i].functions)
-            return false;
-    }
-
-    return true;
+    return (bus->usedSlots & mask) == mask;
 }
 
 
 static bool ATTRIBUTE_NONNULL(1)
 virDomainPCIAddressBusIsEmpty(virDomainPCIAddressBus *bus)
 {
-    size_t i;
-
-    for (i = bus->minSlot; i <= bus->maxSlot; i++) {
-        if (bus->slot[i].functions)
-            return false;
-    }
-
-    return true;
+    return (bus->usedSlots & virDomainPCIAddressBusSlotMask(bus)) == 0;
 }
 
 
@@ -830,6 +827,7 @@ virDomainPCIAddressReserveAddrInternal(virDomainPCIAddressSet *addrs,
     if (!bus->slot[addr->slot].functions &&
         flags & VIR_PCI_CONNECT_AGGREGATE_SLOT) {
         bus->slot[addr->slot].aggregate = true;
+        bus->aggregateSlots |= 1U << addr->slot;
     }
 
     if (virDomainPCIAddressBusIsEmpty(bus) && !bus->isolationGroupLocked) {
@@ -854,6 +852,7 @@ virDomainPCIAddressReserveAddrInternal(virDomainPCIAddressSet *addrs,
 
     /* mark the requested function as reserved */
     bus->slot[addr->slot].functions |= (1 << addr->function);
+    bus->usedSlots |= 1U << addr->slot;
     VIR_DEBUG("Reserving PCI address %s (aggregate='%s')", addrStr,
               bus->slot[addr->slot].aggregate ? "true" : "false");
 
@@ -938,7 +937,11 @@ void
 virDomainPCIAddressReleaseAddr(virDomainPCIAddressSet *addrs,
                                virPCIDeviceAddress *addr)
 {
-    addrs->buses[addr->bus].slot[addr->slot].functions &= ~(1 << addr->function);
+    virDomainPCIAddressBus *bus = &addrs->buses[addr->bus];
+
+    bus->slot[addr->slot].functions &= ~(1 << addr->function);
+    if (!bus->slot[addr->slot].functions)
+        bus->usedSlots &= ~(1U << addr->slot);
 }
 
 
@@ -1006,65 +1009,68 @@ virDomainPCIAddressSetFree(virDomainPCIAddressSet *addrs)
 }
 
 
-static int
+static void
 virDomainPCIAddressFindUnusedFunctionOnBus(virDomainPCIAddressBus *bus,
                                            virPCIDeviceAddress *searchAddr,
                                            int function,
                                            virDomainPCIConnectFlags flags,
                                            bool *found)
 {
-    g_autofree char *addrStr = NULL;
+    uint32_t freeSlots;
+    uint32_t candidates;
+    gint slot;
 
     *found = false;
 
-    if (!(addrStr = virPCIDeviceAddressAsString(searchAddr)))
-        return -1;
-
-    if (!virDomainPCIAddressFlagsCompatible(searchAddr, addrStr, bus->flags,
+    if (!virDomainPCIAddressFlagsCompatible(searchAddr, NULL, bus->flags,
                                             flags, false, false)) {
         VIR_DEBUG("PCI bus %04x:%02x is not compatible with the device",
                   searchAddr->domain, searchAddr->bus);
-    } else {
-        while (searchAddr->slot <= bus->maxSlot) {
-            if (bus->slot[searchAddr->slot].functions == 0) {
-                *found = true;
-                break;
-            }
+        return;
+    }
 
-            if (flags & VIR_PCI_CONNECT_AGGREGATE_SLOT &&
-                bus->slot[searchAddr->slot].aggregate) {
-                /* slot and device are okay with aggregating devices */
-                if ((bus->slot[searchAddr->slot].functions &
-                     (1 << searchAddr->function)) == 0) {
-                    *found = true;
-                    break;
-                }
+    /* Only the slots which are completely free or, if the device can
+     * share a slot, which hold aggregated devices need a closer look */
+    freeSlots = ~bus->usedSlots & virDomainPCIAddressBusSlotMask(bus);
+    candidates = freeSlots;
+    if (flags & VIR_PCI_CONNECT_AGGREGATE_SLOT)
+        candidates |= bus->usedSlots & bus->aggregateSlots;
+    if (searchAddr->slot > 0)
+        candidates &= ~((1U << searchAddr->slot) - 1);
 
-                /* also check for *any* unused function if caller
-                 * sent function = -1
-                 */
-                if (function == -1) {
-                    while (searchAddr->function < 8) {
-                        if ((bus->slot[searchAddr->slot].functions &
-                             (1 << searchAddr->function)) == 0) {
-                            *found = true;
-                            break; /* out of inner while */
-                        }
-                        searchAddr->function++;
-                    }
-                    if (*found)
-                       break; /* out of outer while */
-                    searchAddr->function = 0; /* reset for next try */
-                }
-            }
+    for (slot = g_bit_nth_lsf(candidates, -1);
+         slot >= 0;
+         slot = g_bit_nth_lsf(candidates, slot)) {
+        uint8_t functions = bus->slot[slot].functions;
 
-            VIR_DEBUG("PCI slot %04x:%02x:%02x already in use",
-                      searchAddr->domain, searchAddr->bus, searchAddr->slot);
-            searchAddr->slot++;
+        searchAddr->slot = slot;
+
+        if (freeSlots & (1U << slot)) {
+            *found = true;
+            return;
         }
+
+        /* slot and device are okay with aggregating devices */
+        if ((functions & (1 << searchAddr->function)) == 0) {
+            *found = true;
+            return;
+        }
+
+        /* also check for *any* unused function if caller
+         * sent function = -1
+         */
+        if (function == -1 && functions != 0xff) {
+            while (functions & (1 << searchAddr->function))
+                searchAddr->function++;
+            *found = true;
+            return;
+        }
+
+        VIR_DEBUG("PCI slot %04x:%02x:%02x already in use",
+                  searchAddr->domain, searchAddr->bus, searchAddr->slot);
     }
 
-    return 0;
+    searchAddr->slot = bus->maxSlot + 1;
 }
 
 
@@ -1101,10 +1107,8 @@ virDomainPCIAddressGetNextAddr(virDomainPCIAddressSet *addrs,
 
         a.slot = bus->minSlot;
 
-        if (virDomainPCIAddressFindUnusedFunctionOnBus(bus, &a, function,
-                                                       flags, &found) < 0) {
-            return -1;
-        }
+        virDomainPCIAddressFindUnusedFunctionOnBus(bus, &a, function,
+                                                   flags, &found);
 
         if (found)
             goto success;
@@ -1125,10 +1129,8 @@ virDomainPCIAddressGetNextAddr(virDomainPCIAddressSet *addrs,
 
         a.slot = bus->minSlot;
 
-        if (virDomainPCIAddressFindUnusedFunctionOnBus(bus, &a, function,
-                                                       flags, &found) < 0) {
-            return -1;
-        }
+        virDomainPCIAddressFindUnusedFunctionOnBus(bus, &a, function,
+                                                   flags, &found);
 
         /* The isolation group for the bus will actually be changed
          * later, in virDomainPCIAddressReserveAddrInternal() */
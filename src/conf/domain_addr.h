@@ -105,6 +105,11 @@ typedef struct {
      * bit is set, that function is in use by a device.
      */
     virDomainPCIAddressSlot slot[VIR_PCI_ADDRESS_SLOT_LAST + 1];
+    /* Bit N is set if any function of slot N is in use, and in
+     * @aggregateSlots if slot N has its aggregate flag set, so that free
+     * slots can be found without looking at every one of them */
+    uint32_t usedSlots;
+    uint32_t aggregateSlots;
 
     /* See virDomainDeviceInfo::isolationGroup */
     unsigned int isolationGroup;
@@ -2254,7 +2254,7 @@ virDomainDiskDefFree(virDomainDiskDef *def)
     g_free(def->dst);
     virObjectUnref(def->mirror);
     g_free(def->wwn);
-    g_free(def->driverName);
+    virStringInternRelease(def->driverName);
     g_free(def->vendor);
     g_free(def->product);
     g_free(def->domain_name);
@@ -2320,8 +2320,8 @@ virDomainDiskGetDriver(const virDomainDiskDef *def)
 void
 virDomainDiskSetDriver(virDomainDiskDef *def, const char *name)
 {
-    char *tmp = g_strdup(name);
-    g_free(def->driverName);
+    char *tmp = virStringIntern(name);
+    virStringInternRelease(def->driverName);
     def->driverName = tmp;
 }
 
@@ -3893,6 +3893,8 @@ void virDomainObjAssignDef(virDomainObj *domain,
             domain->def = def;
         }
     }
+
+    domain->generation++;
 }
 
 
@@ -4011,6 +4013,7 @@ virDomainObjRemoveTransientDef(virDomainObj *domain)
     virDomainDefFree(domain->def);
     domain->def = g_steal_pointer(&domain->newDef);
     domain->def->id = -1;
+    domain->generation++;
 }
 
 
@@ -6682,43 +6685,46 @@ virDomainDeviceAliasIsUserAlias(const char *aliasStr)
 static int
 virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
                             xmlNodePtr node,
-                            xmlXPathContextPtr ctxt,
                             virDomainDeviceInfo *info,
                             unsigned int flags)
 {
     xmlNodePtr acpi = NULL;
     xmlNodePtr address = NULL;
+    xmlNodePtr alias = NULL;
     xmlNodePtr master = NULL;
     xmlNodePtr boot = NULL;
     xmlNodePtr rom = NULL;
     int ret = -1;
     g_autofree char *aliasStr = NULL;
-    VIR_XPATH_NODE_AUTORESTORE(ctxt)
 
     virDomainDeviceInfoClear(info);
-    ctxt->node = node;
 
-    if ((aliasStr = virXPathString("string(./alias/@name)", ctxt)))
+    /* This is called for every device, look up the subelements directly
+     * rather than through XPath */
+    if ((alias = virXMLNodeGetSubelement(node, "alias")))
+        aliasStr = virXMLPropString(alias, "name");
+
+    if (aliasStr)
         if (!(flags & VIR_DOMAIN_DEF_PARSE_INACTIVE) ||
             (xmlopt->config.features & VIR_DOMAIN_DEF_FEATURE_USER_ALIAS &&
              virDomainDeviceAliasIsUserAlias(aliasStr) &&
              strspn(aliasStr, USER_ALIAS_CHARS) == strlen(aliasStr)))
             info->alias = g_steal_pointer(&aliasStr);
 
-    if ((master = virXPathNode("./master", ctxt))) {
+    if ((master = virXMLNodeGetSubelement(node, "master"))) {
         info->mastertype = VIR_DOMAIN_CONTROLLER_MASTER_USB;
         if (virDomainDeviceUSBMasterParseXML(master, &info->master.usb) < 0)
             goto cleanup;
     }
 
     if (flags & VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT &&
-        (boot = virXPathNode("./boot", ctxt))) {
+        (boot = virXMLNodeGetSubelement(node, "boot"))) {
         if (virDomainDeviceBootParseXML(boot, info))
             goto cleanup;
     }
 
     if ((flags & VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) &&
-        (rom = virXPathNode("./rom", ctxt))) {
+        (rom = virXMLNodeGetSubelement(node, "rom"))) {
         if (virXMLPropTristateBool(rom, "enabled", VIR_XML_PROP_NONE,
                                    &info->romenabled) < 0)
             goto cleanup;
@@ -6737,13 +6743,13 @@ virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if ((acpi = virXPathNode("./acpi", ctxt))) {
+    if ((acpi = virXMLNodeGetSubelement(node, "acpi"))) {
         if (virXMLPropUInt(acpi, "index", 10, VIR_XML_PROP_NONE,
                            &info->acpiIndex) < 0)
             goto cleanup;
     }
 
-    if ((address = virXPathNode("./address", ctxt)) &&
+    if ((address = virXMLNodeGetSubelement(node, "address")) &&
         virDomainDeviceAddressParseXML(address, info) < 0)
         goto cleanup;
 
@@ -8916,11 +8922,14 @@ virDomainDiskDefDriverParseXML(virDomainDiskDef *def,
                                xmlNodePtr cur,
                                xmlXPathContextPtr ctxt)
 {
+    g_autofree char *driverName = NULL;
     VIR_XPATH_NODE_AUTORESTORE(ctxt)
 
     ctxt->node = cur;
 
-    def->driverName = virXMLPropString(cur, "name");
+    /* nearly every disk uses the same driver name, share it */
+    driverName = virXMLPropString(cur, "name");
+    def->driverName = virStringIntern(driverName);
 
     if (virXMLPropEnum(cur, "cache", virDomainDiskCacheTypeFromString,
                        VIR_XML_PROP_NONE, &def->cachemode) < 0)
@@ -9161,7 +9170,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
                        VIR_XML_PROP_NONZERO, &def->sgio) < 0)
         return NULL;
 
-    if ((sourceNode = virXPathNode("./source", ctxt))) {
+    if ((sourceNode = virXMLNodeGetSubelement(node, "source"))) {
         if (virXMLPropEnum(sourceNode, "startupPolicy",
                            virDomainStartupPolicyTypeFromString,
                            VIR_XML_PROP_NONZERO,
@@ -9169,7 +9178,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((targetNode = virXPathNode("./target", ctxt))) {
+    if ((targetNode = virXMLNodeGetSubelement(node, "target"))) {
         def->dst = virXMLPropString(targetNode, "dev");
 
         if (virXMLPropEnum(targetNode, "bus",
@@ -9191,12 +9200,12 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((geometryNode = virXPathNode("./geometry", ctxt))) {
+    if ((geometryNode = virXMLNodeGetSubelement(node, "geometry"))) {
         if (virDomainDiskDefGeometryParse(def, geometryNode) < 0)
             return NULL;
     }
 
-    if ((blockioNode = virXPathNode("./blockio", ctxt))) {
+    if ((blockioNode = virXMLNodeGetSubelement(node, "blockio"))) {
         if (virXMLPropUInt(blockioNode, "logical_block_size", 10, VIR_XML_PROP_NONE,
                            &def->blockio.logical_block_size) < 0)
             return NULL;
@@ -9206,7 +9215,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((driverNode = virXPathNode("./driver", ctxt))) {
+    if ((driverNode = virXMLNodeGetSubelement(node, "driver"))) {
         if (virDomainVirtioOptionsParseXML(driverNode, &def->virtio) < 0)
             return NULL;
 
@@ -9217,23 +9226,23 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((mirrorNode = virXPathNode("./mirror", ctxt))) {
+    if ((mirrorNode = virXMLNodeGetSubelement(node, "mirror"))) {
         if (!(flags & VIR_DOMAIN_DEF_PARSE_INACTIVE)) {
             if (virDomainDiskDefMirrorParse(def, mirrorNode, ctxt, flags, xmlopt) < 0)
                 return NULL;
         }
     }
 
-    if (virXPathNode("./auth", ctxt))
+    if (virXMLNodeGetSubelement(node, "auth"))
         def->diskElementAuth = true;
 
-    if (virXPathNode("./encryption", ctxt))
+    if (virXMLNodeGetSubelement(node, "encryption"))
         def->diskElementEnc = true;
 
     if (flags & VIR_DOMAIN_DEF_PARSE_STATUS) {
         xmlNodePtr diskSecretsPlacementNode;
 
-        if ((diskSecretsPlacementNode = virXPathNode("./diskSecretsPlacement", ctxt))) {
+        if ((diskSecretsPlacementNode = virXMLNodeGetSubelement(node, "diskSecretsPlacement"))) {
             g_autofree char *secretAuth = virXMLPropString(diskSecretsPlacementNode, "auth");
             g_autofree char *secretEnc = virXMLPropString(diskSecretsPlacementNode, "enc");
 
@@ -9242,7 +9251,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if ((transientNode = virXPathNode("./transient", ctxt))) {
+    if ((transientNode = virXMLNodeGetSubelement(node, "transient"))) {
         def->transient = true;
 
         if (virXMLPropTristateBool(transientNode, "shareBacking",
@@ -9260,7 +9269,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
     def->vendor = virXPathString("string(./vendor)", ctxt);
     def->product = virXPathString("string(./product)", ctxt);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0) {
         return NULL;
     }
@@ -9613,7 +9622,7 @@ virDomainControllerDefParseXML(virDomainXMLOption *xmlopt,
     if (def->type == VIR_DOMAIN_CONTROLLER_TYPE_USB &&
         def->model == VIR_DOMAIN_CONTROLLER_MODEL_USB_NONE) {
         VIR_DEBUG("Ignoring device address for none model usb controller");
-    } else if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    } else if (virDomainDeviceInfoParseXML(xmlopt, node,
                                            &def->info, flags) < 0) {
         return NULL;
     }
@@ -9987,7 +9996,7 @@ virDomainFSDefParseXML(virDomainXMLOption *xmlopt,
     def->sock = g_steal_pointer(&sock);
     def->dst = g_steal_pointer(&target);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0)
         goto error;
 
@@ -10314,7 +10323,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
                                &def->trustGuestRxFilters) < 0)
         goto error;
 
-    if ((source_node = virXPathNode("./source", ctxt))) {
+    if ((source_node = virXMLNodeGetSubelement(node, "source"))) {
         xmlNodePtr tmpnode = ctxt->node;
 
         ctxt->node = source_node;
@@ -10378,18 +10387,15 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
             address = virXMLPropString(source_node, "address");
             port = virXMLPropString(source_node, "port");
             if (def->type == VIR_DOMAIN_NET_TYPE_UDP) {
-                xmlNodePtr tmp_node = ctxt->node;
-                ctxt->node = source_node;
-                if ((tmpNode = virXPathNode("./local", ctxt))) {
+                if ((tmpNode = virXMLNodeGetSubelement(source_node, "local"))) {
                     localaddr = virXMLPropString(tmpNode, "address");
                     localport = virXMLPropString(tmpNode, "port");
                 }
-                ctxt->node = tmp_node;
             }
         }
     }
 
-    if ((virtualport_node = virXPathNode("./virtualport", ctxt))) {
+    if ((virtualport_node = virXMLNodeGetSubelement(node, "virtualport"))) {
         if (def->type == VIR_DOMAIN_NET_TYPE_NETWORK) {
             if (!(def->virtPortProfile
                   = virNetDevVPortProfileParse(virtualport_node,
@@ -10426,7 +10432,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
     domain_name = virXPathString("string(./backenddomain/@name)", ctxt);
     model = virXPathString("string(./model/@type)", ctxt);
 
-    if ((driver_node = virXPathNode("./driver", ctxt)) &&
+    if ((driver_node = virXMLNodeGetSubelement(node, "driver")) &&
         (virDomainVirtioOptionsParseXML(driver_node, &def->virtio) < 0))
         goto error;
 
@@ -10438,7 +10444,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
     rx_queue_size = virXMLPropString(driver_node, "rx_queue_size");
     tx_queue_size = virXMLPropString(driver_node, "tx_queue_size");
 
-    if ((filterref_node = virXPathNode("./filterref", ctxt))) {
+    if ((filterref_node = virXMLNodeGetSubelement(node, "filterref"))) {
         filter = virXMLPropString(filterref_node, "filter");
         virHashFree(filterparams);
         filterparams = virNWFilterParseParamAttributes(filterref_node);
@@ -10446,17 +10452,17 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
 
     if ((flags & VIR_DOMAIN_DEF_PARSE_ACTUAL_NET) &&
         def->type == VIR_DOMAIN_NET_TYPE_NETWORK &&
-        (actual_node = virXPathNode("./actual", ctxt)) &&
+        (actual_node = virXMLNodeGetSubelement(node, "actual")) &&
         (virDomainActualNetDefParseXML(actual_node, ctxt, def,
                                       &actual, flags, xmlopt) < 0))
         goto error;
 
-    if ((bandwidth_node = virXPathNode("./bandwidth", ctxt)) &&
+    if ((bandwidth_node = virXMLNodeGetSubelement(node, "bandwidth")) &&
         (virNetDevBandwidthParse(&def->bandwidth, NULL, bandwidth_node,
                                  def->type == VIR_DOMAIN_NET_TYPE_NETWORK) < 0))
         goto error;
 
-    if ((vlan_node = virXPathNode("./vlan", ctxt)) &&
+    if ((vlan_node = virXMLNodeGetSubelement(node, "vlan")) &&
         (virNetDevVlanParse(vlan_node, ctxt, &def->vlan) < 0))
         goto error;
 
@@ -10509,7 +10515,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
         def->mac_check = tmpCheck;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT
                                     | VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) < 0) {
         goto error;
@@ -10849,7 +10855,8 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
             def->driver.virtio.tx_queue_size = q;
         }
 
-        if ((tmpNode = virXPathNode("./driver/host", ctxt))) {
+        if (driver_node &&
+            (tmpNode = virXMLNodeGetSubelement(driver_node, "host"))) {
             if (virXMLPropTristateSwitch(tmpNode, "csum", VIR_XML_PROP_NONE,
                                          &def->driver.virtio.host.csum) < 0)
                 goto error;
@@ -10880,7 +10887,8 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
                 goto error;
         }
 
-        if ((tmpNode = virXPathNode("./driver/guest", ctxt))) {
+        if (driver_node &&
+            (tmpNode = virXMLNodeGetSubelement(driver_node, "guest"))) {
             if (virXMLPropTristateSwitch(tmpNode, "csum", VIR_XML_PROP_NONE,
                                          &def->driver.virtio.guest.csum) < 0)
                 goto error;
@@ -10958,8 +10966,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    node = virXPathNode("./coalesce", ctxt);
-    if (node) {
+    if ((node = virXMLNodeGetSubelement(node, "coalesce"))) {
         if (virDomainNetDefCoalesceParseXML(node, ctxt, &def->coalesce) < 0)
             goto error;
     }
@@ -11609,7 +11616,7 @@ virDomainChrDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (def->deviceType == VIR_DOMAIN_CHR_DEVICE_TYPE_SERIAL &&
@@ -11716,7 +11723,7 @@ virDomainSmartcardDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     return g_steal_pointer(&def);
@@ -11875,7 +11882,7 @@ virDomainTPMDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -11888,7 +11895,6 @@ virDomainTPMDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainPanicDef *
 virDomainPanicDefParseXML(virDomainXMLOption *xmlopt,
                           xmlNodePtr node,
-                          xmlXPathContextPtr ctxt,
                           unsigned int flags)
 {
     virDomainPanicDef *panic;
@@ -11896,7 +11902,7 @@ virDomainPanicDefParseXML(virDomainXMLOption *xmlopt,
 
     panic = g_new0(virDomainPanicDef, 1);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    if (virDomainDeviceInfoParseXML(xmlopt, node,
                                     &panic->info, flags) < 0)
         goto error;
 
@@ -12045,7 +12051,7 @@ virDomainInputDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (def->bus == VIR_DOMAIN_INPUT_BUS_USB &&
@@ -12109,7 +12115,6 @@ virDomainInputDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainHubDef *
 virDomainHubDefParseXML(virDomainXMLOption *xmlopt,
                         xmlNodePtr node,
-                        xmlXPathContextPtr ctxt,
                         unsigned int flags)
 {
     virDomainHubDef *def;
@@ -12131,7 +12136,7 @@ virDomainHubDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -13056,7 +13061,7 @@ virDomainSoundDefParseXML(virDomainXMLOption *xmlopt,
             goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -13393,7 +13398,6 @@ virDomainAudioDefParseXML(virDomainXMLOption *xmlopt G_GNUC_UNUSED,
 static virDomainWatchdogDef *
 virDomainWatchdogDefParseXML(virDomainXMLOption *xmlopt,
                              xmlNodePtr node,
-                             xmlXPathContextPtr ctxt,
                              unsigned int flags)
 {
     virDomainWatchdogDef *def;
@@ -13427,7 +13431,7 @@ virDomainWatchdogDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -13534,7 +13538,7 @@ virDomainRNGDefParseXML(virDomainXMLOption *xmlopt,
         break;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -13588,7 +13592,7 @@ virDomainMemballoonDefParseXML(virDomainXMLOption *xmlopt,
 
     if (def->model == VIR_DOMAIN_MEMBALLOON_MODEL_NONE)
         VIR_DEBUG("Ignoring device address for none model Memballoon");
-    else if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    else if (virDomainDeviceInfoParseXML(xmlopt, node,
                                          &def->info, flags) < 0)
         goto error;
 
@@ -13606,14 +13610,13 @@ virDomainMemballoonDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainNVRAMDef *
 virDomainNVRAMDefParseXML(virDomainXMLOption *xmlopt,
                           xmlNodePtr node,
-                          xmlXPathContextPtr ctxt,
                           unsigned int flags)
 {
     virDomainNVRAMDef *def;
 
     def = g_new0(virDomainNVRAMDef, 1);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -13691,7 +13694,7 @@ virDomainShmemDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
 
@@ -14339,7 +14342,7 @@ virDomainVideoDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     def->driver = virDomainVideoDriverDefParseXML(node, ctxt);
@@ -14391,7 +14394,7 @@ virDomainHostdevDefParseXML(virDomainXMLOption *xmlopt,
     }
 
     if (def->info->type == VIR_DOMAIN_DEVICE_ADDRESS_TYPE_NONE) {
-        if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, def->info,
+        if (virDomainDeviceInfoParseXML(xmlopt, node, def->info,
                                         flags  | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT
                                         | VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) < 0)
             goto error;
@@ -14473,7 +14476,7 @@ virDomainRedirdevDefParseXML(virDomainXMLOption *xmlopt,
     if (def->source->type == VIR_DOMAIN_CHR_TYPE_SPICEVMC)
         def->source->data.spicevmc = VIR_DOMAIN_CHR_SPICEVMC_USBREDIR;
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0)
         goto error;
 
@@ -14950,7 +14953,7 @@ virDomainMemoryDefParseXML(virDomainXMLOption *xmlopt,
     if (virDomainMemoryTargetDefParseXML(node, ctxt, def) < 0)
         goto error;
 
-    if (virDomainDeviceInfoParseXML(xmlopt, memdevNode, ctxt,
+    if (virDomainDeviceInfoParseXML(xmlopt, memdevNode,
                                     &def->info, flags) < 0)
         goto error;
 
@@ -15034,7 +15037,7 @@ virDomainVsockDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &vsock->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &vsock->info, flags) < 0)
         return NULL;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -15114,7 +15117,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_WATCHDOG:
         if (!(dev->data.watchdog = virDomainWatchdogDefParseXML(xmlopt, node,
-                                                                ctxt, flags)))
+                                                                flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_VIDEO:
@@ -15140,7 +15143,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_HUB:
         if (!(dev->data.hub = virDomainHubDefParseXML(xmlopt, node,
-                                                      ctxt, flags)))
+                                                      flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_REDIRDEV:
@@ -15174,7 +15177,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_NVRAM:
         if (!(dev->data.nvram = virDomainNVRAMDefParseXML(xmlopt, node,
-                                                          ctxt, flags)))
+                                                          flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_SHMEM:
@@ -15188,7 +15191,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_PANIC:
         if (!(dev->data.panic = virDomainPanicDefParseXML(xmlopt, node,
-                                                          ctxt, flags)))
+                                                          flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_MEMORY:
@@ -19057,6 +19060,13 @@ virDomainDefParseMemory(virDomainDef *def,
         VIR_FREE(tmp);
     }
 
+    if (virXPathUInt("string(./memoryBacking/allocation/@threads)",
+                     ctxt, &def->mem.allocation_threads) == -2) {
+        virReportError(VIR_ERR_XML_ERROR, "%s",
+                       _("invalid memoryBacking/allocation/threads value"));
+        goto error;
+    }
+
     if (virXPathNode("./memoryBacking/hugepages", ctxt)) {
         /* hugepages will be used */
         if ((n = virXPathNodeSet("./memoryBacking/hugepages/page", ctxt, &nodes)) < 0) {
@@ -19206,12 +19216,77 @@ virDomainMemorytuneDefParse(virDomainDef *def,
 }
 
 
+/*
+ * Collects the element children of all <@name> children of @parent and
+ * groups them by their element name. The hot parts of the domain parser
+ * look up the elements they need in the index rather than evaluating an
+ * XPath expression for each of them.
+ */
+static GHashTable *
+virDomainDefParseChildIndex(xmlNodePtr parent,
+                            const char *name)
+{
+    GHashTable *index = virHashNew((virHashDataFree) g_ptr_array_unref);
+    xmlNodePtr group;
+    xmlNodePtr cur;
+
+    for (group = parent->children; group; group = group->next) {
+        if (group->type != XML_ELEMENT_NODE || group->ns ||
+            !virXMLNodeNameEqual(group, name))
+            continue;
+
+        for (cur = group->children; cur; cur = cur->next) {
+            GPtrArray *nodes;
+
+            if (cur->type != XML_ELEMENT_NODE || cur->ns)
+                continue;
+
+            if (!(nodes = g_hash_table_lookup(index, cur->name))) {
+                nodes = g_ptr_array_new();
+                g_hash_table_insert(index, g_strdup((const char *)cur->name),
+                                    nodes);
+            }
+
+            g_ptr_array_add(nodes, cur);
+        }
+    }
+
+    return index;
+}
+
+
+/*
+ * Same as virXPathNodeSet for the elements named @name in @index: returns
+ * their number and fills @list with a copy of their nodes in document
+ * order, which the caller must free.
+ */
+static int
+virDomainDefParseChildIndexGet(GHashTable *index,
+                               const char *name,
+                               xmlNodePtr **list)
+{
+    GPtrArray *nodes = g_hash_table_lookup(index, name);
+
+    *list = NULL;
+
+    if (!nodes)
+        return 0;
+
+    *list = g_new0(xmlNodePtr, nodes->len);
+    memcpy(*list, nodes->pdata, nodes->len * sizeof(xmlNodePtr));
+
+    return nodes->len;
+}
+
+
 static int
 virDomainDefTunablesParse(virDomainDef *def,
                           xmlXPathContextPtr ctxt,
                           virDomainXMLOption *xmlopt,
                           unsigned int flags)
 {
+    g_autoptr(GHashTable) cputune = virDomainDefParseChildIndex(ctxt->node,
+                                                                "cputune");
     g_autofree xmlNodePtr *nodes = NULL;
     size_t i;
     int n;
@@ -19327,7 +19402,7 @@ virDomainDefTunablesParse(virDomainDef *def,
         return -1;
     }
 
-    if ((n = virXPathNodeSet("./cputune/vcpupin", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(cputune, "vcpupin", &nodes)) < 0)
         return -1;
 
     for (i = 0; i < n; i++) {
@@ -19336,7 +19411,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/emulatorpin", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "emulatorpin", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract emulatorpin nodes"));
         return -1;
@@ -19355,7 +19430,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     VIR_FREE(nodes);
 
 
-    if ((n = virXPathNodeSet("./cputune/iothreadpin", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "iothreadpin", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract iothreadpin nodes"));
         return -1;
@@ -19367,7 +19442,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/vcpusched", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "vcpusched", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract vcpusched nodes"));
         return -1;
@@ -19379,7 +19454,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/iothreadsched", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "iothreadsched", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract iothreadsched nodes"));
         return -1;
@@ -19391,7 +19466,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/emulatorsched", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "emulatorsched", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract emulatorsched nodes"));
         return -1;
@@ -19409,7 +19484,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/cachetune", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "cachetune", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract cachetune nodes"));
         return -1;
@@ -19421,7 +19496,7 @@ virDomainDefTunablesParse(virDomainDef *def,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./cputune/memorytune", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(cputune, "memorytune", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("cannot extract memorytune nodes"));
         return -1;
@@ -19589,6 +19664,7 @@ virDomainDefClockParse(virDomainDef *def,
 static int
 virDomainDefControllersParse(virDomainDef *def,
                              xmlXPathContextPtr ctxt,
+                             GHashTable *devices,
                              virDomainXMLOption *xmlopt,
                              unsigned int flags,
                              bool *usb_none)
@@ -19599,7 +19675,7 @@ virDomainDefControllersParse(virDomainDef *def,
     size_t i;
     int n;
 
-    if ((n = virXPathNodeSet("./devices/controller", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "controller", &nodes)) < 0)
         return -1;
 
     if (n)
@@ -19663,10 +19739,13 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     g_autofree xmlNodePtr *nodes = NULL;
     g_autofree char *tmp = NULL;
     g_autoptr(virDomainDef) def = NULL;
+    g_autoptr(GHashTable) devices = NULL;
 
     if (!(def = virDomainDefNew(xmlopt)))
         return NULL;
 
+    devices = virDomainDefParseChildIndex(ctxt->node, "devices");
+
     if (virDomainDefParseIDs(def, ctxt, flags, &uuid_generated) < 0)
         return NULL;
 
@@ -19762,7 +19841,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
         return NULL;
 
     /* analysis of the disk devices */
-    if ((n = virXPathNodeSet("./devices/disk", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "disk", &nodes)) < 0)
         return NULL;
 
     for (i = 0; i < n; i++) {
@@ -19777,11 +19856,12 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if (virDomainDefControllersParse(def, ctxt, xmlopt, flags, &usb_none) < 0)
+    if (virDomainDefControllersParse(def, ctxt, devices, xmlopt, flags,
+                                     &usb_none) < 0)
         return NULL;
 
     /* analysis of the resource leases */
-    if ((n = virXPathNodeSet("./devices/lease", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(devices, "lease", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("cannot extract device leases"));
         return NULL;
@@ -19798,7 +19878,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the filesystems */
-    if ((n = virXPathNodeSet("./devices/filesystem", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "filesystem", &nodes)) < 0)
         return NULL;
     if (n)
         def->fss = g_new0(virDomainFSDef *, n);
@@ -19815,7 +19895,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the network devices */
-    if ((n = virXPathNodeSet("./devices/interface", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "interface", &nodes)) < 0)
         return NULL;
     if (n)
         def->nets = g_new0(virDomainNetDef *, n);
@@ -19842,7 +19922,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the smartcard devices */
-    if ((n = virXPathNodeSet("./devices/smartcard", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "smartcard", &nodes)) < 0)
         return NULL;
     if (n)
         def->smartcards = g_new0(virDomainSmartcardDef *, n);
@@ -19861,7 +19941,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the character devices */
-    if ((n = virXPathNodeSet("./devices/parallel", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "parallel", &nodes)) < 0)
         return NULL;
     if (n)
         def->parallels = g_new0(virDomainChrDef *, n);
@@ -19886,7 +19966,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/serial", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "serial", &nodes)) < 0)
         return NULL;
 
     if (n)
@@ -19912,7 +19992,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/console", ctxt, &nodes)) < 0) {
+    if ((n = virDomainDefParseChildIndexGet(devices, "console", &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("cannot extract console devices"));
         return NULL;
@@ -19933,7 +20013,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/channel", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "channel", &nodes)) < 0)
         return NULL;
     if (n)
         def->channels = g_new0(virDomainChrDef *, n);
@@ -19952,7 +20032,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the input devices */
-    if ((n = virXPathNodeSet("./devices/input", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "input", &nodes)) < 0)
         return NULL;
     if (n)
         def->inputs = g_new0(virDomainInputDef *, n);
@@ -19980,7 +20060,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the graphics devices */
-    if ((n = virXPathNodeSet("./devices/graphics", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "graphics", &nodes)) < 0)
         return NULL;
     if (n)
         def->graphics = g_new0(virDomainGraphicsDef *, n);
@@ -19997,7 +20077,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the sound devices */
-    if ((n = virXPathNodeSet("./devices/sound", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "sound", &nodes)) < 0)
         return NULL;
     if (n)
         def->sounds = g_new0(virDomainSoundDef *, n);
@@ -20014,7 +20094,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the audio devices */
-    if ((n = virXPathNodeSet("./devices/audio", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "audio", &nodes)) < 0)
         return NULL;
     if (n)
         def->audios = g_new0(virDomainAudioDef *, n);
@@ -20030,7 +20110,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the video devices */
-    if ((n = virXPathNodeSet("./devices/video", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "video", &nodes)) < 0)
         return NULL;
     if (n)
         def->videos = g_new0(virDomainVideoDef *, n);
@@ -20057,7 +20137,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the host devices */
-    if ((n = virXPathNodeSet("./devices/hostdev", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "hostdev", &nodes)) < 0)
         return NULL;
     if (n > 0)
         VIR_REALLOC_N(def->hostdevs, def->nhostdevs + n);
@@ -20094,7 +20174,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
     /* analysis of the watchdog devices */
     def->watchdog = NULL;
-    if ((n = virXPathNodeSet("./devices/watchdog", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "watchdog", &nodes)) < 0)
         return NULL;
     if (n > 1) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -20104,7 +20184,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     if (n > 0) {
         virDomainWatchdogDef *watchdog;
 
-        watchdog = virDomainWatchdogDefParseXML(xmlopt, nodes[0], ctxt, flags);
+        watchdog = virDomainWatchdogDefParseXML(xmlopt, nodes[0], flags);
         if (!watchdog)
             return NULL;
 
@@ -20114,7 +20194,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
     /* analysis of the memballoon devices */
     def->memballoon = NULL;
-    if ((n = virXPathNodeSet("./devices/memballoon", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "memballoon", &nodes)) < 0)
         return NULL;
     if (n > 1) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -20133,7 +20213,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* Parse the RNG devices */
-    if ((n = virXPathNodeSet("./devices/rng", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "rng", &nodes)) < 0)
         return NULL;
     if (n)
         def->rngs = g_new0(virDomainRNGDef *, n);
@@ -20148,7 +20228,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* Parse the TPM devices */
-    if ((n = virXPathNodeSet("./devices/tpm", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "tpm", &nodes)) < 0)
         return NULL;
 
     if (n > 2) {
@@ -20171,7 +20251,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/nvram", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "nvram", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -20180,7 +20260,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
         return NULL;
     } else if (n == 1) {
         virDomainNVRAMDef *nvram =
-            virDomainNVRAMDefParseXML(xmlopt, nodes[0], ctxt, flags);
+            virDomainNVRAMDefParseXML(xmlopt, nodes[0], flags);
         if (!nvram)
             return NULL;
         def->nvram = nvram;
@@ -20188,14 +20268,14 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* analysis of the hub devices */
-    if ((n = virXPathNodeSet("./devices/hub", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "hub", &nodes)) < 0)
         return NULL;
     if (n)
         def->hubs = g_new0(virDomainHubDef *, n);
     for (i = 0; i < n; i++) {
         virDomainHubDef *hub;
 
-        hub = virDomainHubDefParseXML(xmlopt, nodes[i], ctxt, flags);
+        hub = virDomainHubDefParseXML(xmlopt, nodes[i], flags);
         if (!hub)
             return NULL;
 
@@ -20212,7 +20292,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the redirected devices */
-    if ((n = virXPathNodeSet("./devices/redirdev", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "redirdev", &nodes)) < 0)
         return NULL;
     if (n)
         def->redirdevs = g_new0(virDomainRedirdevDef *, n);
@@ -20227,7 +20307,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the redirection filter rules */
-    if ((n = virXPathNodeSet("./devices/redirfilter", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "redirfilter", &nodes)) < 0)
         return NULL;
     if (n > 1) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -20246,14 +20326,14 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the panic devices */
-    if ((n = virXPathNodeSet("./devices/panic", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "panic", &nodes)) < 0)
         return NULL;
     if (n)
         def->panics = g_new0(virDomainPanicDef *, n);
     for (i = 0; i < n; i++) {
         virDomainPanicDef *panic;
 
-        panic = virDomainPanicDefParseXML(xmlopt, nodes[i], ctxt, flags);
+        panic = virDomainPanicDefParseXML(xmlopt, nodes[i], flags);
         if (!panic)
             return NULL;
 
@@ -20262,7 +20342,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the shmem devices */
-    if ((n = virXPathNodeSet("./devices/shmem", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "shmem", &nodes)) < 0)
         return NULL;
     if (n)
         def->shmems = g_new0(virDomainShmemDef *, n);
@@ -20288,7 +20368,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* analysis of memory devices */
-    if ((n = virXPathNodeSet("./devices/memory", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "memory", &nodes)) < 0)
         return NULL;
     if (n)
         def->mems = g_new0(virDomainMemoryDef *, n);
@@ -20305,7 +20385,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/iommu", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "iommu", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -20320,7 +20400,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/vsock", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefParseChildIndexGet(devices, "vsock", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -27606,9 +27686,15 @@ virDomainMemorybackingFormat(virBuffer *buf,
     if (mem->access)
         virBufferAsprintf(&childBuf, "<access mode='%s'/>\n",
                           virDomainMemoryAccessTypeToString(mem->access));
-    if (mem->allocation)
-        virBufferAsprintf(&childBuf, "<allocation mode='%s'/>\n",
-                          virDomainMemoryAllocationTypeToString(mem->allocation));
+    if (mem->allocation || mem->allocation_threads) {
+        virBufferAddLit(&childBuf, "<allocation");
+        if (mem->allocation)
+            virBufferAsprintf(&childBuf, " mode='%s'",
+                              virDomainMemoryAllocationTypeToString(mem->allocation));
+        if (mem->allocation_threads)
+            virBufferAsprintf(&childBuf, " threads='%u'", mem->allocation_threads);
+        virBufferAddLit(&childBuf, "/>\n");
+    }
     if (mem->discard)
         virBufferAddLit(&childBuf, "<discard/>\n");
 
@@ -28031,6 +28117,54 @@ virDomainDefFormatInternal(virDomainDef *def,
 }
 
 
+/* Formats only the sections of @def selected by the
+ * VIR_DOMAIN_DEF_FORMAT_SECTION_* @flags, so that clients interested
+ * in a part of a large definition don't pay for formatting the rest. */
+static int
+virDomainDefFormatSections(virDomainDef *def,
+                           virDomainXMLOption *xmlopt,
+                           virBuffer *buf,
+                           unsigned int flags)
+{
+    size_t i;
+
+    if (flags & VIR_DOMAIN_DEF_FORMAT_SECTION_METADATA) {
+        virBufferEscapeString(buf, "<title>%s</title>\n", def->title);
+        virBufferEscapeString(buf, "<description>%s</description>\n",
+                              def->description);
+
+        if (virXMLFormatMetadata(buf, def->metadata) < 0)
+            return -1;
+    }
+
+    if (!(flags & (VIR_DOMAIN_DEF_FORMAT_SECTION_DISKS |
+                   VIR_DOMAIN_DEF_FORMAT_SECTION_INTERFACES)))
+        return 0;
+
+    virBufferAddLit(buf, "<devices>\n");
+    virBufferAdjustIndent(buf, 2);
+
+    if (flags & VIR_DOMAIN_DEF_FORMAT_SECTION_DISKS) {
+        for (i = 0; i < def->ndisks; i++) {
+            if (virDomainDiskDefFormat(buf, def->disks[i], flags, xmlopt) < 0)
+                return -1;
+        }
+    }
+
+    if (flags & VIR_DOMAIN_DEF_FORMAT_SECTION_INTERFACES) {
+        for (i = 0; i < def->nnets; i++) {
+            if (virDomainNetDefFormat(buf, def->nets[i], xmlopt, flags) < 0)
+                return -1;
+        }
+    }
+
+    virBufferAdjustIndent(buf, -2);
+    virBufferAddLit(buf, "</devices>\n");
+
+    return 0;
+}
+
+
 /* This internal version appends to an existing buffer
  * (possibly with auto-indent), rather than flattening
  * to string.
@@ -28052,7 +28186,8 @@ virDomainDefFormatInternalSetRootName(virDomainDef *def,
                   VIR_DOMAIN_DEF_FORMAT_STATUS |
                   VIR_DOMAIN_DEF_FORMAT_ACTUAL_NET |
                   VIR_DOMAIN_DEF_FORMAT_PCI_ORIG_STATES |
-                  VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST,
+                  VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST |
+                  VIR_DOMAIN_DEF_FORMAT_SECTIONS,
                   -1);
 
     if (!(type = virDomainVirtTypeToString(def->virtType))) {
@@ -28078,6 +28213,15 @@ virDomainDefFormatInternalSetRootName(virDomainDef *def,
     virUUIDFormat(uuid, uuidstr);
     virBufferAsprintf(buf, "<uuid>%s</uuid>\n", uuidstr);
 
+    if (flags & VIR_DOMAIN_DEF_FORMAT_SECTIONS) {
+        if (virDomainDefFormatSections(def, xmlopt, buf, flags) < 0)
+            return -1;
+
+        virBufferAdjustIndent(buf, -2);
+        virBufferAsprintf(buf, "</%s>\n", rootname);
+        return 0;
+    }
+
     if (def->genidRequested) {
         char genidstr[VIR_UUID_STRING_BUFLEN];
 
@@ -28561,6 +28705,12 @@ unsigned int virDomainDefFormatConvertXMLFlags(unsigned int flags)
         formatFlags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE;
     if (flags & VIR_DOMAIN_XML_MIGRATABLE)
         formatFlags |= VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
+    if (flags & VIR_DOMAIN_XML_SECTION_METADATA)
+        formatFlags |= VIR_DOMAIN_DEF_FORMAT_SECTION_METADATA;
+    if (flags & VIR_DOMAIN_XML_SECTION_DISKS)
+        formatFlags |= VIR_DOMAIN_DEF_FORMAT_SECTION_DISKS;
+    if (flags & VIR_DOMAIN_XML_SECTION_INTERFACES)
+        formatFlags |= VIR_DOMAIN_DEF_FORMAT_SECTION_INTERFACES;
 
     return formatFlags;
 }
@@ -28573,7 +28723,15 @@ virDomainDefFormat(virDomainDef *def,
 {
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
 
-    virCheckFlags(VIR_DOMAIN_DEF_FORMAT_COMMON_FLAGS, NULL);
+    virCheckFlags(VIR_DOMAIN_DEF_FORMAT_COMMON_FLAGS |
+                  VIR_DOMAIN_DEF_FORMAT_SECTIONS |
+                  VIR_DOMAIN_DEF_FORMAT_COMPACT, NULL);
+
+    if (flags & VIR_DOMAIN_DEF_FORMAT_COMPACT) {
+        virBufferSetCompact(&buf, true);
+        flags &= ~VIR_DOMAIN_DEF_FORMAT_COMPACT;
+    }
+
     if (virDomainDefFormatInternal(def, xmlopt, &buf, flags) < 0)
         return NULL;
 
@@ -28591,6 +28749,11 @@ virDomainObjFormat(virDomainObj *obj,
     int reason;
     size_t i;
 
+    if (flags & VIR_DOMAIN_DEF_FORMAT_COMPACT) {
+        virBufferSetCompact(&buf, true);
+        flags &= ~VIR_DOMAIN_DEF_FORMAT_COMPACT;
+    }
+
     state = virDomainObjGetState(obj, &reason);
     virBufferAsprintf(&buf, "<domstatus state='%s' reason='%s' pid='%lld'>\n",
                       virDomainStateTypeToString(state),
@@ -28797,10 +28960,13 @@ virDomainObjSave(virDomainObj *obj,
                           VIR_DOMAIN_DEF_FORMAT_STATUS |
                           VIR_DOMAIN_DEF_FORMAT_ACTUAL_NET |
                           VIR_DOMAIN_DEF_FORMAT_PCI_ORIG_STATES |
-                          VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST);
+                          VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST |
+                          VIR_DOMAIN_DEF_FORMAT_COMPACT);
 
     g_autofree char *xml = NULL;
 
+    obj->generation++;
+
     if (!(xml = virDomainObjFormat(obj, xmlopt, flags)))
         return -1;
 
@@ -29120,7 +29286,8 @@ virDomainDefCopy(virDomainDef *src,
                  void *parseOpaque,
                  bool migratable)
 {
-    unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE;
+    unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE |
+                                VIR_DOMAIN_DEF_FORMAT_COMPACT;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
     g_autofree char *xml = NULL;
@@ -29128,7 +29295,9 @@ virDomainDefCopy(virDomainDef *src,
     if (migratable)
         format_flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE | VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
 
-    /* Easiest to clone via a round-trip through XML.  */
+    /* Easiest to clone via a round-trip through XML. The XML is never seen
+     * by anyone, so skip indentation which would only give the parser a
+     * whitespace text node to create and throw away for every element.  */
     if (!(xml = virDomainDefFormat(src, xmlopt, format_flags)))
         return NULL;
 
@@ -29989,6 +30158,8 @@ virDomainObjSetMetadata(virDomainObj *vm,
     if (virDomainObjGetDefs(vm, flags, &def, &persistentDef) < 0)
         return -1;
 
+    vm->generation++;
+
     if (def) {
         if (virDomainDefSetMetadata(def, type, metadata, key, uri) < 0)
             return -1;
@@ -2655,6 +2655,7 @@ struct _virDomainMemtune {
     int source; /* enum virDomainMemorySource */
     int access; /* enum virDomainMemoryAccess */
     int allocation; /* enum virDomainMemoryAllocation */
+    unsigned int allocation_threads;
 
     virTristateBool discard;
 };
@@ -3008,6 +3009,9 @@ struct _virDomainObj {
 
     unsigned long long originalMemlock; /* Original RLIMIT_MEMLOCK, zero if no
                                          * restore will be required later */
+
+    unsigned long long generation; /* Bumped whenever def or newDef may have
+                                    * changed, lets drivers cache formatted XML */
 };
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainObj, virObjectUnref);
@@ -3467,8 +3471,19 @@ typedef enum {
     VIR_DOMAIN_DEF_FORMAT_ALLOW_ROM       = 1 << 6,
     VIR_DOMAIN_DEF_FORMAT_ALLOW_BOOT      = 1 << 7,
     VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST    = 1 << 8,
+    /* omit indentation, for XML read back by libvirt only */
+    VIR_DOMAIN_DEF_FORMAT_COMPACT         = 1 << 9,
+    /* format only the name, UUID and the selected sections */
+    VIR_DOMAIN_DEF_FORMAT_SECTION_METADATA   = 1 << 10,
+    VIR_DOMAIN_DEF_FORMAT_SECTION_DISKS      = 1 << 11,
+    VIR_DOMAIN_DEF_FORMAT_SECTION_INTERFACES = 1 << 12,
 } virDomainDefFormatFlags;
 
+#define VIR_DOMAIN_DEF_FORMAT_SECTIONS \
+    (VIR_DOMAIN_DEF_FORMAT_SECTION_METADATA | \
+     VIR_DOMAIN_DEF_FORMAT_SECTION_DISKS | \
+     VIR_DOMAIN_DEF_FORMAT_SECTION_INTERFACES)
+
 /* Use these flags to skip specific domain ABI consistency checks done
  * in virDomainDefCheckABIStabilityFlags.
  */
@@ -3537,6 +3552,12 @@ void virDomainIOThreadIDDel(virDomainDef *def, unsigned int iothread_id);
 #define VIR_DOMAIN_XML_COMMON_FLAGS \
     (VIR_DOMAIN_XML_SECURE | VIR_DOMAIN_XML_INACTIVE | \
      VIR_DOMAIN_XML_MIGRATABLE)
+/* Selecting sections only suppresses elements the client did not ask for,
+ * so an older server returning the whole XML is harmless. Drivers which
+ * format through virDomainDefFormatConvertXMLFlags can accept them. */
+#define VIR_DOMAIN_XML_SECTION_FLAGS \
+    (VIR_DOMAIN_XML_SECTION_METADATA | VIR_DOMAIN_XML_SECTION_DISKS | \
+     VIR_DOMAIN_XML_SECTION_INTERFACES)
 unsigned int virDomainDefFormatConvertXMLFlags(unsigned int flags);
 
 char *virDomainDefFormat(virDomainDef *def,
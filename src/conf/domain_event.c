@@ -59,6 +59,7 @@ static virClass *virDomainEventMetadataChangeClass;
 static virClass *virDomainEventBlockThresholdClass;
 static virClass *virDomainEventMemoryFailureClass;
 static virClass *virDomainEventMemoryDeviceSizeChangeClass;
+static virClass *virDomainEventStatsClass;
 
 static void virDomainEventDispose(void *obj);
 static void virDomainEventLifecycleDispose(void *obj);
@@ -83,6 +84,7 @@ static void virDomainEventMetadataChangeDispose(void *obj);
 static void virDomainEventBlockThresholdDispose(void *obj);
 static void virDomainEventMemoryFailureDispose(void *obj);
 static void virDomainEventMemoryDeviceSizeChangeDispose(void *obj);
+static void virDomainEventStatsDispose(void *obj);
 
 static void
 virDomainEventDispatchDefaultFunc(virConnectPtr conn,
@@ -288,6 +290,14 @@ struct _virDomainEventMemoryDeviceSizeChange {
 typedef struct _virDomainEventMemoryDeviceSizeChange virDomainEventMemoryDeviceSizeChange;
 typedef virDomainEventMemoryDeviceSizeChange *virDomainEventMemoryDeviceSizeChangePtr;
 
+struct _virDomainEventStats {
+    virDomainEvent parent;
+
+    virTypedParameterPtr params;
+    int nparams;
+};
+typedef struct _virDomainEventStats virDomainEventStats;
+
 static int
 virDomainEventsOnceInit(void)
 {
@@ -337,6 +347,8 @@ virDomainEventsOnceInit(void)
         return -1;
     if (!VIR_CLASS_NEW(virDomainEventMemoryDeviceSizeChange, virDomainEventClass))
         return -1;
+    if (!VIR_CLASS_NEW(virDomainEventStats, virDomainEventClass))
+        return -1;
     return 0;
 }
 
@@ -562,6 +574,15 @@ virDomainEventMemoryDeviceSizeChangeDispose(void *obj)
     g_free(event->alias);
 }
 
+static void
+virDomainEventStatsDispose(void *obj)
+{
+    virDomainEventStats *event = obj;
+    VIR_DEBUG("obj=%p", event);
+
+    virTypedParamsFree(event->params, event->nparams);
+}
+
 static void *
 virDomainEventNew(virClass *klass,
                   int eventID,
@@ -1736,6 +1757,67 @@ virDomainEventMemoryDeviceSizeChangeNewFromDom(virDomainPtr dom,
 }
 
 
+/* Like virDomainEventTunableNew this consumes @params. A non-zero
+ * @connSerial restricts delivery to callbacks of that connection. */
+static virObjectEvent *
+virDomainEventStatsNew(int id,
+                       const char *name,
+                       unsigned char *uuid,
+                       unsigned long long connSerial,
+                       virTypedParameterPtr params,
+                       int nparams)
+{
+    virDomainEventStats *ev;
+
+    if (virDomainEventsInitialize() < 0)
+        goto error;
+
+    if (!(ev = virDomainEventNew(virDomainEventStatsClass,
+                                 VIR_DOMAIN_EVENT_ID_STATS,
+                                 id, name, uuid)))
+        goto error;
+
+    ev->parent.parent.connSerial = connSerial;
+    ev->params = params;
+    ev->nparams = nparams;
+
+    return (virObjectEvent *)ev;
+
+ error:
+    virTypedParamsFree(params, nparams);
+    return NULL;
+}
+
+
+virObjectEvent *
+virDomainEventStatsNewFromObj(virDomainObj *obj,
+                              unsigned long long connSerial,
+                              virTypedParameterPtr params,
+                              int nparams)
+{
+    return virDomainEventStatsNew(obj->def->id,
+                                  obj->def->name,
+                                  obj->def->uuid,
+                                  connSerial,
+                                  params,
+                                  nparams);
+}
+
+
+virObjectEvent *
+virDomainEventStatsNewFromDom(virDomainPtr dom,
+                              virTypedParameterPtr params,
+                              int nparams)
+{
+    return virDomainEventStatsNew(dom->id,
+                                  dom->name,
+                                  dom->uuid,
+                                  0,
+                                  params,
+                                  nparams);
+}
+
+
 static void
 virDomainEventDispatchDefaultFunc(virConnectPtr conn,
                                   virObjectEvent *event,
@@ -2044,6 +2126,18 @@ virDomainEventDispatchDefaultFunc(virConnectPtr conn,
             goto cleanup;
         }
 
+    case VIR_DOMAIN_EVENT_ID_STATS:
+        {
+            virDomainEventStats *statsEvent;
+
+            statsEvent = (virDomainEventStats *)event;
+            ((virConnectDomainEventStatsCallback)cb)(conn, dom,
+                                                     statsEvent->params,
+                                                     statsEvent->nparams,
+                                                     cbopaque);
+            goto cleanup;
+        }
+
     case VIR_DOMAIN_EVENT_ID_LAST:
         break;
     }
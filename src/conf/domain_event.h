@@ -277,6 +277,17 @@ virDomainEventMemoryDeviceSizeChangeNewFromDom(virDomainPtr dom,
                                                const char *alias,
                                                unsigned long long size);
 
+virObjectEvent *
+virDomainEventStatsNewFromObj(virDomainObj *obj,
+                              unsigned long long connSerial,
+                              virTypedParameterPtr params,
+                              int nparams);
+
+virObjectEvent *
+virDomainEventStatsNewFromDom(virDomainPtr dom,
+                              virTypedParameterPtr params,
+                              int nparams);
+
 int
 virDomainEventStateRegister(virConnectPtr conn,
                             virObjectEventState *state,
@@ -2632,7 +2632,8 @@ virNodeDeviceUpdateCaps(virNodeDeviceDef *def)
             break;
         case VIR_NODE_DEV_CAP_PCI_DEV:
             if (virNodeDeviceGetPCIDynamicCaps(def->sysfs_path,
-                                               &cap->data.pci_dev) < 0)
+                                               &cap->data.pci_dev,
+                                               true) < 0)
                 return -1;
             break;
         case VIR_NODE_DEV_CAP_CSS_DEV:
@@ -3043,10 +3044,12 @@ virNodeDeviceGetPCIVPDDynamicCap(virNodeDevCapPCIDev *devCapPCIDev)
  * without this device itself changing. These must be refreshed
  * anytime full XML of the device is requested, because they can
  * change with no corresponding notification from the kernel/udev.
+ * Reading VPD can be slow, so it is skipped unless @vpd is true.
  */
 int
 virNodeDeviceGetPCIDynamicCaps(const char *sysfsPath,
-                               virNodeDevCapPCIDev *pci_dev)
+                               virNodeDevCapPCIDev *pci_dev,
+                               bool vpd)
 {
     if (virNodeDeviceGetPCISRIOVCaps(sysfsPath, pci_dev) < 0 ||
         virNodeDeviceGetPCIIOMMUGroupCaps(pci_dev) < 0)
@@ -3060,7 +3063,7 @@ virNodeDeviceGetPCIDynamicCaps(const char *sysfsPath,
     if (pci_dev->nmdev_types > 0)
         pci_dev->flags |= VIR_NODE_DEV_CAP_FLAG_PCI_MDEV;
 
-    if (virNodeDeviceGetPCIVPDDynamicCap(pci_dev) < 0)
+    if (vpd && virNodeDeviceGetPCIVPDDynamicCap(pci_dev) < 0)
         return -1;
 
     return 0;
@@ -3119,7 +3122,8 @@ virNodeDeviceGetSCSIHostCaps(virNodeDevCapSCSIHost *scsi_host G_GNUC_UNUSED)
 
 int
 virNodeDeviceGetPCIDynamicCaps(const char *sysfsPath G_GNUC_UNUSED,
-                               virNodeDevCapPCIDev *pci_dev G_GNUC_UNUSED)
+                               virNodeDevCapPCIDev *pci_dev G_GNUC_UNUSED,
+                               bool vpd G_GNUC_UNUSED)
 {
     return -1;
 }
@@ -442,7 +442,8 @@ virNodeDeviceGetSCSITargetCaps(const char *sysfsPath,
 
 int
 virNodeDeviceGetPCIDynamicCaps(const char *sysfsPath,
-                               virNodeDevCapPCIDev *pci_dev);
+                               virNodeDevCapPCIDev *pci_dev,
+                               bool vpd);
 
 int
 virNodeDeviceGetCSSDynamicCaps(const char *sysfsPath,
@@ -29,6 +29,7 @@
 #include "virlog.h"
 #include "datatypes.h"
 #include "viralloc.h"
+#include "virhash.h"
 #include "virerror.h"
 #include "virobject.h"
 #include "virstring.h"
@@ -55,10 +56,22 @@ struct _virObjectEventCallback {
 };
 typedef struct _virObjectEventCallback virObjectEventCallback;
 
+/* Callbacks sharing the same event ID and object key, in the order
+ * of registration (and thus of increasing callbackID) */
+struct _virObjectEventCallbackBucket {
+    size_t count;
+    virObjectEventCallback **callbacks;
+};
+typedef struct _virObjectEventCallbackBucket virObjectEventCallbackBucket;
+
 struct _virObjectEventCallbackList {
     unsigned int nextID;
     size_t count;
     virObjectEventCallback **callbacks;
+    /* @callbacks indexed by virObjectEventCallbackIndexKey(), so that
+     * dispatching an event only needs to look at the callbacks that
+     * registered for its event ID, either globally or for its object */
+    GHashTable *index;
 };
 
 struct _virObjectEventQueue {
@@ -142,6 +155,94 @@ virObjectEventCallbackFree(virObjectEventCallback *cb)
     g_free(cb);
 }
 
+static void
+virObjectEventCallbackBucketFree(void *opaque)
+{
+    virObjectEventCallbackBucket *bucket = opaque;
+
+    if (!bucket)
+        return;
+
+    g_free(bucket->callbacks);
+    g_free(bucket);
+}
+
+
+static virObjectEventCallbackList *
+virObjectEventCallbackListNew(void)
+{
+    virObjectEventCallbackList *list = g_new0(virObjectEventCallbackList, 1);
+
+    list->index = virHashNew(virObjectEventCallbackBucketFree);
+
+    return list;
+}
+
+
+/**
+ * virObjectEventCallbackIndexKey:
+ * @eventID: the event ID
+ * @key: optional key of per-object filtering
+ *
+ * Returns the key under which callbacks for @eventID are stored in
+ * the callback list index: either the ones registered for object
+ * @key, or the global ones if @key is NULL.
+ */
+static char *
+virObjectEventCallbackIndexKey(int eventID,
+                               const char *key)
+{
+    if (key)
+        return g_strdup_printf("%d/%s", eventID, key);
+    return g_strdup_printf("%d", eventID);
+}
+
+
+static void
+virObjectEventCallbackListIndexAdd(virObjectEventCallbackList *cbList,
+                                   virObjectEventCallback *cb)
+{
+    g_autofree char *key = NULL;
+    virObjectEventCallbackBucket *bucket;
+
+    key = virObjectEventCallbackIndexKey(cb->eventID,
+                                         cb->key_filter ? cb->key : NULL);
+
+    if (!(bucket = g_hash_table_lookup(cbList->index, key))) {
+        bucket = g_new0(virObjectEventCallbackBucket, 1);
+        g_hash_table_insert(cbList->index, g_steal_pointer(&key), bucket);
+    }
+
+    VIR_APPEND_ELEMENT(bucket->callbacks, bucket->count, cb);
+}
+
+
+static void
+virObjectEventCallbackListIndexRemove(virObjectEventCallbackList *cbList,
+                                      virObjectEventCallback *cb)
+{
+    g_autofree char *key = NULL;
+    virObjectEventCallbackBucket *bucket;
+    size_t i;
+
+    key = virObjectEventCallbackIndexKey(cb->eventID,
+                                         cb->key_filter ? cb->key : NULL);
+
+    if (!(bucket = g_hash_table_lookup(cbList->index, key)))
+        return;
+
+    for (i = 0; i < bucket->count; i++) {
+        if (bucket->callbacks[i] == cb) {
+            VIR_DELETE_ELEMENT(bucket->callbacks, i, bucket->count);
+            break;
+        }
+    }
+
+    if (bucket->count == 0)
+        g_hash_table_remove(cbList->index, key);
+}
+
+
 /**
  * virObjectEventCallbackListFree:
  * @list: event callback list head
@@ -162,6 +263,7 @@ virObjectEventCallbackListFree(virObjectEventCallbackList *list)
         g_free(list->callbacks[i]);
     }
     g_free(list->callbacks);
+    g_clear_pointer(&list->index, g_hash_table_unref);
     g_free(list);
 }
 
@@ -251,6 +353,7 @@ virObjectEventCallbackListRemoveID(virConnectPtr conn,
              * function won't end up with a double free error */
             if (doFreeCb && cb->freecb)
                 (*cb->freecb)(cb->opaque);
+            virObjectEventCallbackListIndexRemove(cbList, cb);
             virObjectEventCallbackFree(cb);
             VIR_DELETE_ELEMENT(cbList->callbacks, i, cbList->count);
             return ret;
@@ -300,6 +403,7 @@ virObjectEventCallbackListPurgeMarked(virObjectEventCallbackList *cbList)
             virFreeCallback freecb = cbList->callbacks[n]->freecb;
             if (freecb)
                 (*freecb)(cbList->callbacks[n]->opaque);
+            virObjectEventCallbackListIndexRemove(cbList, cbList->callbacks[n]);
             virObjectEventCallbackFree(cbList->callbacks[n]);
 
             VIR_DELETE_ELEMENT(cbList->callbacks, n, cbList->count);
@@ -440,6 +544,7 @@ virObjectEventCallbackListAddID(virConnectPtr conn,
     cb->filter_opaque = filter_opaque;
     cb->legacy = legacy;
 
+    virObjectEventCallbackListIndexAdd(cbList, cb);
     VIR_APPEND_ELEMENT(cbList->callbacks, cbList->count, cb);
 
     /* When additional filtering is being done, every client callback
@@ -557,7 +662,7 @@ virObjectEventStateNew(void)
     if (!(state = virObjectLockableNew(virObjectEventStateClass)))
         return NULL;
 
-    state->callbacks = g_new0(virObjectEventCallbackList, 1);
+    state->callbacks = virObjectEventCallbackListNew();
 
     if (!(state->queue = virObjectEventQueueNew()))
         goto error;
@@ -659,6 +764,8 @@ virObjectEventDispatchMatchCallback(virObjectEvent *event,
         return false;
     if (cb->remoteID != event->remoteID)
         return false;
+    if (event->connSerial && cb->conn->serial != event->connSerial)
+        return false;
 
     if (cb->filter && !(cb->filter)(cb->conn, event, cb->filter_opaque))
         return false;
@@ -669,19 +776,57 @@ virObjectEventDispatchMatchCallback(virObjectEvent *event,
 }
 
 
+static virObjectEventCallbackBucket *
+virObjectEventCallbackListLookupBucket(virObjectEventCallbackList *callbacks,
+                                       int eventID,
+                                       const char *key)
+{
+    g_autofree char *indexKey = virObjectEventCallbackIndexKey(eventID, key);
+
+    return g_hash_table_lookup(callbacks->index, indexKey);
+}
+
+
 static void
 virObjectEventStateDispatchCallbacks(virObjectEventState *state,
                                      virObjectEvent *event,
                                      virObjectEventCallbackList *callbacks)
 {
-    size_t i;
-    /* Cache this now, since we may be dropping the lock,
+    virObjectEventCallbackBucket *global;
+    virObjectEventCallbackBucket *object = NULL;
+    size_t nglobal = 0;
+    size_t nobject = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* Only the global callbacks for this event ID and the ones
+     * registered for the event's object can possibly match. */
+    global = virObjectEventCallbackListLookupBucket(callbacks,
+                                                    event->eventID, NULL);
+    if (event->meta.key)
+        object = virObjectEventCallbackListLookupBucket(callbacks,
+                                                        event->eventID,
+                                                        event->meta.key);
+
+    /* Cache the counts now, since we may be dropping the lock,
        and have more callbacks added. We're guaranteed not
        to have any removed */
-    size_t cbCount = callbacks->count;
-
-    for (i = 0; i < cbCount; i++) {
-        virObjectEventCallback *cb = callbacks->callbacks[i];
+    if (global)
+        nglobal = global->count;
+    if (object)
+        nobject = object->count;
+
+    /* Merge both buckets by callbackID to preserve the order in
+     * which callbacks were registered */
+    while (i < nglobal || j < nobject) {
+        virObjectEventCallback *cb;
+
+        if (j >= nobject ||
+            (i < nglobal &&
+             global->callbacks[i]->callbackID < object->callbacks[j]->callbackID))
+            cb = global->callbacks[i++];
+        else
+            cb = object->callbacks[j++];
 
         if (!virObjectEventDispatchMatchCallback(event, cb))
             continue;
@@ -45,6 +45,9 @@ struct  __attribute__((aligned(8))) _virObjectEvent {
     int eventID;
     virObjectMeta meta;
     int remoteID;
+    /* If non-zero, deliver only to callbacks of the connection
+     * with this serial */
+    unsigned long long connSerial;
     virObjectEventDispatchFunc dispatch;
 };
 
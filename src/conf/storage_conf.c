@@ -101,6 +101,11 @@ VIR_ENUM_IMPL(virStorageVolDefRefreshAllocation,
               "default", "capacity",
 );
 
+VIR_ENUM_IMPL(virStoragePoolCloneMode,
+              VIR_STORAGE_POOL_CLONE_MODE_LAST,
+              "default", "full", "reflink", "auto", "overlay",
+);
+
 VIR_ENUM_IMPL(virStoragePartedFs,
               VIR_STORAGE_PARTED_FS_TYPE_LAST,
               "ext2", "ext2", "fat16",
@@ -809,6 +814,7 @@ virStoragePoolDefParseFeatures(virStoragePoolDef *def,
                                xmlXPathContextPtr ctxt)
 {
     g_autofree char *cow = virXPathString("string(./features/cow/@state)", ctxt);
+    g_autofree char *clone = virXPathString("string(./features/clone/@mode)", ctxt);
 
     if (cow) {
         int val;
@@ -827,6 +833,24 @@ virStoragePoolDefParseFeatures(virStoragePoolDef *def,
         def->features.cow = val;
     }
 
+    if (clone) {
+        int val;
+        if (def->type != VIR_STORAGE_POOL_FS &&
+            def->type != VIR_STORAGE_POOL_DIR &&
+            def->type != VIR_STORAGE_POOL_NETFS) {
+            virReportError(VIR_ERR_NO_SUPPORT, "%s",
+                           _("clone feature may only be used for 'fs', 'netfs' and 'dir' pools"));
+            return -1;
+        }
+        if ((val = virStoragePoolCloneModeTypeFromString(clone)) <= 0) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("invalid storage pool clone mode '%s'"),
+                           clone);
+            return -1;
+        }
+        def->features.cloneMode = val;
+    }
+
     return 0;
 }
 
@@ -1124,7 +1148,8 @@ static void
 virStoragePoolDefFormatFeatures(virBuffer *buf,
                                 virStoragePoolDef *def)
 {
-    if (def->features.cow == VIR_TRISTATE_BOOL_ABSENT)
+    if (def->features.cow == VIR_TRISTATE_BOOL_ABSENT &&
+        def->features.cloneMode == VIR_STORAGE_POOL_CLONE_MODE_DEFAULT)
         return;
 
     virBufferAddLit(buf, "<features>\n");
@@ -1132,6 +1157,9 @@ virStoragePoolDefFormatFeatures(virBuffer *buf,
     if (def->features.cow != VIR_TRISTATE_BOOL_ABSENT)
         virBufferAsprintf(buf, "<cow state='%s'/>\n",
                           virTristateBoolTypeToString(def->features.cow));
+    if (def->features.cloneMode != VIR_STORAGE_POOL_CLONE_MODE_DEFAULT)
+        virBufferAsprintf(buf, "<clone mode='%s'/>\n",
+                          virStoragePoolCloneModeTypeToString(def->features.cloneMode));
     virBufferAdjustIndent(buf, -2);
     virBufferAddLit(buf, "</features>\n");
 }
@@ -75,6 +75,19 @@ typedef enum {
 VIR_ENUM_DECL(virStorageVolDefRefreshAllocation);
 
 typedef struct _virStorageVolDef virStorageVolDef;
+
+/* Identity of the file a volume was probed from, a refresh of the pool can
+ * reuse the volume as long as the file still matches it */
+typedef struct _virStorageVolFileID virStorageVolFileID;
+struct _virStorageVolFileID {
+    bool valid;
+    unsigned long long dev;
+    unsigned long long ino;
+    unsigned long long size;
+    long long mtime;
+    long long ctime;
+};
+
 struct _virStorageVolDef {
     char *name;
     char *key;
@@ -85,6 +98,8 @@ struct _virStorageVolDef {
 
     virStorageVolSource source;
     virStorageSource target;
+
+    virStorageVolFileID fileID;
 };
 
 typedef struct _virStorageVolDefList virStorageVolDefList;
@@ -173,9 +188,22 @@ struct _virStoragePoolSourceDevice {
     } geometry;
 };
 
+typedef enum {
+    VIR_STORAGE_POOL_CLONE_MODE_DEFAULT = 0,
+    VIR_STORAGE_POOL_CLONE_MODE_FULL,    /* copy all data */
+    VIR_STORAGE_POOL_CLONE_MODE_REFLINK, /* share extents of the source */
+    VIR_STORAGE_POOL_CLONE_MODE_AUTO,    /* reflink if possible, else copy */
+    VIR_STORAGE_POOL_CLONE_MODE_OVERLAY, /* qcow2 overlay of the source */
+
+    VIR_STORAGE_POOL_CLONE_MODE_LAST
+} virStoragePoolCloneMode;
+
+VIR_ENUM_DECL(virStoragePoolCloneMode);
+
 typedef struct _virStoragePoolFeatures virStoragePoolFeatures;
 struct _virStoragePoolFeatures {
     virTristateBool cow;
+    virStoragePoolCloneMode cloneMode;
 };
 
 
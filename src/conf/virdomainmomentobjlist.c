@@ -68,47 +68,40 @@ virDomainMomentForEachChild(virDomainMomentObj *moment,
     return moment->nchildren;
 }
 
-struct moment_act_on_descendant {
-    int number;
-    virHashIterator iter;
-    void *data;
-};
-
-static int
-virDomainMomentActOnDescendant(void *payload,
-                               const char *name,
-                               void *data)
-{
-    virDomainMomentObj *obj = payload;
-    struct moment_act_on_descendant *curr = data;
-    virDomainMomentObj tmp = *obj;
-
-    /* Careful: curr->iter can delete obj, hence the need for tmp */
-    (curr->iter)(payload, name, curr->data);
-    curr->number += 1 + virDomainMomentForEachDescendant(&tmp,
-                                                         curr->iter,
-                                                         curr->data);
-    return 0;
-}
-
 /* Run iter(data) on all descendants of moment, while ignoring all
  * other entries in moments.  Return the number of descendants
  * visited.  The visit is guaranteed to be topological, but no
- * particular order between siblings is guaranteed.  */
+ * particular order between siblings is guaranteed.  The tree is
+ * walked without recursion so that deep hierarchies don't exhaust
+ * the stack; only the pending siblings of the ancestors of the
+ * visited moment are remembered.  */
 int
 virDomainMomentForEachDescendant(virDomainMomentObj *moment,
                                  virHashIterator iter,
                                  void *data)
 {
-    struct moment_act_on_descendant act;
+    g_autoptr(GPtrArray) pending = g_ptr_array_new();
+    virDomainMomentObj *next = moment->first_child;
+    int number = 0;
+
+    while (next || pending->len > 0) {
+        virDomainMomentObj *obj;
 
-    act.number = 0;
-    act.iter = iter;
-    act.data = data;
-    virDomainMomentForEachChild(moment,
-                                virDomainMomentActOnDescendant, &act);
+        if (!next)
+            next = g_ptr_array_remove_index(pending, pending->len - 1);
 
-    return act.number;
+        obj = next;
+
+        /* Careful: iter can delete obj, hence look at its relations first */
+        next = obj->first_child;
+        if (obj->sibling)
+            g_ptr_array_add(pending, obj->sibling);
+
+        (iter)(obj, obj->def->name, data);
+        number++;
+    }
+
+    return number;
 }
 
 
@@ -119,23 +112,19 @@ virDomainMomentForEachDescendant(virDomainMomentObj *moment,
 void
 virDomainMomentDropParent(virDomainMomentObj *moment)
 {
-    virDomainMomentObj *prev = NULL;
-    virDomainMomentObj *curr = NULL;
+    if (!moment->prev_sibling && moment->parent->first_child != moment) {
+        VIR_WARN("inconsistent moment relations");
+        return;
+    }
 
     moment->parent->nchildren--;
-    curr = moment->parent->first_child;
-    while (curr != moment) {
-        if (!curr) {
-            VIR_WARN("inconsistent moment relations");
-            return;
-        }
-        prev = curr;
-        curr = curr->sibling;
-    }
-    if (prev)
-        prev->sibling = g_steal_pointer(&moment->sibling);
+    if (moment->sibling)
+        moment->sibling->prev_sibling = moment->prev_sibling;
+    if (moment->prev_sibling)
+        moment->prev_sibling->sibling = g_steal_pointer(&moment->sibling);
     else
         moment->parent->first_child = g_steal_pointer(&moment->sibling);
+    moment->prev_sibling = NULL;
     moment->parent = NULL;
 }
 
@@ -157,6 +146,9 @@ virDomainMomentSetParent(virDomainMomentObj *moment,
     moment->parent = parent;
     parent->nchildren++;
     moment->sibling = parent->first_child;
+    moment->prev_sibling = NULL;
+    if (parent->first_child)
+        parent->first_child->prev_sibling = moment;
     parent->first_child = moment;
 }
 
@@ -195,6 +187,8 @@ virDomainMomentMoveChildren(virDomainMomentObj *from,
         child->parent = to;
         if (!child->sibling) {
             child->sibling = to->first_child;
+            if (to->first_child)
+                to->first_child->prev_sibling = child;
             break;
         }
         child = child->sibling;
@@ -560,6 +554,11 @@ virDomainMomentCheckCycles(virDomainMomentObjList *list,
                            def->parent_name, def->name);
             return -1;
         }
+        /* A moment which isn't in the list yet can't be the ancestor of
+         * any other one, so walking the chain of parents, which is as
+         * long as the tree is deep, is needed only when redefining. */
+        if (!virDomainMomentFindByName(list, def->name))
+            return 0;
         while (other->def->parent_name) {
             if (STREQ(other->def->parent_name, def->name)) {
                 virReportError(VIR_ERR_INVALID_ARG,
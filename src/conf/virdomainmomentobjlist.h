@@ -36,7 +36,8 @@ typedef bool (*virDomainMomentObjListFilter)(virDomainMomentObj *obj,
  * (for quick lookup by name) and a metaroot (which is the parent of
  * all user-visible roots), so that all other objects always have a
  * valid parent object; the tree structure is currently maintained via
- * a linked list. */
+ * a doubly linked list of siblings, so that a moment can be unlinked
+ * from its parent without walking all of its siblings. */
 struct _virDomainMomentObj {
     /* Public field */
     virDomainMomentDef *def; /* non-NULL except for metaroot */
@@ -46,6 +47,7 @@ struct _virDomainMomentObj {
                                      virDomainMomentUpdateRelations, or
                                      after virDomainMomentDropParent */
     virDomainMomentObj *sibling; /* NULL if last child of parent */
+    virDomainMomentObj *prev_sibling; /* NULL if first child of parent */
     size_t nchildren;
     virDomainMomentObj *first_child; /* NULL if no children */
 };
@@ -29,8 +29,10 @@
 #include "snapshot_conf.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhostcpu.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virthreadpool.h"
 #include "virdomainsnapshotobjlist.h"
 #include "virdomaincheckpointobjlist.h"
 
@@ -39,7 +41,25 @@
 VIR_LOG_INIT("conf.virdomainobjlist");
 
 static virClass *virDomainObjListClass;
+static virClass *virDomainObjListSnapshotClass;
 static void virDomainObjListDispose(void *obj);
+static void virDomainObjListSnapshotDispose(void *obj);
+
+
+/*
+ * An immutable array of all domains on the list, shared by readers
+ * which need to walk the whole list. It is built on demand and
+ * dropped whenever a domain is added or removed, so that listing
+ * domains doesn't need to hold the list lock while iterating over
+ * the hash table and referencing every domain.
+ */
+typedef struct _virDomainObjListSnapshot virDomainObjListSnapshot;
+struct _virDomainObjListSnapshot {
+    virObject parent;
+
+    size_t nvms;
+    virDomainObj **vms;
+};
 
 
 struct _virDomainObjList {
@@ -52,6 +72,19 @@ struct _virDomainObjList {
     /* name -> virDomainObj mapping for O(1),
      * lockless lookup-by-name */
     GHashTable *objsName;
+
+    /* ID -> virDomainObj mapping for lookup-by-ID. IDs are assigned
+     * and cleared by drivers without the list being involved, so this
+     * is merely a cache which is validated on each use and filled in
+     * on a miss. Protected by @objsIDLock as it's modified while
+     * holding the list lock just for reading. */
+    GHashTable *objsID;
+    virMutex objsIDLock;
+
+    /* Current snapshot of all domains, protected by @snapshotLock.
+     * Replaced only while holding the list lock for writing. */
+    virDomainObjListSnapshot *snapshot;
+    virMutex snapshotLock;
 };
 
 
@@ -60,6 +93,9 @@ static int virDomainObjListOnceInit(void)
     if (!VIR_CLASS_NEW(virDomainObjList, virClassForObjectRWLockable()))
         return -1;
 
+    if (!VIR_CLASS_NEW(virDomainObjListSnapshot, virClassForObject()))
+        return -1;
+
     return 0;
 }
 
@@ -75,8 +111,23 @@ virDomainObjList *virDomainObjListNew(void)
     if (!(doms = virObjectRWLockableNew(virDomainObjListClass)))
         return NULL;
 
+    if (virMutexInit(&doms->objsIDLock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        virObjectUnref(doms);
+        return NULL;
+    }
+
+    if (virMutexInit(&doms->snapshotLock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        virMutexDestroy(&doms->objsIDLock);
+        virObjectUnref(doms);
+        return NULL;
+    }
+
     doms->objs = virHashNew(virObjectFreeHashData);
     doms->objsName = virHashNew(virObjectFreeHashData);
+    doms->objsID = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, virObjectFreeHashData);
     return doms;
 }
 
@@ -85,8 +136,80 @@ static void virDomainObjListDispose(void *obj)
 {
     virDomainObjList *doms = obj;
 
+    virObjectUnref(doms->snapshot);
     virHashFree(doms->objs);
     virHashFree(doms->objsName);
+    if (doms->objsID) {
+        g_hash_table_unref(doms->objsID);
+        virMutexDestroy(&doms->objsIDLock);
+        virMutexDestroy(&doms->snapshotLock);
+    }
+}
+
+
+static void virDomainObjListSnapshotDispose(void *obj)
+{
+    virDomainObjListSnapshot *snap = obj;
+    size_t i;
+
+    for (i = 0; i < snap->nvms; i++)
+        virObjectUnref(snap->vms[i]);
+    g_free(snap->vms);
+}
+
+
+static int
+virDomainObjListSnapshotIterator(void *payload,
+                                 const char *name G_GNUC_UNUSED,
+                                 void *opaque)
+{
+    virDomainObjListSnapshot *snap = opaque;
+
+    snap->vms[snap->nvms++] = virObjectRef(payload);
+    return 0;
+}
+
+
+/*
+ * Returns a ref counted snapshot of all domains on @doms. If there is
+ * a current snapshot, no list lock is needed at all, otherwise a new
+ * one is built with the list locked for reading.
+ */
+static virDomainObjListSnapshot *
+virDomainObjListGetSnapshot(virDomainObjList *doms)
+{
+    virDomainObjListSnapshot *snap;
+
+    virMutexLock(&doms->snapshotLock);
+    snap = virObjectRef(doms->snapshot);
+    virMutexUnlock(&doms->snapshotLock);
+
+    if (snap)
+        return snap;
+
+    virObjectRWLockRead(doms);
+    virMutexLock(&doms->snapshotLock);
+    if (!doms->snapshot &&
+        (doms->snapshot = virObjectNew(virDomainObjListSnapshotClass))) {
+        doms->snapshot->vms = g_new0(virDomainObj *, virHashSize(doms->objs));
+        virHashForEach(doms->objs, virDomainObjListSnapshotIterator,
+                       doms->snapshot);
+    }
+    snap = virObjectRef(doms->snapshot);
+    virMutexUnlock(&doms->snapshotLock);
+    virObjectRWUnlock(doms);
+
+    return snap;
+}
+
+
+/* The caller must hold lock on @doms for writing */
+static void
+virDomainObjListInvalidateSnapshot(virDomainObjList *doms)
+{
+    virMutexLock(&doms->snapshotLock);
+    g_clear_pointer(&doms->snapshot, virObjectUnref);
+    virMutexUnlock(&doms->snapshotLock);
 }
 
 
@@ -107,6 +230,40 @@ static int virDomainObjListSearchID(const void *payload,
 }
 
 
+/*
+ * Looks up @id in the doms->objsID cache and returns a ref counted (but
+ * unlocked) domain object if the cached entry is still valid. A stale
+ * entry is dropped. The caller must hold a lock on @doms.
+ */
+static virDomainObj *
+virDomainObjListFindByIDCached(virDomainObjList *doms,
+                               int id)
+{
+    virDomainObj *obj;
+    bool valid;
+
+    virMutexLock(&doms->objsIDLock);
+    obj = virObjectRef(g_hash_table_lookup(doms->objsID, GINT_TO_POINTER(id)));
+    virMutexUnlock(&doms->objsIDLock);
+
+    if (!obj)
+        return NULL;
+
+    valid = virDomainObjListSearchID(obj, NULL, &id) == 1;
+
+    if (!valid) {
+        virMutexLock(&doms->objsIDLock);
+        if (g_hash_table_lookup(doms->objsID, GINT_TO_POINTER(id)) == obj)
+            g_hash_table_remove(doms->objsID, GINT_TO_POINTER(id));
+        virMutexUnlock(&doms->objsIDLock);
+        virObjectUnref(obj);
+        obj = NULL;
+    }
+
+    return obj;
+}
+
+
 virDomainObj *
 virDomainObjListFindByID(virDomainObjList *doms,
                          int id)
@@ -114,8 +271,17 @@ virDomainObjListFindByID(virDomainObjList *doms,
     virDomainObj *obj;
 
     virObjectRWLockRead(doms);
-    obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
-    virObjectRef(obj);
+    if (!(obj = virDomainObjListFindByIDCached(doms, id))) {
+        obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
+        virObjectRef(obj);
+
+        if (obj) {
+            virMutexLock(&doms->objsIDLock);
+            g_hash_table_replace(doms->objsID, GINT_TO_POINTER(id),
+                                 virObjectRef(obj));
+            virMutexUnlock(&doms->objsIDLock);
+        }
+    }
     virObjectRWUnlock(doms);
     if (obj) {
         virObjectLock(obj);
@@ -242,6 +408,8 @@ virDomainObjListAddObjLocked(virDomainObjList *doms,
     }
     virObjectRef(vm);
 
+    virDomainObjListInvalidateSnapshot(doms);
+
     return 0;
 }
 
@@ -354,6 +522,15 @@ virDomainObjListAdd(virDomainObjList *doms,
 }
 
 
+static gboolean
+virDomainObjListRemoveIDHelper(gpointer key G_GNUC_UNUSED,
+                               gpointer value,
+                               gpointer opaque)
+{
+    return value == opaque;
+}
+
+
 /* The caller must hold lock on 'doms' in addition to 'virDomainObjListRemove'
  * requirements
  *
@@ -370,6 +547,13 @@ virDomainObjListRemoveLocked(virDomainObjList *doms,
 
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
+
+    virDomainObjListInvalidateSnapshot(doms);
+
+    virMutexLock(&doms->objsIDLock);
+    g_hash_table_foreach_remove(doms->objsID,
+                                virDomainObjListRemoveIDHelper, dom);
+    virMutexUnlock(&doms->objsIDLock);
 }
 
 
@@ -469,101 +653,266 @@ virDomainObjListRename(virDomainObjList *doms,
 }
 
 
+/*
+ * Parsing domain XMLs is by far the most expensive part of loading
+ * domains and each file can be parsed independently. Therefore the
+ * files are parsed on a pool of worker threads and only adding the
+ * results into the list is done sequentially, in the order in which
+ * the files were read from the directory.
+ */
+#define VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS_MAX 16
+
+typedef struct _virDomainObjListLoadCtx virDomainObjListLoadCtx;
+struct _virDomainObjListLoadCtx {
+    const char *configDir;
+    const char *autostartDir;
+    bool liveStatus;
+    virDomainXMLOption *xmlopt;
+
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+typedef struct _virDomainObjListLoadEntry virDomainObjListLoadEntry;
+struct _virDomainObjListLoadEntry {
+    char *name;
+    virDomainDef *def;      /* parsed persistent config */
+    int autostart;
+    virDomainObj *obj;      /* parsed live status */
+};
+
+
+static void
+virDomainObjListLoadEntryFree(virDomainObjListLoadEntry *entry)
+{
+    if (!entry)
+        return;
+
+    g_free(entry->name);
+    virDomainDefFree(entry->def);
+    virObjectUnref(entry->obj);
+    g_free(entry);
+}
+
+
+static int
+virDomainObjListLoadConfigParse(virDomainObjListLoadCtx *ctx,
+                                virDomainObjListLoadEntry *entry)
+{
+    g_autofree char *configFile = NULL;
+    g_autofree char *autostartLink = NULL;
+
+    if ((configFile = virDomainConfigFile(ctx->configDir, entry->name)) == NULL)
+        return -1;
+    if (!(entry->def = virDomainDefParseFile(configFile, ctx->xmlopt, NULL,
+                                             VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                             VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                             VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
+        return -1;
+
+    if ((autostartLink = virDomainConfigFile(ctx->autostartDir, entry->name)) == NULL)
+        return -1;
+
+    if ((entry->autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virDomainObjListLoadStatusParse(virDomainObjListLoadCtx *ctx,
+                                virDomainObjListLoadEntry *entry)
+{
+    g_autofree char *statusFile = NULL;
+
+    if ((statusFile = virDomainConfigFile(ctx->configDir, entry->name)) == NULL)
+        return -1;
+
+    if (!(entry->obj = virDomainObjParseFile(statusFile, ctx->xmlopt,
+                                             VIR_DOMAIN_DEF_PARSE_STATUS |
+                                             VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
+                                             VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
+                                             VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                             VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
+        return -1;
+
+    /* virDomainObjParseFile returns a locked object, but the parsed
+     * objects are handed over between threads before being added */
+    virObjectUnlock(entry->obj);
+
+    return 0;
+}
+
+
+static void
+virDomainObjListLoadParse(virDomainObjListLoadCtx *ctx,
+                          virDomainObjListLoadEntry *entry)
+{
+    VIR_INFO("Loading config file '%s.xml'", entry->name);
+
+    /* NB: errors are reported once the entry is being added */
+    if (ctx->liveStatus)
+        ignore_value(virDomainObjListLoadStatusParse(ctx, entry));
+    else
+        ignore_value(virDomainObjListLoadConfigParse(ctx, entry));
+}
+
+
+static void
+virDomainObjListLoadWorker(void *jobdata,
+                           void *opaque)
+{
+    virDomainObjListLoadEntry *entry = jobdata;
+    virDomainObjListLoadCtx *ctx = opaque;
+
+    virDomainObjListLoadParse(ctx, entry);
+
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/*
+ * Parses all @entries, using a pool of worker threads if there's
+ * enough of them to make it worthwhile.
+ */
+static void
+virDomainObjListLoadParseAll(virDomainObjListLoadCtx *ctx,
+                             GPtrArray *entries)
+{
+    virThreadPool *pool = NULL;
+    int nworkers;
+    size_t i;
+
+    if ((nworkers = virHostCPUGetCount()) < 0) {
+        virResetLastError();
+        nworkers = 1;
+    }
+    nworkers = MIN(nworkers, VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS_MAX);
+    nworkers = MIN(nworkers, entries->len);
+
+    if (nworkers > 1 &&
+        virMutexInit(&ctx->lock) == 0) {
+        if (virCondInit(&ctx->cond) == 0) {
+            pool = virThreadPoolNewFull(0, nworkers, 0,
+                                        virDomainObjListLoadWorker,
+                                        "domain-load", NULL, ctx);
+            if (!pool)
+                virCondDestroy(&ctx->cond);
+        }
+        if (!pool)
+            virMutexDestroy(&ctx->lock);
+    }
+
+    if (!pool) {
+        /* Fall back to parsing in this thread */
+        virResetLastError();
+        for (i = 0; i < entries->len; i++)
+            virDomainObjListLoadParse(ctx, g_ptr_array_index(entries, i));
+        return;
+    }
+
+    VIR_DEBUG("Parsing %u configs using %d workers", entries->len, nworkers);
+
+    for (i = 0; i < entries->len; i++) {
+        virDomainObjListLoadEntry *entry = g_ptr_array_index(entries, i);
+
+        virMutexLock(&ctx->lock);
+        ctx->pending++;
+        virMutexUnlock(&ctx->lock);
+
+        if (virThreadPoolSendJob(pool, 0, entry) < 0) {
+            virMutexLock(&ctx->lock);
+            ctx->pending--;
+            virMutexUnlock(&ctx->lock);
+
+            virResetLastError();
+            virDomainObjListLoadParse(ctx, entry);
+        }
+    }
+
+    virMutexLock(&ctx->lock);
+    while (ctx->pending > 0) {
+        /* Freeing the pool below waits for running workers anyway,
+         * entries which were not parsed yet are just reported as
+         * failed to load */
+        if (virCondWait(&ctx->cond, &ctx->lock) < 0) {
+            VIR_WARN("Failed to wait for configs to be parsed");
+            break;
+        }
+    }
+    virMutexUnlock(&ctx->lock);
+
+    virThreadPoolFree(pool);
+    virCondDestroy(&ctx->cond);
+    virMutexDestroy(&ctx->lock);
+}
+
+
 static virDomainObj *
 virDomainObjListLoadConfig(virDomainObjList *doms,
                            virDomainXMLOption *xmlopt,
-                           const char *configDir,
-                           const char *autostartDir,
-                           const char *name,
+                           virDomainObjListLoadEntry *entry,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    char *configFile = NULL, *autostartLink = NULL;
-    virDomainDef *def = NULL;
     virDomainObj *dom;
-    int autostart;
     virDomainDef *oldDef = NULL;
 
-    if ((configFile = virDomainConfigFile(configDir, name)) == NULL)
-        goto error;
-    if (!(def = virDomainDefParseFile(configFile, xmlopt, NULL,
-                                      VIR_DOMAIN_DEF_PARSE_INACTIVE |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
-
-    if ((autostartLink = virDomainConfigFile(autostartDir, name)) == NULL)
-        goto error;
-
-    if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
-        goto error;
+    if (!entry->def)
+        return NULL;
 
-    if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef)))
-        goto error;
+    if (!(dom = virDomainObjListAddLocked(doms, entry->def, xmlopt, 0, &oldDef)))
+        return NULL;
+    entry->def = NULL;
 
-    dom->autostart = autostart;
+    dom->autostart = entry->autostart;
 
     if (notify)
         (*notify)(dom, oldDef == NULL, opaque);
 
     virDomainDefFree(oldDef);
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
     return dom;
-
- error:
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
-    virDomainDefFree(def);
-    return NULL;
 }
 
 
 static virDomainObj *
 virDomainObjListLoadStatus(virDomainObjList *doms,
-                           const char *statusDir,
-                           const char *name,
-                           virDomainXMLOption *xmlopt,
+                           virDomainObjListLoadEntry *entry,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    char *statusFile = NULL;
     virDomainObj *obj = NULL;
     char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    if ((statusFile = virDomainConfigFile(statusDir, name)) == NULL)
-        goto error;
-
-    if (!(obj = virDomainObjParseFile(statusFile, xmlopt,
-                                      VIR_DOMAIN_DEF_PARSE_STATUS |
-                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
-                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
+    if (!entry->obj)
+        return NULL;
 
-    virUUIDFormat(obj->def->uuid, uuidstr);
+    virUUIDFormat(entry->obj->def->uuid, uuidstr);
 
     if (virHashLookup(doms->objs, uuidstr) != NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("unexpected domain %s already exists"),
-                       obj->def->name);
-        goto error;
+                       entry->obj->def->name);
+        return NULL;
     }
 
-    if (virDomainObjListAddObjLocked(doms, obj) < 0)
-        goto error;
+    obj = g_steal_pointer(&entry->obj);
+    virObjectLock(obj);
+
+    if (virDomainObjListAddObjLocked(doms, obj) < 0) {
+        virDomainObjEndAPI(&obj);
+        return NULL;
+    }
 
     if (notify)
         (*notify)(obj, 1, opaque);
 
-    VIR_FREE(statusFile);
     return obj;
-
- error:
-    virDomainObjEndAPI(&obj);
-    VIR_FREE(statusFile);
-    return NULL;
 }
 
 
@@ -577,7 +926,15 @@ virDomainObjListLoadAllConfigs(virDomainObjList *doms,
                                void *opaque)
 {
     g_autoptr(DIR) dir = NULL;
+    g_autoptr(GPtrArray) entries = NULL;
+    virDomainObjListLoadCtx ctx = {
+        .configDir = configDir,
+        .autostartDir = autostartDir,
+        .liveStatus = liveStatus,
+        .xmlopt = xmlopt,
+    };
     struct dirent *entry;
+    size_t i;
     int ret = -1;
     int rc;
 
@@ -586,38 +943,40 @@ virDomainObjListLoadAllConfigs(virDomainObjList *doms,
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
-    virObjectRWLockWrite(doms);
+    entries = g_ptr_array_new_with_free_func((GDestroyNotify) virDomainObjListLoadEntryFree);
 
     while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
-        virDomainObj *dom;
+        virDomainObjListLoadEntry *loadEntry;
 
         if (!virStringStripSuffix(entry->d_name, ".xml"))
             continue;
 
+        loadEntry = g_new0(virDomainObjListLoadEntry, 1);
+        loadEntry->name = g_strdup(entry->d_name);
+        g_ptr_array_add(entries, loadEntry);
+    }
+
+    virDomainObjListLoadParseAll(&ctx, entries);
+
+    virObjectRWLockWrite(doms);
+
+    for (i = 0; i < entries->len; i++) {
+        virDomainObjListLoadEntry *loadEntry = g_ptr_array_index(entries, i);
+        virDomainObj *dom;
+
         /* NB: ignoring errors, so one malformed config doesn't
            kill the whole process */
-        VIR_INFO("Loading config file '%s.xml'", entry->d_name);
         if (liveStatus)
-            dom = virDomainObjListLoadStatus(doms,
-                                             configDir,
-                                             entry->d_name,
-                                             xmlopt,
-                                             notify,
-                                             opaque);
+            dom = virDomainObjListLoadStatus(doms, loadEntry, notify, opaque);
         else
-            dom = virDomainObjListLoadConfig(doms,
-                                             xmlopt,
-                                             configDir,
-                                             autostartDir,
-                                             entry->d_name,
-                                             notify,
-                                             opaque);
+            dom = virDomainObjListLoadConfig(doms, xmlopt, loadEntry,
+                                             notify, opaque);
         if (dom) {
             if (!liveStatus)
                 dom->persistent = 1;
             virDomainObjEndAPI(&dom);
         } else {
-            VIR_ERROR(_("Failed to load config for domain '%s'"), entry->d_name);
+            VIR_ERROR(_("Failed to load config for domain '%s'"), loadEntry->name);
         }
     }
 
@@ -665,9 +1024,16 @@ virDomainObjListNumOfDomains(virDomainObjList *doms,
                              virConnectPtr conn)
 {
     struct virDomainObjListData data = { filter, conn, active, 0 };
-    virObjectRWLockRead(doms);
-    virHashForEach(doms->objs, virDomainObjListCount, &data);
-    virObjectRWUnlock(doms);
+    virDomainObjListSnapshot *snap;
+    size_t i;
+
+    if (!(snap = virDomainObjListGetSnapshot(doms)))
+        return -1;
+
+    for (i = 0; i < snap->nvms; i++)
+        virDomainObjListCount(snap->vms[i], NULL, &data);
+
+    virObjectUnref(snap);
     return data.count;
 }
 
@@ -709,9 +1075,16 @@ virDomainObjListGetActiveIDs(virDomainObjList *doms,
 {
     struct virDomainIDData data = { filter, conn,
                                     0, maxids, ids };
-    virObjectRWLockRead(doms);
-    virHashForEach(doms->objs, virDomainObjListCopyActiveIDs, &data);
-    virObjectRWUnlock(doms);
+    virDomainObjListSnapshot *snap;
+    size_t i;
+
+    if (!(snap = virDomainObjListGetSnapshot(doms)))
+        return -1;
+
+    for (i = 0; i < snap->nvms; i++)
+        virDomainObjListCopyActiveIDs(snap->vms[i], NULL, &data);
+
+    virObjectUnref(snap);
     return data.numids;
 }
 
@@ -761,10 +1134,16 @@ virDomainObjListGetInactiveNames(virDomainObjList *doms,
 {
     struct virDomainNameData data = { filter, conn,
                                       0, 0, maxnames, names };
+    virDomainObjListSnapshot *snap;
     size_t i;
-    virObjectRWLockRead(doms);
-    virHashForEach(doms->objs, virDomainObjListCopyInactiveNames, &data);
-    virObjectRWUnlock(doms);
+
+    if (!(snap = virDomainObjListGetSnapshot(doms)))
+        return -1;
+
+    for (i = 0; i < snap->nvms; i++)
+        virDomainObjListCopyInactiveNames(snap->vms[i], NULL, &data);
+
+    virObjectUnref(snap);
     if (data.oom) {
         for (i = 0; i < data.numnames; i++)
             VIR_FREE(data.names[i]);
@@ -904,34 +1283,25 @@ virDomainObjMatchFilter(virDomainObj *vm,
 #undef MATCH
 
 
-struct virDomainListData {
-    virDomainObj **vms;
-    size_t nvms;
-};
-
-
-static int
-virDomainObjListCollectIterator(void *payload,
-                                const char *name G_GNUC_UNUSED,
-                                void *opaque)
-{
-    struct virDomainListData *data = opaque;
-
-    data->vms[data->nvms++] = virObjectRef(payload);
-    return 0;
-}
-
-
+/*
+ * If @borrowed is true, @list does not hold references on the domains,
+ * which are kept alive by the caller, and the ones filtered out are just
+ * dropped from @list.
+ */
 static void
 virDomainObjListFilter(virDomainObj ***list,
                        size_t *nvms,
                        virConnectPtr conn,
                        virDomainObjListACLFilter filter,
-                       unsigned int flags)
+                       unsigned int flags,
+                       bool borrowed)
 {
-    size_t i = 0;
+    size_t i;
+    size_t n = 0;
 
-    while (i < *nvms) {
+    /* Compact the list in place rather than deleting elements one by
+     * one, which would make filtering quadratic in number of domains */
+    for (i = 0; i < *nvms; i++) {
         virDomainObj *vm = (*list)[i];
 
         virObjectLock(vm);
@@ -944,14 +1314,54 @@ virDomainObjListFilter(virDomainObj ***list,
         if (vm->removing ||
             (filter && !filter(conn, vm->def)) ||
             !virDomainObjMatchFilter(vm, flags)) {
-            virDomainObjEndAPI(&vm);
-            VIR_DELETE_ELEMENT(*list, i, *nvms);
+            if (borrowed)
+                virObjectUnlock(vm);
+            else
+                virDomainObjEndAPI(&vm);
             continue;
         }
 
         virObjectUnlock(vm);
-        i++;
+        (*list)[n++] = vm;
     }
+
+    if (n == 0)
+        g_clear_pointer(list, g_free);
+    *nvms = n;
+}
+
+
+/*
+ * Like virDomainObjListCollect, except that the domains in @vms are
+ * borrowed from the returned snapshot rather than referenced, and thus
+ * stay valid only until the snapshot is released. For read-only scoped
+ * access this avoids taking and dropping a reference on every domain.
+ */
+static virDomainObjListSnapshot *
+virDomainObjListCollectBorrowed(virDomainObjList *domlist,
+                                virConnectPtr conn,
+                                virDomainObj ***vms,
+                                size_t *nvms,
+                                virDomainObjListACLFilter filter,
+                                unsigned int flags)
+{
+    virDomainObjListSnapshot *snap;
+    virDomainObj **list;
+    size_t nlist;
+
+    if (!(snap = virDomainObjListGetSnapshot(domlist)))
+        return NULL;
+
+    list = g_new0(virDomainObj *, snap->nvms);
+    memcpy(list, snap->vms, snap->nvms * sizeof(*list));
+    nlist = snap->nvms;
+
+    virDomainObjListFilter(&list, &nlist, conn, filter, flags, true);
+
+    *nvms = nlist;
+    *vms = list;
+
+    return snap;
 }
 
 
@@ -963,18 +1373,17 @@ virDomainObjListCollect(virDomainObjList *domlist,
                         virDomainObjListACLFilter filter,
                         unsigned int flags)
 {
-    struct virDomainListData data = { NULL, 0 };
-
-    virObjectRWLockRead(domlist);
-    data.vms = g_new0(virDomainObj *, virHashSize(domlist->objs));
-
-    virHashForEach(domlist->objs, virDomainObjListCollectIterator, &data);
-    virObjectRWUnlock(domlist);
+    virDomainObjListSnapshot *snap;
+    size_t i;
 
-    virDomainObjListFilter(&data.vms, &data.nvms, conn, filter, flags);
+    if (!(snap = virDomainObjListCollectBorrowed(domlist, conn, vms, nvms,
+                                                 filter, flags)))
+        return -1;
 
-    *nvms = data.nvms;
-    *vms = data.vms;
+    /* Only reference the domains which passed the filter */
+    for (i = 0; i < *nvms; i++)
+        virObjectRef((*vms)[i]);
+    virObjectUnref(snap);
 
     return 0;
 }
@@ -1021,7 +1430,7 @@ virDomainObjListConvert(virDomainObjList *domlist,
     }
     virObjectRWUnlock(domlist);
 
-    virDomainObjListFilter(vms, nvms, conn, filter, flags);
+    virDomainObjListFilter(vms, nvms, conn, filter, flags, false);
 
     return 0;
 
@@ -1044,10 +1453,12 @@ virDomainObjListExport(virDomainObjList *domlist,
     virDomainObj **vms = NULL;
     virDomainPtr *doms = NULL;
     size_t nvms = 0;
+    virDomainObjListSnapshot *snap;
     size_t i;
     int ret = -1;
 
-    if (virDomainObjListCollect(domlist, conn, &vms, &nvms, filter, flags) < 0)
+    if (!(snap = virDomainObjListCollectBorrowed(domlist, conn, &vms, &nvms,
+                                                 filter, flags)))
         return -1;
 
     if (domains) {
@@ -1071,6 +1482,7 @@ virDomainObjListExport(virDomainObjList *domlist,
 
  cleanup:
     virObjectListFree(doms);
-    virObjectListFreeCount(vms, nvms);
+    g_free(vms);
+    virObjectUnref(snap);
     return ret;
 }
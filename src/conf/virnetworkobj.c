@@ -52,6 +52,7 @@ struct _virNetworkObj {
     virNetworkDef *newDef; /* New definition to activate at shutdown */
 
     virBitmap *classIdMap; /* bitmap of class IDs for QoS */
+    size_t classIdHint; /* all class IDs below this one are taken */
     unsigned long long floor_sum; /* sum of all 'floor'-s of attached NICs */
 
     unsigned int taint;
@@ -233,6 +234,51 @@ virNetworkObjGetClassIdMap(virNetworkObj *obj)
 }
 
 
+/**
+ * virNetworkObjAllocClassId:
+ * @obj: network object
+ *
+ * Find the lowest free QoS class ID of @obj and mark it as used.
+ * The search starts at the lowest ID that may be free, so IDs are
+ * handed out without rescanning the taken ones.
+ *
+ * Returns the class ID or -1 if none is available.
+ */
+ssize_t
+virNetworkObjAllocClassId(virNetworkObj *obj)
+{
+    ssize_t id;
+
+    if ((id = virBitmapNextClearBit(obj->classIdMap,
+                                    (ssize_t) obj->classIdHint - 1)) < 0)
+        id = virBitmapSize(obj->classIdMap);
+
+    if (virBitmapSetBitExpand(obj->classIdMap, id) < 0)
+        return -1;
+
+    obj->classIdHint = id + 1;
+    return id;
+}
+
+
+/**
+ * virNetworkObjReleaseClassId:
+ * @obj: network object
+ * @id: class ID
+ *
+ * Mark QoS class ID @id of @obj as free again.
+ */
+void
+virNetworkObjReleaseClassId(virNetworkObj *obj,
+                            size_t id)
+{
+    ignore_value(virBitmapClearBit(obj->classIdMap, id));
+
+    if (id < obj->classIdHint)
+        obj->classIdHint = id;
+}
+
+
 virMacMap *
 virNetworkObjGetMacMap(virNetworkObj *obj)
 {
@@ -279,6 +325,7 @@ virNetworkObjMacMgrAdd(virNetworkObj *obj,
 {
     char macStr[VIR_MAC_STRING_BUFLEN];
     char *file = NULL;
+    int rc;
     int ret = -1;
 
     if (!obj->macmap)
@@ -289,10 +336,12 @@ virNetworkObjMacMgrAdd(virNetworkObj *obj,
     if (!(file = virMacMapFileName(dnsmasqStateDir, obj->def->bridge)))
         goto cleanup;
 
-    if (virMacMapAdd(obj->macmap, domain, macStr) < 0)
+    if ((rc = virMacMapAdd(obj->macmap, domain, macStr)) < 0)
         goto cleanup;
 
-    if (virMacMapWriteFile(obj->macmap, file) < 0)
+    /* No need to rewrite the file if nothing changed */
+    if (rc > 0 &&
+        virMacMapWriteFile(obj->macmap, file) < 0)
         goto cleanup;
 
     ret = 0;
@@ -310,6 +359,7 @@ virNetworkObjMacMgrDel(virNetworkObj *obj,
 {
     char macStr[VIR_MAC_STRING_BUFLEN];
     char *file = NULL;
+    int rc;
     int ret = -1;
 
     if (!obj->macmap)
@@ -320,10 +370,11 @@ virNetworkObjMacMgrDel(virNetworkObj *obj,
     if (!(file = virMacMapFileName(dnsmasqStateDir, obj->def->bridge)))
         goto cleanup;
 
-    if (virMacMapRemove(obj->macmap, domain, macStr) < 0)
+    if ((rc = virMacMapRemove(obj->macmap, domain, macStr)) < 0)
         goto cleanup;
 
-    if (virMacMapWriteFile(obj->macmap, file) < 0)
+    if (rc > 0 &&
+        virMacMapWriteFile(obj->macmap, file) < 0)
         goto cleanup;
 
     ret = 0;
@@ -952,6 +1003,7 @@ virNetworkLoadState(virNetworkObjList *nets,
     if (classIdMap) {
         virBitmapFree(obj->classIdMap);
         obj->classIdMap = g_steal_pointer(&classIdMap);
+        obj->classIdHint = 0;
     }
 
     if (floor_sum_val > 0)
@@ -76,6 +76,13 @@ virNetworkObjSetRadvdPid(virNetworkObj *obj,
 virBitmap *
 virNetworkObjGetClassIdMap(virNetworkObj *obj);
 
+ssize_t
+virNetworkObjAllocClassId(virNetworkObj *obj);
+
+void
+virNetworkObjReleaseClassId(virNetworkObj *obj,
+                            size_t id);
+
 unsigned long long
 virNetworkObjGetFloorSum(virNetworkObj *obj);
 
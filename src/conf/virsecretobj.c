@@ -56,11 +56,11 @@ struct _virSecretObjList {
     /* uuid string -> virSecretObj  mapping
      * for O(1), lockless lookup-by-uuid */
     GHashTable *objs;
-};
 
-struct virSecretSearchData {
-    int usageType;
-    const char *usageID;
+    /* usage id -> GPtrArray of virSecretObj (not ref'd) mapping for
+     * lookup-by-usage without walking all secrets. Secrets of different
+     * usage types may share the usage id, which can't change on redefine */
+    GHashTable *usageIDs;
 };
 
 
@@ -124,6 +124,9 @@ virSecretObjListNew(void)
         return NULL;
     }
 
+    secrets->usageIDs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) g_ptr_array_unref);
+
     return secrets;
 }
 
@@ -150,6 +153,8 @@ virSecretObjListDispose(void *obj)
     virSecretObjList *secrets = obj;
 
     virHashFree(secrets->objs);
+    if (secrets->usageIDs)
+        g_hash_table_unref(secrets->usageIDs);
 }
 
 
@@ -195,29 +200,39 @@ virSecretObjListFindByUUID(virSecretObjList *secrets,
 }
 
 
-static int
-virSecretObjSearchName(const void *payload,
-                       const char *name G_GNUC_UNUSED,
-                       const void *opaque)
+static void
+virSecretObjListAddUsageLocked(virSecretObjList *secrets,
+                               virSecretObj *obj)
 {
-    virSecretObj *obj = (virSecretObj *) payload;
-    virSecretDef *def;
-    struct virSecretSearchData *data = (struct virSecretSearchData *) opaque;
-    int found = 0;
+    const char *usageID = obj->def->usage_id;
+    GPtrArray *objs;
 
-    virObjectLock(obj);
-    def = obj->def;
+    if (!usageID)
+        return;
 
-    if (def->usage_type != data->usageType)
-        goto cleanup;
+    if (!(objs = g_hash_table_lookup(secrets->usageIDs, usageID))) {
+        objs = g_ptr_array_new();
+        g_hash_table_insert(secrets->usageIDs, g_strdup(usageID), objs);
+    }
 
-    if (data->usageType != VIR_SECRET_USAGE_TYPE_NONE &&
-        STREQ(def->usage_id, data->usageID))
-        found = 1;
+    g_ptr_array_add(objs, obj);
+}
 
- cleanup:
-    virObjectUnlock(obj);
-    return found;
+
+static void
+virSecretObjListRemoveUsageLocked(virSecretObjList *secrets,
+                                  virSecretObj *obj)
+{
+    const char *usageID = obj->def->usage_id;
+    GPtrArray *objs;
+
+    if (!usageID ||
+        !(objs = g_hash_table_lookup(secrets->usageIDs, usageID)))
+        return;
+
+    g_ptr_array_remove_fast(objs, obj);
+    if (objs->len == 0)
+        g_hash_table_remove(secrets->usageIDs, usageID);
 }
 
 
@@ -236,14 +251,26 @@ virSecretObjListFindByUsageLocked(virSecretObjList *secrets,
                                   int usageType,
                                   const char *usageID)
 {
-    virSecretObj *obj = NULL;
-    struct virSecretSearchData data = { .usageType = usageType,
-                                        .usageID = usageID };
+    GPtrArray *objs;
+    size_t i;
 
-    obj = virHashSearch(secrets->objs, virSecretObjSearchName, &data, NULL);
-    if (obj)
-        virObjectRef(obj);
-    return obj;
+    if (usageType == VIR_SECRET_USAGE_TYPE_NONE || !usageID ||
+        !(objs = g_hash_table_lookup(secrets->usageIDs, usageID)))
+        return NULL;
+
+    for (i = 0; i < objs->len; i++) {
+        virSecretObj *obj = g_ptr_array_index(objs, i);
+        bool match;
+
+        virObjectLock(obj);
+        match = obj->def->usage_type == usageType;
+        virObjectUnlock(obj);
+
+        if (match)
+            return virObjectRef(obj);
+    }
+
+    return NULL;
 }
 
 
@@ -300,6 +327,7 @@ virSecretObjListRemove(virSecretObjList *secrets,
 
     virObjectRWLockWrite(secrets);
     virObjectLock(obj);
+    virSecretObjListRemoveUsageLocked(secrets, obj);
     virHashRemoveEntry(secrets->objs, uuidstr);
     virSecretObjEndAPI(&obj);
     virObjectRWUnlock(secrets);
@@ -389,6 +417,7 @@ virSecretObjListAdd(virSecretObjList *secrets,
             goto cleanup;
 
         obj->def = newdef;
+        virSecretObjListAddUsageLocked(secrets, obj);
         virObjectRef(obj);
     }
 
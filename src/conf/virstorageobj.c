@@ -42,12 +42,15 @@ static virClass *virStoragePoolObjClass;
 static virClass *virStoragePoolObjListClass;
 static virClass *virStorageVolObjClass;
 static virClass *virStorageVolObjListClass;
+static virClass *virStorageVolIndexClass;
 
 static void
 virStoragePoolObjDispose(void *opaque);
 static void
 virStoragePoolObjListDispose(void *opaque);
 static void
+virStorageVolIndexDispose(void *opaque);
+static void
 virStorageVolObjDispose(void *opaque);
 static void
 virStorageVolObjListDispose(void *opaque);
@@ -78,6 +81,20 @@ struct _virStorageVolObjList {
     GHashTable *objsPath;
 };
 
+/* Index of volumes of all pools in a virStoragePoolObjList. It only names
+ * the pool a volume is in, callers have to look the volume up in the pool
+ * to make sure the hint is still valid. */
+typedef struct _virStorageVolIndex virStorageVolIndex;
+struct _virStorageVolIndex {
+    virObjectLockable parent;
+
+    /* volume key string -> pool uuid string mapping */
+    GHashTable *keys;
+
+    /* volume path string -> pool uuid string mapping */
+    GHashTable *paths;
+};
+
 struct _virStoragePoolObj {
     virObjectLockable parent;
 
@@ -92,6 +109,12 @@ struct _virStoragePoolObj {
     virStoragePoolDef *newDef;
 
     virStorageVolObjList *volumes;
+
+    /* volumes known before a refresh started, see virStoragePoolObjStashVols */
+    virStorageVolObjList *stashedVolumes;
+
+    /* index of the pool list the pool is in, if any */
+    virStorageVolIndex *volIndex;
 };
 
 struct _virStoragePoolObjList {
@@ -104,6 +127,10 @@ struct _virStoragePoolObjList {
     /* name string -> virStoragePoolObj mapping
      * for (1), lockless lookup-by-name */
     GHashTable *objsName;
+
+    /* volume key and path -> pool mapping
+     * for (1) lookup of volumes across pools */
+    virStorageVolIndex *volIndex;
 };
 
 
@@ -198,12 +225,134 @@ virStoragePoolObjOnceInit(void)
     if (!VIR_CLASS_NEW(virStoragePoolObjList, virClassForObjectRWLockable()))
         return -1;
 
+    if (!VIR_CLASS_NEW(virStorageVolIndex, virClassForObjectLockable()))
+        return -1;
+
     return 0;
 }
 
 VIR_ONCE_GLOBAL_INIT(virStoragePoolObj);
 
 
+static virStorageVolIndex *
+virStorageVolIndexNew(void)
+{
+    virStorageVolIndex *idx;
+
+    if (!(idx = virObjectLockableNew(virStorageVolIndexClass)))
+        return NULL;
+
+    idx->keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    idx->paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    return idx;
+}
+
+
+static void
+virStorageVolIndexDispose(void *opaque)
+{
+    virStorageVolIndex *idx = opaque;
+
+    g_hash_table_unref(idx->keys);
+    g_hash_table_unref(idx->paths);
+}
+
+
+static void
+virStorageVolIndexAdd(virStoragePoolObj *obj,
+                      virStorageVolDef *voldef)
+{
+    virStorageVolIndex *idx = obj->volIndex;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!idx)
+        return;
+
+    virUUIDFormat(obj->def->uuid, uuidstr);
+
+    virObjectLock(idx);
+    g_hash_table_insert(idx->keys, g_strdup(voldef->key), g_strdup(uuidstr));
+    g_hash_table_insert(idx->paths, g_strdup(voldef->target.path),
+                        g_strdup(uuidstr));
+    virObjectUnlock(idx);
+}
+
+
+/* Drops @name from @table unless it was claimed by another pool since */
+static void
+virStorageVolIndexRemoveOne(GHashTable *table,
+                            const char *name,
+                            const char *uuidstr)
+{
+    const char *owner;
+
+    if ((owner = g_hash_table_lookup(table, name)) && STREQ(owner, uuidstr))
+        g_hash_table_remove(table, name);
+}
+
+
+static void
+virStorageVolIndexRemoveVol(virStoragePoolObj *obj,
+                            virStorageVolDef *voldef)
+{
+    virStorageVolIndex *idx = obj->volIndex;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!idx)
+        return;
+
+    virUUIDFormat(obj->def->uuid, uuidstr);
+
+    virObjectLock(idx);
+    virStorageVolIndexRemoveOne(idx->keys, voldef->key, uuidstr);
+    virStorageVolIndexRemoveOne(idx->paths, voldef->target.path, uuidstr);
+    virObjectUnlock(idx);
+}
+
+
+/*
+ * Removes volumes in @volumes of @obj from the index. Keys and paths which
+ * are in @keep as well stay indexed.
+ */
+static void
+virStorageVolIndexRemove(virStoragePoolObj *obj,
+                         virStorageVolObjList *volumes,
+                         virStorageVolObjList *keep)
+{
+    virStorageVolIndex *idx = obj->volIndex;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    GHashTableIter iter;
+    void *payload;
+
+    if (!idx || !obj->def || !volumes)
+        return;
+
+    virUUIDFormat(obj->def->uuid, uuidstr);
+
+    if (keep)
+        virObjectRWLockRead(keep);
+    virObjectLock(idx);
+
+    g_hash_table_iter_init(&iter, volumes->objsKey);
+    while (g_hash_table_iter_next(&iter, NULL, &payload)) {
+        virStorageVolDef *voldef = ((virStorageVolObj *) payload)->voldef;
+
+        if (!voldef)
+            continue;
+
+        if (!keep || !virHashLookup(keep->objsKey, voldef->key))
+            virStorageVolIndexRemoveOne(idx->keys, voldef->key, uuidstr);
+        if (!keep || !virHashLookup(keep->objsPath, voldef->target.path))
+            virStorageVolIndexRemoveOne(idx->paths, voldef->target.path, uuidstr);
+    }
+
+    virObjectUnlock(idx);
+    if (keep)
+        virObjectRWUnlock(keep);
+}
+
+
 virStoragePoolObj *
 virStoragePoolObjNew(void)
 {
@@ -367,7 +516,9 @@ virStoragePoolObjDispose(void *opaque)
     virStoragePoolObj *obj = opaque;
 
     virStoragePoolObjClearVols(obj);
+    virStoragePoolObjClearStashedVols(obj);
     virObjectUnref(obj->volumes);
+    virObjectUnref(obj->volIndex);
 
     virStoragePoolDefFree(obj->def);
     virStoragePoolDefFree(obj->newDef);
@@ -384,6 +535,7 @@ virStoragePoolObjListDispose(void *opaque)
 
     virHashFree(pools->objs);
     virHashFree(pools->objsName);
+    virObjectUnref(pools->volIndex);
 }
 
 
@@ -401,6 +553,11 @@ virStoragePoolObjListNew(void)
     pools->objs = virHashNew(virObjectFreeHashData);
     pools->objsName = virHashNew(virObjectFreeHashData);
 
+    if (!(pools->volIndex = virStorageVolIndexNew())) {
+        virObjectUnref(pools);
+        return NULL;
+    }
+
     return pools;
 }
 
@@ -617,18 +774,197 @@ virStoragePoolSourceFindDuplicateDevices(virStoragePoolObj *obj,
 }
 
 
+static virStoragePoolObj *
+virStoragePoolObjListFindByVolIndex(virStoragePoolObjList *pools,
+                                    const char *name,
+                                    bool byPath,
+                                    virStorageVolDef **voldef)
+{
+    virStorageVolIndex *idx = pools->volIndex;
+    g_autofree char *uuidstr = NULL;
+    virStoragePoolObj *obj;
+
+    virObjectLock(idx);
+    uuidstr = g_strdup(g_hash_table_lookup(byPath ? idx->paths : idx->keys,
+                                           name));
+    virObjectUnlock(idx);
+
+    if (!uuidstr)
+        return NULL;
+
+    virObjectRWLockRead(pools);
+    obj = virObjectRef(virHashLookup(pools->objs, uuidstr));
+    virObjectRWUnlock(pools);
+
+    if (!obj)
+        return NULL;
+
+    virObjectLock(obj);
+
+    if (virStoragePoolObjIsActive(obj)) {
+        if (byPath)
+            *voldef = virStorageVolDefFindByPath(obj, name);
+        else
+            *voldef = virStorageVolDefFindByKey(obj, name);
+
+        if (*voldef)
+            return obj;
+    }
+
+    virStoragePoolObjEndAPI(&obj);
+    return NULL;
+}
+
+
+/**
+ * virStoragePoolObjListFindByVolKey:
+ * @pools: Storage pool object list pointer
+ * @key: key of the volume to find
+ * @voldef: filled with the found volume definition
+ *
+ * Looks up the active pool holding a volume with @key using the index of
+ * volumes of @pools, without scanning all the pools. The index remembers
+ * only the pool which added a volume with @key last, callers which need
+ * to be exhaustive fall back to virStoragePoolObjListSearch.
+ *
+ * Returns: Locked and reffed storage pool object or NULL if not found
+ */
+virStoragePoolObj *
+virStoragePoolObjListFindByVolKey(virStoragePoolObjList *pools,
+                                  const char *key,
+                                  virStorageVolDef **voldef)
+{
+    return virStoragePoolObjListFindByVolIndex(pools, key, false, voldef);
+}
+
+
+/**
+ * virStoragePoolObjListFindByVolPath:
+ * @pools: Storage pool object list pointer
+ * @path: target path of the volume to find
+ * @voldef: filled with the found volume definition
+ *
+ * Same as virStoragePoolObjListFindByVolKey, but looks the volume up by
+ * its target path, which has to match exactly.
+ *
+ * Returns: Locked and reffed storage pool object or NULL if not found
+ */
+virStoragePoolObj *
+virStoragePoolObjListFindByVolPath(virStoragePoolObjList *pools,
+                                   const char *path,
+                                   virStorageVolDef **voldef)
+{
+    return virStoragePoolObjListFindByVolIndex(pools, path, true, voldef);
+}
+
+
 void
 virStoragePoolObjClearVols(virStoragePoolObj *obj)
 {
     if (!obj->volumes)
         return;
 
+    virStorageVolIndexRemove(obj, obj->volumes, NULL);
+
     virHashRemoveAll(obj->volumes->objsKey);
     virHashRemoveAll(obj->volumes->objsName);
     virHashRemoveAll(obj->volumes->objsPath);
 }
 
 
+/**
+ * virStoragePoolObjStashVols:
+ * @obj: storage pool object
+ *
+ * Empties the list of volumes of @obj like virStoragePoolObjClearVols, but
+ * keeps the volumes aside so that a backend refreshing the pool can take
+ * over those which did not change using virStoragePoolObjTakeStashedVol.
+ * The volumes which were not taken are freed by
+ * virStoragePoolObjClearStashedVols once the refresh is done.
+ */
+void
+virStoragePoolObjStashVols(virStoragePoolObj *obj)
+{
+    virStorageVolObjList *volumes;
+
+    virStoragePoolObjClearStashedVols(obj);
+
+    if (!obj->volumes || !(volumes = virStorageVolObjListNew())) {
+        virStoragePoolObjClearVols(obj);
+        return;
+    }
+
+    obj->stashedVolumes = g_steal_pointer(&obj->volumes);
+    obj->volumes = volumes;
+}
+
+
+/**
+ * virStoragePoolObjTakeStashedVol:
+ * @obj: storage pool object
+ * @name: name of the volume
+ *
+ * Removes the volume called @name from the volumes stashed by
+ * virStoragePoolObjStashVols.
+ *
+ * Returns the volume definition which the caller now owns, or NULL if
+ * there is no such volume.
+ */
+virStorageVolDef *
+virStoragePoolObjTakeStashedVol(virStoragePoolObj *obj,
+                                const char *name)
+{
+    virStorageVolObjList *volumes = obj->stashedVolumes;
+    virStorageVolObj *volobj;
+    virStorageVolDef *voldef;
+
+    if (!volumes || !(volobj = virHashLookup(volumes->objsName, name)))
+        return NULL;
+
+    voldef = g_steal_pointer(&volobj->voldef);
+
+    virStorageVolIndexRemoveVol(obj, voldef);
+
+    virHashRemoveEntry(volumes->objsKey, voldef->key);
+    virHashRemoveEntry(volumes->objsPath, voldef->target.path);
+    virHashRemoveEntry(volumes->objsName, voldef->name);
+
+    return voldef;
+}
+
+
+/**
+ * virStoragePoolObjUnstashVols:
+ * @obj: storage pool object
+ *
+ * Puts the volumes stashed by virStoragePoolObjStashVols back in place of
+ * the list of volumes of @obj, for a backend which can tell that none of
+ * them changed without looking at each of them. Volumes added to @obj
+ * since they were stashed are dropped.
+ */
+void
+virStoragePoolObjUnstashVols(virStoragePoolObj *obj)
+{
+    if (!obj->stashedVolumes)
+        return;
+
+    virStorageVolIndexRemove(obj, obj->volumes, obj->stashedVolumes);
+    virObjectUnref(obj->volumes);
+    obj->volumes = g_steal_pointer(&obj->stashedVolumes);
+}
+
+
+void
+virStoragePoolObjClearStashedVols(virStoragePoolObj *obj)
+{
+    if (!obj->stashedVolumes)
+        return;
+
+    virStorageVolIndexRemove(obj, obj->stashedVolumes, obj->volumes);
+    g_clear_pointer(&obj->stashedVolumes, virObjectUnref);
+}
+
+
 int
 virStoragePoolObjAddVol(virStoragePoolObj *obj,
                         virStorageVolDef *voldef)
@@ -659,6 +995,7 @@ virStoragePoolObjAddVol(virStoragePoolObj *obj,
     virObjectRef(volobj);
 
     volobj->voldef = voldef;
+    virStorageVolIndexAdd(obj, voldef);
     virObjectRWUnlock(volumes);
     virStorageVolObjEndAPI(&volobj);
     return 0;
@@ -690,6 +1027,7 @@ virStoragePoolObjRemoveVol(virStoragePoolObj *obj,
 
     virObjectRef(volobj);
     virObjectLock(volobj);
+    virStorageVolIndexRemoveVol(obj, voldef);
     virHashRemoveEntry(volumes->objsKey, voldef->key);
     virHashRemoveEntry(volumes->objsName, voldef->name);
     virHashRemoveEntry(volumes->objsPath, voldef->target.path);
@@ -1590,6 +1928,7 @@ virStoragePoolObjListAdd(virStoragePoolObjList *pools,
     }
     virObjectRef(obj);
     obj->def = def;
+    obj->volIndex = virObjectRef(pools->volIndex);
     virObjectRWUnlock(pools);
     return obj;
 
@@ -129,6 +129,16 @@ virStoragePoolObj *
 virStoragePoolObjFindByName(virStoragePoolObjList *pools,
                             const char *name);
 
+virStoragePoolObj *
+virStoragePoolObjListFindByVolKey(virStoragePoolObjList *pools,
+                                  const char *key,
+                                  virStorageVolDef **voldef);
+
+virStoragePoolObj *
+virStoragePoolObjListFindByVolPath(virStoragePoolObjList *pools,
+                                   const char *path,
+                                   virStorageVolDef **voldef);
+
 int
 virStoragePoolObjAddVol(virStoragePoolObj *obj,
                         virStorageVolDef *voldef);
@@ -173,6 +183,19 @@ virStorageVolDefFindByName(virStoragePoolObj *obj,
 void
 virStoragePoolObjClearVols(virStoragePoolObj *obj);
 
+void
+virStoragePoolObjStashVols(virStoragePoolObj *obj);
+
+virStorageVolDef *
+virStoragePoolObjTakeStashedVol(virStoragePoolObj *obj,
+                                const char *name);
+
+void
+virStoragePoolObjUnstashVols(virStoragePoolObj *obj);
+
+void
+virStoragePoolObjClearStashedVols(virStoragePoolObj *obj);
+
 typedef bool
 (*virStoragePoolVolumeACLFilter)(virConnectPtr conn,
                                  virStoragePoolDef *pool,
@@ -154,6 +154,10 @@ struct _virCPUx86Map {
     virCPUx86Feature **features;
     size_t nmodels;
     virCPUx86Model **models;
+    /* Name lookup tables for the above, the keys are owned by
+     * the items themselves */
+    GHashTable *featureIndex;
+    GHashTable *modelIndex;
     size_t nblockers;
     virCPUx86Feature **migrate_blockers;
 };
@@ -362,14 +366,7 @@ static virCPUx86Feature *
 x86FeatureFind(virCPUx86Map *map,
                const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nfeatures; i++) {
-        if (STREQ(map->features[i]->name, name))
-            return map->features[i];
-    }
-
-    return NULL;
+    return g_hash_table_lookup(map->featureIndex, name);
 }
 
 
@@ -458,21 +455,45 @@ virCPUx86DataNext(virCPUx86DataIterator *iterator)
 }
 
 
+/* Items in virCPUx86Data are kept sorted by virCPUx86DataSorter, which
+ * makes this a binary search. If @item is not found, @pos (if not NULL)
+ * is set to the index it should be inserted at. */
 static virCPUx86DataItem *
-virCPUx86DataGet(const virCPUx86Data *data,
-                 const virCPUx86DataItem *item)
+virCPUx86DataFind(const virCPUx86Data *data,
+                  const virCPUx86DataItem *item,
+                  size_t *pos)
 {
-    size_t i;
+    size_t lo = 0;
+    size_t hi = data->len;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        virCPUx86DataItem *di = data->items + mid;
+        int rc = virCPUx86DataItemCmp(di, item);
 
-    for (i = 0; i < data->len; i++) {
-        virCPUx86DataItem *di = data->items + i;
-        if (virCPUx86DataItemCmp(di, item) == 0)
+        if (rc == 0)
             return di;
+
+        if (rc < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
+    if (pos)
+        *pos = lo;
+
     return NULL;
 }
 
+
+static virCPUx86DataItem *
+virCPUx86DataGet(const virCPUx86Data *data,
+                 const virCPUx86DataItem *item)
+{
+    return virCPUx86DataFind(data, item, NULL);
+}
+
 static void
 virCPUx86DataClear(virCPUx86Data *data)
 {
@@ -530,15 +551,15 @@ virCPUx86DataAddItem(virCPUx86Data *data,
                      const virCPUx86DataItem *item)
 {
     virCPUx86DataItem *existing;
+    size_t pos = 0;
 
-    if ((existing = virCPUx86DataGet(data, item))) {
+    if ((existing = virCPUx86DataFind(data, item, &pos))) {
         virCPUx86DataItemSetBits(existing, item);
     } else {
-        VIR_APPEND_ELEMENT_COPY(data->items, data->len,
-                                *((virCPUx86DataItem *)item));
+        virCPUx86DataItem copy = *item;
 
-        qsort(data->items, data->len,
-              sizeof(virCPUx86DataItem), virCPUx86DataSorter);
+        if (VIR_INSERT_ELEMENT(data->items, pos, data->len, copy) < 0)
+            return -1;
     }
 
     return 0;
@@ -1153,6 +1174,7 @@ x86FeatureParse(xmlXPathContextPtr ctxt,
     if (!feature->migratable)
         VIR_APPEND_ELEMENT_COPY(map->migrate_blockers, map->nblockers, feature);
 
+    g_hash_table_insert(map->featureIndex, feature->name, feature);
     VIR_APPEND_ELEMENT(map->features, map->nfeatures, feature);
 
     return 0;
@@ -1298,14 +1320,7 @@ static virCPUx86Model *
 x86ModelFind(virCPUx86Map *map,
              const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nmodels; i++) {
-        if (STREQ(map->models[i]->name, name))
-            return map->models[i];
-    }
-
-    return NULL;
+    return g_hash_table_lookup(map->modelIndex, name);
 }
 
 
@@ -1686,6 +1701,7 @@ x86ModelParse(xmlXPathContextPtr ctxt,
     if (x86ModelParseFeatures(model, ctxt, map) < 0)
         return -1;
 
+    g_hash_table_insert(map->modelIndex, model->name, model);
     VIR_APPEND_ELEMENT(map->models, map->nmodels, model);
 
     return 0;
@@ -1700,6 +1716,11 @@ x86MapFree(virCPUx86Map *map)
     if (!map)
         return;
 
+    if (map->featureIndex)
+        g_hash_table_unref(map->featureIndex);
+    if (map->modelIndex)
+        g_hash_table_unref(map->modelIndex);
+
     for (i = 0; i < map->nfeatures; i++)
         x86FeatureFree(map->features[i]);
     g_free(map->features);
@@ -1728,6 +1749,8 @@ virCPUx86LoadMap(void)
     g_autoptr(virCPUx86Map) map = NULL;
 
     map = g_new0(virCPUx86Map, 1);
+    map->featureIndex = g_hash_table_new(g_str_hash, g_str_equal);
+    map->modelIndex = g_hash_table_new(g_str_hash, g_str_equal);
 
     if (cpuMapLoad("x86", x86VendorParse, x86FeatureParse, x86ModelParse, map) < 0)
         return NULL;
@@ -3439,6 +3462,9 @@ virCPUx86DataGetHost(void)
         item->data.cpuid.edx = kvm_cpuid->entries[i].edx;
     }
 
+    qsort(cpuid->data.x86.items, cpuid->data.x86.len,
+          sizeof(virCPUx86DataItem), virCPUx86DataSorter);
+
     return cpuid;
 }
 #endif
@@ -79,6 +79,9 @@ static void virAdmClientDispose(void *obj);
 static __thread bool connectDisposed;
 static __thread bool admConnectDisposed;
 
+static virMutex connectSerialLock = VIR_MUTEX_INITIALIZER;
+static unsigned long long connectSerial;
+
 static int
 virDataTypesOnceInit(void)
 {
@@ -130,10 +133,19 @@ VIR_ONCE_GLOBAL_INIT(virDataTypes);
 virConnectPtr
 virGetConnect(void)
 {
+    virConnectPtr conn;
+
     if (virDataTypesInitialize() < 0)
         return NULL;
 
-    return virObjectLockableNew(virConnectClass);
+    if (!(conn = virObjectLockableNew(virConnectClass)))
+        return NULL;
+
+    virMutexLock(&connectSerialLock);
+    conn->serial = ++connectSerial;
+    virMutexUnlock(&connectSerialLock);
+
+    return conn;
 }
 
 
@@ -519,6 +519,10 @@ struct _virConnect {
     unsigned int flags;     /* a set of connection flags */
     virURI *uri;          /* connection URI */
 
+    /* Unique within the process, lets drivers refer to a connection
+     * without holding a reference to it */
+    unsigned long long serial;
+
     /* The underlying hypervisor driver and network driver. */
     virHypervisorDriver *driver;
     virNetworkDriver *networkDriver;
@@ -740,6 +744,18 @@ struct _virStream {
 };
 
 
+/**
+ * _virDomainBatch
+ *
+ * Internal structure associated with a batch of domain queries
+ */
+struct _virDomainBatch {
+    virConnectPtr conn;
+    size_t ncalls;
+    virDomainBatchCall *calls;
+};
+
+
 /**
  * _virDomainCheckpoint
  *
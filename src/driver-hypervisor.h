@@ -1410,6 +1410,82 @@ typedef int
                                   int seconds,
                                   unsigned int flags);
 
+typedef enum {
+    VIR_DOMAIN_BATCH_CALL_GET_INFO,
+    VIR_DOMAIN_BATCH_CALL_GET_STATE,
+    VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO,
+} virDomainBatchCallType;
+
+typedef struct _virDomainBatchCall virDomainBatchCall;
+struct _virDomainBatchCall {
+    virDomainBatchCallType type;
+    virDomainPtr domain;
+    char *disk;
+    unsigned int flags;
+
+    /* Caller provided storage for the results */
+    virDomainInfoPtr info;
+    int *state;
+    int *reason;
+    virDomainBlockInfoPtr blockInfo;
+
+    /* Set by the driver if the call failed */
+    virErrorPtr error;
+};
+
+/*
+ * Runs all of @calls, filling in either the results or the error of
+ * each of them. Returns 0 if the batch was run (even though some of
+ * the calls may have failed), -1 if it could not be run at all.
+ */
+typedef int
+(*virDrvDomainBatchRun)(virConnectPtr conn,
+                        virDomainBatchCall *calls,
+                        size_t ncalls,
+                        unsigned int flags);
+
+typedef int
+(*virDrvConnectDomainStatsSubscribe)(virConnectPtr conn,
+                                     unsigned int stats,
+                                     unsigned int interval,
+                                     unsigned int flags);
+
+typedef int
+(*virDrvDomainSnapshotCreateXMLGroup)(virConnectPtr conn,
+                                      virDomainPtr *domains,
+                                      unsigned int ndomains,
+                                      const char **xmlDescs,
+                                      virDomainSnapshotPtr *snapshots,
+                                      unsigned int flags);
+
+typedef int
+(*virDrvDomainAttachDevices)(virDomainPtr domain,
+                             const char **xmls,
+                             unsigned int nxmls,
+                             unsigned int flags);
+
+typedef int
+(*virDrvDomainDetachDevices)(virDomainPtr domain,
+                             const char **xmls,
+                             unsigned int nxmls,
+                             unsigned int flags);
+
+typedef int
+(*virDrvConnectStartDomains)(virConnectPtr conn,
+                             virDomainPtr *domains,
+                             unsigned int ndomains,
+                             unsigned int parallel,
+                             int *results,
+                             unsigned int flags);
+
+typedef int
+(*virDrvConnectShutdownDomains)(virConnectPtr conn,
+                                virDomainPtr *domains,
+                                unsigned int ndomains,
+                                unsigned int parallel,
+                                int *results,
+                                unsigned int flags);
+
 typedef struct _virHypervisorDriver virHypervisorDriver;
 
 /**
@@ -1676,4 +1752,11 @@ struct _virHypervisorDriver {
     virDrvDomainAuthorizedSSHKeysSet domainAuthorizedSSHKeysSet;
     virDrvDomainGetMessages domainGetMessages;
     virDrvDomainStartDirtyRateCalc domainStartDirtyRateCalc;
+    virDrvDomainBatchRun domainBatchRun;
+    virDrvConnectDomainStatsSubscribe connectDomainStatsSubscribe;
+    virDrvDomainSnapshotCreateXMLGroup domainSnapshotCreateXMLGroup;
+    virDrvDomainAttachDevices domainAttachDevices;
+    virDrvDomainDetachDevices domainDetachDevices;
+    virDrvConnectStartDomains connectStartDomains;
+    virDrvConnectShutdownDomains connectShutdownDomains;
 };
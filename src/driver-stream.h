@@ -29,6 +29,11 @@ typedef int
                     const char *data,
                     size_t nbytes);
 
+typedef int
+(*virDrvStreamSendFromFD)(virStreamPtr st,
+                          int fd,
+                          size_t nbytes);
+
 typedef int
 (*virDrvStreamRecv)(virStreamPtr st,
                     char *data,
@@ -78,6 +83,7 @@ typedef int
 typedef struct _virStreamDriver virStreamDriver;
 struct _virStreamDriver {
     virDrvStreamSend streamSend;
+    virDrvStreamSendFromFD streamSendFromFD;
     virDrvStreamRecv streamRecv;
     virDrvStreamRecvFlags streamRecvFlags;
     virDrvStreamSendHole streamSendHole;
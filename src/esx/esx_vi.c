@@ -795,6 +795,9 @@ ESX_VI__TEMPLATE__FREE(Context,
     if (item->sessionLock)
         virMutexDestroy(item->sessionLock);
 
+    if (item->vmCacheLock)
+        virMutexDestroy(item->vmCacheLock);
+
     esxVI_CURL_Free(&item->curl);
     g_free(item->url);
     g_free(item->ipAddress);
@@ -816,6 +819,10 @@ ESX_VI__TEMPLATE__FREE(Context,
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToHost);
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToParentToParent);
     esxVI_SelectionSpec_Free(&item->selectSet_datacenterToNetwork);
+    g_free(item->vmCacheLock);
+    esxVI_ManagedObjectReference_Free(&item->vmCacheFilter);
+    g_free(item->vmCacheVersion);
+    esxVI_ObjectContent_Free(&item->vmCache);
 })
 
 int
@@ -858,6 +865,14 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
         return -1;
     }
 
+    ctx->vmCacheLock = g_new0(virMutex, 1);
+
+    if (virMutexInit(ctx->vmCacheLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not initialize virtual machine cache mutex"));
+        return -1;
+    }
+
     if (esxVI_RetrieveServiceContent(ctx, &ctx->service) < 0)
         return -1;
 
@@ -1855,6 +1870,11 @@ esxVI_BuildSelectSetCollection(esxVI_Context *ctx)
 
 
 
+static void esxVI_VirtualMachineCache_Reset(esxVI_Context *ctx,
+                                            bool destroyFilter);
+
+
+
 /*
  * Cannot use the SessionIsActive() function here, because at least
  * ESX Server 3.5.0 build-64607 and ESX 4.0.0 build-171294 return an
@@ -1922,6 +1942,12 @@ esxVI_EnsureSession(esxVI_Context *ctx)
     if (!currentSession) {
         esxVI_UserSession_Free(&ctx->session);
 
+        /* The property filter of the virtual machine cache died with the
+         * old session, start over with the new one */
+        virMutexLock(ctx->vmCacheLock);
+        esxVI_VirtualMachineCache_Reset(ctx, false);
+        virMutexUnlock(ctx->vmCacheLock);
+
         if (esxVI_Login(ctx, ctx->username, escapedPassword, NULL,
                         &ctx->session) < 0) {
             goto cleanup;
@@ -2673,11 +2699,449 @@ esxVI_LookupHostSystemProperties(esxVI_Context *ctx,
 
 
 
+/*
+ * The virtual machine cache holds these properties of all virtual machines of
+ * ctx->hostSystem. It's filled once through a property filter and then kept
+ * up to date by applying the changes reported by CheckForUpdates, so that
+ * listing and looking up domains costs a small delta instead of retrieving
+ * the properties of every virtual machine again.
+ */
+#define ESX_VI_VM_CACHE_PROPERTIES \
+    "configStatus\0" \
+    "name\0" \
+    "runtime.powerState\0" \
+    "config.uuid\0" \
+    "config.hardware.memoryMB\0" \
+    "config.hardware.numCPU\0" \
+    "config.memoryAllocation.limit\0"
+
+static bool
+esxVI_VirtualMachineCache_HasProperty(const char *name)
+{
+    const char *property;
+
+    for (property = ESX_VI_VM_CACHE_PROPERTIES; *property;
+         property += strlen(property) + 1) {
+        if (STREQ(property, name))
+            return true;
+    }
+
+    return false;
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static void
+esxVI_VirtualMachineCache_Reset(esxVI_Context *ctx, bool destroyFilter)
+{
+    if (ctx->vmCacheFilter && destroyFilter) {
+        virErrorPtr orig_err;
+
+        virErrorPreserveLast(&orig_err);
+
+        if (esxVI_DestroyPropertyFilter(ctx, ctx->vmCacheFilter) < 0)
+            VIR_DEBUG("DestroyPropertyFilter failed");
+
+        virErrorRestore(&orig_err);
+    }
+
+    esxVI_ManagedObjectReference_Free(&ctx->vmCacheFilter);
+    g_clear_pointer(&ctx->vmCacheVersion, g_free);
+    esxVI_ObjectContent_Free(&ctx->vmCache);
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static int
+esxVI_VirtualMachineCache_CreateFilter(esxVI_Context *ctx)
+{
+    int result = -1;
+    esxVI_ObjectSpec *objectSpec = NULL;
+    bool objectSpec_isAppended = false;
+    esxVI_PropertySpec *propertySpec = NULL;
+    bool propertySpec_isAppended = false;
+    esxVI_PropertyFilterSpec *propertyFilterSpec = NULL;
+
+    if (esxVI_ObjectSpec_Alloc(&objectSpec) < 0)
+        return -1;
+
+    /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
+     *        for cluster support */
+    objectSpec->obj = ctx->hostSystem->_reference;
+    objectSpec->skip = esxVI_Boolean_False;
+    objectSpec->selectSet = ctx->selectSet_hostSystemToVm;
+
+    if (esxVI_PropertySpec_Alloc(&propertySpec) < 0)
+        goto cleanup;
+
+    propertySpec->type = (char *)"VirtualMachine";
+
+    if (esxVI_String_AppendValueListToList(&propertySpec->pathSet,
+                                           ESX_VI_VM_CACHE_PROPERTIES) < 0 ||
+        esxVI_PropertyFilterSpec_Alloc(&propertyFilterSpec) < 0 ||
+        esxVI_PropertySpec_AppendToList(&propertyFilterSpec->propSet,
+                                        propertySpec) < 0) {
+        goto cleanup;
+    }
+
+    propertySpec_isAppended = true;
+
+    if (esxVI_ObjectSpec_AppendToList(&propertyFilterSpec->objectSet,
+                                      objectSpec) < 0) {
+        goto cleanup;
+    }
+
+    objectSpec_isAppended = true;
+
+    if (esxVI_CreateFilter(ctx, propertyFilterSpec, esxVI_Boolean_True,
+                           &ctx->vmCacheFilter) < 0) {
+        goto cleanup;
+    }
+
+    result = 0;
+
+ cleanup:
+    /*
+     * Remove values borrowed from the context from the data structures to
+     * prevent them from being freed by esxVI_PropertyFilterSpec_Free().
+     */
+    objectSpec->obj = NULL;
+    objectSpec->selectSet = NULL;
+
+    if (propertySpec)
+        propertySpec->type = NULL;
+
+    if (!objectSpec_isAppended)
+        esxVI_ObjectSpec_Free(&objectSpec);
+
+    if (!propertySpec_isAppended)
+        esxVI_PropertySpec_Free(&propertySpec);
+
+    esxVI_PropertyFilterSpec_Free(&propertyFilterSpec);
+
+    return result;
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static int
+esxVI_VirtualMachineCache_ApplyChanges(esxVI_ObjectContent *virtualMachine,
+                                       esxVI_PropertyChange *changeSet)
+{
+    esxVI_PropertyChange *propertyChange;
+
+    for (propertyChange = changeSet; propertyChange;
+         propertyChange = propertyChange->_next) {
+        esxVI_DynamicProperty **link = &virtualMachine->propSet;
+        esxVI_DynamicProperty *dynamicProperty = NULL;
+
+        while (*link && STRNEQ((*link)->name, propertyChange->name))
+            link = &(*link)->_next;
+
+        if (*link) {
+            dynamicProperty = *link;
+            *link = dynamicProperty->_next;
+            dynamicProperty->_next = NULL;
+            esxVI_DynamicProperty_Free(&dynamicProperty);
+        }
+
+        if ((propertyChange->op != esxVI_PropertyChangeOp_Add &&
+             propertyChange->op != esxVI_PropertyChangeOp_Assign) ||
+            !propertyChange->val) {
+            continue;
+        }
+
+        if (esxVI_DynamicProperty_Alloc(&dynamicProperty) < 0)
+            return -1;
+
+        dynamicProperty->name = g_strdup(propertyChange->name);
+
+        if (esxVI_AnyType_DeepCopy(&dynamicProperty->val,
+                                   propertyChange->val) < 0 ||
+            esxVI_DynamicProperty_AppendToList(&virtualMachine->propSet,
+                                               dynamicProperty) < 0) {
+            esxVI_DynamicProperty_Free(&dynamicProperty);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static int
+esxVI_VirtualMachineCache_ApplyUpdateSet(esxVI_Context *ctx,
+                                         esxVI_UpdateSet *updateSet)
+{
+    esxVI_PropertyFilterUpdate *propertyFilterUpdate;
+    esxVI_ObjectUpdate *objectUpdate;
+
+    for (propertyFilterUpdate = updateSet->filterSet; propertyFilterUpdate;
+         propertyFilterUpdate = propertyFilterUpdate->_next) {
+        /* Filters of esxVI_WaitForTaskCompletion live on the same property
+         * collector and report their changes here as well */
+        if (STRNEQ(propertyFilterUpdate->filter->value,
+                   ctx->vmCacheFilter->value)) {
+            continue;
+        }
+
+        for (objectUpdate = propertyFilterUpdate->objectSet; objectUpdate;
+             objectUpdate = objectUpdate->_next) {
+            esxVI_ObjectContent **link = &ctx->vmCache;
+            esxVI_ObjectContent *virtualMachine = NULL;
+
+            while (*link && STRNEQ((*link)->obj->value,
+                                   objectUpdate->obj->value)) {
+                link = &(*link)->_next;
+            }
+
+            if (objectUpdate->kind == esxVI_ObjectUpdateKind_Leave) {
+                if (*link) {
+                    virtualMachine = *link;
+                    *link = virtualMachine->_next;
+                    virtualMachine->_next = NULL;
+                    esxVI_ObjectContent_Free(&virtualMachine);
+                }
+
+                continue;
+            }
+
+            if (!*link) {
+                if (esxVI_ObjectContent_Alloc(&virtualMachine) < 0)
+                    return -1;
+
+                if (esxVI_ManagedObjectReference_DeepCopy
+                      (&virtualMachine->obj, objectUpdate->obj) < 0 ||
+                    esxVI_ObjectContent_AppendToList(&ctx->vmCache,
+                                                     virtualMachine) < 0) {
+                    esxVI_ObjectContent_Free(&virtualMachine);
+                    return -1;
+                }
+            } else {
+                virtualMachine = *link;
+            }
+
+            if (esxVI_VirtualMachineCache_ApplyChanges
+                  (virtualMachine, objectUpdate->changeSet) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static int
+esxVI_VirtualMachineCache_Refresh(esxVI_Context *ctx)
+{
+    int result = -1;
+    esxVI_UpdateSet *updateSet = NULL;
+
+    if (!ctx->vmCacheFilter) {
+        if (esxVI_VirtualMachineCache_CreateFilter(ctx) < 0) {
+            /* Don't try again for every lookup */
+            ctx->vmCacheDisabled = true;
+            return -1;
+        }
+
+        /* The initial version reports the complete content of the filter */
+        if (esxVI_WaitForUpdates(ctx, "", &updateSet) < 0)
+            goto cleanup;
+    } else if (esxVI_CheckForUpdates(ctx, ctx->vmCacheVersion,
+                                     &updateSet) < 0) {
+        goto cleanup;
+    }
+
+    /* CheckForUpdates returns nothing if nothing changed */
+    if (updateSet) {
+        if (esxVI_VirtualMachineCache_ApplyUpdateSet(ctx, updateSet) < 0)
+            goto cleanup;
+
+        g_free(ctx->vmCacheVersion);
+        ctx->vmCacheVersion = g_strdup(updateSet->version);
+    }
+
+    result = 0;
+
+ cleanup:
+    if (result < 0)
+        esxVI_VirtualMachineCache_Reset(ctx, true);
+
+    esxVI_UpdateSet_Free(&updateSet);
+
+    return result;
+}
+
+
+
+static bool
+esxVI_VirtualMachineCache_MatchesUuid(esxVI_ObjectContent *virtualMachine,
+                                      const unsigned char *uuid)
+{
+    esxVI_DynamicProperty *dynamicProperty;
+    unsigned char uuid_candidate[VIR_UUID_BUFLEN];
+
+    for (dynamicProperty = virtualMachine->propSet; dynamicProperty;
+         dynamicProperty = dynamicProperty->_next) {
+        if (STREQ(dynamicProperty->name, "config.uuid")) {
+            return dynamicProperty->val->type == esxVI_Type_String &&
+                   virUUIDParse(dynamicProperty->val->string,
+                                uuid_candidate) == 0 &&
+                   memcmp(uuid, uuid_candidate, VIR_UUID_BUFLEN) == 0;
+        }
+    }
+
+    return false;
+}
+
+
+
+/* ctx->vmCacheLock must be held */
+static int
+esxVI_VirtualMachineCache_Copy(esxVI_ObjectContent *virtualMachine,
+                               esxVI_String *propertyNameList,
+                               esxVI_ObjectContent **virtualMachineList)
+{
+    esxVI_ObjectContent *copy = NULL;
+    esxVI_DynamicProperty *dynamicProperty;
+    esxVI_String *propertyName;
+
+    if (esxVI_ObjectContent_Alloc(&copy) < 0 ||
+        esxVI_ManagedObjectReference_DeepCopy(&copy->obj,
+                                              virtualMachine->obj) < 0) {
+        goto failure;
+    }
+
+    /* Return only the requested properties, like RetrieveProperties does */
+    for (dynamicProperty = virtualMachine->propSet; dynamicProperty;
+         dynamicProperty = dynamicProperty->_next) {
+        esxVI_DynamicProperty *dynamicPropertyCopy = NULL;
+
+        for (propertyName = propertyNameList; propertyName;
+             propertyName = propertyName->_next) {
+            if (STREQ(propertyName->value, dynamicProperty->name))
+                break;
+        }
+
+        if (!propertyName)
+            continue;
+
+        if (esxVI_DynamicProperty_DeepCopy(&dynamicPropertyCopy,
+                                           dynamicProperty) < 0) {
+            goto failure;
+        }
+
+        if (esxVI_DynamicProperty_AppendToList(&copy->propSet,
+                                               dynamicPropertyCopy) < 0) {
+            esxVI_DynamicProperty_Free(&dynamicPropertyCopy);
+            goto failure;
+        }
+    }
+
+    if (esxVI_ObjectContent_AppendToList(virtualMachineList, copy) < 0)
+        goto failure;
+
+    return 0;
+
+ failure:
+    esxVI_ObjectContent_Free(&copy);
+
+    return -1;
+}
+
+
+
+/*
+ * Serves a lookup of the virtual machines of ctx->hostSystem, or of the one
+ * with @uuid among them, from the virtual machine cache.
+ *
+ * Returns 1 if the cache answered the lookup, 0 if it can't and the caller
+ * has to ask the server, or -1 on error.
+ */
+static int
+esxVI_VirtualMachineCache_Lookup(esxVI_Context *ctx,
+                                 const unsigned char *uuid,
+                                 esxVI_String *propertyNameList,
+                                 esxVI_ObjectContent **virtualMachineList)
+{
+    int result = -1;
+    esxVI_String *propertyName;
+    esxVI_ObjectContent *virtualMachine;
+
+    if (!ctx->vmCacheLock)
+        return 0;
+
+    for (propertyName = propertyNameList; propertyName;
+         propertyName = propertyName->_next) {
+        if (!esxVI_VirtualMachineCache_HasProperty(propertyName->value))
+            return 0;
+    }
+
+    virMutexLock(ctx->vmCacheLock);
+
+    if (ctx->vmCacheDisabled) {
+        result = 0;
+        goto cleanup;
+    }
+
+    if (esxVI_VirtualMachineCache_Refresh(ctx) < 0) {
+        VIR_WARN("Could not refresh the virtual machine cache, "
+                 "falling back to uncached lookups: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+        result = 0;
+        goto cleanup;
+    }
+
+    for (virtualMachine = ctx->vmCache; virtualMachine;
+         virtualMachine = virtualMachine->_next) {
+        if (uuid &&
+            !esxVI_VirtualMachineCache_MatchesUuid(virtualMachine, uuid)) {
+            continue;
+        }
+
+        if (esxVI_VirtualMachineCache_Copy(virtualMachine, propertyNameList,
+                                           virtualMachineList) < 0) {
+            esxVI_ObjectContent_Free(virtualMachineList);
+            goto cleanup;
+        }
+
+        if (uuid)
+            break;
+    }
+
+    result = 1;
+
+ cleanup:
+    virMutexUnlock(ctx->vmCacheLock);
+
+    return result;
+}
+
+
+
 int
 esxVI_LookupVirtualMachineList(esxVI_Context *ctx,
                                esxVI_String *propertyNameList,
                                esxVI_ObjectContent **virtualMachineList)
 {
+    int rc;
+
+    ESX_VI_CHECK_ARG_LIST(virtualMachineList);
+
+    if ((rc = esxVI_VirtualMachineCache_Lookup(ctx, NULL, propertyNameList,
+                                               virtualMachineList)) != 0) {
+        return rc < 0 ? -1 : 0;
+    }
+
     /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
      *        for cluster support */
     return esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
@@ -2700,6 +3164,16 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
 
     ESX_VI_CHECK_ARG_LIST(virtualMachine);
 
+    /* Virtual machines outside of ctx->hostSystem are not cached, so a miss
+     * still has to be looked up on the server */
+    if (esxVI_VirtualMachineCache_Lookup(ctx, uuid, propertyNameList,
+                                         virtualMachine) < 0) {
+        return -1;
+    }
+
+    if (*virtualMachine)
+        return 0;
+
     virUUIDFormat(uuid, uuid_string);
 
     if (esxVI_FindByUuid(ctx, ctx->datacenter->_reference, uuid_string,
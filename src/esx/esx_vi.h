@@ -200,6 +200,11 @@ struct _esxVI_Context {
     esxVI_SelectionSpec *selectSet_datacenterToNetwork;
     bool hasQueryVirtualDiskUuid;
     bool hasSessionIsActive;
+    virMutex *vmCacheLock; /* protects the virtual machine cache below */
+    esxVI_ManagedObjectReference *vmCacheFilter;
+    char *vmCacheVersion;
+    esxVI_ObjectContent *vmCache;
+    bool vmCacheDisabled;
 };
 
 int esxVI_Context_Alloc(esxVI_Context **ctx);
@@ -84,7 +84,7 @@ hypervGetActiveVirtualSystemList(hypervPrivate *priv,
 {
     g_auto(virBuffer) query = { g_string_new(MSVM_COMPUTERSYSTEM_WQL_SELECT
                                              "WHERE " MSVM_COMPUTERSYSTEM_WQL_VIRTUAL
-                                             "AND " MSVM_COMPUTERSYSTEM_WQL_ACTIVE), 0 };
+                                             "AND " MSVM_COMPUTERSYSTEM_WQL_ACTIVE), 0, false };
 
     if (hypervGetWmiClass(Msvm_ComputerSystem, computerSystemList) < 0)
         return -1;
@@ -106,7 +106,7 @@ hypervGetInactiveVirtualSystemList(hypervPrivate *priv,
 {
     g_auto(virBuffer) query = { g_string_new(MSVM_COMPUTERSYSTEM_WQL_SELECT
                                              "WHERE " MSVM_COMPUTERSYSTEM_WQL_VIRTUAL
-                                             "AND " MSVM_COMPUTERSYSTEM_WQL_INACTIVE), 0 };
+                                             "AND " MSVM_COMPUTERSYSTEM_WQL_INACTIVE), 0, false };
 
     if (hypervGetWmiClass(Msvm_ComputerSystem, computerSystemList) < 0)
         return -1;
@@ -125,7 +125,7 @@ static int
 hypervGetPhysicalSystemList(hypervPrivate *priv,
                             Win32_ComputerSystem **computerSystemList)
 {
-    g_auto(virBuffer) query = { g_string_new(WIN32_COMPUTERSYSTEM_WQL_SELECT), 0 };
+    g_auto(virBuffer) query = { g_string_new(WIN32_COMPUTERSYSTEM_WQL_SELECT), 0, false };
 
     if (hypervGetWmiClass(Win32_ComputerSystem, computerSystemList) < 0)
         return -1;
@@ -190,7 +190,7 @@ hypervGetVirtualSystemByName(hypervPrivate *priv, const char *name,
 static int
 hypervGetOperatingSystem(hypervPrivate *priv, Win32_OperatingSystem **operatingSystem)
 {
-    g_auto(virBuffer) query = { g_string_new(WIN32_OPERATINGSYSTEM_WQL_SELECT), 0 };
+    g_auto(virBuffer) query = { g_string_new(WIN32_OPERATINGSYSTEM_WQL_SELECT), 0, false };
 
     if (hypervGetWmiClass(Win32_OperatingSystem, operatingSystem) < 0)
         return -1;
@@ -243,7 +243,7 @@ static int
 hypervLookupHostSystemBiosUuid(hypervPrivate *priv, unsigned char *uuid)
 {
     g_autoptr(Win32_ComputerSystemProduct) computerSystem = NULL;
-    g_auto(virBuffer) query = { g_string_new(WIN32_COMPUTERSYSTEMPRODUCT_WQL_SELECT), 0 };
+    g_auto(virBuffer) query = { g_string_new(WIN32_COMPUTERSYSTEMPRODUCT_WQL_SELECT), 0, false };
 
     if (hypervGetWmiClass(Win32_ComputerSystemProduct, &computerSystem) < 0)
         return -1;
@@ -105,7 +105,7 @@ hypervConnectListAllNetworks(virConnectPtr conn,
     size_t count = 0;
     size_t i;
     g_auto(virBuffer) query = { g_string_new(MSVM_VIRTUALETHERNETSWITCH_WQL_SELECT
-                                             "WHERE HealthState = 5"), 0 };
+                                             "WHERE HealthState = 5"), 0, false };
     g_autoptr(Msvm_VirtualEthernetSwitch) switches = NULL;
     Msvm_VirtualEthernetSwitch *entry = NULL;
 
@@ -644,3 +644,194 @@ virDomainDriverGetIOThreadsConfig(virDomainDef *targetDef,
 
     return ret;
 }
+
+
+/*
+ * Statistics cursor used to implement
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED. It remembers the last
+ * set of statistics reported for each domain so that subsequent
+ * calls can report only the parameters whose value changed.
+ */
+struct _virDomainDriverStatsCursor {
+    virMutex lock;
+
+    /* UUID string -> virDomainDriverStatsCursorEntry */
+    GHashTable *domains;
+};
+
+typedef struct _virDomainDriverStatsCursorEntry virDomainDriverStatsCursorEntry;
+struct _virDomainDriverStatsCursorEntry {
+    virTypedParameterPtr params;
+    int nparams;
+    bool seen;
+};
+
+
+static void
+virDomainDriverStatsCursorEntryFree(void *opaque)
+{
+    virDomainDriverStatsCursorEntry *entry = opaque;
+
+    virTypedParamsFree(entry->params, entry->nparams);
+    g_free(entry);
+}
+
+
+virDomainDriverStatsCursor *
+virDomainDriverStatsCursorNew(void)
+{
+    virDomainDriverStatsCursor *cursor = g_new0(virDomainDriverStatsCursor, 1);
+
+    if (virMutexInit(&cursor->lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        g_free(cursor);
+        return NULL;
+    }
+
+    cursor->domains = virHashNew(virDomainDriverStatsCursorEntryFree);
+
+    return cursor;
+}
+
+
+void
+virDomainDriverStatsCursorFree(virDomainDriverStatsCursor *cursor)
+{
+    if (!cursor)
+        return;
+
+    g_hash_table_unref(cursor->domains);
+    virMutexDestroy(&cursor->lock);
+    g_free(cursor);
+}
+
+
+static bool
+virDomainDriverStatsParamEqual(virTypedParameterPtr a,
+                               virTypedParameterPtr b)
+{
+    if (a->type != b->type || STRNEQ(a->field, b->field))
+        return false;
+
+    switch ((virTypedParameterType) a->type) {
+    case VIR_TYPED_PARAM_INT:
+        return a->value.i == b->value.i;
+    case VIR_TYPED_PARAM_UINT:
+        return a->value.ui == b->value.ui;
+    case VIR_TYPED_PARAM_LLONG:
+        return a->value.l == b->value.l;
+    case VIR_TYPED_PARAM_ULLONG:
+        return a->value.ul == b->value.ul;
+    case VIR_TYPED_PARAM_DOUBLE:
+        return memcmp(&a->value.d, &b->value.d, sizeof(a->value.d)) == 0;
+    case VIR_TYPED_PARAM_BOOLEAN:
+        return a->value.b == b->value.b;
+    case VIR_TYPED_PARAM_STRING:
+        return STREQ_NULLABLE(a->value.s, b->value.s);
+    case VIR_TYPED_PARAM_LAST:
+        break;
+    }
+
+    return false;
+}
+
+
+/*
+ * Returns true if @param was reported with the same value in @entry.
+ * Statistics are usually reported in the same order each time, so the
+ * search starts at *@hint, which is updated to point after the match.
+ */
+static bool
+virDomainDriverStatsParamUnchanged(virDomainDriverStatsCursorEntry *entry,
+                                   virTypedParameterPtr param,
+                                   size_t *hint)
+{
+    size_t i;
+
+    for (i = 0; i < entry->nparams; i++) {
+        size_t idx = (*hint + i) % entry->nparams;
+
+        if (STRNEQ(entry->params[idx].field, param->field))
+            continue;
+
+        *hint = idx + 1;
+        return virDomainDriverStatsParamEqual(&entry->params[idx], param);
+    }
+
+    return false;
+}
+
+
+/**
+ * virDomainDriverStatsCursorApply:
+ * @cursor: statistics cursor
+ * @records: statistics records to be returned to the caller
+ * @nrecords: number of @records
+ * @prune: forget domains not present in @records
+ *
+ * Removes parameters whose value did not change since the previous
+ * call from each of @records and remembers the current values for
+ * the next call. Records of domains first seen by @cursor are left
+ * untouched. If @prune is true, which is the case when @records are
+ * statistics for all domains the caller can see, domains not
+ * present in @records are forgotten and reported in full once they
+ * appear again.
+ */
+void
+virDomainDriverStatsCursorApply(virDomainDriverStatsCursor *cursor,
+                                virDomainStatsRecordPtr *records,
+                                int nrecords,
+                                bool prune)
+{
+    GHashTableIter htitr;
+    void *value;
+    size_t i;
+
+    virMutexLock(&cursor->lock);
+
+    for (i = 0; i < nrecords; i++) {
+        virDomainStatsRecordPtr rec = records[i];
+        virDomainDriverStatsCursorEntry *entry;
+        virDomainDriverStatsCursorEntry *newEntry;
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+        size_t hint = 0;
+        size_t j;
+        int n = 0;
+
+        virUUIDFormat(rec->dom->uuid, uuidstr);
+
+        newEntry = g_new0(virDomainDriverStatsCursorEntry, 1);
+        ignore_value(virTypedParamsCopy(&newEntry->params, rec->params,
+                                        rec->nparams));
+        newEntry->nparams = rec->nparams;
+        newEntry->seen = true;
+
+        if ((entry = g_hash_table_lookup(cursor->domains, uuidstr))) {
+            for (j = 0; j < rec->nparams; j++) {
+                if (virDomainDriverStatsParamUnchanged(entry, &rec->params[j],
+                                                       &hint)) {
+                    virTypedParamsClear(&rec->params[j], 1);
+                    continue;
+                }
+
+                rec->params[n++] = rec->params[j];
+            }
+
+            rec->nparams = n;
+        }
+
+        g_hash_table_insert(cursor->domains, g_strdup(uuidstr), newEntry);
+    }
+
+    g_hash_table_iter_init(&htitr, cursor->domains);
+    while (g_hash_table_iter_next(&htitr, NULL, &value)) {
+        virDomainDriverStatsCursorEntry *entry = value;
+
+        if (prune && !entry->seen)
+            g_hash_table_iter_remove(&htitr);
+        else
+            entry->seen = false;
+    }
+
+    virMutexUnlock(&cursor->lock);
+}
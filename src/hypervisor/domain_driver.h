@@ -70,3 +70,14 @@ int virDomainDriverDelIOThreadCheck(virDomainDef *def,
 int virDomainDriverGetIOThreadsConfig(virDomainDef *targetDef,
                                       virDomainIOThreadInfoPtr **info,
                                       unsigned int bitmap_size);
+
+typedef struct _virDomainDriverStatsCursor virDomainDriverStatsCursor;
+
+virDomainDriverStatsCursor *virDomainDriverStatsCursorNew(void);
+void virDomainDriverStatsCursorFree(virDomainDriverStatsCursor *cursor);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainDriverStatsCursor, virDomainDriverStatsCursorFree);
+
+void virDomainDriverStatsCursorApply(virDomainDriverStatsCursor *cursor,
+                                     virDomainStatsRecordPtr *records,
+                                     int nrecords,
+                                     bool prune);
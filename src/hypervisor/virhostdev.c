@@ -34,6 +34,7 @@
 #include "virlog.h"
 #include "virutil.h"
 #include "virnetdev.h"
+#include "virthread.h"
 #include "configmake.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -621,6 +622,77 @@ virHostdevResetAllPCIDevices(virHostdevManager *mgr,
     return ret;
 }
 
+static void
+virHostdevBindPCIDeviceToStubThread(void *opaque)
+{
+    virPCIDevice *pci = opaque;
+
+    /* Passing no lists makes this only (probe and) bind the stub
+     * driver, which is safe to do for unrelated devices at once */
+    if (virPCIDeviceDetach(pci, NULL, NULL) < 0) {
+        VIR_DEBUG("Failed to bind PCI device %s to stub driver: %s",
+                  virPCIDeviceGetName(pci), virGetLastErrorMessage());
+        virResetLastError();
+    }
+}
+
+
+/*
+ * Binding a device to its stub driver first unbinds it from its host
+ * driver, which for some devices (e.g. GPUs) takes a long time. Do
+ * that for all managed devices concurrently. Failures are ignored
+ * here; the caller detaches each device afterwards anyway, which is a
+ * no-op for devices bound already and reports errors properly for
+ * the rest.
+ */
+static void
+virHostdevBindAllPCIDevicesToStub(virHostdevManager *mgr,
+                                  virPCIDeviceList *pcidevs)
+{
+    size_t n = virPCIDeviceListCount(pcidevs);
+    g_autofree virThread *threads = g_new0(virThread, n);
+    g_autofree bool *started = g_new0(bool, n);
+    size_t nmanaged = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        virPCIDevice *pci = virPCIDeviceListGet(pcidevs, i);
+
+        if (virPCIDeviceGetManaged(pci) &&
+            !virPCIDeviceListFind(mgr->activePCIHostdevs,
+                                  virPCIDeviceGetAddress(pci)))
+            nmanaged++;
+    }
+
+    if (nmanaged < 2)
+        return;
+
+    for (i = 0; i < n; i++) {
+        virPCIDevice *pci = virPCIDeviceListGet(pcidevs, i);
+
+        if (!virPCIDeviceGetManaged(pci) ||
+            virPCIDeviceListFind(mgr->activePCIHostdevs,
+                                 virPCIDeviceGetAddress(pci)))
+            continue;
+
+        if (virThreadCreateFull(&threads[i], true,
+                                virHostdevBindPCIDeviceToStubThread,
+                                "hostdev-bind", false, pci) < 0) {
+            VIR_DEBUG("Failed to spawn thread binding PCI device %s",
+                      virPCIDeviceGetName(pci));
+            continue;
+        }
+
+        started[i] = true;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (started[i])
+            virThreadJoin(&threads[i]);
+    }
+}
+
+
 static void
 virHostdevReattachAllPCIDevices(virHostdevManager *mgr,
                                 virPCIDeviceList *pcidevs)
@@ -732,6 +804,8 @@ virHostdevPreparePCIDevicesImpl(virHostdevManager *mgr,
 
     /* Step 2: detach managed devices and make sure unmanaged devices
      *         have already been taken care of */
+    virHostdevBindAllPCIDevicesToStub(mgr, pcidevs);
+
     for (i = 0; i < virPCIDeviceListCount(pcidevs); i++) {
         virPCIDevice *pci = virPCIDeviceListGet(pcidevs, i);
 
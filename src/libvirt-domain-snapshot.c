@@ -257,6 +257,113 @@ virDomainSnapshotCreateXML(virDomainPtr domain,
 }
 
 
+/**
+ * virDomainSnapshotCreateXMLGroup:
+ * @domains: array of domains to snapshot
+ * @ndomains: number of entries in @domains
+ * @xmlDescs: array of @ndomains snapshot XML descriptions, one per domain
+ * @snapshots: optional array of @ndomains entries to be filled with the
+ *             created snapshots
+ * @flags: bitwise-OR of supported virDomainSnapshotCreateFlags
+ *
+ * Creates a disk snapshot of each domain in @domains as described by the
+ * matching entry in @xmlDescs, in the same way virDomainSnapshotCreateXML()
+ * does, but the point in time captured by the snapshots is the same for
+ * all the domains.  This is useful for applications whose state is spread
+ * across several guests, such as clustered databases.
+ *
+ * All domains have to belong to the same connection and each domain may
+ * appear only once in @domains.  @flags must include
+ * VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY; besides that
+ * VIR_DOMAIN_SNAPSHOT_CREATE_NO_METADATA,
+ * VIR_DOMAIN_SNAPSHOT_CREATE_REUSE_EXT, VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE,
+ * VIR_DOMAIN_SNAPSHOT_CREATE_ATOMIC and
+ * VIR_DOMAIN_SNAPSHOT_CREATE_VALIDATE are accepted and apply to every
+ * domain.  If VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE is used the file systems
+ * of all the running guests are frozen at the same time, the snapshots
+ * are taken and all the guests are thawed again, which keeps the time
+ * the guests are frozen independent of the number of domains.
+ *
+ * If the snapshot of any of the domains can't be prepared or any of the
+ * guests can't be frozen, no snapshot is taken at all.  Once the
+ * snapshots are being taken a failure of one domain doesn't undo the
+ * snapshots of the other domains; if this API fails, it is therefore
+ * necessary to follow up with virDomainSnapshotLookupByName() for each
+ * domain to determine whether its snapshot was created.
+ *
+ * On success, if @snapshots is not NULL, its entries are set to the
+ * snapshots of the respective domains which should be freed with
+ * virDomainSnapshotFree once they are no longer needed.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+virDomainSnapshotCreateXMLGroup(virDomainPtr *domains,
+                                unsigned int ndomains,
+                                const char **xmlDescs,
+                                virDomainSnapshotPtr *snapshots,
+                                unsigned int flags)
+{
+    virConnectPtr conn = NULL;
+    size_t i;
+
+    VIR_DEBUG("domains=%p, ndomains=%u, xmlDescs=%p, snapshots=%p, flags=0x%x",
+              domains, ndomains, xmlDescs, snapshots, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgGoto(domains, error);
+    virCheckNonNullArgGoto(xmlDescs, error);
+    virCheckNonZeroArgGoto(ndomains, error);
+
+    virCheckDomainGoto(domains[0], error);
+    conn = domains[0]->conn;
+
+    for (i = 0; i < ndomains; i++) {
+        virCheckDomainGoto(domains[i], error);
+        virCheckNonNullArgGoto(xmlDescs[i], error);
+
+        if (domains[i]->conn != conn) {
+            virReportError(VIR_ERR_INVALID_ARG, "%s",
+                           _("domains in 'domains' array must belong to a "
+                             "single connection"));
+            goto error;
+        }
+    }
+
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    VIR_REQUIRE_FLAG_GOTO(VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE,
+                          VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY,
+                          error);
+
+    if (!(flags & VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY)) {
+        virReportInvalidArg(flags, "%s",
+                            _("group snapshots require flag "
+                              "VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY"));
+        goto error;
+    }
+
+    if (snapshots)
+        memset(snapshots, 0, sizeof(*snapshots) * ndomains);
+
+    if (conn->driver->domainSnapshotCreateXMLGroup) {
+        int ret;
+        ret = conn->driver->domainSnapshotCreateXMLGroup(conn, domains, ndomains,
+                                                         xmlDescs, snapshots,
+                                                         flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virDomainSnapshotGetXMLDesc:
  * @snapshot: a domain snapshot object
@@ -154,6 +154,14 @@ virDomainGetConnect(virDomainPtr dom)
  * block attempts at migration. Hypervisors may also block save-to-file,
  * or snapshots.
  *
+ * If the VIR_DOMAIN_START_INCOMING flag is set, the guest domain is
+ * started paused and waits for an incoming migration of a domain with
+ * the same UUID and a compatible configuration. Such a domain is used
+ * by the Prepare phase of the migration instead of starting a new
+ * one, which removes the cost of starting the domain from the
+ * migration. The domain cannot be resumed until the migration
+ * finishes. Tunnelled and offline migrations do not use it.
+ *
  * virDomainFree should be used to free the resources after the
  * domain object is no longer needed.
  *
@@ -1525,6 +1533,164 @@ virDomainShutdownFlags(virDomainPtr domain, unsigned int flags)
 }
 
 
+/* Checks the arguments common to the APIs handling many domains at once */
+static int
+virConnectCheckDomainList(virConnectPtr conn,
+                          virDomainPtr *domains,
+                          unsigned int ndomains,
+                          int *results)
+{
+    size_t i;
+
+    virCheckNonNullArgGoto(domains, error);
+    virCheckNonZeroArgGoto(ndomains, error);
+
+    for (i = 0; i < ndomains; i++) {
+        virCheckDomainGoto(domains[i], error);
+
+        if (domains[i]->conn != conn) {
+            virReportError(VIR_ERR_INVALID_ARG, "%s",
+                           _("domains in 'domains' array must belong to "
+                             "the connection"));
+            goto error;
+        }
+    }
+
+    if (results)
+        memset(results, 0, sizeof(*results) * ndomains);
+
+    return 0;
+
+ error:
+    return -1;
+}
+
+
+/**
+ * virConnectStartDomains:
+ * @conn: pointer to the hypervisor connection
+ * @domains: array of domains to start
+ * @ndomains: number of entries in @domains
+ * @parallel: maximum number of domains started at the same time, or 0 to
+ *            let the hypervisor choose
+ * @results: optional array of @ndomains entries to be filled with the
+ *           outcome for each domain
+ * @flags: bitwise-OR of supported virDomainCreateFlags
+ *
+ * Launches all the defined domains in @domains, in the same way
+ * virDomainCreateWithFlags() does with @flags, but in a single call
+ * which starts up to @parallel domains at once. This is meant for
+ * starting many guests at host boot or after an evacuation without
+ * waiting for each domain in turn.
+ *
+ * Failing to start one domain doesn't stop the other domains from being
+ * started. If @results is not NULL, its entries are set to 0 for the
+ * domains which were started and to the virErrorNumber code of the
+ * failure for the others. The order in which the domains are started
+ * is undefined.
+ *
+ * Returns the number of domains which were started, or -1 if none of the
+ * domains were started because the call itself failed.
+ */
+int
+virConnectStartDomains(virConnectPtr conn,
+                       virDomainPtr *domains,
+                       unsigned int ndomains,
+                       unsigned int parallel,
+                       int *results,
+                       unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, domains=%p, ndomains=%u, parallel=%u, results=%p, "
+              "flags=0x%x",
+              conn, domains, ndomains, parallel, results, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (virConnectCheckDomainList(conn, domains, ndomains, results) < 0)
+        goto error;
+
+    if (conn->driver->connectStartDomains) {
+        int ret;
+        ret = conn->driver->connectStartDomains(conn, domains, ndomains,
+                                                parallel, results, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
+/**
+ * virConnectShutdownDomains:
+ * @conn: pointer to the hypervisor connection
+ * @domains: array of domains to shut down
+ * @ndomains: number of entries in @domains
+ * @parallel: maximum number of domains handled at the same time, or 0 to
+ *            let the hypervisor choose
+ * @results: optional array of @ndomains entries to be filled with the
+ *           outcome for each domain
+ * @flags: bitwise-OR of virDomainShutdownFlagValues
+ *
+ * Requests all the running domains in @domains to shut down, in the same
+ * way virDomainShutdownFlags() does with @flags, but in a single call
+ * which handles up to @parallel domains at once. Like
+ * virDomainShutdownFlags(), this returns as soon as the requests are
+ * issued and the guest OS may ignore them.
+ *
+ * Failing to shut down one domain doesn't stop the requests to the other
+ * domains. If @results is not NULL, its entries are set to 0 for the
+ * domains which were requested to shut down and to the virErrorNumber
+ * code of the failure for the others.
+ *
+ * Returns the number of domains which were requested to shut down, or -1
+ * if none of the domains were handled because the call itself failed.
+ */
+int
+virConnectShutdownDomains(virConnectPtr conn,
+                          virDomainPtr *domains,
+                          unsigned int ndomains,
+                          unsigned int parallel,
+                          int *results,
+                          unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, domains=%p, ndomains=%u, parallel=%u, results=%p, "
+              "flags=0x%x",
+              conn, domains, ndomains, parallel, results, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (virConnectCheckDomainList(conn, domains, ndomains, results) < 0)
+        goto error;
+
+    if (conn->driver->connectShutdownDomains) {
+        int ret;
+        ret = conn->driver->connectShutdownDomains(conn, domains, ndomains,
+                                                   parallel, results, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virDomainReboot:
  * @domain: a domain object
@@ -2576,6 +2742,13 @@ virDomainGetControlInfo(virDomainPtr domain,
  * XML might not validate against the schema, so it is mainly for
  * internal use.
  *
+ * Clients interested only in some parts of a large definition can use
+ * the VIR_DOMAIN_XML_SECTION_* flags, in which case the XML contains the
+ * name and UUID of the domain followed only by the requested sections,
+ * with any devices enclosed in a <devices> element.  Such XML can not be
+ * used to define the domain.  Servers predating these flags (before
+ * 7.10.0) reject them with VIR_ERR_INVALID_ARG.
+ *
  * Returns a 0 terminated UTF-8 encoded XML instance, or NULL in case
  * of error. The caller must free() the returned value.
  */
@@ -8652,6 +8825,117 @@ virDomainDetachDeviceAlias(virDomainPtr domain,
     return -1;
 }
 
+/**
+ * virDomainAttachDevices:
+ * @domain: pointer to domain object
+ * @xmls: list of XML descriptions of one device each
+ * @nxmls: the number of device descriptions in @xmls
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Attach several virtual devices to a domain at once. The semantics of
+ * @flags and of the device descriptions are the same as for
+ * virDomainAttachDeviceFlags(), which this API is equivalent to calling for
+ * every element of @xmls in order. Hypervisor drivers may however validate
+ * all the devices before attaching any of them and save the state of the
+ * domain just once, which makes attaching many devices considerably cheaper.
+ *
+ * If attaching a device to the running domain fails, the devices preceding
+ * it in @xmls may remain attached while the following ones are not
+ * processed. The persistent configuration is changed only if all the devices
+ * were attached successfully.
+ *
+ * Returns 0 in case of success, -1 in case of failure.
+ */
+int
+virDomainAttachDevices(virDomainPtr domain,
+                       const char **xmls,
+                       unsigned int nxmls,
+                       unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "xmls=%p, nxmls=%u, flags=0x%x",
+                     xmls, nxmls, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    virCheckNonNullArgGoto(xmls, error);
+    virCheckNonZeroArgGoto(nxmls, error);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (conn->driver->domainAttachDevices) {
+        int ret;
+        ret = conn->driver->domainAttachDevices(domain, xmls, nxmls, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+/**
+ * virDomainDetachDevices:
+ * @domain: pointer to domain object
+ * @xmls: list of XML descriptions of one device each
+ * @nxmls: the number of device descriptions in @xmls
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Detach several virtual devices from a domain at once. The semantics of
+ * @flags and of the device descriptions are the same as for
+ * virDomainDetachDeviceFlags(), which this API is equivalent to calling for
+ * every element of @xmls in order, including the possibly asynchronous
+ * removal of the devices from the running domain.
+ *
+ * If detaching a device from the running domain fails, the devices preceding
+ * it in @xmls may have been detached while the following ones are not
+ * processed. The persistent configuration is changed only if all the devices
+ * were detached successfully.
+ *
+ * Returns 0 in case of success, -1 in case of failure.
+ */
+int
+virDomainDetachDevices(virDomainPtr domain,
+                       const char **xmls,
+                       unsigned int nxmls,
+                       unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "xmls=%p, nxmls=%u, flags=0x%x",
+                     xmls, nxmls, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    virCheckNonNullArgGoto(xmls, error);
+    virCheckNonZeroArgGoto(nxmls, error);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (conn->driver->domainDetachDevices) {
+        int ret;
+        ret = conn->driver->domainDetachDevices(domain, xmls, nxmls, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
 
 /**
  * virConnectDomainEventRegister:
@@ -8962,6 +9246,12 @@ virDomainGetJobInfo(virDomainPtr domain, virDomainJobInfoPtr info)
  * obtained by listening to a VIR_DOMAIN_EVENT_ID_JOB_COMPLETED event (on the
  * source host in case of a migration job).
  *
+ * When @flags contains VIR_DOMAIN_JOB_STATS_LOCK, the function returns
+ * statistics of how long callers waited for and held each type of job on
+ * the domain instead, using fields starting with VIR_DOMAIN_JOB_LOCK_PREFIX,
+ * and @type is set to VIR_DOMAIN_JOB_NONE. These statistics are available
+ * for inactive domains as well.
+ *
  * Returns 0 in case of success and -1 in case of failure.
  */
 int
@@ -8985,6 +9275,9 @@ virDomainGetJobStats(virDomainPtr domain,
     VIR_REQUIRE_FLAG_GOTO(VIR_DOMAIN_JOB_STATS_KEEP_COMPLETED,
                           VIR_DOMAIN_JOB_STATS_COMPLETED,
                           error);
+    VIR_EXCLUSIVE_FLAGS_GOTO(VIR_DOMAIN_JOB_STATS_LOCK,
+                             VIR_DOMAIN_JOB_STATS_COMPLETED,
+                             error);
 
     conn = domain->conn;
 
@@ -11705,6 +11998,14 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  *                          instead of running. Exposed to the VM as a steal
  *                          time.
  *
+ *     This group may also contain hypervisor specific statistics of the
+ *     vCPU <num>, e.g. as reported by KVM. Their names are in the form
+ *     "vcpu.<num>.<name>.<suffix>" where <suffix> is "sum" for cumulative
+ *     counters, "cur" for instantaneous values and "max" for peak values,
+ *     all as unsigned long long. Boolean statistics are reported as
+ *     "vcpu.<num>.<name>" as boolean. The set of <name>s available depends
+ *     on the hypervisor and host kernel and is not guaranteed to be stable.
+ *
  * VIR_DOMAIN_STATS_INTERFACE:
  *     Return network interface statistics (from domain point of view).
  *     The typed parameter keys are in this format:
@@ -11908,6 +12209,76 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  *     "dirtyrate.megabytes_per_second" - the calculated memory dirty rate in
  *                                        MiB/s as long long. It is produced
  *                                        only if the calc_status is measured.
+ *     "dirtyrate.calc_mode" - the calculation mode used last measurement, either
+ *                             of these 3 'page-sampling,dirty-bitmap,dirty-ring'
+ *                             values returned.
+ *     "dirtyrate.vcpu.<num>.megabytes_per_second" - the calculated memory dirty
+ *                                                   rate for a virtual cpu as
+ *                                                   unsigned long long. It is
+ *                                                   produced only if the
+ *                                                   calc_mode is dirty-ring.
+ *
+ * VIR_DOMAIN_STATS_VM:
+ *     Return hypervisor specific statistics of the VM as a whole, e.g. as
+ *     reported by KVM. The typed parameter keys are in this format:
+ *
+ *     "vm.<name>.sum" - cumulative counter <name> as unsigned long long
+ *     "vm.<name>.cur" - instantaneous value <name> as unsigned long long
+ *     "vm.<name>.max" - peak value <name> as unsigned long long
+ *     "vm.<name>" - boolean statistic <name> as boolean
+ *
+ *     The set of <name>s available depends on the hypervisor and host kernel
+ *     and is not guaranteed to be stable.
+ *
+ * VIR_DOMAIN_STATS_MONITOR:
+ *     Return statistics of the commands libvirt issued on the monitor of the
+ *     hypervisor since the domain was started. The typed parameter keys are
+ *     in this format:
+ *
+ *     "monitor.pending" - number of commands waiting for a reply
+ *                         as unsigned int
+ *     "monitor.pending.time" - time in nanoseconds the oldest pending command
+ *                              has been waiting for its reply
+ *                              as unsigned long long
+ *     "monitor.command.count" - number of commands reported as unsigned int
+ *     "monitor.command.<num>.name" - name of the command as string
+ *     "monitor.command.<num>.calls" - number of times the command was issued
+ *                                     as unsigned long long
+ *     "monitor.command.<num>.errors" - number of calls which failed
+ *                                      as unsigned long long
+ *     "monitor.command.<num>.time" - total time in nanoseconds spent waiting
+ *                                    for replies as unsigned long long
+ *     "monitor.command.<num>.time.max" - longest time in nanoseconds spent
+ *                                        waiting for a reply
+ *                                        as unsigned long long
+ *     "monitor.command.<num>.latency.<bucket>" - number of calls which were
+ *                                                replied to within <bucket>
+ *                                                as unsigned long long.
+ *                                                The buckets are "1ms",
+ *                                                "10ms", "100ms", "1s", "10s"
+ *                                                and "inf", each call is
+ *                                                counted in one bucket only.
+ *     "monitor.command.<num>.bytes.sent" - bytes sent as unsigned long long
+ *     "monitor.command.<num>.bytes.received" - bytes received
+ *                                              as unsigned long long
+ *
+ * VIR_DOMAIN_STATS_BLOCKJOB:
+ *     Return the progress of all block jobs running on disks of the domain,
+ *     queried from the hypervisor at once. The typed parameter keys are in
+ *     this format:
+ *
+ *     "blockjob.count" - number of block jobs reported as unsigned int
+ *     "blockjob.<num>.disk" - target name of the disk the job runs on
+ *                             as string
+ *     "blockjob.<num>.type" - type of the job as int, one of
+ *                             virDomainBlockJobType
+ *     "blockjob.<num>.cur" - current position of the job
+ *                            as unsigned long long
+ *     "blockjob.<num>.end" - end position of the job as unsigned long long
+ *     "blockjob.<num>.bandwidth" - bandwidth limit of the job in bytes per
+ *                                  second as unsigned long long
+ *     "blockjob.<num>.ready" - whether the job is ready to be pivoted or
+ *                              finished as boolean
  *
  * Note that entire stats groups or individual stat fields may be missing from
  * the output in case they are not supported by the given hypervisor, are not
@@ -11931,6 +12302,13 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED in @flags makes
+ * the hypervisor remember the statistics reported on this connection
+ * and report only those typed parameters whose value changed since
+ * the previous call with this flag. Statistics of domains which were
+ * not reported by the previous call are reported in full. Callers
+ * are expected to keep the last known value of every parameter.
+ *
  * Similarly to virConnectListAllDomains, @flags can contain various flags to
  * filter the list of domains to provide stats for.
  *
@@ -12021,6 +12399,13 @@ virConnectGetAllDomainStats(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED in @flags makes
+ * the hypervisor remember the statistics reported on this connection
+ * and report only those typed parameters whose value changed since
+ * the previous call with this flag. Statistics of domains which were
+ * not reported by the previous call are reported in full. Callers
+ * are expected to keep the last known value of every parameter.
+ *
  * Note that any of the domain list filtering flags in @flags may be rejected
  * by this function.
  *
@@ -12115,6 +12500,63 @@ virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats)
 }
 
 
+/**
+ * virConnectDomainStatsSubscribe:
+ * @conn: pointer to the hypervisor connection
+ * @stats: stats to deliver, binary-OR of virDomainStatsTypes
+ * @interval: number of seconds between two deliveries, 0 to unsubscribe
+ * @flags: extra flags; binary-OR of virConnectGetAllDomainStatsFlags
+ *
+ * Asks the hypervisor to periodically collect statistics of all domains
+ * and deliver them to this connection as VIR_DOMAIN_EVENT_ID_STATS events
+ * instead of having the application poll virConnectGetAllDomainStats.
+ * One event is emitted for each domain every @interval seconds, carrying
+ * the same typed parameters virConnectGetAllDomainStats would report for
+ * @stats and @flags. The application has to register a callback for
+ * VIR_DOMAIN_EVENT_ID_STATS via virConnectDomainEventRegisterAny to
+ * receive them.
+ *
+ * A connection has at most one subscription; calling this function again
+ * replaces it, calling it with @interval set to 0 cancels it. The
+ * subscription is cancelled automatically when the connection is closed.
+ *
+ * The hypervisor is free to collect statistics for several subscribers at
+ * once, therefore statistics delivered to different connections may be
+ * identical even though they were requested at different times.
+ *
+ * Hypervisors may reject some of @flags, in particular
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED is not supported.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virConnectDomainStatsSubscribe(virConnectPtr conn,
+                               unsigned int stats,
+                               unsigned int interval,
+                               unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, stats=0x%x, interval=%u, flags=0x%x",
+              conn, stats, interval, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+
+    if (conn->driver->connectDomainStatsSubscribe) {
+        if (conn->driver->connectDomainStatsSubscribe(conn, stats, interval,
+                                                      flags) < 0)
+            goto error;
+        return 0;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virDomainGetFSInfo:
  * @dom: a domain object
@@ -13203,12 +13645,20 @@ virDomainGetMessages(virDomainPtr domain,
  * virDomainStartDirtyRateCalc:
  * @domain: a domain object
  * @seconds: specified calculating time in seconds
- * @flags: extra flags; not used yet, so callers should always pass 0
+ * @flags: bitwise-OR of supported virDomainDirtyRateCalcFlags
  *
  * Calculate the current domain's memory dirty rate in next @seconds.
  * The calculated dirty rate information is available by calling
  * virConnectGetAllDomainStats.
  *
+ * By default the rate is estimated by sampling and hashing a subset of the
+ * guest pages (VIR_DOMAIN_DIRTYRATE_MODE_PAGE_SAMPLING). With
+ * VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP the hypervisor tracks dirty pages
+ * with its dirty bitmap instead, which costs no guest CPU time but has to
+ * be supported by the hypervisor. VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING uses
+ * the KVM dirty ring, which has to be enabled for the domain, and provides
+ * the dirty rate of every vCPU. The modes are mutually exclusive.
+ *
  * Returns 0 in case of success, -1 otherwise.
  */
 int
@@ -13241,3 +13691,343 @@ virDomainStartDirtyRateCalc(virDomainPtr domain,
     virDispatchError(conn);
     return -1;
 }
+
+
+/**
+ * virDomainBatchNew:
+ * @conn: pointer to the hypervisor connection
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Creates an empty batch of domain queries. Queries are added to the
+ * batch with virDomainBatchAddGetInfo, virDomainBatchAddGetState and
+ * virDomainBatchAddGetBlockInfo, and are all run at once by
+ * virDomainBatchRun. When talking to a remote daemon the whole batch
+ * is transferred in a single round trip, which makes polling a large
+ * number of domains considerably cheaper than issuing each query by
+ * itself.
+ *
+ * Returns a new batch which must be released with virDomainBatchFree,
+ * or NULL in case of failure.
+ */
+virDomainBatchPtr
+virDomainBatchNew(virConnectPtr conn,
+                  unsigned int flags)
+{
+    virDomainBatchPtr batch;
+
+    VIR_DEBUG("conn=%p, flags=0x%x", conn, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, NULL);
+
+    if (flags != 0) {
+        virReportInvalidArg(flags, _("unsupported flags (0x%x) in function %s"),
+                            flags, __FUNCTION__);
+        virDispatchError(conn);
+        return NULL;
+    }
+
+    batch = g_new0(virDomainBatch, 1);
+    batch->conn = virObjectRef(conn);
+
+    return batch;
+}
+
+
+static virDomainBatchCall *
+virDomainBatchAdd(virDomainBatchPtr batch,
+                  virDomainPtr domain,
+                  virDomainBatchCallType type)
+{
+    virDomainBatchCall *call;
+
+    if (domain->conn != batch->conn) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("domain does not belong to the connection of the batch"));
+        return NULL;
+    }
+
+    VIR_EXPAND_N(batch->calls, batch->ncalls, 1);
+    call = &batch->calls[batch->ncalls - 1];
+    call->type = type;
+    call->domain = virObjectRef(domain);
+
+    return call;
+}
+
+
+/**
+ * virDomainBatchAddGetInfo:
+ * @batch: a batch of domain queries
+ * @domain: a domain object
+ * @info: pointer to a virDomainInfo structure allocated by the user
+ *
+ * Queues a call equivalent to virDomainGetInfo to @batch. @info must
+ * stay valid until virDomainBatchRun returns, which is when it gets
+ * filled in.
+ *
+ * Returns the index of the call within @batch, or -1 in case of failure.
+ */
+int
+virDomainBatchAddGetInfo(virDomainBatchPtr batch,
+                         virDomainPtr domain,
+                         virDomainInfoPtr info)
+{
+    virDomainBatchCall *call;
+
+    VIR_DOMAIN_DEBUG(domain, "batch=%p, info=%p", batch, info);
+
+    virResetLastError();
+
+    virCheckNonNullArgReturn(batch, -1);
+    virCheckDomainReturn(domain, -1);
+    virCheckNonNullArgGoto(info, error);
+
+    if (!(call = virDomainBatchAdd(batch, domain,
+                                   VIR_DOMAIN_BATCH_CALL_GET_INFO)))
+        goto error;
+
+    call->info = info;
+
+    return batch->ncalls - 1;
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
+/**
+ * virDomainBatchAddGetState:
+ * @batch: a batch of domain queries
+ * @domain: a domain object
+ * @state: returned state of the domain (one of virDomainState)
+ * @reason: returned reason which led to @state (one of virDomain*Reason
+ * corresponding to the current state); it is allowed to be NULL
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Queues a call equivalent to virDomainGetState to @batch. @state and
+ * @reason must stay valid until virDomainBatchRun returns, which is when
+ * they get filled in.
+ *
+ * Returns the index of the call within @batch, or -1 in case of failure.
+ */
+int
+virDomainBatchAddGetState(virDomainBatchPtr batch,
+                          virDomainPtr domain,
+                          int *state,
+                          int *reason,
+                          unsigned int flags)
+{
+    virDomainBatchCall *call;
+
+    VIR_DOMAIN_DEBUG(domain, "batch=%p, state=%p, reason=%p, flags=0x%x",
+                     batch, state, reason, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgReturn(batch, -1);
+    virCheckDomainReturn(domain, -1);
+    virCheckNonNullArgGoto(state, error);
+
+    if (!(call = virDomainBatchAdd(batch, domain,
+                                   VIR_DOMAIN_BATCH_CALL_GET_STATE)))
+        goto error;
+
+    call->state = state;
+    call->reason = reason;
+    call->flags = flags;
+
+    return batch->ncalls - 1;
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
+/**
+ * virDomainBatchAddGetBlockInfo:
+ * @batch: a batch of domain queries
+ * @domain: a domain object
+ * @disk: path to the block device, or device shorthand
+ * @info: pointer to a virDomainBlockInfo structure allocated by the user
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Queues a call equivalent to virDomainGetBlockInfo to @batch. @info
+ * must stay valid until virDomainBatchRun returns, which is when it gets
+ * filled in.
+ *
+ * Returns the index of the call within @batch, or -1 in case of failure.
+ */
+int
+virDomainBatchAddGetBlockInfo(virDomainBatchPtr batch,
+                              virDomainPtr domain,
+                              const char *disk,
+                              virDomainBlockInfoPtr info,
+                              unsigned int flags)
+{
+    virDomainBatchCall *call;
+
+    VIR_DOMAIN_DEBUG(domain, "batch=%p, disk=%s, info=%p, flags=0x%x",
+                     batch, NULLSTR(disk), info, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgReturn(batch, -1);
+    virCheckDomainReturn(domain, -1);
+    virCheckNonNullArgGoto(disk, error);
+    virCheckNonNullArgGoto(info, error);
+
+    if (!(call = virDomainBatchAdd(batch, domain,
+                                   VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO)))
+        goto error;
+
+    call->disk = g_strdup(disk);
+    call->blockInfo = info;
+    call->flags = flags;
+
+    return batch->ncalls - 1;
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
+static void
+virDomainBatchRunCall(virDomainBatchCall *call)
+{
+    int rc = -1;
+
+    switch (call->type) {
+    case VIR_DOMAIN_BATCH_CALL_GET_INFO:
+        rc = virDomainGetInfo(call->domain, call->info);
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_STATE:
+        rc = virDomainGetState(call->domain, call->state,
+                               call->reason, call->flags);
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO:
+        rc = virDomainGetBlockInfo(call->domain, call->disk,
+                                   call->blockInfo, call->flags);
+        break;
+    }
+
+    if (rc < 0)
+        call->error = virSaveLastError();
+}
+
+
+/**
+ * virDomainBatchRun:
+ * @batch: a batch of domain queries
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Runs all calls queued to @batch. The calls are independent of each
+ * other, a failure of one of them does not prevent the rest from being
+ * run. The error of an individual call can be retrieved with
+ * virDomainBatchGetError. A batch can be run repeatedly, for instance
+ * to poll the same set of domains periodically.
+ *
+ * Returns the number of calls which failed, or -1 if the batch could
+ * not be run at all.
+ */
+int
+virDomainBatchRun(virDomainBatchPtr batch,
+                  unsigned int flags)
+{
+    virConnectPtr conn;
+    size_t i;
+    int ret = 0;
+
+    VIR_DEBUG("batch=%p, flags=0x%x", batch, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgReturn(batch, -1);
+    conn = batch->conn;
+
+    for (i = 0; i < batch->ncalls; i++)
+        g_clear_pointer(&batch->calls[i].error, virFreeError);
+
+    if (conn->driver->domainBatchRun) {
+        if (conn->driver->domainBatchRun(conn, batch->calls,
+                                         batch->ncalls, flags) < 0)
+            goto error;
+    } else {
+        if (flags != 0) {
+            virReportInvalidArg(flags,
+                                _("unsupported flags (0x%x) in function %s"),
+                                flags, __FUNCTION__);
+            goto error;
+        }
+
+        for (i = 0; i < batch->ncalls; i++)
+            virDomainBatchRunCall(&batch->calls[i]);
+        virResetLastError();
+    }
+
+    for (i = 0; i < batch->ncalls; i++) {
+        if (batch->calls[i].error)
+            ret++;
+    }
+
+    return ret;
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
+/**
+ * virDomainBatchGetError:
+ * @batch: a batch of domain queries
+ * @idx: index of a call, as returned when it was added to @batch
+ *
+ * Provides the error of a single call of the last virDomainBatchRun.
+ * The error is owned by @batch and stays valid until the batch is run
+ * again or freed.
+ *
+ * Returns the error, or NULL if the call succeeded or @idx is not
+ * a valid index.
+ */
+virErrorPtr
+virDomainBatchGetError(virDomainBatchPtr batch,
+                       int idx)
+{
+    VIR_DEBUG("batch=%p, idx=%d", batch, idx);
+
+    if (!batch || idx < 0 || idx >= batch->ncalls)
+        return NULL;
+
+    return batch->calls[idx].error;
+}
+
+
+/**
+ * virDomainBatchFree:
+ * @batch: a batch of domain queries
+ *
+ * Releases @batch together with all queued calls.
+ */
+void
+virDomainBatchFree(virDomainBatchPtr batch)
+{
+    size_t i;
+
+    if (!batch)
+        return;
+
+    for (i = 0; i < batch->ncalls; i++) {
+        virObjectUnref(batch->calls[i].domain);
+        g_free(batch->calls[i].disk);
+        virFreeError(batch->calls[i].error);
+    }
+
+    g_free(batch->calls);
+    virObjectUnref(batch->conn);
+    g_free(batch);
+}
@@ -23,6 +23,7 @@
 #include "datatypes.h"
 #include "viralloc.h"
 #include "virlog.h"
+#include "virfile.h"
 #include "rpc/virnetprotocol.h"
 
 VIR_LOG_INIT("libvirt.stream");
@@ -527,6 +528,52 @@ virStreamInData(virStreamPtr stream,
 }
 
 
+/**
+ * virStreamSendFromFD:
+ * @stream: stream
+ * @fd: file descriptor to read data from
+ * @nbytes: maximum number of bytes to send
+ *
+ * Reads up to @nbytes of data from @fd and sends them as a single
+ * chunk through @stream. Drivers which support it read the data
+ * directly into the buffer which is then sent to the other side of
+ * the stream, other drivers use an intermediate buffer and
+ * virStreamSend.
+ *
+ * Returns the number of bytes sent,
+ *         0 when EOF was reached on @fd,
+ *        -1 otherwise
+ */
+int
+virStreamSendFromFD(virStreamPtr stream,
+                    int fd,
+                    size_t nbytes)
+{
+    g_autofree char *buffer = NULL;
+    ssize_t got;
+
+    VIR_DEBUG("stream=%p, fd=%d, nbytes=%zu", stream, fd, nbytes);
+
+    virResetLastError();
+
+    if (stream->driver->streamSendFromFD)
+        return (stream->driver->streamSendFromFD)(stream, fd, nbytes);
+
+    buffer = g_new0(char, nbytes);
+
+    if ((got = saferead(fd, buffer, nbytes)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to read stream data"));
+        return -1;
+    }
+
+    if (got == 0)
+        return 0;
+
+    return virStreamSend(stream, buffer, got);
+}
+
+
 /**
  * virStreamSendAll:
  * @stream: pointer to the stream object
@@ -131,6 +131,12 @@ typedef enum {
      * Whether the virNetworkUpdate() API implementation passes arguments to
      * the driver's callback in correct order. */
     VIR_DRV_FEATURE_NETWORK_UPDATE_HAS_CORRECT_ORDER = 16,
+
+    /*
+     * Remote party supports compressed RPC messages. Checking this feature
+     * also tells the server that the client is able to decompress them.
+     */
+    VIR_DRV_FEATURE_REMOTE_COMPRESSION = 17,
 } virDrvFeature;
 
 
@@ -307,3 +313,7 @@ virTypedParameterValidateSet(virConnectPtr conn,
 int virStreamInData(virStreamPtr stream,
                     int *data,
                     long long *length);
+
+int virStreamSendFromFD(virStreamPtr stream,
+                        int fd,
+                        size_t nbytes);
@@ -337,6 +337,16 @@ virLockDaemonExecRestartHandler(virNetDaemon *dmn,
     virNetDaemonQuitExecRestart(dmn);
 }
 
+static void
+virLockDaemonDumpLogsHandler(virNetDaemon *dmn G_GNUC_UNUSED,
+                             siginfo_t *sig G_GNUC_UNUSED,
+                             void *opaque G_GNUC_UNUSED)
+{
+    if (virLogDumpRings() < 0)
+        VIR_WARN("Failed to dump in-memory logs: %s",
+                 virGetLastErrorMessage());
+}
+
 static int
 virLockDaemonSetupSignals(virNetDaemon *dmn)
 {
@@ -348,6 +358,8 @@ virLockDaemonSetupSignals(virNetDaemon *dmn)
         return -1;
     if (virNetDaemonAddSignalHandler(dmn, SIGUSR1, virLockDaemonExecRestartHandler, NULL) < 0)
         return -1;
+    if (virNetDaemonAddSignalHandler(dmn, SIGUSR2, virLockDaemonDumpLogsHandler, NULL) < 0)
+        return -1;
     return 0;
 }
 
@@ -642,7 +654,7 @@ virLockDaemonPostExecRestart(const char *state_file,
     }
 
     if (virFileReadAll(state_file,
-                       1024 * 1024 * 10, /* 10 MB */
+                       1024 * 1024 * 1024, /* 1 GB */
                        &state) < 0)
         goto cleanup;
 
@@ -738,7 +750,7 @@ virLockDaemonPreExecRestart(const char *state_file,
     if (virJSONValueObjectAppendString(object, "magic", magic) < 0)
         return -1;
 
-    if (!(state = virJSONValueToString(object, true)))
+    if (!(state = virJSONValueToString(object, false)))
         return -1;
 
     VIR_DEBUG("Saving state %s", state);
@@ -426,3 +426,153 @@ virLockSpaceProtocolDispatchCreateLockSpace(virNetServer *server G_GNUC_UNUSED,
     g_mutex_unlock(&priv->lock);
     return rv;
 }
+
+
+static int
+virLockSpaceProtocolDispatchAcquireResources(virNetServer *server G_GNUC_UNUSED,
+                                             virNetServerClient *client,
+                                             virNetMessage *msg G_GNUC_UNUSED,
+                                             struct virNetMessageError *rerr,
+                                             virLockSpaceProtocolAcquireResourcesArgs *args)
+{
+    int rv = -1;
+    unsigned int flags = args->flags;
+    virLockDaemonClient *priv =
+        virNetServerClientGetPrivateData(client);
+    g_autofree virLockSpace **lockspaces = NULL;
+    size_t nacquired = 0;
+    size_t i;
+
+    g_mutex_lock(&priv->lock);
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (priv->restricted) {
+        virReportError(VIR_ERR_OPERATION_DENIED, "%s",
+                       _("lock manager connection has been restricted"));
+        goto cleanup;
+    }
+
+    if (!priv->ownerId) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("lock owner details have not been registered"));
+        goto cleanup;
+    }
+
+    lockspaces = g_new0(virLockSpace *, args->resources.resources_len);
+
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolResource *res = &args->resources.resources_val[i];
+
+        if (res->flags & ~(VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED |
+                           VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("unsupported flags (0x%x) for resource %s"),
+                           res->flags, res->name);
+            goto cleanup;
+        }
+
+        if (!(lockspaces[i] = virLockDaemonFindLockSpace(lockDaemon, res->path))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Lockspace for path %s does not exist"),
+                           res->path);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolResource *res = &args->resources.resources_val[i];
+        unsigned int newFlags = 0;
+
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_SHARED;
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_AUTOCREATE;
+
+        if (virLockSpaceAcquireResource(lockspaces[i],
+                                        res->name,
+                                        priv->ownerPid,
+                                        newFlags) < 0)
+            goto cleanup;
+
+        nacquired++;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0) {
+        virErrorPtr orig_err;
+
+        /* Either all of the resources are acquired or none */
+        virErrorPreserveLast(&orig_err);
+        while (nacquired-- > 0) {
+            virLockSpaceProtocolResource *res = &args->resources.resources_val[nacquired];
+
+            ignore_value(virLockSpaceReleaseResource(lockspaces[nacquired],
+                                                     res->name,
+                                                     priv->ownerPid));
+        }
+        virErrorRestore(&orig_err);
+
+        virNetMessageSaveError(rerr);
+    }
+    g_mutex_unlock(&priv->lock);
+    return rv;
+}
+
+
+static int
+virLockSpaceProtocolDispatchReleaseResources(virNetServer *server G_GNUC_UNUSED,
+                                             virNetServerClient *client,
+                                             virNetMessage *msg G_GNUC_UNUSED,
+                                             struct virNetMessageError *rerr,
+                                             virLockSpaceProtocolReleaseResourcesArgs *args)
+{
+    int rv = -1;
+    unsigned int flags = args->flags;
+    virLockDaemonClient *priv =
+        virNetServerClientGetPrivateData(client);
+    size_t i;
+
+    g_mutex_lock(&priv->lock);
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (priv->restricted) {
+        virReportError(VIR_ERR_OPERATION_DENIED, "%s",
+                       _("lock manager connection has been restricted"));
+        goto cleanup;
+    }
+
+    if (!priv->ownerId) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("lock owner details have not been registered"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolResource *res = &args->resources.resources_val[i];
+        virLockSpace *lockspace;
+
+        if (!(lockspace = virLockDaemonFindLockSpace(lockDaemon, res->path))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Lockspace for path %s does not exist"),
+                           res->path);
+            goto cleanup;
+        }
+
+        if (virLockSpaceReleaseResource(lockspace,
+                                        res->name,
+                                        priv->ownerPid) < 0)
+            goto cleanup;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    g_mutex_unlock(&priv->lock);
+    return rv;
+}
@@ -650,6 +650,91 @@ static int virLockManagerLockDaemonAddResource(virLockManager *lock,
 }
 
 
+static virLockSpaceProtocolResource *
+virLockManagerLockDaemonResourcesArgs(virLockManagerLockDaemonPrivate *priv,
+                                      bool release)
+{
+    virLockSpaceProtocolResource *resources;
+    size_t i;
+
+    resources = g_new0(virLockSpaceProtocolResource, priv->nresources);
+
+    for (i = 0; i < priv->nresources; i++) {
+        resources[i].path = priv->resources[i].lockspace;
+        resources[i].name = priv->resources[i].name;
+        resources[i].flags = priv->resources[i].flags;
+
+        if (release)
+            resources[i].flags &=
+                ~(VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED |
+                  VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE);
+    }
+
+    return resources;
+}
+
+
+/*
+ * Acquire or release all resources of @priv in a single call. Returns 0 on
+ * success, -1 on error and 1 if the daemon does not know the batched call
+ * yet (e.g. an older virtlockd not re-executed since upgrade), in which case
+ * the caller should fall back to handling the resources one by one.
+ */
+static int
+virLockManagerLockDaemonBatchCall(virLockManagerLockDaemonPrivate *priv,
+                                  virNetClient *client,
+                                  virNetClientProgram *program,
+                                  int *counter,
+                                  bool release)
+{
+    g_autofree virLockSpaceProtocolResource *resources = NULL;
+    virLockSpaceProtocolAcquireResourcesArgs acquireArgs;
+    virLockSpaceProtocolReleaseResourcesArgs releaseArgs;
+    int rc;
+
+    resources = virLockManagerLockDaemonResourcesArgs(priv, release);
+
+    if (release) {
+        memset(&releaseArgs, 0, sizeof(releaseArgs));
+        releaseArgs.resources.resources_len = priv->nresources;
+        releaseArgs.resources.resources_val = resources;
+
+        rc = virNetClientProgramCall(program,
+                                     client,
+                                     (*counter)++,
+                                     VIR_LOCK_SPACE_PROTOCOL_PROC_RELEASE_RESOURCES,
+                                     0, NULL, NULL, NULL,
+                                     (xdrproc_t)xdr_virLockSpaceProtocolReleaseResourcesArgs, &releaseArgs,
+                                     (xdrproc_t)xdr_void, NULL);
+    } else {
+        memset(&acquireArgs, 0, sizeof(acquireArgs));
+        acquireArgs.resources.resources_len = priv->nresources;
+        acquireArgs.resources.resources_val = resources;
+
+        rc = virNetClientProgramCall(program,
+                                     client,
+                                     (*counter)++,
+                                     VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCES,
+                                     0, NULL, NULL, NULL,
+                                     (xdrproc_t)xdr_virLockSpaceProtocolAcquireResourcesArgs, &acquireArgs,
+                                     (xdrproc_t)xdr_void, NULL);
+    }
+
+    if (rc == 0)
+        return 0;
+
+    /* Lock conflicts and similar failures are reported with their own
+     * error codes, an unknown procedure is a generic RPC error */
+    if (virGetLastErrorCode() != VIR_ERR_RPC)
+        return -1;
+
+    VIR_DEBUG("Batched %s not supported by the daemon, falling back",
+              release ? "release" : "acquire");
+    virResetLastError();
+    return 1;
+}
+
+
 static int virLockManagerLockDaemonAcquire(virLockManager *lock,
                                            const char *state G_GNUC_UNUSED,
                                            unsigned int flags,
@@ -680,9 +765,16 @@ static int virLockManagerLockDaemonAcquire(virLockManager *lock,
         (*fd = virNetClientDupFD(client, false)) < 0)
         goto cleanup;
 
-    if (!(flags & VIR_LOCK_MANAGER_ACQUIRE_REGISTER_ONLY)) {
+    if (!(flags & VIR_LOCK_MANAGER_ACQUIRE_REGISTER_ONLY) &&
+        priv->nresources > 0) {
         size_t i;
-        for (i = 0; i < priv->nresources; i++) {
+        int rc;
+
+        if ((rc = virLockManagerLockDaemonBatchCall(priv, client, program,
+                                                    &counter, false)) < 0)
+            goto cleanup;
+
+        for (i = 0; rc > 0 && i < priv->nresources; i++) {
             virLockSpaceProtocolAcquireResourceArgs args;
 
             memset(&args, 0, sizeof(args));
@@ -726,6 +818,7 @@ static int virLockManagerLockDaemonRelease(virLockManager *lock,
     virNetClientProgram *program = NULL;
     int counter = 0;
     int rv = -1;
+    int rc = 0;
     size_t i;
     virLockManagerLockDaemonPrivate *priv = lock->privateData;
 
@@ -737,7 +830,12 @@ static int virLockManagerLockDaemonRelease(virLockManager *lock,
     if (!(client = virLockManagerLockDaemonConnect(lock, &program, &counter)))
         goto cleanup;
 
-    for (i = 0; i < priv->nresources; i++) {
+    if (priv->nresources > 0 &&
+        (rc = virLockManagerLockDaemonBatchCall(priv, client, program,
+                                                &counter, true)) < 0)
+        goto cleanup;
+
+    for (i = 0; rc > 0 && i < priv->nresources; i++) {
         virLockSpaceProtocolReleaseResourceArgs args;
 
         memset(&args, 0, sizeof(args));
@@ -286,6 +286,16 @@ virLogDaemonExecRestartHandler(virNetDaemon *dmn,
     virNetDaemonQuitExecRestart(dmn);
 }
 
+static void
+virLogDaemonDumpLogsHandler(virNetDaemon *dmn G_GNUC_UNUSED,
+                            siginfo_t *sig G_GNUC_UNUSED,
+                            void *opaque G_GNUC_UNUSED)
+{
+    if (virLogDumpRings() < 0)
+        VIR_WARN("Failed to dump in-memory logs: %s",
+                 virGetLastErrorMessage());
+}
+
 static int
 virLogDaemonSetupSignals(virNetDaemon *dmn)
 {
@@ -297,6 +307,8 @@ virLogDaemonSetupSignals(virNetDaemon *dmn)
         return -1;
     if (virNetDaemonAddSignalHandler(dmn, SIGUSR1, virLogDaemonExecRestartHandler, NULL) < 0)
         return -1;
+    if (virNetDaemonAddSignalHandler(dmn, SIGUSR2, virLogDaemonDumpLogsHandler, NULL) < 0)
+        return -1;
     return 0;
 }
 
@@ -450,7 +462,7 @@ virLogDaemonPostExecRestart(const char *state_file,
     }
 
     if (virFileReadAll(state_file,
-                       1024 * 1024 * 10, /* 10 MB */
+                       1024 * 1024 * 1024, /* 1 GB */
                        &state) < 0)
         goto cleanup;
 
@@ -528,7 +540,7 @@ virLogDaemonPreExecRestart(const char *state_file,
     if (virJSONValueObjectAppend(object, "handler", &handler) < 0)
         return -1;
 
-    if (!(state = virJSONValueToString(object, true)))
+    if (!(state = virJSONValueToString(object, false)))
         return -1;
 
     VIR_DEBUG("Saving state %s", state);
@@ -43,6 +43,10 @@ VIR_LOG_INIT("logging.log_handler");
 
 #define DEFAULT_MODE 0600
 
+/* Large enough to take the whole content of a pipe with default capacity
+ * in one go, small enough to bound the time spent on one chatty guest. */
+#define VIR_LOG_HANDLER_READ_SIZE (64 * 1024)
+
 typedef struct _virLogHandlerLogFile virLogHandlerLogFile;
 struct _virLogHandlerLogFile {
     virRotatingFileWriter *file;
@@ -67,6 +71,9 @@ struct _virLogHandler {
 
     virLogHandlerShutdownInhibitor inhibitor;
     void *opaque;
+
+    /* Buffer for data read from log pipes, used with the handler locked */
+    char *readbuf;
 };
 
 static virClass *virLogHandlerClass;
@@ -118,6 +125,17 @@ virLogHandlerLogFileClose(virLogHandler *handler,
 }
 
 
+/* The handler must be locked */
+static char *
+virLogHandlerGetReadBuffer(virLogHandler *handler)
+{
+    if (!handler->readbuf)
+        handler->readbuf = g_new(char, VIR_LOG_HANDLER_READ_SIZE);
+
+    return handler->readbuf;
+}
+
+
 static virLogHandlerLogFile *
 virLogHandlerGetLogFileFromWatch(virLogHandler *handler,
                                  int watch)
@@ -141,7 +159,7 @@ virLogHandlerDomainLogFileEvent(int watch,
 {
     virLogHandler *handler = opaque;
     virLogHandlerLogFile *logfile;
-    char buf[1024];
+    char *buf;
     ssize_t len;
 
     virObjectLock(handler);
@@ -157,8 +175,13 @@ virLogHandlerDomainLogFileEvent(int watch,
         goto cleanup;
     }
 
+    /* A single read takes whatever is in the pipe, up to the buffer size,
+     * so that it's written to the log file at once rather than in small
+     * chunks each costing a wakeup of the event loop. */
+    buf = virLogHandlerGetReadBuffer(handler);
+
  reread:
-    len = read(fd, buf, sizeof(buf));
+    len = read(fd, buf, VIR_LOG_HANDLER_READ_SIZE);
     if (len < 0) {
         if (errno == EINTR)
             goto reread;
@@ -350,6 +373,7 @@ virLogHandlerDispose(void *obj)
         virLogHandlerLogFileFree(handler->files[i]);
     }
     g_free(handler->files);
+    g_free(handler->readbuf);
 }
 
 
@@ -428,9 +452,10 @@ virLogHandlerDomainOpenLogFile(virLogHandler *handler,
 
 
 static void
-virLogHandlerDomainLogFileDrain(virLogHandlerLogFile *file)
+virLogHandlerDomainLogFileDrain(virLogHandler *handler,
+                                virLogHandlerLogFile *file)
 {
-    char buf[1024];
+    char *buf = virLogHandlerGetReadBuffer(handler);
     ssize_t len;
     struct pollfd pfd;
     int ret;
@@ -451,7 +476,7 @@ virLogHandlerDomainLogFileDrain(virLogHandlerLogFile *file)
         if (ret == 0)
             return;
 
-        len = read(file->pipefd, buf, sizeof(buf));
+        len = read(file->pipefd, buf, VIR_LOG_HANDLER_READ_SIZE);
         file->drained = true;
         if (len < 0) {
             if (errno == EINTR)
@@ -497,7 +522,7 @@ virLogHandlerDomainGetLogFilePosition(virLogHandler *handler,
         goto cleanup;
     }
 
-    virLogHandlerDomainLogFileDrain(file);
+    virLogHandlerDomainLogFileDrain(handler, file);
 
     *inode = virRotatingFileWriterGetINode(file->file);
     *offset = virRotatingFileWriterGetOffset(file->file);
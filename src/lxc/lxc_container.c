@@ -507,8 +507,7 @@ lxcContainerRenameAndEnableInterfaces(virDomainDef *vmDef,
 /*_syscall2(int, pivot_root, char *, newroot, const char *, oldroot)*/
 extern int pivot_root(const char * new_root, const char * put_old);
 
-static int lxcContainerUnmountSubtree(const char *prefix,
-                                      bool isOldRootFS)
+static int lxcContainerUnmountSubtree(const char *prefix)
 {
     g_auto(GStrv) mounts = NULL;
     size_t nmounts = 0;
@@ -542,14 +541,6 @@ static int lxcContainerUnmountSubtree(const char *prefix,
                                  failedUmount, mounts[nmounts-1]);
             goto cleanup;
         }
-        /* This unmounts the tmpfs on which the old root filesystem was hosted */
-        if (isOldRootFS &&
-            umount(mounts[nmounts-1]) < 0) {
-            virReportSystemError(saveErrno,
-                                 _("Failed to unmount '%s' and could not unmount old root '%s'"),
-                                 failedUmount, mounts[nmounts-1]);
-            goto cleanup;
-        }
     }
 
     ret = 0;
@@ -558,6 +549,33 @@ static int lxcContainerUnmountSubtree(const char *prefix,
     return ret;
 }
 
+/*
+ * Gets rid of all mounts inherited from the host OS at once. Unmounting
+ * them one by one means a umount() per host mount, and on hosts running
+ * many containers, whose mounts all show up here, that dominates the
+ * container start time. The detached mounts are unreachable from the
+ * container and get released as soon as nothing uses them anymore.
+ */
+static int lxcContainerDetachOldRoot(void)
+{
+    VIR_DEBUG("Detach old root");
+
+    if (umount2("/.oldroot", MNT_DETACH) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Failed to detach old root '/.oldroot'"));
+        return -1;
+    }
+
+    /* This unmounts the tmpfs on which the old root filesystem was hosted */
+    if (umount("/.oldroot") < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Failed to unmount tmpfs at '/.oldroot'"));
+        return -1;
+    }
+
+    return 0;
+}
+
 static int lxcContainerResolveSymlinks(virDomainFSDef *fs, bool gentle)
 {
     char *newroot;
@@ -1479,7 +1497,7 @@ static int lxcContainerMountAllFS(virDomainDef *vmDef,
 
         if (!(vmDef->fss[i]->src && vmDef->fss[i]->src->path &&
               STRPREFIX(vmDef->fss[i]->src->path, vmDef->fss[i]->dst)) &&
-            lxcContainerUnmountSubtree(vmDef->fss[i]->dst, false) < 0)
+            lxcContainerUnmountSubtree(vmDef->fss[i]->dst) < 0)
             return -1;
 
         if (lxcContainerMountFS(vmDef->fss[i], sec_mount_options) < 0)
@@ -1521,7 +1539,7 @@ static int lxcContainerUnmountForSharedRoot(const char *stateDir,
     /* Some versions of Linux kernel don't let you overmount
      * the selinux filesystem, so make sure we kill it first
      */
-    if (lxcContainerUnmountSubtree(SELINUX_MOUNT, false) < 0)
+    if (lxcContainerUnmountSubtree(SELINUX_MOUNT) < 0)
         return -1;
 #endif
 
@@ -1529,20 +1547,20 @@ static int lxcContainerUnmountForSharedRoot(const char *stateDir,
      * shouldn't appear in container. */
     tmp = g_strdup_printf("%s/%s.dev", stateDir, domain);
 
-    if (lxcContainerUnmountSubtree(tmp, false) < 0)
+    if (lxcContainerUnmountSubtree(tmp) < 0)
         return -1;
 
     g_free(tmp);
     tmp = g_strdup_printf("%s/%s.devpts", stateDir, domain);
 
-    if (lxcContainerUnmountSubtree(tmp, false) < 0)
+    if (lxcContainerUnmountSubtree(tmp) < 0)
         return -1;
 
 #if WITH_FUSE
     g_free(tmp);
     tmp = g_strdup_printf("%s/%s.fuse", stateDir, domain);
 
-    if (lxcContainerUnmountSubtree(tmp, false) < 0)
+    if (lxcContainerUnmountSubtree(tmp) < 0)
         return -1;
 #endif
 
@@ -1550,9 +1568,9 @@ static int lxcContainerUnmountForSharedRoot(const char *stateDir,
      * get rid of any existing stuff under /proc, /sys & /tmp.
      * We need new namespace aware versions of those. We must
      * do /proc last otherwise we won't find /proc/mounts :-) */
-    if (lxcContainerUnmountSubtree("/sys", false) < 0 ||
-        lxcContainerUnmountSubtree("/dev", false) < 0 ||
-        lxcContainerUnmountSubtree("/proc", false) < 0)
+    if (lxcContainerUnmountSubtree("/sys") < 0 ||
+        lxcContainerUnmountSubtree("/dev") < 0 ||
+        lxcContainerUnmountSubtree("/proc") < 0)
         return -1;
 
     return 0;
@@ -1653,7 +1671,7 @@ static int lxcContainerSetupPivotRoot(virDomainDef *vmDef,
         return -1;
 
    /* Gets rid of all remaining mounts from host OS, including /.oldroot itself */
-    if (lxcContainerUnmountSubtree("/.oldroot", true) < 0)
+    if (lxcContainerDetachOldRoot() < 0)
         return -1;
 
     return 0;
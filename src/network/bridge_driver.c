@@ -48,6 +48,7 @@
 #include "viralloc.h"
 #include "viruuid.h"
 #include "viriptables.h"
+#include "virfirewall.h"
 #include "virlog.h"
 #include "virdnsmasq.h"
 #include "configmake.h"
@@ -66,8 +67,11 @@
 #include "network_event.h"
 #include "virhook.h"
 #include "virjson.h"
+#include "virlease.h"
 #include "virnetworkportdef.h"
 #include "virutil.h"
+#include "virevent.h"
+#include "virhash.h"
 
 #include "netdev_bandwidth_conf.h"
 
@@ -397,6 +401,7 @@ networkRemoveInactive(virNetworkDriverState *driver,
     g_autofree char *radvdpidbase = NULL;
     g_autofree char *statusfile = NULL;
     g_autofree char *macMapFile = NULL;
+    g_autofree char *leaseIndexFile = NULL;
     g_autoptr(dnsmasqContext) dctx = NULL;
     virNetworkDef *def = virNetworkObjGetPersistentDef(obj);
 
@@ -427,10 +432,14 @@ networkRemoveInactive(virNetworkDriverState *driver,
     if (!(macMapFile = virMacMapFileName(driver->dnsmasqStateDir, def->bridge)))
         return -1;
 
+    if (!(leaseIndexFile = virLeaseIndexFileName(driver->dnsmasqStateDir, def->bridge)))
+        return -1;
+
     /* dnsmasq */
     dnsmasqDelete(dctx);
     unlink(leasefile);
     unlink(customleasefile);
+    unlink(leaseIndexFile);
     unlink(configfile);
 
     /* MAC map manager */
@@ -670,6 +679,7 @@ networkStateInitialize(bool privileged,
     network_driver = g_new0(virNetworkDriverState, 1);
 
     network_driver->lockFD = -1;
+    network_driver->dnsmasqReloadTimer = -1;
     if (virMutexInit(&network_driver->lock) < 0) {
         g_clear_pointer(&network_driver, g_free);
         goto error;
@@ -677,6 +687,9 @@ networkStateInitialize(bool privileged,
 
     network_driver->privileged = privileged;
 
+    if (privileged)
+        virFirewallEnableBatching();
+
     if (!(network_driver->xmlopt = networkDnsmasqCreateXMLConf()))
         goto error;
 
@@ -851,6 +864,10 @@ networkStateCleanup(void)
 
     virObjectUnref(network_driver->dnsmasqCaps);
 
+    if (network_driver->dnsmasqReloadTimer != -1)
+        virEventRemoveTimeout(network_driver->dnsmasqReloadTimer);
+    g_clear_pointer(&network_driver->dnsmasqReloadPending, g_hash_table_unref);
+
     virMutexDestroy(&network_driver->lock);
 
     g_clear_pointer(&network_driver, g_free);
@@ -933,6 +950,7 @@ networkConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_COMPRESSION:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     default:
         return 0;
@@ -1669,9 +1687,89 @@ networkStartDhcpDaemon(virNetworkDriverState *driver,
 }
 
 
+/* How long to collect host updates before telling dnsmasq to reread
+ * its files, in milliseconds */
+#define DNSMASQ_RELOAD_DELAY 250
+
+static void
+networkDnsmasqReloadTimer(int timer G_GNUC_UNUSED,
+                          void *opaque)
+{
+    virNetworkDriverState *driver = opaque;
+    g_autoptr(GHashTable) pending = NULL;
+    GHashTableIter iter;
+    const char *name;
+
+    networkDriverLock(driver);
+    pending = g_steal_pointer(&driver->dnsmasqReloadPending);
+    virEventUpdateTimeout(driver->dnsmasqReloadTimer, -1);
+    networkDriverUnlock(driver);
+
+    if (!pending)
+        return;
+
+    g_hash_table_iter_init(&iter, pending);
+    while (g_hash_table_iter_next(&iter, (gpointer *) &name, NULL)) {
+        virNetworkObj *obj;
+        pid_t dnsmasqPid;
+
+        if (!(obj = virNetworkObjFindByName(driver->networks, name)))
+            continue;
+
+        dnsmasqPid = virNetworkObjGetDnsmasqPid(obj);
+        if (virNetworkObjIsActive(obj) && dnsmasqPid > 0) {
+            VIR_DEBUG("Sending SIGHUP to dnsmasq of network %s", name);
+            ignore_value(kill(dnsmasqPid, SIGHUP));
+        }
+
+        virNetworkObjEndAPI(&obj);
+    }
+}
+
+
+/* networkScheduleDhcpDaemonReload:
+ *  Tell dnsmasq of @obj to reread its files shortly. Updates of many
+ *  networks or many updates of one network made within
+ *  DNSMASQ_RELOAD_DELAY are coalesced into a single SIGHUP per
+ *  dnsmasq. If no timer can be registered the SIGHUP is sent right
+ *  away.
+ *
+ *  Returns 0 on success, -1 on failure.
+ */
+static int
+networkScheduleDhcpDaemonReload(virNetworkDriverState *driver,
+                                virNetworkObj *obj)
+{
+    virNetworkDef *def = virNetworkObjGetDef(obj);
+
+    networkDriverLock(driver);
+
+    if (driver->dnsmasqReloadTimer == -1)
+        driver->dnsmasqReloadTimer = virEventAddTimeout(-1,
+                                                        networkDnsmasqReloadTimer,
+                                                        driver, NULL);
+
+    if (driver->dnsmasqReloadTimer == -1) {
+        networkDriverUnlock(driver);
+        virResetLastError();
+        return kill(virNetworkObjGetDnsmasqPid(obj), SIGHUP);
+    }
+
+    if (!driver->dnsmasqReloadPending) {
+        driver->dnsmasqReloadPending = virHashNew(NULL);
+        virEventUpdateTimeout(driver->dnsmasqReloadTimer, DNSMASQ_RELOAD_DELAY);
+    }
+
+    g_hash_table_add(driver->dnsmasqReloadPending, g_strdup(def->name));
+
+    networkDriverUnlock(driver);
+    return 0;
+}
+
+
 /* networkRefreshDhcpDaemon:
- *  Update dnsmasq config files, then send a SIGHUP so that it rereads
- *  them.   This only works for the dhcp-hostsfile and the
+ *  Update dnsmasq config files, then schedule a SIGHUP so that it
+ *  rereads them.   This only works for the dhcp-hostsfile and the
  *  addn-hosts file.
  *
  *  Returns 0 on success, -1 on failure.
@@ -1733,9 +1831,7 @@ networkRefreshDhcpDaemon(virNetworkDriverState *driver,
     if (dnsmasqSave(dctx) < 0)
         return -1;
 
-    dnsmasqPid = virNetworkObjGetDnsmasqPid(obj);
-    return kill(dnsmasqPid, SIGHUP);
-
+    return networkScheduleDhcpDaemonReload(driver, obj);
 }
 
 
@@ -4960,16 +5056,7 @@ networkCheckBandwidth(virNetworkObj *obj,
 static ssize_t
 networkNextClassID(virNetworkObj *obj)
 {
-    ssize_t ret = 0;
-    virBitmap *classIdMap = virNetworkObjGetClassIdMap(obj);
-
-    if ((ret = virBitmapNextClearBit(classIdMap, -1)) < 0)
-        ret = virBitmapSize(classIdMap);
-
-    if (virBitmapSetBitExpand(classIdMap, ret) < 0)
-        return -1;
-
-    return ret;
+    return virNetworkObjAllocClassId(obj);
 }
 
 
@@ -4982,7 +5069,6 @@ networkPlugBandwidthImpl(virNetworkObj *obj,
 {
     virNetworkDriverState *driver = networkGetDriver();
     virNetworkDef *def = virNetworkObjGetDef(obj);
-    virBitmap *classIdMap = virNetworkObjGetClassIdMap(obj);
     unsigned long long tmp_floor_sum = virNetworkObjGetFloorSum(obj);
     ssize_t next_id = 0;
     int plug_ret;
@@ -5008,7 +5094,7 @@ networkPlugBandwidthImpl(virNetworkObj *obj,
     virNetworkObjSetFloorSum(obj, tmp_floor_sum);
     /* update status file */
     if (virNetworkObjSaveStatus(driver->stateDir, obj, network_driver->xmlopt) < 0) {
-        ignore_value(virBitmapClearBit(classIdMap, next_id));
+        virNetworkObjReleaseClassId(obj, next_id);
         tmp_floor_sum -= ifaceBand->in->floor;
         virNetworkObjSetFloorSum(obj, tmp_floor_sum);
         *class_id = 0;
@@ -5087,7 +5173,7 @@ networkUnplugBandwidth(virNetworkObj *obj,
         virNetworkObjSetFloorSum(obj, tmp_floor_sum);
 
         /* return class ID */
-        ignore_value(virBitmapClearBit(classIdMap, *class_id));
+        virNetworkObjReleaseClassId(obj, *class_id);
         /* update status file */
         if (virNetworkObjSaveStatus(driver->stateDir,
                                     obj, network_driver->xmlopt) < 0) {
@@ -57,6 +57,11 @@ struct _virNetworkDriverState {
     virObjectEventState *networkEventState;
 
     virNetworkXMLOption *xmlopt;
+
+    /* Require lock. Names of networks whose dnsmasq is to be sent
+     * SIGHUP once @dnsmasqReloadTimer fires */
+    GHashTable *dnsmasqReloadPending;
+    int dnsmasqReloadTimer;
 };
 
 typedef struct _virNetworkDriverState virNetworkDriverState;
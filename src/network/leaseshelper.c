@@ -84,6 +84,7 @@ main(int argc, char **argv)
 {
     g_autofree char *pid_file = NULL;
     g_autofree char *custom_lease_file = NULL;
+    g_autofree char *index_file = NULL;
     const char *ip = NULL;
     const char *mac = NULL;
     const char *leases_str = NULL;
@@ -158,6 +159,8 @@ main(int argc, char **argv)
 
     custom_lease_file = g_strdup_printf(LOCALSTATEDIR "/lib/libvirt/dnsmasq/%s.status",
                                         interface);
+    index_file = virLeaseIndexFileName(LOCALSTATEDIR "/lib/libvirt/dnsmasq",
+                                       interface);
 
     pid_file = g_strdup(RUNSTATEDIR "/leaseshelper.pid");
 
@@ -249,6 +252,12 @@ main(int argc, char **argv)
         break;
     }
 
+    /* Keep the hostname index used by the NSS plugin in sync with the
+     * lease file. It is written after the lease file so that the
+     * plugin can tell a stale index by its older mtime. */
+    if (virLeaseWriteIndex(leases_array_new, index_file) < 0)
+        goto cleanup;
+
     rv = EXIT_SUCCESS;
 
  cleanup:
@@ -416,7 +416,8 @@ udevProcessPCI(struct udev_device *device,
                             &pci_dev->numa_node, 10) < 0)
         goto cleanup;
 
-    if (virNodeDeviceGetPCIDynamicCaps(def->sysfs_path, pci_dev) < 0)
+    /* VPD is read when the device XML is requested */
+    if (virNodeDeviceGetPCIDynamicCaps(def->sysfs_path, pci_dev, false) < 0)
         goto cleanup;
 
     devAddr.domain = pci_dev->domain;
@@ -1577,14 +1578,11 @@ udevAddOneDevice(struct udev_device *device)
 
 static int
 udevProcessDeviceListEntry(struct udev *udev,
-                           struct udev_list_entry *list_entry)
+                           const char *name)
 {
     struct udev_device *device;
-    const char *name = NULL;
     int ret = -1;
 
-    name = udev_list_entry_get_name(list_entry);
-
     device = udev_device_new_from_syspath(udev, name);
 
     if (device != NULL) {
@@ -1625,11 +1623,129 @@ udevEnumerateAddMatches(struct udev_enumerate *udev_enumerate)
 }
 
 
+#define UDEV_ENUMERATE_WORKERS 8
+#define UDEV_ENUMERATE_DEVICES_PER_WORKER 32
+
+typedef struct _udevEnumerateWave udevEnumerateWave;
+struct _udevEnumerateWave {
+    virMutex lock;
+    char **names;
+    size_t nnames;
+    size_t next;
+};
+
+
+static void
+udevEnumerateProcessWave(udevEnumerateWave *wave,
+                         struct udev *udev)
+{
+    while (true) {
+        const char *name;
+
+        virMutexLock(&wave->lock);
+        if (wave->next == wave->nnames) {
+            virMutexUnlock(&wave->lock);
+            break;
+        }
+        name = wave->names[wave->next++];
+        virMutexUnlock(&wave->lock);
+
+        udevProcessDeviceListEntry(udev, name);
+    }
+}
+
+
+static void
+udevEnumerateWorker(void *opaque)
+{
+    udevEnumerateWave *wave = opaque;
+    struct udev *udev;
+
+    /* A udev context must not be used by multiple threads at once */
+    if (!(udev = udev_new())) {
+        VIR_DEBUG("Failed to create udev context for enumeration worker");
+        return;
+    }
+
+    udevEnumerateProcessWave(wave, udev);
+    udev_unref(udev);
+}
+
+
+/* Process devices @names in parallel. The calling thread takes part, so
+ * all of them get processed even if no worker thread can be started. */
+static void
+udevEnumerateRunWave(struct udev *udev,
+                     char **names,
+                     size_t nnames)
+{
+    udevEnumerateWave wave = { .names = names, .nnames = nnames };
+    virThread workers[UDEV_ENUMERATE_WORKERS - 1];
+    size_t nworkers = MIN(nnames / UDEV_ENUMERATE_DEVICES_PER_WORKER,
+                          G_N_ELEMENTS(workers));
+    size_t started = 0;
+    size_t i;
+
+    if (virMutexInit(&wave.lock) < 0) {
+        for (i = 0; i < nnames; i++)
+            udevProcessDeviceListEntry(udev, names[i]);
+        return;
+    }
+
+    for (i = 0; i < nworkers; i++) {
+        if (virThreadCreateFull(&workers[started], true, udevEnumerateWorker,
+                                "udev-enum", false, &wave) < 0) {
+            VIR_DEBUG("Failed to spawn udev enumeration worker");
+            break;
+        }
+        started++;
+    }
+
+    udevEnumerateProcessWave(&wave, udev);
+
+    for (i = 0; i < started; i++)
+        virThreadJoin(&workers[i]);
+
+    virMutexDestroy(&wave.lock);
+}
+
+
+static size_t
+udevSysfsPathDepth(const char *path)
+{
+    size_t depth = 0;
+
+    for (; *path; path++) {
+        if (*path == '/')
+            depth++;
+    }
+
+    return depth;
+}
+
+
+static gint
+udevSysfsPathDepthCompare(gconstpointer a,
+                          gconstpointer b)
+{
+    size_t depthA = udevSysfsPathDepth(*(const char **)a);
+    size_t depthB = udevSysfsPathDepth(*(const char **)b);
+
+    if (depthA < depthB)
+        return -1;
+    if (depthA > depthB)
+        return 1;
+    return 0;
+}
+
+
 static int
 udevEnumerateDevices(struct udev *udev)
 {
     struct udev_enumerate *udev_enumerate = NULL;
     struct udev_list_entry *list_entry = NULL;
+    g_autoptr(GPtrArray) names = g_ptr_array_new_with_free_func(g_free);
+    size_t i;
     int ret = -1;
 
     udev_enumerate = udev_enumerate_new(udev);
@@ -1641,8 +1757,25 @@ udevEnumerateDevices(struct udev *udev)
 
     udev_list_entry_foreach(list_entry,
                             udev_enumerate_get_list_entry(udev_enumerate)) {
+        g_ptr_array_add(names, g_strdup(udev_list_entry_get_name(list_entry)));
+    }
+
+    /* The parent of a device is looked up among the devices already known
+     * (see udevSetParent), and its sysfs path is always a prefix of the
+     * device's path. Devices at the same depth of the sysfs tree can thus
+     * be processed in parallel, one depth after another. */
+    g_ptr_array_sort(names, udevSysfsPathDepthCompare);
+
+    for (i = 0; i < names->len;) {
+        size_t depth = udevSysfsPathDepth(g_ptr_array_index(names, i));
+        size_t j = i + 1;
 
-        udevProcessDeviceListEntry(udev, list_entry);
+        while (j < names->len &&
+               udevSysfsPathDepth(g_ptr_array_index(names, j)) == depth)
+            j++;
+
+        udevEnumerateRunWave(udev, (char **)names->pdata + i, j - i);
+        i = j;
     }
 
     ret = 0;
@@ -1766,6 +1899,115 @@ udevEventMonitorSanityCheck(udevEventData *priv,
 }
 
 
+/* Maximum number of events handled in one batch and the time given to a
+ * storm of events to settle before handling them. */
+#define UDEV_EVENT_BATCH_MAX 1024
+#define UDEV_EVENT_COALESCE_WINDOW (50 * 1000) /* microseconds */
+
+
+/**
+ * udevEventReceiveDevice:
+ * @priv: udev event data
+ * @device: filled in with the received device
+ *
+ * Returns 1 if a device was received, 0 if there is no more data to be
+ * read from the udev monitor and -1 on a fatal error.
+ */
+static int
+udevEventReceiveDevice(udevEventData *priv,
+                       struct udev_device **device)
+{
+    int saved_errno;
+
+    virObjectLock(priv);
+    errno = 0;
+    *device = udev_monitor_receive_device(priv->udev_monitor);
+    saved_errno = errno;
+
+    if (*device) {
+        virObjectUnlock(priv);
+        return 1;
+    }
+
+    if (saved_errno == 0) {
+        virObjectUnlock(priv);
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("failed to receive device from udev monitor"));
+        return -1;
+    }
+
+    /* POSIX allows both EAGAIN and EWOULDBLOCK to be used
+     * interchangeably when the read would block or timeout was fired
+     */
+    VIR_WARNINGS_NO_WLOGICALOP_EQUAL_EXPR
+    if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK) {
+    VIR_WARNINGS_RESET
+        virObjectUnlock(priv);
+        virReportSystemError(saved_errno, "%s",
+                             _("failed to receive device from udev "
+                               "monitor"));
+        return -1;
+    }
+
+    /* Trying to move the reset of the @priv->dataReady flag to
+     * after the udev_monitor_receive_device wouldn't help much
+     * due to event mgmt and scheduler timing. */
+    priv->dataReady = false;
+    virObjectUnlock(priv);
+
+    return 0;
+}
+
+
+/**
+ * udevEventCoalesce:
+ * @devices: batch of devices to be handled
+ * @pending: sysfs path -> position in @devices (counted from 1) of the
+ *           device's last add or change event not followed by any other
+ *           event
+ * @device: newly received device
+ *
+ * Appends @device to @devices. Since add and change events are both
+ * handled by re-reading the whole device, a change event replaces a
+ * pending add or change event of the same device instead. Events which
+ * are not handled at all are dropped.
+ */
+static void
+udevEventCoalesce(GPtrArray *devices,
+                  GHashTable *pending,
+                  struct udev_device *device)
+{
+    const char *action = udev_device_get_action(device);
+    const char *syspath = udev_device_get_syspath(device);
+    gpointer pos;
+
+    if (STREQ_NULLABLE(action, "change") &&
+        (pos = g_hash_table_lookup(pending, syspath))) {
+        size_t i = GPOINTER_TO_SIZE(pos) - 1;
+
+        udev_device_unref(g_ptr_array_index(devices, i));
+        devices->pdata[i] = device;
+        return;
+    }
+
+    if (STREQ_NULLABLE(action, "add") || STREQ_NULLABLE(action, "change")) {
+        g_ptr_array_add(devices, device);
+        g_hash_table_replace(pending, g_strdup(syspath),
+                             GSIZE_TO_POINTER(devices->len));
+        return;
+    }
+
+    if (STREQ_NULLABLE(action, "remove") || STREQ_NULLABLE(action, "move")) {
+        g_hash_table_remove(pending, syspath);
+        g_ptr_array_add(devices, device);
+        return;
+    }
+
+    VIR_DEBUG("ignoring udev action: '%s': %s", NULLSTR(action), syspath);
+    udev_device_unref(device);
+}
+
+
 /**
  * udevEventHandleThread
  * @opaque: unused
@@ -1780,6 +2022,12 @@ udevEventMonitorSanityCheck(udevEventData *priv,
  * the handler thread is currently trying to process, simply because
  * the data hadn't been retrieved from the socket.
  *
+ * All events available are read and handled in a batch, see
+ * udevEventCoalesce. If there is more than one of them, the thread waits
+ * for UDEV_EVENT_COALESCE_WINDOW for more events to arrive, so that a
+ * storm of events, e.g. when creating many SR-IOV VFs, results in each
+ * device being processed only once.
+ *
  * NB: Some older distros, such as CentOS 6, libudev opens sockets
  * without the NONBLOCK flag which might cause issues with event
  * based algorithm. Although the issue can be mitigated by resetting
@@ -1790,10 +2038,16 @@ static void
 udevEventHandleThread(void *opaque G_GNUC_UNUSED)
 {
     udevEventData *priv = driver->privateData;
-    struct udev_device *device = NULL;
 
     /* continue rather than break from the loop on non-fatal errors */
     while (1) {
+        g_autoptr(GPtrArray) devices = NULL;
+        g_autoptr(GHashTable) pending = NULL;
+        struct udev_device *device = NULL;
+        bool waited = false;
+        int rc = 0;
+        size_t i;
+
         virObjectLock(priv);
         while (!priv->dataReady && !priv->threadQuit) {
             if (virCondWait(&priv->threadCond, &priv->parent.lock)) {
@@ -1808,47 +2062,39 @@ udevEventHandleThread(void *opaque G_GNUC_UNUSED)
             virObjectUnlock(priv);
             return;
         }
-
-        errno = 0;
-        device = udev_monitor_receive_device(priv->udev_monitor);
         virObjectUnlock(priv);
 
-        if (!device) {
-            if (errno == 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                               _("failed to receive device from udev monitor"));
-                return;
-            }
+        devices = g_ptr_array_new();
+        pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
-            /* POSIX allows both EAGAIN and EWOULDBLOCK to be used
-             * interchangeably when the read would block or timeout was fired
-             */
-            VIR_WARNINGS_NO_WLOGICALOP_EQUAL_EXPR
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-            VIR_WARNINGS_RESET
-                virReportSystemError(errno, "%s",
-                                     _("failed to receive device from udev "
-                                       "monitor"));
-                return;
-            }
+        /* Instead of waiting for the next event after processing @device
+         * data, let's keep reading from the udev monitor and only wait
+         * for the next event once either a EAGAIN or a EWOULDBLOCK error
+         * is encountered. */
+        while (devices->len < UDEV_EVENT_BATCH_MAX) {
+            if ((rc = udevEventReceiveDevice(priv, &device)) < 0)
+                break;
 
-            /* Trying to move the reset of the @priv->dataReady flag to
-             * after the udev_monitor_receive_device wouldn't help much
-             * due to event mgmt and scheduler timing. */
-            virObjectLock(priv);
-            priv->dataReady = false;
-            virObjectUnlock(priv);
+            if (rc == 0) {
+                if (waited || devices->len < 2)
+                    break;
+
+                waited = true;
+                g_usleep(UDEV_EVENT_COALESCE_WINDOW);
+                continue;
+            }
 
-            continue;
+            udevEventCoalesce(devices, pending, device);
         }
 
-        udevHandleOneDevice(device);
-        udev_device_unref(device);
+        for (i = 0; i < devices->len; i++) {
+            device = g_ptr_array_index(devices, i);
+            udevHandleOneDevice(device);
+            udev_device_unref(device);
+        }
 
-        /* Instead of waiting for the next event after processing @device
-         * data, let's keep reading from the udev monitor and only wait
-         * for the next event once either a EAGAIN or a EWOULDBLOCK error
-         * is encountered. */
+        if (rc < 0)
+            return;
     }
 }
 
@@ -83,6 +83,8 @@ struct virNWFilterSnoopState {
     virMutex             snoopLock;  /* protects SnoopReqs and IfNameToKey */
     GHashTable *     active;
     virMutex             activeLock; /* protects Active */
+    /* decodes packets captured on all interfaces */
+    virThreadPool *      decodePool;
 };
 
 # define virNWFilterSnoopLock() \
@@ -137,7 +139,12 @@ struct _virNWFilterSnoopReq {
     virCond                              threadStatusCond;
 
     int                                  jobCompletionStatus;
-    /* the number of submitted jobs in the worker's queue */
+    /* packets waiting to be decoded in order by the decode pool */
+    GQueue                               decodeJobs;
+    /* whether the decode pool has a job for this req */
+    bool                                 decodeScheduled;
+    /* the number of queued packets per capture direction */
+    int                                  decodeQCtr[2];
     /*
      * protect those members that can change while the
      * req is on the public SnoopReq hash and
@@ -148,6 +155,8 @@ struct _virNWFilterSnoopReq {
      * - end
      * - a lease while it is on the list
      * - threadStatus
+     * - decodeJobs
+     * - decodeScheduled
      * (for refctr, see above)
      */
     virMutex                             lock;
@@ -218,6 +227,7 @@ G_STATIC_ASSERT(sizeof(struct _virNWFilterSnoopDHCPHdr) == 236);
      offsetof(virNWFilterSnoopDHCPHdr, d_opts))
 
 # define PCAP_PBUFSIZE              576 /* >= IP/TCP/DHCP headers */
+# define PCAP_BUFFER_SIZE    (64 * 1024) /* DHCP traffic is sparse */
 # define PCAP_READ_MAXERRS          25 /* retries on failing device */
 # define PCAP_FLOOD_TIMEOUT_MS      10 /* ms */
 
@@ -235,6 +245,8 @@ struct _virNWFilterDHCPDecodeJob {
 
 # define MAX_QUEUED_JOBS        (DHCP_PKT_BURST + 2 * DHCP_PKT_RATE)
 
+# define DHCP_DECODE_MAX_WORKERS 4
+
 typedef struct _virNWFilterSnoopRateLimitConf virNWFilterSnoopRateLimitConf;
 struct _virNWFilterSnoopRateLimitConf {
     time_t prev;
@@ -252,7 +264,6 @@ struct _virNWFilterSnoopPcapConf {
     const pcap_direction_t dir;
     const char *filter;
     virNWFilterSnoopRateLimitConf rateLimit; /* indep. rate limiters */
-    int qCtr; /* number of jobs in the worker's queue */
     const unsigned int maxQSize;
     unsigned long long penaltyTimeoutAbs;
 };
@@ -546,6 +557,7 @@ virNWFilterSnoopReqNew(const char *ifkey)
     }
 
     req->threadStatus = THREAD_STATUS_NONE;
+    g_queue_init(&req->decodeJobs);
 
     if (virStrcpyStatic(req->ifkey, ifkey) < 0 ||
         virMutexInitRecursive(&req->lock) < 0) {
@@ -570,6 +582,7 @@ static void
 virNWFilterSnoopReqFree(virNWFilterSnoopReq *req)
 {
     virNWFilterSnoopIPLease *ipl;
+    virNWFilterDHCPDecodeJob *job;
 
     if (!req)
         return;
@@ -583,6 +596,8 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReq *req)
 
     /* free all req data */
     virNWFilterBindingDefFree(req->binding);
+    while ((job = g_queue_pop_head(&req->decodeJobs)))
+        g_free(job);
 
     virMutexDestroy(&req->lock);
     virCondDestroy(&req->threadStatusCond);
@@ -1052,6 +1067,7 @@ virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
     }
 
     if (pcap_set_snaplen(handle, PCAP_PBUFSIZE) < 0 ||
+        pcap_set_buffer_size(handle, PCAP_BUFFER_SIZE) < 0 ||
         pcap_set_immediate_mode(handle, 1) < 0 ||
         pcap_activate(handle) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1090,37 +1106,55 @@ virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
 }
 
 /*
- * Worker function to decode the DHCP message and with that
- * also do the time-consuming work of instantiating the filters
+ * Worker function to decode the DHCP messages queued on a req and with
+ * that also do the time-consuming work of instantiating the filters.
+ * The decode pool is shared by all interfaces; a req is only handed to
+ * one worker at a time so that its packets are processed in order.
  */
-static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque)
+static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque G_GNUC_UNUSED)
 {
-    virNWFilterSnoopReq *req = opaque;
-    g_autofree virNWFilterDHCPDecodeJob *job = jobdata;
-    virNWFilterSnoopEthHdr *packet = (virNWFilterSnoopEthHdr *)job->packet;
+    virNWFilterSnoopReq *req = jobdata;
+    virNWFilterDHCPDecodeJob *job;
 
-    if (virNWFilterSnoopDHCPDecode(req, packet,
-                                   job->caplen, job->fromVM) == -1) {
-        req->jobCompletionStatus = -1;
+    virNWFilterSnoopReqLock(req);
 
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Instantiation of rules failed on "
-                         "interface '%s'"), req->binding->portdevname);
+    while ((job = g_queue_pop_head(&req->decodeJobs))) {
+        virNWFilterSnoopEthHdr *packet = (virNWFilterSnoopEthHdr *)job->packet;
+
+        virNWFilterSnoopReqUnlock(req);
+
+        if (virNWFilterSnoopDHCPDecode(req, packet,
+                                       job->caplen, job->fromVM) == -1) {
+            req->jobCompletionStatus = -1;
+
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Instantiation of rules failed on "
+                             "interface '%s'"), req->binding->portdevname);
+        }
+        ignore_value(!!g_atomic_int_dec_and_test(job->qCtr));
+        g_free(job);
+
+        virNWFilterSnoopReqLock(req);
     }
-    ignore_value(!!g_atomic_int_dec_and_test(job->qCtr));
+
+    req->decodeScheduled = false;
+
+    virNWFilterSnoopReqUnlock(req);
+
+    virNWFilterSnoopReqPut(req);
 }
 
 /*
- * Submit a job to the worker thread doing the time-consuming work...
+ * Queue a packet on the req and hand the req to the decode pool doing
+ * the time-consuming work...
  */
 static int
-virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPool *pool,
+virNWFilterSnoopDHCPDecodeJobSubmit(virNWFilterSnoopReq *req,
                                     virNWFilterSnoopEthHdr *pep,
                                     int len, pcap_direction_t dir,
                                     int *qCtr)
 {
     virNWFilterDHCPDecodeJob *job;
-    int ret;
 
     if (len <= MIN_VALID_DHCP_PKT_SIZE || len > sizeof(job->packet))
         return 0;
@@ -1132,14 +1166,49 @@ virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPool *pool,
     job->fromVM = (dir == PCAP_D_IN);
     job->qCtr = qCtr;
 
-    ret = virThreadPoolSendJob(pool, 0, job);
+    virNWFilterSnoopReqLock(req);
 
-    if (ret == 0)
-        g_atomic_int_add(qCtr, 1);
-    else
+    g_queue_push_tail(&req->decodeJobs, job);
+    g_atomic_int_add(qCtr, 1);
+
+    if (!req->decodeScheduled) {
+        /* the worker releases this reference once the queue is empty */
+        virNWFilterSnoopReqGet(req);
+
+        if (virThreadPoolSendJob(virNWFilterSnoopState.decodePool, 0, req) < 0) {
+            g_queue_pop_tail(&req->decodeJobs);
+            g_atomic_int_add(qCtr, -1);
+            g_free(job);
+
+            virNWFilterSnoopReqUnlock(req);
+            virNWFilterSnoopReqPut(req);
+            return -1;
+        }
+
+        req->decodeScheduled = true;
+    }
+
+    virNWFilterSnoopReqUnlock(req);
+
+    return 0;
+}
+
+/*
+ * Drop the packets of a req that were not decoded yet
+ */
+static void
+virNWFilterSnoopDHCPDecodeJobsDrop(virNWFilterSnoopReq *req)
+{
+    virNWFilterDHCPDecodeJob *job;
+
+    virNWFilterSnoopReqLock(req);
+
+    while ((job = g_queue_pop_head(&req->decodeJobs))) {
+        ignore_value(!!g_atomic_int_dec_and_test(job->qCtr));
         g_free(job);
+    }
 
-    return ret;
+    virNWFilterSnoopReqUnlock(req);
 }
 
 /*
@@ -1275,7 +1344,6 @@ virNWFilterDHCPSnoopThread(void *req0)
     int tmp = -1, rv, n, pollTo;
     size_t i;
     g_autofree char *threadkey = NULL;
-    virThreadPool *worker = NULL;
     time_t last_displayed = 0, last_displayed_queue = 0;
     virNWFilterSnoopPcapConf pcapConf[] = {
         {
@@ -1330,15 +1398,10 @@ virNWFilterDHCPSnoopThread(void *req0)
         }
         tmp = virNetDevGetIndex(req->binding->portdevname, &ifindex);
         threadkey = g_strdup(req->threadkey);
-        worker = virThreadPoolNewFull(1, 1, 0,
-                                      virNWFilterDHCPDecodeWorker,
-                                      "dhcp-decode",
-                                      NULL,
-                                      req);
     }
 
     /* let creator know how well we initialized */
-    if (error || !threadkey || tmp < 0 || !worker ||
+    if (error || !threadkey || tmp < 0 ||
         ifindex != req->ifindex) {
         virErrorPreserveLast(&req->threadError);
         req->threadStatus = THREAD_STATUS_FAIL;
@@ -1442,7 +1505,7 @@ virNWFilterDHCPSnoopThread(void *req0)
                 unsigned int diff;
 
                 /* submit packet to worker thread */
-                if (g_atomic_int_get(&pcapConf[i].qCtr) >
+                if (g_atomic_int_get(&req->decodeQCtr[i]) >
                     pcapConf[i].maxQSize) {
                     if (last_displayed_queue - time(0) > 10) {
                         last_displayed_queue = time(0);
@@ -1466,10 +1529,10 @@ virNWFilterDHCPSnoopThread(void *req0)
                     continue;
                 }
 
-                if (virNWFilterSnoopDHCPDecodeJobSubmit(worker, packet,
-                                                      hdr->caplen,
-                                                      pcapConf[i].dir,
-                                                      &pcapConf[i].qCtr) < 0) {
+                if (virNWFilterSnoopDHCPDecodeJobSubmit(req, packet,
+                                                        hdr->caplen,
+                                                        pcapConf[i].dir,
+                                                        &req->decodeQCtr[i]) < 0) {
                     virReportError(VIR_ERR_INTERNAL_ERROR,
                                    _("Job submission failed on "
                                      "interface '%s'"), req->binding->portdevname);
@@ -1497,7 +1560,7 @@ virNWFilterDHCPSnoopThread(void *req0)
     virNWFilterSnoopUnlock();
 
  cleanup:
-    virThreadPoolFree(worker);
+    virNWFilterSnoopDHCPDecodeJobsDrop(req);
 
     virNWFilterSnoopReqPut(req);
 
@@ -1999,6 +2062,14 @@ virNWFilterDHCPSnoopInit(void)
     virNWFilterSnoopState.snoopReqs =
         virHashNew(virNWFilterSnoopReqRelease);
 
+    if (!(virNWFilterSnoopState.decodePool =
+          virThreadPoolNewFull(1, DHCP_DECODE_MAX_WORKERS, 0,
+                               virNWFilterDHCPDecodeWorker,
+                               "dhcp-decode",
+                               NULL,
+                               NULL)))
+        return -1;
+
     virNWFilterSnoopLeaseFileLoad();
     virNWFilterSnoopLeaseFileOpen();
 
@@ -2077,6 +2148,8 @@ virNWFilterDHCPSnoopShutdown(void)
     virNWFilterSnoopEndThreads();
     virNWFilterSnoopJoinThreads();
 
+    g_clear_pointer(&virNWFilterSnoopState.decodePool, virThreadPoolFree);
+
     virNWFilterSnoopLock();
 
     virNWFilterSnoopLeaseFileClose();
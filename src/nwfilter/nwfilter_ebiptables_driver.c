@@ -100,6 +100,100 @@ static void ebiptablesDriverShutdown(void);
 static int ebtablesCleanAll(const char *ifname);
 static int ebiptablesAllTeardown(const char *ifname);
 
+/*
+ * Digests of the rules instantiated by ebiptablesApplyNewRules for an
+ * interface, allowing to skip re-instantiation of unchanged rules.
+ */
+typedef struct _ebiptablesIfaceDigest ebiptablesIfaceDigest;
+struct _ebiptablesIfaceDigest {
+    char *active;  /* rules in the root chains */
+    char *pending; /* rules in the temporary chains */
+};
+
+static GHashTable *ifaceDigests;
+static virMutex ifaceDigestsLock = VIR_MUTEX_INITIALIZER;
+
+
+static void
+ebiptablesIfaceDigestFree(void *opaque)
+{
+    ebiptablesIfaceDigest *digest = opaque;
+
+    g_free(digest->active);
+    g_free(digest->pending);
+    g_free(digest);
+}
+
+
+/*
+ * Record @digest as the digest of the rules about to be instantiated in
+ * the temporary chains of @ifname. If @allowSkip is true and the rules
+ * currently in the root chains have the same digest, nothing is
+ * recorded and true is returned.
+ */
+static bool
+ebiptablesIfaceDigestSetPending(const char *ifname,
+                                const char *digest,
+                                bool allowSkip)
+{
+    ebiptablesIfaceDigest *entry;
+    bool ret = false;
+
+    virMutexLock(&ifaceDigestsLock);
+
+    if (!ifaceDigests)
+        ifaceDigests = virHashNew(ebiptablesIfaceDigestFree);
+
+    if (!(entry = virHashLookup(ifaceDigests, ifname))) {
+        entry = g_new0(ebiptablesIfaceDigest, 1);
+        g_hash_table_insert(ifaceDigests, g_strdup(ifname), entry);
+    }
+
+    if (allowSkip && STREQ_NULLABLE(entry->active, digest)) {
+        ret = true;
+    } else {
+        g_free(entry->pending);
+        entry->pending = g_strdup(digest);
+    }
+
+    virMutexUnlock(&ifaceDigestsLock);
+    return ret;
+}
+
+
+/* The temporary chains of @ifname were dropped (@commit is false) or
+ * renamed to become the root chains (@commit is true). */
+static void
+ebiptablesIfaceDigestFinish(const char *ifname,
+                            bool commit)
+{
+    ebiptablesIfaceDigest *entry;
+
+    virMutexLock(&ifaceDigestsLock);
+
+    if (ifaceDigests && (entry = virHashLookup(ifaceDigests, ifname))) {
+        if (commit) {
+            g_free(entry->active);
+            entry->active = g_steal_pointer(&entry->pending);
+        } else {
+            g_clear_pointer(&entry->pending, g_free);
+        }
+    }
+
+    virMutexUnlock(&ifaceDigestsLock);
+}
+
+
+/* The chains of @ifname were removed or replaced by other rules. */
+static void
+ebiptablesIfaceDigestForget(const char *ifname)
+{
+    virMutexLock(&ifaceDigestsLock);
+    if (ifaceDigests)
+        virHashRemoveEntry(ifaceDigests, ifname);
+    virMutexUnlock(&ifaceDigestsLock);
+}
+
 struct ushort_map {
     unsigned short attr;
     const char *val;
@@ -349,17 +443,60 @@ printDataTypeAsHex(virNWFilterVarCombIter *vars,
 }
 
 
+static int
+ebtablesHandleMACAmong(virFirewall *fw,
+                       virFirewallRule *fwrule,
+                       virNWFilterVarCombIter *vars,
+                       nwItemDesc *item,
+                       const char *option)
+{
+    const char *varName = virNWFilterVarAccessGetVarName(item->varAccess);
+    virNWFilterVarValue *val = virHashLookup(vars->hashTable, varName);
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    if (!val) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Could not find value for variable '%s'"),
+                       varName);
+        return -1;
+    }
+
+    for (i = 0; i < virNWFilterVarValueGetCardinality(val); i++)
+        virBufferAsprintf(&buf, "%s,",
+                          virNWFilterVarValueGetNthValue(val, i));
+    virBufferTrimChars(&buf, ",");
+
+    virFirewallRuleAddArg(fw, fwrule, option);
+    virFirewallRuleAddArg(fw, fwrule, virBufferCurrentContent(&buf));
+
+    return 0;
+}
+
+
+/*
+ * With @among set, a MAC address taken from a variable is matched
+ * against all of the variable's values at once, see
+ * ebtablesRuleCanUseAmong.
+ */
 static int
 ebtablesHandleEthHdr(virFirewall *fw,
                      virFirewallRule *fwrule,
                      virNWFilterVarCombIter *vars,
                      ethHdrDataDef *ethHdr,
-                     bool reverse)
+                     bool reverse,
+                     bool among)
 {
     char macaddr[VIR_MAC_STRING_BUFLEN];
     char macmask[VIR_MAC_STRING_BUFLEN];
 
-    if (HAS_ENTRY_ITEM(&ethHdr->dataSrcMACAddr)) {
+    if (among &&
+        (ethHdr->dataSrcMACAddr.flags & NWFILTER_ENTRY_ITEM_FLAG_HAS_VAR)) {
+        if (ebtablesHandleMACAmong(fw, fwrule, vars,
+                                   &ethHdr->dataSrcMACAddr,
+                                   reverse ? "--among-dst" : "--among-src") < 0)
+            return -1;
+    } else if (HAS_ENTRY_ITEM(&ethHdr->dataSrcMACAddr)) {
         if (printDataType(vars,
                           macaddr, sizeof(macaddr),
                           &ethHdr->dataSrcMACAddr) < 0)
@@ -384,7 +521,13 @@ ebtablesHandleEthHdr(virFirewall *fw,
         }
     }
 
-    if (HAS_ENTRY_ITEM(&ethHdr->dataDstMACAddr)) {
+    if (among &&
+        (ethHdr->dataDstMACAddr.flags & NWFILTER_ENTRY_ITEM_FLAG_HAS_VAR)) {
+        if (ebtablesHandleMACAmong(fw, fwrule, vars,
+                                   &ethHdr->dataDstMACAddr,
+                                   reverse ? "--among-src" : "--among-dst") < 0)
+            return -1;
+    } else if (HAS_ENTRY_ITEM(&ethHdr->dataDstMACAddr)) {
         if (printDataType(vars,
                           macaddr, sizeof(macaddr),
                           &ethHdr->dataDstMACAddr) < 0)
@@ -1751,6 +1894,80 @@ iptablesCreateRuleInstance(virFirewall *fw,
 
 
 
+static bool
+ebtablesMACItemUsesVar(nwItemDesc *item,
+                       nwItemDesc *mask,
+                       virNWFilterVarAccess *varAccess)
+{
+    return (item->flags & NWFILTER_ENTRY_ITEM_FLAG_HAS_VAR) &&
+        !ENTRY_WANT_NEG_SIGN(item) &&
+        !HAS_ENTRY_ITEM(mask) &&
+        virNWFilterVarAccessEqual(item->varAccess, varAccess);
+}
+
+
+/*
+ * ebtablesRuleCanUseAmong:
+ * @rule: The rule of the filter to check
+ * @vars: The variables the rule is instantiated with
+ *
+ * Check whether the only variable accessed by @rule is a list of MAC
+ * addresses matched as the source or destination of the frame. All
+ * instances of such a rule then differ only in that address and can be
+ * collapsed into a single rule using ebtables' hashed 'among' match, so
+ * that the size of the list does not influence the number of rules.
+ */
+static bool
+ebtablesRuleCanUseAmong(virNWFilterRuleDef *rule,
+                        GHashTable *vars)
+{
+    ethHdrDataDef *ethHdr = NULL;
+    virNWFilterVarAccess *varAccess;
+    virNWFilterVarValue *val;
+
+    if (rule->nVarAccess != 1)
+        return false;
+
+    varAccess = rule->varAccess[0];
+    if (virNWFilterVarAccessGetType(varAccess) != VIR_NWFILTER_VAR_ACCESS_ITERATOR)
+        return false;
+
+    switch (rule->prtclType) {
+    case VIR_NWFILTER_RULE_PROTOCOL_MAC:
+        ethHdr = &rule->p.ethHdrFilter.ethHdr;
+        break;
+    case VIR_NWFILTER_RULE_PROTOCOL_VLAN:
+        ethHdr = &rule->p.vlanHdrFilter.ethHdr;
+        break;
+    case VIR_NWFILTER_RULE_PROTOCOL_STP:
+        ethHdr = &rule->p.stpHdrFilter.ethHdr;
+        break;
+    case VIR_NWFILTER_RULE_PROTOCOL_ARP:
+    case VIR_NWFILTER_RULE_PROTOCOL_RARP:
+        ethHdr = &rule->p.arpHdrFilter.ethHdr;
+        break;
+    case VIR_NWFILTER_RULE_PROTOCOL_IP:
+        ethHdr = &rule->p.ipHdrFilter.ethHdr;
+        break;
+    case VIR_NWFILTER_RULE_PROTOCOL_IPV6:
+        ethHdr = &rule->p.ipv6HdrFilter.ethHdr;
+        break;
+    default:
+        return false;
+    }
+
+    if (!ebtablesMACItemUsesVar(&ethHdr->dataSrcMACAddr,
+                                &ethHdr->dataSrcMACMask, varAccess) &&
+        !ebtablesMACItemUsesVar(&ethHdr->dataDstMACAddr,
+                                &ethHdr->dataDstMACMask, varAccess))
+        return false;
+
+    val = virHashLookup(vars, virNWFilterVarAccessGetVarName(varAccess));
+
+    return val && virNWFilterVarValueGetCardinality(val) > 1;
+}
+
+
 /*
  * ebtablesCreateRuleInstance:
  * @fw: the firewall ruleset to add to
@@ -1786,6 +2003,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
     char chain[MAX_CHAINNAME_LENGTH];
     const char *target;
     bool hasMask = false;
+    bool among = ebtablesRuleCanUseAmong(rule, vars->hashTable);
     virFirewallRule *fwrule;
 
     if (STREQ(chainSuffix,
@@ -1842,7 +2060,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.ethHdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         if (HAS_ENTRY_ITEM(&rule->p.ethHdrFilter.dataProtocolID)) {
@@ -1864,7 +2082,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.vlanHdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         virFirewallRuleAddArgList(fw, fwrule,
@@ -1893,7 +2111,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.stpHdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         virFirewallRuleAddArgList(fw, fwrule,
@@ -1929,7 +2147,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.arpHdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         virFirewallRuleAddArg(fw, fwrule, "-p");
@@ -2056,7 +2274,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.ipHdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         virFirewallRuleAddArgList(fw, fwrule,
@@ -2189,7 +2407,7 @@ ebtablesCreateRuleInstance(virFirewall *fw,
         if (ebtablesHandleEthHdr(fw, fwrule,
                                  vars,
                                  &rule->p.ipv6HdrFilter.ethHdr,
-                                 reverse) < 0)
+                                 reverse, among) < 0)
             return -1;
 
         virFirewallRuleAddArgList(fw, fwrule,
@@ -3074,6 +3292,8 @@ ebtablesCleanAll(const char *ifname)
 {
     g_autoptr(virFirewall) fw = virFirewallNew();
 
+    ebiptablesIfaceDigestForget(ifname);
+
     virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
 
     ebtablesUnlinkRootChainFW(fw, true, ifname);
@@ -3249,6 +3469,16 @@ ebtablesRuleInstCommand(virFirewall *fw,
     if (!vciter)
         return -1;
 
+    /* a list of MAC addresses is matched by a single rule */
+    if (ebtablesRuleCanUseAmong(rule->def, rule->vars)) {
+        ret = ebiptablesCreateRuleInstance(fw,
+                                           rule->chainSuffix,
+                                           rule->def,
+                                           ifname,
+                                           vciter);
+        goto cleanup;
+    }
+
     do {
         if (ebiptablesCreateRuleInstance(fw,
                                          rule->chainSuffix,
@@ -3324,10 +3554,13 @@ ebtablesGetSubChainInsts(GHashTable *chains,
 static int
 ebiptablesApplyNewRules(const char *ifname,
                         virNWFilterRuleInst **rules,
-                        size_t nrules)
+                        size_t nrules,
+                        bool *unchanged)
 {
     size_t i, j;
     g_autoptr(virFirewall) fw = virFirewallNew();
+    g_autofree char *fwstr = NULL;
+    g_autofree char *digest = NULL;
     g_autoptr(GHashTable) chains_in_set  = virHashNew(NULL);
     g_autoptr(GHashTable) chains_out_set = virHashNew(NULL);
     bool haveEbtables = false;
@@ -3337,6 +3570,9 @@ ebiptablesApplyNewRules(const char *ifname,
     size_t nsubchains = 0;
     int ret = -1;
 
+    if (unchanged)
+        *unchanged = false;
+
     if (nrules)
         qsort(rules, nrules, sizeof(rules[0]),
               virNWFilterRuleInstSortPtr);
@@ -3516,8 +3752,20 @@ ebiptablesApplyNewRules(const char *ifname,
     ebtablesRemoveTmpRootChainFW(fw, true, ifname);
     ebtablesRemoveTmpRootChainFW(fw, false, ifname);
 
-    if (virFirewallApply(fw) < 0)
+    fwstr = virFirewallFormat(fw);
+    digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, fwstr, -1);
+
+    if (ebiptablesIfaceDigestSetPending(ifname, digest, !!unchanged)) {
+        VIR_DEBUG("Rules of %s are unchanged", ifname);
+        *unchanged = true;
+        ret = 0;
         goto cleanup;
+    }
+
+    if (virFirewallApply(fw) < 0) {
+        ebiptablesIfaceDigestFinish(ifname, false);
+        goto cleanup;
+    }
 
     ret = 0;
 
@@ -3555,6 +3803,8 @@ ebiptablesTearNewRules(const char *ifname)
 
     ebiptablesTearNewRulesFW(fw, ifname);
 
+    ebiptablesIfaceDigestFinish(ifname, false);
+
     return virFirewallApply(fw);
 }
 
@@ -3580,6 +3830,8 @@ ebiptablesTearOldRules(const char *ifname)
     ebtablesRemoveRootChainFW(fw, false, ifname);
     ebtablesRenameTmpSubAndRootChainsFW(fw, ifname);
 
+    ebiptablesIfaceDigestFinish(ifname, true);
+
     return virFirewallApply(fw);
 }
 
@@ -3618,6 +3870,8 @@ ebiptablesAllTeardown(const char *ifname)
     ebtablesRemoveRootChainFW(fw, true, ifname);
     ebtablesRemoveRootChainFW(fw, false, ifname);
 
+    ebiptablesIfaceDigestForget(ifname);
+
     return virFirewallApply(fw);
 }
 
@@ -3742,5 +3996,9 @@ ebiptablesDriverInit(bool privileged)
 static void
 ebiptablesDriverShutdown(void)
 {
+    virMutexLock(&ifaceDigestsLock);
+    g_clear_pointer(&ifaceDigests, g_hash_table_unref);
+    virMutexUnlock(&ifaceDigestsLock);
+
     ebiptables_driver.flags = 0;
 }
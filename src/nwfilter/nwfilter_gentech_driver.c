@@ -573,10 +573,19 @@ virNWFilterDoInstantiate(virNWFilterTechDriver *techdriver,
     }
 
     if (instantiate) {
+        bool unchanged = false;
+
         if (virNWFilterLockIface(binding->portdevname) < 0)
             goto error;
 
-        rc = techdriver->applyNewRules(binding->portdevname, inst.rules, inst.nrules);
+        /* when updating filters, leave interfaces whose instantiated
+         * rules did not change alone */
+        rc = techdriver->applyNewRules(binding->portdevname,
+                                       inst.rules, inst.nrules,
+                                       useNewFilter == INSTANTIATE_FOLLOW_NEWFILTER ?
+                                       &unchanged : NULL);
+        if (rc == 0 && unchanged)
+            *foundNewFilter = false;
 
         if (teardownOld && rc == 0)
             techdriver->tearOldRules(binding->portdevname);
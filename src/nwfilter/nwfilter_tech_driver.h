@@ -41,9 +41,12 @@ struct _virNWFilterRuleInst {
 typedef int (*virNWFilterTechDrvInit)(bool privileged);
 typedef void (*virNWFilterTechDrvShutdown)(void);
 
+/* If @unchanged is not NULL and @rules match the rules currently
+ * applied to @ifname, nothing is done and *unchanged is set to true */
 typedef int (*virNWFilterRuleApplyNewRules)(const char *ifname,
                                             virNWFilterRuleInst **rules,
-                                            size_t nrules);
+                                            size_t nrules,
+                                            bool *unchanged);
 
 typedef int (*virNWFilterRuleTeardownNewRules)(const char *ifname);
 
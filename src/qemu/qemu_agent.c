@@ -77,9 +77,24 @@ struct _qemuAgentMessage {
     bool finished;
     /* true for sync command */
     bool sync;
-    /* id of the issued sync command */
+    /* id of the issued sync command, or of the first of
+     * pipelined commands */
     unsigned long long id;
     bool first;
+
+    /* Number of pipelined commands in txBuffer, 0 if the message
+     * holds a single command. Their replies are collected in
+     * @replies in the order in which the commands were sent */
+    size_t ncmds;
+    size_t nreplies;
+    virJSONValue **replies;
+};
+
+
+typedef struct _qemuAgentPrefetchedReply qemuAgentPrefetchedReply;
+struct _qemuAgentPrefetchedReply {
+    char *cmdname;
+    virJSONValue *reply;
 };
 
 
@@ -121,6 +136,13 @@ struct _qemuAgent {
      * Take that as indication of successful completion */
     qemuAgentEvent await_event;
     int timeout;
+
+    /* Replies to commands sent ahead of time by qemuAgentPrefetch()
+     * waiting to be picked up by the matching qemuAgentCommand() */
+    qemuAgentPrefetchedReply *prefetched;
+    size_t nprefetched;
+    /* id to be used for the next pipelined command */
+    unsigned long long pipelineID;
 };
 
 static virClass *qemuAgentClass;
@@ -163,6 +185,7 @@ static void qemuAgentDispose(void *obj)
 
     VIR_DEBUG("agent=%p", agent);
 
+    qemuAgentPrefetchClear(agent);
     if (agent->vm)
         virObjectUnref(agent->vm);
     virCondDestroy(&agent->notify);
@@ -231,6 +254,33 @@ qemuAgentIOProcessEvent(qemuAgent *agent,
     return 0;
 }
 
+static void
+qemuAgentIOProcessPipelineReply(qemuAgentMessage *msg,
+                                virJSONValue **obj)
+{
+    unsigned long long id;
+    size_t idx = msg->nreplies;
+
+    /* Correlate the reply with its command by the echoed 'id' if
+     * there is one, rely on the order of replies otherwise */
+    if (virJSONValueObjectGetNumberUlong(*obj, "id", &id) == 0) {
+        if (id < msg->id || id - msg->id >= msg->ncmds) {
+            VIR_DEBUG("Ignoring reply with unexpected ID: %llu", id);
+            return;
+        }
+        idx = id - msg->id;
+    }
+
+    if (idx >= msg->ncmds || msg->replies[idx]) {
+        VIR_DEBUG("Ignoring unexpected reply");
+        return;
+    }
+
+    msg->replies[idx] = g_steal_pointer(obj);
+    if (++msg->nreplies == msg->ncmds)
+        msg->finished = true;
+}
+
 static int
 qemuAgentIOProcessLine(qemuAgent *agent,
                        const char *line,
@@ -264,7 +314,9 @@ qemuAgentIOProcessLine(qemuAgent *agent,
         ret = qemuAgentIOProcessEvent(agent, obj);
     } else if (virJSONValueObjectHasKey(obj, "error") == 1 ||
                virJSONValueObjectHasKey(obj, "return") == 1) {
-        if (msg) {
+        if (msg && msg->ncmds > 0) {
+            qemuAgentIOProcessPipelineReply(msg, &obj);
+        } else if (msg) {
             if (msg->sync) {
                 unsigned long long id;
 
@@ -346,9 +398,13 @@ qemuAgentIOProcess(qemuAgent *agent)
     qemuAgentMessage *msg = NULL;
 
     /* See if there's a message ready for reply; that is,
-     * one that has completed writing all its data.
+     * one that has completed writing all its data. Replies to
+     * pipelined commands may arrive while the rest of the commands
+     * is still being written.
      */
-    if (agent->msg && agent->msg->txOffset == agent->msg->txLength)
+    if (agent->msg &&
+        (agent->msg->txOffset == agent->msg->txLength ||
+         (agent->msg->ncmds > 0 && agent->msg->txOffset > 0)))
         msg = agent->msg;
 
 #if DEBUG_IO
@@ -1043,6 +1099,161 @@ qemuAgentCheckError(virJSONValue *cmd,
     return 0;
 }
 
+/**
+ * qemuAgentPrefetchTake:
+ * @agent: agent object
+ * @cmd: command about to be executed
+ *
+ * Returns the reply to @cmd if it was already obtained by
+ * qemuAgentPrefetch(), NULL otherwise. Only commands without
+ * arguments can be prefetched.
+ */
+static virJSONValue *
+qemuAgentPrefetchTake(qemuAgent *agent,
+                      virJSONValue *cmd)
+{
+    const char *cmdname = qemuAgentCommandName(cmd);
+    size_t i;
+
+    if (agent->nprefetched == 0 ||
+        virJSONValueObjectHasKey(cmd, "arguments") == 1)
+        return NULL;
+
+    for (i = 0; i < agent->nprefetched; i++) {
+        if (agent->prefetched[i].reply &&
+            STREQ(agent->prefetched[i].cmdname, cmdname))
+            return g_steal_pointer(&agent->prefetched[i].reply);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * qemuAgentPrefetchClear:
+ * @agent: agent object
+ *
+ * Drop all replies obtained by qemuAgentPrefetch() which were not
+ * used yet.
+ */
+void
+qemuAgentPrefetchClear(qemuAgent *agent)
+{
+    size_t i;
+
+    for (i = 0; i < agent->nprefetched; i++) {
+        g_free(agent->prefetched[i].cmdname);
+        virJSONValueFree(agent->prefetched[i].reply);
+    }
+    g_clear_pointer(&agent->prefetched, g_free);
+    agent->nprefetched = 0;
+}
+
+
+/**
+ * qemuAgentPrefetch:
+ * @agent: agent object
+ * @cmdnames: names of commands without arguments
+ * @ncmdnames: number of items in @cmdnames
+ *
+ * Send all commands from @cmdnames to the guest agent at once and
+ * wait for all their replies. Each reply is then used by the next
+ * execution of the very same command instead of talking to the agent
+ * again, which saves a guest-sync and a round trip per command when
+ * gathering multiple pieces of information from the guest. Replies
+ * which were not used should be dropped by qemuAgentPrefetchClear()
+ * once the caller is done with the agent.
+ *
+ * Returns 0 on success, -1 otherwise (with error reported).
+ */
+int
+qemuAgentPrefetch(qemuAgent *agent,
+                  const char **cmdnames,
+                  size_t ncmdnames)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    qemuAgentMessage msg;
+    int seconds = agent->timeout;
+    int ret = -1;
+    size_t i;
+
+    qemuAgentPrefetchClear(agent);
+
+    if (ncmdnames == 0)
+        return 0;
+
+    if (!agent->running) {
+        virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                       _("Guest agent disappeared while executing command"));
+        return -1;
+    }
+
+    if (qemuAgentGuestSync(agent) < 0)
+        return -1;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.id = agent->pipelineID;
+    msg.ncmds = ncmdnames;
+    msg.replies = g_new0(virJSONValue *, ncmdnames);
+    agent->pipelineID += ncmdnames;
+
+    for (i = 0; i < ncmdnames; i++) {
+        g_autoptr(virJSONValue) cmd = NULL;
+        g_autofree char *cmdstr = NULL;
+
+        if (virJSONValueObjectAdd(&cmd,
+                                  "s:execute", cmdnames[i],
+                                  "U:id", msg.id + i,
+                                  NULL) < 0 ||
+            !(cmdstr = virJSONValueToString(cmd, false)))
+            goto cleanup;
+
+        virBufferAsprintf(&buf, "%s" LINE_ENDING, cmdstr);
+    }
+
+    msg.txBuffer = virBufferContentAndReset(&buf);
+    msg.txLength = strlen(msg.txBuffer);
+
+    /* Give the whole batch as much time as the commands would
+     * get if they were sent one by one */
+    if (seconds == VIR_DOMAIN_QEMU_AGENT_COMMAND_DEFAULT)
+        seconds = QEMU_AGENT_WAIT_TIME;
+    if (seconds > 0)
+        seconds *= ncmdnames;
+
+    VIR_DEBUG("Send %zu pipelined commands, seconds = %d", ncmdnames, seconds);
+
+    if (qemuAgentSend(agent, &msg, seconds) < 0)
+        goto cleanup;
+
+    if (msg.nreplies < msg.ncmds) {
+        if (agent->running)
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing agent reply object"));
+        else
+            virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                           _("Guest agent disappeared while executing command"));
+        goto cleanup;
+    }
+
+    agent->prefetched = g_new0(qemuAgentPrefetchedReply, ncmdnames);
+    agent->nprefetched = ncmdnames;
+    for (i = 0; i < ncmdnames; i++) {
+        agent->prefetched[i].cmdname = g_strdup(cmdnames[i]);
+        agent->prefetched[i].reply = g_steal_pointer(&msg.replies[i]);
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < msg.ncmds; i++)
+        virJSONValueFree(msg.replies[i]);
+    g_free(msg.replies);
+    VIR_FREE(msg.txBuffer);
+    return ret;
+}
+
+
 static int
 qemuAgentCommandFull(qemuAgent *agent,
                      virJSONValue *cmd,
@@ -1064,6 +1275,12 @@ qemuAgentCommandFull(qemuAgent *agent,
         goto cleanup;
     }
 
+    if ((*reply = qemuAgentPrefetchTake(agent, cmd))) {
+        VIR_DEBUG("Using prefetched reply to '%s'", qemuAgentCommandName(cmd));
+        ret = qemuAgentCheckError(cmd, *reply, report_unsupported);
+        goto cleanup;
+    }
+
     if (qemuAgentGuestSync(agent) < 0)
         goto cleanup;
 
@@ -178,6 +178,11 @@ int qemuAgentGetTimezone(qemuAgent *mon,
 void qemuAgentSetResponseTimeout(qemuAgent *mon,
                                  int timeout);
 
+int qemuAgentPrefetch(qemuAgent *agent,
+                      const char **cmdnames,
+                      size_t ncmdnames);
+void qemuAgentPrefetchClear(qemuAgent *agent);
+
 int qemuAgentSSHGetAuthorizedKeys(qemuAgent *agent,
                                   const char *user,
                                   char ***keys);
@@ -526,6 +526,9 @@ qemuBackupDiskStarted(virDomainObj *vm,
  *
  * Exports all disks from @dd when doing a pull backup in the NBD server. This
  * function must be called while in the monitor context.
+ *
+ * Exports of disks which have an iothread are served from it, so that reads
+ * of several exports don't all compete for the main loop.
  */
 static int
 qemuBackupBeginPullExportDisks(virDomainObj *vm,
@@ -536,15 +539,20 @@ qemuBackupBeginPullExportDisks(virDomainObj *vm,
 
     for (i = 0; i < ndisks; i++) {
         struct qemuBackupDiskData *dd = disks + i;
+        g_autofree char *iothread = NULL;
 
         if (!dd->backupdisk->exportname)
             dd->backupdisk->exportname = g_strdup(dd->domdisk->dst);
 
+        if (dd->domdisk->iothread)
+            iothread = g_strdup_printf("iothread%u", dd->domdisk->iothread);
+
         if (qemuBlockExportAddNBD(vm, NULL,
                                   dd->store,
                                   dd->backupdisk->exportname,
                                   false,
-                                  dd->incrementalBitmap) < 0)
+                                  dd->incrementalBitmap,
+                                  iothread) < 0)
             return -1;
     }
 
@@ -759,6 +767,7 @@ qemuBackupBegin(virDomainObj *vm,
     bool job_started = false;
     bool nbd_running = false;
     bool reuse = (flags & VIR_DOMAIN_BACKUP_BEGIN_REUSE_EXTERNAL);
+    unsigned int maxConnections = 0;
     int rc = 0;
     int ret = -1;
 
@@ -809,6 +818,16 @@ qemuBackupBegin(virDomainObj *vm,
         goto endjob;
     }
 
+    if (pull && cfg->backupNBDMaxConnections > 0) {
+        /* 'max-connections' of 'nbd-server-start' was introduced in the same
+         * release as 'block-export-add' */
+        if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCK_EXPORT_ADD))
+            maxConnections = cfg->backupNBDMaxConnections;
+        else
+            VIR_WARN("backup_nbd_max_connections is not supported by this QEMU, "
+                     "ignoring it for domain %s", vm->def->name);
+    }
+
     if (virDomainBackupAlignDisks(def, vm->def, suffix) < 0)
         goto endjob;
 
@@ -881,7 +900,8 @@ qemuBackupBegin(virDomainObj *vm,
             rc = qemuMonitorAddObject(priv->mon, &tlsProps, &tlsAlias);
 
         if (rc == 0) {
-            if ((rc = qemuMonitorNBDServerStart(priv->mon, priv->backup->server, tlsAlias)) == 0)
+            if ((rc = qemuMonitorNBDServerStart(priv->mon, priv->backup->server,
+                                                tlsAlias, maxConnections)) == 0)
                 nbd_running = true;
         }
     }
@@ -3007,6 +3007,39 @@ qemuBlockNamedNodeDataGetBitmapByName(GHashTable *blockNamedNodeData,
 }
 
 
+/**
+ * qemuBlockNamedNodeDataInvalidate:
+ * @vm: domain object
+ *
+ * Drops the cached reply of query-named-block-nodes of @vm so that the next
+ * call to qemuBlockGetNamedNodeData fetches fresh data. This is necessary
+ * when the state of the block nodes changes without libvirt issuing a command
+ * (e.g. block job events) or when volatile data such as the dirty bitmap
+ * counts need to be up to date.
+ */
+void
+qemuBlockNamedNodeDataInvalidate(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    g_clear_pointer(&priv->namedNodeData, g_hash_table_unref);
+}
+
+
+/**
+ * qemuBlockGetNamedNodeData:
+ * @vm: domain object
+ * @asyncJob: qemu asynchronous job type
+ *
+ * Returns the parsed reply of query-named-block-nodes. The data is cached in
+ * the private data of @vm and reused for as long as no command which might
+ * have modified the block nodes was sent to the monitor, so that nested
+ * operations within one job don't need to query and parse it repeatedly. The
+ * cache is dropped when the job finishes or by qemuBlockNamedNodeDataInvalidate.
+ *
+ * The caller must not modify the returned hash table and must release it
+ * by g_hash_table_unref.
+ */
 GHashTable *
 qemuBlockGetNamedNodeData(virDomainObj *vm,
                           qemuDomainAsyncJob asyncJob)
@@ -3016,15 +3049,26 @@ qemuBlockGetNamedNodeData(virDomainObj *vm,
     g_autoptr(GHashTable) blockNamedNodeData = NULL;
     bool supports_flat = virQEMUCapsGet(priv->qemuCaps,
                                         QEMU_CAPS_QMP_QUERY_NAMED_BLOCK_NODES_FLAT);
+    unsigned long long generation;
+
+    if (priv->namedNodeData && priv->mon &&
+        priv->namedNodeDataGeneration == qemuMonitorGetModifyGeneration(priv->mon))
+        return g_hash_table_ref(priv->namedNodeData);
+
+    qemuBlockNamedNodeDataInvalidate(vm);
 
     if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
         return NULL;
 
+    generation = qemuMonitorGetModifyGeneration(priv->mon);
     blockNamedNodeData = qemuMonitorBlockGetNamedNodeData(priv->mon, supports_flat);
 
     if (qemuDomainObjExitMonitor(driver, vm) < 0 || !blockNamedNodeData)
         return NULL;
 
+    priv->namedNodeData = g_hash_table_ref(blockNamedNodeData);
+    priv->namedNodeDataGeneration = generation;
+
     return g_steal_pointer(&blockNamedNodeData);
 }
 
@@ -3537,7 +3581,8 @@ virJSONValue *
 qemuBlockExportGetNBDProps(const char *nodename,
                            const char *exportname,
                            bool writable,
-                           const char **bitmaps)
+                           const char **bitmaps,
+                           const char *iothread)
 {
     g_autofree char *exportid = NULL;
     g_autoptr(virJSONValue) bitmapsarr = NULL;
@@ -3558,6 +3603,7 @@ qemuBlockExportGetNBDProps(const char *nodename,
                               "s:type", "nbd",
                               "s:id", exportid,
                               "s:node-name", nodename,
+                              "S:iothread", iothread,
                               "b:writable", writable,
                               "s:name", exportname,
                               "A:bitmaps", &bitmapsarr,
@@ -3576,10 +3622,13 @@ qemuBlockExportGetNBDProps(const char *nodename,
  * @exportname: name for the export
  * @writable: whether the NBD export allows writes
  * @bitmap: (optional) block dirty bitmap to export along
+ * @iothread: (optional) alias of the iothread to serve the export from
  *
  * This function automatically selects the proper invocation of exporting a
  * block backend via NBD in qemu. This includes use of nodename for blockdev
- * and proper configuration for the exportname for older qemus.
+ * and proper configuration for the exportname for older qemus. @iothread is
+ * ignored by qemus not supporting 'block-export-add', the export is then
+ * served from the main loop.
  *
  * This function must be called while in the monitor context.
  */
@@ -3589,7 +3638,8 @@ qemuBlockExportAddNBD(virDomainObj *vm,
                       virStorageSource *src,
                       const char *exportname,
                       bool writable,
-                      const char *bitmap)
+                      const char *bitmap,
+                      const char *iothread)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
     g_autoptr(virJSONValue) nbdprops = NULL;
@@ -3605,7 +3655,7 @@ qemuBlockExportAddNBD(virDomainObj *vm,
                                        exportname, writable, bitmap);
 
     if (!(nbdprops = qemuBlockExportGetNBDProps(src->nodeformat, exportname,
-                                                writable, bitmaps)))
+                                                writable, bitmaps, iothread)))
         return -1;
 
     return qemuMonitorBlockExportAdd(priv->mon, &nbdprops);
@@ -232,6 +232,9 @@ qemuBlockNamedNodeDataGetBitmapByName(GHashTable *blockNamedNodeData,
                                       virStorageSource *src,
                                       const char *bitmap);
 
+void
+qemuBlockNamedNodeDataInvalidate(virDomainObj *vm);
+
 GHashTable *
 qemuBlockGetNamedNodeData(virDomainObj *vm,
                           qemuDomainAsyncJob asyncJob);
@@ -294,7 +297,8 @@ virJSONValue *
 qemuBlockExportGetNBDProps(const char *nodename,
                            const char *exportname,
                            bool writable,
-                           const char **bitmaps);
+                           const char **bitmaps,
+                           const char *iothread);
 
 
 int
@@ -303,4 +307,5 @@ qemuBlockExportAddNBD(virDomainObj *vm,
                       virStorageSource *src,
                       const char *exportname,
                       bool writable,
-                      const char *bitmap);
+                      const char *bitmap,
+                      const char *iothread);
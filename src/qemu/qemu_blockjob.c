@@ -24,6 +24,7 @@
 #include "internal.h"
 
 #include "qemu_blockjob.h"
+#include "qemu_blockjob_sched.h"
 #include "qemu_block.h"
 #include "qemu_domain.h"
 #include "qemu_alias.h"
@@ -33,6 +34,7 @@
 #include "conf/domain_event.h"
 
 #include "storage_source_conf.h"
+#include "storage_source.h"
 #include "virlog.h"
 #include "virthread.h"
 #include "virtime.h"
@@ -136,6 +138,50 @@ qemuBlockJobDataNew(qemuBlockJobType type,
 }
 
 
+/**
+ * qemuBlockJobSaveStatus:
+ * @vm: domain object
+ *
+ * Saves the status XML of @vm after a change of its block jobs. While a batch
+ * of block job updates is being processed (see qemuBlockJobBatchBegin) the
+ * status is saved only once when the batch ends.
+ */
+static void
+qemuBlockJobSaveStatus(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    if (priv->blockjobsBatch > 0) {
+        priv->blockjobsBatchSave = true;
+        return;
+    }
+
+    qemuDomainSaveStatus(vm);
+}
+
+
+static void
+qemuBlockJobBatchBegin(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    priv->blockjobsBatch++;
+}
+
+
+static void
+qemuBlockJobBatchEnd(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    if (--priv->blockjobsBatch > 0 || !priv->blockjobsBatchSave)
+        return;
+
+    priv->blockjobsBatchSave = false;
+    qemuDomainSaveStatus(vm);
+}
+
+
 /**
  * qemuBlockJobMarkBroken:
  * @job: job to mark as broken
@@ -192,7 +238,7 @@ qemuBlockJobRegister(qemuBlockJobData *job,
     }
 
     if (savestatus)
-        qemuDomainSaveStatus(vm);
+        qemuBlockJobSaveStatus(vm);
 
     return 0;
 }
@@ -216,10 +262,12 @@ qemuBlockJobUnregister(qemuBlockJobData *job,
         job->disk = NULL;
     }
 
+    qemuBlockJobSchedRemove(priv->driver, vm, job);
+
     /* this may remove the last reference of 'job' */
     virHashRemoveEntry(priv->blockjobs, job->name);
 
-    qemuDomainSaveStatus(vm);
+    qemuBlockJobSaveStatus(vm);
 }
 
 
@@ -442,7 +490,7 @@ qemuBlockJobStarted(qemuBlockJobData *job,
     if (job->state == QEMU_BLOCKJOB_STATE_NEW)
         job->state = QEMU_BLOCKJOB_STATE_RUNNING;
 
-    qemuDomainSaveStatus(vm);
+    qemuBlockJobSaveStatus(vm);
 }
 
 
@@ -510,6 +558,8 @@ qemuBlockJobRefreshJobs(virQEMUDriver *driver,
     if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
         goto cleanup;
 
+    qemuBlockJobBatchBegin(vm);
+
     for (i = 0; i < njobinfo; i++) {
         if (!(job = virHashLookup(priv->blockjobs, jobinfo[i]->id))) {
             VIR_DEBUG("ignoring untracked job '%s'", jobinfo[i]->id);
@@ -531,7 +581,7 @@ qemuBlockJobRefreshJobs(virQEMUDriver *driver,
                 VIR_WARN("can't cancel job '%s' with invalid data", job->name);
 
             if (qemuDomainObjExitMonitor(driver, vm) < 0)
-                goto cleanup;
+                goto endbatch;
 
             if (rc < 0)
                 qemuBlockJobUnregister(job, vm);
@@ -567,6 +617,10 @@ qemuBlockJobRefreshJobs(virQEMUDriver *driver,
 
         job->reconnected = true;
 
+        if (job->newstate == -1)
+            qemuBlockJobSchedReconnect(driver, vm, job,
+                                       jobinfo[i]->status == QEMU_MONITOR_JOB_STATUS_PAUSED);
+
         if (job->newstate != -1)
             qemuBlockJobUpdate(vm, job, QEMU_ASYNC_JOB_NONE);
         /* 'job' may be invalid after this update */
@@ -579,8 +633,13 @@ qemuBlockJobRefreshJobs(virQEMUDriver *driver,
         qemuBlockJobUnregister(job, vm);
     }
 
+    qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, false);
+
     ret = 0;
 
+ endbatch:
+    qemuBlockJobBatchEnd(vm);
+
  cleanup:
     for (i = 0; i < njobinfo; i++)
         qemuMonitorJobInfoFree(jobinfo[i]);
@@ -805,7 +864,8 @@ qemuBlockJobEventProcessLegacy(virQEMUDriver *driver,
 
     case VIR_DOMAIN_BLOCK_JOB_READY:
         disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_READY;
-        qemuDomainSaveStatus(vm);
+        qemuBlockJobSchedRemove(driver, vm, job);
+        qemuBlockJobSaveStatus(vm);
         break;
 
     case VIR_DOMAIN_BLOCK_JOB_FAILED:
@@ -1545,6 +1605,14 @@ qemuBlockJobEventProcessConcludedTransition(qemuBlockJobData *job,
 {
     bool success = job->newstate == QEMU_BLOCKJOB_STATE_COMPLETED;
 
+    /* the images of the chain may have been rewritten by the job */
+    if (job->disk) {
+        virStorageSourceHeaderCacheInvalidate(job->disk->src);
+        virStorageSourceHeaderCacheInvalidate(job->disk->mirror);
+    }
+    if (job->type == QEMU_BLOCKJOB_TYPE_CREATE)
+        virStorageSourceHeaderCacheInvalidate(job->data.create.src);
+
     switch ((qemuBlockJobType) job->type) {
     case QEMU_BLOCKJOB_TYPE_PULL:
         if (success)
@@ -1650,7 +1718,7 @@ qemuBlockJobEventProcessConcluded(qemuBlockJobData *job,
         job->newstate = QEMU_BLOCKJOB_STATE_CANCELLED;
 
     if (refreshed)
-        qemuDomainSaveStatus(vm);
+        qemuBlockJobSaveStatus(vm);
 
     VIR_DEBUG("handling job '%s' state '%d' newstate '%d'", job->name, job->state, job->newstate);
 
@@ -1708,8 +1776,10 @@ qemuBlockJobEventProcess(virQEMUDriver *driver,
                 job->disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_READY;
                 qemuBlockJobEmitEvents(driver, vm, job->disk, job->type, job->newstate);
             }
+            /* the job only mirrors guest writes from now on */
+            qemuBlockJobSchedRemove(driver, vm, job);
             job->state = job->newstate;
-            qemuDomainSaveStatus(vm);
+            qemuBlockJobSaveStatus(vm);
         }
         job->newstate = -1;
         break;
@@ -1752,6 +1822,60 @@ qemuBlockJobUpdate(virDomainObj *vm,
 }
 
 
+/**
+ * qemuBlockJobUpdateAll:
+ * @vm: domain
+ * @job: job data (may be NULL)
+ * @asyncJob: current qemu asynchronous job type
+ *
+ * Process the state change of @job along with the pending state changes of
+ * all other block jobs of @vm which are not handled synchronously. With many
+ * jobs changing state at once (e.g. when mirroring lots of disks) this handles
+ * the changes which piled up in one go and saves the status XML only once
+ * rather than once per job; the events queued for the other jobs then find
+ * nothing to do.
+ */
+void
+qemuBlockJobUpdateAll(virDomainObj *vm,
+                      qemuBlockJobData *job,
+                      int asyncJob)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autofree virHashKeyValuePair *items = NULL;
+    g_autofree qemuBlockJobData **jobs = NULL;
+    size_t njobs = 0;
+    size_t i;
+
+    if (!(items = virHashGetItems(priv->blockjobs, &njobs, false)))
+        return;
+
+    /* handling one job may unregister others, keep them referenced */
+    jobs = g_new0(qemuBlockJobData *, njobs);
+    for (i = 0; i < njobs; i++)
+        jobs[i] = virObjectRef((void *) items[i].value);
+
+    qemuBlockJobBatchBegin(vm);
+
+    if (job)
+        qemuBlockJobUpdate(vm, job, asyncJob);
+
+    for (i = 0; i < njobs; i++) {
+        if (jobs[i] == job ||
+            jobs[i]->synchronous ||
+            jobs[i]->newstate == -1 ||
+            virHashLookup(priv->blockjobs, jobs[i]->name) != jobs[i])
+            continue;
+
+        qemuBlockJobUpdate(vm, jobs[i], asyncJob);
+    }
+
+    qemuBlockJobBatchEnd(vm);
+
+    for (i = 0; i < njobs; i++)
+        virObjectUnref(jobs[i]);
+}
+
+
 /**
  * qemuBlockJobSyncBegin:
  * @job: block job data
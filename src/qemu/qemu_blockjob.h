@@ -222,6 +222,12 @@ qemuBlockJobUpdate(virDomainObj *vm,
                    qemuBlockJobData *job,
                    int asyncJob);
 
+void
+qemuBlockJobUpdateAll(virDomainObj *vm,
+                      qemuBlockJobData *job,
+                      int asyncJob)
+    ATTRIBUTE_NONNULL(1);
+
 void qemuBlockJobSyncBegin(qemuBlockJobData *job);
 void qemuBlockJobSyncEnd(virDomainObj *vm,
                          qemuBlockJobData *job,
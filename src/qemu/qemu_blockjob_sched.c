@@ -0,0 +1,832 @@
+/*
+ * qemu_blockjob_sched.c: QEMU host-wide block job scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "qemu_blockjob_sched.h"
+#include "qemu_domain.h"
+#include "qemu_monitor.h"
+#include "qemu_process.h"
+#include "virerror.h"
+#include "virlog.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+VIR_LOG_INIT("qemu.qemu_blockjob_sched");
+
+/*
+ * When block_job_pool_bandwidth or block_job_pool_max_concurrent is set in
+ * qemu.conf, block pull, commit and copy jobs started by the user are
+ * scheduled across all domains. Jobs are grouped by the storage pool of the
+ * disk they run on, disks which are not pool volumes form one more group.
+ *
+ * Jobs which are not admitted by the scheduler are paused right after they
+ * are started. Waiting jobs are admitted in the order of the blkio weight of
+ * their domain and resumed by the worker thread of their domain. The
+ * bandwidth of a group is split among its running jobs in proportion to the
+ * weight, except for those limited to a lower bandwidth by the user, and
+ * redistributed every time a job is admitted or finishes.
+ *
+ * With block_job_latency_target set, a timer periodically asks the domains
+ * running scheduled jobs to sample the I/O latency of their disks. The
+ * bandwidth of a group is halved whenever the latency observed on it
+ * exceeds the target and raised back in small steps otherwise.
+ */
+
+#define QEMU_BLOCKJOB_SCHED_DEFAULT_WEIGHT 500
+#define QEMU_BLOCKJOB_SCHED_MIN_SHARE (1024ULL * 1024ULL)
+#define QEMU_BLOCKJOB_SCHED_INTERVAL 5000
+#define QEMU_BLOCKJOB_SCHED_MIN_SCALE 5
+#define QEMU_BLOCKJOB_SCHED_SCALE_STEP 10
+
+typedef struct _qemuBlockJobSchedGroup qemuBlockJobSchedGroup;
+struct _qemuBlockJobSchedGroup {
+    char *name;
+    size_t nentries;
+    size_t nactive;
+    unsigned int scale;         /* percents of the configured bandwidth */
+    unsigned long long latency; /* highest latency sampled since last tick */
+};
+
+typedef struct _qemuBlockJobSchedEntry qemuBlockJobSchedEntry;
+struct _qemuBlockJobSchedEntry {
+    virDomainObj *vm;
+    char *jobname;
+    qemuBlockJobSchedGroup *group;
+    unsigned int weight;
+    unsigned long long seq;
+    unsigned long long limit;   /* bytes/s requested for the job, 0 if unlimited */
+    unsigned long long share;   /* bytes/s assigned by the scheduler */
+    unsigned long long applied; /* bytes/s currently set in QEMU */
+    bool active;
+    bool paused;                /* the job is paused in QEMU */
+    bool notified;              /* an event is queued for the domain */
+};
+
+struct _qemuBlockJobSched {
+    virMutex lock;
+    virQEMUDriver *driver;
+    GPtrArray *entries;
+    GHashTable *groups;
+    unsigned long long seq;
+    int timer;
+};
+
+
+static void
+qemuBlockJobSchedGroupFree(void *opaque)
+{
+    qemuBlockJobSchedGroup *group = opaque;
+
+    g_free(group->name);
+    g_free(group);
+}
+
+
+static void
+qemuBlockJobSchedEntryFree(void *opaque)
+{
+    qemuBlockJobSchedEntry *entry = opaque;
+
+    virObjectUnref(entry->vm);
+    g_free(entry->jobname);
+    g_free(entry);
+}
+
+
+qemuBlockJobSched *
+qemuBlockJobSchedNew(virQEMUDriver *driver)
+{
+    qemuBlockJobSched *sched = g_new0(qemuBlockJobSched, 1);
+
+    if (virMutexInit(&sched->lock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize block job scheduler mutex"));
+        g_free(sched);
+        return NULL;
+    }
+
+    sched->driver = driver;
+    sched->entries = g_ptr_array_new_with_free_func(qemuBlockJobSchedEntryFree);
+    sched->groups = virHashNew(qemuBlockJobSchedGroupFree);
+    sched->timer = -1;
+
+    return sched;
+}
+
+
+void
+qemuBlockJobSchedFree(qemuBlockJobSched *sched)
+{
+    if (!sched)
+        return;
+
+    if (sched->timer >= 0)
+        virEventRemoveTimeout(sched->timer);
+
+    g_ptr_array_unref(sched->entries);
+    g_clear_pointer(&sched->groups, g_hash_table_unref);
+    virMutexDestroy(&sched->lock);
+    g_free(sched);
+}
+
+
+static bool
+qemuBlockJobSchedEnabled(virQEMUDriverConfig *cfg)
+{
+    return cfg->blockJobPoolBandwidth > 0 || cfg->blockJobPoolMaxConcurrent > 0;
+}
+
+
+static const char *
+qemuBlockJobSchedDiskGroup(virDomainDiskDef *disk)
+{
+    if (disk->src->srcpool && disk->src->srcpool->pool)
+        return disk->src->srcpool->pool;
+
+    return "";
+}
+
+
+static qemuBlockJobSchedEntry *
+qemuBlockJobSchedFind(qemuBlockJobSched *sched,
+                      virDomainObj *vm,
+                      const char *jobname,
+                      size_t *idx)
+{
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->vm == vm && STREQ(entry->jobname, jobname)) {
+            if (idx)
+                *idx = i;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Whether QEMU needs to be told about a changed state of @entry. */
+static bool
+qemuBlockJobSchedEntryChanged(qemuBlockJobSchedEntry *entry)
+{
+    if (!entry->active)
+        return !entry->paused;
+
+    return entry->paused || entry->share != entry->applied;
+}
+
+
+static void
+qemuBlockJobSchedNotify(qemuBlockJobSched *sched,
+                        virDomainObj *vm)
+{
+    struct qemuProcessEvent *processEvent;
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->vm == vm && entry->notified)
+            return;
+    }
+
+    processEvent = g_new0(struct qemuProcessEvent, 1);
+    processEvent->eventType = QEMU_PROCESS_EVENT_BLOCKJOB_SCHED;
+    processEvent->vm = virObjectRef(vm);
+
+    if (qemuProcessEventSubmit(sched->driver, &processEvent) < 0)
+        return;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->vm == vm)
+            entry->notified = true;
+    }
+}
+
+
+/* Orders entries by the bandwidth they are limited to relative to their
+ * weight, unlimited ones go last. */
+static gint
+qemuBlockJobSchedCompareLimit(gconstpointer a,
+                              gconstpointer b)
+{
+    const qemuBlockJobSchedEntry *ea = *(qemuBlockJobSchedEntry **) a;
+    const qemuBlockJobSchedEntry *eb = *(qemuBlockJobSchedEntry **) b;
+    double ra = (double) ea->limit / ea->weight;
+    double rb = (double) eb->limit / eb->weight;
+
+    if (ea->limit == 0 || eb->limit == 0)
+        return (ea->limit == 0) - (eb->limit == 0);
+
+    if (ra < rb)
+        return -1;
+    return ra > rb;
+}
+
+
+/* Returns the waiting entry of @group which should be admitted next: the one
+ * with the highest weight, the one which was queued first wins a tie. */
+static qemuBlockJobSchedEntry *
+qemuBlockJobSchedNext(qemuBlockJobSched *sched,
+                      qemuBlockJobSchedGroup *group)
+{
+    qemuBlockJobSchedEntry *next = NULL;
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->group != group || entry->active)
+            continue;
+
+        if (!next ||
+            entry->weight > next->weight ||
+            (entry->weight == next->weight && entry->seq < next->seq))
+            next = entry;
+    }
+
+    return next;
+}
+
+
+/* Admits waiting jobs of @group while there are free slots and splits the
+ * bandwidth of the group among its running jobs. Domains whose jobs need to
+ * be updated in QEMU are notified, except for @self which is expected to
+ * apply the changes right away. Must be called with the scheduler locked. */
+static void
+qemuBlockJobSchedRebalance(qemuBlockJobSched *sched,
+                           qemuBlockJobSchedGroup *group,
+                           virQEMUDriverConfig *cfg,
+                           virDomainObj *self,
+                           bool notify)
+{
+    g_autoptr(GPtrArray) active = g_ptr_array_new();
+    qemuBlockJobSchedEntry *next;
+    unsigned long long remaining;
+    unsigned long long weights = 0;
+    size_t i;
+
+    while ((cfg->blockJobPoolMaxConcurrent == 0 ||
+            group->nactive < cfg->blockJobPoolMaxConcurrent) &&
+           (next = qemuBlockJobSchedNext(sched, group))) {
+        next->active = true;
+        group->nactive++;
+
+        VIR_DEBUG("Admitted block job '%s' of domain %s, %zu active jobs in group '%s'",
+                  next->jobname, next->vm->def->name, group->nactive, group->name);
+    }
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->group != group || !entry->active)
+            continue;
+
+        g_ptr_array_add(active, entry);
+        weights += entry->weight;
+    }
+
+    g_ptr_array_sort(active, qemuBlockJobSchedCompareLimit);
+
+    remaining = cfg->blockJobPoolBandwidth * 1024ULL * 1024ULL / 100 * group->scale;
+
+    for (i = 0; i < active->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(active, i);
+        unsigned long long fair;
+
+        if (cfg->blockJobPoolBandwidth == 0) {
+            entry->share = entry->limit;
+            continue;
+        }
+
+        fair = (unsigned long long) ((double) remaining * entry->weight / weights);
+        fair = MAX(fair, QEMU_BLOCKJOB_SCHED_MIN_SHARE);
+
+        if (entry->limit > 0)
+            entry->share = MIN(fair, entry->limit);
+        else
+            entry->share = fair;
+
+        remaining -= MIN(entry->share, remaining);
+        weights -= entry->weight;
+    }
+
+    if (!notify)
+        return;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->group == group && entry->vm != self &&
+            qemuBlockJobSchedEntryChanged(entry))
+            qemuBlockJobSchedNotify(sched, entry->vm);
+    }
+}
+
+
+static void
+qemuBlockJobSchedTimer(int timer G_GNUC_UNUSED,
+                       void *opaque)
+{
+    qemuBlockJobSched *sched = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(sched->driver);
+    unsigned long long target = cfg->blockJobLatencyTarget * 1000ULL * 1000ULL;
+    GHashTableIter htitr;
+    void *value;
+    size_t i;
+
+    virMutexLock(&sched->lock);
+
+    g_hash_table_iter_init(&htitr, sched->groups);
+    while (g_hash_table_iter_next(&htitr, NULL, &value)) {
+        qemuBlockJobSchedGroup *group = value;
+        unsigned int scale = group->scale;
+
+        if (target > 0 && group->latency > target)
+            scale = MAX(scale / 2, QEMU_BLOCKJOB_SCHED_MIN_SCALE);
+        else
+            scale = MIN(scale + QEMU_BLOCKJOB_SCHED_SCALE_STEP, 100);
+
+        if (scale != group->scale) {
+            VIR_DEBUG("Scaling bandwidth of block job group '%s' to %u%%, latency %llu ns",
+                      group->name, scale, group->latency);
+            group->scale = scale;
+        }
+
+        group->latency = 0;
+        qemuBlockJobSchedRebalance(sched, group, cfg, NULL, false);
+    }
+
+    /* every domain samples the latency of its disks and applies its shares */
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        qemuBlockJobSchedNotify(sched, entry->vm);
+    }
+
+    virMutexUnlock(&sched->lock);
+}
+
+
+static void
+qemuBlockJobSchedInsert(qemuBlockJobSched *sched,
+                        virDomainObj *vm,
+                        qemuBlockJobData *job,
+                        virQEMUDriverConfig *cfg,
+                        unsigned long long limit,
+                        bool paused)
+{
+    const char *groupname = qemuBlockJobSchedDiskGroup(job->disk);
+    qemuBlockJobSchedGroup *group;
+    qemuBlockJobSchedEntry *entry;
+
+    if (!(group = virHashLookup(sched->groups, groupname))) {
+        group = g_new0(qemuBlockJobSchedGroup, 1);
+        group->name = g_strdup(groupname);
+        group->scale = 100;
+        g_hash_table_insert(sched->groups, g_strdup(groupname), group);
+    }
+
+    entry = g_new0(qemuBlockJobSchedEntry, 1);
+    entry->vm = virObjectRef(vm);
+    entry->jobname = g_strdup(job->name);
+    entry->group = group;
+    entry->weight = vm->def->blkio.weight;
+    if (entry->weight == 0)
+        entry->weight = QEMU_BLOCKJOB_SCHED_DEFAULT_WEIGHT;
+    entry->seq = sched->seq++;
+    entry->limit = limit;
+    entry->applied = limit;
+    entry->paused = paused;
+
+    g_ptr_array_add(sched->entries, entry);
+    group->nentries++;
+
+    if (cfg->blockJobLatencyTarget > 0 &&
+        cfg->blockJobPoolBandwidth > 0 &&
+        sched->timer < 0) {
+        if ((sched->timer = virEventAddTimeout(QEMU_BLOCKJOB_SCHED_INTERVAL,
+                                               qemuBlockJobSchedTimer,
+                                               sched, NULL)) < 0) {
+            VIR_WARN("unable to register block job scheduler timer");
+            virResetLastError();
+        }
+    }
+
+    VIR_DEBUG("Queued block job '%s' of domain %s in group '%s'",
+              entry->jobname, vm->def->name, group->name);
+
+    qemuBlockJobSchedRebalance(sched, group, cfg, vm, true);
+}
+
+
+/**
+ * qemuBlockJobSchedAdd:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @job: block job about to be started
+ * @speed: bandwidth of the job in bytes/s, 0 if unlimited
+ *
+ * Registers @job with the scheduler and replaces @speed with the bandwidth
+ * the job should be started with. If the job is not admitted right away it
+ * is paused by qemuBlockJobSchedApply, which the caller has to call once the
+ * job is started in QEMU. When scheduling is not configured this function
+ * does nothing.
+ */
+void
+qemuBlockJobSchedAdd(virQEMUDriver *driver,
+                     virDomainObj *vm,
+                     qemuBlockJobData *job,
+                     unsigned long long *speed)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuBlockJobSched *sched = driver->blockjobSched;
+    qemuBlockJobSchedEntry *entry;
+
+    if (!sched || !job->disk || !qemuBlockJobSchedEnabled(cfg))
+        return;
+
+    virMutexLock(&sched->lock);
+    qemuBlockJobSchedInsert(sched, vm, job, cfg, *speed, false);
+
+    if ((entry = qemuBlockJobSchedFind(sched, vm, job->name, NULL)) &&
+        entry->active)
+        *speed = entry->applied = entry->share;
+    virMutexUnlock(&sched->lock);
+}
+
+
+/**
+ * qemuBlockJobSchedReconnect:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @job: running block job
+ * @paused: whether QEMU reports the job as paused
+ *
+ * Registers @job which was running before libvirtd was restarted with the
+ * scheduler. The bandwidth originally requested for the job is not known,
+ * so it's considered unlimited.
+ */
+void
+qemuBlockJobSchedReconnect(virQEMUDriver *driver,
+                           virDomainObj *vm,
+                           qemuBlockJobData *job,
+                           bool paused)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuBlockJobSched *sched = driver->blockjobSched;
+
+    if (!sched || !job->disk || !qemuBlockJobSchedEnabled(cfg))
+        return;
+
+    switch ((qemuBlockJobType) job->type) {
+    case QEMU_BLOCKJOB_TYPE_PULL:
+    case QEMU_BLOCKJOB_TYPE_COMMIT:
+    case QEMU_BLOCKJOB_TYPE_ACTIVE_COMMIT:
+    case QEMU_BLOCKJOB_TYPE_COPY:
+        break;
+
+    case QEMU_BLOCKJOB_TYPE_NONE:
+    case QEMU_BLOCKJOB_TYPE_BACKUP:
+    case QEMU_BLOCKJOB_TYPE_INTERNAL:
+    case QEMU_BLOCKJOB_TYPE_CREATE:
+    case QEMU_BLOCKJOB_TYPE_BROKEN:
+    case QEMU_BLOCKJOB_TYPE_LAST:
+    default:
+        return;
+    }
+
+    if (job->synchronous ||
+        (job->state != QEMU_BLOCKJOB_STATE_NEW &&
+         job->state != QEMU_BLOCKJOB_STATE_RUNNING))
+        return;
+
+    virMutexLock(&sched->lock);
+    if (!qemuBlockJobSchedFind(sched, vm, job->name, NULL))
+        qemuBlockJobSchedInsert(sched, vm, job, cfg, 0, paused);
+    virMutexUnlock(&sched->lock);
+}
+
+
+/**
+ * qemuBlockJobSchedSetLimit:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @job: block job
+ * @speed: bandwidth requested for the job in bytes/s, 0 if unlimited
+ *
+ * Updates the bandwidth the user requested for @job. The caller has to
+ * call qemuBlockJobSchedApply to apply the resulting bandwidth.
+ *
+ * Returns true if @job is scheduled, false if the caller should set the
+ * bandwidth directly.
+ */
+bool
+qemuBlockJobSchedSetLimit(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          qemuBlockJobData *job,
+                          unsigned long long speed)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuBlockJobSched *sched = driver->blockjobSched;
+    qemuBlockJobSchedEntry *entry;
+
+    if (!sched)
+        return false;
+
+    virMutexLock(&sched->lock);
+    if (!(entry = qemuBlockJobSchedFind(sched, vm, job->name, NULL))) {
+        virMutexUnlock(&sched->lock);
+        return false;
+    }
+
+    entry->limit = speed;
+    qemuBlockJobSchedRebalance(sched, entry->group, cfg, vm, true);
+    virMutexUnlock(&sched->lock);
+
+    return true;
+}
+
+
+/**
+ * qemuBlockJobSchedRemove:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @job: block job
+ *
+ * Removes @job from the scheduler once it finished or reached the ready
+ * state and lets the next waiting job of its group run.
+ */
+void
+qemuBlockJobSchedRemove(virQEMUDriver *driver,
+                        virDomainObj *vm,
+                        qemuBlockJobData *job)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = NULL;
+    qemuBlockJobSched *sched = driver ? driver->blockjobSched : NULL;
+    qemuBlockJobSchedEntry *entry;
+    qemuBlockJobSchedGroup *group;
+    size_t idx;
+
+    if (!sched)
+        return;
+
+    virMutexLock(&sched->lock);
+    if (!(entry = qemuBlockJobSchedFind(sched, vm, job->name, &idx))) {
+        virMutexUnlock(&sched->lock);
+        return;
+    }
+
+    VIR_DEBUG("Removing block job '%s' of domain %s from group '%s'",
+              entry->jobname, vm->def->name, entry->group->name);
+
+    group = entry->group;
+    if (entry->active)
+        group->nactive--;
+    group->nentries--;
+    g_ptr_array_remove_index(sched->entries, idx);
+
+    if (group->nentries == 0) {
+        g_hash_table_remove(sched->groups, group->name);
+    } else {
+        cfg = virQEMUDriverGetConfig(driver);
+        qemuBlockJobSchedRebalance(sched, group, cfg, NULL, true);
+    }
+
+    if (sched->entries->len == 0 && sched->timer >= 0) {
+        virEventRemoveTimeout(sched->timer);
+        sched->timer = -1;
+    }
+    virMutexUnlock(&sched->lock);
+}
+
+
+/* Samples the average latency of guest I/O requests on disks of @vm since
+ * the previous sample and reports it to the groups of the disks. */
+static void
+qemuBlockJobSchedSample(virQEMUDriver *driver,
+                        virDomainObj *vm,
+                        qemuDomainAsyncJob asyncJob)
+{
+    qemuBlockJobSched *sched = driver->blockjobSched;
+    qemuDomainObjPrivate *priv = vm->privateData;
+    bool blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV);
+    g_autoptr(GHashTable) blockstats = NULL;
+    size_t i;
+    int rc;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return;
+
+    rc = qemuMonitorGetAllBlockStatsInfo(priv->mon, &blockstats);
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0) {
+        virResetLastError();
+        return;
+    }
+
+    for (i = 0; i < vm->def->ndisks; i++) {
+        virDomainDiskDef *disk = vm->def->disks[i];
+        qemuDomainDiskPrivate *diskPriv = QEMU_DOMAIN_DISK_PRIVATE(disk);
+        const char *entryname = disk->info.alias;
+        qemuBlockStats *stats;
+        qemuBlockJobSchedGroup *group;
+        unsigned long long time;
+        unsigned long long reqs;
+
+        if (blockdev && diskPriv->qomName)
+            entryname = diskPriv->qomName;
+
+        if (!entryname || !(stats = virHashLookup(blockstats, entryname)))
+            continue;
+
+        time = stats->rd_total_times + stats->wr_total_times +
+               stats->flush_total_times;
+        reqs = stats->rd_req + stats->wr_req + stats->flush_req;
+
+        if (diskPriv->schedIOReqs > 0 && reqs > diskPriv->schedIOReqs &&
+            time >= diskPriv->schedIOTime) {
+            unsigned long long latency = (time - diskPriv->schedIOTime) /
+                                         (reqs - diskPriv->schedIOReqs);
+
+            virMutexLock(&sched->lock);
+            if ((group = virHashLookup(sched->groups,
+                                       qemuBlockJobSchedDiskGroup(disk))))
+                group->latency = MAX(group->latency, latency);
+            virMutexUnlock(&sched->lock);
+        }
+
+        diskPriv->schedIOTime = time;
+        diskPriv->schedIOReqs = reqs;
+    }
+}
+
+
+typedef struct _qemuBlockJobSchedAction qemuBlockJobSchedAction;
+struct _qemuBlockJobSchedAction {
+    char *jobname;
+    bool setspeed;
+    unsigned long long speed;
+    bool pause;
+    bool resume;
+};
+
+
+static void
+qemuBlockJobSchedActionFree(void *opaque)
+{
+    qemuBlockJobSchedAction *action = opaque;
+
+    g_free(action->jobname);
+    g_free(action);
+}
+
+
+/**
+ * qemuBlockJobSchedApply:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @asyncJob: current asynchronous job
+ * @sample: sample the I/O latency of the disks of @vm first
+ *
+ * Brings the block jobs of @vm in line with the decisions of the scheduler:
+ * sets the bandwidth assigned to each running job, pauses jobs which were
+ * not admitted and resumes those which were. Failures are only logged as
+ * the job may have finished meanwhile. The caller must hold a job on @vm.
+ */
+void
+qemuBlockJobSchedApply(virQEMUDriver *driver,
+                       virDomainObj *vm,
+                       qemuDomainAsyncJob asyncJob,
+                       bool sample)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuBlockJobSched *sched = driver->blockjobSched;
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(GPtrArray) actions = NULL;
+    size_t i;
+
+    if (!sched || !virDomainObjIsActive(vm))
+        return;
+
+    if (sample &&
+        cfg->blockJobLatencyTarget > 0 &&
+        cfg->blockJobPoolBandwidth > 0)
+        qemuBlockJobSchedSample(driver, vm, asyncJob);
+
+    actions = g_ptr_array_new_with_free_func(qemuBlockJobSchedActionFree);
+
+    virMutexLock(&sched->lock);
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+        qemuBlockJobSchedAction *action;
+
+        if (entry->vm != vm || !qemuBlockJobSchedEntryChanged(entry))
+            continue;
+
+        action = g_new0(qemuBlockJobSchedAction, 1);
+        action->jobname = g_strdup(entry->jobname);
+
+        if (entry->active) {
+            action->setspeed = entry->share != entry->applied;
+            action->speed = entry->share;
+            action->resume = entry->paused;
+            entry->applied = entry->share;
+            entry->paused = false;
+        } else {
+            action->pause = true;
+            entry->paused = true;
+        }
+
+        g_ptr_array_add(actions, action);
+    }
+    virMutexUnlock(&sched->lock);
+
+    if (actions->len == 0)
+        return;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return;
+
+    for (i = 0; i < actions->len; i++) {
+        qemuBlockJobSchedAction *action = g_ptr_array_index(actions, i);
+
+        VIR_DEBUG("Updating block job '%s' of domain %s: speed=%llu pause=%d resume=%d",
+                  action->jobname, vm->def->name,
+                  action->setspeed ? action->speed : 0,
+                  action->pause, action->resume);
+
+        if ((action->setspeed &&
+             qemuMonitorBlockJobSetSpeed(priv->mon, action->jobname,
+                                         action->speed) < 0) ||
+            (action->pause &&
+             qemuMonitorBlockJobPause(priv->mon, action->jobname) < 0) ||
+            (action->resume &&
+             qemuMonitorBlockJobResume(priv->mon, action->jobname) < 0)) {
+            VIR_WARN("unable to update block job '%s' of domain %s: %s",
+                     action->jobname, vm->def->name, virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    ignore_value(qemuDomainObjExitMonitor(driver, vm));
+}
+
+
+/**
+ * qemuBlockJobSchedProcessEvent:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Handles the event the scheduler queued for @vm when the state of its block
+ * jobs changed or their disks should be sampled.
+ */
+void
+qemuBlockJobSchedProcessEvent(virQEMUDriver *driver,
+                              virDomainObj *vm)
+{
+    qemuBlockJobSched *sched = driver->blockjobSched;
+    size_t i;
+
+    if (!sched)
+        return;
+
+    virMutexLock(&sched->lock);
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuBlockJobSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->vm == vm)
+            entry->notified = false;
+    }
+    virMutexUnlock(&sched->lock);
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        return;
+
+    qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, true);
+
+    qemuDomainObjEndJob(driver, vm);
+}
@@ -0,0 +1,63 @@
+/*
+ * qemu_blockjob_sched.h: QEMU host-wide block job scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "qemu_conf.h"
+#include "qemu_blockjob.h"
+#include "qemu_domainjob.h"
+
+qemuBlockJobSched *
+qemuBlockJobSchedNew(virQEMUDriver *driver);
+
+void
+qemuBlockJobSchedFree(qemuBlockJobSched *sched);
+
+void
+qemuBlockJobSchedAdd(virQEMUDriver *driver,
+                     virDomainObj *vm,
+                     qemuBlockJobData *job,
+                     unsigned long long *speed);
+
+void
+qemuBlockJobSchedReconnect(virQEMUDriver *driver,
+                           virDomainObj *vm,
+                           qemuBlockJobData *job,
+                           bool paused);
+
+bool
+qemuBlockJobSchedSetLimit(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          qemuBlockJobData *job,
+                          unsigned long long speed);
+
+void
+qemuBlockJobSchedRemove(virQEMUDriver *driver,
+                        virDomainObj *vm,
+                        qemuBlockJobData *job);
+
+void
+qemuBlockJobSchedApply(virQEMUDriver *driver,
+                       virDomainObj *vm,
+                       qemuDomainAsyncJob asyncJob,
+                       bool sample);
+
+void
+qemuBlockJobSchedProcessEvent(virQEMUDriver *driver,
+                              virDomainObj *vm);
@@ -51,6 +51,7 @@
 #include "virutil.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdarg.h>
@@ -651,6 +652,11 @@ VIR_ENUM_IMPL(virQEMUCaps,
               "device.json", /* QEMU_CAPS_DEVICE_JSON */
               "query-dirty-rate", /* QEMU_CAPS_QUERY_DIRTY_RATE */
               "rbd-encryption", /* QEMU_CAPS_RBD_ENCRYPTION */
+              "query-stats", /* QEMU_CAPS_QUERY_STATS */
+              "query-stats-schemas", /* QEMU_CAPS_QUERY_STATS_SCHEMAS */
+
+              /* 420 */
+              "memory-backend-file.prealloc-threads", /* QEMU_CAPS_MEMORY_BACKEND_PREALLOC_THREADS */
     );
 
 
@@ -732,9 +738,18 @@ struct _virQEMUCaps {
 
     virSEVCapability *sevCapabilities;
 
+    size_t nstatsSchema;
+    qemuMonitorQueryStatsSchemaData *statsSchema;
+
     /* Capabilities which may differ depending on the accelerator. */
     virQEMUCapsAccel kvm;
     virQEMUCapsAccel tcg;
+
+    /* Capabilities stored in the cache are never modified once probed.
+     * Per-domain copies only need their own flags, so everything from
+     * @cpuData up to here is borrowed from @base until any of it needs
+     * to be changed, see virQEMUCapsUnshare. */
+    virQEMUCaps *base;
 };
 
 struct virQEMUCapsSearchData {
@@ -1106,6 +1121,43 @@ virQEMUCapsProbeHostCPU(virArch hostArch,
 }
 
 
+/*
+ * Probes all emulator binaries virQEMUCapsInit will ask for on a pool of
+ * worker threads rather than one after another.
+ */
+static void
+virQEMUCapsPrefetchGuests(virFileCache *cache,
+                          virArch hostarch)
+{
+    g_autoptr(GPtrArray) binaries = g_ptr_array_new_with_free_func(g_free);
+    size_t i;
+
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        char *binary = virQEMUCapsGetDefaultEmulator(hostarch, i);
+        size_t j;
+
+        if (!binary)
+            continue;
+
+        for (j = 0; j < binaries->len; j++) {
+            if (STREQ(binary, g_ptr_array_index(binaries, j)))
+                break;
+        }
+
+        if (j < binaries->len)
+            g_free(binary);
+        else
+            g_ptr_array_add(binaries, binary);
+    }
+
+    if (binaries->len == 0)
+        return;
+
+    g_ptr_array_add(binaries, NULL);
+    virQEMUCapsCachePrefetch(cache, (const char *const *) binaries->pdata);
+}
+
+
 virCaps *
 virQEMUCapsInit(virFileCache *cache)
 {
@@ -1139,6 +1191,8 @@ virQEMUCapsInit(virFileCache *cache)
      * so just probe for them all - we gracefully fail
      * if a qemu-system-$ARCH binary can't be found
      */
+    virQEMUCapsPrefetchGuests(cache, hostarch);
+
     for (i = 0; i < VIR_ARCH_LAST; i++)
         if (virQEMUCapsInitGuest(caps, cache,
                                  hostarch,
@@ -1180,6 +1234,8 @@ struct virQEMUCapsStringFlags virQEMUCapsCommands[] = {
     { "set-numa-node", QEMU_CAPS_NUMA },
     { "set-action", QEMU_CAPS_SET_ACTION },
     { "query-dirty-rate", QEMU_CAPS_QUERY_DIRTY_RATE },
+    { "query-stats", QEMU_CAPS_QUERY_STATS },
+    { "query-stats-schemas", QEMU_CAPS_QUERY_STATS_SCHEMAS },
 };
 
 struct virQEMUCapsStringFlags virQEMUCapsMigration[] = {
@@ -1705,6 +1761,7 @@ static struct virQEMUCapsStringFlags virQEMUCapsObjectPropsMemoryBackendFile[] =
      * released qemu versions. */
     { "x-use-canonical-path-for-ramblock-id", QEMU_CAPS_X_USE_CANONICAL_PATH_FOR_RAMBLOCK_ID },
     { "reserve", QEMU_CAPS_MEMORY_BACKEND_RESERVE },
+    { "prealloc-threads", QEMU_CAPS_MEMORY_BACKEND_PREALLOC_THREADS },
 };
 
 static struct virQEMUCapsStringFlags virQEMUCapsObjectPropsMemoryBackendMemfd[] = {
@@ -1902,6 +1959,22 @@ virQEMUCapsSEVInfoCopy(virSEVCapability **dst,
 }
 
 
+static void
+virQEMUCapsStatsSchemaCopy(virQEMUCaps *dst,
+                           virQEMUCaps *src)
+{
+    size_t i;
+
+    dst->statsSchema = g_new0(qemuMonitorQueryStatsSchemaData, src->nstatsSchema);
+    dst->nstatsSchema = src->nstatsSchema;
+
+    for (i = 0; i < src->nstatsSchema; i++) {
+        dst->statsSchema[i] = src->statsSchema[i];
+        dst->statsSchema[i].name = g_strdup(src->statsSchema[i].name);
+    }
+}
+
+
 static void
 virQEMUCapsAccelCopyMachineTypes(virQEMUCapsAccel *dst,
                                  virQEMUCapsAccel *src)
@@ -1940,11 +2013,82 @@ virQEMUCapsAccelCopy(virQEMUCapsAccel *dst,
 }
 
 
-virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps)
+static int
+virQEMUCapsCopyData(virQEMUCaps *dst,
+                    virQEMUCaps *src)
 {
-    g_autoptr(virQEMUCaps) ret = virQEMUCapsNewBinary(qemuCaps->binary);
     size_t i;
 
+    dst->cpuData = virCPUDataNewCopy(src->cpuData);
+
+    if (virQEMUCapsAccelCopy(&dst->kvm, &src->kvm) < 0 ||
+        virQEMUCapsAccelCopy(&dst->tcg, &src->tcg) < 0)
+        return -1;
+
+    dst->gicCapabilities = g_new0(virGICCapability, src->ngicCapabilities);
+    dst->ngicCapabilities = src->ngicCapabilities;
+    for (i = 0; i < src->ngicCapabilities; i++)
+        dst->gicCapabilities[i] = src->gicCapabilities[i];
+
+    if (virQEMUCapsGet(src, QEMU_CAPS_SEV_GUEST) &&
+        virQEMUCapsSEVInfoCopy(&dst->sevCapabilities,
+                               src->sevCapabilities) < 0)
+        return -1;
+
+    virQEMUCapsStatsSchemaCopy(dst, src);
+
+    return 0;
+}
+
+
+static void
+virQEMUCapsShareData(virQEMUCaps *dst,
+                     virQEMUCaps *src)
+{
+    dst->cpuData = src->cpuData;
+    dst->ngicCapabilities = src->ngicCapabilities;
+    dst->gicCapabilities = src->gicCapabilities;
+    dst->sevCapabilities = src->sevCapabilities;
+    dst->nstatsSchema = src->nstatsSchema;
+    dst->statsSchema = src->statsSchema;
+    dst->kvm = src->kvm;
+    dst->tcg = src->tcg;
+}
+
+
+/**
+ * virQEMUCapsUnshare:
+ * @qemuCaps: QEMU capabilities
+ *
+ * Make sure @qemuCaps owns all of its data rather than borrowing it from
+ * the cached capabilities it was copied from. Has to be called before
+ * anything but flags is modified.
+ */
+static void
+virQEMUCapsUnshare(virQEMUCaps *qemuCaps)
+{
+    g_autoptr(virQEMUCaps) base = g_steal_pointer(&qemuCaps->base);
+
+    if (!base)
+        return;
+
+    qemuCaps->cpuData = NULL;
+    qemuCaps->gicCapabilities = NULL;
+    qemuCaps->sevCapabilities = NULL;
+    qemuCaps->statsSchema = NULL;
+    memset(&qemuCaps->kvm, 0, sizeof(qemuCaps->kvm));
+    memset(&qemuCaps->tcg, 0, sizeof(qemuCaps->tcg));
+
+    /* The copy can only fail on allocation errors which abort anyway */
+    ignore_value(virQEMUCapsCopyData(qemuCaps, base));
+}
+
+
+static virQEMUCaps *
+virQEMUCapsNewCopyInternal(virQEMUCaps *qemuCaps)
+{
+    g_autoptr(virQEMUCaps) ret = virQEMUCapsNewBinary(qemuCaps->binary);
+
     if (!ret)
         return NULL;
 
@@ -1966,26 +2110,50 @@ virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps)
     ret->kernelVersion = g_strdup(qemuCaps->kernelVersion);
 
     ret->arch = qemuCaps->arch;
-    ret->cpuData = virCPUDataNewCopy(qemuCaps->cpuData);
 
-    if (virQEMUCapsAccelCopy(&ret->kvm, &qemuCaps->kvm) < 0 ||
-        virQEMUCapsAccelCopy(&ret->tcg, &qemuCaps->tcg) < 0)
-        return NULL;
+    return g_steal_pointer(&ret);
+}
 
-    ret->gicCapabilities = g_new0(virGICCapability, qemuCaps->ngicCapabilities);
-    ret->ngicCapabilities = qemuCaps->ngicCapabilities;
-    for (i = 0; i < qemuCaps->ngicCapabilities; i++)
-        ret->gicCapabilities[i] = qemuCaps->gicCapabilities[i];
 
-    if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_SEV_GUEST) &&
-        virQEMUCapsSEVInfoCopy(&ret->sevCapabilities,
-                               qemuCaps->sevCapabilities) < 0)
+virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps)
+{
+    g_autoptr(virQEMUCaps) ret = virQEMUCapsNewCopyInternal(qemuCaps);
+
+    if (!ret)
+        return NULL;
+
+    if (virQEMUCapsCopyData(ret, qemuCaps) < 0)
         return NULL;
 
     return g_steal_pointer(&ret);
 }
 
 
+/**
+ * virQEMUCapsNewCopyShared:
+ * @qemuCaps: QEMU capabilities
+ *
+ * Same as virQEMUCapsNewCopy, except that only flags are really copied
+ * and everything else is shared with @qemuCaps, which must not be modified
+ * for as long as the copy exists. That is the case for capabilities stored
+ * in the cache, which are replaced rather than updated.
+ */
+virQEMUCaps *
+virQEMUCapsNewCopyShared(virQEMUCaps *qemuCaps)
+{
+    virQEMUCaps *base = qemuCaps->base ? qemuCaps->base : qemuCaps;
+    virQEMUCaps *ret = virQEMUCapsNewCopyInternal(qemuCaps);
+
+    if (!ret)
+        return NULL;
+
+    virQEMUCapsShareData(ret, base);
+    ret->base = virObjectRef(base);
+
+    return ret;
+}
+
+
 static void
 virQEMUCapsAccelClear(virQEMUCapsAccel *caps)
 {
@@ -2015,12 +2183,20 @@ void virQEMUCapsDispose(void *obj)
     g_free(qemuCaps->binary);
     g_free(qemuCaps->hostCPUSignature);
 
+    if (qemuCaps->base) {
+        virObjectUnref(qemuCaps->base);
+        return;
+    }
+
     g_free(qemuCaps->gicCapabilities);
 
     virCPUDataFree(qemuCaps->cpuData);
 
     virSEVCapabilitiesFree(qemuCaps->sevCapabilities);
 
+    qemuMonitorQueryStatsSchemaFree(qemuCaps->statsSchema,
+                                    qemuCaps->nstatsSchema);
+
     virQEMUCapsAccelClear(&qemuCaps->kvm);
     virQEMUCapsAccelClear(&qemuCaps->tcg);
 }
@@ -2130,8 +2306,12 @@ virQEMUCapsAddCPUDefinitions(virQEMUCaps *qemuCaps,
 {
     size_t i;
     size_t start;
-    virQEMUCapsAccel *accel = virQEMUCapsGetAccel(qemuCaps, type);
-    qemuMonitorCPUDefs *defs = accel->cpuModels;
+    virQEMUCapsAccel *accel;
+    qemuMonitorCPUDefs *defs;
+
+    virQEMUCapsUnshare(qemuCaps);
+    accel = virQEMUCapsGetAccel(qemuCaps, type);
+    defs = accel->cpuModels;
 
     if (defs) {
         start = defs->ncpus;
@@ -2526,6 +2706,8 @@ virQEMUCapsSetGICCapabilities(virQEMUCaps *qemuCaps,
                               virGICCapability *capabilities,
                               size_t ncapabilities)
 {
+    virQEMUCapsUnshare(qemuCaps);
+
     VIR_FREE(qemuCaps->gicCapabilities);
 
     qemuCaps->gicCapabilities = capabilities;
@@ -2540,6 +2722,23 @@ virQEMUCapsGetSEVCapabilities(virQEMUCaps *qemuCaps)
 }
 
 
+/**
+ * virQEMUCapsGetStatsSchema:
+ * @qemuCaps: capabilities
+ * @nschema: filled with the number of returned entries
+ *
+ * Returns the description of the statistics QEMU reports via
+ * query-stats, as probed with query-stats-schemas.
+ */
+qemuMonitorQueryStatsSchemaData *
+virQEMUCapsGetStatsSchema(virQEMUCaps *qemuCaps,
+                          size_t *nschema)
+{
+    *nschema = qemuCaps->nstatsSchema;
+    return qemuCaps->statsSchema;
+}
+
+
 static int
 virQEMUCapsProbeQMPCommands(virQEMUCaps *qemuCaps,
                             qemuMonitor *mon)
@@ -2714,9 +2913,12 @@ virQEMUCapsAddMachine(virQEMUCaps *qemuCaps,
                       const char *defaultRAMid,
                       bool deprecated)
 {
-    virQEMUCapsAccel *accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+    virQEMUCapsAccel *accel;
     virQEMUCapsMachineType *mach;
 
+    virQEMUCapsUnshare(qemuCaps);
+    accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+
     accel->machineTypes = g_renew(virQEMUCapsMachineType,
                                   accel->machineTypes,
                                   ++accel->nmachineTypes);
@@ -3313,6 +3515,27 @@ virQEMUCapsProbeQMPSEVCapabilities(virQEMUCaps *qemuCaps,
 }
 
 
+static int
+virQEMUCapsProbeQMPStatsSchema(virQEMUCaps *qemuCaps,
+                               qemuMonitor *mon)
+{
+    qemuMonitorQueryStatsSchemaData *schema = NULL;
+    size_t nschema = 0;
+
+    if (!virQEMUCapsGet(qemuCaps, QEMU_CAPS_QUERY_STATS_SCHEMAS))
+        return 0;
+
+    if (qemuMonitorQueryStatsSchema(mon, &schema, &nschema) < 0)
+        return -1;
+
+    qemuMonitorQueryStatsSchemaFree(qemuCaps->statsSchema,
+                                    qemuCaps->nstatsSchema);
+    qemuCaps->statsSchema = schema;
+    qemuCaps->nstatsSchema = nschema;
+    return 0;
+}
+
+
 /*
  * Filter for features which should never be passed to QEMU. Either because
  * QEMU never supported them or they were dropped as they never did anything
@@ -3608,6 +3831,8 @@ virQEMUCapsInitHostCPUModel(virQEMUCaps *qemuCaps,
     if (!virQEMUCapsGuestIsNative(hostArch, qemuCaps->arch))
         return;
 
+    virQEMUCapsUnshare(qemuCaps);
+
     if (!(cpu = virQEMUCapsNewHostCPUModel()))
         goto error;
 
@@ -3697,6 +3922,7 @@ virQEMUCapsUpdateHostCPUModel(virQEMUCaps *qemuCaps,
                             virArch hostArch,
                             virDomainVirtType type)
 {
+    virQEMUCapsUnshare(qemuCaps);
     virQEMUCapsHostCPUDataClear(&virQEMUCapsGetAccel(qemuCaps, type)->hostCPU);
     virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, type);
 }
@@ -3714,6 +3940,7 @@ virQEMUCapsSetCPUModelInfo(virQEMUCaps *qemuCaps,
                            virDomainVirtType type,
                            qemuMonitorCPUModelInfo *modelInfo)
 {
+    virQEMUCapsUnshare(qemuCaps);
     virQEMUCapsGetAccel(qemuCaps, type)->hostCPU.info = modelInfo;
 }
 
@@ -4098,6 +4325,69 @@ virQEMUCapsParseSEVInfo(virQEMUCaps *qemuCaps, xmlXPathContextPtr ctxt)
 }
 
 
+static int
+virQEMUCapsParseStatsSchema(virQEMUCaps *qemuCaps,
+                            xmlXPathContextPtr ctxt)
+{
+    g_autofree xmlNodePtr *nodes = NULL;
+    qemuMonitorQueryStatsSchemaData *schema;
+    size_t nschema;
+    size_t i;
+    int n;
+
+    if ((n = virXPathNodeSet("./statsSchema/stat", ctxt, &nodes)) < 0)
+        return -1;
+
+    if (n == 0)
+        return 0;
+
+    schema = g_new0(qemuMonitorQueryStatsSchemaData, n);
+    nschema = n;
+
+    for (i = 0; i < nschema; i++) {
+        qemuMonitorQueryStatsSchemaData *data = &schema[i];
+        unsigned int target;
+        unsigned int type;
+        unsigned int unit = QEMU_MONITOR_QUERY_STATS_UNIT_NONE;
+
+        if (!(data->name = virXMLPropString(nodes[i], "name"))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("missing stat name in QEMU capabilities cache"));
+            goto error;
+        }
+
+        if (virXMLPropEnum(nodes[i], "target",
+                           qemuMonitorQueryStatsTargetTypeFromString,
+                           VIR_XML_PROP_REQUIRED, &target) < 0 ||
+            virXMLPropEnum(nodes[i], "type",
+                           qemuMonitorQueryStatsTypeTypeFromString,
+                           VIR_XML_PROP_REQUIRED, &type) < 0 ||
+            virXMLPropEnum(nodes[i], "unit",
+                           qemuMonitorQueryStatsUnitTypeFromString,
+                           VIR_XML_PROP_NONE, &unit) < 0 ||
+            virXMLPropInt(nodes[i], "base", 10, VIR_XML_PROP_NONE,
+                          &data->base, 0) < 0 ||
+            virXMLPropInt(nodes[i], "exponent", 10, VIR_XML_PROP_NONE,
+                          &data->exponent, 0) < 0 ||
+            virXMLPropUInt(nodes[i], "bucketSize", 10, VIR_XML_PROP_NONE,
+                           &data->bucketSize) < 0)
+            goto error;
+
+        data->target = target;
+        data->type = type;
+        data->unit = unit;
+    }
+
+    qemuCaps->statsSchema = schema;
+    qemuCaps->nstatsSchema = nschema;
+    return 0;
+
+ error:
+    qemuMonitorQueryStatsSchemaFree(schema, nschema);
+    return -1;
+}
+
+
 /*
  * Parsing a doc that looks like
  *
@@ -4344,6 +4634,9 @@ virQEMUCapsLoadCache(virArch hostArch,
     if (virQEMUCapsParseSEVInfo(qemuCaps, ctxt) < 0)
         goto cleanup;
 
+    if (virQEMUCapsParseStatsSchema(qemuCaps, ctxt) < 0)
+        goto cleanup;
+
     virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_KVM);
     virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_QEMU);
 
@@ -4525,6 +4818,36 @@ virQEMUCapsFormatSEVInfo(virQEMUCaps *qemuCaps, virBuffer *buf)
 }
 
 
+static void
+virQEMUCapsFormatStatsSchema(virQEMUCaps *qemuCaps,
+                             virBuffer *buf)
+{
+    g_auto(virBuffer) childBuf = VIR_BUFFER_INIT_CHILD(buf);
+    size_t i;
+
+    for (i = 0; i < qemuCaps->nstatsSchema; i++) {
+        qemuMonitorQueryStatsSchemaData *data = &qemuCaps->statsSchema[i];
+
+        virBufferEscapeString(&childBuf, "<stat name='%s'", data->name);
+        virBufferAsprintf(&childBuf, " target='%s' type='%s'",
+                          qemuMonitorQueryStatsTargetTypeToString(data->target),
+                          qemuMonitorQueryStatsTypeTypeToString(data->type));
+        if (data->unit != QEMU_MONITOR_QUERY_STATS_UNIT_NONE)
+            virBufferAsprintf(&childBuf, " unit='%s'",
+                              qemuMonitorQueryStatsUnitTypeToString(data->unit));
+        if (data->base)
+            virBufferAsprintf(&childBuf, " base='%d'", data->base);
+        if (data->exponent)
+            virBufferAsprintf(&childBuf, " exponent='%d'", data->exponent);
+        if (data->bucketSize)
+            virBufferAsprintf(&childBuf, " bucketSize='%u'", data->bucketSize);
+        virBufferAddLit(&childBuf, "/>\n");
+    }
+
+    virXMLFormatElement(buf, "statsSchema", NULL, &childBuf);
+}
+
+
 char *
 virQEMUCapsFormatCache(virQEMUCaps *qemuCaps)
 {
@@ -4603,6 +4926,8 @@ virQEMUCapsFormatCache(virQEMUCaps *qemuCaps)
     if (qemuCaps->sevCapabilities)
         virQEMUCapsFormatSEVInfo(qemuCaps, &buf);
 
+    virQEMUCapsFormatStatsSchema(qemuCaps, &buf);
+
     if (qemuCaps->kvmSupportsNesting)
         virBufferAddLit(&buf, "<kvmSupportsNesting/>\n");
 
@@ -4616,92 +4941,976 @@ virQEMUCapsFormatCache(virQEMUCaps *qemuCaps)
 }
 
 
-static int
-virQEMUCapsSaveFile(void *data,
-                    const char *filename,
-                    void *privData G_GNUC_UNUSED)
+/*
+ * Binary form of the capabilities cache. It carries exactly the same
+ * data as the XML produced by virQEMUCapsFormatCache, which is still
+ * written next to it for debugging, but can be loaded without parsing
+ * any XML. The data is only ever read by the same libvirt build on the
+ * same host which wrote it, so all numbers are stored in host byte
+ * order and there's no need for a stable layout. Any change to the
+ * layout must bump VIR_QEMU_CAPS_BINARY_VERSION though.
+ *
+ * Strings are stored as a uint32_t length followed by the characters
+ * without the trailing NUL, UINT32_MAX stands for NULL. Lists are
+ * stored as a uint32_t count followed by the items.
+ */
+#define VIR_QEMU_CAPS_BINARY_MAGIC "LVQEMUCP"
+#define VIR_QEMU_CAPS_BINARY_VERSION 1
+#define VIR_QEMU_CAPS_BINARY_ENDIAN 0x01020304
+
+typedef struct _virQEMUCapsBinReader virQEMUCapsBinReader;
+struct _virQEMUCapsBinReader {
+    const char *data;
+    size_t len;
+    size_t offset;
+};
+
+
+static void
+virQEMUCapsBinPutU32(GByteArray *buf,
+                     uint32_t val)
 {
-    virQEMUCaps *qemuCaps = data;
-    g_autofree char *xml = NULL;
+    g_byte_array_append(buf, (const guint8 *) &val, sizeof(val));
+}
 
-    xml = virQEMUCapsFormatCache(qemuCaps);
 
-    if (virFileWriteStr(filename, xml, 0600) < 0) {
-        virReportSystemError(errno,
-                             _("Failed to save '%s' for '%s'"),
-                             filename, qemuCaps->binary);
-        return -1;
-    }
+static void
+virQEMUCapsBinPutI32(GByteArray *buf,
+                     int32_t val)
+{
+    g_byte_array_append(buf, (const guint8 *) &val, sizeof(val));
+}
 
-    VIR_DEBUG("Saved caps '%s' for '%s' with (%lld, %lld)",
-              filename, qemuCaps->binary,
-              (long long)qemuCaps->ctime,
-              (long long)qemuCaps->libvirtCtime);
 
-    return 0;
+static void
+virQEMUCapsBinPutI64(GByteArray *buf,
+                     int64_t val)
+{
+    g_byte_array_append(buf, (const guint8 *) &val, sizeof(val));
 }
 
 
-/*
- * Check whether IBM Secure Execution (S390) is enabled
- */
-static bool
-virQEMUCapsKVMSupportsSecureGuestS390(void)
+static void
+virQEMUCapsBinPutBool(GByteArray *buf,
+                      bool val)
 {
+    guint8 byte = val;
 
-    g_autofree char *cmdline = NULL;
-    static const char *kValues[] = {"y", "Y", "on", "ON", "oN", "On", "1"};
+    g_byte_array_append(buf, &byte, 1);
+}
 
-    if (!virFileIsDir("/sys/firmware/uv"))
-        return false;
 
-    if (virFileReadValueString(&cmdline, "/proc/cmdline") < 0)
-        return false;
+static void
+virQEMUCapsBinPutStr(GByteArray *buf,
+                     const char *str)
+{
+    size_t len;
 
-    /* we're prefix matching rather than equality matching here, because kernel
-     * would treat even something like prot_virt='yFOO' as enabled */
-    if (virKernelCmdlineMatchParam(cmdline, "prot_virt", kValues,
-                                   G_N_ELEMENTS(kValues),
-                                   VIR_KERNEL_CMDLINE_FLAGS_SEARCH_FIRST |
-                                   VIR_KERNEL_CMDLINE_FLAGS_CMP_PREFIX))
-        return true;
+    if (!str) {
+        virQEMUCapsBinPutU32(buf, UINT32_MAX);
+        return;
+    }
 
-    return false;
+    len = strlen(str);
+    virQEMUCapsBinPutU32(buf, len);
+    g_byte_array_append(buf, (const guint8 *) str, len);
 }
 
 
-/*
- * Check whether AMD Secure Encrypted Virtualization (x86) is enabled
- */
-static bool
-virQEMUCapsKVMSupportsSecureGuestAMD(void)
+static int
+virQEMUCapsBinGet(virQEMUCapsBinReader *reader,
+                  void *dst,
+                  size_t len)
 {
-    g_autofree char *modValue = NULL;
+    if (reader->len - reader->offset < len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("truncated QEMU capabilities cache"));
+        return -1;
+    }
 
-    if (virFileReadValueString(&modValue, "/sys/module/kvm_amd/parameters/sev") < 0)
-        return false;
+    memcpy(dst, reader->data + reader->offset, len);
+    reader->offset += len;
+    return 0;
+}
 
-    if (modValue[0] != '1')
-        return false;
 
-    if (virFileExists(QEMU_DEV_SEV))
-        return true;
+static int
+virQEMUCapsBinGetU32(virQEMUCapsBinReader *reader,
+                     unsigned int *val)
+{
+    uint32_t tmp;
 
-    return false;
+    if (virQEMUCapsBinGet(reader, &tmp, sizeof(tmp)) < 0)
+        return -1;
+
+    *val = tmp;
+    return 0;
 }
 
 
-/*
- * Check whether the secure guest functionality is enabled.
- * See the specific architecture function for details on the verifications made.
- */
-static bool
-virQEMUCapsKVMSupportsSecureGuest(void)
+static int
+virQEMUCapsBinGetI32(virQEMUCapsBinReader *reader,
+                     int *val)
 {
-    virArch arch = virArchFromHost();
+    int32_t tmp;
 
-    if (ARCH_IS_S390(arch))
-        return virQEMUCapsKVMSupportsSecureGuestS390();
+    if (virQEMUCapsBinGet(reader, &tmp, sizeof(tmp)) < 0)
+        return -1;
+
+    *val = tmp;
+    return 0;
+}
+
+
+static int
+virQEMUCapsBinGetI64(virQEMUCapsBinReader *reader,
+                     long long *val)
+{
+    int64_t tmp;
+
+    if (virQEMUCapsBinGet(reader, &tmp, sizeof(tmp)) < 0)
+        return -1;
+
+    *val = tmp;
+    return 0;
+}
+
+
+static int
+virQEMUCapsBinGetTime(virQEMUCapsBinReader *reader,
+                      time_t *val)
+{
+    long long tmp;
+
+    if (virQEMUCapsBinGetI64(reader, &tmp) < 0)
+        return -1;
+
+    *val = (time_t)tmp;
+    return 0;
+}
+
+
+static int
+virQEMUCapsBinGetBool(virQEMUCapsBinReader *reader,
+                      bool *val)
+{
+    guint8 byte;
+
+    if (virQEMUCapsBinGet(reader, &byte, 1) < 0)
+        return -1;
+
+    *val = !!byte;
+    return 0;
+}
+
+
+/* Reads the number of items in a list, each item takes at least one byte
+ * so a corrupted count can't make us allocate insane amounts of memory */
+static int
+virQEMUCapsBinGetCount(virQEMUCapsBinReader *reader,
+                       size_t *count)
+{
+    unsigned int tmp;
+
+    if (virQEMUCapsBinGetU32(reader, &tmp) < 0)
+        return -1;
+
+    if (tmp > reader->len - reader->offset) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("malformed list in QEMU capabilities cache"));
+        return -1;
+    }
+
+    *count = tmp;
+    return 0;
+}
+
+
+static int
+virQEMUCapsBinGetStr(virQEMUCapsBinReader *reader,
+                     char **str)
+{
+    unsigned int len;
+
+    *str = NULL;
+
+    if (virQEMUCapsBinGetU32(reader, &len) < 0)
+        return -1;
+
+    if (len == UINT32_MAX)
+        return 0;
+
+    if (reader->len - reader->offset < len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("truncated QEMU capabilities cache"));
+        return -1;
+    }
+
+    *str = g_strndup(reader->data + reader->offset, len);
+    reader->offset += len;
+    return 0;
+}
+
+
+static int
+virQEMUCapsBinGetStrRequired(virQEMUCapsBinReader *reader,
+                             char **str)
+{
+    if (virQEMUCapsBinGetStr(reader, str) < 0)
+        return -1;
+
+    if (!*str) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("missing string in QEMU capabilities cache"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+virQEMUCapsFormatBinaryAccel(virQEMUCaps *qemuCaps,
+                             GByteArray *buf,
+                             virDomainVirtType type)
+{
+    virQEMUCapsAccel *caps = virQEMUCapsGetAccel(qemuCaps, type);
+    qemuMonitorCPUModelInfo *model = caps->hostCPU.info;
+    size_t i;
+    size_t j;
+
+    virQEMUCapsBinPutBool(buf, !!model);
+    if (model) {
+        virQEMUCapsBinPutStr(buf, model->name);
+        virQEMUCapsBinPutBool(buf, model->migratability);
+        virQEMUCapsBinPutU32(buf, model->nprops);
+
+        for (i = 0; i < model->nprops; i++) {
+            qemuMonitorCPUProperty *prop = model->props + i;
+
+            virQEMUCapsBinPutStr(buf, prop->name);
+            virQEMUCapsBinPutU32(buf, prop->type);
+
+            switch (prop->type) {
+            case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+                virQEMUCapsBinPutBool(buf, prop->value.boolean);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_STRING:
+                virQEMUCapsBinPutStr(buf, prop->value.string);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+                virQEMUCapsBinPutI64(buf, prop->value.number);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_LAST:
+                break;
+            }
+
+            virQEMUCapsBinPutI32(buf, prop->migratable);
+        }
+    }
+
+    if (caps->cpuModels) {
+        virQEMUCapsBinPutU32(buf, caps->cpuModels->ncpus);
+
+        for (i = 0; i < caps->cpuModels->ncpus; i++) {
+            qemuMonitorCPUDefInfo *cpu = caps->cpuModels->cpus + i;
+            size_t nblockers = cpu->blockers ? g_strv_length(cpu->blockers) : 0;
+
+            virQEMUCapsBinPutStr(buf, cpu->name);
+            virQEMUCapsBinPutStr(buf, cpu->type);
+            virQEMUCapsBinPutI32(buf, cpu->usable);
+            virQEMUCapsBinPutBool(buf, cpu->deprecated);
+            virQEMUCapsBinPutU32(buf, nblockers);
+            for (j = 0; j < nblockers; j++)
+                virQEMUCapsBinPutStr(buf, cpu->blockers[j]);
+        }
+    } else {
+        virQEMUCapsBinPutU32(buf, 0);
+    }
+
+    virQEMUCapsBinPutU32(buf, caps->nmachineTypes);
+    for (i = 0; i < caps->nmachineTypes; i++) {
+        virQEMUCapsMachineType *mach = caps->machineTypes + i;
+
+        virQEMUCapsBinPutStr(buf, mach->name);
+        virQEMUCapsBinPutStr(buf, mach->alias);
+        virQEMUCapsBinPutU32(buf, mach->maxCpus);
+        virQEMUCapsBinPutBool(buf, mach->hotplugCpus);
+        virQEMUCapsBinPutBool(buf, mach->qemuDefault);
+        virQEMUCapsBinPutStr(buf, mach->defaultCPU);
+        virQEMUCapsBinPutBool(buf, mach->numaMemSupported);
+        virQEMUCapsBinPutStr(buf, mach->defaultRAMid);
+        virQEMUCapsBinPutBool(buf, mach->deprecated);
+    }
+}
+
+
+/**
+ * virQEMUCapsFormatCacheBinary:
+ * @qemuCaps: capabilities to format
+ *
+ * Formats @qemuCaps into the binary capabilities cache format.
+ *
+ * Returns the formatted data, the caller is responsible for freeing it.
+ */
+GByteArray *
+virQEMUCapsFormatCacheBinary(virQEMUCaps *qemuCaps)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    size_t nflags = 0;
+    size_t i;
+
+    g_byte_array_append(buf, (const guint8 *) VIR_QEMU_CAPS_BINARY_MAGIC,
+                        strlen(VIR_QEMU_CAPS_BINARY_MAGIC));
+    virQEMUCapsBinPutU32(buf, VIR_QEMU_CAPS_BINARY_VERSION);
+    virQEMUCapsBinPutU32(buf, VIR_QEMU_CAPS_BINARY_ENDIAN);
+
+    /* data used to check whether the cache is outdated go first */
+    virQEMUCapsBinPutI64(buf, qemuCaps->libvirtCtime);
+    virQEMUCapsBinPutU32(buf, qemuCaps->libvirtVersion);
+
+    virQEMUCapsBinPutStr(buf, qemuCaps->binary);
+    virQEMUCapsBinPutI64(buf, qemuCaps->ctime);
+    virQEMUCapsBinPutI64(buf, qemuCaps->modDirMtime);
+
+    for (i = 0; i < QEMU_CAPS_LAST; i++) {
+        if (virQEMUCapsGet(qemuCaps, i))
+            nflags++;
+    }
+    virQEMUCapsBinPutU32(buf, nflags);
+    for (i = 0; i < QEMU_CAPS_LAST; i++) {
+        if (virQEMUCapsGet(qemuCaps, i))
+            virQEMUCapsBinPutU32(buf, i);
+    }
+
+    virQEMUCapsBinPutU32(buf, qemuCaps->version);
+    virQEMUCapsBinPutU32(buf, qemuCaps->kvmVersion);
+    virQEMUCapsBinPutU32(buf, qemuCaps->microcodeVersion);
+    virQEMUCapsBinPutStr(buf, qemuCaps->hostCPUSignature);
+    virQEMUCapsBinPutStr(buf, qemuCaps->package);
+    virQEMUCapsBinPutStr(buf, qemuCaps->kernelVersion);
+    virQEMUCapsBinPutU32(buf, qemuCaps->arch);
+
+    if (qemuCaps->cpuData) {
+        g_autofree char *cpudata = virCPUDataFormat(qemuCaps->cpuData);
+
+        if (!cpudata)
+            return NULL;
+
+        virQEMUCapsBinPutStr(buf, cpudata);
+    } else {
+        virQEMUCapsBinPutStr(buf, NULL);
+    }
+
+    virQEMUCapsFormatBinaryAccel(qemuCaps, buf, VIR_DOMAIN_VIRT_KVM);
+    virQEMUCapsFormatBinaryAccel(qemuCaps, buf, VIR_DOMAIN_VIRT_QEMU);
+
+    virQEMUCapsBinPutU32(buf, qemuCaps->ngicCapabilities);
+    for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+        virQEMUCapsBinPutU32(buf, qemuCaps->gicCapabilities[i].version);
+        virQEMUCapsBinPutU32(buf, qemuCaps->gicCapabilities[i].implementation);
+    }
+
+    virQEMUCapsBinPutBool(buf, !!qemuCaps->sevCapabilities);
+    if (qemuCaps->sevCapabilities) {
+        virSEVCapability *sev = qemuCaps->sevCapabilities;
+
+        virQEMUCapsBinPutU32(buf, sev->cbitpos);
+        virQEMUCapsBinPutU32(buf, sev->reduced_phys_bits);
+        virQEMUCapsBinPutStr(buf, sev->pdh);
+        virQEMUCapsBinPutStr(buf, sev->cert_chain);
+    }
+
+    virQEMUCapsBinPutU32(buf, qemuCaps->nstatsSchema);
+    for (i = 0; i < qemuCaps->nstatsSchema; i++) {
+        qemuMonitorQueryStatsSchemaData *data = &qemuCaps->statsSchema[i];
+
+        virQEMUCapsBinPutStr(buf, data->name);
+        virQEMUCapsBinPutU32(buf, data->target);
+        virQEMUCapsBinPutU32(buf, data->type);
+        virQEMUCapsBinPutU32(buf, data->unit);
+        virQEMUCapsBinPutI32(buf, data->base);
+        virQEMUCapsBinPutI32(buf, data->exponent);
+        virQEMUCapsBinPutU32(buf, data->bucketSize);
+    }
+
+    virQEMUCapsBinPutBool(buf, qemuCaps->kvmSupportsNesting);
+    virQEMUCapsBinPutBool(buf, qemuCaps->kvmSupportsSecureGuest);
+
+    return g_steal_pointer(&buf);
+}
+
+
+static int
+virQEMUCapsLoadBinaryHostCPUModelInfo(virQEMUCapsAccel *caps,
+                                      virQEMUCapsBinReader *reader)
+{
+    g_autoptr(qemuMonitorCPUModelInfo) hostCPU = NULL;
+    bool present;
+    size_t i;
+
+    if (virQEMUCapsBinGetBool(reader, &present) < 0)
+        return -1;
+
+    if (!present)
+        return 0;
+
+    hostCPU = g_new0(qemuMonitorCPUModelInfo, 1);
+
+    if (virQEMUCapsBinGetStrRequired(reader, &hostCPU->name) < 0 ||
+        virQEMUCapsBinGetBool(reader, &hostCPU->migratability) < 0 ||
+        virQEMUCapsBinGetCount(reader, &hostCPU->nprops) < 0)
+        return -1;
+
+    hostCPU->props = g_new0(qemuMonitorCPUProperty, hostCPU->nprops);
+
+    for (i = 0; i < hostCPU->nprops; i++) {
+        qemuMonitorCPUProperty *prop = hostCPU->props + i;
+        unsigned int type;
+        int migratable;
+
+        if (virQEMUCapsBinGetStrRequired(reader, &prop->name) < 0 ||
+            virQEMUCapsBinGetU32(reader, &type) < 0)
+            return -1;
+
+        switch ((qemuMonitorCPUPropertyType) type) {
+        case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+            if (virQEMUCapsBinGetBool(reader, &prop->value.boolean) < 0)
+                return -1;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_STRING:
+            if (virQEMUCapsBinGetStrRequired(reader, &prop->value.string) < 0)
+                return -1;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+            if (virQEMUCapsBinGetI64(reader, &prop->value.number) < 0)
+                return -1;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_LAST:
+        default:
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("invalid CPU model property type "
+                             "in QEMU capabilities cache"));
+            return -1;
+        }
+        prop->type = type;
+
+        if (virQEMUCapsBinGetI32(reader, &migratable) < 0)
+            return -1;
+
+        if (migratable < 0 || migratable >= VIR_TRISTATE_BOOL_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("unknown migratable value for '%s' host "
+                             "CPU model property"),
+                           prop->name);
+            return -1;
+        }
+        prop->migratable = migratable;
+    }
+
+    caps->hostCPU.info = g_steal_pointer(&hostCPU);
+    return 0;
+}
+
+
+static int
+virQEMUCapsLoadBinaryCPUModels(virQEMUCapsAccel *caps,
+                               virQEMUCapsBinReader *reader)
+{
+    g_autoptr(qemuMonitorCPUDefs) defs = NULL;
+    size_t ncpus;
+    size_t i;
+
+    if (virQEMUCapsBinGetCount(reader, &ncpus) < 0)
+        return -1;
+
+    if (ncpus == 0)
+        return 0;
+
+    if (!(defs = qemuMonitorCPUDefsNew(ncpus)))
+        return -1;
+
+    for (i = 0; i < ncpus; i++) {
+        qemuMonitorCPUDefInfo *cpu = defs->cpus + i;
+        size_t nblockers;
+        int usable;
+        size_t j;
+
+        if (virQEMUCapsBinGetStrRequired(reader, &cpu->name) < 0 ||
+            virQEMUCapsBinGetStr(reader, &cpu->type) < 0 ||
+            virQEMUCapsBinGetI32(reader, &usable) < 0 ||
+            virQEMUCapsBinGetBool(reader, &cpu->deprecated) < 0 ||
+            virQEMUCapsBinGetCount(reader, &nblockers) < 0)
+            return -1;
+
+        if (usable < 0 || usable >= VIR_DOMCAPS_CPU_USABLE_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("unknown usable value for CPU model '%s'"),
+                           cpu->name);
+            return -1;
+        }
+        cpu->usable = usable;
+
+        if (nblockers == 0)
+            continue;
+
+        cpu->blockers = g_new0(char *, nblockers + 1);
+        for (j = 0; j < nblockers; j++) {
+            if (virQEMUCapsBinGetStrRequired(reader, &cpu->blockers[j]) < 0)
+                return -1;
+        }
+    }
+
+    caps->cpuModels = g_steal_pointer(&defs);
+    return 0;
+}
+
+
+static int
+virQEMUCapsLoadBinaryMachines(virQEMUCapsAccel *caps,
+                              virQEMUCapsBinReader *reader)
+{
+    size_t i;
+
+    if (virQEMUCapsBinGetCount(reader, &caps->nmachineTypes) < 0)
+        return -1;
+
+    caps->machineTypes = g_new0(virQEMUCapsMachineType, caps->nmachineTypes);
+
+    for (i = 0; i < caps->nmachineTypes; i++) {
+        virQEMUCapsMachineType *mach = caps->machineTypes + i;
+
+        if (virQEMUCapsBinGetStrRequired(reader, &mach->name) < 0 ||
+            virQEMUCapsBinGetStr(reader, &mach->alias) < 0 ||
+            virQEMUCapsBinGetU32(reader, &mach->maxCpus) < 0 ||
+            virQEMUCapsBinGetBool(reader, &mach->hotplugCpus) < 0 ||
+            virQEMUCapsBinGetBool(reader, &mach->qemuDefault) < 0 ||
+            virQEMUCapsBinGetStr(reader, &mach->defaultCPU) < 0 ||
+            virQEMUCapsBinGetBool(reader, &mach->numaMemSupported) < 0 ||
+            virQEMUCapsBinGetStr(reader, &mach->defaultRAMid) < 0 ||
+            virQEMUCapsBinGetBool(reader, &mach->deprecated) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virQEMUCapsLoadBinaryAccel(virQEMUCaps *qemuCaps,
+                           virQEMUCapsBinReader *reader,
+                           virDomainVirtType type)
+{
+    virQEMUCapsAccel *caps = virQEMUCapsGetAccel(qemuCaps, type);
+
+    if (virQEMUCapsLoadBinaryHostCPUModelInfo(caps, reader) < 0 ||
+        virQEMUCapsLoadBinaryCPUModels(caps, reader) < 0 ||
+        virQEMUCapsLoadBinaryMachines(caps, reader) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virQEMUCapsLoadBinaryStatsSchema(virQEMUCaps *qemuCaps,
+                                 virQEMUCapsBinReader *reader)
+{
+    qemuMonitorQueryStatsSchemaData *schema;
+    size_t nschema;
+    size_t i;
+
+    if (virQEMUCapsBinGetCount(reader, &nschema) < 0)
+        return -1;
+
+    if (nschema == 0)
+        return 0;
+
+    schema = g_new0(qemuMonitorQueryStatsSchemaData, nschema);
+
+    for (i = 0; i < nschema; i++) {
+        qemuMonitorQueryStatsSchemaData *data = &schema[i];
+        unsigned int target;
+        unsigned int type;
+        unsigned int unit;
+
+        if (virQEMUCapsBinGetStrRequired(reader, &data->name) < 0 ||
+            virQEMUCapsBinGetU32(reader, &target) < 0 ||
+            virQEMUCapsBinGetU32(reader, &type) < 0 ||
+            virQEMUCapsBinGetU32(reader, &unit) < 0 ||
+            virQEMUCapsBinGetI32(reader, &data->base) < 0 ||
+            virQEMUCapsBinGetI32(reader, &data->exponent) < 0 ||
+            virQEMUCapsBinGetU32(reader, &data->bucketSize) < 0)
+            goto error;
+
+        if (target >= QEMU_MONITOR_QUERY_STATS_TARGET_LAST ||
+            type >= QEMU_MONITOR_QUERY_STATS_TYPE_LAST ||
+            unit >= QEMU_MONITOR_QUERY_STATS_UNIT_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("malformed stat '%s' in QEMU capabilities cache"),
+                           data->name);
+            goto error;
+        }
+
+        data->target = target;
+        data->type = type;
+        data->unit = unit;
+    }
+
+    qemuCaps->statsSchema = schema;
+    qemuCaps->nstatsSchema = nschema;
+    return 0;
+
+ error:
+    qemuMonitorQueryStatsSchemaFree(schema, nschema);
+    return -1;
+}
+
+
+/**
+ * virQEMUCapsLoadCacheBinaryData:
+ * @hostArch: host architecture
+ * @qemuCaps: capabilities object to fill in
+ * @data: binary cache data as produced by virQEMUCapsFormatCacheBinary
+ * @len: length of @data
+ * @skipInvalidation: don't check whether the data is outdated
+ *
+ * Returns 0 on success, 1 if outdated, -1 on error
+ */
+int
+virQEMUCapsLoadCacheBinaryData(virArch hostArch,
+                               virQEMUCaps *qemuCaps,
+                               const char *data,
+                               size_t len,
+                               bool skipInvalidation)
+{
+    virQEMUCapsBinReader reader = { .data = data, .len = len };
+    size_t magiclen = strlen(VIR_QEMU_CAPS_BINARY_MAGIC);
+    g_autofree char *binary = NULL;
+    g_autofree char *cpudata = NULL;
+    unsigned int version;
+    unsigned int endian;
+    unsigned int arch;
+    long long l;
+    size_t nflags;
+    bool sev;
+    size_t i;
+
+    if (len < magiclen ||
+        memcmp(data, VIR_QEMU_CAPS_BINARY_MAGIC, magiclen) != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("invalid QEMU capabilities cache"));
+        return -1;
+    }
+    reader.offset = magiclen;
+
+    if (virQEMUCapsBinGetU32(&reader, &version) < 0 ||
+        virQEMUCapsBinGetU32(&reader, &endian) < 0)
+        return -1;
+
+    if (version != VIR_QEMU_CAPS_BINARY_VERSION ||
+        endian != VIR_QEMU_CAPS_BINARY_ENDIAN) {
+        VIR_DEBUG("Outdated capabilities for %s: unsupported cache format",
+                  qemuCaps->binary);
+        return 1;
+    }
+
+    if (virQEMUCapsBinGetI64(&reader, &l) < 0 ||
+        virQEMUCapsBinGetU32(&reader, &qemuCaps->libvirtVersion) < 0)
+        return -1;
+    qemuCaps->libvirtCtime = (time_t)l;
+
+    if (!skipInvalidation &&
+        (qemuCaps->libvirtCtime != virGetSelfLastChanged() ||
+         qemuCaps->libvirtVersion != LIBVIR_VERSION_NUMBER)) {
+        VIR_DEBUG("Outdated capabilities in %s: libvirt changed "
+                  "(%lld vs %lld, %lu vs %lu), stopping load",
+                  qemuCaps->binary,
+                  (long long)qemuCaps->libvirtCtime,
+                  (long long)virGetSelfLastChanged(),
+                  (unsigned long)qemuCaps->libvirtVersion,
+                  (unsigned long)LIBVIR_VERSION_NUMBER);
+        return 1;
+    }
+
+    if (virQEMUCapsBinGetStrRequired(&reader, &binary) < 0)
+        return -1;
+    if (STRNEQ(binary, qemuCaps->binary)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Expected caps for '%s' but saw '%s'"),
+                       qemuCaps->binary, binary);
+        return -1;
+    }
+
+    if (virQEMUCapsBinGetTime(&reader, &qemuCaps->ctime) < 0 ||
+        virQEMUCapsBinGetTime(&reader, &qemuCaps->modDirMtime) < 0 ||
+        virQEMUCapsBinGetCount(&reader, &nflags) < 0)
+        return -1;
+
+    for (i = 0; i < nflags; i++) {
+        unsigned int flag;
+
+        if (virQEMUCapsBinGetU32(&reader, &flag) < 0)
+            return -1;
+
+        if (flag >= QEMU_CAPS_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Unknown qemu capabilities flag %u"), flag);
+            return -1;
+        }
+        virQEMUCapsSet(qemuCaps, flag);
+    }
+
+    if (virQEMUCapsBinGetU32(&reader, &qemuCaps->version) < 0 ||
+        virQEMUCapsBinGetU32(&reader, &qemuCaps->kvmVersion) < 0 ||
+        virQEMUCapsBinGetU32(&reader, &qemuCaps->microcodeVersion) < 0 ||
+        virQEMUCapsBinGetStr(&reader, &qemuCaps->hostCPUSignature) < 0 ||
+        virQEMUCapsBinGetStr(&reader, &qemuCaps->package) < 0 ||
+        virQEMUCapsBinGetStr(&reader, &qemuCaps->kernelVersion) < 0 ||
+        virQEMUCapsBinGetU32(&reader, &arch) < 0 ||
+        virQEMUCapsBinGetStr(&reader, &cpudata) < 0)
+        return -1;
+
+    if (arch == VIR_ARCH_NONE || arch >= VIR_ARCH_LAST) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unknown arch %u in QEMU capabilities cache"), arch);
+        return -1;
+    }
+    qemuCaps->arch = arch;
+
+    if (cpudata &&
+        !(qemuCaps->cpuData = virCPUDataParse(cpudata)))
+        return -1;
+
+    if (virQEMUCapsLoadBinaryAccel(qemuCaps, &reader, VIR_DOMAIN_VIRT_KVM) < 0 ||
+        virQEMUCapsLoadBinaryAccel(qemuCaps, &reader, VIR_DOMAIN_VIRT_QEMU) < 0)
+        return -1;
+
+    if (virQEMUCapsBinGetCount(&reader, &qemuCaps->ngicCapabilities) < 0)
+        return -1;
+
+    qemuCaps->gicCapabilities = g_new0(virGICCapability,
+                                       qemuCaps->ngicCapabilities);
+    for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+        virGICCapability *cap = &qemuCaps->gicCapabilities[i];
+        unsigned int gicVersion;
+        unsigned int implementation;
+
+        if (virQEMUCapsBinGetU32(&reader, &gicVersion) < 0 ||
+            virQEMUCapsBinGetU32(&reader, &implementation) < 0)
+            return -1;
+
+        cap->version = gicVersion;
+        cap->implementation = implementation;
+    }
+
+    if (virQEMUCapsBinGetBool(&reader, &sev) < 0)
+        return -1;
+
+    if (sev) {
+        g_autoptr(virSEVCapability) sevCaps = g_new0(virSEVCapability, 1);
+
+        if (virQEMUCapsBinGetU32(&reader, &sevCaps->cbitpos) < 0 ||
+            virQEMUCapsBinGetU32(&reader, &sevCaps->reduced_phys_bits) < 0 ||
+            virQEMUCapsBinGetStrRequired(&reader, &sevCaps->pdh) < 0 ||
+            virQEMUCapsBinGetStrRequired(&reader, &sevCaps->cert_chain) < 0)
+            return -1;
+
+        qemuCaps->sevCapabilities = g_steal_pointer(&sevCaps);
+    }
+
+    if (virQEMUCapsLoadBinaryStatsSchema(qemuCaps, &reader) < 0 ||
+        virQEMUCapsBinGetBool(&reader, &qemuCaps->kvmSupportsNesting) < 0 ||
+        virQEMUCapsBinGetBool(&reader, &qemuCaps->kvmSupportsSecureGuest) < 0)
+        return -1;
+
+    if (reader.offset != reader.len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("trailing garbage in QEMU capabilities cache"));
+        return -1;
+    }
+
+    virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_KVM);
+    virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_QEMU);
+
+    if (skipInvalidation)
+        qemuCaps->invalidation = false;
+
+    return 0;
+}
+
+
+/**
+ * virQEMUCapsLoadCacheBinary:
+ * @hostArch: host architecture
+ * @qemuCaps: capabilities object to fill in
+ * @filename: binary capabilities cache file
+ * @skipInvalidation: don't check whether the data is outdated
+ *
+ * Same as virQEMUCapsLoadCache, but loads the binary cache format. The file
+ * is mapped into memory rather than read, which is safe as the cache files
+ * are only ever replaced atomically.
+ *
+ * Returns 0 on success, 1 if outdated, -1 on error
+ */
+int
+virQEMUCapsLoadCacheBinary(virArch hostArch,
+                           virQEMUCaps *qemuCaps,
+                           const char *filename,
+                           bool skipInvalidation)
+{
+    VIR_AUTOCLOSE fd = -1;
+    struct stat sb;
+    void *data;
+    int ret;
+
+    if ((fd = open(filename, O_RDONLY)) < 0) {
+        virReportSystemError(errno, _("cannot open file '%s'"), filename);
+        return -1;
+    }
+
+    if (fstat(fd, &sb) < 0) {
+        virReportSystemError(errno, _("cannot stat file '%s'"), filename);
+        return -1;
+    }
+
+    if (sb.st_size == 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("empty QEMU capabilities cache '%s'"), filename);
+        return -1;
+    }
+
+    data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        virReportSystemError(errno, _("cannot map file '%s'"), filename);
+        return -1;
+    }
+
+    ret = virQEMUCapsLoadCacheBinaryData(hostArch, qemuCaps, data,
+                                         sb.st_size, skipInvalidation);
+
+    munmap(data, sb.st_size);
+    return ret;
+}
+
+
+static int
+virQEMUCapsSaveFileBinary(int fd,
+                          const void *opaque)
+{
+    const GByteArray *data = opaque;
+
+    if (safewrite(fd, data->data, data->len) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virQEMUCapsSaveFile(void *data,
+                    const char *filename,
+                    void *privData G_GNUC_UNUSED)
+{
+    virQEMUCaps *qemuCaps = data;
+    g_autoptr(GByteArray) bin = NULL;
+    g_autofree char *xml = NULL;
+    g_autofree char *xmlFile = NULL;
+
+    if (!(bin = virQEMUCapsFormatCacheBinary(qemuCaps)))
+        return -1;
+
+    /* The file has to be replaced atomically as it may be mapped
+     * into memory by virQEMUCapsLoadCacheBinary at the same time */
+    if (virFileRewrite(filename, 0600, virQEMUCapsSaveFileBinary, bin) < 0)
+        return -1;
+
+    /* The XML form is not used by libvirt, it's kept around just
+     * to allow inspecting the cached data */
+    xml = virQEMUCapsFormatCache(qemuCaps);
+    xmlFile = g_strdup_printf("%.*s.xml",
+                              (int) (strlen(filename) - strlen(".bin")),
+                              filename);
+
+    if (virFileWriteStr(xmlFile, xml, 0600) < 0)
+        VIR_WARN("Failed to save '%s' for '%s': %s",
+                 xmlFile, qemuCaps->binary, g_strerror(errno));
+
+    VIR_DEBUG("Saved caps '%s' for '%s' with (%lld, %lld)",
+              filename, qemuCaps->binary,
+              (long long)qemuCaps->ctime,
+              (long long)qemuCaps->libvirtCtime);
+
+    return 0;
+}
+
+
+/*
+ * Check whether IBM Secure Execution (S390) is enabled
+ */
+static bool
+virQEMUCapsKVMSupportsSecureGuestS390(void)
+{
+
+    g_autofree char *cmdline = NULL;
+    static const char *kValues[] = {"y", "Y", "on", "ON", "oN", "On", "1"};
+
+    if (!virFileIsDir("/sys/firmware/uv"))
+        return false;
+
+    if (virFileReadValueString(&cmdline, "/proc/cmdline") < 0)
+        return false;
+
+    /* we're prefix matching rather than equality matching here, because kernel
+     * would treat even something like prot_virt='yFOO' as enabled */
+    if (virKernelCmdlineMatchParam(cmdline, "prot_virt", kValues,
+                                   G_N_ELEMENTS(kValues),
+                                   VIR_KERNEL_CMDLINE_FLAGS_SEARCH_FIRST |
+                                   VIR_KERNEL_CMDLINE_FLAGS_CMP_PREFIX))
+        return true;
+
+    return false;
+}
+
+
+/*
+ * Check whether AMD Secure Encrypted Virtualization (x86) is enabled
+ */
+static bool
+virQEMUCapsKVMSupportsSecureGuestAMD(void)
+{
+    g_autofree char *modValue = NULL;
+
+    if (virFileReadValueString(&modValue, "/sys/module/kvm_amd/parameters/sev") < 0)
+        return false;
+
+    if (modValue[0] != '1')
+        return false;
+
+    if (virFileExists(QEMU_DEV_SEV))
+        return true;
+
+    return false;
+}
+
+
+/*
+ * Check whether the secure guest functionality is enabled.
+ * See the specific architecture function for details on the verifications made.
+ */
+static bool
+virQEMUCapsKVMSupportsSecureGuest(void)
+{
+    virArch arch = virArchFromHost();
+
+    if (ARCH_IS_S390(arch))
+        return virQEMUCapsKVMSupportsSecureGuestS390();
 
     if (ARCH_IS_X86(arch))
         return virQEMUCapsKVMSupportsSecureGuestAMD();
@@ -5281,6 +6490,8 @@ virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
         return -1;
     if (virQEMUCapsProbeQMPSEVCapabilities(qemuCaps, mon) < 0)
         return -1;
+    if (virQEMUCapsProbeQMPStatsSchema(qemuCaps, mon) < 0)
+        return -1;
 
     virQEMUCapsInitProcessCaps(qemuCaps);
 
@@ -5333,22 +6544,102 @@ virQEMUCapsLogProbeFailure(const char *binary)
 }
 
 
+/* QEMU process for probing capabilities started in a separate thread */
+typedef struct _virQEMUCapsQMPStart virQEMUCapsQMPStart;
+struct _virQEMUCapsQMPStart {
+    qemuProcessQMP *proc;
+    virThread thread;
+    bool running;
+    int rc;
+    virErrorPtr err;
+};
+
+
+static void
+virQEMUCapsQMPStartWorker(void *opaque)
+{
+    virQEMUCapsQMPStart *start = opaque;
+
+    if ((start->rc = qemuProcessQMPStart(start->proc)) < 0)
+        virErrorPreserveLast(&start->err);
+}
+
+
+/*
+ * Starts QEMU for probing without waiting for it to come up. Failing to
+ * do so is not an error, the caller will start QEMU on its own once the
+ * process is needed.
+ */
+static void
+virQEMUCapsQMPStartAsync(virQEMUCapsQMPStart *start,
+                         const char *binary,
+                         const char *libDir,
+                         uid_t runUid,
+                         gid_t runGid,
+                         bool onlyTCG)
+{
+    if (!(start->proc = qemuProcessQMPNew(binary, libDir,
+                                          runUid, runGid, onlyTCG)) ||
+        virThreadCreateFull(&start->thread, true,
+                            virQEMUCapsQMPStartWorker,
+                            "qemu-caps-probe", false, start) < 0) {
+        virResetLastError();
+        g_clear_pointer(&start->proc, qemuProcessQMPFree);
+        return;
+    }
+
+    start->running = true;
+}
+
+
+static void
+virQEMUCapsQMPStartJoin(virQEMUCapsQMPStart *start)
+{
+    if (!start->running)
+        return;
+
+    virThreadJoin(&start->thread);
+    start->running = false;
+}
+
+
+static void
+virQEMUCapsQMPStartClear(virQEMUCapsQMPStart *start)
+{
+    virQEMUCapsQMPStartJoin(start);
+    g_clear_pointer(&start->proc, qemuProcessQMPFree);
+    g_clear_pointer(&start->err, virFreeError);
+}
+
+
 static int
 virQEMUCapsInitQMPSingle(virQEMUCaps *qemuCaps,
                          const char *libDir,
                          uid_t runUid,
                          gid_t runGid,
+                         virQEMUCapsQMPStart *start,
                          bool onlyTCG)
 {
     g_autoptr(qemuProcessQMP) proc = NULL;
     int ret = -1;
 
-    if (!(proc = qemuProcessQMPNew(qemuCaps->binary, libDir,
-                                   runUid, runGid, onlyTCG)))
-        goto cleanup;
+    if (start && start->proc) {
+        /* QEMU has been started by virQEMUCapsQMPStartAsync already */
+        virQEMUCapsQMPStartJoin(start);
+        proc = g_steal_pointer(&start->proc);
 
-    if (qemuProcessQMPStart(proc) < 0)
-        goto cleanup;
+        if (start->rc < 0) {
+            virErrorRestore(&start->err);
+            goto cleanup;
+        }
+    } else {
+        if (!(proc = qemuProcessQMPNew(qemuCaps->binary, libDir,
+                                       runUid, runGid, onlyTCG)))
+            goto cleanup;
+
+        if (qemuProcessQMPStart(proc) < 0)
+            goto cleanup;
+    }
 
     if (onlyTCG)
         ret = virQEMUCapsInitQMPMonitorTCG(qemuCaps, proc->mon);
@@ -5365,12 +6656,26 @@ virQEMUCapsInitQMPSingle(virQEMUCaps *qemuCaps,
 
 static int
 virQEMUCapsInitQMP(virQEMUCaps *qemuCaps,
+                   virArch hostArch,
                    const char *libDir,
                    uid_t runUid,
                    gid_t runGid)
 {
-    if (virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid, false) < 0)
-        return -1;
+    virQEMUCapsQMPStart tcg = { 0 };
+    g_autofree char *native = virQEMUCapsGetDefaultEmulator(hostArch, hostArch);
+    int ret = -1;
+
+    /* The TCG pass below is most likely needed when probing the native
+     * emulator on a host with KVM, let the QEMU process it needs start
+     * up while the first one is being probed. */
+    if (STREQ_NULLABLE(native, qemuCaps->binary) &&
+        virFileExists("/dev/kvm"))
+        virQEMUCapsQMPStartAsync(&tcg, qemuCaps->binary, libDir,
+                                 runUid, runGid, true);
+
+    if (virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid,
+                                 NULL, false) < 0)
+        goto cleanup;
 
     /*
      * If KVM was enabled during the first probe, we need to explicitly probe
@@ -5379,10 +6684,15 @@ virQEMUCapsInitQMP(virQEMUCaps *qemuCaps,
      */
     if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_KVM) &&
         virQEMUCapsGet(qemuCaps, QEMU_CAPS_TCG) &&
-        virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid, true) < 0)
-        return -1;
+        virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid,
+                                 &tcg, true) < 0)
+        goto cleanup;
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    virQEMUCapsQMPStartClear(&tcg);
+    return ret;
 }
 
 
@@ -5431,7 +6741,7 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
         qemuCaps->modDirMtime = sb.st_mtime;
     }
 
-    if (virQEMUCapsInitQMP(qemuCaps, libDir, runUid, runGid) < 0)
+    if (virQEMUCapsInitQMP(qemuCaps, hostArch, libDir, runUid, runGid) < 0)
         return NULL;
 
     qemuCaps->libvirtCtime = virGetSelfLastChanged();
@@ -5486,7 +6796,7 @@ virQEMUCapsLoadFile(const char *filename,
     if (!qemuCaps)
         return NULL;
 
-    ret = virQEMUCapsLoadCache(priv->hostArch, qemuCaps, filename, false);
+    ret = virQEMUCapsLoadCacheBinary(priv->hostArch, qemuCaps, filename, false);
     if (ret < 0)
         return NULL;
     if (ret == 1) {
@@ -5559,7 +6869,7 @@ virQEMUCapsCacheNew(const char *libDir,
 
     capsCacheDir = g_strdup_printf("%s/capabilities", cacheDir);
 
-    if (!(cache = virFileCacheNew(capsCacheDir, "xml", &qemuCapsCacheHandlers)))
+    if (!(cache = virFileCacheNew(capsCacheDir, "bin", &qemuCapsCacheHandlers)))
         goto error;
 
     priv = g_new0(virQEMUCapsCachePriv, 1);
@@ -5607,6 +6917,27 @@ virQEMUCapsCacheLookup(virFileCache *cache,
 }
 
 
+/**
+ * virQEMUCapsCachePrefetch:
+ * @cache: QEMU capabilities cache
+ * @binaries: NULL terminated list of emulator binaries
+ *
+ * Probes capabilities of all @binaries which are not cached yet in
+ * parallel. Callers of virQEMUCapsCacheLookup only wait for the binary
+ * they asked for.
+ */
+void
+virQEMUCapsCachePrefetch(virFileCache *cache,
+                         const char *const *binaries)
+{
+    virQEMUCapsCachePriv *priv = virFileCacheGetPriv(cache);
+
+    priv->microcodeVersion = virHostCPUGetMicrocodeVersion(priv->hostArch);
+
+    virFileCachePrefetch(cache, binaries);
+}
+
+
 virQEMUCaps *
 virQEMUCapsCacheLookupCopy(virFileCache *cache,
                            virDomainVirtType virtType,
@@ -5619,7 +6950,7 @@ virQEMUCapsCacheLookupCopy(virFileCache *cache,
     if (!qemuCaps)
         return NULL;
 
-    ret = virQEMUCapsNewCopy(qemuCaps);
+    ret = virQEMUCapsNewCopyShared(qemuCaps);
     virObjectUnref(qemuCaps);
 
     if (!ret)
@@ -6366,9 +7697,12 @@ static void
 virQEMUCapsStripMachineAliasesForVirtType(virQEMUCaps *qemuCaps,
                                           virDomainVirtType virtType)
 {
-    virQEMUCapsAccel *accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+    virQEMUCapsAccel *accel;
     size_t i;
 
+    virQEMUCapsUnshare(qemuCaps);
+    accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+
     for (i = 0; i < accel->nmachineTypes; i++) {
         virQEMUCapsMachineType *mach = &accel->machineTypes[i];
         g_autofree char *name = g_steal_pointer(&mach->alias);
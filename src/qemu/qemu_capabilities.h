@@ -631,6 +631,11 @@ typedef enum { /* virQEMUCapsFlags grouping marker for syntax-check */
     QEMU_CAPS_DEVICE_JSON, /* -device accepts JSON */
     QEMU_CAPS_QUERY_DIRTY_RATE, /* accepts query-dirty-rate */
     QEMU_CAPS_RBD_ENCRYPTION, /* Ceph RBD encryption support */
+    QEMU_CAPS_QUERY_STATS, /* accepts query-stats */
+    QEMU_CAPS_QUERY_STATS_SCHEMAS, /* accepts query-stats-schemas */
+
+    /* 420 */
+    QEMU_CAPS_MEMORY_BACKEND_PREALLOC_THREADS, /* -object memory-backend-*.prealloc-threads */
 
     QEMU_CAPS_LAST /* this must always be the last item */
 } virQEMUCapsFlags;
@@ -748,6 +753,8 @@ virFileCache *virQEMUCapsCacheNew(const char *libDir,
                                     gid_t gid);
 virQEMUCaps *virQEMUCapsCacheLookup(virFileCache *cache,
                                       const char *binary);
+void virQEMUCapsCachePrefetch(virFileCache *cache,
+                              const char *const *binaries);
 virQEMUCaps *virQEMUCapsCacheLookupCopy(virFileCache *cache,
                                           virDomainVirtType virtType,
                                           const char *binary,
@@ -821,6 +828,10 @@ virQEMUCapsCPUFeatureFromQEMU(virQEMUCaps *qemuCaps,
 virSEVCapability *
 virQEMUCapsGetSEVCapabilities(virQEMUCaps *qemuCaps);
 
+qemuMonitorQueryStatsSchemaData *
+virQEMUCapsGetStatsSchema(virQEMUCaps *qemuCaps,
+                          size_t *nschema);
+
 bool
 virQEMUCapsGetKVMSupportsSecureGuest(virQEMUCaps *qemuCaps) G_GNUC_NO_INLINE;
 
@@ -26,6 +26,7 @@
 #pragma once
 
 virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps);
+virQEMUCaps *virQEMUCapsNewCopyShared(virQEMUCaps *qemuCaps);
 
 virQEMUCaps *
 virQEMUCapsNewForBinaryInternal(virArch hostArch,
@@ -44,6 +45,17 @@ int virQEMUCapsLoadCache(virArch hostArch,
                          bool skipInvalidation);
 char *virQEMUCapsFormatCache(virQEMUCaps *qemuCaps);
 
+int virQEMUCapsLoadCacheBinary(virArch hostArch,
+                               virQEMUCaps *qemuCaps,
+                               const char *filename,
+                               bool skipInvalidation);
+int virQEMUCapsLoadCacheBinaryData(virArch hostArch,
+                                   virQEMUCaps *qemuCaps,
+                                   const char *data,
+                                   size_t len,
+                                   bool skipInvalidation);
+GByteArray *virQEMUCapsFormatCacheBinary(virQEMUCaps *qemuCaps);
+
 int
 virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
                           qemuMonitor *mon);
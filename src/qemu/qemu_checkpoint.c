@@ -106,11 +106,18 @@ qemuCheckpointObjFromCheckpoint(virDomainObj *vm,
 }
 
 
+/**
+ * qemuCheckpointWriteMetadataBatch:
+ *
+ * Like qemuCheckpointWriteMetadata, but adds the file to @batch to be
+ * written along with others if @batch is not NULL.
+ */
 int
-qemuCheckpointWriteMetadata(virDomainObj *vm,
-                            virDomainMomentObj *checkpoint,
-                            virDomainXMLOption *xmlopt,
-                            const char *checkpointDir)
+qemuCheckpointWriteMetadataBatch(virDomainObj *vm,
+                                 virDomainMomentObj *checkpoint,
+                                 virDomainXMLOption *xmlopt,
+                                 const char *checkpointDir,
+                                 virFileRewriteBatch *batch)
 {
     unsigned int flags = VIR_DOMAIN_CHECKPOINT_FORMAT_SECURE;
     virDomainCheckpointDef *def = virDomainCheckpointObjGetDef(checkpoint);
@@ -131,7 +138,18 @@ qemuCheckpointWriteMetadata(virDomainObj *vm,
 
     chkFile = g_strdup_printf("%s/%s.xml", chkDir, def->parent.name);
 
-    return virXMLSaveFile(chkFile, NULL, "checkpoint-edit", newxml);
+    return virXMLSaveFileBatch(batch, chkFile, NULL, "checkpoint-edit", newxml);
+}
+
+
+int
+qemuCheckpointWriteMetadata(virDomainObj *vm,
+                            virDomainMomentObj *checkpoint,
+                            virDomainXMLOption *xmlopt,
+                            const char *checkpointDir)
+{
+    return qemuCheckpointWriteMetadataBatch(vm, checkpoint, xmlopt,
+                                            checkpointDir, NULL);
 }
 
 
@@ -161,7 +179,8 @@ qemuCheckpointDiscardDiskBitmaps(virStorageSource *src,
                                                bitmapdata->name) < 0)
             return -1;
 
-        if (n != src)
+        /* the image may already be listed for another bitmap being removed */
+        if (n != src && !g_slist_find(*reopenimages, n))
             *reopenimages = g_slist_prepend(*reopenimages, n);
     }
 
@@ -176,9 +195,19 @@ qemuCheckpointDiscardDiskBitmaps(virStorageSource *src,
 }
 
 
+/**
+ * qemuCheckpointDiscardBitmaps:
+ * @vm: domain object
+ * @chkdefs: list of virDomainCheckpointDef of the checkpoints being deleted
+ *
+ * Removes the bitmaps of all disks of all checkpoints in @chkdefs in a single
+ * transaction, so that the node data of the backing chains needs to be
+ * queried and the images reopened only once regardless of the number of
+ * disks and checkpoints.
+ */
 static int
 qemuCheckpointDiscardBitmaps(virDomainObj *vm,
-                             virDomainCheckpointDef *chkdef)
+                             GSList *chkdefs)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
     virQEMUDriver *driver = priv->driver;
@@ -190,34 +219,41 @@ qemuCheckpointDiscardBitmaps(virDomainObj *vm,
     g_autoptr(GSList) relabelimages = NULL;
     GSList *next;
 
+    if (!chkdefs)
+        return 0;
+
     actions = virJSONValueNewArray();
 
     if (!(blockNamedNodeData = qemuBlockGetNamedNodeData(vm, QEMU_ASYNC_JOB_NONE)))
         return -1;
 
-    for (i = 0; i < chkdef->ndisks; i++) {
-        virDomainCheckpointDiskDef *chkdisk = &chkdef->disks[i];
-        virDomainDiskDef *domdisk = virDomainDiskByTarget(vm->def, chkdisk->name);
+    for (next = chkdefs; next; next = next->next) {
+        virDomainCheckpointDef *chkdef = next->data;
 
-        /* domdisk can be missing e.g. when it was unplugged */
-        if (!domdisk)
-            continue;
+        for (i = 0; i < chkdef->ndisks; i++) {
+            virDomainCheckpointDiskDef *chkdisk = &chkdef->disks[i];
+            virDomainDiskDef *domdisk = virDomainDiskByTarget(vm->def, chkdisk->name);
 
-        if (chkdisk->type != VIR_DOMAIN_CHECKPOINT_TYPE_BITMAP)
-            continue;
+            /* domdisk can be missing e.g. when it was unplugged */
+            if (!domdisk)
+                continue;
 
-        if (!chkdisk->bitmap) {
-            virReportError(VIR_ERR_INVALID_ARG,
-                           _("missing bitmap name for disk '%s' of checkpoint '%s'"),
-                           chkdisk->name, chkdef->parent.name);
-            return -1;
-        }
+            if (chkdisk->type != VIR_DOMAIN_CHECKPOINT_TYPE_BITMAP)
+                continue;
 
-        if (qemuCheckpointDiscardDiskBitmaps(domdisk->src, blockNamedNodeData,
-                                             chkdisk->bitmap,
-                                             actions, domdisk->dst,
-                                             &reopenimages) < 0)
-            return -1;
+            if (!chkdisk->bitmap) {
+                virReportError(VIR_ERR_INVALID_ARG,
+                               _("missing bitmap name for disk '%s' of checkpoint '%s'"),
+                               chkdisk->name, chkdef->parent.name);
+                return -1;
+            }
+
+            if (qemuCheckpointDiscardDiskBitmaps(domdisk->src, blockNamedNodeData,
+                                                 chkdisk->bitmap,
+                                                 actions, domdisk->dst,
+                                                 &reopenimages) < 0)
+                return -1;
+        }
     }
 
     /* label any non-top images for read-write access */
@@ -275,11 +311,8 @@ qemuCheckpointDiscard(virQEMUDriver *driver,
     chkFile = g_strdup_printf("%s/%s/%s.xml", cfg->checkpointDir, vm->def->name,
                               chk->def->name);
 
-    if (!metadata_only) {
-        virDomainCheckpointDef *chkdef = virDomainCheckpointObjGetDef(chk);
-        if (qemuCheckpointDiscardBitmaps(vm, chkdef) < 0)
-            return -1;
-    }
+    /* bitmaps are removed by the caller for all deleted checkpoints at once,
+     * see qemuCheckpointDiscardBitmaps */
 
     if (chkcurrent) {
         virDomainMomentObj *parent = NULL;
@@ -663,6 +696,9 @@ qemuCheckpointGetXMLDescUpdateSize(virDomainObj *vm,
     if (virDomainObjCheckActive(vm) < 0)
         goto endjob;
 
+    /* the dirty counts of the bitmaps change constantly */
+    qemuBlockNamedNodeDataInvalidate(vm);
+
     if (!(blockNamedNodeData = qemuBlockGetNamedNodeData(vm, QEMU_ASYNC_JOB_NONE)))
         goto endjob;
 
@@ -806,6 +842,7 @@ struct virQEMUCheckpointReparent {
     virDomainMomentObj *parent;
     virDomainObj *vm;
     virDomainXMLOption *xmlopt;
+    virFileRewriteBatch *batch;
     int err;
 };
 
@@ -826,8 +863,22 @@ qemuCheckpointReparentChildren(void *payload,
     if (rep->parent->def)
         moment->def->parent_name = g_strdup(rep->parent->def->name);
 
-    rep->err = qemuCheckpointWriteMetadata(rep->vm, moment,
-                                           rep->xmlopt, rep->dir);
+    rep->err = qemuCheckpointWriteMetadataBatch(rep->vm, moment,
+                                                rep->xmlopt, rep->dir,
+                                                rep->batch);
+    return 0;
+}
+
+
+static int
+qemuCheckpointCollectDefs(void *payload,
+                          const char *name G_GNUC_UNUSED,
+                          void *data)
+{
+    virDomainMomentObj *moment = payload;
+    GSList **chkdefs = data;
+
+    *chkdefs = g_slist_prepend(*chkdefs, virDomainCheckpointObjGetDef(moment));
     return 0;
 }
 
@@ -844,6 +895,8 @@ qemuCheckpointDelete(virDomainObj *vm,
     virDomainMomentObj *chk = NULL;
     virQEMUMomentRemove rem;
     struct virQEMUCheckpointReparent rep;
+    g_autoptr(virFileRewriteBatch) batch = NULL;
+    g_autoptr(GSList) chkdefs = NULL;
     bool metadata_only = !!(flags & VIR_DOMAIN_CHECKPOINT_DELETE_METADATA_ONLY);
 
     virCheckFlags(VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN |
@@ -870,6 +923,19 @@ qemuCheckpointDelete(virDomainObj *vm,
     if (!(chk = qemuCheckpointObjFromCheckpoint(vm, checkpoint)))
         goto endjob;
 
+    if (!metadata_only) {
+        if (flags & (VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN |
+                     VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN_ONLY))
+            virDomainMomentForEachDescendant(chk, qemuCheckpointCollectDefs,
+                                             &chkdefs);
+
+        if (!(flags & VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN_ONLY))
+            chkdefs = g_slist_prepend(chkdefs, virDomainCheckpointObjGetDef(chk));
+
+        if (qemuCheckpointDiscardBitmaps(vm, chkdefs) < 0)
+            goto endjob;
+    }
+
     if (flags & (VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN |
                  VIR_DOMAIN_CHECKPOINT_DELETE_CHILDREN_ONLY)) {
         rem.driver = driver;
@@ -899,14 +965,18 @@ qemuCheckpointDelete(virDomainObj *vm,
             }
         }
     } else if (chk->nchildren) {
+        /* every child gets its file rewritten, do it in one go */
+        batch = virFileRewriteBatchNew();
         rep.dir = cfg->checkpointDir;
         rep.parent = chk->parent;
         rep.vm = vm;
         rep.err = 0;
         rep.xmlopt = driver->xmlopt;
+        rep.batch = batch;
         virDomainMomentForEachChild(chk, qemuCheckpointReparentChildren,
                                     &rep);
-        if (rep.err < 0)
+        if (rep.err < 0 ||
+            virFileRewriteBatchCommit(batch) < 0)
             goto endjob;
         virDomainMomentMoveChildren(chk, chk->parent);
     }
@@ -85,3 +85,10 @@ qemuCheckpointWriteMetadata(virDomainObj *vm,
                             virDomainMomentObj *checkpoint,
                             virDomainXMLOption *xmlopt,
                             const char *checkpointDir);
+
+int
+qemuCheckpointWriteMetadataBatch(virDomainObj *vm,
+                                 virDomainMomentObj *checkpoint,
+                                 virDomainXMLOption *xmlopt,
+                                 const char *checkpointDir,
+                                 virFileRewriteBatch *batch);
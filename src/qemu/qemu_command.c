@@ -3591,7 +3591,11 @@ qemuBuildMemoryBackendProps(virJSONValue **backendProps,
             return -1;
     } else {
         if (!priv->memPrealloc &&
-            virJSONValueObjectAdd(&props, "B:prealloc", prealloc, NULL) < 0)
+            virJSONValueObjectAdd(&props,
+                                  "B:prealloc", prealloc,
+                                  "p:prealloc-threads",
+                                  prealloc ? def->mem.allocation_threads : 0,
+                                  NULL) < 0)
             return -1;
     }
 
@@ -44,10 +44,13 @@
 #include "domain_driver.h"
 #include "domain_nwfilter.h"
 #include "virfile.h"
+#include "virhostcpu.h"
+#include "virhostmem.h"
 #include "virsocket.h"
 #include "virstring.h"
 #include "storage_conf.h"
 #include "virutil.h"
+#include "vircrypto.h"
 #include "configmake.h"
 #include "security/security_util.h"
 
@@ -277,6 +280,8 @@ virQEMUDriverConfig *virQEMUDriverConfigNew(bool privileged,
 
     cfg->keepAliveInterval = 5;
     cfg->keepAliveCount = 5;
+    cfg->reconnectWorkers = 16;
+    cfg->statsWorkers = 16;
     cfg->seccompSandbox = -1;
 
     cfg->logTimestamp = true;
@@ -621,6 +626,16 @@ virQEMUDriverConfigLoadSaveEntry(virQEMUDriverConfig *cfg,
         return -1;
     if (virConfGetValueString(conf, "snapshot_image_format", &cfg->snapshotImageFormat) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "save_parallel_channels", &cfg->saveParallelChannels) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "backup_nbd_max_connections", &cfg->backupNBDMaxConnections) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "block_job_pool_bandwidth", &cfg->blockJobPoolBandwidth) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "block_job_pool_max_concurrent", &cfg->blockJobPoolMaxConcurrent) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "block_job_latency_target", &cfg->blockJobLatencyTarget) < 0)
+        return -1;
     if (virConfGetValueString(conf, "auto_dump_path", &cfg->autoDumpPath) < 0)
         return -1;
     if (virConfGetValueBool(conf, "auto_dump_bypass_cache", &cfg->autoDumpBypassCache) < 0)
@@ -677,6 +692,10 @@ virQEMUDriverConfigLoadProcessEntry(virQEMUDriverConfig *cfg,
 
     if (virConfGetValueBool(conf, "set_process_name", &cfg->setProcessName) < 0)
         return -1;
+    if (virConfGetValueBool(conf, "async_hooks", &cfg->asyncHooks) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "io_autotune", &cfg->ioAutotune) < 0)
+        return -1;
     if (virConfGetValueUInt(conf, "max_processes", &cfg->maxProcesses) < 0)
         return -1;
     if (virConfGetValueUInt(conf, "max_files", &cfg->maxFiles) < 0)
@@ -752,6 +771,16 @@ virQEMUDriverConfigLoadRPCEntry(virQEMUDriverConfig *cfg,
 {
     if (virConfGetValueUInt(conf, "max_queued", &cfg->maxQueuedJobs) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "reconnect_workers", &cfg->reconnectWorkers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_workers", &cfg->statsWorkers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_cache_max_age", &cfg->statsCacheMaxAge) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "status_save_interval", &cfg->statusSaveInterval) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "compact_domain_data", &cfg->compactDomainData) < 0)
+        return -1;
     if (virConfGetValueInt(conf, "keepalive_interval", &cfg->keepAliveInterval) < 0)
         return -1;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
@@ -786,6 +815,22 @@ virQEMUDriverConfigLoadNetworkEntry(virQEMUDriverConfig *cfg,
         return -1;
     }
 
+    if (virConfGetValueUInt(conf, "migration_host_bandwidth",
+                            &cfg->migrationHostBandwidth) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "migration_max_concurrent",
+                            &cfg->migrationMaxConcurrent) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "migration_converge_iterations",
+                            &cfg->migrationConvergeIterations) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "migration_converge_postcopy",
+                            &cfg->migrationConvergePostcopy) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "migration_storage_parallel",
+                            &cfg->migrationStorageParallel) < 0)
+        return -1;
+
     if (virConfGetValueString(conf, "migration_host", &cfg->migrateHost) < 0)
         return -1;
     virStringStripIPv6Brackets(cfg->migrateHost);
@@ -990,6 +1035,9 @@ virQEMUDriverConfigLoadSecurityEntry(virQEMUDriverConfig *cfg,
         }
     }
 
+    if (virConfGetValueBool(conf, "namespace_helper", &cfg->namespaceHelper) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -1197,6 +1245,12 @@ virQEMUDriverConfigValidate(virQEMUDriverConfig *cfg)
         return -1;
     }
 
+    if (cfg->reconnectWorkers == 0) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("reconnect_workers must be greater than zero"));
+        return -1;
+    }
+
     return 0;
 }
 
@@ -1412,12 +1466,119 @@ virCaps *virQEMUDriverGetCapabilities(virQEMUDriver *driver,
 }
 
 
+/* The formatted capabilities are rebuilt at least this often to pick up
+ * emulators which were installed or removed */
+#define QEMU_CAPS_XML_MAX_AGE (30 * G_USEC_PER_SEC)
+
+/*
+ * Describes the state of the host resources which the capabilities
+ * depend on and which change at runtime, i.e. the online CPUs and the
+ * amount of memory. Returns NULL if the state can't be determined.
+ */
+static char *
+virQEMUDriverGetHostState(void)
+{
+    g_autoptr(virBitmap) online = NULL;
+    g_autofree char *cpus = NULL;
+    unsigned long long memory;
+
+    if (!(online = virHostCPUGetOnlineBitmap()) ||
+        !(cpus = virBitmapFormat(online)) ||
+        virHostMemGetInfo(&memory, NULL) < 0) {
+        virResetLastError();
+        return NULL;
+    }
+
+    return g_strdup_printf("%s:%llu", cpus, memory);
+}
+
+
+/**
+ * virQEMUDriverGetCapabilitiesXML:
+ * @driver: QEMU driver
+ *
+ * Formats the capabilities of the host. The XML is reused until CPUs or
+ * memory of the host go online or offline, or until it is
+ * QEMU_CAPS_XML_MAX_AGE old, rather than rebuilding the capabilities on
+ * every call.
+ *
+ * Returns the formatted capabilities or NULL on error.
+ */
+char *
+virQEMUDriverGetCapabilitiesXML(virQEMUDriver *driver)
+{
+    g_autoptr(virCaps) caps = NULL;
+    g_autofree char *host = virQEMUDriverGetHostState();
+    gint64 now = g_get_monotonic_time();
+    char *xml = NULL;
+
+    qemuDriverLock(driver);
+    if (host && driver->capsXML &&
+        STREQ_NULLABLE(driver->capsXMLHost, host) &&
+        now - driver->capsXMLTime < QEMU_CAPS_XML_MAX_AGE)
+        xml = g_strdup(driver->capsXML);
+    qemuDriverUnlock(driver);
+
+    if (xml)
+        return xml;
+
+    if (!(caps = virQEMUDriverGetCapabilities(driver, true)) ||
+        !(xml = virCapabilitiesFormatXML(caps)))
+        return NULL;
+
+    qemuDriverLock(driver);
+    g_free(driver->capsXML);
+    driver->capsXML = g_strdup(xml);
+    g_free(driver->capsXMLHost);
+    driver->capsXMLHost = g_steal_pointer(&host);
+    driver->capsXMLTime = now;
+    qemuDriverUnlock(driver);
+
+    return xml;
+}
+
+
+#define QEMU_DOMAIN_CAPS_CACHE_MAX 256
+
+typedef struct _qemuDomainCapsEntry qemuDomainCapsEntry;
+struct _qemuDomainCapsEntry {
+    virQEMUCaps *qemuCaps; /* capabilities @domCaps were computed from */
+    virDomainCaps *domCaps;
+    char *xml;
+};
+
+
+static void
+qemuDomainCapsEntryFree(void *opaque)
+{
+    qemuDomainCapsEntry *entry = opaque;
+
+    if (!entry)
+        return;
+
+    virObjectUnref(entry->qemuCaps);
+    virObjectUnref(entry->domCaps);
+    g_free(entry->xml);
+    g_free(entry);
+}
+
+
 /**
  * virQEMUDriverGetDomainCapabilities:
+ * @driver: QEMU driver
+ * @qemuCaps: QEMU capabilities from the driver's cache
+ * @machine: machine type
+ * @arch: guest architecture
+ * @virttype: domain virt type
+ * @xml: (optional) filled in with the formatted capabilities
  *
  * Get a reference to the virDomainCaps *instance. The caller
  * must release the reference with virObjetUnref().
  *
+ * The result is cached per emulator, @arch, @virttype and @machine for as
+ * long as @qemuCaps stays in the capabilities cache, so the returned object
+ * is shared and must not be modified.
+ *
  * Returns: a reference to a virDomainCaps *instance or NULL
  */
 virDomainCaps *
@@ -1425,11 +1586,37 @@ virQEMUDriverGetDomainCapabilities(virQEMUDriver *driver,
                                    virQEMUCaps *qemuCaps,
                                    const char *machine,
                                    virArch arch,
-                                   virDomainVirtType virttype)
+                                   virDomainVirtType virttype,
+                                   char **xml)
 {
-    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autoptr(virQEMUDriverConfig) cfg = NULL;
     g_autoptr(virDomainCaps) domCaps = NULL;
     const char *path = virQEMUCapsGetBinary(qemuCaps);
+    g_autofree char *key = NULL;
+    qemuDomainCapsEntry *entry;
+
+    key = g_strdup_printf("%s\n%s\n%s\n%s",
+                          path, virArchToString(arch),
+                          virDomainVirtTypeToString(virttype),
+                          NULLSTR(machine));
+
+    qemuDriverLock(driver);
+    if (driver->domainCaps &&
+        (entry = g_hash_table_lookup(driver->domainCaps, key))) {
+        if (entry->qemuCaps == qemuCaps) {
+            domCaps = virObjectRef(entry->domCaps);
+            if (xml)
+                *xml = g_strdup(entry->xml);
+            qemuDriverUnlock(driver);
+            return g_steal_pointer(&domCaps);
+        }
+
+        /* the capabilities of the emulator were probed again */
+        g_hash_table_remove(driver->domainCaps, key);
+    }
+    qemuDriverUnlock(driver);
+
+    cfg = virQEMUDriverGetConfig(driver);
 
     if (!(domCaps = virDomainCapsNew(path, machine, arch, virttype)))
         return NULL;
@@ -1440,10 +1627,213 @@ virQEMUDriverGetDomainCapabilities(virQEMUDriver *driver,
                                   cfg->nfirmwares) < 0)
         return NULL;
 
+    entry = g_new0(qemuDomainCapsEntry, 1);
+    entry->qemuCaps = virObjectRef(qemuCaps);
+    entry->domCaps = virObjectRef(domCaps);
+
+    if (!(entry->xml = virDomainCapsFormat(domCaps))) {
+        qemuDomainCapsEntryFree(entry);
+        return NULL;
+    }
+
+    if (xml)
+        *xml = g_strdup(entry->xml);
+
+    qemuDriverLock(driver);
+    if (!driver->domainCaps) {
+        driver->domainCaps = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   g_free, qemuDomainCapsEntryFree);
+    }
+
+    /* Stale entries are only dropped when looked up, keep the cache bounded */
+    if (g_hash_table_size(driver->domainCaps) >= QEMU_DOMAIN_CAPS_CACHE_MAX)
+        g_hash_table_remove_all(driver->domainCaps);
+
+    g_hash_table_replace(driver->domainCaps, g_steal_pointer(&key), entry);
+    qemuDriverUnlock(driver);
+
     return g_steal_pointer(&domCaps);
 }
 
 
+/**
+ * virQEMUDriverGetStatsCursor:
+ *
+ * Get the statistics cursor of @conn, creating it on first use. The
+ * cursor is owned by @driver and lives until @conn is closed.
+ *
+ * Returns: the cursor or NULL on error
+ */
+virDomainDriverStatsCursor *
+virQEMUDriverGetStatsCursor(virQEMUDriver *driver,
+                            virConnectPtr conn)
+{
+    virDomainDriverStatsCursor *cursor;
+
+    qemuDriverLock(driver);
+    if (!(cursor = g_hash_table_lookup(driver->statsCursors, conn)) &&
+        (cursor = virDomainDriverStatsCursorNew()))
+        g_hash_table_insert(driver->statsCursors, conn, cursor);
+    qemuDriverUnlock(driver);
+
+    return cursor;
+}
+
+
+void
+virQEMUDriverRemoveStatsCursor(virQEMUDriver *driver,
+                               virConnectPtr conn)
+{
+    qemuDriverLock(driver);
+    g_hash_table_remove(driver->statsCursors, conn);
+    qemuDriverUnlock(driver);
+}
+
+
+#define QEMU_CPU_RESULT_CACHE_MAX 256
+
+typedef struct _qemuCPUResult qemuCPUResult;
+struct _qemuCPUResult {
+    virQEMUCaps *qemuCaps; /* capabilities the result was computed from */
+    int result;
+    char *xml;
+};
+
+
+static void
+qemuCPUResultFree(void *opaque)
+{
+    qemuCPUResult *res = opaque;
+
+    if (!res)
+        return;
+
+    virObjectUnref(res->qemuCaps);
+    g_free(res->xml);
+    g_free(res);
+}
+
+
+/**
+ * virQEMUDriverCPUResultKey:
+ * @op: name of the operation
+ * @qemuCaps: QEMU capabilities the operation is computed with
+ * @arch: guest architecture
+ * @virttype: domain virt type
+ * @flags: flags passed to the API
+ * @xmlCPUs: CPU definitions passed to the API
+ * @ncpus: number of elements in @xmlCPUs
+ *
+ * Computes a digest identifying a CPU compare or baseline request so that
+ * its result can be looked up by virQEMUDriverLookupCPUResult.
+ *
+ * Returns: the key or NULL on error
+ */
+char *
+virQEMUDriverCPUResultKey(const char *op,
+                          virQEMUCaps *qemuCaps,
+                          virArch arch,
+                          virDomainVirtType virttype,
+                          unsigned int flags,
+                          const char **xmlCPUs,
+                          unsigned int ncpus)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *str = NULL;
+    char *key = NULL;
+    size_t i;
+
+    virBufferAsprintf(&buf, "%s\n%s\n%s\n%s\n%x\n",
+                      op, virQEMUCapsGetBinary(qemuCaps),
+                      virArchToString(arch),
+                      virDomainVirtTypeToString(virttype),
+                      flags);
+
+    for (i = 0; i < ncpus; i++) {
+        const char *xml = NULLSTR_EMPTY(xmlCPUs[i]);
+
+        virBufferAsprintf(&buf, "%zu\n%s\n", strlen(xml), xml);
+    }
+
+    str = virBufferContentAndReset(&buf);
+
+    if (virCryptoHashString(VIR_CRYPTO_HASH_SHA256, str, &key) < 0)
+        return NULL;
+
+    return key;
+}
+
+
+/**
+ * virQEMUDriverLookupCPUResult:
+ * @driver: QEMU driver
+ * @key: key returned by virQEMUDriverCPUResultKey
+ * @qemuCaps: current QEMU capabilities
+ * @result: filled in with the cached compare result
+ * @xml: filled in with a copy of the cached CPU definition
+ *
+ * Results computed from different capabilities than @qemuCaps, that is
+ * before the capabilities were refreshed, are dropped from the cache.
+ *
+ * Returns: true if a result was found, false otherwise
+ */
+bool
+virQEMUDriverLookupCPUResult(virQEMUDriver *driver,
+                             const char *key,
+                             virQEMUCaps *qemuCaps,
+                             int *result,
+                             char **xml)
+{
+    qemuCPUResult *res;
+    bool found = false;
+
+    qemuDriverLock(driver);
+    if (driver->cpuResults &&
+        (res = g_hash_table_lookup(driver->cpuResults, key))) {
+        if (res->qemuCaps == qemuCaps) {
+            if (result)
+                *result = res->result;
+            if (xml)
+                *xml = g_strdup(res->xml);
+            found = true;
+        } else {
+            g_hash_table_remove(driver->cpuResults, key);
+        }
+    }
+    qemuDriverUnlock(driver);
+
+    return found;
+}
+
+
+void
+virQEMUDriverCacheCPUResult(virQEMUDriver *driver,
+                            const char *key,
+                            virQEMUCaps *qemuCaps,
+                            int result,
+                            const char *xml)
+{
+    qemuCPUResult *res = g_new0(qemuCPUResult, 1);
+
+    res->qemuCaps = virObjectRef(qemuCaps);
+    res->result = result;
+    res->xml = g_strdup(xml);
+
+    qemuDriverLock(driver);
+    if (!driver->cpuResults) {
+        driver->cpuResults = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   g_free, qemuCPUResultFree);
+    }
+
+    /* Stale entries are only dropped when looked up, keep the cache bounded */
+    if (g_hash_table_size(driver->cpuResults) >= QEMU_CPU_RESULT_CACHE_MAX)
+        g_hash_table_remove_all(driver->cpuResults);
+
+    g_hash_table_replace(driver->cpuResults, g_strdup(key), res);
+    qemuDriverUnlock(driver);
+}
+
+
 struct _qemuSharedDeviceEntry {
     size_t ref;
     char **domains; /* array of domain names */
@@ -44,6 +44,7 @@
 #include "locking/lock_manager.h"
 #include "qemu_capabilities.h"
 #include "virclosecallbacks.h"
+#include "domain_driver.h"
 #include "virhostdev.h"
 #include "virfile.h"
 #include "virfilecache.h"
@@ -53,6 +54,16 @@
 
 typedef struct _virQEMUDriver virQEMUDriver;
 
+typedef struct _qemuStatsPush qemuStatsPush;
+
+typedef struct _qemuMigrationSched qemuMigrationSched;
+
+typedef struct _qemuBlockJobSched qemuBlockJobSched;
+
+typedef struct _qemuStatusWriter qemuStatusWriter;
+
+typedef struct _qemuFirmwareCache qemuFirmwareCache;
+
 typedef struct _virQEMUDriverConfig virQEMUDriverConfig;
 
 /* Main driver config. The data in these object
@@ -76,6 +87,7 @@ struct _virQEMUDriverConfig {
     bool dynamicOwnership;
 
     virBitmap *namespaces;
+    bool namespaceHelper;
     bool rememberOwner;
 
     int cgroupControllers;
@@ -144,6 +156,11 @@ struct _virQEMUDriverConfig {
     bool backupTLSx509verify;
     bool backupTLSx509verifyPresent;
     char *backupTLSx509secretUUID;
+    unsigned int backupNBDMaxConnections;
+
+    unsigned int blockJobPoolBandwidth;
+    unsigned int blockJobPoolMaxConcurrent;
+    unsigned int blockJobLatencyTarget;
 
     bool vxhsTLS;
     char *vxhsTLSx509certdir;
@@ -173,6 +190,8 @@ struct _virQEMUDriverConfig {
     bool vncAllowHostAudio;
     bool nogfxAllowHostAudio;
     bool setProcessName;
+    bool asyncHooks;
+    bool ioAutotune;
 
     unsigned int maxProcesses;
     unsigned int maxFiles;
@@ -181,6 +200,11 @@ struct _virQEMUDriverConfig {
     bool dumpGuestCore;
 
     unsigned int maxQueuedJobs;
+    unsigned int reconnectWorkers;
+    unsigned int statsWorkers;
+    unsigned int statsCacheMaxAge;
+    unsigned int statusSaveInterval;
+    bool compactDomainData;
 
     char **securityDriverNames;
     bool securityDefaultConfined;
@@ -189,6 +213,7 @@ struct _virQEMUDriverConfig {
     char *saveImageFormat;
     char *dumpImageFormat;
     char *snapshotImageFormat;
+    unsigned int saveParallelChannels;
 
     char *autoDumpPath;
     bool autoDumpBypassCache;
@@ -206,6 +231,11 @@ struct _virQEMUDriverConfig {
     char *migrationAddress;
     unsigned int migrationPortMin;
     unsigned int migrationPortMax;
+    unsigned int migrationHostBandwidth;
+    unsigned int migrationMaxConcurrent;
+    unsigned int migrationConvergeIterations;
+    bool migrationConvergePostcopy;
+    unsigned int migrationStorageParallel;
 
     bool logTimestamp;
     bool stdioLogD;
@@ -242,6 +272,31 @@ struct _virQEMUDriver {
     /* Immutable pointer, self-locking APIs */
     virThreadPool *workerPool;
 
+    /* Immutable pointer, self-locking APIs */
+    virThreadPool *reconnectPool;
+
+    /* Immutable pointer, self-locking APIs, NULL if disabled */
+    virThreadPool *statsPool;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuStatsPush *statsPush;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuMigrationSched *migrationSched;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuBlockJobSched *blockjobSched;
+
+    /* Immutable pointer, self-locking APIs */
+    qemuStatusWriter *statusWriter;
+
+    /* Atomic inc/dec only, domains still waiting to be reconnected */
+    int reconnectPending;
+    /* Immutable value, number of domains queued for reconnect */
+    int reconnectTotal;
+    /* Immutable value, when reconnecting started */
+    long long reconnectStart;
+
     /* Atomic increment only */
     int lastvmid;
 
@@ -270,6 +325,13 @@ struct _virQEMUDriver {
      */
     virCaps *caps;
 
+    /* Require lock. The formatted capabilities served by
+     * virConnectGetCapabilities, the state of host resources and the time
+     * they were built at */
+    char *capsXML;
+    char *capsXMLHost;
+    gint64 capsXMLTime;
+
     /* Lazy initialized on first use, immutable thereafter.
      * Require lock to get the pointer & do optional initialization
      */
@@ -284,6 +346,9 @@ struct _virQEMUDriver {
     /* Immutable pointer, self-locking APIs */
     virFileCache *qemuCapsCache;
 
+    /* Immutable pointer, self-locking APIs */
+    qemuFirmwareCache *firmwareCache;
+
     /* Immutable pointer, self-locking APIs */
     virObjectEventState *domainEventState;
 
@@ -295,6 +360,18 @@ struct _virQEMUDriver {
     /* Immutable pointer. Unsafe APIs. XXX */
     GHashTable *sharedDevices;
 
+    /* Immutable pointer. Require lock to access the table,
+     * virConnect -> virDomainDriverStatsCursor mapping */
+    GHashTable *statsCursors;
+
+    /* Lazy initialized on first use. Require lock to access the table,
+     * digest of a CPU compare/baseline request -> cached result */
+    GHashTable *cpuResults;
+
+    /* Lazy initialized on first use. Require lock to access the table,
+     * emulator, arch, virt type and machine -> cached domain capabilities */
+    GHashTable *domainCaps;
+
     /* Immutable pointer, immutable object */
     virPortAllocatorRange *remotePorts;
 
@@ -336,13 +413,43 @@ virCPUDef *virQEMUDriverGetHostCPU(virQEMUDriver *driver);
 virCaps *virQEMUDriverCreateCapabilities(virQEMUDriver *driver);
 virCaps *virQEMUDriverGetCapabilities(virQEMUDriver *driver,
                                         bool refresh);
+char *virQEMUDriverGetCapabilitiesXML(virQEMUDriver *driver);
+
+virDomainDriverStatsCursor *
+virQEMUDriverGetStatsCursor(virQEMUDriver *driver,
+                            virConnectPtr conn);
+void
+virQEMUDriverRemoveStatsCursor(virQEMUDriver *driver,
+                               virConnectPtr conn);
+
+char *
+virQEMUDriverCPUResultKey(const char *op,
+                          virQEMUCaps *qemuCaps,
+                          virArch arch,
+                          virDomainVirtType virttype,
+                          unsigned int flags,
+                          const char **xmlCPUs,
+                          unsigned int ncpus);
+bool
+virQEMUDriverLookupCPUResult(virQEMUDriver *driver,
+                             const char *key,
+                             virQEMUCaps *qemuCaps,
+                             int *result,
+                             char **xml);
+void
+virQEMUDriverCacheCPUResult(virQEMUDriver *driver,
+                            const char *key,
+                            virQEMUCaps *qemuCaps,
+                            int result,
+                            const char *xml);
 
 virDomainCaps *
 virQEMUDriverGetDomainCapabilities(virQEMUDriver *driver,
                                    virQEMUCaps *qemuCaps,
                                    const char *machine,
                                    virArch arch,
-                                   virDomainVirtType virttype);
+                                   virDomainVirtType virttype,
+                                   char **xml);
 
 typedef struct _qemuSharedDeviceEntry qemuSharedDeviceEntry;
 
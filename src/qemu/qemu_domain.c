@@ -33,6 +33,7 @@
 #include "qemu_migration_params.h"
 #include "qemu_security.h"
 #include "qemu_slirp.h"
+#include "qemu_statuswriter.h"
 #include "qemu_extdevice.h"
 #include "qemu_blockjob.h"
 #include "qemu_checkpoint.h"
@@ -57,6 +58,7 @@
 #include "storage_source.h"
 #include "virstring.h"
 #include "virthreadjob.h"
+#include "virthreadpool.h"
 #include "virprocess.h"
 #include "vircrypto.h"
 #include "virrandom.h"
@@ -820,6 +822,7 @@ qemuDomainVcpuPrivateDispose(void *obj)
 
     g_free(priv->type);
     g_free(priv->alias);
+    g_free(priv->qomPath);
     virJSONValueFree(priv->props);
     return;
 }
@@ -1593,6 +1596,79 @@ qemuDomainObjStopWorker(virDomainObj *dom)
 }
 
 
+void
+qemuDomainStatsCacheClear(qemuDomainStatsCache *cache)
+{
+    g_clear_pointer(&cache->blockStats, g_hash_table_unref);
+    cache->blockStamp = 0;
+    cache->nballoon = 0;
+    cache->balloonStamp = 0;
+    g_clear_pointer(&cache->dirtyRate, qemuMonitorDirtyRateInfoFree);
+}
+
+
+void
+qemuDomainXMLCacheClear(qemuDomainXMLCache *cache)
+{
+    size_t i;
+
+    for (i = 0; i < QEMU_DOMAIN_XML_CACHE_SIZE; i++) {
+        g_clear_pointer(&cache->entries[i].xml, g_free);
+        cache->entries[i].flags = 0;
+        cache->entries[i].generation = 0;
+    }
+
+    cache->next = 0;
+}
+
+
+/**
+ * qemuDomainObjReleaseCaches:
+ * @vm: domain object
+ *
+ * Frees the data cached in the private data of @vm which can't be used
+ * anymore once a job ended and bumped the generation of @vm. With
+ * compact_domain_data set in qemu.conf, stale statistics are freed too
+ * rather than kept until they are replaced.
+ */
+void
+qemuDomainObjReleaseCaches(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
+    qemuDomainStatsCache *stats = &priv->statsCache;
+
+    qemuDomainXMLCacheClear(&priv->xmlCache);
+
+    if (!cfg->compactDomainData)
+        return;
+
+    if (stats->blockStats &&
+        !qemuDomainStatsCacheIsFresh(stats->blockStamp, cfg->statsCacheMaxAge)) {
+        g_clear_pointer(&stats->blockStats, g_hash_table_unref);
+        stats->blockStamp = 0;
+    }
+}
+
+
+/**
+ * qemuDomainStatsCacheIsFresh:
+ * @stamp: time the cached data was fetched
+ * @maxAge: stats_cache_max_age from qemu.conf
+ *
+ * Returns true if data fetched at @stamp can still be reported.
+ */
+bool
+qemuDomainStatsCacheIsFresh(unsigned long long stamp,
+                            unsigned int maxAge)
+{
+    if (stamp == 0 || maxAge == 0)
+        return false;
+
+    return g_get_monotonic_time() / 1000 - stamp <= maxAge;
+}
+
+
 /**
  * qemuDomainObjPrivateDataClear:
  * @priv: domain private data
@@ -1603,6 +1679,8 @@ qemuDomainObjStopWorker(virDomainObj *dom)
 void
 qemuDomainObjPrivateDataClear(qemuDomainObjPrivate *priv)
 {
+    g_clear_pointer(&priv->namedNodeData, g_hash_table_unref);
+
     g_strfreev(priv->qemuDevices);
     priv->qemuDevices = NULL;
 
@@ -1623,6 +1701,7 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivate *priv)
     VIR_FREE(priv->channelTargetDir);
 
     priv->memPrealloc = false;
+    priv->prestaged = false;
 
     /* remove automatic pinning data */
     virBitmapFree(priv->autoNodeset);
@@ -1642,6 +1721,7 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivate *priv)
     /* clear previously used namespaces */
     virBitmapFree(priv->namespaces);
     priv->namespaces = NULL;
+    g_clear_pointer(&priv->nsHelper, qemuNamespaceHelperFree);
 
     priv->rememberOwner = false;
 
@@ -1670,6 +1750,9 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivate *priv)
         g_slist_free_full(g_steal_pointer(&priv->dbusVMStateIds), g_free);
 
     priv->dbusVMState = false;
+
+    qemuDomainStatsCacheClear(&priv->statsCache);
+    qemuDomainXMLCacheClear(&priv->xmlCache);
 }
 
 
@@ -2317,6 +2400,8 @@ qemuDomainObjPrivateXMLFormat(virBuffer *buf,
     if (qemuDomainObjPrivateXMLFormatJob(buf, vm) < 0)
         return -1;
 
+    qemuDomainObjPrivateXMLFormatJobLockStats(buf, vm);
+
     if (priv->fakeReboot)
         virBufferAddLit(buf, "<fakereboot/>\n");
 
@@ -2358,6 +2443,9 @@ qemuDomainObjPrivateXMLFormat(virBuffer *buf,
     if (priv->memPrealloc)
         virBufferAddLit(buf, "<memPrealloc/>\n");
 
+    if (priv->prestaged)
+        virBufferAddLit(buf, "<prestaged/>\n");
+
     if (qemuDomainObjPrivateXMLFormatBlockjobs(buf, vm) < 0)
         return -1;
 
@@ -3001,6 +3089,9 @@ qemuDomainObjPrivateXMLParse(xmlXPathContextPtr ctxt,
     if (qemuDomainObjPrivateXMLParseJob(vm, ctxt) < 0)
         goto error;
 
+    if (qemuDomainObjPrivateXMLParseJobLockStats(vm, ctxt) < 0)
+        goto error;
+
     priv->fakeReboot = virXPathBoolean("boolean(./fakereboot)", ctxt) == 1;
 
     if ((n = virXPathNodeSet("./devices/device", ctxt, &nodes)) < 0) {
@@ -3089,6 +3180,7 @@ qemuDomainObjPrivateXMLParse(xmlXPathContextPtr ctxt,
     }
 
     priv->memPrealloc = virXPathBoolean("boolean(./memPrealloc)", ctxt) == 1;
+    priv->prestaged = virXPathBoolean("boolean(./prestaged)", ctxt) == 1;
 
     return 0;
 
@@ -4361,6 +4453,81 @@ qemuDomainDefTPMsPostParse(virDomainDef *def)
 }
 
 
+#define QEMU_DOMAIN_IO_AUTOTUNE_MAX_QUEUES 16
+#define QEMU_DOMAIN_IO_AUTOTUNE_VCPUS_PER_IOTHREAD 4
+
+/**
+ * qemuDomainDefIOAutotune:
+ * @def: domain definition
+ * @qemuCaps: QEMU capabilities
+ *
+ * Implements the 'io_autotune' qemu.conf option. Virtio disks and virtio
+ * interfaces without queues configured get one queue per vCPU. If the
+ * domain has no IOThreads, IOThreads are added and the virtio disks are
+ * spread across them. Everything set explicitly in the XML is kept.
+ *
+ * As the changes are guest visible, this must be used only for new
+ * definitions.
+ */
+static void
+qemuDomainDefIOAutotune(virDomainDef *def,
+                        virQEMUCaps *qemuCaps)
+{
+    unsigned int vcpus = virDomainDefGetVcpus(def);
+    unsigned int queues = MIN(vcpus, QEMU_DOMAIN_IO_AUTOTUNE_MAX_QUEUES);
+    bool addIOThreads = def->niothreadids == 0 &&
+                        virQEMUCapsGet(qemuCaps, QEMU_CAPS_OBJECT_IOTHREAD);
+    g_autoptr(GPtrArray) disks = g_ptr_array_new();
+    size_t niothreads;
+    size_t i;
+
+    for (i = 0; i < def->ndisks; i++) {
+        virDomainDiskDef *disk = def->disks[i];
+
+        if (disk->bus != VIR_DOMAIN_DISK_BUS_VIRTIO ||
+            virStorageSourceGetActualType(disk->src) == VIR_STORAGE_TYPE_VHOST_USER)
+            continue;
+
+        if (disk->queues == 0 && queues > 1 &&
+            virQEMUCapsGet(qemuCaps, QEMU_CAPS_VIRTIO_BLK_NUM_QUEUES))
+            disk->queues = queues;
+
+        if (addIOThreads && disk->iothread == 0)
+            g_ptr_array_add(disks, disk);
+    }
+
+    /* Only tap based interfaces which libvirt creates itself are known to
+     * support multiqueue at this point. The actual type of interfaces of
+     * type 'network' is unknown until the domain is started. */
+    for (i = 0; i < def->nnets; i++) {
+        virDomainNetDef *net = def->nets[i];
+
+        if (net->driver.virtio.queues == 0 && queues > 1 &&
+            virDomainNetIsVirtioModel(net) &&
+            (net->type == VIR_DOMAIN_NET_TYPE_BRIDGE ||
+             net->type == VIR_DOMAIN_NET_TYPE_DIRECT))
+            net->driver.virtio.queues = queues;
+    }
+
+    if (disks->len == 0)
+        return;
+
+    niothreads = MIN(disks->len,
+                     MAX(1, vcpus / QEMU_DOMAIN_IO_AUTOTUNE_VCPUS_PER_IOTHREAD));
+
+    /* The IOThreads aren't pinned, so they follow the emulator placement
+     * which takes the domain's numatune into account. */
+    for (i = 0; i < niothreads; i++)
+        virDomainIOThreadIDAdd(def, i + 1)->autofill = true;
+
+    for (i = 0; i < disks->len; i++) {
+        virDomainDiskDef *disk = g_ptr_array_index(disks, i);
+
+        disk->iothread = (i % niothreads) + 1;
+    }
+}
+
+
 static int
 qemuDomainDefPostParseBasic(virDomainDef *def,
                             void *opaque G_GNUC_UNUSED)
@@ -4441,6 +4608,10 @@ qemuDomainDefPostParse(virDomainDef *def,
     if (qemuDomainDefVcpusPostParse(def) < 0)
         return -1;
 
+    if (cfg->ioAutotune &&
+        (parseFlags & VIR_DOMAIN_DEF_PARSE_ABI_UPDATE))
+        qemuDomainDefIOAutotune(def, qemuCaps);
+
     if (qemuDomainDefCPUPostParse(def, qemuCaps) < 0)
         return -1;
 
@@ -5768,23 +5939,51 @@ virDomainDefParserConfig virQEMUDriverDomainDefParserConfig = {
 };
 
 
+/*
+ * Writes the status of @obj right away. Use this where the status must be
+ * on disk before going on, qemuDomainSaveStatus may defer the write.
+ */
 void
 qemuDomainObjSaveStatus(virQEMUDriver *driver,
                         virDomainObj *obj)
 {
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivate *priv = obj->privateData;
 
     if (virDomainObjIsActive(obj)) {
+        priv->statusDirty = false;
         if (virDomainObjSave(obj, driver->xmlopt, cfg->stateDir) < 0)
             VIR_WARN("Failed to save status on vm %s", obj->def->name);
     }
 }
 
 
+/*
+ * Saves the status of @obj. With status_save_interval set the domain is
+ * only marked dirty and its status is written later by the status writer,
+ * together with any other changes made in the meantime.
+ */
 void
 qemuDomainSaveStatus(virDomainObj *obj)
 {
-    qemuDomainObjSaveStatus(QEMU_DOMAIN_PRIVATE(obj)->driver, obj);
+    qemuDomainObjPrivate *priv = obj->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
+
+    if (!virDomainObjIsActive(obj))
+        return;
+
+    if (cfg->statusSaveInterval > 0) {
+        obj->generation++;
+        priv->statusDirty = true;
+        if (priv->statusQueued)
+            return;
+        if (qemuStatusWriterQueue(priv->driver, obj)) {
+            priv->statusQueued = true;
+            return;
+        }
+    }
+
+    qemuDomainObjSaveStatus(priv->driver, obj);
 }
 
 
@@ -5803,6 +6002,8 @@ qemuDomainSaveConfig(virDomainObj *obj)
     if (!def)
         return;
 
+    obj->generation++;
+
     cfg = virQEMUDriverGetConfig(driver);
 
     if (virDomainDefSave(def, driver->xmlopt, cfg->configDir) < 0)
@@ -5840,7 +6041,8 @@ qemuDomainObjEnterMonitorInternal(virQEMUDriver *driver,
     } else if (priv->job.asyncOwner == virThreadSelfID()) {
         VIR_WARN("This thread seems to be the async job owner; entering"
                  " monitor without asking for a nested job is dangerous");
-    } else if (priv->job.owner != virThreadSelfID()) {
+    } else if (priv->job.owner != virThreadSelfID() &&
+               !(priv->job.active == QEMU_JOB_QUERY && priv->job.nshared > 0)) {
         VIR_WARN("Entering a monitor without owning a job. "
                  "Job %s owner %s (%llu)",
                  qemuDomainJobTypeToString(priv->job.active),
@@ -6060,7 +6262,8 @@ qemuDomainDefFormatBufInternal(virQEMUDriver *driver,
 {
     g_autoptr(virDomainDef) copy = NULL;
 
-    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS | VIR_DOMAIN_XML_UPDATE_CPU, -1);
+    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS | VIR_DOMAIN_XML_UPDATE_CPU |
+                  VIR_DOMAIN_XML_SECTION_FLAGS, -1);
 
     if (!(flags & (VIR_DOMAIN_XML_UPDATE_CPU | VIR_DOMAIN_XML_MIGRATABLE)))
         goto format;
@@ -6296,6 +6499,62 @@ char *qemuDomainFormatXML(virQEMUDriver *driver,
     return qemuDomainDefFormatXMLInternal(driver, priv->qemuCaps, def, origCPU, flags);
 }
 
+
+/**
+ * qemuDomainFormatXMLCached:
+ * @driver: qemu driver
+ * @vm: locked domain object
+ * @flags: VIR_DOMAIN_XML_* flags
+ *
+ * Same as qemuDomainFormatXML, but reuses the XML formatted by an earlier
+ * call with the same @flags if the generation of @vm did not change since.
+ * The cache is bypassed while a job is running on @vm as the definition
+ * may be modified without the generation being bumped until the job ends,
+ * and with compact_domain_data set in qemu.conf.
+ *
+ * Returns the formatted XML which the caller must free, NULL on error.
+ */
+char *
+qemuDomainFormatXMLCached(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          unsigned int flags)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainXMLCache *cache = &priv->xmlCache;
+    qemuDomainXMLCacheEntry *entry;
+    char *xml;
+    size_t i;
+
+    if ((flags & VIR_DOMAIN_XML_UPDATE_CPU) ||
+        cfg->compactDomainData ||
+        priv->job.active != QEMU_JOB_NONE ||
+        priv->job.asyncJob != QEMU_ASYNC_JOB_NONE)
+        return qemuDomainFormatXML(driver, vm, flags);
+
+    for (i = 0; i < QEMU_DOMAIN_XML_CACHE_SIZE; i++) {
+        entry = &cache->entries[i];
+
+        if (entry->xml &&
+            entry->flags == flags &&
+            entry->generation == vm->generation)
+            return g_strdup(entry->xml);
+    }
+
+    if (!(xml = qemuDomainFormatXML(driver, vm, flags)))
+        return NULL;
+
+    entry = &cache->entries[cache->next];
+    cache->next = (cache->next + 1) % QEMU_DOMAIN_XML_CACHE_SIZE;
+
+    g_free(entry->xml);
+    entry->xml = g_strdup(xml);
+    entry->flags = flags;
+    entry->generation = vm->generation;
+
+    return xml;
+}
+
 char *
 qemuDomainDefFormatLive(virQEMUDriver *driver,
                         virQEMUCaps *qemuCaps,
@@ -6805,11 +7064,18 @@ qemuFindQemuImgBinary(virQEMUDriver *driver)
     return driver->qemuImgBinary;
 }
 
+/**
+ * qemuDomainSnapshotWriteMetadataBatch:
+ *
+ * Like qemuDomainSnapshotWriteMetadata, but adds the file to @batch to be
+ * written along with others if @batch is not NULL.
+ */
 int
-qemuDomainSnapshotWriteMetadata(virDomainObj *vm,
-                                virDomainMomentObj *snapshot,
-                                virDomainXMLOption *xmlopt,
-                                const char *snapshotDir)
+qemuDomainSnapshotWriteMetadataBatch(virDomainObj *vm,
+                                     virDomainMomentObj *snapshot,
+                                     virDomainXMLOption *xmlopt,
+                                     const char *snapshotDir,
+                                     virFileRewriteBatch *batch)
 {
     g_autofree char *newxml = NULL;
     g_autofree char *snapDir = NULL;
@@ -6835,7 +7101,18 @@ qemuDomainSnapshotWriteMetadata(virDomainObj *vm,
 
     snapFile = g_strdup_printf("%s/%s.xml", snapDir, def->parent.name);
 
-    return virXMLSaveFile(snapFile, NULL, "snapshot-edit", newxml);
+    return virXMLSaveFileBatch(batch, snapFile, NULL, "snapshot-edit", newxml);
+}
+
+
+int
+qemuDomainSnapshotWriteMetadata(virDomainObj *vm,
+                                virDomainMomentObj *snapshot,
+                                virDomainXMLOption *xmlopt,
+                                const char *snapshotDir)
+{
+    return qemuDomainSnapshotWriteMetadataBatch(vm, snapshot, xmlopt,
+                                                snapshotDir, NULL);
 }
 
 
@@ -7478,6 +7755,141 @@ qemuDomainPrepareStorageSourceConfig(virStorageSource *src,
 }
 
 
+/*
+ * Whether @disksrc is a local image of a format without backing support for
+ * which there is no chain to determine.
+ */
+static bool
+qemuDomainDiskChainIsLocalPlain(virStorageSource *disksrc)
+{
+    return virStorageSourceIsLocalStorage(disksrc) &&
+           disksrc->format > VIR_STORAGE_FILE_NONE &&
+           disksrc->format < VIR_STORAGE_FILE_BACKING;
+}
+
+
+static int
+qemuDomainDiskChainPrepareLocalPlain(virDomainDiskDef *disk,
+                                     virStorageSource *disksrc,
+                                     bool report_broken)
+{
+    if (!virFileExists(disksrc->path)) {
+        if (report_broken)
+            virStorageSourceReportBrokenChain(errno, disksrc, disksrc);
+
+        return -1;
+    }
+
+    /* terminate the chain for such images as the code below would do */
+    if (!disksrc->backingStore)
+        disksrc->backingStore = virStorageSourceNew();
+
+    /* host cdrom requires special treatment in qemu, so we need to check
+     * whether a block device is a cdrom */
+    if (disk->device == VIR_DOMAIN_DISK_DEVICE_CDROM &&
+        disksrc->format == VIR_STORAGE_FILE_RAW &&
+        virStorageSourceIsBlockLocal(disksrc) &&
+        virFileIsCDROM(disksrc->path) == 1)
+        disksrc->hostcdrom = true;
+
+    return 0;
+}
+
+
+/*
+ * Checks that the image @src of the chain of @disksrc, as declared in the
+ * XML, is accessible.
+ */
+static int
+qemuDomainDiskChainCheckLayer(virQEMUDriver *driver,
+                              virDomainObj *vm,
+                              virStorageSource *src,
+                              virStorageSource *disksrc)
+{
+    int rv = virStorageSourceSupportsAccess(src);
+
+    if (rv <= 0)
+        return rv;
+
+    if (qemuDomainStorageFileInit(driver, vm, src, disksrc) < 0)
+        return -1;
+
+    if (virStorageSourceAccess(src, F_OK) < 0) {
+        virStorageSourceReportBrokenChain(errno, src, disksrc);
+        virStorageSourceDeinit(src);
+        return -1;
+    }
+
+    virStorageSourceDeinit(src);
+    return 0;
+}
+
+
+/*
+ * Detects the rest of the chain of @disksrc below @src, the last image
+ * declared in the XML, from the image metadata.
+ */
+static int
+qemuDomainDiskChainDetect(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          virStorageSource *src,
+                          virStorageSource *disksrc,
+                          bool report_broken)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    uid_t uid;
+    gid_t gid;
+
+    qemuDomainGetImageIds(cfg, vm, src, disksrc, &uid, &gid);
+
+    return virStorageSourceGetMetadata(src, uid, gid,
+                                       QEMU_DOMAIN_STORAGE_SOURCE_CHAIN_MAX_DEPTH,
+                                       report_broken);
+}
+
+
+/*
+ * Prepares the images of the chain of @disksrc detected below @detected,
+ * if any, and validates the whole chain.
+ */
+static int
+qemuDomainDiskChainFinish(virQEMUDriver *driver,
+                          virDomainObj *vm,
+                          virDomainDiskDef *disk,
+                          virStorageSource *disksrc,
+                          virStorageSource *detected)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    virStorageSource *n; /* iterator for the backing chain detected from disk */
+    qemuDomainObjPrivate *priv = vm->privateData;
+    bool blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV);
+    bool isSD = qemuDiskBusIsSD(disk->bus);
+
+    for (n = detected ? detected->backingStore : NULL;
+         virStorageSourceIsBacking(n); n = n->backingStore) {
+        /* convert detected ISO format to 'raw' as qemu would not understand it */
+        if (n->format == VIR_STORAGE_FILE_ISO)
+            n->format = VIR_STORAGE_FILE_RAW;
+
+        /* mask-out blockdev for 'sd' disks */
+        if (qemuDomainValidateStorageSource(n, priv->qemuCaps, isSD) < 0)
+            return -1;
+
+        qemuDomainPrepareStorageSourceConfig(n, cfg, priv->qemuCaps);
+        qemuDomainPrepareDiskSourceData(disk, n);
+
+        if (blockdev && !isSD &&
+            qemuDomainPrepareStorageSourceBlockdev(disk, n, priv, cfg) < 0)
+            return -1;
+    }
+
+    if (qemuDomainStorageSourceValidateDepth(disksrc, 0, disk->dst) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 /**
  * qemuDomainDetermineDiskChain:
  * @driver: qemu driver object
@@ -7498,14 +7910,7 @@ qemuDomainDetermineDiskChain(virQEMUDriver *driver,
                              virStorageSource *disksrc,
                              bool report_broken)
 {
-    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     virStorageSource *src; /* iterator for the backing chain declared in XML */
-    virStorageSource *n; /* iterator for the backing chain detected from disk */
-    qemuDomainObjPrivate *priv = vm->privateData;
-    bool blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV);
-    bool isSD = qemuDiskBusIsSD(disk->bus);
-    uid_t uid;
-    gid_t gid;
 
     if (!disksrc)
         disksrc = disk->src;
@@ -7515,94 +7920,293 @@ qemuDomainDetermineDiskChain(virQEMUDriver *driver,
 
     /* There is no need to check the backing chain for disks without backing
      * support */
-    if (virStorageSourceIsLocalStorage(disksrc) &&
-        disksrc->format > VIR_STORAGE_FILE_NONE &&
-        disksrc->format < VIR_STORAGE_FILE_BACKING) {
-
-        if (!virFileExists(disksrc->path)) {
-            if (report_broken)
-                virStorageSourceReportBrokenChain(errno, disksrc, disksrc);
+    if (qemuDomainDiskChainIsLocalPlain(disksrc))
+        return qemuDomainDiskChainPrepareLocalPlain(disk, disksrc, report_broken);
 
+    src = disksrc;
+    /* skip to the end of the chain if there is any */
+    while (virStorageSourceHasBacking(src)) {
+        if (report_broken &&
+            qemuDomainDiskChainCheckLayer(driver, vm, src, disksrc) < 0)
             return -1;
-        }
 
-        /* terminate the chain for such images as the code below would do */
-        if (!disksrc->backingStore)
-            disksrc->backingStore = virStorageSourceNew();
+        src = src->backingStore;
+    }
 
-        /* host cdrom requires special treatment in qemu, so we need to check
-         * whether a block device is a cdrom */
-        if (disk->device == VIR_DOMAIN_DISK_DEVICE_CDROM &&
-            disksrc->format == VIR_STORAGE_FILE_RAW &&
-            virStorageSourceIsBlockLocal(disksrc) &&
-            virFileIsCDROM(disksrc->path) == 1)
-            disksrc->hostcdrom = true;
+    /* We skipped to the end of the chain. Skip detection if there's the
+     * terminator. (An allocated but empty backingStore) */
+    if (src->backingStore)
+        return qemuDomainDiskChainFinish(driver, vm, disk, disksrc, NULL);
 
-        return 0;
+    if (qemuDomainDiskChainDetect(driver, vm, src, disksrc, report_broken) < 0)
+        return -1;
+
+    return qemuDomainDiskChainFinish(driver, vm, disk, disksrc, src);
+}
+
+
+/* Upper limit of threads used by qemuDomainDetermineDiskChains */
+#define QEMU_DOMAIN_DISK_CHAIN_WORKERS 8
+
+typedef enum {
+    QEMU_DOMAIN_DISK_CHAIN_STEP_LOCAL_PLAIN,
+    QEMU_DOMAIN_DISK_CHAIN_STEP_CHECK,
+    QEMU_DOMAIN_DISK_CHAIN_STEP_DETECT,
+} qemuDomainDiskChainStepType;
+
+typedef struct _qemuDomainDiskChainCtx qemuDomainDiskChainCtx;
+struct _qemuDomainDiskChainCtx {
+    virQEMUDriver *driver;
+    virDomainObj *vm;
+    bool report_broken;
+
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+typedef struct _qemuDomainDiskChainStep qemuDomainDiskChainStep;
+struct _qemuDomainDiskChainStep {
+    qemuDomainDiskChainStepType type;
+    size_t idx;                 /* index of the disk in the array */
+    virDomainDiskDef *disk;
+    virStorageSource *src;      /* image the step works on */
+
+    int rc;
+    virErrorPtr error;
+};
+
+
+static void
+qemuDomainDiskChainStepFree(qemuDomainDiskChainStep *step)
+{
+    if (!step)
+        return;
+
+    virFreeError(step->error);
+    g_free(step);
+}
+
+
+static void
+qemuDomainDiskChainStepRun(qemuDomainDiskChainStep *step,
+                           qemuDomainDiskChainCtx *ctx)
+{
+    switch (step->type) {
+    case QEMU_DOMAIN_DISK_CHAIN_STEP_LOCAL_PLAIN:
+        step->rc = qemuDomainDiskChainPrepareLocalPlain(step->disk, step->src,
+                                                        ctx->report_broken);
+        break;
+
+    case QEMU_DOMAIN_DISK_CHAIN_STEP_CHECK:
+        step->rc = qemuDomainDiskChainCheckLayer(ctx->driver, ctx->vm,
+                                                 step->src, step->disk->src);
+        break;
+
+    case QEMU_DOMAIN_DISK_CHAIN_STEP_DETECT:
+        step->rc = qemuDomainDiskChainDetect(ctx->driver, ctx->vm, step->src,
+                                             step->disk->src,
+                                             ctx->report_broken);
+        break;
     }
 
-    src = disksrc;
-    /* skip to the end of the chain if there is any */
-    while (virStorageSourceHasBacking(src)) {
-        if (report_broken) {
-            int rv = virStorageSourceSupportsAccess(src);
+    if (step->rc < 0)
+        virErrorPreserveLast(&step->error);
+}
 
-            if (rv < 0)
-                return -1;
 
-            if (rv > 0) {
-                if (qemuDomainStorageFileInit(driver, vm, src, disksrc) < 0)
-                    return -1;
+static void
+qemuDomainDiskChainWorker(void *jobdata,
+                          void *opaque)
+{
+    qemuDomainDiskChainStep *step = jobdata;
+    qemuDomainDiskChainCtx *ctx = opaque;
 
-                if (virStorageSourceAccess(src, F_OK) < 0) {
-                    virStorageSourceReportBrokenChain(errno, src, disksrc);
-                    virStorageSourceDeinit(src);
-                    return -1;
-                }
+    qemuDomainDiskChainStepRun(step, ctx);
 
-                virStorageSourceDeinit(src);
-            }
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+static void
+qemuDomainDiskChainRunSteps(qemuDomainDiskChainCtx *ctx,
+                            GPtrArray *steps)
+{
+    virThreadPool *pool = NULL;
+    size_t nworkers = MIN(steps->len, QEMU_DOMAIN_DISK_CHAIN_WORKERS);
+    size_t i;
+
+    if (nworkers > 1 &&
+        virMutexInit(&ctx->lock) == 0) {
+        if (virCondInit(&ctx->cond) == 0) {
+            pool = virThreadPoolNewFull(0, nworkers, 0,
+                                        qemuDomainDiskChainWorker,
+                                        "qemu-disk-chain", NULL, ctx);
+            if (!pool)
+                virCondDestroy(&ctx->cond);
         }
-        src = src->backingStore;
+        if (!pool)
+            virMutexDestroy(&ctx->lock);
     }
 
-    /* We skipped to the end of the chain. Skip detection if there's the
-     * terminator. (An allocated but empty backingStore) */
-    if (src->backingStore) {
-        if (qemuDomainStorageSourceValidateDepth(disksrc, 0, disk->dst) < 0)
-            return -1;
+    if (!pool) {
+        /* Fall back to running the steps in this thread */
+        virResetLastError();
+        for (i = 0; i < steps->len; i++)
+            qemuDomainDiskChainStepRun(g_ptr_array_index(steps, i), ctx);
+        return;
+    }
 
-        return 0;
+    VIR_DEBUG("Determining disk chains of domain '%s' in %u steps using %zu workers",
+              ctx->vm->def->name, steps->len, nworkers);
+
+    for (i = 0; i < steps->len; i++) {
+        qemuDomainDiskChainStep *step = g_ptr_array_index(steps, i);
+
+        virMutexLock(&ctx->lock);
+        ctx->pending++;
+        virMutexUnlock(&ctx->lock);
+
+        if (virThreadPoolSendJob(pool, 0, step) < 0) {
+            virMutexLock(&ctx->lock);
+            ctx->pending--;
+            virMutexUnlock(&ctx->lock);
+
+            virResetLastError();
+            qemuDomainDiskChainStepRun(step, ctx);
+        }
     }
 
-    qemuDomainGetImageIds(cfg, vm, src, disksrc, &uid, &gid);
+    virMutexLock(&ctx->lock);
+    while (ctx->pending > 0) {
+        if (virCondWait(&ctx->cond, &ctx->lock) < 0) {
+            VIR_WARN("Failed to wait for disk chains to be determined");
+            break;
+        }
+    }
+    virMutexUnlock(&ctx->lock);
 
-    if (virStorageSourceGetMetadata(src, uid, gid,
-                                    QEMU_DOMAIN_STORAGE_SOURCE_CHAIN_MAX_DEPTH,
-                                    report_broken) < 0)
-        return -1;
+    /* Waits for any worker still running */
+    virThreadPoolFree(pool);
+    virCondDestroy(&ctx->cond);
+    virMutexDestroy(&ctx->lock);
+}
 
-    for (n = src->backingStore; virStorageSourceIsBacking(n); n = n->backingStore) {
-        /* convert detected ISO format to 'raw' as qemu would not understand it */
-        if (n->format == VIR_STORAGE_FILE_ISO)
-            n->format = VIR_STORAGE_FILE_RAW;
 
-        /* mask-out blockdev for 'sd' disks */
-        if (qemuDomainValidateStorageSource(n, priv->qemuCaps, isSD) < 0)
-            return -1;
+/**
+ * qemuDomainDetermineDiskChains:
+ * @driver: qemu driver object
+ * @vm: domain object
+ * @disks: disks to determine the chains of
+ * @ndisks: number of disks in @disks
+ * @report_broken: report broken chains verbosely
+ * @rcs: array of @ndisks results to fill in
+ * @errors: array of @ndisks errors to fill in
+ *
+ * Does the same as qemuDomainDetermineDiskChain for the source of each disk
+ * in @disks. The accessibility checks of the images declared in the XML and
+ * the detection of the rest of the chains, which may take a while with
+ * network storage, are all done in parallel. Everything which modifies the
+ * domain, such as allocating the IDs of detected images, is then done in this
+ * thread in the order of @disks.
+ *
+ * The result of determining the chain of disks[i], 0 on success and -1 on
+ * failure, is stored in rcs[i] and the error it failed with in errors[i].
+ * The caller must free the errors.
+ */
+void
+qemuDomainDetermineDiskChains(virQEMUDriver *driver,
+                              virDomainObj *vm,
+                              virDomainDiskDef **disks,
+                              size_t ndisks,
+                              bool report_broken,
+                              int *rcs,
+                              virErrorPtr *errors)
+{
+    qemuDomainDiskChainCtx ctx = {
+        .driver = driver,
+        .vm = vm,
+        .report_broken = report_broken,
+    };
+    g_autoptr(GPtrArray) steps = NULL;
+    g_autofree virStorageSource **detected = g_new0(virStorageSource *, ndisks);
+    size_t i;
 
-        qemuDomainPrepareStorageSourceConfig(n, cfg, priv->qemuCaps);
-        qemuDomainPrepareDiskSourceData(disk, n);
+    steps = g_ptr_array_new_with_free_func((GDestroyNotify) qemuDomainDiskChainStepFree);
 
-        if (blockdev && !isSD &&
-            qemuDomainPrepareStorageSourceBlockdev(disk, n, priv, cfg) < 0)
-            return -1;
+    for (i = 0; i < ndisks; i++) {
+        virDomainDiskDef *disk = disks[i];
+        virStorageSource *src = disk->src;
+        qemuDomainDiskChainStep *step;
+
+        rcs[i] = 0;
+        errors[i] = NULL;
+
+        if (virStorageSourceIsEmpty(src))
+            continue;
+
+        if (qemuDomainDiskChainIsLocalPlain(src)) {
+            step = g_new0(qemuDomainDiskChainStep, 1);
+            step->type = QEMU_DOMAIN_DISK_CHAIN_STEP_LOCAL_PLAIN;
+            step->idx = i;
+            step->disk = disk;
+            step->src = src;
+            g_ptr_array_add(steps, step);
+            continue;
+        }
+
+        for (; virStorageSourceHasBacking(src); src = src->backingStore) {
+            if (!report_broken)
+                continue;
+
+            step = g_new0(qemuDomainDiskChainStep, 1);
+            step->type = QEMU_DOMAIN_DISK_CHAIN_STEP_CHECK;
+            step->idx = i;
+            step->disk = disk;
+            step->src = src;
+            g_ptr_array_add(steps, step);
+        }
+
+        if (src->backingStore)
+            continue;
+
+        step = g_new0(qemuDomainDiskChainStep, 1);
+        step->type = QEMU_DOMAIN_DISK_CHAIN_STEP_DETECT;
+        step->idx = i;
+        step->disk = disk;
+        step->src = src;
+        g_ptr_array_add(steps, step);
+        detected[i] = src;
     }
 
-    if (qemuDomainStorageSourceValidateDepth(disksrc, 0, disk->dst) < 0)
-        return -1;
+    qemuDomainDiskChainRunSteps(&ctx, steps);
 
-    return 0;
+    /* The steps of each disk are in chain order, report the first failure
+     * like qemuDomainDetermineDiskChain would */
+    for (i = 0; i < steps->len; i++) {
+        qemuDomainDiskChainStep *step = g_ptr_array_index(steps, i);
+
+        if (step->rc < 0 && rcs[step->idx] == 0) {
+            rcs[step->idx] = -1;
+            errors[step->idx] = g_steal_pointer(&step->error);
+        }
+    }
+
+    for (i = 0; i < ndisks; i++) {
+        virDomainDiskDef *disk = disks[i];
+
+        if (rcs[i] < 0 ||
+            virStorageSourceIsEmpty(disk->src) ||
+            qemuDomainDiskChainIsLocalPlain(disk->src))
+            continue;
+
+        if ((rcs[i] = qemuDomainDiskChainFinish(driver, vm, disk, disk->src,
+                                                detected[i])) < 0)
+            virErrorPreserveLast(&errors[i]);
+    }
 }
 
 
@@ -9030,8 +9634,14 @@ qemuDomainUpdateCurrentMemorySize(virDomainObj *vm)
 
     /* if no balloning is available, the current size equals to the current
      * full memory size */
-    if (!virDomainDefHasMemballoon(vm->def))
-        vm->def->mem.cur_balloon = virDomainDefGetMemoryTotal(vm->def);
+    if (!virDomainDefHasMemballoon(vm->def)) {
+        unsigned long long total = virDomainDefGetMemoryTotal(vm->def);
+
+        if (vm->def->mem.cur_balloon != total) {
+            vm->def->mem.cur_balloon = total;
+            vm->generation++;
+        }
+    }
 }
 
 
@@ -9554,6 +10164,8 @@ qemuDomainRefreshVcpuInfo(virQEMUDriver *driver,
         vcpupriv->type = g_steal_pointer(&info[i].type);
         VIR_FREE(vcpupriv->alias);
         vcpupriv->alias = g_steal_pointer(&info[i].alias);
+        VIR_FREE(vcpupriv->qomPath);
+        vcpupriv->qomPath = g_steal_pointer(&info[i].thread_qom_path);
         virJSONValueFree(vcpupriv->props);
         vcpupriv->props = g_steal_pointer(&info[i].props);
         vcpupriv->enable_id = info[i].id;
@@ -10895,6 +11507,7 @@ qemuProcessEventFree(struct qemuProcessEvent *event)
         qemuMonitorMemoryDeviceSizeChangeFree(event->data);
         break;
     case QEMU_PROCESS_EVENT_PR_DISCONNECT:
+    case QEMU_PROCESS_EVENT_BLOCKJOB_SCHED:
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
@@ -101,6 +101,50 @@ struct _qemuDomainSecretInfo {
     char *ciphertext; /* encoded/encrypted secret */
 };
 
+/* Results of monitor queries done for domain statistics, shared by
+ * callers asking for statistics within stats_cache_max_age. */
+typedef struct _qemuDomainStatsCache qemuDomainStatsCache;
+struct _qemuDomainStatsCache {
+    /* monotonic time in ms when the data was fetched, 0 if not cached */
+    unsigned long long blockStamp;
+    GHashTable *blockStats;
+
+    unsigned long long balloonStamp;
+    virDomainMemoryStatStruct balloon[VIR_DOMAIN_MEMORY_STAT_NR];
+    int nballoon;
+
+    /* result of the last completed dirty rate calculation, valid until
+     * another one is started */
+    qemuMonitorDirtyRateInfo *dirtyRate;
+};
+
+void qemuDomainStatsCacheClear(qemuDomainStatsCache *cache);
+bool qemuDomainStatsCacheIsFresh(unsigned long long stamp,
+                                 unsigned int maxAge);
+
+/* Domain XML formatted for virDomainGetXMLDesc, valid as long as the
+ * domain object generation did not change. */
+#define QEMU_DOMAIN_XML_CACHE_SIZE 4
+
+typedef struct _qemuDomainXMLCacheEntry qemuDomainXMLCacheEntry;
+struct _qemuDomainXMLCacheEntry {
+    unsigned int flags;
+    unsigned long long generation;
+    char *xml;
+};
+
+typedef struct _qemuDomainXMLCache qemuDomainXMLCache;
+struct _qemuDomainXMLCache {
+    qemuDomainXMLCacheEntry entries[QEMU_DOMAIN_XML_CACHE_SIZE];
+    size_t next; /* entry to be replaced on the next miss */
+};
+
+void qemuDomainXMLCacheClear(qemuDomainXMLCache *cache);
+
+void qemuDomainObjReleaseCaches(virDomainObj *vm);
+
+typedef struct _qemuNamespaceHelper qemuNamespaceHelper;
+
 typedef struct _qemuDomainObjPrivate qemuDomainObjPrivate;
 struct _qemuDomainObjPrivate {
     virQEMUDriver *driver;
@@ -108,6 +152,8 @@ struct _qemuDomainObjPrivate {
     qemuDomainJobObj job;
 
     virBitmap *namespaces;
+    /* helper process modifying the mount namespace, see qemu_namespace.c */
+    qemuNamespaceHelper *nsHelper;
 
     virEventThread *eventThread;
 
@@ -223,8 +269,32 @@ struct _qemuDomainObjPrivate {
     /* true if global -mem-prealloc appears on cmd line */
     bool memPrealloc;
 
+    /* true if the domain was started to wait for an incoming migration
+     * which did not begin yet (VIR_DOMAIN_START_INCOMING) */
+    bool prestaged;
+
+    /* monitor events waiting to be processed and whether the domain is
+     * queued in the worker pool to process them, both protected by the
+     * lock in qemuProcessEventSubmit */
+    GQueue events;
+    bool eventsScheduled;
+
+    /* status changed since it was last written and the domain is queued
+     * to have it written by the status writer (status_save_interval) */
+    bool statusDirty;
+    bool statusQueued;
+
     /* running block jobs */
     GHashTable *blockjobs;
+    /* nesting of batches of block job updates and whether the status needs
+     * to be saved when the outermost one ends */
+    unsigned int blockjobsBatch;
+    bool blockjobsBatchSave;
+
+    /* parsed reply of query-named-block-nodes reused by nested operations
+     * within a job, see qemuBlockGetNamedNodeData */
+    GHashTable *namedNodeData;
+    unsigned long long namedNodeDataGeneration;
 
     bool disableSlirp;
 
@@ -243,6 +313,14 @@ struct _qemuDomainObjPrivate {
     GSList *dbusVMStateIds;
     /* true if -object dbus-vmstate was added */
     bool dbusVMState;
+
+    qemuDomainStatsCache statsCache;
+    qemuDomainXMLCache xmlCache;
+
+    /* monotonic time in us when the current start phase began and
+     * durations in us of the phases of the most recent start */
+    unsigned long long startPhaseMark;
+    unsigned long long startPhases[QEMU_DOMAIN_START_PHASE_LAST];
 };
 
 #define QEMU_DOMAIN_PRIVATE(vm) \
@@ -272,6 +350,10 @@ struct _qemuDomainDiskPrivate {
 
     bool transientOverlayCreated; /* the overlay image of a transient disk was
                                      created and the definition was updated */
+
+    /* guest I/O counters last sampled by the block job scheduler */
+    unsigned long long schedIOTime;
+    unsigned long long schedIOReqs;
 };
 
 #define QEMU_DOMAIN_STORAGE_SOURCE_PRIVATE(src) \
@@ -306,6 +388,7 @@ struct _qemuDomainVcpuPrivate {
     int enable_id; /* order in which the vcpus were enabled in qemu */
     int qemu_id; /* ID reported by qemu as 'CPU' in query-cpus */
     char *alias;
+    char *qomPath; /* qom path of the vcpu thread object */
     virTristateBool halted;
 
     /* copy of the data that qemu returned */
@@ -401,6 +484,7 @@ typedef enum {
     QEMU_PROCESS_EVENT_RDMA_GID_STATUS_CHANGED,
     QEMU_PROCESS_EVENT_GUEST_CRASHLOADED,
     QEMU_PROCESS_EVENT_MEMORY_DEVICE_SIZE_CHANGE,
+    QEMU_PROCESS_EVENT_BLOCKJOB_SCHED,
 
     QEMU_PROCESS_EVENT_LAST
 } qemuProcessEventType;
@@ -529,6 +613,10 @@ char *qemuDomainFormatXML(virQEMUDriver *driver,
                           virDomainObj *vm,
                           unsigned int flags);
 
+char *qemuDomainFormatXMLCached(virQEMUDriver *driver,
+                                virDomainObj *vm,
+                                unsigned int flags);
+
 char *qemuDomainDefFormatLive(virQEMUDriver *driver,
                               virQEMUCaps *qemuCaps,
                               virDomainDef *def,
@@ -597,6 +685,11 @@ int qemuDomainSnapshotWriteMetadata(virDomainObj *vm,
                                     virDomainMomentObj *snapshot,
                                     virDomainXMLOption *xmlopt,
                                     const char *snapshotDir);
+int qemuDomainSnapshotWriteMetadataBatch(virDomainObj *vm,
+                                         virDomainMomentObj *snapshot,
+                                         virDomainXMLOption *xmlopt,
+                                         const char *snapshotDir,
+                                         virFileRewriteBatch *batch);
 
 int qemuDomainSnapshotForEachQcow2(virQEMUDriver *driver,
                                    virDomainDef *def,
@@ -655,6 +748,14 @@ int qemuDomainDetermineDiskChain(virQEMUDriver *driver,
                                  virStorageSource *disksrc,
                                  bool report_broken);
 
+void qemuDomainDetermineDiskChains(virQEMUDriver *driver,
+                                   virDomainObj *vm,
+                                   virDomainDiskDef **disks,
+                                   size_t ndisks,
+                                   bool report_broken,
+                                   int *rcs,
+                                   virErrorPtr *errors);
+
 bool qemuDomainDiskChangeSupported(virDomainDiskDef *disk,
                                    virDomainDiskDef *orig_disk);
 
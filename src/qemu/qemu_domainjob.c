@@ -26,6 +26,11 @@
 #include "virerror.h"
 #include "virtime.h"
 #include "virthreadjob.h"
+#include "virprobe.h"
+
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -63,6 +68,32 @@ VIR_ENUM_IMPL(qemuDomainAsyncJob,
               "backup",
 );
 
+/* Upper bounds in milliseconds of all but the last histogram bucket */
+static const unsigned long long
+qemuDomainJobLockHistBounds[QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS - 1] = {
+    1, 10, 100, 1000, 10000,
+};
+
+static const char *
+qemuDomainJobLockHistNames[QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS] = {
+    "1ms", "10ms", "100ms", "1s", "10s", "inf",
+};
+
+VIR_ENUM_IMPL(qemuDomainStartPhase,
+              QEMU_DOMAIN_START_PHASE_LAST,
+              "init",
+              "prepare_domain",
+              "prepare_host",
+              "commandline",
+              "spawn",
+              "namespace",
+              "cgroup",
+              "label",
+              "monitor",
+              "setup",
+              "finish",
+);
+
 const char *
 qemuDomainAsyncJobPhaseToString(qemuDomainAsyncJob job,
                                 int phase G_GNUC_UNUSED)
@@ -192,6 +223,7 @@ qemuDomainObjResetJob(qemuDomainJobObj *job)
     job->owner = 0;
     g_clear_pointer(&job->ownerAPI, g_free);
     job->started = 0;
+    job->nshared = 0;
 }
 
 
@@ -376,6 +408,7 @@ qemuDomainJobInfoToInfo(qemuDomainJobInfo *jobInfo,
         info->fileRemaining = info->fileTotal - info->fileProcessed;
         break;
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         break;
     }
@@ -665,6 +698,126 @@ qemuDomainBackupJobInfoToParams(qemuDomainJobInfo *jobInfo,
 }
 
 
+static int
+qemuDomainStartJobInfoToParams(qemuDomainJobInfo *jobInfo,
+                               int *type,
+                               virTypedParameterPtr *params,
+                               int *nparams)
+{
+    qemuDomainStartStats *stats = &jobInfo->stats.start;
+    g_autoptr(virTypedParamList) par = g_new0(virTypedParamList, 1);
+    size_t i;
+
+    if (virTypedParamListAddInt(par, jobInfo->operation,
+                                VIR_DOMAIN_JOB_OPERATION) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(par, jobInfo->timeElapsed,
+                                   VIR_DOMAIN_JOB_TIME_ELAPSED) < 0)
+        return -1;
+
+    for (i = 0; i < QEMU_DOMAIN_START_PHASE_LAST; i++) {
+        if (virTypedParamListAddULLong(par, stats->phases[i],
+                                       VIR_DOMAIN_JOB_START_PHASE_PREFIX "%s",
+                                       qemuDomainStartPhaseTypeToString(i)) < 0)
+            return -1;
+    }
+
+    if (jobInfo->status != QEMU_DOMAIN_JOB_STATUS_ACTIVE &&
+        virTypedParamListAddBoolean(par,
+                                    jobInfo->status == QEMU_DOMAIN_JOB_STATUS_COMPLETED,
+                                    VIR_DOMAIN_JOB_SUCCESS) < 0)
+        return -1;
+
+    *nparams = virTypedParamListStealParams(par, params);
+    *type = qemuDomainJobStatusToType(jobInfo->status);
+    return 0;
+}
+
+
+static int
+qemuDomainJobLockStatsAddParams(virTypedParamList *par,
+                                qemuDomainJobLockStats *stats,
+                                const char *name)
+{
+    g_autofree char *prefix = g_strdup_printf(VIR_DOMAIN_JOB_LOCK_PREFIX "%s", name);
+    size_t i;
+
+    g_strdelimit(prefix, " ", '_');
+
+    if (virTypedParamListAddULLong(par, stats->count, "%s_count", prefix) < 0 ||
+        virTypedParamListAddULLong(par, stats->waiting, "%s_waiting", prefix) < 0 ||
+        virTypedParamListAddULLong(par, stats->waitTotal, "%s_wait_total", prefix) < 0 ||
+        virTypedParamListAddULLong(par, stats->waitMax, "%s_wait_max", prefix) < 0 ||
+        virTypedParamListAddULLong(par, stats->holdTotal, "%s_hold_total", prefix) < 0 ||
+        virTypedParamListAddULLong(par, stats->holdMax, "%s_hold_max", prefix) < 0)
+        return -1;
+
+    for (i = 0; i < QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS; i++) {
+        if (virTypedParamListAddULLong(par, stats->waitHist[i], "%s_wait_hist_%s",
+                                       prefix, qemuDomainJobLockHistNames[i]) < 0 ||
+            virTypedParamListAddULLong(par, stats->holdHist[i], "%s_hold_hist_%s",
+                                       prefix, qemuDomainJobLockHistNames[i]) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * qemuDomainJobLockStatsToParams:
+ * @job: job object of a domain
+ * @params: filled with the statistics
+ * @nparams: filled with the number of items in @params
+ *
+ * Converts statistics of waiting for and holding jobs into typed
+ * parameters for virDomainGetJobStats with VIR_DOMAIN_JOB_STATS_LOCK.
+ * Job types which were never used are skipped.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuDomainJobLockStatsToParams(qemuDomainJobObj *job,
+                               virTypedParameterPtr *params,
+                               int *nparams)
+{
+    g_autoptr(virTypedParamList) par = g_new0(virTypedParamList, 1);
+    size_t i;
+
+    for (i = QEMU_JOB_NONE + 1; i < QEMU_JOB_LAST; i++) {
+        qemuDomainJobLockStats *stats = &job->lockStats[i];
+
+        /* accounted per async job type below */
+        if (i == QEMU_JOB_ASYNC)
+            continue;
+
+        if (stats->count == 0 && stats->waiting == 0)
+            continue;
+
+        if (qemuDomainJobLockStatsAddParams(par, stats,
+                                            qemuDomainJobTypeToString(i)) < 0)
+            return -1;
+    }
+
+    for (i = QEMU_ASYNC_JOB_NONE + 1; i < QEMU_ASYNC_JOB_LAST; i++) {
+        qemuDomainJobLockStats *stats = &job->asyncLockStats[i];
+        g_autofree char *name = NULL;
+
+        if (stats->count == 0 && stats->waiting == 0)
+            continue;
+
+        name = g_strdup_printf("async %s", qemuDomainAsyncJobTypeToString(i));
+
+        if (qemuDomainJobLockStatsAddParams(par, stats, name) < 0)
+            return -1;
+    }
+
+    *nparams = virTypedParamListStealParams(par, params);
+    return 0;
+}
+
+
 int
 qemuDomainJobInfoToParams(qemuDomainJobInfo *jobInfo,
                           int *type,
@@ -682,6 +835,9 @@ qemuDomainJobInfoToParams(qemuDomainJobInfo *jobInfo,
     case QEMU_DOMAIN_JOB_STATS_TYPE_BACKUP:
         return qemuDomainBackupJobInfoToParams(jobInfo, type, params, nparams);
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
+        return qemuDomainStartJobInfoToParams(jobInfo, type, params, nparams);
+
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("invalid job statistics type"));
@@ -744,6 +900,8 @@ qemuDomainObjDiscardAsyncJob(virQEMUDriver *driver, virDomainObj *obj)
     if (priv->job.active == QEMU_JOB_ASYNC_NESTED)
         qemuDomainObjResetJob(&priv->job);
     qemuDomainObjResetAsyncJob(&priv->job);
+    obj->generation++;
+    qemuDomainObjReleaseCaches(obj);
     qemuDomainObjSaveStatus(driver, obj);
 }
 
@@ -788,6 +946,56 @@ qemuDomainObjCanSetJob(qemuDomainJobObj *job,
              job->agentActive == QEMU_AGENT_JOB_NONE));
 }
 
+static qemuDomainJobLockStats *
+qemuDomainJobGetLockStats(qemuDomainJobObj *job,
+                          qemuDomainJob type,
+                          qemuDomainAsyncJob asyncType)
+{
+    if (type == QEMU_JOB_ASYNC)
+        return &job->asyncLockStats[asyncType];
+
+    /* agent only jobs are not accounted */
+    if (type == QEMU_JOB_NONE)
+        return NULL;
+
+    return &job->lockStats[type];
+}
+
+
+static void
+qemuDomainJobLockStatsAdd(unsigned long long *hist,
+                          unsigned long long *total,
+                          unsigned long long *max,
+                          unsigned long long ms)
+{
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(qemuDomainJobLockHistBounds); i++) {
+        if (ms <= qemuDomainJobLockHistBounds[i])
+            break;
+    }
+
+    hist[i]++;
+    *total += ms;
+    if (ms > *max)
+        *max = ms;
+}
+
+/* Query jobs don't change any state and the monitor handles several
+ * commands in flight, so a query job can join one which is already running.
+ * To keep writers from starving, no new query joins while any other job is
+ * waiting for the current one to finish. */
+static bool
+qemuDomainObjCanShareJob(qemuDomainJobObj *job,
+                         qemuDomainJob newJob,
+                         qemuDomainAgentJob newAgentJob)
+{
+    return newJob == QEMU_JOB_QUERY &&
+           newAgentJob == QEMU_AGENT_JOB_NONE &&
+           job->active == QEMU_JOB_QUERY &&
+           job->nwriters == 0;
+}
+
 /* Give up waiting for mutex after 30 seconds */
 #define QEMU_JOB_WAIT_TIME (1000ull * 30)
 
@@ -824,12 +1032,18 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
     qemuDomainObjPrivate *priv = obj->privateData;
     unsigned long long now;
     unsigned long long then;
+    unsigned long long queued;
     bool nested = job == QEMU_JOB_ASYNC_NESTED;
     bool async = job == QEMU_JOB_ASYNC;
+    bool writer = job != QEMU_JOB_NONE && job != QEMU_JOB_QUERY;
+    bool share = false;
+    qemuDomainJobLockStats *lockStats = qemuDomainJobGetLockStats(&priv->job,
+                                                                  job, asyncJob);
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     const char *blocker = NULL;
     const char *agentBlocker = NULL;
     int ret = -1;
+    int rc;
     unsigned long long duration = 0;
     unsigned long long agentDuration = 0;
     unsigned long long asyncDuration = 0;
@@ -848,9 +1062,12 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
         return -1;
 
     priv->jobs_queued++;
+    queued = now;
     then = now + QEMU_JOB_WAIT_TIME;
 
  retry:
+    share = false;
+
     if ((!async && job != QEMU_JOB_DESTROY) &&
         cfg->maxQueuedJobs &&
         priv->jobs_queued > cfg->maxQueuedJobs) {
@@ -862,16 +1079,35 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
             goto cleanup;
 
         VIR_DEBUG("Waiting for async job (vm=%p name=%s)", obj, obj->def->name);
-        if (virCondWaitUntil(&priv->job.asyncCond, &obj->parent.lock, then) < 0)
+        if (lockStats)
+            lockStats->waiting++;
+        rc = virCondWaitUntil(&priv->job.asyncCond, &obj->parent.lock, then);
+        if (lockStats)
+            lockStats->waiting--;
+        if (rc < 0)
             goto error;
     }
 
     while (!qemuDomainObjCanSetJob(&priv->job, job, agentJob)) {
+        if (qemuDomainObjCanShareJob(&priv->job, job, agentJob)) {
+            share = true;
+            break;
+        }
+
         if (nowait)
             goto cleanup;
 
         VIR_DEBUG("Waiting for job (vm=%p name=%s)", obj, obj->def->name);
-        if (virCondWaitUntil(&priv->job.cond, &obj->parent.lock, then) < 0)
+        if (writer)
+            priv->job.nwriters++;
+        if (lockStats)
+            lockStats->waiting++;
+        rc = virCondWaitUntil(&priv->job.cond, &obj->parent.lock, then);
+        if (lockStats)
+            lockStats->waiting--;
+        if (writer)
+            priv->job.nwriters--;
+        if (rc < 0)
             goto error;
     }
 
@@ -882,12 +1118,25 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
 
     ignore_value(virTimeMillisNow(&now));
 
-    if (job) {
+    if (lockStats) {
+        lockStats->count++;
+        qemuDomainJobLockStatsAdd(lockStats->waitHist, &lockStats->waitTotal,
+                                  &lockStats->waitMax, now - queued);
+    }
+
+    if (share) {
+        priv->job.nshared++;
+        VIR_DEBUG("Joined job: %s after %llums (holders=%u async=%s vm=%p name=%s)",
+                  qemuDomainJobTypeToString(job), now - queued,
+                  priv->job.nshared + 1,
+                  qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
+                  obj, obj->def->name);
+    } else if (job) {
         qemuDomainObjResetJob(&priv->job);
 
         if (job != QEMU_JOB_ASYNC) {
-            VIR_DEBUG("Started job: %s (async=%s vm=%p name=%s)",
-                      qemuDomainJobTypeToString(job),
+            VIR_DEBUG("Started job: %s after %llums (async=%s vm=%p name=%s)",
+                      qemuDomainJobTypeToString(job), now - queued,
                       qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
                       obj, obj->def->name);
             priv->job.active = job;
@@ -895,8 +1144,8 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
             priv->job.ownerAPI = g_strdup(virThreadJobGet());
             priv->job.started = now;
         } else {
-            VIR_DEBUG("Started async job: %s (vm=%p name=%s)",
-                      qemuDomainAsyncJobTypeToString(asyncJob),
+            VIR_DEBUG("Started async job: %s after %llums (vm=%p name=%s)",
+                      qemuDomainAsyncJobTypeToString(asyncJob), now - queued,
                       obj, obj->def->name);
             qemuDomainObjResetAsyncJob(&priv->job);
             priv->job.current = g_new0(qemuDomainJobInfo, 1);
@@ -912,8 +1161,8 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
     if (agentJob) {
         qemuDomainObjResetAgentJob(&priv->job);
 
-        VIR_DEBUG("Started agent job: %s (vm=%p name=%s job=%s async=%s)",
-                  qemuDomainAgentJobTypeToString(agentJob),
+        VIR_DEBUG("Started agent job: %s after %llums (vm=%p name=%s job=%s async=%s)",
+                  qemuDomainAgentJobTypeToString(agentJob), now - queued,
                   obj, obj->def->name,
                   qemuDomainJobTypeToString(priv->job.active),
                   qemuDomainAsyncJobTypeToString(priv->job.asyncJob));
@@ -926,6 +1175,12 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveStatus(driver, obj);
 
+    PROBE(QEMU_JOB_BEGIN,
+          "vm=%p name=%s job=%s agentJob=%s asyncJob=%s waitms=%llu ret=%d",
+          obj, obj->def->name, qemuDomainJobTypeToString(job),
+          qemuDomainAgentJobTypeToString(agentJob),
+          qemuDomainAsyncJobTypeToString(asyncJob), now - queued, 0);
+
     return 0;
 
  error:
@@ -1016,6 +1271,12 @@ qemuDomainObjBeginJobInternal(virQEMUDriver *driver,
     }
 
  cleanup:
+    ignore_value(virTimeMillisNow(&now));
+    PROBE(QEMU_JOB_BEGIN,
+          "vm=%p name=%s job=%s agentJob=%s asyncJob=%s waitms=%llu ret=%d",
+          obj, obj->def->name, qemuDomainJobTypeToString(job),
+          qemuDomainAgentJobTypeToString(agentJob),
+          qemuDomainAsyncJobTypeToString(asyncJob), now - queued, ret);
     priv->jobs_queued--;
     return ret;
 }
@@ -1136,15 +1397,49 @@ qemuDomainObjEndJob(virQEMUDriver *driver, virDomainObj *obj)
 {
     qemuDomainObjPrivate *priv = obj->privateData;
     qemuDomainJob job = priv->job.active;
+    unsigned long long now;
+    unsigned long long held = 0;
+    bool timed = priv->job.started && virTimeMillisNow(&now) == 0;
 
     priv->jobs_queued--;
 
+    if (timed)
+        held = now - priv->job.started;
+
+    PROBE(QEMU_JOB_END,
+          "vm=%p name=%s job=%s heldms=%llu",
+          obj, obj->def->name, qemuDomainJobTypeToString(job), held);
+
+    if (job == QEMU_JOB_QUERY && priv->job.nshared > 0) {
+        /* other holders keep the job running */
+        priv->job.nshared--;
+        obj->generation++;
+        qemuDomainObjReleaseCaches(obj);
+        VIR_DEBUG("Leaving shared job: %s (holders=%u vm=%p name=%s)",
+                  qemuDomainJobTypeToString(job), priv->job.nshared + 1,
+                  obj, obj->def->name);
+        return;
+    }
+
     VIR_DEBUG("Stopping job: %s (async=%s vm=%p name=%s)",
               qemuDomainJobTypeToString(job),
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    if (job != QEMU_JOB_NONE && timed) {
+        qemuDomainJobLockStats *stats = &priv->job.lockStats[job];
+
+        qemuDomainJobLockStatsAdd(stats->holdHist, &stats->holdTotal,
+                                  &stats->holdMax, held);
+    }
+
     qemuDomainObjResetJob(&priv->job);
+    /* the job might have changed the definition */
+    obj->generation++;
+    qemuDomainObjReleaseCaches(obj);
+    /* nested jobs of an async job keep using the cached block node data */
+    if (priv->job.asyncJob == QEMU_ASYNC_JOB_NONE)
+        g_clear_pointer(&priv->namedNodeData, g_hash_table_unref);
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveStatus(driver, obj);
     /* We indeed need to wake up ALL threads waiting because
@@ -1157,9 +1452,18 @@ qemuDomainObjEndAgentJob(virDomainObj *obj)
 {
     qemuDomainObjPrivate *priv = obj->privateData;
     qemuDomainAgentJob agentJob = priv->job.agentActive;
+    unsigned long long now;
+    unsigned long long held = 0;
 
     priv->jobs_queued--;
 
+    if (priv->job.agentStarted && virTimeMillisNow(&now) == 0)
+        held = now - priv->job.agentStarted;
+
+    PROBE(QEMU_JOB_AGENT_END,
+          "vm=%p name=%s agentJob=%s heldms=%llu",
+          obj, obj->def->name, qemuDomainAgentJobTypeToString(agentJob), held);
+
     VIR_DEBUG("Stopping agent job: %s (async=%s vm=%p name=%s)",
               qemuDomainAgentJobTypeToString(agentJob),
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
@@ -1175,6 +1479,9 @@ void
 qemuDomainObjEndAsyncJob(virQEMUDriver *driver, virDomainObj *obj)
 {
     qemuDomainObjPrivate *priv = obj->privateData;
+    unsigned long long now;
+    unsigned long long held = 0;
+    bool timed = priv->job.asyncStarted && virTimeMillisNow(&now) == 0;
 
     priv->jobs_queued--;
 
@@ -1182,7 +1489,25 @@ qemuDomainObjEndAsyncJob(virQEMUDriver *driver, virDomainObj *obj)
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    if (timed)
+        held = now - priv->job.asyncStarted;
+
+    PROBE(QEMU_JOB_ASYNC_END,
+          "vm=%p name=%s asyncJob=%s heldms=%llu",
+          obj, obj->def->name,
+          qemuDomainAsyncJobTypeToString(priv->job.asyncJob), held);
+
+    if (priv->job.asyncJob != QEMU_ASYNC_JOB_NONE && timed) {
+        qemuDomainJobLockStats *stats = &priv->job.asyncLockStats[priv->job.asyncJob];
+
+        qemuDomainJobLockStatsAdd(stats->holdHist, &stats->holdTotal,
+                                  &stats->holdMax, held);
+    }
+
     qemuDomainObjResetAsyncJob(&priv->job);
+    obj->generation++;
+    qemuDomainObjReleaseCaches(obj);
+    g_clear_pointer(&priv->namedNodeData, g_hash_table_unref);
     qemuDomainObjSaveStatus(driver, obj);
     virCondBroadcast(&priv->job.asyncCond);
 }
@@ -1294,3 +1619,155 @@ qemuDomainObjPrivateXMLParseJob(virDomainObj *vm,
 
     return 0;
 }
+
+
+static void
+qemuDomainObjPrivateXMLFormatJobLockStatsOne(virBuffer *buf,
+                                             const char *attr,
+                                             const char *type,
+                                             qemuDomainJobLockStats *stats)
+{
+    g_auto(virBuffer) attrBuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) childBuf = VIR_BUFFER_INIT_CHILD(buf);
+    size_t i;
+
+    if (stats->count == 0)
+        return;
+
+    virBufferAsprintf(&attrBuf, " %s='%s' count='%llu'", attr, type, stats->count);
+    virBufferAsprintf(&attrBuf, " waitTotal='%llu' waitMax='%llu'",
+                      stats->waitTotal, stats->waitMax);
+    virBufferAsprintf(&attrBuf, " holdTotal='%llu' holdMax='%llu'",
+                      stats->holdTotal, stats->holdMax);
+
+    for (i = 0; i < QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS; i++) {
+        if (stats->waitHist[i] > 0)
+            virBufferAsprintf(&childBuf, "<wait bucket='%s' count='%llu'/>\n",
+                              qemuDomainJobLockHistNames[i], stats->waitHist[i]);
+    }
+
+    for (i = 0; i < QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS; i++) {
+        if (stats->holdHist[i] > 0)
+            virBufferAsprintf(&childBuf, "<hold bucket='%s' count='%llu'/>\n",
+                              qemuDomainJobLockHistNames[i], stats->holdHist[i]);
+    }
+
+    virXMLFormatElement(buf, "lock", &attrBuf, &childBuf);
+}
+
+
+void
+qemuDomainObjPrivateXMLFormatJobLockStats(virBuffer *buf,
+                                          virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_auto(virBuffer) childBuf = VIR_BUFFER_INIT_CHILD(buf);
+    size_t i;
+
+    for (i = QEMU_JOB_NONE + 1; i < QEMU_JOB_LAST; i++) {
+        if (i == QEMU_JOB_ASYNC)
+            continue;
+
+        qemuDomainObjPrivateXMLFormatJobLockStatsOne(&childBuf, "job",
+                                                     qemuDomainJobTypeToString(i),
+                                                     &priv->job.lockStats[i]);
+    }
+
+    for (i = QEMU_ASYNC_JOB_NONE + 1; i < QEMU_ASYNC_JOB_LAST; i++) {
+        qemuDomainObjPrivateXMLFormatJobLockStatsOne(&childBuf, "async",
+                                                     qemuDomainAsyncJobTypeToString(i),
+                                                     &priv->job.asyncLockStats[i]);
+    }
+
+    virXMLFormatElement(buf, "jobLockStats", NULL, &childBuf);
+}
+
+
+/* The statistics are only informative, values which cannot be parsed are
+ * ignored rather than failing to load the domain status. */
+static void
+qemuDomainObjPrivateXMLParseJobLockStatsValue(xmlNodePtr node,
+                                              const char *name,
+                                              unsigned long long *value)
+{
+    g_autofree char *tmp = virXMLPropString(node, name);
+
+    if (tmp)
+        ignore_value(virStrToLong_ullp(tmp, NULL, 10, value));
+}
+
+
+static void
+qemuDomainObjPrivateXMLParseJobLockStatsOne(xmlNodePtr node,
+                                            qemuDomainJobLockStats *stats)
+{
+    xmlNodePtr cur;
+
+    qemuDomainObjPrivateXMLParseJobLockStatsValue(node, "count", &stats->count);
+    qemuDomainObjPrivateXMLParseJobLockStatsValue(node, "waitTotal", &stats->waitTotal);
+    qemuDomainObjPrivateXMLParseJobLockStatsValue(node, "waitMax", &stats->waitMax);
+    qemuDomainObjPrivateXMLParseJobLockStatsValue(node, "holdTotal", &stats->holdTotal);
+    qemuDomainObjPrivateXMLParseJobLockStatsValue(node, "holdMax", &stats->holdMax);
+
+    for (cur = node->children; cur; cur = cur->next) {
+        g_autofree char *bucket = NULL;
+        unsigned long long *hist;
+        size_t i;
+
+        if (cur->type != XML_ELEMENT_NODE)
+            continue;
+
+        if (virXMLNodeNameEqual(cur, "wait"))
+            hist = stats->waitHist;
+        else if (virXMLNodeNameEqual(cur, "hold"))
+            hist = stats->holdHist;
+        else
+            continue;
+
+        if (!(bucket = virXMLPropString(cur, "bucket")))
+            continue;
+
+        for (i = 0; i < QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS; i++) {
+            if (STREQ(bucket, qemuDomainJobLockHistNames[i])) {
+                qemuDomainObjPrivateXMLParseJobLockStatsValue(cur, "count", &hist[i]);
+                break;
+            }
+        }
+    }
+}
+
+
+int
+qemuDomainObjPrivateXMLParseJobLockStats(virDomainObj *vm,
+                                         xmlXPathContextPtr ctxt)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autofree xmlNodePtr *nodes = NULL;
+    int n;
+    size_t i;
+
+    if ((n = virXPathNodeSet("./jobLockStats/lock", ctxt, &nodes)) < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        g_autofree char *type = NULL;
+        qemuDomainJobLockStats *stats = NULL;
+        int t;
+
+        if ((type = virXMLPropString(nodes[i], "job"))) {
+            t = qemuDomainJobTypeFromString(type);
+            if (t > QEMU_JOB_NONE && t != QEMU_JOB_ASYNC)
+                stats = &priv->job.lockStats[t];
+        } else if ((type = virXMLPropString(nodes[i], "async"))) {
+            t = qemuDomainAsyncJobTypeFromString(type);
+            if (t > QEMU_ASYNC_JOB_NONE)
+                stats = &priv->job.asyncLockStats[t];
+        }
+
+        /* statistics of job types we don't know are dropped */
+        if (stats)
+            qemuDomainObjPrivateXMLParseJobLockStatsOne(nodes[i], stats);
+    }
+
+    return 0;
+}
@@ -79,6 +79,24 @@ typedef enum {
 } qemuDomainAsyncJob;
 VIR_ENUM_DECL(qemuDomainAsyncJob);
 
+/* Phases of starting a domain which are timed separately */
+typedef enum {
+    QEMU_DOMAIN_START_PHASE_INIT = 0,
+    QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN,
+    QEMU_DOMAIN_START_PHASE_PREPARE_HOST,
+    QEMU_DOMAIN_START_PHASE_COMMANDLINE,
+    QEMU_DOMAIN_START_PHASE_SPAWN,
+    QEMU_DOMAIN_START_PHASE_NAMESPACE,
+    QEMU_DOMAIN_START_PHASE_CGROUP,
+    QEMU_DOMAIN_START_PHASE_LABEL,
+    QEMU_DOMAIN_START_PHASE_MONITOR,
+    QEMU_DOMAIN_START_PHASE_SETUP,
+    QEMU_DOMAIN_START_PHASE_FINISH,
+
+    QEMU_DOMAIN_START_PHASE_LAST
+} qemuDomainStartPhase;
+VIR_ENUM_DECL(qemuDomainStartPhase);
+
 typedef enum {
     QEMU_DOMAIN_JOB_STATUS_NONE = 0,
     QEMU_DOMAIN_JOB_STATUS_ACTIVE,
@@ -97,6 +115,7 @@ typedef enum {
     QEMU_DOMAIN_JOB_STATS_TYPE_SAVEDUMP,
     QEMU_DOMAIN_JOB_STATS_TYPE_MEMDUMP,
     QEMU_DOMAIN_JOB_STATS_TYPE_BACKUP,
+    QEMU_DOMAIN_JOB_STATS_TYPE_START,
 } qemuDomainJobStatsType;
 
 
@@ -114,6 +133,11 @@ struct _qemuDomainBackupStats {
     unsigned long long tmp_total;
 };
 
+typedef struct _qemuDomainStartStats qemuDomainStartStats;
+struct _qemuDomainStartStats {
+    unsigned long long phases[QEMU_DOMAIN_START_PHASE_LAST]; /* in us */
+};
+
 typedef struct _qemuDomainJobInfo qemuDomainJobInfo;
 struct _qemuDomainJobInfo {
     qemuDomainJobStatus status;
@@ -138,6 +162,7 @@ struct _qemuDomainJobInfo {
         qemuMonitorMigrationStats mig;
         qemuMonitorDumpStats dump;
         qemuDomainBackupStats backup;
+        qemuDomainStartStats start;
     } stats;
     qemuDomainMirrorStats mirrorStats;
 
@@ -152,6 +177,22 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuDomainJobInfo, qemuDomainJobInfoFree);
 qemuDomainJobInfo *
 qemuDomainJobInfoCopy(qemuDomainJobInfo *info);
 
+/* Number of buckets of the job lock wait and hold time histograms */
+#define QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS 6
+
+/* How long callers of one job type waited for and held the job */
+typedef struct _qemuDomainJobLockStats qemuDomainJobLockStats;
+struct _qemuDomainJobLockStats {
+    unsigned int waiting;               /* callers waiting right now */
+    unsigned long long count;           /* times the job was acquired */
+    unsigned long long waitTotal;       /* all times in milliseconds */
+    unsigned long long waitMax;
+    unsigned long long holdTotal;
+    unsigned long long holdMax;
+    unsigned long long waitHist[QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS];
+    unsigned long long holdHist[QEMU_DOMAIN_JOB_LOCK_HIST_BUCKETS];
+};
+
 typedef struct _qemuDomainJobObj qemuDomainJobObj;
 
 typedef void *(*qemuDomainObjPrivateJobAlloc)(void);
@@ -181,6 +222,10 @@ struct _qemuDomainJobObj {
     unsigned long long owner;           /* Thread id which set current job */
     char *ownerAPI;                     /* The API which owns the job */
     unsigned long long started;         /* When the current job started */
+    unsigned int nshared;               /* Extra holders sharing an active
+                                         * QEMU_JOB_QUERY */
+    unsigned int nwriters;              /* Other than query jobs waiting for
+                                         * @active, blocks sharing */
 
     /* The following members are for QEMU_AGENT_JOB_* */
     qemuDomainAgentJob agentActive;     /* Currently running agent job */
@@ -204,6 +249,11 @@ struct _qemuDomainJobObj {
 
     void *privateData;                  /* job specific collection of data */
     qemuDomainObjPrivateJobCallbacks *cb;
+
+    /* Contention statistics, the time a shared query job is held counts
+     * from its first holder acquiring it to the last one ending it */
+    qemuDomainJobLockStats lockStats[QEMU_JOB_LAST];
+    qemuDomainJobLockStats asyncLockStats[QEMU_ASYNC_JOB_LAST];
 };
 
 const char *qemuDomainAsyncJobPhaseToString(qemuDomainAsyncJob job,
@@ -261,6 +311,11 @@ int qemuDomainJobInfoUpdateDowntime(qemuDomainJobInfo *jobInfo)
 int qemuDomainJobInfoToInfo(qemuDomainJobInfo *jobInfo,
                             virDomainJobInfoPtr info)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+int qemuDomainJobLockStatsToParams(qemuDomainJobObj *job,
+                                   virTypedParameterPtr *params,
+                                   int *nparams)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+
 int qemuDomainJobInfoToParams(qemuDomainJobInfo *jobInfo,
                               int *type,
                               virTypedParameterPtr *params,
@@ -286,3 +341,11 @@ qemuDomainObjPrivateXMLFormatJob(virBuffer *buf,
 int
 qemuDomainObjPrivateXMLParseJob(virDomainObj *vm,
                                 xmlXPathContextPtr ctxt);
+
+void
+qemuDomainObjPrivateXMLFormatJobLockStats(virBuffer *buf,
+                                          virDomainObj *vm);
+
+int
+qemuDomainObjPrivateXMLParseJobLockStats(virDomainObj *vm,
+                                         xmlXPathContextPtr ctxt);
@@ -40,13 +40,17 @@
 #include "qemu_capabilities.h"
 #include "qemu_command.h"
 #include "qemu_cgroup.h"
+#include "qemu_firmware.h"
 #include "qemu_hostdev.h"
 #include "qemu_hotplug.h"
 #include "qemu_monitor.h"
 #include "qemu_process.h"
 #include "qemu_migration.h"
 #include "qemu_migration_params.h"
+#include "qemu_migration_sched.h"
+#include "qemu_statuswriter.h"
 #include "qemu_blockjob.h"
+#include "qemu_blockjob_sched.h"
 #include "qemu_security.h"
 #include "qemu_checkpoint.h"
 #include "qemu_backup.h"
@@ -138,6 +142,10 @@ VIR_LOG_INIT("qemu.qemu_driver");
 
 #define QEMU_NB_BANDWIDTH_PARAM 7
 
+/* Maximum number of threads processing monitor events. Events of a single
+ * domain are always processed one at a time. */
+#define QEMU_EVENT_WORKERS 8
+
 VIR_ENUM_DECL(qemuDumpFormat);
 VIR_ENUM_IMPL(qemuDumpFormat,
               VIR_DOMAIN_CORE_DUMP_FORMAT_LAST,
@@ -150,6 +158,13 @@ VIR_ENUM_IMPL(qemuDumpFormat,
 
 
 static void qemuProcessEventHandler(void *data, void *opaque);
+static void qemuDomainStatsJobHandler(void *jobdata, void *opaque);
+
+static qemuStatsPush *qemuStatsPushNew(void);
+static void qemuStatsPushStop(qemuStatsPush *push, bool wait);
+static void qemuStatsPushFree(qemuStatsPush *push);
+static void qemuStatsPushUnsubscribe(qemuStatsPush *push,
+                                     unsigned long long connSerial);
 
 static int qemuStateCleanup(void);
 
@@ -573,6 +588,9 @@ qemuStateInitialize(bool privileged,
     const char *defsecmodel = NULL;
     g_autofree virSecurityManager **sec_managers = NULL;
     g_autoptr(virIdentity) identity = virIdentityGetCurrent();
+    long long start = g_get_monotonic_time();
+    long long loadStart;
+    long long loadEnd;
 
     qemu_driver = g_new0(virQEMUDriver, 1);
 
@@ -737,6 +755,11 @@ qemuStateInitialize(bool privileged,
 
     qemu_driver->sharedDevices = virHashNew(qemuSharedDeviceEntryFree);
 
+    qemu_driver->statsCursors = g_hash_table_new_full(g_direct_hash,
+                                                      g_direct_equal,
+                                                      NULL,
+                                                      (GDestroyNotify) virDomainDriverStatsCursorFree);
+
     if (qemuMigrationDstErrorInit(qemu_driver) < 0)
         goto error;
 
@@ -827,6 +850,9 @@ qemuStateInitialize(bool privileged,
     if (!qemu_driver->qemuCapsCache)
         goto error;
 
+    if (!(qemu_driver->firmwareCache = qemuFirmwareCacheNew(privileged)))
+        goto error;
+
     if (!(sec_managers = qemuSecurityGetNested(qemu_driver->securityManager)))
         goto error;
 
@@ -868,6 +894,8 @@ qemuStateInitialize(bool privileged,
     if (!(qemu_driver->closeCallbacks = virCloseCallbacksNew()))
         goto error;
 
+    loadStart = g_get_monotonic_time();
+
     /* Get all the running persistent or transient configs first */
     if (virDomainObjListLoadAllConfigs(qemu_driver->domains,
                                        cfg->stateDir,
@@ -912,17 +940,41 @@ qemuStateInitialize(bool privileged,
                             qemuDomainManagedSaveLoad,
                             qemu_driver);
 
+    loadEnd = g_get_monotonic_time();
+
     /* must be initialized before trying to reconnect to all the
      * running domains since there might occur some QEMU monitor
      * events that will be dispatched to the worker pool */
-    qemu_driver->workerPool = virThreadPoolNewFull(0, 1, 0, qemuProcessEventHandler,
+    qemu_driver->workerPool = virThreadPoolNewFull(0, QEMU_EVENT_WORKERS, 0,
+                                                   qemuProcessEventHandler,
                                                    "qemu-event",
                                                    identity,
                                                    qemu_driver);
     if (!qemu_driver->workerPool)
         goto error;
 
-    qemuProcessReconnectAll(qemu_driver);
+    if (cfg->statsWorkers > 0 &&
+        !(qemu_driver->statsPool = virThreadPoolNewFull(0, cfg->statsWorkers, 0,
+                                                        qemuDomainStatsJobHandler,
+                                                        "qemu-stats",
+                                                        identity,
+                                                        qemu_driver)))
+        goto error;
+
+    if (!(qemu_driver->statsPush = qemuStatsPushNew()))
+        goto error;
+
+    if (!(qemu_driver->migrationSched = qemuMigrationSchedNew()))
+        goto error;
+
+    if (!(qemu_driver->blockjobSched = qemuBlockJobSchedNew(qemu_driver)))
+        goto error;
+
+    if (!(qemu_driver->statusWriter = qemuStatusWriterNew()))
+        goto error;
+
+    if (qemuProcessReconnectAll(qemu_driver) < 0)
+        goto error;
 
     if (virDriverShouldAutostart(cfg->stateDir, &autostart) < 0)
         goto error;
@@ -930,6 +982,12 @@ qemuStateInitialize(bool privileged,
     if (autostart)
         qemuAutostartDomains(qemu_driver);
 
+    VIR_INFO("QEMU driver initialized: setup %lld ms, "
+             "loading domains %lld ms, total %lld ms",
+             (loadStart - start) / 1000,
+             (loadEnd - loadStart) / 1000,
+             (g_get_monotonic_time() - start) / 1000);
+
     return VIR_DRV_STATE_INIT_COMPLETE;
 
  error:
@@ -1037,6 +1095,10 @@ qemuStateShutdownPrepare(void)
     if (!qemu_driver)
         return 0;
 
+    if (qemu_driver->reconnectPool)
+        virThreadPoolStop(qemu_driver->reconnectPool);
+    if (qemu_driver->statsPush)
+        qemuStatsPushStop(qemu_driver->statsPush, false);
     virThreadPoolStop(qemu_driver->workerPool);
     return 0;
 }
@@ -1061,7 +1123,14 @@ qemuStateShutdownWait(void)
 
     virDomainObjListForEach(qemu_driver->domains, false,
                             qemuDomainObjStopWorkerIter, NULL);
+    if (qemu_driver->reconnectPool)
+        virThreadPoolDrain(qemu_driver->reconnectPool);
+    if (qemu_driver->statsPush)
+        qemuStatsPushStop(qemu_driver->statsPush, true);
     virThreadPoolDrain(qemu_driver->workerPool);
+    /* Write out any deferred status only after the workers are gone */
+    if (qemu_driver->statusWriter)
+        qemuStatusWriterStop(qemu_driver->statusWriter, true);
     return 0;
 }
 
@@ -1077,6 +1146,10 @@ qemuStateCleanup(void)
     if (!qemu_driver)
         return -1;
 
+    qemuStatsPushFree(qemu_driver->statsPush);
+    qemuMigrationSchedFree(qemu_driver->migrationSched);
+    qemuBlockJobSchedFree(qemu_driver->blockjobSched);
+    qemuStatusWriterFree(qemu_driver->statusWriter);
     virObjectUnref(qemu_driver->migrationErrors);
     virObjectUnref(qemu_driver->closeCallbacks);
     virLockManagerPluginUnref(qemu_driver->lockManager);
@@ -1085,16 +1158,27 @@ qemuStateCleanup(void)
     virPortAllocatorRangeFree(qemu_driver->webSocketPorts);
     virPortAllocatorRangeFree(qemu_driver->remotePorts);
     virHashFree(qemu_driver->sharedDevices);
+    if (qemu_driver->statsCursors)
+        g_hash_table_unref(qemu_driver->statsCursors);
+    if (qemu_driver->cpuResults)
+        g_hash_table_unref(qemu_driver->cpuResults);
+    if (qemu_driver->domainCaps)
+        g_hash_table_unref(qemu_driver->domainCaps);
     virObjectUnref(qemu_driver->hostdevMgr);
     virObjectUnref(qemu_driver->securityManager);
     virObjectUnref(qemu_driver->domainEventState);
     virObjectUnref(qemu_driver->qemuCapsCache);
+    qemuFirmwareCacheFree(qemu_driver->firmwareCache);
     virObjectUnref(qemu_driver->xmlopt);
     virCPUDefFree(qemu_driver->hostcpu);
     virObjectUnref(qemu_driver->caps);
+    g_free(qemu_driver->capsXML);
+    g_free(qemu_driver->capsXMLHost);
     ebtablesContextFree(qemu_driver->ebtables);
     VIR_FREE(qemu_driver->qemuImgBinary);
     virObjectUnref(qemu_driver->domains);
+    virThreadPoolFree(qemu_driver->reconnectPool);
+    virThreadPoolFree(qemu_driver->statsPool);
     virThreadPoolFree(qemu_driver->workerPool);
 
     if (qemu_driver->lockFD != -1)
@@ -1175,6 +1259,9 @@ static int qemuConnectClose(virConnectPtr conn)
     /* Get rid of callbacks registered for this conn */
     virCloseCallbacksRun(driver->closeCallbacks, conn, driver->domains, driver);
 
+    virQEMUDriverRemoveStatsCursor(driver, conn);
+    qemuStatsPushUnsubscribe(driver->statsPush, conn->serial);
+
     conn->privateData = NULL;
 
     return 0;
@@ -1204,6 +1291,7 @@ qemuConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_COMPRESSION:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     default:
         return 0;
@@ -1281,15 +1369,11 @@ qemuConnectGetMaxVcpus(virConnectPtr conn G_GNUC_UNUSED, const char *type)
 
 static char *qemuConnectGetCapabilities(virConnectPtr conn) {
     virQEMUDriver *driver = conn->privateData;
-    g_autoptr(virCaps) caps = NULL;
 
     if (virConnectGetCapabilitiesEnsureACL(conn) < 0)
         return NULL;
 
-    if (!(caps = virQEMUDriverGetCapabilities(driver, true)))
-        return NULL;
-
-    return virCapabilitiesFormatXML(caps);
+    return virQEMUDriverGetCapabilitiesXML(driver);
 }
 
 
@@ -1731,10 +1815,12 @@ static virDomainPtr qemuDomainCreateXML(virConnectPtr conn,
     unsigned int start_flags = VIR_QEMU_PROCESS_START_COLD;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                VIR_DOMAIN_DEF_PARSE_ABI_UPDATE;
+    bool incoming = !!(flags & VIR_DOMAIN_START_INCOMING);
 
     virCheckFlags(VIR_DOMAIN_START_PAUSED |
                   VIR_DOMAIN_START_AUTODESTROY |
-                  VIR_DOMAIN_START_VALIDATE, NULL);
+                  VIR_DOMAIN_START_VALIDATE |
+                  VIR_DOMAIN_START_INCOMING, NULL);
 
     if (flags & VIR_DOMAIN_START_VALIDATE)
         parse_flags |= VIR_DOMAIN_DEF_PARSE_VALIDATE_SCHEMA;
@@ -1742,6 +1828,14 @@ static virDomainPtr qemuDomainCreateXML(virConnectPtr conn,
         start_flags |= VIR_QEMU_PROCESS_START_PAUSED;
     if (flags & VIR_DOMAIN_START_AUTODESTROY)
         start_flags |= VIR_QEMU_PROCESS_START_AUTODESTROY;
+    if (incoming) {
+        /* The definition has to match the one sent by the migration source */
+        parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                      VIR_DOMAIN_DEF_PARSE_ABI_UPDATE_MIGRATION;
+        if (flags & VIR_DOMAIN_START_VALIDATE)
+            parse_flags |= VIR_DOMAIN_DEF_PARSE_VALIDATE_SCHEMA;
+        start_flags |= VIR_QEMU_PROCESS_START_PAUSED;
+    }
 
     virNWFilterReadLockFilterUpdates();
 
@@ -1766,9 +1860,13 @@ static virDomainPtr qemuDomainCreateXML(virConnectPtr conn,
         goto cleanup;
     }
 
+    /* Recorded in the status XML written once the domain starts */
+    QEMU_DOMAIN_PRIVATE(vm)->prestaged = incoming;
+
     if (qemuProcessStart(conn, driver, vm, NULL, QEMU_ASYNC_JOB_START,
-                         NULL, -1, NULL, NULL,
-                         VIR_NETDEV_VPORT_PROFILE_OP_CREATE,
+                         incoming ? "defer" : NULL, -1, NULL, NULL, NULL,
+                         incoming ? VIR_NETDEV_VPORT_PROFILE_OP_MIGRATE_IN_START :
+                                    VIR_NETDEV_VPORT_PROFILE_OP_CREATE,
                          start_flags) < 0) {
         virDomainAuditStart(vm, "booted", false);
         qemuDomainRemoveInactive(driver, vm);
@@ -1779,7 +1877,7 @@ static virDomainPtr qemuDomainCreateXML(virConnectPtr conn,
     event = virDomainEventLifecycleNewFromObj(vm,
                                      VIR_DOMAIN_EVENT_STARTED,
                                      VIR_DOMAIN_EVENT_STARTED_BOOTED);
-    if (event && (flags & VIR_DOMAIN_START_PAUSED)) {
+    if (event && (start_flags & VIR_QEMU_PROCESS_START_PAUSED)) {
         /* There are two classes of event-watching clients - those
          * that only care about on/off (and must see a started event
          * no matter what, but don't care about suspend events), and
@@ -1975,29 +2073,23 @@ qemuDomainShutdownFlagsMonitor(virQEMUDriver *driver,
 }
 
 
-static int qemuDomainShutdownFlags(virDomainPtr dom, unsigned int flags)
+static int
+qemuDomainShutdownObj(virQEMUDriver *driver,
+                      virDomainObj *vm,
+                      unsigned int flags)
 {
-    virQEMUDriver *driver = dom->conn->privateData;
-    virDomainObj *vm;
     int ret = -1;
-    qemuDomainObjPrivate *priv;
+    qemuDomainObjPrivate *priv = vm->privateData;
     bool useAgent = false, agentRequested, acpiRequested;
     bool isReboot = false;
     bool agentForced;
 
-    virCheckFlags(VIR_DOMAIN_SHUTDOWN_ACPI_POWER_BTN |
-                  VIR_DOMAIN_SHUTDOWN_GUEST_AGENT, -1);
-
-    if (!(vm = qemuDomainObjFromDomain(dom)))
-        goto cleanup;
-
     if (vm->def->onPoweroff == VIR_DOMAIN_LIFECYCLE_ACTION_RESTART ||
         vm->def->onPoweroff == VIR_DOMAIN_LIFECYCLE_ACTION_RESTART_RENAME) {
         isReboot = true;
         VIR_INFO("Domain on_poweroff setting overridden, attempting reboot");
     }
 
-    priv = vm->privateData;
     agentRequested = flags & VIR_DOMAIN_SHUTDOWN_GUEST_AGENT;
     acpiRequested  = flags & VIR_DOMAIN_SHUTDOWN_ACPI_POWER_BTN;
 
@@ -2005,14 +2097,11 @@ static int qemuDomainShutdownFlags(virDomainPtr dom, unsigned int flags)
     if (agentRequested || (!flags && priv->agent))
         useAgent = true;
 
-    if (virDomainShutdownFlagsEnsureACL(dom->conn, vm->def, flags) < 0)
-        goto cleanup;
-
     agentForced = agentRequested && !acpiRequested;
     if (useAgent) {
         ret = qemuDomainShutdownFlagsAgent(driver, vm, isReboot, agentForced);
         if (ret < 0 && agentForced)
-            goto cleanup;
+            return ret;
     }
 
     /* If we are not enforced to use just an agent, try ACPI
@@ -2021,14 +2110,33 @@ static int qemuDomainShutdownFlags(virDomainPtr dom, unsigned int flags)
     if (!useAgent || (ret < 0 && (acpiRequested || !flags))) {
         /* Even if agent failed, we have to check if guest went away
          * by itself while our locks were down.  */
-        if (useAgent && !virDomainObjIsActive(vm)) {
-            ret = 0;
-            goto cleanup;
-        }
+        if (useAgent && !virDomainObjIsActive(vm))
+            return 0;
 
         ret = qemuDomainShutdownFlagsMonitor(driver, vm, isReboot);
     }
 
+    return ret;
+}
+
+
+static int qemuDomainShutdownFlags(virDomainPtr dom, unsigned int flags)
+{
+    virQEMUDriver *driver = dom->conn->privateData;
+    virDomainObj *vm;
+    int ret = -1;
+
+    virCheckFlags(VIR_DOMAIN_SHUTDOWN_ACPI_POWER_BTN |
+                  VIR_DOMAIN_SHUTDOWN_GUEST_AGENT, -1);
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainShutdownFlagsEnsureACL(dom->conn, vm->def, flags) < 0)
+        goto cleanup;
+
+    ret = qemuDomainShutdownObj(driver, vm, flags);
+
  cleanup:
     virDomainObjEndAPI(&vm);
     return ret;
@@ -2776,6 +2884,7 @@ qemuDomainSaveInternal(virQEMUDriver *driver,
                        int compressed, virCommand *compressor,
                        const char *xmlin, unsigned int flags)
 {
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     g_autofree char *xml = NULL;
     bool was_running = false;
     int ret = -1;
@@ -2854,6 +2963,7 @@ qemuDomainSaveInternal(virQEMUDriver *driver,
     xml = NULL;
 
     ret = qemuSaveImageCreate(driver, vm, path, data, compressor,
+                              cfg->saveParallelChannels,
                               flags, QEMU_ASYNC_JOB_SAVE);
     if (ret < 0)
         goto endjob;
@@ -4140,7 +4250,7 @@ processJobStatusChangeEvent(virQEMUDriver *driver,
         goto endjob;
     }
 
-    qemuBlockJobUpdate(vm, job, QEMU_ASYNC_JOB_NONE);
+    qemuBlockJobUpdateAll(vm, job, QEMU_ASYNC_JOB_NONE);
 
  endjob:
     qemuDomainObjEndJob(driver, vm);
@@ -4308,11 +4418,11 @@ processMemoryDeviceSizeChange(virQEMUDriver *driver,
 }
 
 
-static void qemuProcessEventHandler(void *data, void *opaque)
+static void
+qemuProcessEventRun(virQEMUDriver *driver,
+                    struct qemuProcessEvent *processEvent)
 {
-    struct qemuProcessEvent *processEvent = data;
     virDomainObj *vm = processEvent->vm;
-    virQEMUDriver *driver = opaque;
 
     VIR_DEBUG("vm=%p, event=%d", vm, processEvent->eventType);
 
@@ -4360,6 +4470,9 @@ static void qemuProcessEventHandler(void *data, void *opaque)
     case QEMU_PROCESS_EVENT_MEMORY_DEVICE_SIZE_CHANGE:
         processMemoryDeviceSizeChange(driver, vm, processEvent->data);
         break;
+    case QEMU_PROCESS_EVENT_BLOCKJOB_SCHED:
+        qemuBlockJobSchedProcessEvent(driver, vm);
+        break;
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
@@ -4369,6 +4482,22 @@ static void qemuProcessEventHandler(void *data, void *opaque)
 }
 
 
+/* The worker pool is handed domains with pending events rather than the
+ * events themselves. Every turn processes a single event and puts the
+ * domain back at the end of the queue if it has more of them. */
+static void qemuProcessEventHandler(void *data, void *opaque)
+{
+    virDomainObj *vm = data;
+    virQEMUDriver *driver = opaque;
+    struct qemuProcessEvent *processEvent;
+
+    if ((processEvent = qemuProcessEventPop(vm)))
+        qemuProcessEventRun(driver, processEvent);
+
+    qemuProcessEventReschedule(driver, vm);
+}
+
+
 static int
 qemuDomainSetVcpusAgent(virDomainObj *vm,
                         unsigned int nvcpus)
@@ -6283,7 +6412,8 @@ static char
     virDomainObj *vm;
     char *ret = NULL;
 
-    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS | VIR_DOMAIN_XML_UPDATE_CPU,
+    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS | VIR_DOMAIN_XML_UPDATE_CPU |
+                  VIR_DOMAIN_XML_SECTION_FLAGS,
                   NULL);
 
     if (!(vm = qemuDomainObjFromDomain(dom)))
@@ -6304,7 +6434,7 @@ static char
         !(flags & VIR_DOMAIN_XML_INACTIVE))
         flags &= ~VIR_DOMAIN_XML_UPDATE_CPU;
 
-    ret = qemuDomainFormatXML(driver, vm, flags);
+    ret = qemuDomainFormatXMLCached(driver, vm, flags);
 
  cleanup:
     virDomainObjEndAPI(&vm);
@@ -6527,7 +6657,7 @@ qemuDomainObjStart(virConnectPtr conn,
     }
 
     ret = qemuProcessStart(conn, driver, vm, NULL, asyncJob,
-                           NULL, -1, NULL, NULL,
+                           NULL, -1, NULL, NULL, NULL,
                            VIR_NETDEV_VPORT_PROFILE_OP_CREATE, start_flags);
     virDomainAuditStart(vm, "booted", ret >= 0);
     if (ret >= 0) {
@@ -6547,6 +6677,39 @@ qemuDomainObjStart(virConnectPtr conn,
     return ret;
 }
 
+/*
+ * Starts the inactive @vm, which must be locked. The caller is expected
+ * to hold the nwfilter update lock.
+ */
+static int
+qemuDomainCreateObj(virConnectPtr conn,
+                    virQEMUDriver *driver,
+                    virDomainObj *vm,
+                    unsigned int flags)
+{
+    int ret = -1;
+
+    if (qemuProcessBeginJob(driver, vm, VIR_DOMAIN_JOB_OPERATION_START,
+                            flags) < 0)
+        return -1;
+
+    if (virDomainObjIsActive(vm)) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       "%s", _("domain is already running"));
+        goto endjob;
+    }
+
+    if (qemuDomainObjStart(conn, driver, vm, flags,
+                           QEMU_ASYNC_JOB_START) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    qemuProcessEndJob(driver, vm);
+    return ret;
+}
+
 static int
 qemuDomainCreateWithFlags(virDomainPtr dom, unsigned int flags)
 {
@@ -6567,26 +6730,12 @@ qemuDomainCreateWithFlags(virDomainPtr dom, unsigned int flags)
     if (virDomainCreateWithFlagsEnsureACL(dom->conn, vm->def) < 0)
         goto cleanup;
 
-    if (qemuProcessBeginJob(driver, vm, VIR_DOMAIN_JOB_OPERATION_START,
-                            flags) < 0)
+    if (qemuDomainCreateObj(dom->conn, driver, vm, flags) < 0)
         goto cleanup;
 
-    if (virDomainObjIsActive(vm)) {
-        virReportError(VIR_ERR_OPERATION_INVALID,
-                       "%s", _("domain is already running"));
-        goto endjob;
-    }
-
-    if (qemuDomainObjStart(dom->conn, driver, vm, flags,
-                           QEMU_ASYNC_JOB_START) < 0)
-        goto endjob;
-
     dom->id = vm->def->id;
     ret = 0;
 
- endjob:
-    qemuProcessEndJob(driver, vm);
-
  cleanup:
     virDomainObjEndAPI(&vm);
     virNWFilterUnlockFilterUpdates();
@@ -6599,6 +6748,234 @@ qemuDomainCreate(virDomainPtr dom)
     return qemuDomainCreateWithFlags(dom, 0);
 }
 
+
+/* Default number of domains started or shut down concurrently by
+ * virConnectStartDomains and virConnectShutdownDomains */
+#define QEMU_DOMAIN_LIFECYCLE_WORKERS 8
+
+typedef struct _qemuDomainLifecycleCtx qemuDomainLifecycleCtx;
+struct _qemuDomainLifecycleCtx {
+    virConnectPtr conn;
+    bool start;
+    unsigned int flags;
+
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+typedef struct _qemuDomainLifecycleJob qemuDomainLifecycleJob;
+struct _qemuDomainLifecycleJob {
+    virDomainPtr dom;
+    virDomainObj *vm;
+
+    int rc;
+    virErrorPtr err;
+};
+
+
+static void
+qemuDomainLifecycleJobRun(qemuDomainLifecycleJob *job,
+                          qemuDomainLifecycleCtx *ctx)
+{
+    virQEMUDriver *driver = ctx->conn->privateData;
+
+    virObjectLock(job->vm);
+
+    if (ctx->start) {
+        job->rc = qemuDomainCreateObj(ctx->conn, driver, job->vm, ctx->flags);
+        if (job->rc == 0)
+            job->dom->id = job->vm->def->id;
+    } else {
+        job->rc = qemuDomainShutdownObj(driver, job->vm, ctx->flags);
+    }
+
+    if (job->rc < 0)
+        virErrorPreserveLast(&job->err);
+
+    virObjectUnlock(job->vm);
+}
+
+
+static void
+qemuDomainLifecycleWorker(void *jobdata,
+                          void *opaque)
+{
+    qemuDomainLifecycleJob *job = jobdata;
+    qemuDomainLifecycleCtx *ctx = opaque;
+
+    qemuDomainLifecycleJobRun(job, ctx);
+
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/*
+ * Starts or shuts down @domains using up to @parallel workers of a
+ * temporary pool. Each domain gets its own job so a slow guest holds up
+ * only its worker. Fills @results and returns the number of domains
+ * handled successfully, or -1 if the call was rejected as a whole.
+ */
+static int
+qemuConnectLifecycleDomains(virConnectPtr conn,
+                            virDomainPtr *domains,
+                            unsigned int ndomains,
+                            unsigned int parallel,
+                            int *results,
+                            bool start,
+                            unsigned int flags)
+{
+    g_autoptr(virIdentity) identity = virIdentityGetCurrent();
+    g_autofree qemuDomainLifecycleJob *jobs = g_new0(qemuDomainLifecycleJob, ndomains);
+    qemuDomainLifecycleCtx ctx = { .conn = conn, .start = start, .flags = flags };
+    virThreadPool *pool = NULL;
+    size_t nworkers;
+    int nsuccess = 0;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < ndomains; i++) {
+        qemuDomainLifecycleJob *job = &jobs[i];
+        int rc;
+
+        job->dom = domains[i];
+
+        if (!(job->vm = qemuDomainObjFromDomain(domains[i])))
+            goto cleanup;
+
+        if (start)
+            rc = virConnectStartDomainsEnsureACL(conn, job->vm->def);
+        else
+            rc = virConnectShutdownDomainsEnsureACL(conn, job->vm->def, flags);
+
+        /* The workers lock the domain themselves */
+        virObjectUnlock(job->vm);
+
+        if (rc < 0)
+            goto cleanup;
+    }
+
+    if (parallel == 0)
+        parallel = QEMU_DOMAIN_LIFECYCLE_WORKERS;
+    nworkers = MIN(parallel, ndomains);
+
+    if (virMutexInit(&ctx.lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        goto cleanup;
+    }
+
+    if (virCondInit(&ctx.cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&ctx.lock);
+        goto cleanup;
+    }
+
+    if (nworkers > 1 &&
+        !(pool = virThreadPoolNewFull(0, nworkers, 0,
+                                      qemuDomainLifecycleWorker,
+                                      "qemu-lifecycle", identity, &ctx)))
+        virResetLastError();
+
+    VIR_DEBUG("%s %u domains using %zu workers",
+              start ? "Starting" : "Shutting down", ndomains,
+              pool ? nworkers : 1);
+
+    if (start)
+        virNWFilterReadLockFilterUpdates();
+
+    for (i = 0; i < ndomains; i++) {
+        qemuDomainLifecycleJob *job = &jobs[i];
+
+        if (pool) {
+            virMutexLock(&ctx.lock);
+            ctx.pending++;
+            virMutexUnlock(&ctx.lock);
+
+            if (virThreadPoolSendJob(pool, 0, job) == 0)
+                continue;
+
+            virMutexLock(&ctx.lock);
+            ctx.pending--;
+            virMutexUnlock(&ctx.lock);
+
+            /* Do it ourselves if the job can't be queued */
+            virResetLastError();
+        }
+
+        qemuDomainLifecycleJobRun(job, &ctx);
+    }
+
+    virMutexLock(&ctx.lock);
+    while (ctx.pending > 0)
+        ignore_value(virCondWait(&ctx.cond, &ctx.lock));
+    virMutexUnlock(&ctx.lock);
+
+    virThreadPoolFree(pool);
+    virCondDestroy(&ctx.cond);
+    virMutexDestroy(&ctx.lock);
+
+    if (start)
+        virNWFilterUnlockFilterUpdates();
+
+    for (i = 0; i < ndomains; i++) {
+        if (jobs[i].rc == 0) {
+            nsuccess++;
+            continue;
+        }
+
+        if (results)
+            results[i] = jobs[i].err ? jobs[i].err->code : VIR_ERR_INTERNAL_ERROR;
+        VIR_WARN("Failed to %s domain '%s': %s",
+                 start ? "start" : "shut down", domains[i]->name,
+                 NULLSTR(jobs[i].err ? jobs[i].err->message : NULL));
+    }
+
+    ret = nsuccess;
+
+ cleanup:
+    for (i = 0; i < ndomains; i++) {
+        virObjectUnref(jobs[i].vm);
+        virFreeError(jobs[i].err);
+    }
+    return ret;
+}
+
+
+static int
+qemuConnectStartDomains(virConnectPtr conn,
+                        virDomainPtr *domains,
+                        unsigned int ndomains,
+                        unsigned int parallel,
+                        int *results,
+                        unsigned int flags)
+{
+    virCheckFlags(VIR_DOMAIN_START_PAUSED |
+                  VIR_DOMAIN_START_BYPASS_CACHE |
+                  VIR_DOMAIN_START_FORCE_BOOT, -1);
+
+    return qemuConnectLifecycleDomains(conn, domains, ndomains, parallel,
+                                       results, true, flags);
+}
+
+
+static int
+qemuConnectShutdownDomains(virConnectPtr conn,
+                           virDomainPtr *domains,
+                           unsigned int ndomains,
+                           unsigned int parallel,
+                           int *results,
+                           unsigned int flags)
+{
+    virCheckFlags(VIR_DOMAIN_SHUTDOWN_ACPI_POWER_BTN |
+                  VIR_DOMAIN_SHUTDOWN_GUEST_AGENT, -1);
+
+    return qemuConnectLifecycleDomains(conn, domains, ndomains, parallel,
+                                       results, false, flags);
+}
+
 static virDomainPtr
 qemuDomainDefineXMLFlags(virConnectPtr conn,
                          const char *xml,
@@ -6984,9 +7361,8 @@ qemuDomainAttachDeviceLive(virDomainObj *vm,
         virObjectEventStateQueue(driver->domainEventState, event);
     }
 
-    if (ret == 0)
-        ret = qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE);
-
+    /* the caller is responsible for updating the device list once all the
+     * devices are attached */
     return ret;
 }
 
@@ -7869,25 +8245,44 @@ qemuDomainAttachDeviceLiveAndConfigHomogenize(const virDomainDeviceDef *devConf,
 }
 
 
+/**
+ * qemuDomainAttachDevicesLiveAndConfig:
+ * @vm: domain object
+ * @driver: qemu driver
+ * @xmls: XML descriptions of the devices
+ * @nxmls: number of elements in @xmls
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Attaches all devices described by @xmls within a single job. All the
+ * devices are parsed and validated before the first one is hotplugged and
+ * the device list and status of @vm are refreshed and saved just once after
+ * the last one. QEMU can't add devices in a transaction, so if hotplugging a
+ * device fails, the devices preceding it remain attached.
+ */
 static int
-qemuDomainAttachDeviceLiveAndConfig(virDomainObj *vm,
-                                    virQEMUDriver *driver,
-                                    const char *xml,
-                                    unsigned int flags)
+qemuDomainAttachDevicesLiveAndConfig(virDomainObj *vm,
+                                     virQEMUDriver *driver,
+                                     const char **xmls,
+                                     size_t nxmls,
+                                     unsigned int flags)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
     g_autoptr(virDomainDef) vmdef = NULL;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
-    g_autoptr(virDomainDeviceDef) devConf = NULL;
-    virDomainDeviceDef devConfSave = { 0 };
-    g_autoptr(virDomainDeviceDef) devLive = NULL;
+    g_autofree virDomainDeviceDef *devConfSave = NULL;
+    virDomainDeviceDef **devLive = NULL;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                VIR_DOMAIN_DEF_PARSE_ABI_UPDATE;
+    size_t nattached = 0;
+    size_t i;
+    int ret = -1;
 
     virCheckFlags(VIR_DOMAIN_AFFECT_LIVE |
                   VIR_DOMAIN_AFFECT_CONFIG, -1);
 
     cfg = virQEMUDriverGetConfig(driver);
+    devConfSave = g_new0(virDomainDeviceDef, nxmls);
+    devLive = g_new0(virDomainDeviceDef *, nxmls);
 
     /* The config and live post processing address auto-generation algorithms
      * rely on the correct vm->def or vm->newDef being passed, so call the
@@ -7896,73 +8291,98 @@ qemuDomainAttachDeviceLiveAndConfig(virDomainObj *vm,
         vmdef = virDomainObjCopyPersistentDef(vm, driver->xmlopt,
                                               priv->qemuCaps);
         if (!vmdef)
-            return -1;
+            goto cleanup;
 
-        if (!(devConf = virDomainDeviceDefParse(xml, vmdef,
-                                                driver->xmlopt, priv->qemuCaps,
-                                                parse_flags)))
-            return -1;
+        for (i = 0; i < nxmls; i++) {
+            g_autoptr(virDomainDeviceDef) devConf = NULL;
 
-        /*
-         * devConf will be NULLed out by
-         * qemuDomainAttachDeviceConfig(), so save it for later use by
-         * qemuDomainAttachDeviceLiveAndConfigHomogenize()
-         */
-        devConfSave = *devConf;
+            if (!(devConf = virDomainDeviceDefParse(xmls[i], vmdef,
+                                                    driver->xmlopt, priv->qemuCaps,
+                                                    parse_flags)))
+                goto cleanup;
 
-        if (virDomainDeviceValidateAliasForHotplug(vm, devConf,
-                                                   VIR_DOMAIN_AFFECT_CONFIG) < 0)
-            return -1;
+            /*
+             * devConf will be NULLed out by
+             * qemuDomainAttachDeviceConfig(), so save it for later use by
+             * qemuDomainAttachDeviceLiveAndConfigHomogenize()
+             */
+            devConfSave[i] = *devConf;
 
-        if (virDomainDefCompatibleDevice(vmdef, devConf, NULL,
-                                         VIR_DOMAIN_DEVICE_ACTION_ATTACH,
-                                         false) < 0)
-            return -1;
+            if (virDomainDeviceValidateAliasForHotplug(vm, devConf,
+                                                       VIR_DOMAIN_AFFECT_CONFIG) < 0)
+                goto cleanup;
 
-        if (qemuDomainAttachDeviceConfig(vmdef, devConf, priv->qemuCaps,
-                                         parse_flags,
-                                         driver->xmlopt) < 0)
-            return -1;
+            if (virDomainDefCompatibleDevice(vmdef, devConf, NULL,
+                                             VIR_DOMAIN_DEVICE_ACTION_ATTACH,
+                                             false) < 0)
+                goto cleanup;
+
+            if (qemuDomainAttachDeviceConfig(vmdef, devConf, priv->qemuCaps,
+                                             parse_flags,
+                                             driver->xmlopt) < 0)
+                goto cleanup;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_LIVE) {
-        if (!(devLive = virDomainDeviceDefParse(xml, vm->def,
-                                                driver->xmlopt, priv->qemuCaps,
-                                                parse_flags)))
-            return -1;
+        for (i = 0; i < nxmls; i++) {
+            if (!(devLive[i] = virDomainDeviceDefParse(xmls[i], vm->def,
+                                                       driver->xmlopt,
+                                                       priv->qemuCaps,
+                                                       parse_flags)))
+                goto cleanup;
 
-        if (flags & VIR_DOMAIN_AFFECT_CONFIG)
-            qemuDomainAttachDeviceLiveAndConfigHomogenize(&devConfSave, devLive);
+            if (flags & VIR_DOMAIN_AFFECT_CONFIG)
+                qemuDomainAttachDeviceLiveAndConfigHomogenize(&devConfSave[i],
+                                                              devLive[i]);
 
-        if (virDomainDeviceValidateAliasForHotplug(vm, devLive,
-                                                   VIR_DOMAIN_AFFECT_LIVE) < 0)
-            return -1;
+            if (virDomainDeviceValidateAliasForHotplug(vm, devLive[i],
+                                                       VIR_DOMAIN_AFFECT_LIVE) < 0)
+                goto cleanup;
 
-        if (virDomainDefCompatibleDevice(vm->def, devLive, NULL,
-                                         VIR_DOMAIN_DEVICE_ACTION_ATTACH,
-                                         true) < 0)
-            return -1;
+            if (virDomainDefCompatibleDevice(vm->def, devLive[i], NULL,
+                                             VIR_DOMAIN_DEVICE_ACTION_ATTACH,
+                                             true) < 0)
+                goto cleanup;
+        }
+
+        for (i = 0; i < nxmls; i++) {
+            if (qemuDomainAttachDeviceLive(vm, devLive[i], driver) < 0)
+                break;
+            nattached++;
+        }
+
+        if (nattached > 0 &&
+            qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
+            nattached = 0;
 
-        if (qemuDomainAttachDeviceLive(vm, devLive, driver) < 0)
-            return -1;
         /*
          * update domain status forcibly because the domain status may be
          * changed even if we failed to attach the device. For example,
          * a new controller may be created.
          */
         qemuDomainSaveStatus(vm);
+
+        if (nattached < nxmls)
+            goto cleanup;
     }
 
     /* Finally, if no error until here, we can save config. */
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
         if (virDomainDefSave(vmdef, driver->xmlopt, cfg->configDir) < 0)
-            return -1;
+            goto cleanup;
 
         virDomainObjAssignDef(vm, vmdef, false, NULL);
         vmdef = NULL;
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nxmls; i++)
+        virDomainDeviceDefFree(devLive[i]);
+    g_free(devLive);
+    return ret;
 }
 
 static int
@@ -7988,7 +8408,45 @@ qemuDomainAttachDeviceFlags(virDomainPtr dom,
     if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
         goto endjob;
 
-    if (qemuDomainAttachDeviceLiveAndConfig(vm, driver, xml, flags) < 0)
+    if (qemuDomainAttachDevicesLiveAndConfig(vm, driver, &xml, 1, flags) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    virNWFilterUnlockFilterUpdates();
+    return ret;
+}
+
+static int
+qemuDomainAttachDevices(virDomainPtr dom,
+                        const char **xmls,
+                        unsigned int nxmls,
+                        unsigned int flags)
+{
+    virQEMUDriver *driver = dom->conn->privateData;
+    virDomainObj *vm = NULL;
+    int ret = -1;
+
+    virNWFilterReadLockFilterUpdates();
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainAttachDevicesEnsureACL(dom->conn, vm->def, flags) < 0)
+        goto cleanup;
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        goto cleanup;
+
+    if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
+        goto endjob;
+
+    if (qemuDomainAttachDevicesLiveAndConfig(vm, driver, xmls, nxmls, flags) < 0)
         goto endjob;
 
     ret = 0;
@@ -8112,45 +8570,66 @@ static int qemuDomainUpdateDeviceFlags(virDomainPtr dom,
     return ret;
 }
 
+/**
+ * qemuDomainDetachDevicesLiveAndConfig:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @xmls: XML descriptions of the devices
+ * @nxmls: number of elements in @xmls
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Detaches all devices described by @xmls within a single job. All the
+ * descriptions are parsed before the first device is unplugged and the device
+ * list and status of @vm are refreshed and saved just once after the last
+ * one. If unplugging a device fails, the devices preceding it stay detached.
+ */
 static int
-qemuDomainDetachDeviceLiveAndConfig(virQEMUDriver *driver,
-                                    virDomainObj *vm,
-                                    const char *xml,
-                                    unsigned int flags)
+qemuDomainDetachDevicesLiveAndConfig(virQEMUDriver *driver,
+                                     virDomainObj *vm,
+                                     const char **xmls,
+                                     size_t nxmls,
+                                     unsigned int flags)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
-    g_autoptr(virDomainDeviceDef) dev = NULL;
-    virDomainDeviceDef *dev_copy = NULL;
+    virDomainDeviceDef **devs = NULL;
+    virDomainDeviceDef **dev_copies = NULL;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
     g_autoptr(virDomainDef) vmdef = NULL;
+    size_t i;
     int ret = -1;
 
     virCheckFlags(VIR_DOMAIN_AFFECT_LIVE |
                   VIR_DOMAIN_AFFECT_CONFIG, -1);
 
     cfg = virQEMUDriverGetConfig(driver);
+    devs = g_new0(virDomainDeviceDef *, nxmls);
+    dev_copies = g_new0(virDomainDeviceDef *, nxmls);
 
     if ((flags & VIR_DOMAIN_AFFECT_CONFIG) &&
         !(flags & VIR_DOMAIN_AFFECT_LIVE))
         parse_flags |= VIR_DOMAIN_DEF_PARSE_INACTIVE;
 
-    dev = dev_copy = virDomainDeviceDefParse(xml, vm->def,
-                                             driver->xmlopt, priv->qemuCaps,
-                                             parse_flags);
-    if (dev == NULL)
-        goto cleanup;
-
-    if (flags & VIR_DOMAIN_AFFECT_CONFIG &&
-        flags & VIR_DOMAIN_AFFECT_LIVE) {
-        /* If we are affecting both CONFIG and LIVE
-         * create a deep copy of device as adding
-         * to CONFIG takes one instance.
-         */
-        dev_copy = virDomainDeviceDefCopy(dev, vm->def,
-                                          driver->xmlopt, priv->qemuCaps);
-        if (!dev_copy)
+    for (i = 0; i < nxmls; i++) {
+        devs[i] = dev_copies[i] = virDomainDeviceDefParse(xmls[i], vm->def,
+                                                          driver->xmlopt,
+                                                          priv->qemuCaps,
+                                                          parse_flags);
+        if (devs[i] == NULL)
             goto cleanup;
+
+        if (flags & VIR_DOMAIN_AFFECT_CONFIG &&
+            flags & VIR_DOMAIN_AFFECT_LIVE) {
+            /* If we are affecting both CONFIG and LIVE
+             * create a deep copy of device as adding
+             * to CONFIG takes one instance.
+             */
+            dev_copies[i] = virDomainDeviceDefCopy(devs[i], vm->def,
+                                                   driver->xmlopt,
+                                                   priv->qemuCaps);
+            if (!dev_copies[i])
+                goto cleanup;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
@@ -8159,22 +8638,35 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriver *driver,
         if (!vmdef)
             goto cleanup;
 
-        if (qemuDomainDetachDeviceConfig(vmdef, dev, priv->qemuCaps,
-                                         parse_flags,
-                                         driver->xmlopt) < 0)
-            goto cleanup;
+        for (i = 0; i < nxmls; i++) {
+            if (qemuDomainDetachDeviceConfig(vmdef, devs[i], priv->qemuCaps,
+                                             parse_flags,
+                                             driver->xmlopt) < 0)
+                goto cleanup;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_LIVE) {
-        int rc;
+        bool removed = false;
+        int rc = 0;
 
-        if ((rc = qemuDomainDetachDeviceLive(vm, dev_copy, driver, false)) < 0)
-            goto cleanup;
+        for (i = 0; i < nxmls; i++) {
+            if ((rc = qemuDomainDetachDeviceLive(vm, dev_copies[i],
+                                                 driver, false)) < 0)
+                break;
 
-        if (rc == 0 && qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
-            goto cleanup;
+            if (rc == 0)
+                removed = true;
+        }
+
+        if (removed &&
+            qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
+            rc = -1;
 
         qemuDomainSaveStatus(vm);
+
+        if (rc < 0)
+            goto cleanup;
     }
 
     /* Finally, if no error until here, we can save config. */
@@ -8189,8 +8681,13 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriver *driver,
     ret = 0;
 
  cleanup:
-    if (dev != dev_copy)
-        virDomainDeviceDefFree(dev_copy);
+    for (i = 0; i < nxmls; i++) {
+        if (devs[i] != dev_copies[i])
+            virDomainDeviceDefFree(dev_copies[i]);
+        virDomainDeviceDefFree(devs[i]);
+    }
+    g_free(dev_copies);
+    g_free(devs);
     return ret;
 }
 
@@ -8281,7 +8778,43 @@ qemuDomainDetachDeviceFlags(virDomainPtr dom,
     if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
         goto endjob;
 
-    if (qemuDomainDetachDeviceLiveAndConfig(driver, vm, xml, flags) < 0)
+    if (qemuDomainDetachDevicesLiveAndConfig(driver, vm, &xml, 1, flags) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    return ret;
+}
+
+
+static int
+qemuDomainDetachDevices(virDomainPtr dom,
+                        const char **xmls,
+                        unsigned int nxmls,
+                        unsigned int flags)
+{
+    virQEMUDriver *driver = dom->conn->privateData;
+    virDomainObj *vm = NULL;
+    int ret = -1;
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainDetachDevicesEnsureACL(dom->conn, vm->def, flags) < 0)
+        goto cleanup;
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        goto cleanup;
+
+    if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
+        goto endjob;
+
+    if (qemuDomainDetachDevicesLiveAndConfig(driver, vm, xmls, nxmls, flags) < 0)
         goto endjob;
 
     ret = 0;
@@ -10054,12 +10587,12 @@ qemuDomainBlocksStatsGather(virQEMUDriver *driver,
     }
 
     qemuDomainObjEnterMonitor(driver, vm);
-    nstats = qemuMonitorGetAllBlockStatsInfo(priv->mon, &blockstats);
+    if (capacity && blockdev) {
+        nstats = qemuMonitorGetAllBlockStatsInfoBlockdev(priv->mon, &blockstats);
+    } else {
+        nstats = qemuMonitorGetAllBlockStatsInfo(priv->mon, &blockstats);
 
-    if (capacity && nstats >= 0) {
-        if (blockdev)
-            rc = qemuMonitorBlockStatsUpdateCapacityBlockdev(priv->mon, blockstats);
-        else
+        if (capacity && nstats >= 0)
             rc = qemuMonitorBlockStatsUpdateCapacity(priv->mon, blockstats);
     }
 
@@ -12271,6 +12804,7 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
     virCPUDef *cpu = NULL;
     virArch arch;
     virDomainVirtType virttype;
+    g_autofree char *key = NULL;
 
     virCheckFlags(VIR_CONNECT_COMPARE_CPU_FAIL_INCOMPATIBLE |
                   VIR_CONNECT_COMPARE_CPU_VALIDATE_XML,
@@ -12291,6 +12825,13 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
     if (!qemuCaps)
         goto cleanup;
 
+    if (!(key = virQEMUDriverCPUResultKey("compare", qemuCaps, arch, virttype,
+                                          flags, &xmlCPU, 1)))
+        goto cleanup;
+
+    if (virQEMUDriverLookupCPUResult(driver, key, qemuCaps, &ret, NULL))
+        goto cleanup;
+
     hvCPU = virQEMUCapsGetHostModel(qemuCaps, virttype,
                                     VIR_QEMU_CAPS_HOST_CPU_REPORTED);
 
@@ -12332,6 +12873,9 @@ qemuConnectCompareHypervisorCPU(virConnectPtr conn,
                          "for arch %s"), virArchToString(arch));
     }
 
+    if (ret != VIR_CPU_COMPARE_ERROR)
+        virQEMUDriverCacheCPUResult(driver, key, qemuCaps, ret, NULL);
+
  cleanup:
     virCPUDefFree(cpu);
     return ret;
@@ -12513,6 +13057,7 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
     virCPUDef *cpu = NULL;
     char *cpustr = NULL;
     g_auto(GStrv) features = NULL;
+    g_autofree char *key = NULL;
 
     virCheckFlags(VIR_CONNECT_BASELINE_CPU_EXPAND_FEATURES |
                   VIR_CONNECT_BASELINE_CPU_MIGRATABLE, NULL);
@@ -12522,9 +13067,6 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
 
     migratable = !!(flags & VIR_CONNECT_BASELINE_CPU_MIGRATABLE);
 
-    if (!(cpus = virCPUDefListParse(xmlCPUs, ncpus, VIR_CPU_TYPE_AUTO)))
-        goto cleanup;
-
     qemuCaps = virQEMUCapsCacheLookupDefault(driver->qemuCapsCache,
                                              emulator,
                                              archStr,
@@ -12534,6 +13076,16 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
     if (!qemuCaps)
         goto cleanup;
 
+    if (!(key = virQEMUDriverCPUResultKey("baseline", qemuCaps, arch, virttype,
+                                          flags, xmlCPUs, ncpus)))
+        goto cleanup;
+
+    if (virQEMUDriverLookupCPUResult(driver, key, qemuCaps, NULL, &cpustr))
+        goto cleanup;
+
+    if (!(cpus = virCPUDefListParse(xmlCPUs, ncpus, VIR_CPU_TYPE_AUTO)))
+        goto cleanup;
+
     if (!(cpuModels = virQEMUCapsGetCPUModels(qemuCaps, virttype, NULL, NULL)) ||
         cpuModels->nmodels == 0) {
         virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
@@ -12581,7 +13133,8 @@ qemuConnectBaselineHypervisorCPU(virConnectPtr conn,
         virCPUExpandFeatures(arch, cpu) < 0)
         goto cleanup;
 
-    cpustr = virCPUDefFormat(cpu, NULL);
+    if ((cpustr = virCPUDefFormat(cpu, NULL)))
+        virQEMUDriverCacheCPUResult(driver, key, qemuCaps, 0, cpustr);
 
  cleanup:
     virCPUDefListFree(cpus);
@@ -12728,6 +13281,13 @@ qemuDomainGetJobStatsInternal(virQEMUDriver *driver,
             goto cleanup;
         break;
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
+        if (qemuDomainJobInfoUpdateTime(*jobInfo) < 0)
+            goto cleanup;
+        memcpy((*jobInfo)->stats.start.phases, priv->startPhases,
+               sizeof(priv->startPhases));
+        break;
+
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         break;
     }
@@ -12789,7 +13349,8 @@ qemuDomainGetJobStats(virDomainPtr dom,
     int ret = -1;
 
     virCheckFlags(VIR_DOMAIN_JOB_STATS_COMPLETED |
-                  VIR_DOMAIN_JOB_STATS_KEEP_COMPLETED, -1);
+                  VIR_DOMAIN_JOB_STATS_KEEP_COMPLETED |
+                  VIR_DOMAIN_JOB_STATS_LOCK, -1);
 
     if (!(vm = qemuDomainObjFromDomain(dom)))
         goto cleanup;
@@ -12798,6 +13359,13 @@ qemuDomainGetJobStats(virDomainPtr dom,
         goto cleanup;
 
     priv = vm->privateData;
+
+    if (flags & VIR_DOMAIN_JOB_STATS_LOCK) {
+        /* read under the domain lock, must not wait for a job itself */
+        *type = VIR_DOMAIN_JOB_NONE;
+        ret = qemuDomainJobLockStatsToParams(&priv->job, params, nparams);
+        goto cleanup;
+    }
     if (qemuDomainGetJobStatsInternal(driver, vm, completed, &jobInfo) < 0)
         goto cleanup;
 
@@ -13424,6 +13992,52 @@ qemuDomainSnapshotCreateXML(virDomainPtr domain,
 }
 
 
+static int
+qemuDomainSnapshotCreateXMLGroup(virConnectPtr conn,
+                                 virDomainPtr *domains,
+                                 unsigned int ndomains,
+                                 const char **xmlDescs,
+                                 virDomainSnapshotPtr *snapshots,
+                                 unsigned int flags)
+{
+    g_autofree virDomainObj **vms = g_new0(virDomainObj *, ndomains);
+    int ret = -1;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < ndomains; i++) {
+        if (!(vms[i] = qemuDomainObjFromDomain(domains[i])))
+            goto cleanup;
+
+        if (virDomainSnapshotCreateXMLGroupEnsureACL(conn, vms[i]->def, flags) < 0) {
+            virDomainObjEndAPI(&vms[i]);
+            goto cleanup;
+        }
+
+        virObjectUnlock(vms[i]);
+
+        /* a second snapshot job of a domain can't start before the first
+         * one ends, while the first one waits for the second to join */
+        for (j = 0; j < i; j++) {
+            if (vms[j] == vms[i]) {
+                virReportError(VIR_ERR_INVALID_ARG,
+                               _("domain '%s' is listed more than once"),
+                               domains[i]->name);
+                goto cleanup;
+            }
+        }
+    }
+
+    ret = qemuSnapshotCreateXMLGroup(domains, vms, xmlDescs, ndomains,
+                                     snapshots, flags);
+
+ cleanup:
+    for (i = 0; i < ndomains; i++)
+        virObjectUnref(vms[i]);
+    return ret;
+}
+
+
 static int
 qemuDomainSnapshotListNames(virDomainPtr domain,
                             char **names,
@@ -14490,6 +15104,8 @@ qemuDomainBlockPullCommon(virDomainObj *vm,
     if (!(job = qemuBlockJobDiskNewPull(vm, disk, baseSource, flags)))
         goto endjob;
 
+    qemuBlockJobSchedAdd(driver, vm, job, &speed);
+
     if (blockdev) {
         jobname = job->name;
         persistjob = true;
@@ -14520,6 +15136,7 @@ qemuDomainBlockPullCommon(virDomainObj *vm,
         goto endjob;
 
     qemuBlockJobStarted(job, vm);
+    qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, false);
 
  endjob:
     qemuDomainObjEndJob(driver, vm);
@@ -14802,6 +15419,12 @@ qemuDomainBlockJobSetSpeed(virDomainPtr dom,
         goto endjob;
     }
 
+    if (qemuBlockJobSchedSetLimit(driver, vm, job, speed)) {
+        qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, false);
+        ret = 0;
+        goto endjob;
+    }
+
     qemuDomainObjEnterMonitor(driver, vm);
     ret = qemuMonitorBlockJobSetSpeed(qemuDomainGetMonitor(vm),
                                       job->name,
@@ -15208,6 +15831,8 @@ qemuDomainBlockCopyCommon(virDomainObj *vm,
 
     disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_NONE;
 
+    qemuBlockJobSchedAdd(driver, vm, job, &bandwidth);
+
     /* Actually start the mirroring */
     qemuDomainObjEnterMonitor(driver, vm);
 
@@ -15238,6 +15863,7 @@ qemuDomainBlockCopyCommon(virDomainObj *vm,
     disk->mirror = g_steal_pointer(&mirror);
     disk->mirrorJob = VIR_DOMAIN_BLOCK_JOB_TYPE_COPY;
     qemuBlockJobStarted(job, vm);
+    qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, false);
 
  endjob:
     if (ret < 0 &&
@@ -15628,6 +16254,8 @@ qemuDomainBlockCommit(virDomainPtr dom,
 
     disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_NONE;
 
+    qemuBlockJobSchedAdd(driver, vm, job, &speed);
+
     /* Start the commit operation.  Pass the user's original spelling,
      * if any, through to qemu, since qemu may behave differently
      * depending on whether the input was specified as relative or
@@ -15672,6 +16300,7 @@ qemuDomainBlockCommit(virDomainPtr dom,
         disk->mirrorJob = VIR_DOMAIN_BLOCK_JOB_TYPE_ACTIVE_COMMIT;
     }
     qemuBlockJobStarted(job, vm);
+    qemuBlockJobSchedApply(driver, vm, QEMU_ASYNC_JOB_NONE, false);
 
  endjob:
     if (ret < 0 && clean_access) {
@@ -17548,6 +18177,7 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
     virArch arch;
     virDomainVirtType virttype;
     g_autoptr(virDomainCaps) domCaps = NULL;
+    char *xml = NULL;
 
     virCheckFlags(0, NULL);
 
@@ -17565,10 +18195,64 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
 
     if (!(domCaps = virQEMUDriverGetDomainCapabilities(driver,
                                                        qemuCaps, machine,
-                                                       arch, virttype)))
+                                                       arch, virttype,
+                                                       &xml)))
+        return NULL;
+
+    return xml;
+}
+
+
+/* Data collected once per bulk stats call and shared by all domains */
+typedef struct _qemuDomainGetStatsBulk qemuDomainGetStatsBulk;
+struct _qemuDomainGetStatsBulk {
+    GHashTable *netstats; /* ifname -> virDomainInterfaceStats, may be NULL */
+    /* OVS interface stats, fetched by the first domain needing them */
+    GMutex ovsLock;
+    bool ovsFetched;
+    GHashTable *ovsstats; /* ifname -> virDomainInterfaceStats, may be NULL */
+    /* number of parameters of the domain gathered last, accessed
+     * atomically as domains may be processed in parallel */
+    int nparamsHint;
+};
+
+
+static void
+qemuDomainGetStatsBulkInit(qemuDomainGetStatsBulk *bulk)
+{
+    memset(bulk, 0, sizeof(*bulk));
+    g_mutex_init(&bulk->ovsLock);
+}
+
+
+static void
+qemuDomainGetStatsBulkClear(qemuDomainGetStatsBulk *bulk)
+{
+    g_mutex_clear(&bulk->ovsLock);
+    g_clear_pointer(&bulk->ovsstats, g_hash_table_unref);
+}
+
+
+/* One ovs-vsctl call for all vhost-user interfaces of all domains instead
+ * of one call per interface */
+static GHashTable *
+qemuDomainGetStatsBulkOVS(qemuDomainGetStatsBulk *bulk)
+{
+    GHashTable *ret;
+
+    if (!bulk)
         return NULL;
 
-    return virDomainCapsFormat(domCaps);
+    g_mutex_lock(&bulk->ovsLock);
+    if (!bulk->ovsFetched) {
+        if (!(bulk->ovsstats = virNetDevOpenvswitchInterfaceStatsAll()))
+            virResetLastError();
+        bulk->ovsFetched = true;
+    }
+    ret = bulk->ovsstats;
+    g_mutex_unlock(&bulk->ovsLock);
+
+    return ret;
 }
 
 
@@ -17576,7 +18260,8 @@ static int
 qemuDomainGetStatsState(virQEMUDriver *driver G_GNUC_UNUSED,
                         virDomainObj *dom,
                         virTypedParamList *params,
-                        unsigned int privflags G_GNUC_UNUSED)
+                        unsigned int privflags G_GNUC_UNUSED,
+                        qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     if (virTypedParamListAddInt(params, dom->state.state, "state.state") < 0)
         return -1;
@@ -17879,19 +18564,17 @@ qemuDomainGetStatsCpuCgroup(virDomainObj *dom,
     unsigned long long cpu_time = 0;
     unsigned long long user_time = 0;
     unsigned long long sys_time = 0;
-    int err = 0;
 
     if (!priv->cgroup)
         return 0;
 
-    err = virCgroupGetCpuacctUsage(priv->cgroup, &cpu_time);
-    if (!err && virTypedParamListAddULLong(params, cpu_time, "cpu.time") < 0)
-        return -1;
+    if (virCgroupGetCpuacctTimes(priv->cgroup, &cpu_time,
+                                 &user_time, &sys_time) < 0)
+        return 0;
 
-    err = virCgroupGetCpuacctStat(priv->cgroup, &user_time, &sys_time);
-    if (!err && virTypedParamListAddULLong(params, user_time, "cpu.user") < 0)
-        return -1;
-    if (!err && virTypedParamListAddULLong(params, sys_time, "cpu.system") < 0)
+    if (virTypedParamListAddULLong(params, cpu_time, "cpu.time") < 0 ||
+        virTypedParamListAddULLong(params, user_time, "cpu.user") < 0 ||
+        virTypedParamListAddULLong(params, sys_time, "cpu.system") < 0)
         return -1;
 
     return 0;
@@ -17919,7 +18602,8 @@ static int
 qemuDomainGetStatsCpu(virQEMUDriver *driver,
                       virDomainObj *dom,
                       virTypedParamList *params,
-                      unsigned int privflags G_GNUC_UNUSED)
+                      unsigned int privflags G_GNUC_UNUSED,
+                      qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     if (qemuDomainGetStatsCpuCgroup(dom, params) < 0)
         return -1;
@@ -17938,7 +18622,8 @@ static int
 qemuDomainGetStatsMemory(virQEMUDriver *driver,
                          virDomainObj *dom,
                          virTypedParamList *params,
-                         unsigned int privflags G_GNUC_UNUSED)
+                         unsigned int privflags G_GNUC_UNUSED,
+                         qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 
 {
     return qemuDomainGetStatsMemoryBandwidth(driver, dom, params);
@@ -17949,11 +18634,14 @@ static int
 qemuDomainGetStatsBalloon(virQEMUDriver *driver,
                           virDomainObj *dom,
                           virTypedParamList *params,
-                          unsigned int privflags)
+                          unsigned int privflags,
+                          qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     virDomainMemoryStatStruct stats[VIR_DOMAIN_MEMORY_STAT_NR];
     int nr_stats;
     unsigned long long cur_balloon = 0;
+    qemuDomainStatsCache *cache = &QEMU_DOMAIN_PRIVATE(dom)->statsCache;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     size_t i;
 
     if (!virDomainDefHasMemballoon(dom->def)) {
@@ -17969,13 +18657,27 @@ qemuDomainGetStatsBalloon(virQEMUDriver *driver,
                                    "balloon.maximum") < 0)
         return -1;
 
-    if (!HAVE_JOB(privflags) || !virDomainObjIsActive(dom))
+    if (!virDomainObjIsActive(dom))
         return 0;
 
-    nr_stats = qemuDomainMemoryStatsInternal(driver, dom, stats,
-                                             VIR_DOMAIN_MEMORY_STAT_NR);
-    if (nr_stats < 0)
-        return 0;
+    if (qemuDomainStatsCacheIsFresh(cache->balloonStamp, cfg->statsCacheMaxAge)) {
+        nr_stats = cache->nballoon;
+        memcpy(stats, cache->balloon, sizeof(stats[0]) * nr_stats);
+    } else {
+        if (!HAVE_JOB(privflags))
+            return 0;
+
+        nr_stats = qemuDomainMemoryStatsInternal(driver, dom, stats,
+                                                 VIR_DOMAIN_MEMORY_STAT_NR);
+        if (nr_stats < 0)
+            return 0;
+
+        if (cfg->statsCacheMaxAge > 0) {
+            memcpy(cache->balloon, stats, sizeof(stats[0]) * nr_stats);
+            cache->nballoon = nr_stats;
+            cache->balloonStamp = g_get_monotonic_time() / 1000;
+        }
+    }
 
 #define STORE_MEM_RECORD(TAG, NAME) \
     if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_ ##TAG) \
@@ -18003,36 +18705,181 @@ qemuDomainGetStatsBalloon(virQEMUDriver *driver,
 }
 
 
+/**
+ * qemuDomainAddStatsFromHashTable:
+ * @stats: hash table of values as returned by qemuMonitorExtractQueryStats
+ * @schema: array of statistics known by QEMU
+ * @nschema: number of elements in @schema
+ * @target: target the values in @stats belong to
+ * @params: typed parameter list to add the values to
+ * @prefix: prefix of the parameter names, e.g. "vm" or "vcpu.0"
+ *
+ * Converts statistics reported via query-stats into typed parameters.
+ * Cumulative, instantaneous and peak values are stored with the "sum",
+ * "cur" and "max" suffix respectively, boolean values are stored as is.
+ * Histograms are not reported.
+ */
 static int
-qemuDomainGetStatsVcpu(virQEMUDriver *driver,
-                       virDomainObj *dom,
-                       virTypedParamList *params,
-                       unsigned int privflags)
+qemuDomainAddStatsFromHashTable(GHashTable *stats,
+                                qemuMonitorQueryStatsSchemaData *schema,
+                                size_t nschema,
+                                qemuMonitorQueryStatsTargetType target,
+                                virTypedParamList *params,
+                                const char *prefix)
 {
-    virDomainVcpuDef *vcpu;
-    qemuDomainVcpuPrivate *vcpupriv;
     size_t i;
-    int ret = -1;
-    virVcpuInfoPtr cpuinfo = NULL;
-    g_autofree unsigned long long *cpuwait = NULL;
-    g_autofree unsigned long long *cpudelay = NULL;
 
-    if (virTypedParamListAddUInt(params, virDomainDefGetVcpus(dom->def),
-                                 "vcpu.current") < 0)
-        return -1;
+    for (i = 0; i < nschema; i++) {
+        virJSONValue *value;
+        unsigned long long num;
+        const char *suffix = NULL;
 
-    if (virTypedParamListAddUInt(params, virDomainDefGetVcpusMax(dom->def),
-                                 "vcpu.maximum") < 0)
-        return -1;
+        if (schema[i].target != target)
+            continue;
 
-    cpuinfo = g_new0(virVcpuInfo, virDomainDefGetVcpus(dom->def));
-    cpuwait = g_new0(unsigned long long, virDomainDefGetVcpus(dom->def));
-    cpudelay = g_new0(unsigned long long, virDomainDefGetVcpus(dom->def));
+        if (!(value = g_hash_table_lookup(stats, schema[i].name)))
+            continue;
 
-    if (HAVE_JOB(privflags) && virDomainObjIsActive(dom) &&
-        qemuDomainRefreshVcpuHalted(driver, dom, QEMU_ASYNC_JOB_NONE) < 0) {
-            /* it's ok to be silent and go ahead, because halted vcpu info
-             * wasn't here from the beginning */
+        if (schema[i].unit == QEMU_MONITOR_QUERY_STATS_UNIT_BOOLEAN) {
+            bool val;
+
+            if (virJSONValueGetBoolean(value, &val) < 0)
+                continue;
+
+            if (virTypedParamListAddBoolean(params, val, "%s.%s",
+                                            prefix, schema[i].name) < 0)
+                return -1;
+
+            continue;
+        }
+
+        switch (schema[i].type) {
+        case QEMU_MONITOR_QUERY_STATS_TYPE_CUMULATIVE:
+            suffix = "sum";
+            break;
+        case QEMU_MONITOR_QUERY_STATS_TYPE_INSTANT:
+            suffix = "cur";
+            break;
+        case QEMU_MONITOR_QUERY_STATS_TYPE_PEAK:
+            suffix = "max";
+            break;
+        case QEMU_MONITOR_QUERY_STATS_TYPE_LINEAR_HISTOGRAM:
+        case QEMU_MONITOR_QUERY_STATS_TYPE_LOG2_HISTOGRAM:
+        case QEMU_MONITOR_QUERY_STATS_TYPE_LAST:
+            break;
+        }
+
+        if (!suffix || virJSONValueGetNumberUlong(value, &num) < 0)
+            continue;
+
+        if (virTypedParamListAddULLong(params, num, "%s.%s.%s",
+                                       prefix, schema[i].name, suffix) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * qemuDomainGetStatsVcpuQueryStats:
+ *
+ * Fetches the KVM statistics of all vCPUs of @dom with a single
+ * query-stats command and adds them as "vcpu.<num>.<name>.<suffix>".
+ * Failure to fetch the data is not fatal.
+ */
+static int
+qemuDomainGetStatsVcpuQueryStats(virQEMUDriver *driver,
+                                 virDomainObj *dom,
+                                 virTypedParamList *params)
+{
+    qemuDomainObjPrivate *priv = dom->privateData;
+    qemuMonitorQueryStatsSchemaData *schema;
+    size_t nschema;
+    g_autoptr(virJSONValue) queried = NULL;
+    size_t i;
+    size_t j;
+
+    if (!virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_QUERY_STATS) ||
+        !(schema = virQEMUCapsGetStatsSchema(priv->qemuCaps, &nschema)))
+        return 0;
+
+    qemuDomainObjEnterMonitor(driver, dom);
+    queried = qemuMonitorQueryStats(priv->mon, QEMU_MONITOR_QUERY_STATS_TARGET_VCPU);
+    if (qemuDomainObjExitMonitor(driver, dom) < 0)
+        return -1;
+
+    if (!queried) {
+        virResetLastError();
+        return 0;
+    }
+
+    for (i = 0; i < virJSONValueArraySize(queried); i++) {
+        virJSONValue *entry = virJSONValueArrayGet(queried, i);
+        const char *qomPath = virJSONValueObjectGetString(entry, "qom-path");
+        g_autoptr(GHashTable) stats = NULL;
+        g_autofree char *prefix = NULL;
+
+        if (!qomPath)
+            continue;
+
+        for (j = 0; j < virDomainDefGetVcpusMax(dom->def); j++) {
+            virDomainVcpuDef *vcpu = virDomainDefGetVcpu(dom->def, j);
+            qemuDomainVcpuPrivate *vcpupriv = QEMU_DOMAIN_VCPU_PRIVATE(vcpu);
+
+            if (vcpu->online && STREQ_NULLABLE(vcpupriv->qomPath, qomPath))
+                break;
+        }
+
+        if (j == virDomainDefGetVcpusMax(dom->def))
+            continue;
+
+        if (!(stats = qemuMonitorExtractQueryStats(entry)))
+            continue;
+
+        prefix = g_strdup_printf("vcpu.%zu", j);
+
+        if (qemuDomainAddStatsFromHashTable(stats, schema, nschema,
+                                            QEMU_MONITOR_QUERY_STATS_TARGET_VCPU,
+                                            params, prefix) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsVcpu(virQEMUDriver *driver,
+                       virDomainObj *dom,
+                       virTypedParamList *params,
+                       unsigned int privflags,
+                       qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
+{
+    virDomainVcpuDef *vcpu;
+    qemuDomainVcpuPrivate *vcpupriv;
+    size_t i;
+    int ret = -1;
+    virVcpuInfoPtr cpuinfo = NULL;
+    g_autofree unsigned long long *cpuwait = NULL;
+    g_autofree unsigned long long *cpudelay = NULL;
+
+    if (virTypedParamListAddUInt(params, virDomainDefGetVcpus(dom->def),
+                                 "vcpu.current") < 0)
+        return -1;
+
+    if (virTypedParamListAddUInt(params, virDomainDefGetVcpusMax(dom->def),
+                                 "vcpu.maximum") < 0)
+        return -1;
+
+    cpuinfo = g_new0(virVcpuInfo, virDomainDefGetVcpus(dom->def));
+    cpuwait = g_new0(unsigned long long, virDomainDefGetVcpus(dom->def));
+    cpudelay = g_new0(unsigned long long, virDomainDefGetVcpus(dom->def));
+
+    if (HAVE_JOB(privflags) && virDomainObjIsActive(dom) &&
+        qemuDomainRefreshVcpuHalted(driver, dom, QEMU_ASYNC_JOB_NONE) < 0) {
+            /* it's ok to be silent and go ahead, because halted vcpu info
+             * wasn't here from the beginning */
             virResetLastError();
     }
 
@@ -18080,6 +18927,10 @@ qemuDomainGetStatsVcpu(virQEMUDriver *driver,
         }
     }
 
+    if (HAVE_JOB(privflags) && virDomainObjIsActive(dom) &&
+        qemuDomainGetStatsVcpuQueryStats(driver, dom, params) < 0)
+        goto cleanup;
+
     ret = 0;
 
  cleanup:
@@ -18096,7 +18947,8 @@ static int
 qemuDomainGetStatsInterface(virQEMUDriver *driver G_GNUC_UNUSED,
                             virDomainObj *dom,
                             virTypedParamList *params,
-                            unsigned int privflags G_GNUC_UNUSED)
+                            unsigned int privflags G_GNUC_UNUSED,
+                            qemuDomainGetStatsBulk *bulk)
 {
     size_t i;
     struct _virDomainInterfaceStats tmp;
@@ -18123,13 +18975,15 @@ qemuDomainGetStatsInterface(virQEMUDriver *driver G_GNUC_UNUSED,
             return -1;
 
         if (actualType == VIR_DOMAIN_NET_TYPE_VHOSTUSER) {
-            if (virNetDevOpenvswitchInterfaceStats(net->ifname, &tmp) < 0) {
+            if (virNetDevOpenvswitchInterfaceStatsLookup(qemuDomainGetStatsBulkOVS(bulk),
+                                                         net->ifname, &tmp) < 0) {
                 virResetLastError();
                 continue;
             }
         } else {
-            if (virNetDevTapInterfaceStats(net->ifname, &tmp,
-                                           !virDomainNetTypeSharesHostView(net)) < 0) {
+            if (virNetDevTapInterfaceStatsLookup(bulk ? bulk->netstats : NULL,
+                                                 net->ifname, &tmp,
+                                                 !virDomainNetTypeSharesHostView(net)) < 0) {
                 virResetLastError();
                 continue;
             }
@@ -18515,7 +19369,8 @@ static int
 qemuDomainGetStatsBlock(virQEMUDriver *driver,
                         virDomainObj *dom,
                         virTypedParamList *params,
-                        unsigned int privflags)
+                        unsigned int privflags,
+                        qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     size_t i;
     int rc;
@@ -18530,16 +19385,22 @@ qemuDomainGetStatsBlock(virQEMUDriver *driver,
     int count_index = -1;
     size_t visited = 0;
     bool visitBacking = !!(privflags & QEMU_DOMAIN_STATS_BACKING);
-
-    if (HAVE_JOB(privflags) && virDomainObjIsActive(dom)) {
+    qemuDomainStatsCache *cache = &priv->statsCache;
+
+    /* Stats refreshed from named nodes data are modified while being
+     * reported, which prevents sharing them. */
+    if (!fetchnodedata && virDomainObjIsActive(dom) &&
+        qemuDomainStatsCacheIsFresh(cache->blockStamp, cfg->statsCacheMaxAge)) {
+        stats = g_hash_table_ref(cache->blockStats);
+    } else if (HAVE_JOB(privflags) && virDomainObjIsActive(dom)) {
         qemuDomainObjEnterMonitor(driver, dom);
 
-        rc = qemuMonitorGetAllBlockStatsInfo(priv->mon, &stats);
+        if (blockdev) {
+            rc = qemuMonitorGetAllBlockStatsInfoBlockdev(priv->mon, &stats);
+        } else {
+            rc = qemuMonitorGetAllBlockStatsInfo(priv->mon, &stats);
 
-        if (rc >= 0) {
-            if (blockdev)
-                rc = qemuMonitorBlockStatsUpdateCapacityBlockdev(priv->mon, stats);
-            else
+            if (rc >= 0)
                 ignore_value(qemuMonitorBlockStatsUpdateCapacity(priv->mon, stats));
         }
 
@@ -18552,6 +19413,12 @@ qemuDomainGetStatsBlock(virQEMUDriver *driver,
         /* failure to retrieve stats is fine at this point */
         if (rc < 0 || (fetchnodedata && !nodedata))
             virResetLastError();
+
+        if (rc >= 0 && stats && !fetchnodedata && cfg->statsCacheMaxAge > 0) {
+            g_clear_pointer(&cache->blockStats, g_hash_table_unref);
+            cache->blockStats = g_hash_table_ref(stats);
+            cache->blockStamp = g_get_monotonic_time() / 1000;
+        }
     }
 
     if (nodedata &&
@@ -18583,7 +19450,8 @@ static int
 qemuDomainGetStatsIOThread(virQEMUDriver *driver,
                            virDomainObj *dom,
                            virTypedParamList *params,
-                           unsigned int privflags)
+                           unsigned int privflags,
+                           qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     qemuDomainObjPrivate *priv = dom->privateData;
     size_t i;
@@ -18659,7 +19527,8 @@ static int
 qemuDomainGetStatsPerf(virQEMUDriver *driver G_GNUC_UNUSED,
                        virDomainObj *dom,
                        virTypedParamList *params,
-                       unsigned int privflags G_GNUC_UNUSED)
+                       unsigned int privflags G_GNUC_UNUSED,
+                       qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
     size_t i;
     qemuDomainObjPrivate *priv = dom->privateData;
@@ -18695,31 +19564,223 @@ static int
 qemuDomainGetStatsDirtyRate(virQEMUDriver *driver,
                             virDomainObj *dom,
                             virTypedParamList *params,
-                            unsigned int privflags)
+                            unsigned int privflags,
+                            qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
 {
-    qemuMonitorDirtyRateInfo info;
+    qemuDomainObjPrivate *priv = dom->privateData;
+    g_autoptr(qemuMonitorDirtyRateInfo) fetched = NULL;
+    qemuMonitorDirtyRateInfo *info;
+    size_t i;
 
-    if (!HAVE_JOB(privflags) || !virDomainObjIsActive(dom))
+    if (!virDomainObjIsActive(dom))
         return 0;
 
-    if (qemuDomainGetStatsDirtyRateMon(driver, dom, &info) < 0)
-        return -1;
+    /* A completed measurement doesn't change until another calculation
+     * is started, so there's no need to ask QEMU again (and no need for
+     * a job either). */
+    if (!(info = priv->statsCache.dirtyRate)) {
+        if (!HAVE_JOB(privflags))
+            return 0;
+
+        info = fetched = g_new0(qemuMonitorDirtyRateInfo, 1);
+
+        if (qemuDomainGetStatsDirtyRateMon(driver, dom, info) < 0)
+            return -1;
+    }
 
-    if (virTypedParamListAddInt(params, info.status,
+    if (virTypedParamListAddInt(params, info->status,
                                 "dirtyrate.calc_status") < 0)
         return -1;
 
-    if (virTypedParamListAddLLong(params, info.startTime,
+    if (virTypedParamListAddLLong(params, info->startTime,
                                   "dirtyrate.calc_start_time") < 0)
         return -1;
 
-    if (virTypedParamListAddInt(params, info.calcTime,
+    if (virTypedParamListAddInt(params, info->calcTime,
                                 "dirtyrate.calc_period") < 0)
         return -1;
 
-    if ((info.status == VIR_DOMAIN_DIRTYRATE_MEASURED) &&
-        virTypedParamListAddLLong(params, info.dirtyRate,
-                                  "dirtyrate.megabytes_per_second") < 0)
+    if (virTypedParamListAddString(params,
+                                   qemuMonitorDirtyRateCalcModeTypeToString(info->mode),
+                                   "dirtyrate.calc_mode") < 0)
+        return -1;
+
+    if (info->status == VIR_DOMAIN_DIRTYRATE_MEASURED) {
+        if (virTypedParamListAddLLong(params, info->dirtyRate,
+                                      "dirtyrate.megabytes_per_second") < 0)
+            return -1;
+
+        if (info->mode == QEMU_MONITOR_DIRTYRATE_CALC_MODE_DIRTY_RING) {
+            for (i = 0; i < info->nvcpus; i++) {
+                if (virTypedParamListAddULLong(params, info->rates[i].value,
+                                               "dirtyrate.vcpu.%d.megabytes_per_second",
+                                               info->rates[i].idx) < 0)
+                    return -1;
+            }
+        }
+
+        if (fetched)
+            priv->statsCache.dirtyRate = g_steal_pointer(&fetched);
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsVm(virQEMUDriver *driver,
+                     virDomainObj *dom,
+                     virTypedParamList *params,
+                     unsigned int privflags,
+                     qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
+{
+    qemuDomainObjPrivate *priv = dom->privateData;
+    qemuMonitorQueryStatsSchemaData *schema;
+    size_t nschema;
+    g_autoptr(virJSONValue) queried = NULL;
+    g_autoptr(GHashTable) stats = NULL;
+    virJSONValue *entry;
+
+    if (!HAVE_JOB(privflags) || !virDomainObjIsActive(dom))
+        return 0;
+
+    if (!(schema = virQEMUCapsGetStatsSchema(priv->qemuCaps, &nschema)))
+        return 0;
+
+    qemuDomainObjEnterMonitor(driver, dom);
+    queried = qemuMonitorQueryStats(priv->mon, QEMU_MONITOR_QUERY_STATS_TARGET_VM);
+    if (qemuDomainObjExitMonitor(driver, dom) < 0)
+        return -1;
+
+    if (!queried) {
+        virResetLastError();
+        return 0;
+    }
+
+    /* there's just one VM wide entry per provider */
+    if (!(entry = virJSONValueArrayGet(queried, 0)) ||
+        !(stats = qemuMonitorExtractQueryStats(entry)))
+        return 0;
+
+    return qemuDomainAddStatsFromHashTable(stats, schema, nschema,
+                                           QEMU_MONITOR_QUERY_STATS_TARGET_VM,
+                                           params, "vm");
+}
+
+
+static int
+qemuDomainGetStatsMonitor(virQEMUDriver *driver G_GNUC_UNUSED,
+                          virDomainObj *dom,
+                          virTypedParamList *params,
+                          unsigned int privflags G_GNUC_UNUSED,
+                          qemuDomainGetStatsBulk *bulk G_GNUC_UNUSED)
+{
+    qemuDomainObjPrivate *priv = dom->privateData;
+    g_autoptr(qemuMonitorStats) stats = NULL;
+    size_t i;
+    size_t j;
+
+    /* The statistics are gathered by libvirt itself, no need to
+     * talk to QEMU and thus no need for a job either */
+    if (!virDomainObjIsActive(dom) || !priv->mon)
+        return 0;
+
+    stats = qemuMonitorGetStats(priv->mon);
+
+    if (virTypedParamListAddUInt(params, stats->pending,
+                                 "monitor.pending") < 0 ||
+        virTypedParamListAddULLong(params, stats->pendingTime,
+                                   "monitor.pending.time") < 0 ||
+        virTypedParamListAddUInt(params, stats->ncommands,
+                                 "monitor.command.count") < 0)
+        return -1;
+
+    for (i = 0; i < stats->ncommands; i++) {
+        qemuMonitorCommandStats *cmd = stats->commands + i;
+
+        if (virTypedParamListAddString(params, cmd->name,
+                                       "monitor.command.%zu.name", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->calls,
+                                       "monitor.command.%zu.calls", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->errors,
+                                       "monitor.command.%zu.errors", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->time,
+                                       "monitor.command.%zu.time", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->timeMax,
+                                       "monitor.command.%zu.time.max", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->bytesSent,
+                                       "monitor.command.%zu.bytes.sent", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->bytesReceived,
+                                       "monitor.command.%zu.bytes.received", i) < 0)
+            return -1;
+
+        for (j = 0; j < QEMU_MONITOR_LATENCY_LAST; j++) {
+            if (virTypedParamListAddULLong(params, cmd->latency[j],
+                                           "monitor.command.%zu.latency.%s", i,
+                                           qemuMonitorLatencyBucketTypeToString(j)) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsBlockJob(virQEMUDriver *driver,
+                           virDomainObj *dom,
+                           virTypedParamList *params,
+                           unsigned int privflags)
+{
+    g_autoptr(GHashTable) blockjobstats = NULL;
+    size_t njobs = 0;
+    size_t i;
+    int rc;
+
+    if (!HAVE_JOB(privflags) || !virDomainObjIsActive(dom))
+        return 0;
+
+    /* a single query returns the progress of all jobs of the domain */
+    qemuDomainObjEnterMonitor(driver, dom);
+    blockjobstats = qemuMonitorGetAllBlockJobInfo(qemuDomainGetMonitor(dom), true);
+    rc = qemuDomainObjExitMonitor(driver, dom);
+
+    if (rc < 0 || !blockjobstats) {
+        virResetLastError();
+        return 0;
+    }
+
+    for (i = 0; i < dom->def->ndisks; i++) {
+        virDomainDiskDef *disk = dom->def->disks[i];
+        g_autoptr(qemuBlockJobData) job = NULL;
+        virDomainBlockJobInfo info = { 0 };
+
+        if (!(job = qemuBlockJobDiskGetJob(disk)))
+            continue;
+
+        if (qemuBlockJobInfoTranslate(g_hash_table_lookup(blockjobstats, job->name),
+                                      &info, job, true) < 0)
+            return -1;
+
+        if (virTypedParamListAddString(params, disk->dst,
+                                       "blockjob.%zu.disk", njobs) < 0 ||
+            virTypedParamListAddInt(params, info.type,
+                                    "blockjob.%zu.type", njobs) < 0 ||
+            virTypedParamListAddULLong(params, info.cur,
+                                       "blockjob.%zu.cur", njobs) < 0 ||
+            virTypedParamListAddULLong(params, info.end,
+                                       "blockjob.%zu.end", njobs) < 0 ||
+            virTypedParamListAddULLong(params, info.bandwidth,
+                                       "blockjob.%zu.bandwidth", njobs) < 0 ||
+            virTypedParamListAddBoolean(params,
+                                        job->state == QEMU_BLOCKJOB_STATE_READY,
+                                        "blockjob.%zu.ready", njobs) < 0)
+            return -1;
+
+        njobs++;
+    }
+
+    if (virTypedParamListAddUInt(params, njobs, "blockjob.count") < 0)
         return -1;
 
     return 0;
@@ -18729,7 +19790,8 @@ typedef int
 (*qemuDomainGetStatsFunc)(virQEMUDriver *driver,
                           virDomainObj *dom,
                           virTypedParamList *list,
-                          unsigned int flags);
+                          unsigned int flags,
+                          qemuDomainGetStatsBulk *bulk);
 
 struct qemuDomainGetStatsWorker {
     qemuDomainGetStatsFunc func;
@@ -18743,6 +19805,11 @@ static virQEMUCapsFlags queryDirtyRateRequired[] = {
     QEMU_CAPS_LAST,
 };
 
+static virQEMUCapsFlags queryStatsRequired[] = {
+    QEMU_CAPS_QUERY_STATS,
+    QEMU_CAPS_LAST,
+};
+
 static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
     { qemuDomainGetStatsState, VIR_DOMAIN_STATS_STATE, false, NULL },
     { qemuDomainGetStatsCpu, VIR_DOMAIN_STATS_CPU_TOTAL, false, NULL },
@@ -18754,6 +19821,9 @@ static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
     { qemuDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD, true, NULL },
     { qemuDomainGetStatsMemory, VIR_DOMAIN_STATS_MEMORY, false, NULL },
     { qemuDomainGetStatsDirtyRate, VIR_DOMAIN_STATS_DIRTYRATE, true, queryDirtyRateRequired },
+    { qemuDomainGetStatsVm, VIR_DOMAIN_STATS_VM, true, queryStatsRequired },
+    { qemuDomainGetStatsMonitor, VIR_DOMAIN_STATS_MONITOR, false, NULL },
+    { qemuDomainGetStatsBlockJob, VIR_DOMAIN_STATS_BLOCKJOB, true, NULL },
     { NULL, 0, false, NULL }
 };
 
@@ -18817,12 +19887,45 @@ qemuDomainGetStatsNeedMonitor(unsigned int stats)
 }
 
 
+/*
+ * Returns the stats groups which can be reported from the statistics
+ * cache of @vm, without talking to the monitor.
+ */
+static unsigned int
+qemuDomainGetStatsCached(virQEMUDriver *driver,
+                         virDomainObj *vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivate *priv = vm->privateData;
+    unsigned int ret = 0;
+
+    if (!virDomainObjIsActive(vm))
+        return 0;
+
+    if (qemuDomainStatsCacheIsFresh(priv->statsCache.balloonStamp,
+                                    cfg->statsCacheMaxAge))
+        ret |= VIR_DOMAIN_STATS_BALLOON;
+
+    if (qemuDomainStatsCacheIsFresh(priv->statsCache.blockStamp,
+                                    cfg->statsCacheMaxAge))
+        ret |= VIR_DOMAIN_STATS_BLOCK;
+
+    return ret;
+}
+
+
+/*
+ * Gathers @stats of @dom into @record. The domain of the record is
+ * only filled in if @conn is given.
+ */
 static int
-qemuDomainGetStats(virConnectPtr conn,
+qemuDomainGetStats(virQEMUDriver *driver,
+                   virConnectPtr conn,
                    virDomainObj *dom,
                    unsigned int stats,
                    virDomainStatsRecordPtr *record,
-                   unsigned int flags)
+                   unsigned int flags,
+                   qemuDomainGetStatsBulk *bulk)
 {
     g_autofree virDomainStatsRecordPtr tmp = NULL;
     g_autoptr(virTypedParamList) params = NULL;
@@ -18830,26 +19933,236 @@ qemuDomainGetStats(virConnectPtr conn,
 
     params = g_new0(virTypedParamList, 1);
 
+    /* Domains tend to have similar number of stats, start with as many
+     * as the previous one had to avoid growing the list step by step */
+    if (bulk)
+        virTypedParamListReserve(params, g_atomic_int_get(&bulk->nparamsHint));
+
     for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
         if (stats & qemuDomainGetStatsWorkers[i].stats) {
-            if (qemuDomainGetStatsWorkers[i].func(conn->privateData, dom, params,
-                                                  flags) < 0)
+            if (qemuDomainGetStatsWorkers[i].func(driver, dom, params,
+                                                  flags, bulk) < 0)
                 return -1;
         }
     }
 
     tmp = g_new0(virDomainStatsRecord, 1);
 
-    if (!(tmp->dom = virGetDomain(conn, dom->def->name,
+    if (conn &&
+        !(tmp->dom = virGetDomain(conn, dom->def->name,
                                   dom->def->uuid, dom->def->id)))
         return -1;
 
+    if (bulk)
+        g_atomic_int_set(&bulk->nparamsHint, params->npar);
+
     tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
     *record = g_steal_pointer(&tmp);
     return 0;
 }
 
 
+/*
+ * Gathers statistics of a single @vm for qemuConnectGetAllDomainStats,
+ * stores them into @record (which is left NULL if there are none).
+ * @conn may be NULL if the caller is interested only in the parameters.
+ * @bulk may be NULL if there is no data shared with other domains.
+ */
+static int
+qemuConnectGetAllDomainStatsOne(virQEMUDriver *driver,
+                                virConnectPtr conn,
+                                virDomainObj *vm,
+                                unsigned int stats,
+                                virDomainStatsRecordPtr *record,
+                                unsigned int flags,
+                                qemuDomainGetStatsBulk *bulk)
+{
+    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
+    unsigned int privflags = 0;
+    unsigned int requestedStats = stats;
+    unsigned int domflags = 0;
+    int ret = -1;
+
+    virObjectLock(vm);
+
+    if (qemuDomainGetStatsCheckSupport(&requestedStats, enforce, vm) < 0)
+        goto cleanup;
+
+    if (qemuDomainGetStatsNeedMonitor(requestedStats &
+                                      ~qemuDomainGetStatsCached(driver, vm)))
+        privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+
+    if (HAVE_JOB(privflags)) {
+        int rv;
+
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
+        else
+            rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+
+        if (rv == 0)
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    ret = qemuDomainGetStats(driver, conn, vm, requestedStats, record,
+                             domflags, bulk);
+
+    if (HAVE_JOB(domflags))
+        qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    virObjectUnlock(vm);
+    return ret;
+}
+
+
+typedef struct _qemuDomainStatsJobCtx qemuDomainStatsJobCtx;
+struct _qemuDomainStatsJobCtx {
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+typedef struct _qemuDomainStatsJob qemuDomainStatsJob;
+struct _qemuDomainStatsJob {
+    qemuDomainStatsJobCtx *ctx;
+    virIdentity *identity;
+    virConnectPtr conn;
+    virDomainObj *vm;
+    unsigned int stats;
+    unsigned int flags;
+    qemuDomainGetStatsBulk *bulk;
+
+    int rc;
+    virErrorPtr err;
+    virDomainStatsRecordPtr record;
+};
+
+
+static void
+qemuDomainStatsJobHandler(void *jobdata,
+                          void *opaque G_GNUC_UNUSED)
+{
+    qemuDomainStatsJob *job = jobdata;
+    qemuDomainStatsJobCtx *ctx = job->ctx;
+
+    virIdentitySetCurrent(job->identity);
+
+    job->rc = qemuConnectGetAllDomainStatsOne(job->conn->privateData, job->conn,
+                                              job->vm, job->stats,
+                                              &job->record, job->flags,
+                                              job->bulk);
+    if (job->rc < 0)
+        virErrorPreserveLast(&job->err);
+
+    virIdentitySetCurrent(NULL);
+
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/*
+ * Gathers statistics of @vms on driver->statsPool and stores them
+ * into @records in the order of @vms. Returns the number of records
+ * filled in, or -1 if gathering stats of any of the domains failed.
+ */
+static int
+qemuConnectGetAllDomainStatsParallel(virConnectPtr conn,
+                                     virDomainObj **vms,
+                                     size_t nvms,
+                                     unsigned int stats,
+                                     virDomainStatsRecordPtr *records,
+                                     unsigned int flags,
+                                     qemuDomainGetStatsBulk *bulk)
+{
+    virQEMUDriver *driver = conn->privateData;
+    g_autoptr(virIdentity) identity = virIdentityGetCurrent();
+    g_autofree qemuDomainStatsJob *jobs = g_new0(qemuDomainStatsJob, nvms);
+    qemuDomainStatsJobCtx ctx = { .pending = 0 };
+    int nrecords = 0;
+    size_t i;
+    int ret = -1;
+
+    if (virMutexInit(&ctx.lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return -1;
+    }
+
+    if (virCondInit(&ctx.cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&ctx.lock);
+        return -1;
+    }
+
+    for (i = 0; i < nvms; i++) {
+        qemuDomainStatsJob *job = &jobs[i];
+
+        job->ctx = &ctx;
+        job->identity = identity;
+        job->conn = conn;
+        job->vm = vms[i];
+        job->stats = stats;
+        job->flags = flags;
+        job->bulk = bulk;
+
+        virMutexLock(&ctx.lock);
+        ctx.pending++;
+        virMutexUnlock(&ctx.lock);
+
+        if (virThreadPoolSendJob(driver->statsPool, 0, job) < 0) {
+            virMutexLock(&ctx.lock);
+            ctx.pending--;
+            virMutexUnlock(&ctx.lock);
+
+            /* Do it ourselves if the job can't be queued */
+            virResetLastError();
+            job->rc = qemuConnectGetAllDomainStatsOne(driver, conn, job->vm,
+                                                      stats, &job->record,
+                                                      flags, bulk);
+            if (job->rc < 0)
+                virErrorPreserveLast(&job->err);
+        }
+    }
+
+    virMutexLock(&ctx.lock);
+    while (ctx.pending > 0)
+        ignore_value(virCondWait(&ctx.cond, &ctx.lock));
+    virMutexUnlock(&ctx.lock);
+
+    virCondDestroy(&ctx.cond);
+    virMutexDestroy(&ctx.lock);
+
+    for (i = 0; i < nvms; i++) {
+        if (jobs[i].rc < 0) {
+            virErrorRestore(&jobs[i].err);
+            goto cleanup;
+        }
+
+        if (jobs[i].record)
+            records[nrecords++] = g_steal_pointer(&jobs[i].record);
+    }
+
+    ret = nrecords;
+
+ cleanup:
+    for (i = 0; i < nvms; i++) {
+        if (jobs[i].record) {
+            virDomainStatsRecordPtr tmp[] = { jobs[i].record, NULL };
+            virDomainStatsRecordListFree(tmp);
+        }
+        virFreeError(jobs[i].err);
+    }
+    return ret;
+}
+
+
 static int
 qemuConnectGetAllDomainStats(virConnectPtr conn,
                              virDomainPtr *doms,
@@ -18863,7 +20176,9 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     virDomainObj **vms = NULL;
     size_t nvms;
     virDomainStatsRecordPtr *tmpstats = NULL;
-    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
+    virDomainDriverStatsCursor *cursor = NULL;
+    g_autoptr(GHashTable) netstats = NULL;
+    qemuDomainGetStatsBulk bulk = { 0 };
     int nstats = 0;
     size_t i;
     int ret = -1;
@@ -18876,11 +20191,16 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
-                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED, -1);
 
     if (virConnectGetAllDomainStatsEnsureACL(conn) < 0)
         return -1;
 
+    if ((flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_CHANGED) &&
+        !(cursor = virQEMUDriverGetStatsCursor(driver, conn)))
+        return -1;
+
     if (ndoms) {
         if (virDomainObjListConvert(driver->domains, conn, doms, ndoms, &vms,
                                     &nvms, virConnectGetAllDomainStatsCheckACL,
@@ -18895,69 +20215,413 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
 
     tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
 
+    qemuDomainGetStatsBulkInit(&bulk);
+
+    if (nvms > 1 && (stats == 0 || stats & VIR_DOMAIN_STATS_INTERFACE)) {
+        /* One netlink dump instead of a /proc/net/dev read per NIC */
+        if (!(netstats = virNetDevTapInterfaceStatsAll()))
+            virResetLastError();
+        bulk.netstats = netstats;
+    }
+
+    if (driver->statsPool && nvms > 1) {
+        if ((nstats = qemuConnectGetAllDomainStatsParallel(conn, vms, nvms,
+                                                           stats, tmpstats,
+                                                           flags, &bulk)) < 0)
+            goto cleanup;
+    } else {
+        for (i = 0; i < nvms; i++) {
+            virDomainStatsRecordPtr tmp = NULL;
+
+            if (qemuConnectGetAllDomainStatsOne(driver, conn, vms[i], stats,
+                                                &tmp, flags, &bulk) < 0)
+                goto cleanup;
+
+            if (tmp)
+                tmpstats[nstats++] = tmp;
+        }
+    }
+
+    if (cursor)
+        virDomainDriverStatsCursorApply(cursor, tmpstats, nstats, ndoms == 0);
+
+    *retStats = g_steal_pointer(&tmpstats);
+
+    ret = nstats;
+
+ cleanup:
+    virErrorPreserveLast(&orig_err);
+    qemuDomainGetStatsBulkClear(&bulk);
+    virDomainStatsRecordListFree(tmpstats);
+    virObjectListFreeCount(vms, nvms);
+    virErrorRestore(&orig_err);
+
+    return ret;
+}
+
+
+/*
+ * Periodic delivery of domain statistics as VIR_DOMAIN_EVENT_ID_STATS
+ * events. Every connection may have one subscription. A single thread
+ * collects the statistics once they are due and queues one event per
+ * domain and subscriber, addressed to the subscribed connection only.
+ * Subscribers which are due at the same time and ask for the same data
+ * share one collection, the statistics cache of the domains takes care
+ * of subscribers with differing schedules.
+ */
+typedef struct _qemuStatsSubscription qemuStatsSubscription;
+struct _qemuStatsSubscription {
+    unsigned long long connSerial;
+    unsigned int stats;
+    unsigned int flags;
+    unsigned long long interval; /* milliseconds */
+    unsigned long long deadline; /* milliseconds since the epoch */
+};
+
+struct _qemuStatsPush {
+    virMutex lock;
+    virCond cond;
+    virThread thread;
+    bool threadActive;
+    bool quit;
+
+    qemuStatsSubscription *subs;
+    size_t nsubs;
+};
+
+
+static qemuStatsPush *
+qemuStatsPushNew(void)
+{
+    g_autofree qemuStatsPush *push = g_new0(qemuStatsPush, 1);
+
+    if (virMutexInit(&push->lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return NULL;
+    }
+
+    if (virCondInit(&push->cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&push->lock);
+        return NULL;
+    }
+
+    return g_steal_pointer(&push);
+}
+
+
+/*
+ * Tells the delivery thread to quit, and if @wait is true waits for
+ * it to do so. No new subscriptions are accepted afterwards.
+ */
+static void
+qemuStatsPushStop(qemuStatsPush *push,
+                  bool wait)
+{
+    bool join = false;
+
+    virMutexLock(&push->lock);
+    push->quit = true;
+    virCondSignal(&push->cond);
+    if (wait && push->threadActive) {
+        push->threadActive = false;
+        join = true;
+    }
+    virMutexUnlock(&push->lock);
+
+    if (join)
+        virThreadJoin(&push->thread);
+}
+
+
+static void
+qemuStatsPushFree(qemuStatsPush *push)
+{
+    if (!push)
+        return;
+
+    qemuStatsPushStop(push, true);
+
+    g_free(push->subs);
+    virCondDestroy(&push->cond);
+    virMutexDestroy(&push->lock);
+    g_free(push);
+}
+
+
+static bool
+qemuStatsPushQuitting(qemuStatsPush *push)
+{
+    bool ret;
+
+    virMutexLock(&push->lock);
+    ret = push->quit;
+    virMutexUnlock(&push->lock);
+
+    return ret;
+}
+
+
+static void
+qemuStatsPushUnsubscribe(qemuStatsPush *push,
+                         unsigned long long connSerial)
+{
+    size_t i;
+
+    virMutexLock(&push->lock);
+    for (i = 0; i < push->nsubs; i++) {
+        if (push->subs[i].connSerial == connSerial) {
+            VIR_DELETE_ELEMENT(push->subs, i, push->nsubs);
+            break;
+        }
+    }
+    virMutexUnlock(&push->lock);
+}
+
+
+static void
+qemuStatsPushRecordFree(virDomainStatsRecordPtr record)
+{
+    if (!record)
+        return;
+
+    virTypedParamsFree(record->params, record->nparams);
+    g_free(record);
+}
+
+
+/*
+ * Collects statistics of all domains for the @nsubs subscriptions in
+ * @subs and queues the resulting events.
+ */
+static void
+qemuStatsPushDeliver(virQEMUDriver *driver,
+                     qemuStatsSubscription *subs,
+                     size_t nsubs)
+{
+    virDomainObj **vms = NULL;
+    size_t nvms = 0;
+    g_autoptr(GHashTable) netstats = NULL;
+    qemuDomainGetStatsBulk bulk;
+    size_t i;
+
+    /* Access control is done when relaying the events to clients */
+    if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms,
+                                NULL, 0) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    qemuDomainGetStatsBulkInit(&bulk);
+
+    for (i = 0; i < nsubs; i++) {
+        if (subs[i].stats == 0 || subs[i].stats & VIR_DOMAIN_STATS_INTERFACE) {
+            if (!(netstats = virNetDevTapInterfaceStatsAll()))
+                virResetLastError();
+            bulk.netstats = netstats;
+            break;
+        }
+    }
+
     for (i = 0; i < nvms; i++) {
         virDomainObj *vm = vms[i];
-        virDomainStatsRecordPtr tmp = NULL;
-        unsigned int privflags = 0;
-        unsigned int requestedStats = stats;
-        unsigned int domflags = 0;
+        g_autofree virDomainStatsRecordPtr *records = NULL;
+        size_t j;
 
-        virObjectLock(vm);
+        if (qemuStatsPushQuitting(driver->statsPush))
+            break;
 
-        if (qemuDomainGetStatsCheckSupport(&requestedStats, enforce, vm) < 0) {
+        records = g_new0(virDomainStatsRecordPtr, nsubs);
+
+        for (j = 0; j < nsubs; j++) {
+            virTypedParameterPtr params = NULL;
+            int nparams = 0;
+            virObjectEvent *event;
+            size_t k;
+
+            for (k = 0; k < j; k++) {
+                if (subs[k].stats == subs[j].stats &&
+                    subs[k].flags == subs[j].flags)
+                    break;
+            }
+
+            if (k < j) {
+                if (!records[k])
+                    continue;
+            } else {
+                if (qemuConnectGetAllDomainStatsOne(driver, NULL, vm,
+                                                    subs[j].stats,
+                                                    &records[j],
+                                                    subs[j].flags,
+                                                    &bulk) < 0) {
+                    VIR_DEBUG("Failed to collect stats of domain %s: %s",
+                              vm->def->name, virGetLastErrorMessage());
+                    virResetLastError();
+                    continue;
+                }
+
+                if (!records[j])
+                    continue;
+                k = j;
+            }
+
+            if (virTypedParamsCopy(&params, records[k]->params,
+                                   records[k]->nparams) < 0) {
+                virResetLastError();
+                continue;
+            }
+            nparams = records[k]->nparams;
+
+            virObjectLock(vm);
+            event = virDomainEventStatsNewFromObj(vm, subs[j].connSerial,
+                                                  params, nparams);
             virObjectUnlock(vm);
-            goto cleanup;
+
+            virObjectEventStateQueue(driver->domainEventState, event);
         }
 
-        if (qemuDomainGetStatsNeedMonitor(requestedStats))
-            privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+        for (j = 0; j < nsubs; j++)
+            qemuStatsPushRecordFree(records[j]);
+    }
 
-        if (HAVE_JOB(privflags)) {
-            int rv;
+    qemuDomainGetStatsBulkClear(&bulk);
+    virObjectListFreeCount(vms, nvms);
+}
 
-            if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
-                rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
-            else
-                rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
 
-            if (rv == 0)
-                domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+static void
+qemuStatsPushThread(void *opaque)
+{
+    virQEMUDriver *driver = opaque;
+    qemuStatsPush *push = driver->statsPush;
+
+    virMutexLock(&push->lock);
+    while (!push->quit) {
+        g_autofree qemuStatsSubscription *due = NULL;
+        size_t ndue = 0;
+        unsigned long long now;
+        unsigned long long next = 0;
+        size_t i;
+
+        if (virTimeMillisNow(&now) < 0) {
+            VIR_WARN("Unable to get current time, stopping stats delivery");
+            virResetLastError();
+            break;
         }
-        /* else: without a job it's still possible to gather some data */
 
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
-        if (qemuDomainGetStats(conn, vm, requestedStats, &tmp, domflags) < 0) {
-            if (HAVE_JOB(domflags) && vm)
-                qemuDomainObjEndJob(driver, vm);
+        for (i = 0; i < push->nsubs; i++) {
+            qemuStatsSubscription *sub = &push->subs[i];
 
-            virObjectUnlock(vm);
-            goto cleanup;
+            if (sub->deadline <= now) {
+                VIR_APPEND_ELEMENT_COPY(due, ndue, *sub);
+
+                /* Don't try to catch up with missed deliveries */
+                sub->deadline += sub->interval;
+                if (sub->deadline <= now)
+                    sub->deadline = now + sub->interval;
+            }
+
+            if (next == 0 || sub->deadline < next)
+                next = sub->deadline;
+        }
+
+        if (ndue == 0) {
+            if (next == 0)
+                ignore_value(virCondWait(&push->cond, &push->lock));
+            else
+                ignore_value(virCondWaitUntil(&push->cond, &push->lock, next));
+            continue;
         }
 
-        if (tmp)
-            tmpstats[nstats++] = tmp;
+        virMutexUnlock(&push->lock);
+        qemuStatsPushDeliver(driver, due, ndue);
+        virMutexLock(&push->lock);
+    }
+    virMutexUnlock(&push->lock);
+}
+
 
-        if (HAVE_JOB(domflags))
-            qemuDomainObjEndJob(driver, vm);
+static int
+qemuStatsPushSubscribe(virQEMUDriver *driver,
+                       unsigned long long connSerial,
+                       unsigned int stats,
+                       unsigned int interval,
+                       unsigned int flags)
+{
+    qemuStatsPush *push = driver->statsPush;
+    qemuStatsSubscription sub = {
+        .connSerial = connSerial,
+        .stats = stats,
+        .flags = flags,
+        .interval = interval * 1000ULL,
+    };
+    size_t i;
+    int ret = -1;
 
-        virObjectUnlock(vm);
+    if (interval == 0) {
+        qemuStatsPushUnsubscribe(push, connSerial);
+        return 0;
     }
 
-    *retStats = g_steal_pointer(&tmpstats);
+    if (virTimeMillisNow(&sub.deadline) < 0)
+        return -1;
+    sub.deadline += sub.interval;
 
-    ret = nstats;
+    virMutexLock(&push->lock);
 
- cleanup:
-    virErrorPreserveLast(&orig_err);
-    virDomainStatsRecordListFree(tmpstats);
-    virObjectListFreeCount(vms, nvms);
-    virErrorRestore(&orig_err);
+    if (push->quit) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("the QEMU driver is shutting down"));
+        goto cleanup;
+    }
 
+    if (!push->threadActive) {
+        if (virThreadCreateFull(&push->thread, true, qemuStatsPushThread,
+                                "qemu-stats-push", false, driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create stats delivery thread"));
+            goto cleanup;
+        }
+        push->threadActive = true;
+    }
+
+    for (i = 0; i < push->nsubs; i++) {
+        if (push->subs[i].connSerial == connSerial)
+            break;
+    }
+
+    if (i < push->nsubs)
+        push->subs[i] = sub;
+    else
+        VIR_APPEND_ELEMENT(push->subs, push->nsubs, sub);
+
+    virCondSignal(&push->cond);
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&push->lock);
     return ret;
 }
 
 
+static int
+qemuConnectDomainStatsSubscribe(virConnectPtr conn,
+                                unsigned int stats,
+                                unsigned int interval,
+                                unsigned int flags)
+{
+    virQEMUDriver *driver = conn->privateData;
+
+    virCheckFlags(VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING, -1);
+
+    if (virConnectDomainStatsSubscribeEnsureACL(conn) < 0)
+        return -1;
+
+    return qemuStatsPushSubscribe(driver, conn->serial, stats, interval, flags);
+}
+
+
 static int
 qemuNodeAllocPages(virConnectPtr conn,
                    unsigned int npages,
@@ -19240,6 +20904,7 @@ qemuDomainSetUserPassword(virDomainPtr dom,
 struct qemuDomainMomentWriteMetadataData {
     virQEMUDriver *driver;
     virDomainObj *vm;
+    virFileRewriteBatch *batch;
 };
 
 
@@ -19252,9 +20917,10 @@ qemuDomainSnapshotWriteMetadataIter(void *payload,
     virQEMUDriverConfig *cfg =  virQEMUDriverGetConfig(data->driver);
     int ret;
 
-    ret = qemuDomainSnapshotWriteMetadata(data->vm, payload,
-                                          data->driver->xmlopt,
-                                          cfg->snapshotDir);
+    ret = qemuDomainSnapshotWriteMetadataBatch(data->vm, payload,
+                                               data->driver->xmlopt,
+                                               cfg->snapshotDir,
+                                               data->batch);
 
     virObjectUnref(cfg);
     return ret;
@@ -19270,9 +20936,10 @@ qemuDomainCheckpointWriteMetadataIter(void *payload,
     virQEMUDriverConfig *cfg =  virQEMUDriverGetConfig(data->driver);
     int ret;
 
-    ret = qemuCheckpointWriteMetadata(data->vm, payload,
-                                      data->driver->xmlopt,
-                                      cfg->snapshotDir);
+    ret = qemuCheckpointWriteMetadataBatch(data->vm, payload,
+                                           data->driver->xmlopt,
+                                           cfg->snapshotDir,
+                                           data->batch);
 
     virObjectUnref(cfg);
     return ret;
@@ -19297,9 +20964,11 @@ qemuDomainRenameCallback(virDomainObj *vm,
     g_autofree char *old_dom_cfg_file = NULL;
     g_autofree char *new_dom_autostart_link = NULL;
     g_autofree char *old_dom_autostart_link = NULL;
+    g_autoptr(virFileRewriteBatch) batch = virFileRewriteBatchNew();
     struct qemuDomainMomentWriteMetadataData data = {
         .driver = driver,
         .vm = vm,
+        .batch = batch,
     };
 
     virCheckFlags(0, ret);
@@ -19353,6 +21022,9 @@ qemuDomainRenameCallback(virDomainObj *vm,
                                    &data) < 0)
         goto cleanup;
 
+    if (virFileRewriteBatchCommit(batch) < 0)
+        goto cleanup;
+
     if (virDomainDefSave(vm->def, driver->xmlopt, cfg->configDir) < 0)
         goto cleanup;
 
@@ -20399,6 +22071,8 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     qemuAgentDiskInfo **agentdiskinfo = NULL;
     virDomainInterfacePtr *ifaces = NULL;
     size_t nifaces = 0;
+    const char *prefetch[7];
+    size_t nprefetch = 0;
     size_t i;
 
     virCheckFlags(0, -1);
@@ -20406,6 +22080,21 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     if (qemuDomainGetGuestInfoCheckSupport(types, &supportedTypes) < 0)
         return -1;
 
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_USERS)
+        prefetch[nprefetch++] = "guest-get-users";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_OS)
+        prefetch[nprefetch++] = "guest-get-osinfo";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_TIMEZONE)
+        prefetch[nprefetch++] = "guest-get-timezone";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_HOSTNAME)
+        prefetch[nprefetch++] = "guest-get-host-name";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_FILESYSTEM)
+        prefetch[nprefetch++] = "guest-get-fsinfo";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_DISKS)
+        prefetch[nprefetch++] = "guest-get-disks";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_INTERFACES)
+        prefetch[nprefetch++] = "guest-network-get-interfaces";
+
     if (!(vm = qemuDomainObjFromDomain(dom)))
         goto cleanup;
 
@@ -20421,6 +22110,13 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
 
     agent = qemuDomainObjEnterAgent(vm);
 
+    /* Send all the commands to the agent at once rather than waiting
+     * for each reply before sending the next command. The functions
+     * below then just process the replies. */
+    if (nprefetch > 1 &&
+        qemuAgentPrefetch(agent, prefetch, nprefetch) < 0)
+        goto exitagent;
+
     /* The agent info commands will return -2 for any commands that are not
      * supported by the agent, or -1 for all other errors. In the case where no
      * categories were explicitly requested (i.e. 'types' is 0), ignore
@@ -20473,6 +22169,7 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
         }
     }
 
+    qemuAgentPrefetchClear(agent);
     qemuDomainObjExitAgent(vm, agent);
     qemuDomainObjEndAgentJob(vm);
 
@@ -20518,6 +22215,7 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     return ret;
 
  exitagent:
+    qemuAgentPrefetchClear(agent);
     qemuDomainObjExitAgent(vm, agent);
 
  endagentjob:
@@ -20691,9 +22389,20 @@ qemuDomainStartDirtyRateCalc(virDomainPtr dom,
     virQEMUDriver *driver = dom->conn->privateData;
     virDomainObj *vm = NULL;
     qemuDomainObjPrivate *priv;
+    qemuMonitorDirtyRateCalcMode mode = QEMU_MONITOR_DIRTYRATE_CALC_MODE_PAGE_SAMPLING;
     int ret = -1;
 
-    virCheckFlags(0, -1);
+    virCheckFlags(VIR_DOMAIN_DIRTYRATE_MODE_PAGE_SAMPLING |
+                  VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP |
+                  VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING, -1);
+
+    VIR_EXCLUSIVE_FLAGS_RET(VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP,
+                            VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING, -1);
+
+    if (flags & VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP)
+        mode = QEMU_MONITOR_DIRTYRATE_CALC_MODE_DIRTY_BITMAP;
+    else if (flags & VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING)
+        mode = QEMU_MONITOR_DIRTYRATE_CALC_MODE_DIRTY_RING;
 
     if (seconds < MIN_DIRTYRATE_CALC_PERIOD ||
         seconds > MAX_DIRTYRATE_CALC_PERIOD) {
@@ -20723,8 +22432,10 @@ qemuDomainStartDirtyRateCalc(virDomainPtr dom,
     VIR_DEBUG("Calculate dirty rate in next %d seconds", seconds);
 
     priv = vm->privateData;
+    g_clear_pointer(&priv->statsCache.dirtyRate, qemuMonitorDirtyRateInfoFree);
+
     qemuDomainObjEnterMonitor(driver, vm);
-    ret = qemuMonitorStartDirtyRateCalc(priv->mon, seconds);
+    ret = qemuMonitorStartDirtyRateCalc(priv->mon, seconds, mode);
 
     if (qemuDomainObjExitMonitor(driver, vm) < 0)
         ret = -1;
@@ -20981,6 +22692,12 @@ static virHypervisorDriver qemuHypervisorDriver = {
     .domainAuthorizedSSHKeysSet = qemuDomainAuthorizedSSHKeysSet, /* 6.10.0 */
     .domainGetMessages = qemuDomainGetMessages, /* 7.1.0 */
     .domainStartDirtyRateCalc = qemuDomainStartDirtyRateCalc, /* 7.2.0 */
+    .connectDomainStatsSubscribe = qemuConnectDomainStatsSubscribe, /* 7.10.0 */
+    .domainSnapshotCreateXMLGroup = qemuDomainSnapshotCreateXMLGroup, /* 7.10.0 */
+    .domainAttachDevices = qemuDomainAttachDevices, /* 7.10.0 */
+    .domainDetachDevices = qemuDomainDetachDevices, /* 7.10.0 */
+    .connectStartDomains = qemuConnectStartDomains, /* 7.10.0 */
+    .connectShutdownDomains = qemuConnectShutdownDomains, /* 7.10.0 */
 };
 
 
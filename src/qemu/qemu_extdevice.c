@@ -171,6 +171,11 @@ qemuExtDevicesStart(virQEMUDriver *driver,
     virDomainDef *def = vm->def;
     size_t i;
 
+    /* swtpm takes a while until it is ready, start it first and only
+     * wait for it once the other helpers are started */
+    if (def->ntpms > 0 && qemuExtTPMStart(driver, vm, incomingMigration) < 0)
+        return -1;
+
     for (i = 0; i < def->nvideos; i++) {
         virDomainVideoDef *video = def->videos[i];
 
@@ -180,9 +185,6 @@ qemuExtDevicesStart(virQEMUDriver *driver,
         }
     }
 
-    if (def->ntpms > 0 && qemuExtTPMStart(driver, vm, incomingMigration) < 0)
-        return -1;
-
     for (i = 0; i < def->nnets; i++) {
         virDomainNetDef *net = def->nets[i];
         qemuSlirp *slirp = QEMU_DOMAIN_NETWORK_PRIVATE(net)->slirp;
@@ -201,6 +203,9 @@ qemuExtDevicesStart(virQEMUDriver *driver,
         }
     }
 
+    if (def->ntpms > 0 && qemuExtTPMWaitStarted(driver, vm) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -20,6 +20,8 @@
 
 #include <config.h>
 
+#include <sys/stat.h>
+
 #include "qemu_firmware.h"
 #include "qemu_interop_config.h"
 #include "configmake.h"
@@ -170,6 +172,38 @@ struct _qemuFirmware {
     qemuFirmwareFeature *features;
 
     /* Tags intentionally not parsed. */
+
+    /* Bitmaps of @interfaces and @features (1 << value), filled in once
+     * the descriptor is parsed so that matching doesn't walk the arrays */
+    unsigned int interfacesMask;
+    unsigned int featuresMask;
+};
+
+G_STATIC_ASSERT(QEMU_FIRMWARE_OS_INTERFACE_LAST <= 32);
+G_STATIC_ASSERT(QEMU_FIRMWARE_FEATURE_LAST <= 32);
+
+
+/* A parsed descriptor along with the identity of the file it was read
+ * from, to tell whether the file changed since */
+typedef struct _qemuFirmwareEntry qemuFirmwareEntry;
+struct _qemuFirmwareEntry {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    time_t ctime;
+    qemuFirmware *fw;
+};
+
+
+struct _qemuFirmwareCache {
+    virMutex lock;
+    bool privileged;
+
+    /* Descriptors read last time, NULL if not read yet. The array is
+     * never modified once built, callers get their own reference. */
+    GPtrArray *entries;
 };
 
 
@@ -612,6 +646,7 @@ qemuFirmwareParse(const char *path)
     g_autofree char *cont = NULL;
     g_autoptr(virJSONValue) doc = NULL;
     g_autoptr(qemuFirmware) fw = NULL;
+    size_t i;
 
     if (virFileReadAll(path, DOCUMENT_SIZE, &cont) < 0)
         return NULL;
@@ -637,6 +672,12 @@ qemuFirmwareParse(const char *path)
     if (qemuFirmwareFeatureParse(path, doc, fw) < 0)
         return NULL;
 
+    for (i = 0; i < fw->ninterfaces; i++)
+        fw->interfacesMask |= 1U << fw->interfaces[i];
+
+    for (i = 0; i < fw->nfeatures; i++)
+        fw->featuresMask |= 1U << fw->features[i];
+
     return g_steal_pointer(&fw);
 }
 
@@ -923,15 +964,14 @@ qemuFirmwareMatchDomain(const virDomainDef *def,
                         const qemuFirmware *fw,
                         const char *path)
 {
-    size_t i;
     qemuFirmwareOSInterface want;
-    bool supportsS3 = false;
-    bool supportsS4 = false;
-    bool requiresSMM = false;
-    bool supportsSEV = false;
-    bool supportsSEVES = false;
-    bool supportsSecureBoot = false;
-    bool hasEnrolledKeys = false;
+    bool supportsS3 = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_ACPI_S3);
+    bool supportsS4 = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_ACPI_S4);
+    bool requiresSMM = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_REQUIRES_SMM);
+    bool supportsSEV = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_AMD_SEV);
+    bool supportsSEVES = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_AMD_SEV_ES);
+    bool supportsSecureBoot = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_SECURE_BOOT);
+    bool hasEnrolledKeys = fw->featuresMask & (1U << QEMU_FIRMWARE_FEATURE_ENROLLED_KEYS);
     int reqSecureBoot;
     int reqEnrolledKeys;
 
@@ -952,12 +992,7 @@ qemuFirmwareMatchDomain(const virDomainDef *def,
         }
     }
 
-    for (i = 0; i < fw->ninterfaces; i++) {
-        if (fw->interfaces[i] == want)
-            break;
-    }
-
-    if (i == fw->ninterfaces) {
+    if (!(fw->interfacesMask & (1U << want))) {
         VIR_DEBUG("No matching interface in '%s'", path);
         return false;
     }
@@ -967,42 +1002,6 @@ qemuFirmwareMatchDomain(const virDomainDef *def,
         return false;
     }
 
-    for (i = 0; i < fw->nfeatures; i++) {
-        switch (fw->features[i]) {
-        case QEMU_FIRMWARE_FEATURE_ACPI_S3:
-            supportsS3 = true;
-            break;
-        case QEMU_FIRMWARE_FEATURE_ACPI_S4:
-            supportsS4 = true;
-            break;
-        case QEMU_FIRMWARE_FEATURE_AMD_SEV:
-            supportsSEV = true;
-            break;
-
-        case QEMU_FIRMWARE_FEATURE_AMD_SEV_ES:
-            supportsSEVES = true;
-            break;
-
-        case QEMU_FIRMWARE_FEATURE_REQUIRES_SMM:
-            requiresSMM = true;
-            break;
-
-        case QEMU_FIRMWARE_FEATURE_SECURE_BOOT:
-            supportsSecureBoot = true;
-            break;
-
-        case QEMU_FIRMWARE_FEATURE_ENROLLED_KEYS:
-            hasEnrolledKeys = true;
-            break;
-
-        case QEMU_FIRMWARE_FEATURE_VERBOSE_DYNAMIC:
-        case QEMU_FIRMWARE_FEATURE_VERBOSE_STATIC:
-        case QEMU_FIRMWARE_FEATURE_NONE:
-        case QEMU_FIRMWARE_FEATURE_LAST:
-            break;
-        }
-    }
-
     if (def->pm.s3 == VIR_TRISTATE_BOOL_YES &&
         !supportsS3) {
         VIR_DEBUG("Domain requires S3, firmware '%s' doesn't support it", path);
@@ -1232,41 +1231,161 @@ qemuFirmwareSanityCheck(const qemuFirmware *fw,
 }
 
 
-static ssize_t
+static void
+qemuFirmwareEntryFree(qemuFirmwareEntry *entry)
+{
+    if (!entry)
+        return;
+
+    g_free(entry->path);
+    qemuFirmwareFree(entry->fw);
+    g_free(entry);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuFirmwareEntry, qemuFirmwareEntryFree);
+
+
+static qemuFirmwareEntry *
+qemuFirmwareEntryNew(const char *path)
+{
+    g_autoptr(qemuFirmwareEntry) entry = g_new0(qemuFirmwareEntry, 1);
+    struct stat sb;
+
+    if (stat(path, &sb) < 0) {
+        virReportSystemError(errno, _("unable to stat '%s'"), path);
+        return NULL;
+    }
+
+    entry->path = g_strdup(path);
+    entry->dev = sb.st_dev;
+    entry->ino = sb.st_ino;
+    entry->size = sb.st_size;
+    entry->mtime = sb.st_mtime;
+    entry->ctime = sb.st_ctime;
+
+    return g_steal_pointer(&entry);
+}
+
+
+static bool
+qemuFirmwareEntryEqual(const qemuFirmwareEntry *a,
+                       const qemuFirmwareEntry *b)
+{
+    return STREQ(a->path, b->path) &&
+        a->dev == b->dev &&
+        a->ino == b->ino &&
+        a->size == b->size &&
+        a->mtime == b->mtime &&
+        a->ctime == b->ctime;
+}
+
+
+/**
+ * qemuFirmwareFetchParsedConfigs:
+ * @privileged: whether running as privileged user
+ * @current: (nullable) descriptors read previously
+ *
+ * Lists the firmware descriptors and parses them. If @current is given and
+ * none of the descriptor files was added, removed or modified since it was
+ * built, a new reference to @current is returned instead and nothing is
+ * parsed.
+ *
+ * Returns an array of qemuFirmwareEntry, or NULL on error.
+ */
+static GPtrArray *
 qemuFirmwareFetchParsedConfigs(bool privileged,
-                               qemuFirmware ***firmwaresRet,
-                               char ***pathsRet)
+                               GPtrArray *current)
 {
     g_auto(GStrv) paths = NULL;
-    size_t npaths;
-    qemuFirmware **firmwares = NULL;
+    g_autoptr(GPtrArray) entries = NULL;
+    bool unchanged = !!current;
     size_t i;
 
     if (qemuFirmwareFetchConfigs(&paths, privileged) < 0)
-        return -1;
+        return NULL;
+
+    entries = g_ptr_array_new_with_free_func((GDestroyNotify) qemuFirmwareEntryFree);
 
-    if (!paths)
-        return 0;
+    for (i = 0; paths && paths[i]; i++) {
+        qemuFirmwareEntry *entry;
 
-    npaths = g_strv_length(paths);
+        if (!(entry = qemuFirmwareEntryNew(paths[i])))
+            return NULL;
 
-    firmwares = g_new0(qemuFirmware *, npaths);
+        if (unchanged &&
+            (i >= current->len ||
+             !qemuFirmwareEntryEqual(g_ptr_array_index(current, i), entry)))
+            unchanged = false;
 
-    for (i = 0; i < npaths; i++) {
-        if (!(firmwares[i] = qemuFirmwareParse(paths[i])))
-            goto error;
+        g_ptr_array_add(entries, entry);
     }
 
-    *firmwaresRet = g_steal_pointer(&firmwares);
-    if (pathsRet)
-        *pathsRet = g_steal_pointer(&paths);
-    return npaths;
+    if (unchanged && entries->len == current->len)
+        return g_ptr_array_ref(current);
 
- error:
-    while (i > 0)
-        qemuFirmwareFree(firmwares[--i]);
-    VIR_FREE(firmwares);
-    return -1;
+    for (i = 0; i < entries->len; i++) {
+        qemuFirmwareEntry *entry = g_ptr_array_index(entries, i);
+
+        if (!(entry->fw = qemuFirmwareParse(entry->path)))
+            return NULL;
+    }
+
+    return g_steal_pointer(&entries);
+}
+
+
+qemuFirmwareCache *
+qemuFirmwareCacheNew(bool privileged)
+{
+    g_autofree qemuFirmwareCache *cache = g_new0(qemuFirmwareCache, 1);
+
+    if (virMutexInit(&cache->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unable to initialize mutex"));
+        return NULL;
+    }
+
+    cache->privileged = privileged;
+
+    return g_steal_pointer(&cache);
+}
+
+
+void
+qemuFirmwareCacheFree(qemuFirmwareCache *cache)
+{
+    if (!cache)
+        return;
+
+    if (cache->entries)
+        g_ptr_array_unref(cache->entries);
+    virMutexDestroy(&cache->lock);
+    g_free(cache);
+}
+
+
+/* Returns the descriptors from @cache, re-reading them only if any of the
+ * files changed. The caller must unref the returned array. */
+static GPtrArray *
+qemuFirmwareCacheGetEntries(qemuFirmwareCache *cache)
+{
+    GPtrArray *entries;
+
+    virMutexLock(&cache->lock);
+
+    if ((entries = qemuFirmwareFetchParsedConfigs(cache->privileged,
+                                                  cache->entries)) &&
+        entries != cache->entries) {
+        VIR_DEBUG("Firmware descriptors changed, %u parsed", entries->len);
+
+        if (cache->entries)
+            g_ptr_array_unref(cache->entries);
+        cache->entries = g_ptr_array_ref(entries);
+    }
+
+    virMutexUnlock(&cache->lock);
+
+    return entries;
 }
 
 
@@ -1275,13 +1394,10 @@ qemuFirmwareFillDomain(virQEMUDriver *driver,
                        virDomainDef *def,
                        unsigned int flags)
 {
-    g_auto(GStrv) paths = NULL;
-    qemuFirmware **firmwares = NULL;
-    ssize_t nfirmwares = 0;
-    const qemuFirmware *theone = NULL;
+    g_autoptr(GPtrArray) firmwares = NULL;
+    const qemuFirmwareEntry *theone = NULL;
     bool needResult = true;
     size_t i;
-    int ret = -1;
 
     /* Fill in FW paths if either os.firmware is enabled, or
      * loader path was provided with no nvram varstore. */
@@ -1305,15 +1421,21 @@ qemuFirmwareFillDomain(virQEMUDriver *driver,
             return 0;
     }
 
-    if ((nfirmwares = qemuFirmwareFetchParsedConfigs(driver->privileged,
-                                                     &firmwares, &paths)) < 0)
+    if (driver->firmwareCache)
+        firmwares = qemuFirmwareCacheGetEntries(driver->firmwareCache);
+    else
+        firmwares = qemuFirmwareFetchParsedConfigs(driver->privileged, NULL);
+
+    if (!firmwares)
         return -1;
 
-    for (i = 0; i < nfirmwares; i++) {
-        if (qemuFirmwareMatchDomain(def, firmwares[i], paths[i])) {
-            theone = firmwares[i];
+    for (i = 0; i < firmwares->len; i++) {
+        const qemuFirmwareEntry *entry = g_ptr_array_index(firmwares, i);
+
+        if (qemuFirmwareMatchDomain(def, entry->fw, entry->path)) {
+            theone = entry;
             VIR_DEBUG("Found matching firmware (description path '%s')",
-                      paths[i]);
+                      entry->path);
             break;
         }
     }
@@ -1327,27 +1449,22 @@ qemuFirmwareFillDomain(virQEMUDriver *driver,
             VIR_DEBUG("Unable to find NVRAM template for '%s', "
                       "falling back to old style",
                       NULLSTR(def->os.loader ? def->os.loader->path : NULL));
-            ret = 0;
+            return 0;
         }
-        goto cleanup;
+        return -1;
     }
 
     /* Firstly, let's do some sanity checks. If either of these
      * fail we can still start the domain successfully, but it's
      * likely that admin/FW manufacturer messed up. */
-    qemuFirmwareSanityCheck(theone, paths[i]);
+    qemuFirmwareSanityCheck(theone->fw, theone->path);
 
-    if (qemuFirmwareEnableFeatures(driver, def, theone) < 0)
-        goto cleanup;
+    if (qemuFirmwareEnableFeatures(driver, def, theone->fw) < 0)
+        return -1;
 
     def->os.firmware = VIR_DOMAIN_OS_DEF_FIRMWARE_NONE;
 
-    ret = 0;
- cleanup:
-    for (i = 0; i < nfirmwares; i++)
-        qemuFirmwareFree(firmwares[i]);
-    VIR_FREE(firmwares);
-    return ret;
+    return 0;
 }
 
 
@@ -1390,8 +1507,7 @@ qemuFirmwareGetSupported(const char *machine,
                          virFirmware ***fws,
                          size_t *nfws)
 {
-    qemuFirmware **firmwares = NULL;
-    ssize_t nfirmwares = 0;
+    g_autoptr(GPtrArray) firmwares = NULL;
     size_t i;
 
     *supported = VIR_DOMAIN_OS_DEF_FIRMWARE_NONE;
@@ -1402,12 +1518,12 @@ qemuFirmwareGetSupported(const char *machine,
         *nfws = 0;
     }
 
-    if ((nfirmwares = qemuFirmwareFetchParsedConfigs(privileged,
-                                                     &firmwares, NULL)) < 0)
+    if (!(firmwares = qemuFirmwareFetchParsedConfigs(privileged, NULL)))
         return -1;
 
-    for (i = 0; i < nfirmwares; i++) {
-        qemuFirmware *fw = firmwares[i];
+    for (i = 0; i < firmwares->len; i++) {
+        qemuFirmwareEntry *entry = g_ptr_array_index(firmwares, i);
+        qemuFirmware *fw = entry->fw;
         const qemuFirmwareMappingFlash *flash = &fw->mapping.data.flash;
         const qemuFirmwareMappingMemory *memory = &fw->mapping.data.memory;
         const char *fwpath = NULL;
@@ -1489,11 +1605,8 @@ qemuFirmwareGetSupported(const char *machine,
         }
     }
 
-    if (fws && !*fws && nfirmwares)
+    if (fws && !*fws && firmwares->len)
         VIR_REALLOC_N(*fws, 0);
 
-    for (i = 0; i < nfirmwares; i++)
-        qemuFirmwareFree(firmwares[i]);
-    VIR_FREE(firmwares);
     return 0;
 }
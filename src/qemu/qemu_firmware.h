@@ -42,6 +42,12 @@ int
 qemuFirmwareFetchConfigs(char ***firmwares,
                          bool privileged);
 
+qemuFirmwareCache *
+qemuFirmwareCacheNew(bool privileged);
+
+void
+qemuFirmwareCacheFree(qemuFirmwareCache *cache);
+
 int
 qemuFirmwareFillDomain(virQEMUDriver *driver,
                        virDomainDef *def,
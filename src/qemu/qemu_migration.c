@@ -28,6 +28,7 @@
 #include "qemu_migration.h"
 #include "qemu_migration_cookie.h"
 #include "qemu_migration_params.h"
+#include "qemu_migration_sched.h"
 #include "qemu_monitor.h"
 #include "qemu_domain.h"
 #include "qemu_process.h"
@@ -508,12 +509,13 @@ qemuMigrationDstStartNBDServer(virQEMUDriver *driver,
             goto cleanup;
 
         if (!server_started) {
-            if (qemuMonitorNBDServerStart(priv->mon, &server, tls_alias) < 0)
+            if (qemuMonitorNBDServerStart(priv->mon, &server, tls_alias, 0) < 0)
                 goto exit_monitor;
             server_started = true;
         }
 
-        if (qemuBlockExportAddNBD(vm, diskAlias, disk->src, diskAlias, true, NULL) < 0)
+        if (qemuBlockExportAddNBD(vm, diskAlias, disk->src, diskAlias,
+                                  true, NULL, NULL) < 0)
             goto exit_monitor;
         if (qemuDomainObjExitMonitor(driver, vm) < 0)
             goto cleanup;
@@ -576,22 +578,21 @@ qemuMigrationNBDReportMirrorError(qemuBlockJobData *job,
 
 
 /**
- * qemuMigrationSrcNBDStorageCopyReady:
+ * qemuMigrationSrcNBDStorageCopyNotReady:
  * @vm: domain
  *
  * Check the status of all drives copied via qemuMigrationSrcNBDStorageCopy.
  * Any pending block job events for the mirrored disks will be processed.
  *
- * Returns 1 if all mirrors are "ready",
- *         0 if some mirrors are still performing initial sync,
+ * Returns the number of mirrors still performing initial sync,
  *        -1 on error.
  */
-static int
-qemuMigrationSrcNBDStorageCopyReady(virDomainObj *vm,
-                                    qemuDomainAsyncJob asyncJob)
+static ssize_t
+qemuMigrationSrcNBDStorageCopyNotReady(virDomainObj *vm,
+                                       qemuDomainAsyncJob asyncJob)
 {
     size_t i;
-    size_t notReady = 0;
+    ssize_t notReady = 0;
 
     for (i = 0; i < vm->def->ndisks; i++) {
         virDomainDiskDef *disk = vm->def->disks[i];
@@ -620,8 +621,32 @@ qemuMigrationSrcNBDStorageCopyReady(virDomainObj *vm,
         virObjectUnref(job);
     }
 
+    return notReady;
+}
+
+
+/**
+ * qemuMigrationSrcNBDStorageCopyReady:
+ * @vm: domain
+ *
+ * Check the status of all drives copied via qemuMigrationSrcNBDStorageCopy.
+ * Any pending block job events for the mirrored disks will be processed.
+ *
+ * Returns 1 if all mirrors are "ready",
+ *         0 if some mirrors are still performing initial sync,
+ *        -1 on error.
+ */
+static int
+qemuMigrationSrcNBDStorageCopyReady(virDomainObj *vm,
+                                    qemuDomainAsyncJob asyncJob)
+{
+    ssize_t notReady;
+
+    if ((notReady = qemuMigrationSrcNBDStorageCopyNotReady(vm, asyncJob)) < 0)
+        return -1;
+
     if (notReady) {
-        VIR_DEBUG("Waiting for %zu disk mirrors to get ready", notReady);
+        VIR_DEBUG("Waiting for %zd disk mirrors to get ready", notReady);
         return 0;
     } else {
         VIR_DEBUG("All disk mirrors are ready");
@@ -1094,7 +1119,10 @@ qemuMigrationSrcNBDStorageCopyOne(virQEMUDriver *driver,
  * @speed: bandwidth limit in MiB/s
  *
  * Migrate non-shared storage using the NBD protocol to the server running
- * inside the qemu process on dst and wait until the copy converges.
+ * inside the qemu process on dst and wait until the copy converges. When
+ * migration_storage_parallel is set in qemu.conf, only the configured number
+ * of disks performs the initial sync at a time, the next disk is copied once
+ * a mirror gets ready.
  * On failure, the caller is expected to call qemuMigrationSrcNBDCopyCancel
  * to stop all running copy operations.
  *
@@ -1116,10 +1144,10 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriver *driver,
 {
     qemuDomainObjPrivate *priv = vm->privateData;
     int port;
-    size_t i;
+    size_t i = 0;
     unsigned long long mirror_speed = speed;
     bool mirror_shallow = flags & VIR_MIGRATE_NON_SHARED_INC;
-    int rv;
+    ssize_t notReady;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     g_autoptr(virURI) uri = NULL;
     const char *socket = NULL;
@@ -1172,28 +1200,42 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriver *driver,
         }
     }
 
-    for (i = 0; i < vm->def->ndisks; i++) {
-        virDomainDiskDef *disk = vm->def->disks[i];
+    while (1) {
+        notReady = qemuMigrationSrcNBDStorageCopyNotReady(vm, QEMU_ASYNC_JOB_MIGRATION_OUT);
+        if (notReady < 0)
+            return -1;
 
-        /* check whether disk should be migrated */
-        if (!qemuMigrationAnyCopyDisk(disk, nmigrate_disks, migrate_disks))
-            continue;
+        for (; i < vm->def->ndisks; i++) {
+            virDomainDiskDef *disk = vm->def->disks[i];
 
-        if (qemuMigrationSrcNBDStorageCopyOne(driver, vm, disk, host, port,
-                                              socket,
-                                              mirror_speed, mirror_shallow,
-                                              tlsAlias, flags) < 0)
-            return -1;
+            if (cfg->migrationStorageParallel > 0 &&
+                notReady >= cfg->migrationStorageParallel)
+                break;
 
-        if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0) {
-            VIR_WARN("Failed to save status on vm %s", vm->def->name);
-            return -1;
+            /* check whether disk should be migrated */
+            if (!qemuMigrationAnyCopyDisk(disk, nmigrate_disks, migrate_disks))
+                continue;
+
+            if (qemuMigrationSrcNBDStorageCopyOne(driver, vm, disk, host, port,
+                                                  socket,
+                                                  mirror_speed, mirror_shallow,
+                                                  tlsAlias, flags) < 0)
+                return -1;
+
+            if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0) {
+                VIR_WARN("Failed to save status on vm %s", vm->def->name);
+                return -1;
+            }
+
+            notReady++;
         }
-    }
 
-    while ((rv = qemuMigrationSrcNBDStorageCopyReady(vm, QEMU_ASYNC_JOB_MIGRATION_OUT)) != 1) {
-        if (rv < 0)
-            return -1;
+        if (notReady == 0 && i == vm->def->ndisks) {
+            VIR_DEBUG("All disk mirrors are ready");
+            break;
+        }
+
+        VIR_DEBUG("Waiting for %zd disk mirrors to get ready", notReady);
 
         if (priv->job.abortJob) {
             priv->job.current->status = QEMU_DOMAIN_JOB_STATUS_CANCELED;
@@ -1865,6 +1907,141 @@ qemuMigrationAnyCompleted(virQEMUDriver *driver,
 }
 
 
+typedef struct _qemuMigrationConvergeState qemuMigrationConvergeState;
+struct _qemuMigrationConvergeState {
+    unsigned long long iteration;
+    unsigned long long remaining;
+    unsigned long long cacheMiss;
+    bool done;
+};
+
+
+/* Sets a single migration parameter of a running migration. Failures are
+ * reported, but the caller is free to ignore them.
+ */
+static int
+qemuMigrationSrcConvergeSetParam(qemuMonitor *mon,
+                                 const char *name,
+                                 unsigned long long value)
+{
+    g_autoptr(virJSONValue) params = virJSONValueNewObject();
+
+    if (virJSONValueObjectAppendNumberUlong(params, name, value) < 0)
+        return -1;
+
+    return qemuMonitorSetMigrationParams(mon, &params);
+}
+
+
+/* Tries to make a migration which does not converge finish. It is supposed
+ * to be called at the end of every RAM iteration. Once the migration made
+ * migration_converge_iterations iterations, each iteration in which the
+ * remaining RAM didn't shrink takes the first of the following steps which
+ * can still be taken:
+ *
+ *  - double the XBZRLE cache as long as it keeps missing pages, up to a
+ *    quarter of the guest memory,
+ *  - double the CPU throttling increment of auto-converge,
+ *  - switch to post-copy if allowed in qemu.conf and the migration was
+ *    started with VIR_MIGRATE_POSTCOPY.
+ *
+ * Returns 0 on success (even if a step could not be taken), -1 if the domain
+ * died.
+ */
+static int
+qemuMigrationSrcConverge(virQEMUDriver *driver,
+                         virDomainObj *vm,
+                         qemuDomainAsyncJob asyncJob,
+                         qemuMigrationConvergeState *state)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivate *priv = vm->privateData;
+    qemuMonitorMigrationStats stats = { 0 };
+    g_autoptr(virJSONValue) params = NULL;
+    bool converging;
+    bool cacheMissed;
+    int increment = 0;
+    int rc;
+
+    if (asyncJob != QEMU_ASYNC_JOB_MIGRATION_OUT ||
+        cfg->migrationConvergeIterations == 0 ||
+        state->done)
+        return 0;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return -1;
+    rc = qemuMonitorGetMigrationStats(priv->mon, &stats, NULL);
+    if (qemuDomainObjExitMonitor(driver, vm) < 0)
+        return -1;
+
+    if (rc < 0 ||
+        stats.status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE ||
+        stats.ram_iteration == state->iteration) {
+        virResetLastError();
+        return 0;
+    }
+
+    converging = state->iteration == 0 || stats.ram_remaining < state->remaining;
+    cacheMissed = stats.xbzrle_cache_miss > state->cacheMiss;
+
+    state->iteration = stats.ram_iteration;
+    state->remaining = stats.ram_remaining;
+    state->cacheMiss = stats.xbzrle_cache_miss;
+
+    if (stats.ram_iteration < cfg->migrationConvergeIterations || converging)
+        return 0;
+
+    VIR_DEBUG("Migration of domain %s does not converge: iteration %llu, "
+              "remaining %llu bytes, dirty rate %llu pages/s",
+              vm->def->name, stats.ram_iteration, stats.ram_remaining,
+              stats.ram_dirty_rate);
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return -1;
+
+    if (stats.xbzrle_set && cacheMissed &&
+        stats.xbzrle_cache_size * 2 <= stats.ram_total / 4) {
+        VIR_DEBUG("Raising XBZRLE cache size to %llu",
+                  stats.xbzrle_cache_size * 2);
+        if (virQEMUCapsGet(priv->qemuCaps,
+                           QEMU_CAPS_MIGRATION_PARAM_XBZRLE_CACHE_SIZE))
+            rc = qemuMigrationSrcConvergeSetParam(priv->mon, "xbzrle-cache-size",
+                                                  stats.xbzrle_cache_size * 2);
+        else
+            rc = qemuMonitorSetMigrationCacheSize(priv->mon,
+                                                  stats.xbzrle_cache_size * 2);
+    } else if (priv->job.apiFlags & VIR_MIGRATE_AUTO_CONVERGE &&
+               (rc = qemuMonitorGetMigrationParams(priv->mon, &params)) == 0 &&
+               virJSONValueObjectGetNumberInt(params, "cpu-throttle-increment",
+                                              &increment) == 0 &&
+               increment < 100) {
+        increment = MIN(increment * 2, 100);
+        VIR_DEBUG("Raising CPU throttling increment to %d", increment);
+        rc = qemuMigrationSrcConvergeSetParam(priv->mon, "cpu-throttle-increment",
+                                              increment);
+    } else if (cfg->migrationConvergePostcopy &&
+               priv->job.apiFlags & VIR_MIGRATE_POSTCOPY) {
+        VIR_DEBUG("Switching to post-copy");
+        rc = qemuMonitorMigrateStartPostCopy(priv->mon);
+        state->done = true;
+    } else {
+        VIR_DEBUG("No step left to make the migration converge");
+        state->done = true;
+    }
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0)
+        return -1;
+
+    if (rc < 0) {
+        VIR_WARN("Failed to help migration of domain %s converge: %s",
+                 vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    return 0;
+}
+
+
 /* Returns 0 on success, -2 when migration needs to be cancelled, or -1 when
  * QEMU reports failed migration.
  */
@@ -1878,6 +2055,7 @@ qemuMigrationSrcWaitForCompletion(virQEMUDriver *driver,
     qemuDomainObjPrivate *priv = vm->privateData;
     qemuDomainJobInfo *jobInfo = priv->job.current;
     bool events = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_EVENT);
+    qemuMigrationConvergeState converge = { 0 };
     int rv;
 
     jobInfo->status = QEMU_DOMAIN_JOB_STATUS_MIGRATING;
@@ -1887,6 +2065,10 @@ qemuMigrationSrcWaitForCompletion(virQEMUDriver *driver,
         if (rv < 0)
             return rv;
 
+        if (qemuMigrationSchedUpdate(driver, vm, asyncJob) < 0 ||
+            qemuMigrationSrcConverge(driver, vm, asyncJob, &converge) < 0)
+            return -2;
+
         if (events) {
             if (virDomainObjWait(vm) < 0) {
                 if (virDomainObjIsActive(vm))
@@ -2097,6 +2279,7 @@ qemuMigrationDstCheckProtocol(virQEMUCaps *qemuCaps,
     } else if (!STRPREFIX(migrateFrom, "tcp") &&
                !STRPREFIX(migrateFrom, "exec") &&
                !STRPREFIX(migrateFrom, "fd") &&
+               !STRPREFIX(migrateFrom, "file") &&
                !STRPREFIX(migrateFrom, "unix") &&
                STRNEQ(migrateFrom, "stdio")) {
         virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
@@ -2641,6 +2824,64 @@ qemuMigrationDstPrepare(virDomainObj *vm,
 }
 
 
+/**
+ * qemuMigrationDstGetPrestaged:
+ * @driver: qemu driver
+ * @def: domain definition sent by the migration source
+ * @tunnel: whether the migration is tunnelled
+ * @flags: migration flags
+ * @vm: filled with the prestaged domain object
+ *
+ * Looks up a domain started with VIR_DOMAIN_START_INCOMING which is waiting
+ * for the incoming migration of @def. The domain is returned locked and
+ * referenced in @vm.
+ *
+ * Returns 1 if a usable domain was found,
+ *         0 if there is no prestaged domain matching @def,
+ *        -1 on error (e.g., when the prestaged domain is incompatible).
+ */
+static int
+qemuMigrationDstGetPrestaged(virQEMUDriver *driver,
+                             virDomainDef *def,
+                             bool tunnel,
+                             unsigned long flags,
+                             virDomainObj **vm)
+{
+    virDomainObj *obj;
+    qemuDomainObjPrivate *priv;
+
+    *vm = NULL;
+
+    if (!(obj = virDomainObjListFindByUUID(driver->domains, def->uuid)))
+        return 0;
+
+    priv = obj->privateData;
+    if (!virDomainObjIsActive(obj) || !priv->prestaged) {
+        virDomainObjEndAPI(&obj);
+        return 0;
+    }
+
+    if (tunnel || flags & VIR_MIGRATE_OFFLINE) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("domain '%s' waiting for an incoming migration cannot "
+                         "be used by tunnelled or offline migration"),
+                       obj->def->name);
+        goto error;
+    }
+
+    if (!qemuDomainDefCheckABIStability(driver, priv->qemuCaps, obj->def, def))
+        goto error;
+
+    VIR_DEBUG("Using prestaged domain %s", obj->def->name);
+    *vm = obj;
+    return 1;
+
+ error:
+    virDomainObjEndAPI(&obj);
+    return -1;
+}
+
+
 /**
  * qemuMigrationDstPrepareAnyBlockDirtyBitmaps:
  * @vm: domain object
@@ -2764,6 +3005,7 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
     bool taint_hook = false;
     bool stopProcess = false;
     bool relabel = false;
+    bool prestaged = false;
     int rv;
     g_autofree char *tlsAlias = NULL;
 
@@ -2878,13 +3120,20 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
                                          QEMU_MIGRATION_COOKIE_BLOCK_DIRTY_BITMAPS)))
         goto cleanup;
 
-    if (!(vm = virDomainObjListAdd(driver->domains, *def,
-                                   driver->xmlopt,
-                                   VIR_DOMAIN_OBJ_LIST_ADD_LIVE |
-                                   VIR_DOMAIN_OBJ_LIST_ADD_CHECK_LIVE,
-                                   NULL)))
+    if ((rv = qemuMigrationDstGetPrestaged(driver, *def, tunnel, flags, &vm)) < 0)
         goto cleanup;
-    *def = NULL;
+
+    if (rv == 1) {
+        prestaged = true;
+    } else {
+        if (!(vm = virDomainObjListAdd(driver->domains, *def,
+                                       driver->xmlopt,
+                                       VIR_DOMAIN_OBJ_LIST_ADD_LIVE |
+                                       VIR_DOMAIN_OBJ_LIST_ADD_CHECK_LIVE,
+                                       NULL)))
+            goto cleanup;
+        *def = NULL;
+    }
 
     priv = vm->privateData;
     jobPriv = priv->job.privateData;
@@ -2913,6 +3162,24 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
         goto cleanup;
     qemuMigrationJobSetPhase(driver, vm, QEMU_MIGRATION_PHASE_PREPARE);
 
+    if (prestaged) {
+        /* QEMU is already running and waiting for the migration */
+        priv->prestaged = false;
+        stopProcess = true;
+        relabel = true;
+
+        /* Tie the domain to the migration like a freshly started one */
+        ignore_value(qemuProcessAutoDestroyRemove(driver, vm));
+        if (qemuProcessAutoDestroyAdd(driver, vm, dconn) < 0)
+            goto stopjob;
+
+        if (!(incoming = qemuMigrationDstPrepare(vm, false, protocol,
+                                                 listenAddress, port, -1)))
+            goto stopjob;
+
+        goto prepare;
+    }
+
     /* Domain starts inactive, even if the domain XML had an id field. */
     vm->def->id = -1;
 
@@ -2961,6 +3228,7 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
         dataFD[1] = -1; /* 'st' owns the FD now & will close it */
     }
 
+ prepare:
     if (STREQ_NULLABLE(protocol, "rdma") &&
         vm->def->mem.hard_limit > 0 &&
         virProcessSetMaxMemLock(vm->pid, vm->def->mem.hard_limit << 10) < 0) {
@@ -3047,7 +3315,8 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
     if (qemuDomainCleanupAdd(vm, qemuMigrationDstPrepareCleanup) < 0)
         goto stopjob;
 
-    if (!(flags & VIR_MIGRATE_OFFLINE)) {
+    /* A prestaged domain was announced when it started */
+    if (!(flags & VIR_MIGRATE_OFFLINE) && !prestaged) {
         virDomainAuditStart(vm, "migrated", true);
         event = virDomainEventLifecycleNewFromObj(vm,
                                          VIR_DOMAIN_EVENT_STARTED,
@@ -3084,8 +3353,11 @@ qemuMigrationDstPrepareAny(virQEMUDriver *driver,
         if (nbdPort == 0)
             virPortAllocatorRelease(priv->nbdPort);
         priv->nbdPort = 0;
-        virDomainObjRemoveTransientDef(vm);
-        qemuDomainRemoveInactiveJob(driver, vm);
+        /* A prestaged domain is kept unless it was stopped */
+        if (!virDomainObjIsActive(vm)) {
+            virDomainObjRemoveTransientDef(vm);
+            qemuDomainRemoveInactiveJob(driver, vm);
+        }
     }
     virDomainObjEndAPI(&vm);
     virObjectEventStateQueue(driver->domainEventState, event);
@@ -3551,7 +3823,8 @@ struct _qemuMigrationSpec {
     } fwd;
 };
 
-#define TUNNEL_SEND_BUF_SIZE 65536
+/* Large chunks keep the per-message RPC overhead low */
+#define TUNNEL_SEND_BUF_SIZE (1024 * 1024)
 
 typedef struct _qemuMigrationIOThread qemuMigrationIOThread;
 struct _qemuMigrationIOThread {
@@ -3566,7 +3839,6 @@ struct _qemuMigrationIOThread {
 static void qemuMigrationSrcIOFunc(void *arg)
 {
     qemuMigrationIOThread *data = arg;
-    char *buffer = NULL;
     struct pollfd fds[2];
     int timeout = -1;
     virErrorPtr err = NULL;
@@ -3574,8 +3846,6 @@ static void qemuMigrationSrcIOFunc(void *arg)
     VIR_DEBUG("Running migration tunnel; stream=%p, sock=%d",
               data->st, data->sock);
 
-    buffer = g_new0(char, TUNNEL_SEND_BUF_SIZE);
-
     fds[0].fd = data->sock;
     fds[1].fd = data->wakeupRecvFD;
 
@@ -3625,18 +3895,15 @@ static void qemuMigrationSrcIOFunc(void *arg)
         if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
             int nbytes;
 
-            nbytes = saferead(data->sock, buffer, TUNNEL_SEND_BUF_SIZE);
-            if (nbytes > 0) {
-                if (virStreamSend(data->st, buffer, nbytes) < 0)
-                    goto error;
-            } else if (nbytes < 0) {
-                virReportSystemError(errno, "%s",
-                        _("tunnelled migration failed to read from qemu"));
+            /* The data is read directly into the RPC message buffer */
+            nbytes = virStreamSendFromFD(data->st, data->sock,
+                                         TUNNEL_SEND_BUF_SIZE);
+            if (nbytes < 0)
                 goto abrt;
-            } else {
-                /* EOF; get out of here */
+
+            /* EOF; get out of here */
+            if (nbytes == 0)
                 break;
-            }
         }
     }
 
@@ -3644,7 +3911,6 @@ static void qemuMigrationSrcIOFunc(void *arg)
         goto error;
 
     VIR_FORCE_CLOSE(data->sock);
-    VIR_FREE(buffer);
 
     return;
 
@@ -3664,7 +3930,6 @@ static void qemuMigrationSrcIOFunc(void *arg)
     if (!virLastErrorIsSystemErrno(EPIPE))
         virCopyLastError(&data->err);
     virResetLastError();
-    VIR_FREE(buffer);
 }
 
 
@@ -4023,6 +4288,7 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
     unsigned int waitFlags;
     g_autoptr(virDomainDef) persistDef = NULL;
     g_autofree char *timestamp = NULL;
+    unsigned long bandwidth;
     int rc;
 
     if (resource > 0)
@@ -4117,9 +4383,13 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
             goto error;
     }
 
+    if (qemuMigrationSchedAdmit(driver, vm, QEMU_ASYNC_JOB_MIGRATION_OUT,
+                                &bandwidth) < 0)
+        goto error;
+
     if (bwParam &&
         qemuMigrationParamsSetULL(migParams, QEMU_MIGRATION_PARAM_MAX_BANDWIDTH,
-                                  priv->migMaxBandwidth * 1024 * 1024) < 0)
+                                  bandwidth * 1024 * 1024) < 0)
         goto error;
 
     if (qemuMigrationParamsApply(driver, vm, QEMU_ASYNC_JOB_MIGRATION_OUT,
@@ -4197,7 +4467,7 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
     }
 
     if (!bwParam &&
-        qemuMonitorSetMigrationSpeed(priv->mon, priv->migMaxBandwidth) < 0)
+        qemuMonitorSetMigrationSpeed(priv->mon, bandwidth) < 0)
         goto exit_monitor;
 
     /* connect to the destination qemu if needed */
@@ -4354,6 +4624,7 @@ qemuMigrationSrcRun(virQEMUDriver *driver,
     if (events)
         priv->signalIOError = false;
 
+    qemuMigrationSchedRelease(driver, vm);
     priv->migMaxBandwidth = restore_max_bandwidth;
     virErrorRestore(&orig_err);
 
@@ -4536,6 +4807,11 @@ qemuMigrationSrcPerformTunnel(virQEMUDriver *driver,
     spec.dest.fd.qemu = fds[1];
     spec.dest.fd.local = fds[0];
 
+#ifdef F_SETPIPE_SZ
+    /* Let QEMU fill a whole chunk without waiting for the tunnel thread */
+    ignore_value(fcntl(fds[0], F_SETPIPE_SZ, TUNNEL_SEND_BUF_SIZE));
+#endif
+
     if (spec.dest.fd.qemu == -1 ||
         qemuSecuritySetImageFDLabel(driver->securityManager, vm->def,
                                     spec.dest.fd.qemu) < 0) {
@@ -6045,6 +6321,130 @@ qemuMigrationSrcToFile(virQEMUDriver *driver, virDomainObj *vm,
 }
 
 
+/**
+ * qemuMigrationSrcToParallelFile:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @path: path to the save image
+ * @offset: offset in @path where QEMU should start writing
+ * @channels: number of parallel channels
+ * @asyncJob: async job
+ *
+ * Helper function called while vm is active. Unlike qemuMigrationSrcToFile
+ * QEMU opens @path on its own and writes guest memory using @channels
+ * multifd channels, each page at a fixed offset within the file. The caller
+ * is responsible for writing libvirt's header in front of @offset.
+ */
+int
+qemuMigrationSrcToParallelFile(virQEMUDriver *driver,
+                               virDomainObj *vm,
+                               const char *path,
+                               unsigned long long offset,
+                               unsigned int channels,
+                               qemuDomainAsyncJob asyncJob)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    unsigned long saveMigBandwidth = priv->migMaxBandwidth;
+    virErrorPtr orig_err = NULL;
+    g_autoptr(qemuMigrationParams) migParams = NULL;
+    g_autoptr(qemuMigrationParams) origParams = NULL;
+    bool relabel = false;
+    int ret = -1;
+    int rc;
+
+    if (strchr(path, ',')) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("parallel save to '%s' is not supported: "
+                         "path must not contain ','"), path);
+        return -1;
+    }
+
+    if (!(migParams = qemuMigrationParamsForSave(channels)))
+        return -1;
+
+    if (qemuMigrationParamsCheckSupported(vm, migParams) < 0)
+        return -1;
+
+    if (qemuMigrationSetDBusVMState(driver, vm) < 0)
+        return -1;
+
+    /* Target is a file, there's no reason to limit the bandwidth. */
+    if (qemuMigrationParamsSetULL(migParams,
+                                  QEMU_MIGRATION_PARAM_MAX_BANDWIDTH,
+                                  QEMU_DOMAIN_MIG_BANDWIDTH_MAX * 1024 * 1024) < 0)
+        return -1;
+
+    if (!(origParams = qemuMigrationParamsNew()) ||
+        qemuMigrationParamsSetULL(origParams,
+                                  QEMU_MIGRATION_PARAM_MAX_BANDWIDTH,
+                                  saveMigBandwidth * 1024 * 1024) < 0)
+        return -1;
+
+    if (qemuMigrationParamsApply(driver, vm, asyncJob, migParams) < 0)
+        goto cleanup;
+
+    priv->migMaxBandwidth = QEMU_DOMAIN_MIG_BANDWIDTH_MAX;
+
+    if (!virDomainObjIsActive(vm)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("guest unexpectedly quit"));
+        goto cleanup;
+    }
+
+    if (qemuSecuritySetSavedStateLabel(driver->securityManager,
+                                       vm->def, path) < 0)
+        goto cleanup;
+    relabel = true;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        goto cleanup;
+
+    rc = qemuMonitorMigrateToFile(priv->mon,
+                                  QEMU_MONITOR_MIGRATE_BACKGROUND,
+                                  path, offset);
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
+        goto cleanup;
+
+    rc = qemuMigrationSrcWaitForCompletion(driver, vm, asyncJob, NULL, 0);
+
+    if (rc < 0) {
+        if (rc == -2) {
+            virErrorPreserveLast(&orig_err);
+            if (virDomainObjIsActive(vm) &&
+                qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) == 0) {
+                qemuMonitorMigrateCancel(priv->mon);
+                ignore_value(qemuDomainObjExitMonitor(driver, vm));
+            }
+        }
+        goto cleanup;
+    }
+
+    qemuDomainEventEmitJobCompleted(driver, vm);
+    ret = 0;
+
+ cleanup:
+    if (ret < 0 && !orig_err)
+        virErrorPreserveLast(&orig_err);
+
+    if (relabel &&
+        qemuSecurityRestoreSavedStateLabel(driver->securityManager,
+                                           vm->def, path) < 0)
+        VIR_WARN("failed to restore save state label on %s", path);
+
+    /* Disable the capabilities again and restore max migration bandwidth */
+    if (virDomainObjIsActive(vm)) {
+        ignore_value(qemuMigrationParamsApply(driver, vm, asyncJob,
+                                              origParams));
+        priv->migMaxBandwidth = saveMigBandwidth;
+    }
+
+    virErrorRestore(&orig_err);
+
+    return ret;
+}
+
+
 int
 qemuMigrationSrcCancel(virQEMUDriver *driver,
                        virDomainObj *vm)
@@ -212,6 +212,16 @@ qemuMigrationSrcToFile(virQEMUDriver *driver,
                        qemuDomainAsyncJob asyncJob)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
 
+int
+qemuMigrationSrcToParallelFile(virQEMUDriver *driver,
+                               virDomainObj *vm,
+                               const char *path,
+                               unsigned long long offset,
+                               unsigned int channels,
+                               qemuDomainAsyncJob asyncJob)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3)
+    G_GNUC_WARN_UNUSED_RESULT;
+
 int
 qemuMigrationSrcCancel(virQEMUDriver *driver,
                        virDomainObj *vm);
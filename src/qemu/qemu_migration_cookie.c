@@ -1415,8 +1415,6 @@ qemuMigrationCookieXMLParseStr(qemuMigrationCookie *mig,
     g_autoptr(xmlDoc) doc = NULL;
     g_autoptr(xmlXPathContext) ctxt = NULL;
 
-    VIR_DEBUG("xml=%s", NULLSTR(xml));
-
     if (!(doc = virXMLParseStringCtxt(xml, _("(qemu_migration_cookie)"), &ctxt)))
         return -1;
 
@@ -1424,6 +1422,25 @@ qemuMigrationCookieXMLParseStr(qemuMigrationCookie *mig,
 }
 
 
+/**
+ * qemuMigrationCookieFormat:
+ * @mig: migration cookie
+ * @driver: qemu driver
+ * @dom: domain object
+ * @party: the side of migration formatting the cookie
+ * @cookieout: filled with the formatted cookie
+ * @cookieoutlen: filled with the length of @cookieout
+ * @flags: bitwise-OR of qemuMigrationCookieFlags
+ *
+ * Formats @mig into a cookie sent to the other side of migration. Only the
+ * sections requested by @flags (and those explicitly added to @mig by the
+ * caller) are formatted, sections parsed from an incoming cookie are never
+ * sent back. Thus each migration phase only transfers the data the next phase
+ * needs. Large cookies are compressed by the RPC layer if the connection
+ * negotiated it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
 int
 qemuMigrationCookieFormat(qemuMigrationCookie *mig,
                           virQEMUDriver *driver,
@@ -90,6 +90,7 @@ VIR_ENUM_IMPL(qemuMigrationCapability,
               "late-block-activate",
               "multifd",
               "dirty-bitmaps",
+              "mapped-ram",
 );
 
 
@@ -252,6 +253,30 @@ qemuMigrationParamsNew(void)
 }
 
 
+/**
+ * qemuMigrationParamsForSave:
+ * @channels: number of multifd channels
+ *
+ * Creates migration parameters for saving the memory of a domain into (or
+ * restoring it from) a seekable file using @channels parallel channels. Each
+ * page of guest RAM is stored at a fixed offset within the file so that the
+ * channels do not depend on each other.
+ */
+qemuMigrationParams *
+qemuMigrationParamsForSave(unsigned int channels)
+{
+    g_autoptr(qemuMigrationParams) params = qemuMigrationParamsNew();
+
+    ignore_value(virBitmapSetBit(params->caps, QEMU_MIGRATION_CAP_MULTIFD));
+    ignore_value(virBitmapSetBit(params->caps, QEMU_MIGRATION_CAP_MAPPED_RAM));
+
+    params->params[QEMU_MIGRATION_PARAM_MULTIFD_CHANNELS].value.i = channels;
+    params->params[QEMU_MIGRATION_PARAM_MULTIFD_CHANNELS].set = true;
+
+    return g_steal_pointer(&params);
+}
+
+
 void
 qemuMigrationParamsFree(qemuMigrationParams *migParams)
 {
@@ -1125,6 +1150,39 @@ qemuMigrationParamsGetULL(qemuMigrationParams *migParams,
 }
 
 
+/**
+ * qemuMigrationParamsCheckSupported:
+ * @vm: domain object
+ * @migParams: migration parameters
+ *
+ * Reports an error if any of the capabilities enabled in @migParams is not
+ * supported by QEMU running @vm.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+qemuMigrationParamsCheckSupported(virDomainObj *vm,
+                                  qemuMigrationParams *migParams)
+{
+    qemuMigrationCapability cap;
+
+    for (cap = 0; cap < QEMU_MIGRATION_CAP_LAST; cap++) {
+        bool state = false;
+
+        ignore_value(virBitmapGetBit(migParams->caps, cap, &state));
+
+        if (state && !qemuMigrationCapsGet(vm, cap)) {
+            virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                           _("Migration option '%s' is not supported by QEMU binary"),
+                           qemuMigrationCapabilityTypeToString(cap));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 /**
  * qemuMigrationParamsCheck:
  *
@@ -1151,18 +1209,8 @@ qemuMigrationParamsCheck(virQEMUDriver *driver,
     else
         party = QEMU_MIGRATION_DESTINATION;
 
-    for (cap = 0; cap < QEMU_MIGRATION_CAP_LAST; cap++) {
-        bool state = false;
-
-        ignore_value(virBitmapGetBit(migParams->caps, cap, &state));
-
-        if (state && !qemuMigrationCapsGet(vm, cap)) {
-            virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
-                           _("Migration option '%s' is not supported by QEMU binary"),
-                           qemuMigrationCapabilityTypeToString(cap));
-            return -1;
-        }
-    }
+    if (qemuMigrationParamsCheckSupported(vm, migParams) < 0)
+        return -1;
 
     for (i = 0; i < G_N_ELEMENTS(qemuMigrationParamsAlwaysOn); i++) {
         cap = qemuMigrationParamsAlwaysOn[i].cap;
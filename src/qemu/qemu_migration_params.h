@@ -40,6 +40,7 @@ typedef enum {
     QEMU_MIGRATION_CAP_LATE_BLOCK_ACTIVATE,
     QEMU_MIGRATION_CAP_MULTIFD,
     QEMU_MIGRATION_CAP_BLOCK_DIRTY_BITMAPS,
+    QEMU_MIGRATION_CAP_MAPPED_RAM,
 
     QEMU_MIGRATION_CAP_LAST
 } qemuMigrationCapability;
@@ -90,6 +91,9 @@ qemuMigrationParamsDump(qemuMigrationParams *migParams,
 qemuMigrationParams *
 qemuMigrationParamsNew(void);
 
+qemuMigrationParams *
+qemuMigrationParamsForSave(unsigned int channels);
+
 void
 qemuMigrationParamsFree(qemuMigrationParams *migParams);
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuMigrationParams, qemuMigrationParamsFree);
@@ -136,6 +140,10 @@ void
 qemuMigrationParamsSetBlockDirtyBitmapMapping(qemuMigrationParams *migParams,
                                               virJSONValue **params);
 
+int
+qemuMigrationParamsCheckSupported(virDomainObj *vm,
+                                  qemuMigrationParams *migParams);
+
 int
 qemuMigrationParamsCheck(virQEMUDriver *driver,
                          virDomainObj *vm,
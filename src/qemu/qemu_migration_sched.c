@@ -0,0 +1,432 @@
+/*
+ * qemu_migration_sched.c: QEMU outgoing migration scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "qemu_migration_sched.h"
+#include "qemu_domain.h"
+#include "qemu_monitor.h"
+#include "virerror.h"
+#include "virlog.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+VIR_LOG_INIT("qemu.qemu_migration_sched");
+
+/*
+ * When migration_host_bandwidth is set in qemu.conf, all outgoing migrations
+ * share the configured bandwidth. A migration has to be admitted by the
+ * scheduler before QEMU starts sending any data. Migrations are admitted in
+ * the order of the dirty rate of their domain, the ones which are expected
+ * to converge fast go first and free their share of bandwidth for the rest.
+ * The bandwidth is split evenly among active migrations, except for those
+ * limited to a lower bandwidth by the user, and redistributed every time a
+ * migration is admitted or finishes. Each migration thread applies its new
+ * share to QEMU once it is woken up by the scheduler.
+ */
+
+typedef struct _qemuMigrationSchedEntry qemuMigrationSchedEntry;
+struct _qemuMigrationSchedEntry {
+    virDomainObj *vm;
+    unsigned long long seq;
+    long long dirtyRate;    /* MiB/s, 0 if not measured */
+    unsigned long limit;    /* MiB/s requested for the migration */
+    unsigned long share;    /* MiB/s assigned by the scheduler */
+    unsigned long applied;  /* MiB/s currently set in QEMU */
+    bool active;
+};
+
+struct _qemuMigrationSched {
+    virMutex lock;
+    GPtrArray *entries;
+    size_t nactive;
+    unsigned long long seq;
+};
+
+
+static void
+qemuMigrationSchedEntryFree(void *opaque)
+{
+    qemuMigrationSchedEntry *entry = opaque;
+
+    virObjectUnref(entry->vm);
+    g_free(entry);
+}
+
+
+qemuMigrationSched *
+qemuMigrationSchedNew(void)
+{
+    qemuMigrationSched *sched = g_new0(qemuMigrationSched, 1);
+
+    if (virMutexInit(&sched->lock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize migration scheduler mutex"));
+        g_free(sched);
+        return NULL;
+    }
+
+    sched->entries = g_ptr_array_new_with_free_func(qemuMigrationSchedEntryFree);
+
+    return sched;
+}
+
+
+void
+qemuMigrationSchedFree(qemuMigrationSched *sched)
+{
+    if (!sched)
+        return;
+
+    g_ptr_array_unref(sched->entries);
+    virMutexDestroy(&sched->lock);
+    g_free(sched);
+}
+
+
+static qemuMigrationSchedEntry *
+qemuMigrationSchedFind(qemuMigrationSched *sched,
+                       virDomainObj *vm,
+                       size_t *idx)
+{
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuMigrationSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->vm == vm) {
+            if (idx)
+                *idx = i;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+
+static gint
+qemuMigrationSchedCompareLimit(gconstpointer a,
+                               gconstpointer b)
+{
+    const qemuMigrationSchedEntry *ea = *(qemuMigrationSchedEntry **) a;
+    const qemuMigrationSchedEntry *eb = *(qemuMigrationSchedEntry **) b;
+
+    if (ea->limit < eb->limit)
+        return -1;
+    return ea->limit > eb->limit;
+}
+
+
+/* Splits @budget among active migrations. Migrations limited below their
+ * fair share keep their limit and the rest is split among the others.
+ * Migrations whose share changed are woken up to apply it. Must be called
+ * with the scheduler locked.
+ */
+static void
+qemuMigrationSchedRebalance(qemuMigrationSched *sched,
+                            unsigned long budget)
+{
+    g_autoptr(GPtrArray) active = g_ptr_array_new();
+    unsigned long remaining = budget;
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuMigrationSchedEntry *entry = g_ptr_array_index(sched->entries, i);
+
+        if (entry->active)
+            g_ptr_array_add(active, entry);
+    }
+
+    g_ptr_array_sort(active, qemuMigrationSchedCompareLimit);
+
+    for (i = 0; i < active->len; i++) {
+        qemuMigrationSchedEntry *entry = g_ptr_array_index(active, i);
+        unsigned long share = MAX(remaining / (active->len - i), 1);
+
+        entry->share = MIN(share, entry->limit);
+        remaining -= MIN(entry->share, remaining);
+
+        if (entry->share != entry->applied)
+            virDomainObjBroadcast(entry->vm);
+    }
+}
+
+
+/* Returns true if @entry is the waiting migration with the lowest dirty
+ * rate, the one which was queued first wins a tie.
+ */
+static bool
+qemuMigrationSchedIsNext(qemuMigrationSched *sched,
+                         qemuMigrationSchedEntry *entry)
+{
+    size_t i;
+
+    for (i = 0; i < sched->entries->len; i++) {
+        qemuMigrationSchedEntry *other = g_ptr_array_index(sched->entries, i);
+
+        if (other == entry || other->active)
+            continue;
+
+        if (other->dirtyRate < entry->dirtyRate ||
+            (other->dirtyRate == entry->dirtyRate && other->seq < entry->seq))
+            return false;
+    }
+
+    return true;
+}
+
+
+static bool
+qemuMigrationSchedTryAdmit(qemuMigrationSched *sched,
+                           qemuMigrationSchedEntry *entry,
+                           virQEMUDriverConfig *cfg)
+{
+    if (entry->active)
+        return true;
+
+    if (cfg->migrationMaxConcurrent > 0 &&
+        sched->nactive >= cfg->migrationMaxConcurrent)
+        return false;
+
+    if (!qemuMigrationSchedIsNext(sched, entry))
+        return false;
+
+    entry->active = true;
+    sched->nactive++;
+    qemuMigrationSchedRebalance(sched, cfg->migrationHostBandwidth);
+
+    VIR_DEBUG("Admitted migration of domain %s, %zu active migrations",
+              entry->vm->def->name, sched->nactive);
+
+    return true;
+}
+
+
+static long long
+qemuMigrationSchedGetDirtyRate(virQEMUDriver *driver,
+                               virDomainObj *vm,
+                               qemuDomainAsyncJob asyncJob)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    qemuMonitorDirtyRateInfo info = { 0 };
+    int rc;
+
+    if (!virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_QUERY_DIRTY_RATE))
+        return 0;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return 0;
+
+    rc = qemuMonitorQueryDirtyRate(priv->mon, &info);
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0) {
+        virResetLastError();
+        return 0;
+    }
+
+    if (info.status != VIR_DOMAIN_DIRTYRATE_MEASURED)
+        return 0;
+
+    return info.dirtyRate;
+}
+
+
+/**
+ * qemuMigrationSchedAdmit:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @asyncJob: migration job
+ * @bandwidth: filled with the bandwidth assigned to the migration in MiB/s
+ *
+ * Waits until the outgoing migration of @vm can be started and stores the
+ * bandwidth it may use in @bandwidth. The migration has to be released by
+ * qemuMigrationSchedRelease once it finishes, even if this function fails.
+ * When the host bandwidth is not limited, this function doesn't wait and
+ * returns the bandwidth requested for the migration.
+ *
+ * Returns 0 on success, -1 on error (e.g., when the migration was aborted
+ * while waiting).
+ */
+int
+qemuMigrationSchedAdmit(virQEMUDriver *driver,
+                        virDomainObj *vm,
+                        qemuDomainAsyncJob asyncJob,
+                        unsigned long *bandwidth)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuMigrationSched *sched = driver->migrationSched;
+    qemuDomainObjPrivate *priv = vm->privateData;
+    qemuMigrationSchedEntry *entry;
+    bool admitted;
+
+    *bandwidth = priv->migMaxBandwidth;
+
+    if (cfg->migrationHostBandwidth == 0)
+        return 0;
+
+    entry = g_new0(qemuMigrationSchedEntry, 1);
+    entry->vm = virObjectRef(vm);
+    entry->limit = priv->migMaxBandwidth;
+    entry->dirtyRate = qemuMigrationSchedGetDirtyRate(driver, vm, asyncJob);
+
+    virMutexLock(&sched->lock);
+    entry->seq = sched->seq++;
+    g_ptr_array_add(sched->entries, entry);
+    virMutexUnlock(&sched->lock);
+
+    VIR_DEBUG("Queued migration of domain %s, dirty rate %lld MiB/s",
+              vm->def->name, entry->dirtyRate);
+
+    while (1) {
+        unsigned long long now;
+
+        virMutexLock(&sched->lock);
+        if ((admitted = qemuMigrationSchedTryAdmit(sched, entry, cfg)))
+            *bandwidth = entry->applied = entry->share;
+        virMutexUnlock(&sched->lock);
+
+        if (admitted)
+            return 0;
+
+        if (priv->job.abortJob) {
+            priv->job.current->status = QEMU_DOMAIN_JOB_STATUS_CANCELED;
+            virReportError(VIR_ERR_OPERATION_ABORTED, _("%s: %s"),
+                           qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
+                           _("canceled by client"));
+            return -1;
+        }
+
+        /* Wake up periodically to notice an aborted job */
+        if (virTimeMillisNow(&now) < 0 ||
+            virDomainObjWaitUntil(vm, now + 1000) < 0)
+            return -1;
+    }
+}
+
+
+/**
+ * qemuMigrationSchedUpdate:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @asyncJob: migration job
+ *
+ * Applies the bandwidth currently assigned to an outgoing migration of @vm
+ * by the scheduler. The function is a no-op for migrations which are not
+ * scheduled.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMigrationSchedUpdate(virQEMUDriver *driver,
+                         virDomainObj *vm,
+                         qemuDomainAsyncJob asyncJob)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuMigrationSched *sched = driver->migrationSched;
+    qemuDomainObjPrivate *priv = vm->privateData;
+    qemuMigrationSchedEntry *entry;
+    g_autoptr(virJSONValue) params = NULL;
+    unsigned long share;
+    int rc;
+
+    virMutexLock(&sched->lock);
+    if (!(entry = qemuMigrationSchedFind(sched, vm, NULL)) || !entry->active) {
+        virMutexUnlock(&sched->lock);
+        return 0;
+    }
+
+    /* The bandwidth was changed by virDomainMigrateSetMaxSpeed */
+    if (entry->limit != priv->migMaxBandwidth) {
+        entry->limit = priv->migMaxBandwidth;
+        entry->applied = 0;
+        qemuMigrationSchedRebalance(sched, cfg->migrationHostBandwidth);
+    }
+
+    share = entry->share;
+    if (share == entry->applied) {
+        virMutexUnlock(&sched->lock);
+        return 0;
+    }
+    entry->applied = share;
+    virMutexUnlock(&sched->lock);
+
+    VIR_DEBUG("Setting migration bandwidth of domain %s to %lu MiB/s",
+              vm->def->name, share);
+
+    if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_PARAM_BANDWIDTH) &&
+        virJSONValueObjectAdd(&params,
+                              "U:max-bandwidth", share * 1024ULL * 1024ULL,
+                              NULL) < 0)
+        return -1;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return -1;
+
+    if (params)
+        rc = qemuMonitorSetMigrationParams(priv->mon, &params);
+    else
+        rc = qemuMonitorSetMigrationSpeed(priv->mon, share);
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuMigrationSchedRelease:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Removes an outgoing migration of @vm from the scheduler and lets the next
+ * waiting migration start.
+ */
+void
+qemuMigrationSchedRelease(virQEMUDriver *driver,
+                          virDomainObj *vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuMigrationSched *sched = driver->migrationSched;
+    qemuMigrationSchedEntry *entry;
+    size_t idx;
+    size_t i;
+
+    virMutexLock(&sched->lock);
+    if (!(entry = qemuMigrationSchedFind(sched, vm, &idx))) {
+        virMutexUnlock(&sched->lock);
+        return;
+    }
+
+    if (entry->active)
+        sched->nactive--;
+    g_ptr_array_remove_index(sched->entries, idx);
+
+    qemuMigrationSchedRebalance(sched, cfg->migrationHostBandwidth);
+
+    for (i = 0; i < sched->entries->len; i++) {
+        entry = g_ptr_array_index(sched->entries, i);
+
+        if (!entry->active)
+            virDomainObjBroadcast(entry->vm);
+    }
+    virMutexUnlock(&sched->lock);
+}
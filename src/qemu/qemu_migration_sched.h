@@ -0,0 +1,44 @@
+/*
+ * qemu_migration_sched.h: QEMU outgoing migration scheduler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "qemu_conf.h"
+#include "qemu_domainjob.h"
+
+qemuMigrationSched *
+qemuMigrationSchedNew(void);
+
+void
+qemuMigrationSchedFree(qemuMigrationSched *sched);
+
+int
+qemuMigrationSchedAdmit(virQEMUDriver *driver,
+                        virDomainObj *vm,
+                        qemuDomainAsyncJob asyncJob,
+                        unsigned long *bandwidth);
+
+int
+qemuMigrationSchedUpdate(virQEMUDriver *driver,
+                         virDomainObj *vm,
+                         qemuDomainAsyncJob asyncJob);
+
+void
+qemuMigrationSchedRelease(virQEMUDriver *driver,
+                          virDomainObj *vm);
@@ -68,6 +68,10 @@ VIR_LOG_INIT("qemu.qemu_monitor");
  */
 #define QEMU_MONITOR_MAX_RESPONSE (10 * 1024 * 1024)
 
+/* Buffers grown beyond this size for a large reply are shrunk again once
+ * the reply was processed, see qemuMonitorIOShrinkBuffer */
+#define QEMU_MONITOR_BUFFER_KEEP (64 * 1024)
+
 struct _qemuMonitor {
     virObjectLockable parent;
 
@@ -84,8 +88,8 @@ struct _qemuMonitor {
     qemuMonitorCallbacks *cb;
     void *callbackOpaque;
 
-    /* If there's a command being processed this will be
-     * non-NULL */
+    /* Queue of commands being processed, oldest first. Multiple
+     * commands may be in flight, see qemuMonitorSendAsync */
     qemuMonitorMessage *msg;
 
     /* Buffer incoming data ready for Text/QMP monitor
@@ -94,10 +98,22 @@ struct _qemuMonitor {
     size_t bufferLength;
     char *buffer;
 
+    /* Number of bytes at the beginning of @buffer already fed to @parser,
+     * which holds the state of the partially received message */
+    size_t bufferScanned;
+    virJSONStreamParser *parser;
+
     /* If anything went wrong, this will be fed back
      * the next monitor msg */
     virError lastError;
 
+    /* Per command accounting, qemuMonitorCommandStats keyed by name */
+    GHashTable *commandStats;
+
+    /* Number of commands sent which may have modified the state of the
+     * guest, see qemuMonitorGetModifyGeneration */
+    unsigned long long modifyGeneration;
+
     /* Set to true when EOF is detected on the monitor */
     bool goteof;
 
@@ -201,6 +217,13 @@ VIR_ENUM_IMPL(qemuMonitorDumpStatus,
               "none", "active", "completed", "failed",
 );
 
+VIR_ENUM_IMPL(qemuMonitorDirtyRateCalcMode,
+              QEMU_MONITOR_DIRTYRATE_CALC_MODE_LAST,
+              "page-sampling",
+              "dirty-bitmap",
+              "dirty-ring",
+);
+
 VIR_ENUM_IMPL(qemuMonitorMemoryFailureRecipient,
               QEMU_MONITOR_MEMORY_FAILURE_RECIPIENT_LAST,
               "hypervisor", "guest");
@@ -210,6 +233,47 @@ VIR_ENUM_IMPL(qemuMonitorMemoryFailureAction,
               "ignore", "inject",
               "fatal", "reset");
 
+VIR_ENUM_IMPL(qemuMonitorQueryStatsTarget,
+              QEMU_MONITOR_QUERY_STATS_TARGET_LAST,
+              "vm", "vcpu");
+
+VIR_ENUM_IMPL(qemuMonitorQueryStatsType,
+              QEMU_MONITOR_QUERY_STATS_TYPE_LAST,
+              "cumulative", "instant", "peak",
+              "linear-histogram", "log2-histogram");
+
+VIR_ENUM_IMPL(qemuMonitorQueryStatsUnit,
+              QEMU_MONITOR_QUERY_STATS_UNIT_LAST,
+              "none", "bytes", "seconds", "cycles", "boolean");
+
+VIR_ENUM_IMPL(qemuMonitorLatencyBucket,
+              QEMU_MONITOR_LATENCY_LAST,
+              "1ms", "10ms", "100ms", "1s", "10s", "inf");
+
+/* Upper bounds of qemuMonitorLatencyBucket in microseconds */
+static const unsigned long long qemuMonitorLatencyLimit[] = {
+    1000ULL,
+    10 * 1000ULL,
+    100 * 1000ULL,
+    1000 * 1000ULL,
+    10 * 1000 * 1000ULL,
+};
+G_STATIC_ASSERT(G_N_ELEMENTS(qemuMonitorLatencyLimit) == QEMU_MONITOR_LATENCY_LAST - 1);
+
+
+static void
+qemuMonitorCommandStatsFree(void *opaque)
+{
+    qemuMonitorCommandStats *stats = opaque;
+
+    if (!stats)
+        return;
+
+    g_free(stats->name);
+    g_free(stats);
+}
+
+
 #if DEBUG_RAW_IO
 static char *
 qemuMonitorEscapeNonPrintable(const char *text)
@@ -242,6 +306,8 @@ qemuMonitorDispose(void *obj)
     virResetError(&mon->lastError);
     virCondDestroy(&mon->notify);
     g_free(mon->buffer);
+    virJSONStreamParserFree(mon->parser);
+    virHashFree(mon->commandStats);
     g_free(mon->balloonpath);
 }
 
@@ -314,6 +380,25 @@ qemuMonitorOpenUnix(const char *monitor,
 }
 
 
+/*
+ * The buffer is freed once all its data was processed. Shrink it also
+ * when only a partial message follows a large reply, so that it doesn't
+ * keep the size of the largest reply for the lifetime of the domain.
+ */
+static void
+qemuMonitorIOShrinkBuffer(qemuMonitor *mon)
+{
+    /* room for the pending data and its terminating NUL */
+    size_t len = MAX(QEMU_MONITOR_BUFFER_KEEP, 2 * (mon->bufferOffset + 1));
+
+    if (mon->bufferLength <= 2 * len)
+        return;
+
+    VIR_REALLOC_N(mon->buffer, len);
+    mon->bufferLength = len;
+}
+
+
 /* This method processes data that has been received
  * from the monitor. Looking for async events and
  * replies/errors.
@@ -322,18 +407,13 @@ static int
 qemuMonitorIOProcess(qemuMonitor *mon)
 {
     int len;
-    qemuMonitorMessage *msg = NULL;
-
-    /* See if there's a message & whether its ready for its reply
-     * ie whether its completed writing all its data */
-    if (mon->msg && mon->msg->txOffset == mon->msg->txLength)
-        msg = mon->msg;
+    qemuMonitorMessage *msg;
 
 #if DEBUG_IO
 # if DEBUG_RAW_IO
-    char *str1 = qemuMonitorEscapeNonPrintable(msg ? msg->txBuffer : "");
+    char *str1 = qemuMonitorEscapeNonPrintable(mon->msg ? mon->msg->txBuffer : "");
     char *str2 = qemuMonitorEscapeNonPrintable(mon->buffer);
-    VIR_ERROR(_("Process %d %p %p [[[[%s]]][[[%s]]]"), (int)mon->bufferOffset, mon->msg, msg, str1, str2);
+    VIR_ERROR(_("Process %d %p [[[[%s]]][[[%s]]]"), (int)mon->bufferOffset, mon->msg, str1, str2);
     VIR_FREE(str1);
     VIR_FREE(str2);
 # else
@@ -344,35 +424,115 @@ qemuMonitorIOProcess(qemuMonitor *mon)
     PROBE_QUIET(QEMU_MONITOR_IO_PROCESS, "mon=%p buf=%s len=%zu",
                 mon, mon->buffer, mon->bufferOffset);
 
-    len = qemuMonitorJSONIOProcess(mon,
+    len = qemuMonitorJSONIOProcess(mon, mon->parser,
                                    mon->buffer, mon->bufferOffset,
-                                   msg);
+                                   &mon->bufferScanned);
     if (len < 0)
         return -1;
 
     if (len && mon->waitGreeting)
         mon->waitGreeting = false;
 
-    if (len < mon->bufferOffset) {
-        memmove(mon->buffer, mon->buffer + len, mon->bufferOffset - len);
+    if (len == 0) {
+        /* nothing complete yet, the rest was already fed to the parser */
+    } else if (len < mon->bufferOffset) {
+        memmove(mon->buffer, mon->buffer + len, mon->bufferOffset - len + 1);
         mon->bufferOffset -= len;
+        mon->bufferScanned -= len;
+        qemuMonitorIOShrinkBuffer(mon);
     } else {
         VIR_FREE(mon->buffer);
-        mon->bufferOffset = mon->bufferLength = 0;
+        mon->bufferOffset = mon->bufferLength = mon->bufferScanned = 0;
     }
 #if DEBUG_IO
     VIR_DEBUG("Process done %d used %d", (int)mon->bufferOffset, len);
 #endif
 
     /* As the monitor mutex was unlocked in qemuMonitorJSONIOProcess()
-     * while dealing with qemu event, mon->msg could be changed which
-     * means the above 'msg' may be invalid, thus we use 'mon->msg' here */
-    if (mon->msg && mon->msg->finished)
-        virCondBroadcast(&mon->notify);
+     * while dealing with qemu event, the queue could have changed, thus
+     * it needs to be walked only now */
+    for (msg = mon->msg; msg; msg = msg->next) {
+        if (msg->finished) {
+            virCondBroadcast(&mon->notify);
+            break;
+        }
+    }
     return len;
 }
 
 
+/*
+ * Returns the first queued message which wasn't fully transmitted yet.
+ * Messages are written out strictly in the order they were queued in.
+ */
+static qemuMonitorMessage *
+qemuMonitorGetTxMessage(qemuMonitor *mon)
+{
+    qemuMonitorMessage *msg;
+
+    for (msg = mon->msg; msg; msg = msg->next) {
+        if (msg->txOffset < msg->txLength)
+            return msg;
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Marks all queued messages as finished and wakes up their waiters,
+ * used when the monitor can't be used any more.
+ */
+static void
+qemuMonitorFinishMessages(qemuMonitor *mon)
+{
+    qemuMonitorMessage *msg;
+
+    for (msg = mon->msg; msg; msg = msg->next)
+        msg->finished = true;
+
+    virCondBroadcast(&mon->notify);
+}
+
+
+/**
+ * qemuMonitorGetReplyMessage:
+ * @mon: monitor object
+ * @id: QMP 'id' of a received reply, may be NULL
+ *
+ * Looks up the queued message a reply received from QEMU belongs to. The
+ * message whose command carries @id is preferred, otherwise the oldest
+ * message still waiting for its reply is returned as QEMU replies to
+ * commands in the order they were sent.
+ *
+ * Returns the message or NULL if no message is waiting for a reply.
+ */
+qemuMonitorMessage *
+qemuMonitorGetReplyMessage(qemuMonitor *mon,
+                           const char *id)
+{
+    qemuMonitorMessage *oldest = NULL;
+    qemuMonitorMessage *msg;
+
+    for (msg = mon->msg; msg; msg = msg->next) {
+        /* a reply can only arrive for a fully transmitted command */
+        if (msg->txOffset < msg->txLength)
+            break;
+
+        if (msg->finished)
+            continue;
+
+        if (id && msg->id && STREQ(id, msg->id))
+            return msg;
+
+        if (!oldest)
+            oldest = msg;
+    }
+
+    return oldest;
+}
+
+
 /* Call this function while holding the monitor lock. */
 static int
 qemuMonitorIOWriteWithFD(qemuMonitor *mon,
@@ -419,41 +579,47 @@ qemuMonitorIOWriteWithFD(qemuMonitor *mon,
 static int
 qemuMonitorIOWrite(qemuMonitor *mon)
 {
-    int done;
-    const char *buf;
-    size_t len;
+    qemuMonitorMessage *msg;
+    int ret = 0;
 
-    /* If no active message, or fully transmitted, the no-op */
-    if (!mon->msg || mon->msg->txOffset == mon->msg->txLength)
-        return 0;
+    /* Write out as many of the queued messages as the socket takes */
+    while ((msg = qemuMonitorGetTxMessage(mon))) {
+        int done;
+        const char *buf = msg->txBuffer + msg->txOffset;
+        size_t len = msg->txLength - msg->txOffset;
 
-    buf = mon->msg->txBuffer + mon->msg->txOffset;
-    len = mon->msg->txLength - mon->msg->txOffset;
-    if (mon->msg->txFD == -1)
-        done = write(mon->fd, buf, len);
-    else
-        done = qemuMonitorIOWriteWithFD(mon, buf, len, mon->msg->txFD);
+        if (msg->txFD == -1)
+            done = write(mon->fd, buf, len);
+        else
+            done = qemuMonitorIOWriteWithFD(mon, buf, len, msg->txFD);
 
-    PROBE(QEMU_MONITOR_IO_WRITE,
-          "mon=%p buf=%s len=%zu ret=%d errno=%d",
-          mon, buf, len, done, done < 0 ? errno : 0);
+        PROBE(QEMU_MONITOR_IO_WRITE,
+              "mon=%p buf=%s len=%zu ret=%d errno=%d",
+              mon, buf, len, done, done < 0 ? errno : 0);
 
-    if (mon->msg->txFD != -1) {
-        PROBE(QEMU_MONITOR_IO_SEND_FD,
-              "mon=%p fd=%d ret=%d errno=%d",
-              mon, mon->msg->txFD, done, done < 0 ? errno : 0);
-    }
+        if (msg->txFD != -1) {
+            PROBE(QEMU_MONITOR_IO_SEND_FD,
+                  "mon=%p fd=%d ret=%d errno=%d",
+                  mon, msg->txFD, done, done < 0 ? errno : 0);
+        }
 
-    if (done < 0) {
-        if (errno == EAGAIN)
-            return 0;
+        if (done < 0) {
+            if (errno == EAGAIN)
+                break;
 
-        virReportSystemError(errno, "%s",
-                             _("Unable to write to monitor"));
-        return -1;
+            virReportSystemError(errno, "%s",
+                                 _("Unable to write to monitor"));
+            return -1;
+        }
+
+        msg->txOffset += done;
+        ret += done;
+
+        if (done < len)
+            break;
     }
-    mon->msg->txOffset += done;
-    return done;
+
+    return ret;
 }
 
 
@@ -470,15 +636,23 @@ qemuMonitorIORead(qemuMonitor *mon)
     int ret = 0;
 
     if (avail < 1024) {
+        size_t grow;
+
         if (mon->bufferLength >= QEMU_MONITOR_MAX_RESPONSE) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            _("QEMU monitor reply exceeds buffer size (%d bytes)"),
                            QEMU_MONITOR_MAX_RESPONSE);
             return -1;
         }
-        VIR_REALLOC_N(mon->buffer, mon->bufferLength + 1024);
-        mon->bufferLength += 1024;
-        avail += 1024;
+
+        /* Grow geometrically so that large replies don't need a realloc
+         * and a wakeup for every kilobyte received */
+        grow = MAX(1024, mon->bufferLength);
+        grow = MIN(grow, QEMU_MONITOR_MAX_RESPONSE - mon->bufferLength);
+
+        VIR_REALLOC_N(mon->buffer, mon->bufferLength + grow);
+        mon->bufferLength += grow;
+        avail += grow;
     }
 
     /* Read as much as we can get into our buffer,
@@ -616,12 +790,10 @@ qemuMonitorIO(GSocket *socket G_GNUC_UNUSED,
         }
 
         VIR_DEBUG("Error on monitor %s", NULLSTR(mon->lastError.message));
-        /* If IO process resulted in an error & we have a message,
-         * then wakeup that waiter */
-        if (mon->msg && !mon->msg->finished) {
-            mon->msg->finished = true;
-            virCondSignal(&mon->notify);
-        }
+        /* If IO process resulted in an error & we have messages,
+         * then wakeup their waiters */
+        if (mon->msg)
+            qemuMonitorFinishMessages(mon);
     }
 
     qemuMonitorUpdateWatch(mon);
@@ -695,6 +867,8 @@ qemuMonitorOpenInternal(virDomainObj *vm,
     mon->context = g_main_context_ref(context);
     mon->vm = virObjectRef(vm);
     mon->waitGreeting = true;
+    mon->parser = virJSONStreamParserNew();
+    mon->commandStats = virHashNew(qemuMonitorCommandStatsFree);
     mon->cb = cb;
     mon->callbackOpaque = opaque;
 
@@ -825,8 +999,7 @@ qemuMonitorRegister(qemuMonitor *mon)
     if (mon->lastError.code == VIR_ERR_OK) {
         cond |= G_IO_IN;
 
-        if ((mon->msg && mon->msg->txOffset < mon->msg->txLength) &&
-            !mon->waitGreeting)
+        if (qemuMonitorGetTxMessage(mon) && !mon->waitGreeting)
             cond |= G_IO_OUT;
     }
 
@@ -897,8 +1070,7 @@ qemuMonitorClose(qemuMonitor *mon)
             else
                 virResetLastError();
         }
-        mon->msg->finished = true;
-        virCondSignal(&mon->notify);
+        qemuMonitorFinishMessages(mon);
     }
 
     /* Propagate existing monitor error in case the current thread has no
@@ -927,11 +1099,77 @@ qemuMonitorResetCommandID(qemuMonitor *mon)
 }
 
 
+/**
+ * qemuMonitorCommandAccount:
+ * @mon: monitor object
+ * @msg: message whose processing finished
+ * @ret: result of waiting for the reply
+ *
+ * Records the time it took QEMU to reply to @msg along with the amount
+ * of data which was exchanged in the per command statistics of @mon.
+ */
+static void
+qemuMonitorCommandAccount(qemuMonitor *mon,
+                          qemuMonitorMessage *msg,
+                          int ret)
+{
+    qemuMonitorCommandStats *stats;
+    unsigned long long usec = g_get_monotonic_time() - msg->queued;
+    size_t i;
+
+    if (!msg->name)
+        return;
+
+    if (ret == 0 && msg->rxObject &&
+        virJSONValueObjectHasKey(msg->rxObject, "error") == 1)
+        ret = -1;
+
+    PROBE_QUIET(QEMU_MONITOR_COMMAND_DONE,
+                "mon=%p cmd=%s id=%s usec=%llu ret=%d",
+                mon, msg->name, NULLSTR(msg->id), usec, ret);
+
+    if (!(stats = g_hash_table_lookup(mon->commandStats, msg->name))) {
+        stats = g_new0(qemuMonitorCommandStats, 1);
+        stats->name = g_strdup(msg->name);
+        g_hash_table_insert(mon->commandStats, g_strdup(msg->name), stats);
+    }
+
+    stats->calls++;
+    if (ret < 0)
+        stats->errors++;
+
+    stats->time += usec * 1000;
+    stats->timeMax = MAX(stats->timeMax, usec * 1000);
+
+    for (i = 0; i < G_N_ELEMENTS(qemuMonitorLatencyLimit); i++) {
+        if (usec <= qemuMonitorLatencyLimit[i])
+            break;
+    }
+    stats->latency[i]++;
+
+    stats->bytesSent += msg->txOffset;
+    stats->bytesReceived += msg->rxLength;
+}
+
+
+/**
+ * qemuMonitorSendAsync:
+ * @mon: monitor object
+ * @msg: message to send
+ *
+ * Queues @msg to be sent to QEMU without waiting for its reply, so that
+ * multiple independent commands can be in flight on the monitor at once.
+ * The caller must not release @mon's lock between submitting the message
+ * and collecting its reply with qemuMonitorWaitMessage, which has to be
+ * called for every successfully queued message.
+ *
+ * Returns 0 on success, -1 on error.
+ */
 int
-qemuMonitorSend(qemuMonitor *mon,
-                qemuMonitorMessage *msg)
+qemuMonitorSendAsync(qemuMonitor *mon,
+                     qemuMonitorMessage *msg)
 {
-    int ret = -1;
+    qemuMonitorMessage **tail;
 
     /* Check whether qemu quit unexpectedly */
     if (mon->lastError.code != VIR_ERR_OK) {
@@ -946,14 +1184,42 @@ qemuMonitorSend(qemuMonitor *mon,
         return -1;
     }
 
-    mon->msg = msg;
+    for (tail = &mon->msg; *tail; tail = &(*tail)->next)
+        ;
+
+    msg->next = NULL;
+    msg->queued = g_get_monotonic_time();
+    *tail = msg;
+
+    if (!msg->name || !STRPREFIX(msg->name, "query-"))
+        mon->modifyGeneration++;
     qemuMonitorUpdateWatch(mon);
 
     PROBE(QEMU_MONITOR_SEND_MSG,
           "mon=%p msg=%s fd=%d",
-          mon, mon->msg->txBuffer, mon->msg->txFD);
+          mon, msg->txBuffer, msg->txFD);
+
+    return 0;
+}
+
+
+/**
+ * qemuMonitorWaitMessage:
+ * @mon: monitor object
+ * @msg: message queued by qemuMonitorSendAsync
+ *
+ * Waits until the reply to @msg arrives and removes @msg from the queue.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorWaitMessage(qemuMonitor *mon,
+                       qemuMonitorMessage *msg)
+{
+    qemuMonitorMessage **tmp;
+    int ret = -1;
 
-    while (!mon->msg->finished) {
+    while (!msg->finished) {
         if (virCondWait(&mon->notify, &mon->parent.lock) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("Unable to wait on monitor condition"));
@@ -971,13 +1237,47 @@ qemuMonitorSend(qemuMonitor *mon,
     ret = 0;
 
  cleanup:
-    mon->msg = NULL;
+    for (tmp = &mon->msg; *tmp; tmp = &(*tmp)->next) {
+        if (*tmp == msg) {
+            *tmp = msg->next;
+            break;
+        }
+    }
+    msg->next = NULL;
     qemuMonitorUpdateWatch(mon);
 
+    qemuMonitorCommandAccount(mon, msg, ret);
+
     return ret;
 }
 
 
+int
+qemuMonitorSend(qemuMonitor *mon,
+                qemuMonitorMessage *msg)
+{
+    if (qemuMonitorSendAsync(mon, msg) < 0)
+        return -1;
+
+    return qemuMonitorWaitMessage(mon, msg);
+}
+
+
+/**
+ * qemuMonitorGetModifyGeneration:
+ * @mon: monitor object
+ *
+ * Returns a counter which is incremented whenever a command which isn't a
+ * 'query-' command is sent to QEMU. Data obtained by a query command may be
+ * reused for as long as the returned value doesn't change.
+ */
+unsigned long long
+qemuMonitorGetModifyGeneration(qemuMonitor *mon)
+{
+    return mon->modifyGeneration;
+}
+
+
 /**
  * This function returns a new virError object; the caller is responsible
  * for freeing it.
@@ -992,6 +1292,62 @@ qemuMonitorLastError(qemuMonitor *mon)
 }
 
 
+void
+qemuMonitorStatsFree(qemuMonitorStats *stats)
+{
+    size_t i;
+
+    if (!stats)
+        return;
+
+    for (i = 0; i < stats->ncommands; i++)
+        g_free(stats->commands[i].name);
+    g_free(stats->commands);
+    g_free(stats);
+}
+
+
+/**
+ * qemuMonitorGetStats:
+ * @mon: monitor object
+ *
+ * Returns a snapshot of the per command statistics of @mon and of the
+ * commands still waiting for a reply. Unlike other monitor APIs this one
+ * does not talk to QEMU, locks @mon on its own and thus must not be called
+ * from within qemuDomainObjEnterMonitor.
+ */
+qemuMonitorStats *
+qemuMonitorGetStats(qemuMonitor *mon)
+{
+    g_autoptr(qemuMonitorStats) ret = g_new0(qemuMonitorStats, 1);
+    g_autofree virHashKeyValuePair *items = NULL;
+    qemuMonitorMessage *msg;
+    size_t i;
+
+    virObjectLock(mon);
+
+    items = virHashGetItems(mon->commandStats, &ret->ncommands, true);
+    ret->commands = g_new0(qemuMonitorCommandStats, ret->ncommands);
+
+    for (i = 0; i < ret->ncommands; i++) {
+        const qemuMonitorCommandStats *stats = items[i].value;
+
+        ret->commands[i] = *stats;
+        ret->commands[i].name = g_strdup(stats->name);
+    }
+
+    for (msg = mon->msg; msg; msg = msg->next) {
+        ret->pending++;
+        if (ret->pending == 1)
+            ret->pendingTime = (g_get_monotonic_time() - msg->queued) * 1000;
+    }
+
+    virObjectUnlock(mon);
+
+    return g_steal_pointer(&ret);
+}
+
+
 /**
  * Search the qom objects for the balloon driver object by its known names
  * of "virtio-balloon-pci" or "virtio-balloon-ccw". The entry for the driver
@@ -1593,6 +1949,7 @@ qemuMonitorCPUInfoClear(qemuMonitorCPUInfo *cpus,
         cpus[i].halted = false;
 
         VIR_FREE(cpus[i].qom_path);
+        VIR_FREE(cpus[i].thread_qom_path);
         VIR_FREE(cpus[i].alias);
         VIR_FREE(cpus[i].type);
         virJSONValueFree(cpus[i].props);
@@ -1622,8 +1979,10 @@ qemuMonitorQueryCpusFree(struct qemuMonitorQueryCpusEntry *entries,
     if (!entries)
         return;
 
-    for (i = 0; i < nentries; i++)
+    for (i = 0; i < nentries; i++) {
         g_free(entries[i].qom_path);
+        g_free(entries[i].thread_qom_path);
+    }
 
     g_free(entries);
 }
@@ -1645,6 +2004,7 @@ qemuMonitorGetCPUInfoLegacy(struct qemuMonitorQueryCpusEntry *cpuentries,
             vcpus[i].tid = cpuentries[i].tid;
             vcpus[i].halted = cpuentries[i].halted;
             vcpus[i].qemu_id = cpuentries[i].qemu_id;
+            vcpus[i].thread_qom_path = g_strdup(cpuentries[i].qom_path);
         }
 
         /* for legacy hotplug to work we need to fake the vcpu count added by
@@ -1705,6 +2065,9 @@ qemuMonitorGetCPUInfoHotplug(struct qemuMonitorQueryHotpluggableCpusEntry *hotpl
 
     /* trim '/thread...' suffix from the data returned by query-cpus[-fast] */
     for (i = 0; i < ncpuentries; i++) {
+        g_free(cpuentries[i].thread_qom_path);
+        cpuentries[i].thread_qom_path = g_strdup(cpuentries[i].qom_path);
+
         if (cpuentries[i].qom_path &&
             (tmp = strstr(cpuentries[i].qom_path, "/thread")))
             *tmp = '\0';
@@ -1789,6 +2152,8 @@ qemuMonitorGetCPUInfoHotplug(struct qemuMonitorQueryHotpluggableCpusEntry *hotpl
         vcpus[anyvcpu].qemu_id = cpuentries[j].qemu_id;
         vcpus[anyvcpu].tid = cpuentries[j].tid;
         vcpus[anyvcpu].halted = cpuentries[j].halted;
+        g_free(vcpus[anyvcpu].thread_qom_path);
+        vcpus[anyvcpu].thread_qom_path = g_steal_pointer(&cpuentries[j].thread_qom_path);
     }
 
     return 0;
@@ -2108,6 +2473,34 @@ qemuMonitorBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
 }
 
 
+/**
+ * qemuMonitorGetAllBlockStatsInfoBlockdev:
+ * @mon: monitor object
+ * @ret_stats: filled with a hash table of qemuBlockStats
+ *
+ * Combines qemuMonitorGetAllBlockStatsInfo and
+ * qemuMonitorBlockStatsUpdateCapacityBlockdev while sending the
+ * underlying commands to QEMU at once.
+ *
+ * Returns the number of stats fields reported, or -1 on error.
+ */
+int
+qemuMonitorGetAllBlockStatsInfoBlockdev(qemuMonitor *mon,
+                                        GHashTable **ret_stats)
+{
+    int ret;
+    g_autoptr(GHashTable) stats = virHashNew(g_free);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    if ((ret = qemuMonitorJSONGetAllBlockStatsInfoBlockdev(mon, stats)) < 0)
+        return -1;
+
+    *ret_stats = g_steal_pointer(&stats);
+    return ret;
+}
+
+
 /**
  * qemuMonitorBlockGetNamedNodeData:
  * @mon: monitor object
@@ -2481,6 +2874,22 @@ qemuMonitorMigrateToSocket(qemuMonitor *mon,
 }
 
 
+int
+qemuMonitorMigrateToFile(qemuMonitor *mon,
+                         unsigned int flags,
+                         const char *path,
+                         unsigned long long offset)
+{
+    g_autofree char *uri = g_strdup_printf("file:%s,offset=%llu", path, offset);
+
+    VIR_DEBUG("path=%s offset=%llu flags=0x%x", path, offset, flags);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONMigrate(mon, flags, uri);
+}
+
+
 int
 qemuMonitorMigrateCancel(qemuMonitor *mon)
 {
@@ -3267,6 +3676,30 @@ qemuMonitorGetAllBlockJobInfo(qemuMonitor *mon,
 }
 
 
+int
+qemuMonitorBlockJobPause(qemuMonitor *mon,
+                         const char *jobname)
+{
+    VIR_DEBUG("jobname=%s", jobname);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONBlockJobPause(mon, jobname);
+}
+
+
+int
+qemuMonitorBlockJobResume(qemuMonitor *mon,
+                          const char *jobname)
+{
+    VIR_DEBUG("jobname=%s", jobname);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONBlockJobResume(mon, jobname);
+}
+
+
 int
 qemuMonitorJobDismiss(qemuMonitor *mon,
                       const char *jobname)
@@ -3770,19 +4203,21 @@ qemuMonitorGetSEVCapabilities(qemuMonitor *mon,
 int
 qemuMonitorNBDServerStart(qemuMonitor *mon,
                           const virStorageNetHostDef *server,
-                          const char *tls_alias)
+                          const char *tls_alias,
+                          unsigned int max_connections)
 {
     /* Peek inside the struct for nicer logging */
     if (server->transport == VIR_STORAGE_NET_HOST_TRANS_TCP)
-        VIR_DEBUG("server={tcp host=%s port=%u} tls_alias=%s",
-                  NULLSTR(server->name), server->port, NULLSTR(tls_alias));
+        VIR_DEBUG("server={tcp host=%s port=%u} tls_alias=%s max_connections=%u",
+                  NULLSTR(server->name), server->port, NULLSTR(tls_alias),
+                  max_connections);
     else
-        VIR_DEBUG("server={unix socket=%s} tls_alias=%s",
-                  NULLSTR(server->socket), NULLSTR(tls_alias));
+        VIR_DEBUG("server={unix socket=%s} tls_alias=%s max_connections=%u",
+                  NULLSTR(server->socket), NULLSTR(tls_alias), max_connections);
 
     QEMU_CHECK_MONITOR(mon);
 
-    return qemuMonitorJSONNBDServerStart(mon, server, tls_alias);
+    return qemuMonitorJSONNBDServerStart(mon, server, tls_alias, max_connections);
 }
 
 
@@ -4560,13 +4995,15 @@ qemuMonitorTransactionBackup(virJSONValue *actions,
 
 int
 qemuMonitorStartDirtyRateCalc(qemuMonitor *mon,
-                              int seconds)
+                              int seconds,
+                              qemuMonitorDirtyRateCalcMode mode)
 {
-    VIR_DEBUG("seconds=%d", seconds);
+    VIR_DEBUG("seconds=%d, mode=%s",
+              seconds, qemuMonitorDirtyRateCalcModeTypeToString(mode));
 
     QEMU_CHECK_MONITOR(mon);
 
-    return qemuMonitorJSONStartDirtyRateCalc(mon, seconds);
+    return qemuMonitorJSONStartDirtyRateCalc(mon, seconds, mode);
 }
 
 
@@ -4582,6 +5019,17 @@ qemuMonitorQueryDirtyRate(qemuMonitor *mon,
 }
 
 
+void
+qemuMonitorDirtyRateInfoFree(qemuMonitorDirtyRateInfo *info)
+{
+    if (!info)
+        return;
+
+    g_free(info->rates);
+    g_free(info);
+}
+
+
 int
 qemuMonitorSetAction(qemuMonitor *mon,
                      qemuMonitorActionShutdown shutdown,
@@ -4609,3 +5057,98 @@ qemuMonitorChangeMemoryRequestedSize(qemuMonitor *mon,
 
     return qemuMonitorJSONChangeMemoryRequestedSize(mon, alias, requestedsize);
 }
+
+
+void
+qemuMonitorQueryStatsSchemaFree(qemuMonitorQueryStatsSchemaData *schema,
+                                size_t nschema)
+{
+    size_t i;
+
+    if (!schema)
+        return;
+
+    for (i = 0; i < nschema; i++)
+        g_free(schema[i].name);
+
+    g_free(schema);
+}
+
+
+/**
+ * qemuMonitorQueryStatsSchema:
+ * @mon: monitor object
+ * @schema: filled with the array of known statistics
+ * @nschema: filled with the number of elements in @schema
+ *
+ * Queries the description of the statistics QEMU's 'kvm' provider is
+ * able to report via query-stats.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorQueryStatsSchema(qemuMonitor *mon,
+                            qemuMonitorQueryStatsSchemaData **schema,
+                            size_t *nschema)
+{
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONQueryStatsSchema(mon, schema, nschema);
+}
+
+
+/**
+ * qemuMonitorQueryStats:
+ * @mon: monitor object
+ * @target: the kind of object statistics are queried for
+ *
+ * Queries statistics of the 'kvm' provider for all objects of @target,
+ * i.e. the VM as a whole or every vCPU, in a single command.
+ *
+ * Returns the 'return' array of query-stats (which is an array with one
+ * entry per object, see qemuMonitorExtractQueryStats), or NULL on error.
+ */
+virJSONValue *
+qemuMonitorQueryStats(qemuMonitor *mon,
+                      qemuMonitorQueryStatsTargetType target)
+{
+    VIR_DEBUG("target=%s", qemuMonitorQueryStatsTargetTypeToString(target));
+
+    QEMU_CHECK_MONITOR_NULL(mon);
+
+    return qemuMonitorJSONQueryStats(mon, target);
+}
+
+
+/**
+ * qemuMonitorExtractQueryStats:
+ * @info: single entry of the array returned by qemuMonitorQueryStats
+ *
+ * Returns a hash table mapping the names of the statistics in @info to
+ * their values. The values are borrowed from @info. Returns NULL if
+ * @info is malformed.
+ */
+GHashTable *
+qemuMonitorExtractQueryStats(virJSONValue *info)
+{
+    g_autoptr(GHashTable) hash = virHashNew(NULL);
+    virJSONValue *stats;
+    size_t i;
+
+    if (!(stats = virJSONValueObjectGetArray(info, "stats")))
+        return NULL;
+
+    for (i = 0; i < virJSONValueArraySize(stats); i++) {
+        virJSONValue *stat = virJSONValueArrayGet(stats, i);
+        virJSONValue *value = virJSONValueObjectGet(stat, "value");
+        const char *name = virJSONValueObjectGetString(stat, "name");
+
+        if (!name || !value)
+            continue;
+
+        if (virHashAddEntry(hash, name, value) < 0)
+            return NULL;
+    }
+
+    return g_steal_pointer(&hash);
+}
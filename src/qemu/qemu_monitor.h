@@ -53,6 +53,17 @@ struct _qemuMonitorMessage {
      * fatal error occurred on the monitor channel
      */
     bool finished;
+
+    /* QMP 'id' of the command used to pair it with its reply, may be NULL */
+    const char *id;
+
+    /* Name of the QMP command, used for accounting, may be NULL */
+    const char *name;
+    /* Monotonic time in microseconds when the message was queued */
+    unsigned long long queued;
+
+    /* Next message in the queue of messages submitted to the monitor */
+    qemuMonitorMessage *next;
 };
 
 typedef enum {
@@ -489,10 +500,18 @@ int qemuMonitorSetLink(qemuMonitor *mon,
                        virDomainNetInterfaceLinkState state)
     ATTRIBUTE_NONNULL(2);
 
+unsigned long long qemuMonitorGetModifyGeneration(qemuMonitor *mon);
+
 /* These APIs are for use by the internal Text/JSON monitor impl code only */
 char *qemuMonitorNextCommandID(qemuMonitor *mon);
 int qemuMonitorSend(qemuMonitor *mon,
                     qemuMonitorMessage *msg) G_GNUC_NO_INLINE;
+int qemuMonitorSendAsync(qemuMonitor *mon,
+                         qemuMonitorMessage *msg);
+int qemuMonitorWaitMessage(qemuMonitor *mon,
+                           qemuMonitorMessage *msg);
+qemuMonitorMessage *qemuMonitorGetReplyMessage(qemuMonitor *mon,
+                                               const char *id);
 int qemuMonitorUpdateVideoMemorySize(qemuMonitor *mon,
                                      virDomainVideoDef *video,
                                      const char *videoName)
@@ -636,6 +655,7 @@ struct qemuMonitorQueryCpusEntry {
     int qemu_id; /* id of the cpu as reported by qemu */
     pid_t tid;
     char *qom_path;
+    char *thread_qom_path; /* untrimmed copy of qom_path, used by query-stats */
     bool halted;
 };
 void qemuMonitorQueryCpusFree(struct qemuMonitorQueryCpusEntry *entries,
@@ -695,6 +715,9 @@ struct _qemuMonitorCPUInfo {
     /* internal for use in the matching code */
     char *qom_path;
 
+    /* qom path of the vcpu thread object, used to match query-stats data */
+    char *thread_qom_path;
+
     bool halted;
 };
 typedef struct _qemuMonitorCPUInfo qemuMonitorCPUInfo;
@@ -758,6 +781,9 @@ int qemuMonitorBlockStatsUpdateCapacity(qemuMonitor *mon,
 int qemuMonitorBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
                                                 GHashTable *stats)
     ATTRIBUTE_NONNULL(2);
+int qemuMonitorGetAllBlockStatsInfoBlockdev(qemuMonitor *mon,
+                                            GHashTable **ret_stats)
+    ATTRIBUTE_NONNULL(2);
 
 typedef struct _qemuBlockNamedNodeDataBitmap qemuBlockNamedNodeDataBitmap;
 struct _qemuBlockNamedNodeDataBitmap {
@@ -938,6 +964,11 @@ int qemuMonitorMigrateToSocket(qemuMonitor *mon,
                                unsigned int flags,
                                const char *socketPath);
 
+int qemuMonitorMigrateToFile(qemuMonitor *mon,
+                             unsigned int flags,
+                             const char *path,
+                             unsigned long long offset);
+
 int qemuMonitorMigrateCancel(qemuMonitor *mon);
 
 int qemuMonitorGetDumpGuestMemoryCapability(qemuMonitor *mon,
@@ -1152,6 +1183,14 @@ struct _qemuMonitorBlockJobInfo {
 GHashTable *qemuMonitorGetAllBlockJobInfo(qemuMonitor *mon,
                                               bool rawjobname);
 
+int qemuMonitorBlockJobPause(qemuMonitor *mon,
+                             const char *jobname)
+    ATTRIBUTE_NONNULL(2);
+
+int qemuMonitorBlockJobResume(qemuMonitor *mon,
+                              const char *jobname)
+    ATTRIBUTE_NONNULL(2);
+
 int qemuMonitorJobDismiss(qemuMonitor *mon,
                           const char *jobname)
     ATTRIBUTE_NONNULL(2);
@@ -1305,7 +1344,8 @@ char *qemuMonitorGetTargetArch(qemuMonitor *mon);
 
 int qemuMonitorNBDServerStart(qemuMonitor *mon,
                               const virStorageNetHostDef *server,
-                              const char *tls_alias)
+                              const char *tls_alias,
+                              unsigned int max_connections)
     ATTRIBUTE_NONNULL(2);
 int qemuMonitorNBDServerAdd(qemuMonitor *mon,
                             const char *deviceID,
@@ -1532,9 +1572,25 @@ qemuMonitorTransactionBackup(virJSONValue *actions,
                              const char *bitmap,
                              qemuMonitorTransactionBackupSyncMode syncmode);
 
+typedef enum {
+    QEMU_MONITOR_DIRTYRATE_CALC_MODE_PAGE_SAMPLING = 0,
+    QEMU_MONITOR_DIRTYRATE_CALC_MODE_DIRTY_BITMAP,
+    QEMU_MONITOR_DIRTYRATE_CALC_MODE_DIRTY_RING,
+    QEMU_MONITOR_DIRTYRATE_CALC_MODE_LAST,
+} qemuMonitorDirtyRateCalcMode;
+
+VIR_ENUM_DECL(qemuMonitorDirtyRateCalcMode);
+
 int
 qemuMonitorStartDirtyRateCalc(qemuMonitor *mon,
-                              int seconds);
+                              int seconds,
+                              qemuMonitorDirtyRateCalcMode mode);
+
+typedef struct _qemuMonitorDirtyRateVcpu qemuMonitorDirtyRateVcpu;
+struct _qemuMonitorDirtyRateVcpu {
+    int idx;                    /* virtual cpu index */
+    unsigned long long value;   /* virtual cpu dirty page rate in MiB/s */
+};
 
 typedef struct _qemuMonitorDirtyRateInfo qemuMonitorDirtyRateInfo;
 struct _qemuMonitorDirtyRateInfo {
@@ -1543,8 +1599,16 @@ struct _qemuMonitorDirtyRateInfo {
     int calcTime;           /* the period of dirtyrate calculation */
     long long startTime;    /* the start time of dirtyrate calculation */
     long long dirtyRate;    /* the dirtyrate in MiB/s */
+    qemuMonitorDirtyRateCalcMode mode;  /* calculation mode used in
+                                           last measurement */
+    size_t nvcpus;  /* number of virtual cpu */
+    qemuMonitorDirtyRateVcpu *rates; /* array of dirty page rate */
 };
 
+void
+qemuMonitorDirtyRateInfoFree(qemuMonitorDirtyRateInfo *info);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuMonitorDirtyRateInfo, qemuMonitorDirtyRateInfoFree);
+
 int
 qemuMonitorQueryDirtyRate(qemuMonitor *mon,
                           qemuMonitorDirtyRateInfo *info);
@@ -1560,3 +1624,107 @@ int
 qemuMonitorChangeMemoryRequestedSize(qemuMonitor *mon,
                                      const char *alias,
                                      unsigned long long requestedsize);
+
+typedef enum {
+    QEMU_MONITOR_QUERY_STATS_TARGET_VM,
+    QEMU_MONITOR_QUERY_STATS_TARGET_VCPU,
+
+    QEMU_MONITOR_QUERY_STATS_TARGET_LAST
+} qemuMonitorQueryStatsTargetType;
+
+VIR_ENUM_DECL(qemuMonitorQueryStatsTarget);
+
+typedef enum {
+    QEMU_MONITOR_QUERY_STATS_TYPE_CUMULATIVE,
+    QEMU_MONITOR_QUERY_STATS_TYPE_INSTANT,
+    QEMU_MONITOR_QUERY_STATS_TYPE_PEAK,
+    QEMU_MONITOR_QUERY_STATS_TYPE_LINEAR_HISTOGRAM,
+    QEMU_MONITOR_QUERY_STATS_TYPE_LOG2_HISTOGRAM,
+
+    QEMU_MONITOR_QUERY_STATS_TYPE_LAST
+} qemuMonitorQueryStatsTypeType;
+
+VIR_ENUM_DECL(qemuMonitorQueryStatsType);
+
+typedef enum {
+    QEMU_MONITOR_QUERY_STATS_UNIT_NONE,
+    QEMU_MONITOR_QUERY_STATS_UNIT_BYTES,
+    QEMU_MONITOR_QUERY_STATS_UNIT_SECONDS,
+    QEMU_MONITOR_QUERY_STATS_UNIT_CYCLES,
+    QEMU_MONITOR_QUERY_STATS_UNIT_BOOLEAN,
+
+    QEMU_MONITOR_QUERY_STATS_UNIT_LAST
+} qemuMonitorQueryStatsUnitType;
+
+VIR_ENUM_DECL(qemuMonitorQueryStatsUnit);
+
+/* Description of a single statistic of the 'kvm' provider as returned
+ * by query-stats-schemas */
+typedef struct _qemuMonitorQueryStatsSchemaData qemuMonitorQueryStatsSchemaData;
+struct _qemuMonitorQueryStatsSchemaData {
+    char *name;
+    qemuMonitorQueryStatsTargetType target;
+    qemuMonitorQueryStatsTypeType type;
+    qemuMonitorQueryStatsUnitType unit;
+    int base;
+    int exponent;
+    unsigned int bucketSize;
+};
+
+void
+qemuMonitorQueryStatsSchemaFree(qemuMonitorQueryStatsSchemaData *schema,
+                                size_t nschema);
+
+int
+qemuMonitorQueryStatsSchema(qemuMonitor *mon,
+                            qemuMonitorQueryStatsSchemaData **schema,
+                            size_t *nschema);
+
+virJSONValue *
+qemuMonitorQueryStats(qemuMonitor *mon,
+                      qemuMonitorQueryStatsTargetType target);
+
+GHashTable *
+qemuMonitorExtractQueryStats(virJSONValue *info);
+
+typedef enum {
+    QEMU_MONITOR_LATENCY_1MS,
+    QEMU_MONITOR_LATENCY_10MS,
+    QEMU_MONITOR_LATENCY_100MS,
+    QEMU_MONITOR_LATENCY_1S,
+    QEMU_MONITOR_LATENCY_10S,
+    QEMU_MONITOR_LATENCY_INF,
+
+    QEMU_MONITOR_LATENCY_LAST
+} qemuMonitorLatencyBucket;
+
+VIR_ENUM_DECL(qemuMonitorLatencyBucket);
+
+/* Accounting of a single QMP command issued on the monitor */
+typedef struct _qemuMonitorCommandStats qemuMonitorCommandStats;
+struct _qemuMonitorCommandStats {
+    char *name;
+    unsigned long long calls;
+    unsigned long long errors; /* error replies and monitor failures */
+    unsigned long long time; /* total time waiting for replies, in ns */
+    unsigned long long timeMax; /* in ns */
+    /* number of calls whose reply arrived within the bucket limit */
+    unsigned long long latency[QEMU_MONITOR_LATENCY_LAST];
+    unsigned long long bytesSent;
+    unsigned long long bytesReceived;
+};
+
+typedef struct _qemuMonitorStats qemuMonitorStats;
+struct _qemuMonitorStats {
+    qemuMonitorCommandStats *commands; /* sorted by name */
+    size_t ncommands;
+    size_t pending; /* commands still waiting for a reply */
+    unsigned long long pendingTime; /* age of the oldest pending one, in ns */
+};
+
+void
+qemuMonitorStatsFree(qemuMonitorStats *stats);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuMonitorStats, qemuMonitorStatsFree);
+
+qemuMonitorStats *
+qemuMonitorGetStats(qemuMonitor *mon);
@@ -212,36 +212,46 @@ qemuMonitorJSONIOProcessEvent(qemuMonitor *mon,
     return 0;
 }
 
+/**
+ * qemuMonitorJSONIOProcessLine:
+ * @mon: monitor object
+ * @line: text of the message, used for logging
+ * @obj: the already parsed message
+ *
+ * Dispatches a single message received from QEMU. If @obj is a reply
+ * it is stolen from the caller and handed to the queued message it
+ * belongs to.
+ */
 int
 qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
                              const char *line,
-                             qemuMonitorMessage *msg)
+                             virJSONValue **obj)
 {
-    g_autoptr(virJSONValue) obj = NULL;
-
     VIR_DEBUG("Line [%s]", line);
 
-    if (!(obj = virJSONValueFromString(line)))
-        return -1;
-
-    if (virJSONValueGetType(obj) != VIR_JSON_TYPE_OBJECT) {
+    if (virJSONValueGetType(*obj) != VIR_JSON_TYPE_OBJECT) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Parsed JSON reply '%s' isn't an object"), line);
         return -1;
     }
 
-    if (virJSONValueObjectHasKey(obj, "QMP") == 1) {
+    if (virJSONValueObjectHasKey(*obj, "QMP") == 1) {
         return 0;
-    } else if (virJSONValueObjectHasKey(obj, "event") == 1) {
+    } else if (virJSONValueObjectHasKey(*obj, "event") == 1) {
         PROBE(QEMU_MONITOR_RECV_EVENT,
               "mon=%p event=%s", mon, line);
-        return qemuMonitorJSONIOProcessEvent(mon, obj);
-    } else if (virJSONValueObjectHasKey(obj, "error") == 1 ||
-               virJSONValueObjectHasKey(obj, "return") == 1) {
+        return qemuMonitorJSONIOProcessEvent(mon, *obj);
+    } else if (virJSONValueObjectHasKey(*obj, "error") == 1 ||
+               virJSONValueObjectHasKey(*obj, "return") == 1) {
+        qemuMonitorMessage *msg;
+
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
+        msg = qemuMonitorGetReplyMessage(mon,
+                                         virJSONValueObjectGetString(*obj, "id"));
         if (msg) {
-            msg->rxObject = g_steal_pointer(&obj);
+            msg->rxObject = g_steal_pointer(obj);
+            msg->rxLength = strlen(line);
             msg->finished = 1;
             return 0;
         } else {
@@ -256,50 +266,80 @@ qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
     return -1;
 }
 
+/**
+ * qemuMonitorJSONIOProcess:
+ * @mon: monitor object
+ * @parser: parser keeping the state of the message being received
+ * @data: data received from the monitor, NUL-terminated
+ * @len: length of @data
+ * @scanned: number of bytes of @data which were already fed to @parser
+ *
+ * Processes all complete messages in @data. Bytes of an incomplete
+ * message are fed to @parser right away so that neither the search for
+ * the message delimiter nor the parsing has to start over once more data
+ * arrives. @scanned is updated accordingly.
+ *
+ * Returns the number of bytes of @data consumed by complete messages, or
+ * -1 on error.
+ */
 int qemuMonitorJSONIOProcess(qemuMonitor *mon,
-                             const char *data,
+                             virJSONStreamParser *parser,
+                             char *data,
                              size_t len,
-                             qemuMonitorMessage *msg)
+                             size_t *scanned)
 {
-    int used = 0;
+    size_t used = 0;
     /*VIR_DEBUG("Data %d bytes [%s]", len, data);*/
 
-    while (used < len) {
-        char *nl = strstr(data + used, LINE_ENDING);
-
-        if (nl) {
-            int got = nl - (data + used);
-            g_autofree char *line = g_strndup(data + used, got);
+    while (*scanned < len) {
+        char *nl = memchr(data + *scanned, '\n', len - *scanned);
+        g_autoptr(virJSONValue) obj = NULL;
+        char *line = data + used;
 
-            used += got + strlen(LINE_ENDING);
-            line[got] = '\0'; /* kill \n */
-            if (qemuMonitorJSONIOProcessLine(mon, line, msg) < 0)
+        if (!nl) {
+            if (virJSONStreamParserFeed(parser, data + *scanned,
+                                        len - *scanned) < 0)
                 return -1;
-        } else {
+            *scanned = len;
             break;
         }
+
+        if (virJSONStreamParserFeed(parser, data + *scanned,
+                                    nl - (data + *scanned)) < 0)
+            return -1;
+
+        used = nl - data + 1;
+        *scanned = used;
+
+        /* kill \r\n so that the message can be logged in place */
+        *nl = '\0';
+        if (nl > line && nl[-1] == LINE_ENDING[0])
+            nl[-1] = '\0';
+
+        if (!(obj = virJSONStreamParserFinish(parser)) ||
+            qemuMonitorJSONIOProcessLine(mon, line, &obj) < 0)
+            return -1;
     }
 
 #if DEBUG_IO
-    VIR_DEBUG("Total used %d bytes out of %zd available in buffer", used, len);
+    VIR_DEBUG("Total used %zu bytes out of %zu available in buffer", used, len);
 #endif
 
     return used;
 }
 
+/*
+ * Assigns a command id to @cmd and formats it into @cmdbuf which backs
+ * the transmit buffer of @msg.
+ */
 static int
-qemuMonitorJSONCommandWithFd(qemuMonitor *mon,
-                             virJSONValue *cmd,
-                             int scm_fd,
-                             virJSONValue **reply)
+qemuMonitorJSONCommandPrepare(qemuMonitor *mon,
+                              virJSONValue *cmd,
+                              int scm_fd,
+                              virBuffer *cmdbuf,
+                              qemuMonitorMessage *msg)
 {
-    int ret = -1;
-    qemuMonitorMessage msg;
-    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
-
-    *reply = NULL;
-
-    memset(&msg, 0, sizeof(msg));
+    memset(msg, 0, sizeof(*msg));
 
     if (virJSONValueObjectHasKey(cmd, "execute") == 1) {
         g_autofree char *id = qemuMonitorNextCommandID(mon);
@@ -309,15 +349,37 @@ qemuMonitorJSONCommandWithFd(qemuMonitor *mon,
                            _("Unable to append command 'id' string"));
             return -1;
         }
+
+        msg->id = virJSONValueObjectGetString(cmd, "id");
+        msg->name = virJSONValueObjectGetString(cmd, "execute");
     }
 
-    if (virJSONValueToBuffer(cmd, &cmdbuf, false) < 0)
+    if (virJSONValueToBuffer(cmd, cmdbuf, false) < 0)
         return -1;
-    virBufferAddLit(&cmdbuf, "\r\n");
+    virBufferAddLit(cmdbuf, "\r\n");
 
-    msg.txLength = virBufferUse(&cmdbuf);
-    msg.txBuffer = virBufferCurrentContent(&cmdbuf);
-    msg.txFD = scm_fd;
+    msg->txLength = virBufferUse(cmdbuf);
+    msg->txBuffer = virBufferCurrentContent(cmdbuf);
+    msg->txFD = scm_fd;
+
+    return 0;
+}
+
+
+static int
+qemuMonitorJSONCommandWithFd(qemuMonitor *mon,
+                             virJSONValue *cmd,
+                             int scm_fd,
+                             virJSONValue **reply)
+{
+    int ret = -1;
+    qemuMonitorMessage msg;
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+
+    *reply = NULL;
+
+    if (qemuMonitorJSONCommandPrepare(mon, cmd, scm_fd, &cmdbuf, &msg) < 0)
+        return -1;
 
     ret = qemuMonitorSend(mon, &msg);
 
@@ -343,6 +405,69 @@ qemuMonitorJSONCommand(qemuMonitor *mon,
     return qemuMonitorJSONCommandWithFd(mon, cmd, -1, reply);
 }
 
+
+/**
+ * qemuMonitorJSONCommands:
+ * @mon: monitor object
+ * @cmds: array of independent commands
+ * @replies: array filled with the replies to @cmds
+ * @ncmds: number of elements in @cmds and @replies
+ *
+ * Sends all @cmds to QEMU at once and collects their replies afterwards,
+ * so that executing them costs a single round trip. The commands must not
+ * depend on each other's results. Callers are expected to check each
+ * reply with qemuMonitorJSONCheckReply or qemuMonitorJSONCheckError.
+ *
+ * Returns 0 if all replies were received, -1 otherwise in which case
+ * @replies is left empty.
+ */
+static int
+qemuMonitorJSONCommands(qemuMonitor *mon,
+                        virJSONValue **cmds,
+                        virJSONValue **replies,
+                        size_t ncmds)
+{
+    g_autofree qemuMonitorMessage *msgs = g_new0(qemuMonitorMessage, ncmds);
+    g_autofree virBuffer *cmdbufs = g_new0(virBuffer, ncmds);
+    size_t nsent = 0;
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < ncmds; i++) {
+        if (qemuMonitorJSONCommandPrepare(mon, cmds[i], -1,
+                                          &cmdbufs[i], &msgs[i]) < 0 ||
+            qemuMonitorSendAsync(mon, &msgs[i]) < 0) {
+            ret = -1;
+            break;
+        }
+        nsent++;
+    }
+
+    /* all queued messages need to be collected even if something failed */
+    for (i = 0; i < nsent; i++) {
+        if (qemuMonitorWaitMessage(mon, &msgs[i]) < 0)
+            ret = -1;
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        if (ret == 0 && !msgs[i].rxObject) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Missing monitor reply object"));
+            ret = -1;
+        }
+
+        replies[i] = msgs[i].rxObject;
+        virBufferFreeAndReset(&cmdbufs[i]);
+    }
+
+    if (ret < 0) {
+        for (i = 0; i < ncmds; i++)
+            g_clear_pointer(&replies[i], virJSONValueFree);
+    }
+
+    return ret;
+}
+
 /* Ignoring OOM in this method, since we're already reporting
  * a more important error
  *
@@ -2470,17 +2595,13 @@ qemuMonitorJSONQueryBlockstats(qemuMonitor *mon,
 }
 
 
-int
-qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
-                                    GHashTable *hash)
+static int
+qemuMonitorJSONGetAllBlockStatsInfoData(virJSONValue *devices,
+                                        GHashTable *hash)
 {
     int nstats = 0;
     int rc;
     size_t i;
-    g_autoptr(virJSONValue) devices = NULL;
-
-    if (!(devices = qemuMonitorJSONQueryBlockstats(mon, true)))
-        return -1;
 
     for (i = 0; i < virJSONValueArraySize(devices); i++) {
         virJSONValue *dev = virJSONValueArrayGet(devices, i);
@@ -2511,6 +2632,19 @@ qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
 }
 
 
+int
+qemuMonitorJSONGetAllBlockStatsInfo(qemuMonitor *mon,
+                                    GHashTable *hash)
+{
+    g_autoptr(virJSONValue) devices = NULL;
+
+    if (!(devices = qemuMonitorJSONQueryBlockstats(mon, true)))
+        return -1;
+
+    return qemuMonitorJSONGetAllBlockStatsInfoData(devices, hash);
+}
+
+
 static int
 qemuMonitorJSONBlockStatsUpdateCapacityData(virJSONValue *image,
                                             const char *name,
@@ -2650,6 +2784,68 @@ qemuMonitorJSONBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
 }
 
 
+/**
+ * qemuMonitorJSONGetAllBlockStatsInfoBlockdev:
+ * @mon: monitor object
+ * @hash: hash table to fill
+ *
+ * Does the same as qemuMonitorJSONGetAllBlockStatsInfo followed by
+ * qemuMonitorJSONBlockStatsUpdateCapacityBlockdev, but issues
+ * 'query-blockstats' and 'query-named-block-nodes' at once.
+ */
+int
+qemuMonitorJSONGetAllBlockStatsInfoBlockdev(qemuMonitor *mon,
+                                            GHashTable *hash)
+{
+    g_autoptr(virJSONValue) statscmd = NULL;
+    g_autoptr(virJSONValue) nodescmd = NULL;
+    g_autoptr(virJSONValue) statsreply = NULL;
+    g_autoptr(virJSONValue) nodesreply = NULL;
+    g_autoptr(virJSONValue) devices = NULL;
+    g_autoptr(virJSONValue) nodes = NULL;
+    virJSONValue *cmds[2];
+    virJSONValue *replies[2];
+    int nstats;
+
+    if (!(statscmd = qemuMonitorJSONMakeCommand("query-blockstats",
+                                                "B:query-nodes", true,
+                                                NULL)) ||
+        !(nodescmd = qemuMonitorJSONMakeCommand("query-named-block-nodes",
+                                                "B:flat", false,
+                                                NULL)))
+        return -1;
+
+    cmds[0] = statscmd;
+    cmds[1] = nodescmd;
+
+    if (qemuMonitorJSONCommands(mon, cmds, replies, G_N_ELEMENTS(cmds)) < 0)
+        return -1;
+
+    statsreply = replies[0];
+    nodesreply = replies[1];
+
+    if (qemuMonitorJSONCheckReply(statscmd, statsreply, VIR_JSON_TYPE_ARRAY) < 0)
+        return -1;
+
+    devices = virJSONValueObjectStealArray(statsreply, "return");
+
+    if ((nstats = qemuMonitorJSONGetAllBlockStatsInfoData(devices, hash)) < 0)
+        return -1;
+
+    if (qemuMonitorJSONCheckReply(nodescmd, nodesreply, VIR_JSON_TYPE_ARRAY) < 0)
+        return -1;
+
+    nodes = virJSONValueObjectStealArray(nodesreply, "return");
+
+    if (virJSONValueArrayForeachSteal(nodes,
+                                      qemuMonitorJSONBlockStatsUpdateCapacityBlockdevWorker,
+                                      hash) < 0)
+        return -1;
+
+    return nstats;
+}
+
+
 static void
 qemuMonitorJSONBlockNamedNodeDataBitmapFree(qemuBlockNamedNodeDataBitmap *bitmap)
 {
@@ -4787,6 +4983,45 @@ qemuMonitorJSONDrivePivot(qemuMonitor *mon,
 }
 
 
+static int
+qemuMonitorJSONBlockJobPauseResume(qemuMonitor *mon,
+                                   const char *cmdname,
+                                   const char *jobname)
+{
+    g_autoptr(virJSONValue) cmd = NULL;
+    g_autoptr(virJSONValue) reply = NULL;
+
+    if (!(cmd = qemuMonitorJSONMakeCommand(cmdname,
+                                           "s:device", jobname,
+                                           NULL)))
+        return -1;
+
+    if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
+        return -1;
+
+    if (qemuMonitorJSONBlockJobError(cmd, reply, jobname) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+int
+qemuMonitorJSONBlockJobPause(qemuMonitor *mon,
+                             const char *jobname)
+{
+    return qemuMonitorJSONBlockJobPauseResume(mon, "block-job-pause", jobname);
+}
+
+
+int
+qemuMonitorJSONBlockJobResume(qemuMonitor *mon,
+                              const char *jobname)
+{
+    return qemuMonitorJSONBlockJobPauseResume(mon, "block-job-resume", jobname);
+}
+
+
 int
 qemuMonitorJSONJobDismiss(qemuMonitor *mon,
                           const char *jobname)
@@ -6453,7 +6688,8 @@ qemuMonitorJSONBuildUnixSocketAddress(const char *path)
 int
 qemuMonitorJSONNBDServerStart(qemuMonitor *mon,
                               const virStorageNetHostDef *server,
-                              const char *tls_alias)
+                              const char *tls_alias,
+                              unsigned int max_connections)
 {
     g_autoptr(virJSONValue) cmd = NULL;
     g_autoptr(virJSONValue) reply = NULL;
@@ -6480,6 +6716,7 @@ qemuMonitorJSONNBDServerStart(qemuMonitor *mon,
     if (!(cmd = qemuMonitorJSONMakeCommand("nbd-server-start",
                                            "a:addr", &addr,
                                            "S:tls-creds", tls_alias,
+                                           "p:max-connections", max_connections,
                                            NULL)))
         return -1;
 
@@ -8520,13 +8757,20 @@ qemuMonitorJSONGetCPUMigratable(qemuMonitor *mon,
 
 int
 qemuMonitorJSONStartDirtyRateCalc(qemuMonitor *mon,
-                                  int seconds)
+                                  int seconds,
+                                  qemuMonitorDirtyRateCalcMode mode)
 {
     g_autoptr(virJSONValue) cmd = NULL;
     g_autoptr(virJSONValue) reply = NULL;
+    const char *modestr = NULL;
+
+    /* page-sampling is the default, don't bother older QEMUs with it */
+    if (mode != QEMU_MONITOR_DIRTYRATE_CALC_MODE_PAGE_SAMPLING)
+        modestr = qemuMonitorDirtyRateCalcModeTypeToString(mode);
 
     if (!(cmd = qemuMonitorJSONMakeCommand("calc-dirty-rate",
                                            "i:calc-time", seconds,
+                                           "S:mode", modestr,
                                            NULL)))
         return -1;
 
@@ -8546,12 +8790,47 @@ VIR_ENUM_IMPL(qemuMonitorDirtyRateStatus,
               "measuring",
               "measured");
 
+static int
+qemuMonitorJSONExtractVcpuDirtyRate(virJSONValue *data,
+                                    qemuMonitorDirtyRateInfo *info)
+{
+    size_t nvcpus;
+    size_t i;
+
+    nvcpus = virJSONValueArraySize(data);
+    info->nvcpus = nvcpus;
+    info->rates = g_new0(qemuMonitorDirtyRateVcpu, nvcpus);
+
+    for (i = 0; i < nvcpus; i++) {
+        virJSONValue *entry = virJSONValueArrayGet(data, i);
+        if (virJSONValueObjectGetNumberInt(entry, "id",
+                                           &info->rates[i].idx) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("query-dirty-rate reply was missing 'id' data"));
+            return -1;
+        }
+
+        if (virJSONValueObjectGetNumberUlong(entry, "dirty-rate",
+                                             &info->rates[i].value) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("query-dirty-rate reply was missing 'dirty-rate' data"));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 qemuMonitorJSONExtractDirtyRateInfo(virJSONValue *data,
                                     qemuMonitorDirtyRateInfo *info)
 {
     const char *statusstr;
+    const char *modestr;
     int status;
+    int mode = QEMU_MONITOR_DIRTYRATE_CALC_MODE_PAGE_SAMPLING;
+    virJSONValue *rates = NULL;
 
     if (!(statusstr = virJSONValueObjectGetString(data, "status"))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -8588,6 +8867,19 @@ qemuMonitorJSONExtractDirtyRateInfo(virJSONValue *data,
         return -1;
     }
 
+    if ((modestr = virJSONValueObjectGetString(data, "mode"))) {
+        if ((mode = qemuMonitorDirtyRateCalcModeTypeFromString(modestr)) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Unknown dirty page rate calculation mode: %s"), modestr);
+            return -1;
+        }
+    }
+    info->mode = mode;
+
+    if ((rates = virJSONValueObjectGetArray(data, "vcpu-dirty-rate")) &&
+        qemuMonitorJSONExtractVcpuDirtyRate(rates, info) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -8711,3 +9003,149 @@ qemuMonitorJSONChangeMemoryRequestedSize(qemuMonitor *mon,
 
     return qemuMonitorJSONSetObjectProperty(mon, path, "requested-size", &prop);
 }
+
+
+static int
+qemuMonitorJSONExtractQueryStatsSchema(virJSONValue *entry,
+                                       qemuMonitorQueryStatsTargetType target,
+                                       qemuMonitorQueryStatsSchemaData *data)
+{
+    const char *name = virJSONValueObjectGetString(entry, "name");
+    const char *type = virJSONValueObjectGetString(entry, "type");
+    const char *unit = virJSONValueObjectGetString(entry, "unit");
+    int tmp;
+
+    if (!name || !type) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("query-stats-schemas reply was missing stat name or type"));
+        return -1;
+    }
+
+    if ((tmp = qemuMonitorQueryStatsTypeTypeFromString(type)) < 0) {
+        VIR_DEBUG("ignoring stat '%s' of unknown type '%s'", name, type);
+        return 0;
+    }
+    data->type = tmp;
+
+    data->unit = QEMU_MONITOR_QUERY_STATS_UNIT_NONE;
+    if (unit) {
+        if ((tmp = qemuMonitorQueryStatsUnitTypeFromString(unit)) <= 0) {
+            VIR_DEBUG("ignoring stat '%s' of unknown unit '%s'", name, unit);
+            return 0;
+        }
+        data->unit = tmp;
+    }
+
+    /* all of these are optional */
+    ignore_value(virJSONValueObjectGetNumberInt(entry, "base", &data->base));
+    ignore_value(virJSONValueObjectGetNumberInt(entry, "exponent", &data->exponent));
+    ignore_value(virJSONValueObjectGetNumberUint(entry, "bucket-size", &data->bucketSize));
+
+    data->target = target;
+    data->name = g_strdup(name);
+    return 1;
+}
+
+
+int
+qemuMonitorJSONQueryStatsSchema(qemuMonitor *mon,
+                                qemuMonitorQueryStatsSchemaData **schema,
+                                size_t *nschema)
+{
+    g_autoptr(virJSONValue) cmd = NULL;
+    g_autoptr(virJSONValue) reply = NULL;
+    virJSONValue *data;
+    qemuMonitorQueryStatsSchemaData *list = NULL;
+    size_t nlist = 0;
+    size_t i;
+    size_t j;
+
+    *schema = NULL;
+    *nschema = 0;
+
+    if (!(cmd = qemuMonitorJSONMakeCommand("query-stats-schemas",
+                                           "s:provider", "kvm",
+                                           NULL)))
+        return -1;
+
+    if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
+        return -1;
+
+    if (qemuMonitorJSONCheckReply(cmd, reply, VIR_JSON_TYPE_ARRAY) < 0)
+        return -1;
+
+    data = virJSONValueObjectGetArray(reply, "return");
+
+    for (i = 0; i < virJSONValueArraySize(data); i++) {
+        virJSONValue *entry = virJSONValueArrayGet(data, i);
+        const char *target = virJSONValueObjectGetString(entry, "target");
+        virJSONValue *stats = virJSONValueObjectGetArray(entry, "stats");
+        int targetType;
+
+        if (!target || !stats) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("query-stats-schemas reply was missing target or stats"));
+            goto error;
+        }
+
+        /* Only the targets libvirt knows how to query are interesting */
+        if ((targetType = qemuMonitorQueryStatsTargetTypeFromString(target)) < 0)
+            continue;
+
+        VIR_EXPAND_N(list, nlist, virJSONValueArraySize(stats));
+
+        for (j = 0; j < virJSONValueArraySize(stats); j++) {
+            int rc = qemuMonitorJSONExtractQueryStatsSchema(virJSONValueArrayGet(stats, j),
+                                                            targetType,
+                                                            &list[*nschema]);
+
+            if (rc < 0)
+                goto error;
+
+            if (rc > 0)
+                (*nschema)++;
+        }
+
+        VIR_SHRINK_N(list, nlist, nlist - *nschema);
+    }
+
+    *schema = list;
+    return 0;
+
+ error:
+    qemuMonitorQueryStatsSchemaFree(list, nlist);
+    *nschema = 0;
+    return -1;
+}
+
+
+virJSONValue *
+qemuMonitorJSONQueryStats(qemuMonitor *mon,
+                          qemuMonitorQueryStatsTargetType target)
+{
+    g_autoptr(virJSONValue) cmd = NULL;
+    g_autoptr(virJSONValue) reply = NULL;
+    g_autoptr(virJSONValue) providers = virJSONValueNewArray();
+    g_autoptr(virJSONValue) provider = NULL;
+
+    if (virJSONValueObjectAdd(&provider, "s:provider", "kvm", NULL) < 0)
+        return NULL;
+
+    if (virJSONValueArrayAppend(providers, &provider) < 0)
+        return NULL;
+
+    if (!(cmd = qemuMonitorJSONMakeCommand("query-stats",
+                                           "s:target",
+                                           qemuMonitorQueryStatsTargetTypeToString(target),
+                                           "a:providers", &providers,
+                                           NULL)))
+        return NULL;
+
+    if (qemuMonitorJSONCommand(mon, cmd, &reply) < 0)
+        return NULL;
+
+    if (qemuMonitorJSONCheckReply(cmd, reply, VIR_JSON_TYPE_ARRAY) < 0)
+        return NULL;
+
+    return virJSONValueObjectStealArray(reply, "return");
+}
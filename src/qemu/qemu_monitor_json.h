@@ -30,12 +30,13 @@
 
 int qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
                                  const char *line,
-                                 qemuMonitorMessage *msg) G_GNUC_NO_INLINE;
+                                 virJSONValue **obj) G_GNUC_NO_INLINE;
 
 int qemuMonitorJSONIOProcess(qemuMonitor *mon,
-                             const char *data,
+                             virJSONStreamParser *parser,
+                             char *data,
                              size_t len,
-                             qemuMonitorMessage *msg);
+                             size_t *scanned);
 
 int qemuMonitorJSONHumanCommand(qemuMonitor *mon,
                                 const char *cmd,
@@ -83,6 +84,8 @@ int qemuMonitorJSONBlockStatsUpdateCapacity(qemuMonitor *mon,
                                             GHashTable *stats);
 int qemuMonitorJSONBlockStatsUpdateCapacityBlockdev(qemuMonitor *mon,
                                                     GHashTable *stats);
+int qemuMonitorJSONGetAllBlockStatsInfoBlockdev(qemuMonitor *mon,
+                                                GHashTable *hash);
 
 GHashTable *
 qemuMonitorJSONBlockGetNamedNodeDataJSON(virJSONValue *nodes);
@@ -337,6 +340,14 @@ GHashTable *qemuMonitorJSONGetAllBlockJobInfo(qemuMonitor *mon,
                                                   bool rawjobname)
     ATTRIBUTE_NONNULL(1);
 
+int qemuMonitorJSONBlockJobPause(qemuMonitor *mon,
+                                 const char *jobname)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
+int qemuMonitorJSONBlockJobResume(qemuMonitor *mon,
+                                  const char *jobname)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 int qemuMonitorJSONJobDismiss(qemuMonitor *mon,
                               const char *jobname)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
@@ -484,7 +495,8 @@ char *qemuMonitorJSONGetTargetArch(qemuMonitor *mon);
 
 int qemuMonitorJSONNBDServerStart(qemuMonitor *mon,
                                   const virStorageNetHostDef *server,
-                                  const char *tls_alias);
+                                  const char *tls_alias,
+                                  unsigned int max_connections);
 int qemuMonitorJSONNBDServerAdd(qemuMonitor *mon,
                                 const char *deviceID,
                                 const char *export,
@@ -694,7 +706,8 @@ qemuMonitorJSONGetCPUMigratable(qemuMonitor *mon,
 
 int
 qemuMonitorJSONStartDirtyRateCalc(qemuMonitor *mon,
-                                  int seconds);
+                                  int seconds,
+                                  qemuMonitorDirtyRateCalcMode mode);
 
 int
 qemuMonitorJSONQueryDirtyRate(qemuMonitor *mon,
@@ -711,3 +724,12 @@ int
 qemuMonitorJSONChangeMemoryRequestedSize(qemuMonitor *mon,
                                          const char *alias,
                                          unsigned long long requestedsize);
+
+int
+qemuMonitorJSONQueryStatsSchema(qemuMonitor *mon,
+                                qemuMonitorQueryStatsSchemaData **schema,
+                                size_t *nschema);
+
+virJSONValue *
+qemuMonitorJSONQueryStats(qemuMonitor *mon,
+                          qemuMonitorQueryStatsTargetType target);
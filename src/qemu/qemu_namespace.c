@@ -23,6 +23,7 @@
 
 #ifdef __linux__
 # include <sys/sysmacros.h>
+# include <sched.h>
 #endif
 #if defined(WITH_SYS_MOUNT_H)
 # include <sys/mount.h>
@@ -30,6 +31,7 @@
 #ifdef WITH_SELINUX
 # include <selinux/selinux.h>
 #endif
+#include <sys/socket.h>
 
 #include "qemu_namespace.h"
 #include "qemu_domain.h"
@@ -41,6 +43,8 @@
 #include "virstring.h"
 #include "virdevmapper.h"
 #include "virglibutil.h"
+#include "virfile.h"
+#include "virprocess.h"
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -844,6 +848,10 @@ void
 qemuDomainDestroyNamespace(virQEMUDriver *driver G_GNUC_UNUSED,
                            virDomainObj *vm)
 {
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    g_clear_pointer(&priv->nsHelper, qemuNamespaceHelperFree);
+
     if (qemuDomainNamespaceEnabled(vm, QEMU_DOMAIN_NS_MOUNT))
         qemuDomainDisableNamespace(vm, QEMU_DOMAIN_NS_MOUNT);
 }
@@ -897,6 +905,47 @@ struct _qemuNamespaceMknodData {
 };
 
 
+/*
+ * Instead of forking a child which enters the mount namespace of a domain
+ * every time a device is to be created or removed there, a helper process
+ * can be kept in the namespace (see namespace_helper in qemu.conf). It is
+ * forked when the namespace is modified for the first time and receives
+ * requests over a socket until the domain is stopped. It holds a reference
+ * to the root directory of the host so that it can look at the original
+ * files when creating their copies in the namespace.
+ *
+ * Every request is a single packet consisting of NUL terminated strings:
+ * the operation ("mknod" or "unlink") followed by pairs of file and
+ * target ("" if there is none) for "mknod", or paths for "unlink". The
+ * helper replies with qemuNamespaceHelperReply.
+ */
+#define QEMU_NAMESPACE_HELPER_MAX_REQUEST (64 * 1024)
+
+struct _qemuNamespaceHelper {
+    pid_t pid;
+    int fd;
+};
+
+typedef struct _qemuNamespaceHelperReply qemuNamespaceHelperReply;
+struct _qemuNamespaceHelperReply {
+    int ret;
+    char message[1024];
+};
+
+
+void
+qemuNamespaceHelperFree(qemuNamespaceHelper *helper)
+{
+    if (!helper)
+        return;
+
+    /* The helper exits on its own once it sees the socket closed */
+    VIR_FORCE_CLOSE(helper->fd);
+    virProcessAbort(helper->pid);
+    g_free(helper);
+}
+
+
 static void
 qemuNamespaceMknodItemClear(qemuNamespaceMknodItem *item)
 {
@@ -1102,6 +1151,302 @@ qemuNamespaceMknodHelper(pid_t pid G_GNUC_UNUSED,
 }
 
 
+static int
+qemuNamespaceHelperCloseFDs(int keepfd1,
+                            int keepfd2)
+{
+    const char *dirName = "/proc/self/fd";
+    g_autoptr(DIR) dp = NULL;
+    g_autoptr(GArray) fds = g_array_new(false, false, sizeof(int));
+    struct dirent *entry;
+    size_t i;
+    int rc;
+
+    if (virDirOpen(&dp, dirName) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dp, &entry, dirName)) > 0) {
+        int fd;
+
+        if (virStrToLong_i(entry->d_name, NULL, 10, &fd) < 0 ||
+            fd <= STDERR_FILENO || fd == keepfd1 || fd == keepfd2 ||
+            fd == dirfd(dp))
+            continue;
+
+        g_array_append_val(fds, fd);
+    }
+
+    if (rc < 0)
+        return -1;
+
+    for (i = 0; i < fds->len; i++) {
+        int fd = g_array_index(fds, int, i);
+
+        VIR_FORCE_CLOSE(fd);
+    }
+
+    return 0;
+}
+
+
+static int
+qemuNamespaceHelperMknod(int hostRoot,
+                         const char *file,
+                         const char *target)
+{
+    g_auto(qemuNamespaceMknodItem) item = { 0 };
+    g_autofree char *hostFile = NULL;
+
+    /* @file in the namespace is just a copy, the original is still
+     * available through the host root directory. */
+    hostFile = g_strdup_printf("/proc/self/fd/%d%s", hostRoot, file);
+
+    item.file = g_strdup(file);
+    if (*target)
+        item.target = g_strdup(target);
+
+    if (g_lstat(hostFile, &item.sb) < 0) {
+        virReportSystemError(errno, _("Unable to access %s"), file);
+        return -1;
+    }
+
+    if (!S_ISLNK(item.sb.st_mode) &&
+        virFileGetACLs(hostFile, &item.acl) < 0 &&
+        errno != ENOTSUP) {
+        virReportSystemError(errno, _("Unable to get ACLs on %s"), file);
+        return -1;
+    }
+
+# ifdef WITH_SELINUX
+    if (lgetfilecon_raw(hostFile, &item.tcon) < 0 &&
+        (errno != ENOTSUP && errno != ENODATA)) {
+        virReportSystemError(errno,
+                             _("Unable to get SELinux label from %s"), file);
+        return -1;
+    }
+# endif
+
+    return qemuNamespaceMknodOne(&item);
+}
+
+
+static int
+qemuNamespaceHelperProcess(const char *buf,
+                           size_t len,
+                           int hostRoot)
+{
+    const char *end = buf + len;
+    const char *op = buf;
+    const char *cur;
+    bool mknod;
+    bool exists = false;
+
+    if (len == 0 || buf[len - 1] != '\0')
+        goto malformed;
+
+    if (STREQ(op, "mknod"))
+        mknod = true;
+    else if (STREQ(op, "unlink"))
+        mknod = false;
+    else
+        goto malformed;
+
+    cur = op + strlen(op) + 1;
+    while (cur < end) {
+        const char *file = cur;
+
+        cur += strlen(cur) + 1;
+
+        if (mknod) {
+            const char *target = cur;
+            int rc;
+
+            if (cur >= end)
+                goto malformed;
+            cur += strlen(cur) + 1;
+
+            if ((rc = qemuNamespaceHelperMknod(hostRoot, file, target)) < 0)
+                return -1;
+
+            if (rc > 0)
+                exists = true;
+        } else {
+            VIR_DEBUG("Unlinking %s", file);
+            if (unlink(file) < 0 && errno != ENOENT) {
+                virReportSystemError(errno,
+                                     _("Unable to remove device %s"), file);
+                return -1;
+            }
+        }
+    }
+
+    return exists;
+
+ malformed:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("malformed namespace helper request"));
+    return -1;
+}
+
+
+static int
+qemuNamespaceHelperLoop(int fd,
+                        int hostRoot)
+{
+    g_autofree char *buf = g_new0(char, QEMU_NAMESPACE_HELPER_MAX_REQUEST);
+
+    while (true) {
+        qemuNamespaceHelperReply reply = { 0 };
+        ssize_t len;
+
+        if ((len = recv(fd, buf, QEMU_NAMESPACE_HELPER_MAX_REQUEST, 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        /* The daemon closed the socket, we are no longer needed */
+        if (len == 0)
+            return 0;
+
+        if ((reply.ret = qemuNamespaceHelperProcess(buf, len, hostRoot)) < 0) {
+            ignore_value(virStrcpyStatic(reply.message,
+                                         virGetLastErrorMessage()));
+            virResetLastError();
+        }
+
+        if (safewrite(fd, &reply, sizeof(reply)) < 0)
+            return -1;
+    }
+}
+
+
+static qemuNamespaceHelper *
+qemuNamespaceHelperStart(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    virQEMUDriver *driver = priv->driver;
+    qemuNamespaceHelper *helper;
+    pid_t qemupid = vm->pid;
+    int pair[2] = { -1, -1 };
+    pid_t child;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create namespace helper socket"));
+        return NULL;
+    }
+
+    if (qemuSecurityPreFork(driver->securityManager) < 0)
+        goto error;
+
+    if ((child = virFork()) == 0) {
+        g_autofree char *path = NULL;
+        int hostRoot;
+        int nsfd;
+
+        qemuSecurityPostFork(driver->securityManager);
+        VIR_FORCE_CLOSE(pair[0]);
+
+        /* Unlike short-lived children this one must not keep any of the
+         * daemon's FDs (clients, monitors, ...) open. */
+        if ((hostRoot = open("/", O_PATH | O_DIRECTORY | O_CLOEXEC)) < 0 ||
+            qemuNamespaceHelperCloseFDs(pair[1], hostRoot) < 0)
+            _exit(EXIT_CANCELED);
+
+        path = g_strdup_printf("/proc/%lld/ns/mnt", (long long)qemupid);
+        if ((nsfd = open(path, O_RDONLY | O_CLOEXEC)) < 0 ||
+            setns(nsfd, CLONE_NEWNS) < 0)
+            _exit(EXIT_CANCELED);
+        VIR_FORCE_CLOSE(nsfd);
+
+        _exit(qemuNamespaceHelperLoop(pair[1], hostRoot) < 0 ? EXIT_CANCELED : 0);
+    }
+
+    qemuSecurityPostFork(driver->securityManager);
+
+    if (child < 0)
+        goto error;
+
+    VIR_FORCE_CLOSE(pair[1]);
+
+    VIR_DEBUG("Started namespace helper %lld for domain %s",
+              (long long)child, vm->def->name);
+
+    helper = g_new0(qemuNamespaceHelper, 1);
+    helper->pid = child;
+    helper->fd = pair[0];
+
+    return helper;
+
+ error:
+    VIR_FORCE_CLOSE(pair[0]);
+    VIR_FORCE_CLOSE(pair[1]);
+    return NULL;
+}
+
+
+/**
+ * qemuNamespaceHelperRun:
+ * @vm: domain object
+ * @req: request as described above
+ *
+ * Let the namespace helper of @vm process @req, starting the helper if
+ * needed.
+ *
+ * Returns -2 if the helper is not enabled or can't be used, in which case
+ * the caller is supposed to do the job itself, otherwise the result of the
+ * request, i.e. -1 with an error reported, 0 or 1 if any of the created
+ * files existed already.
+ */
+static int
+qemuNamespaceHelperRun(virDomainObj *vm,
+                       GByteArray *req)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
+    qemuNamespaceHelperReply reply = { 0 };
+
+    if (!cfg->namespaceHelper ||
+        req->len > QEMU_NAMESPACE_HELPER_MAX_REQUEST)
+        return -2;
+
+    if (!priv->nsHelper &&
+        !(priv->nsHelper = qemuNamespaceHelperStart(vm))) {
+        VIR_WARN("Unable to start namespace helper for domain %s: %s",
+                 vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+        return -2;
+    }
+
+    /* Both operations are idempotent so if the helper went away in the
+     * middle of a request the caller can safely repeat it. */
+    if (send(priv->nsHelper->fd, req->data, req->len, MSG_NOSIGNAL) < 0 ||
+        saferead(priv->nsHelper->fd, &reply, sizeof(reply)) != sizeof(reply)) {
+        VIR_WARN("Namespace helper for domain %s is gone", vm->def->name);
+        g_clear_pointer(&priv->nsHelper, qemuNamespaceHelperFree);
+        return -2;
+    }
+
+    if (reply.ret < 0) {
+        reply.message[sizeof(reply.message) - 1] = '\0';
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("namespace helper failed: %s"), reply.message);
+        return -1;
+    }
+
+    return reply.ret;
+}
+
+
+static void
+qemuNamespaceHelperAddString(GByteArray *req,
+                             const char *str)
+{
+    g_byte_array_append(req, (const guint8 *)str, strlen(str) + 1);
+}
+
+
 static int
 qemuNamespaceMknodItemInit(qemuNamespaceMknodItem *item,
                            virQEMUDriverConfig *cfg,
@@ -1248,6 +1593,7 @@ qemuNamespaceMknodPaths(virDomainObj *vm,
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     g_auto(GStrv) devMountsPath = NULL;
     qemuNamespaceMknodData data = { 0 };
+    g_autoptr(GByteArray) req = NULL;
     size_t i;
     int ret = -1;
     GSList *next;
@@ -1279,12 +1625,21 @@ qemuNamespaceMknodPaths(virDomainObj *vm,
         }
     }
 
-    if (qemuSecurityPreFork(driver->securityManager) < 0)
-        goto cleanup;
+    req = g_byte_array_new();
+    qemuNamespaceHelperAddString(req, "mknod");
+    for (i = 0; i < data.nitems; i++) {
+        qemuNamespaceHelperAddString(req, data.items[i].file);
+        qemuNamespaceHelperAddString(req, NULLSTR_EMPTY(data.items[i].target));
+    }
 
-    ret = virProcessRunInMountNamespace(vm->pid, qemuNamespaceMknodHelper,
-                                        &data);
-    qemuSecurityPostFork(driver->securityManager);
+    if ((ret = qemuNamespaceHelperRun(vm, req)) == -2) {
+        if (qemuSecurityPreFork(driver->securityManager) < 0)
+            goto cleanup;
+
+        ret = virProcessRunInMountNamespace(vm->pid, qemuNamespaceMknodHelper,
+                                            &data);
+        qemuSecurityPostFork(driver->securityManager);
+    }
 
     if (ret == 0 && created != NULL)
         *created = true;
@@ -1304,6 +1659,22 @@ qemuNamespaceMknodPaths(virDomainObj *vm,
 #else /* !defined(__linux__) */
 
 
+static int
+qemuNamespaceHelperRun(virDomainObj *vm G_GNUC_UNUSED,
+                       GByteArray *req G_GNUC_UNUSED)
+{
+    return -2;
+}
+
+
+static void
+qemuNamespaceHelperAddString(GByteArray *req,
+                             const char *str)
+{
+    g_byte_array_append(req, (const guint8 *)str, strlen(str) + 1);
+}
+
+
 static int
 qemuNamespaceMknodPaths(virDomainObj *vm G_GNUC_UNUSED,
                         GSList *paths G_GNUC_UNUSED,
@@ -1349,7 +1720,9 @@ qemuNamespaceUnlinkPaths(virDomainObj *vm,
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     g_auto(GStrv) devMountsPath = NULL;
     g_autoptr(virGSListString) unlinkPaths = NULL;
+    g_autoptr(GByteArray) req = NULL;
     GSList *next;
+    int rc;
 
     if (!paths)
         return 0;
@@ -1381,10 +1754,20 @@ qemuNamespaceUnlinkPaths(virDomainObj *vm,
         }
     }
 
-    if (unlinkPaths &&
-        virProcessRunInMountNamespace(vm->pid,
-                                      qemuNamespaceUnlinkHelper,
-                                      unlinkPaths) < 0)
+    if (!unlinkPaths)
+        return 0;
+
+    req = g_byte_array_new();
+    qemuNamespaceHelperAddString(req, "unlink");
+    for (next = unlinkPaths; next; next = next->next)
+        qemuNamespaceHelperAddString(req, next->data);
+
+    if ((rc = qemuNamespaceHelperRun(vm, req)) == -2)
+        rc = virProcessRunInMountNamespace(vm->pid,
+                                           qemuNamespaceUnlinkHelper,
+                                           unlinkPaths);
+
+    if (rc < 0)
         return -1;
 
     return 0;
@@ -23,6 +23,7 @@
 
 #include "virenum.h"
 #include "qemu_conf.h"
+#include "qemu_domain.h"
 #include "virconf.h"
 
 typedef enum {
@@ -47,6 +48,8 @@ int qemuDomainBuildNamespace(virQEMUDriverConfig *cfg,
 void qemuDomainDestroyNamespace(virQEMUDriver *driver,
                                 virDomainObj *vm);
 
+void qemuNamespaceHelperFree(qemuNamespaceHelper *helper);
+
 bool qemuDomainNamespaceAvailable(qemuDomainNamespace ns);
 
 int qemuDomainNamespaceSetupDisk(virDomainObj *vm,
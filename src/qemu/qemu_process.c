@@ -95,9 +95,15 @@
 #include "viridentity.h"
 #include "virthreadjob.h"
 #include "virutil.h"
+#include "virsystemd.h"
+#include "virprobe.h"
 #include "storage_source.h"
 #include "backup_conf.h"
 
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
 VIR_LOG_INIT("qemu.qemu_process");
@@ -260,30 +266,196 @@ qemuConnectAgent(virQEMUDriver *driver, virDomainObj *vm)
 }
 
 
+/* Protects the event queues of all domains, see qemuProcessEventSubmit.
+ * The queues are not protected by the domain object lock, as events may
+ * be submitted without holding it. */
+static virMutex qemuProcessEventLock = VIR_MUTEX_INITIALIZER;
+
+
+static void
+qemuProcessEventDiscard(struct qemuProcessEvent *event)
+{
+    virObjectUnref(event->vm);
+    qemuProcessEventFree(event);
+}
+
+
+/**
+ * qemuProcessEventCoalesce:
+ * @queue: queue of events of a domain waiting to be processed
+ * @event: new event
+ *
+ * Merges @event into an equivalent event waiting in @queue, if there's
+ * one. Returns true if @event was merged and thus shall be discarded.
+ */
+static bool
+qemuProcessEventCoalesce(GQueue *queue,
+                         struct qemuProcessEvent *event)
+{
+    GList *next;
+
+    for (next = queue->tail; next; next = next->prev) {
+        struct qemuProcessEvent *queued = next->data;
+
+        if (queued->eventType != event->eventType)
+            continue;
+
+        switch (event->eventType) {
+        case QEMU_PROCESS_EVENT_NIC_RX_FILTER_CHANGED:
+            /* the handler reads the current filter of the device anyway */
+            if (STREQ(queued->data, event->data))
+                return true;
+            break;
+
+        case QEMU_PROCESS_EVENT_MEMORY_DEVICE_SIZE_CHANGE: {
+            qemuMonitorMemoryDeviceSizeChange *queuedInfo = queued->data;
+            qemuMonitorMemoryDeviceSizeChange *info = event->data;
+
+            /* only the latest size is of interest */
+            if (STREQ(queuedInfo->devAlias, info->devAlias)) {
+                queuedInfo->size = info->size;
+                return true;
+            }
+            break;
+        }
+
+        case QEMU_PROCESS_EVENT_BLOCKJOB_SCHED:
+            return true;
+
+        case QEMU_PROCESS_EVENT_WATCHDOG:
+        case QEMU_PROCESS_EVENT_GUESTPANIC:
+        case QEMU_PROCESS_EVENT_DEVICE_DELETED:
+        case QEMU_PROCESS_EVENT_SERIAL_CHANGED:
+        case QEMU_PROCESS_EVENT_BLOCK_JOB:
+        case QEMU_PROCESS_EVENT_JOB_STATUS_CHANGE:
+        case QEMU_PROCESS_EVENT_MONITOR_EOF:
+        case QEMU_PROCESS_EVENT_PR_DISCONNECT:
+        case QEMU_PROCESS_EVENT_RDMA_GID_STATUS_CHANGED:
+        case QEMU_PROCESS_EVENT_GUEST_CRASHLOADED:
+        case QEMU_PROCESS_EVENT_LAST:
+            return false;
+        }
+    }
+
+    return false;
+}
+
+
 /**
  * qemuProcessEventSubmit:
  * @driver: QEMU driver object
  * @event: pointer to the variable holding the event processing data (stolen and cleared)
  *
- * Submits @event to be processed by the asynchronous event handling thread.
+ * Submits @event to be processed by the asynchronous event handling threads.
+ * (*event)->vm must be set and hold a reference to the domain object.
+ *
+ * Every domain has its own queue of events, which are processed in order,
+ * one at a time. The domains with pending events take turns in the worker
+ * pool, so that a burst of events of one domain doesn't delay the others.
+ * An event equivalent to one which is still waiting in the queue is merged
+ * with it.
+ *
  * In case when submission of the handling fails @event is properly freed and
- * cleared. If (*event)->vm is non-NULL the domain object is uref'd before freeing
- * @event.
+ * cleared and the domain object is unref'd.
+ *
+ * Returns 0 on success, -1 on failure.
  */
-static void
+int
 qemuProcessEventSubmit(virQEMUDriver *driver,
                        struct qemuProcessEvent **event)
 {
+    virDomainObj *vm;
+    qemuDomainObjPrivate *priv;
+    int ret = -1;
+
     if (!*event)
-        return;
+        return 0;
+
+    vm = (*event)->vm;
+    priv = vm->privateData;
+
+    virMutexLock(&qemuProcessEventLock);
+
+    if (qemuProcessEventCoalesce(&priv->events, *event)) {
+        VIR_DEBUG("Merged event %d of domain %s with a queued one",
+                  (*event)->eventType, vm->def->name);
+        qemuProcessEventDiscard(g_steal_pointer(event));
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (!priv->eventsScheduled) {
+        if (virThreadPoolSendJob(driver->workerPool, 0, virObjectRef(vm)) < 0) {
+            virObjectUnref(vm);
+            qemuProcessEventDiscard(g_steal_pointer(event));
+            goto cleanup;
+        }
 
-    if (virThreadPoolSendJob(driver->workerPool, 0, *event) < 0) {
-        if ((*event)->vm)
-            virObjectUnref((*event)->vm);
-        qemuProcessEventFree(*event);
+        priv->eventsScheduled = true;
     }
 
-    *event = NULL;
+    g_queue_push_tail(&priv->events, g_steal_pointer(event));
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&qemuProcessEventLock);
+    return ret;
+}
+
+
+/**
+ * qemuProcessEventPop:
+ * @vm: domain object
+ *
+ * Returns the next event of @vm to be processed by the worker which was
+ * handed @vm by the worker pool, or NULL if there's none.
+ */
+struct qemuProcessEvent *
+qemuProcessEventPop(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    struct qemuProcessEvent *event;
+
+    virMutexLock(&qemuProcessEventLock);
+    event = g_queue_pop_head(&priv->events);
+    virMutexUnlock(&qemuProcessEventLock);
+
+    return event;
+}
+
+
+/**
+ * qemuProcessEventReschedule:
+ * @driver: QEMU driver object
+ * @vm: domain object (reference is stolen)
+ *
+ * To be called by the worker after it processed an event of @vm. If @vm
+ * has more events pending, it is put back to the end of the worker pool
+ * queue, otherwise it's marked as idle.
+ */
+void
+qemuProcessEventReschedule(virQEMUDriver *driver,
+                           virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    struct qemuProcessEvent *event;
+
+    virMutexLock(&qemuProcessEventLock);
+
+    if (!g_queue_is_empty(&priv->events)) {
+        if (virThreadPoolSendJob(driver->workerPool, 0, vm) == 0) {
+            virMutexUnlock(&qemuProcessEventLock);
+            return;
+        }
+
+        while ((event = g_queue_pop_head(&priv->events)))
+            qemuProcessEventDiscard(event);
+    }
+
+    priv->eventsScheduled = false;
+    virMutexUnlock(&qemuProcessEventLock);
+
+    virObjectUnref(vm);
 }
 
 
@@ -929,6 +1101,8 @@ qemuProcessHandleBlockJob(qemuMonitor *mon G_GNUC_UNUSED,
 
     priv = vm->privateData;
 
+    qemuBlockNamedNodeDataInvalidate(vm);
+
     /* with QEMU_CAPS_BLOCKDEV we handle block job events via JOB_STATUS_CHANGE */
     if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV))
         goto cleanup;
@@ -981,6 +1155,8 @@ qemuProcessHandleJobStatusChange(qemuMonitor *mon G_GNUC_UNUSED,
     virObjectLock(vm);
     priv = vm->privateData;
 
+    qemuBlockNamedNodeDataInvalidate(vm);
+
     VIR_DEBUG("job '%s'(domain: %p,%s) state changed to '%s'(%d)",
               jobname, vm, vm->def->name,
               qemuMonitorJobStatusTypeToString(status), status);
@@ -1663,6 +1839,10 @@ qemuProcessHandleMigrationPass(qemuMonitor *mon G_GNUC_UNUSED,
     virObjectEventStateQueue(driver->domainEventState,
                          virDomainEventMigrationIterationNewFromObj(vm, pass));
 
+    /* Let the migration thread react to the new iteration */
+    if (priv->job.asyncJob == QEMU_ASYNC_JOB_MIGRATION_OUT)
+        virDomainObjBroadcast(vm);
+
  cleanup:
     virObjectUnlock(vm);
 }
@@ -4674,6 +4854,21 @@ qemuProcessIncomingDefNew(virQEMUCaps *qemuCaps,
 {
     qemuProcessIncomingDef *inc = NULL;
 
+    /* Start waiting for a migration whose URI is not known yet */
+    if (STREQ(migrateFrom, "defer")) {
+        if (!virQEMUCapsGet(qemuCaps, QEMU_CAPS_INCOMING_DEFER)) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                           _("deferred incoming migration is not supported "
+                             "with this QEMU binary"));
+            return NULL;
+        }
+
+        inc = g_new0(qemuProcessIncomingDef, 1);
+        inc->launchURI = g_strdup("defer");
+        inc->fd = -1;
+        return inc;
+    }
+
     if (qemuMigrationDstCheckProtocol(qemuCaps, migrateFrom) < 0)
         return NULL;
 
@@ -4713,10 +4908,14 @@ qemuProcessBeginJob(virQEMUDriver *driver,
                     virDomainJobOperation operation,
                     unsigned long apiFlags)
 {
+    qemuDomainObjPrivate *priv = vm->privateData;
+
     if (qemuDomainObjBeginAsyncJob(driver, vm, QEMU_ASYNC_JOB_START,
                                    operation, apiFlags) < 0)
         return -1;
 
+    priv->job.current->statsType = QEMU_DOMAIN_JOB_STATS_TYPE_START;
+
     qemuDomainObjSetAsyncJobMask(vm, QEMU_JOB_NONE);
     return 0;
 }
@@ -5657,6 +5856,70 @@ qemuProcessPrepareQEMUCaps(virDomainObj *vm,
 }
 
 
+/*
+ * Starting a domain is split into phases which are timed separately, so
+ * that it is possible to tell where the time goes when domains are being
+ * started repeatedly. Each phase lasts from the end of the previous one.
+ */
+static void
+qemuProcessStartPhaseBegin(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    memset(priv->startPhases, 0, sizeof(priv->startPhases));
+    priv->startPhaseMark = g_get_monotonic_time();
+}
+
+
+static void
+qemuProcessStartPhaseEnd(virDomainObj *vm,
+                         qemuDomainStartPhase phase)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    unsigned long long now = g_get_monotonic_time();
+    unsigned long long usec = now - priv->startPhaseMark;
+
+    priv->startPhases[phase] += usec;
+    priv->startPhaseMark = now;
+
+    PROBE(QEMU_PROCESS_START_PHASE,
+          "vm=%p name=%s phase=%s usec=%llu",
+          vm, vm->def->name, qemuDomainStartPhaseTypeToString(phase), usec);
+}
+
+
+static void
+qemuProcessStartPhaseReport(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    unsigned long long total = 0;
+    size_t i;
+
+    for (i = 0; i < QEMU_DOMAIN_START_PHASE_LAST; i++) {
+        total += priv->startPhases[i];
+        virBufferAsprintf(&buf, " %s=%llu",
+                          qemuDomainStartPhaseTypeToString(i),
+                          priv->startPhases[i] / 1000);
+    }
+
+    VIR_INFO("Domain %s started in %llu ms, phases in ms:%s",
+             vm->def->name, total / 1000, virBufferCurrentContent(&buf));
+
+    /* Keep the record of the last start around for virDomainGetJobStats */
+    if (priv->job.current &&
+        priv->job.current->statsType == QEMU_DOMAIN_JOB_STATS_TYPE_START) {
+        qemuDomainJobInfoUpdateTime(priv->job.current);
+
+        g_clear_pointer(&priv->job.completed, qemuDomainJobInfoFree);
+        priv->job.completed = qemuDomainJobInfoCopy(priv->job.current);
+        priv->job.completed->status = QEMU_DOMAIN_JOB_STATUS_COMPLETED;
+        memcpy(priv->job.completed->stats.start.phases, priv->startPhases,
+               sizeof(priv->startPhases));
+    }
+}
+
+
 /**
  * qemuProcessInit:
  *
@@ -5687,6 +5950,8 @@ qemuProcessInit(virQEMUDriver *driver,
 
     VIR_DEBUG("Beginning VM startup process");
 
+    qemuProcessStartPhaseBegin(vm);
+
     if (virDomainObjIsActive(vm)) {
         virReportError(VIR_ERR_OPERATION_INVALID, "%s",
                        _("VM is already active"));
@@ -5746,6 +6011,7 @@ qemuProcessInit(virQEMUDriver *driver,
         priv->origCPU = g_steal_pointer(&origCPU);
     }
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_INIT);
     ret = 0;
 
  cleanup:
@@ -6683,6 +6949,7 @@ qemuProcessPrepareDomain(virQEMUDriver *driver,
             return -1;
     }
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN);
     return 0;
 }
 
@@ -6762,11 +7029,19 @@ qemuProcessPrepareHostStorage(virQEMUDriver *driver,
                               unsigned int flags)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
+    size_t ndisks = vm->def->ndisks;
     size_t i;
     bool cold_boot = flags & VIR_QEMU_PROCESS_START_COLD;
     bool blockdev = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV);
+    g_autofree virDomainDiskDef **disks = g_new0(virDomainDiskDef *, ndisks);
+    g_autofree size_t *idxs = g_new0(size_t, ndisks);
+    g_autofree int *rcs = g_new0(int, ndisks);
+    g_autofree virErrorPtr *errors = g_new0(virErrorPtr, ndisks);
+    size_t nchains = 0;
+    int ret = -1;
 
-    for (i = vm->def->ndisks; i > 0; i--) {
+    /* Disks may be dropped by the startup policy, so go from the end */
+    for (i = ndisks; i > 0; i--) {
         size_t idx = i - 1;
         virDomainDiskDef *disk = vm->def->disks[idx];
 
@@ -6782,19 +7057,50 @@ qemuProcessPrepareHostStorage(virQEMUDriver *driver,
          * source file immediately as determining chain will surely fail
          * and we don't want noisy error notice in logs for this case.
          */
-        if (qemuDomainDiskIsMissingLocalOptional(disk) && cold_boot)
+        if (qemuDomainDiskIsMissingLocalOptional(disk) && cold_boot) {
             VIR_INFO("optional disk '%s' source file is missing, "
                      "skip checking disk chain", disk->dst);
-        else if (qemuDomainDetermineDiskChain(driver, vm, disk, NULL, true) >= 0)
             continue;
+        }
 
-        if (qemuDomainCheckDiskStartupPolicy(driver, vm, idx, cold_boot) >= 0)
+        disks[nchains] = disk;
+        idxs[nchains] = idx;
+        nchains++;
+    }
+
+    /* Probing the images of the disks is independent of each other, let
+     * it run in parallel */
+    qemuDomainDetermineDiskChains(driver, vm, disks, nchains, true,
+                                  rcs, errors);
+
+    for (i = ndisks; i > 0; i--) {
+        size_t idx = i - 1;
+        virDomainDiskDef *disk = vm->def->disks[idx];
+        size_t j;
+
+        if (virStorageSourceIsEmpty(disk->src))
             continue;
 
-        return -1;
+        for (j = 0; j < nchains && idxs[j] != idx; j++)
+            ;
+
+        if (j < nchains) {
+            if (rcs[j] >= 0)
+                continue;
+
+            virErrorRestore(&errors[j]);
+        }
+
+        if (qemuDomainCheckDiskStartupPolicy(driver, vm, idx, cold_boot) < 0)
+            goto cleanup;
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nchains; i++)
+        virFreeError(errors[i]);
+    return ret;
 }
 
 
@@ -6938,6 +7244,7 @@ qemuProcessPrepareHost(virQEMUDriver *driver,
     if (qemuProcessPrepareLaunchSecurityGuestInput(vm) < 0)
         return -1;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_PREPARE_HOST);
     return 0;
 }
 
@@ -7302,6 +7609,8 @@ qemuProcessLaunch(virConnectPtr conn,
                                      &nnicindexes, &nicindexes, 0)))
         goto cleanup;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_COMMANDLINE);
+
     if (incoming && incoming->fd != -1)
         virCommandPassFD(cmd, incoming->fd, 0);
 
@@ -7394,10 +7703,14 @@ qemuProcessLaunch(virConnectPtr conn,
         goto cleanup;
     }
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_SPAWN);
+
     VIR_DEBUG("Building domain mount namespace (if required)");
     if (qemuDomainBuildNamespace(cfg, vm) < 0)
         goto cleanup;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_NAMESPACE);
+
     VIR_DEBUG("Setting up domain cgroup (if required)");
     if (qemuSetupCgroup(vm, nnicindexes, nicindexes) < 0)
         goto cleanup;
@@ -7428,6 +7741,8 @@ qemuProcessLaunch(virConnectPtr conn,
         qemuProcessStartManagedPRDaemon(vm) < 0)
         goto cleanup;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_CGROUP);
+
     VIR_DEBUG("Setting domain security labels");
     if (qemuSecuritySetAllLabel(driver,
                                 vm,
@@ -7460,6 +7775,8 @@ qemuProcessLaunch(virConnectPtr conn,
             goto cleanup;
     }
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_LABEL);
+
     VIR_DEBUG("Labelling done, completing handshake to child");
     if (virCommandHandshakeNotify(cmd) < 0)
         goto cleanup;
@@ -7475,6 +7792,8 @@ qemuProcessLaunch(virConnectPtr conn,
     if (qemuConnectAgent(driver, vm) < 0)
         goto cleanup;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_MONITOR);
+
     VIR_DEBUG("Verifying and updating provided guest CPU");
     if (qemuProcessUpdateAndVerifyCPU(driver, vm, asyncJob) < 0)
         goto cleanup;
@@ -7562,6 +7881,7 @@ qemuProcessLaunch(virConnectPtr conn,
     if (qemuProcessSetupLifecycleActions(vm, asyncJob) < 0)
         goto cleanup;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_SETUP);
     ret = 0;
 
  cleanup:
@@ -7647,6 +7967,9 @@ qemuProcessFinishStartup(virQEMUDriver *driver,
                              VIR_HOOK_SUBOP_BEGIN) < 0)
         return -1;
 
+    qemuProcessStartPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_FINISH);
+    qemuProcessStartPhaseReport(vm);
+
     return 0;
 }
 
@@ -7660,6 +7983,7 @@ qemuProcessStart(virConnectPtr conn,
                  const char *migrateFrom,
                  int migrateFd,
                  const char *migratePath,
+                 qemuMigrationParams *migParams,
                  virDomainMomentObj *snapshot,
                  virNetDevVPortProfileOp vmop,
                  unsigned int flags)
@@ -7721,6 +8045,11 @@ qemuProcessStart(virConnectPtr conn,
     relabel = true;
 
     if (incoming) {
+        if (migParams &&
+            (qemuMigrationParamsCheckSupported(vm, migParams) < 0 ||
+             qemuMigrationParamsApply(driver, vm, asyncJob, migParams) < 0))
+            goto stop;
+
         if (incoming->deferredURI &&
             qemuMigrationDstRun(driver, vm, incoming->deferredURI, asyncJob) < 0)
             goto stop;
@@ -8023,9 +8352,16 @@ void qemuProcessStop(virQEMUDriver *driver,
         g_autofree char *xml = qemuDomainDefFormatXML(driver, NULL, vm->def, 0);
 
         /* we can't stop the operation even if the script raised an error */
-        ignore_value(virHookCall(VIR_HOOK_DRIVER_QEMU, vm->def->name,
-                                 VIR_HOOK_QEMU_OP_STOPPED, VIR_HOOK_SUBOP_END,
-                                 NULL, xml, NULL));
+        if (cfg->asyncHooks) {
+            virHookCallAsync(VIR_HOOK_DRIVER_QEMU, vm->def->name,
+                             VIR_HOOK_QEMU_OP_STOPPED, VIR_HOOK_SUBOP_END,
+                             NULL, xml);
+        } else {
+            ignore_value(virHookCall(VIR_HOOK_DRIVER_QEMU, vm->def->name,
+                                     VIR_HOOK_QEMU_OP_STOPPED,
+                                     VIR_HOOK_SUBOP_END,
+                                     NULL, xml, NULL));
+        }
     }
 
     /* Reset Security Labels unless caller don't want us to */
@@ -8240,9 +8576,15 @@ void qemuProcessStop(virQEMUDriver *driver,
         g_autofree char *xml = qemuDomainDefFormatXML(driver, NULL, vm->def, 0);
 
         /* we can't stop the operation even if the script raised an error */
-        virHookCall(VIR_HOOK_DRIVER_QEMU, vm->def->name,
-                    VIR_HOOK_QEMU_OP_RELEASE, VIR_HOOK_SUBOP_END,
-                    NULL, xml, NULL);
+        if (cfg->asyncHooks) {
+            virHookCallAsync(VIR_HOOK_DRIVER_QEMU, vm->def->name,
+                             VIR_HOOK_QEMU_OP_RELEASE, VIR_HOOK_SUBOP_END,
+                             NULL, xml);
+        } else {
+            virHookCall(VIR_HOOK_DRIVER_QEMU, vm->def->name,
+                        VIR_HOOK_QEMU_OP_RELEASE, VIR_HOOK_SUBOP_END,
+                        NULL, xml, NULL);
+        }
     }
 
     virDomainObjRemoveTransientDef(vm);
@@ -8593,18 +8935,48 @@ qemuProcessRefreshBlockjobs(virQEMUDriver *driver,
 
 
 struct qemuProcessReconnectData {
-    virQEMUDriver *driver;
     virDomainObj *obj;
-    virIdentity *identity;
+    qemuDomainJobObj oldjob;
+    bool jobStarted;
 };
+
+
+/*
+ * Called whenever reconnecting to a domain finished, successfully or not.
+ * The progress is logged and reported to the service manager at every 10%
+ * so that whoever waits for the daemon to fully converge can watch it.
+ */
+static void
+qemuProcessReconnectProgress(virQEMUDriver *driver)
+{
+    int total = driver->reconnectTotal;
+    int step = MAX(total / 10, 1);
+    int done;
+
+    if (g_atomic_int_dec_and_test(&driver->reconnectPending)) {
+        VIR_INFO("Reconnected to all %d running domains in %lld ms", total,
+                 (g_get_monotonic_time() - driver->reconnectStart) / 1000);
+        virSystemdNotifyStatus("Reconnected to all %d running domains", total);
+        return;
+    }
+
+    done = total - g_atomic_int_get(&driver->reconnectPending);
+    if (done > 0 && done % step == 0) {
+        VIR_INFO("Reconnected to %d of %d running domains", done, total);
+        virSystemdNotifyStatus("Reconnecting to running domains: %d of %d",
+                               done, total);
+    }
+}
+
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
  * and re-reserve the security labels in use
  *
- * This function also inherits a locked and ref'd domain object.
+ * This function runs in the reconnect worker pool and inherits a ref'd
+ * domain object, for which qemuProcessReconnectHelper already acquired
+ * a job (unless @jobStarted is false).
  *
  * This function needs to:
- * 1. Enter job
  * 1. just before monitor reconnect do lightweight MonitorEnter
  *    (increase VM refcount and unlock VM)
  * 2. reconnect to monitor
@@ -8616,40 +8988,37 @@ struct qemuProcessReconnectData {
  * monitor lock, which does not exists in this early phase.
  */
 static void
-qemuProcessReconnect(void *opaque)
+qemuProcessReconnect(void *jobdata,
+                     void *opaque)
 {
-    struct qemuProcessReconnectData *data = opaque;
-    virQEMUDriver *driver = data->driver;
+    struct qemuProcessReconnectData *data = jobdata;
+    virQEMUDriver *driver = opaque;
     virDomainObj *obj = data->obj;
     qemuDomainObjPrivate *priv;
-    g_auto(qemuDomainJobObj) oldjob = {
-      .cb = NULL,
-    };
+    g_auto(qemuDomainJobObj) oldjob = data->oldjob;
     int state;
     int reason;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     size_t i;
     unsigned int stopFlags = 0;
-    bool jobStarted = false;
+    bool jobStarted = data->jobStarted;
     bool retry = true;
     bool tryMonReconn = false;
 
-    virIdentitySetCurrent(data->identity);
-    g_clear_object(&data->identity);
     VIR_FREE(data);
 
+    virObjectLock(obj);
+
     cfg = virQEMUDriverGetConfig(driver);
     priv = obj->privateData;
 
-    qemuDomainObjRestoreJob(obj, &oldjob);
     if (oldjob.asyncJob == QEMU_ASYNC_JOB_MIGRATION_IN)
         stopFlags |= VIR_QEMU_PROCESS_STOP_MIGRATED;
     if (oldjob.asyncJob == QEMU_ASYNC_JOB_BACKUP && priv->backup)
         priv->backup->apiFlags = oldjob.apiFlags;
 
-    if (qemuDomainObjBeginJob(driver, obj, QEMU_JOB_MODIFY) < 0)
+    if (!jobStarted)
         goto error;
-    jobStarted = true;
 
     /* XXX If we ever gonna change pid file pattern, come up with
      * some intelligence here to deal with old paths. */
@@ -8895,7 +9264,8 @@ qemuProcessReconnect(void *opaque)
     }
     virDomainObjEndAPI(&obj);
     virNWFilterUnlockFilterUpdates();
-    virIdentitySetCurrent(NULL);
+
+    qemuProcessReconnectProgress(driver);
     return;
 
  error:
@@ -8931,66 +9301,139 @@ static int
 qemuProcessReconnectHelper(virDomainObj *obj,
                            void *opaque)
 {
-    virThread thread;
-    struct qemuProcessReconnectData *src = opaque;
+    virQEMUDriver *driver = opaque;
     struct qemuProcessReconnectData *data;
-    g_autofree char *name = NULL;
-
-    /* If the VM was inactive, we don't need to reconnect */
-    if (!obj->pid)
-        return 0;
 
     data = g_new0(struct qemuProcessReconnectData, 1);
-
-    memcpy(data, src, sizeof(*data));
     data->obj = obj;
-    data->identity = virIdentityGetCurrent();
 
     virNWFilterReadLockFilterUpdates();
 
-    /* this lock and reference will be eventually transferred to the thread
-     * that handles the reconnect */
+    /* This reference will be eventually transferred to the worker that
+     * handles the reconnect. The job is acquired right away so that no
+     * API can get to the domain before it is reconnected. The domain is
+     * not kept locked while waiting for a worker though, so APIs which
+     * only read the domain definition are served meanwhile. */
     virObjectLock(obj);
     virObjectRef(obj);
 
-    name = g_strdup_printf("init-%s", obj->def->name);
+    qemuDomainObjRestoreJob(obj, &data->oldjob);
+    if (qemuDomainObjBeginJob(driver, obj, QEMU_JOB_MODIFY) >= 0)
+        data->jobStarted = true;
 
-    if (virThreadCreateFull(&thread, false, qemuProcessReconnect,
-                            name, false, data) < 0) {
+    if (virThreadPoolSendJob(driver->reconnectPool, 0, data) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Could not create thread. QEMU initialization "
+                       _("Could not queue reconnect. QEMU initialization "
                          "might be incomplete"));
-        /* We can't spawn a thread and thus connect to monitor. Kill qemu.
-         * It's safe to call qemuProcessStop without a job here since there
-         * is no thread that could be doing anything else with the same domain
-         * object.
+        qemuProcessReconnectProgress(driver);
+        if (data->jobStarted)
+            qemuDomainObjEndJob(driver, obj);
+
+        /* We can't connect to monitor. Kill qemu. It's safe to call
+         * qemuProcessStop without a job here since there is no thread that
+         * could be doing anything else with the same domain object.
          */
-        qemuProcessStop(src->driver, obj, VIR_DOMAIN_SHUTOFF_FAILED,
+        qemuProcessStop(driver, obj, VIR_DOMAIN_SHUTOFF_FAILED,
                         QEMU_ASYNC_JOB_NONE, 0);
-        qemuDomainRemoveInactiveJobLocked(src->driver, obj);
+        qemuDomainRemoveInactiveJobLocked(driver, obj);
 
         virDomainObjEndAPI(&obj);
         virNWFilterUnlockFilterUpdates();
-        g_clear_object(&data->identity);
+        qemuDomainObjClearJob(&data->oldjob);
         VIR_FREE(data);
         return -1;
     }
 
+    virObjectUnlock(obj);
     return 0;
 }
 
+struct qemuProcessReconnectQueue {
+    GPtrArray *urgent;
+    GPtrArray *normal;
+};
+
+
+static int
+qemuProcessReconnectCollect(virDomainObj *obj,
+                            void *opaque)
+{
+    struct qemuProcessReconnectQueue *queue = opaque;
+    qemuDomainObjPrivate *priv;
+
+    /* If the VM was inactive, we don't need to reconnect */
+    if (!obj->pid)
+        return 0;
+
+    virObjectLock(obj);
+    priv = obj->privateData;
+
+    /* Domains which were in the middle of a job (e.g. a migration) when
+     * the daemon went away are reconnected first since the job is likely
+     * to time out on the other side or has a management app waiting. */
+    if (priv->job.active != QEMU_JOB_NONE ||
+        priv->job.asyncJob != QEMU_ASYNC_JOB_NONE)
+        g_ptr_array_add(queue->urgent, virObjectRef(obj));
+    else
+        g_ptr_array_add(queue->normal, virObjectRef(obj));
+
+    virObjectUnlock(obj);
+    return 0;
+}
+
+
 /**
  * qemuProcessReconnectAll
  *
  * Try to re-open the resources for live VMs that we care
- * about.
+ * about. The reconnect happens in the background, on a pool
+ * of cfg->reconnectWorkers threads. Domains with a job that
+ * was interrupted by the daemon going away are queued first.
+ *
+ * Returns 0 on success, -1 if the pool can't be created.
  */
-void
+int
 qemuProcessReconnectAll(virQEMUDriver *driver)
 {
-    struct qemuProcessReconnectData data = {.driver = driver};
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autoptr(virIdentity) identity = virIdentityGetCurrent();
+    g_autoptr(GPtrArray) urgent = g_ptr_array_new_with_free_func(virObjectUnref);
+    g_autoptr(GPtrArray) normal = g_ptr_array_new_with_free_func(virObjectUnref);
+    struct qemuProcessReconnectQueue queue = { urgent, normal };
+    size_t i;
+
+    driver->reconnectPool = virThreadPoolNewFull(0, cfg->reconnectWorkers, 0,
+                                                 qemuProcessReconnect,
+                                                 "qemu-reconnect",
+                                                 identity,
+                                                 driver);
+    if (!driver->reconnectPool)
+        return -1;
+
+    driver->reconnectStart = g_get_monotonic_time();
     virDomainObjListForEach(driver->domains, true,
-                            qemuProcessReconnectHelper, &data);
+                            qemuProcessReconnectCollect, &queue);
+
+    driver->reconnectTotal = urgent->len + normal->len;
+    if (driver->reconnectTotal == 0)
+        return 0;
+
+    VIR_INFO("Reconnecting to %d running domains, %u with interrupted jobs",
+             driver->reconnectTotal, urgent->len);
+    virSystemdNotifyStatus("Reconnecting to running domains: 0 of %d",
+                           driver->reconnectTotal);
+
+    /* Every domain is accounted for upfront, so that progress is reported
+     * correctly even if reconnecting to early domains finishes before
+     * the rest is queued. */
+    g_atomic_int_set(&driver->reconnectPending, driver->reconnectTotal);
+
+    for (i = 0; i < urgent->len; i++)
+        qemuProcessReconnectHelper(g_ptr_array_index(urgent, i), driver);
+    for (i = 0; i < normal->len; i++)
+        qemuProcessReconnectHelper(g_ptr_array_index(normal, i), driver);
+
+    return 0;
 }
 
 
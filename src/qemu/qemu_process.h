@@ -23,6 +23,7 @@
 
 #include "qemu_conf.h"
 #include "qemu_domain.h"
+#include "qemu_migration_params.h"
 #include "virstoragefile.h"
 #include "vireventthread.h"
 
@@ -47,7 +48,7 @@ int qemuProcessDestroyMemoryBackingPath(virQEMUDriver *driver,
                                         virDomainObj *vm,
                                         virDomainMemoryDef *mem);
 
-void qemuProcessReconnectAll(virQEMUDriver *driver);
+int qemuProcessReconnectAll(virQEMUDriver *driver);
 
 typedef struct _qemuProcessIncomingDef qemuProcessIncomingDef;
 struct _qemuProcessIncomingDef {
@@ -91,6 +92,7 @@ int qemuProcessStart(virConnectPtr conn,
                      const char *migrateFrom,
                      int stdin_fd,
                      const char *stdin_path,
+                     qemuMigrationParams *migParams,
                      virDomainMomentObj *snapshot,
                      virNetDevVPortProfileOp vmop,
                      unsigned int flags);
@@ -212,6 +214,12 @@ int qemuProcessStartManagedPRDaemon(virDomainObj *vm) G_GNUC_NO_INLINE;
 
 void qemuProcessKillManagedPRDaemon(virDomainObj *vm) G_GNUC_NO_INLINE;
 
+int qemuProcessEventSubmit(virQEMUDriver *driver,
+                           struct qemuProcessEvent **event);
+struct qemuProcessEvent *qemuProcessEventPop(virDomainObj *vm);
+void qemuProcessEventReschedule(virQEMUDriver *driver,
+                                virDomainObj *vm);
+
 typedef struct _qemuProcessQMP qemuProcessQMP;
 struct _qemuProcessQMP {
     char *binary;
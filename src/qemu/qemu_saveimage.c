@@ -49,6 +49,7 @@ typedef enum {
      */
     QEMU_SAVE_FORMAT_XZ = 3,
     QEMU_SAVE_FORMAT_LZOP = 4,
+    QEMU_SAVE_FORMAT_ZSTD = 5,
     /* Note: add new members only at the end.
        These values are used in the on-disk format.
        Do not change or re-use numbers. */
@@ -64,6 +65,7 @@ VIR_ENUM_IMPL(qemuSaveCompression,
               "bzip2",
               "xz",
               "lzop",
+              "zstd",
 );
 
 static inline void
@@ -74,6 +76,17 @@ qemuSaveImageBswapHeader(virQEMUSaveHeader *hdr)
     hdr->was_running = GUINT32_SWAP_LE_BE(hdr->was_running);
     hdr->compressed = GUINT32_SWAP_LE_BE(hdr->compressed);
     hdr->cookieOffset = GUINT32_SWAP_LE_BE(hdr->cookieOffset);
+    hdr->multifdChannels = GUINT32_SWAP_LE_BE(hdr->multifdChannels);
+}
+
+
+/* Offset of guest memory within a parallel save image. The memory follows
+ * libvirt's header and data, aligned so that QEMU can access it directly.
+ */
+static unsigned long long
+qemuSaveImageGetParallelOffset(virQEMUSaveHeader *header)
+{
+    return sizeof(*header) + header->data_len;
 }
 
 
@@ -158,6 +171,12 @@ virQEMUSaveDataWrite(virQEMUSaveData *data,
          * that what was originally saved
          */
         header->data_len = len + (64 * 1024);
+
+        if (header->multifdChannels > 0) {
+            header->data_len = VIR_ROUND_UP(sizeof(*header) + header->data_len,
+                                            QEMU_SAVE_PARALLEL_ALIGN);
+            header->data_len -= sizeof(*header);
+        }
     } else {
         if (len > header->data_len) {
             virReportError(VIR_ERR_OPERATION_FAILED, "%s",
@@ -258,6 +277,7 @@ qemuSaveImageCreate(virQEMUDriver *driver,
                     const char *path,
                     virQEMUSaveData *data,
                     virCommand *compressor,
+                    unsigned int channels,
                     unsigned int flags,
                     qemuDomainAsyncJob asyncJob)
 {
@@ -269,6 +289,23 @@ qemuSaveImageCreate(virQEMUDriver *driver,
     virFileWrapperFd *wrapperFd = NULL;
     unsigned int wrapperFlags = VIR_FILE_WRAPPER_NON_BLOCKING;
 
+    if (channels > 0) {
+        if (compressor) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                           _("parallel save cannot be combined with compression"));
+            return -1;
+        }
+
+        if (flags & VIR_DOMAIN_SAVE_BYPASS_CACHE) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                           _("parallel save cannot bypass file system cache"));
+            return -1;
+        }
+
+        data->header.version = QEMU_SAVE_VERSION_PARALLEL;
+        data->header.multifdChannels = channels;
+    }
+
     /* Obtain the file handle.  */
     if ((flags & VIR_DOMAIN_SAVE_BYPASS_CACHE)) {
         wrapperFlags |= VIR_FILE_WRAPPER_BYPASS_CACHE;
@@ -286,6 +323,34 @@ qemuSaveImageCreate(virQEMUDriver *driver,
     if (fd < 0)
         goto cleanup;
 
+    if (channels > 0) {
+        /* QEMU writes guest memory on its own directly into the file, we
+         * only need to provide libvirt's header in front of it. */
+        if (virQEMUSaveDataWrite(data, fd, path) < 0)
+            goto cleanup;
+
+        if (qemuMigrationSrcToParallelFile(driver, vm, path,
+                                           qemuSaveImageGetParallelOffset(&data->header),
+                                           channels, asyncJob) < 0)
+            goto cleanup;
+
+        if (virFileDataSync(fd) < 0) {
+            virReportSystemError(errno, _("unable to sync %s"), path);
+            goto cleanup;
+        }
+
+        if (lseek(fd, 0, SEEK_SET) < 0) {
+            virReportSystemError(errno, _("unable to seek %s"), path);
+            goto cleanup;
+        }
+
+        if (virQEMUSaveDataFinish(data, &fd, path) < 0)
+            goto cleanup;
+
+        ret = 0;
+        goto cleanup;
+    }
+
     if (qemuSecuritySetImageFDLabel(driver->securityManager, vm->def, fd) < 0)
         goto cleanup;
 
@@ -378,6 +443,9 @@ qemuSaveImageGetCompressionProgram(const char *imageFormat,
     virCommandAddArg(*compressor, "-c");
     if (ret == QEMU_SAVE_FORMAT_XZ)
         virCommandAddArg(*compressor, "-3");
+    /* Unlike the others zstd is able to use all host CPUs */
+    if (ret == QEMU_SAVE_FORMAT_ZSTD)
+        virCommandAddArg(*compressor, "-T0");
 
     return ret;
 
@@ -511,15 +579,31 @@ qemuSaveImageOpen(virQEMUDriver *driver,
         return -1;
     }
 
-    if (header->version > QEMU_SAVE_VERSION) {
+    if (header->version > QEMU_SAVE_VERSION_PARALLEL) {
         /* convert endianness and try again */
         qemuSaveImageBswapHeader(header);
     }
 
-    if (header->version > QEMU_SAVE_VERSION) {
+    if (header->version > QEMU_SAVE_VERSION_PARALLEL) {
         virReportError(VIR_ERR_OPERATION_FAILED,
                        _("image version is not supported (%d > %d)"),
-                       header->version, QEMU_SAVE_VERSION);
+                       header->version, QEMU_SAVE_VERSION_PARALLEL);
+        return -1;
+    }
+
+    if (header->version == QEMU_SAVE_VERSION_PARALLEL &&
+        (header->multifdChannels == 0 ||
+         header->compressed != QEMU_SAVE_FORMAT_RAW ||
+         (sizeof(*header) + header->data_len) % QEMU_SAVE_PARALLEL_ALIGN != 0)) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("invalid parallel save image header"));
+        return -1;
+    }
+
+    if (header->version == QEMU_SAVE_VERSION_PARALLEL && bypass_cache) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                       _("parallel save image cannot be restored bypassing "
+                         "file system cache"));
         return -1;
     }
 
@@ -589,6 +673,9 @@ qemuSaveImageStartVM(virConnectPtr conn,
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     virQEMUSaveHeader *header = &data->header;
     g_autoptr(qemuDomainSaveCookie) cookie = NULL;
+    g_autoptr(qemuMigrationParams) migParams = NULL;
+    g_autofree char *migrateFrom = NULL;
+    int migrateFd = -1;
     int rc = 0;
 
     if (virSaveCookieParseString(data->cookie, (virObject **)&cookie,
@@ -625,8 +712,34 @@ qemuSaveImageStartVM(virConnectPtr conn,
     if (cookie && !cookie->slirpHelper)
         priv->disableSlirp = true;
 
+    if (header->version == QEMU_SAVE_VERSION_PARALLEL) {
+        /* QEMU reads guest memory from the image on its own. Since every
+         * page is stored at a fixed offset, the number of channels doesn't
+         * have to match the one used for saving the image, e.g., when it
+         * is restored on a bigger host. */
+        unsigned int channels = MAX(header->multifdChannels,
+                                    cfg->saveParallelChannels);
+
+        if (strchr(path, ',')) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                           _("parallel restore from '%s' is not supported: "
+                             "path must not contain ','"), path);
+            goto cleanup;
+        }
+
+        if (!(migParams = qemuMigrationParamsForSave(channels)))
+            goto cleanup;
+
+        migrateFrom = g_strdup_printf("file:%s,offset=%llu", path,
+                                      qemuSaveImageGetParallelOffset(header));
+    } else {
+        migrateFrom = g_strdup("stdio");
+        migrateFd = *fd;
+    }
+
     if (qemuProcessStart(conn, driver, vm, cookie ? cookie->cpu : NULL,
-                         asyncJob, "stdio", *fd, path, NULL,
+                         asyncJob, migrateFrom, migrateFd, path, migParams,
+                         NULL,
                          VIR_NETDEV_VPORT_PROFILE_OP_RESTORE,
                          VIR_QEMU_PROCESS_START_PAUSED |
                          VIR_QEMU_PROCESS_START_GEN_VMID) == 0)
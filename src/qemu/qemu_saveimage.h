@@ -31,6 +31,10 @@
 #define QEMU_SAVE_MAGIC   "LibvirtQemudSave"
 #define QEMU_SAVE_PARTIAL "LibvirtQemudPart"
 #define QEMU_SAVE_VERSION 2
+/* Guest memory is stored at fixed offsets by multifdChannels channels */
+#define QEMU_SAVE_VERSION_PARALLEL 3
+/* Alignment of guest memory in parallel images */
+#define QEMU_SAVE_PARALLEL_ALIGN 4096
 
 G_STATIC_ASSERT(sizeof(QEMU_SAVE_MAGIC) == sizeof(QEMU_SAVE_PARTIAL));
 
@@ -42,7 +46,8 @@ struct _virQEMUSaveHeader {
     uint32_t was_running;
     uint32_t compressed;
     uint32_t cookieOffset;
-    uint32_t unused[14];
+    uint32_t multifdChannels;
+    uint32_t unused[13];
 };
 
 
@@ -95,6 +100,7 @@ qemuSaveImageCreate(virQEMUDriver *driver,
                     const char *path,
                     virQEMUSaveData *data,
                     virCommand *compressor,
+                    unsigned int channels,
                     unsigned int flags,
                     qemuDomainAsyncJob asyncJob);
 
@@ -49,6 +49,44 @@
 VIR_LOG_INIT("qemu.qemu_snapshot");
 
 
+/* Points every member of a group snapshot waits for the others at */
+typedef enum {
+    QEMU_SNAPSHOT_GROUP_PHASE_PREPARED, /* overlays of all members are ready */
+    QEMU_SNAPSHOT_GROUP_PHASE_FROZEN, /* all guests are quiesced */
+    QEMU_SNAPSHOT_GROUP_PHASE_DONE, /* all transactions were issued */
+
+    QEMU_SNAPSHOT_GROUP_PHASE_LAST
+} qemuSnapshotGroupPhase;
+
+typedef struct _qemuSnapshotGroup qemuSnapshotGroup;
+struct _qemuSnapshotGroup {
+    virMutex lock;
+    virCond cond;
+
+    size_t nmembers;
+    size_t arrived[QEMU_SNAPSHOT_GROUP_PHASE_LAST];
+    bool failed;
+};
+
+typedef struct _qemuSnapshotGroupMember qemuSnapshotGroupMember;
+struct _qemuSnapshotGroupMember {
+    qemuSnapshotGroup *group;
+    size_t phase; /* the next phase the member didn't arrive at yet */
+    bool first; /* the failure of this member made the group fail */
+
+    virThread thread;
+    bool started;
+
+    virDomainPtr domain;
+    virDomainObj *vm;
+    const char *xmlDesc;
+    unsigned int flags;
+
+    virDomainSnapshotPtr snapshot;
+    virErrorPtr error;
+};
+
+
 /**
  * qemuSnapshotSetCurrent: Set currently active snapshot
  *
@@ -1340,6 +1378,175 @@ qemuSnapshotCreateActiveExternalDisks(virDomainObj *vm,
 }
 
 
+/**
+ * qemuSnapshotGroupLeave:
+ * @member: member of a group snapshot
+ * @ok: whether the member succeeded
+ *
+ * Marks @member as arrived at all the phases it didn't reach yet so that
+ * the other members don't wait for it anymore. If @ok is false the whole
+ * group fails.
+ */
+static void
+qemuSnapshotGroupLeave(qemuSnapshotGroupMember *member,
+                       bool ok)
+{
+    qemuSnapshotGroup *group = member->group;
+
+    virMutexLock(&group->lock);
+
+    for (; member->phase < QEMU_SNAPSHOT_GROUP_PHASE_LAST; member->phase++)
+        group->arrived[member->phase]++;
+
+    if (!ok && !group->failed) {
+        group->failed = true;
+        member->first = true;
+    }
+
+    virCondBroadcast(&group->cond);
+    virMutexUnlock(&group->lock);
+}
+
+
+/**
+ * qemuSnapshotGroupArrive:
+ * @member: member of a group snapshot
+ * @vm: domain object of @member, locked
+ * @phase: phase @member arrived at
+ *
+ * Waits until all members of the group arrived at @phase. @vm is unlocked
+ * while waiting.
+ *
+ * Returns 0 on success, -1 with an error reported if the group failed.
+ */
+static int
+qemuSnapshotGroupArrive(qemuSnapshotGroupMember *member,
+                        virDomainObj *vm,
+                        qemuSnapshotGroupPhase phase)
+{
+    qemuSnapshotGroup *group = member->group;
+    int ret = 0;
+
+    virObjectUnlock(vm);
+    virMutexLock(&group->lock);
+
+    for (; member->phase <= phase; member->phase++)
+        group->arrived[member->phase]++;
+
+    virCondBroadcast(&group->cond);
+
+    while (!group->failed && group->arrived[phase] < group->nmembers) {
+        if (virCondWait(&group->cond, &group->lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to wait for other domains of the group"));
+            if (!group->failed) {
+                group->failed = true;
+                member->first = true;
+            }
+            virCondBroadcast(&group->cond);
+            ret = -1;
+            break;
+        }
+    }
+
+    if (ret == 0 && group->failed) {
+        virReportError(VIR_ERR_OPERATION_ABORTED, "%s",
+                       _("snapshot of another domain of the group failed"));
+        ret = -1;
+    }
+
+    virMutexUnlock(&group->lock);
+    virObjectLock(vm);
+
+    return ret;
+}
+
+
+/* The domain is expected to be locked and active. Unlike for a standalone
+ * snapshot, everything which may take long is done before the guest is
+ * frozen, so that the guests of the group are frozen only while the
+ * transactions of all of them are issued. */
+static int
+qemuSnapshotCreateActiveExternalGroup(virQEMUDriver *driver,
+                                      virDomainObj *vm,
+                                      virDomainMomentObj *snap,
+                                      unsigned int flags,
+                                      qemuSnapshotGroupMember *member)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+    bool reuse = (flags & VIR_DOMAIN_SNAPSHOT_CREATE_REUSE_EXT) != 0;
+    g_autoptr(GHashTable) blockNamedNodeData = NULL;
+    g_autoptr(qemuSnapshotDiskContext) snapctxt = NULL;
+    bool thaw = false;
+    int ret = -1;
+
+    if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV) &&
+        !(blockNamedNodeData = qemuBlockGetNamedNodeData(vm, QEMU_ASYNC_JOB_SNAPSHOT)))
+        goto cleanup;
+
+    if (!(snapctxt = qemuSnapshotDiskPrepareActiveExternal(vm, snap, reuse,
+                                                           blockNamedNodeData,
+                                                           QEMU_ASYNC_JOB_SNAPSHOT)))
+        goto cleanup;
+
+    if (qemuSnapshotGroupArrive(member, vm, QEMU_SNAPSHOT_GROUP_PHASE_PREPARED) < 0)
+        goto cleanup;
+
+    if (flags & VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE) {
+        int frozen;
+
+        if (qemuDomainObjBeginAgentJob(driver, vm, QEMU_AGENT_JOB_MODIFY) < 0)
+            goto cleanup;
+
+        if (virDomainObjCheckActive(vm) < 0) {
+            qemuDomainObjEndAgentJob(vm);
+            goto cleanup;
+        }
+
+        frozen = qemuSnapshotFSFreeze(vm, NULL, 0);
+        qemuDomainObjEndAgentJob(vm);
+
+        if (frozen < 0)
+            goto cleanup;
+
+        if (frozen > 0)
+            thaw = true;
+    }
+
+    if (qemuSnapshotGroupArrive(member, vm, QEMU_SNAPSHOT_GROUP_PHASE_FROZEN) < 0)
+        goto cleanup;
+
+    if (virDomainObjCheckActive(vm) < 0)
+        goto cleanup;
+
+    if (qemuSnapshotDiskCreate(snapctxt) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    /* A failed member doesn't hold back the others, the rest of the group
+     * thaws once everybody's transaction was issued */
+    if (ret < 0)
+        qemuSnapshotGroupLeave(member, false);
+    else
+        ignore_value(qemuSnapshotGroupArrive(member, vm,
+                                             QEMU_SNAPSHOT_GROUP_PHASE_DONE));
+
+    if (thaw &&
+        qemuDomainObjBeginAgentJob(driver, vm, QEMU_AGENT_JOB_MODIFY) >= 0 &&
+        virDomainObjIsActive(vm)) {
+        /* report error only on an otherwise successful snapshot */
+        if (qemuSnapshotFSThaw(vm, ret == 0) < 0)
+            ret = -1;
+
+        qemuDomainObjEndAgentJob(vm);
+    }
+
+    return ret;
+}
+
+
 static int
 qemuSnapshotCreateActiveExternal(virQEMUDriver *driver,
                                  virDomainObj *vm,
@@ -1454,7 +1661,7 @@ qemuSnapshotCreateActiveExternal(virQEMUDriver *driver,
         memory_existing = virFileExists(snapdef->memorysnapshotfile);
 
         if ((ret = qemuSaveImageCreate(driver, vm, snapdef->memorysnapshotfile,
-                                       data, compressor, 0,
+                                       data, compressor, 0, 0,
                                        QEMU_ASYNC_JOB_SNAPSHOT)) < 0)
             goto cleanup;
 
@@ -1531,11 +1738,12 @@ qemuSnapshotCreateActiveExternal(virQEMUDriver *driver,
 }
 
 
-virDomainSnapshotPtr
-qemuSnapshotCreateXML(virDomainPtr domain,
-                      virDomainObj *vm,
-                      const char *xmlDesc,
-                      unsigned int flags)
+static virDomainSnapshotPtr
+qemuSnapshotCreate(virDomainPtr domain,
+                   virDomainObj *vm,
+                   const char *xmlDesc,
+                   unsigned int flags,
+                   qemuSnapshotGroupMember *member)
 {
     virQEMUDriver *driver = domain->conn->privateData;
     g_autofree char *xml = NULL;
@@ -1745,8 +1953,13 @@ qemuSnapshotCreateXML(virDomainPtr domain,
          * makes sense, such as checking that qemu-img recognizes the
          * snapshot name in at least one of the domain's disks?  */
     } else if (virDomainObjIsActive(vm)) {
-        if (flags & VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY ||
-            virDomainSnapshotObjGetDef(snap)->memory == VIR_DOMAIN_SNAPSHOT_LOCATION_EXTERNAL) {
+        if (member) {
+            /* disk snapshot synchronized with other domains */
+            if (qemuSnapshotCreateActiveExternalGroup(driver, vm, snap,
+                                                      flags, member) < 0)
+                goto endjob;
+        } else if (flags & VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY ||
+                   virDomainSnapshotObjGetDef(snap)->memory == VIR_DOMAIN_SNAPSHOT_LOCATION_EXTERNAL) {
             /* external full system or disk snapshot */
             if (qemuSnapshotCreateActiveExternal(driver, vm, snap, cfg, flags) < 0)
                 goto endjob;
@@ -1802,10 +2015,160 @@ qemuSnapshotCreateXML(virDomainPtr domain,
     qemuDomainObjEndAsyncJob(driver, vm);
 
  cleanup:
+    if (member)
+        qemuSnapshotGroupLeave(member, !!snapshot);
+
     return snapshot;
 }
 
 
+virDomainSnapshotPtr
+qemuSnapshotCreateXML(virDomainPtr domain,
+                      virDomainObj *vm,
+                      const char *xmlDesc,
+                      unsigned int flags)
+{
+    return qemuSnapshotCreate(domain, vm, xmlDesc, flags, NULL);
+}
+
+
+static void
+qemuSnapshotGroupMemberThread(void *opaque)
+{
+    qemuSnapshotGroupMember *member = opaque;
+
+    virObjectLock(member->vm);
+    member->snapshot = qemuSnapshotCreate(member->domain, member->vm,
+                                          member->xmlDesc, member->flags,
+                                          member);
+    virObjectUnlock(member->vm);
+
+    if (!member->snapshot)
+        virErrorPreserveLast(&member->error);
+}
+
+
+/**
+ * qemuSnapshotCreateXMLGroup:
+ * @domains: domains to snapshot
+ * @vms: referenced, unlocked domain objects of @domains
+ * @xmlDescs: snapshot XML of each domain
+ * @ndomains: number of domains
+ * @snapshots: optional array to return the snapshots in
+ * @flags: bitwise-OR of virDomainSnapshotCreateFlags
+ *
+ * Creates disk snapshots of several domains capturing the same point in
+ * time. Each domain is handled by a thread of its own; the threads create
+ * the overlays, then freeze the guests, issue the transactions and thaw
+ * the guests in lockstep, so the time the guests are frozen doesn't grow
+ * with the number of domains. A thread per domain rather than a bounded
+ * pool is needed as every member waits for all the others at each step.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuSnapshotCreateXMLGroup(virDomainPtr *domains,
+                           virDomainObj **vms,
+                           const char **xmlDescs,
+                           size_t ndomains,
+                           virDomainSnapshotPtr *snapshots,
+                           unsigned int flags)
+{
+    qemuSnapshotGroup group = { 0 };
+    g_autofree qemuSnapshotGroupMember *members = NULL;
+    qemuSnapshotGroupMember *culprit = NULL;
+    int ret = 0;
+    size_t i;
+
+    virCheckFlags(VIR_DOMAIN_SNAPSHOT_CREATE_NO_METADATA |
+                  VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY |
+                  VIR_DOMAIN_SNAPSHOT_CREATE_REUSE_EXT |
+                  VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE |
+                  VIR_DOMAIN_SNAPSHOT_CREATE_ATOMIC |
+                  VIR_DOMAIN_SNAPSHOT_CREATE_VALIDATE, -1);
+
+    if (virMutexInit(&group.lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return -1;
+    }
+
+    if (virCondInit(&group.cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&group.lock);
+        return -1;
+    }
+
+    group.nmembers = ndomains;
+    members = g_new0(qemuSnapshotGroupMember, ndomains);
+
+    for (i = 0; i < ndomains; i++) {
+        qemuSnapshotGroupMember *member = members + i;
+
+        member->group = &group;
+        member->domain = domains[i];
+        member->vm = vms[i];
+        member->xmlDesc = xmlDescs[i];
+        member->flags = flags;
+
+        if (virThreadCreateFull(&member->thread, true,
+                                qemuSnapshotGroupMemberThread,
+                                "qemu-snap-group",
+                                false,
+                                member) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create snapshot thread"));
+            virErrorPreserveLast(&member->error);
+            qemuSnapshotGroupLeave(member, false);
+            continue;
+        }
+
+        member->started = true;
+    }
+
+    for (i = 0; i < ndomains; i++) {
+        if (members[i].started)
+            virThreadJoin(&members[i].thread);
+
+        if (!members[i].snapshot)
+            ret = -1;
+    }
+
+    virCondDestroy(&group.cond);
+    virMutexDestroy(&group.lock);
+
+    if (ret < 0) {
+        /* report the error which made the group fail rather than those of
+         * the members which gave up because of it */
+        for (i = 0; i < ndomains; i++) {
+            if (!members[i].error)
+                continue;
+
+            if (!culprit || members[i].first)
+                culprit = members + i;
+
+            if (culprit->first)
+                break;
+        }
+
+        if (culprit)
+            virErrorRestore(&culprit->error);
+        else
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("group snapshot failed"));
+    }
+
+    for (i = 0; i < ndomains; i++) {
+        if (ret == 0 && snapshots)
+            snapshots[i] = g_steal_pointer(&members[i].snapshot);
+
+        virObjectUnref(members[i].snapshot);
+        virFreeError(members[i].error);
+    }
+
+    return ret;
+}
+
+
 /* The domain is expected to be locked and inactive. */
 static int
 qemuSnapshotRevertInactive(virQEMUDriver *driver,
@@ -2111,7 +2474,8 @@ qemuSnapshotRevert(virDomainObj *vm,
 
             rc = qemuProcessStart(snapshot->domain->conn, driver, vm,
                                   cookie ? cookie->cpu : NULL,
-                                  QEMU_ASYNC_JOB_START, NULL, -1, NULL, snap,
+                                  QEMU_ASYNC_JOB_START, NULL, -1, NULL, NULL,
+                                  snap,
                                   VIR_NETDEV_VPORT_PROFILE_OP_CREATE,
                                   start_flags);
             virDomainAuditStart(vm, "from-snapshot", rc >= 0);
@@ -2203,6 +2567,7 @@ qemuSnapshotRevert(virDomainObj *vm,
             virObjectEventStateQueue(driver->domainEventState, event);
             rc = qemuProcessStart(snapshot->domain->conn, driver, vm, NULL,
                                   QEMU_ASYNC_JOB_START, NULL, -1, NULL, NULL,
+                                  NULL,
                                   VIR_NETDEV_VPORT_PROFILE_OP_CREATE,
                                   start_flags);
             virDomainAuditStart(vm, "from-snapshot", rc >= 0);
@@ -2282,9 +2647,11 @@ struct _virQEMUMomentReparent {
     virDomainMomentObj *parent;
     virDomainObj *vm;
     virDomainXMLOption *xmlopt;
+    virFileRewriteBatch *batch;
     int err;
     int (*writeMetadata)(virDomainObj *, virDomainMomentObj *,
-                         virDomainXMLOption *, const char *);
+                         virDomainXMLOption *, const char *,
+                         virFileRewriteBatch *);
 };
 
 
@@ -2305,7 +2672,7 @@ qemuSnapshotChildrenReparent(void *payload,
         moment->def->parent_name = g_strdup(rep->parent->def->name);
 
     rep->err = rep->writeMetadata(rep->vm, moment, rep->xmlopt,
-                                  rep->dir);
+                                  rep->dir, rep->batch);
     return 0;
 }
 
@@ -2320,6 +2687,7 @@ qemuSnapshotDelete(virDomainObj *vm,
     virDomainMomentObj *snap = NULL;
     virQEMUMomentRemove rem;
     virQEMUMomentReparent rep;
+    g_autoptr(virFileRewriteBatch) batch = NULL;
     bool metadata_only = !!(flags & VIR_DOMAIN_SNAPSHOT_DELETE_METADATA_ONLY);
     int external = 0;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
@@ -2380,16 +2748,20 @@ qemuSnapshotDelete(virDomainObj *vm,
             }
         }
     } else if (snap->nchildren) {
+        /* every child gets its file rewritten, do it in one go */
+        batch = virFileRewriteBatchNew();
         rep.dir = cfg->snapshotDir;
         rep.parent = snap->parent;
         rep.vm = vm;
         rep.err = 0;
         rep.xmlopt = driver->xmlopt;
-        rep.writeMetadata = qemuDomainSnapshotWriteMetadata;
+        rep.batch = batch;
+        rep.writeMetadata = qemuDomainSnapshotWriteMetadataBatch;
         virDomainMomentForEachChild(snap,
                                     qemuSnapshotChildrenReparent,
                                     &rep);
-        if (rep.err < 0)
+        if (rep.err < 0 ||
+            virFileRewriteBatchCommit(batch) < 0)
             goto endjob;
         virDomainMomentMoveChildren(snap, snap->parent);
     }
@@ -45,6 +45,14 @@ qemuSnapshotCreateXML(virDomainPtr domain,
                       const char *xmlDesc,
                       unsigned int flags);
 
+int
+qemuSnapshotCreateXMLGroup(virDomainPtr *domains,
+                           virDomainObj **vms,
+                           const char **xmlDescs,
+                           size_t ndomains,
+                           virDomainSnapshotPtr *snapshots,
+                           unsigned int flags);
+
 int
 qemuSnapshotRevert(virDomainObj *vm,
                    virDomainSnapshotPtr snapshot,
@@ -0,0 +1,226 @@
+/*
+ * qemu_statuswriter.c: QEMU deferred domain status writer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "qemu_statuswriter.h"
+#include "qemu_domain.h"
+#include "virerror.h"
+#include "virlog.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_QEMU
+
+VIR_LOG_INIT("qemu.qemu_statuswriter");
+
+/*
+ * When status_save_interval is set in qemu.conf, qemuDomainSaveStatus only
+ * marks the status of a domain as dirty and queues the domain here. A single
+ * thread writes the status files of all queued domains at most once per
+ * interval, so a burst of changes to one domain results in one write of
+ * its final state. Points where the status has to hit the disk right away,
+ * such as the end of a job, keep calling qemuDomainObjSaveStatus, which
+ * writes synchronously and clears the dirty flag. Domains still queued when
+ * the driver shuts down are written before the thread exits.
+ */
+
+struct _qemuStatusWriter {
+    virMutex lock;
+    virCond cond;
+    virThread thread;
+    bool threadActive;
+    bool quit;
+
+    GPtrArray *vms;
+    unsigned long long next; /* milliseconds since the epoch */
+};
+
+
+qemuStatusWriter *
+qemuStatusWriterNew(void)
+{
+    g_autofree qemuStatusWriter *writer = g_new0(qemuStatusWriter, 1);
+
+    if (virMutexInit(&writer->lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return NULL;
+    }
+
+    if (virCondInit(&writer->cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&writer->lock);
+        return NULL;
+    }
+
+    writer->vms = g_ptr_array_new_with_free_func(virObjectUnref);
+
+    return g_steal_pointer(&writer);
+}
+
+
+/*
+ * Tells the writer thread to write all queued domains and quit, and if
+ * @wait is true waits for it to do so. Domains are not queued anymore
+ * afterwards, their status is saved synchronously instead.
+ */
+void
+qemuStatusWriterStop(qemuStatusWriter *writer,
+                     bool wait)
+{
+    bool join = false;
+
+    virMutexLock(&writer->lock);
+    writer->quit = true;
+    virCondSignal(&writer->cond);
+    if (wait && writer->threadActive) {
+        writer->threadActive = false;
+        join = true;
+    }
+    virMutexUnlock(&writer->lock);
+
+    if (join)
+        virThreadJoin(&writer->thread);
+}
+
+
+void
+qemuStatusWriterFree(qemuStatusWriter *writer)
+{
+    if (!writer)
+        return;
+
+    qemuStatusWriterStop(writer, true);
+
+    g_ptr_array_unref(writer->vms);
+    virCondDestroy(&writer->cond);
+    virMutexDestroy(&writer->lock);
+    g_free(writer);
+}
+
+
+static void
+qemuStatusWriterFlush(virQEMUDriver *driver,
+                      GPtrArray *vms)
+{
+    size_t i;
+
+    for (i = 0; i < vms->len; i++) {
+        virDomainObj *vm = g_ptr_array_index(vms, i);
+        qemuDomainObjPrivate *priv;
+
+        virObjectLock(vm);
+        priv = vm->privateData;
+        priv->statusQueued = false;
+        /* The status might have been saved synchronously meanwhile */
+        if (priv->statusDirty)
+            qemuDomainObjSaveStatus(driver, vm);
+        virObjectUnlock(vm);
+    }
+}
+
+
+static void
+qemuStatusWriterThread(void *opaque)
+{
+    virQEMUDriver *driver = opaque;
+    qemuStatusWriter *writer = driver->statusWriter;
+
+    virMutexLock(&writer->lock);
+    while (true) {
+        g_autoptr(GPtrArray) vms = NULL;
+        g_autoptr(virQEMUDriverConfig) cfg = NULL;
+        unsigned long long now;
+
+        if (!writer->quit && writer->vms->len == 0) {
+            ignore_value(virCondWait(&writer->cond, &writer->lock));
+            continue;
+        }
+
+        if (virTimeMillisNow(&now) < 0) {
+            VIR_WARN("Unable to get current time, writing status right away");
+            virResetLastError();
+            now = writer->next;
+        }
+
+        if (!writer->quit && now < writer->next) {
+            ignore_value(virCondWaitUntil(&writer->cond, &writer->lock,
+                                          writer->next));
+            continue;
+        }
+
+        if (writer->vms->len == 0)
+            break;
+
+        vms = g_steal_pointer(&writer->vms);
+        writer->vms = g_ptr_array_new_with_free_func(virObjectUnref);
+        virMutexUnlock(&writer->lock);
+
+        qemuStatusWriterFlush(driver, vms);
+        cfg = virQEMUDriverGetConfig(driver);
+
+        virMutexLock(&writer->lock);
+        writer->next = now + cfg->statusSaveInterval;
+    }
+    virMutexUnlock(&writer->lock);
+}
+
+
+/**
+ * qemuStatusWriterQueue:
+ * @driver: qemu driver data
+ * @vm: domain object
+ *
+ * Queues @vm to have its status written by the writer thread within
+ * status_save_interval. The caller must hold the lock of @vm.
+ *
+ * Returns true if @vm was queued, false if its status has to be saved
+ * synchronously because the writer is disabled or shutting down.
+ */
+bool
+qemuStatusWriterQueue(virQEMUDriver *driver,
+                      virDomainObj *vm)
+{
+    qemuStatusWriter *writer = driver->statusWriter;
+    bool ret = false;
+
+    if (!writer)
+        return false;
+
+    virMutexLock(&writer->lock);
+
+    if (writer->quit)
+        goto cleanup;
+
+    if (!writer->threadActive) {
+        if (virThreadCreateFull(&writer->thread, true, qemuStatusWriterThread,
+                                "qemu-status-writer", false, driver) < 0) {
+            VIR_WARN("Unable to create status writer thread");
+            goto cleanup;
+        }
+        writer->threadActive = true;
+    }
+
+    g_ptr_array_add(writer->vms, virObjectRef(vm));
+    virCondSignal(&writer->cond);
+    ret = true;
+
+ cleanup:
+    virMutexUnlock(&writer->lock);
+    return ret;
+}
@@ -44,6 +44,7 @@
 #include "qemu_tpm.h"
 #include "virtpm.h"
 #include "virsecret.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -903,7 +904,9 @@ qemuExtTPMCleanupHost(virDomainDef *def)
  *
  * Start the external TPM Emulator:
  * - have the command line built
- * - start the external TPM Emulator and sync with it before QEMU start
+ * - start the external TPM Emulator
+ *
+ * Use qemuExtTPMWaitEmulator to sync with it before QEMU start.
  */
 static int
 qemuExtTPMStartEmulator(virQEMUDriver *driver,
@@ -916,8 +919,7 @@ qemuExtTPMStartEmulator(virQEMUDriver *driver,
     g_autofree char *errbuf = NULL;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     g_autofree char *shortName = virDomainDefGetShortName(vm->def);
-    int cmdret = 0, timeout, rc;
-    pid_t pid;
+    int cmdret = 0;
 
     if (!shortName)
         return -1;
@@ -952,25 +954,45 @@ qemuExtTPMStartEmulator(virQEMUDriver *driver,
         return -1;
     }
 
-    /* check that the swtpm has written its pid into the file */
-    timeout = 1000; /* ms */
-    while (timeout > 0) {
-        rc = qemuTPMEmulatorGetPid(cfg->swtpmStateDir, shortName, &pid);
-        if (rc < 0) {
-            timeout -= 50;
-            g_usleep(50 * 1000);
+    return 0;
+}
+
+
+/*
+ * qemuExtTPMWaitEmulator:
+ *
+ * @driver: QEMU driver
+ * @vm: the domain object
+ *
+ * Wait until the TPM Emulator started by qemuExtTPMStartEmulator has
+ * written its pid into the file, which it does once it is ready to
+ * accept connections.
+ */
+static int
+qemuExtTPMWaitEmulator(virQEMUDriver *driver,
+                       virDomainObj *vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autofree char *shortName = virDomainDefGetShortName(vm->def);
+    virTimeBackOffVar timebackoff;
+    pid_t pid;
+
+    if (!shortName)
+        return -1;
+
+    if (virTimeBackOffStart(&timebackoff, 1, 1000) < 0)
+        return -1;
+
+    while (virTimeBackOffWait(&timebackoff)) {
+        if (qemuTPMEmulatorGetPid(cfg->swtpmStateDir, shortName, &pid) < 0)
             continue;
-        }
-        if (rc == 0 && pid == (pid_t)-1)
-            goto error;
-        break;
-    }
-    if (timeout <= 0)
-        goto error;
 
-    return 0;
+        if (pid == (pid_t)-1)
+            break;
+
+        return 0;
+    }
 
- error:
     virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                    _("swtpm failed to start"));
     return -1;
@@ -996,6 +1018,23 @@ qemuExtTPMStart(virQEMUDriver *driver,
 }
 
 
+int
+qemuExtTPMWaitStarted(virQEMUDriver *driver,
+                      virDomainObj *vm)
+{
+    size_t i;
+
+    for (i = 0; i < vm->def->ntpms; i++) {
+        if (vm->def->tpms[i]->type != VIR_DOMAIN_TPM_TYPE_EMULATOR)
+            continue;
+
+        return qemuExtTPMWaitEmulator(driver, vm);
+    }
+
+    return 0;
+}
+
+
 void
 qemuExtTPMStop(virQEMUDriver *driver,
                virDomainObj *vm)
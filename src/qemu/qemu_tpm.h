@@ -41,6 +41,11 @@ int qemuExtTPMStart(virQEMUDriver *driver,
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
     G_GNUC_WARN_UNUSED_RESULT;
 
+int qemuExtTPMWaitStarted(virQEMUDriver *driver,
+                          virDomainObj *vm)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
+    G_GNUC_WARN_UNUSED_RESULT;
+
 void qemuExtTPMStop(virQEMUDriver *driver,
                     virDomainObj *vm)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
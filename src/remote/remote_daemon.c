@@ -38,6 +38,7 @@
 
 #include "remote_daemon.h"
 #include "remote_daemon_config.h"
+#include "remote_daemon_metrics.h"
 
 #include "admin/admin_server_dispatch.h"
 #include "viruuid.h"
@@ -46,6 +47,7 @@
 #include "virconf.h"
 #include "virnetlink.h"
 #include "virnetdaemon.h"
+#include "virnetsocketuring.h"
 #include "remote_daemon_dispatch.h"
 #include "virhook.h"
 #include "viraudit.h"
@@ -494,6 +496,15 @@ static void daemonReloadHandler(virNetDaemon *dmn G_GNUC_UNUSED,
     }
 }
 
+static void daemonDumpLogsHandler(virNetDaemon *dmn G_GNUC_UNUSED,
+                                  siginfo_t *sig G_GNUC_UNUSED,
+                                  void *opaque G_GNUC_UNUSED)
+{
+    if (virLogDumpRings() < 0)
+        VIR_WARN("Failed to dump in-memory logs: %s",
+                 virGetLastErrorMessage());
+}
+
 static int daemonSetupSignals(virNetDaemon *dmn)
 {
     if (virNetDaemonAddSignalHandler(dmn, SIGINT, daemonShutdownHandler, NULL) < 0)
@@ -504,6 +515,8 @@ static int daemonSetupSignals(virNetDaemon *dmn)
         return -1;
     if (virNetDaemonAddSignalHandler(dmn, SIGHUP, daemonReloadHandler, NULL) < 0)
         return -1;
+    if (virNetDaemonAddSignalHandler(dmn, SIGUSR2, daemonDumpLogsHandler, NULL) < 0)
+        return -1;
     return 0;
 }
 
@@ -1044,6 +1057,15 @@ int main(int argc, char **argv) {
         goto cleanup;
     }
 
+    if (config->max_mutating_workers &&
+        virNetServerSetThreadPoolParameters(srv, -1, -1, -1,
+                                            config->max_mutating_workers) < 0) {
+        ret = VIR_DAEMON_ERR_INIT;
+        goto cleanup;
+    }
+
+    virNetServerSetCompressionThreshold(srv, config->compression_threshold);
+
     if (virNetDaemonAddServer(dmn, srv) < 0) {
         ret = VIR_DAEMON_ERR_INIT;
         goto cleanup;
@@ -1066,6 +1088,10 @@ int main(int argc, char **argv) {
         ret = VIR_DAEMON_ERR_INIT;
         goto cleanup;
     }
+#ifdef VIRTPROXYD
+    virNetServerProgramSetForwarder(remoteProgram,
+                                    remoteDispatchForwardCall, NULL);
+#endif /* VIRTPROXYD */
     if (virNetServerAddProgram(srv, remoteProgram) < 0) {
         ret = VIR_DAEMON_ERR_INIT;
         goto cleanup;
@@ -1168,6 +1194,23 @@ int main(int argc, char **argv) {
     virHookCall(VIR_HOOK_DRIVER_DAEMON, "-", VIR_HOOK_DAEMON_OP_START,
                 0, "start", NULL, NULL);
 
+    if (config->io_uring &&
+        virNetSocketUringEnable() < 0) {
+        ret = VIR_DAEMON_ERR_NETWORK;
+        goto cleanup;
+    }
+
+    if (config->event_loop_threads > 0 &&
+        virNetServerClientSetupEventThreads(config->event_loop_threads) < 0) {
+        ret = VIR_DAEMON_ERR_NETWORK;
+        goto cleanup;
+    }
+
+    if (daemonMetricsStart(srv, config) < 0) {
+        ret = VIR_DAEMON_ERR_NETWORK;
+        goto cleanup;
+    }
+
     if (daemonSetupNetworking(srv, srvAdm,
                               config,
 #ifdef WITH_IP
@@ -1225,6 +1268,7 @@ int main(int argc, char **argv) {
                 0, "shutdown", NULL, NULL);
 
  cleanup:
+    daemonMetricsStop();
     virNetlinkEventServiceStopAll();
 
     if (driversInitialized) {
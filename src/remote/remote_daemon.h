@@ -58,6 +58,12 @@ struct daemonClientPrivate {
     size_t nsecretEventCallbacks;
     bool closeRegistered;
 
+    /* Recent results of domain event ACL checks, keyed by domain
+     * UUID. Has its own lock because it is used from the event
+     * dispatch path, which must not take @lock */
+    virMutex domainEventACLLock;
+    GHashTable *domainEventACL;
+
 #if WITH_SASL
     virNetSASLSession *sasl;
 #endif
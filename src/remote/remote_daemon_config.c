@@ -163,8 +163,13 @@ daemonConfigNew(bool privileged G_GNUC_UNUSED)
     data->admin_keepalive_interval = 5;
     data->admin_keepalive_count = 5;
 
+    data->compression_threshold = VIR_NET_MESSAGE_COMPRESS_THRESHOLD;
+
     data->ovs_timeout = VIR_NETDEV_OVS_DEFAULT_TIMEOUT;
 
+    data->metrics_unix_sock_perms = g_strdup("0700");
+    data->metrics_cache_time = 5;
+
     return data;
 }
 
@@ -223,6 +228,10 @@ daemonConfigFree(struct daemonConfig *data)
     g_free(data->log_filters);
     g_free(data->log_outputs);
 
+    g_free(data->metrics_unix_sock);
+    g_free(data->metrics_unix_sock_perms);
+    g_free(data->metrics_uri);
+
     g_free(data);
 }
 
@@ -338,10 +347,18 @@ daemonConfigLoadOptions(struct daemonConfig *data,
 
     if (virConfGetValueUInt(conf, "prio_workers", &data->prio_workers) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "max_mutating_workers", &data->max_mutating_workers) < 0)
+        return -1;
 
     if (virConfGetValueUInt(conf, "max_client_requests", &data->max_client_requests) < 0)
         return -1;
 
+    if (virConfGetValueBool(conf, "io_uring", &data->io_uring) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "event_loop_threads", &data->event_loop_threads) < 0)
+        return -1;
+
     if (virConfGetValueUInt(conf, "admin_min_workers", &data->admin_min_workers) < 0)
         return -1;
     if (virConfGetValueUInt(conf, "admin_max_workers", &data->admin_max_workers) < 0)
@@ -380,9 +397,21 @@ daemonConfigLoadOptions(struct daemonConfig *data,
     if (virConfGetValueUInt(conf, "admin_keepalive_count", &data->admin_keepalive_count) < 0)
         return -1;
 
+    if (virConfGetValueUInt(conf, "compression_threshold", &data->compression_threshold) < 0)
+        return -1;
+
     if (virConfGetValueUInt(conf, "ovs_timeout", &data->ovs_timeout) < 0)
         return -1;
 
+    if (virConfGetValueString(conf, "metrics_unix_sock", &data->metrics_unix_sock) < 0)
+        return -1;
+    if (virConfGetValueString(conf, "metrics_unix_sock_perms", &data->metrics_unix_sock_perms) < 0)
+        return -1;
+    if (virConfGetValueString(conf, "metrics_uri", &data->metrics_uri) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "metrics_cache_time", &data->metrics_cache_time) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -73,9 +73,14 @@ struct daemonConfig {
     unsigned int max_anonymous_clients;
 
     unsigned int prio_workers;
+    unsigned int max_mutating_workers;
 
     unsigned int max_client_requests;
 
+    bool io_uring;
+
+    unsigned int event_loop_threads;
+
     unsigned int log_level;
     char *log_filters;
     char *log_outputs;
@@ -95,7 +100,14 @@ struct daemonConfig {
     int admin_keepalive_interval;
     unsigned int admin_keepalive_count;
 
+    unsigned int compression_threshold;
+
     unsigned int ovs_timeout;
+
+    char *metrics_unix_sock;
+    char *metrics_unix_sock_perms;
+    char *metrics_uri;
+    unsigned int metrics_cache_time;
 };
 
 
@@ -25,6 +25,7 @@
 #include "remote_daemon_dispatch.h"
 #include "remote_daemon.h"
 #include "remote_sockets.h"
+#include "remote_driver.h"
 #include "libvirt_internal.h"
 #include "datatypes.h"
 #include "viralloc.h"
@@ -129,6 +130,19 @@ remoteGetSecretConn(virNetServerClient *client);
 static virConnectPtr
 remoteGetStorageConn(virNetServerClient *client);
 
+/* Reply of REMOTE_PROC_CONNECT_GET_ALL_DOMAIN_STATS, encoded straight
+ * from the records returned by the driver, in the wire format of
+ * remote_connect_get_all_domain_stats_ret */
+typedef struct _remote_connect_get_all_domain_stats_direct_ret remote_connect_get_all_domain_stats_direct_ret;
+struct _remote_connect_get_all_domain_stats_direct_ret {
+    virDomainStatsRecordPtr *records;
+    u_int nrecords;
+};
+
+static bool_t
+xdr_remote_connect_get_all_domain_stats_direct_ret(XDR *xdrs,
+                                                   remote_connect_get_all_domain_stats_direct_ret *ret);
+
 
 #include "remote_daemon_dispatch_stubs.h"
 #include "qemu_daemon_dispatch_stubs.h"
@@ -155,9 +169,52 @@ remoteEventCallbackFree(void *opaque)
 }
 
 
+/* How long (in microseconds) the result of a domain event ACL check
+ * is reused for further events of the same domain sent to the same
+ * client. This keeps a burst of events (e.g. many guests being
+ * started at once) from turning into a burst of access driver queries
+ * while still picking up policy changes in a timely manner. */
+#define REMOTE_DOMAIN_EVENT_ACL_TTL (5 * G_USEC_PER_SEC)
+
+/* Expired entries are purged once the cache grows beyond this size */
+#define REMOTE_DOMAIN_EVENT_ACL_MAX 1024
+
+typedef struct _remoteDomainEventACL remoteDomainEventACL;
+struct _remoteDomainEventACL {
+    char *name;
+    bool allowed;
+    gint64 expires;
+};
+
+
+static void
+remoteDomainEventACLFree(void *opaque)
+{
+    remoteDomainEventACL *acl = opaque;
+
+    if (!acl)
+        return;
+
+    g_free(acl->name);
+    g_free(acl);
+}
+
+
+static gboolean
+remoteDomainEventACLExpired(gpointer key G_GNUC_UNUSED,
+                            gpointer value,
+                            gpointer opaque)
+{
+    remoteDomainEventACL *acl = value;
+    gint64 *now = opaque;
+
+    return acl->expires <= *now;
+}
+
+
 static bool
-remoteRelayDomainEventCheckACL(virNetServerClient *client,
-                               virConnectPtr conn, virDomainPtr dom)
+remoteRelayDomainEventCheckACLUncached(virNetServerClient *client,
+                                       virConnectPtr conn, virDomainPtr dom)
 {
     virDomainDef def;
     g_autoptr(virIdentity) identity = NULL;
@@ -182,6 +239,47 @@ remoteRelayDomainEventCheckACL(virNetServerClient *client,
 }
 
 
+static bool
+remoteRelayDomainEventCheckACL(virNetServerClient *client,
+                               virConnectPtr conn, virDomainPtr dom)
+{
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    remoteDomainEventACL *acl;
+    gint64 now = g_get_monotonic_time();
+    bool allowed;
+
+    virUUIDFormat(dom->uuid, uuidstr);
+
+    virMutexLock(&priv->domainEventACLLock);
+    if ((acl = g_hash_table_lookup(priv->domainEventACL, uuidstr)) &&
+        acl->expires > now &&
+        STREQ(acl->name, dom->name)) {
+        allowed = acl->allowed;
+        virMutexUnlock(&priv->domainEventACLLock);
+        return allowed;
+    }
+    virMutexUnlock(&priv->domainEventACLLock);
+
+    allowed = remoteRelayDomainEventCheckACLUncached(client, conn, dom);
+
+    acl = g_new0(remoteDomainEventACL, 1);
+    acl->name = g_strdup(dom->name);
+    acl->allowed = allowed;
+    acl->expires = now + REMOTE_DOMAIN_EVENT_ACL_TTL;
+
+    virMutexLock(&priv->domainEventACLLock);
+    if (g_hash_table_size(priv->domainEventACL) >= REMOTE_DOMAIN_EVENT_ACL_MAX)
+        g_hash_table_foreach_remove(priv->domainEventACL,
+                                    remoteDomainEventACLExpired, &now);
+
+    g_hash_table_insert(priv->domainEventACL, g_strdup(uuidstr), acl);
+    virMutexUnlock(&priv->domainEventACLLock);
+
+    return allowed;
+}
+
+
 static bool
 remoteRelayNetworkEventCheckACL(virNetServerClient *client,
                                 virConnectPtr conn, virNetworkPtr net)
@@ -1363,6 +1461,45 @@ remoteRelayDomainEventMemoryDeviceSizeChange(virConnectPtr conn,
 }
 
 
+static int
+remoteRelayDomainEventStats(virConnectPtr conn,
+                            virDomainPtr dom,
+                            virTypedParameterPtr params,
+                            int nparams,
+                            void *opaque)
+{
+    daemonClientEventCallback *callback = opaque;
+    remote_domain_event_callback_stats_msg data;
+
+    if (callback->callbackID < 0 ||
+        !remoteRelayDomainEventCheckACL(callback->client, conn, dom))
+        return -1;
+
+    VIR_DEBUG("Relaying domain stats event %s %d, callback %d, params %p %d",
+              dom->name, dom->id, callback->callbackID, params, nparams);
+
+    /* build return data */
+    memset(&data, 0, sizeof(data));
+
+    if (virTypedParamsSerialize(params, nparams,
+                                REMOTE_DOMAIN_EVENT_STATS_MAX,
+                                (struct _virTypedParameterRemote **) &data.params.params_val,
+                                &data.params.params_len,
+                                VIR_TYPED_PARAM_STRING_OKAY) < 0)
+        return -1;
+
+    data.callbackID = callback->callbackID;
+    make_nonnull_domain(&data.dom, dom);
+
+    remoteDispatchObjectEventSend(callback->client, callback->program,
+                                  REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS,
+                                  (xdrproc_t)xdr_remote_domain_event_callback_stats_msg,
+                                  &data);
+
+    return 0;
+}
+
+
 static virConnectDomainEventGenericCallback domainEventCallbacks[] = {
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventLifecycle),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventReboot),
@@ -1391,6 +1528,7 @@ static virConnectDomainEventGenericCallback domainEventCallbacks[] = {
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventBlockThreshold),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventMemoryFailure),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventMemoryDeviceSizeChange),
+    VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventStats),
 };
 
 G_STATIC_ASSERT(G_N_ELEMENTS(domainEventCallbacks) == VIR_DOMAIN_EVENT_ID_LAST);
@@ -1773,6 +1911,9 @@ void remoteClientFree(void *data)
     if (priv->storageConn)
         virConnectClose(priv->storageConn);
 
+    g_clear_pointer(&priv->domainEventACL, g_hash_table_unref);
+    virMutexDestroy(&priv->domainEventACLLock);
+
     g_free(priv);
 }
 
@@ -1972,6 +2113,15 @@ void *remoteClientNew(virNetServerClient *client,
         return NULL;
     }
 
+    if (virMutexInit(&priv->domainEventACLLock) < 0) {
+        virMutexDestroy(&priv->lock);
+        VIR_FREE(priv);
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        return NULL;
+    }
+
+    priv->domainEventACL = virHashNew(remoteDomainEventACLFree);
+
     virNetServerClientSetCloseHook(client, remoteClientCloseFunc);
     return priv;
 }
@@ -2042,6 +2192,30 @@ remoteDispatchProbeURI(bool readonly,
     VIR_DEBUG("Probed URI %s for driver %s", *probeduri, driver);
     return 0;
 }
+
+
+/*
+ * Relays plain calls straight to the daemon behind the connection
+ * of the client, without decoding them and running them through
+ * the public API and the remote driver. The daemon on the other
+ * end does the access control checks, using the identity of the
+ * client set when opening the connection.
+ */
+int
+remoteDispatchForwardCall(virNetServer *server G_GNUC_UNUSED,
+                          virNetServerClient *client,
+                          virNetMessage *msg,
+                          void *opaque G_GNUC_UNUSED)
+{
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    /* let the regular dispatcher report the missing connection */
+    if (!priv->conn)
+        return 0;
+
+    return remoteConnectForwardMessage(priv->conn, msg);
+}
 #endif /* VIRTPROXYD */
 
 
@@ -4924,7 +5098,7 @@ remoteDispatchDomainMigrateConfirm3(virNetServer *server G_GNUC_UNUSED,
 }
 
 
-static int remoteDispatchConnectSupportsFeature(virNetServer *server G_GNUC_UNUSED,
+static int remoteDispatchConnectSupportsFeature(virNetServer *server,
                                                 virNetServerClient *client,
                                                 virNetMessage *msg G_GNUC_UNUSED,
                                                 struct virNetMessageError *rerr,
@@ -4945,6 +5119,21 @@ static int remoteDispatchConnectSupportsFeature(virNetServer *server G_GNUC_UNUS
         goto done;
     }
 
+    /* Only clients able to decompress messages ask for this one, so
+     * asking is what enables compressing messages sent to them.
+     */
+    if (args->feature == VIR_DRV_FEATURE_REMOTE_COMPRESSION) {
+        size_t threshold = virNetServerGetCompressionThreshold(server);
+
+        supported = 0;
+        if (threshold > 0 && virNetMessageCompressionSupported()) {
+            if (virNetServerClientSetCompression(client, threshold) < 0)
+                goto cleanup;
+            supported = 1;
+        }
+        goto done;
+    }
+
     conn = remoteGetHypervisorConn(client);
 
     if (!conn)
@@ -4973,6 +5162,7 @@ static int remoteDispatchConnectSupportsFeature(virNetServer *server G_GNUC_UNUS
             goto cleanup;
         break;
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
+    case VIR_DRV_FEATURE_REMOTE_COMPRESSION:
         /* should not be possible! */
         goto cleanup;
     }
@@ -6719,16 +6909,202 @@ remoteDispatchNetworkGetDHCPLeases(virNetServer *server G_GNUC_UNUSED,
 }
 
 
+/* Encoded size of a XDR string */
+static size_t
+remoteXDRStringSize(const char *str)
+{
+    return 4 + VIR_ROUND_UP(strlen(str), 4);
+}
+
+
+static u_int
+remoteDomainStatsRecordCountParams(virDomainStatsRecordPtr record)
+{
+    u_int nparams = 0;
+    size_t i;
+
+    /* Sparse entries are skipped, like virTypedParamsSerialize does */
+    for (i = 0; i < record->nparams; i++) {
+        if (record->params[i].type)
+            nparams++;
+    }
+
+    return nparams;
+}
+
+
+/*
+ * Validates @records and computes the exact size of their encoding by
+ * xdr_remote_connect_get_all_domain_stats_direct_ret, so that the reply
+ * buffer can be allocated at once instead of being grown while encoding.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+remoteDomainStatsRecordsSize(virDomainStatsRecordPtr *records,
+                             int nrecords,
+                             size_t *size)
+{
+    size_t len = 4;
+    size_t i;
+    size_t j;
+
+    if (nrecords > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Number of domain stats records is %d, "
+                         "which exceeds max limit: %d"),
+                       nrecords, REMOTE_DOMAIN_LIST_MAX);
+        return -1;
+    }
+
+    for (i = 0; i < nrecords; i++) {
+        virDomainStatsRecordPtr record = records[i];
+
+        if (record->nparams > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+            virReportError(VIR_ERR_RPC,
+                           _("too many parameters '%d' for limit '%d'"),
+                           record->nparams,
+                           REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX);
+            return -1;
+        }
+
+        /* remote_nonnull_domain and the length of the params array */
+        len += remoteXDRStringSize(record->dom->name) + VIR_UUID_BUFLEN + 4;
+        len += 4;
+
+        for (j = 0; j < record->nparams; j++) {
+            virTypedParameterPtr param = record->params + j;
+
+            if (!param->type)
+                continue;
+
+            len += remoteXDRStringSize(param->field) + 4;
+
+            switch ((virTypedParameterType) param->type) {
+            case VIR_TYPED_PARAM_INT:
+            case VIR_TYPED_PARAM_UINT:
+            case VIR_TYPED_PARAM_BOOLEAN:
+                len += 4;
+                break;
+            case VIR_TYPED_PARAM_LLONG:
+            case VIR_TYPED_PARAM_ULLONG:
+            case VIR_TYPED_PARAM_DOUBLE:
+                len += 8;
+                break;
+            case VIR_TYPED_PARAM_STRING:
+                len += remoteXDRStringSize(param->value.s);
+                break;
+            case VIR_TYPED_PARAM_LAST:
+            default:
+                virReportError(VIR_ERR_RPC, _("unknown parameter type: %d"),
+                               param->type);
+                return -1;
+            }
+        }
+    }
+
+    *size = len;
+    return 0;
+}
+
+
+static bool_t
+remoteEncodeTypedParam(XDR *xdrs,
+                       virTypedParameterPtr param)
+{
+    char *field = param->field;
+    int type = param->type;
+    int64_t l;
+    uint64_t ul;
+    int b;
+
+    if (!xdr_remote_nonnull_string(xdrs, &field) ||
+        !xdr_int(xdrs, &type))
+        return FALSE;
+
+    switch ((virTypedParameterType) param->type) {
+    case VIR_TYPED_PARAM_INT:
+        return xdr_int(xdrs, &param->value.i);
+    case VIR_TYPED_PARAM_UINT:
+        return xdr_u_int(xdrs, &param->value.ui);
+    case VIR_TYPED_PARAM_LLONG:
+        l = param->value.l;
+        return xdr_int64_t(xdrs, &l);
+    case VIR_TYPED_PARAM_ULLONG:
+        ul = param->value.ul;
+        return xdr_uint64_t(xdrs, &ul);
+    case VIR_TYPED_PARAM_DOUBLE:
+        return xdr_double(xdrs, &param->value.d);
+    case VIR_TYPED_PARAM_BOOLEAN:
+        b = param->value.b;
+        return xdr_int(xdrs, &b);
+    case VIR_TYPED_PARAM_STRING:
+        return xdr_remote_nonnull_string(xdrs, &param->value.s);
+    case VIR_TYPED_PARAM_LAST:
+        break;
+    }
+
+    return FALSE;
+}
+
+
+static bool_t
+xdr_remote_connect_get_all_domain_stats_direct_ret(XDR *xdrs,
+                                                   remote_connect_get_all_domain_stats_direct_ret *ret)
+{
+    size_t i;
+    size_t j;
+
+    if (xdrs->x_op == XDR_FREE) {
+        virDomainStatsRecordListFree(g_steal_pointer(&ret->records));
+        ret->nrecords = 0;
+        return TRUE;
+    }
+
+    /* The reply is only ever encoded by the daemon */
+    if (xdrs->x_op != XDR_ENCODE)
+        return FALSE;
+
+    if (!xdr_u_int(xdrs, &ret->nrecords))
+        return FALSE;
+
+    for (i = 0; i < ret->nrecords; i++) {
+        virDomainStatsRecordPtr record = ret->records[i];
+        remote_nonnull_domain dom;
+        u_int nparams = remoteDomainStatsRecordCountParams(record);
+
+        dom.name = record->dom->name;
+        dom.id = record->dom->id;
+        memcpy(dom.uuid, record->dom->uuid, VIR_UUID_BUFLEN);
+
+        if (!xdr_remote_nonnull_domain(xdrs, &dom) ||
+            !xdr_u_int(xdrs, &nparams))
+            return FALSE;
+
+        for (j = 0; j < record->nparams; j++) {
+            if (!record->params[j].type)
+                continue;
+
+            if (!remoteEncodeTypedParam(xdrs, record->params + j))
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
 static int
 remoteDispatchConnectGetAllDomainStats(virNetServer *server G_GNUC_UNUSED,
                                        virNetServerClient *client,
-                                       virNetMessage *msg G_GNUC_UNUSED,
+                                       virNetMessage *msg,
                                        struct virNetMessageError *rerr,
                                        remote_connect_get_all_domain_stats_args *args,
-                                       remote_connect_get_all_domain_stats_ret *ret)
+                                       remote_connect_get_all_domain_stats_direct_ret *ret)
 {
     int rv = -1;
     size_t i;
+    size_t len;
     virDomainStatsRecordPtr *retStats = NULL;
     int nrecords = 0;
     virDomainPtr *doms = NULL;
@@ -6758,48 +7134,234 @@ remoteDispatchConnectGetAllDomainStats(virNetServer *server G_GNUC_UNUSED,
             goto cleanup;
     }
 
-    if (nrecords) {
-        if (nrecords > REMOTE_DOMAIN_LIST_MAX) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Number of domain stats records is %d, "
-                             "which exceeds max limit: %d"),
-                           nrecords, REMOTE_DOMAIN_LIST_MAX);
+    if (remoteDomainStatsRecordsSize(retStats, nrecords, &len) < 0)
+        goto cleanup;
+
+    if (len > VIR_NET_MESSAGE_MAX - VIR_NET_MESSAGE_HEADER_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("domain stats reply of %zu bytes exceeds message size limit"),
+                       len);
+        goto cleanup;
+    }
+
+    /* The records are encoded into the reply as they are, make sure the
+     * message buffer is large enough to hold them in one go */
+    virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_LEN_MAX +
+                               VIR_NET_MESSAGE_HEADER_MAX + len);
+
+    ret->records = g_steal_pointer(&retStats);
+    ret->nrecords = nrecords;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virDomainStatsRecordListFree(retStats);
+    virObjectListFree(doms);
+
+    return rv;
+}
+
+
+static int
+remoteDispatchDomainSnapshotCreateXMLGroup(virNetServer *server G_GNUC_UNUSED,
+                                           virNetServerClient *client,
+                                           virNetMessage *msg G_GNUC_UNUSED,
+                                           struct virNetMessageError *rerr,
+                                           remote_domain_snapshot_create_xml_group_args *args,
+                                           remote_domain_snapshot_create_xml_group_ret *ret)
+{
+    int rv = -1;
+    size_t i;
+    size_t ndoms = args->doms.doms_len;
+    virDomainPtr *doms = NULL;
+    virDomainSnapshotPtr *snaps = NULL;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if (args->xml_descs.xml_descs_len != ndoms) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("got %u snapshot descriptions for %zu domains"),
+                       args->xml_descs.xml_descs_len, ndoms);
+        goto cleanup;
+    }
+
+    doms = g_new0(virDomainPtr, ndoms);
+    snaps = g_new0(virDomainSnapshotPtr, ndoms);
+
+    for (i = 0; i < ndoms; i++) {
+        if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
             goto cleanup;
-        }
+    }
 
-        ret->retStats.retStats_val = g_new0(remote_domain_stats_record, nrecords);
-        ret->retStats.retStats_len = nrecords;
+    if (virDomainSnapshotCreateXMLGroup(doms, ndoms,
+                                        (const char **) args->xml_descs.xml_descs_val,
+                                        snaps, args->flags) < 0)
+        goto cleanup;
 
-        for (i = 0; i < nrecords; i++) {
-            remote_domain_stats_record *dst = ret->retStats.retStats_val + i;
+    ret->snaps.snaps_val = g_new0(remote_nonnull_domain_snapshot, ndoms);
+    ret->snaps.snaps_len = ndoms;
 
-            make_nonnull_domain(&dst->dom, retStats[i]->dom);
+    for (i = 0; i < ndoms; i++)
+        make_nonnull_domain_snapshot(ret->snaps.snaps_val + i, snaps[i]);
 
-            if (virTypedParamsSerialize(retStats[i]->params,
-                                        retStats[i]->nparams,
-                                        REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX,
-                                        (struct _virTypedParameterRemote **) &dst->params.params_val,
-                                        &dst->params.params_len,
-                                        VIR_TYPED_PARAM_STRING_OKAY) < 0)
-                goto cleanup;
-        }
-    } else {
-        ret->retStats.retStats_len = 0;
-        ret->retStats.retStats_val = NULL;
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virObjectListFreeCount(snaps, ndoms);
+    virObjectListFreeCount(doms, ndoms);
+
+    return rv;
+}
+
+
+static int
+remoteDispatchConnectStartDomains(virNetServer *server G_GNUC_UNUSED,
+                                  virNetServerClient *client,
+                                  virNetMessage *msg G_GNUC_UNUSED,
+                                  struct virNetMessageError *rerr,
+                                  remote_connect_start_domains_args *args,
+                                  remote_connect_start_domains_ret *ret)
+{
+    int rv = -1;
+    int nsuccess;
+    size_t i;
+    size_t ndoms = args->doms.doms_len;
+    virDomainPtr *doms = NULL;
+    int *results = NULL;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    doms = g_new0(virDomainPtr, ndoms);
+    results = g_new0(int, ndoms);
+
+    for (i = 0; i < ndoms; i++) {
+        if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
+            goto cleanup;
     }
 
+    if ((nsuccess = virConnectStartDomains(conn, doms, ndoms, args->parallel,
+                                           results, args->flags)) < 0)
+        goto cleanup;
+
+    ret->results.results_val = g_steal_pointer(&results);
+    ret->results.results_len = ndoms;
+    ret->ret = nsuccess;
+
     rv = 0;
 
  cleanup:
-    if (rv < 0) {
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    g_free(results);
+    virObjectListFreeCount(doms, ndoms);
+
+    return rv;
+}
+
+
+static int
+remoteDispatchConnectShutdownDomains(virNetServer *server G_GNUC_UNUSED,
+                                     virNetServerClient *client,
+                                     virNetMessage *msg G_GNUC_UNUSED,
+                                     struct virNetMessageError *rerr,
+                                     remote_connect_shutdown_domains_args *args,
+                                     remote_connect_shutdown_domains_ret *ret)
+{
+    int rv = -1;
+    int nsuccess;
+    size_t i;
+    size_t ndoms = args->doms.doms_len;
+    virDomainPtr *doms = NULL;
+    int *results = NULL;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    doms = g_new0(virDomainPtr, ndoms);
+    results = g_new0(int, ndoms);
+
+    for (i = 0; i < ndoms; i++) {
+        if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
+            goto cleanup;
+    }
+
+    if ((nsuccess = virConnectShutdownDomains(conn, doms, ndoms, args->parallel,
+                                              results, args->flags)) < 0)
+        goto cleanup;
+
+    ret->results.results_val = g_steal_pointer(&results);
+    ret->results.results_len = ndoms;
+    ret->ret = nsuccess;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
         virNetMessageSaveError(rerr);
-        xdr_free((xdrproc_t)xdr_remote_connect_get_all_domain_stats_ret,
-                 (char *) ret);
+
+    g_free(results);
+    virObjectListFreeCount(doms, ndoms);
+
+    return rv;
+}
+
+
+static int
+remoteDispatchDomainGetXMLDesc(virNetServer *server G_GNUC_UNUSED,
+                               virNetServerClient *client,
+                               virNetMessage *msg,
+                               struct virNetMessageError *rerr,
+                               remote_domain_get_xml_desc_args *args,
+                               remote_domain_get_xml_desc_ret *ret)
+{
+    virDomainPtr dom = NULL;
+    g_autofree char *xml = NULL;
+    size_t len;
+    int rv = -1;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if (!(dom = get_nonnull_domain(conn, args->dom)))
+        goto cleanup;
+
+    if (!(xml = virDomainGetXMLDesc(dom, args->flags)))
+        goto cleanup;
+
+    len = remoteXDRStringSize(xml);
+
+    if (len > VIR_NET_MESSAGE_MAX - VIR_NET_MESSAGE_HEADER_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("domain XML of %zu bytes exceeds message size limit"),
+                       len);
+        goto cleanup;
     }
 
-    virDomainStatsRecordListFree(retStats);
-    virObjectListFree(doms);
+    /* Large definitions would otherwise be encoded into the reply over
+     * and over again while its buffer grows to fit them */
+    virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_LEN_MAX +
+                               VIR_NET_MESSAGE_HEADER_MAX + len);
+
+    ret->xml = g_steal_pointer(&xml);
+    rv = 0;
 
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virObjectUnref(dom);
     return rv;
 }
 
@@ -7467,3 +8029,92 @@ remoteDispatchDomainGetMessages(virNetServer *server G_GNUC_UNUSED,
 
     return rv;
 }
+
+
+static int
+remoteDispatchConnectMulti(virNetServer *server,
+                           virNetServerClient *client,
+                           virNetMessage *msg,
+                           struct virNetMessageError *rerr,
+                           remote_connect_multi_args *args,
+                           remote_connect_multi_ret *ret)
+{
+    int rv = -1;
+    size_t i;
+    size_t hdrlen = VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX;
+    remote_connect_multi_result *results = NULL;
+    virNetMessage *sub = NULL;
+    unsigned int flags = args->flags;
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (!remoteGetHypervisorConn(client))
+        goto cleanup;
+
+    for (i = 0; i < args->calls.calls_len; i++) {
+        int proc = args->calls.calls_val[i].proc;
+
+        if (proc == REMOTE_PROC_CONNECT_OPEN ||
+            proc == REMOTE_PROC_CONNECT_CLOSE ||
+            proc == REMOTE_PROC_CONNECT_MULTI) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           _("procedure %d cannot be batched"), proc);
+            goto cleanup;
+        }
+    }
+
+    results = g_new0(remote_connect_multi_result, args->calls.calls_len);
+
+    for (i = 0; i < args->calls.calls_len; i++) {
+        remote_connect_multi_call *call = args->calls.calls_val + i;
+        remote_connect_multi_result *res = results + i;
+        size_t len;
+
+        sub = virNetMessageNew(false);
+        sub->header = msg->header;
+        sub->header.proc = call->proc;
+        sub->header.type = VIR_NET_CALL;
+        sub->header.status = VIR_NET_OK;
+
+        virNetMessageReserveBuffer(sub, hdrlen + call->args.args_len);
+        memcpy(sub->buffer + hdrlen, call->args.args_val, call->args.args_len);
+        sub->bufferLength = hdrlen + call->args.args_len;
+        sub->bufferOffset = hdrlen;
+
+        if (virNetServerProgramDispatchInline(remoteProgram, server,
+                                              client, sub) < 0)
+            goto cleanup;
+
+        len = sub->bufferLength - hdrlen;
+        if (len > REMOTE_CONNECT_MULTI_DATA_MAX) {
+            virReportError(VIR_ERR_RPC,
+                           _("reply to batched procedure %d is too large"),
+                           call->proc);
+            goto cleanup;
+        }
+
+        res->status = sub->header.status;
+        res->ret.ret_len = len;
+        res->ret.ret_val = g_new0(char, len);
+        memcpy(res->ret.ret_val, sub->buffer + hdrlen, len);
+
+        g_clear_pointer(&sub, virNetMessageFree);
+    }
+
+    ret->results.results_val = g_steal_pointer(&results);
+    ret->results.results_len = args->calls.calls_len;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0) {
+        virNetMessageSaveError(rerr);
+        if (results) {
+            for (i = 0; i < args->calls.calls_len; i++)
+                g_free(results[i].ret.ret_val);
+            g_free(results);
+        }
+    }
+    virNetMessageFree(sub);
+    return rv;
+}
@@ -37,3 +37,10 @@ extern size_t qemuNProcs;
 void remoteClientFree(void *data);
 void *remoteClientNew(virNetServerClient *client,
                       void *opaque);
+
+#ifdef VIRTPROXYD
+int remoteDispatchForwardCall(virNetServer *server,
+                              virNetServerClient *client,
+                              virNetMessage *msg,
+                              void *opaque);
+#endif /* VIRTPROXYD */
@@ -0,0 +1,747 @@
+/*
+ * remote_daemon_metrics.c: OpenMetrics endpoint of the daemons
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "remote_daemon_metrics.h"
+#include "viralloc.h"
+#include "virbuffer.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virhash.h"
+#include "viridentity.h"
+#include "virlog.h"
+#include "virnetmessage.h"
+#include "virstring.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+VIR_LOG_INIT("daemon.metrics");
+
+/*
+ * The daemon can serve its own and its domains' statistics in the
+ * OpenMetrics text format over HTTP on a UNIX socket. A dedicated thread
+ * answers the scrapes, so a slow scrape never holds up the event loop or
+ * the RPC workers. Domain statistics are gathered over an in-process
+ * connection to the hypervisor driver, which avoids the RPC encoding an
+ * external exporter would pay for every scrape.
+ */
+
+#define DAEMON_METRICS_REQUEST_MAX 8192
+#define DAEMON_METRICS_REQUEST_TIMEOUT (5 * 1000)
+
+typedef struct _daemonMetrics daemonMetrics;
+struct _daemonMetrics {
+    virNetServer *srv;
+    char *path;
+    char *uri;
+    unsigned int cacheTime;
+
+    int listenfd;
+    int wakeupfd[2];
+    virThread thread;
+
+    /* Used only from the metrics thread */
+    virConnectPtr conn;
+    char *cache;
+    unsigned long long cacheExpiry;
+};
+
+static daemonMetrics *metrics;
+
+
+typedef struct _daemonMetricsFamily daemonMetricsFamily;
+struct _daemonMetricsFamily {
+    char *name;
+    const char *type;
+    virBuffer samples;
+};
+
+
+static void
+daemonMetricsFamilyFree(daemonMetricsFamily *family)
+{
+    g_free(family->name);
+    virBufferFreeAndReset(&family->samples);
+    g_free(family);
+}
+
+
+/* OpenMetrics requires all samples of a family to be listed together,
+ * so samples are collected per family first and rendered at the end */
+typedef struct _daemonMetricsOutput daemonMetricsOutput;
+struct _daemonMetricsOutput {
+    GHashTable *families;   /* name -> daemonMetricsFamily, borrowed */
+    GPtrArray *order;       /* owns the families, in order of appearance */
+};
+
+
+static daemonMetricsFamily *
+daemonMetricsGetFamily(daemonMetricsOutput *out,
+                       const char *name,
+                       const char *type)
+{
+    daemonMetricsFamily *family;
+
+    if ((family = g_hash_table_lookup(out->families, name)))
+        return family;
+
+    family = g_new0(daemonMetricsFamily, 1);
+    family->name = g_strdup(name);
+    family->type = type;
+    g_ptr_array_add(out->order, family);
+    g_hash_table_insert(out->families, family->name, family);
+
+    return family;
+}
+
+
+static void
+daemonMetricsEscapeLabel(virBuffer *buf,
+                         const char *value)
+{
+    for (; *value; value++) {
+        switch (*value) {
+        case '\\':
+            virBufferAddLit(buf, "\\\\");
+            break;
+        case '"':
+            virBufferAddLit(buf, "\\\"");
+            break;
+        case '\n':
+            virBufferAddLit(buf, "\\n");
+            break;
+        default:
+            virBufferAddChar(buf, *value);
+        }
+    }
+}
+
+
+/* Metric and label names may only contain [a-zA-Z0-9_] */
+static void
+daemonMetricsAddName(virBuffer *buf,
+                     const char *name)
+{
+    for (; *name; name++) {
+        if (g_ascii_isalnum(*name))
+            virBufferAddChar(buf, *name);
+        else
+            virBufferAddChar(buf, '_');
+    }
+}
+
+
+static bool
+daemonMetricsIsIndex(const char *str)
+{
+    return *str && strspn(str, "0123456789") == strlen(str);
+}
+
+
+static void
+daemonMetricsAddDaemonValue(daemonMetricsOutput *out,
+                            const char *name,
+                            const char *type,
+                            const char *suffix,
+                            const char *labels,
+                            const char *value)
+{
+    daemonMetricsFamily *family = daemonMetricsGetFamily(out, name, type);
+
+    virBufferAsprintf(&family->samples, "%s%s%s %s\n",
+                      name, NULLSTR_EMPTY(suffix), NULLSTR_EMPTY(labels), value);
+}
+
+
+static void
+daemonMetricsAddDaemonULLong(daemonMetricsOutput *out,
+                             const char *name,
+                             const char *type,
+                             unsigned long long value)
+{
+    g_autofree char *str = g_strdup_printf("%llu", value);
+
+    daemonMetricsAddDaemonValue(out, name, type,
+                                STREQ(type, "counter") ? "_total" : NULL,
+                                NULL, str);
+}
+
+
+static void
+daemonMetricsAddDaemonSeconds(daemonMetricsOutput *out,
+                              const char *name,
+                              const char *type,
+                              const char *suffix,
+                              const char *labels,
+                              unsigned long long us)
+{
+    char str[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_ascii_dtostr(str, sizeof(str), us / 1000000.0);
+    daemonMetricsAddDaemonValue(out, name, type, suffix, labels, str);
+}
+
+
+static void
+daemonMetricsCollectDaemon(daemonMetricsOutput *out,
+                           virNetServer *srv)
+{
+    size_t minWorkers;
+    size_t maxWorkers;
+    size_t nWorkers;
+    size_t freeWorkers;
+    size_t nPrioWorkers;
+    size_t jobQueueDepth;
+    size_t maxMutatingWorkers;
+    size_t mutatingJobQueueDepth;
+    unsigned long long poolHits;
+    unsigned long long poolMisses;
+    unsigned long long njobs = 0;
+    g_autofree char *njobsStr = NULL;
+    virThreadPoolStats stats;
+    size_t i;
+
+    ignore_value(virNetServerGetThreadPoolParameters(srv, &minWorkers,
+                                                     &maxWorkers, &nWorkers,
+                                                     &freeWorkers,
+                                                     &nPrioWorkers,
+                                                     &jobQueueDepth,
+                                                     &maxMutatingWorkers,
+                                                     &mutatingJobQueueDepth));
+    virNetServerGetThreadPoolStats(srv, &stats);
+    virNetMessageGetPoolStats(&poolHits, &poolMisses);
+
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_clients", "gauge",
+                                 virNetServerGetCurrentClients(srv));
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_workers", "gauge",
+                                 nWorkers);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_workers_max", "gauge",
+                                 maxWorkers);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_workers_free", "gauge",
+                                 freeWorkers);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_workers_priority", "gauge",
+                                 nPrioWorkers);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_job_queue_depth", "gauge",
+                                 jobQueueDepth);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_mutating_job_queue_depth",
+                                 "gauge", mutatingJobQueueDepth);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_jobs_completed", "counter",
+                                 stats.jobsCompleted);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_jobs_long_running", "gauge",
+                                 stats.longRunningJobs);
+    daemonMetricsAddDaemonSeconds(out, "libvirt_daemon_job_oldest_run_seconds",
+                                  "gauge", NULL, NULL, stats.oldestJobRunTime);
+    daemonMetricsAddDaemonSeconds(out, "libvirt_daemon_job_run_seconds",
+                                  "counter", "_total", NULL, stats.runTime);
+    daemonMetricsAddDaemonSeconds(out, "libvirt_daemon_job_run_max_seconds",
+                                  "gauge", NULL, NULL, stats.runTimeMax);
+    daemonMetricsAddDaemonSeconds(out, "libvirt_daemon_job_wait_max_seconds",
+                                  "gauge", NULL, NULL, stats.waitTimeMax);
+
+    for (i = 0; i < VIR_THREAD_POOL_WAIT_BUCKETS; i++) {
+        g_autofree char *labels = NULL;
+        g_autofree char *count = NULL;
+
+        njobs += stats.waitBucket[i];
+
+        if (stats.waitBucketBound[i] == 0) {
+            labels = g_strdup("{le=\"+Inf\"}");
+        } else {
+            char bound[G_ASCII_DTOSTR_BUF_SIZE];
+
+            g_ascii_dtostr(bound, sizeof(bound),
+                           stats.waitBucketBound[i] / 1000000.0);
+            labels = g_strdup_printf("{le=\"%s\"}", bound);
+        }
+
+        count = g_strdup_printf("%llu", njobs);
+        daemonMetricsAddDaemonValue(out, "libvirt_daemon_job_wait_seconds",
+                                    "histogram", "_bucket", labels, count);
+    }
+
+    njobsStr = g_strdup_printf("%llu", njobs);
+    daemonMetricsAddDaemonValue(out, "libvirt_daemon_job_wait_seconds",
+                                "histogram", "_count", NULL, njobsStr);
+    daemonMetricsAddDaemonSeconds(out, "libvirt_daemon_job_wait_seconds",
+                                  "histogram", "_sum", NULL, stats.waitTime);
+
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_message_pool_hits",
+                                 "counter", poolHits);
+    daemonMetricsAddDaemonULLong(out, "libvirt_daemon_message_pool_misses",
+                                 "counter", poolMisses);
+}
+
+
+/*
+ * Domain statistics are rendered generically. Numeric components of
+ * the field names become labels named after the preceding component,
+ * so that e.g. 'block.1.rd.bytes' turns into
+ *
+ *   libvirt_domain_block_rd_bytes{domain="vm",block="1",block_name="vdb"}
+ *
+ * where the '_name' label comes from the 'block.1.name' field.
+ */
+static void
+daemonMetricsCollectRecord(daemonMetricsOutput *out,
+                           virDomainStatsRecordPtr record)
+{
+    g_autoptr(GHashTable) names = virHashNew(NULL);
+    const char *domname = virDomainGetName(record->dom);
+    size_t i;
+
+    for (i = 0; i < record->nparams; i++) {
+        virTypedParameterPtr param = record->params + i;
+        const char *suffix;
+
+        if (param->type == VIR_TYPED_PARAM_STRING &&
+            (suffix = strrchr(param->field, '.')) &&
+            STREQ(suffix, ".name")) {
+            g_hash_table_insert(names,
+                                g_strndup(param->field, suffix - param->field),
+                                param->value.s);
+        }
+    }
+
+    for (i = 0; i < record->nparams; i++) {
+        virTypedParameterPtr param = record->params + i;
+        g_auto(virBuffer) name = VIR_BUFFER_INITIALIZER;
+        g_auto(virBuffer) labels = VIR_BUFFER_INITIALIZER;
+        g_auto(virBuffer) prefix = VIR_BUFFER_INITIALIZER;
+        g_auto(GStrv) parts = NULL;
+        g_autofree char *value = NULL;
+        daemonMetricsFamily *family;
+        size_t j;
+
+        switch ((virTypedParameterType) param->type) {
+        case VIR_TYPED_PARAM_INT:
+            value = g_strdup_printf("%d", param->value.i);
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            value = g_strdup_printf("%u", param->value.ui);
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            value = g_strdup_printf("%lld", param->value.l);
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            value = g_strdup_printf("%llu", param->value.ul);
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            value = g_new0(char, G_ASCII_DTOSTR_BUF_SIZE);
+            g_ascii_dtostr(value, G_ASCII_DTOSTR_BUF_SIZE, param->value.d);
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            value = g_strdup(param->value.b ? "1" : "0");
+            break;
+        case VIR_TYPED_PARAM_STRING:
+        case VIR_TYPED_PARAM_LAST:
+        default:
+            continue;
+        }
+
+        virBufferAddLit(&name, "libvirt_domain");
+        virBufferAddLit(&labels, "{domain=\"");
+        daemonMetricsEscapeLabel(&labels, domname);
+        virBufferAddChar(&labels, '"');
+
+        parts = g_strsplit(param->field, ".", 0);
+        for (j = 0; parts[j]; j++) {
+            const char *devname;
+
+            if (j > 0)
+                virBufferAddChar(&prefix, '.');
+            virBufferAdd(&prefix, parts[j], -1);
+
+            if (j == 0 || !daemonMetricsIsIndex(parts[j]) ||
+                daemonMetricsIsIndex(parts[j - 1])) {
+                virBufferAddChar(&name, '_');
+                daemonMetricsAddName(&name, parts[j]);
+                continue;
+            }
+
+            virBufferAddChar(&labels, ',');
+            daemonMetricsAddName(&labels, parts[j - 1]);
+            virBufferAsprintf(&labels, "=\"%s\"", parts[j]);
+
+            if ((devname = g_hash_table_lookup(names,
+                                               virBufferCurrentContent(&prefix)))) {
+                virBufferAddChar(&labels, ',');
+                daemonMetricsAddName(&labels, parts[j - 1]);
+                virBufferAddLit(&labels, "_name=\"");
+                daemonMetricsEscapeLabel(&labels, devname);
+                virBufferAddChar(&labels, '"');
+            }
+        }
+        virBufferAddChar(&labels, '}');
+
+        family = daemonMetricsGetFamily(out, virBufferCurrentContent(&name),
+                                        "unknown");
+        virBufferAsprintf(&family->samples, "%s%s %s\n",
+                          family->name, virBufferCurrentContent(&labels),
+                          value);
+    }
+}
+
+
+static int
+daemonMetricsCollectDomains(daemonMetrics *m,
+                            daemonMetricsOutput *out)
+{
+    virDomainStatsRecordPtr *records = NULL;
+    virDomainStatsRecordPtr *next;
+
+    if (m->conn && virConnectIsAlive(m->conn) != 1) {
+        virConnectClose(m->conn);
+        m->conn = NULL;
+    }
+
+    if (!m->conn &&
+        !(m->conn = virConnectOpen(m->uri)))
+        return -1;
+
+    /* Don't wait for domains busy with other jobs, a scrape with some
+     * values missing is better than a scrape timing out */
+    if (virConnectGetAllDomainStats(m->conn, 0, &records,
+                                    VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT) < 0)
+        return -1;
+
+    for (next = records; *next; next++)
+        daemonMetricsCollectRecord(out, *next);
+
+    virDomainStatsRecordListFree(records);
+    return 0;
+}
+
+
+static char *
+daemonMetricsRender(daemonMetrics *m)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    /* The families and their names are owned by @order */
+    g_autoptr(GHashTable) families = g_hash_table_new(g_str_hash, g_str_equal);
+    g_autoptr(GPtrArray) order = g_ptr_array_new_with_free_func((GDestroyNotify) daemonMetricsFamilyFree);
+    daemonMetricsOutput out = { .families = families, .order = order };
+    bool up;
+    size_t i;
+
+    daemonMetricsCollectDaemon(&out, m->srv);
+
+    /* Reported as libvirt_up, e.g. before the drivers are initialized
+     * or in daemons which don't manage domains at all */
+    if (!(up = daemonMetricsCollectDomains(m, &out) == 0))
+        VIR_DEBUG("Unable to collect domain statistics: %s",
+                  virGetLastErrorMessage());
+
+    daemonMetricsAddDaemonValue(&out, "libvirt_up", "gauge", NULL, NULL,
+                                up ? "1" : "0");
+
+    for (i = 0; i < order->len; i++) {
+        daemonMetricsFamily *family = g_ptr_array_index(order, i);
+
+        virBufferAsprintf(&buf, "# TYPE %s %s\n", family->name, family->type);
+        virBufferAddBuffer(&buf, &family->samples);
+    }
+    virBufferAddLit(&buf, "# EOF\n");
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static const char *
+daemonMetricsGet(daemonMetrics *m)
+{
+    unsigned long long now = g_get_monotonic_time();
+
+    if (!m->cache || now >= m->cacheExpiry) {
+        g_free(m->cache);
+        m->cache = daemonMetricsRender(m);
+        m->cacheExpiry = now + m->cacheTime * 1000ULL * 1000ULL;
+    }
+
+    return m->cache;
+}
+
+
+static void
+daemonMetricsReply(int fd,
+                   const char *status,
+                   const char *type,
+                   const char *body)
+{
+    g_autofree char *header = NULL;
+
+    header = g_strdup_printf("HTTP/1.1 %s\r\n"
+                             "Content-Type: %s\r\n"
+                             "Content-Length: %zu\r\n"
+                             "Connection: close\r\n"
+                             "\r\n",
+                             status, type, strlen(body));
+
+    if (safewrite(fd, header, strlen(header)) < 0 ||
+        safewrite(fd, body, strlen(body)) < 0)
+        VIR_DEBUG("Failed to send metrics reply: %s", g_strerror(errno));
+}
+
+
+static void
+daemonMetricsHandleClient(daemonMetrics *m,
+                          int fd)
+{
+    char buf[DAEMON_METRICS_REQUEST_MAX + 1];
+    size_t len = 0;
+    char *path;
+    char *end;
+
+    buf[0] = '\0';
+
+    /* Only the request line matters, but read the whole header so that
+     * the client doesn't get a reset when we close the connection */
+    while (!strstr(buf, "\r\n\r\n")) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        ssize_t got;
+        int rc;
+
+        if (len == DAEMON_METRICS_REQUEST_MAX)
+            return;
+
+        if ((rc = poll(&pfd, 1, DAEMON_METRICS_REQUEST_TIMEOUT)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (rc == 0)
+            return;
+
+        if ((got = read(fd, buf + len, DAEMON_METRICS_REQUEST_MAX - len)) <= 0)
+            return;
+
+        len += got;
+        buf[len] = '\0';
+    }
+
+    if (!STRPREFIX(buf, "GET ")) {
+        daemonMetricsReply(fd, "405 Method Not Allowed", "text/plain",
+                           "Method not allowed\n");
+        return;
+    }
+
+    path = buf + strlen("GET ");
+    if ((end = strpbrk(path, " \r\n")))
+        *end = '\0';
+
+    if (STRNEQ(path, "/metrics") && STRNEQ(path, "/")) {
+        daemonMetricsReply(fd, "404 Not Found", "text/plain", "Not found\n");
+        return;
+    }
+
+    daemonMetricsReply(fd, "200 OK",
+                       "application/openmetrics-text; version=1.0.0; charset=utf-8",
+                       daemonMetricsGet(m));
+}
+
+
+static void
+daemonMetricsThread(void *opaque)
+{
+    daemonMetrics *m = opaque;
+    g_autoptr(virIdentity) sysident = virIdentityGetSystem();
+
+    virIdentitySetCurrent(sysident);
+
+    while (true) {
+        struct pollfd fds[] = {
+            { .fd = m->listenfd, .events = POLLIN },
+            { .fd = m->wakeupfd[0], .events = POLLIN },
+        };
+        VIR_AUTOCLOSE clientfd = -1;
+
+        if (poll(fds, G_N_ELEMENTS(fds), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            VIR_ERROR(_("Failed to poll metrics socket: %s"),
+                      g_strerror(errno));
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        if ((clientfd = accept(m->listenfd, NULL, NULL)) < 0) {
+            VIR_DEBUG("Failed to accept metrics client: %s",
+                      g_strerror(errno));
+            continue;
+        }
+
+        daemonMetricsHandleClient(m, clientfd);
+    }
+
+    if (m->conn) {
+        virConnectClose(m->conn);
+        m->conn = NULL;
+    }
+
+    virIdentitySetCurrent(NULL);
+}
+
+
+static int
+daemonMetricsListen(const char *path,
+                    mode_t mode)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd;
+
+    if (virStrcpyStatic(addr.sun_path, path) < 0) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                       _("metrics socket path '%s' too long"), path);
+        return -1;
+    }
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        virReportSystemError(errno, "%s", _("Failed to create metrics socket"));
+        return -1;
+    }
+
+    if (unlink(path) < 0 && errno != ENOENT) {
+        virReportSystemError(errno, _("Failed to remove '%s'"), path);
+        goto error;
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        virReportSystemError(errno, _("Failed to bind socket to '%s'"), path);
+        goto error;
+    }
+
+    if (chmod(path, mode) < 0) {
+        virReportSystemError(errno, _("Failed to set permissions of '%s'"),
+                             path);
+        goto error;
+    }
+
+    if (listen(fd, 30) < 0) {
+        virReportSystemError(errno, _("Failed to listen on '%s'"), path);
+        goto error;
+    }
+
+    return fd;
+
+ error:
+    VIR_FORCE_CLOSE(fd);
+    return -1;
+}
+
+
+static void
+daemonMetricsFree(daemonMetrics *m)
+{
+    if (!m)
+        return;
+
+    if (m->listenfd >= 0) {
+        VIR_FORCE_CLOSE(m->listenfd);
+        unlink(m->path);
+    }
+    VIR_FORCE_CLOSE(m->wakeupfd[0]);
+    VIR_FORCE_CLOSE(m->wakeupfd[1]);
+    virObjectUnref(m->srv);
+    g_free(m->path);
+    g_free(m->uri);
+    g_free(m->cache);
+    g_free(m);
+}
+
+
+/**
+ * daemonMetricsStart:
+ * @srv: server to report the statistics of
+ * @config: daemon configuration
+ *
+ * Starts serving the metrics on the socket given by the
+ * metrics_unix_sock setting, if any.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+daemonMetricsStart(virNetServer *srv,
+                   struct daemonConfig *config)
+{
+    daemonMetrics *m;
+    int mode;
+
+    if (!config->metrics_unix_sock)
+        return 0;
+
+    if (virStrToLong_i(config->metrics_unix_sock_perms, NULL, 8, &mode) < 0) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                       _("Failed to parse mode '%s'"),
+                       config->metrics_unix_sock_perms);
+        return -1;
+    }
+
+    m = g_new0(daemonMetrics, 1);
+    m->srv = virObjectRef(srv);
+    m->path = g_strdup(config->metrics_unix_sock);
+    m->uri = g_strdup(config->metrics_uri);
+    m->cacheTime = config->metrics_cache_time;
+    m->listenfd = -1;
+    m->wakeupfd[0] = m->wakeupfd[1] = -1;
+
+    if ((m->listenfd = daemonMetricsListen(m->path, mode)) < 0)
+        goto error;
+
+    if (virPipe(m->wakeupfd) < 0)
+        goto error;
+
+    if (virThreadCreateFull(&m->thread, true, daemonMetricsThread,
+                            "daemon-metrics", false, m) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Failed to create metrics thread"));
+        goto error;
+    }
+
+    metrics = m;
+    return 0;
+
+ error:
+    daemonMetricsFree(m);
+    return -1;
+}
+
+
+void
+daemonMetricsStop(void)
+{
+    char c = 0;
+
+    if (!metrics)
+        return;
+
+    ignore_value(safewrite(metrics->wakeupfd[1], &c, 1));
+    virThreadJoin(&metrics->thread);
+
+    g_clear_pointer(&metrics, daemonMetricsFree);
+}
@@ -0,0 +1,26 @@
+/*
+ * remote_daemon_metrics.h: OpenMetrics endpoint of the daemons
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "virnetserver.h"
+#include "remote_daemon_config.h"
+
+int daemonMetricsStart(virNetServer *srv,
+                       struct daemonConfig *config);
+void daemonMetricsStop(void);
@@ -852,8 +852,6 @@ daemonStreamHandleRead(virNetServerClient *client,
 
     memset(&rerr, 0, sizeof(rerr));
 
-    buffer = g_new0(char, bufferLen);
-
     if (!(msg = virNetMessageNew(false)))
         goto cleanup;
 
@@ -909,6 +907,14 @@ daemonStreamHandleRead(virNetServerClient *client,
         bufferLen > stream->dataLen)
         bufferLen = stream->dataLen;
 
+    /* Receive the data straight into the message buffer to save a copy */
+    if (!(buffer = virNetServerProgramPrepareStreamData(stream->prog,
+                                                        msg,
+                                                        stream->procedure,
+                                                        stream->serial,
+                                                        bufferLen)))
+        goto cleanup;
+
     rv = virStreamRecv(stream->st, buffer, bufferLen);
     if (rv == -2) {
         /* Should never get this, since we're only called when we know
@@ -933,12 +939,7 @@ daemonStreamHandleRead(virNetServerClient *client,
         msg->cb = daemonStreamMessageFinished;
         msg->opaque = stream;
         stream->refs++;
-        if (virNetServerProgramSendStreamData(stream->prog,
-                                              client,
-                                              msg,
-                                              stream->procedure,
-                                              stream->serial,
-                                              buffer, rv) < 0)
+        if (virNetServerProgramSendPreparedStreamData(client, msg, rv) < 0)
             goto cleanup;
         msg = NULL;
     }
@@ -946,7 +947,6 @@ daemonStreamHandleRead(virNetServerClient *client,
  done:
     ret = 0;
  cleanup:
-    VIR_FREE(buffer);
     virNetMessageFree(msg);
     return ret;
 }
@@ -127,6 +127,7 @@ static int callFull(virConnectPtr conn, struct private_data *priv,
                     int proc_nr,
                     xdrproc_t args_filter, char *args,
                     xdrproc_t ret_filter, char *ret);
+static virHypervisorDriver hypervisor_driver;
 static int remoteAuthenticate(virConnectPtr conn, struct private_data *priv,
                               virConnectAuthPtr auth, const char *authtype);
 #if WITH_SASL
@@ -413,6 +414,11 @@ static void
 remoteDomainBuildEventMemoryDeviceSizeChange(virNetClientProgram *prog,
                                              virNetClient *client,
                                              void *evdata, void *opaque);
+
+static void
+remoteDomainBuildEventCallbackStats(virNetClientProgram *prog,
+                                    virNetClient *client,
+                                    void *evdata, void *opaque);
 static void
 remoteConnectNotifyEventConnectionClosed(virNetClientProgram *prog G_GNUC_UNUSED,
                                          virNetClient *client G_GNUC_UNUSED,
@@ -632,6 +638,10 @@ static virNetClientProgramEvent remoteEvents[] = {
       remoteDomainBuildEventMemoryDeviceSizeChange,
       sizeof(remote_domain_event_memory_device_size_change_msg),
       (xdrproc_t)xdr_remote_domain_event_memory_device_size_change_msg },
+    { REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS,
+      remoteDomainBuildEventCallbackStats,
+      sizeof(remote_domain_event_callback_stats_msg),
+      (xdrproc_t)xdr_remote_domain_event_callback_stats_msg },
 };
 
 static void
@@ -753,6 +763,7 @@ doRemoteOpen(virConnectPtr conn,
     g_autofree char *mode_str = NULL;
     g_autofree char *daemon_path = NULL;
     g_autofree char *proxy_str = NULL;
+    g_autofree char *compress_str = NULL;
     bool sanity = true;
     bool verify = true;
 #ifndef WIN32
@@ -761,6 +772,7 @@ doRemoteOpen(virConnectPtr conn,
     int mode;
     size_t i;
     int proxy;
+    int compress;
 
     /* We handle *ALL* URIs here. The caller has rejected any
      * URIs we don't care about */
@@ -800,6 +812,7 @@ doRemoteOpen(virConnectPtr conn,
             EXTRACT_URI_ARG_STR("tls_priority", tls_priority);
             EXTRACT_URI_ARG_STR("mode", mode_str);
             EXTRACT_URI_ARG_STR("proxy", proxy_str);
+            EXTRACT_URI_ARG_STR("compress", compress_str);
             EXTRACT_URI_ARG_BOOL("no_sanity", sanity);
             EXTRACT_URI_ARG_BOOL("no_verify", verify);
 #ifndef WIN32
@@ -905,6 +918,19 @@ doRemoteOpen(virConnectPtr conn,
             proxy = VIR_NET_CLIENT_PROXY_AUTO;
     }
 
+    if (compress_str) {
+        if (virStrToLong_i(compress_str, NULL, 10, &compress) < 0) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("Failed to parse value of URI component %s"),
+                           "compress");
+            goto failed;
+        }
+    } else {
+        /* Only worth it when talking across the network */
+        compress = transport == REMOTE_DRIVER_TRANSPORT_TCP ||
+                   transport == REMOTE_DRIVER_TRANSPORT_TLS;
+    }
+
     /* Sanity check that nothing requested !direct mode by mistake */
     if (inside_daemon && !conn->uri->server && mode != REMOTE_DRIVER_MODE_DIRECT) {
         virReportError(VIR_ERR_INVALID_ARG, "%s",
@@ -1186,6 +1212,16 @@ doRemoteOpen(virConnectPtr conn,
                  "by the remote side.");
     }
 
+    if (compress && virNetMessageCompressionSupported()) {
+        if (remoteConnectSupportsFeatureUnlocked(conn, priv,
+                                                 VIR_DRV_FEATURE_REMOTE_COMPRESSION)) {
+            virNetClientSetCompression(priv->client,
+                                       VIR_NET_MESSAGE_COMPRESS_THRESHOLD);
+        } else {
+            VIR_INFO("Message compression is not supported by the server");
+        }
+    }
+
     return VIR_DRV_OPEN_SUCCESS;
 
  failed:
@@ -5473,6 +5509,38 @@ remoteDomainBuildEventMemoryDeviceSizeChange(virNetClientProgram *prog G_GNUC_UN
 }
 
 
+static void
+remoteDomainBuildEventCallbackStats(virNetClientProgram *prog G_GNUC_UNUSED,
+                                    virNetClient *client G_GNUC_UNUSED,
+                                    void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_stats_msg *msg = evdata;
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    virObjectEvent *event = NULL;
+
+    if (virTypedParamsDeserialize((struct _virTypedParameterRemote *) msg->params.params_val,
+                                  msg->params.params_len,
+                                  REMOTE_DOMAIN_EVENT_STATS_MAX,
+                                  &params, &nparams) < 0)
+        return;
+
+    if (!(dom = get_nonnull_domain(conn, msg->dom))) {
+        virTypedParamsFree(params, nparams);
+        return;
+    }
+
+    event = virDomainEventStatsNewFromDom(dom, params, nparams);
+
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, msg->callbackID);
+}
+
+
 static int
 remoteStreamSend(virStreamPtr st,
                  const char *data,
@@ -5501,6 +5569,33 @@ remoteStreamSend(virStreamPtr st,
 }
 
 
+static int
+remoteStreamSendFromFD(virStreamPtr st,
+                       int fd,
+                       size_t nbytes)
+{
+    struct private_data *priv = st->conn->privateData;
+    virNetClientStream *privst = st->privateData;
+    int rv;
+
+    VIR_DEBUG("st=%p fd=%d nbytes=%zu", st, fd, nbytes);
+
+    remoteDriverLock(priv);
+    priv->localUses++;
+    remoteDriverUnlock(priv);
+
+    rv = virNetClientStreamSendPacketFromFD(privst,
+                                            priv->client,
+                                            fd,
+                                            nbytes);
+
+    remoteDriverLock(priv);
+    priv->localUses--;
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
 static int
 remoteStreamRecvFlags(virStreamPtr st,
                       char *data,
@@ -5743,6 +5838,7 @@ static virStreamDriver remoteStreamDrv = {
     .streamRecv = remoteStreamRecv,
     .streamRecvFlags = remoteStreamRecvFlags,
     .streamSend = remoteStreamSend,
+    .streamSendFromFD = remoteStreamSendFromFD,
     .streamSendHole = remoteStreamSendHole,
     .streamRecvHole = remoteStreamRecvHole,
     .streamFinish = remoteStreamFinish,
@@ -6563,6 +6659,57 @@ call(virConnectPtr conn,
 }
 
 
+/**
+ * remoteConnectForwardMessage:
+ * @conn: the connection
+ * @msg: a complete call of the remote program
+ *
+ * Passes the call in @msg on to the daemon @conn is connected to
+ * without decoding its arguments, and replaces it with the reply of
+ * the daemon, again without decoding it. This lets a daemon proxying
+ * calls to another one skip the round trip through the public API.
+ *
+ * Returns 1 if @msg holds the reply, 0 if @conn isn't handled by the
+ * remote driver, -1 on error.
+ */
+int
+remoteConnectForwardMessage(virConnectPtr conn,
+                            virNetMessage *msg)
+{
+    struct private_data *priv = conn->privateData;
+    virNetClient *client;
+    int counter;
+    int rv = -1;
+
+    if (conn->driver != &hypervisor_driver)
+        return 0;
+
+    remoteDriverLock(priv);
+
+    if (!priv->client) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("remote connection is closed"));
+        goto cleanup;
+    }
+
+    client = priv->client;
+    counter = priv->counter++;
+    priv->localUses++;
+
+    remoteDriverUnlock(priv);
+    rv = virNetClientProgramForward(priv->remoteProgram, client, counter, msg);
+    remoteDriverLock(priv);
+    priv->localUses--;
+
+    if (rv == 0)
+        rv = 1;
+
+ cleanup:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
 static int
 remoteDomainGetInterfaceParameters(virDomainPtr domain,
                                    const char *device,
@@ -7573,6 +7720,203 @@ remoteConnectGetAllDomainStats(virConnectPtr conn,
 }
 
 
+static int
+remoteDomainSnapshotCreateXMLGroup(virConnectPtr conn,
+                                   virDomainPtr *domains,
+                                   unsigned int ndomains,
+                                   const char **xmlDescs,
+                                   virDomainSnapshotPtr *snapshots,
+                                   unsigned int flags)
+{
+    struct private_data *priv = conn->privateData;
+    int rv = -1;
+    size_t i;
+    remote_domain_snapshot_create_xml_group_args args;
+    remote_domain_snapshot_create_xml_group_ret ret;
+    virDomainSnapshotPtr *tmpsnaps = NULL;
+
+    if (ndomains > REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many domains '%u' for limit '%d'"),
+                       ndomains, REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX);
+        return -1;
+    }
+
+    memset(&args, 0, sizeof(args));
+
+    args.doms.doms_val = g_new0(remote_nonnull_domain, ndomains);
+    for (i = 0; i < ndomains; i++)
+        make_nonnull_domain(args.doms.doms_val + i, domains[i]);
+    args.doms.doms_len = ndomains;
+
+    args.xml_descs.xml_descs_val = (char **) xmlDescs;
+    args.xml_descs.xml_descs_len = ndomains;
+
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+
+    remoteDriverLock(priv);
+    if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_SNAPSHOT_CREATE_XML_GROUP,
+             (xdrproc_t)xdr_remote_domain_snapshot_create_xml_group_args, (char *)&args,
+             (xdrproc_t)xdr_remote_domain_snapshot_create_xml_group_ret, (char *)&ret) == -1) {
+        remoteDriverUnlock(priv);
+        goto cleanup;
+    }
+    remoteDriverUnlock(priv);
+
+    if (ret.snaps.snaps_len != ndomains) {
+        virReportError(VIR_ERR_RPC,
+                       _("got %u snapshots for %u domains"),
+                       ret.snaps.snaps_len, ndomains);
+        goto cleanup;
+    }
+
+    tmpsnaps = g_new0(virDomainSnapshotPtr, ndomains);
+
+    for (i = 0; i < ndomains; i++) {
+        if (!(tmpsnaps[i] = get_nonnull_domain_snapshot(domains[i],
+                                                        ret.snaps.snaps_val[i])))
+            goto cleanup;
+    }
+
+    if (snapshots) {
+        for (i = 0; i < ndomains; i++)
+            snapshots[i] = g_steal_pointer(&tmpsnaps[i]);
+    }
+
+    rv = 0;
+
+ cleanup:
+    virObjectListFreeCount(tmpsnaps, ndomains);
+    VIR_FREE(args.doms.doms_val);
+    xdr_free((xdrproc_t)xdr_remote_domain_snapshot_create_xml_group_ret,
+             (char *) &ret);
+
+    return rv;
+}
+
+
+static int
+remoteConnectStartDomains(virConnectPtr conn,
+                          virDomainPtr *domains,
+                          unsigned int ndomains,
+                          unsigned int parallel,
+                          int *results,
+                          unsigned int flags)
+{
+    struct private_data *priv = conn->privateData;
+    int rv = -1;
+    size_t i;
+    remote_connect_start_domains_args args;
+    remote_connect_start_domains_ret ret;
+
+    if (ndomains > REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many domains '%u' for limit '%d'"),
+                       ndomains, REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX);
+        return -1;
+    }
+
+    memset(&args, 0, sizeof(args));
+
+    args.doms.doms_val = g_new0(remote_nonnull_domain, ndomains);
+    for (i = 0; i < ndomains; i++)
+        make_nonnull_domain(args.doms.doms_val + i, domains[i]);
+    args.doms.doms_len = ndomains;
+    args.parallel = parallel;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+
+    remoteDriverLock(priv);
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_START_DOMAINS,
+             (xdrproc_t)xdr_remote_connect_start_domains_args, (char *)&args,
+             (xdrproc_t)xdr_remote_connect_start_domains_ret, (char *)&ret) == -1) {
+        remoteDriverUnlock(priv);
+        goto cleanup;
+    }
+    remoteDriverUnlock(priv);
+
+    if (ret.results.results_len != ndomains) {
+        virReportError(VIR_ERR_RPC,
+                       _("got %u results for %u domains"),
+                       ret.results.results_len, ndomains);
+        goto cleanup;
+    }
+
+    if (results)
+        memcpy(results, ret.results.results_val, sizeof(*results) * ndomains);
+    rv = ret.ret;
+
+ cleanup:
+    VIR_FREE(args.doms.doms_val);
+    xdr_free((xdrproc_t)xdr_remote_connect_start_domains_ret, (char *) &ret);
+
+    return rv;
+}
+
+
+static int
+remoteConnectShutdownDomains(virConnectPtr conn,
+                             virDomainPtr *domains,
+                             unsigned int ndomains,
+                             unsigned int parallel,
+                             int *results,
+                             unsigned int flags)
+{
+    struct private_data *priv = conn->privateData;
+    int rv = -1;
+    size_t i;
+    remote_connect_shutdown_domains_args args;
+    remote_connect_shutdown_domains_ret ret;
+
+    if (ndomains > REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many domains '%u' for limit '%d'"),
+                       ndomains, REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX);
+        return -1;
+    }
+
+    memset(&args, 0, sizeof(args));
+
+    args.doms.doms_val = g_new0(remote_nonnull_domain, ndomains);
+    for (i = 0; i < ndomains; i++)
+        make_nonnull_domain(args.doms.doms_val + i, domains[i]);
+    args.doms.doms_len = ndomains;
+    args.parallel = parallel;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+
+    remoteDriverLock(priv);
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_SHUTDOWN_DOMAINS,
+             (xdrproc_t)xdr_remote_connect_shutdown_domains_args, (char *)&args,
+             (xdrproc_t)xdr_remote_connect_shutdown_domains_ret, (char *)&ret) == -1) {
+        remoteDriverUnlock(priv);
+        goto cleanup;
+    }
+    remoteDriverUnlock(priv);
+
+    if (ret.results.results_len != ndomains) {
+        virReportError(VIR_ERR_RPC,
+                       _("got %u results for %u domains"),
+                       ret.results.results_len, ndomains);
+        goto cleanup;
+    }
+
+    if (results)
+        memcpy(results, ret.results.results_val, sizeof(*results) * ndomains);
+    rv = ret.ret;
+
+ cleanup:
+    VIR_FREE(args.doms.doms_val);
+    xdr_free((xdrproc_t)xdr_remote_connect_shutdown_domains_ret, (char *) &ret);
+
+    return rv;
+}
+
+
 static int
 remoteNodeAllocPages(virConnectPtr conn,
                      unsigned int npages,
@@ -8139,6 +8483,207 @@ remoteDomainGetMessages(virDomainPtr domain,
     return rv;
 }
 
+static int
+remoteDomainBatchEncodeCall(virDomainBatchCall *bcall,
+                            remote_connect_multi_call *dst,
+                            char *scratch)
+{
+    XDR xdr;
+    xdrproc_t filter = NULL;
+    union {
+        remote_domain_get_info_args info;
+        remote_domain_get_state_args state;
+        remote_domain_get_block_info_args blockInfo;
+    } args;
+    int rv = -1;
+
+    memset(&args, 0, sizeof(args));
+
+    switch (bcall->type) {
+    case VIR_DOMAIN_BATCH_CALL_GET_INFO:
+        dst->proc = REMOTE_PROC_DOMAIN_GET_INFO;
+        filter = (xdrproc_t) xdr_remote_domain_get_info_args;
+        make_nonnull_domain(&args.info.dom, bcall->domain);
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_STATE:
+        dst->proc = REMOTE_PROC_DOMAIN_GET_STATE;
+        filter = (xdrproc_t) xdr_remote_domain_get_state_args;
+        make_nonnull_domain(&args.state.dom, bcall->domain);
+        args.state.flags = bcall->flags;
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO:
+        dst->proc = REMOTE_PROC_DOMAIN_GET_BLOCK_INFO;
+        filter = (xdrproc_t) xdr_remote_domain_get_block_info_args;
+        make_nonnull_domain(&args.blockInfo.dom, bcall->domain);
+        args.blockInfo.path = bcall->disk;
+        args.blockInfo.flags = bcall->flags;
+        break;
+    }
+
+    xdrmem_create(&xdr, scratch, REMOTE_CONNECT_MULTI_DATA_MAX, XDR_ENCODE);
+
+    if (!filter(&xdr, &args, 0)) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to encode arguments of batched call"));
+        goto cleanup;
+    }
+
+    dst->args.args_len = xdr_getpos(&xdr);
+    dst->args.args_val = g_new0(char, dst->args.args_len);
+    memcpy(dst->args.args_val, scratch, dst->args.args_len);
+
+    rv = 0;
+
+ cleanup:
+    xdr_destroy(&xdr);
+    return rv;
+}
+
+
+static void
+remoteDomainBatchDecodeResult(virDomainBatchCall *bcall,
+                              remote_connect_multi_result *res)
+{
+    XDR xdr;
+    xdrproc_t filter = NULL;
+    union {
+        remote_domain_get_info_ret info;
+        remote_domain_get_state_ret state;
+        remote_domain_get_block_info_ret blockInfo;
+    } ret;
+
+    memset(&ret, 0, sizeof(ret));
+    xdrmem_create(&xdr, res->ret.ret_val, res->ret.ret_len, XDR_DECODE);
+
+    if (res->status != VIR_NET_OK) {
+        virNetMessageError err;
+
+        memset(&err, 0, sizeof(err));
+        if (!xdr_virNetMessageError(&xdr, &err)) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("Unable to decode error of batched call"));
+        } else {
+            virNetClientProgramRaiseError(&err);
+            xdr_free((xdrproc_t) xdr_virNetMessageError, (char *) &err);
+        }
+        goto error;
+    }
+
+    switch (bcall->type) {
+    case VIR_DOMAIN_BATCH_CALL_GET_INFO:
+        filter = (xdrproc_t) xdr_remote_domain_get_info_ret;
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_STATE:
+        filter = (xdrproc_t) xdr_remote_domain_get_state_ret;
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO:
+        filter = (xdrproc_t) xdr_remote_domain_get_block_info_ret;
+        break;
+    }
+
+    if (!filter(&xdr, &ret, 0)) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decode result of batched call"));
+        goto error;
+    }
+
+    switch (bcall->type) {
+    case VIR_DOMAIN_BATCH_CALL_GET_INFO:
+        bcall->info->state = ret.info.state;
+        bcall->info->maxMem = ret.info.maxMem;
+        bcall->info->memory = ret.info.memory;
+        bcall->info->nrVirtCpu = ret.info.nrVirtCpu;
+        bcall->info->cpuTime = ret.info.cpuTime;
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_STATE:
+        *bcall->state = ret.state.state;
+        if (bcall->reason)
+            *bcall->reason = ret.state.reason;
+        break;
+    case VIR_DOMAIN_BATCH_CALL_GET_BLOCK_INFO:
+        bcall->blockInfo->allocation = ret.blockInfo.allocation;
+        bcall->blockInfo->capacity = ret.blockInfo.capacity;
+        bcall->blockInfo->physical = ret.blockInfo.physical;
+        break;
+    }
+
+    xdr_destroy(&xdr);
+    return;
+
+ error:
+    bcall->error = virSaveLastError();
+    virResetLastError();
+    xdr_destroy(&xdr);
+}
+
+
+static int
+remoteDomainBatchRun(virConnectPtr conn,
+                     virDomainBatchCall *calls,
+                     size_t ncalls,
+                     unsigned int flags)
+{
+    int rv = -1;
+    size_t i;
+    size_t j;
+    size_t n;
+    struct private_data *priv = conn->privateData;
+    g_autofree char *scratch = g_new0(char, REMOTE_CONNECT_MULTI_DATA_MAX);
+    remote_connect_multi_args args;
+    remote_connect_multi_ret ret;
+
+    remoteDriverLock(priv);
+
+    memset(&args, 0, sizeof(args));
+    memset(&ret, 0, sizeof(ret));
+
+    /* Batches larger than what fits into a single message are split */
+    for (i = 0; i < ncalls; i += n) {
+        n = MIN(ncalls - i, REMOTE_CONNECT_MULTI_CALLS_MAX);
+
+        args.calls.calls_val = g_new0(remote_connect_multi_call, n);
+        args.calls.calls_len = n;
+        args.flags = flags;
+
+        for (j = 0; j < n; j++) {
+            if (remoteDomainBatchEncodeCall(&calls[i + j],
+                                            &args.calls.calls_val[j],
+                                            scratch) < 0)
+                goto cleanup;
+        }
+
+        if (call(conn, priv, 0, REMOTE_PROC_CONNECT_MULTI,
+                 (xdrproc_t) xdr_remote_connect_multi_args, (char *)&args,
+                 (xdrproc_t) xdr_remote_connect_multi_ret, (char *)&ret) == -1)
+            goto cleanup;
+
+        if (ret.results.results_len != n) {
+            virReportError(VIR_ERR_RPC, "%s",
+                           _("remoteDomainBatchRun: returned number of "
+                             "results does not match number of calls"));
+            goto cleanup;
+        }
+
+        for (j = 0; j < n; j++)
+            remoteDomainBatchDecodeResult(&calls[i + j],
+                                          &ret.results.results_val[j]);
+
+        xdr_free((xdrproc_t) xdr_remote_connect_multi_args, (char *) &args);
+        xdr_free((xdrproc_t) xdr_remote_connect_multi_ret, (char *) &ret);
+        memset(&args, 0, sizeof(args));
+        memset(&ret, 0, sizeof(ret));
+    }
+
+    rv = 0;
+
+ cleanup:
+    xdr_free((xdrproc_t) xdr_remote_connect_multi_args, (char *) &args);
+    xdr_free((xdrproc_t) xdr_remote_connect_multi_ret, (char *) &ret);
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
 /* get_nonnull_domain and get_nonnull_network turn an on-wire
  * (name, uuid) pair into virDomainPtr or virNetworkPtr object.
  * These can return NULL if underlying memory allocations fail,
@@ -8574,6 +9119,13 @@ static virHypervisorDriver hypervisor_driver = {
     .domainAuthorizedSSHKeysSet = remoteDomainAuthorizedSSHKeysSet, /* 6.10.0 */
     .domainGetMessages = remoteDomainGetMessages, /* 7.1.0 */
     .domainStartDirtyRateCalc = remoteDomainStartDirtyRateCalc, /* 7.2.0 */
+    .domainBatchRun = remoteDomainBatchRun, /* 7.10.0 */
+    .connectDomainStatsSubscribe = remoteConnectDomainStatsSubscribe, /* 7.10.0 */
+    .domainSnapshotCreateXMLGroup = remoteDomainSnapshotCreateXMLGroup, /* 7.10.0 */
+    .domainAttachDevices = remoteDomainAttachDevices, /* 7.10.0 */
+    .domainDetachDevices = remoteDomainDetachDevices, /* 7.10.0 */
+    .connectStartDomains = remoteConnectStartDomains, /* 7.10.0 */
+    .connectShutdownDomains = remoteConnectShutdownDomains, /* 7.10.0 */
 };
 
 static virNetworkDriver network_driver = {
@@ -26,6 +26,10 @@
 
 int remoteRegister (void);
 
+struct _virNetMessage;
+int remoteConnectForwardMessage(virConnectPtr conn,
+                                struct _virNetMessage *msg);
+
 unsigned long remoteVersion(void);
 
 #define LIBVIRTD_LISTEN_ADDR NULL
@@ -286,6 +286,24 @@ const REMOTE_DOMAIN_AUTHORIZED_SSH_KEYS_MAX = 2048;
 /* Upper limit on number of messages */
 const REMOTE_DOMAIN_MESSAGES_MAX = 2048;
 
+/* Upper limit on number of calls in a single batch */
+const REMOTE_CONNECT_MULTI_CALLS_MAX = 512;
+
+/* Upper limit on size of encoded arguments and results of batched calls */
+const REMOTE_CONNECT_MULTI_DATA_MAX = 65536;
+
+/* Upper limit on number of parameters in a single stats event */
+const REMOTE_DOMAIN_EVENT_STATS_MAX = 65536;
+
+/* Upper limit on number of domains in a group snapshot */
+const REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX = 256;
+
+/* Upper limit on number of devices attached or detached at once */
+const REMOTE_DOMAIN_DEVICES_MAX = 256;
+
+/* Upper limit on number of domains started or shut down at once */
+const REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX = 4096;
+
 
 /* UUID.  VIR_UUID_BUFLEN definition comes from libvirt.h */
 typedef opaque remote_uuid[VIR_UUID_BUFLEN];
@@ -3900,6 +3918,81 @@ struct remote_domain_event_memory_device_size_change_msg {
     unsigned hyper size;
 };
 
+struct remote_connect_multi_call {
+    int proc;
+    opaque args<REMOTE_CONNECT_MULTI_DATA_MAX>; /* encoded remote_XXX_args */
+};
+
+struct remote_connect_multi_args {
+    remote_connect_multi_call calls<REMOTE_CONNECT_MULTI_CALLS_MAX>;
+    unsigned int flags;
+};
+
+struct remote_connect_multi_result {
+    int status; /* VIR_NET_OK or VIR_NET_ERROR */
+    opaque ret<REMOTE_CONNECT_MULTI_DATA_MAX>; /* encoded remote_XXX_ret or remote_error */
+};
+
+struct remote_connect_multi_ret {
+    remote_connect_multi_result results<REMOTE_CONNECT_MULTI_CALLS_MAX>;
+};
+
+struct remote_connect_domain_stats_subscribe_args {
+    unsigned int stats;
+    unsigned int interval;
+    unsigned int flags;
+};
+
+struct remote_domain_event_callback_stats_msg {
+    int callbackID;
+    remote_nonnull_domain dom;
+    remote_typed_param params<REMOTE_DOMAIN_EVENT_STATS_MAX>;
+};
+
+struct remote_domain_snapshot_create_xml_group_args {
+    remote_nonnull_domain doms<REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX>;
+    remote_nonnull_string xml_descs<REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX>;
+    unsigned int flags;
+};
+
+struct remote_domain_snapshot_create_xml_group_ret {
+    remote_nonnull_domain_snapshot snaps<REMOTE_DOMAIN_SNAPSHOT_GROUP_MAX>;
+};
+
+struct remote_domain_attach_devices_args {
+    remote_nonnull_domain dom;
+    remote_nonnull_string xmls<REMOTE_DOMAIN_DEVICES_MAX>; /* (const char **) */
+    unsigned int flags;
+};
+
+struct remote_domain_detach_devices_args {
+    remote_nonnull_domain dom;
+    remote_nonnull_string xmls<REMOTE_DOMAIN_DEVICES_MAX>; /* (const char **) */
+    unsigned int flags;
+};
+
+struct remote_connect_start_domains_args {
+    remote_nonnull_domain doms<REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX>;
+    unsigned int parallel;
+    unsigned int flags;
+};
+
+struct remote_connect_start_domains_ret {
+    int results<REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX>;
+    int ret;
+};
+
+struct remote_connect_shutdown_domains_args {
+    remote_nonnull_domain doms<REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX>;
+    unsigned int parallel;
+    unsigned int flags;
+};
+
+struct remote_connect_shutdown_domains_ret {
+    int results<REMOTE_CONNECT_LIFECYCLE_DOMAINS_MAX>;
+    int ret;
+};
+
 /*----- Protocol. -----*/
 
 /* Define the program number, protocol version and procedure numbers here. */
@@ -3932,6 +4025,14 @@ enum remote_procedure {
      *   priority. If in doubt, it's safe to choose low. Low is taken as default,
      *   and thus can be left out.
      *
+     * - @serverret: <type>
+     *
+     *   Lets the daemon encode the reply from a structure of its own
+     *   instead of the ret struct, which avoids copying large replies.
+     *   The daemon must provide xdr_<type> producing the same wire format
+     *   as the ret struct. Only valid together with hand written server
+     *   code.
+     *
      * - @acl: <object>:<permission>
      * - @acl: <object>:<permission>:<flagname>
      * - @acl: <object>:<permission>::<param>:<value>
@@ -4044,7 +4145,7 @@ enum remote_procedure {
     REMOTE_PROC_DOMAIN_DETACH_DEVICE = 13,
 
     /**
-     * @generate: both
+     * @generate: client
      * @acl: domain:read
      * @acl: domain:read_secure:VIR_DOMAIN_XML_SECURE
      * @acl: domain:read_secure:VIR_DOMAIN_XML_MIGRATABLE
@@ -6280,6 +6381,7 @@ enum remote_procedure {
 
     /**
      * @generate: none
+     * @serverret: remote_connect_get_all_domain_stats_direct_ret
      * @acl: connect:search_domains
      * @aclfilter: domain:read
      */
@@ -6905,5 +7007,59 @@ enum remote_procedure {
      * @generate: both
      * @acl: none
      */
-    REMOTE_PROC_DOMAIN_EVENT_MEMORY_DEVICE_SIZE_CHANGE = 438
+    REMOTE_PROC_DOMAIN_EVENT_MEMORY_DEVICE_SIZE_CHANGE = 438,
+
+    /**
+     * @generate: none
+     * @acl: none
+     */
+    REMOTE_PROC_CONNECT_MULTI = 439,
+
+    /**
+     * @generate: both
+     * @acl: connect:search_domains
+     */
+    REMOTE_PROC_CONNECT_DOMAIN_STATS_SUBSCRIBE = 440,
+
+    /**
+     * @generate: both
+     * @acl: none
+     */
+    REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS = 441,
+
+    /**
+     * @generate: none
+     * @acl: domain:snapshot
+     * @acl: domain:fs_freeze:VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE
+     */
+    REMOTE_PROC_DOMAIN_SNAPSHOT_CREATE_XML_GROUP = 442,
+
+    /**
+     * @generate: both
+     * @acl: domain:write
+     * @acl: domain:save:!VIR_DOMAIN_AFFECT_CONFIG|VIR_DOMAIN_AFFECT_LIVE
+     * @acl: domain:save:VIR_DOMAIN_AFFECT_CONFIG
+     */
+    REMOTE_PROC_DOMAIN_ATTACH_DEVICES = 443,
+
+    /**
+     * @generate: both
+     * @acl: domain:write
+     * @acl: domain:save:!VIR_DOMAIN_AFFECT_CONFIG|VIR_DOMAIN_AFFECT_LIVE
+     * @acl: domain:save:VIR_DOMAIN_AFFECT_CONFIG
+     */
+    REMOTE_PROC_DOMAIN_DETACH_DEVICES = 444,
+
+    /**
+     * @generate: none
+     * @acl: domain:start
+     */
+    REMOTE_PROC_CONNECT_START_DOMAINS = 445,
+
+    /**
+     * @generate: none
+     * @acl: domain:init_control
+     * @acl: domain:write:VIR_DOMAIN_SHUTDOWN_GUEST_AGENT
+     */
+    REMOTE_PROC_CONNECT_SHUTDOWN_DOMAINS = 446
 };
@@ -362,6 +362,15 @@ while (<PROTOCOL>) {
         $calls{$name}->{acl} = $opts{acl};
         $calls{$name}->{aclfilter} = $opts{aclfilter};
 
+        # the daemon may encode the reply from a structure of its own,
+        # as long as it provides a matching xdr_ function producing the
+        # same wire format as the ret struct
+        if (exists $opts{serverret}) {
+            die "\@serverret requires hand written server code for $constname"
+                if $opts{generate} eq "both" || $opts{generate} eq "server";
+            $calls{$name}->{ret} = $opts{serverret} if $mode eq "server";
+        }
+
         # for now, we distinguish only two levels of priority:
         # low (0) and high (1)
         if (exists $opts{priority}) {
@@ -376,6 +385,24 @@ while (<PROTOCOL>) {
             $calls{$name}->{priority} = 0;
         }
 
+        # calls requiring only read-like permissions are queries,
+        # anything else is considered to be modifying some state
+        $calls{$name}->{mutating} = 0;
+        if (exists $opts{acl}) {
+            foreach my $acl (@{$opts{acl}}) {
+                next if $acl eq "none";
+                my @bits = split /:/, $acl;
+                $calls{$name}->{mutating} = 1
+                    unless $bits[1] =~ /^(read|read_secure|getattr|search_\w+)$/;
+            }
+        }
+
+        # calls with generated code on both sides have no special
+        # handling in the daemon or the client, so unless they carry
+        # a stream they can be relayed without decoding them
+        $calls{$name}->{forwardable} =
+            ($opts{generate} eq "both" && $calls{$name}->{streamflag} eq "none") ? 1 : 0;
+
         $calls[$id] = $calls{$name};
 
         $collect_args_members = 0;
@@ -475,6 +502,8 @@ if ($mode eq "debug") {
         print "        name $calls{$_}->{name} ($calls{$_}->{ProcName})\n";
         print "        $calls{$_}->{args} -> $calls{$_}->{ret}\n";
         print "        priority -> $calls{$_}->{priority}\n";
+        print "        mutating -> $calls{$_}->{mutating}\n";
+        print "        forwardable -> $calls{$_}->{forwardable}\n";
     }
 }
 
@@ -1266,7 +1295,7 @@ elsif ($mode eq "server") {
 
     print "virNetServerProgramProc ${structprefix}Procs[] = {\n";
     for ($id = 0 ; $id <= $#calls ; $id++) {
-        my ($comment, $name, $argtype, $arglen, $argfilter, $retlen, $retfilter, $priority);
+        my ($comment, $name, $argtype, $arglen, $argfilter, $retlen, $retfilter, $priority, $mutating, $forwardable);
 
         if (defined $calls[$id] && !$calls[$id]->{msg}) {
             $comment = "/* Method $calls[$id]->{ProcName} => $id */";
@@ -1290,8 +1319,10 @@ elsif ($mode eq "server") {
         }
 
     $priority = defined $calls[$id]->{priority} ? $calls[$id]->{priority} : 0;
+    $mutating = $calls[$id]->{mutating} ? "true" : "false";
+    $forwardable = $calls[$id]->{forwardable} && !$calls[$id]->{msg} ? "true" : "false";
 
-        print "{ $comment\n   ${name},\n   $arglen,\n   (xdrproc_t)$argfilter,\n   $retlen,\n   (xdrproc_t)$retfilter,\n   true,\n   $priority\n},\n";
+        print "{ $comment\n   ${name},\n   $arglen,\n   (xdrproc_t)$argfilter,\n   $retlen,\n   (xdrproc_t)$retfilter,\n   true,\n   $priority,\n   $mutating,\n   $forwardable\n},\n";
     }
     print "};\n";
     print "size_t ${structprefix}NProcs = G_N_ELEMENTS(${structprefix}Procs);\n";
@@ -42,7 +42,11 @@ struct _virKeepAlive {
     unsigned int countToDeath;
     gint64 lastPacketReceived;
     gint64 intervalStart;
-    int timer;
+    bool started;
+
+    /* protected by the wheel lock */
+    gint64 deadline;
+    GList *link;
 
     virKeepAliveSendFunc sendCB;
     virKeepAliveDeadFunc deadCB;
@@ -64,6 +68,201 @@ static int virKeepAliveOnceInit(void)
 
 VIR_ONCE_GLOBAL_INIT(virKeepAlive);
 
+
+/*
+ * All started keepalive objects share a single event loop timer. Each object
+ * sits in the slot of the wheel matching the second its current interval
+ * ends in, so a single wakeup of the timer handles every connection which is
+ * due at that time. Objects whose deadline is more than
+ * VIR_KEEPALIVE_WHEEL_SLOTS seconds ahead simply stay in their slot for more
+ * than one turn of the wheel.
+ *
+ * The wheel lock must never be held while locking a keepalive object.
+ */
+#define VIR_KEEPALIVE_WHEEL_SLOTS 64
+
+typedef struct _virKeepAliveWheel virKeepAliveWheel;
+struct _virKeepAliveWheel {
+    virMutex lock;
+    int timer;
+    gint64 armed;       /* deadline the timer is armed for, 0 if disabled */
+    gint64 processed;   /* the last second handled by the timer */
+    bool ticking;
+    GQueue slots[VIR_KEEPALIVE_WHEEL_SLOTS];
+};
+
+static virKeepAliveWheel keepaliveWheel = {
+    .lock = VIR_MUTEX_INITIALIZER,
+    .timer = -1,
+};
+
+
+static void
+virKeepAliveWheelArmAt(gint64 deadline)
+{
+    gint64 now = g_get_monotonic_time() / 1000;
+    gint64 timeout = deadline * 1000 - now;
+
+    keepaliveWheel.armed = deadline;
+    virEventUpdateTimeout(keepaliveWheel.timer,
+                          CLAMP(timeout, 0, INT_MAX));
+}
+
+
+/* Arms the timer for the earliest deadline in the wheel, must be called with
+ * the wheel lock held. */
+static void
+virKeepAliveWheelArm(gint64 now)
+{
+    gint64 next = 0;
+    int i;
+    GList *l;
+
+    for (i = 0; i < VIR_KEEPALIVE_WHEEL_SLOTS && next == 0; i++) {
+        GQueue *slot = &keepaliveWheel.slots[(now + i) % VIR_KEEPALIVE_WHEEL_SLOTS];
+
+        for (l = slot->head; l; l = l->next) {
+            virKeepAlive *ka = l->data;
+
+            if (ka->deadline <= now + i) {
+                next = now + i;
+                break;
+            }
+        }
+    }
+
+    /* only deadlines beyond one turn of the wheel are left */
+    for (i = 0; i < VIR_KEEPALIVE_WHEEL_SLOTS && next == 0; i++) {
+        for (l = keepaliveWheel.slots[i].head; l; l = l->next) {
+            virKeepAlive *ka = l->data;
+
+            if (next == 0 || ka->deadline < next)
+                next = ka->deadline;
+        }
+    }
+
+    if (next == 0) {
+        keepaliveWheel.armed = 0;
+        virEventUpdateTimeout(keepaliveWheel.timer, -1);
+    } else {
+        virKeepAliveWheelArmAt(next);
+    }
+}
+
+
+static void virKeepAliveFire(virKeepAlive *ka);
+
+static void
+virKeepAliveWheelTimer(int timer G_GNUC_UNUSED,
+                       void *opaque G_GNUC_UNUSED)
+{
+    gint64 now = g_get_monotonic_time() / G_USEC_PER_SEC;
+    g_autoptr(GPtrArray) due = g_ptr_array_new();
+    gint64 t;
+    size_t i;
+
+    virMutexLock(&keepaliveWheel.lock);
+
+    t = MAX(keepaliveWheel.processed, now - VIR_KEEPALIVE_WHEEL_SLOTS + 1);
+    for (; t <= now; t++) {
+        GQueue *slot = &keepaliveWheel.slots[t % VIR_KEEPALIVE_WHEEL_SLOTS];
+        GList *l = slot->head;
+
+        while (l) {
+            GList *next = l->next;
+            virKeepAlive *ka = l->data;
+
+            /* the reference held by the wheel is passed to @due */
+            if (ka->deadline <= now) {
+                g_queue_delete_link(slot, l);
+                ka->link = NULL;
+                g_ptr_array_add(due, ka);
+            }
+            l = next;
+        }
+    }
+
+    keepaliveWheel.processed = now;
+    keepaliveWheel.ticking = true;
+
+    virMutexUnlock(&keepaliveWheel.lock);
+
+    VIR_DEBUG("%u keepalive timers due", due->len);
+
+    for (i = 0; i < due->len; i++)
+        virKeepAliveFire(g_ptr_array_index(due, i));
+
+    virMutexLock(&keepaliveWheel.lock);
+    keepaliveWheel.ticking = false;
+    virKeepAliveWheelArm(now);
+    virMutexUnlock(&keepaliveWheel.lock);
+}
+
+
+/* Puts @ka into the slot for @deadline, must be called with @ka locked. */
+static int
+virKeepAliveSchedule(virKeepAlive *ka,
+                     gint64 deadline)
+{
+    int ret = -1;
+
+    if (!ka->started)
+        return 0;
+
+    virMutexLock(&keepaliveWheel.lock);
+
+    if (keepaliveWheel.timer < 0 &&
+        (keepaliveWheel.timer = virEventAddTimeout(-1, virKeepAliveWheelTimer,
+                                                   NULL, NULL)) < 0)
+        goto cleanup;
+
+    if (ka->link) {
+        g_queue_unlink(&keepaliveWheel.slots[ka->deadline % VIR_KEEPALIVE_WHEEL_SLOTS],
+                       ka->link);
+    } else {
+        ka->link = g_list_alloc();
+        ka->link->data = virObjectRef(ka);
+    }
+
+    ka->deadline = deadline;
+    g_queue_push_tail_link(&keepaliveWheel.slots[deadline % VIR_KEEPALIVE_WHEEL_SLOTS],
+                           ka->link);
+
+    /* the timer is re-armed once the batch of due objects is handled */
+    if (!keepaliveWheel.ticking &&
+        (keepaliveWheel.armed == 0 || deadline < keepaliveWheel.armed))
+        virKeepAliveWheelArmAt(deadline);
+
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&keepaliveWheel.lock);
+    return ret;
+}
+
+
+/* Removes @ka from the wheel, must be called with @ka locked. */
+static void
+virKeepAliveUnschedule(virKeepAlive *ka)
+{
+    bool scheduled = false;
+
+    virMutexLock(&keepaliveWheel.lock);
+
+    if (ka->link) {
+        g_queue_delete_link(&keepaliveWheel.slots[ka->deadline % VIR_KEEPALIVE_WHEEL_SLOTS],
+                            ka->link);
+        ka->link = NULL;
+        scheduled = true;
+    }
+
+    virMutexUnlock(&keepaliveWheel.lock);
+
+    /* the caller holds a reference as well */
+    if (scheduled)
+        virObjectUnref(ka);
+}
+
 static virNetMessage *
 virKeepAliveMessage(virKeepAlive *ka, int proc)
 {
@@ -120,8 +319,7 @@ virKeepAliveTimerInternal(virKeepAlive *ka,
         return false;
 
     if (now - ka->intervalStart < ka->interval) {
-        timeval = ka->interval - (now - ka->intervalStart);
-        virEventUpdateTimeout(ka->timer, timeval * 1000);
+        ignore_value(virKeepAliveSchedule(ka, ka->intervalStart + ka->interval));
         return false;
     }
 
@@ -141,25 +339,26 @@ virKeepAliveTimerInternal(virKeepAlive *ka,
         ka->countToDeath--;
         ka->intervalStart = now;
         *msg = virKeepAliveMessage(ka, KEEPALIVE_PROC_PING);
-        virEventUpdateTimeout(ka->timer, ka->interval * 1000);
+        ignore_value(virKeepAliveSchedule(ka, now + ka->interval));
         return false;
     }
 }
 
 
+/* Handles @ka taken out of the wheel by its timer, consumes the reference
+ * held by the wheel. */
 static void
-virKeepAliveTimer(int timer G_GNUC_UNUSED, void *opaque)
+virKeepAliveFire(virKeepAlive *ka)
 {
-    virKeepAlive *ka = opaque;
     virNetMessage *msg = NULL;
-    bool dead;
+    bool dead = false;
     void *client;
 
-    virObjectRef(ka);
     virObjectLock(ka);
 
     client = ka->client;
-    dead = virKeepAliveTimerInternal(ka, &msg);
+    if (ka->started)
+        dead = virKeepAliveTimerInternal(ka, &msg);
 
     virObjectUnlock(ka);
 
@@ -199,7 +398,6 @@ virKeepAliveNew(int interval,
     ka->interval = interval;
     ka->count = count;
     ka->countToDeath = count;
-    ka->timer = -1;
     ka->client = client;
     ka->sendCB = sendCB;
     ka->deadCB = deadCB;
@@ -237,7 +435,7 @@ virKeepAliveStart(virKeepAlive *ka,
 
     virObjectLock(ka);
 
-    if (ka->timer >= 0) {
+    if (ka->started) {
         VIR_DEBUG("Keepalive messages already enabled");
         ret = 0;
         goto cleanup;
@@ -277,13 +475,12 @@ virKeepAliveStart(virKeepAlive *ka,
     else
         timeout = ka->interval - delay;
     ka->intervalStart = now - (ka->interval - timeout);
-    ka->timer = virEventAddTimeout(timeout * 1000, virKeepAliveTimer,
-                                   ka, virObjectFreeCallback);
-    if (ka->timer < 0)
+    ka->started = true;
+    if (virKeepAliveSchedule(ka, now + timeout) < 0) {
+        ka->started = false;
         goto cleanup;
+    }
 
-    /* the timer now has another reference to this object */
-    virObjectRef(ka);
     ret = 0;
 
  cleanup:
@@ -301,9 +498,9 @@ virKeepAliveStop(virKeepAlive *ka)
           "ka=%p client=%p",
           ka, ka->client);
 
-    if (ka->timer > 0) {
-        virEventRemoveTimeout(ka->timer);
-        ka->timer = -1;
+    if (ka->started) {
+        virKeepAliveUnschedule(ka);
+        ka->started = false;
     }
 
     virObjectUnlock(ka);
@@ -402,8 +599,8 @@ virKeepAliveCheckMessage(virKeepAlive *ka,
         }
     }
 
-    if (ka->timer >= 0)
-        virEventUpdateTimeout(ka->timer, ka->interval * 1000);
+    /* The object stays in its slot of the wheel, the timer moves it
+     * according to the new intervalStart once the old deadline is reached */
 
     virObjectUnlock(ka);
 
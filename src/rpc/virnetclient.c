@@ -105,6 +105,8 @@ struct _virNetClient {
     virKeepAlive *keepalive;
     bool wantClose;
     int closeReason;
+    /* Minimal size of calls to compress, 0 unless negotiated */
+    size_t compressThreshold;
     virErrorPtr error;
 
     virNetClientCloseFunc closeCb;
@@ -251,6 +253,24 @@ virNetClientKeepAliveIsSupported(virNetClient *client)
     return supported;
 }
 
+/**
+ * virNetClientSetCompression:
+ * @client: the client
+ * @threshold: minimal payload size to compress, 0 to disable
+ *
+ * Enables compression of calls sent to a server which negotiated
+ * VIR_DRV_FEATURE_REMOTE_COMPRESSION. Compressed replies are accepted
+ * regardless, as long as this build supports compression at all.
+ */
+void
+virNetClientSetCompression(virNetClient *client,
+                           size_t threshold)
+{
+    virObjectLock(client);
+    client->compressThreshold = threshold;
+    virObjectUnlock(client);
+}
+
 int
 virNetClientKeepAliveStart(virNetClient *client,
                            int interval,
@@ -1149,9 +1169,13 @@ virNetClientCallDispatchReply(virNetClient *client)
         return -1;
     }
 
-    VIR_REALLOC_N(thecall->msg->buffer, client->msg.bufferLength);
+    /* Hand the reply buffer over to the call instead of copying it,
+     * client->msg will get a fresh one for the next incoming message */
+    virNetMessageClearPayload(thecall->msg);
+    thecall->msg->buffer = g_steal_pointer(&client->msg.buffer);
+    thecall->msg->bufferAlloc = client->msg.bufferAlloc;
+    client->msg.bufferAlloc = 0;
 
-    memcpy(thecall->msg->buffer, client->msg.buffer, client->msg.bufferLength);
     memcpy(&thecall->msg->header, &client->msg.header, sizeof(client->msg.header));
     thecall->msg->bufferLength = client->msg.bufferLength;
     thecall->msg->bufferOffset = client->msg.bufferOffset;
@@ -1378,6 +1402,71 @@ virNetClientIOWriteMessage(virNetClient *client,
 }
 
 
+#ifndef WIN32
+/* Max number of queued calls written out with a single syscall */
+# define VIR_NET_CLIENT_TX_BATCH 64
+
+/*
+ * Write out data of as many calls waiting for transmission as
+ * possible with a single syscall, so that threads sharing the
+ * connection don't need one syscall per call. Batching stops at a
+ * call carrying FDs, since those must follow the call data. Calls
+ * are completed by virNetClientIOWriteMessage afterwards.
+ */
+static ssize_t
+virNetClientIOWriteBatch(virNetClient *client,
+                         virNetClientCall *thecall)
+{
+    struct iovec iov[VIR_NET_CLIENT_TX_BATCH];
+    virNetClientCall *call;
+    int niov = 0;
+    size_t done;
+    ssize_t ret;
+
+    for (call = thecall;
+         call && niov < VIR_NET_CLIENT_TX_BATCH;
+         call = call->next) {
+        virNetMessage *msg = call->msg;
+
+        if (call->mode != VIR_NET_CLIENT_MODE_WAIT_TX)
+            continue;
+
+        if (msg->bufferOffset < msg->bufferLength) {
+            iov[niov].iov_base = msg->buffer + msg->bufferOffset;
+            iov[niov].iov_len = msg->bufferLength - msg->bufferOffset;
+            niov++;
+        }
+
+        if (msg->nfds > 0)
+            break;
+    }
+
+    /* Nothing to gain, leave it to the regular path */
+    if (niov < 2)
+        return 0;
+
+    ret = virNetSocketWritev(client->sock, iov, niov);
+    if (ret <= 0)
+        return ret;
+
+    done = ret;
+    for (call = thecall; call && done > 0; call = call->next) {
+        virNetMessage *msg = call->msg;
+        size_t len;
+
+        if (call->mode != VIR_NET_CLIENT_MODE_WAIT_TX)
+            continue;
+
+        len = MIN(msg->bufferLength - msg->bufferOffset, done);
+        msg->bufferOffset += len;
+        done -= len;
+    }
+
+    return ret;
+}
+#endif /* !WIN32 */
+
+
 static ssize_t
 virNetClientIOHandleOutput(virNetClient *client)
 {
@@ -1393,6 +1482,11 @@ virNetClientIOHandleOutput(virNetClient *client)
                    * up from poll()ing and the time we locked the client
                    */
 
+#ifndef WIN32
+    if (virNetClientIOWriteBatch(client, thecall) < 0)
+        return -1;
+#endif /* !WIN32 */
+
     while (thecall) {
         ssize_t ret = virNetClientIOWriteMessage(client, thecall);
         if (ret < 0)
@@ -1416,7 +1510,7 @@ virNetClientIOReadMessage(virNetClient *client)
     /* Start by reading length word */
     if (client->msg.bufferLength == 0) {
         client->msg.bufferLength = 4;
-        client->msg.buffer = g_new0(char, client->msg.bufferLength);
+        virNetMessageReserveBuffer(&client->msg, client->msg.bufferLength);
     }
 
     wantData = client->msg.bufferLength - client->msg.bufferOffset;
@@ -2191,6 +2285,16 @@ int virNetClientSendWithReply(virNetClient *client,
                               virNetMessage *msg)
 {
     int ret;
+    size_t threshold;
+
+    virObjectLock(client);
+    threshold = client->compressThreshold;
+    virObjectUnlock(client);
+
+    /* Don't hold up other threads while compressing */
+    if (threshold > 0)
+        virNetMessageCompress(msg, threshold);
+
     virObjectLock(client);
     ret = virNetClientSendInternal(client, msg, true, false);
     virObjectUnlock(client);
@@ -155,6 +155,9 @@ int virNetClientGetTLSKeySize(virNetClient *client);
 
 void virNetClientClose(virNetClient *client);
 
+void virNetClientSetCompression(virNetClient *client,
+                                size_t threshold);
+
 bool virNetClientKeepAliveIsSupported(virNetClient *client);
 int virNetClientKeepAliveStart(virNetClient *client,
                                int interval,
@@ -112,21 +112,19 @@ int virNetClientProgramMatches(virNetClientProgram *prog,
 }
 
 
-static int
-virNetClientProgramDispatchError(virNetClientProgram *prog G_GNUC_UNUSED,
-                                 virNetMessage *msg)
+/**
+ * virNetClientProgramRaiseError:
+ * @err: the error as sent by the server
+ *
+ * Sets @err as the last error of the calling thread, translating
+ * error codes sent by some old servers.
+ */
+void
+virNetClientProgramRaiseError(virNetMessageError *err)
 {
-    virNetMessageError err;
-    int ret = -1;
-
-    memset(&err, 0, sizeof(err));
-
-    if (virNetMessageDecodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &err) < 0)
-        goto cleanup;
-
     /* Interop for virErrorNumber glitch in 0.8.0, if server is
      * 0.7.1 through 0.7.7; see comments in virterror.h. */
-    switch (err.code) {
+    switch (err->code) {
     case VIR_WAR_NO_NWFILTER:
         /* no way to tell old VIR_WAR_NO_SECRET apart from
          * VIR_WAR_NO_NWFILTER, but both are very similar
@@ -137,49 +135,65 @@ virNetClientProgramDispatchError(virNetClientProgram *prog G_GNUC_UNUSED,
     case VIR_ERR_BUILD_FIREWALL:
         /* server was trying to pass VIR_ERR_INVALID_SECRET,
          * VIR_ERR_NO_SECRET, or VIR_ERR_CONFIG_UNSUPPORTED */
-        if (err.domain != VIR_FROM_NWFILTER)
-            err.code += 4;
+        if (err->domain != VIR_FROM_NWFILTER)
+            err->code += 4;
         break;
     case VIR_WAR_NO_SECRET:
-        if (err.domain == VIR_FROM_QEMU)
-            err.code = VIR_ERR_OPERATION_TIMEOUT;
+        if (err->domain == VIR_FROM_QEMU)
+            err->code = VIR_ERR_OPERATION_TIMEOUT;
         break;
     case VIR_ERR_INVALID_SECRET:
-        if (err.domain == VIR_FROM_XEN)
-            err.code = VIR_ERR_MIGRATE_PERSIST_FAILED;
+        if (err->domain == VIR_FROM_XEN)
+            err->code = VIR_ERR_MIGRATE_PERSIST_FAILED;
         break;
     default:
         /* Nothing to alter. */
         break;
     }
 
-    if ((err.domain == VIR_FROM_REMOTE || err.domain == VIR_FROM_RPC) &&
-        err.code == VIR_ERR_RPC &&
-        err.level == VIR_ERR_ERROR &&
-        err.message &&
-        STRPREFIX(*err.message, "unknown procedure")) {
+    if ((err->domain == VIR_FROM_REMOTE || err->domain == VIR_FROM_RPC) &&
+        err->code == VIR_ERR_RPC &&
+        err->level == VIR_ERR_ERROR &&
+        err->message &&
+        STRPREFIX(*err->message, "unknown procedure")) {
         virRaiseErrorFull(__FILE__, __FUNCTION__, __LINE__,
-                          err.domain,
+                          err->domain,
                           VIR_ERR_NO_SUPPORT,
-                          err.level,
-                          err.str1 ? *err.str1 : NULL,
-                          err.str2 ? *err.str2 : NULL,
-                          err.str3 ? *err.str3 : NULL,
-                          err.int1,
-                          err.int2,
-                          "%s", *err.message);
+                          err->level,
+                          err->str1 ? *err->str1 : NULL,
+                          err->str2 ? *err->str2 : NULL,
+                          err->str3 ? *err->str3 : NULL,
+                          err->int1,
+                          err->int2,
+                          "%s", *err->message);
     } else {
         virRaiseErrorFull(__FILE__, __FUNCTION__, __LINE__,
-                          err.domain,
-                          err.code,
-                          err.level,
-                          err.str1 ? *err.str1 : NULL,
-                          err.str2 ? *err.str2 : NULL,
-                          err.str3 ? *err.str3 : NULL,
-                          err.int1,
-                          err.int2,
-                          "%s", err.message ? *err.message : _("Unknown error"));
+                          err->domain,
+                          err->code,
+                          err->level,
+                          err->str1 ? *err->str1 : NULL,
+                          err->str2 ? *err->str2 : NULL,
+                          err->str3 ? *err->str3 : NULL,
+                          err->int1,
+                          err->int2,
+                          "%s", err->message ? *err->message : _("Unknown error"));
     }
+}
+
+
+static int
+virNetClientProgramDispatchError(virNetClientProgram *prog G_GNUC_UNUSED,
+                                 virNetMessage *msg)
+{
+    virNetMessageError err;
+    int ret = -1;
+
+    memset(&err, 0, sizeof(err));
+
+    if (virNetMessageDecodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &err) < 0)
+        goto cleanup;
+
+    virNetClientProgramRaiseError(&err);
 
     ret = 0;
 
@@ -396,3 +410,73 @@ int virNetClientProgramCall(virNetClientProgram *prog,
     }
     return -1;
 }
+
+
+/**
+ * virNetClientProgramForward:
+ * @prog: the program
+ * @client: the client to send the call through
+ * @serial: serial number to use on @client
+ * @msg: a complete call received from elsewhere
+ *
+ * Sends the call in @msg, whose payload is passed on without being
+ * decoded, and waits for the reply. Upon success @msg holds the
+ * complete reply, which may be an error reply, with the original
+ * serial number of the call. Calls passing file descriptors are
+ * not supported.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetClientProgramForward(virNetClientProgram *prog,
+                           virNetClient *client,
+                           unsigned serial,
+                           virNetMessage *msg)
+{
+    virNetMessageHeader header = msg->header;
+
+    if (msg->header.prog != prog->program ||
+        msg->header.vers != prog->version ||
+        msg->header.type != VIR_NET_CALL ||
+        msg->nfds) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to forward message prog=%u vers=%u type=%d"),
+                       msg->header.prog, msg->header.vers, msg->header.type);
+        return -1;
+    }
+
+    msg->header.serial = serial;
+    if (virNetMessageUpdateHeader(msg) < 0)
+        goto error;
+
+    if (virNetClientSendWithReply(client, msg) < 0)
+        goto error;
+
+    if (msg->header.type != VIR_NET_REPLY) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message type %d"), msg->header.type);
+        goto error;
+    }
+    if (msg->header.proc != header.proc) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message proc %d != %d"),
+                       msg->header.proc, header.proc);
+        goto error;
+    }
+    if (msg->header.serial != serial) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected message serial %d != %d"),
+                       msg->header.serial, serial);
+        goto error;
+    }
+
+    msg->header.serial = header.serial;
+    if (virNetMessageUpdateHeader(msg) < 0)
+        goto error;
+
+    return 0;
+
+ error:
+    msg->header = header;
+    return -1;
+}
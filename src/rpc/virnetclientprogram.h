@@ -59,6 +59,9 @@ unsigned virNetClientProgramGetVersion(virNetClientProgram *prog);
 int virNetClientProgramMatches(virNetClientProgram *prog,
                                virNetMessage *msg);
 
+void virNetClientProgramRaiseError(virNetMessageError *err)
+    ATTRIBUTE_NONNULL(1);
+
 int virNetClientProgramDispatch(virNetClientProgram *prog,
                                 virNetClient *client,
                                 virNetMessage *msg);
@@ -73,3 +76,8 @@ int virNetClientProgramCall(virNetClientProgram *prog,
                             int **infds,
                             xdrproc_t args_filter, void *args,
                             xdrproc_t ret_filter, void *ret);
+
+int virNetClientProgramForward(virNetClientProgram *prog,
+                               virNetClient *client,
+                               unsigned serial,
+                               virNetMessage *msg);
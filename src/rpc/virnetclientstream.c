@@ -26,6 +26,7 @@
 #include "virerror.h"
 #include "virlog.h"
 #include "virthread.h"
+#include "virfile.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -342,7 +343,8 @@ int virNetClientStreamQueuePacket(virNetClientStream *st,
     tmp_msg->buffer = g_steal_pointer(&msg->buffer);
     tmp_msg->bufferLength = msg->bufferLength;
     tmp_msg->bufferOffset = msg->bufferOffset;
-    msg->bufferLength = msg->bufferOffset = 0;
+    tmp_msg->bufferAlloc = msg->bufferAlloc;
+    msg->bufferLength = msg->bufferOffset = msg->bufferAlloc = 0;
 
     virObjectLock(st);
 
@@ -407,6 +409,70 @@ int virNetClientStreamSendPacket(virNetClientStream *st,
 }
 
 
+/*
+ * Like virNetClientStreamSendPacket, but reads up to @nbytes of data
+ * from @fd straight into the message buffer instead of copying them
+ * from a caller supplied buffer.
+ *
+ * Returns the number of bytes sent, 0 on EOF of @fd, -1 on error
+ */
+int virNetClientStreamSendPacketFromFD(virNetClientStream *st,
+                                       virNetClient *client,
+                                       int fd,
+                                       size_t nbytes)
+{
+    virNetMessage *msg;
+    char *data;
+    ssize_t got;
+    VIR_DEBUG("st=%p fd=%d nbytes=%zu", st, fd, nbytes);
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    virObjectLock(st);
+
+    msg->header.prog = virNetClientProgramGetProgram(st->prog);
+    msg->header.vers = virNetClientProgramGetVersion(st->prog);
+    msg->header.status = VIR_NET_CONTINUE;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = st->serial;
+    msg->header.proc = st->proc;
+
+    virObjectUnlock(st);
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto error;
+
+    if (!(data = virNetMessageEncodePayloadRawReserve(msg, nbytes)))
+        goto error;
+
+    if ((got = saferead(fd, data, nbytes)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to read stream data"));
+        goto error;
+    }
+
+    if (got == 0) {
+        virNetMessageFree(msg);
+        return 0;
+    }
+
+    if (virNetMessageEncodePayloadRawCommit(msg, got) < 0)
+        goto error;
+
+    if (virNetClientSendStream(client, msg, st) < 0)
+        goto error;
+
+    virNetMessageFree(msg);
+
+    return got;
+
+ error:
+    virNetMessageFree(msg);
+    return -1;
+}
+
+
 static int
 virNetClientStreamSetHole(virNetClientStream *st,
                           long long length,
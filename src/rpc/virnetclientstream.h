@@ -62,6 +62,11 @@ int virNetClientStreamSendPacket(virNetClientStream *st,
                                  const char *data,
                                  size_t nbytes);
 
+int virNetClientStreamSendPacketFromFD(virNetClientStream *st,
+                                       virNetClient *client,
+                                       int fd,
+                                       size_t nbytes);
+
 int virNetClientStreamRecvPacket(virNetClientStream *st,
                                  virNetClient *client,
                                  char *data,
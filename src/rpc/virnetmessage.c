@@ -21,6 +21,9 @@
 #include <config.h>
 
 #include <unistd.h>
+#if WITH_ZSTD
+# include <zstd.h>
+#endif
 
 #include "virnetmessage.h"
 #include "viralloc.h"
@@ -29,16 +32,205 @@
 #include "virfile.h"
 #include "virutil.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
 VIR_LOG_INIT("rpc.netmessage");
 
+/*
+ * Every RPC call and reply needs a message and a payload buffer,
+ * which are thrown away as soon as the message was dispatched or
+ * written out. To avoid hitting the heap allocator for each message,
+ * released messages and buffers are kept in a small process wide
+ * pool. Buffers are grouped into size classes, starting at
+ * VIR_NET_MESSAGE_INITIAL and doubling, matching the way buffers
+ * grow in virNetMessageEncodePayload.
+ */
+#define VIR_NET_MESSAGE_POOL_CLASSES 5
+#define VIR_NET_MESSAGE_POOL_BUFFERS 16
+#define VIR_NET_MESSAGE_POOL_MESSAGES 64
+
+/* Fastest zstd level, WAN links are rarely faster than it */
+#define VIR_NET_MESSAGE_COMPRESS_LEVEL 1
+
+typedef struct _virNetMessagePoolClass virNetMessagePoolClass;
+struct _virNetMessagePoolClass {
+    size_t nbuffers;
+    char *buffers[VIR_NET_MESSAGE_POOL_BUFFERS];
+};
+
+static virMutex virNetMessagePoolLock = VIR_MUTEX_INITIALIZER;
+static virNetMessagePoolClass virNetMessagePool[VIR_NET_MESSAGE_POOL_CLASSES];
+static virNetMessage *virNetMessagePoolMessages;
+static size_t virNetMessagePoolNMessages;
+static unsigned long long virNetMessagePoolHits;
+static unsigned long long virNetMessagePoolMisses;
+
+
+static size_t
+virNetMessagePoolClassSize(size_t cls)
+{
+    return ((size_t)VIR_NET_MESSAGE_INITIAL << cls) + VIR_NET_MESSAGE_LEN_MAX;
+}
+
+
+/*
+ * Returns the smallest size class able to hold @len bytes, or -1 if
+ * such buffers are not pooled. Tiny buffers used for reading the
+ * length word are never pooled so that idle clients do not pin
+ * large buffers.
+ */
+static int
+virNetMessagePoolClassFind(size_t len)
+{
+    size_t i;
+
+    if (len <= VIR_NET_MESSAGE_LEN_MAX)
+        return -1;
+
+    for (i = 0; i < VIR_NET_MESSAGE_POOL_CLASSES; i++) {
+        if (len <= virNetMessagePoolClassSize(i))
+            return i;
+    }
+
+    return -1;
+}
+
+
+static char *
+virNetMessagePoolGetBuffer(size_t len,
+                           size_t *alloc)
+{
+    int cls = virNetMessagePoolClassFind(len);
+    char *buf = NULL;
+
+    if (cls < 0) {
+        *alloc = len;
+        return g_new(char, len);
+    }
+
+    *alloc = virNetMessagePoolClassSize(cls);
+
+    virMutexLock(&virNetMessagePoolLock);
+    if (virNetMessagePool[cls].nbuffers > 0) {
+        virNetMessagePoolClass *pool = &virNetMessagePool[cls];
+
+        buf = g_steal_pointer(&pool->buffers[--pool->nbuffers]);
+        virNetMessagePoolHits++;
+    } else {
+        virNetMessagePoolMisses++;
+    }
+    virMutexUnlock(&virNetMessagePoolLock);
+
+    if (!buf)
+        buf = g_new(char, *alloc);
+
+    return buf;
+}
+
+
+static void
+virNetMessagePoolPutBuffer(char *buf,
+                           size_t alloc)
+{
+    int cls = virNetMessagePoolClassFind(alloc);
+
+    if (!buf)
+        return;
+
+    /* Only buffers whose size exactly matches a class can be reused */
+    if (cls >= 0 && virNetMessagePoolClassSize(cls) == alloc) {
+        virMutexLock(&virNetMessagePoolLock);
+        if (virNetMessagePool[cls].nbuffers < VIR_NET_MESSAGE_POOL_BUFFERS) {
+            virNetMessagePoolClass *pool = &virNetMessagePool[cls];
+
+            pool->buffers[pool->nbuffers++] = g_steal_pointer(&buf);
+        }
+        virMutexUnlock(&virNetMessagePoolLock);
+    }
+
+    g_free(buf);
+}
+
+
+/**
+ * virNetMessageGetPoolStats:
+ * @hits: filled with number of allocations served from the pool
+ * @misses: filled with number of allocations that hit the heap
+ *
+ * Reports how effective the process wide message pool is.
+ */
+void
+virNetMessageGetPoolStats(unsigned long long *hits,
+                          unsigned long long *misses)
+{
+    virMutexLock(&virNetMessagePoolLock);
+    *hits = virNetMessagePoolHits;
+    *misses = virNetMessagePoolMisses;
+    virMutexUnlock(&virNetMessagePoolLock);
+}
+
+
+/**
+ * virNetMessageReserveBuffer:
+ * @msg: the message
+ * @len: minimal required size of the buffer
+ *
+ * Make sure that @msg->buffer can hold at least @len bytes,
+ * preserving its current contents. Neither bufferLength nor
+ * bufferOffset is modified. Any code that allocates a message
+ * buffer should go through this function so that bufferAlloc
+ * stays accurate.
+ */
+void
+virNetMessageReserveBuffer(virNetMessage *msg,
+                           size_t len)
+{
+    char *buf;
+    size_t alloc;
+
+    if (!msg->buffer)
+        msg->bufferAlloc = 0;
+
+    if (msg->buffer && msg->bufferAlloc >= len)
+        return;
+
+    if (msg->buffer && msg->bufferAlloc == 0) {
+        /* Buffer of unknown origin, we can't tell how much to copy */
+        VIR_REALLOC_N(msg->buffer, len);
+        msg->bufferAlloc = len;
+        return;
+    }
+
+    buf = virNetMessagePoolGetBuffer(len, &alloc);
+    if (msg->buffer) {
+        memcpy(buf, msg->buffer, msg->bufferAlloc);
+        virNetMessagePoolPutBuffer(msg->buffer, msg->bufferAlloc);
+    }
+
+    msg->buffer = buf;
+    msg->bufferAlloc = alloc;
+}
+
+
 virNetMessage *virNetMessageNew(bool tracked)
 {
-    virNetMessage *msg;
+    virNetMessage *msg = NULL;
+
+    virMutexLock(&virNetMessagePoolLock);
+    if (virNetMessagePoolMessages) {
+        msg = virNetMessagePoolMessages;
+        virNetMessagePoolMessages = g_steal_pointer(&msg->next);
+        virNetMessagePoolNMessages--;
+        virNetMessagePoolHits++;
+    } else {
+        virNetMessagePoolMisses++;
+    }
+    virMutexUnlock(&virNetMessagePoolLock);
 
-    msg = g_new0(virNetMessage, 1);
+    if (!msg)
+        msg = g_new0(virNetMessage, 1);
 
     msg->tracked = tracked;
     VIR_DEBUG("msg=%p tracked=%d", msg, tracked);
@@ -61,7 +253,8 @@ virNetMessageClearPayload(virNetMessage *msg)
 
     msg->bufferOffset = 0;
     msg->bufferLength = 0;
-    VIR_FREE(msg->buffer);
+    virNetMessagePoolPutBuffer(g_steal_pointer(&msg->buffer), msg->bufferAlloc);
+    msg->bufferAlloc = 0;
 }
 
 
@@ -88,6 +281,16 @@ void virNetMessageFree(virNetMessage *msg)
         msg->cb(msg, msg->opaque);
 
     virNetMessageClearPayload(msg);
+    memset(msg, 0, sizeof(*msg));
+
+    virMutexLock(&virNetMessagePoolLock);
+    if (virNetMessagePoolNMessages < VIR_NET_MESSAGE_POOL_MESSAGES) {
+        msg->next = virNetMessagePoolMessages;
+        virNetMessagePoolMessages = g_steal_pointer(&msg);
+        virNetMessagePoolNMessages++;
+    }
+    virMutexUnlock(&virNetMessagePoolLock);
+
     g_free(msg);
 }
 
@@ -117,6 +320,247 @@ virNetMessage *virNetMessageQueueServe(virNetMessage **queue)
 }
 
 
+/*
+ * Re-encodes the length word and header of a message in place,
+ * using @type instead of @msg->header.type
+ */
+static int
+virNetMessageRewriteHeader(virNetMessage *msg,
+                           virNetMessageType type)
+{
+    virNetMessageHeader header = msg->header;
+    unsigned int len = msg->bufferLength;
+    XDR xdr;
+    int ret = -1;
+
+    header.type = type;
+
+    xdrmem_create(&xdr, msg->buffer,
+                  VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX,
+                  XDR_ENCODE);
+
+    if (!xdr_u_int(&xdr, &len)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
+        goto cleanup;
+    }
+
+    if (!xdr_virNetMessageHeader(&xdr, &header)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message header"));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    xdr_destroy(&xdr);
+    return ret;
+}
+
+
+/**
+ * virNetMessageUpdateHeader:
+ * @msg: a complete message, with header and payload
+ *
+ * Re-encodes @msg->header into the buffer of @msg, leaving the
+ * payload as it is, and rewinds the message ready to be sent. This
+ * allows passing a received message on after changing, for example,
+ * its serial number without decoding and encoding the payload.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetMessageUpdateHeader(virNetMessage *msg)
+{
+    if (msg->bufferLength < VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to update header of incomplete message"));
+        return -1;
+    }
+
+    if (virNetMessageRewriteHeader(msg, msg->header.type) < 0)
+        return -1;
+
+    msg->bufferOffset = 0;
+    return 0;
+}
+
+
+/**
+ * virNetMessageCompressionSupported:
+ *
+ * Returns true if this build is able to compress and decompress
+ * message payloads.
+ */
+bool
+virNetMessageCompressionSupported(void)
+{
+#if WITH_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+#if WITH_ZSTD
+/**
+ * virNetMessageCompress:
+ * @msg: the fully encoded outgoing message
+ * @threshold: minimal payload size worth compressing
+ *
+ * Compresses the payload of @msg in place and flags the message
+ * type accordingly on the wire, provided the payload is at least
+ * @threshold bytes long and compression actually makes it smaller.
+ * Stream data is never compressed, as it is mostly disk or console
+ * contents which are either incompressible or already compressed.
+ * @msg->header is left untouched.
+ *
+ * Returns true if the payload was compressed, false if the
+ * message was left as it was.
+ */
+bool
+virNetMessageCompress(virNetMessage *msg,
+                      size_t threshold)
+{
+    size_t hdrlen = VIR_NET_MESSAGE_LEN_MAX + VIR_NET_MESSAGE_HEADER_MAX;
+    g_autofree char *scratch = NULL;
+    size_t len;
+    size_t bound;
+    size_t ret;
+    unsigned int rawlen;
+    XDR xdr;
+
+    switch (msg->header.type) {
+    case VIR_NET_CALL:
+    case VIR_NET_REPLY:
+    case VIR_NET_MESSAGE:
+    case VIR_NET_CALL_WITH_FDS:
+    case VIR_NET_REPLY_WITH_FDS:
+        break;
+    case VIR_NET_STREAM:
+    case VIR_NET_STREAM_HOLE:
+    default:
+        return false;
+    }
+
+    if (msg->bufferOffset != 0 ||
+        msg->bufferLength < hdrlen + threshold)
+        return false;
+
+    len = msg->bufferLength - hdrlen;
+    bound = ZSTD_compressBound(len);
+    scratch = g_new(char, bound);
+
+    ret = ZSTD_compress(scratch, bound, msg->buffer + hdrlen, len,
+                        VIR_NET_MESSAGE_COMPRESS_LEVEL);
+    if (ZSTD_isError(ret)) {
+        VIR_DEBUG("Unable to compress message payload: %s",
+                  ZSTD_getErrorName(ret));
+        return false;
+    }
+
+    if (ret + VIR_NET_MESSAGE_LEN_MAX >= len)
+        return false;
+
+    rawlen = len;
+    xdrmem_create(&xdr, msg->buffer + hdrlen,
+                  VIR_NET_MESSAGE_LEN_MAX, XDR_ENCODE);
+    if (!xdr_u_int(&xdr, &rawlen)) {
+        xdr_destroy(&xdr);
+        return false;
+    }
+    xdr_destroy(&xdr);
+
+    memcpy(msg->buffer + hdrlen + VIR_NET_MESSAGE_LEN_MAX, scratch, ret);
+    msg->bufferLength = hdrlen + VIR_NET_MESSAGE_LEN_MAX + ret;
+
+    /* Can't fail, this writes less than what was encoded before */
+    ignore_value(virNetMessageRewriteHeader(msg,
+                                            msg->header.type |
+                                            VIR_NET_MESSAGE_TYPE_COMPRESSED));
+
+    VIR_DEBUG("Compressed payload of msg=%p from %zu to %zu bytes",
+              msg, len, ret);
+    return true;
+}
+
+
+/*
+ * Replaces the compressed payload of @msg, whose header was just
+ * decoded, with the original one and clears the compression flag
+ * both from the header and from the buffer, so that decoding the
+ * header once again yields the same result.
+ */
+static int
+virNetMessageDecompress(virNetMessage *msg)
+{
+    size_t hdrlen = msg->bufferOffset;
+    unsigned int rawlen;
+    size_t alloc;
+    size_t ret;
+    char *buf;
+    XDR xdr;
+
+    xdrmem_create(&xdr, msg->buffer + hdrlen,
+                  msg->bufferLength - hdrlen, XDR_DECODE);
+    if (!xdr_u_int(&xdr, &rawlen)) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decode compressed payload length"));
+        xdr_destroy(&xdr);
+        return -1;
+    }
+    xdr_destroy(&xdr);
+
+    if (rawlen > VIR_NET_MESSAGE_MAX - (hdrlen - VIR_NET_MESSAGE_LEN_MAX)) {
+        virReportError(VIR_ERR_RPC,
+                       _("compressed payload of %u bytes too large, want %zu"),
+                       rawlen,
+                       VIR_NET_MESSAGE_MAX - (hdrlen - VIR_NET_MESSAGE_LEN_MAX));
+        return -1;
+    }
+
+    buf = virNetMessagePoolGetBuffer(hdrlen + rawlen, &alloc);
+    memcpy(buf, msg->buffer, hdrlen);
+
+    ret = ZSTD_decompress(buf + hdrlen, rawlen,
+                          msg->buffer + hdrlen + VIR_NET_MESSAGE_LEN_MAX,
+                          msg->bufferLength - hdrlen - VIR_NET_MESSAGE_LEN_MAX);
+    if (ZSTD_isError(ret) || ret != rawlen) {
+        virReportError(VIR_ERR_RPC, "%s",
+                       _("Unable to decompress message payload"));
+        virNetMessagePoolPutBuffer(buf, alloc);
+        return -1;
+    }
+
+    virNetMessagePoolPutBuffer(msg->buffer, msg->bufferAlloc);
+    msg->buffer = buf;
+    msg->bufferAlloc = alloc;
+    msg->bufferLength = hdrlen + rawlen;
+    msg->header.type &= ~VIR_NET_MESSAGE_TYPE_COMPRESSED;
+
+    return virNetMessageRewriteHeader(msg, msg->header.type);
+}
+
+#else /* !WITH_ZSTD */
+
+bool
+virNetMessageCompress(virNetMessage *msg G_GNUC_UNUSED,
+                      size_t threshold G_GNUC_UNUSED)
+{
+    return false;
+}
+
+
+static int
+virNetMessageDecompress(virNetMessage *msg G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_NO_SUPPORT, "%s",
+                   _("compressed messages are not supported by this build"));
+    return -1;
+}
+#endif /* !WITH_ZSTD */
+
+
 int virNetMessageDecodeLength(virNetMessage *msg)
 {
     XDR xdr;
@@ -151,7 +595,7 @@ int virNetMessageDecodeLength(virNetMessage *msg)
     /* Extend our declared buffer length and carry
        on reading the header + payload */
     msg->bufferLength += len;
-    VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+    virNetMessageReserveBuffer(msg, msg->bufferLength);
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
               msg->bufferLength, len);
@@ -201,6 +645,10 @@ int virNetMessageDecodeHeader(virNetMessage *msg)
 
     msg->bufferOffset += xdr_getpos(&xdr);
 
+    if (msg->header.type & VIR_NET_MESSAGE_TYPE_COMPRESSED &&
+        virNetMessageDecompress(msg) < 0)
+        goto cleanup;
+
     ret = 0;
 
  cleanup:
@@ -227,7 +675,7 @@ int virNetMessageEncodeHeader(virNetMessage *msg)
     unsigned int len = 0;
 
     msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
-    VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+    virNetMessageReserveBuffer(msg, msg->bufferLength);
     msg->bufferOffset = 0;
 
     /* Format the header. */
@@ -350,6 +798,14 @@ int virNetMessageEncodePayload(virNetMessage *msg,
     /* Serialise payload of the message. This assumes that
      * virNetMessageEncodeHeader has already been run, so
      * just appends to that data */
+
+    /* Callers knowing the size of a large payload in advance may have
+     * reserved the buffer for it, make use of all of it so that the
+     * payload is encoded in a single pass */
+    if (msg->bufferAlloc > msg->bufferLength)
+        msg->bufferLength = MIN(msg->bufferAlloc,
+                                VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX);
+
     xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                   msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
 
@@ -367,7 +823,7 @@ int virNetMessageEncodePayload(virNetMessage *msg,
 
         msg->bufferLength = newlen + VIR_NET_MESSAGE_LEN_MAX;
 
-        VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+        virNetMessageReserveBuffer(msg, msg->bufferLength);
 
         xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                       msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
@@ -427,13 +883,21 @@ int virNetMessageDecodePayload(virNetMessage *msg,
 }
 
 
-int virNetMessageEncodePayloadRaw(virNetMessage *msg,
-                                  const char *data,
-                                  size_t len)
+/*
+ * @msg: the outgoing message, with header already encoded
+ * @len: maximum length of raw payload
+ *
+ * Makes room for up to @len bytes of raw payload, which the caller
+ * can then store directly at the returned address, instead of
+ * passing a buffer to virNetMessageEncodePayloadRaw which would
+ * have to copy it. Once done, virNetMessageEncodePayloadRawCommit
+ * must be called with the actual length of payload stored.
+ *
+ * returns pointer to payload area, NULL upon fatal error
+ */
+char *virNetMessageEncodePayloadRawReserve(virNetMessage *msg,
+                                           size_t len)
 {
-    XDR xdr;
-    unsigned int msglen;
-
     /* If the message buffer is too small for the payload increase it accordingly. */
     if ((msg->bufferLength - msg->bufferOffset) < len) {
         if ((msg->bufferOffset + len) >
@@ -445,17 +909,33 @@ int virNetMessageEncodePayloadRaw(virNetMessage *msg,
                            VIR_NET_MESSAGE_MAX +
                            VIR_NET_MESSAGE_LEN_MAX -
                            msg->bufferOffset);
-            return -1;
+            return NULL;
         }
 
         msg->bufferLength = msg->bufferOffset + len;
 
-        VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+        virNetMessageReserveBuffer(msg, msg->bufferLength);
 
         VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
     }
 
-    memcpy(msg->buffer + msg->bufferOffset, data, len);
+    return msg->buffer + msg->bufferOffset;
+}
+
+
+int virNetMessageEncodePayloadRawCommit(virNetMessage *msg,
+                                        size_t len)
+{
+    XDR xdr;
+    unsigned int msglen;
+
+    if ((msg->bufferLength - msg->bufferOffset) < len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Raw payload of %zu bytes exceeds reserved space"),
+                       len);
+        return -1;
+    }
+
     msg->bufferOffset += len;
 
     /* Re-encode the length word. */
@@ -478,6 +958,21 @@ int virNetMessageEncodePayloadRaw(virNetMessage *msg,
 }
 
 
+int virNetMessageEncodePayloadRaw(virNetMessage *msg,
+                                  const char *data,
+                                  size_t len)
+{
+    char *payload;
+
+    if (!(payload = virNetMessageEncodePayloadRawReserve(msg, len)))
+        return -1;
+
+    memcpy(payload, data, len);
+
+    return virNetMessageEncodePayloadRawCommit(msg, len);
+}
+
+
 int virNetMessageEncodePayloadEmpty(virNetMessage *msg)
 {
     XDR xdr;
@@ -22,6 +22,9 @@
 
 #include "virnetprotocol.h"
 
+/* Default size of payload from which it is worth compressing messages */
+#define VIR_NET_MESSAGE_COMPRESS_THRESHOLD 4096
+
 typedef struct _virNetMessage virNetMessage;
 
 typedef void (*virNetMessageFreeCallback)(virNetMessage *msg, void *opaque);
@@ -33,6 +36,7 @@ struct _virNetMessage {
                   /* Maximum   VIR_NET_MESSAGE_MAX     + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
     size_t bufferOffset;
+    size_t bufferAlloc; /* Allocated size of @buffer, 0 if unknown */
 
     virNetMessageHeader header;
 
@@ -55,6 +59,14 @@ void virNetMessageClear(virNetMessage *);
 
 void virNetMessageFree(virNetMessage *msg);
 
+void virNetMessageReserveBuffer(virNetMessage *msg,
+                                size_t len)
+    ATTRIBUTE_NONNULL(1);
+
+void virNetMessageGetPoolStats(unsigned long long *hits,
+                               unsigned long long *misses)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 virNetMessage *virNetMessageQueueServe(virNetMessage **queue)
     ATTRIBUTE_NONNULL(1);
 void virNetMessageQueuePush(virNetMessage **queue,
@@ -67,6 +79,8 @@ int virNetMessageDecodeLength(virNetMessage *msg)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 int virNetMessageDecodeHeader(virNetMessage *msg)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+int virNetMessageUpdateHeader(virNetMessage *msg)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
 int virNetMessageEncodePayload(virNetMessage *msg,
                                xdrproc_t filter,
@@ -77,6 +91,11 @@ int virNetMessageDecodePayload(virNetMessage *msg,
                                void *data)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
 
+bool virNetMessageCompressionSupported(void);
+bool virNetMessageCompress(virNetMessage *msg,
+                           size_t threshold)
+    ATTRIBUTE_NONNULL(1);
+
 int virNetMessageEncodeNumFDs(virNetMessage *msg);
 int virNetMessageDecodeNumFDs(virNetMessage *msg);
 
@@ -84,6 +103,12 @@ int virNetMessageEncodePayloadRaw(virNetMessage *msg,
                                   const char *buf,
                                   size_t len)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+char *virNetMessageEncodePayloadRawReserve(virNetMessage *msg,
+                                           size_t len)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+int virNetMessageEncodePayloadRawCommit(virNetMessage *msg,
+                                        size_t len)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 int virNetMessageEncodePayloadEmpty(virNetMessage *msg)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
@@ -149,6 +149,13 @@ const VIR_NET_MESSAGE_NUM_FDS_MAX = 32;
  *     * status == VIR_NET_OK
  *          <empty>
  *
+ * If both peers negotiated VIR_DRV_FEATURE_REMOTE_COMPRESSION, the
+ * VIR_NET_MESSAGE_TYPE_COMPRESSED bit may be set in 'type'. The payload
+ * described above is then replaced by
+ *
+ *          unsigned int - length of the uncompressed payload
+ *          byte[]       - zstd frame holding the payload
+ *
  */
 enum virNetMessageType {
     /* client -> server. args from a method call */
@@ -186,6 +193,9 @@ enum virNetMessageStatus {
 /* 4 byte length word per header */
 const VIR_NET_MESSAGE_HEADER_XDR_LEN = 4;
 
+/* Bit OR'ed into the message type if the payload is compressed */
+const VIR_NET_MESSAGE_TYPE_COMPRESSED = 1073741824;
+
 struct virNetMessageHeader {
     unsigned prog;              /* Unique ID for the program */
     unsigned vers;              /* Program version number */
@@ -66,6 +66,10 @@ struct _virNetServer {
     int keepaliveInterval;
     unsigned int keepaliveCount;
 
+    /* Minimal payload size to compress for clients that want it,
+     * 0 if compression is disabled */
+    size_t compressionThreshold;
+
     virNetTLSContext *tls;
 
     virNetServerClientPrivNew clientPrivNew;
@@ -193,7 +197,7 @@ virNetServerDispatchNewMessage(virNetServerClient *client,
 {
     virNetServer *srv = opaque;
     virNetServerProgram *prog = NULL;
-    unsigned int priority = 0;
+    unsigned int flags = 0;
 
     VIR_DEBUG("server=%p client=%p message=%p",
               srv, client, msg);
@@ -216,10 +220,13 @@ virNetServerDispatchNewMessage(virNetServerClient *client,
 
         if (prog) {
             job->prog = virObjectRef(prog);
-            priority = virNetServerProgramGetPriority(prog, msg->header.proc);
+            if (virNetServerProgramGetPriority(prog, msg->header.proc))
+                flags |= VIR_THREAD_POOL_JOB_PRIORITY;
+            if (virNetServerProgramIsMutating(prog, msg->header.proc))
+                flags |= VIR_THREAD_POOL_JOB_LIMITED;
         }
 
-        if (virThreadPoolSendJob(srv->workers, priority, job) < 0) {
+        if (virThreadPoolSendJob(srv->workers, flags, job) < 0) {
             virObjectUnref(client);
             VIR_FREE(job);
             virObjectUnref(prog);
@@ -987,7 +994,9 @@ virNetServerGetThreadPoolParameters(virNetServer *srv,
                                     size_t *nWorkers,
                                     size_t *freeWorkers,
                                     size_t *nPrioWorkers,
-                                    size_t *jobQueueDepth)
+                                    size_t *jobQueueDepth,
+                                    size_t *maxMutatingWorkers,
+                                    size_t *mutatingJobQueueDepth)
 {
     virObjectLock(srv);
 
@@ -997,22 +1006,35 @@ virNetServerGetThreadPoolParameters(virNetServer *srv,
     *nWorkers = virThreadPoolGetCurrentWorkers(srv->workers);
     *nPrioWorkers = virThreadPoolGetPriorityWorkers(srv->workers);
     *jobQueueDepth = virThreadPoolGetJobQueueDepth(srv->workers);
+    *maxMutatingWorkers = virThreadPoolGetMaxLimitedWorkers(srv->workers);
+    *mutatingJobQueueDepth = virThreadPoolGetLimitedJobQueueDepth(srv->workers);
 
     virObjectUnlock(srv);
     return 0;
 }
 
+void
+virNetServerGetThreadPoolStats(virNetServer *srv,
+                               virThreadPoolStats *stats)
+{
+    virObjectLock(srv);
+    virThreadPoolGetStats(srv->workers, stats);
+    virObjectUnlock(srv);
+}
+
 int
 virNetServerSetThreadPoolParameters(virNetServer *srv,
                                     long long int minWorkers,
                                     long long int maxWorkers,
-                                    long long int prioWorkers)
+                                    long long int prioWorkers,
+                                    long long int maxMutatingWorkers)
 {
     int ret;
 
     virObjectLock(srv);
     ret = virThreadPoolSetParameters(srv->workers, minWorkers,
-                                     maxWorkers, prioWorkers);
+                                     maxWorkers, prioWorkers,
+                                     maxMutatingWorkers);
     virObjectUnlock(srv);
 
     return ret;
@@ -1042,6 +1064,27 @@ virNetServerGetCurrentClients(virNetServer *srv)
     return ret;
 }
 
+size_t
+virNetServerGetCompressionThreshold(virNetServer *srv)
+{
+    size_t ret;
+
+    virObjectLock(srv);
+    ret = srv->compressionThreshold;
+    virObjectUnlock(srv);
+
+    return ret;
+}
+
+void
+virNetServerSetCompressionThreshold(virNetServer *srv,
+                                    size_t threshold)
+{
+    virObjectLock(srv);
+    srv->compressionThreshold = threshold;
+    virObjectUnlock(srv);
+}
+
 size_t
 virNetServerGetMaxUnauthClients(virNetServer *srv)
 {
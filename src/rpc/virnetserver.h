@@ -28,6 +28,7 @@
 #include "virobject.h"
 #include "virjson.h"
 #include "virsystemd.h"
+#include "virthreadpool.h"
 
 
 virNetServer *virNetServerNew(const char *name,
@@ -108,12 +109,18 @@ int virNetServerGetThreadPoolParameters(virNetServer *srv,
                                         size_t *nWorkers,
                                         size_t *freeWorkers,
                                         size_t *nPrioWorkers,
-                                        size_t *jobQueueDepth);
+                                        size_t *jobQueueDepth,
+                                        size_t *maxMutatingWorkers,
+                                        size_t *mutatingJobQueueDepth);
+
+void virNetServerGetThreadPoolStats(virNetServer *srv,
+                                    virThreadPoolStats *stats);
 
 int virNetServerSetThreadPoolParameters(virNetServer *srv,
                                         long long int minWorkers,
                                         long long int maxWorkers,
-                                        long long int prioWorkers);
+                                        long long int prioWorkers,
+                                        long long int maxMutatingWorkers);
 
 unsigned long long virNetServerNextClientID(virNetServer *srv);
 
@@ -135,4 +142,8 @@ int virNetServerSetClientLimits(virNetServer *srv,
                                 long long int maxClients,
                                 long long int maxClientsUnauth);
 
+size_t virNetServerGetCompressionThreshold(virNetServer *srv);
+void virNetServerSetCompressionThreshold(virNetServer *srv,
+                                         size_t threshold);
+
 int virNetServerUpdateTlsFiles(virNetServer *srv);
@@ -33,6 +33,7 @@
 #include "virerror.h"
 #include "viralloc.h"
 #include "virthread.h"
+#include "vireventthread.h"
 #include "virkeepalive.h"
 #include "virprobe.h"
 #include "virstring.h"
@@ -115,6 +116,13 @@ struct _virNetServerClient
     virNetServerClientCloseFunc privateDataCloseFunc;
 
     virKeepAlive *keepalive;
+
+    /* Minimal size of replies and events to compress, 0 if the client
+     * did not negotiate compression */
+    size_t compressThreshold;
+
+    /* Procedure statistics are kept sorted in @stats.procs */
+    virNetServerClientStats stats;
 };
 
 
@@ -186,6 +194,70 @@ virNetServerClientCalculateHandleMode(virNetServerClient *client)
     return mode;
 }
 
+/* Event loop threads client sockets are spread over, see
+ * virNetServerClientSetupEventThreads */
+static virMutex eventThreadsLock = VIR_MUTEX_INITIALIZER;
+static virEventThread **eventThreads;
+static size_t neventThreads;
+static size_t nextEventThread;
+
+
+/**
+ * virNetServerClientSetupEventThreads:
+ * @nthreads: number of event loop threads
+ *
+ * Start @nthreads event loop threads and from now on dispatch I/O of newly
+ * registered clients from them, assigning the threads round-robin, instead
+ * of from the default event loop. Reading and decoding messages of many
+ * busy clients then no longer contends on a single thread.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int virNetServerClientSetupEventThreads(size_t nthreads)
+{
+    size_t i;
+    int ret = -1;
+
+    virMutexLock(&eventThreadsLock);
+    if (neventThreads > 0) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("client event loop threads are already running"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        g_autofree char *name = g_strdup_printf("rpc-event-%zu", i);
+        virEventThread *evt;
+
+        if (!(evt = virEventThreadNew(name)))
+            goto cleanup;
+
+        VIR_APPEND_ELEMENT(eventThreads, neventThreads, evt);
+    }
+
+    ret = 0;
+
+ cleanup:
+    virMutexUnlock(&eventThreadsLock);
+    return ret;
+}
+
+
+static GMainContext *virNetServerClientNextEventContext(void)
+{
+    GMainContext *context = NULL;
+
+    virMutexLock(&eventThreadsLock);
+    if (neventThreads > 0) {
+        context = virEventThreadGetContext(eventThreads[nextEventThread]);
+        nextEventThread = (nextEventThread + 1) % neventThreads;
+    }
+    virMutexUnlock(&eventThreadsLock);
+
+    return context;
+}
+
+
 /*
  * @server: a locked or unlocked server object
  * @client: a locked client object
@@ -193,10 +265,14 @@ virNetServerClientCalculateHandleMode(virNetServerClient *client)
 static int virNetServerClientRegisterEvent(virNetServerClient *client)
 {
     int mode = virNetServerClientCalculateHandleMode(client);
+    GMainContext *context;
 
     if (!client->sock)
         return -1;
 
+    if ((context = virNetServerClientNextEventContext()))
+        virNetSocketSetEventContext(client->sock, context);
+
     virObjectRef(client);
     VIR_DEBUG("Registering client event callback %d", mode);
     if (virNetSocketAddIOCallback(client->sock,
@@ -309,7 +385,7 @@ virNetServerClientCheckAccess(virNetServerClient *client)
      * (NB. The '\1' byte is sent in an encrypted record).
      */
     confirm->bufferLength = 1;
-    confirm->buffer = g_new0(char, confirm->bufferLength);
+    virNetMessageReserveBuffer(confirm, confirm->bufferLength);
     confirm->bufferOffset = 0;
     confirm->buffer[0] = '\1';
 
@@ -409,7 +485,7 @@ virNetServerClientNewInternal(unsigned long long id,
     if (!(client->rx = virNetMessageNew(true)))
         goto error;
     client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-    client->rx->buffer = g_new0(char, client->rx->bufferLength);
+    virNetMessageReserveBuffer(client->rx, client->rx->bufferLength);
     client->nrequests = 1;
 
     PROBE(RPC_SERVER_CLIENT_NEW,
@@ -971,6 +1047,7 @@ void virNetServerClientDispose(void *obj)
     virObjectUnref(client->tls);
     virObjectUnref(client->tlsCtxt);
     virObjectUnref(client->sock);
+    g_free(client->stats.procs);
 }
 
 
@@ -1157,6 +1234,7 @@ static ssize_t virNetServerClientRead(virNetServerClient *client)
         return ret;
 
     client->rx->bufferOffset += ret;
+    client->stats.rxBytes += ret;
     return ret;
 }
 
@@ -1248,6 +1326,7 @@ static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
 
         /* Definitely finished reading, so remove from queue */
         virNetMessageQueueServe(&client->rx);
+        client->stats.rxMessages++;
         PROBE(RPC_SERVER_CLIENT_MSG_RX,
               "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
               client, msg->bufferLength,
@@ -1290,7 +1369,7 @@ static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
                 client->wantClose = true;
             } else {
                 client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                client->rx->buffer = g_new0(char, client->rx->bufferLength);
+                virNetMessageReserveBuffer(client->rx, client->rx->bufferLength);
                 client->nrequests++;
             }
         }
@@ -1301,9 +1380,17 @@ static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
 }
 
 
+/* Max number of queued messages written out with a single syscall */
+#define VIR_NET_SERVER_CLIENT_TX_BATCH 64
+
 /*
  * Send client->tx using no encoding
  *
+ * Messages queued behind client->tx are sent along with it, stopping
+ * at the first message which carries FDs, as those have to be sent
+ * right after the message data, or at a pending SASL session which
+ * must be enabled before sending any further data.
+ *
  * Returns:
  *   -1 on error or EOF
  *    0 on EAGAIN
@@ -1311,6 +1398,12 @@ static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
  */
 static ssize_t virNetServerClientWrite(virNetServerClient *client)
 {
+#ifndef WIN32
+    struct iovec iov[VIR_NET_SERVER_CLIENT_TX_BATCH];
+    virNetMessage *msg;
+    int niov = 0;
+    size_t done;
+#endif /* !WIN32 */
     ssize_t ret;
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
@@ -1324,6 +1417,37 @@ static ssize_t virNetServerClientWrite(virNetServerClient *client)
     if (client->tx->bufferLength == client->tx->bufferOffset)
         return 1;
 
+#ifndef WIN32
+    for (msg = client->tx;
+         msg && niov < VIR_NET_SERVER_CLIENT_TX_BATCH;
+         msg = msg->next) {
+        if (msg->bufferOffset < msg->bufferLength) {
+            iov[niov].iov_base = msg->buffer + msg->bufferOffset;
+            iov[niov].iov_len = msg->bufferLength - msg->bufferOffset;
+            niov++;
+        }
+
+        if (msg->nfds > 0)
+            break;
+# if WITH_SASL
+        if (client->sasl)
+            break;
+# endif
+    }
+
+    ret = virNetSocketWritev(client->sock, iov, niov);
+    if (ret <= 0)
+        return ret; /* -1 error, 0 = egain */
+
+    client->stats.txBytes += ret;
+    done = ret;
+    for (msg = client->tx; msg && done > 0; msg = msg->next) {
+        size_t len = MIN(msg->bufferLength - msg->bufferOffset, done);
+
+        msg->bufferOffset += len;
+        done -= len;
+    }
+#else /* WIN32 */
     ret = virNetSocketWrite(client->sock,
                             client->tx->buffer + client->tx->bufferOffset,
                             client->tx->bufferLength - client->tx->bufferOffset);
@@ -1331,6 +1455,8 @@ static ssize_t virNetServerClientWrite(virNetServerClient *client)
         return ret; /* -1 error, 0 = egain */
 
     client->tx->bufferOffset += ret;
+    client->stats.txBytes += ret;
+#endif /* WIN32 */
     return ret;
 }
 
@@ -1382,6 +1508,7 @@ virNetServerClientDispatchWrite(virNetServerClient *client)
 
             /* Get finished msg from head of tx queue */
             msg = virNetMessageQueueServe(&client->tx);
+            client->stats.txMessages++;
 
             if (msg->tracked) {
                 client->nrequests--;
@@ -1391,7 +1518,7 @@ virNetServerClientDispatchWrite(virNetServerClient *client)
                     /* Ready to recv more messages */
                     virNetMessageClear(msg);
                     msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                    msg->buffer = g_new0(char, msg->bufferLength);
+                    virNetMessageReserveBuffer(msg, msg->bufferLength);
                     client->rx = g_steal_pointer(&msg);
                     client->nrequests++;
                 }
@@ -1505,6 +1632,16 @@ int virNetServerClientSendMessage(virNetServerClient *client,
                                   virNetMessage *msg)
 {
     int ret;
+    size_t threshold;
+
+    virObjectLock(client);
+    threshold = client->compressThreshold;
+    virObjectUnlock(client);
+
+    /* Compress outside of the client lock, so that the event loop
+     * is not blocked on this client meanwhile */
+    if (threshold > 0)
+        virNetMessageCompress(msg, threshold);
 
     virObjectLock(client);
     ret = virNetServerClientSendMessageLocked(client, msg);
@@ -1605,6 +1742,34 @@ virNetServerClientStartKeepAlive(virNetServerClient *client)
     return ret;
 }
 
+
+/**
+ * virNetServerClientSetCompression:
+ * @client: the client
+ * @threshold: minimal payload size to compress, 0 to disable
+ *
+ * Enables compression of replies and events sent to @client, which
+ * has to be able to decompress them.
+ *
+ * Returns 0 on success, -1 if compression isn't supported.
+ */
+int
+virNetServerClientSetCompression(virNetServerClient *client,
+                                 size_t threshold)
+{
+    if (threshold > 0 && !virNetMessageCompressionSupported()) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                       _("message compression is not supported by this build"));
+        return -1;
+    }
+
+    virObjectLock(client);
+    client->compressThreshold = threshold;
+    virObjectUnlock(client);
+
+    return 0;
+}
+
 int
 virNetServerClientGetTransport(virNetServerClient *client)
 {
@@ -1659,6 +1824,92 @@ virNetServerClientGetInfo(virNetServerClient *client,
 }
 
 
+static int
+virNetServerClientProcStatsCompare(const void *key,
+                                   const void *elem)
+{
+    const virNetServerClientProcStats *a = key;
+    const virNetServerClientProcStats *b = elem;
+
+    if (a->prog != b->prog)
+        return a->prog < b->prog ? -1 : 1;
+    if (a->proc != b->proc)
+        return a->proc < b->proc ? -1 : 1;
+    return 0;
+}
+
+
+/**
+ * virNetServerClientRecordCall:
+ * @client: the client
+ * @prog: program of the call
+ * @proc: procedure of the call
+ * @usecs: time it took to dispatch the call
+ *
+ * Accounts a call dispatched on behalf of @client in its statistics.
+ * Callers should only record procedures the program knows about, so
+ * that a client can not make the statistics grow unbounded.
+ */
+void
+virNetServerClientRecordCall(virNetServerClient *client,
+                             unsigned int prog,
+                             int proc,
+                             unsigned long long usecs)
+{
+    virNetServerClientProcStats key = { .prog = prog, .proc = proc };
+    virNetServerClientProcStats *entry;
+    size_t bucket = 0;
+
+    if (usecs > 0)
+        bucket = MIN(g_bit_storage(usecs),
+                     VIR_NET_SERVER_CLIENT_LATENCY_BUCKETS - 1);
+
+    virObjectLock(client);
+
+    client->stats.calls++;
+    client->stats.latency[bucket]++;
+
+    entry = bsearch(&key, client->stats.procs, client->stats.nprocs,
+                    sizeof(*client->stats.procs),
+                    virNetServerClientProcStatsCompare);
+    if (!entry) {
+        size_t pos;
+
+        for (pos = 0; pos < client->stats.nprocs; pos++) {
+            if (virNetServerClientProcStatsCompare(&key,
+                                                   &client->stats.procs[pos]) < 0)
+                break;
+        }
+
+        VIR_INSERT_ELEMENT(client->stats.procs, pos, client->stats.nprocs, key);
+        entry = &client->stats.procs[pos];
+    }
+    entry->calls++;
+
+    virObjectUnlock(client);
+}
+
+
+/**
+ * virNetServerClientGetStats:
+ * @client: the client
+ * @stats: filled with a copy of the statistics of @client
+ *
+ * The caller must free @stats->procs.
+ */
+void
+virNetServerClientGetStats(virNetServerClient *client,
+                           virNetServerClientStats *stats)
+{
+    virObjectLock(client);
+    *stats = client->stats;
+    stats->procs = g_new0(virNetServerClientProcStats, stats->nprocs);
+    memcpy(stats->procs, client->stats.procs,
+           sizeof(*stats->procs) * stats->nprocs);
+    virObjectUnlock(client);
+}
+
+
 /**
  * virNetServerClientSetQuietEOF:
  *
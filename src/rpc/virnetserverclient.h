@@ -145,6 +145,8 @@ void virNetServerClientDelayedClose(virNetServerClient *client);
 void virNetServerClientImmediateClose(virNetServerClient *client);
 bool virNetServerClientWantCloseLocked(virNetServerClient *client);
 
+int virNetServerClientSetupEventThreads(size_t nthreads);
+
 int virNetServerClientInit(virNetServerClient *client);
 
 int virNetServerClientInitKeepAlive(virNetServerClient *client,
@@ -154,6 +156,9 @@ bool virNetServerClientCheckKeepAlive(virNetServerClient *client,
                                       virNetMessage *msg);
 int virNetServerClientStartKeepAlive(virNetServerClient *client);
 
+int virNetServerClientSetCompression(virNetServerClient *client,
+                                     size_t threshold);
+
 const char *virNetServerClientLocalAddrStringSASL(virNetServerClient *client);
 const char *virNetServerClientRemoteAddrStringSASL(virNetServerClient *client);
 const char *virNetServerClientRemoteAddrStringURI(virNetServerClient *client);
@@ -170,4 +175,37 @@ int virNetServerClientGetInfo(virNetServerClient *client,
                               bool *readonly, char **sock_addr,
                               virIdentity **identity);
 
+/* Bucket 0 counts calls which took less than a microsecond, bucket N > 0
+ * those which took [2^(N-1), 2^N) microseconds, the last one anything
+ * longer than that */
+#define VIR_NET_SERVER_CLIENT_LATENCY_BUCKETS 32
+
+typedef struct _virNetServerClientProcStats virNetServerClientProcStats;
+struct _virNetServerClientProcStats {
+    unsigned int prog;
+    int proc;
+    unsigned long long calls;
+};
+
+typedef struct _virNetServerClientStats virNetServerClientStats;
+struct _virNetServerClientStats {
+    unsigned long long rxBytes;
+    unsigned long long txBytes;
+    unsigned long long rxMessages;
+    unsigned long long txMessages;
+    unsigned long long calls;
+    unsigned long long latency[VIR_NET_SERVER_CLIENT_LATENCY_BUCKETS];
+
+    /* Sorted by program and procedure */
+    size_t nprocs;
+    virNetServerClientProcStats *procs;
+};
+
+void virNetServerClientRecordCall(virNetServerClient *client,
+                                  unsigned int prog,
+                                  int proc,
+                                  unsigned long long usecs);
+void virNetServerClientGetStats(virNetServerClient *client,
+                                virNetServerClientStats *stats);
+
 void virNetServerClientSetQuietEOF(virNetServerClient *client);
@@ -28,6 +28,7 @@
 #include "virerror.h"
 #include "virlog.h"
 #include "virfile.h"
+#include "virprobe.h"
 #include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
@@ -41,6 +42,9 @@ struct _virNetServerProgram {
     unsigned version;
     virNetServerProgramProc *procs;
     size_t nprocs;
+
+    virNetServerProgramForwardFunc forwardFunc;
+    void *forwardOpaque;
 };
 
 
@@ -82,6 +86,29 @@ virNetServerProgram *virNetServerProgramNew(unsigned program,
 }
 
 
+/**
+ * virNetServerProgramSetForwarder:
+ * @prog: the program
+ * @func: the callback relaying calls, or NULL
+ * @opaque: data passed to @func
+ *
+ * Makes calls of forwardable procedures of @prog go to @func with
+ * their arguments still encoded, instead of being decoded and run
+ * by the dispatcher of the procedure. The header of such calls is
+ * still checked, in particular the client has to be authenticated
+ * and read-only clients don't get to forward calls modifying any
+ * state. Must be called before the program is added to a server.
+ */
+void
+virNetServerProgramSetForwarder(virNetServerProgram *prog,
+                                virNetServerProgramForwardFunc func,
+                                void *opaque)
+{
+    prog->forwardFunc = func;
+    prog->forwardOpaque = opaque;
+}
+
+
 int virNetServerProgramGetID(virNetServerProgram *prog)
 {
     return prog->program;
@@ -134,15 +161,26 @@ virNetServerProgramGetPriority(virNetServerProgram *prog,
     return proc->priority;
 }
 
+bool
+virNetServerProgramIsMutating(virNetServerProgram *prog,
+                              int procedure)
+{
+    virNetServerProgramProc *proc = virNetServerProgramGetProc(prog, procedure);
+
+    if (!proc)
+        return false;
+
+    return proc->mutating;
+}
+
 static int
-virNetServerProgramSendError(unsigned program,
-                             unsigned version,
-                             virNetServerClient *client,
-                             virNetMessage *msg,
-                             struct virNetMessageError *rerr,
-                             int procedure,
-                             int type,
-                             unsigned int serial)
+virNetServerProgramEncodeError(unsigned program,
+                               unsigned version,
+                               virNetMessage *msg,
+                               struct virNetMessageError *rerr,
+                               int procedure,
+                               int type,
+                               unsigned int serial)
 {
     VIR_DEBUG("prog=%d ver=%d proc=%d type=%d serial=%u msg=%p rerr=%p",
               program, version, procedure, type, serial, msg, rerr);
@@ -164,10 +202,6 @@ virNetServerProgramSendError(unsigned program,
         goto error;
     xdr_free((xdrproc_t)xdr_virNetMessageError, (void*)rerr);
 
-    /* Put reply on end of tx queue to send out  */
-    if (virNetServerClientSendMessage(client, msg) < 0)
-        return -1;
-
     return 0;
 
  error:
@@ -177,6 +211,28 @@ virNetServerProgramSendError(unsigned program,
 }
 
 
+static int
+virNetServerProgramSendError(unsigned program,
+                             unsigned version,
+                             virNetServerClient *client,
+                             virNetMessage *msg,
+                             struct virNetMessageError *rerr,
+                             int procedure,
+                             int type,
+                             unsigned int serial)
+{
+    if (virNetServerProgramEncodeError(program, version, msg, rerr,
+                                       procedure, type, serial) < 0)
+        return -1;
+
+    /* Put reply on end of tx queue to send out  */
+    if (virNetServerClientSendMessage(client, msg) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 /*
  * @client: the client to send the error to
  * @req: the message this error is in reply to
@@ -252,6 +308,18 @@ virNetServerProgramDispatchCall(virNetServerProgram *prog,
                                 virNetServerClient *client,
                                 virNetMessage *msg);
 
+static int
+virNetServerProgramRunCall(virNetServerProgram *prog,
+                           virNetServer *server,
+                           virNetServerClient *client,
+                           virNetMessage *msg);
+
+static int
+virNetServerProgramForwardCall(virNetServerProgram *prog,
+                               virNetServer *server,
+                               virNetServerClient *client,
+                               virNetMessage *msg);
+
 /*
  * @server: the unlocked server object
  * @client: the unlocked client object
@@ -347,6 +415,52 @@ int virNetServerProgramDispatch(virNetServerProgram *prog,
 }
 
 
+/**
+ * virNetServerProgramDispatchInline:
+ * @prog: the program
+ * @server: the unlocked server object
+ * @client: the unlocked client object
+ * @msg: a call, whose header is filled in and whose payload holds
+ *       nothing but the encoded arguments
+ *
+ * Runs the call in the current thread rather than queueing it to a
+ * worker, and leaves the encoded reply in @msg instead of sending it.
+ * This is intended for procedures which carry several calls in one
+ * message. Only calls which do not modify any state may be run this
+ * way, anything else gets an error reply.
+ *
+ * Upon return @msg->header.status tells whether the payload following
+ * the header in @msg->buffer holds the return value of the procedure,
+ * or an error.
+ *
+ * Returns 0 if @msg holds a reply, -1 upon fatal error
+ */
+int
+virNetServerProgramDispatchInline(virNetServerProgram *prog,
+                                  virNetServer *server,
+                                  virNetServerClient *client,
+                                  virNetMessage *msg)
+{
+    virNetServerProgramProc *dispatcher;
+
+    dispatcher = virNetServerProgramGetProc(prog, msg->header.proc);
+
+    if (dispatcher && (dispatcher->mutating || !dispatcher->needAuth)) {
+        virNetMessageError rerr;
+
+        memset(&rerr, 0, sizeof(rerr));
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("procedure %d cannot be batched"),
+                       msg->header.proc);
+        return virNetServerProgramEncodeError(prog->program, prog->version,
+                                              msg, &rerr, msg->header.proc,
+                                              VIR_NET_REPLY, msg->header.serial);
+    }
+
+    return virNetServerProgramRunCall(prog, server, client, msg);
+}
+
+
 /*
  * @server: the unlocked server object
  * @client: the unlocked client object
@@ -364,17 +478,108 @@ virNetServerProgramDispatchCall(virNetServerProgram *prog,
                                 virNetServer *server,
                                 virNetServerClient *client,
                                 virNetMessage *msg)
+{
+    int rc = 0;
+
+    if (prog->forwardFunc &&
+        (rc = virNetServerProgramForwardCall(prog, server, client, msg)) < 0)
+        return -1;
+
+    if (rc == 0 &&
+        virNetServerProgramRunCall(prog, server, client, msg) < 0)
+        return -1;
+
+    /* Put reply on end of tx queue to send out  */
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
+/*
+ * Hands the call in @msg over to the forwarder of @prog if the
+ * procedure allows it, judging by the header only. Returns 1 if
+ * @msg was replaced with the encoded reply or error, 0 if the call
+ * has to be run locally and -1 if not even the error could be
+ * encoded.
+ */
+static int
+virNetServerProgramForwardCall(virNetServerProgram *prog,
+                               virNetServer *server,
+                               virNetServerClient *client,
+                               virNetMessage *msg)
+{
+    virNetServerProgramProc *dispatcher;
+    virNetMessageError rerr;
+    gint64 start = g_get_monotonic_time();
+    int rc;
+
+    /* anything unusual is left to virNetServerProgramRunCall, which
+     * also reports the errors */
+    if (msg->header.type != VIR_NET_CALL ||
+        msg->header.status != VIR_NET_OK ||
+        !(dispatcher = virNetServerProgramGetProc(prog, msg->header.proc)) ||
+        !dispatcher->forwardable ||
+        !dispatcher->needAuth ||
+        !virNetServerClientIsAuthenticated(client) ||
+        (dispatcher->mutating && virNetServerClientGetReadonly(client)))
+        return 0;
+
+    memset(&rerr, 0, sizeof(rerr));
+
+    PROBE_QUIET(RPC_SERVER_DISPATCH_START,
+                "client=%p prog=%d vers=%d proc=%d serial=%u",
+                client, msg->header.prog, msg->header.vers,
+                msg->header.proc, msg->header.serial);
+
+    rc = prog->forwardFunc(server, client, msg, prog->forwardOpaque);
+
+    if (rc != 0)
+        virNetServerClientRecordCall(client, prog->program, msg->header.proc,
+                                     g_get_monotonic_time() - start);
+    PROBE_QUIET(RPC_SERVER_DISPATCH_END,
+                "client=%p prog=%d vers=%d proc=%d serial=%u usec=%llu ret=%d",
+                client, msg->header.prog, msg->header.vers,
+                msg->header.proc, msg->header.serial,
+                (unsigned long long)(g_get_monotonic_time() - start),
+                rc < 0 ? -1 : 0);
+
+    if (rc >= 0)
+        return rc;
+
+    if (virNetServerProgramEncodeError(prog->program, prog->version,
+                                       msg, &rerr, msg->header.proc,
+                                       VIR_NET_REPLY, msg->header.serial) < 0)
+        return -1;
+
+    return 1;
+}
+
+
+/*
+ * Runs the call in @msg and replaces it with the encoded reply
+ * or error. Returns -1 if not even the error could be encoded.
+ */
+static int
+virNetServerProgramRunCall(virNetServerProgram *prog,
+                           virNetServer *server,
+                           virNetServerClient *client,
+                           virNetMessage *msg)
 {
     g_autofree char *arg = NULL;
     g_autofree char *ret = NULL;
     int rv = -1;
-    virNetServerProgramProc *dispatcher;
+    virNetServerProgramProc *dispatcher = NULL;
     virNetMessageError rerr;
     size_t i;
     g_autoptr(virIdentity) identity = NULL;
+    gint64 start = g_get_monotonic_time();
 
     memset(&rerr, 0, sizeof(rerr));
 
+    PROBE_QUIET(RPC_SERVER_DISPATCH_START,
+                "client=%p prog=%d vers=%d proc=%d serial=%u",
+                client, msg->header.prog, msg->header.vers,
+                msg->header.proc, msg->header.serial);
+
     if (msg->header.status != VIR_NET_OK) {
         virReportError(VIR_ERR_RPC,
                        _("Unexpected message status %u"),
@@ -478,15 +683,31 @@ virNetServerProgramDispatchCall(virNetServerProgram *prog,
 
     xdr_free(dispatcher->ret_filter, ret);
 
-    /* Put reply on end of tx queue to send out  */
-    return virNetServerClientSendMessage(client, msg);
+    virNetServerClientRecordCall(client, prog->program, msg->header.proc,
+                                 g_get_monotonic_time() - start);
+    PROBE_QUIET(RPC_SERVER_DISPATCH_END,
+                "client=%p prog=%d vers=%d proc=%d serial=%u usec=%llu ret=%d",
+                client, msg->header.prog, msg->header.vers,
+                msg->header.proc, msg->header.serial,
+                (unsigned long long)(g_get_monotonic_time() - start), 0);
+
+    return 0;
 
  error:
+    if (dispatcher)
+        virNetServerClientRecordCall(client, prog->program, msg->header.proc,
+                                     g_get_monotonic_time() - start);
+    PROBE_QUIET(RPC_SERVER_DISPATCH_END,
+                "client=%p prog=%d vers=%d proc=%d serial=%u usec=%llu ret=%d",
+                client, msg->header.prog, msg->header.vers,
+                msg->header.proc, msg->header.serial,
+                (unsigned long long)(g_get_monotonic_time() - start), -1);
+
     /* Bad stuff (de-)serializing message, but we have an
      * RPC error message we can send back to the client */
-    rv = virNetServerProgramSendReplyError(prog, client, msg, &rerr, &msg->header);
-
-    return rv;
+    return virNetServerProgramEncodeError(prog->program, prog->version,
+                                          msg, &rerr, msg->header.proc,
+                                          VIR_NET_REPLY, msg->header.serial);
 }
 
 
@@ -532,6 +753,49 @@ int virNetServerProgramSendStreamData(virNetServerProgram *prog,
 }
 
 
+/*
+ * Like virNetServerProgramSendStreamData, but instead of copying
+ * data from a caller supplied buffer, returns a pointer into @msg
+ * where up to @len bytes of stream data can be stored directly.
+ * The message is then sent by virNetServerProgramSendPreparedStreamData.
+ *
+ * Returns pointer to data area, NULL on error
+ */
+char *virNetServerProgramPrepareStreamData(virNetServerProgram *prog,
+                                           virNetMessage *msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len)
+{
+    VIR_DEBUG("msg=%p len=%zu", msg, len);
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.proc = procedure;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = serial;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        return NULL;
+
+    return virNetMessageEncodePayloadRawReserve(msg, len);
+}
+
+
+int virNetServerProgramSendPreparedStreamData(virNetServerClient *client,
+                                              virNetMessage *msg,
+                                              size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p len=%zu", client, msg, len);
+
+    if (virNetMessageEncodePayloadRawCommit(msg, len) < 0)
+        return -1;
+
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
 int virNetServerProgramSendStreamHole(virNetServerProgram *prog,
                                       virNetServerClient *client,
                                       virNetMessage *msg,
@@ -48,19 +48,40 @@ struct _virNetServerProgramProc {
     xdrproc_t ret_filter;
     bool needAuth;
     unsigned int priority;
+    bool mutating; /* false for calls which only query state */
+    bool forwardable; /* true for plain calls without streams or FDs */
 };
 
+/*
+ * Relays the call in @msg, whose payload is left encoded, somewhere
+ * else and replaces it with the encoded reply.
+ *
+ * Returns 1 if @msg holds the reply, 0 if the call was not forwarded
+ * and has to be dispatched as usual, -1 on error.
+ */
+typedef int (*virNetServerProgramForwardFunc)(virNetServer *server,
+                                              virNetServerClient *client,
+                                              virNetMessage *msg,
+                                              void *opaque);
+
 virNetServerProgram *virNetServerProgramNew(unsigned program,
                                               unsigned version,
                                               virNetServerProgramProc *procs,
                                               size_t nprocs);
 
+void virNetServerProgramSetForwarder(virNetServerProgram *prog,
+                                     virNetServerProgramForwardFunc func,
+                                     void *opaque);
+
 int virNetServerProgramGetID(virNetServerProgram *prog);
 int virNetServerProgramGetVersion(virNetServerProgram *prog);
 
 unsigned int virNetServerProgramGetPriority(virNetServerProgram *prog,
                                             int procedure);
 
+bool virNetServerProgramIsMutating(virNetServerProgram *prog,
+                                   int procedure);
+
 int virNetServerProgramMatches(virNetServerProgram *prog,
                                virNetMessage *msg);
 
@@ -69,6 +90,11 @@ int virNetServerProgramDispatch(virNetServerProgram *prog,
                                 virNetServerClient *client,
                                 virNetMessage *msg);
 
+int virNetServerProgramDispatchInline(virNetServerProgram *prog,
+                                      virNetServer *server,
+                                      virNetServerClient *client,
+                                      virNetMessage *msg);
+
 int virNetServerProgramSendReplyError(virNetServerProgram *prog,
                                       virNetServerClient *client,
                                       virNetMessage *msg,
@@ -94,6 +120,16 @@ int virNetServerProgramSendStreamData(virNetServerProgram *prog,
                                       const char *data,
                                       size_t len);
 
+char *virNetServerProgramPrepareStreamData(virNetServerProgram *prog,
+                                           virNetMessage *msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           size_t len);
+
+int virNetServerProgramSendPreparedStreamData(virNetServerClient *client,
+                                              virNetMessage *msg,
+                                              size_t len);
+
 int virNetServerProgramSendStreamHole(virNetServerProgram *prog,
                                       virNetServerClient *client,
                                       virNetMessage *msg,
@@ -39,6 +39,7 @@
 
 #include "virsocket.h"
 #include "virnetsocket.h"
+#include "virnetsocketuring.h"
 #include "virutil.h"
 #include "viralloc.h"
 #include "virerror.h"
@@ -49,6 +50,7 @@
 #include "virprobe.h"
 #include "virprocess.h"
 #include "virstring.h"
+#include "vireventglibwatch.h"
 
 #if WITH_SSH2
 # include "virnetsshsession.h"
@@ -73,11 +75,23 @@ struct _virNetSocket {
     bool ownsFd;
     bool quietEOF;
     bool unlinkUNIX;
+    bool accepted;
 
     /* Event callback fields */
     virNetSocketIOFunc func;
     void *opaque;
     virFreeCallback ff;
+    int events;
+
+    /* Set if the callback is dispatched from a dedicated event loop
+     * thread instead of the default event loop */
+    GMainContext *context;
+    GSource *source;
+    bool contextWatch;
+
+    /* Set if receiving and accepting is done through io_uring */
+    virNetSocketUring *uring;
+    int uringTimer;
 
     virSocketAddr localAddr;
     virSocketAddr remoteAddr;
@@ -263,6 +277,7 @@ virNetSocketNew(virSocketAddr *localAddr,
     sock->errfd = errfd;
     sock->pid = pid;
     sock->watch = -1;
+    sock->uringTimer = -1;
     sock->ownsFd = true;
     sock->isClient = isClient;
     sock->unlinkUNIX = unlinkUNIX;
@@ -1246,6 +1261,11 @@ virJSONValue *virNetSocketPreExecRestart(virNetSocket *sock)
                        _("Unable to save socket state when TLS session is active"));
         goto error;
     }
+    if (sock->uring) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("Unable to save socket state when io_uring is used"));
+        goto error;
+    }
 
     object = virJSONValueNewObject();
 
@@ -1299,6 +1319,15 @@ void virNetSocketDispose(void *obj)
         sock->watch = -1;
     }
 
+    virNetSocketUringDetach(g_steal_pointer(&sock->uring));
+
+    if (sock->source) {
+        g_source_destroy(sock->source);
+        g_clear_pointer(&sock->source, g_source_unref);
+    }
+    if (sock->context)
+        g_main_context_unref(sock->context);
+
 #ifndef WIN32
     /* If a server socket, then unlink UNIX path */
     if (sock->unlinkUNIX &&
@@ -1627,12 +1656,21 @@ static ssize_t virNetSocketTLSSessionWrite(const char *buf,
 }
 
 
+/* Plain read of the socket, going through the io_uring queue if enabled */
+static ssize_t virNetSocketReadFD(virNetSocket *sock, char *buf, size_t len)
+{
+    if (sock->uring)
+        return virNetSocketUringRecv(sock->uring, buf, len);
+    return read(sock->fd, buf, len);
+}
+
+
 static ssize_t virNetSocketTLSSessionRead(char *buf,
                                           size_t len,
                                           void *opaque)
 {
     virNetSocket *sock = opaque;
-    return read(sock->fd, buf, len);
+    return virNetSocketReadFD(sock, buf, len);
 }
 
 
@@ -1642,10 +1680,17 @@ void virNetSocketSetTLSSession(virNetSocket *sock,
     virObjectLock(sock);
     virObjectUnref(sock->tlsSession);
     sock->tlsSession = virObjectRef(sess);
-    virNetTLSSessionSetIOCallbacks(sess,
-                                   virNetSocketTLSSessionWrite,
-                                   virNetSocketTLSSessionRead,
-                                   sock);
+    /* Plain TCP connections are handed to GnuTLS directly, so
+     * that it can use kernel TLS offload */
+    if (!sock->uring &&
+        (sock->localAddr.data.sa.sa_family == AF_INET ||
+         sock->localAddr.data.sa.sa_family == AF_INET6))
+        virNetTLSSessionSetFD(sess, sock->fd);
+    else
+        virNetTLSSessionSetIOCallbacks(sess,
+                                       virNetSocketTLSSessionWrite,
+                                       virNetSocketTLSSessionRead,
+                                       sock);
     virObjectUnlock(sock);
 }
 
@@ -1680,6 +1725,10 @@ bool virNetSocketHasCachedData(virNetSocket *sock G_GNUC_UNUSED)
     if (sock->saslDecoded)
         hasCached = true;
 #endif
+
+    if (sock->uring && virNetSocketUringHasPending(sock->uring))
+        hasCached = true;
+
     virObjectUnlock(sock);
     return hasCached;
 }
@@ -1750,7 +1799,7 @@ static ssize_t virNetSocketReadWire(virNetSocket *sock, char *buf, size_t len)
         VIR_NET_TLS_HANDSHAKE_COMPLETE) {
         ret = virNetTLSSessionRead(sock->tlsSession, buf, len);
     } else {
-        ret = read(sock->fd, buf, len);
+        ret = virNetSocketReadFD(sock, buf, len);
     }
 
     if ((ret < 0) && (errno == EINTR))
@@ -1973,6 +2022,80 @@ ssize_t virNetSocketWrite(virNetSocket *sock, const char *buf, size_t len)
 }
 
 
+#ifndef WIN32
+/*
+ * Write out data from multiple buffers using a single syscall.
+ * Transports which need to encode the data (TLS, SASL, SSH) are
+ * only handed the first buffer, so callers must cope with short
+ * writes in any case.
+ *
+ * Returns number of bytes written, 0 on EAGAIN, -1 on error
+ */
+ssize_t virNetSocketWritev(virNetSocket *sock,
+                           const struct iovec *iov,
+                           int iovcnt)
+{
+    bool encoded = false;
+    ssize_t ret;
+
+    if (iovcnt == 1)
+        return virNetSocketWrite(sock, iov[0].iov_base, iov[0].iov_len);
+
+    virObjectLock(sock);
+
+    if (sock->tlsSession)
+        encoded = true;
+# if WITH_SASL
+    if (sock->saslSession)
+        encoded = true;
+# endif
+# if WITH_SSH2
+    if (sock->sshSession)
+        encoded = true;
+# endif
+# if WITH_LIBSSH
+    if (sock->libsshSession)
+        encoded = true;
+# endif
+
+    if (encoded) {
+        virObjectUnlock(sock);
+        return virNetSocketWrite(sock, iov[0].iov_base, iov[0].iov_len);
+    }
+
+ rewrite:
+    ret = writev(sock->fd, iov, iovcnt);
+
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto rewrite;
+        if (errno == EAGAIN) {
+            ret = 0;
+        } else {
+            virReportSystemError(errno, "%s",
+                                 _("Cannot write data"));
+        }
+    } else if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while writing data"));
+        ret = -1;
+    }
+
+    virObjectUnlock(sock);
+    return ret;
+}
+#else /* WIN32 */
+ssize_t virNetSocketWritev(virNetSocket *sock G_GNUC_UNUSED,
+                           const struct iovec *iov G_GNUC_UNUSED,
+                           int iovcnt G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Vectored writes are not supported on this platform"));
+    return -1;
+}
+#endif /* WIN32 */
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
@@ -2078,7 +2201,12 @@ int virNetSocketAccept(virNetSocket *sock, virNetSocket **clientsock)
     memset(&remoteAddr, 0, sizeof(remoteAddr));
 
     remoteAddr.len = sizeof(remoteAddr.data.stor);
-    if ((fd = accept(sock->fd, &remoteAddr.data.sa, &remoteAddr.len)) < 0) {
+    if (sock->uring)
+        fd = virNetSocketUringAccept(sock->uring);
+    else
+        fd = accept(sock->fd, &remoteAddr.data.sa, &remoteAddr.len);
+
+    if (fd < 0) {
         if (errno == ECONNABORTED ||
             errno == EAGAIN) {
             ret = 0;
@@ -2092,6 +2220,17 @@ int virNetSocketAccept(virNetSocket *sock, virNetSocket **clientsock)
         goto cleanup;
     }
 
+    /* Connections accepted through io_uring come without peer address */
+    if (sock->uring &&
+        getpeername(fd, &remoteAddr.data.sa, &remoteAddr.len) < 0) {
+        if (errno == ENOTCONN) {
+            ret = 0;
+            goto cleanup;
+        }
+        virReportSystemError(errno, "%s", _("Unable to get peer socket name"));
+        goto cleanup;
+    }
+
     localAddr.len = sizeof(localAddr.data);
     if (getsockname(fd, &localAddr.data.sa, &localAddr.len) < 0) {
         virReportSystemError(errno, "%s", _("Unable to get local socket name"));
@@ -2105,6 +2244,7 @@ int virNetSocketAccept(virNetSocket *sock, virNetSocket **clientsock)
                                         false)))
         goto cleanup;
 
+    (*clientsock)->accepted = true;
     fd = -1;
     ret = 0;
 
@@ -2152,6 +2292,195 @@ static void virNetSocketEventFree(void *opaque)
         ff(eopaque);
 }
 
+/*
+ * With io_uring the readability of a socket is no longer reported
+ * by the watch on its file descriptor. Instead this timer fires for
+ * as long as data is waiting in the io_uring queue and the callback
+ * asked for readable events.
+ */
+static void virNetSocketUringTimer(int timer,
+                                   void *opaque)
+{
+    virNetSocket *sock = opaque;
+    virNetSocketIOFunc func;
+    void *eopaque;
+    bool readable;
+
+    virObjectLock(sock);
+    readable = sock->uring &&
+        (sock->events & VIR_EVENT_HANDLE_READABLE) &&
+        virNetSocketUringHasPending(sock->uring);
+    if (!readable)
+        virEventUpdateTimeout(timer, -1);
+    func = sock->func;
+    eopaque = sock->opaque;
+    virObjectUnlock(sock);
+
+    if (readable && func)
+        func(sock, VIR_EVENT_HANDLE_READABLE, eopaque);
+}
+
+
+/*
+ * Only sockets of the server side are handed over to io_uring: the
+ * listening ones and TCP connections accepted from them. Connections
+ * on UNIX sockets receive file descriptors which a plain receive
+ * would lose.
+ */
+static bool virNetSocketWantsUring(virNetSocket *sock)
+{
+    int listening = 0;
+    socklen_t len = sizeof(listening);
+
+    if (!virNetSocketUringIsEnabled())
+        return false;
+
+    if (sock->accepted)
+        return sock->localAddr.data.sa.sa_family == AF_INET ||
+            sock->localAddr.data.sa.sa_family == AF_INET6;
+
+    if (sock->isClient)
+        return false;
+
+    return getsockopt(sock->fd, SOL_SOCKET, SO_ACCEPTCONN,
+                      &listening, &len) == 0 && listening;
+}
+
+
+static void virNetSocketUringStop(virNetSocket *sock)
+{
+    virNetSocketUringDetach(g_steal_pointer(&sock->uring));
+
+    if (sock->uringTimer >= 0) {
+        virEventRemoveTimeout(sock->uringTimer);
+        sock->uringTimer = -1;
+    }
+}
+
+
+static int virNetSocketUringStart(virNetSocket *sock)
+{
+    if ((sock->uringTimer = virEventAddTimeout(-1,
+                                               virNetSocketUringTimer,
+                                               virObjectRef(sock),
+                                               virObjectFreeCallback)) < 0) {
+        virObjectUnref(sock);
+        return -1;
+    }
+
+    if (!(sock->uring = virNetSocketUringAttach(sock->fd,
+                                                !sock->accepted,
+                                                sock->uringTimer))) {
+        virNetSocketUringStop(sock);
+        return -1;
+    }
+
+    /* From now on reads must go through the io_uring queue */
+    if (sock->tlsSession)
+        virNetTLSSessionSetIOCallbacks(sock->tlsSession,
+                                       virNetSocketTLSSessionWrite,
+                                       virNetSocketTLSSessionRead,
+                                       sock);
+
+    return 0;
+}
+
+
+static int virNetSocketWatchEvents(virNetSocket *sock,
+                                   int events)
+{
+    if (!sock->uring)
+        return events;
+
+    if ((events & VIR_EVENT_HANDLE_READABLE) &&
+        virNetSocketUringHasPending(sock->uring))
+        virEventUpdateTimeout(sock->uringTimer, 0);
+
+    return events & ~VIR_EVENT_HANDLE_READABLE;
+}
+
+
+static gboolean
+virNetSocketContextDispatch(int fd,
+                            GIOCondition condition,
+                            gpointer opaque)
+{
+    int events = 0;
+
+    if (condition & G_IO_IN)
+        events |= VIR_EVENT_HANDLE_READABLE;
+    if (condition & G_IO_OUT)
+        events |= VIR_EVENT_HANDLE_WRITABLE;
+    if (condition & (G_IO_ERR | G_IO_NVAL))
+        events |= VIR_EVENT_HANDLE_ERROR;
+    if (condition & G_IO_HUP)
+        events |= VIR_EVENT_HANDLE_HANGUP;
+
+    virNetSocketEventHandle(-1, fd, events, opaque);
+
+    return G_SOURCE_CONTINUE;
+}
+
+
+static gboolean
+virNetSocketContextFree(gpointer opaque)
+{
+    virNetSocketEventFree(opaque);
+
+    return G_SOURCE_REMOVE;
+}
+
+
+/* @sock must be locked */
+static void
+virNetSocketContextWatch(virNetSocket *sock,
+                         int events)
+{
+    GIOCondition cond = 0;
+
+    if (sock->source) {
+        g_source_destroy(sock->source);
+        g_clear_pointer(&sock->source, g_source_unref);
+    }
+
+    if (events == 0)
+        return;
+
+    if (events & VIR_EVENT_HANDLE_READABLE)
+        cond |= G_IO_IN;
+    if (events & VIR_EVENT_HANDLE_WRITABLE)
+        cond |= G_IO_OUT;
+
+    sock->source = virEventGLibAddSocketWatch(sock->fd, cond, sock->context,
+                                              virNetSocketContextDispatch,
+                                              sock, NULL);
+}
+
+
+/**
+ * virNetSocketSetEventContext:
+ * @sock: socket object
+ * @context: GLib main context
+ *
+ * Dispatch the callback registered by a later virNetSocketAddIOCallback
+ * from the thread running @context instead of the default event loop.
+ * Sockets using io_uring are always served by the default event loop.
+ */
+void virNetSocketSetEventContext(virNetSocket *sock,
+                                 GMainContext *context)
+{
+    virObjectLock(sock);
+    if (sock->watch >= 0 || sock->contextWatch) {
+        VIR_DEBUG("Watch already registered on socket %p", sock);
+    } else {
+        if (sock->context)
+            g_main_context_unref(sock->context);
+        sock->context = context ? g_main_context_ref(context) : NULL;
+    }
+    virObjectUnlock(sock);
+}
+
+
 int virNetSocketAddIOCallback(virNetSocket *sock,
                               int events,
                               virNetSocketIOFunc func,
@@ -2162,22 +2491,33 @@ int virNetSocketAddIOCallback(virNetSocket *sock,
 
     virObjectRef(sock);
     virObjectLock(sock);
-    if (sock->watch >= 0) {
+    if (sock->watch >= 0 || sock->contextWatch) {
         VIR_DEBUG("Watch already registered on socket %p", sock);
         goto cleanup;
     }
 
-    if ((sock->watch = virEventAddHandle(sock->fd,
-                                         events,
-                                         virNetSocketEventHandle,
-                                         sock,
-                                         virNetSocketEventFree)) < 0) {
+    if (virNetSocketWantsUring(sock) &&
+        virNetSocketUringStart(sock) < 0) {
+        VIR_DEBUG("Failed to set up io_uring on socket %p", sock);
+        goto cleanup;
+    }
+
+    if (sock->context && !sock->uring) {
+        sock->contextWatch = true;
+        virNetSocketContextWatch(sock, events);
+    } else if ((sock->watch = virEventAddHandle(sock->fd,
+                                                virNetSocketWatchEvents(sock, events),
+                                                virNetSocketEventHandle,
+                                                sock,
+                                                virNetSocketEventFree)) < 0) {
         VIR_DEBUG("Failed to register watch on socket %p", sock);
+        virNetSocketUringStop(sock);
         goto cleanup;
     }
     sock->func = func;
     sock->opaque = opaque;
     sock->ff = ff;
+    sock->events = events;
 
     ret = 0;
 
@@ -2192,13 +2532,22 @@ void virNetSocketUpdateIOCallback(virNetSocket *sock,
                                   int events)
 {
     virObjectLock(sock);
+    if (sock->contextWatch) {
+        if (sock->events != events)
+            virNetSocketContextWatch(sock, events);
+        sock->events = events;
+        virObjectUnlock(sock);
+        return;
+    }
+
     if (sock->watch < 0) {
         VIR_DEBUG("Watch not registered on socket %p", sock);
         virObjectUnlock(sock);
         return;
     }
 
-    virEventUpdateHandle(sock->watch, events);
+    sock->events = events;
+    virEventUpdateHandle(sock->watch, virNetSocketWatchEvents(sock, events));
 
     virObjectUnlock(sock);
 }
@@ -2207,6 +2556,23 @@ void virNetSocketRemoveIOCallback(virNetSocket *sock)
 {
     virObjectLock(sock);
 
+    if (sock->contextWatch) {
+        g_autoptr(GSource) idle = g_idle_source_new();
+
+        virNetSocketContextWatch(sock, 0);
+        sock->contextWatch = false;
+        sock->events = 0;
+
+        /* A callback may be running in the event loop thread right now,
+         * release @sock and the callback data from there once it is done.
+         * Don't unref @sock, it's done by virNetSocketContextFree. */
+        g_source_set_callback(idle, virNetSocketContextFree, sock, NULL);
+        g_source_attach(idle, sock->context);
+
+        virObjectUnlock(sock);
+        return;
+    }
+
     if (sock->watch < 0) {
         VIR_DEBUG("Watch not registered on socket %p", sock);
         virObjectUnlock(sock);
@@ -2216,6 +2582,9 @@ void virNetSocketRemoveIOCallback(virNetSocket *sock)
     virEventRemoveHandle(sock->watch);
     /* Don't unref @sock, it's done via eventloop callback. */
     sock->watch = -1;
+    sock->events = 0;
+
+    virNetSocketUringStop(sock);
 
     virObjectUnlock(sock);
 }
@@ -2227,6 +2596,9 @@ void virNetSocketClose(virNetSocket *sock)
 
     virObjectLock(sock);
 
+    /* The ring must let go of the socket before it is closed */
+    virNetSocketUringStop(sock);
+
     if (sock->fd != -1) {
         closesocket(sock->fd);
         sock->fd = -1;
@@ -21,6 +21,12 @@
 
 #pragma once
 
+#ifndef WIN32
+# include <sys/uio.h>
+#else
+struct iovec;
+#endif
+
 #include "virsocketaddr.h"
 #include "vircommand.h"
 #include "virnettlscontext.h"
@@ -144,6 +150,9 @@ void virNetSocketSetQuietEOF(virNetSocket *sock);
 
 ssize_t virNetSocketRead(virNetSocket *sock, char *buf, size_t len);
 ssize_t virNetSocketWrite(virNetSocket *sock, const char *buf, size_t len);
+ssize_t virNetSocketWritev(virNetSocket *sock,
+                           const struct iovec *iov,
+                           int iovcnt);
 
 int virNetSocketSendFD(virNetSocket *sock, int fd);
 int virNetSocketRecvFD(virNetSocket *sock, int *fd);
@@ -166,6 +175,9 @@ int virNetSocketListen(virNetSocket *sock, int backlog);
 int virNetSocketAccept(virNetSocket *sock,
                        virNetSocket **clientsock);
 
+void virNetSocketSetEventContext(virNetSocket *sock,
+                                 GMainContext *context);
+
 int virNetSocketAddIOCallback(virNetSocket *sock,
                               int events,
                               virNetSocketIOFunc func,
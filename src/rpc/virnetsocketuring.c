@@ -0,0 +1,679 @@
+/*
+ * virnetsocketuring.c: io_uring based socket receive and accept
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#if WITH_LIBURING
+# include <liburing.h>
+# include <sys/eventfd.h>
+#endif
+
+#include "virnetsocketuring.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virevent.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+VIR_LOG_INIT("rpc.netsocketuring");
+
+#if WITH_LIBURING
+
+/*
+ * A single ring is shared by all server sockets of the process. Each
+ * socket keeps one multishot request in flight, either a receive
+ * picking buffers from a ring of provided buffers or an accept. The
+ * completions are reaped from the event loop, which gets woken up
+ * through an eventfd registered with the ring. Received data is
+ * copied out of the provided buffer so that the buffer can be handed
+ * back to the kernel right away and a slow reader can't starve the
+ * other sockets.
+ *
+ * Readiness is emulated for the callers of virNetSocket: a socket is
+ * readable as long as its queue holds data, accepted file descriptors,
+ * an error or EOF, and the event loop timer passed to
+ * virNetSocketUringAttach is kicked whenever something was queued.
+ *
+ * Everything is protected by the lock of the ring, all the users of
+ * a socket run in the event loop thread anyway.
+ */
+
+# define VIR_NET_SOCKET_URING_ENTRIES 512
+# define VIR_NET_SOCKET_URING_BUFFERS 256
+# define VIR_NET_SOCKET_URING_BUFFER_SIZE (64 * 1024)
+# define VIR_NET_SOCKET_URING_BUFFER_GROUP 0
+
+/* Stop receiving once this much data waits to be read by a socket,
+ * so that throttled clients are still subject to TCP flow control. */
+# define VIR_NET_SOCKET_URING_MAX_QUEUED (256 * 1024)
+/* Number of accepted connections queued on a listening socket */
+# define VIR_NET_SOCKET_URING_MAX_FDS 16
+
+typedef struct _virNetSocketUringChunk virNetSocketUringChunk;
+struct _virNetSocketUringChunk {
+    virNetSocketUringChunk *next;
+    size_t len;
+    size_t offset;
+    char data[];
+};
+
+struct _virNetSocketUring {
+    int fd;
+    bool listening;
+    int timer; /* -1 once detached */
+
+    bool armed; /* multishot request in flight */
+    bool cancelled; /* cancellation of the request was submitted */
+
+    virNetSocketUringChunk *head;
+    virNetSocketUringChunk *tail;
+    int *fds;
+    size_t nfds;
+    size_t queued;
+
+    int err;
+    bool eof;
+};
+
+typedef struct _virNetSocketUringContext virNetSocketUringContext;
+struct _virNetSocketUringContext {
+    virMutex lock;
+    struct io_uring ring;
+    struct io_uring_buf_ring *bufRing;
+    char *buffers;
+    int efd;
+    int watch;
+};
+
+static virNetSocketUringContext *virNetSocketUringCtx;
+
+
+static void
+virNetSocketUringFree(virNetSocketUring *handle)
+{
+    size_t i;
+
+    while (handle->head) {
+        virNetSocketUringChunk *chunk = handle->head;
+
+        handle->head = chunk->next;
+        g_free(chunk);
+    }
+
+    for (i = 0; i < handle->nfds; i++)
+        VIR_FORCE_CLOSE(handle->fds[i]);
+    g_free(handle->fds);
+    g_free(handle);
+}
+
+
+static struct io_uring_sqe *
+virNetSocketUringGetSQE(virNetSocketUringContext *ctx)
+{
+    struct io_uring_sqe *sqe;
+
+    if ((sqe = io_uring_get_sqe(&ctx->ring)))
+        return sqe;
+
+    /* Submission queue is full, flush it and try again */
+    io_uring_submit(&ctx->ring);
+    return io_uring_get_sqe(&ctx->ring);
+}
+
+
+static int
+virNetSocketUringArmLocked(virNetSocketUringContext *ctx,
+                           virNetSocketUring *handle)
+{
+    struct io_uring_sqe *sqe;
+    int rc;
+
+    if (!(sqe = virNetSocketUringGetSQE(ctx)))
+        return -EBUSY;
+
+    if (handle->listening) {
+        io_uring_prep_multishot_accept(sqe, handle->fd, NULL, NULL,
+                                       SOCK_CLOEXEC);
+    } else {
+        io_uring_prep_recv_multishot(sqe, handle->fd, NULL, 0, 0);
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = VIR_NET_SOCKET_URING_BUFFER_GROUP;
+    }
+    io_uring_sqe_set_data(sqe, handle);
+
+    handle->armed = true;
+    handle->cancelled = false;
+
+    if ((rc = io_uring_submit(&ctx->ring)) < 0)
+        VIR_WARN("Unable to submit io_uring request: %s", g_strerror(-rc));
+
+    return 0;
+}
+
+
+static void
+virNetSocketUringCancelLocked(virNetSocketUringContext *ctx,
+                              virNetSocketUring *handle)
+{
+    struct io_uring_sqe *sqe;
+
+    if (!(sqe = virNetSocketUringGetSQE(ctx))) {
+        VIR_WARN("Unable to cancel io_uring request on fd %d", handle->fd);
+        return;
+    }
+
+    io_uring_prep_cancel(sqe, handle, 0);
+    io_uring_sqe_set_data(sqe, NULL);
+    handle->cancelled = true;
+    io_uring_submit(&ctx->ring);
+}
+
+
+static size_t
+virNetSocketUringMaxQueued(virNetSocketUring *handle)
+{
+    if (handle->listening)
+        return VIR_NET_SOCKET_URING_MAX_FDS;
+    return VIR_NET_SOCKET_URING_MAX_QUEUED;
+}
+
+
+static bool
+virNetSocketUringHasPendingLocked(virNetSocketUring *handle)
+{
+    return handle->head || handle->nfds > 0 || handle->err || handle->eof;
+}
+
+
+/* Rearm the request if it terminated and the queue drained enough */
+static void
+virNetSocketUringRearmLocked(virNetSocketUringContext *ctx,
+                             virNetSocketUring *handle)
+{
+    int rc;
+
+    if (handle->armed || handle->timer < 0 ||
+        handle->err || handle->eof ||
+        handle->queued > virNetSocketUringMaxQueued(handle) / 2)
+        return;
+
+    if ((rc = virNetSocketUringArmLocked(ctx, handle)) < 0)
+        handle->err = -rc;
+}
+
+
+static void
+virNetSocketUringQueueData(virNetSocketUring *handle,
+                           const char *data,
+                           size_t len)
+{
+    virNetSocketUringChunk *chunk;
+
+    chunk = g_malloc(sizeof(*chunk) + len);
+    chunk->next = NULL;
+    chunk->len = len;
+    chunk->offset = 0;
+    memcpy(chunk->data, data, len);
+
+    if (handle->tail)
+        handle->tail->next = chunk;
+    else
+        handle->head = chunk;
+    handle->tail = chunk;
+    handle->queued += len;
+}
+
+
+static void
+virNetSocketUringComplete(virNetSocketUringContext *ctx,
+                          virNetSocketUring *handle,
+                          struct io_uring_cqe *cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        handle->armed = false;
+
+    if (handle->listening) {
+        if (cqe->res >= 0) {
+            int fd = cqe->res;
+
+            if (handle->timer < 0) {
+                VIR_FORCE_CLOSE(fd);
+            } else {
+                VIR_APPEND_ELEMENT(handle->fds, handle->nfds, fd);
+                handle->queued++;
+            }
+        } else if (cqe->res != -ECANCELED) {
+            handle->err = -cqe->res;
+        }
+    } else {
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            unsigned int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            char *buf = ctx->buffers + (size_t)bid * VIR_NET_SOCKET_URING_BUFFER_SIZE;
+
+            if (cqe->res > 0 && handle->timer >= 0)
+                virNetSocketUringQueueData(handle, buf, cqe->res);
+
+            io_uring_buf_ring_add(ctx->bufRing, buf,
+                                  VIR_NET_SOCKET_URING_BUFFER_SIZE, bid,
+                                  io_uring_buf_ring_mask(VIR_NET_SOCKET_URING_BUFFERS),
+                                  0);
+            io_uring_buf_ring_advance(ctx->bufRing, 1);
+        }
+
+        if (cqe->res == 0)
+            handle->eof = true;
+        else if (cqe->res < 0 &&
+                 cqe->res != -ECANCELED &&
+                 cqe->res != -ENOBUFS)
+            handle->err = -cqe->res;
+    }
+
+    if (handle->timer < 0) {
+        if (!handle->armed)
+            virNetSocketUringFree(handle);
+        return;
+    }
+
+    if (handle->armed && !handle->cancelled &&
+        handle->queued >= virNetSocketUringMaxQueued(handle))
+        virNetSocketUringCancelLocked(ctx, handle);
+
+    virNetSocketUringRearmLocked(ctx, handle);
+
+    if (virNetSocketUringHasPendingLocked(handle))
+        virEventUpdateTimeout(handle->timer, 0);
+}
+
+
+static void
+virNetSocketUringHandleEvent(int watch G_GNUC_UNUSED,
+                             int fd,
+                             int events G_GNUC_UNUSED,
+                             void *opaque)
+{
+    virNetSocketUringContext *ctx = opaque;
+    struct io_uring_cqe *cqe;
+    unsigned int head;
+    unsigned int count = 0;
+    uint64_t val;
+
+    ignore_value(read(fd, &val, sizeof(val)));
+
+    virMutexLock(&ctx->lock);
+    io_uring_for_each_cqe(&ctx->ring, head, cqe) {
+        virNetSocketUring *handle = io_uring_cqe_get_data(cqe);
+
+        /* Completions of cancellations have no handle */
+        if (handle)
+            virNetSocketUringComplete(ctx, handle, cqe);
+        count++;
+    }
+    io_uring_cq_advance(&ctx->ring, count);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/**
+ * virNetSocketUringEnable:
+ *
+ * Set up the process wide ring used for receiving data on, and
+ * accepting connections from server sockets. An event loop
+ * implementation must be registered already.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetSocketUringEnable(void)
+{
+    virNetSocketUringContext *ctx;
+    bool haveRing = false;
+    int rc;
+    size_t i;
+
+    if (virNetSocketUringCtx)
+        return 0;
+
+    ctx = g_new0(virNetSocketUringContext, 1);
+    ctx->efd = -1;
+    ctx->watch = -1;
+
+    if (virMutexInit(&ctx->lock) < 0) {
+        virReportSystemError(errno, "%s", _("Unable to initialize mutex"));
+        g_free(ctx);
+        return -1;
+    }
+
+    if ((rc = io_uring_queue_init(VIR_NET_SOCKET_URING_ENTRIES,
+                                  &ctx->ring, 0)) < 0) {
+        virReportSystemError(-rc, "%s", _("Unable to set up io_uring"));
+        goto error;
+    }
+    haveRing = true;
+
+    if (!(ctx->bufRing = io_uring_setup_buf_ring(&ctx->ring,
+                                                 VIR_NET_SOCKET_URING_BUFFERS,
+                                                 VIR_NET_SOCKET_URING_BUFFER_GROUP,
+                                                 0, &rc))) {
+        virReportSystemError(-rc, "%s",
+                             _("Unable to register io_uring buffer ring"));
+        goto error;
+    }
+
+    ctx->buffers = g_new(char, (size_t)VIR_NET_SOCKET_URING_BUFFERS *
+                         VIR_NET_SOCKET_URING_BUFFER_SIZE);
+    for (i = 0; i < VIR_NET_SOCKET_URING_BUFFERS; i++) {
+        io_uring_buf_ring_add(ctx->bufRing,
+                              ctx->buffers + i * VIR_NET_SOCKET_URING_BUFFER_SIZE,
+                              VIR_NET_SOCKET_URING_BUFFER_SIZE, i,
+                              io_uring_buf_ring_mask(VIR_NET_SOCKET_URING_BUFFERS),
+                              i);
+    }
+    io_uring_buf_ring_advance(ctx->bufRing, VIR_NET_SOCKET_URING_BUFFERS);
+
+    if ((ctx->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+        virReportSystemError(errno, "%s", _("Unable to create eventfd"));
+        goto error;
+    }
+
+    if ((rc = io_uring_register_eventfd(&ctx->ring, ctx->efd)) < 0) {
+        virReportSystemError(-rc, "%s",
+                             _("Unable to register eventfd with io_uring"));
+        goto error;
+    }
+
+    if ((ctx->watch = virEventAddHandle(ctx->efd,
+                                        VIR_EVENT_HANDLE_READABLE,
+                                        virNetSocketUringHandleEvent,
+                                        ctx, NULL)) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to watch io_uring completions"));
+        goto error;
+    }
+
+    VIR_DEBUG("io_uring enabled with %d buffers of %d bytes",
+              VIR_NET_SOCKET_URING_BUFFERS, VIR_NET_SOCKET_URING_BUFFER_SIZE);
+
+    virNetSocketUringCtx = ctx;
+    return 0;
+
+ error:
+    if (haveRing) {
+        if (ctx->bufRing)
+            io_uring_free_buf_ring(&ctx->ring, ctx->bufRing,
+                                   VIR_NET_SOCKET_URING_BUFFERS,
+                                   VIR_NET_SOCKET_URING_BUFFER_GROUP);
+        io_uring_queue_exit(&ctx->ring);
+    }
+    VIR_FORCE_CLOSE(ctx->efd);
+    g_free(ctx->buffers);
+    virMutexDestroy(&ctx->lock);
+    g_free(ctx);
+    return -1;
+}
+
+
+bool
+virNetSocketUringIsEnabled(void)
+{
+    return !!virNetSocketUringCtx;
+}
+
+
+/**
+ * virNetSocketUringAttach:
+ * @fd: connected or listening socket
+ * @listening: whether @fd is a listening socket
+ * @timer: event loop timer to fire when data can be read
+ *
+ * Start receiving data on @fd, or accepting connections if @listening
+ * is true. The caller must read from @fd only through
+ * virNetSocketUringRecv or virNetSocketUringAccept and must keep @fd
+ * open until virNetSocketUringDetach was called.
+ *
+ * Returns the new handle or NULL on error
+ */
+virNetSocketUring *
+virNetSocketUringAttach(int fd,
+                        bool listening,
+                        int timer)
+{
+    virNetSocketUringContext *ctx = virNetSocketUringCtx;
+    virNetSocketUring *handle;
+    int rc;
+
+    if (!ctx) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("io_uring is not enabled"));
+        return NULL;
+    }
+
+    handle = g_new0(virNetSocketUring, 1);
+    handle->fd = fd;
+    handle->listening = listening;
+    handle->timer = timer;
+
+    virMutexLock(&ctx->lock);
+    rc = virNetSocketUringArmLocked(ctx, handle);
+    virMutexUnlock(&ctx->lock);
+
+    if (rc < 0) {
+        virReportSystemError(-rc, _("Unable to queue io_uring request on fd %d"),
+                             fd);
+        g_free(handle);
+        return NULL;
+    }
+
+    VIR_DEBUG("handle=%p fd=%d listening=%d", handle, fd, listening);
+    return handle;
+}
+
+
+/**
+ * virNetSocketUringDetach:
+ * @handle: the handle
+ *
+ * Stop receiving on the socket of @handle and drop any queued data.
+ * The timer is not touched anymore once this returns, the handle
+ * itself is released once the kernel is done with the request.
+ */
+void
+virNetSocketUringDetach(virNetSocketUring *handle)
+{
+    virNetSocketUringContext *ctx = virNetSocketUringCtx;
+
+    if (!handle)
+        return;
+
+    VIR_DEBUG("handle=%p fd=%d", handle, handle->fd);
+
+    virMutexLock(&ctx->lock);
+    handle->timer = -1;
+    if (handle->armed) {
+        if (!handle->cancelled)
+            virNetSocketUringCancelLocked(ctx, handle);
+        handle = NULL;
+    }
+    virMutexUnlock(&ctx->lock);
+
+    if (handle)
+        virNetSocketUringFree(handle);
+}
+
+
+bool
+virNetSocketUringHasPending(virNetSocketUring *handle)
+{
+    virNetSocketUringContext *ctx = virNetSocketUringCtx;
+    bool ret;
+
+    virMutexLock(&ctx->lock);
+    ret = virNetSocketUringHasPendingLocked(handle);
+    virMutexUnlock(&ctx->lock);
+
+    return ret;
+}
+
+
+/**
+ * virNetSocketUringRecv:
+ * @handle: the handle
+ * @buf: buffer to fill
+ * @len: size of @buf
+ *
+ * Read data queued for @handle, following the semantics of read(2)
+ * on a non-blocking socket.
+ *
+ * Returns number of bytes read, 0 on EOF, or -1 with errno set
+ */
+ssize_t
+virNetSocketUringRecv(virNetSocketUring *handle,
+                      char *buf,
+                      size_t len)
+{
+    virNetSocketUringContext *ctx = virNetSocketUringCtx;
+    ssize_t ret = 0;
+
+    virMutexLock(&ctx->lock);
+    if (handle->head) {
+        while (handle->head && ret < len) {
+            virNetSocketUringChunk *chunk = handle->head;
+            size_t want = MIN(len - ret, chunk->len - chunk->offset);
+
+            memcpy(buf + ret, chunk->data + chunk->offset, want);
+            chunk->offset += want;
+            ret += want;
+
+            if (chunk->offset == chunk->len) {
+                if (!(handle->head = chunk->next))
+                    handle->tail = NULL;
+                g_free(chunk);
+            }
+        }
+        handle->queued -= ret;
+        virNetSocketUringRearmLocked(ctx, handle);
+    } else if (handle->err) {
+        errno = handle->err;
+        ret = -1;
+    } else if (!handle->eof) {
+        errno = EAGAIN;
+        ret = -1;
+    }
+    virMutexUnlock(&ctx->lock);
+
+    return ret;
+}
+
+
+/**
+ * virNetSocketUringAccept:
+ * @handle: the handle of a listening socket
+ *
+ * Take a connection accepted on the socket of @handle, following the
+ * semantics of accept(2) on a non-blocking socket.
+ *
+ * Returns the file descriptor of the connection or -1 with errno set
+ */
+int
+virNetSocketUringAccept(virNetSocketUring *handle)
+{
+    virNetSocketUringContext *ctx = virNetSocketUringCtx;
+    int fd = -1;
+
+    virMutexLock(&ctx->lock);
+    if (handle->nfds > 0) {
+        fd = handle->fds[0];
+        VIR_DELETE_ELEMENT(handle->fds, 0, handle->nfds);
+        handle->queued--;
+    } else if (handle->err) {
+        /* Errors like EMFILE are transient, accept again afterwards */
+        errno = handle->err;
+        handle->err = 0;
+    } else {
+        errno = EAGAIN;
+    }
+    virNetSocketUringRearmLocked(ctx, handle);
+    virMutexUnlock(&ctx->lock);
+
+    return fd;
+}
+
+#else /* !WITH_LIBURING */
+
+int
+virNetSocketUringEnable(void)
+{
+    virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                   _("io_uring support was not compiled in"));
+    return -1;
+}
+
+
+bool
+virNetSocketUringIsEnabled(void)
+{
+    return false;
+}
+
+
+virNetSocketUring *
+virNetSocketUringAttach(int fd G_GNUC_UNUSED,
+                        bool listening G_GNUC_UNUSED,
+                        int timer G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                   _("io_uring support was not compiled in"));
+    return NULL;
+}
+
+
+void
+virNetSocketUringDetach(virNetSocketUring *handle G_GNUC_UNUSED)
+{
+}
+
+
+bool
+virNetSocketUringHasPending(virNetSocketUring *handle G_GNUC_UNUSED)
+{
+    return false;
+}
+
+
+ssize_t
+virNetSocketUringRecv(virNetSocketUring *handle G_GNUC_UNUSED,
+                      char *buf G_GNUC_UNUSED,
+                      size_t len G_GNUC_UNUSED)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+
+int
+virNetSocketUringAccept(virNetSocketUring *handle G_GNUC_UNUSED)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif /* !WITH_LIBURING */
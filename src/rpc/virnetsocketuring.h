@@ -0,0 +1,37 @@
+/*
+ * virnetsocketuring.h: io_uring based socket receive and accept
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "internal.h"
+
+typedef struct _virNetSocketUring virNetSocketUring;
+
+int virNetSocketUringEnable(void);
+bool virNetSocketUringIsEnabled(void);
+
+virNetSocketUring *virNetSocketUringAttach(int fd,
+                                           bool listening,
+                                           int timer);
+void virNetSocketUringDetach(virNetSocketUring *handle);
+
+bool virNetSocketUringHasPending(virNetSocketUring *handle);
+ssize_t virNetSocketUringRecv(virNetSocketUring *handle,
+                              char *buf,
+                              size_t len);
+int virNetSocketUringAccept(virNetSocketUring *handle);
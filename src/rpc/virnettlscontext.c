@@ -36,10 +36,14 @@
 #include "virlog.h"
 #include "virprobe.h"
 #include "virthread.h"
+#include "virhash.h"
 #include "configmake.h"
 
 #define DH_BITS 2048
 
+/* Upper bound on the number of servers to remember sessions for */
+#define VIR_NET_TLS_SESSION_CACHE_MAX 64
+
 #define LIBVIRT_PKI_DIR SYSCONFDIR "/pki"
 #define LIBVIRT_CACERT LIBVIRT_PKI_DIR "/CA/cacert.pem"
 #define LIBVIRT_CACRL LIBVIRT_PKI_DIR "/CA/cacrl.pem"
@@ -57,6 +61,10 @@ struct _virNetTLSContext {
 
     gnutls_certificate_credentials_t x509cred;
     gnutls_dh_params_t dhParams;
+    /* Server only, key protecting the session tickets issued */
+    gnutls_datum_t ticketKey;
+    /* Client only, identifies credentials in the session cache */
+    char *cacheID;
 
     bool isServer;
     bool requireValidCert;
@@ -71,6 +79,7 @@ struct _virNetTLSSession {
 
     bool isServer;
     char *hostname;
+    char *cacheKey;
     gnutls_session_t session;
     virNetTLSSessionWriteFunc writeFunc;
     virNetTLSSessionReadFunc readFunc;
@@ -98,6 +107,60 @@ static int virNetTLSContextOnceInit(void)
 VIR_ONCE_GLOBAL_INIT(virNetTLSContext);
 
 
+/*
+ * Clients connect over and over to the same hosts, but each
+ * connection has its own context. To let them resume sessions
+ * instead of doing full handshakes, session data handed out by
+ * servers is kept in a process wide cache, keyed by the credentials
+ * and hostname used. Each entry is used once, since servers issue
+ * fresh session data on every resumption.
+ */
+static virMutex virNetTLSSessionCacheLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virNetTLSSessionCache;
+
+
+static void
+virNetTLSSessionCacheEntryFree(void *opaque)
+{
+    g_bytes_unref(opaque);
+}
+
+
+static void
+virNetTLSSessionCachePut(const char *key,
+                         gnutls_datum_t *data)
+{
+    virMutexLock(&virNetTLSSessionCacheLock);
+
+    if (!virNetTLSSessionCache)
+        virNetTLSSessionCache = virHashNew(virNetTLSSessionCacheEntryFree);
+
+    /* Stale entries are never looked up again, so just start over */
+    if (virHashSize(virNetTLSSessionCache) >= VIR_NET_TLS_SESSION_CACHE_MAX &&
+        !virHashHasEntry(virNetTLSSessionCache, key))
+        virHashRemoveAll(virNetTLSSessionCache);
+
+    ignore_value(virHashUpdateEntry(virNetTLSSessionCache, key,
+                                    g_bytes_new(data->data, data->size)));
+
+    virMutexUnlock(&virNetTLSSessionCacheLock);
+}
+
+
+static GBytes *
+virNetTLSSessionCacheTake(const char *key)
+{
+    GBytes *ret = NULL;
+
+    virMutexLock(&virNetTLSSessionCacheLock);
+    if (virNetTLSSessionCache)
+        ret = virHashSteal(virNetTLSSessionCache, key);
+    virMutexUnlock(&virNetTLSSessionCacheLock);
+
+    return ret;
+}
+
+
 static int
 virNetTLSContextCheckCertFile(const char *type, const char *file, bool allowMissing)
 {
@@ -712,6 +775,20 @@ static virNetTLSContext *virNetTLSContextNew(const char *cacert,
     if (virNetTLSContextLoadCredentials(ctxt, isServer, cacert, cacrl, cert, key) < 0)
         goto error;
 
+    if (isServer) {
+        err = gnutls_session_ticket_key_generate(&ctxt->ticketKey);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to generate TLS session ticket key: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+    } else {
+        ctxt->cacheID = g_strdup_printf("%s|%s|%s", cacert,
+                                        NULLSTR_EMPTY(cert),
+                                        NULLSTR_EMPTY(priority));
+    }
+
     /* Generate Diffie Hellman parameters - for use with DHE
      * kx algorithms. These should be discarded and regenerated
      * once a day, once a week or once a month. Depending on the
@@ -949,6 +1026,24 @@ int virNetTLSContextReloadForServer(virNetTLSContext *ctxt,
 
     gnutls_certificate_free_credentials(x509credBak);
 
+    /* Sessions established with the old credentials must not be
+     * resumed, issue tickets with a new key from now on. Failing to
+     * do so is not fatal, tickets just stay valid. */
+    virObjectLock(ctxt);
+    if (ctxt->ticketKey.data) {
+        gnutls_datum_t key = { NULL, 0 };
+
+        if ((err = gnutls_session_ticket_key_generate(&key)) < 0) {
+            VIR_WARN("Unable to regenerate TLS session ticket key: %s",
+                     gnutls_strerror(err));
+        } else {
+            gnutls_memset(ctxt->ticketKey.data, 0, ctxt->ticketKey.size);
+            gnutls_free(ctxt->ticketKey.data);
+            ctxt->ticketKey = key;
+        }
+    }
+    virObjectUnlock(ctxt);
+
     return 0;
 
  error:
@@ -1150,6 +1245,11 @@ void virNetTLSContextDispose(void *obj)
           "ctxt=%p", ctxt);
 
     g_free(ctxt->priority);
+    g_free(ctxt->cacheID);
+    if (ctxt->ticketKey.data) {
+        gnutls_memset(ctxt->ticketKey.data, 0, ctxt->ticketKey.size);
+        gnutls_free(ctxt->ticketKey.data);
+    }
     gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
 }
@@ -1183,6 +1283,49 @@ virNetTLSSessionPull(void *opaque, void *buf, size_t len)
 }
 
 
+/* Remember data of a client session, so that the next connection
+ * to the same server can resume it */
+static void
+virNetTLSSessionSave(virNetTLSSession *sess)
+{
+    gnutls_datum_t data = { NULL, 0 };
+    int err;
+
+    if (!sess->cacheKey)
+        return;
+
+    if ((err = gnutls_session_get_data2(sess->session, &data)) < 0) {
+        VIR_DEBUG("Unable to get TLS session data: %s", gnutls_strerror(err));
+        return;
+    }
+
+    VIR_DEBUG("Caching %u bytes of TLS session data for '%s'",
+              data.size, sess->cacheKey);
+    virNetTLSSessionCachePut(sess->cacheKey, &data);
+    gnutls_free(data.data);
+}
+
+
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+/* With TLS 1.3 servers send session tickets only after the
+ * handshake completed, store them as they come in */
+static int
+virNetTLSSessionTicketHook(gnutls_session_t session,
+                           unsigned int htype G_GNUC_UNUSED,
+                           unsigned int when G_GNUC_UNUSED,
+                           unsigned int incoming G_GNUC_UNUSED,
+                           const gnutls_datum_t *msg G_GNUC_UNUSED)
+{
+    virNetTLSSession *sess = gnutls_session_get_ptr(session);
+
+    if (gnutls_protocol_get_version(session) == GNUTLS_TLS1_3)
+        virNetTLSSessionSave(sess);
+
+    return 0;
+}
+#endif
+
+
 virNetTLSSession *virNetTLSSessionNew(virNetTLSContext *ctxt,
                                         const char *hostname)
 {
@@ -1229,20 +1372,50 @@ virNetTLSSession *virNetTLSSessionNew(virNetTLSContext *ctxt,
         goto error;
     }
 
+    gnutls_session_set_ptr(sess->session, sess);
+
     /* request client certificate if any.
      */
     if (ctxt->isServer) {
         gnutls_certificate_server_set_request(sess->session, GNUTLS_CERT_REQUEST);
 
         gnutls_dh_set_prime_bits(sess->session, DH_BITS);
-    }
 
-    gnutls_transport_set_ptr(sess->session, sess);
-    gnutls_transport_set_push_function(sess->session,
-                                       virNetTLSSessionPush);
-    gnutls_transport_set_pull_function(sess->session,
-                                       virNetTLSSessionPull);
+        virObjectLock(ctxt);
+        err = gnutls_session_ticket_enable_server(sess->session,
+                                                  &ctxt->ticketKey);
+        virObjectUnlock(ctxt);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Failed to enable TLS session tickets: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+    } else if (hostname) {
+        g_autoptr(GBytes) data = NULL;
+
+        sess->cacheKey = g_strdup_printf("%s|%s", ctxt->cacheID, hostname);
+
+        if ((data = virNetTLSSessionCacheTake(sess->cacheKey))) {
+            gsize size;
+            const void *buf = g_bytes_get_data(data, &size);
+
+            VIR_DEBUG("Trying to resume TLS session for '%s'", sess->cacheKey);
+            if ((err = gnutls_session_set_data(sess->session, buf, size)) < 0)
+                VIR_DEBUG("Unable to use cached TLS session data: %s",
+                          gnutls_strerror(err));
+        }
+
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+        gnutls_handshake_set_hook_function(sess->session,
+                                           GNUTLS_HANDSHAKE_NEW_SESSION_TICKET,
+                                           GNUTLS_HOOK_POST,
+                                           virNetTLSSessionTicketHook);
+#endif
+    }
 
+    /* The transport is set up later by either virNetTLSSessionSetFD
+     * or virNetTLSSessionSetIOCallbacks */
     sess->isServer = ctxt->isServer;
 
     PROBE(RPC_TLS_SESSION_NEW,
@@ -1266,6 +1439,33 @@ void virNetTLSSessionSetIOCallbacks(virNetTLSSession *sess,
     sess->writeFunc = writeFunc;
     sess->readFunc = readFunc;
     sess->opaque = opaque;
+    gnutls_transport_set_ptr(sess->session, sess);
+    gnutls_transport_set_push_function(sess->session,
+                                       virNetTLSSessionPush);
+    gnutls_transport_set_pull_function(sess->session,
+                                       virNetTLSSessionPull);
+    virObjectUnlock(sess);
+}
+
+
+/**
+ * virNetTLSSessionSetFD:
+ * @sess: the session
+ * @fd: connected socket
+ *
+ * Let GnuTLS do I/O directly on @fd. Unlike with I/O callbacks this
+ * allows GnuTLS to hand over record encryption to the kernel (kTLS)
+ * once the handshake completed, if the system configuration of
+ * GnuTLS enables it and the kernel supports the negotiated cipher.
+ */
+void virNetTLSSessionSetFD(virNetTLSSession *sess,
+                           int fd)
+{
+    virObjectLock(sess);
+    sess->writeFunc = NULL;
+    sess->readFunc = NULL;
+    sess->opaque = NULL;
+    gnutls_transport_set_int(sess->session, fd);
     virObjectUnlock(sess);
 }
 
@@ -1341,8 +1541,24 @@ int virNetTLSSessionHandshake(virNetTLSSession *sess)
     ret = gnutls_handshake(sess->session);
     VIR_DEBUG("Ret=%d", ret);
     if (ret == 0) {
+        bool resumed = gnutls_session_is_resumed(sess->session) != 0;
+        int ktls = 0;
+
         sess->handshakeComplete = true;
-        VIR_DEBUG("Handshake is complete");
+
+#if GNUTLS_VERSION_NUMBER >= 0x030703
+        ktls = gnutls_transport_is_ktls_enabled(sess->session);
+#endif
+        VIR_DEBUG("Handshake is complete resumed=%d ktls=%d", resumed, ktls);
+
+        if (!sess->isServer) {
+#if GNUTLS_VERSION_NUMBER >= 0x030603
+            if (gnutls_protocol_get_version(sess->session) != GNUTLS_TLS1_3)
+                virNetTLSSessionSave(sess);
+#else
+            virNetTLSSessionSave(sess);
+#endif
+        }
         goto cleanup;
     }
     if (ret == GNUTLS_E_INTERRUPTED || ret == GNUTLS_E_AGAIN) {
@@ -1398,6 +1614,18 @@ int virNetTLSSessionGetKeySize(virNetTLSSession *sess)
     return ssf;
 }
 
+bool virNetTLSSessionIsResumed(virNetTLSSession *sess)
+{
+    bool ret;
+
+    virObjectLock(sess);
+    ret = sess->handshakeComplete &&
+        gnutls_session_is_resumed(sess->session) != 0;
+    virObjectUnlock(sess);
+
+    return ret;
+}
+
 const char *virNetTLSSessionGetX509DName(virNetTLSSession *sess)
 {
     const char *ret = NULL;
@@ -1420,6 +1648,7 @@ void virNetTLSSessionDispose(void *obj)
 
     g_free(sess->x509dname);
     g_free(sess->hostname);
+    g_free(sess->cacheKey);
     gnutls_deinit(sess->session);
 }
 
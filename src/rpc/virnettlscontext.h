@@ -24,8 +24,10 @@
 #include "virobject.h"
 
 typedef struct _virNetTLSContext virNetTLSContext;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNetTLSContext, virObjectUnref);
 
 typedef struct _virNetTLSSession virNetTLSSession;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNetTLSSession, virObjectUnref);
 
 
 void virNetTLSInit(void);
@@ -79,6 +81,8 @@ void virNetTLSSessionSetIOCallbacks(virNetTLSSession *sess,
                                     virNetTLSSessionWriteFunc writeFunc,
                                     virNetTLSSessionReadFunc readFunc,
                                     void *opaque);
+void virNetTLSSessionSetFD(virNetTLSSession *sess,
+                           int fd);
 
 ssize_t virNetTLSSessionWrite(virNetTLSSession *sess,
                               const char *buf, size_t len);
@@ -98,4 +102,6 @@ virNetTLSSessionGetHandshakeStatus(virNetTLSSession *sess);
 
 int virNetTLSSessionGetKeySize(virNetTLSSession *sess);
 
+bool virNetTLSSessionIsResumed(virNetTLSSession *sess);
+
 const char *virNetTLSSessionGetX509DName(virNetTLSSession *sess);
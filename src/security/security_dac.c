@@ -111,6 +111,28 @@ virSecurityDACChownListAppend(virSecurityDACChownList *list,
                               bool restore)
 {
     g_autoptr(virSecurityDACChownItem) item = NULL;
+    size_t i;
+
+    /* Repeating the last change queued for @path/@src is pointless.
+     * Items that remember the owner are kept though, as each of them
+     * takes a reference on the remembered owner which is released by
+     * a matching restore later on. */
+    if (!remember) {
+        for (i = list->nItems; i > 0; i--) {
+            virSecurityDACChownItem *other = list->items[i - 1];
+
+            if (other->src != src || STRNEQ_NULLABLE(other->path, path))
+                continue;
+
+            if (!other->remember &&
+                other->restore == restore &&
+                other->uid == uid &&
+                other->gid == gid)
+                return 0;
+
+            break;
+        }
+    }
 
     item = g_new0(virSecurityDACChownItem, 1);
 
@@ -235,15 +257,9 @@ virSecurityDACTransactionRun(pid_t pid G_GNUC_UNUSED,
 
         for (i = 0; i < list->nItems; i++) {
             virSecurityDACChownItem *item = list->items[i];
-            size_t j;
-
-            for (j = 0; j < state->nfds; j++) {
-                if (STREQ_NULLABLE(item->path, state->paths[j]))
-                    break;
-            }
 
             /* If path wasn't locked, don't try to remember its label. */
-            if (j == state->nfds)
+            if (!virSecurityManagerMetadataIsLocked(state, item->path))
                 item->remember = false;
         }
     }
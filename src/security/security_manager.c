@@ -1353,6 +1353,10 @@ cmpstringp(const void *p1, const void *p2)
 
 #define METADATA_OFFSET 1
 #define METADATA_LEN 1
+/* How long to wait for a metadata lock held by somebody else,
+ * and the maximum delay between two attempts (in microseconds). */
+#define METADATA_LOCK_TIMEOUT (10 * G_USEC_PER_SEC)
+#define METADATA_LOCK_MAX_DELAY (10 * 1000)
 
 /**
  * virSecurityManagerMetadataLock:
@@ -1398,8 +1402,8 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr G_GNUC_UNUSED,
     for (i = 0; i < npaths; i++) {
         const char *p = paths[i];
         struct stat sb;
-        size_t j;
-        int retries = 10 * 1000;
+        gint64 deadline = 0;
+        gulong delay = 100;
         int fd;
 
         if (!p)
@@ -1409,13 +1413,9 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr G_GNUC_UNUSED,
          * Not only we would fail open()-ing it the second time,
          * we would deadlock with ourselves trying to lock it the
          * second time. After all, we've locked it when iterating
-         * over it the first time. */
-        for (j = 0; j < i; j++) {
-            if (STREQ_NULLABLE(p, paths[j]))
-                break;
-        }
-
-        if (i != j)
+         * over it the first time. Since @paths is sorted, any
+         * duplicate immediately follows its first occurrence. */
+        if (i > 0 && STREQ_NULLABLE(p, paths[i - 1]))
             continue;
 
         if (stat(p, &sb) < 0)
@@ -1455,10 +1455,19 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr G_GNUC_UNUSED,
         do {
             if (virFileLock(fd, false,
                             METADATA_OFFSET, METADATA_LEN, false) < 0) {
-                if (retries && (errno == EACCES || errno == EAGAIN)) {
-                    /* File is locked. Try again. */
-                    retries--;
-                    g_usleep(1000);
+                int saved_errno = errno;
+                gint64 now = g_get_monotonic_time();
+
+                if (deadline == 0)
+                    deadline = now + METADATA_LOCK_TIMEOUT;
+
+                errno = saved_errno;
+                if ((errno == EACCES || errno == EAGAIN) && now < deadline) {
+                    /* File is locked. Try again, backing off so that
+                     * short-lived holders are picked up quickly while
+                     * long-lived ones don't make us spin. */
+                    g_usleep(delay);
+                    delay = MIN(delay * 2, METADATA_LOCK_MAX_DELAY);
                     continue;
                 } else {
                     virReportSystemError(errno,
@@ -1492,6 +1501,28 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr G_GNUC_UNUSED,
 }
 
 
+/**
+ * virSecurityManagerMetadataIsLocked:
+ * @state: locking state returned by virSecurityManagerMetadataLock
+ * @path: path to look up
+ *
+ * Returns: true if @path was locked as part of @state,
+ *          false otherwise.
+ */
+bool
+virSecurityManagerMetadataIsLocked(virSecurityManagerMetadataLockState *state,
+                                   const char *path)
+{
+    if (!state || !path || state->nfds == 0)
+        return false;
+
+    /* Locked paths are stored in the same sorted order in which
+     * they were locked. */
+    return bsearch(&path, state->paths, state->nfds,
+                   sizeof(*state->paths), cmpstringp) != NULL;
+}
+
+
 void
 virSecurityManagerMetadataUnlock(virSecurityManager *mgr G_GNUC_UNUSED,
                                  virSecurityManagerMetadataLockState **state)
@@ -241,6 +241,10 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr,
                                const char **paths,
                                size_t npaths);
 
+bool
+virSecurityManagerMetadataIsLocked(virSecurityManagerMetadataLockState *state,
+                                   const char *path);
+
 void
 virSecurityManagerMetadataUnlock(virSecurityManager *mgr,
                                  virSecurityManagerMetadataLockState **state);
@@ -57,6 +57,11 @@ struct _virSecuritySELinuxData {
     char *file_context;
     char *content_context;
     GHashTable *mcs;
+    /* Category range of our own process, cached by its context */
+    char *procContext;
+    char *procSens;
+    int procCatMin;
+    int procCatMax;
     bool skipAllLabel;
     struct selabel_handle *label_handle;
 };
@@ -115,6 +120,26 @@ virSecuritySELinuxContextListAppend(virSecuritySELinuxContextList *list,
                                     bool restore)
 {
     virSecuritySELinuxContextItem *item = NULL;
+    size_t i;
+
+    /* Repeating the last change queued for @path is pointless. Items
+     * remembering the label are kept as each of them holds a
+     * reference on the remembered label. */
+    if (!remember) {
+        for (i = list->nItems; i > 0; i--) {
+            virSecuritySELinuxContextItem *other = list->items[i - 1];
+
+            if (STRNEQ_NULLABLE(other->path, path))
+                continue;
+
+            if (!other->remember &&
+                other->restore == restore &&
+                STREQ_NULLABLE(other->tcon, tcon))
+                return 0;
+
+            break;
+        }
+    }
 
     item = g_new0(virSecuritySELinuxContextItem, 1);
 
@@ -261,15 +286,9 @@ virSecuritySELinuxTransactionRun(pid_t pid G_GNUC_UNUSED,
 
         for (i = 0; i < list->nItems; i++) {
             virSecuritySELinuxContextItem *item = list->items[i];
-            size_t j;
-
-            for (j = 0; j < state->nfds; j++) {
-                if (STREQ_NULLABLE(item->path, state->paths[j]))
-                    break;
-            }
 
             /* If path wasn't locked, don't try to remember its label. */
-            if (j == state->nfds)
+            if (!virSecurityManagerMetadataIsLocked(state, item->path))
                 item->remember = false;
         }
     }
@@ -348,6 +367,9 @@ virSecuritySELinuxMCSRemove(virSecurityManager *mgr,
 }
 
 
+/* Number of random picks to try before falling back to a scan */
+#define MCS_RANDOM_TRIES 64
+
 static char *
 virSecuritySELinuxMCSFind(virSecurityManager *mgr,
                           const char *sens,
@@ -357,6 +379,9 @@ virSecuritySELinuxMCSFind(virSecurityManager *mgr,
     virSecuritySELinuxData *data = virSecurityManagerGetPrivateData(mgr);
     int catRange;
     char *mcs = NULL;
+    size_t i;
+    int c1;
+    int c2;
 
     /* +1 since virRandomInt range is exclusive of the upper bound */
     catRange = (catMax - catMin) + 1;
@@ -371,9 +396,9 @@ virSecuritySELinuxMCSFind(virSecurityManager *mgr,
     VIR_DEBUG("Using sensitivity level '%s' cat min %d max %d range %d",
               sens, catMin, catMax, catRange);
 
-    for (;;) {
-        int c1 = virRandomInt(catRange);
-        int c2 = virRandomInt(catRange);
+    for (i = 0; i < MCS_RANDOM_TRIES; i++) {
+        c1 = virRandomInt(catRange);
+        c2 = virRandomInt(catRange);
 
         VIR_DEBUG("Try cat %s:c%d,c%d", sens, c1 + catMin, c2 + catMin);
 
@@ -397,12 +422,38 @@ virSecuritySELinuxMCSFind(virSecurityManager *mgr,
         }
 
         if (virHashLookup(data->mcs, mcs) == NULL)
-            break;
+            return mcs;
+
+        VIR_FREE(mcs);
+    }
+
+    /* The range is crowded. Rather than keep guessing, walk all the
+     * pairs starting from a random one so that we are guaranteed to
+     * either find a free pair or learn that there is none. */
+    c1 = virRandomInt(catRange);
+    c2 = virRandomInt(catRange);
+    for (i = 0; i < (size_t) catRange * catRange; i++) {
+        if (++c2 == catRange) {
+            c2 = 0;
+            if (++c1 == catRange)
+                c1 = 0;
+        }
+
+        if (c1 >= c2)
+            continue;
+
+        mcs = g_strdup_printf("%s:c%d,c%d", sens, catMin + c1, catMin + c2);
+
+        if (virHashLookup(data->mcs, mcs) == NULL)
+            return mcs;
 
         VIR_FREE(mcs);
     }
 
-    return mcs;
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("No free category pair left in range c%d-c%d"),
+                   catMin, catMax);
+    return NULL;
 }
 
 
@@ -422,10 +473,12 @@ virSecuritySELinuxMCSFind(virSecurityManager *mgr,
  * mode when run with a weird process label.
  */
 static int
-virSecuritySELinuxMCSGetProcessRange(char **sens,
+virSecuritySELinuxMCSGetProcessRange(virSecurityManager *mgr,
+                                     char **sens,
                                      int *catMin,
                                      int *catMax)
 {
+    virSecuritySELinuxData *data = virSecurityManagerGetPrivateData(mgr);
     char *ourSecContext = NULL;
     context_t ourContext = NULL;
     char *cat = NULL;
@@ -438,6 +491,17 @@ virSecuritySELinuxMCSGetProcessRange(char **sens,
                              _("Unable to get current process SELinux context"));
         goto cleanup;
     }
+
+    /* Our own context hardly ever changes, so don't parse it over
+     * and over again for each domain started. */
+    if (STREQ_NULLABLE(ourSecContext, data->procContext)) {
+        *sens = g_strdup(data->procSens);
+        *catMin = data->procCatMin;
+        *catMax = data->procCatMax;
+        ret = 0;
+        goto cleanup;
+    }
+
     if (!(ourContext = context_new(ourSecContext))) {
         virReportSystemError(errno,
                              _("Unable to parse current SELinux context '%s'"),
@@ -517,8 +581,16 @@ virSecuritySELinuxMCSGetProcessRange(char **sens,
     ret = 0;
 
  cleanup:
-    if (ret < 0)
+    if (ret < 0) {
         VIR_FREE(*sens);
+    } else if (ourContext) {
+        g_free(data->procContext);
+        g_free(data->procSens);
+        data->procContext = g_strdup(ourSecContext);
+        data->procSens = g_strdup(*sens);
+        data->procCatMin = *catMin;
+        data->procCatMax = *catMax;
+    }
     freecon(ourSecContext);
     context_free(ourContext);
     return ret;
@@ -850,7 +922,8 @@ virSecuritySELinuxGenLabel(virSecurityManager *mgr,
         break;
 
     case VIR_DOMAIN_SECLABEL_DYNAMIC:
-        if (virSecuritySELinuxMCSGetProcessRange(&sens,
+        if (virSecuritySELinuxMCSGetProcessRange(mgr,
+                                                 &sens,
                                                  &catMin,
                                                  &catMax) < 0)
             goto cleanup;
@@ -891,7 +964,8 @@ virSecuritySELinuxGenLabel(virSecurityManager *mgr,
         break;
 
     case VIR_DOMAIN_SECLABEL_NONE:
-        if (virSecuritySELinuxMCSGetProcessRange(&sens,
+        if (virSecuritySELinuxMCSGetProcessRange(mgr,
+                                                 &sens,
                                                  &catMin,
                                                  &catMax) < 0)
             goto cleanup;
@@ -1031,6 +1105,8 @@ virSecuritySELinuxDriverClose(virSecurityManager *mgr)
 
     virHashFree(data->mcs);
 
+    VIR_FREE(data->procContext);
+    VIR_FREE(data->procSens);
     VIR_FREE(data->domain_context);
     VIR_FREE(data->alt_domain_context);
     VIR_FREE(data->file_context);
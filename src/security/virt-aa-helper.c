@@ -197,6 +197,9 @@ parserCommand(const char *profile_name, const char cmd)
 
 /*
  * Update the dynamic files
+ *
+ * Returns 0 if the file was written, 1 if it was left untouched
+ * because it already had the requested content, -1 on error.
  */
 static int
 update_include_file(const char *include_file, const char *included_files,
@@ -216,6 +219,17 @@ update_include_file(const char *include_file, const char *included_files,
             return rc;
     }
 
+    if (append && existing) {
+        g_autofree char *line = g_strdup_printf("\n%s", included_files);
+
+        /* Appending rules that are already there would only make
+         * the file grow and the profile be reloaded needlessly. */
+        if (strstr(existing, line)) {
+            rc = 1;
+            goto cleanup;
+        }
+    }
+
     if (append && virFileExists(include_file))
         pcontent = g_strdup_printf("%s%s", existing, included_files);
     else
@@ -229,7 +243,7 @@ update_include_file(const char *include_file, const char *included_files,
 
     /* only update the disk profile if it is different */
     if (flen > 0 && flen == plen && STREQLEN(existing, pcontent, plen)) {
-        rc = 0;
+        rc = 1;
         goto cleanup;
     }
 
@@ -1439,6 +1453,7 @@ main(int argc, char **argv)
     char *include_file = NULL;
     off_t size;
     bool purged = 0;
+    bool unchanged = false;
 
     if (virGettextInitialize() < 0 ||
         virErrorInitialize() < 0) {
@@ -1535,8 +1550,11 @@ main(int argc, char **argv)
             rc = 0;
         } else if ((rc = update_include_file(include_file,
                                              included_files,
-                                             ctl->append)) != 0) {
+                                             ctl->append)) < 0) {
             goto cleanup;
+        } else if (rc == 1) {
+            unchanged = true;
+            rc = 0;
         }
 
 
@@ -1558,7 +1576,10 @@ main(int argc, char **argv)
             VIR_FREE(tmp);
         }
 
-        if (rc == 0 && !ctl->dryrun) {
+        /* There's no point in having the parser recompile a profile
+         * whose rules did not change. */
+        if (rc == 0 && !ctl->dryrun &&
+            !(ctl->cmd == 'r' && unchanged && !purged)) {
             if (ctl->cmd == 'c')
                 rc = parserLoad(ctl->uuid);
             else
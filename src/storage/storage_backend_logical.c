@@ -34,6 +34,7 @@
 #include "virfile.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "virthread.h"
 #include "storage_util.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
@@ -381,6 +382,12 @@ virStorageBackendLogicalFindLVs(virStoragePoolObj *pool,
         .vol = vol,
     };
     g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *lvname = NULL;
+
+    /* Let lvs report only the segments of @vol if there is one rather than
+     * those of every volume in the group */
+    if (vol)
+        lvname = g_strdup_printf("%s/%s", def->source.name, vol->name);
 
     cmd = virCommandNewArgList(LVS,
                                "--separator", "#",
@@ -390,19 +397,29 @@ virStorageBackendLogicalFindLVs(virStoragePoolObj *pool,
                                "--nosuffix",
                                "--options",
                                "lv_name,origin,uuid,devices,segtype,stripes,seg_size,vg_extent_size,size,lv_attr",
-                               def->source.name,
+                               lvname ? lvname : def->source.name,
                                NULL);
     return virCommandRunRegex(cmd, 1, regexes, vars,
                               virStorageBackendLogicalMakeVol,
                               &cbdata, "lvs", NULL);
 }
 
+/* Metadata sequence number of each volume group as of the last refresh
+ * which listed its logical volumes, see virStorageBackendLogicalReuseVols */
+static virMutex virStorageBackendLogicalSeqnosLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStorageBackendLogicalSeqnos;
+
+struct virStorageBackendLogicalRefreshData {
+    virStoragePoolObj *pool;
+    char *seqno;
+};
+
 static int
 virStorageBackendLogicalRefreshPoolFunc(char **const groups,
                                         void *data)
 {
-    virStoragePoolObj *pool = data;
-    virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
+    struct virStorageBackendLogicalRefreshData *refreshdata = data;
+    virStoragePoolDef *def = virStoragePoolObjGetDef(refreshdata->pool);
 
     if (virStrToLong_ull(groups[0], NULL, 10, &def->capacity) < 0)
         return -1;
@@ -410,10 +427,106 @@ virStorageBackendLogicalRefreshPoolFunc(char **const groups,
         return -1;
     def->allocation = def->capacity - def->available;
 
+    g_free(refreshdata->seqno);
+    refreshdata->seqno = g_strdup(groups[2]);
+
     return 0;
 }
 
 
+static void
+virStorageBackendLogicalSetSeqno(const char *vgname,
+                                 const char *seqno)
+{
+    virMutexLock(&virStorageBackendLogicalSeqnosLock);
+
+    if (!virStorageBackendLogicalSeqnos)
+        virStorageBackendLogicalSeqnos = virHashNew(g_free);
+
+    g_hash_table_insert(virStorageBackendLogicalSeqnos,
+                        g_strdup(vgname), g_strdup(seqno));
+
+    virMutexUnlock(&virStorageBackendLogicalSeqnosLock);
+}
+
+
+static bool
+virStorageBackendLogicalSeqnoMatches(const char *vgname,
+                                     const char *seqno)
+{
+    const char *last = NULL;
+    bool ret;
+
+    virMutexLock(&virStorageBackendLogicalSeqnosLock);
+
+    if (virStorageBackendLogicalSeqnos)
+        last = virHashLookup(virStorageBackendLogicalSeqnos, vgname);
+    ret = STREQ_NULLABLE(last, seqno);
+
+    virMutexUnlock(&virStorageBackendLogicalSeqnosLock);
+
+    return ret;
+}
+
+
+/*
+ * LVM bumps the sequence number of a volume group with every change of its
+ * metadata, so if it is the same as when the logical volumes were last
+ * listed the only difference lvs could report is in which of them are
+ * active. Those are the ones with a node in the target directory, which
+ * is cheap to check. If that matches too, take back the volumes found by
+ * the previous refresh instead of running lvs again.
+ *
+ * Returns true if the volumes were reused, false if they have to be
+ * listed.
+ */
+static bool
+virStorageBackendLogicalReuseVols(virStoragePoolObj *pool,
+                                  const char *seqno)
+{
+    virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
+    g_autoptr(DIR) dir = NULL;
+    struct dirent *ent;
+    size_t nvols = 0;
+    int rc;
+
+    if (!seqno ||
+        !virStorageBackendLogicalSeqnoMatches(def->source.name, seqno))
+        return false;
+
+    virStoragePoolObjUnstashVols(pool);
+
+    if (virDirOpenQuiet(&dir, def->target.path) < 0)
+        goto restash;
+
+    while ((rc = virDirRead(dir, &ent, NULL)) > 0) {
+        virStorageVolDef *vol;
+
+        if (!(vol = virStorageVolDefFindByName(pool, ent->d_name)))
+            goto restash;
+
+        /* Ownership and permissions of the node may have changed */
+        if (virStorageBackendUpdateVolInfo(vol, false,
+                                           VIR_STORAGE_VOL_OPEN_DEFAULT, 0) < 0)
+            goto restash;
+
+        nvols++;
+    }
+
+    if (rc < 0 || nvols != virStoragePoolObjGetVolumesCount(pool))
+        goto restash;
+
+    VIR_DEBUG("metadata of volume group '%s' is still at seqno %s, "
+              "reusing its %zu volumes", def->source.name, seqno, nvols);
+    return true;
+
+ restash:
+    virResetLastError();
+    virStoragePoolObjStashVols(pool);
+    return false;
+}
+
+
 static int
 virStorageBackendLogicalFindPoolSourcesFunc(char **const groups,
                                             void *data)
@@ -708,48 +821,63 @@ static int
 virStorageBackendLogicalRefreshPool(virStoragePoolObj *pool)
 {
     /*
-     *  # vgs --separator : --noheadings --units b --unbuffered --nosuffix --options "vg_size,vg_free" VGNAME
-     *    10603200512:4328521728
+     *  # vgs --separator : --noheadings --units b --unbuffered --nosuffix --options "vg_size,vg_free,vg_seqno" VGNAME
+     *    10603200512:4328521728:42
      *
-     * Pull out size & free
+     * Pull out size, free & metadata sequence number
      *
      * NB vgs from some distros (e.g. SLES10 SP2) outputs trailing ":" on each line
      */
     const char *regexes[] = {
-        "^\\s*(\\S+):([0-9]+):?\\s*$"
+        "^\\s*(\\S+):([0-9]+):([0-9]+):?\\s*$"
     };
     int vars[] = {
-        2
+        3
     };
     virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
+    struct virStorageBackendLogicalRefreshData refreshdata = {
+        .pool = pool,
+    };
+    g_autofree char *seqno = NULL;
     g_autoptr(virCommand) cmd = NULL;
 
     virWaitForDevices();
 
-    /* Get list of all logical volumes */
-    if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
-        return -1;
-
     cmd = virCommandNewArgList(VGS,
                                "--separator", ":",
                                "--noheadings",
                                "--units", "b",
                                "--unbuffered",
                                "--nosuffix",
-                               "--options", "vg_size,vg_free",
+                               "--options", "vg_size,vg_free,vg_seqno",
                                def->source.name,
                                NULL);
 
-    /* Now get basic volgrp metadata */
+    /* Get basic volgrp metadata first, the sequence number tells whether
+     * the logical volumes have to be listed again. It is read before lvs
+     * runs so that a change racing with it gets noticed next time. */
     if (virCommandRunRegex(cmd,
                            1,
                            regexes,
                            vars,
                            virStorageBackendLogicalRefreshPoolFunc,
-                           pool,
+                           &refreshdata,
                            "vgs",
-                           NULL) < 0)
+                           NULL) < 0) {
+        g_free(refreshdata.seqno);
         return -1;
+    }
+    seqno = refreshdata.seqno;
+
+    if (virStorageBackendLogicalReuseVols(pool, seqno))
+        return 0;
+
+    /* Get list of all logical volumes */
+    if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
+        return -1;
+
+    if (seqno)
+        virStorageBackendLogicalSetSeqno(def->source.name, seqno);
 
     return 0;
 }
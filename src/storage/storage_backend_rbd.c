@@ -22,11 +22,14 @@
 #include <config.h>
 
 #include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "datatypes.h"
 #include "virerror.h"
 #include "storage_backend_rbd.h"
 #include "storage_conf.h"
 #include "viralloc.h"
+#include "virfile.h"
 #include "viridentity.h"
 #include "virlog.h"
 #include "viruuid.h"
@@ -42,10 +45,37 @@
 
 VIR_LOG_INIT("storage.storage_backend_rbd");
 
+/* Number of requests kept in flight when copying data into an image,
+ * unless overridden by the rbd_concurrent_management_ops option */
+#define VIR_STORAGE_RBD_COPY_DEPTH_DEFAULT 10
+#define VIR_STORAGE_RBD_COPY_DEPTH_MAX 256
+
+/* Seconds a RADOS connection is kept around after its last user released
+ * it, and how often idle connections are looked for */
+#define VIR_STORAGE_RBD_CONN_IDLE_TIMEOUT 60
+#define VIR_STORAGE_RBD_CONN_PURGE_INTERVAL 30
+
+static virMutex virStorageBackendRBDConnsLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStorageBackendRBDConns;
+static int virStorageBackendRBDConnsTimer = -1;
+
+/* Connection to a RADOS cluster shared by all pools with the same
+ * monitors, authentication and config options */
+typedef struct _virStorageBackendRBDConn virStorageBackendRBDConn;
+struct _virStorageBackendRBDConn {
+    char *key;
+    rados_t cluster;
+    time_t starttime;
+
+    size_t refs;
+    time_t lastused;    /* when the last user released the connection */
+    bool broken;        /* don't hand out to new users */
+};
+
 struct _virStorageBackendRBDState {
+    virStorageBackendRBDConn *conn;
     rados_t cluster;
     rados_ioctx_t ioctx;
-    time_t starttime;
 };
 
 typedef struct _virStorageBackendRBDState virStorageBackendRBDState;
@@ -179,10 +209,11 @@ virStorageBackendRBDRADOSConfSet(rados_t cluster,
 }
 
 static int
-virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
+virStorageBackendRBDOpenRADOSConn(rados_t *ret_cluster,
                                   virStoragePoolDef *def)
 {
     int ret = -1;
+    rados_t cluster = NULL;
     virStoragePoolSource *source = &def->source;
     virStorageAuthDef *authdef = source->auth;
     g_autofree unsigned char *secret_value = NULL;
@@ -203,7 +234,7 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
 
         VIR_DEBUG("Using cephx authorization, username: %s", authdef->username);
 
-        if (rados_create(&ptr->cluster, authdef->username) < 0) {
+        if (rados_create(&cluster, authdef->username) < 0) {
             virReportSystemError(errno, "%s", _("failed to initialize RADOS"));
             goto cleanup;
         }
@@ -213,7 +244,7 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
 
         conn = virGetConnectSecret();
         if (!conn)
-            return -1;
+            goto cleanup;
 
         if (virSecretGetSecretString(conn, &authdef->seclookupdef,
                                      VIR_SECRET_USAGE_TYPE_CEPH,
@@ -223,23 +254,23 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
         rados_key = g_base64_encode(secret_value, secret_value_size);
         virSecureErase(secret_value, secret_value_size);
 
-        rc = virStorageBackendRBDRADOSConfSet(ptr->cluster, "key", rados_key);
+        rc = virStorageBackendRBDRADOSConfSet(cluster, "key", rados_key);
         virSecureEraseString(rados_key);
 
         if (rc < 0)
             goto cleanup;
 
-        if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+        if (virStorageBackendRBDRADOSConfSet(cluster,
                                              "auth_supported", "cephx") < 0)
             goto cleanup;
     } else {
         VIR_DEBUG("Not using cephx authorization");
-        if (rados_create(&ptr->cluster, NULL) < 0) {
+        if (rados_create(&cluster, NULL) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("failed to create the RADOS cluster"));
             goto cleanup;
         }
-        if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+        if (virStorageBackendRBDRADOSConfSet(cluster,
                                              "auth_supported", "none") < 0)
             goto cleanup;
     }
@@ -273,7 +304,7 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
     }
 
     mon_buff = virBufferContentAndReset(&mon_host);
-    if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+    if (virStorageBackendRBDRADOSConfSet(cluster,
                                          "mon_host",
                                          mon_buff) < 0)
         goto cleanup;
@@ -283,17 +314,17 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
      * In case the Ceph cluster is down libvirt won't block forever.
      * Operations in librados will return -ETIMEDOUT when the timeout is reached.
      */
-    if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+    if (virStorageBackendRBDRADOSConfSet(cluster,
                                          "client_mount_timeout",
                                          client_mount_timeout) < 0)
         goto cleanup;
 
-    if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+    if (virStorageBackendRBDRADOSConfSet(cluster,
                                          "rados_mon_op_timeout",
                                          mon_op_timeout) < 0)
         goto cleanup;
 
-    if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+    if (virStorageBackendRBDRADOSConfSet(cluster,
                                          "rados_osd_op_timeout",
                                          osd_op_timeout) < 0)
         goto cleanup;
@@ -303,7 +334,7 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
      * rbd_create3(), we can tell librbd to default to format 2.
      * This leaves us to simply use rbd_create() and use the default behavior of librbd
      */
-    if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+    if (virStorageBackendRBDRADOSConfSet(cluster,
                                          "rbd_default_format",
                                          rbd_default_format) < 0)
         goto cleanup;
@@ -313,7 +344,7 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
         char uuidstr[VIR_UUID_STRING_BUFLEN];
 
         for (i = 0; i < cmdopts->noptions; i++) {
-            if (virStorageBackendRBDRADOSConfSet(ptr->cluster,
+            if (virStorageBackendRBDRADOSConfSet(cluster,
                                                  cmdopts->names[i],
                                                  cmdopts->values[i]) < 0)
                 goto cleanup;
@@ -324,16 +355,18 @@ virStorageBackendRBDOpenRADOSConn(virStorageBackendRBDState *ptr,
                  "config_opts from XML", def->name, uuidstr);
     }
 
-    ptr->starttime = time(0);
-    if (rados_connect(ptr->cluster) < 0) {
+    if (rados_connect(cluster) < 0) {
         virReportSystemError(errno, _("failed to connect to the RADOS monitor on: %s"),
                              mon_buff);
         goto cleanup;
     }
 
+    *ret_cluster = g_steal_pointer(&cluster);
     ret = 0;
 
  cleanup:
+    if (cluster)
+        rados_shutdown(cluster);
     virObjectUnref(conn);
     return ret;
 }
@@ -352,22 +385,204 @@ virStorageBackendRBDOpenIoCTX(virStorageBackendRBDState *ptr,
 }
 
 static void
-virStorageBackendRBDCloseRADOSConn(virStorageBackendRBDState *ptr)
+virStorageBackendRBDConnFree(virStorageBackendRBDConn *conn)
 {
-    if (ptr->ioctx != NULL) {
-        VIR_DEBUG("Closing RADOS IoCTX");
-        rados_ioctx_destroy(ptr->ioctx);
-    }
-    ptr->ioctx = NULL;
+    if (!conn)
+        return;
 
-    if (ptr->cluster != NULL) {
+    if (conn->cluster) {
         VIR_DEBUG("Closing RADOS connection");
-        rados_shutdown(ptr->cluster);
+        rados_shutdown(conn->cluster);
+        VIR_DEBUG("RADOS connection existed for %ld seconds",
+                  time(0) - conn->starttime);
+    }
+
+    g_free(conn->key);
+    g_free(conn);
+}
+
+
+/*
+ * Identifies connections which can be shared: pools using the same
+ * monitors, credentials and config options get the same key.
+ */
+static char *
+virStorageBackendRBDConnKey(virStoragePoolDef *def)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    virStoragePoolSource *source = &def->source;
+    virStorageAuthDef *authdef = source->auth;
+    size_t i;
+
+    for (i = 0; i < source->nhost; i++)
+        virBufferAsprintf(&buf, "host=%s:%d;", NULLSTR(source->hosts[i].name),
+                          source->hosts[i].port);
+
+    if (authdef) {
+        virBufferAsprintf(&buf, "user=%s;", NULLSTR(authdef->username));
+
+        if (authdef->seclookupdef.type == VIR_SECRET_LOOKUP_TYPE_UUID) {
+            char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+            virUUIDFormat(authdef->seclookupdef.u.uuid, uuidstr);
+            virBufferAsprintf(&buf, "secret=uuid:%s;", uuidstr);
+        } else {
+            virBufferAsprintf(&buf, "secret=usage:%s;",
+                              NULLSTR(authdef->seclookupdef.u.usage));
+        }
+    }
+
+    if (def->namespaceData) {
+        virStoragePoolRBDConfigOptionsDef *cmdopts = def->namespaceData;
+
+        for (i = 0; i < cmdopts->noptions; i++)
+            virBufferAsprintf(&buf, "opt=%s=%s;",
+                              cmdopts->names[i], cmdopts->values[i]);
+    }
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+/* Must be called with virStorageBackendRBDConnsLock held. Idle connections
+ * are moved to @expired for the caller to free once the lock is dropped. */
+static void
+virStorageBackendRBDConnsPurgeLocked(GSList **expired)
+{
+    GHashTableIter iter;
+    void *payload;
+    time_t now = time(0);
+
+    if (!virStorageBackendRBDConns)
+        return;
+
+    g_hash_table_iter_init(&iter, virStorageBackendRBDConns);
+    while (g_hash_table_iter_next(&iter, NULL, &payload)) {
+        virStorageBackendRBDConn *conn = payload;
+
+        if (conn->refs > 0)
+            continue;
+
+        if (!conn->broken &&
+            now - conn->lastused < VIR_STORAGE_RBD_CONN_IDLE_TIMEOUT)
+            continue;
+
+        *expired = g_slist_prepend(*expired, conn);
+        g_hash_table_iter_steal(&iter);
+    }
+}
+
+
+static void
+virStorageBackendRBDConnsPurge(int timer G_GNUC_UNUSED,
+                               void *opaque G_GNUC_UNUSED)
+{
+    GSList *expired = NULL;
+
+    virMutexLock(&virStorageBackendRBDConnsLock);
+    virStorageBackendRBDConnsPurgeLocked(&expired);
+
+    if (virStorageBackendRBDConnsTimer != -1 &&
+        g_hash_table_size(virStorageBackendRBDConns) == 0) {
+        virEventRemoveTimeout(virStorageBackendRBDConnsTimer);
+        virStorageBackendRBDConnsTimer = -1;
     }
-    ptr->cluster = NULL;
+    virMutexUnlock(&virStorageBackendRBDConnsLock);
 
-    VIR_DEBUG("RADOS connection existed for %ld seconds",
-              time(0) - ptr->starttime);
+    g_slist_free_full(expired, (GDestroyNotify) virStorageBackendRBDConnFree);
+}
+
+
+static virStorageBackendRBDConn *
+virStorageBackendRBDConnAcquire(virStoragePoolDef *def)
+{
+    g_autofree char *key = virStorageBackendRBDConnKey(def);
+    virStorageBackendRBDConn *conn;
+    virStorageBackendRBDConn *other = NULL;
+    GSList *expired = NULL;
+    rados_t cluster = NULL;
+
+    virMutexLock(&virStorageBackendRBDConnsLock);
+    if (!virStorageBackendRBDConns)
+        virStorageBackendRBDConns = g_hash_table_new(g_str_hash, g_str_equal);
+
+    /* in case there's no event loop to run the timer */
+    virStorageBackendRBDConnsPurgeLocked(&expired);
+
+    if ((conn = g_hash_table_lookup(virStorageBackendRBDConns, key)) &&
+        !conn->broken) {
+        conn->refs++;
+        virMutexUnlock(&virStorageBackendRBDConnsLock);
+        g_slist_free_full(expired, (GDestroyNotify) virStorageBackendRBDConnFree);
+
+        VIR_DEBUG("Reusing RADOS connection for pool '%s'", def->name);
+        return conn;
+    }
+    virMutexUnlock(&virStorageBackendRBDConnsLock);
+    g_slist_free_full(expired, (GDestroyNotify) virStorageBackendRBDConnFree);
+
+    /* Connecting may take a while, don't block users of other clusters */
+    if (virStorageBackendRBDOpenRADOSConn(&cluster, def) < 0)
+        return NULL;
+
+    conn = g_new0(virStorageBackendRBDConn, 1);
+    conn->key = g_steal_pointer(&key);
+    conn->cluster = cluster;
+    conn->starttime = time(0);
+    conn->refs = 1;
+
+    virMutexLock(&virStorageBackendRBDConnsLock);
+    if ((other = g_hash_table_lookup(virStorageBackendRBDConns, conn->key))) {
+        if (!other->broken) {
+            /* somebody else connected meanwhile, share theirs */
+            other->refs++;
+            virMutexUnlock(&virStorageBackendRBDConnsLock);
+
+            virStorageBackendRBDConnFree(conn);
+            return other;
+        }
+
+        /* a broken connection still in use is freed by its last user */
+        g_hash_table_steal(virStorageBackendRBDConns, conn->key);
+        if (other->refs > 0)
+            other = NULL;
+    }
+    g_hash_table_insert(virStorageBackendRBDConns, conn->key, conn);
+    virMutexUnlock(&virStorageBackendRBDConnsLock);
+
+    virStorageBackendRBDConnFree(other);
+    return conn;
+}
+
+
+static void
+virStorageBackendRBDConnRelease(virStorageBackendRBDConn *conn)
+{
+    bool drop = false;
+
+    if (!conn)
+        return;
+
+    virMutexLock(&virStorageBackendRBDConnsLock);
+    if (--conn->refs == 0) {
+        conn->lastused = time(0);
+
+        if (g_hash_table_lookup(virStorageBackendRBDConns, conn->key) != conn) {
+            /* replaced by a new connection while this one was in use */
+            drop = true;
+        } else if (conn->broken) {
+            g_hash_table_steal(virStorageBackendRBDConns, conn->key);
+            drop = true;
+        } else if (virStorageBackendRBDConnsTimer == -1) {
+            virStorageBackendRBDConnsTimer =
+                virEventAddTimeout(VIR_STORAGE_RBD_CONN_PURGE_INTERVAL * 1000,
+                                   virStorageBackendRBDConnsPurge, NULL, NULL);
+        }
+    }
+    virMutexUnlock(&virStorageBackendRBDConnsLock);
+
+    if (drop)
+        virStorageBackendRBDConnFree(conn);
 }
 
 
@@ -377,7 +592,12 @@ virStorageBackendRBDFreeState(virStorageBackendRBDState **ptr)
     if (!*ptr)
         return;
 
-    virStorageBackendRBDCloseRADOSConn(*ptr);
+    if ((*ptr)->ioctx != NULL) {
+        VIR_DEBUG("Closing RADOS IoCTX");
+        rados_ioctx_destroy((*ptr)->ioctx);
+    }
+
+    virStorageBackendRBDConnRelease((*ptr)->conn);
 
     VIR_FREE(*ptr);
 }
@@ -391,11 +611,17 @@ virStorageBackendRBDNewState(virStoragePoolObj *pool)
 
     ptr = g_new0(virStorageBackendRBDState, 1);
 
-    if (virStorageBackendRBDOpenRADOSConn(ptr, def) < 0)
+    if (!(ptr->conn = virStorageBackendRBDConnAcquire(def)))
         goto error;
+    ptr->cluster = ptr->conn->cluster;
 
-    if (virStorageBackendRBDOpenIoCTX(ptr, pool) < 0)
+    if (virStorageBackendRBDOpenIoCTX(ptr, pool) < 0) {
+        /* the cluster might have gone away, connect anew next time */
+        virMutexLock(&virStorageBackendRBDConnsLock);
+        ptr->conn->broken = true;
+        virMutexUnlock(&virStorageBackendRBDConnsLock);
         goto error;
+    }
 
     return ptr;
 
@@ -1200,6 +1426,478 @@ virStorageBackendRBDCloneImage(rados_ioctx_t io,
     return ret;
 }
 
+typedef struct _virStorageBackendRBDExtent virStorageBackendRBDExtent;
+struct _virStorageBackendRBDExtent {
+    uint64_t offset;
+    uint64_t length;
+};
+
+typedef struct _virStorageBackendRBDCopySlot virStorageBackendRBDCopySlot;
+struct _virStorageBackendRBDCopySlot {
+    char *buf;
+    uint64_t offset;
+    size_t length;
+    rbd_completion_t comp;
+};
+
+typedef struct _virStorageBackendRBDCopy virStorageBackendRBDCopy;
+struct _virStorageBackendRBDCopy {
+    rbd_image_t src;            /* source image, or NULL if reading @srcfd */
+    int srcfd;
+    const char *srcname;
+    rbd_image_t dst;
+    const char *dstname;
+
+    virStorageBackendRBDCopySlot *slots;
+    size_t nslots;
+    size_t depth;
+    size_t chunk;
+};
+
+
+static bool
+virStorageBackendRBDBufIsZero(const char *buf,
+                              size_t len)
+{
+    return len == 0 || (buf[0] == 0 && memcmp(buf, buf + 1, len - 1) == 0);
+}
+
+
+#if LIBRBD_VERSION_CODE > 265
+static int
+virStorageBackendRBDCopyExtentCb(uint64_t offset,
+                                 size_t len,
+                                 int exists,
+                                 void *arg)
+{
+    GArray *extents = arg;
+    virStorageBackendRBDExtent *last = NULL;
+    virStorageBackendRBDExtent extent = { .offset = offset, .length = len };
+
+    if (!exists)
+        return 0;
+
+    if (extents->len > 0)
+        last = &g_array_index(extents, virStorageBackendRBDExtent, extents->len - 1);
+
+    if (last && last->offset + last->length == offset)
+        last->length += len;
+    else
+        g_array_append_val(extents, extent);
+
+    return 0;
+}
+
+
+/*
+ * Fills @extents with the parts of @image which hold any data, or with
+ * the whole of @size if there is no @image to query.
+ */
+static int
+virStorageBackendRBDCopyGetExtents(rbd_image_t image,
+                                   const char *imgname,
+                                   uint64_t size,
+                                   GArray *extents)
+{
+    virStorageBackendRBDExtent whole = { .offset = 0, .length = size };
+
+    if (image) {
+        if (rbd_diff_iterate2(image, NULL, 0, size, 1, 1,
+                              virStorageBackendRBDCopyExtentCb, extents) < 0) {
+            virReportSystemError(errno, _("failed to iterate RBD image '%s'"),
+                                 imgname);
+            return -1;
+        }
+
+        VIR_DEBUG("Found %u allocated extents in RBD image %s",
+                  extents->len, imgname);
+        return 0;
+    }
+
+    if (size > 0)
+        g_array_append_val(extents, whole);
+
+    return 0;
+}
+
+#else
+/*
+ * Without rbd_diff_iterate2() the allocation can't be queried cheaply, so
+ * the whole image is copied and only chunks which read back as zeroes are
+ * skipped.
+ */
+static int
+virStorageBackendRBDCopyGetExtents(rbd_image_t image G_GNUC_UNUSED,
+                                   const char *imgname G_GNUC_UNUSED,
+                                   uint64_t size,
+                                   GArray *extents)
+{
+    virStorageBackendRBDExtent whole = { .offset = 0, .length = size };
+
+    if (size > 0)
+        g_array_append_val(extents, whole);
+
+    return 0;
+}
+#endif
+
+
+static int
+virStorageBackendRBDCopyWait(virStorageBackendRBDCopy *copy,
+                             bool writing)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < copy->nslots; i++) {
+        virStorageBackendRBDCopySlot *slot = &copy->slots[i];
+        ssize_t rc;
+
+        if (!slot->comp)
+            continue;
+
+        rbd_aio_wait_for_complete(slot->comp);
+        rc = rbd_aio_get_return_value(slot->comp);
+        rbd_aio_release(slot->comp);
+        slot->comp = NULL;
+
+        if (rc < 0 && ret == 0) {
+            if (writing) {
+                virReportSystemError(-rc, _("writing %zu bytes failed on "
+                                            "RBD image %s at offset %llu"),
+                                     slot->length, copy->dstname,
+                                     (unsigned long long) slot->offset);
+            } else {
+                virReportSystemError(-rc, _("reading %zu bytes failed from "
+                                            "RBD image %s at offset %llu"),
+                                     slot->length, copy->srcname,
+                                     (unsigned long long) slot->offset);
+            }
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+
+static int
+virStorageBackendRBDCopyReadFile(virStorageBackendRBDCopy *copy,
+                                 virStorageBackendRBDCopySlot *slot)
+{
+    size_t done = 0;
+
+    while (done < slot->length) {
+        ssize_t rc = pread(copy->srcfd, slot->buf + done, slot->length - done,
+                           slot->offset + done);
+
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            virReportSystemError(errno, _("reading %zu bytes failed from "
+                                          "%s at offset %llu"),
+                                 slot->length, copy->srcname,
+                                 (unsigned long long) slot->offset);
+            return -1;
+        }
+
+        /* a file shorter than its volume reads as zeroes past the end */
+        if (rc == 0) {
+            memset(slot->buf + done, 0, slot->length - done);
+            break;
+        }
+
+        done += rc;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Copies the chunks collected in @copy: all of them are read at once, then
+ * those which are not all zeroes are written at once. The destination is
+ * a freshly created image, so the chunks skipped read as zeroes already.
+ */
+static int
+virStorageBackendRBDCopyFlush(virStorageBackendRBDCopy *copy)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < copy->nslots && ret == 0; i++) {
+        virStorageBackendRBDCopySlot *slot = &copy->slots[i];
+
+        if (!copy->src) {
+            ret = virStorageBackendRBDCopyReadFile(copy, slot);
+            continue;
+        }
+
+        if (rbd_aio_create_completion(NULL, NULL, &slot->comp) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to create RBD completion"));
+            slot->comp = NULL;
+            ret = -1;
+        } else if (rbd_aio_read(copy->src, slot->offset, slot->length,
+                                slot->buf, slot->comp) < 0) {
+            virReportSystemError(errno, _("failed to read from RBD image %s"),
+                                 copy->srcname);
+            rbd_aio_release(slot->comp);
+            slot->comp = NULL;
+            ret = -1;
+        }
+    }
+
+    if (virStorageBackendRBDCopyWait(copy, false) < 0 || ret < 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    for (i = 0; i < copy->nslots && ret == 0; i++) {
+        virStorageBackendRBDCopySlot *slot = &copy->slots[i];
+
+        if (virStorageBackendRBDBufIsZero(slot->buf, slot->length))
+            continue;
+
+        if (rbd_aio_create_completion(NULL, NULL, &slot->comp) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to create RBD completion"));
+            slot->comp = NULL;
+            ret = -1;
+        } else if (rbd_aio_write(copy->dst, slot->offset, slot->length,
+                                 slot->buf, slot->comp) < 0) {
+            virReportSystemError(errno, _("failed to write to RBD image %s"),
+                                 copy->dstname);
+            rbd_aio_release(slot->comp);
+            slot->comp = NULL;
+            ret = -1;
+        }
+    }
+
+    if (virStorageBackendRBDCopyWait(copy, true) < 0)
+        ret = -1;
+
+ cleanup:
+    copy->nslots = 0;
+    return ret;
+}
+
+
+static size_t
+virStorageBackendRBDCopyGetDepth(rados_t cluster)
+{
+    char buf[32];
+    unsigned int depth;
+
+    if (rados_conf_get(cluster, "rbd_concurrent_management_ops",
+                       buf, sizeof(buf)) < 0 ||
+        virStrToLong_ui(buf, NULL, 10, &depth) < 0 ||
+        depth == 0)
+        return VIR_STORAGE_RBD_COPY_DEPTH_DEFAULT;
+
+    return MIN(depth, VIR_STORAGE_RBD_COPY_DEPTH_MAX);
+}
+
+
+/*
+ * Creates @dstname of @capacity and copies @size bytes of data into it,
+ * either from the RBD image @src, or from @srcfd if @src is NULL.
+ */
+static int
+virStorageBackendRBDCopyImage(virStorageBackendRBDState *ptr,
+                              rbd_image_t src,
+                              int srcfd,
+                              const char *srcname,
+                              uint64_t size,
+                              const char *dstname,
+                              uint64_t capacity)
+{
+    virStorageBackendRBDCopy copy = {
+        .src = src, .srcfd = srcfd, .srcname = srcname, .dstname = dstname };
+    g_autoptr(GArray) extents = NULL;
+    rbd_image_info_t info;
+    int order = 0;
+    size_t i;
+    int ret = -1;
+
+    extents = g_array_new(FALSE, FALSE, sizeof(virStorageBackendRBDExtent));
+    if (virStorageBackendRBDCopyGetExtents(src, srcname, size, extents) < 0)
+        return -1;
+
+    if (rbd_create(ptr->ioctx, dstname, capacity, &order) < 0) {
+        virReportSystemError(errno, _("failed to create volume '%s'"),
+                             dstname);
+        return -1;
+    }
+
+    if (rbd_open(ptr->ioctx, dstname, &copy.dst, NULL) < 0) {
+        virReportSystemError(errno, _("failed to open the RBD image %s"),
+                             dstname);
+        return -1;
+    }
+
+    if (rbd_stat(copy.dst, &info, sizeof(info)) < 0) {
+        virReportSystemError(errno, _("failed to stat the RBD image %s"),
+                             dstname);
+        goto cleanup;
+    }
+
+    copy.chunk = info.obj_size;
+    copy.depth = virStorageBackendRBDCopyGetDepth(ptr->cluster);
+    copy.slots = g_new0(virStorageBackendRBDCopySlot, copy.depth);
+    for (i = 0; i < copy.depth; i++)
+        copy.slots[i].buf = g_new0(char, copy.chunk);
+
+    VIR_DEBUG("Copying %u extents from %s to RBD image %s, "
+              "%zu requests of %zu bytes at once",
+              extents->len, srcname, dstname, copy.depth, copy.chunk);
+
+    for (i = 0; i < extents->len; i++) {
+        virStorageBackendRBDExtent *extent;
+        uint64_t offset;
+        uint64_t end;
+
+        extent = &g_array_index(extents, virStorageBackendRBDExtent, i);
+        offset = extent->offset;
+        end = MIN(extent->offset + extent->length, size);
+
+        while (offset < end) {
+            virStorageBackendRBDCopySlot *slot = &copy.slots[copy.nslots++];
+
+            slot->offset = offset;
+            slot->length = MIN(copy.chunk, end - offset);
+            offset += slot->length;
+
+            if (copy.nslots == copy.depth &&
+                virStorageBackendRBDCopyFlush(&copy) < 0)
+                goto cleanup;
+        }
+    }
+
+    if (copy.nslots > 0 &&
+        virStorageBackendRBDCopyFlush(&copy) < 0)
+        goto cleanup;
+
+    if (rbd_flush(copy.dst) < 0) {
+        virReportSystemError(errno, _("failed to flush RBD image %s"),
+                             dstname);
+        goto cleanup;
+    }
+
+    VIR_DEBUG("Copied %s to RBD image %s", srcname, dstname);
+
+    ret = 0;
+
+ cleanup:
+    if (copy.slots) {
+        for (i = 0; i < copy.depth; i++)
+            g_free(copy.slots[i].buf);
+        g_free(copy.slots);
+    }
+    rbd_close(copy.dst);
+    return ret;
+}
+
+
+static int
+virStorageBackendRBDCopyFromImage(virStorageBackendRBDState *ptr,
+                                  virStorageVolDef *origvol,
+                                  const char *srcpool,
+                                  const char *srcname,
+                                  virStorageVolDef *newvol)
+{
+    rados_ioctx_t srcio = NULL;
+    rbd_image_t image = NULL;
+    rbd_image_info_t info;
+    int ret = -1;
+
+    if (rados_ioctx_create(ptr->cluster, srcpool, &srcio) < 0) {
+        virReportSystemError(errno, _("failed to create the RBD IoCTX. Does the pool '%s' exist?"),
+                             srcpool);
+        goto cleanup;
+    }
+
+    if (rbd_open_read_only(srcio, srcname, &image, NULL) < 0) {
+        virReportSystemError(errno, _("failed to open the RBD image %s"),
+                             origvol->target.path);
+        goto cleanup;
+    }
+
+    if (rbd_stat(image, &info, sizeof(info)) < 0) {
+        virReportSystemError(errno, _("failed to stat the RBD image %s"),
+                             origvol->target.path);
+        goto cleanup;
+    }
+
+    /* Volumes are only known by the pool and image name, at least make
+     * sure this is not an unrelated image of the same name in the cluster
+     * of this pool while the source pool is in another one */
+    if (info.size != origvol->target.capacity) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("RBD image %s in the cluster of this pool does not "
+                         "match the source volume"),
+                       origvol->target.path);
+        goto cleanup;
+    }
+
+    ret = virStorageBackendRBDCopyImage(ptr, image, -1, origvol->target.path,
+                                        info.size, newvol->name,
+                                        newvol->target.capacity);
+
+ cleanup:
+    if (image)
+        rbd_close(image);
+    if (srcio)
+        rados_ioctx_destroy(srcio);
+    return ret;
+}
+
+
+static int
+virStorageBackendRBDCopyFromFile(virStorageBackendRBDState *ptr,
+                                 virStorageVolDef *origvol,
+                                 virStorageVolDef *newvol)
+{
+    VIR_AUTOCLOSE fd = -1;
+
+    if (origvol->target.format != VIR_STORAGE_FILE_RAW ||
+        origvol->target.encryption) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("only unencrypted raw volumes can be copied into "
+                         "this storage pool, '%s' is not"),
+                       origvol->target.path);
+        return -1;
+    }
+
+    if ((fd = open(origvol->target.path, O_RDONLY)) < 0) {
+        virReportSystemError(errno, _("cannot open volume '%s'"),
+                             origvol->target.path);
+        return -1;
+    }
+
+    return virStorageBackendRBDCopyImage(ptr, NULL, fd, origvol->target.path,
+                                         origvol->target.capacity,
+                                         newvol->name, newvol->target.capacity);
+}
+
+
+static bool
+virStorageBackendRBDCanClone(rados_ioctx_t io,
+                             const char *imgname)
+{
+    rbd_image_t image = NULL;
+    uint64_t features = 0;
+
+    if (rbd_open_read_only(io, imgname, &image, NULL) < 0)
+        return true;
+
+    ignore_value(rbd_get_features(image, &features));
+    rbd_close(image);
+
+    return !!(features & RBD_FEATURE_LAYERING);
+}
+
+
 static int
 virStorageBackendRBDBuildVolFrom(virStoragePoolObj *pool,
                                  virStorageVolDef *newvol,
@@ -1208,19 +1906,64 @@ virStorageBackendRBDBuildVolFrom(virStoragePoolObj *pool,
 {
     virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
     virStorageBackendRBDState *ptr = NULL;
+    g_autofree char *srcpool = NULL;
+    char *srcname = NULL;
     int ret = -1;
 
-    VIR_DEBUG("Creating clone of RBD image %s/%s with name %s",
-              def->source.name, origvol->name, newvol->name);
-
     virCheckFlags(0, -1);
 
     if (!(ptr = virStorageBackendRBDNewState(pool)))
         goto cleanup;
 
-    if ((virStorageBackendRBDCloneImage(ptr->ioctx, origvol->name,
-                                        newvol->name)) < 0)
+    switch ((virStorageVolType) origvol->type) {
+    case VIR_STORAGE_VOL_NETWORK:
+        /* RBD volumes are known as 'pool/image' */
+        if (origvol->target.path &&
+            !strstr(origvol->target.path, "://") &&
+            (srcname = strchr(origvol->target.path, '/'))) {
+            srcpool = g_strndup(origvol->target.path,
+                                srcname - origvol->target.path);
+            srcname++;
+        }
+
+        if (!srcname || strchr(srcname, '/')) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                           _("volume '%s' is not an RBD image"),
+                           origvol->name);
+            goto cleanup;
+        }
+
+        if (STREQ(srcpool, def->source.name) &&
+            virStorageBackendRBDCanClone(ptr->ioctx, srcname)) {
+            VIR_DEBUG("Creating clone of RBD image %s/%s with name %s",
+                      def->source.name, srcname, newvol->name);
+
+            if ((virStorageBackendRBDCloneImage(ptr->ioctx, srcname,
+                                                newvol->name)) < 0)
+                goto cleanup;
+            break;
+        }
+
+        if (virStorageBackendRBDCopyFromImage(ptr, origvol, srcpool, srcname,
+                                              newvol) < 0)
+            goto cleanup;
+        break;
+
+    case VIR_STORAGE_VOL_FILE:
+    case VIR_STORAGE_VOL_BLOCK:
+        if (virStorageBackendRBDCopyFromFile(ptr, origvol, newvol) < 0)
+            goto cleanup;
+        break;
+
+    case VIR_STORAGE_VOL_DIR:
+    case VIR_STORAGE_VOL_NETDIR:
+    case VIR_STORAGE_VOL_PLOOP:
+    case VIR_STORAGE_VOL_LAST:
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("volume '%s' can't be copied into an RBD pool"),
+                       origvol->name);
         goto cleanup;
+    }
 
     ret = 0;
 
@@ -98,8 +98,14 @@ storagePoolRefreshImpl(virStorageBackend *backend,
                        virStoragePoolObj *obj,
                        const char *stateFile)
 {
-    virStoragePoolObjClearVols(obj);
-    if (backend->refreshPool(obj) < 0) {
+    int rc;
+
+    /* let the backend reuse volumes which did not change */
+    virStoragePoolObjStashVols(obj);
+    rc = backend->refreshPool(obj);
+    virStoragePoolObjClearStashedVols(obj);
+
+    if (rc < 0) {
         storagePoolRefreshFailCleanup(backend, obj, stateFile);
         return -1;
     }
@@ -1594,9 +1600,11 @@ storageVolLookupByKey(virConnectPtr conn,
         .key = key, .voldef = NULL };
     virStorageVolPtr vol = NULL;
 
-    if ((obj = virStoragePoolObjListSearch(driver->pools,
-                                           storageVolLookupByKeyCallback,
-                                           &data)) && data.voldef) {
+    if ((obj = virStoragePoolObjListFindByVolKey(driver->pools, key,
+                                                 &data.voldef)) ||
+        ((obj = virStoragePoolObjListSearch(driver->pools,
+                                            storageVolLookupByKeyCallback,
+                                            &data)) && data.voldef)) {
         def = virStoragePoolObjGetDef(obj);
         if (virStorageVolLookupByKeyEnsureACL(conn, def, data.voldef) == 0) {
             vol = virGetStorageVol(conn, def->name,
@@ -1677,9 +1685,13 @@ storageVolLookupByPath(virConnectPtr conn,
     if (!(data.cleanpath = virFileSanitizePath(path)))
         return NULL;
 
-    if ((obj = virStoragePoolObjListSearch(driver->pools,
-                                           storageVolLookupByPathCallback,
-                                           &data)) && data.voldef) {
+    /* Most volumes are known under the path they are asked for, try that
+     * before looking for the stable path in every pool */
+    if ((obj = virStoragePoolObjListFindByVolPath(driver->pools, data.cleanpath,
+                                                  &data.voldef)) ||
+        ((obj = virStoragePoolObjListSearch(driver->pools,
+                                            storageVolLookupByPathCallback,
+                                            &data)) && data.voldef)) {
         def = virStoragePoolObjGetDef(obj);
 
         if (virStorageVolLookupByPathEnsureACL(conn, def, data.voldef) == 0) {
@@ -2024,6 +2036,7 @@ storageVolCreateXMLFrom(virStoragePoolPtr pool,
     virStoragePoolDef *def;
     virStoragePoolObj *objsrc = NULL;
     virStorageBackend *backend;
+    virStorageBackend *backendsrc;
     virStorageVolDef *voldefsrc = NULL;
     virStorageVolDef *shadowvol = NULL;
     virStorageVolPtr newvol = NULL;
@@ -2074,6 +2087,7 @@ storageVolCreateXMLFrom(virStoragePoolPtr pool,
 
     if ((backend = virStorageBackendForType(def->type)) == NULL)
         goto cleanup;
+    backendsrc = backend;
 
     voldefsrc = virStorageVolDefFindByName(objsrc ?
                                            objsrc : obj, volsrc->name);
@@ -2125,8 +2139,16 @@ storageVolCreateXMLFrom(virStoragePoolPtr pool,
         goto cleanup;
     }
 
-    if (backend->refreshVol &&
-        backend->refreshVol(obj, voldefsrc) < 0)
+    /* The source volume is refreshed by the backend of its own pool */
+    if (objsrc) {
+        virStoragePoolDef *objsrcdef = virStoragePoolObjGetDef(objsrc);
+
+        if (!(backendsrc = virStorageBackendForType(objsrcdef->type)))
+            goto cleanup;
+    }
+
+    if (backendsrc->refreshVol &&
+        backendsrc->refreshVol(objsrc ? objsrc : obj, voldefsrc) < 0)
         goto cleanup;
 
     /* 'Define' the new volume so we get async progress reporting.
@@ -76,6 +76,8 @@
 #include "virfdstream.h"
 #include "virutil.h"
 #include "virsecureerase.h"
+#include "virthreadpool.h"
+#include "virhostcpu.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -100,6 +102,12 @@ virStorageBackendNamespaceInit(int poolType,
 }
 
 
+/* Upper bound of threads probing volumes of a local pool at once. Probing
+ * files on network filesystems is bound by the latency of the server rather
+ * than by the host CPUs, so more of them are allowed there. */
+#define VIR_STORAGE_PROBE_WORKERS_LOCAL 4
+#define VIR_STORAGE_PROBE_WORKERS_NETWORK 16
+
 #define READ_BLOCK_SIZE_DEFAULT  (1024 * 1024)
 #define WRITE_BLOCK_SIZE_DEFAULT (4 * 1024)
 
@@ -124,6 +132,100 @@ reflinkCloneFile(int dest_fd G_GNUC_UNUSED,
 #endif
 
 
+/*
+ * Copy @total bytes from @inputfd to @fd within the kernel, which lets
+ * filesystems share extents or copy on the server side. With @want_sparse
+ * holes of the input are skipped instead of copied.
+ *
+ * Returns 1 once done, 0 if copy_file_range() can't be used for the files
+ * and the caller has to copy what's left of @total from the current
+ * offsets itself, or -1 on error.
+ */
+#if WITH_COPY_FILE_RANGE
+static int
+storageBackendCopyFileRange(virStorageVolDef *vol,
+                            virStorageVolDef *inputvol,
+                            int inputfd,
+                            int fd,
+                            unsigned long long *total,
+                            bool want_sparse)
+{
+    while (*total > 0) {
+        int inData = 1;
+        long long len = *total;
+
+        if (want_sparse && virFileInData(inputfd, &inData, &len) < 0)
+            return -1;
+
+        if (len > *total)
+            len = *total;
+
+        /* end of the input */
+        if (len == 0)
+            break;
+
+        if (!inData) {
+            if (lseek(inputfd, len, SEEK_CUR) < 0) {
+                virReportSystemError(errno,
+                                     _("cannot seek in file '%s'"),
+                                     inputvol->target.path);
+                return -1;
+            }
+            if (lseek(fd, len, SEEK_CUR) < 0) {
+                virReportSystemError(errno,
+                                     _("cannot extend file '%s'"),
+                                     vol->target.path);
+                return -1;
+            }
+            *total -= len;
+            continue;
+        }
+
+        while (len > 0) {
+            ssize_t got = copy_file_range(inputfd, NULL, fd, NULL, len, 0);
+
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                if (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP ||
+                    errno == EINVAL || errno == EBADF) {
+                    VIR_DEBUG("Can't copy '%s' to '%s' in kernel: %s",
+                              inputvol->target.path, vol->target.path,
+                              g_strerror(errno));
+                    return 0;
+                }
+
+                virReportSystemError(errno,
+                                     _("failed copying '%s' to '%s'"),
+                                     inputvol->target.path, vol->target.path);
+                return -1;
+            }
+
+            if (got == 0)
+                return 1;
+
+            len -= got;
+            *total -= got;
+        }
+    }
+
+    return 1;
+}
+#else
+static int
+storageBackendCopyFileRange(virStorageVolDef *vol G_GNUC_UNUSED,
+                            virStorageVolDef *inputvol G_GNUC_UNUSED,
+                            int inputfd G_GNUC_UNUSED,
+                            int fd G_GNUC_UNUSED,
+                            unsigned long long *total G_GNUC_UNUSED,
+                            bool want_sparse G_GNUC_UNUSED)
+{
+    return 0;
+}
+#endif
+
+
 static int ATTRIBUTE_NONNULL(2)
 virStorageBackendCopyToFD(virStorageVolDef *vol,
                           virStorageVolDef *inputvol,
@@ -136,8 +238,8 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
     size_t rbytes = READ_BLOCK_SIZE_DEFAULT;
     int wbytes = 0;
     int interval;
+    int rc;
     struct stat st;
-    g_autofree char *zerobuf = NULL;
     g_autofree char *buf = NULL;
     VIR_AUTOCLOSE inputfd = -1;
 
@@ -157,8 +259,6 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
     if (wbytes < WRITE_BLOCK_SIZE_DEFAULT)
         wbytes = WRITE_BLOCK_SIZE_DEFAULT;
 
-    zerobuf = g_new0(char, wbytes);
-
     buf = g_new0(char, rbytes);
 
     if (reflink_copy) {
@@ -173,6 +273,12 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
         }
     }
 
+    if ((rc = storageBackendCopyFileRange(vol, inputvol, inputfd, fd,
+                                          total, want_sparse)) < 0)
+        return -1;
+    if (rc > 0)
+        goto sync;
+
     while (amtread != 0) {
         int amtleft;
 
@@ -194,7 +300,7 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
             int offset = amtread - amtleft;
             interval = ((wbytes > amtleft) ? amtleft : wbytes);
 
-            if (want_sparse && memcmp(buf+offset, zerobuf, interval) == 0) {
+            if (want_sparse && virFileDataIsZero(buf+offset, interval)) {
                 if (lseek(fd, interval, SEEK_CUR) < 0) {
                     virReportSystemError(errno,
                                          _("cannot extend file '%s'"),
@@ -211,6 +317,7 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
         } while ((amtleft -= interval) > 0);
     }
 
+ sync:
     if (virFileDataSync(fd) < 0) {
         virReportSystemError(errno, _("cannot sync data to file '%s'"),
                              vol->target.path);
@@ -2133,6 +2240,186 @@ virStorageBackendVolCreateLocal(virStoragePoolObj *pool,
 }
 
 
+/*
+ * Creates @vol as a reflink of @inputvol, sharing all its extents. Returns 1
+ * on success, 0 if the volumes or the filesystem don't allow a reflink and
+ * @required is false, -1 on error.
+ */
+static int
+storageBackendCloneReflink(virStoragePoolObj *pool,
+                           virStorageVolDef *vol,
+                           virStorageVolDef *inputvol,
+                           bool required)
+{
+    virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
+    int operation_flags = VIR_FILE_OPEN_FORCE_MODE | VIR_FILE_OPEN_FORCE_OWNER;
+    mode_t open_mode = VIR_STORAGE_DEFAULT_VOL_PERM_MODE;
+    VIR_AUTOCLOSE fd = -1;
+    VIR_AUTOCLOSE inputfd = -1;
+
+    if (vol->type != VIR_STORAGE_VOL_FILE ||
+        inputvol->type != VIR_STORAGE_VOL_FILE ||
+        vol->target.format != inputvol->target.format ||
+        vol->target.encryption || inputvol->target.encryption ||
+        virStorageSourceHasBacking(&vol->target) ||
+        vol->target.capacity < inputvol->target.capacity ||
+        (vol->target.format != VIR_STORAGE_FILE_RAW &&
+         vol->target.capacity != inputvol->target.capacity)) {
+        if (!required)
+            return 0;
+
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("volume '%s' can only be cloned by a reflink into "
+                         "an unencrypted volume of the same format and size"),
+                       inputvol->name);
+        return -1;
+    }
+
+    if (def->type == VIR_STORAGE_POOL_NETFS)
+        operation_flags |= VIR_FILE_OPEN_FORK;
+
+    if (vol->target.perms->mode != (mode_t)-1)
+        open_mode = vol->target.perms->mode;
+
+    if ((inputfd = open(inputvol->target.path, O_RDONLY)) < 0) {
+        virReportSystemError(errno,
+                             _("could not open input path '%s'"),
+                             inputvol->target.path);
+        return -1;
+    }
+
+    if ((fd = virFileOpenAs(vol->target.path,
+                            O_RDWR | O_CREAT | O_EXCL,
+                            open_mode,
+                            vol->target.perms->uid,
+                            vol->target.perms->gid,
+                            operation_flags)) < 0) {
+        virReportSystemError(-fd,
+                             _("Failed to create file '%s'"),
+                             vol->target.path);
+        return -1;
+    }
+
+    if (reflinkCloneFile(fd, inputfd) < 0) {
+        int err = errno;
+
+        virFileRemove(vol->target.path,
+                      vol->target.perms->uid,
+                      vol->target.perms->gid);
+
+        if (!required &&
+            (err == ENOTSUP || err == EOPNOTSUPP || err == ENOTTY ||
+             err == EXDEV || err == EINVAL || err == ENOSYS)) {
+            VIR_DEBUG("reflink of '%s' not possible, copying the data: %s",
+                      inputvol->target.path, g_strerror(err));
+            return 0;
+        }
+
+        virReportSystemError(err,
+                             _("failed to clone files from '%s'"),
+                             inputvol->target.path);
+        return -1;
+    }
+
+    /* a raw clone may be larger than its source */
+    if (vol->target.capacity > inputvol->target.capacity &&
+        ftruncate(fd, vol->target.capacity) < 0) {
+        virReportSystemError(errno,
+                             _("cannot extend file '%s'"),
+                             vol->target.path);
+        goto error;
+    }
+
+    if (g_fsync(fd) < 0) {
+        virReportSystemError(errno, _("cannot sync data to file '%s'"),
+                             vol->target.path);
+        goto error;
+    }
+
+    return 1;
+
+ error:
+    virFileRemove(vol->target.path,
+                  vol->target.perms->uid,
+                  vol->target.perms->gid);
+    return -1;
+}
+
+
+/*
+ * Creates @vol as a qcow2 overlay using @inputvol as its backing file.
+ * Returns 1 on success, 0 if @vol is not a plain qcow2 volume and must be
+ * copied instead, -1 on error.
+ */
+static int
+storageBackendCloneOverlay(virStoragePoolObj *pool,
+                           virStorageVolDef *vol,
+                           virStorageVolDef *inputvol,
+                           unsigned int flags)
+{
+    virStorageSource *origBacking = vol->target.backingStore;
+    virStorageSource *backing;
+    int ret;
+
+    if (vol->type != VIR_STORAGE_VOL_FILE ||
+        vol->target.format != VIR_STORAGE_FILE_QCOW2 ||
+        vol->target.encryption || inputvol->target.encryption ||
+        virStorageSourceHasBacking(&vol->target))
+        return 0;
+
+    backing = virStorageSourceNew();
+    backing->type = VIR_STORAGE_TYPE_FILE;
+    backing->path = g_strdup(inputvol->target.path);
+    backing->format = inputvol->target.format;
+
+    /* the overlay is built as if the backing store was part of @vol's
+     * definition, which must be restored afterwards as @vol may be a
+     * shallow copy of the caller's definition */
+    vol->target.backingStore = backing;
+
+    ret = storageBackendCreateQemuImg(pool, vol, NULL,
+                                      flags & ~VIR_STORAGE_VOL_CREATE_REFLINK);
+
+    vol->target.backingStore = origBacking;
+    virObjectUnref(backing);
+
+    return ret < 0 ? -1 : 1;
+}
+
+
+/*
+ * Clones @inputvol into @vol without copying its data if the clone mode of
+ * @pool asks for it. Returns 1 if @vol was created, 0 if the data needs to be
+ * copied and -1 on error.
+ */
+static int
+storageBackendCloneLocal(virStoragePoolObj *pool,
+                         virStorageVolDef *vol,
+                         virStorageVolDef *inputvol,
+                         unsigned int flags)
+{
+    virStoragePoolDef *def = virStoragePoolObjGetDef(pool);
+
+    switch (def->features.cloneMode) {
+    case VIR_STORAGE_POOL_CLONE_MODE_REFLINK:
+        return storageBackendCloneReflink(pool, vol, inputvol, true);
+
+    case VIR_STORAGE_POOL_CLONE_MODE_AUTO:
+        return storageBackendCloneReflink(pool, vol, inputvol, false);
+
+    case VIR_STORAGE_POOL_CLONE_MODE_OVERLAY:
+        return storageBackendCloneOverlay(pool, vol, inputvol, flags);
+
+    case VIR_STORAGE_POOL_CLONE_MODE_DEFAULT:
+    case VIR_STORAGE_POOL_CLONE_MODE_FULL:
+    case VIR_STORAGE_POOL_CLONE_MODE_LAST:
+        break;
+    }
+
+    return 0;
+}
+
+
 static int
 storageBackendVolBuildLocal(virStoragePoolObj *pool,
                             virStorageVolDef *vol,
@@ -2142,6 +2429,11 @@ storageBackendVolBuildLocal(virStoragePoolObj *pool,
     virStorageBackendBuildVolFrom create_func;
 
     if (inputvol) {
+        int rc;
+
+        if ((rc = storageBackendCloneLocal(pool, vol, inputvol, flags)) != 0)
+            return rc < 0 ? -1 : 0;
+
         if (!(create_func =
               virStorageBackendGetBuildVolFromFunction(vol, inputvol)))
             return -1;
@@ -2570,6 +2862,51 @@ storageBackendVolZeroSparseFileLocal(const char *path,
 }
 
 
+/*
+ * Zero @len bytes of @fd at @offset without writing buffers of zeroes,
+ * leaving it to the kernel and the storage where they support it.
+ *
+ * Returns true if the range was zeroed, false if the caller has to do it.
+ */
+static bool
+storageBackendWipeLocalOffload(const char *path,
+                               int fd,
+                               unsigned long long offset,
+                               unsigned long long len)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+        return false;
+
+#ifdef BLKZEROOUT
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t range[2] = { offset, len };
+
+        if (ioctl(fd, BLKZEROOUT, range) == 0)
+            return true;
+
+        VIR_DEBUG("BLKZEROOUT failed on '%s': %s", path, g_strerror(errno));
+        return false;
+    }
+#endif
+
+#if WITH_FALLOCATE - 0 && defined(FALLOC_FL_ZERO_RANGE)
+    if (S_ISREG(st.st_mode)) {
+        if (fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+                      offset, len) == 0)
+            return true;
+
+        VIR_DEBUG("Zeroing range failed on '%s': %s", path, g_strerror(errno));
+        return false;
+    }
+#endif
+
+    VIR_DEBUG("Can't offload zeroing '%s'", path);
+    return false;
+}
+
+
 static int
 storageBackendWipeLocal(const char *path,
                         int fd,
@@ -2603,7 +2940,11 @@ storageBackendWipeLocal(const char *path,
 
     VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
 
-    remaining = wipe_len;
+    if (storageBackendWipeLocalOffload(path, fd, size, wipe_len))
+        remaining = 0;
+    else
+        remaining = wipe_len;
+
     while (remaining > 0) {
         size_t write_size = MIN(writebuf_length, remaining);
         int written = safewrite(fd, writebuf, write_size);
@@ -2633,6 +2974,70 @@ storageBackendWipeLocal(const char *path,
 }
 
 
+/*
+ * Discard all data of @fd, securely if the device supports it.
+ */
+static int
+storageBackendVolTrimLocal(const char *path,
+                           int fd,
+                           struct stat *st)
+{
+#ifdef BLKDISCARD
+    if (S_ISBLK(st->st_mode)) {
+        uint64_t range[2] = { 0, 0 };
+        off_t size;
+
+        if ((size = lseek(fd, 0, SEEK_END)) < 0) {
+            virReportSystemError(errno,
+                                 _("Failed to seek to the end in volume "
+                                   "with path '%s'"),
+                                 path);
+            return -1;
+        }
+        range[1] = size;
+
+# ifdef BLKSECDISCARD
+        if (ioctl(fd, BLKSECDISCARD, range) == 0)
+            return 0;
+        VIR_DEBUG("BLKSECDISCARD failed on '%s': %s", path, g_strerror(errno));
+# endif
+
+        if (ioctl(fd, BLKDISCARD, range) == 0)
+            return 0;
+
+        if (errno != EOPNOTSUPP) {
+            virReportSystemError(errno,
+                                 _("Failed to discard storage volume with "
+                                   "path '%s'"),
+                                 path);
+            return -1;
+        }
+    }
+#endif
+
+#if WITH_FALLOCATE - 0 && defined(FALLOC_FL_PUNCH_HOLE)
+    if (S_ISREG(st->st_mode)) {
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      0, st->st_size) == 0)
+            return 0;
+
+        if (errno != EOPNOTSUPP) {
+            virReportSystemError(errno,
+                                 _("Failed to discard storage volume with "
+                                   "path '%s'"),
+                                 path);
+            return -1;
+        }
+    }
+#endif
+
+    virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                   _("'trim' algorithm not supported for volume '%s'"),
+                   path);
+    return -1;
+}
+
+
 static int
 storageBackendVolWipeLocalFile(const char *path,
                                unsigned int algorithm,
@@ -2688,9 +3093,8 @@ storageBackendVolWipeLocalFile(const char *path,
         alg_char = "random";
         break;
     case VIR_STORAGE_VOL_WIPE_ALG_TRIM:
-        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED, "%s",
-                       _("'trim' algorithm not supported"));
-        return -1;
+        alg_char = "trim";
+        break;
     case VIR_STORAGE_VOL_WIPE_ALG_LAST:
         virReportError(VIR_ERR_INVALID_ARG,
                        _("unsupported algorithm %d"),
@@ -2700,6 +3104,9 @@ storageBackendVolWipeLocalFile(const char *path,
 
     VIR_DEBUG("Wiping file '%s' with algorithm '%s'", path, alg_char);
 
+    if (algorithm == VIR_STORAGE_VOL_WIPE_ALG_TRIM)
+        return storageBackendVolTrimLocal(path, fd, &st);
+
     if (algorithm != VIR_STORAGE_VOL_WIPE_ALG_ZERO) {
         cmd = virCommandNew(SCRUB);
         virCommandAddArgList(cmd, "-f", "-p", alg_char, path, NULL);
@@ -3551,9 +3958,183 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDef *vol)
 }
 
 
+static void
+virStorageBackendVolFileIDSet(virStorageVolFileID *id,
+                              const struct stat *sb,
+                              time_t now)
+{
+    id->dev = sb->st_dev;
+    id->ino = sb->st_ino;
+    id->size = sb->st_size;
+    id->mtime = sb->st_mtime;
+    id->ctime = sb->st_ctime;
+
+    /* Timestamps have a granularity of a second on some filesystems, so a
+     * file changed within the same second after it was probed would look
+     * unchanged. Don't trust files that are that fresh. */
+    id->valid = sb->st_mtime < now && sb->st_ctime < now;
+}
+
+
+static bool
+virStorageBackendVolFileIDMatch(const virStorageVolFileID *id,
+                                const struct stat *sb)
+{
+    return id->valid &&
+           id->dev == (unsigned long long) sb->st_dev &&
+           id->ino == (unsigned long long) sb->st_ino &&
+           id->size == (unsigned long long) sb->st_size &&
+           id->mtime == (long long) sb->st_mtime &&
+           id->ctime == (long long) sb->st_ctime;
+}
+
+
+typedef struct _virStorageBackendProbeCtx virStorageBackendProbeCtx;
+struct _virStorageBackendProbeCtx {
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+typedef struct _virStorageBackendProbeEntry virStorageBackendProbeEntry;
+struct _virStorageBackendProbeEntry {
+    virStorageVolDef *vol;
+    struct stat sb;
+    bool haveStat;
+    time_t now;
+
+    int err;                /* result of probing @vol */
+    virErrorPtr error;      /* error raised while probing @vol */
+};
+
+
+static void
+virStorageBackendProbeEntryFree(virStorageBackendProbeEntry *entry)
+{
+    if (!entry)
+        return;
+
+    virStorageVolDefFree(entry->vol);
+    virFreeError(entry->error);
+    g_free(entry);
+}
+
+
+static void
+virStorageBackendProbeVol(virStorageBackendProbeEntry *entry)
+{
+    if ((entry->err = virStorageBackendRefreshVolTargetUpdate(entry->vol)) < 0)
+        virErrorPreserveLast(&entry->error);
+}
+
+
+static void
+virStorageBackendProbeWorker(void *jobdata,
+                             void *opaque)
+{
+    virStorageBackendProbeEntry *entry = jobdata;
+    virStorageBackendProbeCtx *ctx = opaque;
+
+    virStorageBackendProbeVol(entry);
+
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/*
+ * Probes volumes in all @entries, using a bounded pool of worker threads
+ * if there's enough of them to make it worthwhile. The limit of workers
+ * depends on the type of @def.
+ */
+static void
+virStorageBackendProbeVols(virStoragePoolDef *def,
+                           GPtrArray *entries)
+{
+    virStorageBackendProbeCtx ctx = { 0 };
+    virThreadPool *pool = NULL;
+    int nworkers;
+    size_t i;
+
+    if (def->type == VIR_STORAGE_POOL_NETFS ||
+        def->type == VIR_STORAGE_POOL_VSTORAGE) {
+        nworkers = VIR_STORAGE_PROBE_WORKERS_NETWORK;
+    } else {
+        if ((nworkers = virHostCPUGetCount()) < 0) {
+            virResetLastError();
+            nworkers = 1;
+        }
+        nworkers = MIN(nworkers, VIR_STORAGE_PROBE_WORKERS_LOCAL);
+    }
+    nworkers = MIN(nworkers, entries->len);
+
+    if (nworkers > 1 &&
+        virMutexInit(&ctx.lock) == 0) {
+        if (virCondInit(&ctx.cond) == 0) {
+            pool = virThreadPoolNewFull(0, nworkers, 0,
+                                        virStorageBackendProbeWorker,
+                                        "storage-probe", NULL, &ctx);
+            if (!pool)
+                virCondDestroy(&ctx.cond);
+        }
+        if (!pool)
+            virMutexDestroy(&ctx.lock);
+    }
+
+    if (!pool) {
+        /* Fall back to probing in this thread */
+        virResetLastError();
+        for (i = 0; i < entries->len; i++)
+            virStorageBackendProbeVol(g_ptr_array_index(entries, i));
+        return;
+    }
+
+    VIR_DEBUG("Probing %u volumes under '%s' using %d workers",
+              entries->len, def->target.path, nworkers);
+
+    for (i = 0; i < entries->len; i++) {
+        virStorageBackendProbeEntry *entry = g_ptr_array_index(entries, i);
+
+        virMutexLock(&ctx.lock);
+        ctx.pending++;
+        virMutexUnlock(&ctx.lock);
+
+        if (virThreadPoolSendJob(pool, 0, entry) < 0) {
+            virMutexLock(&ctx.lock);
+            ctx.pending--;
+            virMutexUnlock(&ctx.lock);
+
+            virResetLastError();
+            virStorageBackendProbeVol(entry);
+        }
+    }
+
+    virMutexLock(&ctx.lock);
+    while (ctx.pending > 0) {
+        if (virCondWait(&ctx.cond, &ctx.lock) < 0) {
+            VIR_WARN("Failed to wait for volumes to be probed");
+            break;
+        }
+    }
+    virMutexUnlock(&ctx.lock);
+
+    /* Waits for any worker still running */
+    virThreadPoolFree(pool);
+    virCondDestroy(&ctx.cond);
+    virMutexDestroy(&ctx.lock);
+}
+
+
 /**
  * Iterate over the pool's directory and enumerate all disk images
  * within it. This is non-recursive.
+ *
+ * Volumes known from the previous refresh whose file has the same inode,
+ * size and modification and change times are taken over as they are
+ * instead of opening and probing the file again. The remaining files are
+ * probed in parallel and added in the order they were listed in.
  */
 int
 virStorageBackendRefreshLocal(virStoragePoolObj *pool)
@@ -3567,12 +4148,20 @@ virStorageBackendRefreshLocal(virStoragePoolObj *pool)
     g_autoptr(virStorageVolDef) vol = NULL;
     VIR_AUTOCLOSE fd = -1;
     g_autoptr(virStorageSource) target = NULL;
+    g_autoptr(GPtrArray) entries = NULL;
+    size_t i;
 
     if (virDirOpen(&dir, def->target.path) < 0)
         return -1;
 
+    entries = g_ptr_array_new_with_free_func((GDestroyNotify) virStorageBackendProbeEntryFree);
+
     while ((direrr = virDirRead(dir, &ent, def->target.path)) > 0) {
-        int err;
+        g_autofree char *path = NULL;
+        virStorageBackendProbeEntry *entry;
+        struct stat sb;
+        bool haveStat;
+        time_t now;
 
         if (virStringHasControlChars(ent->d_name)) {
             VIR_WARN("Ignoring file '%s' with control characters under '%s'",
@@ -3580,32 +4169,63 @@ virStorageBackendRefreshLocal(virStoragePoolObj *pool)
             continue;
         }
 
-        vol = g_new0(virStorageVolDef, 1);
+        path = g_strdup_printf("%s/%s", def->target.path, ent->d_name);
+        haveStat = stat(path, &sb) == 0;
+        now = time(NULL);
 
-        vol->name = g_strdup(ent->d_name);
+        if ((vol = virStoragePoolObjTakeStashedVol(pool, ent->d_name))) {
+            if (haveStat && virStorageBackendVolFileIDMatch(&vol->fileID, &sb)) {
+                VIR_DEBUG("Volume '%s' did not change, not probing it", path);
+                if (virStoragePoolObjAddVol(pool, vol) < 0)
+                    return -1;
+                vol = NULL;
+                continue;
+            }
+            g_clear_pointer(&vol, virStorageVolDefFree);
+        }
 
-        vol->type = VIR_STORAGE_VOL_FILE;
-        vol->target.path = g_strdup_printf("%s/%s", def->target.path, vol->name);
+        entry = g_new0(virStorageBackendProbeEntry, 1);
+        g_ptr_array_add(entries, entry);
+
+        entry->sb = sb;
+        entry->haveStat = haveStat;
+        entry->now = now;
+
+        entry->vol = g_new0(virStorageVolDef, 1);
+
+        entry->vol->name = g_strdup(ent->d_name);
+
+        entry->vol->type = VIR_STORAGE_VOL_FILE;
+        entry->vol->target.path = g_steal_pointer(&path);
 
-        vol->key = g_strdup(vol->target.path);
+        entry->vol->key = g_strdup(entry->vol->target.path);
+    }
+    if (direrr < 0)
+        return -1;
+
+    virStorageBackendProbeVols(def, entries);
+
+    for (i = 0; i < entries->len; i++) {
+        virStorageBackendProbeEntry *entry = g_ptr_array_index(entries, i);
 
-        if ((err = virStorageBackendRefreshVolTargetUpdate(vol)) < 0) {
-            if (err == -2) {
+        if (entry->err < 0) {
+            if (entry->err == -2) {
                 /* Silently ignore non-regular files,
                  * eg 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
                 continue;
             }
+            virErrorRestore(&entry->error);
             return -1;
         }
 
-        if (virStoragePoolObjAddVol(pool, vol) < 0)
+        if (entry->haveStat)
+            virStorageBackendVolFileIDSet(&entry->vol->fileID,
+                                          &entry->sb, entry->now);
+
+        if (virStoragePoolObjAddVol(pool, entry->vol) < 0)
             return -1;
-        vol = NULL;
+        entry->vol = NULL;
     }
-    if (direrr < 0)
-        return -1;
 
     target = virStorageSourceNew();
 
@@ -37,6 +37,7 @@
 #include "virobject.h"
 #include "virstoragefile.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
@@ -93,6 +94,191 @@ virStorageSourceMetadataNew(const char *path,
 }
 
 
+/*
+ * Headers of local image files read when probing metadata, so that images
+ * shared by many backing chains, like a common base image, are not read
+ * over and over again. Entries are keyed by device and inode of the file
+ * along with the user and group it was read as, and stay valid as long as
+ * size, mtime and ctime of the file do not change.
+ */
+#define VIR_STORAGE_SOURCE_HEADER_CACHE_MAX 256
+
+typedef struct _virStorageSourceHeader virStorageSourceHeader;
+struct _virStorageSourceHeader {
+    off_t size;
+    time_t mtime;
+    time_t ctime;
+    char *buf;
+    size_t len;
+};
+
+static virMutex virStorageSourceHeaderCacheLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStorageSourceHeaderCache;
+
+
+static void
+virStorageSourceHeaderFree(void *opaque)
+{
+    virStorageSourceHeader *hdr = opaque;
+
+    if (!hdr)
+        return;
+
+    g_free(hdr->buf);
+    g_free(hdr);
+}
+
+
+static char *
+virStorageSourceHeaderCacheFileKey(const struct stat *sb)
+{
+    return g_strdup_printf("%llu:%llu:",
+                           (unsigned long long)sb->st_dev,
+                           (unsigned long long)sb->st_ino);
+}
+
+
+static char *
+virStorageSourceHeaderCacheKey(const struct stat *sb,
+                               uid_t uid,
+                               gid_t gid)
+{
+    g_autofree char *filekey = virStorageSourceHeaderCacheFileKey(sb);
+
+    return g_strdup_printf("%s%lld:%lld", filekey,
+                           (long long)uid, (long long)gid);
+}
+
+
+/* Returns the length of the cached header of the file described by @sb
+ * with a copy of it in @buf, or -1 if there is none. */
+static ssize_t
+virStorageSourceHeaderCacheLookup(const struct stat *sb,
+                                  uid_t uid,
+                                  gid_t gid,
+                                  char **buf)
+{
+    g_autofree char *key = NULL;
+    virStorageSourceHeader *hdr;
+    ssize_t ret = -1;
+
+    if (!S_ISREG(sb->st_mode))
+        return -1;
+
+    key = virStorageSourceHeaderCacheKey(sb, uid, gid);
+
+    virMutexLock(&virStorageSourceHeaderCacheLock);
+
+    if (virStorageSourceHeaderCache &&
+        (hdr = virHashLookup(virStorageSourceHeaderCache, key))) {
+        if (hdr->size == sb->st_size &&
+            hdr->mtime == sb->st_mtime &&
+            hdr->ctime == sb->st_ctime) {
+            *buf = g_new0(char, hdr->len + 1);
+            memcpy(*buf, hdr->buf, hdr->len);
+            ret = hdr->len;
+        } else {
+            virHashRemoveEntry(virStorageSourceHeaderCache, key);
+        }
+    }
+
+    virMutexUnlock(&virStorageSourceHeaderCacheLock);
+
+    return ret;
+}
+
+
+static void
+virStorageSourceHeaderCacheStore(const struct stat *sb,
+                                 uid_t uid,
+                                 gid_t gid,
+                                 const char *buf,
+                                 size_t len)
+{
+    virStorageSourceHeader *hdr;
+    time_t now = time(NULL);
+
+    if (!S_ISREG(sb->st_mode))
+        return;
+
+    /* The timestamps have a granularity of a second, so a file changed in
+     * the current second may change again without them telling. Such files
+     * are not cached until they settle. */
+    if (sb->st_mtime >= now || sb->st_ctime >= now)
+        return;
+
+    hdr = g_new0(virStorageSourceHeader, 1);
+    hdr->size = sb->st_size;
+    hdr->mtime = sb->st_mtime;
+    hdr->ctime = sb->st_ctime;
+    hdr->buf = g_new0(char, len + 1);
+    memcpy(hdr->buf, buf, len);
+    hdr->len = len;
+
+    virMutexLock(&virStorageSourceHeaderCacheLock);
+
+    if (!virStorageSourceHeaderCache)
+        virStorageSourceHeaderCache = virHashNew(virStorageSourceHeaderFree);
+
+    /* The number of distinct images a host probes is usually way below the
+     * limit, simply start over when it is reached */
+    if (virHashSize(virStorageSourceHeaderCache) >= VIR_STORAGE_SOURCE_HEADER_CACHE_MAX)
+        virHashRemoveAll(virStorageSourceHeaderCache);
+
+    g_hash_table_insert(virStorageSourceHeaderCache,
+                        virStorageSourceHeaderCacheKey(sb, uid, gid), hdr);
+
+    virMutexUnlock(&virStorageSourceHeaderCacheLock);
+}
+
+
+static gboolean
+virStorageSourceHeaderCacheMatchFile(gpointer key,
+                                     gpointer value G_GNUC_UNUSED,
+                                     gpointer opaque)
+{
+    return g_str_has_prefix(key, opaque);
+}
+
+
+/**
+ * virStorageSourceHeaderCacheInvalidate:
+ * @src: top of a backing chain
+ *
+ * Drops the cached headers of all local images of the chain starting at
+ * @src. Meant to be called when the chain was modified, e.g. by a block
+ * job, so that it is read again when probed next time.
+ */
+void
+virStorageSourceHeaderCacheInvalidate(virStorageSource *src)
+{
+    g_autoptr(GPtrArray) filekeys = g_ptr_array_new_with_free_func(g_free);
+    virStorageSource *n;
+    size_t i;
+
+    for (n = src; virStorageSourceIsBacking(n); n = n->backingStore) {
+        struct stat sb;
+
+        if (!virStorageSourceIsLocalStorage(n) || !n->path ||
+            stat(n->path, &sb) < 0)
+            continue;
+
+        g_ptr_array_add(filekeys, virStorageSourceHeaderCacheFileKey(&sb));
+    }
+
+    virMutexLock(&virStorageSourceHeaderCacheLock);
+
+    if (virStorageSourceHeaderCache) {
+        for (i = 0; i < filekeys->len; i++)
+            g_hash_table_foreach_remove(virStorageSourceHeaderCache,
+                                        virStorageSourceHeaderCacheMatchFile,
+                                        g_ptr_array_index(filekeys, i));
+    }
+
+    virMutexUnlock(&virStorageSourceHeaderCacheLock);
+}
+
+
 /**
  * virStorageSourceGetMetadataFromBuf:
  * @path: name of file, for error messages
@@ -154,7 +340,7 @@ virStorageSourceGetMetadataFromFD(const char *path,
                                   int format)
 
 {
-    ssize_t len = VIR_STORAGE_MAX_HEADER;
+    ssize_t len;
     struct stat sb;
     g_autofree char *buf = NULL;
     g_autoptr(virStorageSource) meta = NULL;
@@ -176,14 +362,19 @@ virStorageSourceGetMetadataFromFD(const char *path,
         return g_steal_pointer(&meta);
     }
 
-    if (lseek(fd, 0, SEEK_SET) == (off_t)-1) {
-        virReportSystemError(errno, _("cannot seek to start of '%s'"), meta->path);
-        return NULL;
-    }
+    /* The caller opened @fd, so there is no identity to read it as */
+    if ((len = virStorageSourceHeaderCacheLookup(&sb, -1, -1, &buf)) < 0) {
+        if (lseek(fd, 0, SEEK_SET) == (off_t)-1) {
+            virReportSystemError(errno, _("cannot seek to start of '%s'"), meta->path);
+            return NULL;
+        }
 
-    if ((len = virFileReadHeaderFD(fd, len, &buf)) < 0) {
-        virReportSystemError(errno, _("cannot read header '%s'"), meta->path);
-        return NULL;
+        if ((len = virFileReadHeaderFD(fd, VIR_STORAGE_MAX_HEADER, &buf)) < 0) {
+            virReportSystemError(errno, _("cannot read header '%s'"), meta->path);
+            return NULL;
+        }
+
+        virStorageSourceHeaderCacheStore(&sb, -1, -1, buf, len);
     }
 
     if (virStorageFileProbeGetMetadata(meta, buf, len) < 0)
@@ -1265,7 +1456,9 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
                                              size_t *headerLen)
 {
     int ret = -1;
-    ssize_t len;
+    ssize_t len = -1;
+    struct stat sb;
+    bool cacheable;
 
     if (virStorageSourceInitAs(src, uid, gid) < 0)
         return -1;
@@ -1275,8 +1468,19 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
         goto cleanup;
     }
 
-    if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
-        goto cleanup;
+    cacheable = virStorageSourceIsLocalStorage(src) &&
+                virStorageSourceStat(src, &sb) == 0;
+
+    if (cacheable)
+        len = virStorageSourceHeaderCacheLookup(&sb, uid, gid, buf);
+
+    if (len < 0) {
+        if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
+            goto cleanup;
+
+        if (cacheable)
+            virStorageSourceHeaderCacheStore(&sb, uid, gid, *buf, len);
+    }
 
     *headerLen = len;
     ret = 0;
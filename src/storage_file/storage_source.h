@@ -39,6 +39,9 @@ virStorageSourceGetMetadataFromBuf(const char *path,
                                    int format)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+void
+virStorageSourceHeaderCacheInvalidate(virStorageSource *src);
+
 virStorageSource *
 virStorageSourceChainLookup(virStorageSource *chain,
                             virStorageSource *startFrom,
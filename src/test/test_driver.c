@@ -117,10 +117,15 @@ struct _testDriver {
     virDomainObjList *domains;
     virNetworkObjList *networks;
     virObjectEventState *eventState;
+
+    /* immutable after test:///scale was opened, 0 for other connections */
+    unsigned int scaleDomains;
+    gint64 scaleStart;
 };
 typedef struct _testDriver testDriver;
 
 static testDriver *defaultPrivconn;
+static testDriver *scalePrivconn;
 static virMutex defaultLock = VIR_MUTEX_INITIALIZER;
 
 static virClass *testDriverClass;
@@ -608,6 +613,34 @@ static const char *defaultConnXML =
  "</device>"
 "</node>";
 
+/* Template of the domains synthesized by test:///scale. It's filled in with
+ * the index of the domain for the name, UUID and disk, and with the three
+ * lower bytes of the index for the MAC address. */
+#define TEST_SCALE_DOMAIN_XML \
+"<domain type='test'>" \
+"  <name>scale-%u</name>" \
+"  <uuid>7fd5e4d0-0000-4000-8000-%012x</uuid>" \
+"  <memory>2097152</memory>" \
+"  <currentMemory>1048576</currentMemory>" \
+"  <vcpu>2</vcpu>" \
+"  <os>" \
+"    <type>hvm</type>" \
+"  </os>" \
+"  <devices>" \
+"    <disk type='file' device='disk'>" \
+"      <source file='/guest/scale-%u.img'/>" \
+"      <target dev='vda' bus='virtio'/>" \
+"    </disk>" \
+"    <interface type='network'>" \
+"      <mac address='52:54:00:%02x:%02x:%02x'/>" \
+"      <source network='default' bridge='virbr0'/>" \
+"    </interface>" \
+"  </devices>" \
+"</domain>"
+
+/* Number of domains of test:///scale unless given with ?domains=N */
+#define TEST_SCALE_DEFAULT_DOMAINS 1000
+
 
 static const char *defaultPoolSourcesLogicalXML =
 "<sources>\n"
@@ -1389,30 +1422,15 @@ testOpenFromFile(virConnectPtr conn, const char *file)
     return VIR_DRV_OPEN_ERROR;
 }
 
-/* Simultaneous test:///default connections should share the same
- * common state (among other things, this allows testing event
- * detection in one connection for an action caused in another).  */
+/* Fills @privconn with the host and objects of test:///default */
 static int
-testOpenDefault(virConnectPtr conn)
+testOpenDefaultParse(virConnectPtr conn,
+                     testDriver *privconn)
 {
-    int ret = VIR_DRV_OPEN_ERROR;
-    testDriver *privconn = NULL;
     g_autoptr(xmlDoc) doc = NULL;
     g_autoptr(xmlXPathContext) ctxt = NULL;
     size_t i;
 
-    virMutexLock(&defaultLock);
-    if (defaultPrivconn) {
-        conn->privateData = virObjectRef(defaultPrivconn);
-        virMutexUnlock(&defaultLock);
-        return VIR_DRV_OPEN_SUCCESS;
-    }
-
-    if (!(privconn = testDriverNew()))
-        goto error;
-
-    conn->privateData = privconn;
-
     memmove(&privconn->nodeInfo, &defaultNodeInfo, sizeof(defaultNodeInfo));
 
     /* Numa setup */
@@ -1433,13 +1451,38 @@ testOpenDefault(virConnectPtr conn)
     }
 
     if (!(privconn->caps = testBuildCapabilities(conn)))
-        goto error;
+        return -1;
 
     if (!(doc = virXMLParseStringCtxt(defaultConnXML,
                                       _("(test driver)"), &ctxt)))
+        return -1;
+
+    return testOpenParse(privconn, NULL, ctxt);
+}
+
+
+/* Simultaneous test:///default connections should share the same
+ * common state (among other things, this allows testing event
+ * detection in one connection for an action caused in another).  */
+static int
+testOpenDefault(virConnectPtr conn)
+{
+    int ret = VIR_DRV_OPEN_ERROR;
+    testDriver *privconn = NULL;
+
+    virMutexLock(&defaultLock);
+    if (defaultPrivconn) {
+        conn->privateData = virObjectRef(defaultPrivconn);
+        virMutexUnlock(&defaultLock);
+        return VIR_DRV_OPEN_SUCCESS;
+    }
+
+    if (!(privconn = testDriverNew()))
         goto error;
 
-    if (testOpenParse(privconn, NULL, ctxt) < 0)
+    conn->privateData = privconn;
+
+    if (testOpenDefaultParse(conn, privconn) < 0)
         goto error;
 
     defaultPrivconn = privconn;
@@ -1454,6 +1497,124 @@ testOpenDefault(virConnectPtr conn)
     goto cleanup;
 }
 
+
+/* Adds the @ndomains synthesized domains of test:///scale. Four out of
+ * five of them are running. */
+static int
+testOpenScaleDomains(testDriver *privconn,
+                     unsigned int ndomains)
+{
+    unsigned int i;
+
+    for (i = 0; i < ndomains; i++) {
+        g_autofree char *xml = NULL;
+        virDomainDef *def;
+        virDomainObj *obj;
+
+        xml = g_strdup_printf(TEST_SCALE_DOMAIN_XML, i, i, i,
+                              (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+
+        if (!(def = virDomainDefParseString(xml, privconn->xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE)))
+            return -1;
+
+        if (testDomainGenerateIfnames(def) < 0 ||
+            !(obj = virDomainObjListAdd(privconn->domains, def,
+                                        privconn->xmlopt, 0, NULL))) {
+            virDomainDefFree(def);
+            return -1;
+        }
+
+        obj->persistent = true;
+
+        if (i % 5 != 4) {
+            if (testDomainStartState(privconn, obj,
+                                     VIR_DOMAIN_RUNNING_BOOTED) < 0) {
+                virDomainObjEndAPI(&obj);
+                return -1;
+            }
+        } else {
+            testDomainShutdownState(NULL, obj, VIR_DOMAIN_SHUTOFF_UNKNOWN);
+        }
+
+        testDomainObjCheckTaint(obj);
+
+        testDomainGenerateIOThreadInfos(obj);
+
+        virDomainObjEndAPI(&obj);
+    }
+
+    return 0;
+}
+
+
+/* test:///scale is test:///default with a large number of synthesized
+ * domains, which report stats of all the groups a QEMU domain would. Like
+ * test:///default its state is shared by simultaneous connections, so the
+ * inventory is only built by the first one. */
+static int
+testOpenScale(virConnectPtr conn)
+{
+    int ret = VIR_DRV_OPEN_ERROR;
+    testDriver *privconn = NULL;
+    unsigned int ndomains = TEST_SCALE_DEFAULT_DOMAINS;
+    size_t i;
+
+    for (i = 0; i < conn->uri->paramsCount; i++) {
+        virURIParam *param = &conn->uri->params[i];
+
+        if (STREQ(param->name, "domains")) {
+            if (virStrToLong_uip(param->value, NULL, 10, &ndomains) < 0) {
+                virReportError(VIR_ERR_INVALID_ARG,
+                               _("invalid number of domains '%s'"),
+                               param->value);
+                return VIR_DRV_OPEN_ERROR;
+            }
+        } else {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("unknown test:///scale parameter '%s'"),
+                           param->name);
+            return VIR_DRV_OPEN_ERROR;
+        }
+    }
+
+    virMutexLock(&defaultLock);
+    if (scalePrivconn) {
+        if (scalePrivconn->scaleDomains != ndomains) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           _("test:///scale is already open with %u domains"),
+                           scalePrivconn->scaleDomains);
+            goto cleanup;
+        }
+
+        conn->privateData = virObjectRef(scalePrivconn);
+        ret = VIR_DRV_OPEN_SUCCESS;
+        goto cleanup;
+    }
+
+    if (!(privconn = testDriverNew()))
+        goto error;
+
+    conn->privateData = privconn;
+    privconn->scaleDomains = ndomains;
+    privconn->scaleStart = g_get_monotonic_time();
+
+    if (testOpenDefaultParse(conn, privconn) < 0 ||
+        testOpenScaleDomains(privconn, ndomains) < 0)
+        goto error;
+
+    scalePrivconn = privconn;
+    ret = VIR_DRV_OPEN_SUCCESS;
+ cleanup:
+    virMutexUnlock(&defaultLock);
+    return ret;
+
+ error:
+    virObjectUnref(privconn);
+    conn->privateData = NULL;
+    goto cleanup;
+}
+
 static int
 testConnectAuthenticate(virConnectPtr conn,
                         virConnectAuthPtr auth)
@@ -1514,6 +1675,8 @@ testDriverCloseInternal(testDriver *driver)
     virObjectUnref(driver);
     if (testDriverDisposed && driver == defaultPrivconn)
         defaultPrivconn = NULL;
+    if (testDriverDisposed && driver == scalePrivconn)
+        scalePrivconn = NULL;
     virMutexUnlock(&defaultLock);
 }
 
@@ -1537,6 +1700,8 @@ testConnectOpen(virConnectPtr conn,
 
     if (STREQ(conn->uri->path, "/default"))
         ret = testOpenDefault(conn);
+    else if (STREQ(conn->uri->path, "/scale"))
+        ret = testOpenScale(conn);
     else
         ret = testOpenFromFile(conn,
                                conn->uri->path);
@@ -1695,6 +1860,7 @@ testConnectSupportsFeature(virConnectPtr conn G_GNUC_UNUSED,
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_COMPRESSION:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     default:
         return 0;
@@ -1705,13 +1871,8 @@ testConnectSupportsFeature(virConnectPtr conn G_GNUC_UNUSED,
 static int testConnectNumOfDomains(virConnectPtr conn)
 {
     testDriver *privconn = conn->privateData;
-    int count;
 
-    virObjectLock(privconn);
-    count = virDomainObjListNumOfDomains(privconn->domains, true, NULL, NULL);
-    virObjectUnlock(privconn);
-
-    return count;
+    return virDomainObjListNumOfDomains(privconn->domains, true, NULL, NULL);
 }
 
 static int testDomainIsActive(virDomainPtr dom)
@@ -1762,7 +1923,6 @@ testDomainCreateXML(virConnectPtr conn, const char *xml,
     if (flags & VIR_DOMAIN_START_VALIDATE)
         parse_flags |= VIR_DOMAIN_DEF_PARSE_VALIDATE_SCHEMA;
 
-    virObjectLock(privconn);
     if ((def = virDomainDefParseString(xml, privconn->xmlopt,
                                        NULL, parse_flags)) == NULL)
         goto cleanup;
@@ -1794,7 +1954,6 @@ testDomainCreateXML(virConnectPtr conn, const char *xml,
     virDomainObjEndAPI(&dom);
     virObjectEventStateQueue(privconn->eventState, event);
     virDomainDefFree(def);
-    virObjectUnlock(privconn);
     return ret;
 }
 
@@ -3295,7 +3454,8 @@ static char *testDomainGetXMLDesc(virDomainPtr domain, unsigned int flags)
     virDomainObj *privdom;
     char *ret = NULL;
 
-    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS, NULL);
+    virCheckFlags(VIR_DOMAIN_XML_COMMON_FLAGS | VIR_DOMAIN_XML_SECTION_FLAGS,
+                  NULL);
 
     if (!(privdom = testDomObjFromDomain(domain)))
         return NULL;
@@ -4577,8 +4737,6 @@ static int testDomainCreateWithFlags(virDomainPtr domain, unsigned int flags)
 
     virCheckFlags(0, -1);
 
-    virObjectLock(privconn);
-
     if (!(privdom = testDomObjFromDomain(domain)))
         goto cleanup;
 
@@ -4601,7 +4759,6 @@ static int testDomainCreateWithFlags(virDomainPtr domain, unsigned int flags)
  cleanup:
     virDomainObjEndAPI(&privdom);
     virObjectEventStateQueue(privconn->eventState, event);
-    virObjectUnlock(privconn);
     return ret;
 }
 
@@ -9926,6 +10083,176 @@ testDomainGetStatsIOThread(virDomainObj *dom,
     return 0;
 }
 
+/* The counters of the domains of test:///scale grow linearly with the
+ * time since the connection was opened, at a per-domain @rate. */
+static unsigned long long
+testDomainScaleCounter(virDomainObj *dom,
+                       unsigned long long rate)
+{
+    testDomainObjPrivate *priv = dom->privateData;
+    unsigned long long uptime;
+
+    uptime = (g_get_monotonic_time() - priv->driver->scaleStart) / G_USEC_PER_SEC;
+
+    return (uptime + 60) * rate * (1 + dom->def->uuid[VIR_UUID_BUFLEN - 1] % 8);
+}
+
+static int
+testDomainGetStatsCpu(virDomainObj *dom,
+                      virTypedParamList *params)
+{
+    unsigned long long user;
+    unsigned long long system;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    user = testDomainScaleCounter(dom, 150000000ULL);
+    system = testDomainScaleCounter(dom, 30000000ULL);
+
+    if (virTypedParamListAddULLong(params, user + system, "cpu.time") < 0 ||
+        virTypedParamListAddULLong(params, user, "cpu.user") < 0 ||
+        virTypedParamListAddULLong(params, system, "cpu.system") < 0)
+        return -1;
+
+    return 0;
+}
+
+static int
+testDomainGetStatsBalloon(virDomainObj *dom,
+                          virTypedParamList *params)
+{
+    unsigned long long cur = dom->def->mem.cur_balloon;
+    unsigned long long max = virDomainDefGetMemoryTotal(dom->def);
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    if (virTypedParamListAddULLong(params, cur, "balloon.current") < 0 ||
+        virTypedParamListAddULLong(params, max, "balloon.maximum") < 0 ||
+        virTypedParamListAddULLong(params, cur * 3 / 4, "balloon.rss") < 0 ||
+        virTypedParamListAddULLong(params, cur / 4, "balloon.unused") < 0 ||
+        virTypedParamListAddULLong(params, cur * 7 / 8, "balloon.available") < 0 ||
+        virTypedParamListAddULLong(params, cur / 2, "balloon.usable") < 0 ||
+        virTypedParamListAddULLong(params, testDomainScaleCounter(dom, 2),
+                                   "balloon.minor_fault") < 0 ||
+        virTypedParamListAddULLong(params, 0, "balloon.major_fault") < 0)
+        return -1;
+
+    return 0;
+}
+
+static int
+testDomainGetStatsVcpu(virDomainObj *dom,
+                       virTypedParamList *params)
+{
+    unsigned int maxvcpus = virDomainDefGetVcpusMax(dom->def);
+    size_t i;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    if (virTypedParamListAddUInt(params, virDomainDefGetVcpus(dom->def),
+                                 "vcpu.current") < 0 ||
+        virTypedParamListAddUInt(params, maxvcpus, "vcpu.maximum") < 0)
+        return -1;
+
+    for (i = 0; i < maxvcpus; i++) {
+        virDomainVcpuDef *vcpu = virDomainDefGetVcpu(dom->def, i);
+
+        if (!vcpu->online)
+            continue;
+
+        if (virTypedParamListAddInt(params, VIR_VCPU_RUNNING,
+                                    "vcpu.%zu.state", i) < 0 ||
+            virTypedParamListAddULLong(params,
+                                       testDomainScaleCounter(dom, 90000000ULL),
+                                       "vcpu.%zu.time", i) < 0 ||
+            virTypedParamListAddULLong(params,
+                                       testDomainScaleCounter(dom, 1000000ULL),
+                                       "vcpu.%zu.wait", i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+testDomainGetStatsInterface(virDomainObj *dom,
+                            virTypedParamList *params)
+{
+    size_t i;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    if (virTypedParamListAddUInt(params, dom->def->nnets, "net.count") < 0)
+        return -1;
+
+    for (i = 0; i < dom->def->nnets; i++) {
+        virDomainNetDef *net = dom->def->nets[i];
+        unsigned long long rx = testDomainScaleCounter(dom, 25000);
+        unsigned long long tx = testDomainScaleCounter(dom, 10000);
+
+        if (virTypedParamListAddString(params, net->ifname,
+                                       "net.%zu.name", i) < 0 ||
+            virTypedParamListAddULLong(params, rx, "net.%zu.rx.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, rx / 500, "net.%zu.rx.pkts", i) < 0 ||
+            virTypedParamListAddULLong(params, 0, "net.%zu.rx.errs", i) < 0 ||
+            virTypedParamListAddULLong(params, 0, "net.%zu.rx.drop", i) < 0 ||
+            virTypedParamListAddULLong(params, tx, "net.%zu.tx.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, tx / 500, "net.%zu.tx.pkts", i) < 0 ||
+            virTypedParamListAddULLong(params, 0, "net.%zu.tx.errs", i) < 0 ||
+            virTypedParamListAddULLong(params, 0, "net.%zu.tx.drop", i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+testDomainGetStatsBlock(virDomainObj *dom,
+                        virTypedParamList *params)
+{
+    size_t i;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    if (virTypedParamListAddUInt(params, dom->def->ndisks, "block.count") < 0)
+        return -1;
+
+    for (i = 0; i < dom->def->ndisks; i++) {
+        virDomainDiskDef *disk = dom->def->disks[i];
+        unsigned long long rd = testDomainScaleCounter(dom, 40);
+        unsigned long long wr = testDomainScaleCounter(dom, 15);
+
+        if (virTypedParamListAddString(params, disk->dst,
+                                       "block.%zu.name", i) < 0)
+            return -1;
+
+        if (virDomainDiskGetSource(disk) &&
+            virTypedParamListAddString(params, virDomainDiskGetSource(disk),
+                                       "block.%zu.path", i) < 0)
+            return -1;
+
+        if (virTypedParamListAddULLong(params, rd, "block.%zu.rd.reqs", i) < 0 ||
+            virTypedParamListAddULLong(params, rd * 4096, "block.%zu.rd.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, rd * 200000, "block.%zu.rd.times", i) < 0 ||
+            virTypedParamListAddULLong(params, wr, "block.%zu.wr.reqs", i) < 0 ||
+            virTypedParamListAddULLong(params, wr * 8192, "block.%zu.wr.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, wr * 500000, "block.%zu.wr.times", i) < 0 ||
+            virTypedParamListAddULLong(params, wr / 10, "block.%zu.fl.reqs", i) < 0 ||
+            virTypedParamListAddULLong(params, wr * 100000, "block.%zu.fl.times", i) < 0 ||
+            virTypedParamListAddULLong(params, 20ULL << 30, "block.%zu.capacity", i) < 0 ||
+            virTypedParamListAddULLong(params, 5ULL << 30, "block.%zu.allocation", i) < 0 ||
+            virTypedParamListAddULLong(params, 5ULL << 30, "block.%zu.physical", i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
 typedef int
 (*testDomainGetStatsFunc)(virDomainObj *dom,
                           virTypedParamList *list);
@@ -9933,20 +10260,41 @@ typedef int
 struct testDomainGetStatsWorker {
     testDomainGetStatsFunc func;
     unsigned int stats;
+    bool scaleOnly; /* only reported by test:///scale */
 };
 
 static struct testDomainGetStatsWorker testDomainGetStatsWorkers[] = {
-    { testDomainGetStatsState, VIR_DOMAIN_STATS_STATE },
-    { testDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD },
-    { NULL, 0 }
+    { testDomainGetStatsState, VIR_DOMAIN_STATS_STATE, false },
+    { testDomainGetStatsCpu, VIR_DOMAIN_STATS_CPU_TOTAL, true },
+    { testDomainGetStatsBalloon, VIR_DOMAIN_STATS_BALLOON, true },
+    { testDomainGetStatsVcpu, VIR_DOMAIN_STATS_VCPU, true },
+    { testDomainGetStatsInterface, VIR_DOMAIN_STATS_INTERFACE, true },
+    { testDomainGetStatsBlock, VIR_DOMAIN_STATS_BLOCK, true },
+    { testDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD, false },
+    { NULL, 0, false }
 };
 
+static unsigned int
+testDomainGetStatsSupported(testDriver *driver)
+{
+    unsigned int supported = 0;
+    size_t i;
+
+    for (i = 0; testDomainGetStatsWorkers[i].func; i++) {
+        if (!testDomainGetStatsWorkers[i].scaleOnly || driver->scaleDomains > 0)
+            supported |= testDomainGetStatsWorkers[i].stats;
+    }
+
+    return supported;
+}
+
 static int
 testDomainGetStats(virConnectPtr conn,
                    virDomainObj *dom,
                    unsigned int stats,
                    virDomainStatsRecordPtr *record)
 {
+    testDriver *driver = conn->privateData;
     g_autofree virDomainStatsRecordPtr tmp = NULL;
     g_autoptr(virTypedParamList) params = NULL;
     size_t i;
@@ -9954,6 +10302,9 @@ testDomainGetStats(virConnectPtr conn,
     params = g_new0(virTypedParamList, 1);
 
     for (i = 0; testDomainGetStatsWorkers[i].func; i++) {
+        if (testDomainGetStatsWorkers[i].scaleOnly && driver->scaleDomains == 0)
+            continue;
+
         if (stats & testDomainGetStatsWorkers[i].stats) {
             if (testDomainGetStatsWorkers[i].func(dom, params) < 0)
                 return -1;
@@ -9984,8 +10335,7 @@ testConnectGetAllDomainStats(virConnectPtr conn,
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
 
-    unsigned int supported = VIR_DOMAIN_STATS_STATE |
-                             VIR_DOMAIN_STATS_IOTHREAD;
+    unsigned int supported = testDomainGetStatsSupported(driver);
     virDomainObj **vms = NULL;
     size_t nvms;
     virDomainStatsRecordPtr *tmpstats = NULL;
@@ -45,6 +45,108 @@
 # define O_DIRECT 0
 #endif
 
+/* Data is moved through a ring of buffers so that reading the next chunk
+ * overlaps with writing the previous one. The file side is the one usually
+ * opened with O_DIRECT, its reads and writes can't be served from the page
+ * cache and thus block the pipe side for a long time without pipelining.
+ */
+#define RUN_IO_BUFFERS 4
+
+typedef struct _runIOBuffer runIOBuffer;
+struct _runIOBuffer {
+    char *buf;
+    ssize_t len;
+};
+
+typedef struct _runIOPipeline runIOPipeline;
+struct _runIOPipeline {
+    virMutex lock;
+    virCond cond;
+
+    runIOBuffer bufs[RUN_IO_BUFFERS];
+    size_t head;        /* next buffer to be filled by the reader */
+    size_t tail;        /* next buffer to be drained by the writer */
+    size_t filled;      /* number of buffers waiting to be written */
+
+    bool eof;           /* reader is done, no more buffers will be filled */
+    bool quit;          /* writer is done, reader should stop */
+    int readErrno;      /* errno of a failed read, if any */
+
+    int fdin;
+    size_t buflen;
+    bool directRead;
+};
+
+
+static ssize_t
+runIORead(runIOPipeline *pipeline,
+          char *buf)
+{
+    ssize_t got;
+
+    /* If we read with O_DIRECT from file we can't use saferead as
+     * it can lead to unaligned read after reading last bytes.
+     * If we write with O_DIRECT use should use saferead so that
+     * writes will be aligned.
+     * In other cases using saferead reduces number of syscalls.
+     */
+    if (!pipeline->directRead)
+        return saferead(pipeline->fdin, buf, pipeline->buflen);
+
+    while ((got = read(pipeline->fdin, buf, pipeline->buflen)) < 0 &&
+           errno == EINTR)
+        ;
+
+    return got;
+}
+
+
+static void
+runIOReader(void *opaque)
+{
+    runIOPipeline *pipeline = opaque;
+
+    while (1) {
+        runIOBuffer *buffer;
+        ssize_t got;
+        int err;
+
+        virMutexLock(&pipeline->lock);
+        while (!pipeline->quit && pipeline->filled == RUN_IO_BUFFERS)
+            virCondWait(&pipeline->cond, &pipeline->lock);
+
+        if (pipeline->quit) {
+            virMutexUnlock(&pipeline->lock);
+            break;
+        }
+
+        buffer = &pipeline->bufs[pipeline->head];
+        virMutexUnlock(&pipeline->lock);
+
+        /* The writer never touches buffers which are not filled yet */
+        got = runIORead(pipeline, buffer->buf);
+        err = errno;
+
+        virMutexLock(&pipeline->lock);
+        if (got < 0) {
+            pipeline->readErrno = err;
+            pipeline->eof = true;
+        } else if (got == 0) {
+            pipeline->eof = true;
+        } else {
+            buffer->len = got;
+            pipeline->head = (pipeline->head + 1) % RUN_IO_BUFFERS;
+            pipeline->filled++;
+        }
+        virCondSignal(&pipeline->cond);
+        virMutexUnlock(&pipeline->lock);
+
+        if (got <= 0)
+            break;
+    }
+}
+
+
 static int
 runIO(const char *path, int fd, int oflags)
 {
@@ -60,13 +162,17 @@ runIO(const char *path, int fd, int oflags)
     off_t end = 0;
     struct stat sb;
     bool isBlockDev = false;
+    runIOPipeline pipeline = { 0 };
+    virThread reader;
+    int writeErrno = 0;
+    size_t i;
 
 #if WITH_POSIX_MEMALIGN
-    if (posix_memalign(&base, alignMask + 1, buflen))
+    if (posix_memalign(&base, alignMask + 1, buflen * RUN_IO_BUFFERS))
         abort();
     buf = base;
 #else
-    buf = g_new0(char, buflen + alignMask);
+    buf = g_new0(char, buflen * RUN_IO_BUFFERS + alignMask);
     base = buf;
     buf = (char *) (((intptr_t) base + alignMask) & ~alignMask);
 #endif
@@ -115,41 +221,53 @@ runIO(const char *path, int fd, int oflags)
         goto cleanup;
     }
 
+    if (virMutexInit(&pipeline.lock) < 0 ||
+        virCondInit(&pipeline.cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize I/O pipeline"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < RUN_IO_BUFFERS; i++)
+        pipeline.bufs[i].buf = buf + i * buflen;
+    pipeline.fdin = fdin;
+    pipeline.buflen = buflen;
+    pipeline.directRead = fdin == fd && direct;
+
+    if (virThreadCreate(&reader, true, runIOReader, &pipeline) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create I/O reader thread"));
+        goto cleanup;
+    }
+
     while (1) {
+        runIOBuffer *buffer;
         ssize_t got;
 
-        /* If we read with O_DIRECT from file we can't use saferead as
-         * it can lead to unaligned read after reading last bytes.
-         * If we write with O_DIRECT use should use saferead so that
-         * writes will be aligned.
-         * In other cases using saferead reduces number of syscalls.
-         */
-        if (fdin == fd && direct) {
-            if ((got = read(fdin, buf, buflen)) < 0 &&
-                errno == EINTR)
-                continue;
-        } else {
-            got = saferead(fdin, buf, buflen);
-        }
+        virMutexLock(&pipeline.lock);
+        while (!pipeline.eof && pipeline.filled == 0)
+            virCondWait(&pipeline.cond, &pipeline.lock);
 
-        if (got < 0) {
-            virReportSystemError(errno, _("Unable to read %s"), fdinname);
-            goto cleanup;
-        }
-        if (got == 0)
+        if (pipeline.filled == 0) {
+            virMutexUnlock(&pipeline.lock);
             break;
+        }
+
+        buffer = &pipeline.bufs[pipeline.tail];
+        virMutexUnlock(&pipeline.lock);
 
+        got = buffer->len;
         total += got;
 
         /* handle last write size align in direct case */
         if (got < buflen && direct && fdout == fd) {
             ssize_t aligned_got = (got + alignMask) & ~alignMask;
 
-            memset(buf + got, 0, aligned_got - got);
+            memset(buffer->buf + got, 0, aligned_got - got);
 
-            if (safewrite(fdout, buf, aligned_got) < 0) {
-                virReportSystemError(errno, _("Unable to write %s"), fdoutname);
-                goto cleanup;
+            if (safewrite(fdout, buffer->buf, aligned_got) < 0) {
+                writeErrno = errno;
+                break;
             }
 
             if (!isBlockDev && ftruncate(fd, total) < 0) {
@@ -160,10 +278,33 @@ runIO(const char *path, int fd, int oflags)
             break;
         }
 
-        if (safewrite(fdout, buf, got) < 0) {
-            virReportSystemError(errno, _("Unable to write %s"), fdoutname);
-            goto cleanup;
+        if (safewrite(fdout, buffer->buf, got) < 0) {
+            writeErrno = errno;
+            break;
         }
+
+        virMutexLock(&pipeline.lock);
+        pipeline.tail = (pipeline.tail + 1) % RUN_IO_BUFFERS;
+        pipeline.filled--;
+        virCondSignal(&pipeline.cond);
+        virMutexUnlock(&pipeline.lock);
+    }
+
+    if (writeErrno) {
+        virReportSystemError(writeErrno, _("Unable to write %s"), fdoutname);
+        goto cleanup;
+    }
+
+    virMutexLock(&pipeline.lock);
+    pipeline.quit = true;
+    virCondSignal(&pipeline.cond);
+    virMutexUnlock(&pipeline.lock);
+
+    virThreadJoin(&reader);
+
+    if (pipeline.readErrno) {
+        virReportSystemError(pipeline.readErrno, _("Unable to read %s"), fdinname);
+        goto cleanup;
     }
 
     /* Ensure all data is written */
@@ -178,6 +319,8 @@ runIO(const char *path, int fd, int oflags)
     ret = 0;
 
  cleanup:
+    /* On failure the reader thread may still be blocked in read(). There's
+     * no point in waiting for it as the process exits right away. */
     if (VIR_CLOSE(fd) < 0 &&
         ret == 0) {
         virReportSystemError(errno, _("Unable to close %s"), path);
@@ -31,6 +31,15 @@
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+#define VIR_BITMAP_BITS_PER_UNIT  ((int) sizeof(unsigned long) * CHAR_BIT)
+#define VIR_BITMAP_UNIT_OFFSET(b) ((b) / VIR_BITMAP_BITS_PER_UNIT)
+#define VIR_BITMAP_BIT_OFFSET(b)  ((b) % VIR_BITMAP_BITS_PER_UNIT)
+#define VIR_BITMAP_BIT(b)         (1UL << VIR_BITMAP_BIT_OFFSET(b))
+
+/* Bitmaps of up to 256 bits, e.g. CPU and NUMA node masks of common
+ * hosts, are stored within the struct itself */
+#define VIR_BITMAP_INLINE_UNITS   (256 / VIR_BITMAP_BITS_PER_UNIT)
+
 struct _virBitmap {
     size_t nbits;
     size_t map_len;
@@ -39,14 +48,10 @@ struct _virBitmap {
     /* Note that code below depends on the fact that unused bits of the bitmap
      * are not set. Any function decreasing the size of the map needs clear
      * bits which don't belong to the bitmap any more. */
-    unsigned long *map;
-};
-
+    unsigned long *map; /* points to @inline_map unless it's too small */
 
-#define VIR_BITMAP_BITS_PER_UNIT  ((int) sizeof(unsigned long) * CHAR_BIT)
-#define VIR_BITMAP_UNIT_OFFSET(b) ((b) / VIR_BITMAP_BITS_PER_UNIT)
-#define VIR_BITMAP_BIT_OFFSET(b)  ((b) % VIR_BITMAP_BITS_PER_UNIT)
-#define VIR_BITMAP_BIT(b)         (1UL << VIR_BITMAP_BIT_OFFSET(b))
+    unsigned long inline_map[VIR_BITMAP_INLINE_UNITS];
+};
 
 
 /**
@@ -73,13 +78,16 @@ virBitmapNew(size_t size)
 
     bitmap = g_new0(virBitmap, 1);
 
-    if (size == 0)
-        return bitmap;
+    if (sz <= VIR_BITMAP_INLINE_UNITS) {
+        bitmap->map = bitmap->inline_map;
+        bitmap->map_alloc = VIR_BITMAP_INLINE_UNITS;
+    } else {
+        bitmap->map = g_new0(unsigned long, sz);
+        bitmap->map_alloc = sz;
+    }
 
-    bitmap->map = g_new0(unsigned long, sz);
     bitmap->nbits = size;
     bitmap->map_len = sz;
-    bitmap->map_alloc = sz;
     return bitmap;
 }
 
@@ -94,7 +102,8 @@ void
 virBitmapFree(virBitmap *bitmap)
 {
     if (bitmap) {
-        g_free(bitmap->map);
+        if (bitmap->map != bitmap->inline_map)
+            g_free(bitmap->map);
         g_free(bitmap);
     }
 }
@@ -138,7 +147,14 @@ virBitmapExpand(virBitmap *map,
     size_t new_len = VIR_DIV_UP(b + 1, VIR_BITMAP_BITS_PER_UNIT);
 
     /* resize the memory if necessary */
-    if (map->map_len < new_len) {
+    if (map->map == map->inline_map) {
+        if (new_len > map->map_alloc) {
+            map->map = g_new0(unsigned long, new_len);
+            memcpy(map->map, map->inline_map,
+                   map->map_len * sizeof(map->map[0]));
+            map->map_alloc = new_len;
+        }
+    } else if (map->map_len < new_len) {
         VIR_RESIZE_N(map->map, map->map_alloc, map->map_len,
                      new_len - map->map_len);
     }
@@ -172,6 +188,30 @@ virBitmapSetBitExpand(virBitmap *bitmap,
 }
 
 
+/* Helper function. caller must ensure start <= last < bitmap->nbits */
+static void
+virBitmapSetBitRange(virBitmap *bitmap,
+                     size_t start,
+                     size_t last)
+{
+    size_t nl = VIR_BITMAP_UNIT_OFFSET(start);
+    size_t ll = VIR_BITMAP_UNIT_OFFSET(last);
+    unsigned long first = -1UL << VIR_BITMAP_BIT_OFFSET(start);
+    unsigned long end = -1UL >> (VIR_BITMAP_BITS_PER_UNIT - 1 -
+                                 VIR_BITMAP_BIT_OFFSET(last));
+
+    if (nl == ll) {
+        bitmap->map[nl] |= first & end;
+        return;
+    }
+
+    bitmap->map[nl++] |= first;
+    for (; nl < ll; nl++)
+        bitmap->map[nl] = -1UL;
+    bitmap->map[ll] |= end;
+}
+
+
 /**
  * virBitmapClearBit:
  * @bitmap: Pointer to bitmap
@@ -338,37 +378,27 @@ char *
 virBitmapFormat(virBitmap *bitmap)
 {
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
-    bool first = true;
-    int start, cur, prev;
+    ssize_t start;
+    ssize_t last;
 
-    if (!bitmap || (cur = virBitmapNextSetBit(bitmap, -1)) < 0) {
-        char *ret;
-        ret = g_strdup("");
-        return ret;
-    }
-
-    start = prev = cur;
-    while (prev >= 0) {
-        cur = virBitmapNextSetBit(bitmap, prev);
-
-        if (cur == prev + 1) {
-            prev = cur;
-            continue;
-        }
+    if (!bitmap || (start = virBitmapNextSetBit(bitmap, -1)) < 0)
+        return g_strdup("");
 
-        /* cur < 0 or cur > prev + 1 */
+    /* look up whole ranges of set bits rather than single bits */
+    while (start >= 0) {
+        if ((last = virBitmapNextClearBit(bitmap, start)) < 0)
+            last = bitmap->nbits;
+        last--;
 
-        if (!first)
+        if (virBufferUse(&buf) > 0)
             virBufferAddLit(&buf, ",");
-        else
-            first = false;
 
-        if (prev == start)
-            virBufferAsprintf(&buf, "%d", start);
+        if (last == start)
+            virBufferAsprintf(&buf, "%zd", start);
         else
-            virBufferAsprintf(&buf, "%d-%d", start, prev);
+            virBufferAsprintf(&buf, "%zd-%zd", start, last);
 
-        start = prev = cur;
+        start = virBitmapNextSetBit(bitmap, last);
     }
 
     return virBufferContentAndReset(&buf);
@@ -406,7 +436,6 @@ virBitmapParseSeparator(const char *str,
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     *bitmap = virBitmapNew(bitmapSize);
@@ -465,10 +494,10 @@ virBitmapParseSeparator(const char *str,
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBit(*bitmap, i) < 0)
-                    goto error;
-            }
+            if (last >= (*bitmap)->nbits)
+                goto error;
+
+            virBitmapSetBitRange(*bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -541,7 +570,6 @@ virBitmapParseUnlimited(const char *str)
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     if (!str)
@@ -598,10 +626,11 @@ virBitmapParseUnlimited(const char *str)
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBitExpand(bitmap, i) < 0)
-                    goto error;
-            }
+            if (last >= bitmap->nbits &&
+                virBitmapExpand(bitmap, last) < 0)
+                goto error;
+
+            virBitmapSetBitRange(bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -638,7 +667,8 @@ virBitmapNewCopy(virBitmap *src)
 {
     virBitmap *dst = virBitmapNew(src->nbits);
 
-    memcpy(dst->map, src->map, src->map_len * sizeof(src->map[0]));
+    memcpy(dst->map, src->map,
+           MIN(src->map_len, dst->map_len) * sizeof(src->map[0]));
 
     return dst;
 }
@@ -944,7 +974,6 @@ virBitmapNextSetBit(virBitmap *bitmap,
 ssize_t
 virBitmapLastSetBit(virBitmap *bitmap)
 {
-    ssize_t i;
     int unusedBits;
     ssize_t sz;
     unsigned long bits;
@@ -974,12 +1003,8 @@ virBitmapLastSetBit(virBitmap *bitmap)
     return -1;
 
  found:
-    for (i = VIR_BITMAP_BITS_PER_UNIT - 1; i >= 0; i--) {
-        if (bits & 1UL << i)
-            return i + sz * VIR_BITMAP_BITS_PER_UNIT;
-    }
-
-    return -1;
+    return VIR_BITMAP_BITS_PER_UNIT - 1 - __builtin_clzl(bits) +
+        sz * VIR_BITMAP_BITS_PER_UNIT;
 }
 
 
@@ -1236,6 +1261,18 @@ virBitmapShrink(virBitmap *map,
 
     nl = map->nbits / VIR_BITMAP_BITS_PER_UNIT;
     nb = map->nbits % VIR_BITMAP_BITS_PER_UNIT;
+
+    if (map->map == map->inline_map) {
+        size_t len = VIR_DIV_UP(map->nbits, VIR_BITMAP_BITS_PER_UNIT);
+
+        if (nb)
+            map->map[nl] &= ((1UL << nb) - 1);
+        if (len < map->map_len)
+            memset(map->map + len, 0, (map->map_len - len) * sizeof(map->map[0]));
+        map->map_len = len;
+        return;
+    }
+
     map->map[nl] &= ((1UL << nb) - 1);
 
     toremove = map->map_alloc - (nl + 1);
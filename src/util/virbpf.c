@@ -293,6 +293,76 @@ virBPFDeleteElem(int mapfd,
 }
 
 
+/* On input @count is the number of elements @keys and @vals have room
+ * for, on output the number of elements actually read. Reading
+ * starts at @inBatch, or at the beginning of the map if NULL, and
+ * @outBatch is filled in with the position to continue from. Fails
+ * with ENOENT once the end of the map is reached, though @count may
+ * still be non-zero in that case. */
+int
+virBPFLookupBatch(int mapfd G_GNUC_UNUSED,
+                  void *inBatch G_GNUC_UNUSED,
+                  void *outBatch G_GNUC_UNUSED,
+                  void *keys G_GNUC_UNUSED,
+                  void *vals G_GNUC_UNUSED,
+                  unsigned int *count)
+{
+# if WITH_DECL_BPF_MAP_LOOKUP_BATCH
+    union bpf_attr attr;
+    int rc;
+
+    memset(&attr, 0, sizeof(attr));
+
+    attr.batch.map_fd = mapfd;
+    attr.batch.in_batch = (uintptr_t)inBatch;
+    attr.batch.out_batch = (uintptr_t)outBatch;
+    attr.batch.keys = (uintptr_t)keys;
+    attr.batch.values = (uintptr_t)vals;
+    attr.batch.count = *count;
+
+    rc = syscall(SYS_bpf, BPF_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+    *count = attr.batch.count;
+
+    return rc;
+# else /* !WITH_DECL_BPF_MAP_LOOKUP_BATCH */
+    *count = 0;
+    errno = ENOSYS;
+    return -1;
+# endif /* !WITH_DECL_BPF_MAP_LOOKUP_BATCH */
+}
+
+
+/* On input @count is the number of elements in @keys and @vals, on
+ * output the number of elements actually stored. */
+int
+virBPFUpdateBatch(int mapfd G_GNUC_UNUSED,
+                  void *keys G_GNUC_UNUSED,
+                  void *vals G_GNUC_UNUSED,
+                  unsigned int *count)
+{
+# if WITH_DECL_BPF_MAP_LOOKUP_BATCH
+    union bpf_attr attr;
+    int rc;
+
+    memset(&attr, 0, sizeof(attr));
+
+    attr.batch.map_fd = mapfd;
+    attr.batch.keys = (uintptr_t)keys;
+    attr.batch.values = (uintptr_t)vals;
+    attr.batch.count = *count;
+
+    rc = syscall(SYS_bpf, BPF_MAP_UPDATE_BATCH, &attr, sizeof(attr));
+    *count = attr.batch.count;
+
+    return rc;
+# else /* !WITH_DECL_BPF_MAP_LOOKUP_BATCH */
+    *count = 0;
+    errno = ENOSYS;
+    return -1;
+# endif /* !WITH_DECL_BPF_MAP_LOOKUP_BATCH */
+}
+
+
 #else /* !WITH_SYS_SYSCALL_H || !WITH_DECL_BPF_PROG_QUERY */
 
 
@@ -421,4 +491,30 @@ virBPFDeleteElem(int mapfd G_GNUC_UNUSED,
     errno = ENOSYS;
     return -1;
 }
+
+
+int
+virBPFLookupBatch(int mapfd G_GNUC_UNUSED,
+                  void *inBatch G_GNUC_UNUSED,
+                  void *outBatch G_GNUC_UNUSED,
+                  void *keys G_GNUC_UNUSED,
+                  void *vals G_GNUC_UNUSED,
+                  unsigned int *count)
+{
+    *count = 0;
+    errno = ENOSYS;
+    return -1;
+}
+
+
+int
+virBPFUpdateBatch(int mapfd G_GNUC_UNUSED,
+                  void *keys G_GNUC_UNUSED,
+                  void *vals G_GNUC_UNUSED,
+                  unsigned int *count)
+{
+    *count = 0;
+    errno = ENOSYS;
+    return -1;
+}
 #endif /* !WITH_SYS_SYSCALL_H || !WITH_DECL_BPF_PROG_QUERY */
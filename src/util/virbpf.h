@@ -254,3 +254,17 @@ virBPFUpdateElem(int mapfd,
 int
 virBPFDeleteElem(int mapfd,
                  void *key);
+
+int
+virBPFLookupBatch(int mapfd,
+                  void *inBatch,
+                  void *outBatch,
+                  void *keys,
+                  void *vals,
+                  unsigned int *count);
+
+int
+virBPFUpdateBatch(int mapfd,
+                  void *keys,
+                  void *vals,
+                  unsigned int *count);
@@ -103,6 +103,9 @@ virBufferGetIndent(const virBuffer *buf)
 size_t
 virBufferGetEffectiveIndent(const virBuffer *buf)
 {
+    if (buf->compact)
+        return 0;
+
     if (buf->str && buf->str->len && buf->str->str[buf->str->len - 1] != '\n')
         return 0;
 
@@ -110,6 +113,26 @@ virBufferGetEffectiveIndent(const virBuffer *buf)
 }
 
 
+/**
+ * virBufferSetCompact:
+ * @buf: the buffer
+ * @compact: whether to suppress auto-indentation
+ *
+ * With @compact set, the indentation level of @buf is still tracked but
+ * no spaces are added for it. Child buffers initialized with
+ * VIR_BUFFER_INIT_CHILD inherit the setting. This is meant for XML which
+ * is read back by libvirt only, where the indentation is just overhead.
+ */
+void
+virBufferSetCompact(virBuffer *buf, bool compact)
+{
+    if (!buf)
+        return;
+
+    buf->compact = compact;
+}
+
+
 /**
  * virBufferInitialize
  * @buf: the buffer
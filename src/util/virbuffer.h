@@ -32,7 +32,7 @@
  */
 typedef struct _virBuffer virBuffer;
 
-#define VIR_BUFFER_INITIALIZER { NULL, 0 }
+#define VIR_BUFFER_INITIALIZER { NULL, 0, false }
 
 /**
  * VIR_BUFFER_INIT_CHILD:
@@ -41,11 +41,13 @@ typedef struct _virBuffer virBuffer;
  * Initialize a virBuffer structure and set up the indentation level for
  * formatting XML subelements of @parentbuf.
  */
-#define VIR_BUFFER_INIT_CHILD(parentbuf) { NULL, (parentbuf)->indent + 2 }
+#define VIR_BUFFER_INIT_CHILD(parentbuf) \
+    { NULL, (parentbuf)->indent + 2, (parentbuf)->compact }
 
 struct _virBuffer {
     GString *str;
     int indent;
+    bool compact; /* auto-indentation is not applied */
 };
 
 const char *virBufferCurrentContent(virBuffer *buf);
@@ -89,6 +91,7 @@ void virBufferSetIndent(virBuffer *, int indent);
 
 size_t virBufferGetIndent(const virBuffer *buf);
 size_t virBufferGetEffectiveIndent(const virBuffer *buf);
+void virBufferSetCompact(virBuffer *buf, bool compact);
 
 void virBufferTrim(virBuffer *buf, const char *trim);
 void virBufferTrimChars(virBuffer *buf, const char *trim);
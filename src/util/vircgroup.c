@@ -2561,6 +2561,29 @@ virCgroupSetCpuCfsQuota(virCgroup *group, long long cfs_quota)
 }
 
 
+/*
+ * Set both the bandwidth period and quota in one go, if the backend
+ * is able to do so.
+ *
+ * Returns: 0 on success, 1 if not supported by the backend,
+ *          -1 on error
+ */
+static int
+virCgroupSetCpuCfsPeriodQuota(virCgroup *group,
+                              unsigned long long cfs_period,
+                              long long cfs_quota)
+{
+    virCgroup *parent = virCgroupGetNested(group);
+    virCgroupBackend *backend;
+
+    backend = virCgroupBackendForController(parent, VIR_CGROUP_CONTROLLER_CPU);
+    if (!backend || !backend->setCpuCfsPeriodQuota)
+        return 1;
+
+    return backend->setCpuCfsPeriodQuota(parent, cfs_period, cfs_quota);
+}
+
+
 int
 virCgroupGetCpuacctPercpuUsage(virCgroup *group, char **usage)
 {
@@ -2900,6 +2923,41 @@ virCgroupGetCpuacctStat(virCgroup *group, unsigned long long *user,
 }
 
 
+/**
+ * virCgroupGetCpuacctTimes:
+ *
+ * @group: The cgroup to get CPU times for
+ * @usage: Pointer to the returned total CPU time in nanoseconds
+ * @user: Pointer to the returned user CPU time in nanoseconds
+ * @sys: Pointer to the returned system CPU time in nanoseconds
+ *
+ * Same as calling virCgroupGetCpuacctUsage() and
+ * virCgroupGetCpuacctStat(), but lets the backend fetch all the
+ * values at once where it can.
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int
+virCgroupGetCpuacctTimes(virCgroup *group,
+                         unsigned long long *usage,
+                         unsigned long long *user,
+                         unsigned long long *sys)
+{
+    virCgroup *parent = virCgroupGetNested(group);
+    virCgroupBackend *backend;
+
+    backend = virCgroupBackendForController(parent, VIR_CGROUP_CONTROLLER_CPUACCT);
+    if (backend && backend->getCpuacctTimes)
+        return backend->getCpuacctTimes(parent, usage, user, sys);
+
+    if (virCgroupGetCpuacctUsage(group, usage) < 0 ||
+        virCgroupGetCpuacctStat(group, user, sys) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 int
 virCgroupSetFreezerState(virCgroup *group, const char *state)
 {
@@ -3641,6 +3699,15 @@ virCgroupSetCpuCfsQuota(virCgroup *group G_GNUC_UNUSED,
 }
 
 
+static int
+virCgroupSetCpuCfsPeriodQuota(virCgroup *group G_GNUC_UNUSED,
+                              unsigned long long cfs_period G_GNUC_UNUSED,
+                              long long cfs_quota G_GNUC_UNUSED)
+{
+    return 1;
+}
+
+
 int
 virCgroupRemove(virCgroup *group G_GNUC_UNUSED)
 {
@@ -3710,6 +3777,18 @@ virCgroupGetCpuacctStat(virCgroup *group G_GNUC_UNUSED,
 }
 
 
+int
+virCgroupGetCpuacctTimes(virCgroup *group G_GNUC_UNUSED,
+                         unsigned long long *usage G_GNUC_UNUSED,
+                         unsigned long long *user G_GNUC_UNUSED,
+                         unsigned long long *sys G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return -1;
+}
+
+
 int
 virCgroupGetDomainTotalCpuStats(virCgroup *group G_GNUC_UNUSED,
                                 virTypedParameterPtr params G_GNUC_UNUSED,
@@ -3971,6 +4050,13 @@ virCgroupSetupCpuPeriodQuota(virCgroup *cgroup,
     if (period == 0 && quota == 0)
         return 0;
 
+    if (period && quota) {
+        int rc = virCgroupSetCpuCfsPeriodQuota(cgroup, period, quota);
+
+        if (rc <= 0)
+            return rc;
+    }
+
     if (period) {
         /* get old period, and we can rollback if set quota failed */
         if (virCgroupGetCpuCfsPeriod(cgroup, &old_period) < 0)
@@ -248,6 +248,9 @@ int virCgroupGetCpuCfsQuota(virCgroup *group, long long *cfs_quota);
 
 int virCgroupGetCpuacctUsage(virCgroup *group, unsigned long long *usage);
 int virCgroupGetCpuacctPercpuUsage(virCgroup *group, char **usage);
+int virCgroupGetCpuacctTimes(virCgroup *group, unsigned long long *usage,
+                             unsigned long long *user,
+                             unsigned long long *sys);
 int virCgroupGetCpuacctStat(virCgroup *group, unsigned long long *user,
                             unsigned long long *sys);
 
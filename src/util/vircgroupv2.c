@@ -1623,6 +1623,46 @@ virCgroupV2SetCpuCfsQuota(virCgroup *group,
 }
 
 
+/* cpu.max holds both values, so they can be changed with a single
+ * write and without having to read the other one first. */
+static int
+virCgroupV2SetCpuCfsPeriodQuota(virCgroup *group,
+                                unsigned long long cfs_period,
+                                long long cfs_quota)
+{
+    g_autofree char *value = NULL;
+
+    if (cfs_period < VIR_CGROUP_CPU_PERIOD_MIN ||
+        cfs_period > VIR_CGROUP_CPU_PERIOD_MAX) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("cfs_period '%llu' must be in range (%llu, %llu)"),
+                       VIR_CGROUP_CPU_PERIOD_MIN,
+                       VIR_CGROUP_CPU_PERIOD_MAX,
+                       cfs_period);
+        return -1;
+    }
+
+    if (cfs_quota >= 0 &&
+        (cfs_quota < VIR_CGROUP_CPU_QUOTA_MIN ||
+         cfs_quota > VIR_CGROUP_CPU_QUOTA_MAX)) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("cfs_quota '%lld' must be in range (%llu, %llu)"),
+                       cfs_quota,
+                       VIR_CGROUP_CPU_QUOTA_MIN,
+                       VIR_CGROUP_CPU_QUOTA_MAX);
+        return -1;
+    }
+
+    if (cfs_quota == VIR_CGROUP_CPU_QUOTA_MAX)
+        value = g_strdup_printf("max %llu", cfs_period);
+    else
+        value = g_strdup_printf("%lld %llu", cfs_quota, cfs_period);
+
+    return virCgroupSetValueStr(group, VIR_CGROUP_CONTROLLER_CPU,
+                                "cpu.max", value);
+}
+
+
 static int
 virCgroupV2GetCpuCfsQuota(virCgroup *group,
                           long long *cfs_quota)
@@ -1744,6 +1784,68 @@ virCgroupV2GetCpuacctStat(virCgroup *group,
 }
 
 
+static int
+virCgroupV2ParseCpuStatField(const char *str,
+                             const char *field,
+                             unsigned long long *value)
+{
+    const char *tmp = str;
+    size_t len = strlen(field);
+    char *end;
+
+    /* Fields are at the start of a line, followed by a space */
+    while ((tmp = strstr(tmp, field))) {
+        if ((tmp == str || tmp[-1] == '\n') && tmp[len] == ' ')
+            break;
+        tmp += len;
+    }
+
+    if (!tmp) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot find '%s' in cpu stat '%s'"), field, str);
+        return -1;
+    }
+
+    tmp += len + 1;
+    if (virStrToLong_ull(tmp, &end, 10, value) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Failed to parse value '%s' as number."), tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virCgroupV2GetCpuacctTimes(virCgroup *group,
+                           unsigned long long *usage,
+                           unsigned long long *user,
+                           unsigned long long *sys)
+{
+    g_autofree char *str = NULL;
+    unsigned long long usageVal = 0;
+    unsigned long long userVal = 0;
+    unsigned long long sysVal = 0;
+
+    if (virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                             "cpu.stat", &str) < 0) {
+        return -1;
+    }
+
+    if (virCgroupV2ParseCpuStatField(str, "usage_usec", &usageVal) < 0 ||
+        virCgroupV2ParseCpuStatField(str, "user_usec", &userVal) < 0 ||
+        virCgroupV2ParseCpuStatField(str, "system_usec", &sysVal) < 0)
+        return -1;
+
+    *usage = usageVal * 1000;
+    *user = userVal * 1000;
+    *sys = sysVal * 1000;
+
+    return 0;
+}
+
+
 static int
 virCgroupV2SetCpusetMems(virCgroup *group,
                          const char *mems)
@@ -1964,10 +2066,12 @@ virCgroupBackend virCgroupV2Backend = {
     .getCpuCfsPeriod = virCgroupV2GetCpuCfsPeriod,
     .setCpuCfsQuota = virCgroupV2SetCpuCfsQuota,
     .getCpuCfsQuota = virCgroupV2GetCpuCfsQuota,
+    .setCpuCfsPeriodQuota = virCgroupV2SetCpuCfsPeriodQuota,
     .supportsCpuBW = virCgroupV2SupportsCpuBW,
 
     .getCpuacctUsage = virCgroupV2GetCpuacctUsage,
     .getCpuacctStat = virCgroupV2GetCpuacctStat,
+    .getCpuacctTimes = virCgroupV2GetCpuacctTimes,
 
     .setCpusetMems = virCgroupV2SetCpusetMems,
     .getCpusetMems = virCgroupV2GetCpusetMems,
@@ -330,23 +330,76 @@ virCgroupV2DevicesAttachProg(virCgroup *group,
 }
 
 
+/*
+ * Read all entries of @mapfd into @keys and @vals which have room
+ * for @max entries. The whole map is fetched with a few batch
+ * lookups where the kernel supports it, otherwise one entry at a
+ * time.
+ *
+ * Returns the number of entries read, -1 with errno set on error.
+ */
 static int
-virCgroupV2DevicesCountMapEntries(int mapfd)
+virCgroupV2DevicesReadMap(int mapfd,
+                          size_t max,
+                          uint64_t *keys,
+                          uint32_t *vals)
 {
-    int ret = 0;
-    int rc;
+    uint64_t inBatch = 0;
+    uint64_t outBatch = 0;
     uint64_t key = 0;
     uint64_t prevKey = 0;
+    size_t n = 0;
+    int rc;
+
+    while (n < max) {
+        unsigned int count = max - n;
+
+        rc = virBPFLookupBatch(mapfd, n > 0 ? &inBatch : NULL, &outBatch,
+                               keys + n, vals + n, &count);
+        if (rc < 0 && errno != ENOENT) {
+            if (n == 0)
+                goto fallback;
+            return -1;
+        }
+
+        n += count;
+        inBatch = outBatch;
+
+        if (rc < 0)
+            break;
+    }
+
+    return n;
 
+ fallback:
     while ((rc = virBPFGetNextElem(mapfd, &prevKey, &key)) == 0) {
-        ret++;
+        if (n >= max) {
+            errno = ENOSPC;
+            return -1;
+        }
+
+        if (virBPFLookupElem(mapfd, &key, &vals[n]) < 0)
+            return -1;
+
+        keys[n++] = key;
         prevKey = key;
     }
 
     if (rc < 0 && errno != ENOENT)
         return -1;
 
-    return ret;
+    return n;
+}
+
+
+static int
+virCgroupV2DevicesCountMapEntries(int mapfd,
+                                  size_t max)
+{
+    g_autofree uint64_t *keys = g_new0(uint64_t, max);
+    g_autofree uint32_t *vals = g_new0(uint32_t, max);
+
+    return virCgroupV2DevicesReadMap(mapfd, max, keys, vals);
 }
 
 
@@ -419,7 +472,7 @@ virCgroupV2DevicesDetectProg(virCgroup *group)
         return -1;
     }
 
-    nitems = virCgroupV2DevicesCountMapEntries(mapfd);
+    nitems = virCgroupV2DevicesCountMapEntries(mapfd, mapInfo.max_entries);
     if (nitems < 0) {
         virReportSystemError(errno, "%s", _("failed to count cgroup BPF map items"));
         return -1;
@@ -464,10 +517,12 @@ static int
 virCgroupV2DevicesReallocMap(int mapfd,
                              size_t size)
 {
-    uint64_t key = 0;
-    uint64_t prevKey = 0;
-    int rc;
+    g_autofree uint64_t *keys = g_new0(uint64_t, size);
+    g_autofree uint32_t *vals = g_new0(uint32_t, size);
+    unsigned int count;
+    int nitems;
     int ret = -1;
+    size_t i;
     VIR_AUTOCLOSE newmapfd = virCgroupV2DevicesCreateMap(size);
 
     VIR_DEBUG("realloc devices map mapfd:%d, size:%zu", mapfd, size);
@@ -475,30 +530,25 @@ virCgroupV2DevicesReallocMap(int mapfd,
     if (newmapfd < 0)
         return -1;
 
-    while ((rc = virBPFGetNextElem(mapfd, &prevKey, &key)) == 0) {
-        uint32_t val = 0;
-
-        if (virBPFLookupElem(mapfd, &key, &val) < 0) {
-            virReportSystemError(errno, "%s",
-                                 _("failed to lookup device in old map"));
-            return -1;
-        }
-
-        if (virBPFUpdateElem(newmapfd, &key, &val) < 0) {
-            virReportSystemError(errno, "%s",
-                                 _("failed to add device into new map"));
-            return -1;
-        }
-
-        prevKey = key;
-    }
-
-    if (rc < 0 && errno != ENOENT) {
+    if ((nitems = virCgroupV2DevicesReadMap(mapfd, size, keys, vals)) < 0) {
         virReportSystemError(errno, "%s",
                              _("failed to copy all device rules"));
         return -1;
     }
 
+    count = nitems;
+    if (nitems > 0 &&
+        virBPFUpdateBatch(newmapfd, keys, vals, &count) < 0) {
+        /* Old kernel, continue one by one after whatever made it */
+        for (i = count; i < (size_t) nitems; i++) {
+            if (virBPFUpdateElem(newmapfd, &keys[i], &vals[i]) < 0) {
+                virReportSystemError(errno, "%s",
+                                     _("failed to add device into new map"));
+                return -1;
+            }
+        }
+    }
+
     ret = newmapfd;
     newmapfd = -1;
     return ret;
@@ -32,6 +32,9 @@
 #endif
 #include <fcntl.h>
 #include <unistd.h>
+#if WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+# include <spawn.h>
+#endif
 
 #if WITH_CAPNG
 # include <cap-ng.h>
@@ -556,6 +559,75 @@ virCommandMassClose(virCommand *cmd,
 
 # else /* ! __FreeBSD__ */
 
+#  if WITH_CLOSE_RANGE
+static int
+virCommandMassCloseCompareFD(const void *a,
+                             const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+
+/* Close all FDs above stderr except those we need to keep with just a
+ * handful of close_range() calls covering the gaps between the kept FDs,
+ * instead of enumerating and closing every single open FD. Returns 0 on
+ * success, 1 if close_range() is not supported by the kernel and -1 on
+ * error. */
+static int
+virCommandMassCloseRange(virCommand *cmd,
+                         int childin,
+                         int childout,
+                         int childerr)
+{
+    g_autofree int *keep = g_new0(int, cmd->npassfd + 3);
+    size_t nkeep = 0;
+    unsigned int from = STDERR_FILENO + 1;
+    bool first = true;
+    size_t i;
+
+    keep[nkeep++] = childin;
+    keep[nkeep++] = childout;
+    keep[nkeep++] = childerr;
+    for (i = 0; i < cmd->npassfd; i++)
+        keep[nkeep++] = cmd->passfd[i].fd;
+
+    qsort(keep, nkeep, sizeof(*keep), virCommandMassCloseCompareFD);
+
+    for (i = 0; i <= nkeep; i++) {
+        unsigned int to = i < nkeep ? keep[i] - 1 : ~0U;
+
+        if (i < nkeep && keep[i] < (int)from)
+            continue;
+
+        if (to >= from) {
+            if (close_range(from, to, 0) < 0) {
+                if (errno == ENOSYS && first)
+                    return 1;
+
+                virReportSystemError(errno, _("failed to close fds %u-%u"),
+                                     from, to);
+                return -1;
+            }
+            first = false;
+        }
+
+        if (i < nkeep)
+            from = keep[i] + 1;
+    }
+
+    for (i = 0; i < cmd->npassfd; i++) {
+        if (virSetInherit(cmd->passfd[i].fd, true) < 0) {
+            virReportSystemError(errno, _("failed to preserve fd %d"),
+                                 cmd->passfd[i].fd);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+#  endif /* WITH_CLOSE_RANGE */
+
+
 static int
 virCommandMassClose(virCommand *cmd,
                     int childin,
@@ -574,6 +646,15 @@ virCommandMassClose(virCommand *cmd,
      * Therefore we can safely allocate memory here (and transitively call
      * opendir/readdir) without a deadlock. */
 
+#  if WITH_CLOSE_RANGE
+    {
+        int rc;
+
+        if ((rc = virCommandMassCloseRange(cmd, childin, childout, childerr)) <= 0)
+            return rc;
+    }
+#  endif
+
     if (openmax < 0) {
         virReportSystemError(errno, "%s", _("sysconf(_SC_OPEN_MAX) failed"));
         return -1;
@@ -607,6 +688,102 @@ virCommandMassClose(virCommand *cmd,
 
 # endif /* ! __FreeBSD__ */
 
+# if WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+/*
+ * virExecSpawn:
+ * @cmd: command to run
+ * @binary: absolute path to the binary to execute
+ * @childin, @childout, @childerr: FDs to become stdio of the child
+ *
+ * Commands which don't need any setup in the child besides stdio and
+ * closing the rest of FDs are started via posix_spawn(), which does not
+ * copy the page tables of the (possibly huge) daemon process.
+ *
+ * Returns the PID of the child, or 0 if @cmd is not eligible or spawning
+ * failed, in which case the caller should resort to virFork().
+ */
+static pid_t
+virExecSpawn(virCommand *cmd,
+             const char *binary,
+             int childin,
+             int childout,
+             int childerr)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigmask;
+    sigset_t sigdefault;
+    pid_t pid = 0;
+    int rc;
+
+    if (cmd->hook ||
+        cmd->handshake ||
+        cmd->pidfile ||
+        cmd->pwd ||
+        cmd->mask ||
+        cmd->npassfd > 0 ||
+        cmd->uid != (uid_t)-1 ||
+        cmd->gid != (gid_t)-1 ||
+        cmd->capabilities ||
+        (cmd->flags & (VIR_EXEC_CLEAR_CAPS | VIR_EXEC_DAEMON)) ||
+        cmd->setMaxMemLock ||
+        cmd->setMaxProcesses ||
+        cmd->setMaxFiles ||
+        cmd->setMaxCore)
+        return 0;
+#  if defined(WITH_SECDRIVER_SELINUX)
+    if (cmd->seLinuxLabel)
+        return 0;
+#  endif
+#  if defined(WITH_SECDRIVER_APPARMOR)
+    if (cmd->appArmorProfile)
+        return 0;
+#  endif
+
+    /* Keep the dup2() actions independent of each other */
+    if ((childin != STDIN_FILENO && childin <= STDERR_FILENO) ||
+        (childout != STDOUT_FILENO && childout <= STDERR_FILENO) ||
+        (childerr != STDERR_FILENO && childerr <= STDERR_FILENO))
+        return 0;
+
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return 0;
+
+    if (posix_spawnattr_init(&attr) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return 0;
+    }
+
+    /* Same as virFork() does: reset all signal handlers and unblock all
+     * signals in the child */
+    sigemptyset(&sigmask);
+    sigfillset(&sigdefault);
+
+    if (posix_spawn_file_actions_adddup2(&actions, childin, STDIN_FILENO) != 0 ||
+        posix_spawn_file_actions_adddup2(&actions, childout, STDOUT_FILENO) != 0 ||
+        posix_spawn_file_actions_adddup2(&actions, childerr, STDERR_FILENO) != 0 ||
+        posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1) != 0 ||
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK |
+                                        POSIX_SPAWN_SETSIGDEF) != 0 ||
+        posix_spawnattr_setsigmask(&attr, &sigmask) != 0 ||
+        posix_spawnattr_setsigdefault(&attr, &sigdefault) != 0)
+        goto cleanup;
+
+    rc = posix_spawn(&pid, binary, &actions, &attr, cmd->args,
+                     cmd->env ? cmd->env : environ);
+    if (rc != 0) {
+        VIR_DEBUG("posix_spawn of %s failed: %s, falling back to fork",
+                  binary, g_strerror(rc));
+        pid = 0;
+    }
+
+ cleanup:
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+# endif /* WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP */
+
 /*
  * virExec:
  * @cmd virCommand * containing all information about the program to
@@ -627,7 +804,7 @@ virExec(virCommand *cmd)
     const char *binary = NULL;
     int ret;
     g_autofree gid_t *groups = NULL;
-    int ngroups;
+    int ngroups = 0;
 
     if (!g_path_is_absolute(cmd->args[0])) {
         if (!(binary = binarystr = virFindFileInPath(cmd->args[0]))) {
@@ -692,10 +869,18 @@ virExec(virCommand *cmd)
         childerr = null;
     }
 
-    if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
-        goto cleanup;
+# if WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+    pid = virExecSpawn(cmd, binary, childin, childout, childerr);
+# else
+    pid = 0;
+# endif
+
+    if (pid == 0) {
+        if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
+            goto cleanup;
 
-    pid = virFork();
+        pid = virFork();
+    }
 
     if (pid < 0)
         goto cleanup;
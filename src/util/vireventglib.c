@@ -44,7 +44,6 @@ struct virEventGLibHandle
     int watch;
     int fd;
     int events;
-    int removed;
     GSource *source;
     virEventHandleCallback cb;
     void *opaque;
@@ -55,7 +54,6 @@ struct virEventGLibTimeout
 {
     int timer;
     int interval;
-    int removed;
     GSource *source;
     virEventTimeoutCallback cb;
     void *opaque;
@@ -64,11 +62,14 @@ struct virEventGLibTimeout
 
 static GMutex *eventlock;
 
+/* Registered handles and timeouts indexed by their watch and timer IDs.
+ * Entries are removed from the tables as soon as they are unregistered,
+ * while the data is freed asynchronously once no longer used by GLib. */
 static int nextwatch = 1;
-static GPtrArray *handles;
+static GHashTable *handles;
 
 static int nexttimer = 1;
-static GPtrArray *timeouts;
+static GHashTable *timeouts;
 
 static GIOCondition
 virEventGLibEventsToCondition(int events)
@@ -153,7 +154,7 @@ virEventGLibHandleAdd(int fd,
             fd, cond, NULL, virEventGLibHandleDispatch, data, NULL);
     }
 
-    g_ptr_array_add(handles, data);
+    g_hash_table_insert(handles, GINT_TO_POINTER(data->watch), data);
 
     ret = data->watch;
 
@@ -168,21 +169,7 @@ virEventGLibHandleAdd(int fd,
 static struct virEventGLibHandle *
 virEventGLibHandleFind(int watch)
 {
-    guint i;
-
-    for (i = 0; i < handles->len; i++) {
-        struct virEventGLibHandle *h = g_ptr_array_index(handles, i);
-
-        if (h == NULL) {
-            g_warn_if_reached();
-            continue;
-        }
-
-        if ((h->watch == watch) && !h->removed)
-            return h;
-    }
-
-    return NULL;
+    return g_hash_table_lookup(handles, GINT_TO_POINTER(watch));
 }
 
 
@@ -248,9 +235,7 @@ virEventGLibHandleRemoveIdle(gpointer data)
     if (h->ff)
         (h->ff)(h->opaque);
 
-    g_mutex_lock(eventlock);
-    g_ptr_array_remove_fast(handles, h);
-    g_mutex_unlock(eventlock);
+    g_free(h);
 
     return FALSE;
 }
@@ -283,10 +268,10 @@ virEventGLibHandleRemove(int watch)
     }
 
     /* since the actual watch deletion is done asynchronously, a handleUpdate call may
-     * reschedule the watch before it's fully deleted, that's why we need to mark it as
-     * 'removed' to prevent reuse
+     * reschedule the watch before it's fully deleted, that's why we need to remove it
+     * from the table right away to prevent reuse
      */
-    data->removed = TRUE;
+    g_hash_table_remove(handles, GINT_TO_POINTER(watch));
     g_idle_add_full(G_PRIORITY_HIGH, virEventGLibHandleRemoveIdle, data, NULL);
 
     ret = 0;
@@ -349,7 +334,7 @@ virEventGLibTimeoutAdd(int interval,
     if (interval >= 0)
         data->source = virEventGLibTimeoutCreate(interval, data);
 
-    g_ptr_array_add(timeouts, data);
+    g_hash_table_insert(timeouts, GINT_TO_POINTER(data->timer), data);
 
     VIR_DEBUG("Add timeout data=%p interval=%d ms cb=%p opaque=%p timer=%d",
               data, interval, cb, opaque, data->timer);
@@ -368,23 +353,9 @@ virEventGLibTimeoutAdd(int interval,
 static struct virEventGLibTimeout *
 virEventGLibTimeoutFind(int timer)
 {
-    guint i;
-
     g_return_val_if_fail(timeouts != NULL, NULL);
 
-    for (i = 0; i < timeouts->len; i++) {
-        struct virEventGLibTimeout *t = g_ptr_array_index(timeouts, i);
-
-        if (t == NULL) {
-            g_warn_if_reached();
-            continue;
-        }
-
-        if ((t->timer == timer) && !t->removed)
-            return t;
-    }
-
-    return NULL;
+    return g_hash_table_lookup(timeouts, GINT_TO_POINTER(timer));
 }
 
 
@@ -440,9 +411,7 @@ virEventGLibTimeoutRemoveIdle(gpointer data)
     if (t->ff)
         (t->ff)(t->opaque);
 
-    g_mutex_lock(eventlock);
-    g_ptr_array_remove_fast(timeouts, t);
-    g_mutex_unlock(eventlock);
+    g_free(t);
 
     return FALSE;
 }
@@ -474,10 +443,10 @@ virEventGLibTimeoutRemove(int timer)
     }
 
     /* since the actual timeout deletion is done asynchronously, a timeoutUpdate call may
-     * reschedule the timeout before it's fully deleted, that's why we need to mark it as
-     * 'removed' to prevent reuse
+     * reschedule the timeout before it's fully deleted, that's why we need to remove it
+     * from the table right away to prevent reuse
      */
-    data->removed = TRUE;
+    g_hash_table_remove(timeouts, GINT_TO_POINTER(timer));
     g_idle_add(virEventGLibTimeoutRemoveIdle, data);
 
     ret = 0;
@@ -491,8 +460,8 @@ virEventGLibTimeoutRemove(int timer)
 static gpointer virEventGLibRegisterOnce(gpointer data G_GNUC_UNUSED)
 {
     eventlock = g_new0(GMutex, 1);
-    timeouts = g_ptr_array_new_with_free_func(g_free);
-    handles = g_ptr_array_new_with_free_func(g_free);
+    timeouts = g_hash_table_new(g_direct_hash, g_direct_equal);
+    handles = g_hash_table_new(g_direct_hash, g_direct_equal);
     virEventRegisterImpl(virEventGLibHandleAdd,
                          virEventGLibHandleUpdate,
                          virEventGLibHandleRemove,
@@ -47,6 +47,11 @@
 VIR_LOG_INIT("fdstream");
 
 #ifndef WIN32
+/* Size of the chunks the worker thread reads from the file, and how many
+ * of them it may queue up ahead of the stream client consuming them */
+# define VIR_FDSTREAM_THREAD_BUFLEN (1024 * 1024)
+# define VIR_FDSTREAM_THREAD_READAHEAD 8
+
 typedef enum {
     VIR_FDSTREAM_MSG_TYPE_DATA,
     VIR_FDSTREAM_MSG_TYPE_HOLE,
@@ -107,6 +112,7 @@ struct virFDStreamData {
     bool threadAbort;
     bool threadDoRead;
     virFDStreamMsg *msg;
+    size_t nmsg;        /* number of messages in @msg queue */
 };
 
 static virClass *virFDStreamDataClass;
@@ -149,6 +155,7 @@ virFDStreamMsgQueuePush(virFDStreamData *fdst,
         tmp = &(*tmp)->next;
 
     *tmp = g_steal_pointer(msg);
+    fdst->nmsg++;
     virCondSignal(&fdst->threadCond);
 
     if (safewrite(fd, &c, sizeof(c)) != sizeof(c)) {
@@ -172,6 +179,7 @@ virFDStreamMsgQueuePop(virFDStreamData *fdst,
 
     if (tmp) {
         fdst->msg = g_steal_pointer(&tmp->next);
+        fdst->nmsg--;
     }
 
     virCondSignal(&fdst->threadCond);
@@ -415,18 +423,21 @@ virFDStreamThreadDataFree(virFDStreamThreadData *data)
 }
 
 
+/*
+ * Reads the next chunk of @fdin into a new message stored in @ret_msg.
+ * Called without the stream object locked, @fdin is accessed by the
+ * worker thread only.
+ */
 static ssize_t
-virFDStreamThreadDoRead(virFDStreamData *fdst,
-                        bool sparse,
-                        bool isBlock,
-                        const int fdin,
-                        const int fdout,
-                        const char *fdinname,
-                        const char *fdoutname,
-                        size_t length,
-                        size_t total,
-                        size_t *dataLen,
-                        size_t buflen)
+virFDStreamThreadReadMsg(virFDStreamMsg **ret_msg,
+                         bool sparse,
+                         bool isBlock,
+                         const int fdin,
+                         const char *fdinname,
+                         size_t length,
+                         size_t total,
+                         size_t *dataLen,
+                         size_t buflen)
 {
     g_autoptr(virFDStreamMsg) msg = NULL;
     int inData = 0;
@@ -492,31 +503,72 @@ virFDStreamThreadDoRead(virFDStreamData *fdst,
             return -1;
         }
 
-        msg->type = VIR_FDSTREAM_MSG_TYPE_DATA;
-        msg->stream.data.buf = g_steal_pointer(&buf);
-        msg->stream.data.len = got;
+        /* Data sections may still be full of zeroes, e.g. all of a block
+         * device is data. Send such chunks as holes to save the transfer,
+         * the receiving side makes them read back as zeroes either way. */
+        if (sparse && got > 0 && virFileDataIsZero(buf, got)) {
+            msg->type = VIR_FDSTREAM_MSG_TYPE_HOLE;
+            msg->stream.hole.len = got;
+        } else {
+            msg->type = VIR_FDSTREAM_MSG_TYPE_DATA;
+            msg->stream.data.buf = g_steal_pointer(&buf);
+            msg->stream.data.len = got;
+        }
         if (sparse)
             *dataLen -= got;
     }
 
+    *ret_msg = g_steal_pointer(&msg);
+    return got;
+}
+
+
+static ssize_t
+virFDStreamThreadDoRead(virFDStreamData *fdst,
+                        bool sparse,
+                        bool isBlock,
+                        const int fdin,
+                        const int fdout,
+                        const char *fdinname,
+                        const char *fdoutname,
+                        size_t length,
+                        size_t total,
+                        size_t *dataLen,
+                        size_t buflen)
+{
+    g_autoptr(virFDStreamMsg) msg = NULL;
+    ssize_t got;
+
+    /* Let the stream client consume queued messages meanwhile */
+    virObjectUnlock(fdst);
+    got = virFDStreamThreadReadMsg(&msg, sparse, isBlock, fdin, fdinname,
+                                   length, total, dataLen, buflen);
+    virObjectLock(fdst);
+
+    if (got < 0)
+        return -1;
+
     virFDStreamMsgQueuePush(fdst, &msg, fdout, fdoutname);
 
     return got;
 }
 
 
+/*
+ * Writes (the rest of) @msg into @fdout, setting @pop once the message
+ * was written completely. Called without the stream object locked; the
+ * message at the head of the queue is only ever removed by the worker
+ * thread in write mode.
+ */
 static ssize_t
-virFDStreamThreadDoWrite(virFDStreamData *fdst,
-                         bool sparse,
-                         bool isBlock,
-                         const int fdin,
-                         const int fdout,
-                         const char *fdinname,
-                         const char *fdoutname)
+virFDStreamThreadWriteMsg(virFDStreamMsg *msg,
+                          bool sparse,
+                          bool isBlock,
+                          const int fdout,
+                          const char *fdoutname,
+                          bool *pop)
 {
     ssize_t got = 0;
-    virFDStreamMsg *msg = fdst->msg;
-    bool pop = false;
 
     switch (msg->type) {
     case VIR_FDSTREAM_MSG_TYPE_DATA:
@@ -532,7 +584,7 @@ virFDStreamThreadDoWrite(virFDStreamData *fdst,
 
         msg->stream.data.offset += got;
 
-        pop = msg->stream.data.offset == msg->stream.data.len;
+        *pop = msg->stream.data.offset == msg->stream.data.len;
         break;
 
     case VIR_FDSTREAM_MSG_TYPE_HOLE:
@@ -587,10 +639,35 @@ virFDStreamThreadDoWrite(virFDStreamData *fdst,
             }
         }
 
-        pop = true;
+        *pop = true;
         break;
     }
 
+    return got;
+}
+
+
+static ssize_t
+virFDStreamThreadDoWrite(virFDStreamData *fdst,
+                         bool sparse,
+                         bool isBlock,
+                         const int fdin,
+                         const int fdout,
+                         const char *fdinname,
+                         const char *fdoutname)
+{
+    virFDStreamMsg *msg = fdst->msg;
+    bool pop = false;
+    ssize_t got;
+
+    /* Let the stream client queue more messages meanwhile */
+    virObjectUnlock(fdst);
+    got = virFDStreamThreadWriteMsg(msg, sparse, isBlock, fdout, fdoutname, &pop);
+    virObjectLock(fdst);
+
+    if (got < 0)
+        return -1;
+
     if (pop) {
         virFDStreamMsgQueuePop(fdst, fdin, fdinname);
         virFDStreamMsgFree(msg);
@@ -614,7 +691,7 @@ virFDStreamThread(void *opaque)
     char *fdoutname = data->fdoutname;
     virFDStreamData *fdst = st->privateData;
     bool doRead = fdst->threadDoRead;
-    size_t buflen = 256 * 1024;
+    size_t buflen = VIR_FDSTREAM_THREAD_BUFLEN;
     size_t total = 0;
     size_t dataLen = 0;
 
@@ -624,7 +701,10 @@ virFDStreamThread(void *opaque)
     while (1) {
         ssize_t got;
 
-        while (doRead == (fdst->msg != NULL) &&
+        /* Reading, keep up to VIR_FDSTREAM_THREAD_READAHEAD messages
+         * queued. Writing, wait for a message to write. */
+        while ((doRead ? fdst->nmsg >= VIR_FDSTREAM_THREAD_READAHEAD :
+                         !fdst->msg) &&
                !fdst->threadQuit) {
             if (virCondWait(&fdst->threadCond, &fdst->parent.lock)) {
                 virReportSystemError(errno, "%s",
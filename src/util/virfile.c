@@ -83,10 +83,12 @@
 #include "vircommand.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virkmod.h"
 #include "virlog.h"
 #include "virprocess.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "virutil.h"
 #include "virsocket.h"
 
@@ -484,6 +486,162 @@ int virFileUnlock(int fd G_GNUC_UNUSED,
 #endif /* WIN32 */
 
 
+#ifdef WITH_SYNCFS
+
+/* Files rewritten concurrently in the same directory share a single
+ * syncfs() barrier instead of being flushed one at a time. */
+typedef struct _virFileSyncGroup virFileSyncGroup;
+struct _virFileSyncGroup {
+    size_t users;                   /* writers waiting for their file to be
+                                     * flushed */
+    unsigned long long joined;      /* tickets handed out to the writers */
+    unsigned long long synced;      /* tickets covered by a finished sync */
+    bool syncing;                   /* a writer is running syncfs() */
+};
+
+static virMutex virFileSyncLock = VIR_MUTEX_INITIALIZER;
+static virCond virFileSyncCond;
+static GHashTable *virFileSyncGroups;
+
+
+static int
+virFileSyncOnceInit(void)
+{
+    if (virCondInit(&virFileSyncCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize condition variable"));
+        return -1;
+    }
+
+    virFileSyncGroups = virHashNew(g_free);
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virFileSync);
+
+
+/* Flushes the file system holding @dir. Returns -1 with errno set on
+ * failure. */
+static int
+virFileSyncDir(const char *dir)
+{
+    VIR_AUTOCLOSE dirfd = -1;
+
+    if ((dirfd = open(dir, O_RDONLY | O_DIRECTORY)) < 0)
+        return -1;
+
+    return syncfs(dirfd);
+}
+
+
+/*
+ * Makes the data written to @fd, the new contents of the file @newfile,
+ * durable. A writer which is alone in the directory of @newfile simply
+ * flushes @fd. Otherwise the first of the writers flushes the whole file
+ * system once for all of them, and the writers which join while that is
+ * in progress are covered by the next flush, so that a burst of rewrites
+ * waits for a few barriers rather than one per file.
+ *
+ * Returns -1 with errno set on failure.
+ */
+static int
+virFileRewriteSync(const char *newfile,
+                   int fd)
+{
+    g_autofree char *dir = NULL;
+    virFileSyncGroup *group;
+    unsigned long long ticket;
+    int saved_errno = 0;
+    int ret = 0;
+    int rc;
+
+    if (virFileSyncInitialize() < 0) {
+        virResetLastError();
+        return g_fsync(fd);
+    }
+
+    dir = g_path_get_dirname(newfile);
+
+    virMutexLock(&virFileSyncLock);
+
+    if (!(group = g_hash_table_lookup(virFileSyncGroups, dir))) {
+        group = g_new0(virFileSyncGroup, 1);
+        g_hash_table_insert(virFileSyncGroups, g_strdup(dir), group);
+    }
+
+    group->users++;
+    ticket = ++group->joined;
+
+    if (group->users == 1) {
+        /* Nobody to share the barrier with */
+        virMutexUnlock(&virFileSyncLock);
+        rc = g_fsync(fd);
+        saved_errno = errno;
+        virMutexLock(&virFileSyncLock);
+
+        if (rc < 0)
+            ret = -1;
+        goto cleanup;
+    }
+
+    while (group->synced < ticket) {
+        unsigned long long target;
+
+        if (group->syncing) {
+            if (virCondWait(&virFileSyncCond, &virFileSyncLock) < 0) {
+                saved_errno = errno;
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+
+        /* Everything written by the writers which joined so far is
+         * covered by the flush */
+        group->syncing = true;
+        target = group->joined;
+
+        virMutexUnlock(&virFileSyncLock);
+        rc = virFileSyncDir(dir);
+        saved_errno = errno;
+        virMutexLock(&virFileSyncLock);
+
+        group->syncing = false;
+        if (rc == 0)
+            group->synced = MAX(group->synced, target);
+        virCondBroadcast(&virFileSyncCond);
+
+        /* The writers waiting for this flush retry it themselves */
+        if (rc < 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+ cleanup:
+    if (--group->users == 0)
+        g_hash_table_remove(virFileSyncGroups, dir);
+
+    virMutexUnlock(&virFileSyncLock);
+
+    if (ret < 0)
+        errno = saved_errno;
+    return ret;
+}
+
+#else /* !WITH_SYNCFS */
+
+static int
+virFileRewriteSync(const char *newfile G_GNUC_UNUSED,
+                   int fd)
+{
+    return g_fsync(fd);
+}
+
+#endif /* !WITH_SYNCFS */
+
+
 int
 virFileRewrite(const char *path,
                mode_t mode,
@@ -508,7 +666,7 @@ virFileRewrite(const char *path,
         goto cleanup;
     }
 
-    if (g_fsync(fd) < 0) {
+    if (virFileRewriteSync(newfile, fd) < 0) {
         virReportSystemError(errno, _("cannot sync file '%s'"),
                              newfile);
         goto cleanup;
@@ -557,6 +715,176 @@ virFileRewriteStr(const char *path,
 }
 
 
+struct _virFileRewriteBatch {
+    GPtrArray *paths;   /* files whose new contents are in place */
+};
+
+
+/**
+ * virFileRewriteBatchNew:
+ *
+ * Creates a batch of files to be rewritten at once. Each file added by
+ * virFileRewriteBatchAdd gets its new contents written aside right away,
+ * but they only replace the files when the batch is committed by
+ * virFileRewriteBatchCommit. Compared to rewriting the files one by one
+ * with virFileRewrite, the new contents of all of them can be flushed to
+ * the disk together rather than waiting for each file before writing the
+ * next one.
+ */
+virFileRewriteBatch *
+virFileRewriteBatchNew(void)
+{
+    virFileRewriteBatch *batch = g_new0(virFileRewriteBatch, 1);
+
+    batch->paths = g_ptr_array_new_with_free_func(g_free);
+
+    return batch;
+}
+
+
+/**
+ * virFileRewriteBatchFree:
+ * @batch: batch of files
+ *
+ * Frees @batch. The new contents of the files which were not committed
+ * are discarded, leaving the files as they were.
+ */
+void
+virFileRewriteBatchFree(virFileRewriteBatch *batch)
+{
+    size_t i;
+
+    if (!batch)
+        return;
+
+    for (i = 0; i < batch->paths->len; i++) {
+        g_autofree char *newfile = NULL;
+
+        newfile = g_strdup_printf("%s.new", (char *) g_ptr_array_index(batch->paths, i));
+        unlink(newfile);
+    }
+
+    g_ptr_array_unref(batch->paths);
+    g_free(batch);
+}
+
+
+/**
+ * virFileRewriteBatchAdd:
+ * @batch: batch of files
+ * @path: file to rewrite
+ * @mode: mode of the file if it is created
+ * @rewrite: callback writing the new contents
+ * @opaque: data passed to @rewrite
+ *
+ * Writes the new contents of @path like virFileRewrite does, but leaves
+ * flushing it and replacing @path to virFileRewriteBatchCommit.
+ *
+ * Returns 0 on success, -1 on error with an error reported.
+ */
+int
+virFileRewriteBatchAdd(virFileRewriteBatch *batch,
+                       const char *path,
+                       mode_t mode,
+                       virFileRewriteFunc rewrite,
+                       const void *opaque)
+{
+    g_autofree char *newfile = NULL;
+    VIR_AUTOCLOSE fd = -1;
+
+    newfile = g_strdup_printf("%s.new", path);
+
+    if ((fd = open(newfile, O_WRONLY | O_CREAT | O_TRUNC, mode)) < 0) {
+        virReportSystemError(errno, _("cannot create file '%s'"),
+                             newfile);
+        return -1;
+    }
+
+    if (rewrite(fd, opaque) < 0) {
+        virReportSystemError(errno, _("cannot write data to file '%s'"),
+                             newfile);
+        unlink(newfile);
+        return -1;
+    }
+
+    if (VIR_CLOSE(fd) < 0) {
+        virReportSystemError(errno, _("cannot save file '%s'"),
+                             newfile);
+        unlink(newfile);
+        return -1;
+    }
+
+    g_ptr_array_add(batch->paths, g_strdup(path));
+    return 0;
+}
+
+
+/**
+ * virFileRewriteBatchCommit:
+ * @batch: batch of files
+ *
+ * Flushes the new contents of all files added to @batch to the disk and
+ * then replaces the files with them. The files are replaced only once the
+ * new contents of all of them are safely stored, so if flushing any of them
+ * fails, none of the files is changed. Where syncfs() is available, the
+ * files sharing a directory are flushed by a single barrier.
+ *
+ * Returns 0 on success, -1 on error with an error reported.
+ */
+int
+virFileRewriteBatchCommit(virFileRewriteBatch *batch)
+{
+    g_autoptr(GHashTable) synced = virHashNew(NULL);
+    size_t i;
+
+    for (i = 0; i < batch->paths->len; i++) {
+        const char *path = g_ptr_array_index(batch->paths, i);
+        g_autofree char *newfile = g_strdup_printf("%s.new", path);
+        VIR_AUTOCLOSE fd = -1;
+
+#ifdef WITH_SYNCFS
+        if (batch->paths->len > 1) {
+            g_autofree char *dir = g_path_get_dirname(path);
+
+            if (virHashHasEntry(synced, dir))
+                continue;
+
+            if (virFileSyncDir(dir) < 0) {
+                virReportSystemError(errno, _("cannot sync file '%s'"),
+                                     newfile);
+                return -1;
+            }
+
+            g_hash_table_add(synced, g_steal_pointer(&dir));
+            continue;
+        }
+#endif /* WITH_SYNCFS */
+
+        if ((fd = open(newfile, O_RDONLY)) < 0 ||
+            g_fsync(fd) < 0) {
+            virReportSystemError(errno, _("cannot sync file '%s'"),
+                                 newfile);
+            return -1;
+        }
+    }
+
+    while (batch->paths->len > 0) {
+        const char *path = g_ptr_array_index(batch->paths, 0);
+        g_autofree char *newfile = g_strdup_printf("%s.new", path);
+
+        if (rename(newfile, path) < 0) {
+            virReportSystemError(errno, _("cannot rename file '%s' as '%s'"),
+                                 newfile, path);
+            return -1;
+        }
+
+        g_ptr_array_remove_index(batch->paths, 0);
+    }
+
+    return 0;
+}
+
+
 /**
  * virFileResize:
  *
@@ -3946,6 +4274,35 @@ virFileInData(int fd G_GNUC_UNUSED,
 #endif /* !WITH_DECL_SEEK_HOLE */
 
 
+/**
+ * virFileDataIsZero:
+ * @buf: data read from a file
+ * @len: length of @buf
+ *
+ * Checks whether @buf contains only zero bytes, which allows finding holes
+ * where virFileInData can't, such as in block devices or on filesystems
+ * storing zeroes. Once a short prefix is known to be zero, the buffer is
+ * compared with itself shifted by the prefix, so that the bulk of the work
+ * is done by the vectorized memcmp() of the C library.
+ *
+ * Returns true if all @len bytes of @buf are zero.
+ */
+bool
+virFileDataIsZero(const char *buf,
+                  size_t len)
+{
+    size_t prefix = MIN(len, 16);
+    size_t i;
+
+    for (i = 0; i < prefix; i++) {
+        if (buf[i])
+            return false;
+    }
+
+    return len == prefix || memcmp(buf, buf + prefix, len - prefix) == 0;
+}
+
+
 /**
  * virFileReadValueInt:
  * @value: pointer to int to be filled in with the value
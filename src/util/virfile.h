@@ -132,6 +132,17 @@ int virFileRewriteStr(const char *path,
                       mode_t mode,
                       const char *str);
 
+typedef struct _virFileRewriteBatch virFileRewriteBatch;
+virFileRewriteBatch *virFileRewriteBatchNew(void);
+void virFileRewriteBatchFree(virFileRewriteBatch *batch);
+int virFileRewriteBatchAdd(virFileRewriteBatch *batch,
+                           const char *path,
+                           mode_t mode,
+                           virFileRewriteFunc rewrite,
+                           const void *opaque);
+int virFileRewriteBatchCommit(virFileRewriteBatch *batch);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFileRewriteBatch, virFileRewriteBatchFree);
+
 int virFileResize(const char *path,
                   unsigned long long capacity,
                   bool pre_allocate);
@@ -355,6 +366,9 @@ int virFileInData(int fd,
                   int *inData,
                   long long *length);
 
+bool virFileDataIsZero(const char *buf,
+                       size_t len);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFileWrapperFd, virFileWrapperFdFree);
 
 int virFileGetXAttr(const char *path,
@@ -31,9 +31,11 @@
 #include "virfile.h"
 #include "virfilecache.h"
 #include "virhash.h"
+#include "virhostcpu.h"
 #include "virlog.h"
 #include "virobject.h"
 #include "virstring.h"
+#include "virthreadpool.h"
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -43,12 +45,20 @@
 
 VIR_LOG_INIT("util.filecache");
 
+#define VIR_FILE_CACHE_PREFETCH_WORKERS_MAX 8
+
 
 struct _virFileCache {
     virObjectLockable parent;
 
     GHashTable *table;
 
+    /* Names of the data being created right now, the cache is not
+     * locked while doing so. @pendingCond is broadcast once any of
+     * them is finished. */
+    GHashTable *pending;
+    virCond pendingCond;
+
     char *dir;
     char *suffix;
 
@@ -78,6 +88,8 @@ virFileCacheDispose(void *obj)
     g_free(cache->suffix);
 
     virHashFree(cache->table);
+    virHashFree(cache->pending);
+    virCondDestroy(&cache->pendingCond);
 
     virFileCachePrivFree(cache);
 }
@@ -227,6 +239,11 @@ virFileCacheNewData(virFileCache *cache,
  * Creates a new cache object which handles caching any data to files
  * stored on a filesystem.
  *
+ * The loadFile, newData and saveFile handlers are called without the
+ * cache being locked so that data for different names can be created
+ * in parallel, see virFileCachePrefetch. The private data must not be
+ * changed while the cache is in use.
+ *
  * Returns new cache object or NULL on error.
  */
 virFileCache *
@@ -239,10 +256,18 @@ virFileCacheNew(const char *dir,
     if (virFileCacheInitialize() < 0)
         return NULL;
 
-    if (!(cache = virObjectNew(virFileCacheClass)))
+    if (!(cache = virObjectLockableNew(virFileCacheClass)))
+        return NULL;
+
+    if (virCondInit(&cache->pendingCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize cache condition"));
+        virObjectUnref(cache);
         return NULL;
+    }
 
     cache->table = virHashNew(virObjectFreeHashData);
+    cache->pending = virHashNew(NULL);
 
     cache->dir = g_strdup(dir);
 
@@ -268,8 +293,30 @@ virFileCacheValidate(virFileCache *cache,
     }
 
     if (!*data && name) {
+        /* Somebody else may be creating the very same data already */
+        while (virHashHasEntry(cache->pending, name)) {
+            VIR_DEBUG("Waiting for data for '%s'", name);
+            if (virCondWait(&cache->pendingCond, &cache->parent.lock) < 0) {
+                virReportSystemError(errno, "%s",
+                                     _("failed to wait for cached data"));
+                return;
+            }
+        }
+
+        if ((*data = virHashLookup(cache->table, name)))
+            return;
+
         VIR_DEBUG("Creating data for '%s'", name);
+        if (virHashAddEntry(cache->pending, name, cache) < 0)
+            return;
+
+        virObjectUnlock(cache);
         *data = virFileCacheNewData(cache, name);
+        virObjectLock(cache);
+
+        virHashRemoveEntry(cache->pending, name);
+        virCondBroadcast(&cache->pendingCond);
+
         if (*data) {
             VIR_DEBUG("Caching data '%p' for '%s'", *data, name);
             if (virHashAddEntry(cache->table, name, *data) < 0) {
@@ -342,6 +389,130 @@ virFileCacheLookupByFunc(virFileCache *cache,
 }
 
 
+typedef struct _virFileCachePrefetchCtx virFileCachePrefetchCtx;
+struct _virFileCachePrefetchCtx {
+    virFileCache *cache;
+
+    virMutex lock;
+    virCond cond;
+    size_t pending;
+};
+
+
+static void
+virFileCachePrefetchOne(virFileCache *cache,
+                        const char *name)
+{
+    void *data;
+
+    /* Errors are reported later on once the data is really needed */
+    if (!(data = virFileCacheLookup(cache, name))) {
+        VIR_DEBUG("Failed to prefetch data for '%s': %s",
+                  name, virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    virObjectUnref(data);
+}
+
+
+static void
+virFileCachePrefetchWorker(void *jobdata,
+                           void *opaque)
+{
+    const char *name = jobdata;
+    virFileCachePrefetchCtx *ctx = opaque;
+
+    virFileCachePrefetchOne(ctx->cache, name);
+
+    virMutexLock(&ctx->lock);
+    if (--ctx->pending == 0)
+        virCondSignal(&ctx->cond);
+    virMutexUnlock(&ctx->lock);
+}
+
+
+/**
+ * virFileCachePrefetch:
+ * @cache: existing cache object
+ * @names: NULL terminated list of names
+ *
+ * Makes sure data for all @names is cached, creating the missing ones
+ * using a pool of worker threads. Other threads looking up data while
+ * this runs have to wait only if they need data which is being created
+ * at the moment. Failures are not reported, they will be reported once
+ * the failed data is looked up.
+ */
+void
+virFileCachePrefetch(virFileCache *cache,
+                     const char *const *names)
+{
+    virFileCachePrefetchCtx ctx = { .cache = cache };
+    virThreadPool *pool = NULL;
+    size_t nnames = g_strv_length((char **) names);
+    int nworkers;
+    size_t i;
+
+    if ((nworkers = virHostCPUGetCount()) < 0) {
+        virResetLastError();
+        nworkers = 1;
+    }
+    nworkers = MIN(nworkers, VIR_FILE_CACHE_PREFETCH_WORKERS_MAX);
+    nworkers = MIN(nworkers, nnames);
+
+    if (nworkers > 1 &&
+        virMutexInit(&ctx.lock) == 0) {
+        if (virCondInit(&ctx.cond) == 0) {
+            pool = virThreadPoolNewFull(0, nworkers, 0,
+                                        virFileCachePrefetchWorker,
+                                        "cache-prefetch", NULL, &ctx);
+            if (!pool)
+                virCondDestroy(&ctx.cond);
+        }
+        if (!pool)
+            virMutexDestroy(&ctx.lock);
+    }
+
+    if (!pool) {
+        virResetLastError();
+        for (i = 0; i < nnames; i++)
+            virFileCachePrefetchOne(cache, names[i]);
+        return;
+    }
+
+    VIR_DEBUG("Prefetching %zu entries using %d workers", nnames, nworkers);
+
+    for (i = 0; i < nnames; i++) {
+        virMutexLock(&ctx.lock);
+        ctx.pending++;
+        virMutexUnlock(&ctx.lock);
+
+        if (virThreadPoolSendJob(pool, 0, (void *) names[i]) < 0) {
+            virMutexLock(&ctx.lock);
+            ctx.pending--;
+            virMutexUnlock(&ctx.lock);
+
+            virResetLastError();
+            virFileCachePrefetchOne(cache, names[i]);
+        }
+    }
+
+    virMutexLock(&ctx.lock);
+    while (ctx.pending > 0) {
+        /* Freeing the pool below waits for running workers anyway */
+        if (virCondWait(&ctx.cond, &ctx.lock) < 0) {
+            VIR_WARN("Failed to wait for cache prefetch");
+            break;
+        }
+    }
+    virMutexUnlock(&ctx.lock);
+
+    virThreadPoolFree(pool);
+    virCondDestroy(&ctx.cond);
+    virMutexDestroy(&ctx.lock);
+}
+
+
 /**
  * virFileCacheGetPriv:
  * @cache: existing cache object
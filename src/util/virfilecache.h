@@ -124,6 +124,10 @@ virFileCacheLookupByFunc(virFileCache *cache,
                          virHashSearcher iter,
                          const void *iterData);
 
+void
+virFileCachePrefetch(virFileCache *cache,
+                     const char *const *names);
+
 void *
 virFileCacheGetPriv(virFileCache *cache);
 
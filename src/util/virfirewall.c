@@ -83,6 +83,9 @@ struct _virFirewall {
 
 static virFirewallBackend currentBackend = VIR_FIREWALL_BACKEND_AUTOMATIC;
 static virMutex ruleLock = VIR_MUTEX_INITIALIZER;
+/* apply eligible transactions via iptables-restore, see
+ * virFirewallEnableBatching */
+static bool batchEnabled;
 
 static int
 virFirewallValidateBackend(virFirewallBackend backend);
@@ -154,6 +157,33 @@ virFirewallSetBackend(virFirewallBackend backend)
     return virFirewallValidateBackend(backend);
 }
 
+/**
+ * virFirewallEnableBatching:
+ *
+ * Let transactions which consist only of iptables and ip6tables rules,
+ * none of which queries data or ignores errors, be applied by a single
+ * iptables-restore and ip6tables-restore process per layer instead of
+ * running a process for every rule. The rules of every table are then
+ * committed atomically. Batching is enabled only if both tools are
+ * available and rules are not passed through firewalld.
+ */
+void
+virFirewallEnableBatching(void)
+{
+    g_autofree char *iptablesRestore = virFindFileInPath(IPTABLES_RESTORE);
+    g_autofree char *ip6tablesRestore = virFindFileInPath(IP6TABLES_RESTORE);
+
+    if (!iptablesRestore || !ip6tablesRestore) {
+        VIR_DEBUG("iptables-restore/ip6tables-restore not found, "
+                  "not batching firewall rules");
+        return;
+    }
+
+    VIR_DEBUG("batching firewall rules via iptables-restore");
+    batchEnabled = true;
+}
+
+
 static virFirewallGroup *
 virFirewallGroupNew(void)
 {
@@ -555,6 +585,39 @@ virFirewallRuleToString(virFirewallRule *rule)
     return virBufferContentAndReset(&buf);
 }
 
+
+/**
+ * virFirewallFormat:
+ * @firewall: firewall ruleset to format
+ *
+ * Format the transactions and rules of @firewall, one per line, so
+ * that callers can tell whether applying two rulesets would run the
+ * same commands. Rollback rules are not included.
+ *
+ * Returns the formatted ruleset, to be freed by the caller
+ */
+char *
+virFirewallFormat(virFirewall *firewall)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < firewall->ngroups; i++) {
+        virFirewallGroup *group = firewall->groups[i];
+
+        virBufferAsprintf(&buf, "transaction flags=0x%x\n", group->actionFlags);
+        for (j = 0; j < group->naction; j++) {
+            g_autofree char *str = virFirewallRuleToString(group->action[j]);
+
+            virBufferAsprintf(&buf, "%s\n", str);
+        }
+    }
+
+    return virBufferContentAndReset(&buf);
+}
+
+
 static int
 virFirewallApplyRuleDirect(virFirewallRule *rule,
                            bool ignoreErrors,
@@ -698,6 +761,171 @@ virFirewallApplyRule(virFirewall *firewall,
     return 0;
 }
 
+static bool
+virFirewallGroupCanBatch(virFirewallGroup *group)
+{
+    size_t i;
+
+    if (!batchEnabled ||
+        currentBackend != VIR_FIREWALL_BACKEND_DIRECT ||
+        group->actionFlags & VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS)
+        return false;
+
+    for (i = 0; i < group->naction; i++) {
+        virFirewallRule *rule = group->action[i];
+
+        if (rule->layer != VIR_FIREWALL_LAYER_IPV4 &&
+            rule->layer != VIR_FIREWALL_LAYER_IPV6)
+            return false;
+
+        if (rule->queryCB || rule->ignoreErrors)
+            return false;
+    }
+
+    return true;
+}
+
+
+static void
+virFirewallRuleFormatRestoreArg(virBuffer *buf,
+                                const char *arg)
+{
+    const char *p;
+
+    if (*arg && !strpbrk(arg, " \t\"'\\")) {
+        virBufferAdd(buf, arg, -1);
+        return;
+    }
+
+    virBufferAddChar(buf, '"');
+    for (p = arg; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            virBufferAddChar(buf, '\\');
+        virBufferAddChar(buf, *p);
+    }
+    virBufferAddChar(buf, '"');
+}
+
+
+typedef struct _virFirewallRestoreTable virFirewallRestoreTable;
+struct _virFirewallRestoreTable {
+    const char *name;
+    virBuffer rules;
+};
+
+
+/* Format the rules of @group for @layer in the input format of
+ * iptables-restore, grouped by table while preserving their order
+ * within each table. Returns NULL if @group has no rule for @layer. */
+static char *
+virFirewallGroupFormatRestore(virFirewallGroup *group,
+                              virFirewallLayer layer)
+{
+    g_autofree virFirewallRestoreTable *tables = NULL;
+    size_t ntables = 0;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+    size_t j;
+
+    tables = g_new0(virFirewallRestoreTable, group->naction);
+
+    for (i = 0; i < group->naction; i++) {
+        virFirewallRule *rule = group->action[i];
+        const char *table = "filter";
+        virBuffer *tablebuf = NULL;
+        bool first = true;
+
+        if (rule->layer != layer)
+            continue;
+
+        for (j = 0; j + 1 < rule->argsLen; j++) {
+            if (STREQ(rule->args[j], "--table") ||
+                STREQ(rule->args[j], "-t")) {
+                table = rule->args[j + 1];
+                break;
+            }
+        }
+
+        for (j = 0; j < ntables; j++) {
+            if (STREQ(tables[j].name, table)) {
+                tablebuf = &tables[j].rules;
+                break;
+            }
+        }
+
+        if (!tablebuf) {
+            tables[ntables].name = table;
+            tablebuf = &tables[ntables++].rules;
+        }
+
+        for (j = 0; j < rule->argsLen; j++) {
+            if (STREQ(rule->args[j], "-w"))
+                continue;
+
+            if (STREQ(rule->args[j], "--table") ||
+                STREQ(rule->args[j], "-t")) {
+                j++;
+                continue;
+            }
+
+            if (!first)
+                virBufferAddChar(tablebuf, ' ');
+            virFirewallRuleFormatRestoreArg(tablebuf, rule->args[j]);
+            first = false;
+        }
+        virBufferAddChar(tablebuf, '\n');
+    }
+
+    for (i = 0; i < ntables; i++) {
+        virBufferAsprintf(&buf, "*%s\n", tables[i].name);
+        virBufferAddBuffer(&buf, &tables[i].rules);
+        virBufferAddLit(&buf, "COMMIT\n");
+    }
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static int
+virFirewallApplyGroupBatch(virFirewallGroup *group)
+{
+    virFirewallLayer layer;
+
+    for (layer = VIR_FIREWALL_LAYER_IPV4; layer <= VIR_FIREWALL_LAYER_IPV6; layer++) {
+        g_autoptr(virCommand) cmd = NULL;
+        g_autofree char *input = virFirewallGroupFormatRestore(group, layer);
+        g_autofree char *error = NULL;
+        int status;
+
+        if (!input)
+            continue;
+
+        VIR_INFO("Applying rules via %s:\n%s",
+                 layer == VIR_FIREWALL_LAYER_IPV4 ? IPTABLES_RESTORE : IP6TABLES_RESTORE,
+                 input);
+
+        cmd = virCommandNewArgList(layer == VIR_FIREWALL_LAYER_IPV4 ?
+                                   IPTABLES_RESTORE : IP6TABLES_RESTORE,
+                                   "--noflush", "-w", NULL);
+        virCommandSetInputBuffer(cmd, input);
+        virCommandSetErrorBuffer(cmd, &error);
+
+        if (virCommandRun(cmd, &status) < 0)
+            return -1;
+
+        if (status != 0) {
+            g_autofree char *args = virCommandToString(cmd, false);
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to apply firewall rules %s: %s"),
+                           NULLSTR(args), NULLSTR(error));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 virFirewallApplyGroup(virFirewall *firewall,
                       size_t idx)
@@ -710,6 +938,10 @@ virFirewallApplyGroup(virFirewall *firewall,
              firewall, group, group->actionFlags);
     firewall->currentGroup = idx;
     group->addingRollback = false;
+
+    if (virFirewallGroupCanBatch(group))
+        return virFirewallApplyGroupBatch(group);
+
     for (i = 0; i < group->naction; i++) {
         if (virFirewallApplyRule(firewall,
                                  group->action[i],
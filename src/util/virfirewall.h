@@ -109,6 +109,10 @@ void virFirewallStartRollback(virFirewall *firewall,
 
 int virFirewallApply(virFirewall *firewall);
 
+char *virFirewallFormat(virFirewall *firewall);
+
 void virFirewallBackendSynchronize(void);
 
+void virFirewallEnableBatching(void);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFirewall, virFirewallFree);
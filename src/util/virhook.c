@@ -35,6 +35,7 @@
 #include "vircommand.h"
 #include "virstring.h"
 #include "virglibutil.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_HOOK
 
@@ -130,6 +131,24 @@ VIR_ENUM_IMPL(virHookBhyveOp,
 
 static int virHooksFound = -1;
 
+/* Hook calls queued by virHookCallAsync, run in order by a single
+ * worker thread. @virHookAsyncPending counts the queued calls plus the
+ * one being run. */
+typedef struct _virHookAsyncCall virHookAsyncCall;
+struct _virHookAsyncCall {
+    int driver;
+    char *id;
+    int op;
+    int sub_op;
+    char *extra;
+    char *input;
+};
+
+static virMutex virHookAsyncLock = VIR_MUTEX_INITIALIZER;
+static virCond virHookAsyncCond;
+static GQueue virHookAsyncQueue = G_QUEUE_INIT;
+static size_t virHookAsyncPending;
+
 /**
  * virHookCheck:
  * @driver: the driver name "daemon", "qemu", "lxc"...
@@ -300,39 +319,14 @@ virRunScript(const char *path,
     return ret;
 }
 
-/**
- * virHookCall:
- * @driver: the driver number (from virHookDriver enum)
- * @id: an id for the object '-' if non available for example on daemon hooks
- * @op: the operation on the id e.g. VIR_HOOK_QEMU_OP_START
- * @sub_op: a sub_operation, currently unused
- * @extra: optional string information
- * @input: extra input given to the script on stdin
- * @output: optional address of variable to store malloced result buffer
- *
- * Implement a hook call, where the external scripts for the driver are
- * called with the given information. This is a synchronous call, we wait for
- * execution completion. If @output is non-NULL, *output is guaranteed to be
- * allocated after successful virHookCall, and is best-effort allocated after
- * failed virHookCall; the caller is responsible for freeing *output.
- *
- * The script from LIBVIRT_HOOK_DIR is executed the first, followed by scripts
- * found under "$driver.d/" directory (sorted alphabetically. If output from
- * the hook script is expected, then the output produced by LIBVIRT_HOOK_DIR
- * script is fed as input to the first script from the "$driver.d/" directory
- * and its output is fed as input to the second and so on.
- *
- * Returns: 0 if the execution succeeded, 1 if the script was not found or
- *          invalid parameters, and -1 if script returned an error
- */
-int
-virHookCall(int driver,
-            const char *id,
-            int op,
-            int sub_op,
-            const char *extra,
-            const char *input,
-            char **output)
+static int
+virHookCallInternal(int driver,
+                    const char *id,
+                    int op,
+                    int sub_op,
+                    const char *extra,
+                    const char *input,
+                    char **output)
 {
     int ret, script_ret;
     g_autoptr(DIR) dir = NULL;
@@ -459,3 +453,165 @@ virHookCall(int driver,
 
     return script_ret;
 }
+
+
+/**
+ * virHookCall:
+ * @driver: the driver number (from virHookDriver enum)
+ * @id: an id for the object '-' if non available for example on daemon hooks
+ * @op: the operation on the id e.g. VIR_HOOK_QEMU_OP_START
+ * @sub_op: a sub_operation, currently unused
+ * @extra: optional string information
+ * @input: extra input given to the script on stdin
+ * @output: optional address of variable to store malloced result buffer
+ *
+ * Implement a hook call, where the external scripts for the driver are
+ * called with the given information. This is a synchronous call, we wait for
+ * execution completion. If @output is non-NULL, *output is guaranteed to be
+ * allocated after successful virHookCall, and is best-effort allocated after
+ * failed virHookCall; the caller is responsible for freeing *output.
+ *
+ * Any calls queued by virHookCallAsync are run before this one, so that the
+ * scripts always see the operations in the order they happened.
+ *
+ * The script from LIBVIRT_HOOK_DIR is executed the first, followed by scripts
+ * found under "$driver.d/" directory (sorted alphabetically. If output from
+ * the hook script is expected, then the output produced by LIBVIRT_HOOK_DIR
+ * script is fed as input to the first script from the "$driver.d/" directory
+ * and its output is fed as input to the second and so on.
+ *
+ * Returns: 0 if the execution succeeded, 1 if the script was not found or
+ *          invalid parameters, and -1 if script returned an error
+ */
+int
+virHookCall(int driver,
+            const char *id,
+            int op,
+            int sub_op,
+            const char *extra,
+            const char *input,
+            char **output)
+{
+    virMutexLock(&virHookAsyncLock);
+    while (virHookAsyncPending > 0) {
+        if (virCondWait(&virHookAsyncCond, &virHookAsyncLock) < 0)
+            break;
+    }
+    virMutexUnlock(&virHookAsyncLock);
+
+    return virHookCallInternal(driver, id, op, sub_op, extra, input, output);
+}
+
+
+static void
+virHookAsyncCallFree(virHookAsyncCall *call)
+{
+    g_free(call->id);
+    g_free(call->extra);
+    g_free(call->input);
+    g_free(call);
+}
+
+
+static void
+virHookAsyncWorker(void *opaque G_GNUC_UNUSED)
+{
+    virMutexLock(&virHookAsyncLock);
+
+    while (true) {
+        virHookAsyncCall *call;
+
+        while (!(call = g_queue_pop_head(&virHookAsyncQueue)))
+            ignore_value(virCondWait(&virHookAsyncCond, &virHookAsyncLock));
+
+        virMutexUnlock(&virHookAsyncLock);
+
+        if (virHookCallInternal(call->driver, call->id, call->op,
+                                call->sub_op, call->extra, call->input,
+                                NULL) < 0) {
+            VIR_WARN("Hook script for '%s' failed: %s",
+                     call->id, virGetLastErrorMessage());
+        }
+        virResetLastError();
+        virHookAsyncCallFree(call);
+
+        virMutexLock(&virHookAsyncLock);
+        virHookAsyncPending--;
+        virCondBroadcast(&virHookAsyncCond);
+    }
+}
+
+
+static int
+virHookAsyncOnceInit(void)
+{
+    virThread thread;
+
+    if (virCondInit(&virHookAsyncCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize condition variable"));
+        return -1;
+    }
+
+    if (virThreadCreateFull(&thread, false, virHookAsyncWorker,
+                            "hook-async", false, NULL) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create hook script thread"));
+        return -1;
+    }
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virHookAsync);
+
+
+/**
+ * virHookCallAsync:
+ * @driver: the driver number (from virHookDriver enum)
+ * @id: an id for the object '-' if non available for example on daemon hooks
+ * @op: the operation on the id e.g. VIR_HOOK_QEMU_OP_STOPPED
+ * @sub_op: a sub_operation, currently unused
+ * @extra: optional string information
+ * @input: extra input given to the script on stdin
+ *
+ * Same as virHookCall, except that the scripts are run in the background
+ * and the caller doesn't wait for them. Thus it may only be used for
+ * operations whose outcome doesn't depend on the scripts. Queued calls are
+ * run one at a time in the order they were made, a failing script is only
+ * logged. If the background thread can't be started, the scripts are run
+ * synchronously.
+ */
+void
+virHookCallAsync(int driver,
+                 const char *id,
+                 int op,
+                 int sub_op,
+                 const char *extra,
+                 const char *input)
+{
+    virHookAsyncCall *call;
+
+    if (!virHookPresent(driver))
+        return;
+
+    if (virHookAsyncInitialize() < 0) {
+        virResetLastError();
+        ignore_value(virHookCall(driver, id, op, sub_op, extra, input, NULL));
+        return;
+    }
+
+    call = g_new0(virHookAsyncCall, 1);
+    call->driver = driver;
+    call->id = g_strdup(id);
+    call->op = op;
+    call->sub_op = sub_op;
+    call->extra = g_strdup(extra);
+    call->input = g_strdup(input);
+
+    virMutexLock(&virHookAsyncLock);
+    g_queue_push_tail(&virHookAsyncQueue, call);
+    virHookAsyncPending++;
+    virCondBroadcast(&virHookAsyncCond);
+    virMutexUnlock(&virHookAsyncLock);
+}
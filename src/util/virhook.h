@@ -114,3 +114,6 @@ int virHookPresent(int driver);
 
 int virHookCall(int driver, const char *id, int op, int sub_op,
                 const char *extra, const char *input, char **output);
+
+void virHookCallAsync(int driver, const char *id, int op, int sub_op,
+                      const char *extra, const char *input);
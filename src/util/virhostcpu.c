@@ -49,6 +49,7 @@
 #include "virstring.h"
 #include "virnuma.h"
 #include "virlog.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -897,6 +898,28 @@ virHostCPUStatsAssign(virNodeCPUStatsPtr param,
 }
 
 
+#ifdef __linux__
+/* Gathering the host CPU summary walks sysfs for every CPU and reads
+ * /proc/cpuinfo, while the result only changes when CPUs go online or
+ * offline. It is therefore kept along with the online CPUs it was
+ * gathered for. */
+typedef struct _virHostCPUInfoCache virHostCPUInfoCache;
+struct _virHostCPUInfoCache {
+    char *online;
+    virArch hostarch;
+    unsigned int cpus;
+    unsigned int mhz;
+    unsigned int nodes;
+    unsigned int sockets;
+    unsigned int cores;
+    unsigned int threads;
+};
+
+static virMutex virHostCPUInfoLock = VIR_MUTEX_INITIALIZER;
+static virHostCPUInfoCache virHostCPUInfo;
+#endif /* __linux__ */
+
+
 int
 virHostCPUGetInfo(virArch hostarch G_GNUC_UNUSED,
                   unsigned int *cpus G_GNUC_UNUSED,
@@ -908,12 +931,32 @@ virHostCPUGetInfo(virArch hostarch G_GNUC_UNUSED,
 {
 #ifdef __linux__
     int ret = -1;
-    FILE *cpuinfo = fopen(CPUINFO_PATH, "r");
+    g_autofree char *online = NULL;
+    FILE *cpuinfo = NULL;
+
+    /* Without the list of online CPUs the summary is gathered every time */
+    if (virFileReadValueString(&online, "%s/cpu/online", SYSFS_SYSTEM_PATH) < 0)
+        virResetLastError();
+
+    virMutexLock(&virHostCPUInfoLock);
+
+    if (online &&
+        virHostCPUInfo.hostarch == hostarch &&
+        STREQ_NULLABLE(virHostCPUInfo.online, online)) {
+        *cpus = virHostCPUInfo.cpus;
+        *mhz = virHostCPUInfo.mhz;
+        *nodes = virHostCPUInfo.nodes;
+        *sockets = virHostCPUInfo.sockets;
+        *cores = virHostCPUInfo.cores;
+        *threads = virHostCPUInfo.threads;
+        ret = 0;
+        goto cleanup;
+    }
 
-    if (!cpuinfo) {
+    if (!(cpuinfo = fopen(CPUINFO_PATH, "r"))) {
         virReportSystemError(errno,
                              _("cannot open %s"), CPUINFO_PATH);
-        return -1;
+        goto cleanup;
     }
 
     ret = virHostCPUGetInfoPopulateLinux(cpuinfo, hostarch,
@@ -922,7 +965,18 @@ virHostCPUGetInfo(virArch hostarch G_GNUC_UNUSED,
     if (ret < 0)
         goto cleanup;
 
+    g_free(virHostCPUInfo.online);
+    virHostCPUInfo.online = g_steal_pointer(&online);
+    virHostCPUInfo.hostarch = hostarch;
+    virHostCPUInfo.cpus = *cpus;
+    virHostCPUInfo.mhz = *mhz;
+    virHostCPUInfo.nodes = *nodes;
+    virHostCPUInfo.sockets = *sockets;
+    virHostCPUInfo.cores = *cores;
+    virHostCPUInfo.threads = *threads;
+
  cleanup:
+    virMutexUnlock(&virHostCPUInfoLock);
     VIR_FORCE_FCLOSE(cpuinfo);
     return ret;
 #elif defined(__FreeBSD__) || defined(__APPLE__)
@@ -34,7 +34,6 @@
 #include "virbitmap.h"
 
 #if WITH_YAJL
-# include <yajl/yajl_gen.h>
 # include <yajl/yajl_parse.h>
 
 #endif
@@ -58,11 +57,13 @@ struct _virJSONObjectPair {
 
 struct _virJSONObject {
     size_t npairs;
+    size_t nalloc;
     virJSONObjectPair *pairs;
 };
 
 struct _virJSONArray {
     size_t nvalues;
+    size_t nalloc;
     virJSONValue **values;
 };
 
@@ -90,9 +91,17 @@ struct _virJSONParser {
     virJSONValue *head;
     virJSONParserState *state;
     size_t nstate;
+    size_t nstate_max;
     int wrap;
 };
 
+struct _virJSONStreamParser {
+#if WITH_YAJL
+    yajl_handle hand; /* allocated on first data of each value */
+#endif
+    virJSONParser parser;
+};
+
 
 virJSONType
 virJSONValueGetType(const virJSONValue *value)
@@ -555,13 +564,12 @@ virJSONValueNewObject(void)
 
 
 static int
-virJSONValueObjectInsert(virJSONValue *object,
-                         const char *key,
-                         virJSONValue **value,
-                         bool prepend)
+virJSONValueObjectInsertSteal(virJSONValue *object,
+                              char **key,
+                              virJSONValue **value,
+                              bool prepend)
 {
-    virJSONObjectPair pair = { NULL, *value };
-    int ret = -1;
+    virJSONObjectPair pair = { *key, *value };
 
     if (object->type != VIR_JSON_TYPE_OBJECT) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -569,27 +577,38 @@ virJSONValueObjectInsert(virJSONValue *object,
         return -1;
     }
 
-    if (virJSONValueObjectHasKey(object, key)) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, _("duplicate key '%s'"), key);
+    if (virJSONValueObjectHasKey(object, *key)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, _("duplicate key '%s'"), *key);
         return -1;
     }
 
-    pair.key = g_strdup(key);
+    VIR_RESIZE_N(object->data.object.pairs, object->data.object.nalloc,
+                 object->data.object.npairs, 1);
 
     if (prepend) {
-        ret = VIR_INSERT_ELEMENT(object->data.object.pairs, 0,
-                                 object->data.object.npairs, pair);
+        ignore_value(VIR_INSERT_ELEMENT_INPLACE(object->data.object.pairs, 0,
+                                                object->data.object.npairs,
+                                                pair));
     } else {
-        VIR_APPEND_ELEMENT(object->data.object.pairs,
-                           object->data.object.npairs, pair);
-        ret = 0;
+        VIR_APPEND_ELEMENT_INPLACE(object->data.object.pairs,
+                                   object->data.object.npairs, pair);
     }
 
-    if (ret == 0)
-        *value = NULL;
+    *key = NULL;
+    *value = NULL;
+    return 0;
+}
 
-    VIR_FREE(pair.key);
-    return ret;
+
+static int
+virJSONValueObjectInsert(virJSONValue *object,
+                         const char *key,
+                         virJSONValue **value,
+                         bool prepend)
+{
+    g_autofree char *keycopy = g_strdup(key);
+
+    return virJSONValueObjectInsertSteal(object, &keycopy, value, prepend);
 }
 
 
@@ -762,7 +781,8 @@ virJSONValueArrayAppend(virJSONValue *array,
         return -1;
     }
 
-    VIR_REALLOC_N(array->data.array.values, array->data.array.nvalues + 1);
+    VIR_RESIZE_N(array->data.array.values, array->data.array.nalloc,
+                 array->data.array.nvalues, 1);
 
     array->data.array.values[array->data.array.nvalues] = g_steal_pointer(value);
     array->data.array.nvalues++;
@@ -803,8 +823,8 @@ virJSONValueArrayConcat(virJSONValue *a,
         return -1;
     }
 
-    a->data.array.values = g_renew(virJSONValue *, a->data.array.values,
-                                   a->data.array.nvalues + c->data.array.nvalues);
+    VIR_RESIZE_N(a->data.array.values, a->data.array.nalloc,
+                 a->data.array.nvalues, c->data.array.nvalues);
 
     for (i = 0; i < c->data.array.nvalues; i++)
         a->data.array.values[a->data.array.nvalues++] = g_steal_pointer(&c->data.array.values[i]);
@@ -931,8 +951,8 @@ virJSONValueObjectRemoveKey(virJSONValue *object,
             }
             VIR_FREE(object->data.object.pairs[i].key);
             virJSONValueFree(object->data.object.pairs[i].value);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
+            VIR_DELETE_ELEMENT_INPLACE(object->data.object.pairs, i,
+                                       object->data.object.npairs);
             return 1;
         }
     }
@@ -1007,9 +1027,9 @@ virJSONValueArraySteal(virJSONValue *array,
 
     ret = array->data.array.values[element];
 
-    VIR_DELETE_ELEMENT(array->data.array.values,
-                       element,
-                       array->data.array.nvalues);
+    VIR_DELETE_ELEMENT_INPLACE(array->data.array.values,
+                               element,
+                               array->data.array.nvalues);
 
     return ret;
 }
@@ -1419,6 +1439,7 @@ virJSONValueCopy(const virJSONValue *in)
 
         out->data.object.pairs = g_new0(virJSONObjectPair, in->data.object.npairs);
         out->data.object.npairs = in->data.object.npairs;
+        out->data.object.nalloc = in->data.object.npairs;
 
         for (i = 0; i < in->data.object.npairs; i++) {
             out->data.object.pairs[i].key = g_strdup(in->data.object.pairs[i].key);
@@ -1430,6 +1451,7 @@ virJSONValueCopy(const virJSONValue *in)
 
         out->data.array.values = g_new0(virJSONValue *, in->data.array.nvalues);
         out->data.array.nvalues = in->data.array.nvalues;
+        out->data.array.nalloc = in->data.array.nvalues;
 
         for (i = 0; i < in->data.array.nvalues; i++) {
             out->data.array.values[i] = virJSONValueCopy(in->data.array.values[i]);
@@ -1478,12 +1500,9 @@ virJSONParserInsertValue(virJSONParser *parser,
                 return -1;
             }
 
-            if (virJSONValueObjectAppend(state->value,
-                                         state->key,
-                                         value) < 0)
+            if (virJSONValueObjectInsertSteal(state->value, &state->key,
+                                              value, false) < 0)
                 return -1;
-
-            VIR_FREE(state->key);
         }   break;
 
         case VIR_JSON_TYPE_ARRAY: {
@@ -1513,8 +1532,6 @@ virJSONParserHandleNull(void *ctx)
     virJSONParser *parser = ctx;
     g_autoptr(virJSONValue) value = virJSONValueNewNull();
 
-    VIR_DEBUG("parser=%p", parser);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
@@ -1529,8 +1546,6 @@ virJSONParserHandleBoolean(void *ctx,
     virJSONParser *parser = ctx;
     g_autoptr(virJSONValue) value = virJSONValueNewBoolean(boolean_);
 
-    VIR_DEBUG("parser=%p boolean=%d", parser, boolean_);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
@@ -1546,8 +1561,6 @@ virJSONParserHandleNumber(void *ctx,
     virJSONParser *parser = ctx;
     g_autoptr(virJSONValue) value = virJSONValueNewNumber(g_strndup(s, l));
 
-    VIR_DEBUG("parser=%p str=%s", parser, value->data.number);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
@@ -1564,8 +1577,6 @@ virJSONParserHandleString(void *ctx,
     g_autoptr(virJSONValue) value = virJSONValueNewStringLen((const char *)stringVal,
                                                              stringLen);
 
-    VIR_DEBUG("parser=%p str=%p", parser, (const char *)stringVal);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
@@ -1581,8 +1592,6 @@ virJSONParserHandleMapKey(void *ctx,
     virJSONParser *parser = ctx;
     virJSONParserState *state;
 
-    VIR_DEBUG("parser=%p key=%p", parser, (const char *)stringVal);
-
     if (!parser->nstate)
         return 0;
 
@@ -1601,12 +1610,10 @@ virJSONParserHandleStartMap(void *ctx)
     g_autoptr(virJSONValue) value = virJSONValueNewObject();
     virJSONValue *tmp = value;
 
-    VIR_DEBUG("parser=%p", parser);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
-    VIR_REALLOC_N(parser->state, parser->nstate + 1);
+    VIR_RESIZE_N(parser->state, parser->nstate_max, parser->nstate, 1);
 
     parser->state[parser->nstate].value = tmp;
     parser->state[parser->nstate].key = NULL;
@@ -1622,8 +1629,6 @@ virJSONParserHandleEndMap(void *ctx)
     virJSONParser *parser = ctx;
     virJSONParserState *state;
 
-    VIR_DEBUG("parser=%p", parser);
-
     if (!parser->nstate)
         return 0;
 
@@ -1633,7 +1638,7 @@ virJSONParserHandleEndMap(void *ctx)
         return 0;
     }
 
-    VIR_DELETE_ELEMENT(parser->state, parser->nstate - 1, parser->nstate);
+    parser->nstate--;
 
     return 1;
 }
@@ -1646,12 +1651,10 @@ virJSONParserHandleStartArray(void *ctx)
     g_autoptr(virJSONValue) value = virJSONValueNewArray();
     virJSONValue *tmp = value;
 
-    VIR_DEBUG("parser=%p", parser);
-
     if (virJSONParserInsertValue(parser, &value) < 0)
         return 0;
 
-    VIR_REALLOC_N(parser->state, parser->nstate + 1);
+    VIR_RESIZE_N(parser->state, parser->nstate_max, parser->nstate, 1);
 
     parser->state[parser->nstate].value = tmp;
     parser->state[parser->nstate].key = NULL;
@@ -1667,8 +1670,6 @@ virJSONParserHandleEndArray(void *ctx)
     virJSONParser *parser = ctx;
     virJSONParserState *state;
 
-    VIR_DEBUG("parser=%p", parser);
-
     if (!(parser->nstate - parser->wrap))
         return 0;
 
@@ -1678,7 +1679,7 @@ virJSONParserHandleEndArray(void *ctx)
         return 0;
     }
 
-    VIR_DELETE_ELEMENT(parser->state, parser->nstate - 1, parser->nstate);
+    parser->nstate--;
 
     return 1;
 }
@@ -1699,12 +1700,11 @@ static const yajl_callbacks parserCallbacks = {
 };
 
 
-/* XXX add an incremental streaming parser - yajl trivially supports it */
 virJSONValue *
 virJSONValueFromString(const char *jsonstring)
 {
     yajl_handle hand;
-    virJSONParser parser = { NULL, NULL, 0, 0 };
+    virJSONParser parser = { 0 };
     virJSONValue *ret = NULL;
     int rc;
     size_t len = strlen(jsonstring);
@@ -1750,8 +1750,8 @@ virJSONValueFromString(const char *jsonstring)
         size_t i;
         for (i = 0; i < parser.nstate; i++)
             VIR_FREE(parser.state[i].key);
-        VIR_FREE(parser.state);
     }
+    VIR_FREE(parser.state);
 
     VIR_DEBUG("result=%p", ret);
 
@@ -1759,64 +1759,362 @@ virJSONValueFromString(const char *jsonstring)
 }
 
 
+static void
+virJSONStreamParserReset(virJSONStreamParser *stream)
+{
+    size_t i;
+
+    if (stream->hand) {
+        yajl_free(stream->hand);
+        stream->hand = NULL;
+    }
+
+    for (i = 0; i < stream->parser.nstate; i++)
+        g_free(stream->parser.state[i].key);
+    g_clear_pointer(&stream->parser.state, g_free);
+    stream->parser.nstate = 0;
+    stream->parser.nstate_max = 0;
+
+    g_clear_pointer(&stream->parser.head, virJSONValueFree);
+}
+
+
+/**
+ * virJSONStreamParserFeed:
+ * @stream: stream parser
+ * @data: chunk of a JSON document
+ * @len: length of @data
+ *
+ * Parses the next @len bytes of the JSON document being assembled by
+ * @stream. The document may be split at any point, including in the
+ * middle of a token, the parser state is kept until
+ * virJSONStreamParserFinish is called. Thus every byte is looked at
+ * only once no matter in how many chunks the document arrives.
+ *
+ * Returns 0 on success, -1 on error (with libvirt error reported) in
+ * which case the partially parsed document is discarded.
+ */
+int
+virJSONStreamParserFeed(virJSONStreamParser *stream,
+                        const char *data,
+                        size_t len)
+{
+    if (len == 0)
+        return 0;
+
+    if (!stream->hand &&
+        !(stream->hand = yajl_alloc(&parserCallbacks, NULL, &stream->parser))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to create JSON parser"));
+        return -1;
+    }
+
+    if (yajl_parse(stream->hand, (const unsigned char *)data, len) != yajl_status_ok) {
+        unsigned char *errstr = yajl_get_error(stream->hand, 1,
+                                               (const unsigned char *)data,
+                                               len);
+
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse json: %s"), (const char *) errstr);
+        yajl_free_error(stream->hand, errstr);
+        virJSONStreamParserReset(stream);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virJSONStreamParserFinish:
+ * @stream: stream parser
+ *
+ * Completes parsing of the document fed to @stream so far. The parser
+ * is ready to accept the next document afterwards.
+ *
+ * Returns the parsed value or NULL on error (with libvirt error reported).
+ */
+virJSONValue *
+virJSONStreamParserFinish(virJSONStreamParser *stream)
+{
+    virJSONValue *ret = NULL;
+
+    if (!stream->hand) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot parse json: empty document"));
+        return NULL;
+    }
+
+    if (yajl_complete_parse(stream->hand) != yajl_status_ok) {
+        unsigned char *errstr = yajl_get_error(stream->hand, 0, NULL, 0);
+
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse json: %s"), (const char *) errstr);
+        yajl_free_error(stream->hand, errstr);
+    } else if (stream->parser.nstate != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot parse json: unterminated string/map/array"));
+    } else {
+        ret = g_steal_pointer(&stream->parser.head);
+    }
+
+    virJSONStreamParserReset(stream);
+
+    VIR_DEBUG("result=%p", ret);
+
+    return ret;
+}
+
+
+#else
+virJSONValue *
+virJSONValueFromString(const char *jsonstring G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
+
+
+static void
+virJSONStreamParserReset(virJSONStreamParser *stream G_GNUC_UNUSED)
+{
+}
+
+
+int
+virJSONStreamParserFeed(virJSONStreamParser *stream G_GNUC_UNUSED,
+                        const char *data G_GNUC_UNUSED,
+                        size_t len G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
+virJSONValue *
+virJSONStreamParserFinish(virJSONStreamParser *stream G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
+
+#endif
+
+
+/* Checks that @str is made of complete UTF-8 sequences, as yajl did */
+static bool
+virJSONStringIsValidUTF8(const unsigned char *str,
+                         size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        size_t follow;
+
+        if (str[i] < 0x80)
+            follow = 0;
+        else if ((str[i] >> 5) == 0x6)
+            follow = 1;
+        else if ((str[i] >> 4) == 0xE)
+            follow = 2;
+        else if ((str[i] >> 3) == 0x1E)
+            follow = 3;
+        else
+            return false;
+
+        i++;
+
+        for (; follow > 0; follow--, i++) {
+            if (i >= len || (str[i] >> 6) != 0x2)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
 static int
-virJSONValueToStringOne(virJSONValue *object,
-                        yajl_gen g)
+virJSONValueFormatString(virBuffer *buf,
+                         const char *str)
 {
+    static const char hexdigits[] = "0123456789ABCDEF";
+    const unsigned char *ustr = (const unsigned char *) str;
+    size_t len = strlen(str);
+    size_t start = 0;
     size_t i;
 
-    VIR_DEBUG("object=%p type=%d gen=%p", object, object->type, g);
+    if (!virJSONStringIsValidUTF8(ustr, len)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("failed to format JSON: invalid UTF-8 string"));
+        return -1;
+    }
+
+    virBufferAddChar(buf, '"');
+
+    /* copy runs of characters which need no escaping at once */
+    for (i = 0; i < len; i++) {
+        const char *escaped = NULL;
+        char hex[7];
+
+        switch (ustr[i]) {
+        case '\r':
+            escaped = "\\r";
+            break;
+        case '\n':
+            escaped = "\\n";
+            break;
+        case '\\':
+            escaped = "\\\\";
+            break;
+        case '"':
+            escaped = "\\\"";
+            break;
+        case '\f':
+            escaped = "\\f";
+            break;
+        case '\b':
+            escaped = "\\b";
+            break;
+        case '\t':
+            escaped = "\\t";
+            break;
+        default:
+            if (ustr[i] < 0x20) {
+                hex[0] = '\\';
+                hex[1] = 'u';
+                hex[2] = '0';
+                hex[3] = '0';
+                hex[4] = hexdigits[ustr[i] >> 4];
+                hex[5] = hexdigits[ustr[i] & 0xF];
+                hex[6] = '\0';
+                escaped = hex;
+            }
+            break;
+        }
+
+        if (!escaped)
+            continue;
+
+        virBufferAdd(buf, str + start, i - start);
+        virBufferAdd(buf, escaped, -1);
+        start = i + 1;
+    }
+
+    virBufferAdd(buf, str + start, len - start);
+    virBufferAddChar(buf, '"');
+
+    return 0;
+}
+
+
+static void
+virJSONValueFormatIndent(virBuffer *buf,
+                         size_t depth)
+{
+    for (; depth > 0; depth--)
+        virBufferAddLit(buf, "  ");
+}
+
+
+/* The output is identical to what yajl_gen produced, including the
+ * blank line yajl puts into empty objects and arrays when beautifying */
+static int
+virJSONValueFormatOne(virJSONValue *object,
+                      virBuffer *buf,
+                      bool pretty,
+                      size_t depth)
+{
+    size_t i;
 
-    switch (object->type) {
+    switch ((virJSONType) object->type) {
     case VIR_JSON_TYPE_OBJECT:
-        if (yajl_gen_map_open(g) != yajl_gen_status_ok)
-            return -1;
+        virBufferAddChar(buf, '{');
+        if (pretty)
+            virBufferAddChar(buf, '\n');
+
         for (i = 0; i < object->data.object.npairs; i++) {
-            if (yajl_gen_string(g,
-                                (unsigned char *)object->data.object.pairs[i].key,
-                                strlen(object->data.object.pairs[i].key))
-                != yajl_gen_status_ok)
+            if (i > 0) {
+                virBufferAddChar(buf, ',');
+                if (pretty)
+                    virBufferAddChar(buf, '\n');
+            }
+
+            if (pretty)
+                virJSONValueFormatIndent(buf, depth + 1);
+
+            if (virJSONValueFormatString(buf, object->data.object.pairs[i].key) < 0)
                 return -1;
-            if (virJSONValueToStringOne(object->data.object.pairs[i].value, g) < 0)
+
+            if (pretty)
+                virBufferAddLit(buf, ": ");
+            else
+                virBufferAddChar(buf, ':');
+
+            if (virJSONValueFormatOne(object->data.object.pairs[i].value,
+                                      buf, pretty, depth + 1) < 0)
                 return -1;
         }
-        if (yajl_gen_map_close(g) != yajl_gen_status_ok)
-            return -1;
+
+        if (pretty) {
+            virBufferAddChar(buf, '\n');
+            virJSONValueFormatIndent(buf, depth);
+        }
+        virBufferAddChar(buf, '}');
         break;
+
     case VIR_JSON_TYPE_ARRAY:
-        if (yajl_gen_array_open(g) != yajl_gen_status_ok)
-            return -1;
+        virBufferAddChar(buf, '[');
+        if (pretty)
+            virBufferAddChar(buf, '\n');
+
         for (i = 0; i < object->data.array.nvalues; i++) {
-            if (virJSONValueToStringOne(object->data.array.values[i], g) < 0)
+            if (i > 0) {
+                virBufferAddChar(buf, ',');
+                if (pretty)
+                    virBufferAddChar(buf, '\n');
+            }
+
+            if (pretty)
+                virJSONValueFormatIndent(buf, depth + 1);
+
+            if (virJSONValueFormatOne(object->data.array.values[i],
+                                      buf, pretty, depth + 1) < 0)
                 return -1;
         }
-        if (yajl_gen_array_close(g) != yajl_gen_status_ok)
-            return -1;
+
+        if (pretty) {
+            virBufferAddChar(buf, '\n');
+            virJSONValueFormatIndent(buf, depth);
+        }
+        virBufferAddChar(buf, ']');
         break;
 
     case VIR_JSON_TYPE_STRING:
-        if (yajl_gen_string(g, (unsigned char *)object->data.string,
-                            strlen(object->data.string)) != yajl_gen_status_ok)
+        if (virJSONValueFormatString(buf, object->data.string) < 0)
             return -1;
         break;
 
     case VIR_JSON_TYPE_NUMBER:
-        if (yajl_gen_number(g, object->data.number,
-                            strlen(object->data.number)) != yajl_gen_status_ok)
-            return -1;
+        virBufferAdd(buf, object->data.number, -1);
         break;
 
     case VIR_JSON_TYPE_BOOLEAN:
-        if (yajl_gen_bool(g, object->data.boolean) != yajl_gen_status_ok)
-            return -1;
+        if (object->data.boolean)
+            virBufferAddLit(buf, "true");
+        else
+            virBufferAddLit(buf, "false");
         break;
 
     case VIR_JSON_TYPE_NULL:
-        if (yajl_gen_null(g) != yajl_gen_status_ok)
-            return -1;
+        virBufferAddLit(buf, "null");
         break;
 
     default:
+        virReportEnumRangeError(virJSONType, object->type);
         return -1;
     }
 
@@ -1824,72 +2122,39 @@ virJSONValueToStringOne(virJSONValue *object,
 }
 
 
+/**
+ * virJSONValueToBuffer:
+ * @object: JSON value to format
+ * @buf: buffer to append the formatted value to
+ * @pretty: use the pretty formatter
+ *
+ * Formats @object straight into @buf. The auto-indentation of @buf is
+ * not applied to the formatted value.
+ *
+ * Returns 0 on success, -1 on error (with libvirt error reported) in
+ * which case @buf may contain a part of the formatted value.
+ */
 int
 virJSONValueToBuffer(virJSONValue *object,
                      virBuffer *buf,
                      bool pretty)
 {
-    yajl_gen g;
-    const unsigned char *str;
-    size_t len;
-    int ret = -1;
+    size_t indent = virBufferGetIndent(buf);
+    int ret;
 
     VIR_DEBUG("object=%p", object);
 
-    g = yajl_gen_alloc(NULL);
-    if (!g) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to create JSON formatter"));
-        goto cleanup;
-    }
-    yajl_gen_config(g, yajl_gen_beautify, pretty ? 1 : 0);
-    yajl_gen_config(g, yajl_gen_indent_string, pretty ? "  " : " ");
-    yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+    virBufferSetIndent(buf, 0);
 
-    if (virJSONValueToStringOne(object, g) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("failed to convert virJSONValue to yajl data"));
-        goto cleanup;
-    }
+    if ((ret = virJSONValueFormatOne(object, buf, pretty, 0)) == 0 && pretty)
+        virBufferAddChar(buf, '\n');
 
-    if (yajl_gen_get_buf(g, &str, &len) != yajl_gen_status_ok) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                      _("failed to format JSON"));
-        goto cleanup;
-    }
-
-    virBufferAdd(buf, (const char *) str, len);
-    ret = 0;
-
- cleanup:
-    yajl_gen_free(g);
+    virBufferSetIndent(buf, indent);
 
     return ret;
 }
 
 
-#else
-virJSONValue *
-virJSONValueFromString(const char *jsonstring G_GNUC_UNUSED)
-{
-    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                   _("No JSON parser implementation is available"));
-    return NULL;
-}
-
-
-int
-virJSONValueToBuffer(virJSONValue *object G_GNUC_UNUSED,
-                     virBuffer *buf G_GNUC_UNUSED,
-                     bool pretty G_GNUC_UNUSED)
-{
-    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                   _("No JSON parser implementation is available"));
-    return -1;
-}
-#endif
-
-
 char *
 virJSONValueToString(virJSONValue *object,
                      bool pretty)
@@ -1903,6 +2168,30 @@ virJSONValueToString(virJSONValue *object,
 }
 
 
+/**
+ * virJSONStreamParserNew:
+ *
+ * Creates a parser for JSON documents arriving in chunks, see
+ * virJSONStreamParserFeed and virJSONStreamParserFinish.
+ */
+virJSONStreamParser *
+virJSONStreamParserNew(void)
+{
+    return g_new0(virJSONStreamParser, 1);
+}
+
+
+void
+virJSONStreamParserFree(virJSONStreamParser *stream)
+{
+    if (!stream)
+        return;
+
+    virJSONStreamParserReset(stream);
+    g_free(stream);
+}
+
+
 /**
  * virJSONStringReformat:
  * @jsonstr: string to reformat
@@ -2056,6 +2345,7 @@ virJSONValueObjectDeflattenArrays(virJSONValue *json)
     i = obj->npairs;
     json->type = VIR_JSON_TYPE_ARRAY;
     json->data.array.nvalues = i;
+    json->data.array.nalloc = i;
     json->data.array.values = g_steal_pointer(&arraymembers);
 }
 
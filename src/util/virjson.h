@@ -140,6 +140,18 @@ int virJSONValueObjectRemoveKey(virJSONValue *object, const char *key,
 int virJSONValueArrayAppendString(virJSONValue *object, const char *value);
 
 virJSONValue *virJSONValueFromString(const char *jsonstring);
+
+typedef struct _virJSONStreamParser virJSONStreamParser;
+
+virJSONStreamParser *virJSONStreamParserNew(void);
+void virJSONStreamParserFree(virJSONStreamParser *stream);
+int virJSONStreamParserFeed(virJSONStreamParser *stream,
+                            const char *data,
+                            size_t len)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+virJSONValue *virJSONStreamParserFinish(virJSONStreamParser *stream)
+    ATTRIBUTE_NONNULL(1);
+
 char *virJSONValueToString(virJSONValue *object,
                            bool pretty);
 int virJSONValueToBuffer(virJSONValue *object,
@@ -162,3 +174,4 @@ char *virJSONStringReformat(const char *jsonstr, bool pretty);
 virJSONValue *virJSONValueObjectDeflatten(virJSONValue *json);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONValue, virJSONValueFree);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONStreamParser, virJSONStreamParserFree);
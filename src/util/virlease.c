@@ -23,6 +23,7 @@
 #include <config.h>
 
 #include "virlease.h"
+#include "virleaseindex.h"
 
 #include <time.h>
 
@@ -200,6 +201,136 @@ virLeasePrintLeases(virJSONValue *leases_array_new,
 }
 
 
+char *
+virLeaseIndexFileName(const char *dnsmasqStateDir,
+                      const char *bridge)
+{
+    return g_strdup_printf("%s/%s" VIR_LEASE_INDEX_SUFFIX, dnsmasqStateDir, bridge);
+}
+
+
+typedef struct _virLeaseIndexItem virLeaseIndexItem;
+struct _virLeaseIndexItem {
+    const char *hostname;
+    const char *ipaddr;
+    long long expirytime;
+};
+
+
+static int
+virLeaseIndexItemCompare(const void *a,
+                         const void *b)
+{
+    const virLeaseIndexItem *ia = a;
+    const virLeaseIndexItem *ib = b;
+
+    return strcmp(ia->hostname, ib->hostname);
+}
+
+
+typedef struct _virLeaseIndexData virLeaseIndexData;
+struct _virLeaseIndexData {
+    const char *data;
+    size_t len;
+};
+
+
+static int
+virLeaseWriteIndexFunc(int fd,
+                       const void *opaque)
+{
+    const virLeaseIndexData *data = opaque;
+
+    if (safewrite(fd, data->data, data->len) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * virLeaseWriteIndex:
+ * @leases_array: array of leases as stored in the custom lease file
+ * @index_file: path to the index file
+ *
+ * Atomically replace @index_file with an index of all leases from
+ * @leases_array which have a hostname. See virleaseindex.h for the
+ * format of the file.
+ *
+ * Returns 0 on success, -1 otherwise (with error reported).
+ */
+int
+virLeaseWriteIndex(virJSONValue *leases_array,
+                   const char *index_file)
+{
+    size_t nleases = virJSONValueArraySize(leases_array);
+    g_autofree virLeaseIndexItem *items = g_new0(virLeaseIndexItem, nleases);
+    size_t nitems = 0;
+    g_autofree char *buf = NULL;
+    virLeaseIndexHeader *header;
+    virLeaseIndexEntry *entries;
+    virLeaseIndexData data;
+    char *strtab;
+    size_t strsize = 0;
+    size_t off = 0;
+    size_t i;
+
+    for (i = 0; i < nleases; i++) {
+        virJSONValue *lease = virJSONValueArrayGet(leases_array, i);
+        virLeaseIndexItem *item = &items[nitems];
+
+        /* Mirror what the NSS plugin accepts from the lease file */
+        if (!(item->hostname = virJSONValueObjectGetString(lease, "hostname")) ||
+            !(item->ipaddr = virJSONValueObjectGetString(lease, "ip-address")) ||
+            !virJSONValueObjectGetString(lease, "mac-address"))
+            continue;
+
+        if (virJSONValueObjectGetNumberLong(lease, "expiry-time",
+                                            &item->expirytime) < 0)
+            item->expirytime = 0;
+
+        strsize += strlen(item->hostname) + 1 + strlen(item->ipaddr) + 1;
+        nitems++;
+    }
+
+    if (strsize > UINT32_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("too many leases to index"));
+        return -1;
+    }
+
+    qsort(items, nitems, sizeof(*items), virLeaseIndexItemCompare);
+
+    data.len = sizeof(*header) + nitems * sizeof(*entries) + strsize;
+    buf = g_new0(char, data.len);
+    header = (virLeaseIndexHeader *) buf;
+    entries = (virLeaseIndexEntry *) (buf + sizeof(*header));
+    strtab = buf + sizeof(*header) + nitems * sizeof(*entries);
+
+    memcpy(header->magic, VIR_LEASE_INDEX_MAGIC, VIR_LEASE_INDEX_MAGIC_LEN);
+    header->nentries = nitems;
+
+    for (i = 0; i < nitems; i++) {
+        size_t hostlen = strlen(items[i].hostname) + 1;
+        size_t iplen = strlen(items[i].ipaddr) + 1;
+
+        entries[i].expirytime = items[i].expirytime;
+
+        entries[i].hostname = off;
+        memcpy(strtab + off, items[i].hostname, hostlen);
+        off += hostlen;
+
+        entries[i].ipaddr = off;
+        memcpy(strtab + off, items[i].ipaddr, iplen);
+        off += iplen;
+    }
+
+    data.data = buf;
+
+    return virFileRewrite(index_file, 0644, virLeaseWriteIndexFunc, &data);
+}
+
+
 int
 virLeaseNew(virJSONValue **lease_ret,
             const char *mac,
@@ -33,6 +33,13 @@ int virLeasePrintLeases(virJSONValue *leases_array_new,
                         const char *server_duid);
 
 
+char *virLeaseIndexFileName(const char *dnsmasqStateDir,
+                            const char *bridge);
+
+int virLeaseWriteIndex(virJSONValue *leases_array,
+                       const char *index_file);
+
+
 int virLeaseNew(virJSONValue **lease_ret,
                 const char *mac,
                 const char *clientid,
@@ -0,0 +1,57 @@
+/*
+ * virleaseindex.h: DHCP lease index file format
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Next to each BRIDGE.status custom lease file the leases helper
+ * maintains BRIDGE.index, which indexes the leases by hostname so
+ * that the NSS plugin can look a name up without parsing JSON.
+ *
+ * The file consists of:
+ *
+ *   virLeaseIndexHeader
+ *   virLeaseIndexEntry[nentries], sorted by hostname (in strcmp order)
+ *   string table of NUL terminated strings
+ *
+ * String offsets are relative to the beginning of the string table.
+ * All integers are stored in host byte order as the file is only ever
+ * read on the host which wrote it. This header is shared with the NSS
+ * plugin and thus must not depend on anything but libc.
+ */
+
+#define VIR_LEASE_INDEX_MAGIC "LVLIDX01"
+#define VIR_LEASE_INDEX_MAGIC_LEN 8
+#define VIR_LEASE_INDEX_SUFFIX ".index"
+
+typedef struct _virLeaseIndexHeader virLeaseIndexHeader;
+struct _virLeaseIndexHeader {
+    char magic[VIR_LEASE_INDEX_MAGIC_LEN];
+    uint32_t nentries;
+    uint32_t padding;
+};
+
+typedef struct _virLeaseIndexEntry virLeaseIndexEntry;
+struct _virLeaseIndexEntry {
+    int64_t expirytime; /* 0 if the lease never expires */
+    uint32_t hostname;  /* offset of the hostname in the string table */
+    uint32_t ipaddr;    /* offset of the IP address in the string table */
+};
@@ -41,6 +41,11 @@ VIR_LOG_INIT("util.lockspace");
 
 #define VIR_LOCKSPACE_TABLE_SIZE 10
 
+/* Resources are spread over a number of independently locked shards by
+ * the hash of their name, so that acquiring and releasing unrelated
+ * resources does not contend on a single lockspace wide mutex. */
+#define VIR_LOCKSPACE_SHARDS 16
+
 typedef struct _virLockSpaceResource virLockSpaceResource;
 struct _virLockSpaceResource {
     char *name;
@@ -52,14 +57,27 @@ struct _virLockSpaceResource {
     pid_t *owners;
 };
 
+typedef struct _virLockSpaceShard virLockSpaceShard;
+struct _virLockSpaceShard {
+    virMutex lock;
+    GHashTable *resources;
+};
+
 struct _virLockSpace {
     char *dir;
-    virMutex lock;
 
-    GHashTable *resources;
+    virLockSpaceShard shards[VIR_LOCKSPACE_SHARDS];
 };
 
 
+static virLockSpaceShard *
+virLockSpaceGetShard(virLockSpace *lockspace,
+                     const char *resname)
+{
+    return &lockspace->shards[g_str_hash(resname) % VIR_LOCKSPACE_SHARDS];
+}
+
+
 static char *virLockSpaceGetResourcePath(virLockSpace *lockspace,
                                          const char *resname)
 {
@@ -230,25 +248,42 @@ static void virLockSpaceResourceDataFree(void *opaque)
 }
 
 
+static virLockSpace *
+virLockSpaceAlloc(void)
+{
+    virLockSpace *lockspace = g_new0(virLockSpace, 1);
+    size_t i;
+
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        if (virMutexInit(&lockspace->shards[i].lock) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to initialize lockspace mutex"));
+            while (i-- > 0) {
+                virMutexDestroy(&lockspace->shards[i].lock);
+                virHashFree(lockspace->shards[i].resources);
+            }
+            VIR_FREE(lockspace);
+            return NULL;
+        }
+
+        lockspace->shards[i].resources = virHashNew(virLockSpaceResourceDataFree);
+    }
+
+    return lockspace;
+}
+
+
 virLockSpace *virLockSpaceNew(const char *directory)
 {
     virLockSpace *lockspace;
 
     VIR_DEBUG("directory=%s", NULLSTR(directory));
 
-    lockspace = g_new0(virLockSpace, 1);
-
-    if (virMutexInit(&lockspace->lock) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to initialize lockspace mutex"));
-        VIR_FREE(lockspace);
+    if (!(lockspace = virLockSpaceAlloc()))
         return NULL;
-    }
 
     lockspace->dir = g_strdup(directory);
 
-    lockspace->resources = virHashNew(virLockSpaceResourceDataFree);
-
     if (directory) {
         if (virFileExists(directory)) {
             if (!virFileIsDir(directory)) {
@@ -284,16 +319,8 @@ virLockSpace *virLockSpaceNewPostExecRestart(virJSONValue *object)
 
     VIR_DEBUG("object=%p", object);
 
-    lockspace = g_new0(virLockSpace, 1);
-
-    if (virMutexInit(&lockspace->lock) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to initialize lockspace mutex"));
-        VIR_FREE(lockspace);
+    if (!(lockspace = virLockSpaceAlloc()))
         return NULL;
-    }
-
-    lockspace->resources = virHashNew(virLockSpaceResourceDataFree);
 
     if (virJSONValueObjectHasKey(object, "directory")) {
         const char *dir = virJSONValueObjectGetString(object, "directory");
@@ -394,7 +421,8 @@ virLockSpace *virLockSpaceNewPostExecRestart(virJSONValue *object)
             res->owners[j] = (pid_t)owner;
         }
 
-        if (virHashAddEntry(lockspace->resources, res->name, res) < 0) {
+        if (virHashAddEntry(virLockSpaceGetShard(lockspace, res->name)->resources,
+                            res->name, res) < 0) {
             virLockSpaceResourceFree(res);
             goto error;
         }
@@ -408,21 +436,14 @@ virLockSpace *virLockSpaceNewPostExecRestart(virJSONValue *object)
 }
 
 
-virJSONValue *virLockSpacePreExecRestart(virLockSpace *lockspace)
+static int
+virLockSpaceShardPreExecRestart(virLockSpaceShard *shard,
+                                virJSONValue *resources)
 {
-    g_autoptr(virJSONValue) object = virJSONValueNewObject();
-    g_autoptr(virJSONValue) resources = virJSONValueNewArray();
     g_autofree virHashKeyValuePair *pairs = NULL;
     virHashKeyValuePair *tmp;
 
-    virMutexLock(&lockspace->lock);
-
-    if (lockspace->dir &&
-        virJSONValueObjectAppendString(object, "directory", lockspace->dir) < 0)
-        goto error;
-
-
-    tmp = pairs = virHashGetItems(lockspace->resources, NULL, false);
+    tmp = pairs = virHashGetItems(shard->resources, NULL, false);
     while (tmp && tmp->value) {
         virLockSpaceResource *res = (virLockSpaceResource *)tmp->value;
         g_autoptr(virJSONValue) child = virJSONValueNewObject();
@@ -434,52 +455,80 @@ virJSONValue *virLockSpacePreExecRestart(virLockSpace *lockspace)
             virJSONValueObjectAppendNumberInt(child, "fd", res->fd) < 0 ||
             virJSONValueObjectAppendBoolean(child, "lockHeld", res->lockHeld) < 0 ||
             virJSONValueObjectAppendNumberUint(child, "flags", res->flags) < 0)
-            goto error;
+            return -1;
 
         if (virSetInherit(res->fd, true) < 0) {
             virReportSystemError(errno, "%s",
                                  _("Cannot disable close-on-exec flag"));
-            goto error;
+            return -1;
         }
 
         for (i = 0; i < res->nOwners; i++) {
             g_autoptr(virJSONValue) owner = virJSONValueNewNumberUlong(res->owners[i]);
             if (!owner)
-                goto error;
+                return -1;
 
             if (virJSONValueArrayAppend(owners, &owner) < 0)
-                goto error;
+                return -1;
         }
 
         if (virJSONValueObjectAppend(child, "owners", &owners) < 0)
-            goto error;
+            return -1;
 
         if (virJSONValueArrayAppend(resources, &child) < 0)
-            goto error;
+            return -1;
 
         tmp++;
     }
 
+    return 0;
+}
+
+
+virJSONValue *virLockSpacePreExecRestart(virLockSpace *lockspace)
+{
+    g_autoptr(virJSONValue) object = virJSONValueNewObject();
+    g_autoptr(virJSONValue) resources = virJSONValueNewArray();
+    size_t i;
+
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++)
+        virMutexLock(&lockspace->shards[i].lock);
+
+    if (lockspace->dir &&
+        virJSONValueObjectAppendString(object, "directory", lockspace->dir) < 0)
+        goto error;
+
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        if (virLockSpaceShardPreExecRestart(&lockspace->shards[i], resources) < 0)
+            goto error;
+    }
+
     if (virJSONValueObjectAppend(object, "resources", &resources) < 0)
         goto error;
 
-    virMutexUnlock(&lockspace->lock);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++)
+        virMutexUnlock(&lockspace->shards[i].lock);
     return g_steal_pointer(&object);
 
  error:
-    virMutexUnlock(&lockspace->lock);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++)
+        virMutexUnlock(&lockspace->shards[i].lock);
     return NULL;
 }
 
 
 void virLockSpaceFree(virLockSpace *lockspace)
 {
+    size_t i;
+
     if (!lockspace)
         return;
 
-    virHashFree(lockspace->resources);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        virHashFree(lockspace->shards[i].resources);
+        virMutexDestroy(&lockspace->shards[i].lock);
+    }
     g_free(lockspace->dir);
-    virMutexDestroy(&lockspace->lock);
     g_free(lockspace);
 }
 
@@ -493,14 +542,15 @@ const char *virLockSpaceGetDirectory(virLockSpace *lockspace)
 int virLockSpaceCreateResource(virLockSpace *lockspace,
                                const char *resname)
 {
+    virLockSpaceShard *shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     g_autofree char *respath = NULL;
 
     VIR_DEBUG("lockspace=%p resname=%s", lockspace, resname);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (virHashLookup(lockspace->resources, resname) != NULL) {
+    if (virHashLookup(shard->resources, resname) != NULL) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is locked"),
                        resname);
@@ -516,7 +566,7 @@ int virLockSpaceCreateResource(virLockSpace *lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -524,14 +574,15 @@ int virLockSpaceCreateResource(virLockSpace *lockspace,
 int virLockSpaceDeleteResource(virLockSpace *lockspace,
                                const char *resname)
 {
+    virLockSpaceShard *shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     g_autofree char *respath = NULL;
 
     VIR_DEBUG("lockspace=%p resname=%s", lockspace, resname);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (virHashLookup(lockspace->resources, resname) != NULL) {
+    if (virHashLookup(shard->resources, resname) != NULL) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is locked"),
                        resname);
@@ -552,7 +603,7 @@ int virLockSpaceDeleteResource(virLockSpace *lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -562,6 +613,7 @@ int virLockSpaceAcquireResource(virLockSpace *lockspace,
                                 pid_t owner,
                                 unsigned int flags)
 {
+    virLockSpaceShard *shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     virLockSpaceResource *res;
 
@@ -571,9 +623,9 @@ int virLockSpaceAcquireResource(virLockSpace *lockspace,
     virCheckFlags(VIR_LOCK_SPACE_ACQUIRE_SHARED |
                   VIR_LOCK_SPACE_ACQUIRE_AUTOCREATE, -1);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if ((res = virHashLookup(lockspace->resources, resname))) {
+    if ((res = virHashLookup(shard->resources, resname))) {
         if ((res->flags & VIR_LOCK_SPACE_ACQUIRE_SHARED) &&
             (flags & VIR_LOCK_SPACE_ACQUIRE_SHARED)) {
 
@@ -591,7 +643,7 @@ int virLockSpaceAcquireResource(virLockSpace *lockspace,
     if (!(res = virLockSpaceResourceNew(lockspace, resname, flags, owner)))
         goto cleanup;
 
-    if (virHashAddEntry(lockspace->resources, resname, res) < 0) {
+    if (virHashAddEntry(shard->resources, resname, res) < 0) {
         virLockSpaceResourceFree(res);
         goto cleanup;
     }
@@ -600,7 +652,7 @@ int virLockSpaceAcquireResource(virLockSpace *lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -609,6 +661,7 @@ int virLockSpaceReleaseResource(virLockSpace *lockspace,
                                 const char *resname,
                                 pid_t owner)
 {
+    virLockSpaceShard *shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     virLockSpaceResource *res;
     size_t i;
@@ -616,9 +669,9 @@ int virLockSpaceReleaseResource(virLockSpace *lockspace,
     VIR_DEBUG("lockspace=%p resname=%s owner=%lld",
               lockspace, resname, (unsigned long long)owner);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (!(res = virHashLookup(lockspace->resources, resname))) {
+    if (!(res = virHashLookup(shard->resources, resname))) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is not locked"),
                        resname);
@@ -640,13 +693,13 @@ int virLockSpaceReleaseResource(virLockSpace *lockspace,
     VIR_DELETE_ELEMENT(res->owners, i, res->nOwners);
 
     if ((res->nOwners == 0) &&
-        virHashRemoveEntry(lockspace->resources, resname) < 0)
+        virHashRemoveEntry(shard->resources, resname) < 0)
         goto cleanup;
 
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -693,26 +746,26 @@ virLockSpaceRemoveResourcesForOwner(const void *payload,
 int virLockSpaceReleaseResourcesForOwner(virLockSpace *lockspace,
                                          pid_t owner)
 {
-    int ret = 0;
+    int rc;
     struct virLockSpaceRemoveData data = {
         owner, 0
     };
+    size_t i;
 
     VIR_DEBUG("lockspace=%p owner=%lld", lockspace, (unsigned long long)owner);
 
-    virMutexLock(&lockspace->lock);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        virLockSpaceShard *shard = &lockspace->shards[i];
 
-    if (virHashRemoveSet(lockspace->resources,
-                         virLockSpaceRemoveResourcesForOwner,
-                         &data) < 0)
-        goto error;
+        virMutexLock(&shard->lock);
+        rc = virHashRemoveSet(shard->resources,
+                              virLockSpaceRemoveResourcesForOwner,
+                              &data);
+        virMutexUnlock(&shard->lock);
 
-    ret = data.count;
-
-    virMutexUnlock(&lockspace->lock);
-    return ret;
+        if (rc < 0)
+            return -1;
+    }
 
- error:
-    virMutexUnlock(&lockspace->lock);
-    return -1;
+    return data.count;
 }
@@ -69,7 +69,7 @@ static GRegex *virLogRegex;
 VIR_ENUM_DECL(virLogDestination);
 VIR_ENUM_IMPL(virLogDestination,
               VIR_LOG_TO_OUTPUT_LAST,
-              "stderr", "syslog", "file", "journald",
+              "stderr", "syslog", "file", "journald", "ring",
 );
 
 /*
@@ -511,12 +511,6 @@ virLogVMessage(virLogSource *source,
     size_t i;
     int saved_errno = errno;
 
-    if (virLogInitialize() < 0)
-        return;
-
-    if (fmt == NULL)
-        return;
-
     /*
      * 3 intentionally non-thread safe variable reads.
      * Since writes to the variable are serialized on
@@ -524,12 +518,23 @@ virLogVMessage(virLogSource *source,
      * is accidentally dropped or emitted, if another
      * thread is updating log filter list concurrently
      * with a log message emission.
+     *
+     * A source whose serial is current has already been
+     * through virLogSourceUpdate, which implies the logger
+     * is initialized, so messages of a disabled category
+     * are dropped here without any further work.
      */
-    if (source->serial < virLogFiltersSerial)
+    if (source->serial < virLogFiltersSerial) {
+        if (virLogInitialize() < 0)
+            goto cleanup;
         virLogSourceUpdate(source);
+    }
     if (priority < source->priority)
         goto cleanup;
 
+    if (fmt == NULL)
+        goto cleanup;
+
     /*
      * serialize the error message, add level and timestamp
      */
@@ -680,6 +685,182 @@ virLogNewOutputToStderr(virLogPriority priority)
 }
 
 
+/*
+ * The ring output keeps the most recent VIR_LOG_RING_SIZE bytes of
+ * formatted messages in memory. It is only written out to its file when
+ * virLogDumpRings() is called, which makes it cheap enough to be left
+ * enabled at debug level as a flight recorder for post-mortem analysis.
+ * All accesses are serialized by virLogLock.
+ */
+#define VIR_LOG_RING_SIZE (1024 * 1024)
+
+typedef struct _virLogRing virLogRing;
+struct _virLogRing {
+    char *buf;
+    size_t head;
+    bool wrapped;
+};
+
+
+static void
+virLogRingAppend(virLogRing *ring,
+                 const char *str)
+{
+    size_t len = strlen(str);
+
+    /* Only the tail of an oversized message fits */
+    if (len > VIR_LOG_RING_SIZE) {
+        str += len - VIR_LOG_RING_SIZE;
+        len = VIR_LOG_RING_SIZE;
+    }
+
+    while (len > 0) {
+        size_t chunk = MIN(len, VIR_LOG_RING_SIZE - ring->head);
+
+        memcpy(ring->buf + ring->head, str, chunk);
+        str += chunk;
+        len -= chunk;
+        ring->head += chunk;
+
+        if (ring->head == VIR_LOG_RING_SIZE) {
+            ring->head = 0;
+            ring->wrapped = true;
+        }
+    }
+}
+
+
+static void
+virLogOutputToRing(virLogSource *source G_GNUC_UNUSED,
+                   virLogPriority priority G_GNUC_UNUSED,
+                   const char *filename G_GNUC_UNUSED,
+                   int linenr G_GNUC_UNUSED,
+                   const char *funcname G_GNUC_UNUSED,
+                   const char *timestamp,
+                   struct _virLogMetadata *metadata G_GNUC_UNUSED,
+                   const char *rawstr G_GNUC_UNUSED,
+                   const char *str,
+                   void *data)
+{
+    virLogRing *ring = data;
+
+    virLogRingAppend(ring, timestamp);
+    virLogRingAppend(ring, ": ");
+    virLogRingAppend(ring, str);
+}
+
+
+static void
+virLogCloseRing(void *data)
+{
+    virLogRing *ring = data;
+
+    g_free(ring->buf);
+    g_free(ring);
+}
+
+
+static virLogOutput *
+virLogNewOutputToRing(virLogPriority priority,
+                      const char *file)
+{
+    virLogRing *ring = g_new0(virLogRing, 1);
+    virLogOutput *ret = NULL;
+
+    ring->buf = g_new0(char, VIR_LOG_RING_SIZE);
+
+    if (!(ret = virLogOutputNew(virLogOutputToRing, virLogCloseRing, ring,
+                                priority, VIR_LOG_TO_RING, file))) {
+        virLogCloseRing(ring);
+        return NULL;
+    }
+    return ret;
+}
+
+
+/**
+ * virLogDumpRings:
+ *
+ * Write the contents of every ring output defined into the file given
+ * in its definition, oldest messages first. The file is truncated, so
+ * it always holds the snapshot of the latest dump.
+ *
+ * Returns 0 on success, -1 on failure with an error reported.
+ */
+int
+virLogDumpRings(void)
+{
+    size_t i;
+    int ret = 0;
+
+    if (virLogInitialize() < 0)
+        return -1;
+
+    for (i = 0; ; i++) {
+        g_autofree char *path = NULL;
+        g_autofree char *snapshot = NULL;
+        const char *start;
+        size_t len;
+        bool found = false;
+        VIR_AUTOCLOSE fd = -1;
+
+        /* Copy the ring while holding the lock, but do the file I/O without
+         * it so that other threads are not stalled on logging meanwhile */
+        virLogLock();
+        for (; i < virLogNbOutputs; i++) {
+            virLogRing *ring;
+
+            if (virLogOutputs[i]->dest != VIR_LOG_TO_RING)
+                continue;
+
+            ring = virLogOutputs[i]->data;
+            path = g_strdup(virLogOutputs[i]->name);
+            snapshot = g_new0(char, VIR_LOG_RING_SIZE);
+            if (ring->wrapped) {
+                len = VIR_LOG_RING_SIZE - ring->head;
+                memcpy(snapshot, ring->buf + ring->head, len);
+                memcpy(snapshot + len, ring->buf, ring->head);
+                len = VIR_LOG_RING_SIZE;
+            } else {
+                len = ring->head;
+                memcpy(snapshot, ring->buf, len);
+            }
+            found = true;
+            break;
+        }
+        virLogUnlock();
+
+        if (!found)
+            break;
+
+        start = snapshot;
+        /* Skip the partially overwritten oldest message */
+        if (len == VIR_LOG_RING_SIZE) {
+            const char *nl = memchr(snapshot, '\n', len);
+
+            if (nl) {
+                len -= nl + 1 - snapshot;
+                start = nl + 1;
+            }
+        }
+
+        if ((fd = open(path, O_CREAT | O_TRUNC | O_WRONLY,
+                       S_IRUSR | S_IWUSR)) < 0) {
+            virReportSystemError(errno, _("failed to open %s"), path);
+            ret = -1;
+            continue;
+        }
+
+        if (safewrite(fd, start, len) < 0) {
+            virReportSystemError(errno, _("failed to write %s"), path);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+
 static virLogOutput *
 virLogNewOutputToFile(virLogPriority priority,
                       const char *file)
@@ -1108,6 +1289,7 @@ virLogGetOutputs(void)
         switch (dest) {
             case VIR_LOG_TO_SYSLOG:
             case VIR_LOG_TO_FILE:
+            case VIR_LOG_TO_RING:
                 virBufferAsprintf(&outputbuf, "%d:%s:%s",
                                   virLogOutputs[i]->priority,
                                   virLogDestinationTypeToString(dest),
@@ -1259,7 +1441,8 @@ virLogOutputNew(virLogOutputFunc f,
     virLogOutput *ret = NULL;
     char *ndup = NULL;
 
-    if (dest == VIR_LOG_TO_SYSLOG || dest == VIR_LOG_TO_FILE) {
+    if (dest == VIR_LOG_TO_SYSLOG || dest == VIR_LOG_TO_FILE ||
+        dest == VIR_LOG_TO_RING) {
         if (!name) {
             virReportError(VIR_ERR_INVALID_ARG, "%s",
                            _("Missing auxiliary data in output definition"));
@@ -1440,6 +1623,8 @@ virLogDefineFilters(virLogFilter **filters, size_t nfilters)
  *    x:journald - output is sent to journald
  *    x:syslog:name - output is sent to syslog using 'name' as the message tag
  *    x:file:abs_file_path - output is sent to file specified by 'abs_file_path'
+ *    x:ring:abs_file_path - output is kept in an in-memory ring buffer which
+ *                           is written to 'abs_file_path' by virLogDumpRings
  *
  *      'x' - minimal priority level which acts as a filter meaning that only
  *            messages with priority level greater than or equal to 'x' will be
@@ -1495,7 +1680,8 @@ virLogParseOutput(const char *src)
     if (((dest == VIR_LOG_TO_STDERR ||
           dest == VIR_LOG_TO_JOURNALD) && count != 2) ||
         ((dest == VIR_LOG_TO_FILE ||
-          dest == VIR_LOG_TO_SYSLOG) && count != 3)) {
+          dest == VIR_LOG_TO_SYSLOG ||
+          dest == VIR_LOG_TO_RING) && count != 3)) {
         virReportError(VIR_ERR_INVALID_ARG,
                        _("Output '%s' does not meet the format requirements "
                          "for destination type '%s'"), src, tokens[1]);
@@ -1517,6 +1703,12 @@ virLogParseOutput(const char *src)
         ret = virLogNewOutputToFile(prio, abspath);
         VIR_FREE(abspath);
         break;
+    case VIR_LOG_TO_RING:
+        if (!(abspath = g_canonicalize_filename(tokens[2], NULL)))
+            return NULL;
+        ret = virLogNewOutputToRing(prio, abspath);
+        VIR_FREE(abspath);
+        break;
     case VIR_LOG_TO_JOURNALD:
 #if USE_JOURNALD
         ret = virLogNewOutputToJournald(prio);
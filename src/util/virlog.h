@@ -53,6 +53,7 @@ typedef enum {
     VIR_LOG_TO_SYSLOG,
     VIR_LOG_TO_FILE,
     VIR_LOG_TO_JOURNALD,
+    VIR_LOG_TO_RING,
     VIR_LOG_TO_OUTPUT_LAST,
 } virLogDestination;
 
@@ -193,3 +194,4 @@ int virLogParseOutputs(const char *src,
                        virLogOutput ***outputs) ATTRIBUTE_NONNULL(1);
 int virLogParseFilters(const char *src,
                        virLogFilter ***filters) ATTRIBUTE_NONNULL(1);
+int virLogDumpRings(void);
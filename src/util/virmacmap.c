@@ -77,7 +77,7 @@ static int virMacMapOnceInit(void)
 VIR_ONCE_GLOBAL_INIT(virMacMap);
 
 
-static void
+static bool
 virMacMapAddLocked(virMacMap *mgr,
                    const char *domain,
                    const char *mac)
@@ -90,17 +90,19 @@ virMacMapAddLocked(virMacMap *mgr,
 
     for (next = list; next; next = next->next) {
         if (STREQ((const char *) next->data, mac))
-            return;
+            return false;
     }
 
     list = g_slist_append(list, g_strdup(mac));
 
     if (list != orig_list)
         g_hash_table_insert(mgr->macs, g_strdup(domain), list);
+
+    return true;
 }
 
 
-static void
+static bool
 virMacMapRemoveLocked(virMacMap *mgr,
                       const char *domain,
                       const char *mac)
@@ -108,26 +110,33 @@ virMacMapRemoveLocked(virMacMap *mgr,
     GSList *orig_list;
     GSList *list;
     GSList *next;
+    bool found = false;
 
     list = orig_list = g_hash_table_lookup(mgr->macs, domain);
 
     if (!orig_list)
-        return;
+        return false;
 
     for (next = list; next; next = next->next) {
         if (STREQ((const char *) next->data, mac)) {
             list = g_slist_remove_link(list, next);
             g_slist_free_full(next, g_free);
+            found = true;
             break;
         }
     }
 
+    if (!found)
+        return false;
+
     if (list != orig_list) {
         if (list)
             g_hash_table_insert(mgr->macs, g_strdup(domain), list);
         else
             g_hash_table_remove(mgr->macs, domain);
     }
+
+    return true;
 }
 
 
@@ -302,27 +311,33 @@ virMacMapNew(const char *file)
 }
 
 
+/* Returns 1 if @mac was added, 0 if it was already present */
 int
 virMacMapAdd(virMacMap *mgr,
              const char *domain,
              const char *mac)
 {
+    bool changed;
+
     virObjectLock(mgr);
-    virMacMapAddLocked(mgr, domain, mac);
+    changed = virMacMapAddLocked(mgr, domain, mac);
     virObjectUnlock(mgr);
-    return 0;
+    return changed ? 1 : 0;
 }
 
 
+/* Returns 1 if @mac was removed, 0 if it was not present */
 int
 virMacMapRemove(virMacMap *mgr,
                 const char *domain,
                 const char *mac)
 {
+    bool changed;
+
     virObjectLock(mgr);
-    virMacMapRemoveLocked(mgr, domain, mac);
+    changed = virMacMapRemoveLocked(mgr, domain, mac);
     virObjectUnlock(mgr);
-    return 0;
+    return changed ? 1 : 0;
 }
 
 
@@ -21,6 +21,7 @@
 
 #include "virnetdevbandwidth.h"
 #include "vircommand.h"
+#include "virbuffer.h"
 #include "viralloc.h"
 #include "virerror.h"
 #include "virlog.h"
@@ -43,7 +44,7 @@ virNetDevBandwidthFree(virNetDevBandwidth *def)
 }
 
 static void
-virNetDevBandwidthCmdAddOptimalQuantum(virCommand *cmd,
+virNetDevBandwidthAddOptimalQuantum(virBuffer *buf,
                                        const virNetDevBandwidthRate *rate)
 {
     const unsigned long long mtu = 1500;
@@ -61,10 +62,76 @@ virNetDevBandwidthCmdAddOptimalQuantum(virCommand *cmd,
     if (!r2q)
         r2q = 1;
 
-    virCommandAddArg(cmd, "quantum");
-    virCommandAddArgFormat(cmd, "%llu", r2q);
+    virBufferAsprintf(buf, " quantum %llu", r2q);
 }
 
+
+/**
+ * virNetDevBandwidthRunBatch:
+ * @batch: tc commands, one per line, without the leading 'tc'
+ *
+ * Run all commands in @batch with a single 'tc -batch' process
+ * rather than spawning tc for each of them. tc stops at the first
+ * failing command. @batch is emptied.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with error reported).
+ */
+static int
+virNetDevBandwidthRunBatch(virBuffer *batch)
+{
+    g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *input = NULL;
+
+    if (!(input = virBufferContentAndReset(batch)))
+        return 0;
+
+    cmd = virCommandNewArgList(TC, "-batch", "-", NULL);
+    virCommandSetInputBuffer(cmd, input);
+
+    return virCommandRun(cmd, NULL);
+}
+
+/**
+ * virNetDevBandwidthFormatFilter:
+ * @batch: buffer to append the tc command to
+ * @ifname: interface to create the filter on
+ * @ifmac_ptr: MAC of the interface to create filter over
+ * @id: filter ID
+ * @class_id: where to place traffic
+ *
+ * Append a tc command creating the filter described in
+ * virNetDevBandwidthManipulateFilter() to @batch.
+ */
+static void
+virNetDevBandwidthFormatFilter(virBuffer *batch,
+                               const char *ifname,
+                               const virMacAddr *ifmac_ptr,
+                               unsigned int id,
+                               const char *class_id)
+{
+    unsigned char ifmac[VIR_MAC_BUFLEN];
+
+    virMacAddrGetRaw(ifmac_ptr, ifmac);
+
+    /* Okay, this not nice. But since libvirt does not necessarily track
+     * interface IP address(es), and tc fw filter simply refuse to use
+     * ebtables marks, we need to use u32 selector to match MAC address.
+     * If libvirt will ever know something, remove this FIXME
+     */
+    virBufferAsprintf(batch,
+                      "filter add dev %s protocol ip prio 2 handle 800::%u u32 "
+                      "match u16 0x0800 0xffff at -2 "
+                      "match u32 0x%02x%02x%02x%02x 0xffffffff at -12 "
+                      "match u16 0x%02x%02x 0xffff at -14 "
+                      "flowid %s\n",
+                      ifname, id,
+                      ifmac[2], ifmac[3], ifmac[4], ifmac[5],
+                      ifmac[0], ifmac[1],
+                      class_id);
+}
+
+
 /**
  * virNetDevBandwidthManipulateFilter:
  * @ifname: interface to operate on
@@ -107,8 +174,7 @@ virNetDevBandwidthManipulateFilter(const char *ifname,
     int ret = -1;
     char *filter_id = NULL;
     virCommand *cmd = NULL;
-    unsigned char ifmac[VIR_MAC_BUFLEN];
-    char *mac[2] = {NULL, NULL};
+    g_auto(virBuffer) batch = VIR_BUFFER_INITIALIZER;
 
     if (!(remove_old || create_new)) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -132,34 +198,15 @@ virNetDevBandwidthManipulateFilter(const char *ifname,
     }
 
     if (create_new) {
-        virMacAddrGetRaw(ifmac_ptr, ifmac);
+        virNetDevBandwidthFormatFilter(&batch, ifname, ifmac_ptr,
+                                       id, class_id);
 
-        mac[0] = g_strdup_printf("0x%02x%02x%02x%02x", ifmac[2],
-                                 ifmac[3], ifmac[4], ifmac[5]);
-        mac[1] = g_strdup_printf("0x%02x%02x", ifmac[0], ifmac[1]);
-
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
-        /* Okay, this not nice. But since libvirt does not necessarily track
-         * interface IP address(es), and tc fw filter simply refuse to use
-         * ebtables marks, we need to use u32 selector to match MAC address.
-         * If libvirt will ever know something, remove this FIXME
-         */
-        virCommandAddArgList(cmd, "filter", "add", "dev", ifname, "protocol", "ip",
-                             "prio", "2", "handle", filter_id, "u32",
-                             "match", "u16", "0x0800", "0xffff", "at", "-2",
-                             "match", "u32", mac[0], "0xffffffff", "at", "-12",
-                             "match", "u16", mac[1], "0xffff", "at", "-14",
-                             "flowid", class_id, NULL);
-
-        if (virCommandRun(cmd, NULL) < 0)
+        if (virNetDevBandwidthRunBatch(&batch) < 0)
             goto cleanup;
     }
 
     ret = 0;
  cleanup:
-    VIR_FREE(mac[1]);
-    VIR_FREE(mac[0]);
     VIR_FREE(filter_id);
     virCommandFree(cmd);
     return ret;
@@ -198,7 +245,7 @@ virNetDevBandwidthSet(const char *ifname,
     int ret = -1;
     virNetDevBandwidthRate *rx = NULL; /* From domain POV */
     virNetDevBandwidthRate *tx = NULL; /* From domain POV */
-    virCommand *cmd = NULL;
+    g_auto(virBuffer) batch = VIR_BUFFER_INITIALIZER;
     char *average = NULL;
     char *peak = NULL;
     char *burst = NULL;
@@ -240,12 +287,8 @@ virNetDevBandwidthSet(const char *ifname,
         if (tx->burst)
             burst = g_strdup_printf("%llukb", tx->burst);
 
-        cmd = virCommandNew(TC);
-        virCommandAddArgList(cmd, "qdisc", "add", "dev", ifname, "root",
-                             "handle", "1:", "htb", "default",
-                             hierarchical_class ? "2" : "1", NULL);
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
+        virBufferAsprintf(&batch, "qdisc add dev %s root handle 1: htb default %s\n",
+                          ifname, hierarchical_class ? "2" : "1");
 
         /* If we are creating a hierarchical class, all non guaranteed traffic
          * goes to the 1:2 class which will adjust 'rate' dynamically as NICs
@@ -311,49 +354,32 @@ virNetDevBandwidthSet(const char *ifname,
          * it before you dig into the code.
          */
         if (hierarchical_class) {
-            virCommandFree(cmd);
-            cmd = virCommandNew(TC);
-            virCommandAddArgList(cmd, "class", "add", "dev", ifname, "parent",
-                                 "1:", "classid", "1:1", "htb", "rate", average,
-                                 "ceil", peak ? peak : average, NULL);
-            virNetDevBandwidthCmdAddOptimalQuantum(cmd, tx);
-            if (virCommandRun(cmd, NULL) < 0)
-                goto cleanup;
+            virBufferAsprintf(&batch,
+                              "class add dev %s parent 1: classid 1:1 htb rate %s ceil %s",
+                              ifname, average, peak ? peak : average);
+            virNetDevBandwidthAddOptimalQuantum(&batch, tx);
+            virBufferAddChar(&batch, '\n');
         }
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
-        virCommandAddArgList(cmd, "class", "add", "dev", ifname, "parent",
-                             hierarchical_class ? "1:1" : "1:", "classid",
-                             hierarchical_class ? "1:2" : "1:1", "htb",
-                             "rate", average, NULL);
+        virBufferAsprintf(&batch,
+                          "class add dev %s parent %s classid %s htb rate %s",
+                          ifname, hierarchical_class ? "1:1" : "1:",
+                          hierarchical_class ? "1:2" : "1:1", average);
 
         if (peak)
-            virCommandAddArgList(cmd, "ceil", peak, NULL);
+            virBufferAsprintf(&batch, " ceil %s", peak);
         if (burst)
-            virCommandAddArgList(cmd, "burst", burst, NULL);
-
-        virNetDevBandwidthCmdAddOptimalQuantum(cmd, tx);
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
-
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
-        virCommandAddArgList(cmd, "qdisc", "add", "dev", ifname, "parent",
-                             hierarchical_class ? "1:2" : "1:1",
-                             "handle", "2:", "sfq", "perturb",
-                             "10", NULL);
+            virBufferAsprintf(&batch, " burst %s", burst);
 
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
+        virNetDevBandwidthAddOptimalQuantum(&batch, tx);
+        virBufferAddChar(&batch, '\n');
 
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
-        virCommandAddArgList(cmd, "filter", "add", "dev", ifname, "parent",
-                             "1:0", "protocol", "all", "prio", "1", "handle",
-                             "1", "fw", "flowid", "1", NULL);
+        virBufferAsprintf(&batch,
+                          "qdisc add dev %s parent %s handle 2: sfq perturb 10\n",
+                          ifname, hierarchical_class ? "1:2" : "1:1");
 
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
+        virBufferAsprintf(&batch,
+                          "filter add dev %s parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n",
+                          ifname);
 
         VIR_FREE(average);
         VIR_FREE(peak);
@@ -374,31 +400,22 @@ virNetDevBandwidthSet(const char *ifname,
             burst = g_strdup_printf("%llukb", avg);
         }
 
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
-            virCommandAddArgList(cmd, "qdisc", "add", "dev", ifname,
-                                 "ingress", NULL);
-
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
+        virBufferAsprintf(&batch, "qdisc add dev %s ingress\n", ifname);
 
-        virCommandFree(cmd);
-        cmd = virCommandNew(TC);
         /* Set filter to match all ingress traffic */
-        virCommandAddArgList(cmd, "filter", "add", "dev", ifname, "parent",
-                             "ffff:", "protocol", "all", "u32", "match", "u32",
-                             "0", "0", "police", "rate", average,
-                             "burst", burst, "mtu", "64kb", "drop", "flowid",
-                             ":1", NULL);
-
-        if (virCommandRun(cmd, NULL) < 0)
-            goto cleanup;
+        virBufferAsprintf(&batch,
+                          "filter add dev %s parent ffff: protocol all u32 match u32 0 0 "
+                          "police rate %s burst %s mtu 64kb drop flowid :1\n",
+                          ifname, average, burst);
     }
 
+    /* All of the above is set up by a single tc process */
+    if (virNetDevBandwidthRunBatch(&batch) < 0)
+        goto cleanup;
+
     ret = 0;
 
  cleanup:
-    virCommandFree(cmd);
     VIR_FREE(average);
     VIR_FREE(peak);
     VIR_FREE(burst);
@@ -546,7 +563,7 @@ virNetDevBandwidthPlug(const char *brname,
                        unsigned int id)
 {
     int ret = -1;
-    virCommand *cmd = NULL;
+    g_auto(virBuffer) batch = VIR_BUFFER_INITIALIZER;
     char *class_id = NULL;
     char *qdisc_id = NULL;
     char *floor = NULL;
@@ -575,26 +592,19 @@ virNetDevBandwidthPlug(const char *brname,
                            net_bandwidth->in->peak :
                            net_bandwidth->in->average);
 
-    cmd = virCommandNew(TC);
-    virCommandAddArgList(cmd, "class", "add", "dev", brname, "parent", "1:1",
-                         "classid", class_id, "htb", "rate", floor,
-                         "ceil", ceil, NULL);
-    virNetDevBandwidthCmdAddOptimalQuantum(cmd, bandwidth->in);
-
-    if (virCommandRun(cmd, NULL) < 0)
-        goto cleanup;
+    virBufferAsprintf(&batch,
+                      "class add dev %s parent 1:1 classid %s htb rate %s ceil %s",
+                      brname, class_id, floor, ceil);
+    virNetDevBandwidthAddOptimalQuantum(&batch, bandwidth->in);
+    virBufferAddChar(&batch, '\n');
 
-    virCommandFree(cmd);
-    cmd = virCommandNew(TC);
-    virCommandAddArgList(cmd, "qdisc", "add", "dev", brname, "parent",
-                         class_id, "handle", qdisc_id, "sfq", "perturb",
-                         "10", NULL);
+    virBufferAsprintf(&batch,
+                      "qdisc add dev %s parent %s handle %s sfq perturb 10\n",
+                      brname, class_id, qdisc_id);
 
-    if (virCommandRun(cmd, NULL) < 0)
-        goto cleanup;
+    virNetDevBandwidthFormatFilter(&batch, brname, ifmac_ptr, id, class_id);
 
-    if (virNetDevBandwidthManipulateFilter(brname, ifmac_ptr, id,
-                                           class_id, false, true) < 0)
+    if (virNetDevBandwidthRunBatch(&batch) < 0)
         goto cleanup;
 
     ret = 0;
@@ -604,7 +614,6 @@ virNetDevBandwidthPlug(const char *brname,
     VIR_FREE(floor);
     VIR_FREE(qdisc_id);
     VIR_FREE(class_id);
-    virCommandFree(cmd);
     return ret;
 }
 
@@ -686,7 +695,7 @@ virNetDevBandwidthUpdateRate(const char *ifname,
                              unsigned long long new_rate)
 {
     int ret = -1;
-    virCommand *cmd = NULL;
+    g_auto(virBuffer) batch = VIR_BUFFER_INITIALIZER;
     char *class_id = NULL;
     char *rate = NULL;
     char *ceil = NULL;
@@ -697,19 +706,18 @@ virNetDevBandwidthUpdateRate(const char *ifname,
                            bandwidth->in->peak :
                            bandwidth->in->average);
 
-    cmd = virCommandNew(TC);
-    virCommandAddArgList(cmd, "class", "change", "dev", ifname,
-                         "classid", class_id, "htb", "rate", rate,
-                         "ceil", ceil, NULL);
-    virNetDevBandwidthCmdAddOptimalQuantum(cmd, bandwidth->in);
+    virBufferAsprintf(&batch,
+                      "class change dev %s classid %s htb rate %s ceil %s",
+                      ifname, class_id, rate, ceil);
+    virNetDevBandwidthAddOptimalQuantum(&batch, bandwidth->in);
+    virBufferAddChar(&batch, '\n');
 
-    if (virCommandRun(cmd, NULL) < 0)
+    if (virNetDevBandwidthRunBatch(&batch) < 0)
         goto cleanup;
 
     ret = 0;
 
  cleanup:
-    virCommandFree(cmd);
     VIR_FREE(class_id);
     VIR_FREE(rate);
     VIR_FREE(ceil);
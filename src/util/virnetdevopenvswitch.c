@@ -284,31 +284,17 @@ int virNetDevOpenvswitchSetMigrateData(char *migrate, const char *ifname)
     return 0;
 }
 
-
-/**
- * virNetDevOpenvswitchInterfaceParseStats:
- * @json: Input string in JSON format
- * @stats: parsed stats
- *
- * For given input string @json parse interface statistics and store them into
- * @stats.
- *
- * Returns: 0 on success,
- *         -1 otherwise (with error reported).
- */
-int
-virNetDevOpenvswitchInterfaceParseStats(const char *json,
-                                        virDomainInterfaceStatsPtr stats)
+static int
+virNetDevOpenvswitchInterfaceParseStatsMap(virJSONValue *jsonStats,
+                                           virDomainInterfaceStatsPtr stats)
 {
-    g_autoptr(virJSONValue) jsonStats = NULL;
     virJSONValue *jsonMap = NULL;
     size_t i;
 
     stats->rx_bytes = stats->rx_packets = stats->rx_errs = stats->rx_drop = -1;
     stats->tx_bytes = stats->tx_packets = stats->tx_errs = stats->tx_drop = -1;
 
-    if (!(jsonStats = virJSONValueFromString(json)) ||
-        !virJSONValueIsArray(jsonStats) ||
+    if (!virJSONValueIsArray(jsonStats) ||
         !(jsonMap = virJSONValueArrayGet(jsonStats, 1))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unable to parse ovs-vsctl output"));
@@ -358,6 +344,84 @@ virNetDevOpenvswitchInterfaceParseStats(const char *json,
     return 0;
 }
 
+/**
+ * virNetDevOpenvswitchInterfaceParseStats:
+ * @json: Input string in JSON format
+ * @stats: parsed stats
+ *
+ * For given input string @json parse interface statistics and store them into
+ * @stats.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with error reported).
+ */
+int
+virNetDevOpenvswitchInterfaceParseStats(const char *json,
+                                        virDomainInterfaceStatsPtr stats)
+{
+    g_autoptr(virJSONValue) jsonStats = NULL;
+
+    if (!(jsonStats = virJSONValueFromString(json))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to parse ovs-vsctl output"));
+        return -1;
+    }
+
+    return virNetDevOpenvswitchInterfaceParseStatsMap(jsonStats, stats);
+}
+
+/**
+ * virNetDevOpenvswitchInterfaceParseStatsAll:
+ * @json: Input string in JSON format
+ *
+ * For given output of 'ovs-vsctl --format=json --data=json
+ * --columns=name,statistics list Interface' parse statistics of all
+ * interfaces listed.
+ *
+ * Returns: a hash table of interface name -> virDomainInterfaceStats on
+ *          success, NULL otherwise (with error reported).
+ */
+GHashTable *
+virNetDevOpenvswitchInterfaceParseStatsAll(const char *json)
+{
+    g_autoptr(GHashTable) ret = virHashNew(g_free);
+    g_autoptr(virJSONValue) reply = NULL;
+    virJSONValue *data;
+    size_t i;
+
+    if (!(reply = virJSONValueFromString(json)) ||
+        !(data = virJSONValueObjectGetArray(reply, "data"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to parse ovs-vsctl output"));
+        return NULL;
+    }
+
+    for (i = 0; i < virJSONValueArraySize(data); i++) {
+        virJSONValue *row = virJSONValueArrayGet(data, i);
+        virJSONValue *jsonName;
+        virJSONValue *jsonStats;
+        const char *name;
+        g_autofree virDomainInterfaceStatsPtr stats = NULL;
+
+        if (!(jsonName = virJSONValueArrayGet(row, 0)) ||
+            !(jsonStats = virJSONValueArrayGet(row, 1)) ||
+            !(name = virJSONValueGetString(jsonName))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Malformed ovs-vsctl output"));
+            return NULL;
+        }
+
+        stats = g_new0(virDomainInterfaceStatsStruct, 1);
+
+        if (virNetDevOpenvswitchInterfaceParseStatsMap(jsonStats, stats) < 0)
+            return NULL;
+
+        g_hash_table_insert(ret, g_strdup(name), g_steal_pointer(&stats));
+    }
+
+    return g_steal_pointer(&ret);
+}
+
 /**
  * virNetDevOpenvswitchInterfaceStats:
  * @ifname: the name of the interface
@@ -414,6 +478,70 @@ virNetDevOpenvswitchInterfaceStats(const char *ifname,
     return 0;
 }
 
+/**
+ * virNetDevOpenvswitchInterfaceStatsAll:
+ *
+ * Retrieves the stats of all OVS interfaces with a single ovs-vsctl call,
+ * for callers about to query many interfaces at once.
+ *
+ * Returns a hash table of interface name -> virDomainInterfaceStats to be
+ * passed to virNetDevOpenvswitchInterfaceStatsLookup(), or NULL in case of
+ * failure.
+ */
+GHashTable *
+virNetDevOpenvswitchInterfaceStatsAll(void)
+{
+    g_autoptr(virCommand) cmd = virNetDevOpenvswitchCreateCmd();
+    g_autofree char *output = NULL;
+
+    virCommandAddArgList(cmd, "--format=json", "--data=json",
+                         "--columns=name,statistics", "list",
+                         "Interface", NULL);
+    virCommandSetOutputBuffer(cmd, &output);
+
+    if (virCommandRun(cmd, NULL) < 0)
+        return NULL;
+
+    return virNetDevOpenvswitchInterfaceParseStatsAll(output);
+}
+
+/**
+ * virNetDevOpenvswitchInterfaceStatsLookup:
+ * @all: table returned by virNetDevOpenvswitchInterfaceStatsAll(), or NULL
+ * @ifname: the name of the interface
+ * @stats: the retrieved domain interface stat
+ *
+ * Like virNetDevOpenvswitchInterfaceStats(), but take the stats of @ifname
+ * from @all if it has them. Falls back to querying the interface directly
+ * otherwise.
+ *
+ * Returns 0 in case of success or -1 in case of failure
+ */
+int
+virNetDevOpenvswitchInterfaceStatsLookup(GHashTable *all,
+                                         const char *ifname,
+                                         virDomainInterfaceStatsPtr stats)
+{
+    virDomainInterfaceStatsPtr found = NULL;
+
+    if (all)
+        found = g_hash_table_lookup(all, ifname);
+
+    if (!found ||
+        (found->rx_bytes == -1 &&
+         found->rx_packets == -1 &&
+         found->rx_errs == -1 &&
+         found->rx_drop == -1 &&
+         found->tx_bytes == -1 &&
+         found->tx_packets == -1 &&
+         found->tx_errs == -1 &&
+         found->tx_drop == -1))
+        return virNetDevOpenvswitchInterfaceStats(ifname, stats);
+
+    *stats = *found;
+    return 0;
+}
+
 
 /**
  * virNetDeOpenvswitchGetMaster:
@@ -661,6 +789,9 @@ virNetDevOpenvswitchFindUUID(const char *table,
  * domain's RX/TX is host's RX/TX), and for some it's swapped
  * (domain's RX/TX is hosts's TX/RX).
  *
+ * All changes to the OVS database are made by a single ovs-vsctl
+ * invocation, i.e. in one transaction.
+ *
  * Return 0 on success, -1 otherwise.
  */
 int
@@ -671,6 +802,7 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
 {
     virNetDevBandwidthRate *rx = NULL; /* From domain POV */
     virNetDevBandwidthRate *tx = NULL; /* From domain POV */
+    g_autoptr(virCommand) cmd = NULL;
 
     if (!bandwidth) {
         /* nothing to be enabled */
@@ -706,9 +838,10 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
         return 0;
     }
 
+    cmd = virNetDevOpenvswitchCreateCmd();
+
     if (tx && tx->average) {
         char vmuuidstr[VIR_UUID_STRING_BUFLEN];
-        g_autoptr(virCommand) cmd = NULL;
         g_autofree char *vmid_ex_id = NULL;
         g_autofree char *ifname_ex_id = NULL;
         g_autofree char *average = NULL;
@@ -732,12 +865,11 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
         qos_uuid = virNetDevOpenvswitchFindUUID("qos", vmid_ex_id, ifname_ex_id);
 
         /* create qos and set */
-        cmd = virNetDevOpenvswitchCreateCmd();
         if (queue_uuid && *queue_uuid) {
             g_auto(GStrv) lines = g_strsplit(queue_uuid, "\n", 0);
-            virCommandAddArgList(cmd, "set", "queue", lines[0], NULL);
+            virCommandAddArgList(cmd, "--", "set", "queue", lines[0], NULL);
         } else {
-            virCommandAddArgList(cmd, "set", "port", ifname, "qos=@qos1",
+            virCommandAddArgList(cmd, "--", "set", "port", ifname, "qos=@qos1",
                                  vmid_ex_id, ifname_ex_id,
                                  "--", "--id=@qos1", "create", "qos", "type=linux-htb", NULL);
             virCommandAddArgFormat(cmd, "other_config:min-rate=%s", average);
@@ -758,23 +890,11 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
             virCommandAddArgFormat(cmd, "other_config:max-rate=%s", peak);
         }
         virCommandAddArgList(cmd, vmid_ex_id, ifname_ex_id, NULL);
-        if (virCommandRun(cmd, NULL) < 0) {
-            if (queue_uuid && *queue_uuid) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Unable to set queue configuration on port %s"), ifname);
-            } else {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Unable to create and set qos configuration on port %s"), ifname);
-            }
-            return -1;
-        }
 
         if (qos_uuid && *qos_uuid) {
             g_auto(GStrv) lines = g_strsplit(qos_uuid, "\n", 0);
 
-            virCommandFree(cmd);
-            cmd = virNetDevOpenvswitchCreateCmd();
-            virCommandAddArgList(cmd, "set", "qos", lines[0], NULL);
+            virCommandAddArgList(cmd, "--", "set", "qos", lines[0], NULL);
             virCommandAddArgFormat(cmd, "other_config:min-rate=%s", average);
             if (burst) {
                 virCommandAddArgFormat(cmd, "other_config:burst=%s", burst);
@@ -783,11 +903,6 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
                 virCommandAddArgFormat(cmd, "other_config:max-rate=%s", peak);
             }
             virCommandAddArgList(cmd, vmid_ex_id, ifname_ex_id, NULL);
-            if (virCommandRun(cmd, NULL) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Unable to set qos configuration on port %s"), ifname);
-                return -1;
-            }
         }
     } else {
         if (virNetDevOpenvswitchInterfaceClearTxQos(ifname, vmuuid) < 0) {
@@ -795,26 +910,22 @@ virNetDevOpenvswitchInterfaceSetQos(const char *ifname,
         }
     }
 
+    virCommandAddArgList(cmd, "--", "set", "Interface", ifname, NULL);
     if (rx) {
-        g_autoptr(virCommand) cmd = NULL;
-
-        cmd = virNetDevOpenvswitchCreateCmd();
-        virCommandAddArgList(cmd, "set", "Interface", ifname, NULL);
         virCommandAddArgFormat(cmd, "ingress_policing_rate=%llu",
                                rx->average * VIR_NETDEV_RX_TO_OVS);
         if (rx->burst)
             virCommandAddArgFormat(cmd, "ingress_policing_burst=%llu",
                                    rx->burst * VIR_NETDEV_RX_TO_OVS);
-
-        if (virCommandRun(cmd, NULL) < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Unable to set vlan configuration on port %s"), ifname);
-            return -1;
-        }
     } else {
-        if (virNetDevOpenvswitchInterfaceClearRxQos(ifname) < 0) {
-            VIR_WARN("Clean rx qos for interface %s failed", ifname);
-        }
+        virCommandAddArgFormat(cmd, "ingress_policing_rate=%llu", 0llu);
+        virCommandAddArgFormat(cmd, "ingress_policing_burst=%llu", 0llu);
+    }
+
+    if (virCommandRun(cmd, NULL) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to set qos configuration on port %s"), ifname);
+        return -1;
     }
 
     return 0;
@@ -824,14 +935,13 @@ int
 virNetDevOpenvswitchInterfaceClearTxQos(const char *ifname,
                                         const unsigned char *vmuuid)
 {
-    int ret = 0;
     char vmuuidstr[VIR_UUID_STRING_BUFLEN];
     g_autoptr(virCommand) cmd = NULL;
     g_autofree char *ifname_ex_id = NULL;
     g_autofree char *vmid_ex_id = NULL;
     g_autofree char *qos_uuid = NULL;
     g_autofree char *queue_uuid = NULL;
-    g_autofree char *port_qos = NULL;
+    size_t ndestroy = 0;
     size_t i;
 
     /* find qos */
@@ -843,38 +953,21 @@ virNetDevOpenvswitchInterfaceClearTxQos(const char *ifname,
     /* find qos */
     qos_uuid = virNetDevOpenvswitchFindUUID("qos", vmid_ex_id, ifname_ex_id);
 
+    cmd = virNetDevOpenvswitchCreateCmd();
+
+    /* destroy qos */
     if (qos_uuid && *qos_uuid) {
         g_auto(GStrv) lines = g_strsplit(qos_uuid, "\n", 0);
 
-        /* destroy qos */
         for (i = 0; lines[i] != NULL; i++) {
             const char *line = lines[i];
             if (!*line) {
                 continue;
             }
-            virCommandFree(cmd);
-            cmd = virNetDevOpenvswitchCreateCmd();
-            virCommandAddArgList(cmd, "--no-heading", "--columns=_uuid", "--if-exists",
-                                 "list", "port", ifname, "qos", NULL);
-            virCommandSetOutputBuffer(cmd, &port_qos);
-            if (virCommandRun(cmd, NULL) < 0) {
-                VIR_WARN("Unable to remove port qos on port %s", ifname);
-            }
-            if (port_qos && *port_qos) {
-                virCommandFree(cmd);
-                cmd = virNetDevOpenvswitchCreateCmd();
-                virCommandAddArgList(cmd, "remove", "port", ifname, "qos", line, NULL);
-                if (virCommandRun(cmd, NULL) < 0) {
-                    VIR_WARN("Unable to remove port qos on port %s", ifname);
-                }
-            }
-            virCommandFree(cmd);
-            cmd = virNetDevOpenvswitchCreateCmd();
-            virCommandAddArgList(cmd, "destroy", "qos", line, NULL);
-            if (virCommandRun(cmd, NULL) < 0) {
-                VIR_WARN("Unable to destroy qos on port %s", ifname);
-                ret = -1;
-            }
+            virCommandAddArgList(cmd,
+                                 "--", "--if-exists", "remove", "port", ifname, "qos", line,
+                                 "--", "destroy", "qos", line, NULL);
+            ndestroy++;
         }
     }
     /* destroy queue */
@@ -886,17 +979,17 @@ virNetDevOpenvswitchInterfaceClearTxQos(const char *ifname,
             if (!*line) {
                 continue;
             }
-            virCommandFree(cmd);
-            cmd = virNetDevOpenvswitchCreateCmd();
-            virCommandAddArgList(cmd, "destroy", "queue", line, NULL);
-            if (virCommandRun(cmd, NULL) < 0) {
-                VIR_WARN("Unable to destroy queue on port %s", ifname);
-                ret = -1;
-            }
+            virCommandAddArgList(cmd, "--", "destroy", "queue", line, NULL);
+            ndestroy++;
         }
     }
 
-    return ret;
+    if (ndestroy > 0 && virCommandRun(cmd, NULL) < 0) {
+        VIR_WARN("Unable to destroy qos on port %s", ifname);
+        return -1;
+    }
+
+    return 0;
 }
 
 int
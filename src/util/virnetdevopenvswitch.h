@@ -54,10 +54,20 @@ int virNetDevOpenvswitchInterfaceParseStats(const char *json,
                                             virDomainInterfaceStatsPtr stats)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+GHashTable *virNetDevOpenvswitchInterfaceParseStatsAll(const char *json)
+    ATTRIBUTE_NONNULL(1);
+
 int virNetDevOpenvswitchInterfaceStats(const char *ifname,
                                        virDomainInterfaceStatsPtr stats)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+GHashTable *virNetDevOpenvswitchInterfaceStatsAll(void);
+
+int virNetDevOpenvswitchInterfaceStatsLookup(GHashTable *all,
+                                             const char *ifname,
+                                             virDomainInterfaceStatsPtr stats)
+    ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
+
 int
 virNetDevOpenvswitchMaybeUnescapeReply(char *reply)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
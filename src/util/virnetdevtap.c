@@ -29,6 +29,8 @@
 #include "viralloc.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virnetlink.h"
+#include "virhash.h"
 #include "datatypes.h"
 
 #include <unistd.h>
@@ -42,6 +44,7 @@
 #include <fcntl.h>
 #ifdef __linux__
 # include <linux/if_tun.h>    /* IFF_TUN, IFF_NO_PI */
+# include <linux/if_link.h>   /* struct rtnl_link_stats64 */
 #elif defined(__FreeBSD__)
 # include <net/if_mib.h>
 # include <sys/sysctl.h>
@@ -831,3 +834,126 @@ virNetDevTapInterfaceStats(const char *ifname G_GNUC_UNUSED,
 }
 
 #endif /* __linux__ */
+
+
+#if defined(__linux__) && defined(WITH_LIBNL)
+static int
+virNetDevTapInterfaceStatsAllCallback(struct nlmsghdr *resp,
+                                      void *opaque)
+{
+    GHashTable *all = opaque;
+    struct nlattr *tb[IFLA_MAX + 1] = { NULL, };
+    const struct rtnl_link_stats64 *link;
+    virDomainInterfaceStatsPtr stats;
+
+    if (resp->nlmsg_type != RTM_NEWLINK)
+        return 0;
+
+    if (nlmsg_parse(resp, sizeof(struct ifinfomsg), tb, IFLA_MAX, NULL) < 0 ||
+        !tb[IFLA_IFNAME] || !tb[IFLA_STATS64] ||
+        nla_len(tb[IFLA_STATS64]) < (int) sizeof(*link))
+        return 0;
+
+    link = nla_data(tb[IFLA_STATS64]);
+
+    /* Account the same way as /proc/net/dev does */
+    stats = g_new0(struct _virDomainInterfaceStats, 1);
+    stats->rx_bytes = link->rx_bytes;
+    stats->rx_packets = link->rx_packets;
+    stats->rx_errs = link->rx_errors;
+    stats->rx_drop = link->rx_dropped + link->rx_missed_errors;
+    stats->tx_bytes = link->tx_bytes;
+    stats->tx_packets = link->tx_packets;
+    stats->tx_errs = link->tx_errors;
+    stats->tx_drop = link->tx_dropped;
+
+    g_hash_table_insert(all, g_strdup(nla_get_string(tb[IFLA_IFNAME])), stats);
+    return 0;
+}
+
+
+/**
+ * virNetDevTapInterfaceStatsAll:
+ *
+ * Fetch RX/TX statistics of all host interfaces with a single
+ * RTM_GETLINK dump. The statistics are from host POV, i.e. not
+ * swapped. Use virNetDevTapInterfaceStatsLookup() to query the
+ * returned table. On platforms without netlink support the
+ * returned table is empty.
+ *
+ * Returns a hash table of ifname -> virDomainInterfaceStats on
+ * success, NULL otherwise (with error reported).
+ */
+GHashTable *
+virNetDevTapInterfaceStatsAll(void)
+{
+    struct ifinfomsg ifinfo = { .ifi_family = AF_UNSPEC };
+    g_autoptr(virNetlinkMsg) nl_msg = NULL;
+    g_autoptr(GHashTable) all = virHashNew(g_free);
+
+    nl_msg = virNetlinkMsgNew(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP);
+
+    if (nlmsg_append(nl_msg, &ifinfo, sizeof(ifinfo), NLMSG_ALIGNTO) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("allocated netlink buffer is too small"));
+        return NULL;
+    }
+
+    if (virNetlinkDumpCommand(nl_msg, virNetDevTapInterfaceStatsAllCallback,
+                              0, 0, NETLINK_ROUTE, 0, all) < 0)
+        return NULL;
+
+    return g_steal_pointer(&all);
+}
+#else
+GHashTable *
+virNetDevTapInterfaceStatsAll(void)
+{
+    /* Lookups fall back to querying interfaces one by one */
+    return virHashNew(g_free);
+}
+#endif /* defined(__linux__) && defined(WITH_LIBNL) */
+
+
+/**
+ * virNetDevTapInterfaceStatsLookup:
+ * @all: table returned by virNetDevTapInterfaceStatsAll(), or NULL
+ * @ifname: interface
+ * @stats: where to store statistics
+ * @swapped: whether to swap RX/TX fields
+ *
+ * Like virNetDevTapInterfaceStats(), but take the statistics of
+ * @ifname from @all if it has them. Falls back to querying the
+ * interface directly otherwise.
+ *
+ * Returns 0 on success, -1 otherwise (with error reported).
+ */
+int
+virNetDevTapInterfaceStatsLookup(GHashTable *all,
+                                 const char *ifname,
+                                 virDomainInterfaceStatsPtr stats,
+                                 bool swapped)
+{
+    virDomainInterfaceStatsPtr found = NULL;
+
+    if (all && ifname)
+        found = g_hash_table_lookup(all, ifname);
+
+    if (!found)
+        return virNetDevTapInterfaceStats(ifname, stats, swapped);
+
+    if (swapped) {
+        stats->rx_bytes = found->tx_bytes;
+        stats->rx_packets = found->tx_packets;
+        stats->rx_errs = found->tx_errs;
+        stats->rx_drop = found->tx_drop;
+        stats->tx_bytes = found->rx_bytes;
+        stats->tx_packets = found->rx_packets;
+        stats->tx_errs = found->rx_errs;
+        stats->tx_drop = found->rx_drop;
+    } else {
+        *stats = *found;
+    }
+
+    return 0;
+}
@@ -105,3 +105,11 @@ int virNetDevTapInterfaceStats(const char *ifname,
                                virDomainInterfaceStatsPtr stats,
                                bool swapped)
     G_GNUC_WARN_UNUSED_RESULT;
+
+GHashTable *virNetDevTapInterfaceStatsAll(void);
+
+int virNetDevTapInterfaceStatsLookup(GHashTable *all,
+                                     const char *ifname,
+                                     virDomainInterfaceStatsPtr stats,
+                                     bool swapped)
+    G_GNUC_WARN_UNUSED_RESULT;
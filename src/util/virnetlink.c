@@ -130,6 +130,12 @@ static int nextWatch = 1;
 static virNetlinkEventSrvPrivate *server[MAX_LINKS] = {NULL};
 static virNetlinkHandle *placeholder_nlhandle;
 
+/* Sockets for requests to the kernel, kept open between requests of
+ * the process that created them. */
+static virMutex cachedLock = VIR_MUTEX_INITIALIZER;
+static virNetlinkHandle *cachedHandles[MAX_LINKS];
+static pid_t cachedPid;
+
 /* Function definitions */
 
 struct nl_msg *
@@ -191,10 +197,17 @@ virNetlinkStartup(void)
 void
 virNetlinkShutdown(void)
 {
+    size_t i;
+
     if (placeholder_nlhandle) {
         virNetlinkFree(placeholder_nlhandle);
         placeholder_nlhandle = NULL;
     }
+
+    virMutexLock(&cachedLock);
+    for (i = 0; i < MAX_LINKS; i++)
+        g_clear_pointer(&cachedHandles[i], virNetlinkFree);
+    virMutexUnlock(&cachedLock);
 }
 
 
@@ -312,6 +325,117 @@ virNetlinkSendRequest(struct nl_msg *nl_msg, uint32_t src_pid,
     return NULL;
 }
 
+/**
+ * virNetlinkCommandCached:
+ * @nl_msg:     pointer to netlink message
+ * @resp:       pointer to pointer where response buffer will be allocated
+ * @respbuflen: pointer to integer holding the size of the response buffer
+ *              on return of the function.
+ * @protocol:   netlink protocol
+ *
+ * Like virNetlinkCommand() for a request to the kernel, but reuse a
+ * socket kept open for @protocol instead of creating one for every
+ * request. Requests are serialized on the socket, and replies are
+ * matched to the request by their sequence number so that leftovers
+ * of earlier requests (e.g. an ACK following a reply) are skipped.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+virNetlinkCommandCached(struct nl_msg *nl_msg,
+                        struct nlmsghdr **resp,
+                        unsigned int *respbuflen,
+                        unsigned int protocol)
+{
+    struct sockaddr_nl nladdr = {
+            .nl_family = AF_NETLINK,
+            .nl_pid    = 0,
+            .nl_groups = 0,
+    };
+    struct nlmsghdr *nlmsg = nlmsg_hdr(nl_msg);
+    struct pollfd fds[1];
+    virNetlinkHandle *nlhandle;
+    int ret = -1;
+
+    virMutexLock(&cachedLock);
+
+    /* Don't share the socket with a forked child */
+    if (cachedPid != getpid()) {
+        size_t i;
+
+        for (i = 0; i < MAX_LINKS; i++)
+            cachedHandles[i] = NULL;
+        cachedPid = getpid();
+    }
+
+    if (!cachedHandles[protocol] &&
+        !(cachedHandles[protocol] = virNetlinkCreateSocket(protocol)))
+        goto cleanup;
+
+    nlhandle = cachedHandles[protocol];
+
+    nlmsg_set_dst(nl_msg, &nladdr);
+    nlmsg->nlmsg_pid = getpid();
+
+    if (nl_send_auto_complete(nlhandle, nl_msg) < 0) {
+        virReportSystemError(errno,
+                             "%s", _("cannot send to netlink socket"));
+        goto error;
+    }
+
+    memset(fds, 0, sizeof(fds));
+    fds[0].fd = nl_socket_get_fd(nlhandle);
+    fds[0].events = POLLIN;
+
+    while (true) {
+        g_autofree struct nlmsghdr *temp_resp = NULL;
+        int len;
+        int n;
+
+        n = poll(fds, G_N_ELEMENTS(fds), NETLINK_ACK_TIMEOUT_S);
+        if (n < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("error in poll call"));
+            goto error;
+        }
+        if (n == 0) {
+            virReportSystemError(ETIMEDOUT, "%s",
+                                 _("no valid netlink response was received"));
+            goto error;
+        }
+
+        len = nl_recv(nlhandle, &nladdr, (unsigned char **)&temp_resp, NULL);
+        if (len == 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("nl_recv failed - returned 0 bytes"));
+            goto error;
+        }
+        if (len < 0) {
+            virReportSystemError(errno, "%s", _("nl_recv failed"));
+            goto error;
+        }
+
+        if (len >= NLMSG_HDRLEN &&
+            temp_resp->nlmsg_seq != nlmsg->nlmsg_seq)
+            continue;
+
+        *resp = g_steal_pointer(&temp_resp);
+        *respbuflen = len;
+        break;
+    }
+
+    ret = 0;
+    goto cleanup;
+
+ error:
+    /* A late reply could still arrive on the socket, start afresh */
+    g_clear_pointer(&cachedHandles[protocol], virNetlinkFree);
+ cleanup:
+    virMutexUnlock(&cachedLock);
+    return ret;
+}
+
+
 /**
  * virNetlinkCommand:
  * @nl_msg:     pointer to netlink message
@@ -324,6 +448,8 @@ virNetlinkSendRequest(struct nl_msg *nl_msg, uint32_t src_pid,
  * @groups:     the group identifier
  *
  * Send the given message to the netlink layer and receive response.
+ * Requests to the kernel which don't join any multicast group reuse a
+ * socket kept open for @protocol.
  * Returns 0 on success, -1 on error. In case of error, no response
  * buffer will be returned.
  */
@@ -342,6 +468,9 @@ int virNetlinkCommand(struct nl_msg *nl_msg,
     g_autoptr(virNetlinkHandle) nlhandle = NULL;
     int len = 0;
 
+    if (src_pid == 0 && dst_pid == 0 && groups == 0 && protocol < MAX_LINKS)
+        return virNetlinkCommandCached(nl_msg, resp, respbuflen, protocol);
+
     memset(fds, 0, sizeof(fds));
 
     if (!(nlhandle = virNetlinkSendRequest(nl_msg, src_pid, nladdr,
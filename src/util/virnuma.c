@@ -53,6 +53,101 @@
 VIR_LOG_INIT("util.numa");
 
 
+#if WITH_NUMACTL
+/*
+ * Pick nodes for a domain with @vcpus vCPUs and @balloon KiB of memory
+ * without asking numad: start from the node with the most free memory
+ * and, as long as the domain doesn't fit, add the nodes closest to it.
+ * Since free memory already accounts for running domains, this spreads
+ * domains across nodes as they are started.
+ */
+static char *
+virNumaGetBuiltinPlacementAdvice(unsigned short vcpus,
+                                 unsigned long long balloon)
+{
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autofree unsigned long long *memfree = NULL;
+    g_autofree int *ncpus = NULL;
+    g_autofree int *distances = NULL;
+    int ndistances = 0;
+    unsigned long long needMem = balloon * 1024;
+    unsigned long long haveMem;
+    int haveCpus;
+    int maxnode;
+    int best = -1;
+    size_t i;
+
+    if ((maxnode = virNumaGetMaxNode()) < 0)
+        return NULL;
+
+    memfree = g_new0(unsigned long long, maxnode + 1);
+    ncpus = g_new0(int, maxnode + 1);
+    nodeset = virBitmapNew(maxnode + 1);
+
+    for (i = 0; i <= maxnode; i++) {
+        g_autoptr(virBitmap) cpus = NULL;
+        int rc;
+
+        if (!virNumaNodeIsAvailable(i) ||
+            virNumaGetNodeMemory(i, NULL, &memfree[i]) < 0)
+            continue;
+
+        if ((rc = virNumaGetNodeCPUs(i, &cpus)) == -1)
+            return NULL;
+
+        ncpus[i] = MAX(rc, 0);
+
+        if (ncpus[i] > 0 && (best < 0 || memfree[i] > memfree[best]))
+            best = i;
+    }
+
+    if (best < 0) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("No NUMA node with CPUs found"));
+        return NULL;
+    }
+
+    if (virNumaGetDistances(best, &distances, &ndistances) < 0)
+        return NULL;
+
+    ignore_value(virBitmapSetBit(nodeset, best));
+    haveMem = memfree[best];
+    haveCpus = ncpus[best];
+
+    while (haveMem < needMem || haveCpus < vcpus) {
+        int next = -1;
+
+        for (i = 0; i <= maxnode; i++) {
+            int dist = i < ndistances ? distances[i] : 0;
+            int nextDist;
+
+            if (ncpus[i] == 0 || virBitmapIsBitSet(nodeset, i))
+                continue;
+
+            if (next < 0) {
+                next = i;
+                continue;
+            }
+
+            nextDist = next < ndistances ? distances[next] : 0;
+            if (dist < nextDist ||
+                (dist == nextDist && memfree[i] > memfree[next]))
+                next = i;
+        }
+
+        if (next < 0)
+            break;
+
+        ignore_value(virBitmapSetBit(nodeset, next));
+        haveMem += memfree[next];
+        haveCpus += ncpus[next];
+    }
+
+    return virBitmapFormat(nodeset);
+}
+#endif /* WITH_NUMACTL */
+
+
 #if WITH_NUMAD
 char *
 virNumaGetAutoPlacementAdvice(unsigned short vcpus,
@@ -61,6 +156,11 @@ virNumaGetAutoPlacementAdvice(unsigned short vcpus,
     g_autoptr(virCommand) cmd = NULL;
     char *output = NULL;
 
+    if (!virFileIsExecutable(NUMAD)) {
+        VIR_DEBUG("numad is not installed, using built-in placement");
+        return virNumaGetBuiltinPlacementAdvice(vcpus, balloon);
+    }
+
     cmd = virCommandNewArgList(NUMAD, "-w", NULL);
     virCommandAddArgFormat(cmd, "%d:%llu", vcpus,
                            VIR_DIV_UP(balloon, 1024));
@@ -76,7 +176,14 @@ virNumaGetAutoPlacementAdvice(unsigned short vcpus,
 
     return output;
 }
-#else /* !WITH_NUMAD */
+#elif WITH_NUMACTL
+char *
+virNumaGetAutoPlacementAdvice(unsigned short vcpus,
+                              unsigned long long balloon)
+{
+    return virNumaGetBuiltinPlacementAdvice(vcpus, balloon);
+}
+#else /* !WITH_NUMAD && !WITH_NUMACTL */
 char *
 virNumaGetAutoPlacementAdvice(unsigned short vcpus G_GNUC_UNUSED,
                               unsigned long long balloon G_GNUC_UNUSED)
@@ -85,7 +192,7 @@ virNumaGetAutoPlacementAdvice(unsigned short vcpus G_GNUC_UNUSED,
                    _("numad is not available on this host"));
     return NULL;
 }
-#endif /* !WITH_NUMAD */
+#endif /* !WITH_NUMAD && !WITH_NUMACTL */
 
 #if WITH_NUMACTL
 int
@@ -45,8 +45,17 @@ struct _virClass {
     size_t objectSize;
 
     virObjectDisposeCallback dispose;
+
+    /* Number of instances which are alive and which were ever created,
+     * updated atomically */
+    gsize live;
+    gsize created;
 };
 
+/* All classes ever registered, classes are never freed */
+static GPtrArray *virClassList;
+static virMutex virClassListLock = VIR_MUTEX_INITIALIZER;
+
 typedef struct _virObjectPrivate virObjectPrivate;
 struct _virObjectPrivate {
     virClass *klass;
@@ -207,10 +216,74 @@ virClassNew(virClass *parent,
     }
     klass->dispose = dispose;
 
+    virMutexLock(&virClassListLock);
+    if (!virClassList)
+        virClassList = g_ptr_array_new();
+    g_ptr_array_add(virClassList, klass);
+    virMutexUnlock(&virClassListLock);
+
     return klass;
 }
 
 
+static int
+virClassStatsCompare(const void *a,
+                     const void *b)
+{
+    const virClassStats *sa = a;
+    const virClassStats *sb = b;
+
+    if (sa->live != sb->live)
+        return sa->live < sb->live ? 1 : -1;
+
+    return strcmp(sa->name, sb->name);
+}
+
+
+/**
+ * virClassGetStats:
+ * @stats: filled with the statistics of the classes
+ * @nstats: filled with the number of elements of @stats
+ *
+ * Collects the number of live and created instances of every class which
+ * was instantiated at least once, sorted by the number of live instances
+ * in descending order. The caller must free @stats.
+ */
+void
+virClassGetStats(virClassStats **stats,
+                 size_t *nstats)
+{
+    size_t i;
+
+    *stats = NULL;
+    *nstats = 0;
+
+    virMutexLock(&virClassListLock);
+    if (virClassList) {
+        *stats = g_new0(virClassStats, virClassList->len);
+
+        for (i = 0; i < virClassList->len; i++) {
+            virClass *klass = g_ptr_array_index(virClassList, i);
+            virClassStats *s = &(*stats)[*nstats];
+            size_t created = GPOINTER_TO_SIZE(g_atomic_pointer_get(&klass->created));
+
+            if (created == 0)
+                continue;
+
+            s->name = klass->name;
+            s->objectSize = klass->objectSize;
+            s->live = GPOINTER_TO_SIZE(g_atomic_pointer_get(&klass->live));
+            s->created = created;
+            (*nstats)++;
+        }
+    }
+    virMutexUnlock(&virClassListLock);
+
+    if (*nstats > 0)
+        qsort(*stats, *nstats, sizeof(**stats), virClassStatsCompare);
+}
+
+
 /**
  * virClassIsDerivedFrom:
  * @klass: the klass to check
@@ -255,6 +328,8 @@ virObjectNew(virClass *klass)
 
     priv = vir_object_get_instance_private(obj);
     priv->klass = klass;
+    g_atomic_pointer_add(&klass->live, 1);
+    g_atomic_pointer_add(&klass->created, 1);
     PROBE(OBJECT_NEW, "obj=%p classname=%s", obj, priv->klass->name);
 
     return obj;
@@ -320,6 +395,8 @@ static void vir_object_finalize(GObject *gobj)
 
     PROBE(OBJECT_DISPOSE, "obj=%p", gobj);
 
+    g_atomic_pointer_add(&klass->live, -1);
+
     while (klass) {
         if (klass->dispose)
             klass->dispose(obj);
@@ -53,6 +53,14 @@ struct _virObjectRWLockable {
     virRWLock lock;
 };
 
+typedef struct _virClassStats virClassStats;
+struct _virClassStats {
+    const char *name;
+    size_t objectSize;
+    size_t live;
+    size_t created;
+};
+
 virClass *virClassForObject(void);
 virClass *virClassForObjectLockable(void);
 virClass *virClassForObjectRWLockable(void);
@@ -89,6 +97,11 @@ virClassIsDerivedFrom(virClass *klass,
                       virClass *parent)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+void
+virClassGetStats(virClassStats **stats,
+                 size_t *nstats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 void *
 virObjectNew(virClass *klass)
     ATTRIBUTE_NONNULL(1);
@@ -74,7 +74,7 @@ struct _virPCIDevice {
     char          *used_by_drvname;
     char          *used_by_domname;
 
-    /* The following 5 items are only valid after virPCIDeviceInit()
+    /* The following 6 items are only valid after virPCIDeviceInit()
      * has been called for the virPCIDevice object. This is *not* done
      * in most cases (because it creates extra overhead, and parts of
      * it can fail if libvirtd is running unprivileged)
@@ -84,6 +84,7 @@ struct _virPCIDevice {
     bool          has_flr;
     bool          has_pm_reset;
     bool          is_pcie;
+    bool          initialized;
     /**/
 
     bool          managed;
@@ -735,13 +736,14 @@ virPCIDeviceIsParent(virPCIDevice *dev, virPCIDevice *check, void *data)
     if (dev->address.domain != check->address.domain)
         return 0;
 
-    if ((fd = virPCIDeviceConfigOpenTry(check)) < 0)
-        return 0;
-
-    /* Is it a bridge? */
+    /* Is it a bridge? Check this before opening the config space,
+     * since on hosts with lots of SR-IOV VFs most devices are not. */
     ret = virPCIDeviceReadClass(check, &device_class);
     if (ret < 0 || device_class != PCI_CLASS_BRIDGE_PCI)
-        goto cleanup;
+        return ret;
+
+    if ((fd = virPCIDeviceConfigOpenTry(check)) < 0)
+        return 0;
 
     /* Is it a plane? */
     header_type = virPCIDeviceRead8(check, fd, PCI_HEADER_TYPE);
@@ -967,6 +969,11 @@ virPCIDeviceTryPowerManagementReset(virPCIDevice *dev, int cfgfd)
 static int
 virPCIDeviceInit(virPCIDevice *dev, int cfgfd)
 {
+    /* None of this can change for a given device, and walking the
+     * capability lists takes quite a few reads of config space. */
+    if (dev->initialized)
+        return 0;
+
     dev->is_pcie = false;
     if (virPCIDeviceFindCapabilityOffset(dev, cfgfd, PCI_CAP_ID_EXP, &dev->pcie_cap_pos) < 0) {
         /* an unprivileged process is unable to read *all* of a
@@ -996,6 +1003,7 @@ virPCIDeviceInit(virPCIDevice *dev, int cfgfd)
     virPCIDeviceFindCapabilityOffset(dev, cfgfd, PCI_CAP_ID_PM, &dev->pci_pm_cap_pos);
     dev->has_flr = virPCIDeviceDetectFunctionLevelReset(dev, cfgfd);
     dev->has_pm_reset = virPCIDeviceDetectPowerManagementReset(dev, cfgfd);
+    dev->initialized = true;
 
     return 0;
 }
@@ -40,7 +40,8 @@
 typedef struct _virPortAllocator virPortAllocator;
 struct _virPortAllocator {
     virObjectLockable parent;
-    virBitmap *bitmap;
+    virBitmap *bitmap; /* ports reserved by us */
+    virBitmap *busy; /* ports found in use by others when last probed */
 };
 
 struct _virPortAllocatorRange {
@@ -59,6 +60,7 @@ virPortAllocatorDispose(void *obj)
     virPortAllocator *pa = obj;
 
     virBitmapFree(pa->bitmap);
+    virBitmapFree(pa->busy);
 }
 
 static virPortAllocator *
@@ -70,6 +72,7 @@ virPortAllocatorNew(void)
         return NULL;
 
     pa->bitmap = virBitmapNew(VIR_PORT_ALLOCATOR_NUM_PORTS);
+    pa->busy = virBitmapNew(VIR_PORT_ALLOCATOR_NUM_PORTS);
 
     return pa;
 }
@@ -200,12 +203,70 @@ virPortAllocatorGet(void)
     return virPortAllocatorInstance;
 }
 
+/*
+ * Reserves the first port of @range starting at @port which is not reserved
+ * yet and which either was (@busy is true) or wasn't found in use by others
+ * when probed last time. Returns 1 and updates @port if a port was reserved,
+ * 0 if there's none left.
+ */
+static int
+virPortAllocatorReserve(virPortAllocator *pa,
+                        const virPortAllocatorRange *range,
+                        size_t *port,
+                        bool busy)
+{
+    int ret = 0;
+
+    virObjectLock(pa);
+
+    for (; *port <= range->end; (*port)++) {
+        if (virBitmapIsBitSet(pa->bitmap, *port) ||
+            virBitmapIsBitSet(pa->busy, *port) != busy)
+            continue;
+
+        ignore_value(virBitmapSetBit(pa->bitmap, *port));
+        ret = 1;
+        break;
+    }
+
+    virObjectUnlock(pa);
+    return ret;
+}
+
+/*
+ * Records the result of probing a @port reserved by virPortAllocatorReserve.
+ * Unless the port is available, the reservation is dropped.
+ */
+static void
+virPortAllocatorProbed(virPortAllocator *pa,
+                       size_t port,
+                       bool available,
+                       bool busy)
+{
+    virObjectLock(pa);
+
+    if (!available)
+        ignore_value(virBitmapClearBit(pa->bitmap, port));
+
+    if (busy)
+        ignore_value(virBitmapSetBit(pa->busy, port));
+    else
+        ignore_value(virBitmapClearBit(pa->busy, port));
+
+    virObjectUnlock(pa);
+}
+
+/*
+ * Ports are reserved before they are probed, so the allocator is only locked
+ * while looking up a candidate and concurrent callers probe different ports
+ * in parallel. Ports which other processes were using when probed are
+ * skipped and only probed again once no other port of @range is left.
+ */
 int
 virPortAllocatorAcquire(const virPortAllocatorRange *range,
                         unsigned short *port)
 {
-    int ret = -1;
-    size_t i;
+    size_t pass;
     virPortAllocator *pa = virPortAllocatorGet();
 
     *port = 0;
@@ -213,38 +274,32 @@ virPortAllocatorAcquire(const virPortAllocatorRange *range,
     if (!pa)
         return -1;
 
-    virObjectLock(pa);
+    for (pass = 0; pass < 2; pass++) {
+        bool busy = pass > 0;
+        size_t i = range->start;
 
-    for (i = range->start; i <= range->end && !*port; i++) {
-        bool used = false, v6used = false;
+        for (; virPortAllocatorReserve(pa, range, &i, busy) > 0; i++) {
+            bool used = false, v6used = false;
 
-        if (virBitmapIsBitSet(pa->bitmap, i))
-            continue;
+            if (virPortAllocatorBindToPort(&v6used, i, AF_INET6) < 0 ||
+                virPortAllocatorBindToPort(&used, i, AF_INET) < 0) {
+                virPortAllocatorProbed(pa, i, false, busy);
+                return -1;
+            }
 
-        if (virPortAllocatorBindToPort(&v6used, i, AF_INET6) < 0 ||
-            virPortAllocatorBindToPort(&used, i, AF_INET) < 0)
-            goto cleanup;
+            virPortAllocatorProbed(pa, i, !used && !v6used, used || v6used);
 
-        if (!used && !v6used) {
-            /* Add port to bitmap of reserved ports */
-            if (virBitmapSetBit(pa->bitmap, i) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Failed to reserve port %zu"), i);
-                goto cleanup;
+            if (!used && !v6used) {
+                *port = i;
+                return 0;
             }
-            *port = i;
-            ret = 0;
         }
     }
 
-    if (*port == 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unable to find an unused port in range '%s' (%d-%d)"),
-                       range->name, range->start, range->end);
-    }
- cleanup:
-    virObjectUnlock(pa);
-    return ret;
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("Unable to find an unused port in range '%s' (%d-%d)"),
+                   range->name, range->start, range->end);
+    return -1;
 }
 
 int
@@ -364,6 +364,12 @@ struct _virResctrlMonitor {
     /* libvirt-generated path in /sys/fs/resctrl for this particular
      * monitor */
     char *path;
+
+    /* Statistics read by the last virResctrlMonitorGetStats call and the
+     * monotonic time in microseconds they were read at */
+    virResctrlMonitorStats **stats;
+    size_t nstats;
+    unsigned long long statsTime;
 };
 
 
@@ -424,6 +430,7 @@ virResctrlMonitorDispose(void *obj)
     virObjectUnref(monitor->alloc);
     g_free(monitor->id);
     g_free(monitor->path);
+    virResctrlMonitorStatsListFree(monitor->stats, monitor->nstats);
 }
 
 
@@ -2560,11 +2567,11 @@ virResctrlMonitorStatsSorter(const void *a,
  *
  * Returns 0 on success, -1 on error.
  */
-int
-virResctrlMonitorGetStats(virResctrlMonitor *monitor,
-                          const char **resources,
-                          virResctrlMonitorStats ***stats,
-                          size_t *nstats)
+static int
+virResctrlMonitorReadStats(virResctrlMonitor *monitor,
+                           const char **resources,
+                           virResctrlMonitorStats ***stats,
+                           size_t *nstats)
 {
     int rv = -1;
     int ret = -1;
@@ -2576,12 +2583,6 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
     virResctrlMonitorStats *stat = NULL;
     size_t nresources = g_strv_length((char **) resources);
 
-    if (!monitor) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Invalid resctrl monitor"));
-        return -1;
-    }
-
     datapath = g_strdup_printf("%s/mon_data", monitor->path);
 
     if (virDirOpen(&dirp, datapath) < 0)
@@ -2589,7 +2590,6 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
 
     *nstats = 0;
     while (virDirRead(dirp, &ent, datapath) > 0) {
-        g_autofree char *filepath = NULL;
         char *node_id = NULL;
 
         /* Looking for directory that contains resource utilization
@@ -2598,10 +2598,6 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
          * "mon_L3_01" are two target directories for a two nodes system
          * with resource utilization data file for each node respectively.
          */
-        filepath = g_strdup_printf("%s/%s", datapath, ent->d_name);
-
-        if (!virFileIsDir(filepath))
-            continue;
 
         /* Looking for directory has a prefix 'mon_L' */
         if (!(node_id = STRSKIP(ent->d_name, "mon_L")))
@@ -2616,6 +2612,19 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
         if (!(node_id = STRSKIP(node_id, "_")))
             continue;
 
+        /* Only stat the entries whose type is not known from the name
+         * matching above already */
+        if (ent->d_type != DT_DIR) {
+            g_autofree char *filepath = NULL;
+
+            if (ent->d_type != DT_UNKNOWN)
+                continue;
+
+            filepath = g_strdup_printf("%s/%s", datapath, ent->d_name);
+            if (!virFileIsDir(filepath))
+                continue;
+        }
+
         stat = g_new0(virResctrlMonitorStats, 1);
         stat->features = g_new0(char *, nresources + 1);
 
@@ -2653,6 +2662,117 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
 }
 
 
+/* Checks whether @stats were read for exactly the features in @resources */
+static bool
+virResctrlMonitorStatsMatch(virResctrlMonitorStats **stats,
+                            size_t nstats,
+                            const char **resources)
+{
+    size_t i;
+
+    if (nstats == 0)
+        return false;
+
+    for (i = 0; resources[i]; i++) {
+        if (i >= stats[0]->nvals ||
+            STRNEQ(stats[0]->features[i], resources[i]))
+            return false;
+    }
+
+    return i == stats[0]->nvals;
+}
+
+
+static virResctrlMonitorStats *
+virResctrlMonitorStatsCopy(virResctrlMonitorStats *src)
+{
+    virResctrlMonitorStats *dst = g_new0(virResctrlMonitorStats, 1);
+
+    dst->id = src->id;
+    dst->features = g_strdupv(src->features);
+    dst->vals = g_new0(unsigned long long, src->nvals);
+    memcpy(dst->vals, src->vals, src->nvals * sizeof(*src->vals));
+    dst->nvals = src->nvals;
+
+    return dst;
+}
+
+
+/*
+ * virResctrlMonitorGetStats
+ *
+ * @monitor: The monitor that the statistic data will be retrieved from.
+ * @resources: A string list for the monitor feature names.
+ * @stats: Pointer of of virResctrlMonitorStats * array for holding cache or
+ * memory bandwidth usage data.
+ * @nstats: A size_t pointer to hold the returned array length of @stats
+ *
+ * Get cache or memory bandwidth utilization information. Each call walks
+ * the mon_data directory of the monitor and reads one file per node and
+ * feature, so statistics which were read less than
+ * VIR_RESCTRL_MONITOR_STATS_MAX_AGE ago are returned again instead. This
+ * keeps frequent scrapes of many domains from rereading them. The caller
+ * must serialize calls for the same @monitor, as the domain object lock
+ * does.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virResctrlMonitorGetStats(virResctrlMonitor *monitor,
+                          const char **resources,
+                          virResctrlMonitorStats ***stats,
+                          size_t *nstats)
+{
+    unsigned long long now = g_get_monotonic_time();
+    size_t i;
+
+    if (!monitor) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Invalid resctrl monitor"));
+        return -1;
+    }
+
+    if (!virResctrlMonitorStatsMatch(monitor->stats, monitor->nstats,
+                                     resources) ||
+        now - monitor->statsTime >= VIR_RESCTRL_MONITOR_STATS_MAX_AGE) {
+        virResctrlMonitorStats **fresh = NULL;
+        size_t nfresh = 0;
+
+        if (virResctrlMonitorReadStats(monitor, resources,
+                                       &fresh, &nfresh) < 0) {
+            virResctrlMonitorStatsListFree(fresh, nfresh);
+            return -1;
+        }
+
+        virResctrlMonitorStatsListFree(monitor->stats, monitor->nstats);
+        monitor->stats = fresh;
+        monitor->nstats = nfresh;
+        monitor->statsTime = now;
+    }
+
+    *nstats = 0;
+    for (i = 0; i < monitor->nstats; i++) {
+        virResctrlMonitorStats *stat = virResctrlMonitorStatsCopy(monitor->stats[i]);
+
+        VIR_APPEND_ELEMENT(*stats, *nstats, stat);
+    }
+
+    return 0;
+}
+
+
+void
+virResctrlMonitorStatsListFree(virResctrlMonitorStats **stats,
+                               size_t nstats)
+{
+    size_t i;
+
+    for (i = 0; i < nstats; i++)
+        virResctrlMonitorStatsFree(stats[i]);
+    g_free(stats);
+}
+
+
 void
 virResctrlMonitorStatsFree(virResctrlMonitorStats *stat)
 {
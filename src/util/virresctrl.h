@@ -187,6 +187,9 @@ virResctrlInfoGetMonitorPrefix(virResctrlInfo *resctrl,
 
 typedef struct _virResctrlMonitor virResctrlMonitor;
 
+/* How long in microseconds statistics of a monitor are reused */
+#define VIR_RESCTRL_MONITOR_STATS_MAX_AGE (1000 * 1000)
+
 typedef struct _virResctrlMonitorStats virResctrlMonitorStats;
 struct _virResctrlMonitorStats {
     /* The system assigned cache ID associated with statistical record */
@@ -238,3 +241,7 @@ virResctrlMonitorGetStats(virResctrlMonitor *monitor,
 
 void
 virResctrlMonitorStatsFree(virResctrlMonitorStats *stats);
+
+void
+virResctrlMonitorStatsListFree(virResctrlMonitorStats **stats,
+                               size_t nstats);
@@ -999,6 +999,85 @@ virStringParsePort(const char *str,
 }
 
 
+static virMutex virStringInternLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStringInternTable;
+
+
+/**
+ * virStringIntern:
+ * @str: string to intern, may be NULL
+ *
+ * Returns a shared copy of @str. Every caller interning an equal string
+ * gets the same pointer, so a low-cardinality string repeated in many
+ * definitions is kept in memory only once. The returned string must not
+ * be modified and must be released with virStringInternRelease() rather
+ * than g_free(). Returns NULL if @str is NULL.
+ */
+char *
+virStringIntern(const char *str)
+{
+    gpointer key;
+    gpointer refs;
+
+    if (!str)
+        return NULL;
+
+    virMutexLock(&virStringInternLock);
+
+    if (!virStringInternTable)
+        virStringInternTable = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                     g_free, NULL);
+
+    if (g_hash_table_lookup_extended(virStringInternTable, str, &key, &refs)) {
+        g_hash_table_insert(virStringInternTable, key,
+                            GUINT_TO_POINTER(GPOINTER_TO_UINT(refs) + 1));
+    } else {
+        key = g_strdup(str);
+        g_hash_table_insert(virStringInternTable, key, GUINT_TO_POINTER(1));
+    }
+
+    virMutexUnlock(&virStringInternLock);
+
+    return key;
+}
+
+
+/**
+ * virStringInternRelease:
+ * @str: string returned by virStringIntern(), may be NULL
+ *
+ * Drops a reference to an interned string, freeing it once the last
+ * reference is gone.
+ */
+void
+virStringInternRelease(char *str)
+{
+    gpointer key;
+    gpointer refs;
+
+    if (!str)
+        return;
+
+    virMutexLock(&virStringInternLock);
+
+    if (!virStringInternTable ||
+        !g_hash_table_lookup_extended(virStringInternTable, str, &key, &refs) ||
+        key != str) {
+        virMutexUnlock(&virStringInternLock);
+        VIR_WARN("Releasing string '%s' which was not interned", str);
+        return;
+    }
+
+    if (GPOINTER_TO_UINT(refs) > 1)
+        g_hash_table_insert(virStringInternTable, key,
+                            GUINT_TO_POINTER(GPOINTER_TO_UINT(refs) - 1));
+    else
+        g_hash_table_remove(virStringInternTable, key);
+
+    virMutexUnlock(&virStringInternLock);
+}
+
+
 /**
  * virStringParseYesNo:
  * @str: "yes|no" to parse, must not be NULL.
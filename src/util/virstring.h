@@ -135,3 +135,6 @@ int virStringParsePort(const char *str,
 int virStringParseYesNo(const char *str,
                         bool *result)
     G_GNUC_WARN_UNUSED_RESULT;
+
+char *virStringIntern(const char *str);
+void virStringInternRelease(char *str);
@@ -600,12 +600,11 @@ int virSystemdTerminateMachine(const char *name)
     return 0;
 }
 
-void
-virSystemdNotifyStartup(void)
+static void
+virSystemdNotify(const char *msg)
 {
 #ifndef WIN32
     const char *path;
-    const char *msg = "READY=1";
     int fd;
     struct sockaddr_un un = {
         .sun_family = AF_UNIX,
@@ -650,6 +649,34 @@ virSystemdNotifyStartup(void)
 #endif /* !WIN32 */
 }
 
+void
+virSystemdNotifyStartup(void)
+{
+    virSystemdNotify("READY=1");
+}
+
+/**
+ * virSystemdNotifyStatus:
+ * @fmt: printf-style format of the status message
+ *
+ * Tell the service manager a free-form status of the daemon, which is
+ * shown e.g. by 'systemctl status'.
+ */
+void
+virSystemdNotifyStatus(const char *fmt, ...)
+{
+    g_autofree char *status = NULL;
+    g_autofree char *msg = NULL;
+    va_list ap;
+
+    va_start(ap, fmt);
+    status = g_strdup_vprintf(fmt, ap);
+    va_end(ap);
+
+    msg = g_strdup_printf("STATUS=%s", status);
+    virSystemdNotify(msg);
+}
+
 static int
 virSystemdPMSupportTarget(const char *methodName, bool *result)
 {
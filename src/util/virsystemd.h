@@ -55,6 +55,7 @@ int virSystemdCreateMachine(const char *name,
 int virSystemdTerminateMachine(const char *name);
 
 void virSystemdNotifyStartup(void);
+void virSystemdNotifyStatus(const char *fmt, ...) G_GNUC_PRINTF(1, 2);
 
 int virSystemdHasMachined(void);
 
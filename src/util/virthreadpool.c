@@ -33,16 +33,35 @@ typedef struct _virThreadPoolJob virThreadPoolJob;
 struct _virThreadPoolJob {
     virThreadPoolJob *prev;
     virThreadPoolJob *next;
-    unsigned int priority;
+    /* Links among priority jobs only */
+    virThreadPoolJob *prevPrio;
+    virThreadPoolJob *nextPrio;
+    bool priority;
+    bool limited;
+    unsigned long long queued; /* monotonic time of submission */
 
     void *data;
 };
 
+/* Lives on the stack of a worker while it runs a job */
+typedef struct _virThreadPoolRunningJob virThreadPoolRunningJob;
+struct _virThreadPoolRunningJob {
+    virThreadPoolRunningJob *prev;
+    virThreadPoolRunningJob *next;
+    unsigned long long started;
+};
+
+static const unsigned long long
+virThreadPoolWaitBucketBound[VIR_THREAD_POOL_WAIT_BUCKETS] = {
+    100, 1000, 10 * 1000, 100 * 1000, 1000 * 1000, 0,
+};
+
 typedef struct _virThreadPoolJobList virThreadPoolJobList;
 struct _virThreadPoolJobList {
     virThreadPoolJob *head;
     virThreadPoolJob *tail;
     virThreadPoolJob *firstPrio;
+    virThreadPoolJob *lastPrio;
 };
 
 
@@ -71,6 +90,15 @@ struct _virThreadPool {
     size_t nPrioWorkers;
     virThread *prioWorkers;
     virCond prioCond;
+
+    /* Quota of ordinary workers that may run limited jobs at once */
+    size_t maxLimitedWorkers;
+    size_t nLimitedActive;
+    size_t limitedJobQueueDepth;
+
+    /* Jobs being run right now, and statistics of the finished ones */
+    virThreadPoolRunningJob *running;
+    virThreadPoolStats stats;
 };
 
 struct virThreadPoolWorkerData {
@@ -87,6 +115,73 @@ static inline bool virThreadPoolWorkerQuitHelper(size_t count, size_t limit)
     return count > limit;
 }
 
+static void
+virThreadPoolJobStarted(virThreadPool *pool,
+                        virThreadPoolJob *job,
+                        virThreadPoolRunningJob *running)
+{
+    unsigned long long wait;
+    size_t i;
+
+    running->started = g_get_monotonic_time();
+    running->prev = NULL;
+    running->next = pool->running;
+    if (pool->running)
+        pool->running->prev = running;
+    pool->running = running;
+
+    wait = running->started - job->queued;
+    pool->stats.waitTime += wait;
+    pool->stats.waitTimeMax = MAX(pool->stats.waitTimeMax, wait);
+
+    for (i = 0; i < VIR_THREAD_POOL_WAIT_BUCKETS - 1; i++) {
+        if (wait <= virThreadPoolWaitBucketBound[i])
+            break;
+    }
+    pool->stats.waitBucket[i]++;
+}
+
+static void
+virThreadPoolJobFinished(virThreadPool *pool,
+                         virThreadPoolRunningJob *running)
+{
+    unsigned long long runTime = g_get_monotonic_time() - running->started;
+
+    if (running->prev)
+        running->prev->next = running->next;
+    else
+        pool->running = running->next;
+    if (running->next)
+        running->next->prev = running->prev;
+
+    pool->stats.jobsCompleted++;
+    pool->stats.runTime += runTime;
+    pool->stats.runTimeMax = MAX(pool->stats.runTimeMax, runTime);
+}
+
+/* Find the next job a worker may pick up. Ordinary workers skip limited
+ * jobs while the limited quota is exhausted, priority workers are there
+ * to run priority jobs no matter what and are not subject to it.
+ */
+static virThreadPoolJob *
+virThreadPoolNextJob(virThreadPool *pool,
+                     bool priority)
+{
+    virThreadPoolJob *job;
+
+    if (priority)
+        return pool->jobList.firstPrio;
+
+    for (job = pool->jobList.head; job; job = job->next) {
+        if (!job->limited ||
+            pool->maxLimitedWorkers == 0 ||
+            pool->nLimitedActive < pool->maxLimitedWorkers)
+            return job;
+    }
+
+    return NULL;
+}
+
 static void virThreadPoolWorker(void *opaque)
 {
     struct virThreadPoolWorkerData *data = opaque;
@@ -96,6 +191,8 @@ static void virThreadPoolWorker(void *opaque)
     size_t *curWorkers = priority ? &pool->nPrioWorkers : &pool->nWorkers;
     size_t *maxLimit = priority ? &pool->maxPrioWorkers : &pool->maxWorkers;
     virThreadPoolJob *job = NULL;
+    virThreadPoolRunningJob running;
+    bool limited;
 
     VIR_FREE(data);
 
@@ -114,8 +211,7 @@ static void virThreadPoolWorker(void *opaque)
         if (virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
             goto out;
         while (!pool->quit &&
-               ((!priority && !pool->jobList.head) ||
-                (priority && !pool->jobList.firstPrio))) {
+               !(job = virThreadPoolNextJob(pool, priority))) {
             if (!priority)
                 pool->freeWorkers++;
             if (virCondWait(cond, &pool->mutex) < 0) {
@@ -133,20 +229,15 @@ static void virThreadPoolWorker(void *opaque)
         if (pool->quit)
             break;
 
-        if (priority) {
-            job = pool->jobList.firstPrio;
-        } else {
-            job = pool->jobList.head;
-        }
-
-        if (job == pool->jobList.firstPrio) {
-            virThreadPoolJob *tmp = job->next;
-            while (tmp) {
-                if (tmp->priority)
-                    break;
-                tmp = tmp->next;
-            }
-            pool->jobList.firstPrio = tmp;
+        if (job->priority) {
+            if (job->prevPrio)
+                job->prevPrio->nextPrio = job->nextPrio;
+            else
+                pool->jobList.firstPrio = job->nextPrio;
+            if (job->nextPrio)
+                job->nextPrio->prevPrio = job->prevPrio;
+            else
+                pool->jobList.lastPrio = job->prevPrio;
         }
 
         if (job->prev)
@@ -160,10 +251,27 @@ static void virThreadPoolWorker(void *opaque)
 
         pool->jobQueueDepth--;
 
+        if (job->limited) {
+            pool->limitedJobQueueDepth--;
+            pool->nLimitedActive++;
+        }
+
+        limited = job->limited;
+        virThreadPoolJobStarted(pool, job, &running);
+
         virMutexUnlock(&pool->mutex);
         (pool->jobFunc)(job->data, pool->jobOpaque);
         VIR_FREE(job);
         virMutexLock(&pool->mutex);
+
+        virThreadPoolJobFinished(pool, &running);
+
+        if (limited) {
+            pool->nLimitedActive--;
+            /* A limited job held back by the quota may be runnable now */
+            if (pool->limitedJobQueueDepth > 0)
+                virCondSignal(&pool->cond);
+        }
     }
 
  out:
@@ -389,15 +497,73 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPool *pool)
     return ret;
 }
 
+size_t virThreadPoolGetMaxLimitedWorkers(virThreadPool *pool)
+{
+    size_t ret;
+
+    virMutexLock(&pool->mutex);
+    ret = pool->maxLimitedWorkers;
+    virMutexUnlock(&pool->mutex);
+
+    return ret;
+}
+
+size_t virThreadPoolGetLimitedJobQueueDepth(virThreadPool *pool)
+{
+    size_t ret;
+
+    virMutexLock(&pool->mutex);
+    ret = pool->limitedJobQueueDepth;
+    virMutexUnlock(&pool->mutex);
+
+    return ret;
+}
+
+/**
+ * virThreadPoolGetStats:
+ * @pool: thread pool
+ * @stats: filled with the statistics
+ *
+ * Reports how long jobs had to wait for a worker and how long they ran
+ * since the pool was created, as well as the jobs which have been
+ * running for a long time right now.
+ */
+void
+virThreadPoolGetStats(virThreadPool *pool,
+                      virThreadPoolStats *stats)
+{
+    virThreadPoolRunningJob *running;
+    unsigned long long now = g_get_monotonic_time();
+
+    virMutexLock(&pool->mutex);
+
+    *stats = pool->stats;
+    memcpy(stats->waitBucketBound, virThreadPoolWaitBucketBound,
+           sizeof(stats->waitBucketBound));
+
+    for (running = pool->running; running; running = running->next) {
+        unsigned long long runTime = now - running->started;
+
+        if (runTime > VIR_THREAD_POOL_LONG_RUNNING_JOB)
+            stats->longRunningJobs++;
+        stats->oldestJobRunTime = MAX(stats->oldestJobRunTime, runTime);
+    }
+
+    virMutexUnlock(&pool->mutex);
+}
+
 /*
- * @priority - job priority
+ * @flags - bitwise-OR of virThreadPoolJobFlags
  * Return: 0 on success, -1 otherwise
  */
 int virThreadPoolSendJob(virThreadPool *pool,
-                         unsigned int priority,
+                         unsigned int flags,
                          void *jobData)
 {
     virThreadPoolJob *job;
+    bool priority = !!(flags & VIR_THREAD_POOL_JOB_PRIORITY);
+    bool wakeWorker;
+    bool wakePrioWorker;
 
     virMutexLock(&pool->mutex);
     if (pool->quit)
@@ -411,7 +577,9 @@ int virThreadPoolSendJob(virThreadPool *pool,
     job = g_new0(virThreadPoolJob, 1);
 
     job->data = jobData;
+    job->queued = g_get_monotonic_time();
     job->priority = priority;
+    job->limited = !!(flags & VIR_THREAD_POOL_JOB_LIMITED);
 
     job->prev = pool->jobList.tail;
     if (pool->jobList.tail)
@@ -421,16 +589,32 @@ int virThreadPoolSendJob(virThreadPool *pool,
     if (!pool->jobList.head)
         pool->jobList.head = job;
 
-    if (priority && !pool->jobList.firstPrio)
-        pool->jobList.firstPrio = job;
+    if (priority) {
+        job->prevPrio = pool->jobList.lastPrio;
+        if (pool->jobList.lastPrio)
+            pool->jobList.lastPrio->nextPrio = job;
+        else
+            pool->jobList.firstPrio = job;
+        pool->jobList.lastPrio = job;
+    }
 
     pool->jobQueueDepth++;
+    if (job->limited)
+        pool->limitedJobQueueDepth++;
 
-    virCondSignal(&pool->cond);
-    if (priority)
-        virCondSignal(&pool->prioCond);
+    /* Workers check the queue before they wait, so only wake one up if
+     * there is any waiting. Do so after unlocking so that the woken up
+     * worker does not immediately block on the mutex. */
+    wakeWorker = pool->freeWorkers > 0;
+    wakePrioWorker = priority && pool->nPrioWorkers > 0;
 
     virMutexUnlock(&pool->mutex);
+
+    if (wakeWorker)
+        virCondSignal(&pool->cond);
+    if (wakePrioWorker)
+        virCondSignal(&pool->prioCond);
+
     return 0;
 
  error:
@@ -442,7 +626,8 @@ int
 virThreadPoolSetParameters(virThreadPool *pool,
                            long long int minWorkers,
                            long long int maxWorkers,
-                           long long int prioWorkers)
+                           long long int prioWorkers,
+                           long long int limitedWorkers)
 {
     size_t max;
     size_t min;
@@ -489,6 +674,11 @@ virThreadPoolSetParameters(virThreadPool *pool,
         pool->maxPrioWorkers = prioWorkers;
     }
 
+    if (limitedWorkers >= 0) {
+        pool->maxLimitedWorkers = limitedWorkers;
+        virCondBroadcast(&pool->cond);
+    }
+
     virMutexUnlock(&pool->mutex);
     return 0;
 
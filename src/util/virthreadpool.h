@@ -28,6 +28,35 @@ typedef struct _virThreadPool virThreadPool;
 
 typedef void (*virThreadPoolJobFunc)(void *jobdata, void *opaque);
 
+typedef enum {
+    /* Job may also be run by priority workers */
+    VIR_THREAD_POOL_JOB_PRIORITY = (1 << 0),
+    /* Job counts against the limited workers quota */
+    VIR_THREAD_POOL_JOB_LIMITED = (1 << 1),
+} virThreadPoolJobFlags;
+
+/* Number of buckets of the job wait time histogram */
+#define VIR_THREAD_POOL_WAIT_BUCKETS 6
+
+typedef struct _virThreadPoolStats virThreadPoolStats;
+struct _virThreadPoolStats {
+    unsigned long long jobsCompleted;
+    /* Times are in microseconds */
+    unsigned long long waitTime;        /* sum of time jobs spent queued */
+    unsigned long long waitTimeMax;
+    unsigned long long runTime;         /* sum of time jobs spent running */
+    unsigned long long runTimeMax;
+    /* Upper bound of each wait time bucket, 0 for the last unbounded one */
+    unsigned long long waitBucketBound[VIR_THREAD_POOL_WAIT_BUCKETS];
+    unsigned long long waitBucket[VIR_THREAD_POOL_WAIT_BUCKETS];
+    /* Jobs currently running for longer than
+     * VIR_THREAD_POOL_LONG_RUNNING_JOB microseconds */
+    size_t longRunningJobs;
+    unsigned long long oldestJobRunTime;
+};
+
+#define VIR_THREAD_POOL_LONG_RUNNING_JOB (1000 * 1000)
+
 virThreadPool *virThreadPoolNewFull(size_t minWorkers,
                                     size_t maxWorkers,
                                     size_t prioWorkers,
@@ -42,18 +71,23 @@ size_t virThreadPoolGetPriorityWorkers(virThreadPool *pool);
 size_t virThreadPoolGetCurrentWorkers(virThreadPool *pool);
 size_t virThreadPoolGetFreeWorkers(virThreadPool *pool);
 size_t virThreadPoolGetJobQueueDepth(virThreadPool *pool);
+size_t virThreadPoolGetMaxLimitedWorkers(virThreadPool *pool);
+size_t virThreadPoolGetLimitedJobQueueDepth(virThreadPool *pool);
+void virThreadPoolGetStats(virThreadPool *pool,
+                           virThreadPoolStats *stats);
 
 void virThreadPoolFree(virThreadPool *pool);
 
 int virThreadPoolSendJob(virThreadPool *pool,
-                         unsigned int priority,
+                         unsigned int flags,
                          void *jobdata) ATTRIBUTE_NONNULL(1)
                                         G_GNUC_WARN_UNUSED_RESULT;
 
 int virThreadPoolSetParameters(virThreadPool *pool,
                                long long int minWorkers,
                                long long int maxWorkers,
-                               long long int prioWorkers);
+                               long long int prioWorkers,
+                               long long int limitedWorkers);
 
 void virThreadPoolStop(virThreadPool *pool);
 void virThreadPoolDrain(virThreadPool *pool);
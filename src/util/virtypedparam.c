@@ -739,11 +739,37 @@ virTypedParamListStealParams(virTypedParamList *list,
 }
 
 
+/**
+ * virTypedParamListReserve:
+ * @list: typed parameter list
+ * @count: number of parameters
+ *
+ * Make room for at least @count more parameters in @list so that adding
+ * them does not need to grow the list repeatedly.
+ */
+void
+virTypedParamListReserve(virTypedParamList *list,
+                         size_t count)
+{
+    VIR_RESIZE_N(list->par, list->par_alloc, list->npar, count);
+}
+
+
 static int G_GNUC_PRINTF(2, 0)
 virTypedParamSetNameVPrintf(virTypedParameterPtr par,
                             const char *fmt,
                             va_list ap)
 {
+    /* Most names are constant, don't bother formatting those */
+    if (!strchr(fmt, '%')) {
+        if (virStrcpyStatic(par->field, fmt) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Field name too long"));
+            return -1;
+        }
+
+        return 0;
+    }
+
     if (g_vsnprintf(par->field, VIR_TYPED_PARAM_FIELD_LENGTH, fmt, ap) > VIR_TYPED_PARAM_FIELD_LENGTH) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Field name too long"));
         return -1;
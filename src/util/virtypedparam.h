@@ -138,6 +138,9 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(virTypedParamList, virTypedParamListFree);
 size_t virTypedParamListStealParams(virTypedParamList *list,
                                     virTypedParameterPtr *params);
 
+void virTypedParamListReserve(virTypedParamList *list,
+                              size_t count);
+
 int virTypedParamListAddInt(virTypedParamList *list,
                             int value,
                             const char *namefmt,
@@ -1117,14 +1117,19 @@ virXMLParseHelper(int domcode,
     pctxt->_private = &private;
     pctxt->sax->error = catchXMLError;
 
+    /* XML_PARSE_COMPACT stores short text, which covers nearly every
+     * attribute value in the XML we parse, inside the node itself instead
+     * of allocating it separately. */
     if (filename) {
         xml = xmlCtxtReadFile(pctxt, filename, NULL,
                               XML_PARSE_NONET |
-                              XML_PARSE_NOWARNING);
+                              XML_PARSE_NOWARNING |
+                              XML_PARSE_COMPACT);
     } else {
         xml = xmlCtxtReadDoc(pctxt, BAD_CAST xmlStr, url, NULL,
                              XML_PARSE_NONET |
-                             XML_PARSE_NOWARNING);
+                             XML_PARSE_NOWARNING |
+                             XML_PARSE_COMPACT);
     }
 
     if (!xml) {
@@ -1260,6 +1265,29 @@ virXMLSaveFile(const char *path,
     return virFileRewrite(path, S_IRUSR | S_IWUSR, virXMLRewriteFile, &data);
 }
 
+/**
+ * virXMLSaveFileBatch:
+ *
+ * Like virXMLSaveFile, but the file is only replaced once @batch is
+ * committed, see virFileRewriteBatchNew. Saves the file right away if
+ * @batch is NULL.
+ */
+int
+virXMLSaveFileBatch(virFileRewriteBatch *batch,
+                    const char *path,
+                    const char *warnName,
+                    const char *warnCommand,
+                    const char *xml)
+{
+    struct virXMLRewriteFileData data = { warnName, warnCommand, xml };
+
+    if (!batch)
+        return virXMLSaveFile(path, warnName, warnCommand, xml);
+
+    return virFileRewriteBatchAdd(batch, path, S_IRUSR | S_IWUSR,
+                                  virXMLRewriteFile, &data);
+}
+
 /**
  * virXMLNodeToString: convert an XML node ptr to an XML string
  *
@@ -1297,6 +1325,65 @@ virXMLNodeNameEqual(xmlNodePtr node,
 }
 
 
+/**
+ * virXMLNodeGetSubelement:
+ * @node: node to get subelement of
+ * @name: name of subelement to fetch
+ *
+ * Find and return the first sub-element node of @node named @name. This
+ * is a cheaper replacement for an XPath lookup of "./@name".
+ */
+xmlNodePtr
+virXMLNodeGetSubelement(xmlNodePtr node,
+                        const char *name)
+{
+    xmlNodePtr n;
+
+    for (n = node->children; n; n = n->next) {
+        if (n->type == XML_ELEMENT_NODE &&
+            virXMLNodeNameEqual(n, name))
+            return n;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * virXMLNodeGetSubelementList:
+ * @node: node to get subelement of
+ * @name: name of subelement to fetch (NULL to fetch all sub-elements)
+ * @list: If non-NULL, filled with a list of pointers to the nodes. Caller is
+ *        responsible for freeing the list but not the members.
+ *
+ * Find and return sub-elements node of @node named @name in a list.
+ * Returns the number of subelement nodes found (or 0 if none were found).
+ */
+size_t
+virXMLNodeGetSubelementList(xmlNodePtr node,
+                            const char *name,
+                            xmlNodePtr **list)
+{
+    xmlNodePtr n;
+    size_t nelems = 0;
+
+    for (n = node->children; n; n = n->next) {
+        if (n->type != XML_ELEMENT_NODE)
+            continue;
+
+        if (name && !virXMLNodeNameEqual(n, name))
+            continue;
+
+        if (list)
+            VIR_APPEND_ELEMENT_COPY(*list, nelems, n);
+        else
+            nelems++;
+    }
+
+    return nelems;
+}
+
+
 typedef int (*virXMLForeachCallback)(xmlNodePtr node,
                                      void *opaque);
 
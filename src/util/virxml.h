@@ -29,6 +29,7 @@
 
 #include "virbuffer.h"
 #include "virenum.h"
+#include "virfile.h"
 
 xmlXPathContextPtr virXMLXPathContextNew(xmlDocPtr xml)
     G_GNUC_WARN_UNUSED_RESULT;
@@ -265,6 +266,13 @@ virXMLSaveFile(const char *path,
                const char *warnCommand,
                const char *xml);
 
+int
+virXMLSaveFileBatch(virFileRewriteBatch *batch,
+                    const char *path,
+                    const char *warnName,
+                    const char *warnCommand,
+                    const char *xml);
+
 char *
 virXMLNodeToString(xmlDocPtr doc,
                    xmlNodePtr node);
@@ -273,6 +281,15 @@ bool
 virXMLNodeNameEqual(xmlNodePtr node,
                     const char *name);
 
+xmlNodePtr
+virXMLNodeGetSubelement(xmlNodePtr node,
+                        const char *name);
+
+size_t
+virXMLNodeGetSubelementList(xmlNodePtr node,
+                            const char *name,
+                            xmlNodePtr **list);
+
 xmlNodePtr
 virXMLFindChildNodeByNs(xmlNodePtr root,
                         const char *uri);
@@ -243,6 +243,7 @@ mymain(void)
     DO_TEST_BACKUP("backup-push");
     DO_TEST_BACKUP("backup-push-seclabel");
     DO_TEST_BACKUP("backup-push-encrypted");
+    DO_TEST_BACKUP("backup-push-network");
 
     DO_TEST_BACKUP_FULL("backup-pull-internal-invalid", true);
 
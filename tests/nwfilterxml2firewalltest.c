@@ -341,7 +341,10 @@ static int testSetDefaultParameters(GHashTable *vars)
         testSetOneParameter(vars, "C", "1080") ||
         testSetOneParameter(vars, "C", "1090") ||
         testSetOneParameter(vars, "C", "1100") ||
-        testSetOneParameter(vars, "C", "1110"))
+        testSetOneParameter(vars, "C", "1110") ||
+        testSetOneParameter(vars, "M", "52:54:00:00:00:01") ||
+        testSetOneParameter(vars, "M", "52:54:00:00:00:02") ||
+        testSetOneParameter(vars, "M", "52:54:00:00:00:03"))
         return -1;
     return 0;
 }
@@ -368,7 +371,7 @@ static int testCompareXMLToArgvFiles(const char *xml,
                              &inst) < 0)
         goto cleanup;
 
-    if (ebiptables_driver.applyNewRules("vnet0", inst.rules, inst.nrules) < 0)
+    if (ebiptables_driver.applyNewRules("vnet0", inst.rules, inst.nrules, NULL) < 0)
         goto cleanup;
 
     actualargv = virBufferContentAndReset(&buf);
@@ -455,6 +458,7 @@ mymain(void)
     DO_TEST("iter2");
     DO_TEST("iter3");
     DO_TEST("mac");
+    DO_TEST("mac-list");
     DO_TEST("rarp");
     DO_TEST("sctp");
     DO_TEST("sctp-ipv6");
@@ -1406,6 +1406,76 @@ testQemuAgentTimezone(const void *data)
     virTypedParamsFree(params, nparams);
     return ret;
 }
+static int
+testQemuAgentPrefetch(const void *data)
+{
+    virDomainXMLOption *xmlopt = (virDomainXMLOption *)data;
+    g_autoptr(qemuMonitorTest) test = qemuMonitorTestNewAgent(xmlopt);
+    const char *cmdnames[] = { "guest-get-users", "guest-get-osinfo" };
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    int maxparams = 0;
+    unsigned int count;
+    const char *osid = NULL;
+    int ret = -1;
+
+    if (!test)
+        return -1;
+
+    /* Both commands are sent after a single guest-sync */
+    if (qemuMonitorTestAddAgentSyncResponse(test) < 0)
+        goto cleanup;
+
+    if (qemuMonitorTestAddItem(test, "guest-get-users",
+                               testQemuAgentUsersResponse) < 0)
+        goto cleanup;
+
+    if (qemuMonitorTestAddItem(test, "guest-get-osinfo",
+                               testQemuAgentOSInfoResponse) < 0)
+        goto cleanup;
+
+    if (qemuAgentPrefetch(qemuMonitorTestGetAgent(test),
+                          cmdnames, G_N_ELEMENTS(cmdnames)) < 0)
+        goto cleanup;
+
+    /* Neither of these may talk to the agent anymore */
+    if (qemuAgentGetOSInfo(qemuMonitorTestGetAgent(test),
+                           &params, &nparams, &maxparams, true) < 0)
+        goto cleanup;
+
+    if (qemuAgentGetUsers(qemuMonitorTestGetAgent(test),
+                          &params, &nparams, &maxparams, true) < 0)
+        goto cleanup;
+
+    qemuAgentPrefetchClear(qemuMonitorTestGetAgent(test));
+
+    if (virTypedParamsGetUInt(params, nparams, "user.count", &count) < 0)
+        goto cleanup;
+    if (count != 2) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "Expected '2' users, got '%u'", count);
+        goto cleanup;
+    }
+
+    if (checkUserInfo(params, nparams, 0, "test", NULL, 1561739203584) < 0 ||
+        checkUserInfo(params, nparams, 1, "test2", NULL, 1561739229190) < 0)
+        goto cleanup;
+
+    if (virTypedParamsGetString(params, nparams, "os.id", &osid) < 0 ||
+        STRNEQ_NULLABLE(osid, "centos")) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "Expected os.id 'centos', got '%s'", NULLSTR(osid));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -1434,6 +1504,7 @@ mymain(void)
     DO_TEST(Timezone);
     DO_TEST(SSHKeys);
     DO_TEST(GetDisks);
+    DO_TEST(Prefetch);
 
     DO_TEST(Timeout); /* Timeout should always be called last */
 
@@ -781,7 +781,10 @@ testQemuCheckpointDelete(const void *opaque)
     g_autoptr(virJSONValue) nodedatajson = NULL;
     g_autoptr(GHashTable) nodedata = NULL;
     g_autoptr(GSList) reopenimages = NULL;
+    g_auto(GStrv) delbitmaps = NULL;
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    GStrv next;
+    int rc = 0;
 
     expectpath = g_strdup_printf("%s/%s%s-out.json", abs_srcdir,
                                  checkpointDeletePrefix, data->name);
@@ -797,12 +800,18 @@ testQemuCheckpointDelete(const void *opaque)
 
     actions = virJSONValueNewArray();
 
-    if (qemuCheckpointDiscardDiskBitmaps(data->chain,
-                                         nodedata,
-                                         data->deletebitmap,
-                                         actions,
-                                         "testdisk",
-                                         &reopenimages) >= 0) {
+    /* multiple bitmaps separated by commas are removed in one transaction */
+    delbitmaps = g_strsplit(data->deletebitmap, ",", 0);
+
+    for (next = delbitmaps; *next && rc >= 0; next++)
+        rc = qemuCheckpointDiscardDiskBitmaps(data->chain,
+                                              nodedata,
+                                              *next,
+                                              actions,
+                                              "testdisk",
+                                              &reopenimages);
+
+    if (rc >= 0) {
         if (virJSONValueToBuffer(actions, &buf, true) < 0)
             return -1;
     } else {
@@ -1276,6 +1285,7 @@ mymain(void)
     TEST_CHECKPOINT_DELETE("snapshots-intermediate2", "c", "snapshots");
     TEST_CHECKPOINT_DELETE("snapshots-intermediate3", "d", "snapshots");
     TEST_CHECKPOINT_DELETE("snapshots-current", "current", "snapshots");
+    TEST_CHECKPOINT_DELETE("snapshots-multiple", "b,c,d", "snapshots");
 
     TEST_CHECKPOINT_DELETE("synthetic-noparent", "a", "synthetic");
     TEST_CHECKPOINT_DELETE("synthetic-intermediate1", "b", "synthetic");
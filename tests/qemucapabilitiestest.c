@@ -140,7 +140,10 @@ testQemuCapsCopy(const void *opaque)
     g_autofree char *capsFile = NULL;
     g_autoptr(virQEMUCaps) orig = NULL;
     g_autoptr(virQEMUCaps) copy = NULL;
+    g_autoptr(virQEMUCaps) shared = NULL;
     g_autofree char *actual = NULL;
+    g_autofree char *actualShared = NULL;
+    g_autofree char *actualOrig = NULL;
 
     capsFile = g_strdup_printf("%s/%s_%s.%s.xml",
                                data->outputDir, data->prefix, data->version,
@@ -159,6 +162,60 @@ testQemuCapsCopy(const void *opaque)
     if (virTestCompareToFile(actual, capsFile) < 0)
         return -1;
 
+    if (!(shared = virQEMUCapsNewCopyShared(orig)))
+        return -1;
+
+    if (!(actualShared = virQEMUCapsFormatCache(shared)))
+        return -1;
+
+    if (virTestCompareToFile(actualShared, capsFile) < 0)
+        return -1;
+
+    /* Modifying the shared copy must leave the original intact */
+    virQEMUCapsStripMachineAliases(shared);
+
+    if (!(actualOrig = virQEMUCapsFormatCache(orig)))
+        return -1;
+
+    if (virTestCompareToFile(actualOrig, capsFile) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testQemuCapsBinary(const void *opaque)
+{
+    const testQemuData *data = opaque;
+    virArch arch = virArchFromString(data->archName);
+    g_autofree char *capsFile = NULL;
+    g_autoptr(virQEMUCaps) orig = NULL;
+    g_autoptr(virQEMUCaps) loaded = NULL;
+    g_autoptr(GByteArray) bin = NULL;
+    g_autofree char *actual = NULL;
+
+    capsFile = g_strdup_printf("%s/%s_%s.%s.xml",
+                               data->outputDir, data->prefix, data->version,
+                               data->archName);
+
+    if (!(orig = qemuTestParseCapabilitiesArch(arch, capsFile)))
+        return -1;
+
+    if (!(bin = virQEMUCapsFormatCacheBinary(orig)))
+        return -1;
+
+    if (!(loaded = virQEMUCapsNewBinary(virQEMUCapsGetBinary(orig))) ||
+        virQEMUCapsLoadCacheBinaryData(arch, loaded, (const char *) bin->data,
+                                       bin->len, true) < 0)
+        return -1;
+
+    if (!(actual = virQEMUCapsFormatCache(loaded)))
+        return -1;
+
+    if (virTestCompareToFile(actual, capsFile) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -174,9 +231,11 @@ doCapsTest(const char *inputDir,
     testQemuData *data = (testQemuData *) opaque;
     g_autofree char *title = NULL;
     g_autofree char *copyTitle = NULL;
+    g_autofree char *binaryTitle = NULL;
 
     title = g_strdup_printf("%s (%s)", version, archName);
     copyTitle = g_strdup_printf("copy %s (%s)", version, archName);
+    binaryTitle = g_strdup_printf("binary %s (%s)", version, archName);
 
     data->inputDir = inputDir;
     data->prefix = prefix;
@@ -190,6 +249,9 @@ doCapsTest(const char *inputDir,
     if (virTestRun(copyTitle, testQemuCapsCopy, data) < 0)
         data->ret = -1;
 
+    if (virTestRun(binaryTitle, testQemuCapsBinary, data) < 0)
+        data->ret = -1;
+
     return 0;
 }
 
@@ -80,30 +80,31 @@ qemuMonitorSend(qemuMonitor *mon,
 
 static int (*realQemuMonitorJSONIOProcessLine)(qemuMonitor *mon,
                                                const char *line,
-                                               qemuMonitorMessage *msg);
+                                               virJSONValue **obj);
 
 int
 qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
                              const char *line,
-                             qemuMonitorMessage *msg)
+                             virJSONValue **obj)
 {
-    g_autoptr(virJSONValue) value = NULL;
     g_autofree char *json = NULL;
+    bool greeting;
     int ret;
 
     REAL_SYM(realQemuMonitorJSONIOProcessLine);
 
-    ret = realQemuMonitorJSONIOProcessLine(mon, line, msg);
+    /* the real function may steal @obj */
+    if (!(json = virJSONValueToString(*obj, true))) {
+        fprintf(stderr, "Failed to reformat reply string '%s'\n", line);
+        abort();
+    }
+    greeting = virJSONValueObjectHasKey(*obj, "QMP") == 1;
 
-    if (ret == 0) {
-        if (!(value = virJSONValueFromString(line)) ||
-            !(json = virJSONValueToString(value, true))) {
-            fprintf(stderr, "Failed to reformat reply string '%s'\n", line);
-            abort();
-        }
+    ret = realQemuMonitorJSONIOProcessLine(mon, line, obj);
 
+    if (ret == 0) {
         /* Ignore QMP greeting */
-        if (virJSONValueObjectHasKey(value, "QMP"))
+        if (greeting)
             return 0;
 
         if (first)
@@ -0,0 +1,190 @@
+/*
+ * qemumonitorbench.c: benchmarks of QMP command building and reply parsing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "testutilsqemu.h"
+#include "qemumonitortestutils.h"
+#include "qemu/qemu_block.h"
+#include "qemu/qemu_qapi.h"
+#define LIBVIRT_QEMU_CAPSPRIV_H_ALLOW
+#include "qemu/qemu_capspriv.h"
+#define LIBVIRT_QEMU_MONITOR_PRIV_H_ALLOW
+#include "qemu/qemu_monitor_priv.h"
+#define LIBVIRT_QEMU_PROCESSPRIV_H_ALLOW
+#include "qemu/qemu_processpriv.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+typedef struct _benchCapsData benchCapsData;
+struct _benchCapsData {
+    virQEMUDriver *driver;
+    const char *arch;
+    char *repliesFile;
+};
+
+
+/*
+ * Replays a whole capabilities probe, which builds all the probing commands
+ * and parses their replies, including query-qmp-schema and
+ * query-cpu-model-expansion.
+ */
+static int
+benchCapsProbe(void *opaque)
+{
+    benchCapsData *data = opaque;
+    g_autoptr(qemuMonitorTest) mon = NULL;
+    g_autoptr(virQEMUCaps) caps = NULL;
+    g_autofree char *binary = g_strdup_printf("/usr/bin/qemu-system-%s",
+                                              data->arch);
+
+    if (!(mon = qemuMonitorTestNewFromFileFull(data->repliesFile, data->driver,
+                                               NULL, NULL)))
+        return -1;
+
+    if (qemuProcessQMPInitMonitor(qemuMonitorTestGetMonitor(mon)) < 0)
+        return -1;
+
+    if (!(caps = virQEMUCapsNewBinary(binary)) ||
+        virQEMUCapsInitQMPMonitor(caps, qemuMonitorTestGetMonitor(mon)) < 0)
+        return -1;
+
+    if (virQEMUCapsGet(caps, QEMU_CAPS_KVM)) {
+        qemuMonitorResetCommandID(qemuMonitorTestGetMonitor(mon));
+
+        if (qemuProcessQMPInitMonitor(qemuMonitorTestGetMonitor(mon)) < 0 ||
+            virQEMUCapsInitQMPMonitorTCG(caps, qemuMonitorTestGetMonitor(mon)) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+benchSchemaConvert(void *opaque)
+{
+    const char *reply = opaque;
+    g_autoptr(virJSONValue) json = NULL;
+    g_autoptr(GHashTable) schema = NULL;
+    virJSONValue *data;
+
+    if (!(json = virJSONValueFromString(reply)) ||
+        !(data = virJSONValueObjectStealArray(json, "return")) ||
+        !(schema = virQEMUQAPISchemaConvert(data)))
+        return -1;
+
+    return 0;
+}
+
+
+typedef struct _benchBlockData benchBlockData;
+struct _benchBlockData {
+    char *namedNodes;
+    char *blockstats;
+};
+
+
+static int
+benchBackingChain(void *opaque)
+{
+    benchBlockData *data = opaque;
+    g_autoptr(virJSONValue) namedNodes = NULL;
+    g_autoptr(virJSONValue) blockstats = NULL;
+    g_autoptr(GHashTable) nodedata = NULL;
+
+    if (!(namedNodes = virJSONValueFromString(data->namedNodes)) ||
+        !(blockstats = virJSONValueFromString(data->blockstats)) ||
+        !(nodedata = qemuBlockNodeNameGetBackingChain(namedNodes, blockstats)))
+        return -1;
+
+    return 0;
+}
+
+
+/* Finds the reply to @command in the QMP replies file loaded into @replies */
+static char *
+benchFindReply(char *replies,
+               const char *command)
+{
+    g_autofree char *execute = g_strdup_printf("\"execute\": \"%s\"", command);
+    char *reply;
+    char *end;
+
+    if (!(reply = strstr(replies, execute)) ||
+        !(reply = strstr(reply, "\n\n")) ||
+        !(end = strstr(reply + 2, "\n\n")))
+        return NULL;
+
+    return g_strndup(reply + 2, end - reply - 2);
+}
+
+
+static int
+mymain(void)
+{
+    virQEMUDriver driver;
+    benchCapsData caps = { .driver = &driver, .arch = "x86_64" };
+    benchBlockData block = { 0 };
+    g_autofree char *replies = NULL;
+    g_autofree char *schemaReply = NULL;
+    g_autofree char *title = NULL;
+    int ret = 0;
+
+    virEventRegisterDefaultImpl();
+
+    if (qemuTestDriverInit(&driver) < 0)
+        return EXIT_FAILURE;
+
+    if (!(caps.repliesFile = testQemuGetLatestCapsForArch(caps.arch, "replies")) ||
+        virTestLoadFile(caps.repliesFile, &replies) < 0 ||
+        !(schemaReply = benchFindReply(replies, "query-qmp-schema"))) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    if (virTestLoadFile(abs_srcdir "/qemumonitorjsondata/qemumonitorjson-nodename-blockjob-named-nodes.json",
+                        &block.namedNodes) < 0 ||
+        virTestLoadFile(abs_srcdir "/qemumonitorjsondata/qemumonitorjson-nodename-blockjob-blockstats.json",
+                        &block.blockstats) < 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+#define DO_BENCH(name, func, opaque) \
+    do { \
+        if (virTestBenchRun(name, func, opaque) < 0) \
+            ret = -1; \
+    } while (0)
+
+    title = g_strdup_printf("caps probe %s", caps.arch);
+    DO_BENCH(title, benchCapsProbe, &caps);
+    DO_BENCH("query-qmp-schema convert", benchSchemaConvert, schemaReply);
+    DO_BENCH("query-named-block-nodes chain", benchBackingChain, &block);
+
+ cleanup:
+    g_free(caps.repliesFile);
+    g_free(block.namedNodes);
+    g_free(block.blockstats);
+    qemuTestDriverFree(&driver);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -1188,6 +1188,8 @@ GEN_TEST_FUNC(qemuMonitorJSONBlockdevTrayClose, "foodev")
 GEN_TEST_FUNC(qemuMonitorJSONBlockdevMediumRemove, "foodev")
 GEN_TEST_FUNC(qemuMonitorJSONBlockdevMediumInsert, "foodev", "newnode")
 GEN_TEST_FUNC(qemuMonitorJSONBitmapRemove, "foodev", "newnode")
+GEN_TEST_FUNC(qemuMonitorJSONBlockJobPause, "jobname")
+GEN_TEST_FUNC(qemuMonitorJSONBlockJobResume, "jobname")
 GEN_TEST_FUNC(qemuMonitorJSONJobDismiss, "jobname")
 GEN_TEST_FUNC(qemuMonitorJSONJobComplete, "jobname")
 GEN_TEST_FUNC(qemuMonitorJSONBlockJobCancel, "jobname", true)
@@ -1225,11 +1227,11 @@ testQemuMonitorJSONqemuMonitorJSONNBDServerStart(const void *opaque)
         return -1;
 
     if (qemuMonitorJSONNBDServerStart(qemuMonitorTestGetMonitor(test),
-                                      &server_tcp, "test-alias") < 0)
+                                      &server_tcp, "test-alias", 0) < 0)
         return -1;
 
     if (qemuMonitorJSONNBDServerStart(qemuMonitorTestGetMonitor(test),
-                                      &server_unix, "test-alias") < 0)
+                                      &server_unix, "test-alias", 4) < 0)
         return -1;
 
     return 0;
@@ -1669,6 +1671,73 @@ testQemuMonitorJSONqemuMonitorJSONGetAllBlockStatsInfo(const void *opaque)
 }
 
 
+static int
+testQemuMonitorJSONqemuMonitorJSONGetAllBlockStatsInfoBlockdev(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    virDomainXMLOption *xmlopt = data->xmlopt;
+    g_autoptr(GHashTable) blockstats = virHashNew(g_free);
+    qemuBlockStats *stats;
+    g_autoptr(qemuMonitorTest) test = NULL;
+
+    const char *statsreply =
+        "{"
+        "    \"return\": ["
+        "        {"
+        "            \"node-name\": \"libvirt-1-format\","
+        "            \"stats\": {"
+        "                \"wr_bytes\": 2845696,"
+        "                \"wr_operations\": 174,"
+        "                \"rd_bytes\": 28505088,"
+        "                \"rd_operations\": 1279"
+        "            }"
+        "        }"
+        "    ]"
+        "}";
+    const char *nodesreply =
+        "{"
+        "    \"return\": ["
+        "        {"
+        "            \"node-name\": \"libvirt-1-format\","
+        "            \"write_threshold\": 1024,"
+        "            \"image\": {"
+        "                \"virtual-size\": 10737418240,"
+        "                \"actual-size\": 200704"
+        "            }"
+        "        }"
+        "    ]"
+        "}";
+
+    if (!(test = qemuMonitorTestNewSchema(xmlopt, data->schema)))
+        return -1;
+
+    /* both commands are sent before any reply is read */
+    if (qemuMonitorTestAddItem(test, "query-blockstats", statsreply) < 0 ||
+        qemuMonitorTestAddItem(test, "query-named-block-nodes", nodesreply) < 0)
+        return -1;
+
+    if (qemuMonitorJSONGetAllBlockStatsInfoBlockdev(qemuMonitorTestGetMonitor(test),
+                                                    blockstats) < 0)
+        return -1;
+
+    if (!(stats = virHashLookup(blockstats, "libvirt-1-format"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "block stats for node 'libvirt-1-format' are missing");
+        return -1;
+    }
+
+    if (stats->rd_req != 1279 || stats->wr_bytes != 2845696 ||
+        stats->capacity != 10737418240ULL || stats->physical != 200704 ||
+        stats->write_threshold != 1024) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "unexpected block stats for node 'libvirt-1-format'");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 testQemuMonitorJSONqemuMonitorJSONGetMigrationCacheSize(const void *opaque)
 {
@@ -2750,7 +2819,8 @@ testQemuMonitorJSONBlockExportAdd(const void *opaque)
     if (!(test = qemuMonitorTestNewSchema(data->xmlopt, data->schema)))
         return -1;
 
-    if (!(nbddata = qemuBlockExportGetNBDProps("nodename", "exportname", true, bitmaps)))
+    if (!(nbddata = qemuBlockExportGetNBDProps("nodename", "exportname", true,
+                                               bitmaps, "iothread1")))
         return -1;
 
     if (qemuMonitorTestAddItem(test, "block-export-add", "{\"return\":{}}") < 0)
@@ -3020,6 +3090,8 @@ mymain(void)
     DO_TEST_GEN(qemuMonitorJSONBlockdevMediumRemove);
     DO_TEST_GEN(qemuMonitorJSONBlockdevMediumInsert);
     DO_TEST_GEN(qemuMonitorJSONBitmapRemove);
+    DO_TEST_GEN(qemuMonitorJSONBlockJobPause);
+    DO_TEST_GEN(qemuMonitorJSONBlockJobResume);
     DO_TEST_GEN(qemuMonitorJSONJobDismiss);
     DO_TEST_GEN(qemuMonitorJSONJobComplete);
     DO_TEST_GEN(qemuMonitorJSONBlockJobCancel);
@@ -3027,6 +3099,7 @@ mymain(void)
     DO_TEST(qemuMonitorJSONGetBalloonInfo);
     DO_TEST(qemuMonitorJSONGetBlockInfo);
     DO_TEST(qemuMonitorJSONGetAllBlockStatsInfo);
+    DO_TEST(qemuMonitorJSONGetAllBlockStatsInfoBlockdev);
     DO_TEST(qemuMonitorJSONGetMigrationCacheSize);
     DO_TEST(qemuMonitorJSONGetMigrationStats);
     DO_TEST(qemuMonitorJSONGetChardevInfo);
@@ -1243,7 +1243,8 @@ mymain(void)
             QEMU_CAPS_OBJECT_MEMORY_MEMFD,
             QEMU_CAPS_OBJECT_MEMORY_MEMFD_HUGETLB,
             QEMU_CAPS_OBJECT_MEMORY_FILE,
-            QEMU_CAPS_DEVICE_NVDIMM);
+            QEMU_CAPS_DEVICE_NVDIMM,
+            QEMU_CAPS_MEMORY_BACKEND_PREALLOC_THREADS);
     DO_TEST("memfd-memory-default-hugepage",
             QEMU_CAPS_OBJECT_MEMORY_MEMFD,
             QEMU_CAPS_OBJECT_MEMORY_MEMFD_HUGETLB,
@@ -0,0 +1,206 @@
+/*
+ * qemuxmlbench.c: benchmarks of parsing and formatting domain XML
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "testutilsqemu.h"
+#include "domain_validate.h"
+#include "virfile.h"
+#include "virstring.h"
+#include "virxml.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static virQEMUDriver driver;
+
+/* The definitions of the corpus which can be parsed with the latest x86_64
+ * capabilities, both as XML text and parsed */
+typedef struct _benchCorpus benchCorpus;
+struct _benchCorpus {
+    GPtrArray *xmls;
+    GPtrArray *defs;
+};
+
+
+static int
+benchXMLParse(void *opaque)
+{
+    benchCorpus *corpus = opaque;
+    size_t i;
+
+    for (i = 0; i < corpus->xmls->len; i++) {
+        g_autoptr(xmlDoc) doc = NULL;
+        g_autoptr(xmlXPathContext) ctxt = NULL;
+
+        if (!(doc = virXMLParseStringCtxt(g_ptr_array_index(corpus->xmls, i),
+                                          "(bench)", &ctxt)))
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+benchDefParse(void *opaque)
+{
+    benchCorpus *corpus = opaque;
+    size_t i;
+
+    for (i = 0; i < corpus->xmls->len; i++) {
+        virDomainDef *def;
+
+        if (!(def = virDomainDefParseString(g_ptr_array_index(corpus->xmls, i),
+                                            driver.xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                            VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE)))
+            return -1;
+
+        virDomainDefFree(def);
+    }
+
+    return 0;
+}
+
+
+static int
+benchDefValidate(void *opaque)
+{
+    benchCorpus *corpus = opaque;
+    size_t i;
+
+    for (i = 0; i < corpus->defs->len; i++) {
+        if (virDomainDefValidate(g_ptr_array_index(corpus->defs, i),
+                                 VIR_DOMAIN_DEF_PARSE_INACTIVE,
+                                 driver.xmlopt, NULL) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+benchDefFormat(void *opaque)
+{
+    benchCorpus *corpus = opaque;
+    size_t i;
+
+    for (i = 0; i < corpus->defs->len; i++) {
+        g_autofree char *xml = NULL;
+
+        if (!(xml = virDomainDefFormat(g_ptr_array_index(corpus->defs, i),
+                                       driver.xmlopt,
+                                       VIR_DOMAIN_DEF_FORMAT_SECURE)))
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+benchCorpusLoad(benchCorpus *corpus,
+                const char *dirname)
+{
+    g_autoptr(DIR) dir = NULL;
+    struct dirent *ent;
+    int rc;
+
+    if (virDirOpen(&dir, dirname) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, dirname)) > 0) {
+        g_autofree char *path = NULL;
+        g_autofree char *xml = NULL;
+        virDomainDef *def;
+
+        if (!virStringHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        path = g_strdup_printf("%s/%s", dirname, ent->d_name);
+
+        if (virTestLoadFile(path, &xml) < 0)
+            return -1;
+
+        /* definitions requiring other capabilities or invalid on purpose
+         * are left out */
+        if (!(def = virDomainDefParseString(xml, driver.xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE))) {
+            virResetLastError();
+            continue;
+        }
+
+        g_ptr_array_add(corpus->xmls, g_steal_pointer(&xml));
+        g_ptr_array_add(corpus->defs, def);
+    }
+
+    return rc;
+}
+
+
+static int
+mymain(void)
+{
+    g_autoptr(GHashTable) capslatest = testQemuGetLatestCaps();
+    g_autoptr(virQEMUCaps) qemuCaps = NULL;
+    benchCorpus corpus = { 0 };
+    int ret = 0;
+
+    if (!capslatest)
+        return EXIT_FAILURE;
+
+    if (qemuTestDriverInit(&driver) < 0)
+        return EXIT_FAILURE;
+
+    corpus.xmls = g_ptr_array_new_with_free_func(g_free);
+    corpus.defs = g_ptr_array_new_with_free_func((GDestroyNotify) virDomainDefFree);
+
+    if (!(qemuCaps = qemuTestParseCapabilitiesArch(VIR_ARCH_X86_64,
+                                                   g_hash_table_lookup(capslatest, "x86_64"))) ||
+        qemuTestCapsCacheInsert(driver.qemuCapsCache, qemuCaps) < 0 ||
+        benchCorpusLoad(&corpus, abs_srcdir "/qemuxml2argvdata") < 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    printf("corpus: %u domain definitions\n", corpus.xmls->len);
+
+#define DO_BENCH(name, func) \
+    do { \
+        if (virTestBenchRun(name, func, &corpus) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_BENCH("corpus XML parse", benchXMLParse);
+    DO_BENCH("corpus parse + post-parse", benchDefParse);
+    DO_BENCH("corpus validate", benchDefValidate);
+    DO_BENCH("corpus format", benchDefFormat);
+
+ cleanup:
+    g_ptr_array_unref(corpus.xmls);
+    g_ptr_array_unref(corpus.defs);
+    qemuTestDriverFree(&driver);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN_PRELOAD(mymain,
+                      VIR_TEST_MOCK("virpci"),
+                      VIR_TEST_MOCK("virrandom"),
+                      VIR_TEST_MOCK("domaincaps"))
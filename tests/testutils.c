@@ -210,6 +210,58 @@ virTestRunLog(int *ret,
 }
 
 
+/* Minimal duration of a benchmark in milliseconds, can be overridden
+ * using the VIR_BENCH_TIME environment variable */
+#define VIR_TEST_BENCH_DEFAULT_TIME 200
+
+/*
+ * Runs @body repeatedly, doubling the number of iterations until they take
+ * at least VIR_BENCH_TIME milliseconds, and prints the average time of one
+ * call in a format meant to be compared across commits:
+ *
+ *   <title> <ns> ns/op <iterations> ops
+ */
+int
+virTestBenchRun(const char *title,
+                int (*body)(void *data),
+                void *data)
+{
+    const char *benchTime = g_getenv("VIR_BENCH_TIME");
+    unsigned long long minTime = VIR_TEST_BENCH_DEFAULT_TIME;
+    unsigned long long iterations = 1;
+    unsigned long long elapsed;
+
+    if (benchTime &&
+        virStrToLong_ull(benchTime, NULL, 10, &minTime) < 0) {
+        fprintf(stderr, "invalid VIR_BENCH_TIME '%s'\n", benchTime);
+        return -1;
+    }
+
+    while (true) {
+        unsigned long long i;
+        gint64 start = g_get_monotonic_time();
+
+        for (i = 0; i < iterations; i++) {
+            if (body(data) < 0) {
+                fprintf(stderr, "%s: failed\n", title);
+                return -1;
+            }
+        }
+
+        elapsed = g_get_monotonic_time() - start;
+
+        if (elapsed >= minTime * 1000 || iterations >= ULLONG_MAX / 2)
+            break;
+
+        iterations *= 2;
+    }
+
+    printf("%-40s %14.1f ns/op %12llu ops\n",
+           title, elapsed * 1000.0 / iterations, iterations);
+    return 0;
+}
+
+
 /**
  * virTestLoadFile:
  * @file: name of the file to load
@@ -44,6 +44,9 @@ void virTestRunLog(int *ret,
                    const char *title,
                    int (*body)(const void *data),
                    const void *data);
+int virTestBenchRun(const char *title,
+                    int (*body)(void *data),
+                    void *data);
 int virTestLoadFile(const char *file, char **buf);
 char *virTestLoadFilePath(const char *p, ...)
     G_GNUC_NULL_TERMINATED;
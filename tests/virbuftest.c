@@ -357,6 +357,43 @@ testBufSetIndent(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testBufCompact(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+
+    virBufferSetCompact(&buf, true);
+    virBufferAddLit(&buf, "<a>\n");
+    virBufferAdjustIndent(&buf, 2);
+    virBufferAddLit(&buf, "<b>\n");
+    if (virBufferGetIndent(&buf) != 2 ||
+        virBufferGetEffectiveIndent(&buf) != 0) {
+        VIR_TEST_DEBUG("testBufCompact: wrong indentation");
+        return -1;
+    }
+    {
+        g_auto(virBuffer) childBuf = VIR_BUFFER_INIT_CHILD(&buf);
+
+        virBufferAddLit(&childBuf, "<c/>\n");
+        virBufferAddBuffer(&buf, &childBuf);
+    }
+    virBufferAddLit(&buf, "</b>\n");
+    virBufferAdjustIndent(&buf, -2);
+    virBufferAddLit(&buf, "</a>\n");
+
+    if (!(actual = virBufferContentAndReset(&buf)))
+        return -1;
+
+    if (STRNEQ(actual, "<a>\n<b>\n<c/>\n</b>\n</a>\n")) {
+        VIR_TEST_DEBUG("testBufCompact: unexpected output '%s'", actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /* Result of this shows up only in valgrind or similar */
 static int
 testBufferAutoclean(const void *opaque G_GNUC_UNUSED)
@@ -384,6 +421,7 @@ mymain(void)
     DO_TEST("Trim", testBufTrim);
     DO_TEST("AddBuffer", testBufAddBuffer);
     DO_TEST("set indent", testBufSetIndent);
+    DO_TEST("compact", testBufCompact);
     DO_TEST("autoclean", testBufferAutoclean);
 
 #define DO_TEST_ADD_STR(_data, _expect) \
@@ -192,6 +192,51 @@ testFileCache(const void *opaque)
 }
 
 
+static int
+testFileCachePrefetch(const void *opaque)
+{
+    virFileCache *cache = (virFileCache *) opaque;
+    testFileCachePriv *testPriv = virFileCacheGetPriv(cache);
+    const char *names[] = { "prefetchA", "prefetchB", "prefetchC", NULL };
+    size_t i;
+
+    testPriv->dataSaved = false;
+    testPriv->newData = "ddd\n";
+    testPriv->expectData = "ddd\n";
+
+    virFileCachePrefetch(cache, names);
+
+    if (!testPriv->dataSaved) {
+        fprintf(stderr, "Expected prefetched data to be saved.\n");
+        return -1;
+    }
+
+    /* All data is supposed to be cached now */
+    testPriv->dataSaved = false;
+    testPriv->newData = NULL;
+
+    for (i = 0; names[i]; i++) {
+        testFileCacheObj *obj;
+        bool match;
+
+        if (!(obj = virFileCacheLookup(cache, names[i]))) {
+            fprintf(stderr, "Getting prefetched data '%s' failed.\n", names[i]);
+            return -1;
+        }
+
+        match = STREQ_NULLABLE(obj->data, "ddd\n");
+        virObjectUnref(obj);
+
+        if (!match || testPriv->dataSaved) {
+            fprintf(stderr, "Data '%s' was not prefetched.\n", names[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -220,6 +265,9 @@ mymain(void)
     TEST_RUN("cacheInvalid", "bbb\n", "bbb\n", true);
     TEST_RUN("cacheMissing", "ccc\n", "ccc\n", true);
 
+    if (virTestRun("prefetch", testFileCachePrefetch, cache) < 0)
+        ret = -1;
+
     virObjectUnref(cache);
 
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
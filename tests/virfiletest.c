@@ -24,6 +24,7 @@
 #include "testutils.h"
 #include "virfile.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #ifdef __linux__
 # include <linux/falloc.h>
@@ -294,6 +295,40 @@ testFileInData(const void *opaque)
 }
 
 
+static int
+testFileDataIsZero(const void *opaque G_GNUC_UNUSED)
+{
+    size_t lens[] = { 1, 15, 16, 17, 4096, 65537 };
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(lens); i++) {
+        g_autofree char *buf = g_new0(char, lens[i]);
+        size_t pos[] = { 0, lens[i] / 2, lens[i] - 1 };
+        size_t j;
+
+        if (!virFileDataIsZero(buf, lens[i])) {
+            fprintf(stderr, "zeroed buffer of %zu bytes not detected\n",
+                    lens[i]);
+            return -1;
+        }
+
+        for (j = 0; j < G_N_ELEMENTS(pos); j++) {
+            buf[pos[j]] = 1;
+
+            if (virFileDataIsZero(buf, lens[i])) {
+                fprintf(stderr, "buffer of %zu bytes with data at %zu "
+                        "reported as zero\n", lens[i], pos[j]);
+                return -1;
+            }
+
+            buf[pos[j]] = 0;
+        }
+    }
+
+    return 0;
+}
+
+
 struct testFileIsSharedFSType {
     const char *mtabFile;
     const char *filename;
@@ -334,6 +369,107 @@ testFileIsSharedFSType(const void *opaque G_GNUC_UNUSED)
 }
 
 
+#define TEST_FILE_REWRITE_WRITERS 8
+#define TEST_FILE_REWRITE_ROUNDS 16
+
+struct testFileRewriteWriter {
+    char *path;
+    bool failed;
+};
+
+
+static void
+testFileRewriteWriterRun(void *opaque)
+{
+    struct testFileRewriteWriter *writer = opaque;
+    size_t i;
+
+    for (i = 0; i < TEST_FILE_REWRITE_ROUNDS; i++) {
+        g_autofree char *str = g_strdup_printf("%s %zu\n", writer->path, i);
+
+        if (virFileRewriteStr(writer->path, 0600, str) < 0) {
+            writer->failed = true;
+            return;
+        }
+    }
+}
+
+
+/* Files rewritten concurrently in one directory share their flushes, which
+ * must not mix up or lose any of their contents */
+static int
+testFileRewriteConcurrent(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = g_strdup(abs_builddir "/virfiletest-rewrite-XXXXXX");
+    struct testFileRewriteWriter writers[TEST_FILE_REWRITE_WRITERS] = { 0 };
+    virThread threads[TEST_FILE_REWRITE_WRITERS];
+    size_t nthreads = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!g_mkdtemp(dir)) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return -1;
+    }
+
+    for (i = 0; i < TEST_FILE_REWRITE_WRITERS; i++)
+        writers[i].path = g_strdup_printf("%s/file%zu", dir, i);
+
+    for (i = 0; i < TEST_FILE_REWRITE_WRITERS; i++) {
+        if (virThreadCreate(&threads[i], true,
+                            testFileRewriteWriterRun, &writers[i]) < 0)
+            break;
+        nthreads++;
+    }
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    if (nthreads != TEST_FILE_REWRITE_WRITERS) {
+        fprintf(stderr, "Cannot create writer threads\n");
+        goto cleanup;
+    }
+
+    for (i = 0; i < TEST_FILE_REWRITE_WRITERS; i++) {
+        g_autofree char *expect = NULL;
+        g_autofree char *actual = NULL;
+        g_autofree char *newfile = g_strdup_printf("%s.new", writers[i].path);
+
+        if (writers[i].failed) {
+            fprintf(stderr, "Rewriting '%s' failed\n", writers[i].path);
+            goto cleanup;
+        }
+
+        expect = g_strdup_printf("%s %d\n", writers[i].path,
+                                 TEST_FILE_REWRITE_ROUNDS - 1);
+
+        if (virFileReadAll(writers[i].path, 1024, &actual) < 0)
+            goto cleanup;
+
+        if (STRNEQ(expect, actual)) {
+            fprintf(stderr, "Unexpected contents of '%s': '%s'\n",
+                    writers[i].path, actual);
+            goto cleanup;
+        }
+
+        if (virFileExists(newfile)) {
+            fprintf(stderr, "Leftover file '%s'\n", newfile);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < TEST_FILE_REWRITE_WRITERS; i++) {
+        unlink(writers[i].path);
+        g_free(writers[i].path);
+    }
+    rmdir(dir);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -422,6 +558,9 @@ mymain(void)
         DO_TEST_IN_DATA(false, 8, 16, 32, 64, 128, 256, 512);
     }
 
+    if (virTestRun("testFileDataIsZero", testFileDataIsZero, NULL) < 0)
+        ret = -1;
+
 #define DO_TEST_FILE_IS_SHARED_FS_TYPE(mtab, file, exp) \
     do { \
         struct testFileIsSharedFSType data = { \
@@ -444,6 +583,10 @@ mymain(void)
     DO_TEST_FILE_IS_SHARED_FS_TYPE("mounts3.txt", "/gpfs/data", true);
     DO_TEST_FILE_IS_SHARED_FS_TYPE("mounts3.txt", "/quobyte", true);
 
+    if (virTestRun("testFileRewriteConcurrent",
+                   testFileRewriteConcurrent, NULL) < 0)
+        ret = -1;
+
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
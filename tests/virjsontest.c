@@ -102,6 +102,50 @@ testJSONFromString(const void *data)
 }
 
 
+/* Feeds @info->doc to the stream parser split at each possible offset */
+static int
+testJSONFromStream(const void *data)
+{
+    const struct testInfo *info = data;
+    const char *expectstr = info->expect ? info->expect : info->doc;
+    g_autoptr(virJSONStreamParser) stream = virJSONStreamParserNew();
+    size_t len = strlen(info->doc);
+    size_t i;
+
+    for (i = 0; i <= len; i++) {
+        g_autoptr(virJSONValue) json = NULL;
+        g_autofree char *formatted = NULL;
+
+        if (virJSONStreamParserFeed(stream, info->doc, i) < 0 ||
+            virJSONStreamParserFeed(stream, info->doc + i, len - i) < 0 ||
+            !(json = virJSONStreamParserFinish(stream))) {
+            if (info->pass) {
+                VIR_TEST_VERBOSE("Failed to parse %s split at %zu", info->doc, i);
+                return -1;
+            }
+            continue;
+        }
+
+        if (!info->pass) {
+            VIR_TEST_VERBOSE("Unexpected success while parsing %s", info->doc);
+            return -1;
+        }
+
+        if (!(formatted = virJSONValueToString(json, false))) {
+            VIR_TEST_VERBOSE("Failed to format json data");
+            return -1;
+        }
+
+        if (STRNEQ(expectstr, formatted)) {
+            virTestDifference(stderr, expectstr, formatted);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 testJSONAddRemove(const void *data)
 {
@@ -497,6 +541,12 @@ mymain(void)
 #define DO_TEST_PARSE_FAIL(name, doc) \
     DO_TEST_FULL(name, FromString, doc, NULL, false)
 
+#define DO_TEST_PARSE_STREAM(name, doc, expect) \
+    DO_TEST_FULL(name, FromStream, doc, expect, true)
+
+#define DO_TEST_PARSE_STREAM_FAIL(name, doc) \
+    DO_TEST_FULL(name, FromStream, doc, NULL, false)
+
 #define DO_TEST_PARSE_FILE(name) \
     DO_TEST_FULL(name, FromFile, NULL, NULL, true)
 
@@ -577,6 +627,15 @@ mymain(void)
     DO_TEST_PARSE_FAIL("object with unterminated key", "{ \"key:7 }");
     DO_TEST_PARSE_FAIL("duplicate key", "{ \"a\": 1, \"a\": 1 }");
 
+    DO_TEST_PARSE_STREAM("stream object",
+                         "{\"return\": [{\"name\": \"drive0\", \"ro\": false}, 1.5e3, null]}",
+                         "{\"return\":[{\"name\":\"drive0\",\"ro\":false},1.5e3,null]}");
+    DO_TEST_PARSE_STREAM("stream escaped string", "[\"\\\"\\t\\u0041\\\\\"]",
+                         "[\"\\\"\\tA\\\\\"]");
+    DO_TEST_PARSE_STREAM_FAIL("stream nothing", "");
+    DO_TEST_PARSE_STREAM_FAIL("stream unterminated object", "{ \"1\":1, \"2\":[");
+    DO_TEST_PARSE_STREAM_FAIL("stream trailing garbage", "{} {}");
+
     DO_TEST_FULL("lookup on array", Lookup,
                  "[ 1 ]", NULL, false);
     DO_TEST_FULL("lookup on string", Lookup,
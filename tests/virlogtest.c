@@ -141,6 +141,8 @@ mymain(void)
     TEST_LOG_MATCH_FAIL("libvirt:  error : cannot execute binary /usr/libexec/libvirt_lxc: No such file or directory");
     TEST_PARSE_OUTPUTS("1:file:/dev/null", 1);
     TEST_PARSE_OUTPUTS("1:file:/dev/null  2:stderr", 2);
+    TEST_PARSE_OUTPUTS("1:ring:/dev/null  3:stderr", 2);
+    TEST_PARSE_OUTPUTS_FAIL("1:ring", 1);
     TEST_PARSE_OUTPUTS_FAIL("foo:stderr", 1);
     TEST_PARSE_OUTPUTS_FAIL("1:bar", 1);
     TEST_PARSE_OUTPUTS_FAIL("1:stderr:foobar", 1);
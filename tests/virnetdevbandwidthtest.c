@@ -60,6 +60,22 @@ testVirNetDevBandwidthParse(virNetDevBandwidth **var,
                                    true);
 }
 
+/* Commands fed to 'tc -batch -' follow the command line */
+static void
+testVirNetDevBandwidthDryRun(const char *const*args G_GNUC_UNUSED,
+                             const char *const*env G_GNUC_UNUSED,
+                             const char *input,
+                             char **output G_GNUC_UNUSED,
+                             char **error G_GNUC_UNUSED,
+                             int *status G_GNUC_UNUSED,
+                             void *opaque)
+{
+    virBuffer *buf = opaque;
+
+    if (input)
+        virBufferAdd(buf, input, -1);
+}
+
 static int
 testVirNetDevBandwidthSet(const void *data)
 {
@@ -76,7 +92,8 @@ testVirNetDevBandwidthSet(const void *data)
     if (!iface)
         iface = "eth0";
 
-    virCommandSetDryRun(dryRunToken, &buf, false, false, NULL, NULL);
+    virCommandSetDryRun(dryRunToken, &buf, false, false,
+                        testVirNetDevBandwidthDryRun, &buf);
 
     if (virNetDevBandwidthSet(iface, band, info->hierarchical_class, true) < 0)
         return -1;
@@ -122,18 +139,20 @@ mymain(void)
                  "</bandwidth>"),
                 (TC " qdisc del dev eth0 root\n"
                  TC " qdisc del dev eth0 ingress\n"
-                 TC " qdisc add dev eth0 root handle 1: htb default 1\n"
-                 TC " class add dev eth0 parent 1: classid 1:1 htb rate 1024kbps quantum 87\n"
-                 TC " qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
-                 TC " filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"));
+                 TC " -batch -\n"
+                 "qdisc add dev eth0 root handle 1: htb default 1\n"
+                 "class add dev eth0 parent 1: classid 1:1 htb rate 1024kbps quantum 87\n"
+                 "qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
+                 "filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"));
 
     DO_TEST_SET(("<bandwidth>"
                  "  <outbound average='1024'/>"
                  "</bandwidth>"),
                 (TC " qdisc del dev eth0 root\n"
                  TC " qdisc del dev eth0 ingress\n"
-                 TC " qdisc add dev eth0 ingress\n"
-                 TC " filter add dev eth0 parent ffff: protocol all u32 match u32 0 0 "
+                 TC " -batch -\n"
+                 "qdisc add dev eth0 ingress\n"
+                 "filter add dev eth0 parent ffff: protocol all u32 match u32 0 0 "
                  "police rate 1024kbps burst 1024kb mtu 64kb drop flowid :1\n"));
 
     DO_TEST_SET(("<bandwidth>"
@@ -142,12 +161,13 @@ mymain(void)
                  "</bandwidth>"),
                 (TC " qdisc del dev eth0 root\n"
                  TC " qdisc del dev eth0 ingress\n"
-                 TC " qdisc add dev eth0 root handle 1: htb default 1\n"
-                 TC " class add dev eth0 parent 1: classid 1:1 htb rate 1kbps ceil 2kbps burst 4kb quantum 1\n"
-                 TC " qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
-                 TC " filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"
-                 TC " qdisc add dev eth0 ingress\n"
-                 TC " filter add dev eth0 parent ffff: protocol all u32 match u32 0 0 "
+                 TC " -batch -\n"
+                 "qdisc add dev eth0 root handle 1: htb default 1\n"
+                 "class add dev eth0 parent 1: classid 1:1 htb rate 1kbps ceil 2kbps burst 4kb quantum 1\n"
+                 "qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
+                 "filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"
+                 "qdisc add dev eth0 ingress\n"
+                 "filter add dev eth0 parent ffff: protocol all u32 match u32 0 0 "
                  "police rate 5kbps burst 7kb mtu 64kb drop flowid :1\n"));
 
     DO_TEST_SET(("<bandwidth>"
@@ -156,12 +176,13 @@ mymain(void)
                  "</bandwidth>"),
                 (TC " qdisc del dev eth0 root\n"
                  TC " qdisc del dev eth0 ingress\n"
-                 TC " qdisc add dev eth0 root handle 1: htb default 1\n"
-                 TC " class add dev eth0 parent 1: classid 1:1 htb rate 4294967295kbps quantum 366503875\n"
-                 TC " qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
-                 TC " filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"
-                 TC " qdisc add dev eth0 ingress\n"
-                 TC " filter add dev eth0 parent ffff: protocol all u32 match "
+                 TC " -batch -\n"
+                 "qdisc add dev eth0 root handle 1: htb default 1\n"
+                 "class add dev eth0 parent 1: classid 1:1 htb rate 4294967295kbps quantum 366503875\n"
+                 "qdisc add dev eth0 parent 1:1 handle 2: sfq perturb 10\n"
+                 "filter add dev eth0 parent 1:0 protocol all prio 1 handle 1 fw flowid 1\n"
+                 "qdisc add dev eth0 ingress\n"
+                 "filter add dev eth0 parent ffff: protocol all u32 match "
                  "u32 0 0 police rate 4294967295kbps burst 4194303kb mtu 64kb "
                  "drop flowid :1\n"));
 
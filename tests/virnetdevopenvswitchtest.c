@@ -33,6 +33,12 @@ struct _InterfaceParseStatsData {
     const virDomainInterfaceStatsStruct stats;
 };
 
+typedef struct _InterfaceParseStatsAllData InterfaceParseStatsAllData;
+struct _InterfaceParseStatsAllData {
+    const char *ifname;
+    const virDomainInterfaceStatsStruct stats;
+};
+
 struct testSetQosStruct {
     const char *band;
     const char *exp_cmd;
@@ -216,6 +222,56 @@ testVirNetDevOpenvswitchInterfaceClearQos(const void *data)
     return 0;
 }
 
+static int
+testInterfaceParseStatsAll(const void *opaque)
+{
+    const InterfaceParseStatsAllData *data = opaque;
+    g_autofree char *filename = NULL;
+    g_autofree char *buf = NULL;
+    g_autoptr(GHashTable) all = NULL;
+    virDomainInterfaceStatsPtr actual;
+
+    filename = g_strdup_printf("%s/virnetdevopenvswitchdata/statsall.json",
+                               abs_srcdir);
+
+    if (virFileReadAll(filename, 4096, &buf) < 0)
+        return -1;
+
+    if (!(all = virNetDevOpenvswitchInterfaceParseStatsAll(buf)))
+        return -1;
+
+    if (!(actual = g_hash_table_lookup(all, data->ifname))) {
+        fprintf(stderr, "Missing stats of %s\n", data->ifname);
+        return -1;
+    }
+
+    if (memcmp(actual, &data->stats, sizeof(*actual)) != 0) {
+        fprintf(stderr,
+                "Expected stats: %lld %lld %lld %lld %lld %lld %lld %lld\n"
+                "Actual stats: %lld %lld %lld %lld %lld %lld %lld %lld",
+                data->stats.rx_bytes,
+                data->stats.rx_packets,
+                data->stats.rx_errs,
+                data->stats.rx_drop,
+                data->stats.tx_bytes,
+                data->stats.tx_packets,
+                data->stats.tx_errs,
+                data->stats.tx_drop,
+                actual->rx_bytes,
+                actual->rx_packets,
+                actual->rx_errs,
+                actual->rx_drop,
+                actual->tx_bytes,
+                actual->tx_packets,
+                actual->tx_errs,
+                actual->tx_drop);
+
+        return -1;
+    }
+
+    return 0;
+}
+
 static int
 mymain(void)
 {
@@ -235,6 +291,21 @@ mymain(void)
     TEST_INTERFACE_STATS("stats1.json", 9, 12, 11, 10, 2, 8, 5, 4);
     TEST_INTERFACE_STATS("stats2.json", 12406, 173, 0, 0, 0, 0, 0, 0);
 
+#define TEST_INTERFACE_STATS_ALL(name, \
+                                 rxBytes, rxPackets, rxErrs, rxDrop, \
+                                 txBytes, txPackets, txErrs, txDrop) \
+    do { \
+        const InterfaceParseStatsAllData data = {.ifname = name, .stats = { \
+                             rxBytes, rxPackets, rxErrs, rxDrop, \
+                             txBytes, txPackets, txErrs, txDrop}}; \
+        if (virTestRun("Interface stats all " name, testInterfaceParseStatsAll, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    TEST_INTERFACE_STATS_ALL("vhost-user1", 9, 12, 11, 10, 2, 8, 5, 4);
+    TEST_INTERFACE_STATS_ALL("vhost-user2", 12406, 173, 0, 0, 0, 0, 0, 0);
+    TEST_INTERFACE_STATS_ALL("br0", -1, -1, -1, -1, -1, -1, -1, -1);
+
 #define TEST_NAME_ESCAPE(str, fail) \
     do { \
         const escapeData data = {str, fail};\
@@ -271,7 +342,7 @@ mymain(void)
                  OVS_VSCTL " --timeout=5 --no-heading --columns=_uuid find qos"
                            " 'external-ids:vm-id=\"66616b65-7575-6964-0000-000000000000\"'"
                            " 'external-ids:ifname=\"tap-fake\"'\n"
-                 OVS_VSCTL " --timeout=5 set port tap-fake qos=@qos1"
+                 OVS_VSCTL " --timeout=5 -- set port tap-fake qos=@qos1"
                            " 'external-ids:vm-id=\"66616b65-7575-6964-0000-000000000000\"'"
                            " 'external-ids:ifname=\"tap-fake\"'"
                            " -- --id=@qos1 create qos type=linux-htb other_config:min-rate=160000000"
@@ -279,8 +350,8 @@ mymain(void)
                            " 'external-ids:ifname=\"tap-fake\"'"
                            " -- --id=@queue0 create queue other_config:min-rate=160000000 "
                            "'external-ids:vm-id=\"66616b65-7575-6964-0000-000000000000\"'"
-                           " 'external-ids:ifname=\"tap-fake\"'\n"
-                 OVS_VSCTL " --timeout=5 set Interface tap-fake ingress_policing_rate=0 ingress_policing_burst=0\n"));
+                           " 'external-ids:ifname=\"tap-fake\"'"
+                           " -- set Interface tap-fake ingress_policing_rate=0 ingress_policing_burst=0\n"));
 
     DO_TEST_SET(NULL, NULL);
 
@@ -295,7 +366,7 @@ mymain(void)
                  OVS_VSCTL " --timeout=5 --no-heading --columns=_uuid find qos"
                            " 'external-ids:vm-id=\"66616b65-7575-6964-0000-000000000000\"'"
                            " 'external-ids:ifname=\"tap-fake\"'\n"
-                 OVS_VSCTL " --timeout=5 set Interface tap-fake ingress_policing_rate=0 ingress_policing_burst=0\n"));
+                 OVS_VSCTL " --timeout=5 -- set Interface tap-fake ingress_policing_rate=0 ingress_policing_burst=0\n"));
 
     DO_TEST_SET(("<bandwidth>"
                  "  <inbound average='0' />"
@@ -307,7 +378,7 @@ mymain(void)
                  OVS_VSCTL " --timeout=5 --no-heading --columns=_uuid find qos"
                            " 'external-ids:vm-id=\"66616b65-7575-6964-0000-000000000000\"'"
                            " 'external-ids:ifname=\"tap-fake\"'\n"
-                 OVS_VSCTL " --timeout=5 set Interface tap-fake ingress_policing_rate=40000\n"));
+                 OVS_VSCTL " --timeout=5 -- set Interface tap-fake ingress_policing_rate=40000\n"));
 
 #define DO_TEST_CLEAR_QOS(Iface, Vmid, Exp_cmd, ...) \
     do { \
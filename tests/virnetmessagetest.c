@@ -516,6 +516,217 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static int testMessagePool(const void *args G_GNUC_UNUSED)
+{
+    virNetMessage *msg = NULL;
+    char *buffer;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long newHits;
+    unsigned long long newMisses;
+    int ret = -1;
+
+    /* Prime the pool with a released message and buffer */
+    msg = virNetMessageNew(false);
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+    buffer = msg->buffer;
+    virNetMessageFree(msg);
+
+    virNetMessageGetPoolStats(&hits, &misses);
+
+    msg = virNetMessageNew(false);
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (msg->buffer != buffer) {
+        VIR_DEBUG("Expected pooled buffer %p got %p", buffer, msg->buffer);
+        goto cleanup;
+    }
+
+    if (msg->bufferAlloc != VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX) {
+        VIR_DEBUG("Unexpected buffer allocation %zu", msg->bufferAlloc);
+        goto cleanup;
+    }
+
+    virNetMessageGetPoolStats(&newHits, &newMisses);
+
+    if (newHits != hits + 2 || newMisses != misses) {
+        VIR_DEBUG("Expected 2 more hits and no misses, got hits %llu -> %llu "
+                  "misses %llu -> %llu", hits, newHits, misses, newMisses);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+static int testMessageCompress(const void *args G_GNUC_UNUSED)
+{
+    virNetMessage *msg = virNetMessageNew(true);
+    virNetMessage *rx = virNetMessageNew(true);
+    g_autofree char *data = NULL;
+    size_t datalen = 65536;
+    size_t rawlen;
+    size_t i;
+    int ret = -1;
+
+    if (!virNetMessageCompressionSupported()) {
+        ret = EXIT_AM_SKIP;
+        goto cleanup;
+    }
+
+    data = g_new0(char, datalen);
+    for (i = 0; i < datalen; i++)
+        data[i] = "<domain type='kvm'/>"[i % 20];
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_REPLY;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayloadRaw(msg, data, datalen) < 0)
+        goto cleanup;
+
+    rawlen = msg->bufferLength;
+
+    if (virNetMessageCompress(msg, rawlen)) {
+        VIR_DEBUG("Payload below threshold should not be compressed");
+        goto cleanup;
+    }
+
+    if (!virNetMessageCompress(msg, VIR_NET_MESSAGE_COMPRESS_THRESHOLD)) {
+        VIR_DEBUG("Payload was not compressed");
+        goto cleanup;
+    }
+
+    if (msg->bufferLength >= rawlen || msg->header.type != VIR_NET_REPLY) {
+        VIR_DEBUG("Unexpected compressed length %zu or type %d",
+                  msg->bufferLength, msg->header.type);
+        goto cleanup;
+    }
+
+    /* Feed the wire data to the decoder like a socket read would */
+    rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    virNetMessageReserveBuffer(rx, rx->bufferLength);
+    memcpy(rx->buffer, msg->buffer, rx->bufferLength);
+
+    if (virNetMessageDecodeLength(rx) < 0)
+        goto cleanup;
+
+    if (rx->bufferLength != msg->bufferLength) {
+        VIR_DEBUG("Expected length %zu got %zu",
+                  msg->bufferLength, rx->bufferLength);
+        goto cleanup;
+    }
+
+    memcpy(rx->buffer, msg->buffer, rx->bufferLength);
+
+    if (virNetMessageDecodeHeader(rx) < 0)
+        goto cleanup;
+
+    if (rx->header.type != VIR_NET_REPLY ||
+        rx->header.serial != 0x99 ||
+        rx->bufferLength != rawlen) {
+        VIR_DEBUG("Unexpected type %d serial %u length %zu",
+                  rx->header.type, rx->header.serial, rx->bufferLength);
+        goto cleanup;
+    }
+
+    if (memcmp(rx->buffer + rx->bufferOffset, data, datalen) != 0) {
+        VIR_DEBUG("Decompressed payload does not match");
+        goto cleanup;
+    }
+
+    /* Decoding the header again must not decompress twice */
+    if (virNetMessageDecodeHeader(rx) < 0 ||
+        rx->bufferLength != rawlen) {
+        VIR_DEBUG("Second header decode failed");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    virNetMessageFree(rx);
+    return ret;
+}
+
+
+static int testMessageUpdateHeader(const void *args G_GNUC_UNUSED)
+{
+    virNetMessage *msg = virNetMessageNew(true);
+    virNetMessage *rx = virNetMessageNew(true);
+    static const char data[] = "payload which has to stay untouched";
+    int ret = -1;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_CALL;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayloadRaw(msg, data, sizeof(data)) < 0)
+        goto cleanup;
+
+    /* Pass the message on under a different serial, like a proxy would */
+    rx->bufferLength = msg->bufferLength;
+    virNetMessageReserveBuffer(rx, rx->bufferLength);
+    memcpy(rx->buffer, msg->buffer, rx->bufferLength);
+
+    if (virNetMessageDecodeHeader(rx) < 0)
+        goto cleanup;
+
+    rx->header.serial = 0x1234;
+
+    if (virNetMessageUpdateHeader(rx) < 0)
+        goto cleanup;
+
+    if (rx->bufferOffset != 0 || rx->bufferLength != msg->bufferLength) {
+        VIR_DEBUG("Unexpected offset %zu or length %zu",
+                  rx->bufferOffset, rx->bufferLength);
+        goto cleanup;
+    }
+
+    memset(&rx->header, 0, sizeof(rx->header));
+
+    if (virNetMessageDecodeHeader(rx) < 0)
+        goto cleanup;
+
+    if (rx->header.prog != 0x11223344 ||
+        rx->header.proc != 0x666 ||
+        rx->header.type != VIR_NET_CALL ||
+        rx->header.serial != 0x1234) {
+        VIR_DEBUG("Unexpected prog %u proc %d type %d serial %u",
+                  rx->header.prog, rx->header.proc,
+                  rx->header.type, rx->header.serial);
+        goto cleanup;
+    }
+
+    if (memcmp(rx->buffer + rx->bufferOffset, data, sizeof(data)) != 0) {
+        VIR_DEBUG("Payload does not match");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    virNetMessageFree(rx);
+    return ret;
+}
+
 
 static int
 mymain(void)
@@ -541,6 +752,15 @@ mymain(void)
     if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Pool", testMessagePool, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Compress", testMessageCompress, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Update Header", testMessageUpdateHeader, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -233,6 +233,135 @@ static int testTLSSessionInit(const void *opaque)
 }
 
 
+/*
+ * Run a single connection between the given contexts, including the
+ * exchange of some data so that the client gets to see session
+ * tickets sent after the handshake.
+ */
+static int testTLSSessionConnect(virNetTLSContext *serverCtxt,
+                                 virNetTLSContext *clientCtxt,
+                                 const char *hostname,
+                                 bool *resumed)
+{
+    g_autoptr(virNetTLSSession) serverSess = NULL;
+    g_autoptr(virNetTLSSession) clientSess = NULL;
+    int ret = -1;
+    int channel[2];
+    bool clientShake = false;
+    bool serverShake = false;
+    char buf[1];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+        abort();
+
+    ignore_value(virSetNonBlock(channel[0]));
+    ignore_value(virSetNonBlock(channel[1]));
+
+    if (!(serverSess = virNetTLSSessionNew(serverCtxt, NULL)) ||
+        !(clientSess = virNetTLSSessionNew(clientCtxt, hostname)))
+        goto cleanup;
+
+    virNetTLSSessionSetIOCallbacks(serverSess, testWrite, testRead, &channel[0]);
+    virNetTLSSessionSetIOCallbacks(clientSess, testWrite, testRead, &channel[1]);
+
+    do {
+        int rv;
+        if (!serverShake) {
+            rv = virNetTLSSessionHandshake(serverSess);
+            if (rv < 0)
+                goto cleanup;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                serverShake = true;
+        }
+        if (!clientShake) {
+            rv = virNetTLSSessionHandshake(clientSess);
+            if (rv < 0)
+                goto cleanup;
+            if (rv == VIR_NET_TLS_HANDSHAKE_COMPLETE)
+                clientShake = true;
+        }
+    } while (!clientShake || !serverShake);
+
+    if (virNetTLSSessionWrite(serverSess, "1", 1) != 1) {
+        VIR_WARN("Unable to send data to client");
+        goto cleanup;
+    }
+
+    if (virNetTLSSessionRead(clientSess, buf, 1) != 1) {
+        VIR_WARN("Unable to receive data from server");
+        goto cleanup;
+    }
+
+    /* Resumed sessions must still carry the peer certificates */
+    if (virNetTLSContextCheckCertificate(serverCtxt, serverSess) < 0 ||
+        virNetTLSContextCheckCertificate(clientCtxt, clientSess) < 0) {
+        VIR_WARN("Unexpected cert check fail");
+        goto cleanup;
+    }
+
+    *resumed = virNetTLSSessionIsResumed(clientSess);
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(channel[0]);
+    VIR_FORCE_CLOSE(channel[1]);
+    return ret;
+}
+
+
+/*
+ * A second connection to the same server must resume the session
+ * the first one established
+ */
+static int testTLSSessionResume(const void *opaque)
+{
+    struct testTLSSessionData *data = (struct testTLSSessionData *)opaque;
+    g_autoptr(virNetTLSContext) serverCtxt = NULL;
+    g_autoptr(virNetTLSContext) clientCtxt = NULL;
+    bool resumed = false;
+
+    serverCtxt = virNetTLSContextNewServer(data->servercacrt,
+                                           NULL,
+                                           data->servercrt,
+                                           KEYFILE,
+                                           data->wildcards,
+                                           "NORMAL",
+                                           false,
+                                           true);
+
+    clientCtxt = virNetTLSContextNewClient(data->clientcacrt,
+                                           NULL,
+                                           data->clientcrt,
+                                           KEYFILE,
+                                           "NORMAL",
+                                           false,
+                                           true);
+
+    if (!serverCtxt || !clientCtxt)
+        return -1;
+
+    if (testTLSSessionConnect(serverCtxt, clientCtxt,
+                              data->hostname, &resumed) < 0)
+        return -1;
+
+    if (resumed) {
+        VIR_WARN("First session unexpectedly resumed");
+        return -1;
+    }
+
+    if (testTLSSessionConnect(serverCtxt, clientCtxt,
+                              data->hostname, &resumed) < 0)
+        return -1;
+
+    if (!resumed) {
+        VIR_WARN("Second session was not resumed");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -340,6 +469,18 @@ mymain(void)
     DO_SESS_TEST_EXT(cacertreq.filename, altcacertreq.filename, servercertreq.filename,
                      clientcertaltreq.filename, true, true, "libvirt.org", NULL);
 
+    {
+        static struct testTLSSessionData data = { 0 };
+
+        data.servercacrt = cacertreq.filename;
+        data.clientcacrt = cacertreq.filename;
+        data.servercrt = servercertreq.filename;
+        data.clientcrt = clientcertreq.filename;
+        data.hostname = "libvirt.org";
+        if (virTestRun("TLS Session resumption", testTLSSessionResume, &data) < 0)
+            ret = -1;
+    }
+
 
     /* When an altname is set, the CN is ignored, so it must be duplicated
      * as an altname for it to match */
@@ -179,6 +179,19 @@ static int testCompareListCustom(const void *data G_GNUC_UNUSED)
     return testCompareOutputLit(exp, NULL, argv);
 }
 
+static int testCompareDumpXMLSectionDefault(const void *data G_GNUC_UNUSED)
+{
+    const char *const argv[] = { VIRSH_DEFAULT, "dumpxml", "--section",
+                                 "metadata", "test", NULL };
+    const char *exp = "\
+<domain type='test' id='1'>\n\
+  <name>test</name>\n\
+  <uuid>6695eb01-f6a4-8304-79aa-97f2502e193f</uuid>\n\
+</domain>\n\
+\n";
+    return testCompareOutputLit(exp, NULL, argv);
+}
+
 static int testCompareNodeinfoDefault(const void *data G_GNUC_UNUSED)
 {
     const char *const argv[] = { VIRSH_DEFAULT, "nodeinfo", NULL };
@@ -460,6 +473,10 @@ mymain(void)
                    testCompareListCustom, NULL) != 0)
         ret = -1;
 
+    if (virTestRun("virsh dumpxml --section (default)",
+                   testCompareDumpXMLSectionDefault, NULL) != 0)
+        ret = -1;
+
     if (virTestRun("virsh nodeinfo (default)",
                    testCompareNodeinfoDefault, NULL) != 0)
         ret = -1;
@@ -452,6 +452,39 @@ static int testFilterChars(const void *args)
     return 0;
 }
 
+static int
+testStringIntern(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *copy = g_strdup("qemu");
+    char *a = virStringIntern("qemu");
+    char *b = virStringIntern(copy);
+    char *c = virStringIntern("raw");
+    int ret = -1;
+
+    if (a != b) {
+        fprintf(stderr, "Equal strings were interned separately\n");
+        goto cleanup;
+    }
+
+    if (a == c || STRNEQ(a, "qemu") || STRNEQ(c, "raw")) {
+        fprintf(stderr, "Interned strings are mixed up\n");
+        goto cleanup;
+    }
+
+    if (virStringIntern(NULL) != NULL) {
+        fprintf(stderr, "Interning NULL gave a string\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virStringInternRelease(a);
+    virStringInternRelease(b);
+    virStringInternRelease(c);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -730,6 +763,9 @@ mymain(void)
     TEST_FILTER_CHARS(NULL, NULL, NULL);
     TEST_FILTER_CHARS("hello 123 hello", "helo", "hellohello");
 
+    if (virTestRun("virStringIntern", testStringIntern, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
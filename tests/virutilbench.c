@@ -0,0 +1,274 @@
+/*
+ * virutilbench.c: microbenchmarks of utility code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virbitmap.h"
+#include "virbuffer.h"
+#include "virhash.h"
+#include "virjson.h"
+#include "virtypedparam.h"
+#include "virxml.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+static const char *benchEscapeString =
+    "<disk type='file'> & \"quoted\" text with 'apostrophes' and\ttabs";
+
+static int
+benchBufferEscape(void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *str = NULL;
+    size_t i;
+
+    for (i = 0; i < 16; i++)
+        virBufferEscapeString(&buf, "<description>%s</description>\n",
+                              benchEscapeString);
+
+    str = virBufferContentAndReset(&buf);
+    return str ? 0 : -1;
+}
+
+
+#define BENCH_HASH_ENTRIES 10000
+
+struct benchHashData {
+    GHashTable *table;
+    char **keys;
+    size_t next;
+};
+
+static int
+benchHashLookup(void *opaque)
+{
+    struct benchHashData *data = opaque;
+    const char *key = data->keys[data->next++ % BENCH_HASH_ENTRIES];
+
+    return virHashLookup(data->table, key) ? 0 : -1;
+}
+
+static int
+benchHashAdd(void *opaque)
+{
+    struct benchHashData *data = opaque;
+    g_autoptr(GHashTable) table = virHashNew(NULL);
+    size_t i;
+
+    for (i = 0; i < 1000; i++) {
+        if (virHashAddEntry(table, data->keys[i], data) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+benchBitmapParse(void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virBitmap) map = NULL;
+
+    return virBitmapParse("0-3,8-11,16-63,^20,128-191,255", &map, 256);
+}
+
+static int
+benchBitmapFormat(void *opaque)
+{
+    g_autofree char *str = virBitmapFormat(opaque);
+
+    return str ? 0 : -1;
+}
+
+static int
+benchBitmapNextSetBit(void *opaque)
+{
+    virBitmap *map = opaque;
+    ssize_t pos = -1;
+    size_t count = 0;
+
+    while ((pos = virBitmapNextSetBit(map, pos)) >= 0)
+        count++;
+
+    return count == virBitmapCountBits(map) ? 0 : -1;
+}
+
+
+static const char *benchJSONString =
+    "{\"return\": [{\"io-status\": \"ok\", \"device\": \"drive-virtio-disk0\","
+    " \"locked\": false, \"removable\": false, \"inserted\": {\"iops_rd\": 0,"
+    " \"detect_zeroes\": \"off\", \"image\": {\"virtual-size\": 10737418240,"
+    " \"filename\": \"/var/lib/libvirt/images/guest.qcow2\", \"cluster-size\":"
+    " 65536, \"format\": \"qcow2\", \"actual-size\": 2097152000,"
+    " \"format-specific\": {\"type\": \"qcow2\", \"data\": {\"compat\": \"1.1\","
+    " \"lazy-refcounts\": false, \"refcount-bits\": 16, \"corrupt\": false}},"
+    " \"dirty-flag\": false}, \"iops_wr\": 0, \"ro\": false,"
+    " \"node-name\": \"libvirt-1-format\", \"backing_file_depth\": 0,"
+    " \"drv\": \"qcow2\", \"iops\": 0, \"bps_wr\": 0, \"write_threshold\": 0,"
+    " \"encrypted\": false, \"bps\": 0, \"bps_rd\": 0, \"cache\": {\"no-flush\":"
+    " false, \"direct\": true, \"writeback\": true},"
+    " \"file\": \"/var/lib/libvirt/images/guest.qcow2\"}, \"qdev\":"
+    " \"/machine/peripheral/virtio-disk0/virtio-backend\", \"type\": \"unknown\"}],"
+    " \"id\": \"libvirt-23\"}";
+
+static int
+benchJSONParse(void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virJSONValue) json = virJSONValueFromString(benchJSONString);
+
+    return json ? 0 : -1;
+}
+
+static int
+benchJSONFormat(void *opaque)
+{
+    g_autofree char *str = virJSONValueToString(opaque, false);
+
+    return str ? 0 : -1;
+}
+
+
+static const char *benchXMLString =
+    "<domain type='kvm'>\n"
+    "  <name>guest</name>\n"
+    "  <uuid>c7a5fdbd-edaf-9455-926a-d65c16db1809</uuid>\n"
+    "  <memory unit='KiB'>4194304</memory>\n"
+    "  <vcpu placement='static'>4</vcpu>\n"
+    "  <os>\n"
+    "    <type arch='x86_64' machine='pc'>hvm</type>\n"
+    "    <boot dev='hd'/>\n"
+    "  </os>\n"
+    "  <devices>\n"
+    "    <emulator>/usr/bin/qemu-system-x86_64</emulator>\n"
+    "    <disk type='file' device='disk'>\n"
+    "      <driver name='qemu' type='qcow2'/>\n"
+    "      <source file='/var/lib/libvirt/images/guest.qcow2'/>\n"
+    "      <target dev='vda' bus='virtio'/>\n"
+    "    </disk>\n"
+    "    <interface type='network'>\n"
+    "      <mac address='52:54:00:12:34:56'/>\n"
+    "      <source network='default'/>\n"
+    "      <model type='virtio'/>\n"
+    "    </interface>\n"
+    "    <graphics type='vnc' port='-1' autoport='yes'/>\n"
+    "  </devices>\n"
+    "</domain>\n";
+
+static int
+benchXMLParse(void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(xmlDoc) doc = NULL;
+    g_autoptr(xmlXPathContext) ctxt = NULL;
+
+    if (!(doc = virXMLParseStringCtxt(benchXMLString, "(bench)", &ctxt)))
+        return -1;
+
+    return virXPathBoolean("boolean(./devices/disk)", ctxt) == 1 ? 0 : -1;
+}
+
+
+#define BENCH_TYPED_PARAMS 64
+
+static int
+benchTypedParamPack(void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virTypedParamList) list = g_new0(virTypedParamList, 1);
+    virTypedParameterPtr params = NULL;
+    struct _virTypedParameterRemote *remote = NULL;
+    unsigned int nremote = 0;
+    int nparams;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < BENCH_TYPED_PARAMS / 2; i++) {
+        if (virTypedParamListAddULLong(list, i, "block.%zu.rd.bytes", i) < 0 ||
+            virTypedParamListAddString(list, "vda", "block.%zu.name", i) < 0)
+            return -1;
+    }
+
+    nparams = virTypedParamListStealParams(list, &params);
+
+    if (virTypedParamsSerialize(params, nparams, BENCH_TYPED_PARAMS,
+                                &remote, &nremote,
+                                VIR_TYPED_PARAM_STRING_OKAY) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virTypedParamsRemoteFree(remote, nremote);
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    struct benchHashData hash = { 0 };
+    g_autoptr(virBitmap) map = virBitmapNew(1024);
+    g_autoptr(virJSONValue) json = NULL;
+    size_t i;
+    int ret = 0;
+
+    hash.table = virHashNew(NULL);
+    hash.keys = g_new0(char *, BENCH_HASH_ENTRIES + 1);
+    for (i = 0; i < BENCH_HASH_ENTRIES; i++) {
+        hash.keys[i] = g_strdup_printf("domain-%zu", i);
+        if (virHashAddEntry(hash.table, hash.keys[i], &hash) < 0)
+            ret = -1;
+    }
+
+    /* a fragmented mask similar to the ones of pinned vCPUs */
+    for (i = 0; i < 1024; i++) {
+        if (i % 7 < 4)
+            ignore_value(virBitmapSetBit(map, i));
+    }
+
+    if (!(json = virJSONValueFromString(benchJSONString)))
+        ret = -1;
+
+    if (ret < 0)
+        goto cleanup;
+
+#define DO_BENCH(name, func, opaque) \
+    do { \
+        if (virTestBenchRun(name, func, opaque) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_BENCH("virBuffer escape", benchBufferEscape, NULL);
+    DO_BENCH("virHash lookup", benchHashLookup, &hash);
+    DO_BENCH("virHash add 1000", benchHashAdd, &hash);
+    DO_BENCH("virBitmap parse", benchBitmapParse, NULL);
+    DO_BENCH("virBitmap format", benchBitmapFormat, map);
+    DO_BENCH("virBitmap next set bit", benchBitmapNextSetBit, map);
+    DO_BENCH("virJSON parse", benchJSONParse, NULL);
+    DO_BENCH("virJSON format", benchJSONFormat, json);
+    DO_BENCH("virXML parse", benchXMLParse, NULL);
+    DO_BENCH("virTypedParam pack", benchTypedParamPack, NULL);
+
+ cleanup:
+    g_clear_pointer(&hash.table, g_hash_table_unref);
+    g_strfreev(hash.keys);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
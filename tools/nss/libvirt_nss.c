@@ -176,6 +176,16 @@ findLease(const char *name,
     }
 
     for (i = 0; i < nleaseFiles; i++) {
+#if !defined(LIBVIRT_NSS_GUEST)
+        int rc;
+
+        if ((rc = findLeasesIndex(leaseFiles[i], name, af, now,
+                                  address, naddress, found)) < 0)
+            goto cleanup;
+        if (rc == 0)
+            continue;
+#endif /* !LIBVIRT_NSS_GUEST */
+
         if (findLeases(leaseFiles[i],
                        name, macs, nmacs,
                        af, now,
@@ -24,13 +24,17 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
 
 #include "libvirt_nss_leases.h"
 #include "libvirt_nss.h"
+#include "virleaseindex.h"
 
 enum {
     FIND_LEASES_STATE_START,
@@ -438,3 +442,159 @@ findLeases(const char *file,
         close(fd);
     return ret;
 }
+
+
+/**
+ * findLeasesIndex:
+ * @file: path to the custom lease file
+ * @name: hostname to look up
+ * @af: address family
+ * @now: current time
+ * @addrs: all the addresses found
+ * @naddrs: number of elements in @addrs
+ * @found: whether @name has been found
+ *
+ * Look @name up in the index the leases helper maintains next to
+ * @file (see virleaseindex.h). This is equivalent to calling
+ * findLeases() without any MAC addresses, but does not need to parse
+ * the whole lease file.
+ *
+ * Returns 1 if there's no usable index and @file has to be parsed
+ * instead, 0 on success, -1 on error.
+ */
+int
+findLeasesIndex(const char *file,
+                const char *name,
+                int af,
+                time_t now,
+                leaseAddress **addrs,
+                size_t *naddrs,
+                bool *found)
+{
+    char *indexFile = NULL;
+    size_t len = strlen(file);
+    struct stat leaseStat;
+    struct stat indexStat;
+    int fd = -1;
+    void *map = MAP_FAILED;
+    const virLeaseIndexHeader *header;
+    const virLeaseIndexEntry *entries;
+    const char *strtab;
+    size_t strsize;
+    size_t lo = 0;
+    size_t hi;
+    int ret = 1;
+
+    if (len < 7 || strcmp(file + len - 7, ".status") != 0)
+        return 1;
+
+    if (asprintf(&indexFile, "%.*s" VIR_LEASE_INDEX_SUFFIX,
+                 (int) len - 7, file) < 0) {
+        indexFile = NULL;
+        return -1;
+    }
+
+    if ((fd = open(indexFile, O_RDONLY)) < 0) {
+        DEBUG("No lease index %s", indexFile);
+        goto cleanup;
+    }
+
+    if (fstat(fd, &indexStat) < 0 ||
+        stat(file, &leaseStat) < 0)
+        goto cleanup;
+
+    /* The lease file is always written first, so if it is newer the
+     * index is stale (e.g. it was written by an older leases helper) */
+    if (leaseStat.st_mtime > indexStat.st_mtime) {
+        DEBUG("Lease index %s is stale", indexFile);
+        goto cleanup;
+    }
+
+    if (indexStat.st_size < (off_t) sizeof(*header))
+        goto cleanup;
+
+    map = mmap(NULL, indexStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        goto cleanup;
+
+    header = map;
+    if (memcmp(header->magic, VIR_LEASE_INDEX_MAGIC,
+               VIR_LEASE_INDEX_MAGIC_LEN) != 0 ||
+        header->nentries > (indexStat.st_size - sizeof(*header)) / sizeof(*entries)) {
+        DEBUG("Malformed lease index %s", indexFile);
+        goto cleanup;
+    }
+
+    entries = (const virLeaseIndexEntry *) ((const char *) map + sizeof(*header));
+    strtab = (const char *) (entries + header->nentries);
+    strsize = indexStat.st_size - sizeof(*header) -
+        header->nentries * sizeof(*entries);
+
+    /* Every string has to be NUL terminated within the file */
+    if (header->nentries > 0 &&
+        (strsize == 0 || strtab[strsize - 1] != '\0')) {
+        DEBUG("Malformed lease index %s", indexFile);
+        goto cleanup;
+    }
+
+    /* Find the first entry for @name */
+    hi = header->nentries;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (entries[mid].hostname >= strsize) {
+            DEBUG("Malformed lease index %s", indexFile);
+            goto cleanup;
+        }
+
+        if (strcmp(strtab + entries[mid].hostname, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < header->nentries; lo++) {
+        const virLeaseIndexEntry *entry = &entries[lo];
+
+        if (entry->hostname >= strsize ||
+            entry->ipaddr >= strsize) {
+            DEBUG("Malformed lease index %s", indexFile);
+            ret = -1;
+            goto cleanup;
+        }
+
+        if (strcmp(strtab + entry->hostname, name) != 0)
+            break;
+
+        if (entry->expirytime != 0 &&
+            entry->expirytime < now) {
+            DEBUG("Entry expired at %lld vs now %lld",
+                  (long long) entry->expirytime, (long long) now);
+            continue;
+        }
+
+        *found = true;
+
+        if (appendAddr(name, addrs, naddrs,
+                       strtab + entry->ipaddr,
+                       entry->expirytime, af) < 0) {
+            ret = -1;
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (ret < 0) {
+        free(*addrs);
+        *addrs = NULL;
+        *naddrs = 0;
+    }
+    if (map != MAP_FAILED)
+        munmap(map, indexStat.st_size);
+    if (fd != -1)
+        close(fd);
+    free(indexFile);
+    return ret;
+}
@@ -38,3 +38,12 @@ findLeases(const char *file,
            leaseAddress **addrs,
            size_t *naddrs,
            bool *found);
+
+int
+findLeasesIndex(const char *file,
+                const char *name,
+                int af,
+                time_t now,
+                leaseAddress **addrs,
+                size_t *naddrs,
+                bool *found);
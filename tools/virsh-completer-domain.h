@@ -181,3 +181,8 @@ char **
 virshDomainBlockjobBaseTopCompleter(vshControl *ctl,
                                     const vshCmd *cmd,
                                     unsigned int flags);
+
+char **
+virshDomainDirtyRateCalcModeCompleter(vshControl *ctl,
+                                      const vshCmd *cmd,
+                                      unsigned int flags);
@@ -29,6 +29,7 @@
 #include "conf/virdomainobjlist.h"
 #include "viralloc.h"
 #include "virmacaddr.h"
+#include "virjson.h"
 #include "virxml.h"
 #include "virstring.h"
 #include "vsh-table.h"
@@ -2066,6 +2067,18 @@ static const vshCmdOptDef opts_domstats[] = {
      .type = VSH_OT_BOOL,
      .help = N_("report domain dirty rate information"),
     },
+    {.name = "vm",
+     .type = VSH_OT_BOOL,
+     .help = N_("report hypervisor-specific statistics"),
+    },
+    {.name = "monitor",
+     .type = VSH_OT_BOOL,
+     .help = N_("report hypervisor monitor command statistics"),
+    },
+    {.name = "blockjob",
+     .type = VSH_OT_BOOL,
+     .help = N_("report block job progress"),
+    },
     {.name = "list-active",
      .type = VSH_OT_BOOL,
      .help = N_("list only active domains"),
@@ -2114,31 +2127,199 @@ static const vshCmdOptDef opts_domstats[] = {
      .type = VSH_OT_BOOL,
      .help = N_("report only stats that are accessible instantly"),
     },
+    {.name = "interval",
+     .type = VSH_OT_INT,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .help = N_("repeat the query every given number of seconds until interrupted"),
+    },
+    {.name = "delta",
+     .type = VSH_OT_BOOL,
+     .help = N_("with --interval, print only fields that changed since the previous sample"),
+    },
+    {.name = "json",
+     .type = VSH_OT_BOOL,
+     .help = N_("print each domain record as a single line JSON object"),
+    },
     VIRSH_COMMON_OPT_DOMAIN_OT_ARGV(N_("list of domains to get stats for"), 0),
     {.name = NULL}
 };
 
 
+typedef struct _virshDomainStatsPrintData virshDomainStatsPrintData;
+struct _virshDomainStatsPrintData {
+    bool raw;
+    bool json;
+    bool delta;
+    /* domain UUID -> hash table of field -> last printed value */
+    GHashTable *last;
+    /* number of records printed in the current sample */
+    size_t nprinted;
+};
+
+
+/**
+ * virshDomainStatsFieldChanged:
+ * @data: print state
+ * @uuid: UUID string of the domain the field belongs to
+ * @field: name of the field
+ * @value: formatted value of the field
+ *
+ * Records @value as the last seen value of @field and returns true if
+ * it should be printed, i.e. delta mode is off or the value differs from
+ * the one seen in the previous sample.
+ */
 static bool
-virshDomainStatsPrintRecord(vshControl *ctl G_GNUC_UNUSED,
+virshDomainStatsFieldChanged(virshDomainStatsPrintData *data,
+                             const char *uuid,
+                             const char *field,
+                             const char *value)
+{
+    GHashTable *fields;
+    const char *old;
+
+    if (!data->delta)
+        return true;
+
+    if (!(fields = g_hash_table_lookup(data->last, uuid))) {
+        fields = virHashNew(g_free);
+        g_hash_table_insert(data->last, g_strdup(uuid), fields);
+    }
+
+    if ((old = g_hash_table_lookup(fields, field)) && STREQ(old, value))
+        return false;
+
+    g_hash_table_insert(fields, g_strdup(field), g_strdup(value));
+    return true;
+}
+
+
+static virJSONValue *
+virshDomainStatsParamToJSON(virTypedParameterPtr param)
+{
+    switch ((virTypedParameterType) param->type) {
+    case VIR_TYPED_PARAM_INT:
+        return virJSONValueNewNumberInt(param->value.i);
+    case VIR_TYPED_PARAM_UINT:
+        return virJSONValueNewNumberUint(param->value.ui);
+    case VIR_TYPED_PARAM_LLONG:
+        return virJSONValueNewNumberLong(param->value.l);
+    case VIR_TYPED_PARAM_ULLONG:
+        return virJSONValueNewNumberUlong(param->value.ul);
+    case VIR_TYPED_PARAM_DOUBLE:
+        return virJSONValueNewNumberDouble(param->value.d);
+    case VIR_TYPED_PARAM_BOOLEAN:
+        return virJSONValueNewBoolean(param->value.b);
+    case VIR_TYPED_PARAM_STRING:
+        return virJSONValueNewString(param->value.s);
+    case VIR_TYPED_PARAM_LAST:
+    default:
+        break;
+    }
+
+    return virJSONValueNewNull();
+}
+
+
+/**
+ * virshDomainStatsPrintRecord:
+ * @ctl: virsh control structure
+ * @record: stats record of a single domain
+ * @data: print state
+ *
+ * Prints @record either as a block of key=value lines, or as a single
+ * line JSON object when JSON output was requested. In delta mode only
+ * fields which changed since the previous sample are printed and a
+ * record without any changes is skipped entirely.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+virshDomainStatsPrintRecord(vshControl *ctl,
                             virDomainStatsRecordPtr record,
-                            bool raw G_GNUC_UNUSED)
+                            virshDomainStatsPrintData *data)
 {
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virJSONValue) stats = NULL;
+    char uuid[VIR_UUID_STRING_BUFLEN] = "";
+    size_t nprinted = 0;
     size_t i;
 
-    vshPrint(ctl, "Domain: '%s'\n", virDomainGetName(record->dom));
+    if (data->delta &&
+        virDomainGetUUIDString(record->dom, uuid) < 0)
+        return -1;
+
+    if (data->json)
+        stats = virJSONValueNewObject();
 
     /* XXX: Implement pretty-printing */
 
     for (i = 0; i < record->nparams; i++) {
+        virTypedParameterPtr field = record->params + i;
         g_autofree char *param = NULL;
 
-        if (!(param = vshGetTypedParamValue(ctl, record->params + i)))
-            return false;
+        if (!(param = vshGetTypedParamValue(ctl, field)))
+            return -1;
+
+        if (!virshDomainStatsFieldChanged(data, uuid, field->field, param))
+            continue;
+
+        if (stats) {
+            g_autoptr(virJSONValue) value = virshDomainStatsParamToJSON(field);
 
-        vshPrint(ctl, "  %s=%s\n", record->params[i].field, param);
+            if (virJSONValueObjectAppend(stats, field->field, &value) < 0)
+                return -1;
+        } else {
+            virBufferAsprintf(&buf, "  %s=%s\n", field->field, param);
+        }
+        nprinted++;
+    }
+
+    if (data->delta && nprinted == 0)
+        return 0;
+
+    /* Keep the records separated by an empty line in the text output */
+    if (!data->json && data->nprinted++ > 0)
+        vshPrint(ctl, "\n");
+
+    if (stats) {
+        g_autoptr(virJSONValue) obj = NULL;
+        g_autofree char *str = NULL;
+
+        if (virJSONValueObjectAdd(&obj,
+                                  "s:domain", virDomainGetName(record->dom),
+                                  "I:timestamp", (long long) (g_get_real_time() / 1000),
+                                  "a:stats", &stats,
+                                  NULL) < 0)
+            return -1;
+
+        if (!(str = virJSONValueToString(obj, false)))
+            return -1;
+
+        vshPrint(ctl, "%s\n", str);
+    } else {
+        vshPrint(ctl, "Domain: '%s'\n", virDomainGetName(record->dom));
+        vshPrint(ctl, "%s", virBufferCurrentContent(&buf));
     }
 
+    return 0;
+}
+
+
+static bool
+virshDomainStatsPrintSample(vshControl *ctl,
+                            virDomainStatsRecordPtr *records,
+                            virshDomainStatsPrintData *data)
+{
+    virDomainStatsRecordPtr *next;
+
+    data->nprinted = 0;
+
+    for (next = records; *next; next++) {
+        if (virshDomainStatsPrintRecord(ctl, *next, data) < 0)
+            return false;
+    }
+
+    fflush(stdout);
     return true;
 }
 
@@ -2150,13 +2331,28 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
     virDomainPtr dom;
     size_t ndoms = 0;
     virDomainStatsRecordPtr *records = NULL;
-    virDomainStatsRecordPtr *next;
-    bool raw = vshCommandOptBool(cmd, "raw");
+    virshDomainStatsPrintData data = {
+        .raw = vshCommandOptBool(cmd, "raw"),
+        .json = vshCommandOptBool(cmd, "json"),
+        .delta = vshCommandOptBool(cmd, "delta"),
+    };
+    int interval = 0;
     int flags = 0;
     const vshCmdOpt *opt = NULL;
     bool ret = false;
     virshControl *priv = ctl->privData;
 
+    VSH_REQUIRE_OPTION("delta", "interval");
+    VSH_EXCLUSIVE_OPTIONS("json", "raw");
+
+    if (vshCommandOptInt(ctl, cmd, "interval", &interval) < 0)
+        return false;
+
+    if (interval < 0 || interval > INT_MAX / 1000) {
+        vshError(ctl, _("invalid interval value '%d'"), interval);
+        return false;
+    }
+
     if (vshCommandOptBool(cmd, "state"))
         stats |= VIR_DOMAIN_STATS_STATE;
 
@@ -2187,6 +2383,15 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
     if (vshCommandOptBool(cmd, "dirtyrate"))
         stats |= VIR_DOMAIN_STATS_DIRTYRATE;
 
+    if (vshCommandOptBool(cmd, "vm"))
+        stats |= VIR_DOMAIN_STATS_VM;
+
+    if (vshCommandOptBool(cmd, "monitor"))
+        stats |= VIR_DOMAIN_STATS_MONITOR;
+
+    if (vshCommandOptBool(cmd, "blockjob"))
+        stats |= VIR_DOMAIN_STATS_BLOCKJOB;
+
     if (vshCommandOptBool(cmd, "list-active"))
         flags |= VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE;
 
@@ -2233,37 +2438,58 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
             if (VIR_INSERT_ELEMENT(domlist, ndoms - 1, ndoms, dom) < 0)
                 goto cleanup;
         }
+    }
+
+    if (data.delta)
+        data.last = virHashNew((GDestroyNotify) g_hash_table_unref);
+
+    /* In the interval mode the periodic event loop timer wakes us up for
+     * the next sample until the user interrupts us. */
+    if (interval > 0 &&
+        vshEventStart(ctl, interval * 1000) < 0)
+        goto cleanup;
+
+    while (true) {
+        int rc;
 
-        if (virDomainListGetStats(domlist,
-                                  stats,
-                                  &records,
-                                  flags) < 0)
+        if (domlist)
+            rc = virDomainListGetStats(domlist, stats, &records, flags);
+        else
+            rc = virConnectGetAllDomainStats(priv->conn, stats, &records, flags);
+
+        if (rc < 0)
             goto cleanup;
-    } else {
-       if ((virConnectGetAllDomainStats(priv->conn,
-                                        stats,
-                                        &records,
-                                        flags)) < 0)
-           goto cleanup;
-    }
 
-    next = records;
-    while (*next) {
-        if (!virshDomainStatsPrintRecord(ctl, *next, raw))
+        if (!virshDomainStatsPrintSample(ctl, records, &data))
             goto cleanup;
 
-        if (*(++next))
+        g_clear_pointer(&records, virDomainStatsRecordListFree);
+
+        if (interval == 0)
+            break;
+
+        if (!data.json && data.nprinted > 0)
             vshPrint(ctl, "\n");
+
+        rc = vshEventWait(ctl);
+        if (rc == VSH_EVENT_INTERRUPT)
+            break;
+        if (rc < 0)
+            goto cleanup;
     }
 
     ret = true;
  cleanup:
+    if (interval > 0)
+        vshEventCleanup(ctl);
+    g_clear_pointer(&data.last, g_hash_table_unref);
     virDomainStatsRecordListFree(records);
     virObjectListFree(domlist);
 
     return ret;
 }
 
+
 /* "domifaddr" command
  */
 static const vshCmdInfo info_domifaddr[] = {
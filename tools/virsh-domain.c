@@ -372,6 +372,105 @@ cmdAttachDevice(vshControl *ctl, const vshCmd *cmd)
     return true;
 }
 
+/*
+ * "attach-devices" command
+ */
+static const vshCmdInfo info_attach_devices[] = {
+    {.name = "help",
+     .data = N_("attach multiple devices from XML files")
+    },
+    {.name = "desc",
+     .data = N_("Attach the devices from all given XML <file>s at once.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_attach_devices[] = {
+    VIRSH_COMMON_OPT_DOMAIN_FULL(0),
+    VIRSH_COMMON_OPT_DOMAIN_PERSISTENT,
+    VIRSH_COMMON_OPT_DOMAIN_CONFIG,
+    VIRSH_COMMON_OPT_DOMAIN_LIVE,
+    VIRSH_COMMON_OPT_DOMAIN_CURRENT,
+    {.name = "file",
+     .type = VSH_OT_ARGV,
+     .flags = VSH_OFLAG_REQ,
+     .completer = virshCompletePathLocalExisting,
+     .help = N_("XML files")
+    },
+    {.name = NULL}
+};
+
+static bool
+virshDomainModifyDevices(vshControl *ctl,
+                         const vshCmd *cmd,
+                         bool attach)
+{
+    g_autoptr(virshDomain) dom = NULL;
+    const vshCmdOpt *opt = NULL;
+    g_autoptr(GPtrArray) buffers = g_ptr_array_new_with_free_func(g_free);
+    int rv;
+    unsigned int flags = VIR_DOMAIN_AFFECT_CURRENT;
+    bool current = vshCommandOptBool(cmd, "current");
+    bool config = vshCommandOptBool(cmd, "config");
+    bool live = vshCommandOptBool(cmd, "live");
+    bool persistent = vshCommandOptBool(cmd, "persistent");
+
+    VSH_EXCLUSIVE_OPTIONS_VAR(persistent, current);
+
+    VSH_EXCLUSIVE_OPTIONS_VAR(current, live);
+    VSH_EXCLUSIVE_OPTIONS_VAR(current, config);
+
+    if (config || persistent)
+        flags |= VIR_DOMAIN_AFFECT_CONFIG;
+    if (live)
+        flags |= VIR_DOMAIN_AFFECT_LIVE;
+
+    if (!(dom = virshCommandOptDomain(ctl, cmd, NULL)))
+        return false;
+
+    if (persistent &&
+        virDomainIsActive(dom) == 1)
+        flags |= VIR_DOMAIN_AFFECT_LIVE;
+
+    while ((opt = vshCommandOptArgv(ctl, cmd, opt))) {
+        char *buffer;
+
+        if (virFileReadAll(opt->data, VSH_MAX_XML_FILE, &buffer) < 0) {
+            vshReportError(ctl);
+            return false;
+        }
+
+        g_ptr_array_add(buffers, buffer);
+    }
+
+    if (attach)
+        rv = virDomainAttachDevices(dom, (const char **) buffers->pdata,
+                                    buffers->len, flags);
+    else
+        rv = virDomainDetachDevices(dom, (const char **) buffers->pdata,
+                                    buffers->len, flags);
+
+    if (rv < 0) {
+        if (attach)
+            vshError(ctl, "%s", _("Failed to attach devices"));
+        else
+            vshError(ctl, "%s", _("Failed to detach devices"));
+        return false;
+    }
+
+    if (attach)
+        vshPrintExtra(ctl, "%s", _("Devices attached successfully\n"));
+    else
+        vshPrintExtra(ctl, "%s", _("Devices detached successfully\n"));
+    return true;
+}
+
+static bool
+cmdAttachDevices(vshControl *ctl, const vshCmd *cmd)
+{
+    return virshDomainModifyDevices(ctl, cmd, true);
+}
+
 /*
  * "attach-disk" command
  */
@@ -3958,6 +4057,192 @@ cmdUndefine(vshControl *ctl, const vshCmd *cmd)
     goto cleanup;
 }
 
+typedef bool (*virshDomainBulkFunc)(vshControl *ctl,
+                                    virDomainPtr dom,
+                                    void *opaque);
+
+typedef int (*virshDomainBulkAPI)(virConnectPtr conn,
+                                  virDomainPtr *domains,
+                                  unsigned int ndomains,
+                                  unsigned int parallel,
+                                  int *results,
+                                  unsigned int flags);
+
+typedef void (*virshDomainBulkReportFunc)(vshControl *ctl,
+                                          virDomainPtr dom,
+                                          int result);
+
+typedef struct _virshDomainBulkData virshDomainBulkData;
+struct _virshDomainBulkData {
+    vshControl *ctl;
+    virshDomainBulkFunc func;
+    void *opaque;
+
+    virMutex lock;
+    virDomainPtr *domains;
+    size_t ndomains;
+    size_t next;
+    bool ret;
+};
+
+
+static void
+virshDomainBulkWorker(void *opaque)
+{
+    virshDomainBulkData *data = opaque;
+
+    while (true) {
+        virDomainPtr dom;
+        bool ok;
+
+        virMutexLock(&data->lock);
+        if (data->next == data->ndomains) {
+            virMutexUnlock(&data->lock);
+            return;
+        }
+        dom = data->domains[data->next++];
+        virMutexUnlock(&data->lock);
+
+        if (!(ok = data->func(data->ctl, dom, data->opaque))) {
+            /* Errors are reported per domain here rather than once
+             * when the command finishes */
+            if (virGetLastErrorCode() != VIR_ERR_OK)
+                vshError(data->ctl, "%s", virGetLastErrorMessage());
+        }
+
+        virMutexLock(&data->lock);
+        if (!ok)
+            data->ret = false;
+        virMutexUnlock(&data->lock);
+    }
+}
+
+
+/**
+ * virshDomainBulk:
+ * @ctl: virsh control structure
+ * @listFlags: flags for virConnectListAllDomains
+ * @parallel: maximum number of domains to process at once
+ * @api: optional API handling all the domains in a single call
+ * @apiFlags: flags for @api
+ * @report: function reporting the outcome of @api for each domain
+ * @func: function to call for each domain
+ * @opaque: opaque data for @func
+ *
+ * Call @func for each domain matching @listFlags. Up to @parallel
+ * calls are issued concurrently over the shared connection, so that
+ * acting on many domains neither requires a virsh invocation per
+ * domain nor waits for each domain in turn.
+ *
+ * If @api is given, the domains are handed over to it first and @func
+ * is only used with servers which don't support @api.
+ *
+ * Returns true if @func succeeded for all the domains.
+ */
+static bool
+virshDomainBulk(vshControl *ctl,
+                unsigned int listFlags,
+                unsigned int parallel,
+                virshDomainBulkAPI api,
+                unsigned int apiFlags,
+                virshDomainBulkReportFunc report,
+                virshDomainBulkFunc func,
+                void *opaque)
+{
+    virshControl *priv = ctl->privData;
+    virshDomainBulkData data = { .ctl = ctl, .func = func,
+                                 .opaque = opaque, .ret = true };
+    g_autofree virThread *threads = NULL;
+    size_t nthreads = 0;
+    int ndomains;
+    size_t i;
+
+    if ((ndomains = virConnectListAllDomains(priv->conn, &data.domains,
+                                             listFlags)) < 0) {
+        vshError(ctl, "%s", _("Failed to list domains"));
+        return false;
+    }
+    data.ndomains = ndomains;
+
+    if (api && data.ndomains > 0) {
+        g_autofree int *results = g_new0(int, data.ndomains);
+
+        if (api(priv->conn, data.domains, data.ndomains, parallel,
+                results, apiFlags) >= 0) {
+            for (i = 0; i < data.ndomains; i++) {
+                report(ctl, data.domains[i], results[i]);
+                if (results[i] != 0)
+                    data.ret = false;
+            }
+            goto cleanup;
+        }
+
+        /* Older daemons reject the procedure as unknown */
+        if (virGetLastErrorCode() != VIR_ERR_NO_SUPPORT &&
+            virGetLastErrorCode() != VIR_ERR_RPC) {
+            vshError(ctl, "%s", virGetLastErrorMessage());
+            vshResetLibvirtError();
+            data.ret = false;
+            goto cleanup;
+        }
+
+        vshResetLibvirtError();
+    }
+
+    if (virMutexInit(&data.lock) < 0) {
+        vshError(ctl, "%s", _("Unable to initialize mutex"));
+        data.ret = false;
+        goto cleanup;
+    }
+
+    parallel = MIN(parallel, data.ndomains);
+    threads = g_new0(virThread, parallel);
+
+    for (i = 0; i < parallel; i++) {
+        if (virThreadCreate(&threads[i], true, virshDomainBulkWorker, &data) < 0)
+            break;
+        nthreads++;
+    }
+
+    /* Process the domains ourselves if no thread could be started */
+    if (nthreads == 0)
+        virshDomainBulkWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data.lock);
+
+    /* All errors were reported already */
+    vshResetLibvirtError();
+
+ cleanup:
+    for (i = 0; i < data.ndomains; i++)
+        virshDomainFree(data.domains[i]);
+    g_free(data.domains);
+    return data.ret;
+}
+
+
+static int
+virshDomainBulkGetParallel(vshControl *ctl,
+                           const vshCmd *cmd,
+                           unsigned int *parallel)
+{
+    *parallel = 1;
+
+    if (vshCommandOptUInt(ctl, cmd, "parallel", parallel) < 0)
+        return -1;
+
+    if (*parallel == 0) {
+        vshError(ctl, "%s", _("--parallel must be greater than zero"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /*
  * "start" command
  */
@@ -3974,8 +4259,8 @@ static const vshCmdInfo info_start[] = {
 };
 
 static const vshCmdOptDef opts_start[] = {
-    VIRSH_COMMON_OPT_DOMAIN(N_("name of the inactive domain"),
-                            VIR_CONNECT_LIST_DOMAINS_SHUTOFF),
+    VIRSH_COMMON_OPT_DOMAIN_OT_STRING(N_("name of the inactive domain"),
+                                      0, VIR_CONNECT_LIST_DOMAINS_SHUTOFF),
 #ifndef WIN32
     {.name = "console",
      .type = VSH_OT_BOOL,
@@ -4003,6 +4288,15 @@ static const vshCmdOptDef opts_start[] = {
      .completer = virshCompleteEmpty,
      .help = N_("pass file descriptors N,M,... to the guest")
     },
+    {.name = "all",
+     .type = VSH_OT_BOOL,
+     .help = N_("start all inactive persistent domains")
+    },
+    {.name = "parallel",
+     .type = VSH_OT_INT,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .help = N_("number of domains to start at once with --all")
+    },
     {.name = NULL}
 };
 
@@ -4049,37 +4343,13 @@ cmdStartGetFDs(vshControl *ctl,
 }
 
 static bool
-cmdStart(vshControl *ctl, const vshCmd *cmd)
+cmdStartDomain(vshControl *ctl,
+               virDomainPtr dom,
+               unsigned int flags,
+               size_t nfds,
+               int *fds)
 {
-    g_autoptr(virshDomain) dom = NULL;
-#ifndef WIN32
-    bool console = vshCommandOptBool(cmd, "console");
-#endif
-    unsigned int flags = VIR_DOMAIN_NONE;
     int rc;
-    size_t nfds = 0;
-    g_autofree int *fds = NULL;
-
-    if (!(dom = virshCommandOptDomainBy(ctl, cmd, NULL,
-                                        VIRSH_BYNAME | VIRSH_BYUUID)))
-        return false;
-
-    if (virDomainGetID(dom) != (unsigned int)-1) {
-        vshError(ctl, "%s", _("Domain is already active"));
-        return false;
-    }
-
-    if (cmdStartGetFDs(ctl, cmd, &nfds, &fds) < 0)
-        return false;
-
-    if (vshCommandOptBool(cmd, "paused"))
-        flags |= VIR_DOMAIN_START_PAUSED;
-    if (vshCommandOptBool(cmd, "autodestroy"))
-        flags |= VIR_DOMAIN_START_AUTODESTROY;
-    if (vshCommandOptBool(cmd, "bypass-cache"))
-        flags |= VIR_DOMAIN_START_BYPASS_CACHE;
-    if (vshCommandOptBool(cmd, "force-boot"))
-        flags |= VIR_DOMAIN_START_FORCE_BOOT;
 
     /* We can emulate force boot, even for older servers that reject it.  */
     if (flags & VIR_DOMAIN_START_FORCE_BOOT) {
@@ -4087,9 +4357,9 @@ cmdStart(vshControl *ctl, const vshCmd *cmd)
              virDomainCreateWithFiles(dom, nfds, fds, flags) :
              virDomainCreateWithFlags(dom, flags)) == 0)
             goto started;
-        if (last_error->code != VIR_ERR_NO_SUPPORT &&
-            last_error->code != VIR_ERR_INVALID_ARG) {
-            vshReportError(ctl);
+        if (virGetLastErrorCode() != VIR_ERR_NO_SUPPORT &&
+            virGetLastErrorCode() != VIR_ERR_INVALID_ARG) {
+            vshError(ctl, _("Failed to start domain '%s'"), virDomainGetName(dom));
             return false;
         }
         vshResetLibvirtError();
@@ -4099,7 +4369,7 @@ cmdStart(vshControl *ctl, const vshCmd *cmd)
             vshResetLibvirtError();
         } else if (rc > 0) {
             if (virDomainManagedSaveRemove(dom, 0) < 0) {
-                vshReportError(ctl);
+                vshError(ctl, _("Failed to start domain '%s'"), virDomainGetName(dom));
                 return false;
             }
         }
@@ -4117,6 +4387,95 @@ cmdStart(vshControl *ctl, const vshCmd *cmd)
  started:
     vshPrintExtra(ctl, _("Domain '%s' started\n"),
                   virDomainGetName(dom));
+    return true;
+}
+
+static bool
+cmdStartBulk(vshControl *ctl,
+             virDomainPtr dom,
+             void *opaque)
+{
+    unsigned int *flags = opaque;
+
+    return cmdStartDomain(ctl, dom, *flags, 0, NULL);
+}
+
+static void
+cmdStartBulkReport(vshControl *ctl,
+                   virDomainPtr dom,
+                   int result)
+{
+    if (result == 0)
+        vshPrintExtra(ctl, _("Domain '%s' started\n"), virDomainGetName(dom));
+    else
+        vshError(ctl, _("Failed to start domain '%s' (error code %d)"),
+                 virDomainGetName(dom), result);
+}
+
+static bool
+cmdStart(vshControl *ctl, const vshCmd *cmd)
+{
+    g_autoptr(virshDomain) dom = NULL;
+#ifndef WIN32
+    bool console = vshCommandOptBool(cmd, "console");
+#endif
+    bool all = vshCommandOptBool(cmd, "all");
+    unsigned int flags = VIR_DOMAIN_NONE;
+    unsigned int parallel;
+    size_t nfds = 0;
+    g_autofree int *fds = NULL;
+
+    VSH_EXCLUSIVE_OPTIONS("all", "domain");
+#ifndef WIN32
+    VSH_EXCLUSIVE_OPTIONS("all", "console");
+#endif
+    VSH_EXCLUSIVE_OPTIONS("all", "pass-fds");
+    VSH_REQUIRE_OPTION("parallel", "all");
+
+    if (vshCommandOptBool(cmd, "paused"))
+        flags |= VIR_DOMAIN_START_PAUSED;
+    if (vshCommandOptBool(cmd, "autodestroy"))
+        flags |= VIR_DOMAIN_START_AUTODESTROY;
+    if (vshCommandOptBool(cmd, "bypass-cache"))
+        flags |= VIR_DOMAIN_START_BYPASS_CACHE;
+    if (vshCommandOptBool(cmd, "force-boot"))
+        flags |= VIR_DOMAIN_START_FORCE_BOOT;
+
+    if (all) {
+        if (virshDomainBulkGetParallel(ctl, cmd, &parallel) < 0)
+            return false;
+
+        /* The bulk API can't tie the domains to this connection */
+        return virshDomainBulk(ctl,
+                               VIR_CONNECT_LIST_DOMAINS_PERSISTENT |
+                               VIR_CONNECT_LIST_DOMAINS_INACTIVE,
+                               parallel,
+                               (flags & VIR_DOMAIN_START_AUTODESTROY) ?
+                               NULL : virConnectStartDomains,
+                               flags, cmdStartBulkReport,
+                               cmdStartBulk, &flags);
+    }
+
+    if (!vshCommandOptBool(cmd, "domain")) {
+        vshError(ctl, "%s", _("either a domain or --all must be specified"));
+        return false;
+    }
+
+    if (!(dom = virshCommandOptDomainBy(ctl, cmd, NULL,
+                                        VIRSH_BYNAME | VIRSH_BYUUID)))
+        return false;
+
+    if (virDomainGetID(dom) != (unsigned int)-1) {
+        vshError(ctl, "%s", _("Domain is already active"));
+        return false;
+    }
+
+    if (cmdStartGetFDs(ctl, cmd, &nfds, &fds) < 0)
+        return false;
+
+    if (!cmdStartDomain(ctl, dom, flags, nfds, fds))
+        return false;
+
 #ifndef WIN32
     if (console && !cmdRunConsole(ctl, dom, NULL, 0))
         return false;
@@ -5821,26 +6180,72 @@ static const vshCmdInfo info_shutdown[] = {
 };
 
 static const vshCmdOptDef opts_shutdown[] = {
-    VIRSH_COMMON_OPT_DOMAIN_FULL(VIR_CONNECT_LIST_DOMAINS_ACTIVE),
+    VIRSH_COMMON_OPT_DOMAIN_OT_STRING_FULL(0, VIR_CONNECT_LIST_DOMAINS_ACTIVE),
     {.name = "mode",
      .type = VSH_OT_STRING,
      .completer = virshDomainShutdownModeCompleter,
      .help = N_("shutdown mode: acpi|agent|initctl|signal|paravirt")
     },
+    {.name = "all",
+     .type = VSH_OT_BOOL,
+     .help = N_("shutdown all running domains")
+    },
+    {.name = "parallel",
+     .type = VSH_OT_INT,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .help = N_("number of domains to shutdown at once with --all")
+    },
     {.name = NULL}
 };
 
+static bool
+cmdShutdownDomain(vshControl *ctl,
+                  virDomainPtr dom,
+                  void *opaque)
+{
+    unsigned int *flags = opaque;
+    int rv;
+
+    if (*flags)
+        rv = virDomainShutdownFlags(dom, *flags);
+    else
+        rv = virDomainShutdown(dom);
+
+    if (rv != 0) {
+        vshError(ctl, _("Failed to shutdown domain '%s'"), virDomainGetName(dom));
+        return false;
+    }
+
+    vshPrintExtra(ctl, _("Domain '%s' is being shutdown\n"), virDomainGetName(dom));
+    return true;
+}
+
+static void
+cmdShutdownBulkReport(vshControl *ctl,
+                      virDomainPtr dom,
+                      int result)
+{
+    if (result == 0)
+        vshPrintExtra(ctl, _("Domain '%s' is being shutdown\n"),
+                      virDomainGetName(dom));
+    else
+        vshError(ctl, _("Failed to shutdown domain '%s' (error code %d)"),
+                 virDomainGetName(dom), result);
+}
+
 static bool
 cmdShutdown(vshControl *ctl, const vshCmd *cmd)
 {
     g_autoptr(virshDomain) dom = NULL;
-    const char *name;
     const char *mode = NULL;
-    int flags = 0;
-    int rv;
+    unsigned int flags = 0;
+    unsigned int parallel;
     g_auto(GStrv) modes = NULL;
     char **tmp;
 
+    VSH_EXCLUSIVE_OPTIONS("all", "domain");
+    VSH_REQUIRE_OPTION("parallel", "all");
+
     if (vshCommandOptStringReq(ctl, cmd, "mode", &mode) < 0)
         return false;
 
@@ -5871,21 +6276,25 @@ cmdShutdown(vshControl *ctl, const vshCmd *cmd)
         tmp++;
     }
 
-    if (!(dom = virshCommandOptDomain(ctl, cmd, &name)))
-        return false;
+    if (vshCommandOptBool(cmd, "all")) {
+        if (virshDomainBulkGetParallel(ctl, cmd, &parallel) < 0)
+            return false;
 
-    if (flags)
-        rv = virDomainShutdownFlags(dom, flags);
-    else
-        rv = virDomainShutdown(dom);
+        return virshDomainBulk(ctl, VIR_CONNECT_LIST_DOMAINS_ACTIVE,
+                               parallel, virConnectShutdownDomains, flags,
+                               cmdShutdownBulkReport,
+                               cmdShutdownDomain, &flags);
+    }
 
-    if (rv != 0) {
-        vshError(ctl, _("Failed to shutdown domain '%s'"), name);
+    if (!vshCommandOptBool(cmd, "domain")) {
+        vshError(ctl, "%s", _("either a domain or --all must be specified"));
         return false;
     }
 
-    vshPrintExtra(ctl, _("Domain '%s' is being shutdown\n"), name);
-    return true;
+    if (!(dom = virshCommandOptDomain(ctl, cmd, NULL)))
+        return false;
+
+    return cmdShutdownDomain(ctl, dom, &flags);
 }
 
 /*
@@ -8090,6 +8499,10 @@ static const vshCmdOptDef opts_create[] = {
      .type = VSH_OT_BOOL,
      .help = N_("validate the XML against the schema")
     },
+    {.name = "incoming",
+     .type = VSH_OT_BOOL,
+     .help = N_("wait for an incoming migration of the domain")
+    },
     {.name = NULL}
 };
 
@@ -8122,6 +8535,8 @@ cmdCreate(vshControl *ctl, const vshCmd *cmd)
         flags |= VIR_DOMAIN_START_AUTODESTROY;
     if (vshCommandOptBool(cmd, "validate"))
         flags |= VIR_DOMAIN_START_VALIDATE;
+    if (vshCommandOptBool(cmd, "incoming"))
+        flags |= VIR_DOMAIN_START_INCOMING;
 
     if (nfds)
         dom = virDomainCreateXMLWithFiles(priv->conn, buffer, nfds, fds, flags);
@@ -10164,6 +10579,11 @@ static const vshCmdOptDef opts_dumpxml[] = {
      .type = VSH_OT_BOOL,
      .help = N_("provide XML suitable for migrations")
     },
+    {.name = "section",
+     .type = VSH_OT_STRING,
+     .help = N_("comma separated list of sections to dump: "
+                "metadata, disks, interfaces")
+    },
     {.name = NULL}
 };
 
@@ -10177,6 +10597,7 @@ cmdDumpXML(vshControl *ctl, const vshCmd *cmd)
     bool secure = vshCommandOptBool(cmd, "security-info");
     bool update = vshCommandOptBool(cmd, "update-cpu");
     bool migratable = vshCommandOptBool(cmd, "migratable");
+    const char *section = NULL;
 
     if (inactive)
         flags |= VIR_DOMAIN_XML_INACTIVE;
@@ -10187,6 +10608,27 @@ cmdDumpXML(vshControl *ctl, const vshCmd *cmd)
     if (migratable)
         flags |= VIR_DOMAIN_XML_MIGRATABLE;
 
+    if (vshCommandOptStringReq(ctl, cmd, "section", &section) < 0)
+        return false;
+
+    if (section) {
+        g_auto(GStrv) sections = g_strsplit(section, ",", 0);
+        GStrv next;
+
+        for (next = sections; *next; next++) {
+            if (STREQ(*next, "metadata")) {
+                flags |= VIR_DOMAIN_XML_SECTION_METADATA;
+            } else if (STREQ(*next, "disks")) {
+                flags |= VIR_DOMAIN_XML_SECTION_DISKS;
+            } else if (STREQ(*next, "interfaces")) {
+                flags |= VIR_DOMAIN_XML_SECTION_INTERFACES;
+            } else {
+                vshError(ctl, _("unknown domain XML section '%s'"), *next);
+                return false;
+            }
+        }
+    }
+
     if (!(dom = virshCommandOptDomain(ctl, cmd, NULL)))
         return false;
 
@@ -11927,6 +12369,41 @@ cmdDetachDevice(vshControl *ctl, const vshCmd *cmd)
 }
 
 
+/*
+ * "detach-devices" command
+ */
+static const vshCmdInfo info_detach_devices[] = {
+    {.name = "help",
+     .data = N_("detach multiple devices from XML files")
+    },
+    {.name = "desc",
+     .data = N_("Detach the devices from all given XML <file>s at once.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_detach_devices[] = {
+    VIRSH_COMMON_OPT_DOMAIN_FULL(0),
+    VIRSH_COMMON_OPT_DOMAIN_PERSISTENT,
+    VIRSH_COMMON_OPT_DOMAIN_CONFIG,
+    VIRSH_COMMON_OPT_DOMAIN_LIVE,
+    VIRSH_COMMON_OPT_DOMAIN_CURRENT,
+    {.name = "file",
+     .type = VSH_OT_ARGV,
+     .flags = VSH_OFLAG_REQ,
+     .completer = virshCompletePathLocalExisting,
+     .help = N_("XML files")
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdDetachDevices(vshControl *ctl, const vshCmd *cmd)
+{
+    return virshDomainModifyDevices(ctl, cmd, false);
+}
+
+
 /*
  * "detach-device-alias" command
  */
@@ -13400,6 +13877,28 @@ virshEventMemoryDeviceSizeChangePrint(virConnectPtr conn G_GNUC_UNUSED,
 }
 
 
+static void
+virshEventStatsPrint(virConnectPtr conn G_GNUC_UNUSED,
+                     virDomainPtr dom,
+                     virTypedParameterPtr params,
+                     int nparams,
+                     void *opaque)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    virBufferAsprintf(&buf, _("event 'stats' for domain '%s':\n"),
+                      virDomainGetName(dom));
+    for (i = 0; i < nparams; i++) {
+        g_autofree char *value = virTypedParameterToString(&params[i]);
+
+        if (value)
+            virBufferAsprintf(&buf, "\t%s: %s\n", params[i].field, value);
+    }
+    virshEventPrint(opaque, &buf);
+}
+
+
 virshDomainEventCallback virshDomainEventCallbacks[] = {
     { "lifecycle",
       VIR_DOMAIN_EVENT_CALLBACK(virshEventLifecyclePrint), },
@@ -13453,6 +13952,8 @@ virshDomainEventCallback virshDomainEventCallbacks[] = {
       VIR_DOMAIN_EVENT_CALLBACK(virshEventMemoryFailurePrint), },
     { "memory-device-size-change",
       VIR_DOMAIN_EVENT_CALLBACK(virshEventMemoryDeviceSizeChangePrint), },
+    { "stats",
+      VIR_DOMAIN_EVENT_CALLBACK(virshEventStatsPrint), },
 };
 G_STATIC_ASSERT(VIR_DOMAIN_EVENT_ID_LAST == G_N_ELEMENTS(virshDomainEventCallbacks));
 
@@ -14300,14 +14801,28 @@ static const vshCmdOptDef opts_domdirtyrate_calc[] = {
      .help = N_("calculate memory dirty rate within specified seconds, "
                 "the supported value range from 1 to 60, default to 1.")
     },
+    {.name = "mode",
+     .type = VSH_OT_STRING,
+     .completer = virshDomainDirtyRateCalcModeCompleter,
+     .help = N_("dirty page rate calculation mode, either of these 3 options "
+                "'page-sampling, dirty-bitmap, dirty-ring' can be specified.")
+    },
     {.name = NULL}
 };
 
+VIR_ENUM_IMPL(virshDomainDirtyRateCalcMode,
+              VIRSH_DOMAIN_DIRTYRATE_CALC_MODE_LAST,
+              "page-sampling",
+              "dirty-bitmap",
+              "dirty-ring");
+
 static bool
 cmdDomDirtyRateCalc(vshControl *ctl, const vshCmd *cmd)
 {
     g_autoptr(virshDomain) dom = NULL;
     int seconds = 1; /* the default value is 1 */
+    const char *modestr = NULL;
+    unsigned int flags = 0;
 
     if (!(dom = virshCommandOptDomain(ctl, cmd, NULL)))
         return false;
@@ -14315,7 +14830,33 @@ cmdDomDirtyRateCalc(vshControl *ctl, const vshCmd *cmd)
     if (vshCommandOptInt(ctl, cmd, "seconds", &seconds) < 0)
         return false;
 
-    if (virDomainStartDirtyRateCalc(dom, seconds, 0) < 0)
+    if (vshCommandOptStringReq(ctl, cmd, "mode", &modestr) < 0)
+        return false;
+
+    if (modestr) {
+        int mode = virshDomainDirtyRateCalcModeTypeFromString(modestr);
+
+        if (mode < 0) {
+            vshError(ctl, _("Unknown calculation mode '%s'"), modestr);
+            return false;
+        }
+
+        switch ((virshDomainDirtyRateCalcMode) mode) {
+        case VIRSH_DOMAIN_DIRTYRATE_CALC_MODE_PAGE_SAMPLING:
+            flags |= VIR_DOMAIN_DIRTYRATE_MODE_PAGE_SAMPLING;
+            break;
+        case VIRSH_DOMAIN_DIRTYRATE_CALC_MODE_DIRTY_BITMAP:
+            flags |= VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_BITMAP;
+            break;
+        case VIRSH_DOMAIN_DIRTYRATE_CALC_MODE_DIRTY_RING:
+            flags |= VIR_DOMAIN_DIRTYRATE_MODE_DIRTY_RING;
+            break;
+        case VIRSH_DOMAIN_DIRTYRATE_CALC_MODE_LAST:
+            break;
+        }
+    }
+
+    if (virDomainStartDirtyRateCalc(dom, seconds, flags) < 0)
         return false;
 
     vshPrintExtra(ctl, _("Start to calculate domain's memory "
@@ -14332,6 +14873,12 @@ const vshCmdDef domManagementCmds[] = {
      .info = info_attach_device,
      .flags = 0
     },
+    {.name = "attach-devices",
+     .handler = cmdAttachDevices,
+     .opts = opts_attach_devices,
+     .info = info_attach_devices,
+     .flags = 0
+    },
     {.name = "attach-disk",
      .handler = cmdAttachDisk,
      .opts = opts_attach_disk,
@@ -14442,6 +14989,12 @@ const vshCmdDef domManagementCmds[] = {
      .info = info_detach_device,
      .flags = 0
     },
+    {.name = "detach-devices",
+     .handler = cmdDetachDevices,
+     .opts = opts_detach_devices,
+     .info = info_detach_devices,
+     .flags = 0
+    },
     {.name = "detach-device-alias",
      .handler = cmdDetachDeviceAlias,
      .opts = opts_detach_device_alias,
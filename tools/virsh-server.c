@@ -0,0 +1,412 @@
+/*
+ * virsh-server.c: Run virsh commands over a persistent connection
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "virsh-server.h"
+
+#ifndef WIN32
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# include <arpa/inet.h>
+# include <fcntl.h>
+# include <signal.h>
+#endif /* !WIN32 */
+
+#include "internal.h"
+#include "virfile.h"
+#include "virsocket.h"
+#include "virstring.h"
+
+/*
+ * A virsh server keeps its connection to the hypervisor open and runs
+ * commands on behalf of short lived virsh clients, which saves them the
+ * cost of connecting and authenticating for every single command.
+ *
+ * A request consists of (integers are 32 bit in network byte order):
+ *
+ *   count
+ *   count x { length, bytes }
+ *   stdin, stdout and stderr of the client passed as SCM_RIGHTS
+ *
+ * The first string is the working directory of the client, the rest is
+ * the command and its arguments. The command runs with the client's
+ * standard streams and working directory and the server replies with
+ * a single byte holding the exit status.
+ */
+
+#ifndef WIN32
+
+/* Limits protecting the server from absurd requests */
+# define VIRSH_SERVER_MAX_ARGS 4096
+# define VIRSH_SERVER_MAX_ARG_LEN (1024 * 1024)
+
+static bool serving;
+
+
+static int
+virshServerWriteUInt(int fd,
+                     uint32_t val)
+{
+    val = htonl(val);
+
+    if (safewrite(fd, &val, sizeof(val)) != sizeof(val))
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virshServerReadUInt(int fd,
+                    uint32_t *val)
+{
+    ssize_t rc;
+
+    if ((rc = saferead(fd, val, sizeof(*val))) != sizeof(*val)) {
+        if (rc >= 0)
+            errno = ECONNRESET;
+        return -1;
+    }
+
+    *val = ntohl(*val);
+    return 0;
+}
+
+
+static int
+virshServerWriteString(int fd,
+                       const char *str)
+{
+    size_t len = strlen(str);
+
+    if (virshServerWriteUInt(fd, len) < 0 ||
+        safewrite(fd, str, len) != len)
+        return -1;
+
+    return 0;
+}
+
+
+static char *
+virshServerReadString(int fd)
+{
+    g_autofree char *str = NULL;
+    uint32_t len;
+    ssize_t rc;
+
+    if (virshServerReadUInt(fd, &len) < 0)
+        return NULL;
+
+    if (len > VIRSH_SERVER_MAX_ARG_LEN) {
+        errno = E2BIG;
+        return NULL;
+    }
+
+    str = g_new0(char, len + 1);
+    if ((rc = saferead(fd, str, len)) != len) {
+        if (rc >= 0)
+            errno = ECONNRESET;
+        return NULL;
+    }
+
+    return g_steal_pointer(&str);
+}
+
+
+/**
+ * virshServerRunCommand:
+ * @ctl: virsh control structure
+ * @path: path to the socket of the virsh server
+ * @argc: number of arguments
+ * @argv: command and its arguments
+ *
+ * Runs the command given in @argv in the virsh server listening on
+ * @path, using our standard streams and working directory.
+ *
+ * Returns the exit status of the command.
+ */
+int
+virshServerRunCommand(vshControl *ctl,
+                      const char *path,
+                      int argc,
+                      char **argv)
+{
+    VIR_AUTOCLOSE fd = -1;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    g_autofree char *cwd = g_get_current_dir();
+    ssize_t rc;
+    char status;
+    size_t i;
+
+    if (virStrcpyStatic(addr.sun_path, path) < 0) {
+        vshError(ctl, _("Socket path '%s' too long"), path);
+        return EXIT_FAILURE;
+    }
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        vshError(ctl, _("Unable to connect to virsh server '%s': %s"),
+                 path, g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (virshServerWriteUInt(fd, argc + 1) < 0 ||
+        virshServerWriteString(fd, cwd) < 0)
+        goto error;
+
+    for (i = 0; i < argc; i++) {
+        if (virshServerWriteString(fd, argv[i]) < 0)
+            goto error;
+    }
+
+    for (i = 0; i < 3; i++) {
+        if (virSocketSendFD(fd, i) < 0)
+            goto error;
+    }
+
+    if ((rc = saferead(fd, &status, 1)) != 1) {
+        if (rc == 0)
+            errno = ECONNRESET;
+        goto error;
+    }
+
+    return status;
+
+ error:
+    vshError(ctl, _("Unable to communicate with virsh server '%s': %s"),
+             path, g_strerror(errno));
+    return EXIT_FAILURE;
+}
+
+
+static int
+virshServerListen(vshControl *ctl,
+                  const char *path)
+{
+    int fd;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct stat sb;
+    mode_t oldmask;
+    int rc;
+
+    if (virStrcpyStatic(addr.sun_path, path) < 0) {
+        vshError(ctl, _("Socket path '%s' too long"), path);
+        return -1;
+    }
+
+    /* Remove a socket left behind by a previous server */
+    if (lstat(path, &sb) == 0) {
+        if (!S_ISSOCK(sb.st_mode)) {
+            vshError(ctl, _("'%s' exists and is not a socket"), path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        vshError(ctl, _("Unable to create socket: %s"), g_strerror(errno));
+        return -1;
+    }
+
+    /* The server runs commands with our credentials, so only we may
+     * talk to it */
+    oldmask = umask(0077);
+    rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(oldmask);
+
+    if (rc < 0 || listen(fd, 30) < 0) {
+        vshError(ctl, _("Unable to listen on '%s': %s"),
+                 path, g_strerror(errno));
+        VIR_FORCE_CLOSE(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+static char
+virshServerRun(vshControl *ctl,
+               char **args)
+{
+    g_autofree char *oldcwd = g_get_current_dir();
+    bool ret = false;
+
+    if (chdir(args[0]) < 0) {
+        vshError(ctl, _("Unable to change directory to '%s': %s"),
+                 args[0], g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (vshCommandArgvParse(ctl, g_strv_length(args + 1), args + 1))
+        ret = vshCommandRun(ctl, ctl->cmd);
+
+    if (chdir(oldcwd) < 0)
+        vshError(ctl, _("Unable to change directory to '%s': %s"),
+                 oldcwd, g_strerror(errno));
+
+    return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static int
+virshServerHandleClient(vshControl *ctl,
+                        int fd)
+{
+    g_auto(GStrv) args = NULL;
+    int fds[3] = { -1, -1, -1 };
+    int saved[3] = { -1, -1, -1 };
+    char status = EXIT_FAILURE;
+    uint32_t nargs;
+    int ret = -1;
+    size_t i;
+
+    if (virshServerReadUInt(fd, &nargs) < 0)
+        return -1;
+
+    if (nargs < 2 || nargs > VIRSH_SERVER_MAX_ARGS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    args = g_new0(char *, nargs + 1);
+    for (i = 0; i < nargs; i++) {
+        if (!(args[i] = virshServerReadString(fd)))
+            return -1;
+    }
+
+    for (i = 0; i < 3; i++) {
+        if ((fds[i] = virSocketRecvFD(fd, O_CLOEXEC)) < 0)
+            goto cleanup;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i = 0; i < 3; i++) {
+        if ((saved[i] = dup(i)) < 0 ||
+            dup2(fds[i], i) < 0)
+            goto restore;
+    }
+
+    status = virshServerRun(ctl, args);
+
+ restore:
+    fflush(stdout);
+    fflush(stderr);
+    for (i = 0; i < 3; i++) {
+        if (saved[i] >= 0) {
+            dup2(saved[i], i);
+            VIR_FORCE_CLOSE(saved[i]);
+        }
+    }
+
+    if (safewrite(fd, &status, 1) != 1)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < 3; i++)
+        VIR_FORCE_CLOSE(fds[i]);
+    return ret;
+}
+
+
+/*
+ * "server" command
+ */
+const vshCmdInfo info_server[] = {
+    {.name = "help",
+     .data = N_("run commands for other virsh processes")
+    },
+    {.name = "desc",
+     .data = N_("Listen on a UNIX socket and run commands sent by "
+                "'virsh --server' over the current connection.")
+    },
+    {.name = NULL}
+};
+
+const vshCmdOptDef opts_server[] = {
+    {.name = "socket",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .help = N_("path of the UNIX socket to listen on")
+    },
+    {.name = NULL}
+};
+
+bool
+cmdServer(vshControl *ctl, const vshCmd *cmd)
+{
+    VIR_AUTOCLOSE listenfd = -1;
+    const char *path = NULL;
+
+    if (vshCommandOptStringReq(ctl, cmd, "socket", &path) < 0)
+        return false;
+
+    if (serving) {
+        vshError(ctl, "%s", _("Already running as a server"));
+        return false;
+    }
+
+    if ((listenfd = virshServerListen(ctl, path)) < 0)
+        return false;
+
+    /* A client going away must not take the server down with it */
+    signal(SIGPIPE, SIG_IGN);
+    serving = true;
+
+    vshPrintExtra(ctl, _("Listening on '%s'\n"), path);
+    fflush(stdout);
+
+    while (true) {
+        VIR_AUTOCLOSE clientfd = -1;
+
+        if ((clientfd = accept(listenfd, NULL, NULL)) < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            vshError(ctl, _("Unable to accept connection: %s"),
+                     g_strerror(errno));
+            break;
+        }
+
+        if (virshServerHandleClient(ctl, clientfd) < 0)
+            vshError(ctl, _("Failed to process request: %s"),
+                     g_strerror(errno));
+    }
+
+    serving = false;
+    unlink(path);
+    return false;
+}
+
+#else /* WIN32 */
+
+int
+virshServerRunCommand(vshControl *ctl,
+                      const char *path G_GNUC_UNUSED,
+                      int argc G_GNUC_UNUSED,
+                      char **argv G_GNUC_UNUSED)
+{
+    vshError(ctl, "%s", _("virsh server is not supported on this platform"));
+    return EXIT_FAILURE;
+}
+
+#endif /* WIN32 */
@@ -0,0 +1,32 @@
+/*
+ * virsh-server.h: Run virsh commands over a persistent connection
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "virsh.h"
+
+int virshServerRunCommand(vshControl *ctl,
+                          const char *path,
+                          int argc,
+                          char **argv);
+
+#ifndef WIN32
+extern const vshCmdOptDef opts_server[];
+extern const vshCmdInfo info_server[];
+bool cmdServer(vshControl *ctl, const vshCmd *cmd);
+#endif /* !WIN32 */
@@ -447,6 +447,134 @@ cmdSnapshotCreateAs(vshControl *ctl, const vshCmd *cmd)
     return virshSnapshotCreate(ctl, dom, buffer, flags, NULL);
 }
 
+/*
+ * "snapshot-create-group" command
+ */
+static const vshCmdInfo info_snapshot_create_group[] = {
+    {.name = "help",
+     .data = N_("Create disk snapshots of several domains at once")
+    },
+    {.name = "desc",
+     .data = N_("Create consistent disk only snapshots of a group of domains")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_snapshot_create_group[] = {
+    {.name = "name",
+     .type = VSH_OT_STRING,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .completer = virshCompleteEmpty,
+     .help = N_("name of the snapshots")
+    },
+    {.name = "description",
+     .type = VSH_OT_STRING,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .completer = virshCompleteEmpty,
+     .help = N_("description of the snapshots")
+    },
+    {.name = "no-metadata",
+     .type = VSH_OT_BOOL,
+     .help = N_("take snapshots but create no metadata")
+    },
+    {.name = "quiesce",
+     .type = VSH_OT_BOOL,
+     .help = N_("quiesce guests' file systems")
+    },
+    {.name = "atomic",
+     .type = VSH_OT_BOOL,
+     .help = N_("require atomic operation")
+    },
+    {.name = "validate",
+     .type = VSH_OT_BOOL,
+     .help = N_("validate the XML against the schema"),
+    },
+    VIRSH_COMMON_OPT_DOMAIN_OT_ARGV(N_("list of domains to snapshot"),
+                                    VIR_CONNECT_LIST_DOMAINS_ACTIVE),
+    {.name = NULL}
+};
+
+static bool
+cmdSnapshotCreateGroup(vshControl *ctl, const vshCmd *cmd)
+{
+    g_autofree virDomainPtr *doms = NULL;
+    g_autofree const char **xmls = NULL;
+    g_autofree virDomainSnapshotPtr *snaps = NULL;
+    g_autofree char *buffer = NULL;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    const char *name = NULL;
+    const char *desc = NULL;
+    const vshCmdOpt *opt = NULL;
+    unsigned int flags = VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY;
+    size_t ndoms = 0;
+    size_t i;
+    bool ret = false;
+
+    if (vshCommandOptBool(cmd, "no-metadata"))
+        flags |= VIR_DOMAIN_SNAPSHOT_CREATE_NO_METADATA;
+    if (vshCommandOptBool(cmd, "quiesce"))
+        flags |= VIR_DOMAIN_SNAPSHOT_CREATE_QUIESCE;
+    if (vshCommandOptBool(cmd, "atomic"))
+        flags |= VIR_DOMAIN_SNAPSHOT_CREATE_ATOMIC;
+    if (vshCommandOptBool(cmd, "validate"))
+        flags |= VIR_DOMAIN_SNAPSHOT_CREATE_VALIDATE;
+
+    if (vshCommandOptStringReq(ctl, cmd, "name", &name) < 0 ||
+        vshCommandOptStringReq(ctl, cmd, "description", &desc) < 0)
+        return false;
+
+    if (!vshCommandOptBool(cmd, "domain")) {
+        vshError(ctl, "%s", _("at least one domain is required"));
+        return false;
+    }
+
+    virBufferAddLit(&buf, "<domainsnapshot>\n");
+    virBufferAdjustIndent(&buf, 2);
+    virBufferEscapeString(&buf, "<name>%s</name>\n", name);
+    virBufferEscapeString(&buf, "<description>%s</description>\n", desc);
+    virBufferAdjustIndent(&buf, -2);
+    virBufferAddLit(&buf, "</domainsnapshot>\n");
+
+    buffer = virBufferContentAndReset(&buf);
+
+    while ((opt = vshCommandOptArgv(ctl, cmd, opt))) {
+        virDomainPtr dom;
+
+        if (!(dom = virshLookupDomainBy(ctl, opt->data,
+                                        VIRSH_BYID |
+                                        VIRSH_BYUUID | VIRSH_BYNAME)))
+            goto cleanup;
+
+        VIR_APPEND_ELEMENT(doms, ndoms, dom);
+    }
+
+    xmls = g_new0(const char *, ndoms);
+    snaps = g_new0(virDomainSnapshotPtr, ndoms);
+
+    for (i = 0; i < ndoms; i++)
+        xmls[i] = buffer;
+
+    if (virDomainSnapshotCreateXMLGroup(doms, ndoms, xmls, snaps, flags) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ndoms; i++) {
+        vshPrintExtra(ctl, _("Domain snapshot %s of domain %s created\n"),
+                      virDomainSnapshotGetName(snaps[i]),
+                      virDomainGetName(doms[i]));
+    }
+
+    ret = true;
+
+ cleanup:
+    for (i = 0; i < ndoms; i++) {
+        if (snaps)
+            virshDomainSnapshotFree(snaps[i]);
+        virshDomainFree(doms[i]);
+    }
+
+    return ret;
+}
+
 /* Helper for resolving {--current | --ARG name} into a snapshot
  * belonging to DOM.  If EXCLUSIVE, fail if both --current and arg are
  * present.  On success, populate *SNAP and *NAME, before returning 0.
@@ -1855,6 +1983,12 @@ const vshCmdDef snapshotCmds[] = {
      .info = info_snapshot_create_as,
      .flags = 0
     },
+    {.name = "snapshot-create-group",
+     .handler = cmdSnapshotCreateGroup,
+     .opts = opts_snapshot_create_group,
+     .info = info_snapshot_create_group,
+     .flags = 0
+    },
     {.name = "snapshot-current",
      .handler = cmdSnapshotCurrent,
      .opts = opts_snapshot_current,
@@ -53,6 +53,7 @@
 #include "virsh-nwfilter.h"
 #include "virsh-pool.h"
 #include "virsh-secret.h"
+#include "virsh-server.h"
 #include "virsh-snapshot.h"
 #include "virsh-volume.h"
 
@@ -454,6 +455,7 @@ virshUsage(void)
                       "    -l | --log=FILE         output logging to file\n"
                       "    -q | --quiet            quiet mode\n"
                       "    -r | --readonly         connect readonly\n"
+                      "    -S | --server=SOCKET    run the command in the virsh server at SOCKET\n"
                       "    -t | --timing           print timing information\n"
                       "    -v                      short version\n"
                       "    -V                      long version\n"
@@ -651,6 +653,7 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
         {"log", required_argument, NULL, 'l'},
         {"quiet", no_argument, NULL, 'q'},
         {"readonly", no_argument, NULL, 'r'},
+        {"server", required_argument, NULL, 'S'},
         {"timing", no_argument, NULL, 't'},
         {"version", optional_argument, NULL, 'v'},
         {NULL, 0, NULL, 0}
@@ -659,7 +662,7 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     /* Standard (non-command) options. The leading + ensures that no
      * argument reordering takes place, so that command options are
      * not confused with top-level virsh options. */
-    while ((arg = getopt_long(argc, argv, "+:c:d:e:hk:K:l:qrtvV", opt, &longindex)) != -1) {
+    while ((arg = getopt_long(argc, argv, "+:c:d:e:hk:K:l:qrS:tvV", opt, &longindex)) != -1) {
         switch (arg) {
         case 'c':
             VIR_FREE(ctl->connname);
@@ -740,6 +743,9 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
         case 'r':
             priv->readonly = true;
             break;
+        case 'S':
+            priv->server = optarg;
+            break;
         case 'v':
             if (STRNEQ_NULLABLE(optarg, "long")) {
                 puts(VERSION);
@@ -773,6 +779,25 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
         longindex = -1;
     }
 
+    if (priv->server) {
+        if (argc == optind) {
+            vshError(ctl, "%s", _("--server requires a command"));
+            return false;
+        }
+        if (ctl->connname || priv->readonly) {
+            vshError(ctl, "%s",
+                     _("--server uses the connection of the server, "
+                       "--connect and --readonly can't be used"));
+            return false;
+        }
+
+        /* The command is parsed by the server */
+        ctl->imode = false;
+        priv->serverArgc = argc - optind;
+        priv->serverArgv = argv + optind;
+        return true;
+    }
+
     if (argc == optind) {
         ctl->imode = true;
     } else {
@@ -803,6 +828,14 @@ static const vshCmdDef virshCmds[] = {
      .info = info_connect,
      .flags = VSH_CMD_FLAG_NOCONNECT
     },
+#ifndef WIN32
+    {.name = "server",
+     .handler = cmdServer,
+     .opts = opts_server,
+     .info = info_server,
+     .flags = 0
+    },
+#endif /* !WIN32 */
     {.name = NULL}
 };
 
@@ -886,8 +919,20 @@ main(int argc, char **argv)
     if (!vshInit(ctl, cmdGroups, NULL))
         exit(EXIT_FAILURE);
 
-    if (!virshParseArgv(ctl, argc, argv) ||
-        !virshInit(ctl)) {
+    if (!virshParseArgv(ctl, argc, argv)) {
+        virshDeinit(ctl);
+        exit(EXIT_FAILURE);
+    }
+
+    if (virshCtl.server) {
+        int status = virshServerRunCommand(ctl, virshCtl.server,
+                                           virshCtl.serverArgc,
+                                           virshCtl.serverArgv);
+        virshDeinit(ctl);
+        exit(status);
+    }
+
+    if (!virshInit(ctl)) {
         virshDeinit(ctl);
         exit(EXIT_FAILURE);
     }
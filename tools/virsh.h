@@ -149,6 +149,10 @@ struct _virshControl {
                                    are missing */
     const char *escapeChar;     /* String representation of
                                    console escape character */
+    const char *server;         /* socket of a virsh server to run the
+                                   command in, instead of connecting */
+    int serverArgc;             /* command to run in the virsh server */
+    char **serverArgv;
 };
 
 /* Typedefs, function prototypes for job progress reporting.
@@ -421,8 +421,10 @@ cmdSrvThreadpoolInfo(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
     }
 
-    for (i = 0; i < nparams; i++)
-        vshPrint(ctl, "%-15s: %u\n", params[i].field, params[i].value.ui);
+    for (i = 0; i < nparams; i++) {
+        g_autofree char *str = vshGetTypedParamValue(ctl, &params[i]);
+        vshPrint(ctl, "%-15s: %s\n", params[i].field, str);
+    }
 
     ret = true;
 
@@ -468,6 +470,11 @@ static const vshCmdOptDef opts_srv_threadpool_set[] = {
      .type = VSH_OT_INT,
      .help = N_("Change the current number of priority workers"),
     },
+    {.name = "max-mutating-workers",
+     .type = VSH_OT_INT,
+     .help = N_("Change upper limit to number of workers processing "
+                "calls which modify state."),
+    },
     {.name = NULL}
 };
 
@@ -500,13 +507,15 @@ cmdSrvThreadpoolSet(vshControl *ctl, const vshCmd *cmd)
     PARSE_CMD_TYPED_PARAM("max-workers", VIR_THREADPOOL_WORKERS_MAX);
     PARSE_CMD_TYPED_PARAM("min-workers", VIR_THREADPOOL_WORKERS_MIN);
     PARSE_CMD_TYPED_PARAM("priority-workers", VIR_THREADPOOL_WORKERS_PRIORITY);
+    PARSE_CMD_TYPED_PARAM("max-mutating-workers",
+                          VIR_THREADPOOL_MUTATING_WORKERS_MAX);
 
 #undef PARSE_CMD_TYPED_PARAM
 
     if (!nparams) {
         vshError(ctl, "%s",
                  _("At least one of options --min-workers, --max-workers, "
-                   "--priority-workers is mandatory "));
+                   "--priority-workers, --max-mutating-workers is mandatory "));
             goto cleanup;
     }
 
@@ -717,6 +726,137 @@ cmdClientInfo(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/* --------------------
+ * Command client-stats
+ * --------------------
+ */
+
+static const vshCmdInfo info_client_stats[] = {
+    {.name = "help",
+     .data = N_("retrieve client's traffic and call statistics from server")
+    },
+    {.name = "desc",
+     .data = N_("Retrieve the number of bytes and messages transferred, "
+                "calls per procedure and a histogram of call latencies "
+                "of <client> from <server>")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_client_stats[] = {
+    {.name = "server",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .completer = vshAdmServerCompleter,
+     .help = N_("server to which <client> is connected to"),
+    },
+    {.name = "client",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .help = N_("client which to retrieve statistics for"),
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdClientStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    size_t i;
+    unsigned long long id;
+    const char *srvname = NULL;
+    virAdmServerPtr srv = NULL;
+    virAdmClientPtr clnt = NULL;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    g_autoptr(vshTable) procs = NULL;
+    g_autoptr(vshTable) latency = NULL;
+    const char *counters[] = {
+        VIR_CLIENT_INFO_RX_BYTES,
+        VIR_CLIENT_INFO_TX_BYTES,
+        VIR_CLIENT_INFO_RX_MESSAGES,
+        VIR_CLIENT_INFO_TX_MESSAGES,
+        VIR_CLIENT_INFO_CALLS,
+    };
+    vshAdmControl *priv = ctl->privData;
+
+    if (vshCommandOptULongLong(ctl, cmd, "client", &id) < 0)
+        return false;
+
+    if (vshCommandOptStringReq(ctl, cmd, "server", &srvname) < 0)
+        return false;
+
+    if (!(srv = virAdmConnectLookupServer(priv->conn, srvname, 0)) ||
+        !(clnt = virAdmServerLookupClient(srv, id, 0)))
+        goto cleanup;
+
+    if (virAdmClientGetInfo(clnt, &params, &nparams,
+                            VIR_ADM_CLIENT_INFO_STATS) < 0) {
+        vshError(ctl, _("failed to retrieve statistics for client '%llu' "
+                        "connected to server '%s'"),
+                        id, virAdmServerGetName(srv));
+        goto cleanup;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(counters); i++) {
+        unsigned long long val = 0;
+
+        if (virTypedParamsGetULLong(params, nparams, counters[i], &val) < 0)
+            goto cleanup;
+        vshPrint(ctl, "%-15s: %llu\n", counters[i], val);
+    }
+
+    procs = vshTableNew(_("Procedure"), _("Calls"), NULL);
+    latency = vshTableNew(_("Latency"), _("Calls"), NULL);
+    if (!procs || !latency)
+        goto cleanup;
+
+    for (i = 0; i < nparams; i++) {
+        const char *field = params[i].field;
+        const char *suffix;
+        g_autofree char *calls = NULL;
+        g_autofree char *range = NULL;
+
+        if (params[i].type != VIR_TYPED_PARAM_ULLONG)
+            continue;
+
+        calls = g_strdup_printf("%llu", params[i].value.ul);
+
+        if ((suffix = STRSKIP(field, VIR_CLIENT_INFO_CALLS_PREFIX))) {
+            if (vshTableRowAppend(procs, suffix, calls, NULL) < 0)
+                goto cleanup;
+        } else if ((suffix = STRSKIP(field, VIR_CLIENT_INFO_LATENCY_PREFIX))) {
+            unsigned int bucket;
+
+            if (virStrToLong_ui(suffix, NULL, 10, &bucket) < 0 ||
+                bucket >= 64)
+                continue;
+
+            if (bucket == 0)
+                range = g_strdup("< 1us");
+            else
+                range = g_strdup_printf("%llu-%lluus", 1ULL << (bucket - 1),
+                                        1ULL << bucket);
+
+            if (vshTableRowAppend(latency, range, calls, NULL) < 0)
+                goto cleanup;
+        }
+    }
+
+    vshPrint(ctl, "\n");
+    vshTablePrintToStdout(procs, ctl);
+    vshPrint(ctl, "\n");
+    vshTablePrintToStdout(latency, ctl);
+
+    ret = true;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    virAdmServerFree(srv);
+    virAdmClientFree(clnt);
+    return ret;
+}
+
 /* -------------------------
  * Command client-disconnect
  * -------------------------
@@ -1107,6 +1247,95 @@ cmdDaemonLogOutputs(vshControl *ctl, const vshCmd *cmd)
     return true;
 }
 
+/* ---------------------------
+ * Command daemon-object-stats
+ * ---------------------------
+ */
+static const vshCmdInfo info_daemon_object_stats[] = {
+    {.name = "help",
+     .data = N_("show the number of objects of each class in the daemon")
+    },
+    {.name = "desc",
+     .data = N_("Retrieve the number of live and created objects of each "
+                "class in the daemon, ordered by the number of live objects.")
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdDaemonObjectStats(vshControl *ctl, const vshCmd *cmd G_GNUC_UNUSED)
+{
+    bool ret = false;
+    size_t i;
+    unsigned int count = 0;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    g_autoptr(vshTable) table = NULL;
+    vshAdmControl *priv = ctl->privData;
+
+    if (virAdmConnectGetObjectStats(priv->conn, &params, &nparams, 0) < 0) {
+        vshError(ctl, "%s", _("Unable to get daemon object statistics"));
+        goto cleanup;
+    }
+
+    if (virTypedParamsGetUInt(params, nparams,
+                              VIR_OBJECT_STATS_CLASS_COUNT, &count) < 0)
+        goto cleanup;
+
+    if (!(table = vshTableNew(_("Class"), _("Live"), _("Created"),
+                              _("Size"), _("Live bytes"), NULL)))
+        goto cleanup;
+
+    for (i = 0; i < count; i++) {
+        char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+        const char *name = NULL;
+        unsigned long long size = 0;
+        unsigned long long live = 0;
+        unsigned long long created = 0;
+        g_autofree char *liveStr = NULL;
+        g_autofree char *createdStr = NULL;
+        g_autofree char *sizeStr = NULL;
+        g_autofree char *bytesStr = NULL;
+
+        g_snprintf(field, sizeof(field), VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                   VIR_OBJECT_STATS_CLASS_SUFFIX_NAME, i);
+        if (virTypedParamsGetString(params, nparams, field, &name) <= 0)
+            continue;
+
+        g_snprintf(field, sizeof(field), VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                   VIR_OBJECT_STATS_CLASS_SUFFIX_SIZE, i);
+        if (virTypedParamsGetULLong(params, nparams, field, &size) < 0)
+            goto cleanup;
+
+        g_snprintf(field, sizeof(field), VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                   VIR_OBJECT_STATS_CLASS_SUFFIX_LIVE, i);
+        if (virTypedParamsGetULLong(params, nparams, field, &live) < 0)
+            goto cleanup;
+
+        g_snprintf(field, sizeof(field), VIR_OBJECT_STATS_CLASS_PREFIX "%zu"
+                   VIR_OBJECT_STATS_CLASS_SUFFIX_CREATED, i);
+        if (virTypedParamsGetULLong(params, nparams, field, &created) < 0)
+            goto cleanup;
+
+        liveStr = g_strdup_printf("%llu", live);
+        createdStr = g_strdup_printf("%llu", created);
+        sizeStr = g_strdup_printf("%llu", size);
+        bytesStr = g_strdup_printf("%llu", size * live);
+
+        if (vshTableRowAppend(table, name, liveStr, createdStr,
+                              sizeStr, bytesStr, NULL) < 0)
+            goto cleanup;
+    }
+
+    vshTablePrintToStdout(table, ctl);
+
+    ret = true;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
 static void *
 vshAdmConnectionHandler(vshControl *ctl)
 {
@@ -1437,6 +1666,12 @@ static const vshCmdDef monitoringCmds[] = {
      .info = info_client_info,
      .flags = 0
     },
+    {.name = "client-stats",
+     .handler = cmdClientStats,
+     .opts = opts_client_stats,
+     .info = info_client_stats,
+     .flags = 0
+    },
     {.name = "srv-clients-info",
      .flags = VSH_CMD_FLAG_ALIAS,
      .alias = "server-clients-info"
@@ -1447,6 +1682,12 @@ static const vshCmdDef monitoringCmds[] = {
      .info = info_srv_clients_info,
      .flags = 0
     },
+    {.name = "daemon-object-stats",
+     .handler = cmdDaemonObjectStats,
+     .opts = NULL,
+     .info = info_daemon_object_stats,
+     .flags = 0
+    },
     {.name = NULL}
 };
 
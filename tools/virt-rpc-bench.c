@@ -0,0 +1,633 @@
+/*
+ * virt-rpc-bench.c: load generator measuring the RPC throughput of a daemon
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "internal.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "virgettext.h"
+
+#define BENCH_DEFAULT_MIX "version=1,list=1,lookup=4,info=4,xml=2,stats=2"
+
+typedef struct _benchWorker benchWorker;
+
+typedef int (*benchOpFunc)(benchWorker *worker);
+
+typedef struct _benchOp benchOp;
+struct _benchOp {
+    const char *name;
+    benchOpFunc func;
+};
+
+typedef struct _benchResult benchResult;
+struct _benchResult {
+    GArray *latencies; /* of gint64, in microseconds */
+    unsigned long long errors;
+};
+
+struct _benchWorker {
+    GThread *thread;
+    virConnectPtr conn;
+    virDomainPtr dom;
+    GRand *rand;
+
+    benchResult *results; /* indexed like benchOps */
+};
+
+
+static int
+benchOpVersion(benchWorker *worker)
+{
+    unsigned long version;
+
+    return virConnectGetLibVersion(worker->conn, &version);
+}
+
+
+static int
+benchOpList(benchWorker *worker)
+{
+    virDomainPtr *doms = NULL;
+    int ndoms;
+    int i;
+
+    if ((ndoms = virConnectListAllDomains(worker->conn, &doms, 0)) < 0)
+        return -1;
+
+    for (i = 0; i < ndoms; i++)
+        virDomainFree(doms[i]);
+    g_free(doms);
+    return 0;
+}
+
+
+static int
+benchOpLookup(benchWorker *worker)
+{
+    virDomainPtr dom;
+
+    if (!(dom = virDomainLookupByName(worker->conn,
+                                      virDomainGetName(worker->dom))))
+        return -1;
+
+    virDomainFree(dom);
+    return 0;
+}
+
+
+static int
+benchOpInfo(benchWorker *worker)
+{
+    virDomainInfo info;
+
+    return virDomainGetInfo(worker->dom, &info);
+}
+
+
+static int
+benchOpXML(benchWorker *worker)
+{
+    g_autofree char *xml = NULL;
+
+    if (!(xml = virDomainGetXMLDesc(worker->dom, 0)))
+        return -1;
+
+    return 0;
+}
+
+
+static int
+benchOpStats(benchWorker *worker)
+{
+    virDomainPtr doms[] = { worker->dom, NULL };
+    virDomainStatsRecordPtr *records = NULL;
+
+    if (virDomainListGetStats(doms, 0, &records, 0) < 0)
+        return -1;
+
+    virDomainStatsRecordListFree(records);
+    return 0;
+}
+
+
+/* emits two lifecycle events, which is what --events listens for */
+static int
+benchOpLifecycle(benchWorker *worker)
+{
+    if (virDomainSuspend(worker->dom) < 0)
+        return -1;
+
+    return virDomainResume(worker->dom);
+}
+
+
+static int
+benchOpScreenshot(benchWorker *worker)
+{
+    virStreamPtr st;
+    g_autofree char *mime = NULL;
+    char buf[64 * 1024];
+    int got;
+    int ret = -1;
+
+    if (!(st = virStreamNew(worker->conn, 0)))
+        return -1;
+
+    if (!(mime = virDomainScreenshot(worker->dom, st, 0, 0)))
+        goto cleanup;
+
+    while ((got = virStreamRecv(st, buf, sizeof(buf))) > 0)
+        ;
+
+    if (got < 0 || virStreamFinish(st) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    if (ret < 0)
+        virStreamAbort(st);
+    virStreamFree(st);
+    return ret;
+}
+
+
+static const benchOp benchOps[] = {
+    { "version", benchOpVersion },
+    { "list", benchOpList },
+    { "lookup", benchOpLookup },
+    { "info", benchOpInfo },
+    { "xml", benchOpXML },
+    { "stats", benchOpStats },
+    { "lifecycle", benchOpLifecycle },
+    { "screenshot", benchOpScreenshot },
+};
+
+
+/* cumulative weights of benchOps as given by --mix */
+static unsigned int benchWeights[G_N_ELEMENTS(benchOps)];
+
+static gint64 benchMeasureStart;
+static gint64 benchEnd;
+static gint benchEvents;
+static gint benchQuit;
+
+
+static int
+benchParseMix(const char *mix)
+{
+    g_auto(GStrv) items = g_strsplit(mix, ",", 0);
+    unsigned int weights[G_N_ELEMENTS(benchOps)] = { 0 };
+    unsigned int total = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; items[i]; i++) {
+        char *weight = strchr(items[i], '=');
+        guint64 value = 1;
+
+        if (weight) {
+            *weight++ = '\0';
+            if (!g_ascii_string_to_unsigned(weight, 10, 0, 1000, &value, NULL)) {
+                g_printerr(_("invalid weight '%s' of '%s'\n"), weight, items[i]);
+                return -1;
+            }
+        }
+
+        for (j = 0; j < G_N_ELEMENTS(benchOps); j++) {
+            if (STREQ(items[i], benchOps[j].name))
+                break;
+        }
+
+        if (j == G_N_ELEMENTS(benchOps)) {
+            g_printerr(_("unknown procedure '%s'\n"), items[i]);
+            return -1;
+        }
+
+        weights[j] = value;
+    }
+
+    for (j = 0; j < G_N_ELEMENTS(benchOps); j++) {
+        total += weights[j];
+        benchWeights[j] = total;
+    }
+
+    if (total == 0) {
+        g_printerr(_("the mix doesn't contain any procedure\n"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static size_t
+benchPickOp(benchWorker *worker)
+{
+    unsigned int total = benchWeights[G_N_ELEMENTS(benchOps) - 1];
+    unsigned int r = g_rand_int_range(worker->rand, 0, total);
+    size_t i;
+
+    for (i = 0; r >= benchWeights[i]; i++)
+        ;
+
+    return i;
+}
+
+
+static gpointer
+benchWorkerRun(gpointer opaque)
+{
+    benchWorker *worker = opaque;
+    gint64 now;
+
+    while ((now = g_get_monotonic_time()) < benchEnd) {
+        size_t op = benchPickOp(worker);
+        int rc = benchOps[op].func(worker);
+        gint64 latency = g_get_monotonic_time() - now;
+
+        /* results of the warm-up period are dropped */
+        if (now < benchMeasureStart)
+            continue;
+
+        if (rc < 0)
+            worker->results[op].errors++;
+        else
+            g_array_append_val(worker->results[op].latencies, latency);
+    }
+
+    return NULL;
+}
+
+
+static int
+benchEventLifecycle(virConnectPtr conn G_GNUC_UNUSED,
+                    virDomainPtr dom G_GNUC_UNUSED,
+                    int event G_GNUC_UNUSED,
+                    int detail G_GNUC_UNUSED,
+                    void *opaque G_GNUC_UNUSED)
+{
+    if (g_get_monotonic_time() >= benchMeasureStart)
+        g_atomic_int_inc(&benchEvents);
+    return 0;
+}
+
+
+static void
+benchEventTick(int timer G_GNUC_UNUSED,
+               void *opaque G_GNUC_UNUSED)
+{
+}
+
+
+static gpointer
+benchEventLoop(gpointer opaque G_GNUC_UNUSED)
+{
+    while (!g_atomic_int_get(&benchQuit)) {
+        if (virEventRunDefaultImpl() < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+
+static int
+benchCompareLatency(gconstpointer a,
+                    gconstpointer b)
+{
+    gint64 la = *(const gint64 *)a;
+    gint64 lb = *(const gint64 *)b;
+
+    return la < lb ? -1 : la > lb;
+}
+
+
+static gint64
+benchPercentile(GArray *latencies,
+                double percentile)
+{
+    size_t idx;
+
+    if (latencies->len == 0)
+        return 0;
+
+    idx = (size_t) (percentile * latencies->len);
+    if (idx >= latencies->len)
+        idx = latencies->len - 1;
+
+    return g_array_index(latencies, gint64, idx);
+}
+
+
+static void
+benchPrintResult(const char *name,
+                 benchResult *result,
+                 double seconds)
+{
+    g_array_sort(result->latencies, benchCompareLatency);
+
+    printf("%-12s %10u %8llu %12.1f %10lld %10lld %10lld\n",
+           name, result->latencies->len, result->errors,
+           result->latencies->len / seconds,
+           (long long) benchPercentile(result->latencies, 0.5),
+           (long long) benchPercentile(result->latencies, 0.99),
+           (long long) benchPercentile(result->latencies, 0.999));
+}
+
+
+static void
+print_usage(const char *progname,
+            FILE *out)
+{
+    size_t i;
+
+    fprintf(out,
+            _("Usage:\n"
+              "  %s [OPTIONS]\n"
+              "\n"
+              "Drive a mix of API calls against a libvirt daemon and report\n"
+              "the throughput and latency percentiles of each procedure.\n"
+              "\n"
+              "options:\n"
+              "  -c | --connect URI      hypervisor connection URI\n"
+              "  -t | --threads N        number of concurrent callers (default 8)\n"
+              "  -d | --duration SECS    length of the measurement (default 10)\n"
+              "  -w | --warmup SECS      length of the unmeasured warm-up (default 1)\n"
+              "  -m | --mix MIX          weighted procedures to call\n"
+              "                          (default %s)\n"
+              "  -s | --shared           share one connection among all callers\n"
+              "  -e | --events           listen for domain lifecycle events\n"
+              "  -h | --help             display this help and exit\n"
+              "  -v | --version          output version information and exit\n"
+              "\n"
+              "MIX is a comma separated list of PROCEDURE=WEIGHT items, where\n"
+              "PROCEDURE is one of:\n"),
+            progname, BENCH_DEFAULT_MIX);
+
+    for (i = 0; i < G_N_ELEMENTS(benchOps); i++)
+        fprintf(out, "  %s\n", benchOps[i].name);
+
+    fprintf(out,
+            _("\n"
+              "Callers use the domains of the connection in turn, lifecycle\n"
+              "suspends and resumes them. Use for example\n"
+              "'test+unix:///scale?domains=1000' to benchmark the daemon\n"
+              "without running real guests.\n"));
+}
+
+
+int
+main(int argc,
+     char **argv)
+{
+    const char *progname = NULL;
+    const char *uri = NULL;
+    const char *mix = BENCH_DEFAULT_MIX;
+    guint64 nworkers = 8;
+    guint64 duration = 10;
+    guint64 warmup = 1;
+    bool shared = false;
+    bool events = false;
+    g_autofree benchWorker *workers = NULL;
+    virConnectPtr sharedConn = NULL;
+    virDomainPtr *doms = NULL;
+    int ndoms = 0;
+    GThread *eventThread = NULL;
+    int timer = -1;
+    benchResult total = { 0 };
+    double seconds;
+    size_t i;
+    size_t j;
+    int arg;
+    int ret = EXIT_FAILURE;
+
+    struct option opt[] = {
+        {"connect", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"duration", required_argument, NULL, 'd'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"mix", required_argument, NULL, 'm'},
+        {"shared", no_argument, NULL, 's'},
+        {"events", no_argument, NULL, 'e'},
+        {"help", no_argument, NULL, 'h'},
+        {"version", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+
+    if (virGettextInitialize() < 0)
+        return EXIT_FAILURE;
+
+    if (!(progname = strrchr(argv[0], '/')))
+        progname = argv[0];
+    else
+        progname++;
+
+    while ((arg = getopt_long(argc, argv, "c:t:d:w:m:sehv", opt, NULL)) != -1) {
+        switch (arg) {
+        case 'c':
+            uri = optarg;
+            break;
+        case 't':
+            if (!g_ascii_string_to_unsigned(optarg, 10, 1, 10000, &nworkers, NULL)) {
+                g_printerr(_("%s: invalid number of threads '%s'\n"), progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'd':
+            if (!g_ascii_string_to_unsigned(optarg, 10, 1, 86400, &duration, NULL)) {
+                g_printerr(_("%s: invalid duration '%s'\n"), progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            if (!g_ascii_string_to_unsigned(optarg, 10, 0, 86400, &warmup, NULL)) {
+                g_printerr(_("%s: invalid warm-up '%s'\n"), progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'm':
+            mix = optarg;
+            break;
+        case 's':
+            shared = true;
+            break;
+        case 'e':
+            events = true;
+            break;
+        case 'v':
+            printf("%s\n", PACKAGE_VERSION);
+            return EXIT_SUCCESS;
+        case 'h':
+            print_usage(progname, stdout);
+            return EXIT_SUCCESS;
+        default:
+            print_usage(progname, stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc) {
+        print_usage(progname, stderr);
+        return EXIT_FAILURE;
+    }
+
+    if (benchParseMix(mix) < 0)
+        return EXIT_FAILURE;
+
+    /* the event loop keeps the connections alive and delivers events */
+    if (virEventRegisterDefaultImpl() < 0 ||
+        (timer = virEventAddTimeout(100, benchEventTick, NULL, NULL)) < 0)
+        goto cleanup;
+
+    eventThread = g_thread_new("bench-event", benchEventLoop, NULL);
+
+    if (!(sharedConn = virConnectOpen(uri)))
+        goto cleanup;
+
+    if ((ndoms = virConnectListAllDomains(sharedConn, &doms, 0)) < 0)
+        goto cleanup;
+
+    if (ndoms == 0) {
+        g_printerr(_("%s: the connection has no domains\n"), progname);
+        goto cleanup;
+    }
+
+    workers = g_new0(benchWorker, nworkers);
+
+    for (i = 0; i < nworkers; i++) {
+        benchWorker *worker = &workers[i];
+        unsigned char uuid[VIR_UUID_BUFLEN];
+
+        if (shared) {
+            if (virConnectRef(sharedConn) < 0)
+                goto cleanup;
+            worker->conn = sharedConn;
+        } else if (!(worker->conn = virConnectOpen(uri))) {
+            goto cleanup;
+        }
+
+        if (virDomainGetUUID(doms[i % ndoms], uuid) < 0 ||
+            !(worker->dom = virDomainLookupByUUID(worker->conn, uuid)))
+            goto cleanup;
+
+        if (events && (!shared || i == 0) &&
+            virConnectDomainEventRegisterAny(worker->conn, NULL,
+                                             VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                             VIR_DOMAIN_EVENT_CALLBACK(benchEventLifecycle),
+                                             NULL, NULL) < 0)
+            goto cleanup;
+
+        worker->rand = g_rand_new_with_seed(i);
+        worker->results = g_new0(benchResult, G_N_ELEMENTS(benchOps));
+        for (j = 0; j < G_N_ELEMENTS(benchOps); j++)
+            worker->results[j].latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+    }
+
+    benchMeasureStart = g_get_monotonic_time() + warmup * G_USEC_PER_SEC;
+    benchEnd = benchMeasureStart + duration * G_USEC_PER_SEC;
+
+    for (i = 0; i < nworkers; i++)
+        workers[i].thread = g_thread_new("bench-worker", benchWorkerRun, &workers[i]);
+
+    for (i = 0; i < nworkers; i++)
+        g_thread_join(g_steal_pointer(&workers[i].thread));
+
+    seconds = (g_get_monotonic_time() - benchMeasureStart) / (double) G_USEC_PER_SEC;
+
+    printf("%-12s %10s %8s %12s %10s %10s %10s\n",
+           "procedure", "calls", "errors", "calls/s",
+           "p50(us)", "p99(us)", "p999(us)");
+
+    total.latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+    for (j = 0; j < G_N_ELEMENTS(benchOps); j++) {
+        benchResult result = { 0 };
+
+        if (benchWeights[j] == (j > 0 ? benchWeights[j - 1] : 0))
+            continue;
+
+        result.latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+        for (i = 0; i < nworkers; i++) {
+            GArray *latencies = workers[i].results[j].latencies;
+
+            g_array_append_vals(result.latencies, latencies->data, latencies->len);
+            g_array_append_vals(total.latencies, latencies->data, latencies->len);
+            result.errors += workers[i].results[j].errors;
+        }
+
+        total.errors += result.errors;
+        benchPrintResult(benchOps[j].name, &result, seconds);
+        g_array_unref(result.latencies);
+    }
+
+    benchPrintResult("total", &total, seconds);
+
+    if (events)
+        printf("%-12s %10d %8s %12.1f\n", "events",
+               g_atomic_int_get(&benchEvents), "",
+               g_atomic_int_get(&benchEvents) / seconds);
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        g_printerr("%s: %s\n", progname, virGetLastErrorMessage());
+
+    if (workers) {
+        for (i = 0; i < nworkers; i++) {
+            benchWorker *worker = &workers[i];
+
+            if (worker->dom)
+                virDomainFree(worker->dom);
+            if (worker->conn)
+                virConnectClose(worker->conn);
+            if (worker->rand)
+                g_rand_free(worker->rand);
+            if (worker->results) {
+                for (j = 0; j < G_N_ELEMENTS(benchOps); j++)
+                    g_array_unref(worker->results[j].latencies);
+                g_free(worker->results);
+            }
+        }
+    }
+
+    if (total.latencies)
+        g_array_unref(total.latencies);
+
+    for (i = 0; i < ndoms; i++)
+        virDomainFree(doms[i]);
+    g_free(doms);
+
+    if (sharedConn)
+        virConnectClose(sharedConn);
+
+    if (eventThread) {
+        g_atomic_int_set(&benchQuit, 1);
+        g_thread_join(eventThread);
+    }
+
+    if (timer >= 0)
+        virEventRemoveTimeout(timer);
+
+    return ret;
+}
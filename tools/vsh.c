@@ -158,6 +158,10 @@ vshStringToArray(const char *str,
 
 virErrorPtr last_error;
 
+/* Serializes updates of @last_error by commands which issue
+ * libvirt calls from multiple threads at once */
+static virMutex last_error_lock = VIR_MUTEX_INITIALIZER;
+
 /*
  * Quieten libvirt until we're done with the command.
  */
@@ -165,8 +169,7 @@ void
 vshErrorHandler(void *opaque G_GNUC_UNUSED,
                 virErrorPtr error G_GNUC_UNUSED)
 {
-    virFreeError(last_error);
-    last_error = virSaveLastError();
+    vshSaveLibvirtError();
 }
 
 /* Store a libvirt error that is from a helper API that doesn't raise errors
@@ -174,8 +177,10 @@ vshErrorHandler(void *opaque G_GNUC_UNUSED,
 void
 vshSaveLibvirtError(void)
 {
+    virMutexLock(&last_error_lock);
     virFreeError(last_error);
     last_error = virSaveLastError();
+    virMutexUnlock(&last_error_lock);
 }
 
 
@@ -199,8 +204,10 @@ vshSaveLibvirtHelperError(void)
 void
 vshResetLibvirtError(void)
 {
+    virMutexLock(&last_error_lock);
     virFreeError(last_error);
     last_error = NULL;
+    virMutexUnlock(&last_error_lock);
     virResetLastError();
 }
 